@@ -0,0 +1,231 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "autosave_journal.h"
+
+#include <cstring>
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QScopedValueRollback>
+#include <QXmlStreamReader>
+#include <QtEndian>
+
+#include "file_format.h"
+#include "map.h"
+#include "symbol.h"
+#include "undo.h"
+#include "undo_manager.h"
+#include "util/xml_stream_util.h"
+
+
+namespace
+{
+	/** The magic bytes at the beginning of a journal. */
+	const char magic_bytes[8] = { 'O', 'O', 'J', 'O', 'U', 'R', 'N', 'L' };
+	
+	/** The size of the header: magic bytes, base size, base modification time. */
+	const int header_size = 24;
+	
+	static const QLatin1String steps_element("steps");
+	static const QLatin1String step_element("step");
+	
+	/** Writes the identification of the base file into the header. */
+	void writeBaseId(uchar* pos, const QString& base_path)
+	{
+		const QFileInfo base(base_path);
+		qToLittleEndian<quint64>(quint64(base.size()), pos);
+		qToLittleEndian<qint64>(base.lastModified().toMSecsSinceEpoch(), pos + 8);
+	}
+}
+
+
+
+// ### AutosaveJournal ###
+
+AutosaveJournal::AutosaveJournal(Map* map)
+ : map(map)
+{
+	reset();
+}
+
+AutosaveJournal::~AutosaveJournal()
+{
+	// nothing, not inlined
+}
+
+QString AutosaveJournal::journalPath(const QString& base_path)
+{
+	return base_path + QLatin1String(".journal");
+}
+
+void AutosaveJournal::setBase()
+{
+	UndoManager& undo_manager = map->undoManager();
+	has_base = true;
+	has_header = false;
+	journaled_index = undo_manager.droppedStepCount() + undo_manager.undoStepCount();
+	journaled_serial = undo_manager.undoStepCount() ? undo_manager.undoStepSerial(undo_manager.undoStepCount() - 1) : 0;
+	properties_revision = map->getPropertiesRevision();
+	num_steps = 0;
+	undo_manager.clearForwardSteps();
+	undo_manager.setRecordingForwardSteps(true);
+}
+
+void AutosaveJournal::reset()
+{
+	has_base = false;
+	has_header = false;
+	journaled_index = 0;
+	journaled_serial = 0;
+	properties_revision = 0;
+	num_steps = 0;
+	map->undoManager().setRecordingForwardSteps(false);
+}
+
+bool AutosaveJournal::exportChanges(const QString& base_path, QByteArray& data, bool& append)
+{
+	data.clear();
+	append = has_header;
+	
+	if (!has_base || map->getPropertiesRevision() != properties_revision)
+		return false;
+	
+	UndoManager& undo_manager = map->undoManager();
+	// The undo manager drops old steps, so the indices are counted from the
+	// beginning of its history.
+	const std::size_t dropped = undo_manager.droppedStepCount();
+	const std::size_t index = dropped + undo_manager.undoStepCount();
+	if (index < journaled_index
+	    || journaled_index < dropped
+	    || (journaled_serial && (journaled_index == dropped || undo_manager.undoStepSerial(journaled_index - dropped - 1) != journaled_serial))
+	    || num_steps + (index - journaled_index) > max_steps)
+	{
+		return false;
+	}
+	
+	if (index == journaled_index)
+		return true; // No new changes
+	
+	// The recorded steps are UTF-8 encoded step elements.
+	QByteArray record("<steps>");
+	if (!undo_manager.saveForwardSteps(journaled_index - dropped, record))
+		return false;
+	record.append("</steps>");
+	undo_manager.clearForwardSteps();
+	
+	num_steps += index - journaled_index;
+	journaled_index = index;
+	journaled_serial = undo_manager.undoStepSerial(index - dropped - 1);
+	
+	const int prefix_size = has_header ? 4 : header_size + 4;
+	data.resize(prefix_size + record.size());
+	uchar* pos = reinterpret_cast<uchar*>(data.data());
+	if (!has_header)
+	{
+		memcpy(pos, magic_bytes, sizeof(magic_bytes));
+		writeBaseId(pos + sizeof(magic_bytes), base_path);
+		pos += header_size;
+		has_header = true;
+	}
+	qToLittleEndian<quint32>(quint32(record.size()), pos);
+	memcpy(pos + 4, record.constData(), std::size_t(record.size()));
+	
+	return true;
+}
+
+bool AutosaveJournal::replay(Map& map, const QString& base_path, QString& error_string)
+{
+	QFile file(journalPath(base_path));
+	if (!file.exists())
+		return true;
+	
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		error_string = file.errorString();
+		return false;
+	}
+	
+	const QByteArray data = file.readAll();
+	const uchar* const begin = reinterpret_cast<const uchar*>(data.constData());
+	const uchar* const end = begin + data.size();
+	
+	uchar base_id[header_size - sizeof(magic_bytes)];
+	writeBaseId(base_id, base_path);
+	if (data.size() < header_size
+	    || memcmp(begin, magic_bytes, sizeof(magic_bytes)) != 0
+	    || memcmp(begin + sizeof(magic_bytes), base_id, sizeof(base_id)) != 0)
+	{
+		return true; // Not a journal for this base
+	}
+	
+	SymbolDictionary symbol_dict;
+	for (int i = 0; i < map.getNumSymbols(); ++i)
+		symbol_dict[QString::number(i)] = map.getSymbol(i);
+	symbol_dict[QString::number(map.findSymbolIndex(map.getUndefinedPoint()))] = map.getUndefinedPoint();
+	symbol_dict[QString::number(map.findSymbolIndex(map.getUndefinedLine()))] = map.getUndefinedLine();
+	
+	QScopedValueRollback<MapCoord::BoundsOffset> offset { MapCoord::boundsOffset() };
+	MapCoord::boundsOffset().reset(false);
+	
+	try
+	{
+		for (const uchar* pos = begin + header_size; end - pos >= 4; )
+		{
+			const quint32 record_size = qFromLittleEndian<quint32>(pos);
+			pos += 4;
+			if (quint32(end - pos) < record_size)
+				break; // Incomplete record
+			
+			QXmlStreamReader xml(QByteArray::fromRawData(reinterpret_cast<const char*>(pos), int(record_size)));
+			pos += record_size;
+			if (!xml.readNextStartElement() || xml.name() != steps_element)
+				throw FileFormatException(tr("Invalid journal record."));
+			
+			while (xml.readNextStartElement())
+			{
+				if (xml.name() != step_element)
+				{
+					xml.skipCurrentElement();
+					continue;
+				}
+				
+				QScopedPointer<UndoStep> step(UndoStep::load(xml, &map, symbol_dict));
+				if (!step->isValid())
+					throw FileFormatException(tr("Invalid journal step."));
+				map.push(step->undo());
+			}
+			
+			if (xml.hasError())
+				throw FileFormatException(xml.errorString());
+		}
+	}
+	catch (FileFormatException& e)
+	{
+		error_string = e.message();
+		return false;
+	}
+	
+	return true;
+}
@@ -0,0 +1,137 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef _OPENORIENTEERING_AUTOSAVE_JOURNAL_H_
+#define _OPENORIENTEERING_AUTOSAVE_JOURNAL_H_
+
+#include <cstddef>
+
+#include <QCoreApplication>
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+class QByteArray;
+QT_END_NAMESPACE
+
+class Map;
+
+
+/**
+ * @brief AutosaveJournal records the changes of a map since its last full autosave.
+ * 
+ * The journal is a file next to the autosave file (the base). It consists of
+ * a header which identifies the base file by size and modification time, and
+ * of records which hold undo steps in XML format. Each record is preceded by
+ * its size. The steps redo the changes which were made since the base was
+ * saved. So the cost of an autosave depends on the amount of changes, not on
+ * the size of the map.
+ * 
+ * Only changes which are recorded by the undo manager can be journaled.
+ * The steps for the journal are recorded by the undo manager when the
+ * changes are pushed, so exporting does not touch the map. Changes of
+ * colors, symbols, templates and other properties, undoing steps which were
+ * already journaled, steps whose forward step cannot be determined without
+ * executing them, and a journal with more than max_steps steps require a new
+ * full autosave (compaction).
+ * 
+ * A journal whose header does not match the base file is ignored. A record
+ * which was not completely written is ignored, too.
+ */
+class AutosaveJournal
+{
+	Q_DECLARE_TR_FUNCTIONS(AutosaveJournal)
+	
+public:
+	/** The maximum number of steps in a journal. */
+	static const std::size_t max_steps = 100;
+	
+	/** Constructs a journal for the given map. */
+	explicit AutosaveJournal(Map* map);
+	
+	/** Destructor. */
+	~AutosaveJournal();
+	
+	/** Returns the path of the journal for the given base file. */
+	static QString journalPath(const QString& base_path);
+	
+	/**
+	 * Marks the current state of the map as the state of the base file.
+	 * 
+	 * This must be called after exporting a full autosave. It starts the
+	 * recording of forward steps by the map's undo manager.
+	 */
+	void setBase();
+	
+	/**
+	 * Forgets the base.
+	 * 
+	 * This must be called when the base file is removed or could not be
+	 * written. It stops the recording of forward steps.
+	 */
+	void reset();
+	
+	/**
+	 * Exports the changes since the last autosave as a journal record.
+	 * 
+	 * If append is false on return, the data starts with a header, and it
+	 * must replace the journal file. Otherwise it must be appended. The data
+	 * is empty when there are no new changes.
+	 * 
+	 * Returns false if the changes cannot be journaled. Then a full autosave
+	 * is needed.
+	 */
+	bool exportChanges(const QString& base_path, QByteArray& data, bool& append);
+	
+	/**
+	 * Applies the journal of the given base file to the map which was just
+	 * loaded from this file.
+	 * 
+	 * The replayed steps are pushed to the undo manager.
+	 * 
+	 * Returns false on error, with error_string set to a description.
+	 * Returns true if the journal was applied, or if there is no valid
+	 * journal for the base file.
+	 */
+	static bool replay(Map& map, const QString& base_path, QString& error_string);
+	
+private:
+	Map* const map;
+	
+	/// Whether there is a valid base.
+	bool has_base;
+	
+	/// Whether the journal file with header was started for the current base.
+	bool has_header;
+	
+	/// The undo step count of the journaled state, including dropped steps.
+	std::size_t journaled_index;
+	
+	/// The serial number of the newest journaled undo step, or 0. For detecting changed history.
+	quint64 journaled_serial;
+	
+	/// The map's properties revision of the journaled state.
+	quint64 properties_revision;
+	
+	/// The number of steps in the journal.
+	std::size_t num_steps;
+};
+
+#endif
@@ -170,8 +170,6 @@ void ColorWidget::newColor()
 		row = color_table->rowCount();
 	map->addColor(new MapColor(), row);
 	
-	map->updateAllObjects();
-	
 	editCurrentColor();
 }
 
@@ -204,8 +202,6 @@ void ColorWidget::duplicateColor()
 	new_color->setName(new_color->getName() + tr(" (Duplicate)"));
 	map->addColor(new_color, row);
 	
-	map->updateAllObjects();
-	
 	editCurrentColor();
 }
 
@@ -225,7 +221,6 @@ void ColorWidget::moveColorUp()
 	color_table->setCurrentCell(row - 1, color_table->currentColumn());
 	
 	map->setColorsDirty();
-	map->updateAllObjects();
 }
 
 void ColorWidget::moveColorDown()
@@ -244,7 +239,6 @@ void ColorWidget::moveColorDown()
 	color_table->setCurrentCell(row + 1, color_table->currentColumn());
 	
 	map->setColorsDirty();
-	map->updateAllObjects();
 }
 
 // slot
@@ -262,7 +256,6 @@ void ColorWidget::editCurrentColor()
 			*color = dialog.getColor();
 			map->setColor(color, row); // trigger colorChanged signal
 			map->setColorsDirty();
-			map->updateAllObjects();
 		}
 	}
 }
@@ -320,7 +313,6 @@ void ColorWidget::cellChange(int row, int column)
 	
 	map->setColor(color, row); // trigger colorChanged signal
 	map->setColorsDirty();
-	map->updateAllObjects();
 }
 
 void ColorWidget::currentCellChange(int current_row, int current_column, int previous_row, int previous_column)
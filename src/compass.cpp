@@ -19,11 +19,16 @@
 
 #include "compass.h"
 
+#include <cmath>
+
 #include <qmath.h>
+#include <QGuiApplication>
 #include <QMetaMethod>
 #include <QMutex>
 #include <QTime>
 
+#include "settings.h"
+
 
 namespace SensorHelpers
 {
@@ -204,6 +209,10 @@ namespace SensorHelpers
 
 
 #ifdef QT_SENSORS_LIB
+#include <atomic>
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
 #include <QThread>
 #include <QDebug>
 #include <QWaitCondition>
@@ -222,7 +231,10 @@ public:
 	 : thread(this)
 	 , compass(compass)
 	 , enabled(false)
+	 , use_gyro(false)
 	 , latest_azimuth(-1)
+	 , min_update_interval(100)
+	 , dead_zone(0.5f)
 	{
 		// Try to filter out non-gravity sources of acceleration
 		accelerometer.setAccelerationMode(QAccelerometer::Gravity);
@@ -245,16 +257,29 @@ public:
 		thread.wait();
 	}
 	
-	void enable(bool enabled)
+	/**
+	 * Starts or stops the sensors.
+	 * 
+	 * In power saving mode, the gyroscope is not used, and the orientation
+	 * is calculated less frequently.
+	 */
+	void enable(bool enabled, bool power_saving)
 	{
 		if (enabled)
 		{
 			last_gyro_timestamp = 0;
 			gyro_orientation_initialized = false;
+			thread.low_pass_initialized = false;
+			thread.last_update.invalidate();
+			use_gyro = gyro_available && !power_saving;
+			thread.sample_interval = power_saving ? 200 : 30;
 			
 			accelerometer.start();
 			magnetometer.start();
-			gyroscope.start();
+			if (use_gyro)
+				gyroscope.start();
+			else
+				gyroscope.stop();
 			
 			thread.wait_mutex.lock();
 			this->enabled = true;
@@ -340,10 +365,58 @@ private:
 	public:
 		SensorThread(CompassPrivate* p)
 		 : keep_running(true)
+		 , sample_interval(30)
+		 , low_pass_initialized(false)
 		 , p(p)
 		{
 		}
 		
+		/**
+		 * Smoothes the azimuth (in radians) from accelerometer and magnetometer,
+		 * when there is no gyroscope to filter out the noise.
+		 * 
+		 * The filter works on the direction vector, to handle wrap-around.
+		 * Its time constant does not depend on the sample interval.
+		 */
+		float lowPass(float azimuth)
+		{
+			const float LOW_PASS_COEFFICIENT = 0.2f; // per 30 ms
+			const float coefficient = qMin(1.0f, LOW_PASS_COEFFICIENT * sample_interval.load() / 30);
+			
+			if (!low_pass_initialized)
+			{
+				low_pass_x = qCos(azimuth);
+				low_pass_y = qSin(azimuth);
+				low_pass_initialized = true;
+			}
+			else
+			{
+				low_pass_x += coefficient * (float(qCos(azimuth)) - low_pass_x);
+				low_pass_y += coefficient * (float(qSin(azimuth)) - low_pass_y);
+			}
+			return float(qAtan2(low_pass_y, low_pass_x));
+		}
+		
+		/**
+		 * Returns true if a new azimuth shall be sent to the receivers.
+		 * 
+		 * This limits the rate of signals, and it suppresses changes within
+		 * the dead zone around the last sent azimuth.
+		 */
+		bool needsUpdate(float azimuth)
+		{
+			if (last_update.isValid())
+			{
+				if (last_update.elapsed() < p->min_update_interval.load())
+					return false;
+				if (qAbs(std::remainder(azimuth - last_update_azimuth, 360.0f)) < p->dead_zone.load())
+					return false;
+			}
+			last_update.start();
+			last_update_azimuth = azimuth;
+			return true;
+		}
+		
 		float fuseOrientationCoefficient(float gyro, float acc_mag)
 		{
 			const float FILTER_COEFFICIENT = 0.98f;
@@ -396,16 +469,16 @@ private:
 			// If gyro not initialized yet (or we do not have a gyro):
 			// use acc_mag_orientation (and initialize gyro if present)
 			float azimuth;
-			if (! p->gyro_available || ! p->gyro_orientation_initialized)
+			if (! p->use_gyro || ! p->gyro_orientation_initialized)
 			{
-				if (p->gyro_available)
+				if (p->use_gyro)
 				{
 					memcpy(p->gyro_orientation, acc_mag_orientation, 3 * sizeof(float));
 					SensorHelpers::getRotationMatrixFromOrientation(p->gyro_orientation, p->gyro_rotation_matrix);
 					p->gyro_orientation_initialized = true;
 				}
 				
-				azimuth = acc_mag_orientation[0];
+				azimuth = p->use_gyro ? acc_mag_orientation[0] : lowPass(acc_mag_orientation[0]);
 			}
 			else
 			{
@@ -447,7 +520,8 @@ private:
 #endif
 
 			// Send update to receivers
-			p->compass->emitAzimuthChanged(p->latest_azimuth);
+			if (needsUpdate(p->latest_azimuth))
+				p->compass->emitAzimuthChanged(p->latest_azimuth);
 		}
 		
 		void run()
@@ -469,13 +543,19 @@ private:
 				
 				filter();
 				
-				QThread::msleep(30);
+				QThread::msleep(unsigned(sample_interval.load()));
 			}
 		}
 		
 		QMutex wait_mutex;
 		QWaitCondition condition;
 		bool keep_running;
+		QAtomicInt sample_interval; ///< milliseconds
+		bool low_pass_initialized;
+		float low_pass_x;
+		float low_pass_y;
+		QElapsedTimer last_update;
+		float last_update_azimuth;
 		CompassPrivate* p;
 	};
 	
@@ -493,7 +573,11 @@ private:
 	Compass* compass;
 	
 	bool enabled;
+	bool use_gyro;
 	float latest_azimuth;
+	
+	QAtomicInt min_update_interval; ///< milliseconds
+	std::atomic<float> dead_zone;   ///< degrees
 };
 #endif
 
@@ -503,6 +587,8 @@ Compass::Compass(): QObject()
 	reference_counter = 0;
 #ifdef QT_SENSORS_LIB
 	p = new CompassPrivate(this);
+	connect(&Settings::getInstance(), &Settings::settingsChanged, this, &Compass::updateUsage);
+	connect(qApp, &QGuiApplication::applicationStateChanged, this, &Compass::updateUsage);
 #else
 	p = NULL;
 #endif
@@ -526,7 +612,7 @@ void Compass::startUsage()
 	++ reference_counter;
 #ifdef QT_SENSORS_LIB
 	if (reference_counter == 1)
-		p->enable(true);
+		updateUsage();
 #endif
 }
 
@@ -535,7 +621,29 @@ void Compass::stopUsage()
 	-- reference_counter;
 #ifdef QT_SENSORS_LIB
 	if (reference_counter == 0)
-		p->enable(false);
+		updateUsage();
+#endif
+}
+
+void Compass::updateUsage()
+{
+#ifdef QT_SENSORS_LIB
+	// In power saving mode, nobody sees the azimuth while the application
+	// is in the background.
+	const bool power_saving = Settings::getInstance().getSettingCached(Settings::General_PowerSaving).toBool();
+	const bool active = qApp->applicationState() == Qt::ApplicationActive;
+	p->enable(reference_counter > 0 && (active || !power_saving), power_saving);
+#endif
+}
+
+void Compass::setUpdateLimits(int min_interval, float dead_zone)
+{
+#ifdef QT_SENSORS_LIB
+	p->min_update_interval.store(qMax(0, min_interval));
+	p->dead_zone.store(qMax(0.0f, dead_zone));
+#else
+	Q_UNUSED(min_interval);
+	Q_UNUSED(dead_zone);
 #endif
 }
 
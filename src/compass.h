@@ -43,20 +43,27 @@ public:
 	/** Dereferences compass usage. */
 	void stopUsage();
 	
+	/** Sets the limits for azimuthChanged signals: The minimum time between
+	 *  two signals (in milliseconds), and the minimum change of the azimuth
+	 *  (in degrees). The defaults are 100 milliseconds and 0.5 degrees. */
+	void setUpdateLimits(int min_interval, float dead_zone);
+	
 	/** Returns the most recent azimuth value
-	 *  (in degrees clockwise from north; updated approx. every 30 milliseconds). */
+	 *  (in degrees clockwise from north; updated approx. every 30 milliseconds,
+	 *  or every 200 milliseconds in power saving mode). */
 	float getCurrentAzimuth();
 	
 	/** Connects to the azimuthChanged(float azimuth_degrees) signal. This ensures to use a queued
 	 *  connection, which is important because the data provider runs on another
-	 *  thread. Updates are delivered approx. every 30 milliseconds. */
+	 *  thread. Updates are delivered when the azimuth changed by more than a dead zone,
+	 *  but not more often than given by setUpdateLimits(). */
 	void connectToAzimuthChanges(const QObject* receiver, const char* slot);
 	
 	/** Disconnects the given receiver from azimuth changes. */
 	void disconnectFromAzimuthChanges(const QObject* receiver);
 	
 signals:
-	/** Emitted regularly with the current azimuth value (in degrees).
+	/** Emitted with the current azimuth value (in degrees) when it changed.
 	 *  Preferably use connectToAzimuthChanges() to connect to this signal. */
 	void azimuthChanged(float azimuth);
 	
@@ -68,6 +75,9 @@ protected:
 private:
 	Compass();
 	
+	/** Starts or stops the sensors, depending on usage, settings and application state. */
+	void updateUsage();
+	
 	void emitAzimuthChanged(float value);
 	
 	int reference_counter;
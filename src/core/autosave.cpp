@@ -43,6 +43,9 @@ void AutosavePrivate::settingsChanged()
 	// Normally, the autosave interval can be stored as an integer.
 	// It is loaded as a double here to allow for faster unit testing.
 	autosave_interval = Settings::getInstance().getSetting(Settings::General_AutosaveInterval).toDouble() * 60000;
+	// In power saving mode, more changes are collected in each autosave.
+	if (Settings::getInstance().getSetting(Settings::General_PowerSaving).toBool())
+		autosave_interval *= 2;
 	if (autosave_interval < 1000)
 	{
 		// stop autosave
@@ -41,6 +41,8 @@ class AutosavePrivate;
  * On success or permanent failure, autosave() will be called again after the
  * regular autosaving period.
  * On temporary failure, autosave() will be called again after five seconds.
+ * This is also the appropriate result when a previous autosave is still being
+ * completed in the background.
  * 
  * The autosave period (in minutes) is taken from the setting
  * Settings::General_AutosaveInterval.
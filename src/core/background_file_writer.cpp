@@ -0,0 +1,137 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "background_file_writer.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QThread>
+
+
+// ### BackgroundFileWriter::Thread ###
+
+class BackgroundFileWriter::Thread : public QThread
+{
+// no Q_OBJECT as it is not required here
+public:
+	void run() override
+	{
+		if (serializer && !serializer(data, error_string))
+			return;
+		
+		if (mode == Append)
+		{
+			QFile file(path);
+			success = file.open(QIODevice::WriteOnly | QIODevice::Append)
+			          && file.write(data) == data.size()
+			          && file.flush();
+			if (!success)
+				error_string = file.errorString();
+		}
+		else
+		{
+			QSaveFile file(path);
+			success = file.open(QIODevice::WriteOnly)
+			          && file.write(data) == data.size()
+			          && file.commit();
+			if (!success)
+				error_string = file.errorString();
+		}
+	}
+	
+	QString path;
+	Serializer serializer;
+	QByteArray data;
+	Mode mode;
+	bool success;
+	QString error_string;
+};
+
+
+
+// ### BackgroundFileWriter ###
+
+BackgroundFileWriter::BackgroundFileWriter(QObject* parent)
+ : QObject(parent)
+ , thread(new Thread())
+ , pending(false)
+{
+	connect(thread.data(), &QThread::finished, this, &BackgroundFileWriter::threadFinished);
+}
+
+BackgroundFileWriter::~BackgroundFileWriter()
+{
+	thread->wait();
+}
+
+void BackgroundFileWriter::start(const QString& path, const QByteArray& data, Mode mode)
+{
+	waitForFinished();
+	
+	thread->serializer = Serializer();
+	thread->data = data;
+	startThread(path, mode);
+}
+
+void BackgroundFileWriter::start(const QString& path, const Serializer& serializer, Mode mode)
+{
+	waitForFinished();
+	
+	thread->serializer = serializer;
+	thread->data.clear();
+	startThread(path, mode);
+}
+
+void BackgroundFileWriter::startThread(const QString& path, Mode mode)
+{
+	thread->path = path;
+	thread->mode = mode;
+	thread->success = false;
+	thread->error_string.clear();
+	pending = true;
+	thread->start();
+}
+
+bool BackgroundFileWriter::isRunning() const
+{
+	return pending;
+}
+
+void BackgroundFileWriter::waitForFinished()
+{
+	if (pending)
+	{
+		thread->wait();
+		threadFinished();
+	}
+}
+
+void BackgroundFileWriter::threadFinished()
+{
+	// The queued signal from the thread may arrive after waitForFinished().
+	if (!pending || thread->isRunning())
+		return;
+	
+	pending = false;
+	thread->serializer = Serializer();
+	thread->data = QByteArray();
+	emit finished(thread->path, thread->success, thread->error_string);
+}
@@ -0,0 +1,133 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef _OPENORIENTEERING_BACKGROUND_FILE_WRITER_H_
+#define _OPENORIENTEERING_BACKGROUND_FILE_WRITER_H_
+
+#include <functional>
+
+#include <QByteArray>
+#include <QObject>
+#include <QScopedPointer>
+#include <QString>
+
+
+/**
+ * @brief BackgroundFileWriter writes data to a file in a worker thread.
+ * 
+ * By default, the file is replaced atomically, by means of QSaveFile. So
+ * readers never see a partially written file. Alternatively, the data can be
+ * appended to the file.
+ * 
+ * Only one file is written at a time. start() waits for the previous write
+ * to finish. The destructor waits for the current write to finish, too.
+ * 
+ * The caller either prepares the data, e.g. with Map::exportToData(), or
+ * passes a serializer which creates the data in the worker thread, e.g.
+ * from Map::prepareExportToData().
+ * 
+ * Synopsis:
+ * 
+ * QByteArray data = ...;
+ * connect(writer, &BackgroundFileWriter::finished, this, &Foo::writingFinished);
+ * writer->start(path, data);
+ */
+class BackgroundFileWriter : public QObject
+{
+Q_OBJECT
+public:
+	/** The ways of writing the data to the file. */
+	enum Mode
+	{
+		Replace,  ///< Atomically replaces the file.
+		Append    ///< Appends to the file, creating it if needed.
+	};
+	
+	/**
+	 * A function which creates the data in the worker thread.
+	 * 
+	 * It returns true on success. Otherwise it sets the error string.
+	 */
+	using Serializer = std::function<bool (QByteArray& data, QString& error_string)>;
+	
+	/** Constructs a new writer. */
+	explicit BackgroundFileWriter(QObject* parent = nullptr);
+	
+	/** Destructor. Waits for the current write to finish. */
+	virtual ~BackgroundFileWriter();
+	
+	/**
+	 * Starts writing the data to the file with the given path.
+	 * 
+	 * The data is implicitly shared. It must not be modified by the caller
+	 * while it is written.
+	 */
+	void start(const QString& path, const QByteArray& data, Mode mode = Replace);
+	
+	/**
+	 * Starts creating the data with the serializer, and writing it to the
+	 * file with the given path.
+	 * 
+	 * The serializer is destroyed in the thread which owns the writer,
+	 * before finished() is emitted.
+	 */
+	void start(const QString& path, const Serializer& serializer, Mode mode = Replace);
+	
+	/** Returns true while a file is written. */
+	bool isRunning() const;
+	
+	/**
+	 * Waits until the current write is finished.
+	 * 
+	 * Emits finished() if the current write was not reported yet.
+	 */
+	void waitForFinished();
+	
+signals:
+	/**
+	 * This signal is emitted when writing finished.
+	 * 
+	 * It is never emitted in the worker thread. The worker's completion is
+	 * delivered queued to the thread which owns the writer, and the signal
+	 * is emitted there, or in waitForFinished(). So receivers in that thread,
+	 * e.g. the GUI thread, are called directly. Receivers in other threads
+	 * are called queued, in their own thread.
+	 * 
+	 * On failure, error_string describes the reason.
+	 */
+	void finished(const QString& path, bool success, const QString& error_string);
+	
+private slots:
+	void threadFinished();
+	
+private:
+	Q_DISABLE_COPY(BackgroundFileWriter)
+	
+	/** Starts the thread for the prepared data or serializer. */
+	void startThread(const QString& path, Mode mode);
+	
+	class Thread;
+	
+	QScopedPointer<Thread> thread;
+	bool pending;
+};
+
+#endif
@@ -0,0 +1,323 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "banded_tiff_writer.h"
+
+#include <initializer_list>
+#include <limits>
+#include <vector>
+
+#include <QByteArray>
+#include <QImage>
+
+#include "color_transform.h"
+
+
+namespace
+{
+	/** TIFF field types */
+	enum TiffType : quint16
+	{
+		TiffShort    = 3,
+		TiffLong     = 4,
+		TiffRational = 5,
+		TiffLong8    = 16,
+	};
+
+	/** The TIFF tags used by BandedTiffWriter, in ascending order. */
+	enum TiffTag : quint16
+	{
+		ImageWidth                = 256,
+		ImageLength               = 257,
+		BitsPerSample             = 258,
+		Compression               = 259,
+		PhotometricInterpretation = 262,
+		StripOffsets              = 273,
+		SamplesPerPixel           = 277,
+		RowsPerStrip              = 278,
+		StripByteCounts           = 279,
+		XResolution               = 282,
+		YResolution               = 283,
+		PlanarConfiguration       = 284,
+		ResolutionUnit            = 296,
+		InkSet                    = 332,
+	};
+
+	/** The preferred size of a strip, in bytes. */
+	const int strip_size = 256 * 1024;
+
+	/** A directory entry, with its values in little endian byte order. */
+	struct TiffEntry
+	{
+		TiffTag tag;
+		TiffType type;
+		quint64 count;
+		QByteArray values;
+		quint64 offset;
+	};
+
+	/** Appends the value in little endian byte order. */
+	template< class T >
+	void append(QByteArray& data, T value)
+	{
+		for (std::size_t i = 0; i < sizeof(T); ++i)
+		{
+			data.append(char(value & 0xff));
+			value >>= 8;
+		}
+	}
+
+	/** Appends zero bytes until the size of the data is a multiple of alignment. */
+	void pad(QByteArray& data, quint64 position, int alignment)
+	{
+		while ((position + data.size()) % alignment)
+			data.append('\0');
+	}
+
+	TiffEntry shortEntry(TiffTag tag, std::initializer_list<quint16> values)
+	{
+		TiffEntry entry = { tag, TiffShort, values.size(), {}, 0 };
+		for (auto value : values)
+			append(entry.values, value);
+		return entry;
+	}
+
+	TiffEntry longEntry(TiffTag tag, quint32 value)
+	{
+		TiffEntry entry = { tag, TiffLong, 1, {}, 0 };
+		append(entry.values, value);
+		return entry;
+	}
+
+	TiffEntry rationalEntry(TiffTag tag, quint32 numerator, quint32 denominator)
+	{
+		TiffEntry entry = { tag, TiffRational, 1, {}, 0 };
+		append(entry.values, numerator);
+		append(entry.values, denominator);
+		return entry;
+	}
+
+	TiffEntry offsetEntry(TiffTag tag, const std::vector<quint64>& values, bool big_tiff)
+	{
+		TiffEntry entry = { tag, big_tiff ? TiffLong8 : TiffLong, values.size(), {}, 0 };
+		for (auto value : values)
+		{
+			if (big_tiff)
+				append(entry.values, value);
+			else
+				append(entry.values, quint32(value));
+		}
+		return entry;
+	}
+}
+
+
+
+// ### BandedTiffWriter ###
+
+bool BandedTiffWriter::canWrite(const QString& path)
+{
+	return path.endsWith(QLatin1String(".tif"), Qt::CaseInsensitive)
+	       || path.endsWith(QLatin1String(".tiff"), Qt::CaseInsensitive);
+}
+
+BandedTiffWriter::BandedTiffWriter(const QString& path, const QSize& size, int dots_per_inch, ColorTransform* cmyk_transform)
+ : file(path)
+ , size(size)
+ , dots_per_inch(dots_per_inch)
+ , cmyk_transform(cmyk_transform)
+ , samples_per_pixel(cmyk_transform ? 4 : 3)
+ , rows_written(0)
+ , rows_per_strip(qMax(1, strip_size / qMax(1, samples_per_pixel * size.width())))
+ , big_tiff(false)
+{
+	; // nothing
+}
+
+BandedTiffWriter::~BandedTiffWriter()
+{
+	; // nothing
+}
+
+bool BandedTiffWriter::open()
+{
+	if (size.isEmpty() || !file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	// The directory needs two offsets per strip, and less than 1 KiB for the rest.
+	const quint64 row_bytes = quint64(samples_per_pixel) * quint64(size.width());
+	const quint64 num_strips = (quint64(size.height()) + rows_per_strip - 1) / rows_per_strip;
+	const quint64 file_size = 16 + row_bytes * quint64(size.height()) + 16 * num_strips + 1024;
+	big_tiff = file_size > std::numeric_limits<quint32>::max();
+
+	QByteArray header("II");
+	if (big_tiff)
+	{
+		append(header, quint16(43));
+		append(header, quint16(8));  // Offset size
+		append(header, quint16(0));
+		append(header, quint64(0));  // Directory offset, set by finish()
+	}
+	else
+	{
+		append(header, quint16(42));
+		append(header, quint32(0));  // Directory offset, set by finish()
+	}
+	return file.write(header) == header.size();
+}
+
+bool BandedTiffWriter::writeBand(const QImage& band)
+{
+	Q_ASSERT(file.isOpen());
+	Q_ASSERT(band.width() == size.width());
+	Q_ASSERT(rows_written + band.height() <= size.height());
+
+	const qint64 row_bytes = qint64(samples_per_pixel) * qint64(size.width());
+	if (cmyk_transform)
+	{
+		const QImage argb = band.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+		if (argb.isNull())
+			return false;
+
+		QByteArray cmyk(int(row_bytes), Qt::Uninitialized);
+		for (int y = 0; y < argb.height(); ++y)
+		{
+			cmyk_transform->convertToCmyk(reinterpret_cast<const QRgb*>(argb.constScanLine(y)), argb.width(),
+			                              reinterpret_cast<uchar*>(cmyk.data()));
+			if (file.write(cmyk) != row_bytes)
+				return false;
+		}
+		rows_written += argb.height();
+		return true;
+	}
+
+	const QImage rgb = band.convertToFormat(QImage::Format_RGB888);
+	if (rgb.isNull())
+		return false;
+
+	for (int y = 0; y < rgb.height(); ++y)
+	{
+		if (file.write(reinterpret_cast<const char*>(rgb.constScanLine(y)), row_bytes) != row_bytes)
+			return false;
+	}
+	rows_written += rgb.height();
+	return true;
+}
+
+bool BandedTiffWriter::finish()
+{
+	Q_ASSERT(file.isOpen());
+	Q_ASSERT(rows_written == size.height());
+
+	const quint64 header_size = big_tiff ? 16 : 8;
+	const quint64 row_bytes = quint64(samples_per_pixel) * quint64(size.width());
+	std::vector<quint64> strip_offsets;
+	std::vector<quint64> strip_byte_counts;
+	for (int row = 0; row < size.height(); row += rows_per_strip)
+	{
+		strip_offsets.push_back(header_size + row * row_bytes);
+		strip_byte_counts.push_back(qMin(rows_per_strip, size.height() - row) * row_bytes);
+	}
+
+	const bool cmyk = cmyk_transform != nullptr;
+	std::vector<TiffEntry> entries = {
+	  longEntry(ImageWidth, quint32(size.width())),
+	  longEntry(ImageLength, quint32(size.height())),
+	  cmyk ? shortEntry(BitsPerSample, { 8, 8, 8, 8 }) : shortEntry(BitsPerSample, { 8, 8, 8 }),
+	  shortEntry(Compression, { 1 }),                // None
+	  shortEntry(PhotometricInterpretation, { quint16(cmyk ? 5 : 2) }),  // Separated or RGB
+	  offsetEntry(StripOffsets, strip_offsets, big_tiff),
+	  shortEntry(SamplesPerPixel, { quint16(samples_per_pixel) }),
+	  longEntry(RowsPerStrip, quint32(rows_per_strip)),
+	  offsetEntry(StripByteCounts, strip_byte_counts, big_tiff),
+	  rationalEntry(XResolution, quint32(dots_per_inch), 1),
+	  rationalEntry(YResolution, quint32(dots_per_inch), 1),
+	  shortEntry(PlanarConfiguration, { 1 }),        // Chunky
+	  shortEntry(ResolutionUnit, { 2 }),             // Inch
+	};
+	if (cmyk)
+		entries.push_back(shortEntry(InkSet, { 1 }));  // CMYK
+
+	// Values which do not fit into an entry are stored before the directory.
+	const int value_size = big_tiff ? 8 : 4;
+	const quint64 position = file.pos();
+	QByteArray data;
+	for (auto& entry : entries)
+	{
+		if (entry.values.size() > value_size)
+		{
+			pad(data, position, value_size);
+			entry.offset = position + data.size();
+			data.append(entry.values);
+		}
+	}
+	pad(data, position, value_size);
+
+	const quint64 directory_offset = position + data.size();
+	if (big_tiff)
+		append(data, quint64(entries.size()));
+	else
+		append(data, quint16(entries.size()));
+	for (const auto& entry : entries)
+	{
+		append(data, quint16(entry.tag));
+		append(data, quint16(entry.type));
+		if (big_tiff)
+			append(data, quint64(entry.count));
+		else
+			append(data, quint32(entry.count));
+
+		QByteArray value = entry.values;
+		if (value.size() > value_size)
+		{
+			value.clear();
+			if (big_tiff)
+				append(value, entry.offset);
+			else
+				append(value, quint32(entry.offset));
+		}
+		value.append(QByteArray(value_size - value.size(), '\0'));
+		data.append(value);
+	}
+	if (big_tiff)
+		append(data, quint64(0));  // No next directory
+	else
+		append(data, quint32(0));  // No next directory
+
+	if (file.write(data) != data.size())
+		return false;
+
+	// Patch the directory offset in the header.
+	QByteArray offset;
+	if (big_tiff)
+		append(offset, directory_offset);
+	else
+		append(offset, quint32(directory_offset));
+	if (!file.seek(big_tiff ? 8 : 4) || file.write(offset) != offset.size())
+		return false;
+
+	file.close();
+	return file.error() == QFileDevice::NoError;
+}
+
+QString BandedTiffWriter::errorString() const
+{
+	return file.errorString();
+}
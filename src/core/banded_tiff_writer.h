@@ -0,0 +1,120 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_BANDED_TIFF_WRITER_H_
+#define _OPENORIENTEERING_BANDED_TIFF_WRITER_H_
+
+#include <QtGlobal>
+#include <QFile>
+#include <QSize>
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+class QImage;
+QT_END_NAMESPACE
+
+class ColorTransform;
+
+
+/**
+ * Writes an uncompressed RGB or CMYK TIFF file from horizontal bands of rows.
+ *
+ * The complete image is never held in memory. Each band is appended to the
+ * file when it is passed to writeBand(), and the image file directory is
+ * written by finish(). Images which do not fit into the 4 GiB limit of the
+ * classic TIFF format are written as BigTIFF.
+ *
+ * When a color transform is given, the bands are converted to CMYK by
+ * ColorTransform::convertToCmyk(), and the file is written with separated
+ * (CMYK) samples.
+ *
+ * Synopsis:
+ *
+ * BandedTiffWriter writer(path, size, dpi);
+ * bool ok = writer.open();
+ * for (int top = 0; ok && top < size.height(); top += band.height())
+ * {
+ *     ...  // Draw the rows starting at top to band.
+ *     ok = writer.writeBand(band);
+ * }
+ * ok = ok && writer.finish();
+ */
+class BandedTiffWriter
+{
+public:
+	/**
+	 * Returns true if the path has a TIFF file name extension.
+	 */
+	static bool canWrite(const QString& path);
+
+	/**
+	 * Constructs a writer for an image of the given size and resolution.
+	 *
+	 * If cmyk_transform is not null, the image is written as CMYK. The
+	 * transform must remain valid until finish() was called.
+	 *
+	 * The file is not accessed until open() is called.
+	 */
+	BandedTiffWriter(const QString& path, const QSize& size, int dots_per_inch, ColorTransform* cmyk_transform = nullptr);
+
+	/**
+	 * Destructor.
+	 *
+	 * If finish() was not called successfully, the file is incomplete.
+	 */
+	~BandedTiffWriter();
+
+	/**
+	 * Creates the file and writes the TIFF header.
+	 */
+	bool open();
+
+	/**
+	 * Appends the rows of the given band to the file.
+	 *
+	 * The band must have the width of the image, and it must not exceed
+	 * the height of the image together with the rows already written.
+	 */
+	bool writeBand(const QImage& band);
+
+	/**
+	 * Writes the image file directory and closes the file.
+	 *
+	 * All rows of the image must have been written before.
+	 */
+	bool finish();
+
+	/**
+	 * Returns a description of the last error.
+	 */
+	QString errorString() const;
+
+private:
+	QFile file;
+	QSize size;
+	int dots_per_inch;
+	ColorTransform* cmyk_transform;
+	int samples_per_pixel;
+	int rows_written;
+	int rows_per_strip;
+	bool big_tiff;
+};
+
+#endif
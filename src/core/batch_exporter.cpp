@@ -0,0 +1,314 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "batch_exporter.h"
+
+#ifdef QT_PRINTSUPPORT_LIB
+
+#include <initializer_list>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QPrinter>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include "banded_tiff_writer.h"
+#include "color_transform.h"
+#include "map_printer.h"
+#include "map_view.h"
+#include "../map.h"
+#include "../map_part.h"
+#include "../template.h"
+
+
+
+namespace
+{
+	/**
+	 * Serializes the loading of maps and templates by concurrent jobs.
+	 * 
+	 * Loading depends on process-wide state, such as MapCoord::boundsOffset()
+	 * and XMLFileFormat::active_version. This state cannot simply be made
+	 * thread-local because the coordinates are parsed by the worker threads
+	 * of the TaskPool.
+	 */
+	QMutex load_mutex;
+}
+
+
+
+// ### BatchExporter::Job ###
+
+BatchExporter::Job::Job()
+ : format(Pdf)
+ , scale(0)
+ , resolution(0)
+ , show_templates(false)
+ , simulate_overprinting(false)
+{
+	; // nothing
+}
+
+
+
+// ### BatchExporter::Result ###
+
+BatchExporter::Result::Result()
+ : success(false)
+ , load_time(0)
+ , export_time(0)
+{
+	; // nothing
+}
+
+
+
+// ### BatchExporter::JobRunner ###
+
+/**
+ * Runs a single job, and stores the outcome in the given result.
+ */
+class BatchExporter::JobRunner : public QRunnable
+{
+public:
+	JobRunner(const Job& job, Result& result)
+	 : job(job)
+	 , result(result)
+	{
+		; // nothing
+	}
+
+	void run() override
+	{
+		result = exportMap(job);
+	}
+
+private:
+	const Job& job;
+	Result& result;
+};
+
+
+
+// ### BatchExporter ###
+
+BatchExporter::Format BatchExporter::formatForPath(const QString& path)
+{
+	const QString suffix = QFileInfo(path).suffix().toLower();
+	for (const auto& image_suffix : { "png", "bmp", "tif", "tiff", "jpg", "jpeg" })
+	{
+		if (suffix == QLatin1String(image_suffix))
+			return Image;
+	}
+	return Pdf;
+}
+
+BatchExporter::Result BatchExporter::exportMap(const Job& job)
+{
+	Result result;
+	QElapsedTimer timer;
+	timer.start();
+
+	Map map;
+	MapView view(&map);
+	{
+		// Rendering and writing the output run concurrently.
+		QMutexLocker locker(&load_mutex);
+
+		if (!map.loadFrom(job.input_path, nullptr, &view, false, false))
+		{
+			result.error = tr("Cannot open file:\n%1").arg(job.input_path);
+			return result;
+		}
+
+		// Parts may be loaded on demand only.
+		for (int i = 0; i < map.getNumParts(); ++i)
+			map.getPart(i)->ensureLoaded();
+
+		if (job.show_templates)
+		{
+			// Other than in the GUI, there is no chance to locate moved templates.
+			const QString map_directory = QFileInfo(job.input_path).absolutePath();
+			for (int i = 0; i < map.getNumTemplates(); ++i)
+			{
+				Template* temp = map.getTemplate(i);
+				if (view.isTemplateVisible(temp) && temp->getTemplateState() != Template::Loaded)
+					temp->tryToFindAndReloadTemplateFile(map_directory);
+			}
+		}
+	}
+	result.load_time = timer.restart();
+
+	MapPrinter map_printer(map, &view);
+	map_printer.setTarget((job.format == Image) ? MapPrinter::imageTarget() : MapPrinter::pdfTarget());
+	if (job.scale > 0)
+		map_printer.setScale(job.scale);
+	map_printer.setResolution(job.resolution);
+	if (job.print_area.isValid())
+		map_printer.setPrintArea(job.print_area);
+
+	switch (job.format)
+	{
+	case Separations:
+		if (!map.hasSpotColors())
+		{
+			result.error = tr("The map does not have spot colors.");
+			return result;
+		}
+		map_printer.setMode(MapPrinterOptions::Separations);
+		break;
+	case Image:
+		map_printer.setMode(MapPrinterOptions::Raster);
+		map_printer.setCustomPaperSize(map_printer.getPrintArea().size() * map_printer.getScaleAdjustment());
+		break;
+	case Pdf:
+		if (job.simulate_overprinting)
+			map_printer.setMode(MapPrinterOptions::Raster);
+		break;
+	}
+	if (job.format != Separations)
+	{
+		map_printer.setPrintTemplates(job.show_templates, &view);
+		map_printer.setSimulateOverprinting(job.simulate_overprinting);
+	}
+
+	if (job.format == Image)
+	{
+		result.success = exportImage(map_printer, job.output_path, result.error);
+	}
+	else
+	{
+		auto printer = map_printer.makePrinter();
+		if (!printer)
+		{
+			result.error = tr("Failed to prepare the PDF export.");
+			return result;
+		}
+		printer->setOutputFormat(QPrinter::PdfFormat);
+		printer->setOutputFileName(job.output_path);
+		printer->setCreator(QCoreApplication::applicationName());
+		printer->setDocName(QFileInfo(job.input_path).baseName());
+		result.success = map_printer.printMap(printer.get());
+		if (!result.success)
+		{
+			QFile(job.output_path).remove();
+			result.error = tr("Failed to finish the PDF export.");
+		}
+	}
+	result.export_time = timer.elapsed();
+	return result;
+}
+
+std::vector<BatchExporter::Result> BatchExporter::run(const std::vector<Job>& jobs, int num_threads)
+{
+	std::vector<Result> results(jobs.size());
+
+	// Not the global thread pool, because the jobs may need it on their own,
+	// e.g. for rendering pages concurrently.
+	QThreadPool thread_pool;
+	thread_pool.setMaxThreadCount(qMax(1, num_threads));
+	for (std::size_t i = 0; i < jobs.size(); ++i)
+		thread_pool.start(new JobRunner(jobs[i], results[i]));
+	thread_pool.waitForDone();
+
+	return results;
+}
+
+bool BatchExporter::exportImage(const MapPrinter& map_printer, const QString& path, QString& error)
+{
+	const int resolution = map_printer.getOptions().resolution;
+	const qreal pixel_per_mm = resolution / 25.4;
+	const QSize size(qRound(map_printer.getPrintAreaPaperSize().width() * pixel_per_mm),
+	                 qRound(map_printer.getPrintAreaPaperSize().height() * pixel_per_mm));
+
+	if (BandedTiffWriter::canWrite(path))
+		return exportTiff(map_printer, path, size, error);
+
+	QImage image(size, QImage::Format_ARGB32_Premultiplied);
+	if (image.isNull())
+	{
+		error = tr("Failed to prepare the image. Not enough memory.");
+		return false;
+	}
+
+	const int dots_per_meter = qRound(pixel_per_mm * 1000);
+	image.setDotsPerMeterX(dots_per_meter);
+	image.setDotsPerMeterY(dots_per_meter);
+
+	QPainter painter(&image);
+	map_printer.drawPage(&painter, resolution, map_printer.getPrintArea(), true, &image);
+	painter.end();
+	if (!image.save(path))
+	{
+		error = tr("Failed to save the image. Does the path exist? Do you have sufficient rights?");
+		return false;
+	}
+	return true;
+}
+
+bool BatchExporter::exportTiff(const MapPrinter& map_printer, const QString& path, const QSize& size, QString& error)
+{
+	// Draw and write the image in horizontal bands,
+	// so that the memory needed does not depend on the height of the image.
+	const int resolution = map_printer.getOptions().resolution;
+	const int band_height = qBound(1, (1 << 24) / qMax(1, size.width()), size.height());
+	const QRectF print_area = map_printer.getPrintArea();
+	const qreal map_mm_per_pixel = 25.4 / resolution / map_printer.getScaleAdjustment();
+
+	const auto cmyk_transform = map_printer.makeCmykTransform();
+	BandedTiffWriter writer(path, size, resolution, cmyk_transform.get());
+	bool ok = writer.open();
+	QImage band;
+	for (int top = 0; ok && top < size.height(); top += band.height())
+	{
+		const int height = qMin(band_height, size.height() - top);
+		if (band.height() != height)
+			band = QImage(size.width(), height, QImage::Format_ARGB32_Premultiplied);
+		if (band.isNull())
+		{
+			error = tr("Failed to prepare the image. Not enough memory.");
+			return false;
+		}
+
+		const QRectF band_extent(print_area.left(), print_area.top() + top * map_mm_per_pixel,
+		                         print_area.width(), height * map_mm_per_pixel);
+		QPainter painter(&band);
+		map_printer.drawPage(&painter, resolution, band_extent, true, &band);
+		ok = painter.isActive();
+		painter.end();
+
+		ok = ok && writer.writeBand(band);
+	}
+
+	if (!ok || !writer.finish())
+	{
+		error = tr("Failed to save the image. Does the path exist? Do you have sufficient rights?");
+		return false;
+	}
+	return true;
+}
+
+#endif
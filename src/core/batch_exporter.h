@@ -0,0 +1,154 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_BATCH_EXPORTER_H_
+#define _OPENORIENTEERING_BATCH_EXPORTER_H_
+
+#include <vector>
+
+#include <QCoreApplication>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+
+#ifdef QT_PRINTSUPPORT_LIB
+
+class MapPrinter;
+
+
+/**
+ * Exports map files without user interaction.
+ *
+ * Each job loads a map file, including all map parts, and writes it as PDF,
+ * as PDF of spot color separations, or as a raster image. The output is
+ * rendered by MapPrinter, with the print configuration saved in the map file
+ * unless the job overrides the print area, the scale or the resolution.
+ * Raster images cover exactly the print area. PDF documents use the page
+ * format of the print configuration.
+ *
+ * Multiple jobs are run in parallel, each in its own thread. Loading the
+ * maps and templates is serialized because it depends on process-wide state,
+ * but rendering and writing the output run concurrently. The exporter
+ * needs a QApplication object, but it does not need a windowing system: The
+ * "minimal" platform plugin is sufficient.
+ *
+ * Synopsis:
+ *
+ * BatchExporter::Job job;
+ * job.input_path  = "map.omap";
+ * job.output_path = "map.png";
+ * job.format = BatchExporter::formatForPath(job.output_path);
+ * auto results = BatchExporter::run({ job }, QThread::idealThreadCount());
+ */
+class BatchExporter
+{
+	Q_DECLARE_TR_FUNCTIONS(BatchExporter)
+
+public:
+	/** The output formats. */
+	enum Format
+	{
+		Pdf,          ///< PDF, in the mode of the print configuration
+		Separations,  ///< PDF, one page per spot color
+		Image,        ///< Raster image, in a format determined by the file name
+	};
+
+	/** The parameters for exporting a single map. */
+	struct Job
+	{
+		/** Constructs a job which uses the map's print configuration. */
+		Job();
+
+		/** The map file to be exported. */
+		QString input_path;
+
+		/** The file to be written. */
+		QString output_path;
+
+		/** The output format. */
+		Format format;
+
+		/** The map area to be exported, in mm. If empty, the print area of the map. */
+		QRectF print_area;
+
+		/** The scale denominator for printing. If 0, the configured scale. */
+		unsigned int scale;
+
+		/** The resolution, in dpi. If 0, the configured resolution. */
+		unsigned int resolution;
+
+		/** Controls if the templates which are visible in the map's saved view are exported. */
+		bool show_templates;
+
+		/** Controls if spot color overprinting is simulated. Implies raster mode for PDF. */
+		bool simulate_overprinting;
+	};
+
+	/** The outcome of a job. */
+	struct Result
+	{
+		/** Constructs an unsuccessful result. */
+		Result();
+
+		/** True if the output was written. */
+		bool success;
+
+		/** The reason of failure, if not successful. */
+		QString error;
+
+		/** The time spent for loading the map and its templates, including waiting for other jobs, in milliseconds. */
+		qint64 load_time;
+
+		/** The time spent for rendering and writing the output, in milliseconds. */
+		qint64 export_time;
+	};
+
+	/**
+	 * Returns the format which matches the file name extension of the path:
+	 * Image for PNG, BMP, TIFF and JPEG, otherwise Pdf.
+	 */
+	static Format formatForPath(const QString& path);
+
+	/**
+	 * Runs a single job in the current thread.
+	 */
+	static Result exportMap(const Job& job);
+
+	/**
+	 * Runs the jobs by means of the given number of threads.
+	 *
+	 * Blocks until all jobs are finished. The results are in the order of the
+	 * jobs.
+	 */
+	static std::vector<Result> run(const std::vector<Job>& jobs, int num_threads);
+
+private:
+	class JobRunner;
+
+	/** Renders the print area to an image file. */
+	static bool exportImage(const MapPrinter& map_printer, const QString& path, QString& error);
+
+	/** Renders the print area to a TIFF file in horizontal bands. */
+	static bool exportTiff(const MapPrinter& map_printer, const QString& path, const QSize& size, QString& error);
+};
+
+#endif
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "color_transform.h"
+
+#include <algorithm>
+
+
+namespace
+{
+	/** Returns the tone value of t after the given tone value increase at 50 %. */
+	float printedTone(float t, float dot_gain)
+	{
+		return qBound(0.0f, t + 4.0f * dot_gain * t * (1.0f - t), 1.0f);
+	}
+	
+	/** Returns the component scaled by the given factor, as a byte. */
+	int scaled(int component, float factor)
+	{
+		return qBound(0, qRound(component * factor), 255);
+	}
+}
+
+
+
+// ### ColorTransform::Profile ###
+
+// static
+ColorTransform::Profile ColorTransform::Profile::defaultProfile()
+{
+	return { 3.2f, 0.12f, qRgb(255, 255, 255) };
+}
+
+
+
+// ### ColorTransform ###
+
+ColorTransform::ColorTransform(const Profile& profile)
+ : process_profile(profile)
+{
+	// nothing else
+}
+
+void ColorTransform::addColor(const MapColor* color)
+{
+	if (!color)
+		return;
+	
+	const MapColorCmyk cmyk = limited(color->getCmyk());
+	color_entries[color] = { cmyk, proof(cmyk) };
+	
+	// The first color with a particular RGB value wins,
+	// i.e. the color with the highest priority when added in order.
+	const QRgb rgb = static_cast<const QColor&>(*color).rgb();
+	color_pixels.insert({ rgb, pack(cmyk) });
+}
+
+void ColorTransform::clear()
+{
+	color_entries.clear();
+	color_pixels.clear();
+	cached_pixels.clear();
+}
+
+MapColorCmyk ColorTransform::cmyk(const MapColor* color) const
+{
+	auto found = color_entries.find(color);
+	if (found != color_entries.end())
+		return found->second.cmyk;
+	return limited(color->getCmyk());
+}
+
+QColor ColorTransform::proofColor(const MapColor* color) const
+{
+	auto found = color_entries.find(color);
+	if (found != color_entries.end())
+		return QColor(found->second.proof);
+	return QColor(proof(limited(color->getCmyk())));
+}
+
+void ColorTransform::convertToCmyk(const QRgb* pixels, int count, uchar* cmyk_out)
+{
+	// Neighbouring pixels mostly have the same value.
+	QRgb last_rgb = 0;
+	quint32 last_cmyk = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		// Compose the premultiplied pixel over white paper.
+		const QRgb pixel = pixels[i];
+		const int paper = 255 - qAlpha(pixel);
+		const QRgb rgb = qRgb(qRed(pixel) + paper, qGreen(pixel) + paper, qBlue(pixel) + paper);
+		if (i == 0 || rgb != last_rgb)
+		{
+			last_rgb = rgb;
+			auto found = color_pixels.find(rgb);
+			if (found != color_pixels.end())
+			{
+				last_cmyk = found->second;
+			}
+			else
+			{
+				auto cached = cached_pixels.find(rgb);
+				if (cached == cached_pixels.end())
+				{
+					if (cached_pixels.size() >= max_cached_pixels)
+						cached_pixels.clear();
+					cached = cached_pixels.insert({ rgb, separate(rgb) }).first;
+				}
+				last_cmyk = cached->second;
+			}
+		}
+		
+		*cmyk_out++ = uchar(last_cmyk >> 24);
+		*cmyk_out++ = uchar(last_cmyk >> 16);
+		*cmyk_out++ = uchar(last_cmyk >> 8);
+		*cmyk_out++ = uchar(last_cmyk);
+	}
+}
+
+MapColorCmyk ColorTransform::limited(MapColorCmyk cmyk) const
+{
+	const float cmy = cmyk.c + cmyk.m + cmyk.y;
+	if (cmy > 0.0f && cmy + cmyk.k > process_profile.total_area_coverage)
+	{
+		// Keep the black, and reduce the other inks proportionally.
+		const float factor = qMax(0.0f, process_profile.total_area_coverage - cmyk.k) / cmy;
+		cmyk.c *= factor;
+		cmyk.m *= factor;
+		cmyk.y *= factor;
+	}
+	return cmyk;
+}
+
+QRgb ColorTransform::proof(const MapColorCmyk& cmyk) const
+{
+	const float dot_gain = process_profile.dot_gain;
+	const float k = 1.0f - printedTone(cmyk.k, dot_gain);
+	const QRgb paper = process_profile.paper;
+	return qRgb(scaled(qRed(paper),   (1.0f - printedTone(cmyk.c, dot_gain)) * k),
+	            scaled(qGreen(paper), (1.0f - printedTone(cmyk.m, dot_gain)) * k),
+	            scaled(qBlue(paper),  (1.0f - printedTone(cmyk.y, dot_gain)) * k));
+}
+
+quint32 ColorTransform::separate(QRgb rgb) const
+{
+	const float r = qRed(rgb) / 255.0f;
+	const float g = qGreen(rgb) / 255.0f;
+	const float b = qBlue(rgb) / 255.0f;
+	const float k = 1.0f - std::max({ r, g, b });
+	if (k >= 1.0f)
+		return pack({ 0.0f, 0.0f, 0.0f, 1.0f });
+	
+	return pack(limited({ (1.0f - r - k) / (1.0f - k),
+	                      (1.0f - g - k) / (1.0f - k),
+	                      (1.0f - b - k) / (1.0f - k),
+	                      k }));
+}
+
+// static
+quint32 ColorTransform::pack(const MapColorCmyk& cmyk)
+{
+	auto byte = [](float value) -> quint32 {
+		return quint32(qBound(0, qRound(value * 255.0f), 255));
+	};
+	return byte(cmyk.c) << 24 | byte(cmyk.m) << 16 | byte(cmyk.y) << 8 | byte(cmyk.k);
+}
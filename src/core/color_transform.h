@@ -0,0 +1,154 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_COLOR_TRANSFORM_H_
+#define _OPENORIENTEERING_COLOR_TRANSFORM_H_
+
+#include <unordered_map>
+
+#include <QColor>
+
+#include "map_color.h"
+
+
+/**
+ * @brief ColorTransform converts map colors and rendered pixels for a CMYK printing process.
+ *
+ * The process is described by a simple parametric profile: a limit for the
+ * total ink coverage, a tone value increase (dot gain), and the paper color.
+ * For each map color, the conversions are computed once by addColor() and
+ * kept in a lookup table:
+ *
+ * - The CMYK output values are the color's own CMYK definition, limited to
+ *   the total area coverage.
+ * - The proof color is the RGB color which simulates the printed CMYK
+ *   values on the screen (soft proof).
+ *
+ * Rendered RGB pixels are converted by convertToCmyk(). Pixels which have
+ * exactly the RGB value of a map color get the CMYK values of that color.
+ * Other values, e.g. from antialiasing and from templates, are converted
+ * once per distinct value and then taken from a cache.
+ *
+ * Synopsis:
+ *
+ * ColorTransform transform;
+ * for (int i = 0; i < map.getNumColors(); ++i)
+ *     transform.addColor(map.getColor(i));
+ * painter.setPen(transform.proofColor(color));
+ * ...
+ * transform.convertToCmyk(row, width, cmyk_row);
+ */
+class ColorTransform
+{
+public:
+	/** Parameters of a CMYK printing process. */
+	struct Profile
+	{
+		/** The maximum sum of the CMYK components, e.g. 3.0 for 300 %. */
+		float total_area_coverage;
+		
+		/** The tone value increase at 50 % tone, e.g. 0.15 for 15 %. */
+		float dot_gain;
+		
+		/** The color of the unprinted paper. */
+		QRgb paper;
+		
+		/** Returns a profile for coated paper and offset printing. */
+		static Profile defaultProfile();
+	};
+	
+	/** Constructs a transform for the given profile, without colors. */
+	explicit ColorTransform(const Profile& profile = Profile::defaultProfile());
+	
+	/** Returns the profile. */
+	const Profile& profile() const;
+	
+	/**
+	 * Computes the conversions for the given color.
+	 *
+	 * The color must not be modified while it is used with this transform.
+	 */
+	void addColor(const MapColor* color);
+	
+	/** Discards the conversions of all colors and the cached pixel values. */
+	void clear();
+	
+	/**
+	 * Returns the CMYK output values of the given color.
+	 *
+	 * Colors which were not added are converted on the fly.
+	 */
+	MapColorCmyk cmyk(const MapColor* color) const;
+	
+	/**
+	 * Returns the color which simulates the printed color on the screen.
+	 *
+	 * The opacity of the map color is not applied. Colors which were not
+	 * added are converted on the fly.
+	 */
+	QColor proofColor(const MapColor* color) const;
+	
+	/**
+	 * Converts a row of premultiplied ARGB32 pixels to 8-bit CMYK samples.
+	 *
+	 * Transparent pixels show the paper, i.e. they get no ink.
+	 * The output must provide 4 * count bytes.
+	 */
+	void convertToCmyk(const QRgb* pixels, int count, uchar* cmyk_out);
+
+private:
+	/** Limits the sum of the components to the total area coverage. */
+	MapColorCmyk limited(MapColorCmyk cmyk) const;
+	
+	/** Returns the simulated screen color of the given CMYK values. */
+	QRgb proof(const MapColorCmyk& cmyk) const;
+	
+	/** Returns the CMYK samples of an opaque RGB value which is not a map color. */
+	quint32 separate(QRgb rgb) const;
+	
+	/** Packs the CMYK values into four bytes. */
+	static quint32 pack(const MapColorCmyk& cmyk);
+	
+	/** The precomputed conversions of a map color. */
+	struct Entry
+	{
+		MapColorCmyk cmyk;
+		QRgb proof;
+	};
+	
+	/** The maximum number of cached pixel values. */
+	static const std::size_t max_cached_pixels = 1 << 16;
+	
+	Profile process_profile;
+	std::unordered_map<const MapColor*, Entry> color_entries;
+	std::unordered_map<QRgb, quint32> color_pixels;
+	std::unordered_map<QRgb, quint32> cached_pixels;
+};
+
+
+
+// ### ColorTransform inline code ###
+
+inline
+const ColorTransform::Profile& ColorTransform::profile() const
+{
+	return process_profile;
+}
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "decoded_image_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <initializer_list>
+#include <limits>
+#include <vector>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+
+
+namespace
+{
+	/** Identifies the data of a cached image. */
+	const quint32 magic = 0x4f4f4449; // "OODI"
+
+	/** The bytes written since the last pruning, for all caches. Prunes on the first save. */
+	std::atomic<qint64> bytes_since_prune(std::numeric_limits<qint64>::max() / 2);
+
+	/** Returns the directory which holds all entries. */
+	QString cacheDir()
+	{
+		const QString cache_dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+		if (cache_dir.isEmpty())
+			return QString();
+
+		return cache_dir + QLatin1String("/decoded-images");
+	}
+
+	/** Returns the path of the file for the image with the given name. */
+	QString imagePath(const QString& entry_dir, const QString& name)
+	{
+		return entry_dir + QLatin1Char('/') + name + QLatin1String(".image");
+	}
+
+	/** Information about a cache entry, for pruning */
+	struct EntryInfo
+	{
+		QString path;
+		qint64 size;
+		qint64 last_use;  ///< in ms since the epoch
+	};
+
+	/** Returns the time when the file was last read or written, in ms since the epoch. */
+	qint64 lastUse(const QFileInfo& file_info)
+	{
+		qint64 last_use = 0;
+		for (const auto& time : { file_info.lastRead(), file_info.lastModified() })
+		{
+			if (time.isValid())
+				last_use = std::max(last_use, time.toMSecsSinceEpoch());
+		}
+		return last_use;
+	}
+}
+
+
+
+// ### DecodedImageCache ###
+
+DecodedImageCache::DecodedImageCache()
+ : size_limit(0)
+{
+	; // nothing
+}
+
+DecodedImageCache::DecodedImageCache(const QString& path, qint64 size_limit)
+ : size_limit(size_limit)
+{
+	const QFileInfo file_info(path);
+	const QString canonical_path = file_info.canonicalFilePath();
+	const QString cache_dir = cacheDir();
+	if (size_limit <= 0 || canonical_path.isEmpty() || cache_dir.isEmpty())
+		return;
+
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(canonical_path.toUtf8());
+	hash.addData(QByteArray::number(file_info.size()));
+	hash.addData(QByteArray::number(file_info.lastModified().toMSecsSinceEpoch()));
+	entry_dir = cache_dir + QLatin1Char('/') + QString::fromLatin1(hash.result().toHex());
+}
+
+bool DecodedImageCache::isEnabled() const
+{
+	return !entry_dir.isEmpty();
+}
+
+QImage DecodedImageCache::restore(const QString& name) const
+{
+	if (!isEnabled())
+		return QImage();
+
+	QFile file(imagePath(entry_dir, name));
+	if (!file.open(QIODevice::ReadOnly))
+		return QImage();
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_2);
+	quint32 entry_magic;
+	qint32 width, height, format, bytes_per_line;
+	QVector<QRgb> color_table;
+	stream >> entry_magic >> width >> height >> format >> bytes_per_line >> color_table;
+	if (stream.status() != QDataStream::Ok || entry_magic != magic
+	    || format <= QImage::Format_Invalid || format >= QImage::NImageFormats)
+		return QImage();
+
+	QImage image(width, height, QImage::Format(format));
+	if (image.isNull() || image.bytesPerLine() != bytes_per_line)
+		return QImage();
+
+	const qint64 size = image.byteCount();
+	if (file.read(reinterpret_cast<char*>(image.bits()), size) != size)
+		return QImage();
+
+	image.setColorTable(color_table);
+	return image;
+}
+
+void DecodedImageCache::save(const QString& name, const QImage& image) const
+{
+	if (!isEnabled() || image.isNull() || image.byteCount() > size_limit / 2)
+		return;
+
+	if (!QDir().mkpath(entry_dir))
+		return;
+
+	QSaveFile file(imagePath(entry_dir, name));
+	if (!file.open(QIODevice::WriteOnly))
+		return;
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_2);
+	stream << magic
+	       << qint32(image.width()) << qint32(image.height())
+	       << qint32(image.format()) << qint32(image.bytesPerLine())
+	       << image.colorTable();
+	stream.writeRawData(reinterpret_cast<const char*>(image.constBits()), image.byteCount());
+	if (stream.status() != QDataStream::Ok || !file.commit())
+		return;
+
+	if ((bytes_since_prune += image.byteCount()) > size_limit / 16)
+	{
+		bytes_since_prune = 0;
+		prune();
+	}
+}
+
+void DecodedImageCache::prune() const
+{
+	const QString cache_dir = cacheDir();
+	std::vector<EntryInfo> entries;
+	qint64 total_size = 0;
+	QDirIterator entry_it(cache_dir, QDir::Dirs | QDir::NoDotAndDotDot);
+	while (entry_it.hasNext())
+	{
+		EntryInfo entry = { entry_it.next(), 0, 0 };
+		QDirIterator file_it(entry.path, QDir::Files);
+		while (file_it.hasNext())
+		{
+			file_it.next();
+			const QFileInfo file_info = file_it.fileInfo();
+			entry.size += file_info.size();
+			entry.last_use = std::max(entry.last_use, lastUse(file_info));
+		}
+		total_size += entry.size;
+		entries.push_back(entry);
+	}
+	if (total_size <= size_limit)
+		return;
+
+	std::sort(begin(entries), end(entries), [](const EntryInfo& a, const EntryInfo& b) {
+		return a.last_use < b.last_use;
+	});
+	for (const auto& entry : entries)
+	{
+		if (total_size <= size_limit)
+			break;
+		if (QDir(entry.path) == QDir(entry_dir))
+			continue;
+		if (QDir(entry.path).removeRecursively())
+			total_size -= entry.size;
+	}
+}
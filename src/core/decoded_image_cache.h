@@ -0,0 +1,101 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_DECODED_IMAGE_CACHE_H_
+#define _OPENORIENTEERING_DECODED_IMAGE_CACHE_H_
+
+#include <QtGlobal>
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+class QImage;
+QT_END_NAMESPACE
+
+
+/**
+ * A persistent cache of decoded images, such as the tiles of a large image file.
+ *
+ * Decoding large compressed images takes much longer than reading the decoded
+ * pixels. The cache stores the decoded images of an image file in the user's
+ * cache directory, in an entry which is keyed by the file's path, size and
+ * modification time. So outdated entries are never used. Within an entry,
+ * images are identified by name (e.g. "overview", or a tile's name).
+ *
+ * The total size of the cache is limited. When it is exceeded, the least
+ * recently used entries are removed.
+ *
+ * The cache may be used from multiple threads.
+ *
+ * Synopsis:
+ *
+ * DecodedImageCache cache(path, size_limit);
+ * QImage image = cache.restore(QLatin1String("image"));
+ * if (image.isNull())
+ * {
+ *     image = QImage(path);
+ *     cache.save(QLatin1String("image"), image);
+ * }
+ */
+class DecodedImageCache
+{
+public:
+	/**
+	 * Constructs a disabled cache.
+	 */
+	DecodedImageCache();
+
+	/**
+	 * Constructs a cache for the decoded images of the given file.
+	 *
+	 * The size limit is the maximum size of the whole cache, in bytes.
+	 * A size limit of zero disables the cache.
+	 */
+	DecodedImageCache(const QString& path, qint64 size_limit);
+
+	/**
+	 * Returns true if images can be stored and restored.
+	 */
+	bool isEnabled() const;
+
+	/**
+	 * Returns the image with the given name, or a null image
+	 * if there is no such image in the cache.
+	 */
+	QImage restore(const QString& name) const;
+
+	/**
+	 * Stores the image with the given name.
+	 *
+	 * Removes least recently used entries when the size limit is exceeded.
+	 */
+	void save(const QString& name, const QImage& image) const;
+
+private:
+	/**
+	 * Removes least recently used entries, except for this cache's entry,
+	 * until the size of the cache meets the size limit.
+	 */
+	void prune() const;
+
+	QString entry_dir;
+	qint64 size_limit;
+};
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_FLAT_MAP_H_
+#define _OPENORIENTEERING_FLAT_MAP_H_
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+
+/**
+ * A map which keeps its elements sorted in a contiguous vector.
+ *
+ * FlatMap offers the subset of the std::map interface which is needed for
+ * small collections which are visited much more often than they are
+ * modified. Lookup is a binary search, and iteration is linear memory
+ * access. Insertion and removal move the elements behind the position,
+ * and they invalidate all iterators and references.
+ *
+ * Unlike std::map, the key of value_type is not const, but it must not be
+ * modified through an iterator. Key and T must be move-assignable.
+ */
+template< class Key, class T, class Compare = std::less<Key> >
+class FlatMap : private std::vector< std::pair<Key, T> >
+{
+	typedef std::vector< std::pair<Key, T> > base_type;
+
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+	typedef typename base_type::value_type value_type;
+	typedef typename base_type::size_type size_type;
+	typedef typename base_type::iterator iterator;
+	typedef typename base_type::const_iterator const_iterator;
+	typedef typename base_type::reverse_iterator reverse_iterator;
+	typedef typename base_type::const_reverse_iterator const_reverse_iterator;
+
+	using base_type::begin;
+	using base_type::end;
+	using base_type::rbegin;
+	using base_type::rend;
+	using base_type::size;
+	using base_type::empty;
+	using base_type::capacity;
+	using base_type::reserve;
+	using base_type::shrink_to_fit;
+	using base_type::clear;
+
+	/** Returns the first element whose key is not less than the given key. */
+	iterator lower_bound(const Key& key);
+
+	/** Returns the first element whose key is not less than the given key. */
+	const_iterator lower_bound(const Key& key) const;
+
+	/** Returns the element with the given key, or end(). */
+	iterator find(const Key& key);
+
+	/** Returns the element with the given key, or end(). */
+	const_iterator find(const Key& key) const;
+
+	/**
+	 * Returns the value for the given key.
+	 * 
+	 * A default-constructed value is inserted if the key is not found.
+	 */
+	T& operator[](const Key& key);
+
+	/**
+	 * Removes the element at the given position.
+	 * 
+	 * Returns the position of the element which followed the removed one.
+	 */
+	iterator erase(iterator pos);
+
+private:
+	/** Compares an element to a key. */
+	static bool less(const value_type& element, const Key& key);
+};
+
+
+
+// ### FlatMap inline and template code ###
+
+template< class Key, class T, class Compare >
+inline
+bool FlatMap<Key, T, Compare>::less(const value_type& element, const Key& key)
+{
+	return Compare()(element.first, key);
+}
+
+template< class Key, class T, class Compare >
+inline
+typename FlatMap<Key, T, Compare>::iterator FlatMap<Key, T, Compare>::lower_bound(const Key& key)
+{
+	return std::lower_bound(begin(), end(), key, &FlatMap::less);
+}
+
+template< class Key, class T, class Compare >
+inline
+typename FlatMap<Key, T, Compare>::const_iterator FlatMap<Key, T, Compare>::lower_bound(const Key& key) const
+{
+	return std::lower_bound(begin(), end(), key, &FlatMap::less);
+}
+
+template< class Key, class T, class Compare >
+inline
+typename FlatMap<Key, T, Compare>::iterator FlatMap<Key, T, Compare>::find(const Key& key)
+{
+	auto it = lower_bound(key);
+	return (it == end() || Compare()(key, it->first)) ? end() : it;
+}
+
+template< class Key, class T, class Compare >
+inline
+typename FlatMap<Key, T, Compare>::const_iterator FlatMap<Key, T, Compare>::find(const Key& key) const
+{
+	auto it = lower_bound(key);
+	return (it == end() || Compare()(key, it->first)) ? end() : it;
+}
+
+template< class Key, class T, class Compare >
+T& FlatMap<Key, T, Compare>::operator[](const Key& key)
+{
+	auto it = lower_bound(key);
+	if (it == end() || Compare()(key, it->first))
+		it = base_type::insert(it, value_type(key, T()));
+	return it->second;
+}
+
+template< class Key, class T, class Compare >
+inline
+typename FlatMap<Key, T, Compare>::iterator FlatMap<Key, T, Compare>::erase(iterator pos)
+{
+	return base_type::erase(pos);
+}
+
+#endif
@@ -20,6 +20,8 @@
 
 #include "georeferencing.h"
 
+#include <cmath>
+
 #include <qmath.h>
 #include <QCoreApplication>
 #include <QDebug>
@@ -124,6 +126,29 @@ namespace
 		{ "+init=epsg:5514", "+proj=krovak +lat_0=49.5 +lon_0=24.83333333333333 +alpha=30.28813972222222 +k=0.9999 +x_0=0 +y_0=0 "
 		                     "+ellps=bessel +towgs84=542.5,89.2,456.9,5.517,2.275,5.516,6.96 +pm=greenwich +units=m +no_defs" },
 	};
+	
+	
+	/**
+	 * Transforms the coordinates in a single call to pj_transform.
+	 * 
+	 * Returns false if any coordinate could not be transformed.
+	 */
+	bool pj_transform_all(projPJ src, projPJ dst, std::vector<double>& x, std::vector<double>& y)
+	{
+		if (x.empty())
+			return true;
+		
+		if (pj_transform(src, dst, long(x.size()), 1, x.data(), y.data(), NULL) != 0)
+			return false;
+		
+		// Points which fail individually are set to HUGE_VAL.
+		for (auto value : x)
+		{
+			if (value == HUGE_VAL)
+				return false;
+		}
+		return true;
+	}
 }
 
 
@@ -181,6 +206,17 @@ Georeferencing::~Georeferencing()
 
 Georeferencing& Georeferencing::operator=(const Georeferencing& other)
 {
+	// Listeners such as templates reproject their data on every signal,
+	// so only the signals for actual changes are emitted.
+	const bool state_changed          = state != other.state;
+	const bool transformation_changed = to_projected != other.to_projected;
+	const bool declination_changed    = declination != other.declination;
+	const bool projection_changed     = projected_crs_spec != other.projected_crs_spec
+	                                    || projected_crs_id != other.projected_crs_id
+	                                    || projected_crs_parameters != other.projected_crs_parameters
+	                                    || geographic_ref_point != other.geographic_ref_point
+	                                    || projected_crs == NULL;
+	
 	state                    = other.state;
 	scale_denominator        = other.scale_denominator;
 	declination              = other.declination;
@@ -196,14 +232,21 @@ Georeferencing& Georeferencing::operator=(const Georeferencing& other)
 	projected_crs_parameters = other.projected_crs_parameters;
 	geographic_ref_point     = other.geographic_ref_point;
 	
-	if (projected_crs != NULL)
-		pj_free(projected_crs);
-	projected_crs       = pj_init_plus_no_defs(projected_crs_spec);
+	if (projection_changed)
+	{
+		if (projected_crs != NULL)
+			pj_free(projected_crs);
+		projected_crs       = pj_init_plus_no_defs(projected_crs_spec);
+	}
 	
-	emit stateChanged();
-	emit transformationChanged();
-	emit declinationChanged();
-	emit projectionChanged();
+	if (state_changed)
+		emit stateChanged();
+	if (transformation_changed)
+		emit transformationChanged();
+	if (declination_changed)
+		emit declinationChanged();
+	if (projection_changed)
+		emit projectionChanged();
 	
 	return *this;
 }
@@ -748,6 +791,121 @@ MapCoordF Georeferencing::toMapCoordF(Georeferencing* other, const MapCoordF& ma
 	}
 }
 
+bool Georeferencing::toGeographicCoords(const std::vector<MapCoordF>& map_coords, std::vector<LatLon>& lat_lon) const
+{
+	std::vector<QPointF> projected_coords;
+	projected_coords.reserve(map_coords.size());
+	for (const auto& coord : map_coords)
+		projected_coords.push_back(toProjectedCoords(coord));
+	return toGeographicCoords(projected_coords, lat_lon);
+}
+
+bool Georeferencing::toGeographicCoords(const std::vector<QPointF>& projected_coords, std::vector<LatLon>& lat_lon) const
+{
+	lat_lon.clear();
+	if (projected_coords.empty())
+		return true;
+	
+	std::vector<double> easting, northing;
+	easting.reserve(projected_coords.size());
+	northing.reserve(projected_coords.size());
+	for (const auto& coord : projected_coords)
+	{
+		easting.push_back(coord.x());
+		northing.push_back(coord.y());
+	}
+	
+	if (!projected_crs || !geographic_crs
+	    || !pj_transform_all(projected_crs, geographic_crs, easting, northing))
+		return false;
+	
+	lat_lon.reserve(easting.size());
+	for (std::size_t i = 0; i < easting.size(); ++i)
+		lat_lon.push_back(LatLon::fromRadiant(northing[i], easting[i]));
+	return true;
+}
+
+bool Georeferencing::toProjectedCoords(const std::vector<LatLon>& lat_lon, std::vector<QPointF>& projected_coords) const
+{
+	projected_coords.clear();
+	if (lat_lon.empty())
+		return true;
+	
+	std::vector<double> easting, northing;
+	easting.reserve(lat_lon.size());
+	northing.reserve(lat_lon.size());
+	for (const auto& coord : lat_lon)
+	{
+		easting.push_back(degToRad(coord.longitude()));
+		northing.push_back(degToRad(coord.latitude()));
+	}
+	
+	if (!projected_crs || !geographic_crs
+	    || !pj_transform_all(geographic_crs, projected_crs, easting, northing))
+		return false;
+	
+	projected_coords.reserve(easting.size());
+	for (std::size_t i = 0; i < easting.size(); ++i)
+		projected_coords.push_back(QPointF(easting[i], northing[i]));
+	return true;
+}
+
+bool Georeferencing::toMapCoordF(const std::vector<LatLon>& lat_lon, std::vector<MapCoordF>& map_coords) const
+{
+	map_coords.clear();
+	
+	std::vector<QPointF> projected_coords;
+	if (!toProjectedCoords(lat_lon, projected_coords))
+		return false;
+	
+	map_coords.reserve(projected_coords.size());
+	for (const auto& coord : projected_coords)
+		map_coords.push_back(toMapCoordF(coord));
+	return true;
+}
+
+bool Georeferencing::toMapCoordF(const Georeferencing* other, const std::vector<MapCoordF>& other_coords, std::vector<MapCoordF>& map_coords) const
+{
+	if (other == NULL)
+	{
+		map_coords = other_coords;
+		return true;
+	}
+	
+	map_coords.clear();
+	if (other_coords.empty())
+		return true;
+	
+	if (isLocal() || other->isLocal())
+	{
+		map_coords.reserve(other_coords.size());
+		for (const auto& coord : other_coords)
+			map_coords.push_back(toMapCoordF(other->toProjectedCoords(coord)));
+		return true;
+	}
+	
+	std::vector<double> easting, northing;
+	easting.reserve(other_coords.size());
+	northing.reserve(other_coords.size());
+	for (const auto& coord : other_coords)
+	{
+		const QPointF projected_coords = other->toProjectedCoords(coord);
+		easting.push_back(projected_coords.x());
+		northing.push_back(projected_coords.y());
+	}
+	
+	// Use geographic coordinates as intermediate step, cf. the single coordinate variant.
+	if (!projected_crs || !other->projected_crs
+	    || !pj_transform_all(other->projected_crs, geographic_crs, easting, northing)
+	    || !pj_transform_all(geographic_crs, projected_crs, easting, northing))
+		return false;
+	
+	map_coords.reserve(easting.size());
+	for (std::size_t i = 0; i < easting.size(); ++i)
+		map_coords.push_back(toMapCoordF(QPointF(easting[i], northing[i])));
+	return true;
+}
+
 QString Georeferencing::getErrorText() const
 {
 	int err_no = *pj_get_errno_ref();
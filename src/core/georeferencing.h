@@ -21,6 +21,8 @@
 #ifndef _OPENORIENTEERING_GEOREFERENCING_H_
 #define _OPENORIENTEERING_GEOREFERENCING_H_
 
+#include <vector>
+
 #include <QPointF>
 #include <QString>
 #include <QTransform>
@@ -400,6 +402,38 @@ public:
 	MapCoordF toMapCoordF(Georeferencing* other, const MapCoordF& map_coords, bool* ok = NULL) const;
 	
 	
+	/**
+	 * Transforms map (paper) coordinates to geographic coordinates (lat/lon).
+	 * 
+	 * The batch functions transform all coordinates in a single call to
+	 * PROJ.4. They resize the output vector to the size of the input. If any
+	 * coordinate cannot be transformed, they return false and leave the
+	 * output vector empty.
+	 */
+	bool toGeographicCoords(const std::vector<MapCoordF>& map_coords, std::vector<LatLon>& lat_lon) const;
+	
+	/**
+	 * Transforms CRS coordinates to geographic coordinates (lat/lon).
+	 */
+	bool toGeographicCoords(const std::vector<QPointF>& projected_coords, std::vector<LatLon>& lat_lon) const;
+	
+	/**
+	 * Transforms geographic coordinates (lat/lon) to CRS coordinates.
+	 */
+	bool toProjectedCoords(const std::vector<LatLon>& lat_lon, std::vector<QPointF>& projected_coords) const;
+	
+	/**
+	 * Transforms geographic coordinates (lat/lon) to map coordinates.
+	 */
+	bool toMapCoordF(const std::vector<LatLon>& lat_lon, std::vector<MapCoordF>& map_coords) const;
+	
+	/**
+	 * Transforms map coordinates from the other georeferencing to
+	 * map coordinates of this georeferencing, if possible.
+	 */
+	bool toMapCoordF(const Georeferencing* other, const std::vector<MapCoordF>& other_coords, std::vector<MapCoordF>& map_coords) const;
+	
+	
 	/**
 	 * Returns the current error text.
 	 */
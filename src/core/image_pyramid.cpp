@@ -0,0 +1,224 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "image_pyramid.h"
+
+#include <QPaintEngine>
+#include <QPainter>
+#include <qmath.h>
+
+
+namespace
+{
+	/**
+	 * Returns the size of the next level.
+	 */
+	QSize nextLevelSize(const QSize& size)
+	{
+		return QSize((size.width() + 1) / 2, (size.height() + 1) / 2);
+	}
+
+	/**
+	 * Returns a QImage which refers to the given rect of the given image,
+	 * without copying the pixel data.
+	 *
+	 * The returned image must not be used after the original image was
+	 * modified or destroyed.
+	 */
+	QImage subImage(const QImage& image, const QRect& rect)
+	{
+		const uchar* data = image.constBits()
+		                    + rect.top() * image.bytesPerLine()
+		                    + rect.left() * image.depth() / 8;
+		QImage sub_image(data, rect.width(), rect.height(), image.bytesPerLine(), image.format());
+		if (!image.colorTable().isEmpty())
+			sub_image.setColorTable(image.colorTable());
+		return sub_image;
+	}
+}
+
+
+
+// ### ImagePyramid ###
+
+ImagePyramid::ImagePyramid()
+ : tile_copies_size(0)
+{
+	; // nothing else
+}
+
+ImagePyramid::~ImagePyramid()
+{
+	; // nothing
+}
+
+void ImagePyramid::clear()
+{
+	levels.clear();
+	tile_copies.clear();
+	tile_copies_size = 0;
+}
+
+qint64 ImagePyramid::memoryUsage() const
+{
+	qint64 result = tile_copies_size;
+	for (const QImage& level : levels)
+		result += level.byteCount();
+	return result;
+}
+
+void ImagePyramid::update(const QImage& image, const QRect& rect)
+{
+	tile_copies.clear();
+	tile_copies_size = 0;
+
+	QRect source_rect = rect.intersected(image.rect());
+	const QImage* source = &image;
+	for (QImage& level : levels)
+	{
+		if (source_rect.isEmpty())
+			break;
+
+		// Include a border of one pixel for the smoothing of the neighbours.
+		QRect level_rect(QPoint(source_rect.left() / 2 - 1, source_rect.top() / 2 - 1),
+		                 QPoint(source_rect.right() / 2 + 1, source_rect.bottom() / 2 + 1));
+		level_rect = level_rect.intersected(level.rect());
+		source_rect = QRect(level_rect.topLeft() * 2, level_rect.size() * 2).intersected(source->rect());
+
+		QImage part = source->copy(source_rect).scaled(level_rect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+		QPainter painter(&level);
+		painter.setCompositionMode(QPainter::CompositionMode_Source);
+		painter.drawImage(level_rect.topLeft(), part);
+		painter.end();
+
+		source = &level;
+		source_rect = level_rect;
+	}
+}
+
+int ImagePyramid::numLevels(const QImage& image)
+{
+	int num_levels = 1;
+	QSize size = image.size();
+	while (qMax(size.width(), size.height()) > tile_size)
+	{
+		size = nextLevelSize(size);
+		++num_levels;
+	}
+	return num_levels;
+}
+
+const QImage& ImagePyramid::level(const QImage& image, int level) const
+{
+	Q_ASSERT(level >= 0);
+	Q_ASSERT(level < numLevels(image));
+
+	if (level == 0)
+		return image;
+
+	while (int(levels.size()) < level)
+	{
+		const QImage& source = levels.empty() ? image : levels.back();
+		QImage next = source.scaled(nextLevelSize(source.size()), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+		levels.push_back(next);
+	}
+	return levels[level - 1];
+}
+
+int ImagePyramid::levelForResolution(const QImage& image, qreal resolution)
+{
+	// Use the smallest level which still offers one pixel per device pixel.
+	const int max_level = numLevels(image) - 1;
+	int level = 0;
+	while (level < max_level && resolution * (2 << level) <= 1.0)
+		++level;
+	return level;
+}
+
+void ImagePyramid::draw(QPainter* painter, const QImage& image, const QPointF& origin, const QRectF& clip_rect) const
+{
+	if (image.isNull())
+		return;
+
+	const qreal resolution = qSqrt(qAbs(painter->worldTransform().determinant()));
+	const int level_index = levelForResolution(image, resolution);
+	const QImage& level_image = level(image, level_index);
+	const qreal scale_x = qreal(image.width()) / level_image.width();
+	const qreal scale_y = qreal(image.height()) / level_image.height();
+
+	QRect rect = level_image.rect();
+	if (clip_rect.isValid())
+	{
+		// The clip rect in level coordinates, with some border for smoothing
+		QRectF level_clip_rect((clip_rect.left() - origin.x()) / scale_x - 1.0,
+		                       (clip_rect.top() - origin.y()) / scale_y - 1.0,
+		                       clip_rect.width() / scale_x + 2.0,
+		                       clip_rect.height() / scale_y + 2.0);
+		level_clip_rect = level_clip_rect.intersected(QRectF(rect));
+		if (level_clip_rect.isEmpty())
+			return;
+
+		// Extend to full tiles
+		const int left   = qFloor(level_clip_rect.left() / tile_size) * tile_size;
+		const int top    = qFloor(level_clip_rect.top() / tile_size) * tile_size;
+		const int right  = qCeil(level_clip_rect.right() / tile_size) * tile_size;
+		const int bottom = qCeil(level_clip_rect.bottom() / tile_size) * tile_size;
+		rect = QRect(left, top, right - left, bottom - top).intersected(rect);
+	}
+
+	const QRectF target(origin.x() + rect.left() * scale_x, origin.y() + rect.top() * scale_y,
+	                    rect.width() * scale_x, rect.height() * scale_y);
+	if (rect == level_image.rect())
+		painter->drawImage(target, level_image);
+	else if (painter->paintEngine() && painter->paintEngine()->type() == QPaintEngine::Raster)
+		painter->drawImage(target, subImage(level_image, rect));
+	else
+	{
+		// The engine may keep a reference, so draw shared copies of the tiles.
+		for (int y = rect.top(); y <= rect.bottom(); y += tile_size)
+		{
+			for (int x = rect.left(); x <= rect.right(); x += tile_size)
+			{
+				const QRect tile_rect = QRect(x, y, tile_size, tile_size).intersected(rect);
+				const QRectF tile_target(origin.x() + tile_rect.left() * scale_x, origin.y() + tile_rect.top() * scale_y,
+				                         tile_rect.width() * scale_x, tile_rect.height() * scale_y);
+				painter->drawImage(tile_target, tileCopy(level_image, level_index, tile_rect));
+			}
+		}
+	}
+}
+
+const QImage& ImagePyramid::tileCopy(const QImage& level_image, int level, const QRect& rect) const
+{
+	const auto key = std::make_pair(level, std::make_pair(rect.left(), rect.top()));
+	auto tile = tile_copies.find(key);
+	if (tile == tile_copies.end())
+	{
+		const QImage copy = level_image.copy(rect);
+		if (tile_copies_size + copy.byteCount() > max_tile_copies_size)
+		{
+			tile_copies.clear();
+			tile_copies_size = 0;
+		}
+		tile_copies_size += copy.byteCount();
+		tile = tile_copies.insert(std::make_pair(key, copy)).first;
+	}
+	return tile->second;
+}
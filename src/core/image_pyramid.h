@@ -0,0 +1,142 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_IMAGE_PYRAMID_H_
+#define _OPENORIENTEERING_IMAGE_PYRAMID_H_
+
+#include <map>
+#include <vector>
+
+#include <QImage>
+
+QT_BEGIN_NAMESPACE
+class QPainter;
+class QPointF;
+class QRect;
+class QRectF;
+QT_END_NAMESPACE
+
+
+/**
+ * A multi-resolution representation of a raster image.
+ *
+ * Level 0 is the original image. Each further level has half the width and
+ * height of the previous level. Levels are built on demand, i.e. when they
+ * are needed for drawing the image at a low resolution.
+ *
+ * The pyramid does not store the original image. The owner passes it to the
+ * functions which need it. This way, the owner may modify its image without
+ * triggering a deep copy, but it must call update() after each modification.
+ *
+ * Drawing selects the level which matches the resolution of the painter,
+ * and it draws only the tiles of that level which intersect the clip rect.
+ * Paint engines other than the raster engine, e.g. the PDF engine, receive
+ * shared copies of single tiles. So an engine which identifies images by
+ * their cache key embeds each tile only once, even when it is drawn on many
+ * pages. These copies are kept until the pyramid is updated or cleared, or
+ * until they exceed a memory limit.
+ *
+ * Synopsis:
+ *
+ * ImagePyramid pyramid;
+ * ...
+ * pyramid.draw(painter, image, origin, clip_rect);
+ * ...
+ * QPainter(&image).drawLine(...);
+ * pyramid.update(image, modified_rect);
+ */
+class ImagePyramid
+{
+public:
+	/** The width and height of the tiles, in pixels of the respective level. */
+	static const int tile_size = 512;
+
+	/** Constructs an empty pyramid. */
+	ImagePyramid();
+
+	/** The memory limit for the copies of tiles, in bytes. */
+	static const qint64 max_tile_copies_size = 64 * 1024 * 1024;
+
+	/** Destructor. */
+	~ImagePyramid();
+
+	/**
+	 * Discards all levels and copies of tiles.
+	 *
+	 * This must be called when the original image is replaced.
+	 */
+	void clear();
+
+	/**
+	 * Updates the given rect (in pixels of the original image) in all levels
+	 * which have been built so far, and discards the copies of tiles.
+	 */
+	void update(const QImage& image, const QRect& rect);
+
+	/**
+	 * Returns the number of levels for the given image, including level 0.
+	 */
+	static int numLevels(const QImage& image);
+
+	/**
+	 * Returns the image of the given level, building it if necessary.
+	 */
+	const QImage& level(const QImage& image, int level) const;
+
+	/**
+	 * Returns the level which is used for the given resolution.
+	 *
+	 * @param resolution The number of device pixels per pixel of the original image.
+	 */
+	static int levelForResolution(const QImage& image, qreal resolution);
+
+	/**
+	 * Draws the image.
+	 *
+	 * The painter's transformation must be set up for the original image's
+	 * pixel coordinates, relative to the given origin. The clip rect is given
+	 * in the same coordinates. If it is not valid, the whole image is drawn.
+	 */
+	void draw(QPainter* painter, const QImage& image, const QPointF& origin, const QRectF& clip_rect) const;
+
+	/**
+	 * Returns the memory used by the levels which have been built so far,
+	 * and by the copies of tiles, in bytes.
+	 */
+	qint64 memoryUsage() const;
+
+private:
+	/**
+	 * Returns the shared copy of the given tile rect of the given level,
+	 * creating it if necessary.
+	 */
+	const QImage& tileCopy(const QImage& level_image, int level, const QRect& rect) const;
+
+	/** The levels 1..n which have been built so far. */
+	mutable std::vector<QImage> levels;
+
+	/** The copies of tiles, by level and by the top left corner of the tile. */
+	mutable std::map<std::pair<int, std::pair<int, int>>, QImage> tile_copies;
+
+	/** The memory used by the copies of tiles, in bytes. */
+	mutable qint64 tile_copies_size;
+};
+
+#endif
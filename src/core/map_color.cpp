@@ -27,6 +27,7 @@
 MapColor::MapColor()
 : name(QApplication::translate("Map", "New color")),
   priority(Undefined),
+  render_key(-1),
   opacity(1.0f),
   q_color(Qt::black),
   spot_color_method(MapColor::UndefinedMethod),
@@ -41,6 +42,7 @@ MapColor::MapColor()
 MapColor::MapColor(int priority)
 : name(QApplication::translate("Map", "New color")),
   priority(priority),
+  render_key(-1),
   opacity(1.0f),
   q_color(Qt::black),
   spot_color_method(MapColor::UndefinedMethod),
@@ -78,6 +80,7 @@ MapColor::MapColor(int priority)
 MapColor::MapColor(const QString& name, int priority)
 : name(name),
   priority(priority),
+  render_key(-1),
   opacity(1.0),
   q_color(Qt::black),
   spot_color_method(MapColor::UndefinedMethod),
@@ -181,6 +184,23 @@ bool MapColor::equals(const MapColor& other, bool compare_priority) const
 	       (qAbs(opacity - other.opacity) < 1e-03);
 }
 
+uint MapColor::contentHash() const
+{
+	// Only members which are compared exactly in equals() are taken into account.
+	auto combine = [](uint hash, uint value) {
+		return hash ^ (value + 0x9e3779b9u + (hash << 6) + (hash >> 2));
+	};
+	
+	uint hash = qHash(name.toCaseFolded());
+	hash = combine(hash, qHash(int(spot_color_method)));
+	hash = combine(hash, qHash(int(cmyk_color_method)));
+	hash = combine(hash, qHash(int(rgb_color_method)));
+	hash = combine(hash, qHash(int(flags)));
+	if (spot_color_method == SpotColor)
+		hash = combine(hash, qHash(spot_color_name.toCaseFolded()));
+	return hash;
+}
+
 
 void MapColor::setSpotColorName(const QString& spot_color_name) 
 { 
@@ -236,9 +236,27 @@ public:
 	/** 
 	 * Sets the color's priority.
 	 * Normally you don't want to call this directly.
+	 * 
+	 * When a color with a valid priority is moved to another priority,
+	 * its render key keeps the former priority.
 	 */
 	void setPriority(int priority);
 	
+	/**
+	 * Returns the key which identifies this color in renderables.
+	 * 
+	 * The render key equals the priority until the priority is changed.
+	 * It does not change when colors are reordered, so that renderables
+	 * remain valid. Map::renderKeyToPriority() finds the current priority.
+	 */
+	int getRenderKey() const;
+	
+	/**
+	 * Sets the render key.
+	 * Normally you don't want to call this directly.
+	 */
+	void setRenderKey(int key);
+	
 	/** @deprecated Returns the color's opacity. */
 	float getOpacity() const;
 	
@@ -381,6 +399,10 @@ public:
 	/** Compares this color and another. */
 	bool equals(const MapColor& other, bool compare_priority) const;
 	
+	/** Returns a hash value which is the same for colors which are equal
+	 *  according to equals(), regardless of the priority. */
+	uint contentHash() const;
+	
 	/** Compares two colors given by pointers.
 	 *  Returns true if the colors are equal or if both pointers are NULL. */
 	static bool equal(const MapColor* color, const MapColor* other);
@@ -422,6 +444,7 @@ protected:
 	
 	QString name;
 	int priority;
+	int render_key;  ///< A stable key, or negative when equal to the priority
 	
 	MapColorCmyk cmyk;
 	MapColorRgb rgb;
@@ -708,9 +731,23 @@ int MapColor::getPriority() const
 inline
 void MapColor::setPriority(int priority)
 {
+	if (render_key < 0 && this->priority >= 0 && priority != this->priority)
+		render_key = this->priority;
 	this->priority = priority;
 }
 
+inline
+int MapColor::getRenderKey() const
+{
+	return (render_key >= 0) ? render_key : priority;
+}
+
+inline
+void MapColor::setRenderKey(int key)
+{
+	render_key = key;
+}
+
 inline
 float MapColor::getOpacity() const
 {
@@ -20,6 +20,8 @@
 
 #include "map_coord.h"
 
+#include <algorithm>
+#include <limits>
 #include <type_traits>
 
 #include <QLineF>
@@ -174,6 +176,48 @@ void ensureBoundsForQint32(qint64 x64, qint64 y64)
 	}
 }
 
+inline
+const QChar* skipSpace(const QChar* pos, const QChar* last)
+{
+	while (pos != last && pos->isSpace())
+		++pos;
+	return pos;
+}
+
+/**
+ * Parses a decimal integer with optional sign at pos.
+ * 
+ * Returns a pointer to the character after the integer,
+ * or nullptr if there is no integer or if it is too large.
+ */
+const QChar* parseInteger(const QChar* pos, const QChar* last, qint64& value)
+{
+	bool negative = false;
+	if (pos != last && (*pos == QLatin1Char('-') || *pos == QLatin1Char('+')))
+	{
+		negative = (*pos == QLatin1Char('-'));
+		++pos;
+	}
+	
+	constexpr qint64 max_value = (std::numeric_limits<qint64>::max() - 9) / 10;
+	const QChar* first_digit = pos;
+	qint64 result = 0;
+	for (; pos != last; ++pos)
+	{
+		auto digit = unsigned(pos->unicode()) - unsigned('0');
+		if (digit > 9)
+			break;
+		if (result > max_value)
+			return nullptr;
+		result = result * 10 + digit;
+	}
+	if (pos == first_digit)
+		return nullptr;
+	
+	value = negative ? -result : result;
+	return pos;
+}
+
 } // namespace
 
 
@@ -230,6 +274,13 @@ MapCoord MapCoord::load(QXmlStreamReader& xml)
 	return MapCoord { static_cast<qint32>(x64), static_cast<qint32>(y64), flags };
 }
 
+MapCoord MapCoord::load(qint64 x64, qint64 y64, int flags)
+{
+	handleBoundsOffset(x64, y64);
+	ensureBoundsForQint32(x64, y64);
+	return MapCoord { static_cast<qint32>(x64), static_cast<qint32>(y64), flags };
+}
+
 #ifndef NO_NATIVE_FILE_FORMAT
 	
 MapCoord::MapCoord(const LegacyMapCoord& coord)
@@ -242,7 +293,7 @@ MapCoord::MapCoord(const LegacyMapCoord& coord)
 
 #endif
 
-QString MapCoord::toString() const
+QChar* MapCoord::toString(QChar* out) const
 {
 	/* The buffer size must allow for
 	 *  1x ';':   1
@@ -254,6 +305,7 @@ QString MapCoord::toString() const
 	 *            3
 	 *  Total:   28 */
 	constexpr std::size_t buf_size = 1+2+2+20+3;
+	static_assert(buf_size == max_string_length, "max_string_length must match the buffer size");
 	static QChar encoded[10] = {
 	    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9'
 	};
@@ -331,7 +383,46 @@ QString MapCoord::toString() const
 	++j;
 	Q_ASSERT(j < buf_size);
 	j = qMin(j, buf_size);
-	return QString(buffer+j, buf_size-j);
+	return std::copy(buffer+j, buffer+buf_size, out);
+}
+
+QString MapCoord::toString() const
+{
+	QChar buffer[max_string_length];
+	return QString(buffer, toString(buffer) - buffer);
+}
+
+const QChar* MapCoord::parse(const QChar* first, const QChar* last, MapCoord& coord)
+{
+	qint64 x64, y64;
+	auto pos = parseInteger(skipSpace(first, last), last, x64);
+	if (!pos || pos == last || !pos->isSpace())
+		return nullptr;
+	
+	pos = parseInteger(skipSpace(pos, last), last, y64);
+	if (!pos || pos == last)
+		return nullptr;
+	
+	qint64 flags = 0;
+	if (pos->isSpace())
+	{
+		pos = parseInteger(skipSpace(pos, last), last, flags);
+		if (!pos || flags < 0 || flags > std::numeric_limits<int>::max())
+			return nullptr;
+		pos = skipSpace(pos, last);
+	}
+	
+	if (pos == last || *pos != QLatin1Char(';'))
+		return nullptr;
+	
+	handleBoundsOffset(x64, y64);
+	ensureBoundsForQint32(x64, y64);
+	
+	coord.xp = static_cast<qint32>(x64);
+	coord.yp = static_cast<qint32>(y64);
+	coord.setFlags(int(flags));
+	
+	return skipSpace(pos + 1, last);
 }
 
 
@@ -358,3 +449,28 @@ QTextStream& operator>>(QTextStream& stream, MapCoord& coord)
 	
 	return stream;
 }
+
+
+
+// ### MapCoordVector ###
+
+void MapCoordVector::detach(size_type min_capacity)
+{
+	Data* copy = new Data();
+	if (d)
+	{
+		copy->coords.reserve(std::max(min_capacity, d->coords.size()));
+		copy->coords.assign(d->coords.begin(), d->coords.end());
+	}
+	else
+	{
+		copy->coords.reserve(min_capacity);
+	}
+	d = copy;
+}
+
+const MapCoordVector::Storage& MapCoordVector::noCoords()
+{
+	static const Storage no_coords;
+	return no_coords;
+}
@@ -22,12 +22,18 @@
 #ifndef _OPENORIENTEERING_MAP_COORD_H_
 #define _OPENORIENTEERING_MAP_COORD_H_
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <QCoreApplication>
 #include <QFlags>
 #include <QPointF>
+#include <QSharedData>
 
 class QString;
 class QTextStream;
@@ -376,11 +382,43 @@ public:
 	constexpr explicit operator QPointF() const;
 	
 	
+	/**
+	 * The maximum number of characters written by toString().
+	 */
+	static constexpr std::size_t max_string_length = 28;
+	
 	/**
 	 * Writes raw coordinates and flags to a string.
 	 */
 	QString toString() const;
 	
+	/**
+	 * Writes raw coordinates and flags to the given buffer, in the format
+	 * of toString().
+	 * 
+	 * The buffer must have room for max_string_length characters.
+	 * 
+	 * @return A pointer to the character after the last written character.
+	 */
+	QChar* toString(QChar* buffer) const;
+	
+	/**
+	 * Reads raw coordinates and flags in the format of toString() from the
+	 * characters in the range [first, last).
+	 * 
+	 * This is the counterpart of toString() and of operator>>(), without
+	 * creating any stream object. Whitespace around the coordinate is skipped.
+	 * 
+	 * This will initialize the boundsOffset() if neccessary. Otherwise it will
+	 * apply the BoundsOffset() and throw a std::range_error if the adjusted
+	 * coordinates are out of bounds for qint32.
+	 * 
+	 * @return A pointer to the first character after the coordinate and the
+	 *         following whitespace, or nullptr if the characters do not
+	 *         start with a valid coordinate.
+	 */
+	static const QChar* parse(const QChar* first, const QChar* last, MapCoord& coord);
+	
 	
 	/** Saves the MapCoord in xml format to the stream. */
 	void save(QXmlStreamWriter& xml) const;
@@ -393,6 +431,15 @@ public:
 	 */
 	static MapCoord load(QXmlStreamReader& xml);
 	
+	/** Loads the MapCoord from native coordinates and flags.
+	 *
+	 * This is meant for binary file formats. Like load(QXmlStreamReader&),
+	 * it will initialize the boundsOffset() if neccessary. Otherwise it will
+	 * apply the BoundsOffset() and throw a std::range_error if the adjusted
+	 * coordinates are out of bounds for qint32.
+	 */
+	static MapCoord load(qint64 x64, qint64 y64, int flags);
+	
 	
 	friend constexpr bool operator==(const MapCoord& lhs, const MapCoord& rhs);
 	friend constexpr MapCoord operator+(const MapCoord& lhs, const MapCoord& rhs);
@@ -608,7 +655,164 @@ constexpr const MapCoordF operator/(const MapCoordF& lhs, qreal divisor);
 
 
 
-typedef std::vector<MapCoord> MapCoordVector;
+/**
+ * A vector of MapCoord, with implicit sharing.
+ * 
+ * MapCoordVector offers the interface of std::vector<MapCoord>. Copies share
+ * the coordinates until one of them is modified (copy-on-write). So copying
+ * the coordinates of an object, e.g. when the object is duplicated for an
+ * undo step or for an editing preview, takes constant time.
+ * 
+ * Any non-const access detaches the vector from its copies. As with Qt's
+ * implicitly shared containers, references and iterators obtained by
+ * non-const access must not be used for modifications after the vector was
+ * copied: The modifications would become visible in the copy, too.
+ * 
+ * A default-constructed vector does not allocate any memory.
+ */
+class MapCoordVector
+{
+public:
+	typedef std::vector<MapCoord> Storage;
+	
+	typedef Storage::value_type value_type;
+	typedef Storage::size_type size_type;
+	typedef Storage::difference_type difference_type;
+	typedef Storage::reference reference;
+	typedef Storage::const_reference const_reference;
+	typedef Storage::pointer pointer;
+	typedef Storage::const_pointer const_pointer;
+	typedef Storage::iterator iterator;
+	typedef Storage::const_iterator const_iterator;
+	typedef Storage::reverse_iterator reverse_iterator;
+	typedef Storage::const_reverse_iterator const_reverse_iterator;
+	
+	MapCoordVector();
+	explicit MapCoordVector(size_type count);
+	MapCoordVector(size_type count, const MapCoord& value);
+	template<class InputIt, class = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+	MapCoordVector(InputIt first, InputIt last);
+	MapCoordVector(std::initializer_list<MapCoord> init);
+	MapCoordVector(const Storage& coords);
+	MapCoordVector(Storage&& coords);
+	MapCoordVector(const MapCoordVector& other);
+	MapCoordVector(MapCoordVector&& other) noexcept;
+	~MapCoordVector();
+	
+	MapCoordVector& operator=(const MapCoordVector& other);
+	MapCoordVector& operator=(MapCoordVector&& other) noexcept;
+	MapCoordVector& operator=(std::initializer_list<MapCoord> init);
+	
+	void assign(size_type count, const MapCoord& value);
+	template<class InputIt, class = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+	void assign(InputIt first, InputIt last);
+	void assign(std::initializer_list<MapCoord> init);
+	
+	/** Returns true if this vector shares its coordinates with another one. */
+	bool isShared() const;
+	
+	
+	// Element access
+	
+	reference at(size_type pos);
+	const_reference at(size_type pos) const;
+	reference operator[](size_type pos);
+	const_reference operator[](size_type pos) const;
+	reference front();
+	const_reference front() const;
+	reference back();
+	const_reference back() const;
+	pointer data();
+	const_pointer data() const;
+	
+	
+	// Iterators
+	
+	iterator begin();
+	const_iterator begin() const;
+	const_iterator cbegin() const;
+	iterator end();
+	const_iterator end() const;
+	const_iterator cend() const;
+	reverse_iterator rbegin();
+	const_reverse_iterator rbegin() const;
+	const_reverse_iterator crbegin() const;
+	reverse_iterator rend();
+	const_reverse_iterator rend() const;
+	const_reverse_iterator crend() const;
+	
+	
+	// Capacity
+	
+	bool empty() const;
+	size_type size() const;
+	size_type max_size() const;
+	void reserve(size_type new_capacity);
+	size_type capacity() const;
+	void shrink_to_fit();
+	
+	
+	// Modifiers
+	
+	void clear();
+	iterator insert(const_iterator pos, const MapCoord& value);
+	iterator insert(const_iterator pos, MapCoord&& value);
+	iterator insert(const_iterator pos, size_type count, const MapCoord& value);
+	template<class InputIt, class = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+	iterator insert(const_iterator pos, InputIt first, InputIt last);
+	iterator insert(const_iterator pos, std::initializer_list<MapCoord> init);
+	template<class... Args>
+	iterator emplace(const_iterator pos, Args&&... args);
+	iterator erase(const_iterator pos);
+	iterator erase(const_iterator first, const_iterator last);
+	void push_back(const MapCoord& value);
+	void push_back(MapCoord&& value);
+	template<class... Args>
+	void emplace_back(Args&&... args);
+	void pop_back();
+	void resize(size_type count);
+	void resize(size_type count, const MapCoord& value);
+	void swap(MapCoordVector& other) noexcept;
+	
+private:
+	struct Data : public QSharedData
+	{
+		Storage coords;
+	};
+	
+	/** Returns the coordinates, for reading. */
+	const Storage& constStorage() const;
+	
+	/** Returns the coordinates, for modification. Detaches if needed. */
+	Storage& storage();
+	
+	/**
+	 * Replaces the shared or missing data with an unshared copy,
+	 * reserving at least min_capacity elements.
+	 */
+	void detach(size_type min_capacity);
+	
+	/**
+	 * Returns unshared coordinates for being assigned new content.
+	 * 
+	 * Unlike storage(), this does not copy shared coordinates. Unshared
+	 * coordinates are returned as they are.
+	 */
+	Storage& emptyStorage();
+	
+	/** Returns the position of a const_iterator which may point to shared data. */
+	difference_type offsetOf(const_iterator pos) const;
+	
+	static const Storage& noCoords();
+	
+	QExplicitlySharedDataPointer<Data> d;
+};
+
+bool operator==(const MapCoordVector& lhs, const MapCoordVector& rhs);
+bool operator!=(const MapCoordVector& lhs, const MapCoordVector& rhs);
+
+void swap(MapCoordVector& lhs, MapCoordVector& rhs) noexcept;
+
 typedef std::vector<MapCoordF> MapCoordVectorF;
 
 
@@ -1112,4 +1316,462 @@ constexpr const MapCoordF operator/(const MapCoordF& lhs, qreal divisor)
 
 
 
+// ### MapCoordVector inline and template code ###
+
+inline
+MapCoordVector::MapCoordVector()
+{
+	// nothing else
+}
+
+inline
+MapCoordVector::MapCoordVector(size_type count)
+{
+	if (count > 0)
+		emptyStorage().resize(count);
+}
+
+inline
+MapCoordVector::MapCoordVector(size_type count, const MapCoord& value)
+{
+	if (count > 0)
+		emptyStorage().assign(count, value);
+}
+
+template<class InputIt, class>
+MapCoordVector::MapCoordVector(InputIt first, InputIt last)
+{
+	if (first != last)
+		emptyStorage().assign(first, last);
+}
+
+inline
+MapCoordVector::MapCoordVector(std::initializer_list<MapCoord> init)
+{
+	if (init.size() > 0)
+		emptyStorage().assign(init.begin(), init.end());
+}
+
+inline
+MapCoordVector::MapCoordVector(const Storage& coords)
+{
+	if (!coords.empty())
+		emptyStorage() = coords;
+}
+
+inline
+MapCoordVector::MapCoordVector(Storage&& coords)
+{
+	if (!coords.empty())
+		emptyStorage() = std::move(coords);
+}
+
+inline
+MapCoordVector::MapCoordVector(const MapCoordVector& other)
+ : d(other.d)
+{
+	// nothing else
+}
+
+inline
+MapCoordVector::MapCoordVector(MapCoordVector&& other) noexcept
+{
+	d.swap(other.d);
+}
+
+inline
+MapCoordVector::~MapCoordVector()
+{
+	// nothing, not virtual
+}
+
+inline
+MapCoordVector& MapCoordVector::operator=(const MapCoordVector& other)
+{
+	d = other.d;
+	return *this;
+}
+
+inline
+MapCoordVector& MapCoordVector::operator=(MapCoordVector&& other) noexcept
+{
+	// Leaves other empty, like std::vector.
+	MapCoordVector moved(std::move(other));
+	d.swap(moved.d);
+	return *this;
+}
+
+inline
+MapCoordVector& MapCoordVector::operator=(std::initializer_list<MapCoord> init)
+{
+	assign(init);
+	return *this;
+}
+
+inline
+void MapCoordVector::assign(size_type count, const MapCoord& value)
+{
+	emptyStorage().assign(count, value);
+}
+
+template<class InputIt, class>
+void MapCoordVector::assign(InputIt first, InputIt last)
+{
+	// When the range is taken from shared coordinates, the other owner
+	// keeps them alive while they are copied.
+	emptyStorage().assign(first, last);
+}
+
+inline
+void MapCoordVector::assign(std::initializer_list<MapCoord> init)
+{
+	emptyStorage().assign(init.begin(), init.end());
+}
+
+inline
+bool MapCoordVector::isShared() const
+{
+	return d && d->ref.load() != 1;
+}
+
+inline
+MapCoordVector::reference MapCoordVector::at(size_type pos)
+{
+	return storage().at(pos);
+}
+
+inline
+MapCoordVector::const_reference MapCoordVector::at(size_type pos) const
+{
+	return constStorage().at(pos);
+}
+
+inline
+MapCoordVector::reference MapCoordVector::operator[](size_type pos)
+{
+	return storage()[pos];
+}
+
+inline
+MapCoordVector::const_reference MapCoordVector::operator[](size_type pos) const
+{
+	return constStorage()[pos];
+}
+
+inline
+MapCoordVector::reference MapCoordVector::front()
+{
+	return storage().front();
+}
+
+inline
+MapCoordVector::const_reference MapCoordVector::front() const
+{
+	return constStorage().front();
+}
+
+inline
+MapCoordVector::reference MapCoordVector::back()
+{
+	return storage().back();
+}
+
+inline
+MapCoordVector::const_reference MapCoordVector::back() const
+{
+	return constStorage().back();
+}
+
+inline
+MapCoordVector::pointer MapCoordVector::data()
+{
+	return storage().data();
+}
+
+inline
+MapCoordVector::const_pointer MapCoordVector::data() const
+{
+	return constStorage().data();
+}
+
+inline
+MapCoordVector::iterator MapCoordVector::begin()
+{
+	return storage().begin();
+}
+
+inline
+MapCoordVector::const_iterator MapCoordVector::begin() const
+{
+	return constStorage().begin();
+}
+
+inline
+MapCoordVector::const_iterator MapCoordVector::cbegin() const
+{
+	return constStorage().begin();
+}
+
+inline
+MapCoordVector::iterator MapCoordVector::end()
+{
+	return storage().end();
+}
+
+inline
+MapCoordVector::const_iterator MapCoordVector::end() const
+{
+	return constStorage().end();
+}
+
+inline
+MapCoordVector::const_iterator MapCoordVector::cend() const
+{
+	return constStorage().end();
+}
+
+inline
+MapCoordVector::reverse_iterator MapCoordVector::rbegin()
+{
+	return storage().rbegin();
+}
+
+inline
+MapCoordVector::const_reverse_iterator MapCoordVector::rbegin() const
+{
+	return constStorage().rbegin();
+}
+
+inline
+MapCoordVector::const_reverse_iterator MapCoordVector::crbegin() const
+{
+	return constStorage().rbegin();
+}
+
+inline
+MapCoordVector::reverse_iterator MapCoordVector::rend()
+{
+	return storage().rend();
+}
+
+inline
+MapCoordVector::const_reverse_iterator MapCoordVector::rend() const
+{
+	return constStorage().rend();
+}
+
+inline
+MapCoordVector::const_reverse_iterator MapCoordVector::crend() const
+{
+	return constStorage().rend();
+}
+
+inline
+bool MapCoordVector::empty() const
+{
+	return !d || d->coords.empty();
+}
+
+inline
+MapCoordVector::size_type MapCoordVector::size() const
+{
+	return d ? d->coords.size() : 0;
+}
+
+inline
+MapCoordVector::size_type MapCoordVector::max_size() const
+{
+	return constStorage().max_size();
+}
+
+inline
+void MapCoordVector::reserve(size_type new_capacity)
+{
+	if (isShared() || !d)
+		detach(new_capacity);
+	else
+		d->coords.reserve(new_capacity);
+}
+
+inline
+MapCoordVector::size_type MapCoordVector::capacity() const
+{
+	return d ? d->coords.capacity() : 0;
+}
+
+inline
+void MapCoordVector::shrink_to_fit()
+{
+	if (d && !isShared())
+		d->coords.shrink_to_fit();
+}
+
+inline
+void MapCoordVector::clear()
+{
+	// Unshared coordinates keep their capacity, like std::vector.
+	if (isShared())
+		d.reset();
+	else if (d)
+		d->coords.clear();
+}
+
+inline
+MapCoordVector::iterator MapCoordVector::insert(const_iterator pos, const MapCoord& value)
+{
+	const auto offset = offsetOf(pos);
+	Storage& coords = storage();
+	return coords.insert(coords.begin() + offset, value);
+}
+
+inline
+MapCoordVector::iterator MapCoordVector::insert(const_iterator pos, MapCoord&& value)
+{
+	const auto offset = offsetOf(pos);
+	Storage& coords = storage();
+	return coords.insert(coords.begin() + offset, std::move(value));
+}
+
+inline
+MapCoordVector::iterator MapCoordVector::insert(const_iterator pos, size_type count, const MapCoord& value)
+{
+	const auto offset = offsetOf(pos);
+	Storage& coords = storage();
+	coords.insert(coords.begin() + offset, count, value);
+	return coords.begin() + offset;
+}
+
+template<class InputIt, class>
+MapCoordVector::iterator MapCoordVector::insert(const_iterator pos, InputIt first, InputIt last)
+{
+	const auto offset = offsetOf(pos);
+	Storage& coords = storage();
+	coords.insert(coords.begin() + offset, first, last);
+	return coords.begin() + offset;
+}
+
+inline
+MapCoordVector::iterator MapCoordVector::insert(const_iterator pos, std::initializer_list<MapCoord> init)
+{
+	return insert(pos, init.begin(), init.end());
+}
+
+template<class... Args>
+MapCoordVector::iterator MapCoordVector::emplace(const_iterator pos, Args&&... args)
+{
+	const auto offset = offsetOf(pos);
+	Storage& coords = storage();
+	return coords.emplace(coords.begin() + offset, std::forward<Args>(args)...);
+}
+
+inline
+MapCoordVector::iterator MapCoordVector::erase(const_iterator pos)
+{
+	const auto offset = offsetOf(pos);
+	Storage& coords = storage();
+	return coords.erase(coords.begin() + offset);
+}
+
+inline
+MapCoordVector::iterator MapCoordVector::erase(const_iterator first, const_iterator last)
+{
+	const auto offset = offsetOf(first);
+	const auto count = last - first;
+	Storage& coords = storage();
+	return coords.erase(coords.begin() + offset, coords.begin() + offset + count);
+}
+
+inline
+void MapCoordVector::push_back(const MapCoord& value)
+{
+	storage().push_back(value);
+}
+
+inline
+void MapCoordVector::push_back(MapCoord&& value)
+{
+	storage().push_back(std::move(value));
+}
+
+template<class... Args>
+void MapCoordVector::emplace_back(Args&&... args)
+{
+	storage().emplace_back(std::forward<Args>(args)...);
+}
+
+inline
+void MapCoordVector::pop_back()
+{
+	storage().pop_back();
+}
+
+inline
+void MapCoordVector::resize(size_type count)
+{
+	if (count != size())
+		storage().resize(count);
+}
+
+inline
+void MapCoordVector::resize(size_type count, const MapCoord& value)
+{
+	if (count != size())
+		storage().resize(count, value);
+}
+
+inline
+void MapCoordVector::swap(MapCoordVector& other) noexcept
+{
+	d.swap(other.d);
+}
+
+inline
+const MapCoordVector::Storage& MapCoordVector::constStorage() const
+{
+	return d ? d->coords : noCoords();
+}
+
+inline
+MapCoordVector::Storage& MapCoordVector::storage()
+{
+	if (Q_UNLIKELY(!d || d->ref.load() != 1))
+		detach(0);
+	return d->coords;
+}
+
+inline
+MapCoordVector::Storage& MapCoordVector::emptyStorage()
+{
+	if (!d || d->ref.load() != 1)
+		d = new Data();
+	return d->coords;
+}
+
+inline
+MapCoordVector::difference_type MapCoordVector::offsetOf(const_iterator pos) const
+{
+	return pos - constStorage().begin();
+}
+
+inline
+bool operator==(const MapCoordVector& lhs, const MapCoordVector& rhs)
+{
+	return lhs.size() == rhs.size()
+	       && (lhs.data() == rhs.data() || std::equal(lhs.begin(), lhs.end(), rhs.begin()));
+}
+
+inline
+bool operator!=(const MapCoordVector& lhs, const MapCoordVector& rhs)
+{
+	return !(lhs == rhs);
+}
+
+inline
+void swap(MapCoordVector& lhs, MapCoordVector& rhs) noexcept
+{
+	lhs.swap(rhs);
+}
+
+
+
 #endif
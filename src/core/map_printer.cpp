@@ -24,9 +24,15 @@
 #include <limits>
 
 #include <QDebug>
+#include <QMutexLocker>
 #include <QPaintEngine>
 #include <QPainter>
+#include <QPicture>
+#include <QRunnable>
 #include <QScopedValueRollback>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
 #include <QXmlStreamAttributes>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
@@ -39,8 +45,11 @@
 #  endif
 #endif
 
+#include "../core/color_transform.h"
 #include "../core/map_color.h"
 #include "../core/map_view.h"
+#include "../core/task_pool.h"
+#include "../core/tracing.h"
 #include "../map.h"
 #include "../renderable.h"
 #include "../settings.h"
@@ -396,10 +405,25 @@ MapPrinter::MapPrinter(Map& map, const MapView* view, QObject* parent)
   MapPrinterConfig(map.printerConfig()),
   map(map),
   view(view),
-  target(nullptr)
+  target(nullptr),
+  print_part(nullptr),
+  recorded_units_per_inch(0)
 {
 	scale_adjustment = map.getScaleDenominator() / (qreal) options.scale;
 	updatePaperDimensions();
+	
+	// Recorded preview pages become invalid when the output changes.
+	connect(&map, &Map::objectAreaChanged, this, &MapPrinter::discardRecordedPages);
+	connect(&map, &Map::colorAdded, this, &MapPrinter::discardRecordedPages);
+	connect(&map, &Map::colorChanged, this, &MapPrinter::discardRecordedPages);
+	connect(&map, &Map::colorDeleted, this, &MapPrinter::discardRecordedPages);
+	connect(&map, &Map::templateAdded, this, &MapPrinter::discardRecordedPages);
+	connect(&map, &Map::templateChanged, this, &MapPrinter::discardRecordedPages);
+	connect(&map, &Map::templateDeleted, this, &MapPrinter::discardRecordedPages);
+	connect(this, &MapPrinter::targetChanged, this, &MapPrinter::discardRecordedPages);
+	connect(this, &MapPrinter::printAreaChanged, this, &MapPrinter::discardRecordedPages);
+	connect(this, &MapPrinter::pageFormatChanged, this, &MapPrinter::discardRecordedPages);
+	connect(this, &MapPrinter::optionsChanged, this, &MapPrinter::discardRecordedPages);
 }
 
 MapPrinter::~MapPrinter()
@@ -446,6 +470,18 @@ void MapPrinter::setTarget(const QPrinterInfo* new_target)
 	}
 }
 
+std::unique_ptr<ColorTransform> MapPrinter::makeCmykTransform() const
+{
+	std::unique_ptr<ColorTransform> transform;
+	if (options.color_mode == MapPrinterOptions::DeviceCmyk)
+	{
+		transform.reset(new ColorTransform());
+		for (int i = 0; i < map.getNumColors(); ++i)
+			transform->addColor(map.getColor(i));
+	}
+	return transform;
+}
+
 std::unique_ptr<QPrinter> MapPrinter::makePrinter() const
 {
 	std::unique_ptr<QPrinter> printer;
@@ -816,6 +852,8 @@ void drawBuffer(QPainter* device_painter, const QImage* page_buffer, qreal pixel
 
 void MapPrinter::drawPage(QPainter* device_painter, float units_per_inch, const QRectF& page_extent, bool white_background, QImage* page_buffer) const
 {
+	MAPPER_TRACE_SCOPE("print", "MapPrinter::drawPage");
+	
 	device_painter->save();
 	
 	device_painter->setRenderHint(QPainter::Antialiasing);
@@ -956,6 +994,7 @@ void MapPrinter::drawPage(QPainter* device_painter, float units_per_inch, const
 	 */
 	if (options.show_templates)
 	{
+		QMutexLocker locker(&template_mutex);
 		map.drawTemplates(painter, page_region_used, 0, map.getFirstFrontTemplate() - 1, view, false);
 		if (vectorModeSelected() && use_buffer_for_foreground)
 		{
@@ -1004,9 +1043,10 @@ void MapPrinter::drawPage(QPainter* device_painter, float units_per_inch, const
 			map_painter->setTransform(painter->transform());
 		}
 		
-		RenderConfig config = { map, page_region_used, scale, RenderConfig::NoOptions, 1.0 };
+		const auto hatching_option = map.isAreaHatchingEnabled() ? RenderConfig::HatchedAreas : RenderConfig::NoOptions;
+		RenderConfig config = { map, page_region_used, scale, hatching_option, 1.0 };
 		
-		if (rasterModeSelected() && options.simulate_overprinting)
+		if (rasterModeSelected() && options.simulate_overprinting && !print_part)
 		{
 			map.drawOverprintingSimulation(map_painter, config);
 		}
@@ -1015,7 +1055,10 @@ void MapPrinter::drawPage(QPainter* device_painter, float units_per_inch, const
 			if (vectorModeSelected() && view)
 				config.opacity = view->effectiveMapVisibility()->opacity;
 		
-			map.draw(map_painter, config);
+			if (print_part)
+				map.drawPart(map_painter, config, print_part);
+			else
+				map.draw(map_painter, config);
 		}
 			
 		if (map_painter != painter)
@@ -1046,6 +1089,7 @@ void MapPrinter::drawPage(QPainter* device_painter, float units_per_inch, const
 	 */
 	if (options.show_templates)
 	{
+		QMutexLocker locker(&template_mutex);
 		if (vectorModeSelected() && use_buffer_for_foreground)
 		{
 			for (int i = map.getFirstFrontTemplate(); i < map.getNumTemplates(); ++i)
@@ -1105,23 +1149,17 @@ void MapPrinter::drawSeparationPages(QPrinter* printer, QPainter* device_painter
 	device_painter->translate(-page_extent.left(), -page_extent.top());
 	device_painter->setClipRect(page_extent.intersected(print_area), Qt::ReplaceClip);
 	
-	bool need_new_page = false;
+	std::vector<const MapColor*> spot_colors;
 	for (int i = map.getNumColors() - 1; i >= 0; --i)
 	{
 		const MapColor* color = map.getColor(i);
 		if (color->getSpotColorMethod() == MapColor::SpotColor)
-		{
-			if (need_new_page)
-			{
-				printer->newPage();
-			}
-			
-			RenderConfig config = { map, page_extent, scale, RenderConfig::NoOptions, 1.0 };
-			map.drawColorSeparation(device_painter, config, color);
-			need_new_page = true;
-		}
+			spot_colors.push_back(color);
 	}
 	
+	RenderConfig config = { map, page_extent, scale, RenderConfig::NoOptions, 1.0 };
+	map.drawColorSeparations(device_painter, config, spot_colors, [printer]() { printer->newPage(); });
+	
 	device_painter->restore();
 }
 
@@ -1132,6 +1170,10 @@ bool MapPrinter::printMap(QPrinter* printer)
 	printer->setFullPage(true);
 	takePrinterSettings(printer);
 	
+	// Templates may be loaded on demand only.
+	if (options.show_templates && view)
+		map.loadVisibleTemplates(*view);
+	
 	QSizeF extent_size = page_format.page_rect.size() / scale_adjustment;
 	QPainter painter(printer);
 	
@@ -1199,55 +1241,196 @@ bool MapPrinter::printMap(QPrinter* printer)
 	auto message = message_template.arg(1);
 	emit printProgress(0, message);
 	
-	bool need_new_page = false;
-	for (auto vpos : v_page_pos)
+	// The pages of the print preview are retained for replaying.
+	const bool record_pages = painter.paintEngine()->type() == QPaintEngine::Picture
+	                          && !separationsModeSelected();
+	
+	const int max_concurrent_pages = concurrentPageCount();
+	if (max_concurrent_pages > 1 && !record_pages)
 	{
-		if (!painter.isActive())
-		{
-			break;
-		}
-		
-		for (auto hpos : h_page_pos)
+		printPagesConcurrently(printer, &painter, resolution, max_concurrent_pages, message_template);
+	}
+	else
+	{
+		bool need_new_page = false;
+		for (auto vpos : v_page_pos)
 		{
 			if (!painter.isActive())
 			{
 				break;
 			}
 			
+			for (auto hpos : h_page_pos)
+			{
+				if (!painter.isActive())
+				{
+					break;
+				}
+				
+				++step;
+				int progress = qMin(99, qMax(1, (100*step-50)/num_steps));
+				emit printProgress(progress, message_template.arg(step));
+				
+				if (cancel_print_map) /* during printProgress handling */
+				{
+					painter.end();
+					break;
+				}
+					
+				if (need_new_page)
+				{
+					printer->newPage();
+				}
+				
+				QRectF page_extent = QRectF(QPointF(hpos, vpos), extent_size);
+				if (separationsModeSelected())
+				{
+					drawSeparationPages(printer, &painter, resolution, page_extent);
+				}
+				else if (record_pages)
+				{
+					drawRecordedPage(&painter, resolution, page_extent, step - 1);
+				}
+				else
+				{
+					drawPage(&painter, resolution, page_extent, false);
+				}
+				
+				need_new_page = true;
+			}
+		}
+	}
+	
+	if (cancel_print_map)
+	{
+		emit printProgress(100, tr("Canceled"));
+	}
+	else if (!painter.isActive())
+	{
+		emit printProgress(100, tr("Error"));
+		return false;
+	}
+	else
+	{
+		emit printProgress(100, tr("Finished"));
+	}
+	return true;
+}
+
+bool MapPrinter::printVariants(const MapPart* base_part, const std::vector<Variant>& variants)
+{
+	if (variants.empty() || separationsModeSelected())
+		return false;
+	
+	for (const auto& variant : variants)
+		variant.second->setFullPage(true);
+	takePrinterSettings(variants.front().second);
+	
+	if (options.show_templates && view)
+		map.loadVisibleTemplates(*view);
+	
+	std::vector<std::unique_ptr<QPainter>> painters;
+	painters.reserve(variants.size());
+	for (const auto& variant : variants)
+	{
+		painters.emplace_back(new QPainter(variant.second));
+		if (!painters.back()->isActive())
+		{
+			emit printProgress(100, tr("Error"));
+			return false;
+		}
+	}
+	
+	const QSizeF extent_size = page_format.page_rect.size() / scale_adjustment;
+	const float resolution = (float)options.resolution;
+	// A raster base layer uses one pixel per device unit.
+	const bool raster_base = !vectorModeSelected();
+	
+	cancel_print_map = false;
+	bool ok = true;
+	int step = 0;
+	int num_steps = v_page_pos.size() * h_page_pos.size();
+	emit printProgress(0, tr("Processing page %1...").arg(1));
+	
+	bool need_new_page = false;
+	for (auto vpos : v_page_pos)
+	{
+		for (auto hpos : h_page_pos)
+		{
+			if (!ok || cancel_print_map)
+				break;
+			
 			++step;
 			int progress = qMin(99, qMax(1, (100*step-50)/num_steps));
-			emit printProgress(progress, message_template.arg(step));
-			
+			emit printProgress(progress, tr("Processing page %1...").arg(step));
 			if (cancel_print_map) /* during printProgress handling */
-			{
-				painter.end();
 				break;
-			}
-				
+			
 			if (need_new_page)
 			{
-				printer->newPage();
+				for (const auto& variant : variants)
+					variant.second->newPage();
 			}
+			need_new_page = true;
 			
+			// Draw the shared base layer once
 			QRectF page_extent = QRectF(QPointF(hpos, vpos), extent_size);
-			if (separationsModeSelected())
+			QImage base_image;
+			QPicture base_picture;
 			{
-				drawSeparationPages(printer, &painter, resolution, page_extent);
+				QScopedValueRollback<const MapPart*> part_rollback(print_part, base_part);
+				if (raster_base)
+				{
+					int w = qCeil(page_format.paper_dimensions.width() * resolution / 25.4);
+					int h = qCeil(page_format.paper_dimensions.height() * resolution / 25.4);
+					base_image = QImage(w, h, QImage::Format_RGB32);
+					if (base_image.isNull())
+					{
+						ok = false;
+						break;
+					}
+					QPainter base_painter(&base_image);
+					drawPage(&base_painter, resolution, page_extent, true, &base_image);
+					ok = base_painter.isActive();
+				}
+				else
+				{
+					QPainter base_painter(&base_picture);
+					drawPage(&base_painter, resolution, page_extent, false);
+					ok = base_painter.isActive();
+				}
 			}
-			else
+			
+			// Compose each variant from the base layer and its part
+			for (std::size_t i = 0; ok && i < variants.size(); ++i)
 			{
-				drawPage(&painter, resolution, page_extent, false);
+				QPainter* painter = painters[i].get();
+				if (raster_base)
+				{
+					QImage page_image = base_image;
+					QPainter page_painter(&page_image);
+					drawPartOverlay(&page_painter, resolution, page_extent, variants[i].first);
+					page_painter.end();
+					drawBuffer(painter, &page_image, 1.0);
+				}
+				else
+				{
+					painter->drawPicture(0, 0, base_picture);
+					drawPartOverlay(painter, resolution, page_extent, variants[i].first);
+				}
+				ok = painter->isActive();
 			}
-			
-			need_new_page = true;
 		}
 	}
 	
+	for (auto& painter : painters)
+		ok = painter->end() && ok;
+	
 	if (cancel_print_map)
 	{
 		emit printProgress(100, tr("Canceled"));
 	}
-	else if (!painter.isActive())
+	else if (!ok)
 	{
 		emit printProgress(100, tr("Error"));
 		return false;
@@ -1259,6 +1442,204 @@ bool MapPrinter::printMap(QPrinter* printer)
 	return true;
 }
 
+void MapPrinter::drawRecordedPage(QPainter* device_painter, float units_per_inch, const QRectF& page_extent, std::size_t index)
+{
+	if (units_per_inch != recorded_units_per_inch)
+	{
+		discardRecordedPages();
+		recorded_units_per_inch = units_per_inch;
+	}
+	if (recorded_pages.size() <= index)
+		recorded_pages.resize(index + 1);
+	
+	QPicture& page = recorded_pages[index];
+	if (page.isNull())
+	{
+		QPainter recorder(&page);
+		drawPage(&recorder, units_per_inch, page_extent, false);
+		if (!recorder.isActive())
+		{
+			page = QPicture();
+			device_painter->end(); // Signal error
+			return;
+		}
+	}
+	device_painter->drawPicture(0, 0, page);
+}
+
+void MapPrinter::drawPartOverlay(QPainter* device_painter, float units_per_inch, const QRectF& page_extent, const MapPart* part) const
+{
+	device_painter->save();
+	device_painter->setRenderHint(QPainter::Antialiasing);
+	
+	// The same transformation and clipping as in drawPage()
+	qreal scale = units_per_inch / 25.4;
+	device_painter->scale(scale, scale);
+	device_painter->translate(page_format.page_rect.left(), page_format.page_rect.top());
+	if (scale_adjustment != 1.0)
+	{
+		scale *= scale_adjustment;
+		device_painter->scale(scale_adjustment, scale_adjustment);
+	}
+	device_painter->translate(-page_extent.left(), -page_extent.top());
+	
+	QRectF page_region_used(page_extent.intersected(print_area));
+	device_painter->setClipRect(page_region_used, Qt::ReplaceClip);
+	
+	if (!view || view->effectiveMapVisibility()->visible)
+	{
+		const auto hatching_option = map.isAreaHatchingEnabled() ? RenderConfig::HatchedAreas : RenderConfig::NoOptions;
+		RenderConfig config = { map, page_region_used, scale, hatching_option, 1.0 };
+		if (view)
+			config.opacity = view->effectiveMapVisibility()->opacity;
+		map.drawPart(device_painter, config, part);
+	}
+	
+	device_painter->restore();
+}
+
+namespace
+{
+	/**
+	 * A page which is rendered to a raster buffer by a worker thread.
+	 */
+	struct PageRenderJob
+	{
+		QRectF page_extent;
+		QImage image;
+		bool ok;
+		QSemaphore done;
+		
+		PageRenderJob(const QRectF& page_extent) : page_extent(page_extent), ok(false) {}
+	};
+	
+	/**
+	 * A runnable which renders a single page for MapPrinter::printPagesConcurrently().
+	 */
+	class PageRenderRunner : public QRunnable
+	{
+	public:
+		PageRenderRunner(const MapPrinter& printer, PageRenderJob& job, const QSize& size, float resolution)
+		 : printer(printer)
+		 , job(job)
+		 , size(size)
+		 , resolution(resolution)
+		{
+			; // nothing
+		}
+		
+		void run() override
+		{
+			job.image = QImage(size, QImage::Format_RGB32);
+			if (!job.image.isNull())
+			{
+				QPainter painter(&job.image);
+				printer.drawPage(&painter, resolution, job.page_extent, true, &job.image);
+				job.ok = painter.isActive();
+			}
+			job.done.release();
+		}
+		
+	private:
+		const MapPrinter& printer;
+		PageRenderJob& job;
+		const QSize size;
+		const float resolution;
+	};
+	
+}  // namespace
+
+int MapPrinter::concurrentPageCount() const
+{
+	if (separationsModeSelected() || !(rasterModeSelected() || target == imageTarget()))
+		return 1;
+	
+	auto num_pages = int(v_page_pos.size() * h_page_pos.size());
+	if (num_pages < 2)
+		return 1;
+	
+	// Each page needs a page buffer and a map buffer of 4 bytes per pixel.
+	const qreal pixel_per_mm = options.resolution / 25.4;
+	const qreal bytes_per_page = qreal(8) * qCeil(page_format.paper_dimensions.width() * pixel_per_mm)
+	                               * qCeil(page_format.paper_dimensions.height() * pixel_per_mm);
+	const qreal max_bytes = qreal(1) * 1024 * 1024 * 1024;
+	const auto max_pages = bytes_per_page > 0 ? int(qMin(qreal(num_pages), max_bytes / bytes_per_page)) : 1;
+	
+	return qMin(max_pages, TaskPool::maxThreads());
+}
+
+void MapPrinter::printPagesConcurrently(QPrinter* printer, QPainter* device_painter, float units_per_inch, int max_pages, const QString& message_template)
+{
+	Q_ASSERT(max_pages > 1);
+	
+	// Bring the renderables up to date now. While the workers are running,
+	// the map's objects are only read.
+	map.updateObjects();
+	
+	const QSizeF extent_size = page_format.page_rect.size() / scale_adjustment;
+	std::vector<std::unique_ptr<PageRenderJob>> jobs;
+	jobs.reserve(v_page_pos.size() * h_page_pos.size());
+	for (auto vpos : v_page_pos)
+	{
+		for (auto hpos : h_page_pos)
+			jobs.emplace_back(new PageRenderJob(QRectF(QPointF(hpos, vpos), extent_size)));
+	}
+	
+	const qreal pixel_per_mm = options.resolution / 25.4;
+	const QSize buffer_size(qCeil(page_format.paper_dimensions.width() * pixel_per_mm),
+	                        qCeil(page_format.paper_dimensions.height() * pixel_per_mm));
+	const qreal pixel2units = units_per_inch / options.resolution;
+	
+	QThreadPool thread_pool;
+	thread_pool.setMaxThreadCount(max_pages);
+	
+	const int num_steps = int(jobs.size());
+	int next_job = 0;
+	for (int step = 1; step <= num_steps; ++step)
+	{
+		// Keep at most max_pages buffers in progress or waiting for the printer.
+		for (; next_job < num_steps && next_job < step - 1 + max_pages; ++next_job)
+			thread_pool.start(new PageRenderRunner(*this, *jobs[next_job], buffer_size, options.resolution));
+		
+		int progress = qMin(99, qMax(1, (100*step-50)/num_steps));
+		emit printProgress(progress, message_template.arg(step));
+		
+		if (cancel_print_map) /* during printProgress handling */
+		{
+			device_painter->end();
+			break;
+		}
+		
+		auto& job = *jobs[step - 1];
+		job.done.acquire();
+		if (!job.ok)
+		{
+			device_painter->end(); // Signal error
+			break;
+		}
+		
+		if (step > 1)
+		{
+			printer->newPage();
+		}
+		
+		device_painter->save();
+		device_painter->resetTransform();
+		drawBuffer(device_painter, &job.image, pixel2units);
+		device_painter->restore();
+		job.image = QImage();
+	}
+	
+	// Discard pending jobs, and wait for the running ones.
+	thread_pool.clear();
+	thread_pool.waitForDone();
+}
+
+void MapPrinter::discardRecordedPages()
+{
+	recorded_pages.clear();
+}
+
 void MapPrinter::cancelPrintMap()
 {
 	cancel_print_map = true;
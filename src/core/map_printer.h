@@ -26,7 +26,9 @@
 #include <vector>
 
 #include <QHash>
+#include <QMutex>
 #include <QObject>
+#include <QPicture>
 #include <QRectF>
 #include <QSizeF>
 
@@ -40,7 +42,9 @@ class QXmlStreamReader;
 class QXmlStreamWriter;
 QT_END_NAMESPACE
 
+class ColorTransform;
 class Map;
+class MapPart;
 class MapView;
 
 /** The MapPrinterPageFormat is a complete description of page properties. */
@@ -108,12 +112,13 @@ public:
 	
 	/** Color modes.
 	 * 
-	 * At the moment, only PDF supports a different mode than the default.
+	 * At the moment, only PDF and TIFF export support a different mode than
+	 * the default.
 	 */
 	enum ColorMode
 	{
 		DefaultColorMode,  ///< Use the target engine's default color mode.
-		DeviceCmyk         ///< Use device-dependent CMYK for vector data.
+		DeviceCmyk         ///< Use device-dependent CMYK for vector data and TIFF images.
 	};
 
 	/** Constructs new printer options.
@@ -257,6 +262,13 @@ public:
 	/** Creates a printer configured according to the current settings. */
 	std::unique_ptr<QPrinter> makePrinter() const;
 	
+	/**
+	 * Creates a transform for CMYK raster images of the map's colors.
+	 * 
+	 * Returns nullptr unless the color mode is MapPrinterOptions::DeviceCmyk.
+	 */
+	std::unique_ptr<ColorTransform> makeCmykTransform() const;
+	
 	/** Takes the settings from the given printer, 
 	 *  and generates signals for changing properties. */
 	void takePrinterSettings(const QPrinter* printer);
@@ -268,6 +280,21 @@ public:
 	 *  @return true on success, false on error. */
 	bool printMap(QPrinter* printer);
 	
+	/** A map part and the printer which receives the part's variant of the map. */
+	typedef std::pair<const MapPart*, QPrinter*> Variant;
+	
+	/** Prints variants of the map, e.g. one document per course.
+	 * 
+	 *  Each printer receives the objects of the base part, and the objects of
+	 *  the variant's part on top of them. The base part, the templates and the
+	 *  grid are drawn only once per page: In vector mode, they are recorded as
+	 *  a QPicture. Otherwise, they are rendered to an image. The pages of all
+	 *  variants are printed in parallel. The overprinting simulation and the
+	 *  separations mode are not supported.
+	 * 
+	 *  @return true on success, false on error. */
+	bool printVariants(const MapPart* base_part, const std::vector<Variant>& variants);
+	
 	/** Draws a single page to the painter.
 	 * 
 	 *  In case of an error, the painter will be inactive when returning from
@@ -341,6 +368,10 @@ public slots:
 	 *  This can only be used during handlers of the printMapProgress() signal. */
 	void cancelPrintMap();
 	
+	/** Discards the pages which were recorded for the print preview.
+	 *  This is called automatically when the map or the print parameters change. */
+	void discardRecordedPages();
+	
 signals:
 	/** Indicates a new target printer. */
 	void targetChanged(const QPrinterInfo* target) const;
@@ -379,6 +410,30 @@ protected:
 	/** Updates the page breaks from map area and page format. */
 	void updatePageBreaks();
 	
+	/** Returns the number of pages which printMap() may render at the same time.
+	 * 
+	 *  Only pages which are drawn to a raster buffer anyway can be rendered
+	 *  by other threads. The result is limited by the number of CPU cores and
+	 *  by the memory needed for the page buffers. A value less than 2 means
+	 *  that the pages must be printed one after the other. */
+	int concurrentPageCount() const;
+	
+	/** Renders the pages to raster buffers in a thread pool, and sends them
+	 *  to the printer in regular order. Each pass through the loop emits
+	 *  printProgress() like the sequential printing. */
+	void printPagesConcurrently(QPrinter* printer, QPainter* device_painter, float units_per_inch, int max_pages, const QString& message_template);
+	
+	/** Draws a page of the print preview.
+	 * 
+	 *  The page is drawn by drawPage() to a QPicture which is retained for the
+	 *  next preview, and the picture is drawn to the device_painter. Pages are
+	 *  identified by their index. */
+	void drawRecordedPage(QPainter* device_painter, float units_per_inch, const QRectF& page_extent, std::size_t index);
+	
+	/** Draws the objects of the given part on top of a page which was drawn
+	 *  by drawPage() before. */
+	void drawPartOverlay(QPainter* device_painter, float units_per_inch, const QRectF& page_extent, const MapPart* part) const;
+	
 	Map& map;
 	const MapView* view;
 	const QPrinterInfo* target;
@@ -387,6 +442,16 @@ protected:
 	std::vector<qreal> h_page_pos;
 	std::vector<qreal> v_page_pos;
 	bool cancel_print_map;
+	
+	/** If not null, drawPage() draws only the objects of this part. */
+	const MapPart* print_part;
+	
+	/** The pages recorded by drawRecordedPage(). */
+	std::vector<QPicture> recorded_pages;
+	float recorded_units_per_inch;
+	
+	/** Serializes the drawing of templates which may update internal caches. */
+	mutable QMutex template_mutex;
 };
 
 #endif
@@ -0,0 +1,209 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "map_thumbnail_cache.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QEvent>
+#include <QFileInfo>
+#include <QPainter>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <mapper_config.h>
+
+#include "../map.h"
+#include "../renderable.h"
+
+
+// ### MapThumbnailCache::JobFinishedEvent ###
+
+class MapThumbnailCache::JobFinishedEvent : public QEvent
+{
+public:
+	JobFinishedEvent(const QString& path, const QString& key, const QImage& image)
+	 : QEvent(type())
+	 , path(path)
+	 , key(key)
+	 , image(image)
+	{
+		; // nothing
+	}
+
+	static QEvent::Type type()
+	{
+		static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+		return type;
+	}
+
+	const QString path;
+	const QString key;
+	const QImage image;
+};
+
+
+
+// ### MapThumbnailCache::Job ###
+
+/**
+ * Loads a stored thumbnail, or renders and stores a new one.
+ *
+ * The result is posted to the cache. The cache waits for running jobs
+ * when it is destroyed, so the job never outlives it.
+ */
+class MapThumbnailCache::Job : public QRunnable
+{
+public:
+	Job(MapThumbnailCache* cache, const QString& path, const QString& key)
+	 : cache(cache)
+	 , path(path)
+	 , key(key)
+	 , size(cache->size)
+	 , entry_path(cache->cache_dir.isEmpty() ? QString() : cache->cache_dir + QLatin1Char('/') + key + QLatin1String(".png"))
+	{
+		; // nothing
+	}
+
+	void run() override
+	{
+		QImage image;
+		if (!entry_path.isEmpty())
+			image.load(entry_path, "PNG");
+		if (image.width() != size || image.height() != size)
+		{
+			image = renderThumbnail(path, size);
+			if (!image.isNull() && !entry_path.isEmpty() && QDir().mkpath(QFileInfo(entry_path).absolutePath()))
+			{
+				QSaveFile file(entry_path);
+				if (file.open(QIODevice::WriteOnly) && image.save(&file, "PNG"))
+					file.commit();
+			}
+		}
+		QCoreApplication::postEvent(cache, new JobFinishedEvent(path, key, image));
+	}
+
+private:
+	MapThumbnailCache* const cache;
+	const QString path;
+	const QString key;
+	const int size;
+	const QString entry_path;
+};
+
+
+
+// ### MapThumbnailCache ###
+
+MapThumbnailCache::MapThumbnailCache(int size, QObject* parent)
+ : QObject(parent)
+ , size(size)
+{
+	const QString location = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+	if (!location.isEmpty())
+		cache_dir = location + QLatin1String("/map-thumbnails");
+
+	thread_pool.setMaxThreadCount(1);
+}
+
+MapThumbnailCache::~MapThumbnailCache()
+{
+	thread_pool.clear();
+	thread_pool.waitForDone();
+}
+
+QString MapThumbnailCache::entryKey(const QString& path) const
+{
+	const QFileInfo file_info(path);
+	const QString canonical_path = file_info.canonicalFilePath();
+	if (canonical_path.isEmpty())
+		return QString();
+
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(QByteArray(APP_VERSION));
+	hash.addData(canonical_path.toUtf8());
+	hash.addData(QByteArray::number(file_info.size()));
+	hash.addData(QByteArray::number(file_info.lastModified().toMSecsSinceEpoch()));
+	hash.addData(QByteArray::number(size));
+	return QString::fromLatin1(hash.result().toHex());
+}
+
+QImage MapThumbnailCache::thumbnail(const QString& path)
+{
+	const QString key = entryKey(path);
+	if (key.isEmpty())
+		return QImage();
+
+	auto found = thumbnails.constFind(key);
+	if (found != thumbnails.constEnd())
+		return *found;
+
+	if (!pending.contains(key))
+	{
+		pending.insert(key);
+		thread_pool.start(new Job(this, path, key));
+	}
+	return QImage();
+}
+
+QImage MapThumbnailCache::renderThumbnail(const QString& path, int size)
+{
+	Map map;
+	if (size <= 0 || !map.loadFrom(path, nullptr, nullptr, false, false))
+		return QImage();
+
+	const QRectF extent = map.calculateExtent();
+	if (!extent.isValid())
+		return QImage();
+
+	QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+	if (image.isNull())
+		return image;
+	image.fill(Qt::white);
+
+	const qreal scaling = size / qMax(extent.width(), extent.height());
+	QPainter painter(&image);
+	painter.setRenderHint(QPainter::Antialiasing);
+	painter.translate(size / 2.0, size / 2.0);
+	painter.scale(scaling, scaling);
+	painter.translate(-extent.center());
+	RenderConfig config = { map, extent, scaling, RenderConfig::ReducedDetail, 1.0 };
+	map.draw(&painter, config);
+	painter.end();
+	return image;
+}
+
+bool MapThumbnailCache::event(QEvent* event)
+{
+	if (event->type() != JobFinishedEvent::type())
+		return QObject::event(event);
+
+	auto finished = static_cast<JobFinishedEvent*>(event);
+	pending.remove(finished->key);
+	// Failures are recorded as null images, so that they are not retried.
+	thumbnails.insert(finished->key, finished->image);
+	if (!finished->image.isNull())
+		emit thumbnailReady(finished->path, finished->image);
+	return true;
+}
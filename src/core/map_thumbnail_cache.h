@@ -0,0 +1,124 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef _OPENORIENTEERING_MAP_THUMBNAIL_CACHE_H_
+#define _OPENORIENTEERING_MAP_THUMBNAIL_CACHE_H_
+
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+
+
+/**
+ * @brief MapThumbnailCache provides small preview images of map files.
+ *
+ * The thumbnails are rendered in a worker thread, so that e.g. the home
+ * screen's list of recent files is shown without delay. Rendering uses
+ * reduced detail, and it shows the map parts which are loaded with the file.
+ *
+ * Rendered thumbnails are kept in memory, and they are stored as PNG files
+ * in the user's cache directory. The entries are keyed by the program
+ * version, the map file's path, size and modification time, and the
+ * thumbnail size. So a modified map gets a new thumbnail.
+ *
+ * Synopsis:
+ *
+ * connect(cache, &MapThumbnailCache::thumbnailReady, this, &Foo::showThumbnail);
+ * QImage image = cache->thumbnail(path);
+ * if (!image.isNull())
+ *     showThumbnail(path, image);
+ */
+class MapThumbnailCache : public QObject
+{
+Q_OBJECT
+public:
+	/** Constructs a cache for thumbnails of the given width and height, in pixels. */
+	explicit MapThumbnailCache(int size, QObject* parent = nullptr);
+
+	/** Destructor. Waits for a running job, and cancels the queued ones. */
+	~MapThumbnailCache() override;
+
+	/** Returns the width and height of the thumbnails, in pixels. */
+	int thumbnailSize() const;
+
+	/**
+	 * Returns the thumbnail of the given map file if it is in memory.
+	 *
+	 * Otherwise returns a null image, and starts loading or rendering the
+	 * thumbnail in a worker thread. thumbnailReady() will be emitted when
+	 * the thumbnail is available. For files which cannot be rendered, a null
+	 * image is returned without retrying.
+	 */
+	QImage thumbnail(const QString& path);
+
+	/**
+	 * Loads the given map file and renders a thumbnail of the given size.
+	 *
+	 * Returns a null image on error. This function may be called from any thread.
+	 */
+	static QImage renderThumbnail(const QString& path, int size);
+
+signals:
+	/**
+	 * Is emitted when the thumbnail of the given map file becomes available.
+	 */
+	void thumbnailReady(const QString& path, const QImage& image);
+
+protected:
+	/** Takes the results of the jobs. */
+	bool event(QEvent* event) override;
+
+private:
+	class Job;
+	class JobFinishedEvent;
+
+	/** Returns the key of the thumbnail of the given map file, or an empty string. */
+	QString entryKey(const QString& path) const;
+
+	int size;
+
+	/** The directory of the stored thumbnails, or an empty string. */
+	QString cache_dir;
+
+	/** Thumbnails by entry key. */
+	QHash<QString, QImage> thumbnails;
+
+	/** The entry keys of the thumbnails which are loaded or rendered. */
+	QSet<QString> pending;
+
+	/** Not the global thread pool, so that rendering does not delay other tasks. */
+	QThreadPool thread_pool;
+};
+
+
+
+// ### MapThumbnailCache inline code ###
+
+inline
+int MapThumbnailCache::thumbnailSize() const
+{
+	return size;
+}
+
+#endif
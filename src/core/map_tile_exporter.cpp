@@ -0,0 +1,347 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "map_tile_exporter.h"
+
+#include <cmath>
+#include <initializer_list>
+
+#include <QAtomicInt>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QPolygonF>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QTransform>
+#include <qmath.h>
+
+#include "georeferencing.h"
+#include "latlon.h"
+#include "vector_tile_writer.h"
+#include "../map.h"
+#include "../renderable.h"
+#include "../util.h"
+
+
+namespace
+{
+	/** The latitude limit of the Web Mercator projection, in degrees. */
+	const double max_latitude = 85.0511287798;
+
+	/** The size of a pixel at the equator at zoom level 0, in meters. */
+	const double zoom_0_pixel_size = 156543.03392804097;
+
+	/** The maximum number of changed areas which are recorded separately. */
+	const std::size_t max_changed_areas = 256;
+
+	/** Returns the number of tiles per row and column at the given zoom level. */
+	double tilesPerAxis(int zoom)
+	{
+		return std::ldexp(1.0, zoom);
+	}
+
+	/** Returns the (fractional) tile coordinates of the given position. */
+	QPointF toTileCoords(const LatLon& lat_lon, int zoom)
+	{
+		const double n = tilesPerAxis(zoom);
+		const double latitude = qBound(-max_latitude, lat_lon.latitude(), max_latitude) * M_PI / 180.0;
+		return QPointF((lat_lon.longitude() + 180.0) / 360.0 * n,
+		               (1.0 - std::log(std::tan(latitude) + 1.0 / std::cos(latitude)) / M_PI) / 2.0 * n);
+	}
+
+	/** Returns the geographic position of the given tile coordinates. */
+	LatLon toLatLon(double x, double y, int zoom)
+	{
+		const double n = tilesPerAxis(zoom);
+		return LatLon(std::atan(std::sinh(M_PI * (1.0 - 2.0 * y / n))) * 180.0 / M_PI,
+		              x / n * 360.0 - 180.0);
+	}
+}
+
+
+
+// ### MapTileExporter::TileJob ###
+
+/**
+ * The parameters for rendering a single tile.
+ */
+struct MapTileExporter::TileJob
+{
+	QString path;
+	QRectF map_area;
+	QTransform transform;
+	qreal scaling;
+	TileFormat format;
+};
+
+
+
+// ### MapTileExporter::TileRunner ###
+
+/**
+ * Renders a single tile and writes it to its file.
+ *
+ * The map's renderables must not be modified while the runner is active.
+ */
+class MapTileExporter::TileRunner : public QRunnable
+{
+public:
+	TileRunner(Map& map, const TileJob& job, QAtomicInt& failures)
+	 : map(map)
+	 , job(job)
+	 , failures(failures)
+	{
+		; // nothing
+	}
+
+	void run() override
+	{
+		if (job.format == VectorTiles)
+			runVector();
+		else
+			runRaster();
+	}
+
+private:
+	void runRaster()
+	{
+		QImage image(tile_size, tile_size, QImage::Format_ARGB32_Premultiplied);
+		image.fill(Qt::transparent);
+
+		QPainter painter(&image);
+		painter.setRenderHint(QPainter::Antialiasing);
+		painter.setTransform(job.transform);
+		RenderConfig config = { map, job.map_area, job.scaling, RenderConfig::NoOptions, 1.0 };
+		map.draw(&painter, config);
+		painter.end();
+
+		if (!image.save(job.path, "PNG"))
+			failures.ref();
+	}
+
+	void runVector()
+	{
+		const qreal units_per_pixel = qreal(VectorTileWriter::extent) / tile_size;
+		VectorTileWriter writer(vector_tolerance);
+		RenderConfig config = { map, job.map_area, job.scaling, RenderConfig::NoOptions, 1.0 };
+		writer.addObjects(map, config, job.transform * QTransform::fromScale(units_per_pixel, units_per_pixel));
+
+		QFile file(job.path);
+		const QByteArray data = writer.data();
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+		    || file.write(data) != data.size())
+			failures.ref();
+	}
+
+	Map& map;
+	const TileJob job;
+	QAtomicInt& failures;
+};
+
+
+
+// ### MapTileExporter ###
+
+MapTileExporter::MapTileExporter(Map& map, TileFormat format)
+ : map(map)
+ , format(format)
+ , last_min_zoom(-1)
+ , last_max_zoom(-1)
+{
+	; // nothing
+}
+
+MapTileExporter::~MapTileExporter()
+{
+	; // nothing
+}
+
+int MapTileExporter::suggestedMaxZoom() const
+{
+	const auto& georef = map.getGeoreferencing();
+	const double latitude = georef.getGeographicRefPoint().latitude() * M_PI / 180.0;
+	const double pixel_size = 0.0001 * map.getScaleDenominator(); // 0.1 mm on the map, in meters
+	if (pixel_size <= 0.0)
+		return 0;
+
+	const auto zoom = qRound(std::log2(zoom_0_pixel_size * std::cos(latitude) / pixel_size));
+	return qBound(0, zoom, int(max_zoom_level));
+}
+
+void MapTileExporter::markChanged(const QRectF& map_area)
+{
+	if (!map_area.isValid())
+		return;
+
+	if (changed_areas.size() >= max_changed_areas)
+	{
+		// Keep the memory bounded, at the expense of rendering more tiles.
+		QRectF united = changed_areas.front();
+		for (const auto& area : changed_areas)
+			rectInclude(united, area);
+		changed_areas.clear();
+		changed_areas.push_back(united);
+	}
+	changed_areas.push_back(map_area);
+}
+
+bool MapTileExporter::isIncremental(const QString& directory, int min_zoom, int max_zoom) const
+{
+	return !last_directory.isEmpty()
+	       && QDir(directory) == QDir(last_directory)
+	       && min_zoom == last_min_zoom
+	       && max_zoom == last_max_zoom;
+}
+
+bool MapTileExporter::isChanged(const QRectF& tile_area) const
+{
+	for (const auto& area : changed_areas)
+	{
+		if (area.intersects(tile_area))
+			return true;
+	}
+	return false;
+}
+
+bool MapTileExporter::exportTiles(const QString& directory, int min_zoom, int max_zoom)
+{
+	const auto& georef = map.getGeoreferencing();
+	if (!georef.isValid() || georef.isLocal())
+		return false;
+
+	min_zoom = qBound(0, min_zoom, int(max_zoom_level));
+	max_zoom = qBound(min_zoom, max_zoom, int(max_zoom_level));
+	const bool incremental = isIncremental(directory, min_zoom, max_zoom);
+	if (incremental && changed_areas.empty())
+		return true;
+
+	// The renderables are only read while the tiles are rendered.
+	map.updateObjects();
+
+	// Changed areas may lie outside of the current extent
+	// when objects were deleted or moved.
+	QRectF extent = map.calculateExtent();
+	if (incremental)
+	{
+		for (const auto& area : changed_areas)
+			rectIncludeSafe(extent, area);
+	}
+	if (!extent.isValid())
+		return true;
+
+	// The outline of the extent, for determining the range of tiles
+	std::vector<LatLon> outline;
+	const int steps = 8;
+	for (int i = 0; i <= steps; ++i)
+	{
+		const qreal x = extent.left() + extent.width() * i / steps;
+		const qreal y = extent.top() + extent.height() * i / steps;
+		for (const auto& point : { QPointF(x, extent.top()), QPointF(x, extent.bottom()),
+		                           QPointF(extent.left(), y), QPointF(extent.right(), y) })
+		{
+			bool ok = true;
+			const LatLon lat_lon = georef.toGeographicCoords(MapCoordF(point), &ok);
+			if (ok)
+				outline.push_back(lat_lon);
+		}
+	}
+	if (outline.empty())
+		return false;
+
+	QPolygonF pixel_quad;
+	pixel_quad << QPointF(0, 0) << QPointF(tile_size, 0) << QPointF(tile_size, tile_size) << QPointF(0, tile_size);
+	QThreadPool thread_pool;
+	QAtomicInt failures(0);
+	QDir base_dir(directory);
+	const QString file_name = QLatin1String((format == VectorTiles) ? "%1/%2.mvt" : "%1/%2.png");
+	for (int zoom = min_zoom; zoom <= max_zoom; ++zoom)
+	{
+		QRectF tile_range;
+		for (const auto& lat_lon : outline)
+			rectIncludeSafe(tile_range, toTileCoords(lat_lon, zoom));
+
+		const int last_tile = int(tilesPerAxis(zoom)) - 1;
+		const int first_x = qBound(0, qFloor(tile_range.left()), last_tile);
+		const int last_x  = qBound(0, qFloor(tile_range.right()), last_tile);
+		const int first_y = qBound(0, qFloor(tile_range.top()), last_tile);
+		const int last_y  = qBound(0, qFloor(tile_range.bottom()), last_tile);
+		for (int x = first_x; x <= last_x; ++x)
+		{
+			const QString column = QString::fromLatin1("%1/%2").arg(zoom).arg(x);
+			bool column_created = false;
+			for (int y = first_y; y <= last_y; ++y)
+			{
+				QPolygonF map_quad;
+				bool ok = true;
+				for (const auto& corner : { QPoint(x, y), QPoint(x+1, y), QPoint(x+1, y+1), QPoint(x, y+1) })
+				{
+					bool corner_ok = true;
+					map_quad << georef.toMapCoordF(toLatLon(corner.x(), corner.y(), zoom), &corner_ok);
+					ok = ok && corner_ok;
+				}
+				if (!ok)
+					continue;
+
+				const QRectF tile_area = map_quad.boundingRect();
+				if (incremental && !isChanged(tile_area))
+					continue;
+
+				TileJob job;
+				job.path = base_dir.filePath(file_name.arg(column).arg(y));
+				if (!map.hasRenderablesAt(tile_area))
+				{
+					if (incremental)
+						QFile::remove(job.path);
+					continue;
+				}
+
+				if (!QTransform::quadToQuad(map_quad, pixel_quad, job.transform))
+					continue;
+
+				if (!column_created)
+				{
+					if (!base_dir.mkpath(column))
+					{
+						failures.ref();
+						break;
+					}
+					column_created = true;
+				}
+
+				job.map_area = tile_area;
+				job.scaling = std::sqrt(std::abs(job.transform.determinant()));
+				job.format = format;
+				thread_pool.start(new TileRunner(map, job, failures));
+			}
+		}
+	}
+	thread_pool.waitForDone();
+
+	if (failures.load() != 0)
+		return false;
+
+	changed_areas.clear();
+	last_directory = directory;
+	last_min_zoom = min_zoom;
+	last_max_zoom = max_zoom;
+	return true;
+}
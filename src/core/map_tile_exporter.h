@@ -0,0 +1,124 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_MAP_TILE_EXPORTER_H_
+#define _OPENORIENTEERING_MAP_TILE_EXPORTER_H_
+
+#include <vector>
+
+#include <QRectF>
+#include <QString>
+
+class Map;
+
+
+/**
+ * Exports the map as a pyramid of Web Mercator tiles.
+ *
+ * The tiles are written as PNG files of 256 x 256 pixels in the common XYZ
+ * directory layout, i.e. as <directory>/<zoom>/<x>/<y>.png, with the origin
+ * in the north-west. Alternatively, the tiles are written as Mapbox vector
+ * tiles, <directory>/<zoom>/<x>/<y>.mvt, see VectorTileWriter. The geometry
+ * of vector tiles is simplified with a fixed tolerance in tile units, so it
+ * becomes coarser at lower zoom levels. The map must be georeferenced. The tiles are rendered by
+ * multiple threads. Tiles which are not touched by any object are not written.
+ *
+ * The exporter records the areas of the map which changed after an export,
+ * when markChanged() is called for each change. A repeated export to the same
+ * directory and zoom levels renders only the tiles which touch these areas,
+ * and it removes the tiles which have become empty.
+ *
+ * Synopsis:
+ *
+ * MapTileExporter exporter(map);
+ * QObject::connect(&map, &Map::objectAreaChanged, [&exporter](const QRectF& area) {
+ *     exporter.markChanged(area);
+ * });
+ * exporter.exportTiles(directory, 12, exporter.suggestedMaxZoom());
+ */
+class MapTileExporter
+{
+public:
+	/** The width and height of the tiles, in pixels. */
+	static const int tile_size = 256;
+
+	/** The highest zoom level which is supported. */
+	static const int max_zoom_level = 22;
+
+	/** The maximum deviation of simplified vector tile geometry, in tile units. */
+	static constexpr double vector_tolerance = 8.0;
+
+	/** The format of the tiles */
+	enum TileFormat
+	{
+		RasterTiles,  ///< PNG images
+		VectorTiles,  ///< Mapbox vector tiles
+	};
+
+	/**
+	 * Constructs an exporter for the given map.
+	 */
+	explicit MapTileExporter(Map& map, TileFormat format = RasterTiles);
+
+	/**
+	 * Destructor.
+	 */
+	~MapTileExporter();
+
+	/**
+	 * Returns the zoom level where a tile pixel is closest to 0.1 mm on the map.
+	 */
+	int suggestedMaxZoom() const;
+
+	/**
+	 * Records that the given area of the map changed after the last export.
+	 */
+	void markChanged(const QRectF& map_area);
+
+	/**
+	 * Returns true if an export with the given parameters would only update
+	 * the tiles of the changed areas.
+	 */
+	bool isIncremental(const QString& directory, int min_zoom, int max_zoom) const;
+
+	/**
+	 * Renders and writes the tiles for the given range of zoom levels.
+	 *
+	 * Returns false if the map is not georeferenced, or if any tile could
+	 * not be written.
+	 */
+	bool exportTiles(const QString& directory, int min_zoom, int max_zoom);
+
+private:
+	struct TileJob;
+	class TileRunner;
+
+	/** Returns true if the tile's map area must be rendered again. */
+	bool isChanged(const QRectF& tile_area) const;
+
+	Map& map;
+	TileFormat format;
+	std::vector<QRectF> changed_areas;
+	QString last_directory;
+	int last_min_zoom;
+	int last_max_zoom;
+};
+
+#endif
@@ -37,6 +37,7 @@ namespace literal
 	static const QLatin1String position_y("position_y");
 	static const QLatin1String grid("grid");
 	static const QLatin1String overprinting_simulation_enabled("overprinting_simulation_enabled");
+	static const QLatin1String soft_proof_enabled("soft_proof_enabled");
 	static const QLatin1String map("map");
 	static const QLatin1String opacity("opacity");
 	static const QLatin1String visible("visible");
@@ -58,6 +59,7 @@ MapView::MapView(Map* map)
  , all_templates_hidden{ false }
  , grid_visible{ false }
  , overprinting_simulation_enabled{ false }
+ , soft_proof_enabled{ false }
 {
 	updateTransform(NoChange);
 }
@@ -131,6 +133,8 @@ void MapView::save(QXmlStreamWriter& xml, const QLatin1String& element_name, boo
 	mapview_element.writeAttribute(literal::position_y, center_pos.nativeY());
 	mapview_element.writeAttribute(literal::grid, grid_visible);
 	mapview_element.writeAttribute(literal::overprinting_simulation_enabled, overprinting_simulation_enabled);
+	if (soft_proof_enabled)
+		mapview_element.writeAttribute(literal::soft_proof_enabled, soft_proof_enabled);
 	
 	{
 		XmlElementWriter map_element(xml, literal::map);
@@ -178,6 +182,7 @@ void MapView::load(QXmlStreamReader& xml)
 	
 	grid_visible = mapview_element.attribute<bool>(literal::grid);
 	overprinting_simulation_enabled = mapview_element.attribute<bool>(literal::overprinting_simulation_enabled);
+	soft_proof_enabled = mapview_element.attribute<bool>(literal::soft_proof_enabled);
 	updateTransform(CenterChange | ZoomChange | RotationChange);
 	
 	while (xml.readNextStartElement())
@@ -467,7 +472,9 @@ void MapView::setGridVisible(bool visible)
 	if (grid_visible != visible)
 	{
 		grid_visible = visible;
-		updateAllMapWidgets();
+		// The grid has its own layer in the map widgets.
+		for (auto widget : widgets)
+			widget->updateGrid();
 	}
 }
 
@@ -479,3 +486,12 @@ void MapView::setOverprintingSimulationEnabled(bool enabled)
 		updateAllMapWidgets();
 	}
 }
+
+void MapView::setSoftProofEnabled(bool enabled)
+{
+	if (soft_proof_enabled != enabled)
+	{
+		soft_proof_enabled = enabled;
+		updateAllMapWidgets();
+	}
+}
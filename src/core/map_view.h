@@ -271,6 +271,16 @@ public:
 	/** Enables or disables overprinting simulation. */
 	void setOverprintingSimulationEnabled(bool enabled);
 	
+	/**
+	 * Returns if the map colors are shown as expected from CMYK printing.
+	 * 
+	 * @see RenderConfig::SoftProof
+	 */
+	bool isSoftProofEnabled() const;
+	
+	/** Enables or disables the soft proof. */
+	void setSoftProofEnabled(bool enabled);
+	
 	// Static
 	
 	/** The global zoom in limit for the zoom factor. */
@@ -301,6 +311,7 @@ private:
 	bool all_templates_hidden;
 	bool grid_visible;
 	bool overprinting_simulation_enabled;
+	bool soft_proof_enabled;
 };
 
 
@@ -396,6 +407,12 @@ bool MapView::isOverprintingSimulationEnabled() const
 	return overprinting_simulation_enabled;
 }
 
+inline
+bool MapView::isSoftProofEnabled() const
+{
+	return soft_proof_enabled;
+}
+
 
 
 #endif
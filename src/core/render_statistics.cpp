@@ -0,0 +1,71 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "render_statistics.h"
+
+#include <QAtomicInt>
+
+
+namespace
+{
+	QAtomicInt enabled(0);
+	QAtomicInt visited_renderables(0);
+	QAtomicInt drawn_renderables(0);
+	QAtomicInt updated_objects(0);
+}
+
+
+
+// ### RenderStatistics ###
+
+bool RenderStatistics::isEnabled()
+{
+	return enabled.load() != 0;
+}
+
+void RenderStatistics::setEnabled(bool value)
+{
+	enabled.store(value ? 1 : 0);
+	take();
+}
+
+void RenderStatistics::addRenderables(int visited, int drawn)
+{
+	if (isEnabled())
+	{
+		visited_renderables.fetchAndAddRelaxed(visited);
+		drawn_renderables.fetchAndAddRelaxed(drawn);
+	}
+}
+
+void RenderStatistics::addUpdatedObjects(int count)
+{
+	if (isEnabled())
+		updated_objects.fetchAndAddRelaxed(count);
+}
+
+RenderStatistics::Counters RenderStatistics::take()
+{
+	Counters counters;
+	counters.visited_renderables = visited_renderables.fetchAndStoreRelaxed(0);
+	counters.drawn_renderables = drawn_renderables.fetchAndStoreRelaxed(0);
+	counters.updated_objects = updated_objects.fetchAndStoreRelaxed(0);
+	return counters;
+}
@@ -0,0 +1,84 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_RENDER_STATISTICS_H_
+#define _OPENORIENTEERING_RENDER_STATISTICS_H_
+
+#include <QtGlobal>
+
+
+/**
+ * Process-wide counters of the work done for rendering the map.
+ *
+ * The counters are only updated while they are enabled, so that they cost
+ * nothing in normal operation. They are used by the render profiler of the
+ * MapWidget. The counters may be updated from multiple threads.
+ *
+ * Synopsis:
+ *
+ * RenderStatistics::setEnabled(true);
+ * ... // Draw the map.
+ * RenderStatistics::Counters counters = RenderStatistics::take();
+ */
+class RenderStatistics
+{
+public:
+	/**
+	 * A snapshot of the counters.
+	 */
+	struct Counters
+	{
+		/** The number of renderables which were tested for drawing. */
+		int visited_renderables;
+
+		/** The number of renderables which were actually drawn. */
+		int drawn_renderables;
+
+		/** The number of objects updated by Map::updateObjects(). */
+		int updated_objects;
+	};
+
+	/**
+	 * Returns true if the counters are updated.
+	 */
+	static bool isEnabled();
+
+	/**
+	 * Enables or disables the counters, and resets them.
+	 */
+	static void setEnabled(bool enabled);
+
+	/**
+	 * Adds to the renderable counters, if enabled.
+	 */
+	static void addRenderables(int visited, int drawn);
+
+	/**
+	 * Adds to the updated objects counter, if enabled.
+	 */
+	static void addUpdatedObjects(int count);
+
+	/**
+	 * Returns the current counters, and resets them.
+	 */
+	static Counters take();
+};
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "renderable_arena.h"
+
+#include <cstdlib>
+#include <new>
+
+#include <QAtomicInt>
+#include <QThreadStorage>
+
+
+namespace
+{
+	/** The alignment of all allocations. It is also the size of their header. */
+	const std::size_t alignment = 2 * sizeof(void*);
+
+	/** The size of the blocks which are shared by small allocations. */
+	const std::size_t block_size = 64 * 1024;
+
+	/** Allocations larger than this get a block of their own. */
+	const std::size_t max_shared_size = block_size / 8;
+
+	inline
+	std::size_t aligned(std::size_t size)
+	{
+		return (size + alignment - 1) & ~(alignment - 1);
+	}
+
+	/**
+	 * A block of memory for allocations.
+	 *
+	 * The reference count is the number of live allocations, plus one while
+	 * a thread allocates from this block.
+	 */
+	struct Block
+	{
+		QAtomicInt refs;
+		char* next;
+		char* end;
+
+		char* begin()
+		{
+			return reinterpret_cast<char*>(this) + aligned(sizeof(Block));
+		}
+	};
+
+	Block* newBlock(std::size_t capacity, int refs)
+	{
+		void* memory = std::malloc(aligned(sizeof(Block)) + capacity);
+		if (!memory)
+			throw std::bad_alloc();
+
+		Block* block = new (memory) Block();
+		block->refs.store(refs);
+		block->next = block->begin();
+		block->end = block->next + capacity;
+		return block;
+	}
+
+	void releaseBlock(Block* block)
+	{
+		if (!block->refs.deref())
+		{
+			block->~Block();
+			std::free(block);
+		}
+	}
+
+	/** Takes the given amount of memory from the block, which must have enough space. */
+	void* take(Block* block, std::size_t amount)
+	{
+		char* p = block->next;
+		block->next += amount;
+		*reinterpret_cast<Block**>(p) = block;
+		return p + alignment;
+	}
+
+	/** The block from which a particular thread allocates. */
+	struct CurrentBlock
+	{
+		Block* block = nullptr;
+
+		~CurrentBlock()
+		{
+			if (block)
+				releaseBlock(block);
+		}
+	};
+
+	Q_GLOBAL_STATIC(QThreadStorage<CurrentBlock*>, current_blocks)
+}
+
+
+
+// ### RenderableArena ###
+
+void* RenderableArena::allocate(std::size_t size)
+{
+	const std::size_t amount = alignment + aligned(size);
+	if (amount > max_shared_size || current_blocks.isDestroyed())
+	{
+		// One reference for the allocation
+		return take(newBlock(amount, 1), amount);
+	}
+
+	CurrentBlock*& current = current_blocks->localData();
+	if (!current)
+		current = new CurrentBlock();
+
+	Block* block = current->block;
+	if (block && block->refs.loadAcquire() == 1)
+	{
+		// All allocations from this block were released. Only this thread
+		// can take new references, so the block can be reused from the start.
+		block->next = block->begin();
+	}
+	if (!block || std::size_t(block->end - block->next) < amount)
+	{
+		if (block)
+			releaseBlock(block);
+		// One reference for this thread
+		block = current->block = newBlock(block_size - aligned(sizeof(Block)), 1);
+	}
+
+	block->refs.ref();
+	return take(block, amount);
+}
+
+void RenderableArena::deallocate(void* p)
+{
+	if (p)
+		releaseBlock(*reinterpret_cast<Block**>(static_cast<char*>(p) - alignment));
+}
@@ -0,0 +1,68 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_RENDERABLE_ARENA_H_
+#define _OPENORIENTEERING_RENDERABLE_ARENA_H_
+
+#include <cstddef>
+
+
+/**
+ * A memory arena for the many small objects which are created when
+ * renderables are generated.
+ *
+ * Each thread allocates from its own block by advancing a pointer. A block
+ * counts its live allocations, and it is released as soon as the last of
+ * them is freed and no thread allocates from it any longer. When all
+ * allocations from the current block of a thread are freed, e.g. because an
+ * object's renderables were deleted for regeneration, the block is reset and
+ * reused by that thread.
+ *
+ * Memory may be freed by any thread. Freeing is a single atomic decrement,
+ * so that dropping the renderables of a large map does not stress the heap.
+ *
+ * Synopsis:
+ *
+ * void* p = RenderableArena::allocate(sizeof(Foo));
+ * Foo* foo = new (p) Foo();
+ * ...
+ * foo->~Foo();
+ * RenderableArena::deallocate(foo);
+ */
+class RenderableArena
+{
+public:
+	/**
+	 * Returns memory for an object of the given size.
+	 *
+	 * The memory is aligned suitably for any renderable.
+	 * Throws std::bad_alloc when there is no memory.
+	 */
+	static void* allocate(std::size_t size);
+
+	/**
+	 * Releases memory which was returned by allocate().
+	 *
+	 * Does nothing for nullptr.
+	 */
+	static void deallocate(void* p);
+};
+
+#endif
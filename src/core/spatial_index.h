@@ -0,0 +1,436 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_SPATIAL_INDEX_H_
+#define _OPENORIENTEERING_SPATIAL_INDEX_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <QRectF>
+
+
+/**
+ * A spatial index for items with a rectangular extent.
+ *
+ * The index is a sparse uniform grid. Each item is registered in all cells
+ * which are touched by its extent. Items which would occupy too many cells,
+ * and items which do not have a valid extent (yet), are kept in a separate
+ * list which is scanned for each query.
+ *
+ * The index does not own the items. It only stores a copy of the extent which
+ * was given when the item was inserted or updated. It is the responsibility
+ * of the owner of the index to call update() when an item's extent changes.
+ *
+ * Synopsis:
+ *
+ * SpatialIndex<Object> index;
+ * index.insert(object, object->getExtent());
+ * ...
+ * std::vector<Object*> candidates;
+ * index.query(rect, candidates);
+ */
+template< class T >
+class SpatialIndex
+{
+public:
+	typedef std::size_t size_type;
+
+	/**
+	 * Constructs a new index.
+	 *
+	 * @param cell_size The size of the grid's cells (in the units of the
+	 *                  items' extents, normally millimeters on the map).
+	 */
+	explicit SpatialIndex(qreal cell_size = 8.0);
+
+	SpatialIndex(const SpatialIndex&) = delete;
+	SpatialIndex& operator=(const SpatialIndex&) = delete;
+
+	/** Returns the number of items in the index. */
+	size_type size() const;
+
+	/** Returns true if the index is empty. */
+	bool empty() const;
+
+	/** Returns true if the given item is registered in the index. */
+	bool contains(const T* item) const;
+
+	/**
+	 * Adds an item with the given extent to the index.
+	 *
+	 * If the item is already registered, its extent is updated.
+	 */
+	void insert(T* item, const QRectF& extent);
+
+	/**
+	 * Changes the extent of a registered item.
+	 *
+	 * Returns false if the item is not registered in the index.
+	 */
+	bool update(const T* item, const QRectF& extent);
+
+	/**
+	 * Removes an item from the index.
+	 *
+	 * Returns false if the item was not registered in the index.
+	 */
+	bool remove(const T* item);
+
+	/** Removes all items from the index. */
+	void clear();
+	
+	/** Exchanges the contents of this index and an index of equal cell size. */
+	void swap(SpatialIndex& other);
+
+	/**
+	 * Appends all items whose extent touches the given rect to out.
+	 *
+	 * Items which do not have a valid extent are always appended.
+	 * In contrast to QRectF::intersects(), rects of zero width or height are
+	 * considered to touch each other if they share a border or a point.
+	 * Each item is appended at most once.
+	 */
+	void query(const QRectF& rect, std::vector<T*>& out) const;
+
+	/**
+	 * Returns the number of items whose extent touches the given rect.
+	 *
+	 * Items without a valid extent are not counted.
+	 */
+	size_type count(const QRectF& rect) const;
+
+private:
+	/** Cells are identified by a pair of grid coordinates. */
+	typedef std::uint64_t CellKey;
+
+	struct Entry
+	{
+		T* item;
+		QRectF extent;
+		int left;
+		int top;
+		int right;
+		int bottom;
+		bool in_grid;
+	};
+
+	typedef std::vector<Entry*> EntryList;
+
+	/** The maximum number of cells per item. Larger items go to large_entries. */
+	static const int max_cells_per_item = 256;
+
+	static CellKey key(int x, int y);
+
+	int cellIndex(qreal value) const;
+
+	static bool touches(const QRectF& a, const QRectF& b);
+
+	static void removeFrom(EntryList& list, const Entry* entry);
+
+	void place(Entry& entry, const QRectF& extent);
+
+	void unplace(Entry& entry);
+
+	template< class Operation >
+	void forEachTouching(const QRectF& rect, Operation op) const;
+
+
+	const qreal cell_size;
+
+	/** The entries. This container guarantees stable addresses. */
+	std::unordered_map<const T*, Entry> entries;
+
+	/** The grid cells, each referring to the entries which touch it. */
+	std::unordered_map<CellKey, EntryList> cells;
+
+	/** Entries which are too large for the grid or have got no valid extent. */
+	EntryList large_entries;
+};
+
+
+
+// ### SpatialIndex inline and template code ###
+
+template< class T >
+SpatialIndex<T>::SpatialIndex(qreal cell_size)
+ : cell_size(cell_size)
+{
+	Q_ASSERT(cell_size > 0.0);
+}
+
+template< class T >
+inline
+typename SpatialIndex<T>::size_type SpatialIndex<T>::size() const
+{
+	return entries.size();
+}
+
+template< class T >
+inline
+bool SpatialIndex<T>::empty() const
+{
+	return entries.empty();
+}
+
+template< class T >
+inline
+bool SpatialIndex<T>::contains(const T* item) const
+{
+	return entries.find(item) != entries.end();
+}
+
+template< class T >
+void SpatialIndex<T>::insert(T* item, const QRectF& extent)
+{
+	auto result = entries.emplace(item, Entry());
+	Entry& entry = result.first->second;
+	if (result.second)
+	{
+		entry.item = item;
+		entry.in_grid = false;
+		large_entries.push_back(&entry);
+	}
+	place(entry, extent);
+}
+
+template< class T >
+bool SpatialIndex<T>::update(const T* item, const QRectF& extent)
+{
+	auto found = entries.find(item);
+	if (found == entries.end())
+		return false;
+
+	place(found->second, extent);
+	return true;
+}
+
+template< class T >
+bool SpatialIndex<T>::remove(const T* item)
+{
+	auto found = entries.find(item);
+	if (found == entries.end())
+		return false;
+
+	unplace(found->second);
+	removeFrom(large_entries, &found->second);
+	entries.erase(found);
+	return true;
+}
+
+template< class T >
+void SpatialIndex<T>::clear()
+{
+	cells.clear();
+	large_entries.clear();
+	entries.clear();
+}
+
+template< class T >
+void SpatialIndex<T>::swap(SpatialIndex& other)
+{
+	// Swapping the containers keeps the addresses of the entries.
+	Q_ASSERT(cell_size == other.cell_size);
+	cells.swap(other.cells);
+	large_entries.swap(other.large_entries);
+	entries.swap(other.entries);
+}
+
+template< class T >
+void SpatialIndex<T>::query(const QRectF& rect, std::vector<T*>& out) const
+{
+	forEachTouching(rect, [&out](const Entry* entry) { out.push_back(entry->item); });
+	for (const Entry* entry : large_entries)
+	{
+		if (!entry->extent.isValid() || touches(entry->extent, rect))
+			out.push_back(entry->item);
+	}
+}
+
+template< class T >
+typename SpatialIndex<T>::size_type SpatialIndex<T>::count(const QRectF& rect) const
+{
+	size_type result = 0;
+	forEachTouching(rect, [&result](const Entry*) { ++result; });
+	for (const Entry* entry : large_entries)
+	{
+		if (entry->extent.isValid() && touches(entry->extent, rect))
+			++result;
+	}
+	return result;
+}
+
+template< class T >
+inline
+typename SpatialIndex<T>::CellKey SpatialIndex<T>::key(int x, int y)
+{
+	return (CellKey(std::uint32_t(x)) << 32) | CellKey(std::uint32_t(y));
+}
+
+template< class T >
+inline
+int SpatialIndex<T>::cellIndex(qreal value) const
+{
+	return int(std::floor(value / cell_size));
+}
+
+template< class T >
+inline
+bool SpatialIndex<T>::touches(const QRectF& a, const QRectF& b)
+{
+	return a.left() <= b.right() && b.left() <= a.right() &&
+	       a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+template< class T >
+void SpatialIndex<T>::removeFrom(EntryList& list, const Entry* entry)
+{
+	auto found = std::find(list.begin(), list.end(), entry);
+	if (found != list.end())
+	{
+		*found = list.back();
+		list.pop_back();
+	}
+}
+
+template< class T >
+void SpatialIndex<T>::place(Entry& entry, const QRectF& extent)
+{
+	const bool was_in_grid = entry.in_grid;
+	const int old_left = entry.left, old_top = entry.top, old_right = entry.right, old_bottom = entry.bottom;
+
+	entry.extent = extent;
+	bool in_grid = false;
+	if (extent.isValid())
+	{
+		entry.left   = cellIndex(extent.left());
+		entry.top    = cellIndex(extent.top());
+		entry.right  = cellIndex(extent.right());
+		entry.bottom = cellIndex(extent.bottom());
+		in_grid = qint64(entry.right - entry.left + 1) * qint64(entry.bottom - entry.top + 1) <= max_cells_per_item;
+	}
+
+	if (was_in_grid && in_grid &&
+	    old_left == entry.left && old_top == entry.top &&
+	    old_right == entry.right && old_bottom == entry.bottom)
+	{
+		return; // Same cells, nothing else to do
+	}
+
+	if (was_in_grid)
+	{
+		for (int x = old_left; x <= old_right; ++x)
+		{
+			for (int y = old_top; y <= old_bottom; ++y)
+			{
+				auto cell = cells.find(key(x, y));
+				Q_ASSERT(cell != cells.end());
+				removeFrom(cell->second, &entry);
+				if (cell->second.empty())
+					cells.erase(cell);
+			}
+		}
+	}
+	else
+	{
+		removeFrom(large_entries, &entry);
+	}
+
+	entry.in_grid = in_grid;
+	if (in_grid)
+	{
+		for (int x = entry.left; x <= entry.right; ++x)
+		{
+			for (int y = entry.top; y <= entry.bottom; ++y)
+				cells[key(x, y)].push_back(&entry);
+		}
+	}
+	else
+	{
+		large_entries.push_back(&entry);
+	}
+}
+
+template< class T >
+void SpatialIndex<T>::unplace(Entry& entry)
+{
+	if (entry.in_grid)
+	{
+		place(entry, QRectF());
+		Q_ASSERT(!entry.in_grid);
+	}
+}
+
+template< class T >
+template< class Operation >
+void SpatialIndex<T>::forEachTouching(const QRectF& rect, Operation op) const
+{
+	if (cells.empty())
+		return;
+
+	const QRectF query = rect.normalized();
+	const int left   = cellIndex(query.left());
+	const int top    = cellIndex(query.top());
+	const int right  = cellIndex(query.right());
+	const int bottom = cellIndex(query.bottom());
+
+	// An entry is reported only from the first cell where it meets the query.
+	auto report = [&](const Entry* entry, int x, int y) {
+		if (x == std::max(entry->left, left) &&
+		    y == std::max(entry->top, top) &&
+		    touches(entry->extent, query))
+		{
+			op(entry);
+		}
+	};
+
+	if (qint64(right - left + 1) * qint64(bottom - top + 1) > qint64(cells.size()))
+	{
+		// Large query: visit the existing cells only.
+		for (const auto& cell : cells)
+		{
+			const int x = int(std::int32_t(std::uint32_t(cell.first >> 32)));
+			const int y = int(std::int32_t(std::uint32_t(cell.first)));
+			if (x < left || x > right || y < top || y > bottom)
+				continue;
+			for (const Entry* entry : cell.second)
+				report(entry, x, y);
+		}
+	}
+	else
+	{
+		for (int x = left; x <= right; ++x)
+		{
+			for (int y = top; y <= bottom; ++y)
+			{
+				auto cell = cells.find(key(x, y));
+				if (cell == cells.end())
+					continue;
+				for (const Entry* entry : cell->second)
+					report(entry, x, y);
+			}
+		}
+	}
+}
+
+#endif
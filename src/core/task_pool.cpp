@@ -0,0 +1,145 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "task_pool.h"
+
+#include <memory>
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include "../settings.h"
+
+
+namespace
+{
+	/** The General_MaxThreads setting, for access from any thread. */
+	QAtomicInt max_threads_setting(0);
+	
+	/**
+	 * The state shared by the caller and the helper jobs of forEach().
+	 *
+	 * Helpers which start after forEach() returned find no more indices, and
+	 * they do not touch the function or the token then.
+	 */
+	struct ForEachState
+	{
+		const std::function<void (int)>* function;
+		const TaskPool::CancellationToken* token;
+		int count;
+		int chunk_size;
+		QAtomicInt next;
+		
+		QMutex mutex;
+		QWaitCondition idle;
+		int active;   ///< The number of threads working on chunks, guarded by mutex
+		
+		/** Takes and processes chunks until all indices are taken. */
+		void work()
+		{
+			{
+				QMutexLocker lock(&mutex);
+				++active;
+			}
+			for (int first = next.fetchAndAddOrdered(chunk_size); first < count; first = next.fetchAndAddOrdered(chunk_size))
+			{
+				if (token && token->isCancelled())
+				{
+					next.storeRelease(count);
+					break;
+				}
+				const int last = qMin(first + chunk_size, count);
+				for (int i = first; i < last; ++i)
+					(*function)(i);
+			}
+			QMutexLocker lock(&mutex);
+			if (--active == 0)
+				idle.wakeAll();
+		}
+	};
+	
+	/** A helper job of forEach(). */
+	class ForEachJob : public QRunnable
+	{
+	public:
+		explicit ForEachJob(const std::shared_ptr<ForEachState>& state)
+		 : state(state)
+		{ }
+		
+		void run() override
+		{
+			state->work();
+		}
+		
+	private:
+		const std::shared_ptr<ForEachState> state;
+	};
+}
+
+
+
+// ### TaskPool ###
+
+int TaskPool::maxThreads()
+{
+	const int setting = max_threads_setting.loadAcquire();
+	return qMax(1, setting > 0 ? setting : QThread::idealThreadCount());
+}
+
+void TaskPool::applySettings()
+{
+	max_threads_setting.storeRelease(Settings::getInstance().getSettingCached(Settings::General_MaxThreads).toInt());
+	QThreadPool::globalInstance()->setMaxThreadCount(maxThreads());
+}
+
+void TaskPool::start(QRunnable* job, Priority priority)
+{
+	QThreadPool::globalInstance()->start(job, priority);
+}
+
+void TaskPool::forEach(int count, int chunk_size, const std::function<void (int)>& function, const CancellationToken* token)
+{
+	chunk_size = qMax(1, chunk_size);
+	
+	auto state = std::make_shared<ForEachState>();
+	state->function = &function;
+	state->token = token;
+	state->count = count;
+	state->chunk_size = chunk_size;
+	state->next.store(0);
+	state->active = 0;
+	
+	// This thread takes part, too.
+	const int num_chunks = (count + chunk_size - 1) / chunk_size;
+	const int num_helpers = qMin(maxThreads(), num_chunks) - 1;
+	for (int i = 0; i < num_helpers; ++i)
+		start(new ForEachJob(state), Interactive);
+	state->work();
+	
+	// Helpers which still have chunks must finish them.
+	QMutexLocker lock(&state->mutex);
+	while (state->active > 0)
+		state->idle.wait(&state->mutex);
+}
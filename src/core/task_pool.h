@@ -0,0 +1,139 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef _OPENORIENTEERING_TASK_POOL_H_
+#define _OPENORIENTEERING_TASK_POOL_H_
+
+#include <functional>
+
+#include <QAtomicInt>
+
+class QRunnable;
+
+
+/**
+ * The shared pool of worker threads for all subsystems.
+ *
+ * TaskPool is a thin layer over QThreadPool::globalInstance(). It limits the
+ * number of threads according to the General_MaxThreads setting, and it gives
+ * the jobs a priority. Results of jobs reach the GUI thread as events, as
+ * usual with QRunnable.
+ *
+ * forEach() is the common pattern for splitting work on many elements: The
+ * calling thread and helper jobs take chunks of indices from a shared counter
+ * until all elements are done, so faster threads take more of the work. The
+ * calling thread never waits for helpers which have not started, so forEach()
+ * may be used from within worker threads, too.
+ *
+ * Synopsis:
+ *
+ * TaskPool::forEach(int(objects.size()), 64, [&objects](int i) {
+ *     objects[i]->doSomething();
+ * });
+ */
+class TaskPool
+{
+public:
+	/** Priorities for jobs. Jobs of a higher priority are started first. */
+	enum Priority
+	{
+		Idle        = 0,  ///< Work which nobody waits for, e.g. thumbnails
+		Background  = 1,  ///< Work which is needed soon, e.g. loading templates
+		Interactive = 2   ///< Work which the user waits for, e.g. drawing
+	};
+	
+	/**
+	 * A flag for cancelling work which is in progress.
+	 *
+	 * The flag may be set from any thread. The work checks it from time to time.
+	 */
+	class CancellationToken
+	{
+	public:
+		CancellationToken();
+		
+		/** Requests the cancellation. */
+		void cancel();
+		
+		/** Returns true if the cancellation was requested. */
+		bool isCancelled() const;
+		
+	private:
+		QAtomicInt cancelled;
+	};
+	
+	/**
+	 * Returns the number of threads which may work concurrently.
+	 *
+	 * This is the General_MaxThreads setting, or the ideal thread count if the
+	 * setting is 0. The result is at least 1. This function may be called
+	 * from any thread.
+	 */
+	static int maxThreads();
+	
+	/**
+	 * Applies the General_MaxThreads setting to the shared thread pool.
+	 *
+	 * This is called by Settings::applySettings().
+	 */
+	static void applySettings();
+	
+	/**
+	 * Starts the job in a worker thread. The pool takes ownership of the job
+	 * if job->autoDelete() is true.
+	 */
+	static void start(QRunnable* job, Priority priority);
+	
+	/**
+	 * Calls function(i) for all i from 0 to count-1, concurrently.
+	 *
+	 * The indices are taken in chunks of the given size. All calls are finished
+	 * when this function returns. If the token is cancelled, no more chunks are
+	 * started.
+	 */
+	static void forEach(int count, int chunk_size, const std::function<void (int)>& function,
+	                    const CancellationToken* token = nullptr);
+};
+
+
+
+// ### TaskPool::CancellationToken inline code ###
+
+inline
+TaskPool::CancellationToken::CancellationToken()
+ : cancelled(0)
+{
+	// nothing else
+}
+
+inline
+void TaskPool::CancellationToken::cancel()
+{
+	cancelled.storeRelease(1);
+}
+
+inline
+bool TaskPool::CancellationToken::isCancelled() const
+{
+	return cancelled.loadAcquire() != 0;
+}
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tile_fetcher.h"
+
+#include <algorithm>
+#include <vector>
+
+#if defined(QT_NETWORK_LIB)
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#endif
+
+#include <mapper_config.h>
+
+
+TileFetcher::TileFetcher(QObject* parent)
+ : QObject(parent)
+ , network(nullptr)
+{
+#if defined(QT_NETWORK_LIB)
+	network = new QNetworkAccessManager(this);
+	connect(network, &QNetworkAccessManager::finished, this, &TileFetcher::replyFinished);
+#endif
+}
+
+TileFetcher::~TileFetcher()
+{
+	cancelAll();
+}
+
+bool TileFetcher::isSupported()
+{
+#if defined(QT_NETWORK_LIB)
+	return true;
+#else
+	return false;
+#endif
+}
+
+void TileFetcher::request(quint64 key, const QUrl& url, qreal priority)
+{
+	auto found = queued.find(key);
+	if (found != queued.end())
+	{
+		found->second.priority = priority;
+		return;
+	}
+	if (isRequested(key))
+		return;
+
+	queued.insert(std::make_pair(key, Request{ url, priority, false }));
+	startRequests();
+}
+
+void TileFetcher::prefetch(quint64 key, const QUrl& url)
+{
+	auto found = queued.find(key);
+	if (found != queued.end())
+	{
+		found->second.prefetch = true;
+		return;
+	}
+	if (isRequested(key))
+		return;
+
+	queued.insert(std::make_pair(key, Request{ url, 0.0, true }));
+	startRequests();
+}
+
+bool TileFetcher::isRequested(quint64 key) const
+{
+	if (queued.find(key) != queued.end())
+		return true;
+	return std::any_of(begin(running), end(running), [key](const std::pair<QNetworkReply* const, std::pair<quint64, Request>>& entry) {
+		return entry.second.first == key;
+	});
+}
+
+int TileFetcher::numRequests() const
+{
+	return int(queued.size() + running.size());
+}
+
+void TileFetcher::cancelUnless(const std::function<bool (quint64)>& keep)
+{
+	for (auto it = queued.begin(); it != queued.end(); )
+	{
+		if (it->second.prefetch || keep(it->first))
+			++it;
+		else
+			it = queued.erase(it);
+	}
+
+	std::vector<QNetworkReply*> cancelled;
+	for (const auto& entry : running)
+	{
+		if (!entry.second.second.prefetch && !keep(entry.second.first))
+			cancelled.push_back(entry.first);
+	}
+#if defined(QT_NETWORK_LIB)
+	// Erase before aborting: The finished signal is emitted synchronously.
+	for (QNetworkReply* reply : cancelled)
+	{
+		running.erase(reply);
+		reply->abort();
+	}
+#endif
+
+	startRequests();
+}
+
+void TileFetcher::cancelAll()
+{
+	queued.clear();
+
+	auto replies = std::move(running);
+	running.clear();
+#if defined(QT_NETWORK_LIB)
+	for (const auto& entry : replies)
+		entry.first->abort();
+#else
+	Q_UNUSED(replies);
+#endif
+}
+
+void TileFetcher::startRequests()
+{
+	while (!queued.empty() && int(running.size()) < max_running_requests)
+	{
+		// Prefetch requests are served last.
+		auto next = std::min_element(begin(queued), end(queued), [](const std::pair<const quint64, Request>& a, const std::pair<const quint64, Request>& b) {
+			return a.second.prefetch != b.second.prefetch ? b.second.prefetch : a.second.priority < b.second.priority;
+		});
+		const auto key = next->first;
+		const auto request = next->second;
+		queued.erase(next);
+
+#if defined(QT_NETWORK_LIB)
+		QNetworkRequest network_request(request.url);
+		// Tile servers ask clients to identify themselves.
+		network_request.setRawHeader("User-Agent", "OpenOrienteering Mapper/" APP_VERSION);
+		running.insert(std::make_pair(network->get(network_request), std::make_pair(key, request)));
+#else
+		emit tileFailed(key, tr("Downloading is not supported in this build."));
+#endif
+	}
+}
+
+void TileFetcher::replyFinished(QNetworkReply* reply)
+{
+#if defined(QT_NETWORK_LIB)
+	reply->deleteLater();
+
+	auto found = running.find(reply);
+	if (found == running.end())
+		return; // cancelled
+
+	const auto key = found->second.first;
+	running.erase(found);
+	if (reply->error() != QNetworkReply::NoError)
+		emit tileFailed(key, reply->errorString());
+	else
+		emit tileFetched(key, reply->readAll());
+
+	startRequests();
+#else
+	Q_UNUSED(reply);
+#endif
+}
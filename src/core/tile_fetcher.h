@@ -0,0 +1,137 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_TILE_FETCHER_H_
+#define _OPENORIENTEERING_TILE_FETCHER_H_
+
+#include <functional>
+#include <unordered_map>
+
+#include <QByteArray>
+#include <QObject>
+#include <QUrl>
+
+QT_BEGIN_NAMESPACE
+class QNetworkAccessManager;
+class QNetworkReply;
+QT_END_NAMESPACE
+
+
+/**
+ * @brief TileFetcher downloads the tiles of an online tile server.
+ *
+ * Tiles are identified by a key which is chosen by the user of the fetcher.
+ * Requests are queued, and a limited number of them is running at a time.
+ * The queued request with the lowest priority value is started first, so
+ * that e.g. the tiles near the center of the view are fetched before the
+ * tiles at the border. Requesting a queued tile again changes its priority.
+ *
+ * Requests which are no longer needed, e.g. for tiles which were scrolled off
+ * screen, can be cancelled. Prefetch requests are started only when there are
+ * no other requests, and they are not cancelled by cancelUnless().
+ *
+ * When Mapper is built without the Qt Network module, all requests fail.
+ *
+ * Synopsis:
+ *
+ * connect(fetcher, &TileFetcher::tileFetched, this, &Foo::tileFetched);
+ * fetcher->request(key, url, distance_to_center);
+ * ...
+ * fetcher->cancelUnless([](quint64 key) { return isVisible(key); });
+ */
+class TileFetcher : public QObject
+{
+Q_OBJECT
+public:
+	/** The maximum number of requests which are running at the same time. */
+	static const int max_running_requests = 6;
+
+	/** Constructs a new fetcher. */
+	explicit TileFetcher(QObject* parent = nullptr);
+
+	/** Destructor. Aborts all running requests. */
+	~TileFetcher() override;
+
+	/** Returns true if tiles can be downloaded in this build. */
+	static bool isSupported();
+
+	/**
+	 * Requests the tile with the given key from the given URL.
+	 *
+	 * Lower priority values are served first. If the tile is already
+	 * requested, only its priority is updated.
+	 */
+	void request(quint64 key, const QUrl& url, qreal priority);
+
+	/**
+	 * Requests the tile with the given key for offline use.
+	 *
+	 * Prefetch requests are served after all other requests,
+	 * and they are not cancelled by cancelUnless().
+	 */
+	void prefetch(quint64 key, const QUrl& url);
+
+	/** Returns true if the tile with the given key is queued or running. */
+	bool isRequested(quint64 key) const;
+
+	/** Returns the number of queued and running requests. */
+	int numRequests() const;
+
+	/**
+	 * Cancels the queued and running requests, except for prefetch requests
+	 * and the requests for which keep(key) returns true.
+	 */
+	void cancelUnless(const std::function<bool (quint64)>& keep);
+
+	/** Cancels all requests, including prefetch requests. */
+	void cancelAll();
+
+signals:
+	/** This signal is emitted when a tile was downloaded. */
+	void tileFetched(quint64 key, const QByteArray& data);
+
+	/** This signal is emitted when a tile could not be downloaded. */
+	void tileFailed(quint64 key, const QString& error_string);
+
+private:
+	struct Request
+	{
+		QUrl url;
+		qreal priority;
+		bool prefetch;
+	};
+
+	/** Starts queued requests while there are free slots. */
+	void startRequests();
+
+	/** Handles a finished reply. */
+	void replyFinished(QNetworkReply* reply);
+
+
+	QNetworkAccessManager* network;
+
+	/** The queued requests. */
+	std::unordered_map<quint64, Request> queued;
+
+	/** The running requests, by reply. */
+	std::unordered_map<QNetworkReply*, std::pair<quint64, Request>> running;
+};
+
+#endif
@@ -0,0 +1,263 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tiled_image.h"
+
+#include <QDebug>
+#include <QImageIOHandler>
+#include <QImageReader>
+#include <QPainter>
+#include <qmath.h>
+
+
+// ### TiledImage ###
+
+bool TiledImage::canLoad(QImageReader& reader)
+{
+	return reader.supportsOption(QImageIOHandler::ClipRect) &&
+	       reader.supportsOption(QImageIOHandler::ScaledSize) &&
+	       reader.size().isValid();
+}
+
+inline
+TiledImage::TileKey TiledImage::key(int x, int y)
+{
+	return (TileKey(std::uint32_t(x)) << 32) | TileKey(std::uint32_t(y));
+}
+
+TiledImage::TiledImage(const QString& path)
+ : path(path)
+ , memory_limit(qint64(256) << 20)
+ , memory_usage(0)
+ , draw_counter(0)
+{
+	; // nothing
+}
+
+TiledImage::~TiledImage()
+{
+	; // nothing
+}
+
+bool TiledImage::load()
+{
+	clearTiles();
+	overview_image = QImage();
+
+	QImageReader reader(path);
+	image_size = reader.size();
+	if (image_size.isEmpty())
+	{
+		error_string = reader.errorString();
+		return false;
+	}
+
+	QSize scaled_size = image_size;
+	if (scaled_size.width() > overview_size || scaled_size.height() > overview_size)
+		scaled_size.scale(overview_size, overview_size, Qt::KeepAspectRatio);
+	const QString overview_name = QString::fromLatin1("overview-%1x%2").arg(scaled_size.width()).arg(scaled_size.height());
+	overview_image = disk_cache.restore(overview_name);
+	if (overview_image.size() == scaled_size)
+		return true;
+
+	reader.setScaledSize(scaled_size);
+	overview_image = reader.read();
+	if (overview_image.isNull())
+	{
+		error_string = reader.errorString();
+		return false;
+	}
+	disk_cache.save(overview_name, overview_image);
+
+	return true;
+}
+
+void TiledImage::setMemoryLimit(qint64 bytes)
+{
+	memory_limit = bytes;
+	evictTiles();
+}
+
+void TiledImage::clearTiles()
+{
+	tiles.clear();
+	memory_usage = 0;
+}
+
+void TiledImage::setDiskCache(const DecodedImageCache& cache)
+{
+	disk_cache = cache;
+}
+
+void TiledImage::draw(QPainter* painter, const QPointF& origin, const QRectF& clip_rect) const
+{
+	if (overview_image.isNull())
+		return;
+
+	++draw_counter;
+
+	const QRectF image_rect(origin, QSizeF(image_size));
+	const qreal overview_scale_x = qreal(image_size.width()) / overview_image.width();
+	const qreal overview_scale_y = qreal(image_size.height()) / overview_image.height();
+	const qreal resolution = qSqrt(qAbs(painter->worldTransform().determinant()));
+	if (resolution * qMax(overview_scale_x, overview_scale_y) <= 1.0)
+	{
+		// The overview offers enough detail.
+		painter->drawImage(image_rect, overview_image);
+		return;
+	}
+
+	QRectF rect = image_rect;
+	if (clip_rect.isValid())
+		rect = rect.intersected(clip_rect.adjusted(-1.0, -1.0, 1.0, 1.0));
+	if (rect.isEmpty())
+		return;
+	rect.translate(-origin);
+
+	const int first_x = qFloor(rect.left() / tile_size);
+	const int first_y = qFloor(rect.top() / tile_size);
+	const int last_x  = qMax(first_x, qMin(qCeil(rect.right() / tile_size), (image_size.width() + tile_size - 1) / tile_size) - 1);
+	const int last_y  = qMax(first_y, qMin(qCeil(rect.bottom() / tile_size), (image_size.height() + tile_size - 1) / tile_size) - 1);
+
+	const qint64 needed_memory = qint64(last_x - first_x + 1) * (last_y - first_y + 1) * tile_size * tile_size * 4;
+	if (needed_memory > memory_limit)
+	{
+		// The visible tiles do not fit into the memory limit.
+		painter->drawImage(image_rect, overview_image);
+		return;
+	}
+
+	for (int y = first_y; y <= last_y; ++y)
+	{
+		// Decode each run of missing tiles in one pass.
+		int x = first_x;
+		while (x <= last_x)
+		{
+			if (tiles.find(key(x, y)) != tiles.end())
+			{
+				++x;
+				continue;
+			}
+			int run_end = x;
+			while (run_end < last_x && tiles.find(key(run_end + 1, y)) == tiles.end())
+				++run_end;
+			loadTiles(x, run_end, y);
+			x = run_end + 1;
+		}
+
+		for (x = first_x; x <= last_x; ++x)
+		{
+			const QRectF target(origin.x() + x * tile_size, origin.y() + y * tile_size, tile_size, tile_size);
+			auto tile = tiles.find(key(x, y));
+			if (tile != tiles.end())
+			{
+				tile->second.last_use = draw_counter;
+				painter->drawImage(target.topLeft(), tile->second.image);
+			}
+			else
+			{
+				// Decoding failed. Fall back to the overview.
+				const QRectF source((target.left() - origin.x()) / overview_scale_x,
+				                    (target.top() - origin.y()) / overview_scale_y,
+				                    tile_size / overview_scale_x,
+				                    tile_size / overview_scale_y);
+				painter->drawImage(target.intersected(image_rect),
+				                   overview_image,
+				                   source.intersected(QRectF(overview_image.rect())));
+			}
+		}
+	}
+
+	evictTiles();
+}
+
+void TiledImage::loadTiles(int first_x, int last_x, int y) const
+{
+	// Restore cached tiles from both ends of the run.
+	const auto restoreTile = [this, y](int x) -> bool {
+		const QImage image = disk_cache.restore(tileName(x, y));
+		if (image.isNull())
+			return false;
+		Tile& tile = tiles[key(x, y)];
+		tile.image = image;
+		tile.last_use = draw_counter;
+		memory_usage += tile.image.byteCount();
+		return true;
+	};
+	while (first_x <= last_x && restoreTile(first_x))
+		++first_x;
+	while (first_x <= last_x && restoreTile(last_x))
+		--last_x;
+	if (first_x > last_x)
+		return;
+
+	const QRect rect = QRect(first_x * tile_size, y * tile_size, (last_x - first_x + 1) * tile_size, tile_size)
+	                   .intersected(QRect(QPoint(0, 0), image_size));
+	if (rect.isEmpty())
+		return;
+
+	QImageReader reader(path);
+	reader.setClipRect(rect);
+	const QImage strip = reader.read();
+	if (strip.isNull())
+	{
+		qDebug() << "TiledImage: Failed to decode" << rect << "from" << path << ":" << reader.errorString();
+		return;
+	}
+
+	for (int x = first_x; x <= last_x; ++x)
+	{
+		const QRect tile_rect = QRect((x - first_x) * tile_size, 0, tile_size, tile_size).intersected(strip.rect());
+		if (tile_rect.isEmpty())
+			break;
+		Tile& tile = tiles[key(x, y)];
+		memory_usage -= tile.image.byteCount();
+		tile.image = strip.copy(tile_rect);
+		tile.last_use = draw_counter;
+		memory_usage += tile.image.byteCount();
+		disk_cache.save(tileName(x, y), tile.image);
+	}
+}
+
+QString TiledImage::tileName(int x, int y)
+{
+	return QString::fromLatin1("tile-%1-%2-%3").arg(tile_size).arg(x).arg(y);
+}
+
+void TiledImage::evictTiles() const
+{
+	while (memory_usage > memory_limit)
+	{
+		auto least_recently_used = tiles.end();
+		for (auto tile = tiles.begin(); tile != tiles.end(); ++tile)
+		{
+			if (tile->second.last_use < draw_counter &&
+			    (least_recently_used == tiles.end() || tile->second.last_use < least_recently_used->second.last_use))
+			{
+				least_recently_used = tile;
+			}
+		}
+		if (least_recently_used == tiles.end())
+			break; // Only tiles which are in use
+
+		memory_usage -= least_recently_used->second.image.byteCount();
+		tiles.erase(least_recently_used);
+	}
+}
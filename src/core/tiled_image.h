@@ -0,0 +1,203 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_TILED_IMAGE_H_
+#define _OPENORIENTEERING_TILED_IMAGE_H_
+
+#include <cstdint>
+#include <map>
+
+#include <QImage>
+#include <QString>
+
+#include "decoded_image_cache.h"
+
+QT_BEGIN_NAMESPACE
+class QImageReader;
+class QPainter;
+class QPointF;
+class QRect;
+class QRectF;
+QT_END_NAMESPACE
+
+
+/**
+ * A raster image file which is decoded in tiles, on demand.
+ *
+ * Only a low-resolution overview of the image is kept in memory permanently.
+ * Tiles of the full resolution image are decoded from the file when they are
+ * needed for drawing. The memory used by the decoded tiles is limited, and
+ * the least recently used tiles are discarded when the limit is exceeded.
+ *
+ * The overview and the tiles may also be stored in a DecodedImageCache,
+ * so that they need not be decoded again when the image is loaded again.
+ *
+ * This is meant for images which are too large to be decoded completely.
+ * It requires an image format plugin which can decode parts of an image, and
+ * which can decode the image at reduced size (such as JPEG).
+ *
+ * Synopsis:
+ *
+ * QImageReader reader(path);
+ * if (TiledImage::canLoad(reader))
+ * {
+ *     TiledImage tiled_image(path);
+ *     if (tiled_image.load())
+ *         tiled_image.draw(painter, origin, clip_rect);
+ * }
+ */
+class TiledImage
+{
+public:
+	/** The width and height of the tiles, in pixels. */
+	static const int tile_size = 512;
+
+	/** The maximum width and height of the overview, in pixels. */
+	static const int overview_size = 2048;
+
+	/**
+	 * Returns true if the reader's image can be loaded by tiles.
+	 */
+	static bool canLoad(QImageReader& reader);
+
+	/**
+	 * Constructs a tiled image for the given file.
+	 *
+	 * The file is not accessed until load() is called.
+	 */
+	explicit TiledImage(const QString& path);
+
+	/** Destructor. */
+	~TiledImage();
+
+	/**
+	 * Determines the image size and decodes the overview.
+	 *
+	 * Returns false on error. In this case, errorString() gives the reason.
+	 */
+	bool load();
+
+	/** Returns a description of the last error. */
+	QString errorString() const;
+
+	/** Returns the size of the full resolution image. */
+	QSize size() const;
+
+	/** Returns the low-resolution overview of the image. */
+	const QImage& overview() const;
+
+	/**
+	 * Sets the maximum amount of memory to be used for decoded tiles.
+	 *
+	 * The tiles which are needed for a single draw() call are kept even if
+	 * they exceed the limit. If the visible tiles cannot fit into the limit,
+	 * draw() uses the overview instead.
+	 */
+	void setMemoryLimit(qint64 bytes);
+
+	/** Returns the memory used by the decoded tiles, in bytes. */
+	qint64 memoryUsage() const;
+
+	/** Discards all decoded tiles. */
+	void clearTiles();
+
+	/**
+	 * Sets the persistent cache for the overview and for the tiles.
+	 *
+	 * This must be called before load().
+	 */
+	void setDiskCache(const DecodedImageCache& cache);
+
+	/**
+	 * Draws the image.
+	 *
+	 * The painter's transformation must be set up for the full resolution
+	 * image's pixel coordinates, relative to the given origin. The clip rect
+	 * is given in the same coordinates.
+	 */
+	void draw(QPainter* painter, const QPointF& origin, const QRectF& clip_rect) const;
+
+private:
+	typedef std::uint64_t TileKey;
+
+	struct Tile
+	{
+		QImage image;
+		std::uint64_t last_use;
+	};
+
+	static TileKey key(int x, int y);
+
+	/** Returns the name of the tile in the disk cache. */
+	static QString tileName(int x, int y);
+
+	/**
+	 * Decodes the tiles from first_x to last_x in row y.
+	 */
+	void loadTiles(int first_x, int last_x, int y) const;
+
+	/**
+	 * Discards least recently used tiles until the memory limit is met,
+	 * except for the tiles which were used by the current draw() call.
+	 */
+	void evictTiles() const;
+
+
+	QString path;
+	QString error_string;
+	QSize image_size;
+	QImage overview_image;
+	qint64 memory_limit;
+	DecodedImageCache disk_cache;
+
+	mutable std::map<TileKey, Tile> tiles;
+	mutable qint64 memory_usage;
+	mutable std::uint64_t draw_counter;
+};
+
+
+
+// ### TiledImage inline code ###
+
+inline
+QString TiledImage::errorString() const
+{
+	return error_string;
+}
+
+inline
+QSize TiledImage::size() const
+{
+	return image_size;
+}
+
+inline
+const QImage& TiledImage::overview() const
+{
+	return overview_image;
+}
+
+inline
+qint64 TiledImage::memoryUsage() const
+{
+	return memory_usage;
+}
+
+#endif
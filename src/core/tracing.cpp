@@ -0,0 +1,154 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tracing.h"
+
+#include <vector>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QIODevice>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+
+
+namespace
+{
+	/** A recorded event. */
+	struct TraceEvent
+	{
+		const char* category;
+		const char* name;
+		quintptr thread;
+		qint64 timestamp;
+		qint64 value;    ///< The duration of a scope, or the value of a counter
+		bool is_counter;
+	};
+
+	QMutex mutex;
+	QElapsedTimer clock;
+	std::vector<TraceEvent> events;
+	std::size_t dropped_events = 0;
+
+	void addEvent(const TraceEvent& event)
+	{
+		QMutexLocker locker(&mutex);
+		if (events.size() < Tracing::max_events)
+			events.push_back(event);
+		else
+			++dropped_events;
+	}
+
+	/** Writes a JSON string literal. */
+	void writeString(QTextStream& stream, const char* string)
+	{
+		stream << '"';
+		for (const char* c = string; *c; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+				stream << '\\';
+			stream << *c;
+		}
+		stream << '"';
+	}
+}
+
+
+
+// ### Tracing ###
+
+const std::size_t Tracing::max_events;
+
+QAtomicInt Tracing::recording(0);
+
+void Tracing::start()
+{
+	QMutexLocker locker(&mutex);
+	events.clear();
+	dropped_events = 0;
+	clock.start();
+	recording.store(1);
+}
+
+void Tracing::stop()
+{
+	recording.store(0);
+}
+
+std::size_t Tracing::numEvents()
+{
+	QMutexLocker locker(&mutex);
+	return events.size();
+}
+
+std::size_t Tracing::numDroppedEvents()
+{
+	QMutexLocker locker(&mutex);
+	return dropped_events;
+}
+
+qint64 Tracing::now()
+{
+	return clock.nsecsElapsed() / 1000;
+}
+
+void Tracing::addScope(const char* category, const char* name, qint64 start, qint64 duration)
+{
+	addEvent({ category, name, quintptr(QThread::currentThreadId()), start, duration, false });
+}
+
+void Tracing::addCounter(const char* category, const char* name, qint64 value)
+{
+	addEvent({ category, name, quintptr(QThread::currentThreadId()), now(), value, true });
+}
+
+bool Tracing::writeChromeTrace(QIODevice* device)
+{
+	QMutexLocker locker(&mutex);
+
+	const qint64 pid = QCoreApplication::applicationPid();
+	QTextStream stream(device);
+	stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (const auto& event : events)
+	{
+		if (!first)
+			stream << ",\n";
+		first = false;
+
+		stream << "{\"cat\":";
+		writeString(stream, event.category);
+		stream << ",\"name\":";
+		writeString(stream, event.name);
+		stream << ",\"pid\":" << pid
+		       << ",\"tid\":" << event.thread
+		       << ",\"ts\":" << event.timestamp;
+		if (event.is_counter)
+			stream << ",\"ph\":\"C\",\"args\":{\"value\":" << event.value << "}}";
+		else
+			stream << ",\"ph\":\"X\",\"dur\":" << event.value << '}';
+	}
+	stream << "]}\n";
+
+	stream.flush();
+	return stream.status() == QTextStream::Ok;
+}
@@ -0,0 +1,167 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_TRACING_H_
+#define _OPENORIENTEERING_TRACING_H_
+
+#include <cstddef>
+
+#include <QAtomicInt>
+#include <QtGlobal>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+
+/**
+ * Records a trace of timed scopes and counters, for performance analysis.
+ * 
+ * Code is instrumented with the macros MAPPER_TRACE_SCOPE and
+ * MAPPER_TRACE_COUNTER. When MAPPER_TRACING is not defined (i.e. when the
+ * build option Mapper_TRACING is off), these macros expand to nothing.
+ * Otherwise, they cost a single atomic load while no trace is recorded.
+ * 
+ * The recorded events are written in the Chrome trace event format (JSON),
+ * which can be viewed in chrome://tracing.
+ * 
+ * Category and name must be string literals (or other strings which are
+ * valid until the trace is written).
+ * 
+ * Synopsis:
+ * 
+ * void Object::update()
+ * {
+ *     MAPPER_TRACE_SCOPE("object", "Object::update");
+ *     ...
+ * }
+ * 
+ * Tracing::start();
+ * ...
+ * Tracing::stop();
+ * Tracing::writeChromeTrace(&file);
+ */
+class Tracing
+{
+public:
+	/** The maximum number of events in a trace. Further events are dropped. */
+	static const std::size_t max_events = 2000000;
+
+	/** Returns true while a trace is recorded. */
+	static bool isRecording();
+
+	/** Discards the previous trace, and starts recording a new one. */
+	static void start();
+
+	/** Stops recording. The trace is kept until the next start(). */
+	static void stop();
+
+	/** Returns the number of recorded events. */
+	static std::size_t numEvents();
+
+	/** Returns the number of events which were dropped. */
+	static std::size_t numDroppedEvents();
+
+	/** Returns the time since the start of the trace, in microseconds. */
+	static qint64 now();
+
+	/** Records a scope with the given start and duration, in microseconds. */
+	static void addScope(const char* category, const char* name, qint64 start, qint64 duration);
+
+	/** Records the current value of a counter. */
+	static void addCounter(const char* category, const char* name, qint64 value);
+
+	/**
+	 * Writes the recorded trace in the Chrome trace event format.
+	 * 
+	 * Returns false on error.
+	 */
+	static bool writeChromeTrace(QIODevice* device);
+
+private:
+	static QAtomicInt recording;
+};
+
+
+/**
+ * Records the lifetime of an object as a scope in the trace.
+ * 
+ * Normally used via MAPPER_TRACE_SCOPE.
+ */
+class TraceScope
+{
+public:
+	TraceScope(const char* category, const char* name);
+	~TraceScope();
+
+private:
+	Q_DISABLE_COPY(TraceScope)
+
+	const char* const category;
+	const char* const name;
+	const qint64 start;
+};
+
+
+#ifdef MAPPER_TRACING
+#  define MAPPER_TRACE_CONCAT_(a, b) a ## b
+#  define MAPPER_TRACE_CONCAT(a, b) MAPPER_TRACE_CONCAT_(a, b)
+/** Records the rest of the current block as a scope in the trace. */
+#  define MAPPER_TRACE_SCOPE(category, name) \
+	const TraceScope MAPPER_TRACE_CONCAT(mapper_trace_scope_, __LINE__)(category, name)
+/** Records the current value of a counter in the trace. */
+#  define MAPPER_TRACE_COUNTER(category, name, value) \
+	do { if (Tracing::isRecording()) Tracing::addCounter(category, name, value); } while (false)
+#else
+#  define MAPPER_TRACE_SCOPE(category, name)
+#  define MAPPER_TRACE_COUNTER(category, name, value) do { } while (false)
+#endif
+
+
+
+// ### Tracing inline code ###
+
+inline
+bool Tracing::isRecording()
+{
+	return recording.load() != 0;
+}
+
+
+
+// ### TraceScope inline code ###
+
+inline
+TraceScope::TraceScope(const char* category, const char* name)
+ : category(category)
+ , name(name)
+ , start(Tracing::isRecording() ? Tracing::now() : -1)
+{
+	// nothing
+}
+
+inline
+TraceScope::~TraceScope()
+{
+	if (start >= 0 && Tracing::isRecording())
+		Tracing::addScope(category, name, start, Tracing::now() - start);
+}
+
+#endif
@@ -0,0 +1,731 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "vector_tile_writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include <QColor>
+#include <QPaintDevice>
+#include <QPaintEngine>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPainterPathStroker>
+#include <QPolygonF>
+#include <QTransform>
+
+#include "map_color.h"
+#include "../map.h"
+#include "../object.h"
+#include "../renderable.h"
+#include "../symbol.h"
+
+
+namespace
+{
+	/** Protocol buffer wire types */
+	enum WireType : quint32
+	{
+		Varint          = 0,
+		Fixed64         = 1,
+		LengthDelimited = 2,
+	};
+
+	/** Vector tile geometry commands */
+	enum Command : quint32
+	{
+		MoveTo    = 1,
+		LineTo    = 2,
+		ClosePath = 7,
+	};
+
+	/** Appends a base 128 varint. */
+	void appendVarint(QByteArray& data, quint64 value)
+	{
+		while (value >= 0x80)
+		{
+			data.append(char((value & 0x7f) | 0x80));
+			value >>= 7;
+		}
+		data.append(char(value));
+	}
+
+	/** Appends the key of a field. */
+	void appendKey(QByteArray& data, quint32 field, WireType type)
+	{
+		appendVarint(data, (field << 3) | type);
+	}
+
+	void appendVarintField(QByteArray& data, quint32 field, quint64 value)
+	{
+		appendKey(data, field, Varint);
+		appendVarint(data, value);
+	}
+
+	void appendBytesField(QByteArray& data, quint32 field, const QByteArray& value)
+	{
+		appendKey(data, field, LengthDelimited);
+		appendVarint(data, quint64(value.size()));
+		data.append(value);
+	}
+
+	void appendPackedField(QByteArray& data, quint32 field, const std::vector<quint32>& values)
+	{
+		if (values.empty())
+			return;
+
+		QByteArray packed;
+		for (auto value : values)
+			appendVarint(packed, value);
+		appendBytesField(data, field, packed);
+	}
+
+	/** Returns an encoded Value message holding a string. */
+	QByteArray stringValue(const QString& string)
+	{
+		QByteArray value;
+		appendBytesField(value, 1, string.toUtf8());
+		return value;
+	}
+
+	/** Returns an encoded Value message holding a double. */
+	QByteArray doubleValue(double number)
+	{
+		quint64 bits;
+		static_assert(sizeof(bits) == sizeof(number), "double must have 64 bits");
+		std::memcpy(&bits, &number, sizeof(bits));
+
+		QByteArray value;
+		appendKey(value, 3, Fixed64);
+		for (int i = 0; i < 8; ++i)
+		{
+			value.append(char(bits & 0xff));
+			bits >>= 8;
+		}
+		return value;
+	}
+
+	/** Returns an encoded Value message holding an integer. */
+	QByteArray intValue(qint64 number)
+	{
+		QByteArray value;
+		appendVarintField(value, 4, quint64(number));
+		return value;
+	}
+
+	quint32 commandInteger(Command id, quint32 count)
+	{
+		return (id & 0x7) | (count << 3);
+	}
+
+	quint32 zigzag(qint32 value)
+	{
+		return (quint32(value) << 1) ^ quint32(value >> 31);
+	}
+
+	/** Appends the commands for the points to a feature's geometry. */
+	void appendPoints(std::vector<quint32>& geometry, QPoint& cursor, const std::vector<QPoint>& points, bool closed)
+	{
+		geometry.push_back(commandInteger(MoveTo, 1));
+		geometry.push_back(zigzag(points.front().x() - cursor.x()));
+		geometry.push_back(zigzag(points.front().y() - cursor.y()));
+		geometry.push_back(commandInteger(LineTo, quint32(points.size() - 1)));
+		for (std::size_t i = 1; i < points.size(); ++i)
+		{
+			geometry.push_back(zigzag(points[i].x() - points[i-1].x()));
+			geometry.push_back(zigzag(points[i].y() - points[i-1].y()));
+		}
+		cursor = points.back();
+		if (closed)
+			geometry.push_back(commandInteger(ClosePath, 1));
+	}
+
+	/**
+	 * Simplifies the line (Douglas-Peucker) and quantizes it to the integer grid.
+	 *
+	 * Consecutive duplicate points are removed.
+	 */
+	std::vector<QPoint> simplified(const QPolygonF& line, qreal tolerance)
+	{
+		std::vector<QPoint> result;
+		const int size = line.size();
+		if (size < 2)
+			return result;
+
+		std::vector<bool> keep(size, false);
+		keep.front() = keep.back() = true;
+		std::vector<std::pair<int, int>> ranges = { { 0, size - 1 } };
+		const qreal tolerance_squared = tolerance * tolerance;
+		while (!ranges.empty())
+		{
+			const auto range = ranges.back();
+			ranges.pop_back();
+
+			const QPointF& start = line[range.first];
+			const QPointF segment = line[range.second] - start;
+			const qreal length_squared = QPointF::dotProduct(segment, segment);
+			qreal max_distance_squared = 0.0;
+			int farthest = -1;
+			for (int i = range.first + 1; i < range.second; ++i)
+			{
+				const QPointF offset = line[i] - start;
+				qreal distance_squared;
+				if (length_squared == 0.0)
+				{
+					distance_squared = QPointF::dotProduct(offset, offset);
+				}
+				else
+				{
+					const qreal cross = segment.x() * offset.y() - segment.y() * offset.x();
+					distance_squared = cross * cross / length_squared;
+				}
+				if (distance_squared > max_distance_squared)
+				{
+					max_distance_squared = distance_squared;
+					farthest = i;
+				}
+			}
+			if (farthest >= 0 && max_distance_squared > tolerance_squared)
+			{
+				keep[farthest] = true;
+				ranges.push_back({ range.first, farthest });
+				ranges.push_back({ farthest, range.second });
+			}
+		}
+
+		for (int i = 0; i < size; ++i)
+		{
+			if (keep[i])
+			{
+				const QPoint point = line[i].toPoint();
+				if (result.empty() || result.back() != point)
+					result.push_back(point);
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * Returns twice the signed area of the ring.
+	 *
+	 * The area is positive for rings which are clockwise when the y axis
+	 * points downwards, i.e. for exterior rings of vector tile polygons.
+	 */
+	qint64 signedArea(const std::vector<QPoint>& ring)
+	{
+		qint64 area = 0;
+		for (std::size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++)
+			area += qint64(ring[j].x()) * ring[i].y() - qint64(ring[i].x()) * ring[j].y();
+		return area;
+	}
+
+	/** Clips the segment to the rectangle (Liang-Barsky). Returns false if nothing remains. */
+	bool clipSegment(QPointF& a, QPointF& b, const QRectF& rect)
+	{
+		const qreal dx = b.x() - a.x();
+		const qreal dy = b.y() - a.y();
+		const qreal p[4] = { -dx, dx, -dy, dy };
+		const qreal q[4] = { a.x() - rect.left(), rect.right() - a.x(), a.y() - rect.top(), rect.bottom() - a.y() };
+		qreal t0 = 0.0;
+		qreal t1 = 1.0;
+		for (int i = 0; i < 4; ++i)
+		{
+			if (p[i] == 0.0)
+			{
+				if (q[i] < 0.0)
+					return false;
+				continue;
+			}
+
+			const qreal t = q[i] / p[i];
+			if (p[i] < 0.0)
+			{
+				if (t > t1)
+					return false;
+				t0 = qMax(t0, t);
+			}
+			else
+			{
+				if (t < t0)
+					return false;
+				t1 = qMin(t1, t);
+			}
+		}
+
+		const QPointF start = a;
+		if (t1 < 1.0)
+			b = start + QPointF(dx * t1, dy * t1);
+		if (t0 > 0.0)
+			a = start + QPointF(dx * t0, dy * t0);
+		return true;
+	}
+
+	/** Appends the parts of the line which are inside the rectangle. */
+	void clipLine(const QPolygonF& line, const QRectF& rect, std::vector<QPolygonF>& parts)
+	{
+		QPolygonF current;
+		for (int i = 1; i < line.size(); ++i)
+		{
+			QPointF a = line[i-1];
+			QPointF b = line[i];
+			if (!clipSegment(a, b, rect))
+			{
+				if (current.size() > 1)
+					parts.push_back(current);
+				current.clear();
+				continue;
+			}
+
+			if (current.isEmpty() || current.back() != a)
+			{
+				if (current.size() > 1)
+					parts.push_back(current);
+				current.clear();
+				current << a;
+			}
+			current << b;
+		}
+		if (current.size() > 1)
+			parts.push_back(current);
+	}
+
+	/** Returns true if the rectangles overlap, even if one of them has no width or height. */
+	bool overlaps(const QRectF& a, const QRectF& b)
+	{
+		return a.left() <= b.right() && b.left() <= a.right()
+		       && a.top() <= b.bottom() && b.top() <= a.bottom();
+	}
+
+	/** Returns the area of the tile which is encoded, in tile units. */
+	QRectF bufferedTile()
+	{
+		return QRectF(-VectorTileWriter::buffer, -VectorTileWriter::buffer,
+		              VectorTileWriter::extent + 2 * VectorTileWriter::buffer,
+		              VectorTileWriter::extent + 2 * VectorTileWriter::buffer);
+	}
+}
+
+
+
+// ### VectorTileWriter::PaintEngine ###
+
+/**
+ * A paint engine which passes filled and stroked paths to the writer.
+ *
+ * The paths are passed in tile units. Images are ignored.
+ */
+class VectorTileWriter::PaintEngine : public QPaintEngine
+{
+public:
+	explicit PaintEngine(VectorTileWriter& writer)
+	 : QPaintEngine(QPaintEngine::AllFeatures)
+	 , writer(writer)
+	 , clip_enabled(false)
+	{
+		; // nothing
+	}
+
+	bool begin(QPaintDevice*) override
+	{
+		return true;
+	}
+
+	bool end() override
+	{
+		return true;
+	}
+
+	Type type() const override
+	{
+		return QPaintEngine::User;
+	}
+
+	void updateState(const QPaintEngineState& state) override
+	{
+		const auto flags = state.state();
+		if (flags & DirtyTransform)
+			transform = state.transform();
+		if (flags & DirtyPen)
+			pen = state.pen();
+		if (flags & DirtyBrush)
+			brush = state.brush();
+		if (flags & DirtyClipPath)
+		{
+			updateClip(state.clipOperation(), transform.map(state.clipPath()));
+		}
+		if (flags & DirtyClipRegion)
+		{
+			QPainterPath region;
+			region.addRegion(state.clipRegion());
+			updateClip(state.clipOperation(), transform.map(region));
+		}
+		if (flags & DirtyClipEnabled)
+			clip_enabled = state.isClipEnabled();
+	}
+
+	void drawPath(const QPainterPath& path) override
+	{
+		const QPainterPath mapped = transform.map(path);
+		if (brush.style() != Qt::NoBrush)
+			writer.addPolygons(clip_enabled ? mapped.intersected(clip) : mapped);
+
+		if (pen.style() != Qt::NoPen)
+		{
+			const qreal scale = std::sqrt(std::abs(transform.determinant()));
+			const qreal width = pen.isCosmetic() ? qMax(qreal(1.0), pen.widthF()) : pen.widthF() * scale;
+			if (clip_enabled)
+			{
+				// A clipped line is encoded as the area it covers.
+				QPainterPathStroker stroker;
+				stroker.setWidth(width);
+				stroker.setCapStyle(pen.capStyle());
+				stroker.setJoinStyle(pen.joinStyle());
+				stroker.setMiterLimit(pen.miterLimit());
+				writer.addPolygons(stroker.createStroke(mapped).intersected(clip));
+			}
+			else
+			{
+				writer.addLines(mapped, width);
+			}
+		}
+	}
+
+	using QPaintEngine::drawPolygon;
+
+	void drawPolygon(const QPointF* points, int point_count, PolygonDrawMode mode) override
+	{
+		if (point_count < 2)
+			return;
+
+		QPainterPath path(points[0]);
+		for (int i = 1; i < point_count; ++i)
+			path.lineTo(points[i]);
+
+		if (mode == PolylineMode)
+		{
+			const QBrush fill = brush;
+			brush = Qt::NoBrush;
+			drawPath(path);
+			brush = fill;
+			return;
+		}
+
+		path.closeSubpath();
+		path.setFillRule((mode == WindingMode) ? Qt::WindingFill : Qt::OddEvenFill);
+		drawPath(path);
+	}
+
+	void drawPixmap(const QRectF&, const QPixmap&, const QRectF&) override
+	{
+		; // nothing
+	}
+
+private:
+	void updateClip(Qt::ClipOperation operation, const QPainterPath& path)
+	{
+		switch (operation)
+		{
+		case Qt::NoClip:
+			clip = QPainterPath();
+			clip_enabled = false;
+			break;
+		case Qt::ReplaceClip:
+			clip = path;
+			break;
+		case Qt::IntersectClip:
+			clip = clip.intersected(path);
+			break;
+		}
+	}
+
+	VectorTileWriter& writer;
+	QTransform transform;
+	QPen pen;
+	QBrush brush;
+	QPainterPath clip;
+	bool clip_enabled;
+};
+
+
+
+// ### VectorTileWriter::PaintDevice ###
+
+/**
+ * A paint device of the size of the tile, in tile units.
+ */
+class VectorTileWriter::PaintDevice : public QPaintDevice
+{
+public:
+	explicit PaintDevice(VectorTileWriter& writer)
+	 : engine(writer)
+	{
+		; // nothing
+	}
+
+	QPaintEngine* paintEngine() const override
+	{
+		return &engine;
+	}
+
+protected:
+	int metric(PaintDeviceMetric metric) const override
+	{
+		switch (metric)
+		{
+		case PdmWidth:
+		case PdmHeight:
+			return extent;
+		case PdmWidthMM:
+		case PdmHeightMM:
+			return qRound(extent * 25.4 / 96);
+		case PdmNumColors:
+			return std::numeric_limits<int>::max();
+		case PdmDepth:
+			return 32;
+		case PdmDpiX:
+		case PdmDpiY:
+		case PdmPhysicalDpiX:
+		case PdmPhysicalDpiY:
+			return 96;
+		default:
+			return QPaintDevice::metric(metric);
+		}
+	}
+
+private:
+	mutable PaintEngine engine;
+};
+
+
+
+// ### VectorTileWriter ###
+
+VectorTileWriter::VectorTileWriter(qreal tolerance)
+ : tolerance(tolerance)
+{
+	; // nothing
+}
+
+VectorTileWriter::~VectorTileWriter()
+{
+	; // nothing
+}
+
+void VectorTileWriter::addObjects(Map& map, const RenderConfig& config, const QTransform& transform)
+{
+	PaintDevice device(*this);
+	QPainter painter(&device);
+	painter.setTransform(transform);
+	map.drawObjectsSeparately(&painter, config, [this](const Object* object, const MapColor* color) {
+		beginObject(object, color);
+	});
+	painter.end();
+}
+
+bool VectorTileWriter::isEmpty() const
+{
+	return features.empty();
+}
+
+QByteArray VectorTileWriter::data() const
+{
+	QByteArray layer;
+	appendVarintField(layer, 15, 2);  // Version
+	appendBytesField(layer, 1, "map");  // Name
+	for (const auto& feature : features)
+	{
+		QByteArray data;
+		appendPackedField(data, 2, feature.tags);
+		appendVarintField(data, 3, feature.type);
+		appendPackedField(data, 4, feature.geometry);
+		appendBytesField(layer, 2, data);
+	}
+	for (const auto& key : keys)
+		appendBytesField(layer, 3, key);
+	for (const auto& value : values)
+		appendBytesField(layer, 4, value);
+	appendVarintField(layer, 5, extent);
+
+	QByteArray tile;
+	appendBytesField(tile, 3, layer);
+	return tile;
+}
+
+void VectorTileWriter::beginObject(const Object* object, const MapColor* color)
+{
+	object_tags.clear();
+	if (const Symbol* symbol = object->getSymbol())
+	{
+		object_tags.push_back(keyIndex("symbol"));
+		object_tags.push_back(valueIndex(stringValue(symbol->getNumberAsString())));
+		object_tags.push_back(keyIndex("symbol_name"));
+		object_tags.push_back(valueIndex(stringValue(symbol->getPlainTextName())));
+	}
+	if (color)
+	{
+		object_tags.push_back(keyIndex("color"));
+		object_tags.push_back(valueIndex(stringValue(color->getName())));
+		object_tags.push_back(keyIndex("rgb"));
+		object_tags.push_back(valueIndex(stringValue(static_cast<const QColor&>(*color).name())));
+		object_tags.push_back(keyIndex("priority"));
+		object_tags.push_back(valueIndex(intValue(color->getPriority())));
+	}
+}
+
+void VectorTileWriter::addPolygons(const QPainterPath& path)
+{
+	const QRectF tile_rect = bufferedTile();
+	const QRectF bounds = path.controlPointRect();
+	if (!overlaps(bounds, tile_rect))
+		return;
+
+	// Holes are determined by containment below,
+	// so the path must not have intersecting subpaths.
+	QPainterPath area;
+	if (tile_rect.contains(bounds))
+	{
+		area = path.simplified();
+	}
+	else
+	{
+		QPainterPath tile;
+		tile.addRect(tile_rect);
+		area = path.intersected(tile).simplified();
+	}
+
+	struct Ring
+	{
+		QPolygonF polygon;
+		std::vector<QPoint> points;
+		qint64 area;
+		int depth;
+		int parent;
+	};
+	std::vector<Ring> rings;
+	for (const auto& polygon : area.toSubpathPolygons())
+	{
+		auto points = simplified(polygon, tolerance);
+		if (points.size() > 1 && points.front() == points.back())
+			points.pop_back();
+		if (points.size() < 3)
+			continue;
+
+		const qint64 ring_area = signedArea(points);
+		if (ring_area != 0)
+			rings.push_back({ polygon, std::move(points), ring_area, 0, -1 });
+	}
+	if (rings.empty())
+		return;
+
+	// The parent of a ring is the smallest ring which contains it.
+	for (std::size_t i = 0; i < rings.size(); ++i)
+	{
+		auto& ring = rings[i];
+		for (std::size_t j = 0; j < rings.size(); ++j)
+		{
+			const auto& other = rings[j];
+			if (i == j || std::abs(other.area) <= std::abs(ring.area)
+			    || !other.polygon.containsPoint(ring.polygon.first(), Qt::OddEvenFill))
+				continue;
+
+			++ring.depth;
+			if (ring.parent < 0 || std::abs(other.area) < std::abs(rings[ring.parent].area))
+				ring.parent = int(j);
+		}
+	}
+
+	Feature feature = { Polygon, object_tags, {} };
+	QPoint cursor;
+	for (std::size_t i = 0; i < rings.size(); ++i)
+	{
+		auto& exterior = rings[i];
+		if (exterior.depth % 2 != 0)
+			continue;
+
+		if (exterior.area < 0)
+			std::reverse(exterior.points.begin(), exterior.points.end());
+		appendPoints(feature.geometry, cursor, exterior.points, true);
+
+		for (auto& hole : rings)
+		{
+			if (hole.parent != int(i) || hole.depth % 2 == 0)
+				continue;
+
+			if (hole.area > 0)
+				std::reverse(hole.points.begin(), hole.points.end());
+			appendPoints(feature.geometry, cursor, hole.points, true);
+		}
+	}
+	if (!feature.geometry.empty())
+		features.push_back(std::move(feature));
+}
+
+void VectorTileWriter::addLines(const QPainterPath& path, qreal width)
+{
+	const QRectF tile_rect = bufferedTile();
+	if (!overlaps(path.controlPointRect(), tile_rect))
+		return;
+
+	Feature feature = { LineString, object_tags, {} };
+	feature.tags.push_back(keyIndex("line_width"));
+	feature.tags.push_back(valueIndex(doubleValue(width * 256 / extent)));  // Pixels of a 256 pixel tile
+
+	QPoint cursor;
+	std::vector<QPolygonF> parts;
+	for (const auto& polygon : path.toSubpathPolygons())
+	{
+		parts.clear();
+		clipLine(polygon, tile_rect, parts);
+		for (const auto& part : parts)
+		{
+			const auto points = simplified(part, tolerance);
+			if (points.size() >= 2)
+				appendPoints(feature.geometry, cursor, points, false);
+		}
+	}
+	if (!feature.geometry.empty())
+		features.push_back(std::move(feature));
+}
+
+quint32 VectorTileWriter::keyIndex(const QByteArray& key)
+{
+	auto index = key_indices.find(key);
+	if (index == key_indices.end())
+	{
+		index = key_indices.insert(key, quint32(keys.size()));
+		keys.push_back(key);
+	}
+	return *index;
+}
+
+quint32 VectorTileWriter::valueIndex(const QByteArray& value)
+{
+	auto index = value_indices.find(value);
+	if (index == value_indices.end())
+	{
+		index = value_indices.insert(value, quint32(values.size()));
+		values.push_back(value);
+	}
+	return *index;
+}
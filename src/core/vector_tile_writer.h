@@ -0,0 +1,146 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_VECTOR_TILE_WRITER_H_
+#define _OPENORIENTEERING_VECTOR_TILE_WRITER_H_
+
+#include <vector>
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QHash>
+
+QT_BEGIN_NAMESPACE
+class QPainterPath;
+class QTransform;
+QT_END_NAMESPACE
+
+class Map;
+class MapColor;
+class Object;
+struct RenderConfig;
+
+
+/**
+ * Encodes the map's renderables as a Mapbox vector tile (version 2).
+ *
+ * The renderables are drawn to an internal paint device which records the
+ * filled and stroked paths, attributed to the object and color they belong
+ * to. Filled paths become polygon features, stroked paths become linestring
+ * features. All geometry is clipped to the tile plus a small buffer,
+ * simplified with a tolerance given in tile units, and quantized to the
+ * integer grid of the tile's extent. Thus coarse zoom levels get coarse
+ * geometry.
+ *
+ * The tile has a single layer named "map". Each feature carries the symbol
+ * number and name, the color name and RGB value, and the color priority.
+ * Linestring features also carry the line width in pixels of a 256 pixel tile.
+ *
+ * Synopsis:
+ *
+ * VectorTileWriter writer;
+ * writer.addObjects(map, config, transform);  // transform: map -> 0..extent
+ * if (!writer.isEmpty())
+ *     file.write(writer.data());
+ */
+class VectorTileWriter
+{
+public:
+	/** The width and height of the tile, in tile units. */
+	static const int extent = 4096;
+
+	/** The width of the area around the tile which is encoded, too, in tile units. */
+	static const int buffer = 64;
+
+	/**
+	 * Constructs a writer for an empty tile.
+	 *
+	 * The tolerance is the maximum deviation of simplified geometry,
+	 * in tile units.
+	 */
+	explicit VectorTileWriter(qreal tolerance = 8.0);
+
+	/**
+	 * Destructor.
+	 */
+	~VectorTileWriter();
+
+	/**
+	 * Adds the map's objects which are visible in the configuration's bounding box.
+	 *
+	 * The transform maps map coordinates to tile units.
+	 */
+	void addObjects(Map& map, const RenderConfig& config, const QTransform& transform);
+
+	/**
+	 * Returns true if the tile does not contain any feature.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * Returns the encoded tile.
+	 */
+	QByteArray data() const;
+
+private:
+	class PaintEngine;
+	class PaintDevice;
+
+	/** The geometry type of a feature */
+	enum GeometryType : quint32
+	{
+		Point      = 1,
+		LineString = 2,
+		Polygon    = 3,
+	};
+
+	/** An encoded feature */
+	struct Feature
+	{
+		GeometryType type;
+		std::vector<quint32> tags;
+		std::vector<quint32> geometry;
+	};
+
+	/** Sets the attributes of the features which are added next. */
+	void beginObject(const Object* object, const MapColor* color);
+
+	/** Adds a polygon feature for the area of the path, in tile units. */
+	void addPolygons(const QPainterPath& path);
+
+	/** Adds a linestring feature for the path, in tile units. */
+	void addLines(const QPainterPath& path, qreal width);
+
+	/** Returns the index of the key, adding it if necessary. */
+	quint32 keyIndex(const QByteArray& key);
+
+	/** Returns the index of the encoded value, adding it if necessary. */
+	quint32 valueIndex(const QByteArray& value);
+
+	qreal tolerance;
+	std::vector<Feature> features;
+	std::vector<quint32> object_tags;
+	std::vector<QByteArray> keys;
+	std::vector<QByteArray> values;
+	QHash<QByteArray, quint32> key_indices;
+	QHash<QByteArray, quint32> value_indices;
+};
+
+#endif
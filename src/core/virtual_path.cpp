@@ -21,6 +21,8 @@
 
 #include "virtual_path.h"
 
+#include <algorithm>
+
 #include "../util.h"
 
 
@@ -43,6 +45,68 @@ namespace
 	 * This is counteracted by generating many segments.
 	 */
 	const PathCoord::length_type bezier_segment_maxlen_squared = 1.0;
+	
+	/**
+	 * The number of curves from the previous update which are checked for
+	 * a match of an updated curve.
+	 * 
+	 * This permits reuse after inserting or removing a single curve.
+	 */
+	const std::size_t curve_cache_lookahead = 3;
+	
+	/**
+	 * Returns the contribution of the segment from a to b to twice the
+	 * signed area of a polygon (shoelace formula).
+	 */
+	inline
+	double areaTerm(MapCoordF a, MapCoordF b)
+	{
+		return (a.x() + b.x()) * (a.y() - b.y());
+	}
+	
+	/**
+	 * Returns true if the coordinates are exactly equal.
+	 * 
+	 * MapCoordF's operator== does a fuzzy comparison.
+	 */
+	bool isSamePos(MapCoordF a, MapCoordF b)
+	{
+		return a.x() == b.x() && a.y() == b.y();
+	}
+	
+	/**
+	 * Returns the smallest box which contains both boxes.
+	 * 
+	 * Other than QRectF::united(), this does not ignore boxes of zero size.
+	 */
+	QRectF boxUnion(const QRectF& a, const QRectF& b)
+	{
+		return QRectF(QPointF(std::min(a.left(), b.left()), std::min(a.top(), b.top())),
+		              QPointF(std::max(a.right(), b.right()), std::max(a.bottom(), b.bottom())));
+	}
+	
+	/**
+	 * Returns true if the (normalized) boxes overlap, including their borders.
+	 * 
+	 * Other than QRectF::intersects(), this is true for boxes of zero width
+	 * or height.
+	 */
+	bool boxesOverlap(const QRectF& a, const QRectF& b)
+	{
+		return a.left() <= b.right() && b.left() <= a.right() &&
+		       a.top() <= b.bottom() && b.top() <= a.bottom();
+	}
+	
+	/**
+	 * Returns the squared distance from the coordinate to the box,
+	 * or zero if the coordinate is inside the box.
+	 */
+	double distanceSquaredToBox(MapCoordF coord, const QRectF& box)
+	{
+		auto dx = std::max(0.0, std::max(box.left() - coord.x(), coord.x() - box.right()));
+		auto dy = std::max(0.0, std::max(box.top() - coord.y(), coord.y() - box.bottom()));
+		return dx*dx + dy*dy;
+	}
 }
 
 
@@ -59,20 +123,29 @@ PathCoord::length_type PathCoord::bezierError()
 
 // ### PathCoordVector ###
 
+const PathCoordVector::size_type PathCoordVector::segment_group_size;
+
+
 PathCoordVector::PathCoordVector(const MapCoordVector& coords)
     : virtual_coords(coords)
+    , segment_boxes_valid(false)
+    , doubled_area(0.0)
 {
 	// nothing else
 }
 
 PathCoordVector::PathCoordVector(const MapCoordVector& flags, const MapCoordVectorF& coords)
     : virtual_coords(flags, coords)
+    , segment_boxes_valid(false)
+    , doubled_area(0.0)
 {
 	// nothing else
 }
 
 PathCoordVector::PathCoordVector(const VirtualCoordVector& coords)
     : virtual_coords(coords)
+    , segment_boxes_valid(false)
+    , doubled_area(0.0)
 {
 	// nothing else
 }
@@ -92,7 +165,17 @@ VirtualCoordVector::size_type PathCoordVector::update(VirtualCoordVector::size_t
 			         pos.x(), -pos.y(), part_start);
 		}
 		
-		clear();
+		segment_boxes.clear();
+		segment_boxes_valid = false;
+		
+		std::vector<PathCoord> old_path_coords;
+		old_path_coords.swap(*this);
+		reserve(old_path_coords.size());
+		
+		std::vector<CurveCacheEntry> old_curve_cache;
+		old_curve_cache.swap(curve_cache);
+		auto next_old_curve = old_curve_cache.begin();
+		
 		if (empty() || (part_start > 0 && flags[part_start-1].isHolePoint()))
 		{
 			emplace_back(virtual_coords[part_start], part_start, 0.0, 0.0);
@@ -104,8 +187,28 @@ VirtualCoordVector::size_type PathCoordVector::update(VirtualCoordVector::size_t
 			{
 				Q_ASSERT(index+2 <= part_end);
 				
+				CurveCacheEntry entry = { virtual_coords[index-1], virtual_coords[index], virtual_coords[index+1], virtual_coords[index+2], 0, 0 };
+				auto lookahead_end = next_old_curve + std::min(curve_cache_lookahead, std::size_t(old_curve_cache.end() - next_old_curve));
+				auto match = std::find_if(next_old_curve, lookahead_end, [&entry](const CurveCacheEntry& old_entry) {
+					return isSamePos(old_entry.c0, entry.c0) &&
+					       isSamePos(old_entry.c1, entry.c1) &&
+					       isSamePos(old_entry.c2, entry.c2) &&
+					       isSamePos(old_entry.c3, entry.c3);
+				});
+				
 				// Add curve coordinates
-				curveToPathCoord(virtual_coords[index-1], virtual_coords[index], virtual_coords[index+1], virtual_coords[index+2], index-1, 0, 1);
+				entry.first = size();
+				if (match != lookahead_end)
+				{
+					copyCurvePathCoords(old_path_coords, *match, index-1);
+					next_old_curve = match + 1;
+				}
+				else
+				{
+					curveToPathCoord(entry.c0, entry.c1, entry.c2, entry.c3, index-1, 0, 1);
+				}
+				entry.last = size();
+				curve_cache.push_back(entry);
 				index += 2;
 			}
 			
@@ -120,10 +223,114 @@ VirtualCoordVector::size_type PathCoordVector::update(VirtualCoordVector::size_t
 				part_end = index;
 			}
 		}
+		
+		doubled_area = 0.0;
+		for (size_type i = 1; i < size(); ++i)
+			doubled_area += areaTerm((*this)[i-1].pos, (*this)[i].pos);
 	}
 	return part_end;
 }
 
+QRectF PathCoordVector::updateLocally(VirtualCoordVector::size_type first, VirtualCoordVector::size_type last)
+{
+	Q_ASSERT(!empty());
+	Q_ASSERT(first <= last);
+	Q_ASSERT(front().index <= first && last <= back().index);
+	
+	auto& flags = virtual_coords.flags;
+	auto by_index = [](const PathCoord& pc, VirtualCoordVector::size_type index) { return pc.index < index; };
+	
+	// The affected segments begin at the edge which contains or ends at first,
+	// and they end at the first anchor point after last.
+	auto first_pc = size_type { 0 };
+	if (first > front().index)
+	{
+		auto previous_edge = (std::lower_bound(begin(), end(), first, by_index) - 1)->index;
+		first_pc = size_type(std::lower_bound(begin(), end(), previous_edge, by_index) - begin());
+	}
+	auto last_pc = size_type(std::lower_bound(begin(), end(), last + 1, by_index) - begin());
+	if (last_pc == size())
+		--last_pc;
+	
+	const auto edge_start = (*this)[first_pc].index;
+	const auto edge_end   = (*this)[last_pc].index;
+	Q_ASSERT((*this)[first_pc].param == 0 && (*this)[last_pc].param == 0);
+	
+	segment_boxes.clear();
+	segment_boxes_valid = false;
+	
+	QRectF box(QPointF((*this)[first_pc].pos), QSizeF(0.0001, 0.0001));
+	for (auto i = first_pc + 1; i <= last_pc; ++i)
+		rectInclude(box, (*this)[i].pos);
+	
+	// Outside of the replaced segments, only the first and the last path
+	// coord may have moved, and the closing segment is not in the sum.
+	for (auto i = first_pc + 1; i <= last_pc; ++i)
+		doubled_area -= areaTerm((*this)[i-1].pos, (*this)[i].pos);
+	
+	std::vector<PathCoord> tail(begin() + last_pc + 1, end());
+	const auto old_length = (*this)[last_pc].clen;
+	erase(begin() + first_pc + 1, end());
+	(*this)[first_pc].pos = virtual_coords[edge_start];
+	
+	std::vector<CurveCacheEntry> new_curves;
+	for (auto index = edge_start + 1; index <= edge_end; ++index)
+	{
+		if (flags[index-1].isCurveStart())
+		{
+			Q_ASSERT(index+2 <= edge_end);
+			
+			CurveCacheEntry entry = { virtual_coords[index-1], virtual_coords[index], virtual_coords[index+1], virtual_coords[index+2], size(), 0 };
+			curveToPathCoord(entry.c0, entry.c1, entry.c2, entry.c3, index-1, 0, 1);
+			entry.last = size();
+			new_curves.push_back(entry);
+			index += 2;
+		}
+		
+		const PathCoord& prev = back();
+		emplace_back(virtual_coords[index], index, 0.0, prev.clen + prev.pos.distanceTo(virtual_coords[index]));
+	}
+	
+	for (auto i = first_pc; i < size(); ++i)
+		rectInclude(box, (*this)[i].pos);
+	for (auto i = first_pc + 1; i < size(); ++i)
+		doubled_area += areaTerm((*this)[i-1].pos, (*this)[i].pos);
+	
+	// Shift the cumulative length of the remaining path coords.
+	const auto length_change = back().clen - old_length;
+	const auto new_last_pc = size() - 1;
+	for (auto& pc : tail)
+		pc.clen += length_change;
+	insert(end(), tail.begin(), tail.end());
+	
+	// Replace the cache entries of the affected curves.
+	auto curves_begin = std::find_if(curve_cache.begin(), curve_cache.end(), [first_pc](const CurveCacheEntry& entry) {
+		return entry.first > first_pc;
+	});
+	auto curves_end = std::find_if(curves_begin, curve_cache.end(), [last_pc](const CurveCacheEntry& entry) {
+		return entry.first > last_pc;
+	});
+	for (auto entry = curves_end; entry != curve_cache.end(); ++entry)
+	{
+		entry->first = entry->first + new_last_pc - last_pc;
+		entry->last  = entry->last + new_last_pc - last_pc;
+	}
+	curves_begin = curve_cache.erase(curves_begin, curves_end);
+	curve_cache.insert(curves_begin, new_curves.begin(), new_curves.end());
+	
+	return box;
+}
+
+qint64 PathCoordVector::memoryUsage() const
+{
+	qint64 result = qint64(capacity() * sizeof(PathCoord))
+	                + qint64(curve_cache.capacity() * sizeof(CurveCacheEntry))
+	                + qint64(segment_boxes.capacity() * sizeof(std::vector<QRectF>));
+	for (const auto& level : segment_boxes)
+		result += qint64(level.capacity() * sizeof(QRectF));
+	return result;
+}
+
 bool PathCoordVector::isClosed() const
 {
 	return virtual_coords.flags[back().index].isClosePoint();
@@ -162,16 +369,8 @@ double PathCoordVector::calculateArea() const
 {
 	Q_ASSERT(!empty());
 	
-	auto area = 0.0;
-	auto end_index = size() - 1;
-	auto j = end_index;  // The last vertex is the 'previous' one to the first
-	
-	for (auto i = 0u; i <= end_index; ++i)
-	{
-		area += ((*this)[j].pos.x() + (*this)[i].pos.x()) * ((*this)[j].pos.y() - (*this)[i].pos.y()); 
-		j = i;
-	}
-	return qAbs(area) / 2;
+	// The last path coord is the 'previous' one to the first.
+	return qAbs(doubled_area + areaTerm(back().pos, front().pos)) / 2;
 }
 
 QRectF PathCoordVector::calculateExtent() const
@@ -195,19 +394,15 @@ QRectF PathCoordVector::calculateExtent() const
 
 bool PathCoordVector::intersectsBox(QRectF box) const
 {
-	bool result = false;
-	if (!empty())
+	auto normalized_box = box.normalized();
+	auto box_test = [&normalized_box](const QRectF& segment_box)
 	{
-		auto last_pos = front().pos;
-		result = std::any_of(begin()+1, end(), [&box, &last_pos](const PathCoord& pc)
-		{
-			auto pos = pc.pos;
-			auto result = lineIntersectsRect(box, last_pos, pos); /// \todo Implement this here, used nowhere else
-			last_pos = pos;
-			return result;
-		});
-	}
-	return result;
+		return boxesOverlap(normalized_box, segment_box);
+	};
+	return visitSegments(box_test, [this, &box](size_type i)
+	{
+		return lineIntersectsRect(box, (*this)[i].pos, (*this)[i+1].pos); /// \todo Implement this here, used nowhere else
+	});
 }
 
 bool PathCoordVector::isPointInside(MapCoordF coord) const
@@ -215,22 +410,79 @@ bool PathCoordVector::isPointInside(MapCoordF coord) const
 	bool inside = false;
 	if (size() > 2)
 	{
-		auto last_pos = back().pos;
-		for(const auto& path_coord : *this)
+		auto crosses_ray = [coord](MapCoordF last_pos, MapCoordF pos)
 		{
-			auto pos = path_coord.pos;
-			if ( ((pos.y() > coord.y()) != (last_pos.y() > coord.y())) &&
-			     (coord.x() < (last_pos.x() - pos.x()) *
-			      (coord.y() - pos.y()) / (last_pos.y() - pos.y()) + pos.x()) )
-			{
+			return ((pos.y() > coord.y()) != (last_pos.y() > coord.y())) &&
+			       (coord.x() < (last_pos.x() - pos.x()) *
+			        (coord.y() - pos.y()) / (last_pos.y() - pos.y()) + pos.x());
+		};
+		
+		// The segment from the last path coord back to the first one
+		inside = crosses_ray(back().pos, front().pos);
+		
+		// Only segments which reach the ray to the right of coord can cross it.
+		auto box_test = [coord](const QRectF& segment_box)
+		{
+			return segment_box.top() <= coord.y() && coord.y() <= segment_box.bottom() &&
+			       coord.x() <= segment_box.right();
+		};
+		visitSegments(box_test, [this, &inside, &crosses_ray](size_type i)
+		{
+			if (crosses_ray((*this)[i].pos, (*this)[i+1].pos))
 				inside = !inside;
-			}
-			last_pos = pos;
-		}
+			return false;
+		});
 	}
 	return inside;
 }
 
+void PathCoordVector::updateSegmentBoxes() const
+{
+	segment_boxes.clear();
+	segment_boxes_valid = true;
+	
+	if (size() <= 2 * segment_group_size)
+		return;
+	
+	auto num_segments = size() - 1;
+	std::vector<QRectF> boxes;
+	boxes.reserve((num_segments + segment_group_size - 1) / segment_group_size);
+	for (size_type first = 0; first < num_segments; first += segment_group_size)
+	{
+		auto last = std::min(first + segment_group_size, num_segments);
+		auto box = QRectF((*this)[first].pos, (*this)[first].pos);
+		for (auto i = first + 1; i <= last; ++i)
+			box = boxUnion(box, QRectF((*this)[i].pos, (*this)[i].pos));
+		boxes.push_back(box);
+	}
+	segment_boxes.push_back(std::move(boxes));
+	
+	while (segment_boxes.back().size() > 1)
+	{
+		const auto& previous = segment_boxes.back();
+		std::vector<QRectF> next;
+		next.reserve((previous.size() + 1) / 2);
+		for (std::size_t i = 0; i < previous.size(); i += 2)
+		{
+			next.push_back((i + 1 < previous.size()) ? boxUnion(previous[i], previous[i+1]) : previous[i]);
+		}
+		segment_boxes.push_back(std::move(next));
+	}
+}
+
+void PathCoordVector::copyCurvePathCoords(
+        const std::vector<PathCoord>& old_path_coords,
+        const CurveCacheEntry& entry,
+        MapCoordVector::size_type edge_start )
+{
+	for (auto i = entry.first; i < entry.last; ++i)
+	{
+		const PathCoord& old = old_path_coords[i];
+		const PathCoord& prev = back();
+		emplace_back(old.pos, edge_start, old.param, prev.clen + float(prev.pos.distanceTo(old.pos)));
+	}
+}
+
 void PathCoordVector::curveToPathCoord(
         MapCoordF c0,
         MapCoordF c1,
@@ -348,32 +600,42 @@ PathCoord VirtualPath::findClosestPointTo(
 	
 	auto result = path_coords.front();
 	
+	distance_squared = distance_bound_squared;
+	
+	// Groups of segments which are farther away than the current bound
+	// cannot improve the result. The margin covers rounding errors.
+	auto box_test = [coord, &distance_squared](const QRectF& segment_box)
+	{
+		return distanceSquaredToBox(coord, segment_box) <= distance_squared * 1.001f + 1e-6;
+	};
+	
 	// Find upper bound for distance.
-	for (const auto& path_coord : path_coords)
+	auto check_path_coord = [coord, start_index, end_index, &distance_squared, &result](const PathCoord& path_coord)
 	{
-		if (path_coord.index > end_index)
-			break;
-		if (path_coord.index < start_index)
-			continue;
+		if (path_coord.index > end_index || path_coord.index < start_index)
+			return;
 		
 		auto to_coord = coord - path_coord.pos;
 		auto dist_sq = to_coord.lengthSquared();
-		if (dist_sq < distance_bound_squared)
+		if (dist_sq < distance_squared)
 		{
-			distance_bound_squared = dist_sq;
+			distance_squared = dist_sq;
 			result = path_coord;
 		}
-	}
+	};
+	check_path_coord(path_coords.front());
+	path_coords.visitSegments(box_test, [this, &check_path_coord](size_type i)
+	{
+		check_path_coord(path_coords[i+1]);
+		return false;
+	});
 	
 	// Check between this coord and the next one.
-	distance_squared = distance_bound_squared;
-	auto last = end(path_coords)-1;
-	for (auto pc = begin(path_coords); pc != last; ++pc)
+	path_coords.visitSegments(box_test, [this, coord, start_index, end_index, &distance_squared, &result](size_type i)
 	{
-		if (pc->index > end_index)
-			break;
-		if (pc->index < start_index)
-			continue;
+		auto pc = begin(path_coords) + i;
+		if (pc->index > end_index || pc->index < start_index)
+			return false;
 		
 		auto pos = pc->pos;
 		auto next_pc = pc+1;
@@ -391,7 +653,7 @@ PathCoord VirtualPath::findClosestPointTo(
 				distance_squared = to_coord.lengthSquared();
 				result = *pc;
 			}
-			continue;
+			return false;
 		}
 		
 		float line_length = next_pc->clen - pc->clen;
@@ -402,7 +664,7 @@ PathCoord VirtualPath::findClosestPointTo(
 				distance_squared = coord.distanceSquaredTo(next_pos);
 				result = *next_pc;
 			}
-			continue;
+			return false;
 		}
 		
 		auto right = tangent.perpRight();
@@ -432,7 +694,8 @@ PathCoord VirtualPath::findClosestPointTo(
 				result.pos = pos + (next_pos - pos) * factor;
 			}
 		}
-	}
+		return false;
+	});
 	return result;
 }
 
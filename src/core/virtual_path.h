@@ -22,6 +22,7 @@
 #ifndef OPENORIENTEERING_VIRTUAL_PATH_H
 #define OPENORIENTEERING_VIRTUAL_PATH_H
 
+#include <algorithm>
 #include <vector>
 
 #include <QRectF>
@@ -40,10 +41,63 @@ class PathCoordVector : public std::vector<PathCoord>
 private:
 	friend class SplitPathCoord;
 	friend class VirtualPath;
+	friend class PathPart;
+	
+	/**
+	 * The control points of a curve which was approximated in update(),
+	 * and the range of the path coords which were generated for the curve.
+	 */
+	struct CurveCacheEntry
+	{
+		MapCoordF c0, c1, c2, c3;
+		size_type first;
+		size_type last;
+	};
 	
 	VirtualCoordVector virtual_coords;
 	
+	/**
+	 * The curves from the last update(), in the order of the path.
+	 * 
+	 * update() reuses the polyline approximation of curves which did not change.
+	 */
+	std::vector<CurveCacheEntry> curve_cache;
+	
+	/**
+	 * The bounding boxes of groups of segments, for spatial queries.
+	 * 
+	 * The first level holds the boxes of runs of segment_group_size segments.
+	 * Each following level holds the boxes of pairs of boxes from the level
+	 * before, up to a single box. The boxes are built on demand by
+	 * visitSegments(), and discarded by update().
+	 * 
+	 * The boxes are written from const member functions without any
+	 * synchronization. So concurrent queries on the same PathCoordVector
+	 * are not thread-safe, even though they are const. Queries on distinct
+	 * objects may run concurrently.
+	 */
+	mutable std::vector< std::vector<QRectF> > segment_boxes;
+	
+	/** True when segment_boxes corresponds to the current path coords. */
+	mutable bool segment_boxes_valid;
+	
+	/**
+	 * Twice the signed area enclosed by the path coords, without the segment
+	 * from the last path coord back to the first one.
+	 * 
+	 * The sum is calculated by update() and adjusted by updateLocally(), so
+	 * calculateArea() takes constant time and does not modify the object.
+	 */
+	double doubled_area;
+	
 public:
+	/**
+	 * The number of segments which are covered by a single box
+	 * in the first level of the segment boxes.
+	 */
+	static const size_type segment_group_size = 16;
+	
+
 	PathCoordVector(const MapCoordVector& coords);
 	
 	PathCoordVector(const MapCoordVector& flags, const MapCoordVectorF& coords);
@@ -72,10 +126,33 @@ public:
 	/**
 	 * Updates the path coords from the flags/coords, starting at first.
 	 * 
+	 * The approximation of curves whose control points did not change since
+	 * the last update is copied instead of being calculated again.
+	 * 
 	 * \return The index after the last element of this part.
 	 */
 	VirtualCoordVector::size_type update(VirtualCoordVector::size_type first);
 	
+	/**
+	 * Updates the path coords after the coordinates from first to last were
+	 * moved, without changes to the flags or to the number of coordinates.
+	 * 
+	 * Only the segments which start or end within this range are calculated
+	 * again. The cumulative length of the following path coords is adjusted
+	 * by the change of length. The range must be inside this part, and the
+	 * path coords must correspond to the state before the modification.
+	 * 
+	 * \return The bounding box of the affected segments, before and after
+	 *         the modification.
+	 */
+	QRectF updateLocally(VirtualCoordVector::size_type first, VirtualCoordVector::size_type last);
+	
+	/**
+	 * Returns the memory allocated by this object, in bytes, including
+	 * the curve cache and the segment boxes.
+	 */
+	qint64 memoryUsage() const;
+	
 	
 	/**
 	 * Finds the index of the next dash point after first, or returns size()-1.
@@ -110,17 +187,60 @@ public:
 	PathCoord::length_type length() const;
 	
 	/**
-	 * Calculates the area of this part.
+	 * Returns the area of this part.
+	 * 
+	 * The area is maintained by update() and updateLocally().
 	 */
 	double calculateArea() const;
 	
 	QRectF calculateExtent() const;
 	
+	/**
+	 * Returns true if a segment of the path intersects the box.
+	 * 
+	 * Not thread-safe: this may build the segment boxes, cf. visitSegments().
+	 */
 	bool intersectsBox(QRectF box) const;
 	
+	/**
+	 * Returns true if the coord is inside the area enclosed by the path.
+	 * 
+	 * Not thread-safe: this may build the segment boxes, cf. visitSegments().
+	 */
 	bool isPointInside(MapCoordF coord) const;
 	
+	/**
+	 * Calls visitor(i) for the segments from path coord i to path coord i+1,
+	 * in the order of the path.
+	 * 
+	 * Groups of segments are skipped when box_test(box) returns false for
+	 * their bounding box. So box_test must return true for every box which
+	 * may contain segments of interest. The visiting stops when visitor
+	 * returns true.
+	 * 
+	 * The bounding boxes are built on first use after update(). Thus this
+	 * function must not be called concurrently on the same object.
+	 * 
+	 * @return True if the visiting was stopped by the visitor.
+	 */
+	template <class BoxTest, class Visitor>
+	bool visitSegments(BoxTest box_test, Visitor visitor) const;
+	
 private:
+	/**
+	 * Builds the bounding boxes of groups of segments.
+	 * 
+	 * Short paths get no boxes.
+	 */
+	void updateSegmentBoxes() const;
+	
+	/**
+	 * Recursively visits the segments in the box with the given index
+	 * at the given level of the segment boxes.
+	 */
+	template <class BoxTest, class Visitor>
+	bool visitSegmentGroup(std::size_t level, size_type box_index, BoxTest& box_test, Visitor& visitor) const;
+	
 	/**
 	 * Recursive approximation of a bezier curve by polygonal segments.
 	 */
@@ -133,6 +253,16 @@ private:
 		float p0,
 		float p1
 	);
+	
+	/**
+	 * Appends the path coords of a curve from a previous update,
+	 * for the given edge_start.
+	 */
+	void copyCurvePathCoords(
+		const std::vector<PathCoord>& old_path_coords,
+		const CurveCacheEntry& entry,
+		MapCoordVector::size_type edge_start
+	);
 };
 
 
@@ -374,6 +504,53 @@ PathCoordVector::size_type PathCoordVector::upperBound(
 
 
 
+template <class BoxTest, class Visitor>
+bool PathCoordVector::visitSegments(BoxTest box_test, Visitor visitor) const
+{
+	if (!segment_boxes_valid)
+		updateSegmentBoxes();
+	
+	if (segment_boxes.empty())
+	{
+		for (size_type i = 0; i + 1 < size(); ++i)
+		{
+			if (visitor(i))
+				return true;
+		}
+		return false;
+	}
+	
+	auto top_level = segment_boxes.size() - 1;
+	return visitSegmentGroup(top_level, 0, box_test, visitor);
+}
+
+template <class BoxTest, class Visitor>
+bool PathCoordVector::visitSegmentGroup(std::size_t level, size_type box_index, BoxTest& box_test, Visitor& visitor) const
+{
+	if (!box_test(segment_boxes[level][box_index]))
+		return false;
+	
+	if (level == 0)
+	{
+		auto first = box_index * segment_group_size;
+		auto last  = std::min(first + segment_group_size, size() - 1);
+		for (auto i = first; i < last; ++i)
+		{
+			if (visitor(i))
+				return true;
+		}
+		return false;
+	}
+	
+	auto child = 2 * box_index;
+	if (visitSegmentGroup(level - 1, child, box_test, visitor))
+		return true;
+	return child + 1 < segment_boxes[level - 1].size()
+	       && visitSegmentGroup(level - 1, child + 1, box_test, visitor);
+}
+
+
+
 // ### VirtualPath inline code ###
 
 inline
@@ -0,0 +1,248 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "warp_grid.h"
+
+#include <cmath>
+#include <utility>
+
+#include <QImage>
+#include <QPainter>
+#include <QPolygonF>
+#include <QTransform>
+#include <qmath.h>
+
+
+namespace
+{
+	/** The radial basis function of the thin-plate spline, for the squared distance. */
+	double tpsKernel(double distance_sq)
+	{
+		return (distance_sq > 0.0) ? distance_sq * std::log(distance_sq) : 0.0;
+	}
+
+	/**
+	 * Solves the linear system a * x = b by Gaussian elimination with partial pivoting.
+	 *
+	 * a is a square matrix of size n, stored row by row. b holds two right-hand
+	 * sides per row, and it receives the solutions. Returns false if a is singular.
+	 */
+	bool solve(std::vector<double>& a, std::vector<QPointF>& b)
+	{
+		const std::size_t n = b.size();
+		for (std::size_t col = 0; col < n; ++col)
+		{
+			std::size_t pivot = col;
+			for (std::size_t row = col + 1; row < n; ++row)
+			{
+				if (std::abs(a[row * n + col]) > std::abs(a[pivot * n + col]))
+					pivot = row;
+			}
+			if (std::abs(a[pivot * n + col]) < 1e-12)
+				return false;
+
+			if (pivot != col)
+			{
+				for (std::size_t k = 0; k < n; ++k)
+					std::swap(a[pivot * n + k], a[col * n + k]);
+				std::swap(b[pivot], b[col]);
+			}
+
+			for (std::size_t row = col + 1; row < n; ++row)
+			{
+				const double factor = a[row * n + col] / a[col * n + col];
+				if (factor == 0.0)
+					continue;
+				for (std::size_t k = col; k < n; ++k)
+					a[row * n + k] -= factor * a[col * n + k];
+				b[row] -= factor * b[col];
+			}
+		}
+
+		for (std::size_t col = n; col-- > 0; )
+		{
+			for (std::size_t k = col + 1; k < n; ++k)
+				b[col] -= a[col * n + k] * b[k];
+			b[col] /= a[col * n + col];
+		}
+		return true;
+	}
+}
+
+
+
+// ### WarpGrid ###
+
+WarpGrid::WarpGrid()
+ : columns(0)
+ , rows(0)
+{
+	; // nothing
+}
+
+bool WarpGrid::isEmpty() const
+{
+	return nodes.empty();
+}
+
+void WarpGrid::clear()
+{
+	grid_extent = QRectF();
+	columns = 0;
+	rows = 0;
+	nodes.clear();
+}
+
+QRectF WarpGrid::extent() const
+{
+	return grid_extent;
+}
+
+QRectF WarpGrid::boundingRect() const
+{
+	if (nodes.empty())
+		return QRectF();
+
+	qreal left = nodes.front().x(), right = left;
+	qreal top = nodes.front().y(), bottom = top;
+	for (const auto& node : nodes)
+	{
+		left   = qMin(left, node.x());
+		right  = qMax(right, node.x());
+		top    = qMin(top, node.y());
+		bottom = qMax(bottom, node.y());
+	}
+	return QRectF(QPointF(left, top), QPointF(right, bottom));
+}
+
+bool WarpGrid::fitThinPlateSpline(const QRectF& extent, const std::vector<QPointF>& src_points, const std::vector<QPointF>& dest_points)
+{
+	Q_ASSERT(src_points.size() == dest_points.size());
+
+	clear();
+	const std::size_t num_points = src_points.size();
+	if (num_points < 3 || extent.isEmpty())
+		return false;
+
+	// Normalized coordinates keep the system well-conditioned.
+	const QPointF center = extent.center();
+	const qreal scale = qMax(extent.width(), extent.height()) / 2;
+	std::vector<QPointF> points;
+	points.reserve(num_points);
+	for (const auto& point : src_points)
+		points.push_back((point - center) / scale);
+
+	// The system for the kernel weights and the affine part,
+	// with the displacements of the points as right-hand sides
+	const std::size_t n = num_points + 3;
+	std::vector<double> a(n * n, 0.0);
+	std::vector<QPointF> b(n, QPointF());
+	for (std::size_t i = 0; i < num_points; ++i)
+	{
+		for (std::size_t j = 0; j < num_points; ++j)
+		{
+			const QPointF d = points[i] - points[j];
+			a[i * n + j] = tpsKernel(QPointF::dotProduct(d, d));
+		}
+		const double affine_terms[3] = { 1.0, points[i].x(), points[i].y() };
+		for (std::size_t k = 0; k < 3; ++k)
+		{
+			a[i * n + num_points + k] = affine_terms[k];
+			a[(num_points + k) * n + i] = affine_terms[k];
+		}
+		b[i] = dest_points[i] - src_points[i];
+	}
+	if (!solve(a, b))
+		return false;
+
+	const qreal cell_size = qMax(extent.width(), extent.height()) / max_cells;
+	columns = qMax(1, qCeil(extent.width() / cell_size));
+	rows    = qMax(1, qCeil(extent.height() / cell_size));
+	grid_extent = extent;
+	nodes.reserve(std::size_t(columns + 1) * (rows + 1));
+	for (int row = 0; row <= rows; ++row)
+	{
+		for (int column = 0; column <= columns; ++column)
+		{
+			const QPointF pos(extent.left() + extent.width() * column / columns,
+			                  extent.top() + extent.height() * row / rows);
+			const QPointF normalized = (pos - center) / scale;
+			QPointF displacement = b[num_points] + normalized.x() * b[num_points + 1] + normalized.y() * b[num_points + 2];
+			for (std::size_t i = 0; i < num_points; ++i)
+			{
+				const QPointF d = normalized - points[i];
+				displacement += tpsKernel(QPointF::dotProduct(d, d)) * b[i];
+			}
+			nodes.push_back(pos + displacement);
+		}
+	}
+	return true;
+}
+
+void WarpGrid::draw(QPainter* painter, const QImage& image, const QRectF& image_rect, const QRectF& clip_rect) const
+{
+	if (nodes.empty() || image.isNull() || image_rect.isEmpty())
+		return;
+
+	const qreal scale_x = image.width() / image_rect.width();
+	const qreal scale_y = image.height() / image_rect.height();
+	const QTransform base_transform = painter->worldTransform();
+	for (int row = 0; row < rows; ++row)
+	{
+		for (int column = 0; column < columns; ++column)
+		{
+			QPolygonF warped_cell;
+			warped_cell << node(column, row) << node(column + 1, row)
+			            << node(column + 1, row + 1) << node(column, row + 1);
+			if (clip_rect.isValid() && !warped_cell.boundingRect().intersects(clip_rect))
+				continue;
+
+			const QRectF cell = cellRect(column, row);
+			QPolygonF unwarped_cell;
+			unwarped_cell << cell.topLeft() << cell.topRight()
+			              << cell.bottomRight() << cell.bottomLeft();
+			QTransform cell_transform;
+			if (!QTransform::quadToQuad(unwarped_cell, warped_cell, cell_transform))
+				continue; // degenerated by extreme warping
+
+			const QRectF source((cell.left() - image_rect.left()) * scale_x,
+			                    (cell.top() - image_rect.top()) * scale_y,
+			                    cell.width() * scale_x,
+			                    cell.height() * scale_y);
+			painter->setWorldTransform(cell_transform * base_transform);
+			painter->drawImage(cell, image, source);
+		}
+	}
+	painter->setWorldTransform(base_transform);
+}
+
+QRectF WarpGrid::cellRect(int column, int row) const
+{
+	const QPointF top_left(grid_extent.left() + grid_extent.width() * column / columns,
+	                       grid_extent.top() + grid_extent.height() * row / rows);
+	const QPointF bottom_right(grid_extent.left() + grid_extent.width() * (column + 1) / columns,
+	                           grid_extent.top() + grid_extent.height() * (row + 1) / rows);
+	return QRectF(top_left, bottom_right);
+}
+
+const QPointF& WarpGrid::node(int column, int row) const
+{
+	return nodes[std::size_t(row) * (columns + 1) + column];
+}
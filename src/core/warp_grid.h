@@ -0,0 +1,117 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_WARP_GRID_H_
+#define _OPENORIENTEERING_WARP_GRID_H_
+
+#include <vector>
+
+#include <QPointF>
+#include <QRectF>
+
+QT_BEGIN_NAMESPACE
+class QImage;
+class QPainter;
+QT_END_NAMESPACE
+
+
+/**
+ * A coarse grid which approximates a nonlinear warp of an extent.
+ *
+ * The grid divides the extent into cells. The warp is evaluated only at the
+ * nodes of the grid, and each cell is mapped by the projective transformation
+ * which maps the cell's corners to the warped nodes. So neighbouring cells
+ * share their edges, and drawing an image costs one image draw per visible
+ * cell, independent of the number of pixels.
+ *
+ * The warp is fitted as a thin-plate spline which maps each source point
+ * exactly to its destination point, with minimal bending in between.
+ *
+ * Synopsis:
+ *
+ * WarpGrid grid;
+ * if (grid.fitThinPlateSpline(image_rect, src_points, dest_points))
+ *     grid.draw(painter, image, image_rect, clip_rect);
+ */
+class WarpGrid
+{
+public:
+	/** The maximum number of cells along either side of the extent. */
+	static const int max_cells = 32;
+
+	/**
+	 * Constructs an empty grid.
+	 */
+	WarpGrid();
+
+	/**
+	 * Returns true if the grid has not been fitted.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * Discards the grid.
+	 */
+	void clear();
+
+	/**
+	 * Returns the extent for which the grid has been fitted.
+	 */
+	QRectF extent() const;
+
+	/**
+	 * Returns the bounding rect of the warped extent.
+	 */
+	QRectF boundingRect() const;
+
+	/**
+	 * Fits the grid for the given extent to the thin-plate spline which maps
+	 * each source point to the corresponding destination point.
+	 *
+	 * Returns false and clears the grid if there are less than three points,
+	 * or if the points do not determine a unique spline (e.g. when they are
+	 * all on one line).
+	 */
+	bool fitThinPlateSpline(const QRectF& extent, const std::vector<QPointF>& src_points, const std::vector<QPointF>& dest_points);
+
+	/**
+	 * Draws the image warped by the grid.
+	 *
+	 * The image covers the given rect, which is normally the grid's extent.
+	 * (It may be a reduced-resolution version of the original image.)
+	 * Only the cells whose warped bounding box intersects the clip rect are
+	 * drawn. If the clip rect is not valid, all cells are drawn.
+	 */
+	void draw(QPainter* painter, const QImage& image, const QRectF& image_rect, const QRectF& clip_rect) const;
+
+private:
+	/** Returns the rect of the cell with the given index, in unwarped coordinates. */
+	QRectF cellRect(int column, int row) const;
+
+	/** Returns the warped node with the given index. */
+	const QPointF& node(int column, int row) const;
+
+	QRectF grid_extent;
+	int columns;
+	int rows;
+	std::vector<QPointF> nodes;  ///< (columns+1) * (rows+1) warped positions, row by row
+};
+
+#endif
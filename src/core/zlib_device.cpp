@@ -0,0 +1,525 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "zlib_device.h"
+
+#include <cstring>
+#include <deque>
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QWaitCondition>
+
+#include <zlib.h>
+
+#include "task_pool.h"
+
+
+namespace
+{
+	/** The size of the chunks of compressed data. */
+	const int compressed_chunk_size = 64 * 1024;
+	
+	/** The size of the chunks of uncompressed data. */
+	const int uncompressed_chunk_size = 256 * 1024;
+	
+	/** The amount of decompressed data which the helper may keep ahead. */
+	const qint64 max_queued_size = 4 * 1024 * 1024;
+}
+
+
+
+// ### ZlibOutputDevice ###
+
+ZlibOutputDevice::ZlibOutputDevice(QIODevice* target, int level)
+ : target(target)
+ , level(level)
+ , failed(false)
+{
+	// nothing else
+}
+
+ZlibOutputDevice::~ZlibOutputDevice()
+{
+	close();
+}
+
+bool ZlibOutputDevice::open(OpenMode mode)
+{
+	if ((mode & ReadWrite) != WriteOnly || isOpen())
+		return false;
+	
+	stream.reset(new z_stream());
+	if (deflateInit(stream.get(), level) != Z_OK)
+	{
+		setErrorString(tr("Cannot initialize the compression."));
+		stream.reset();
+		return false;
+	}
+	output.resize(compressed_chunk_size);
+	stream->next_out  = reinterpret_cast<Bytef*>(output.data());
+	stream->avail_out = uInt(output.size());
+	failed = false;
+	return QIODevice::open(mode | Unbuffered);
+}
+
+void ZlibOutputDevice::close()
+{
+	finish();
+}
+
+bool ZlibOutputDevice::finish()
+{
+	if (!isOpen())
+		return !failed;
+	
+	stream->next_in  = nullptr;
+	stream->avail_in = 0;
+	deflate(Z_FINISH);
+	deflateEnd(stream.get());
+	stream.reset();
+	output.clear();
+	QIODevice::close();
+	return !failed;
+}
+
+bool ZlibOutputDevice::isSequential() const
+{
+	return true;
+}
+
+qint64 ZlibOutputDevice::readData(char*, qint64)
+{
+	return -1;
+}
+
+qint64 ZlibOutputDevice::writeData(const char* data, qint64 size)
+{
+	if (failed)
+		return -1;
+	
+	for (qint64 done = 0; done < size; )
+	{
+		const uInt block = uInt(qMin(size - done, qint64(1) << 30));
+		stream->next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data + done));
+		stream->avail_in = block;
+		if (!deflate(Z_NO_FLUSH))
+			return -1;
+		done += block;
+	}
+	return size;
+}
+
+bool ZlibOutputDevice::deflate(int flush)
+{
+	forever
+	{
+		const int result = ::deflate(stream.get(), flush);
+		if (result == Z_STREAM_ERROR)
+		{
+			setErrorString(tr("Cannot compress the data."));
+			failed = true;
+			return false;
+		}
+		
+		const bool done = (flush == Z_FINISH) ? (result == Z_STREAM_END) : (stream->avail_in == 0);
+		if (stream->avail_out == 0 || (done && flush == Z_FINISH))
+		{
+			const qint64 size = output.size() - qint64(stream->avail_out);
+			if (!failed && target->write(output.constData(), size) != size)
+			{
+				setErrorString(target->errorString());
+				failed = true;
+			}
+			stream->next_out  = reinterpret_cast<Bytef*>(output.data());
+			stream->avail_out = uInt(output.size());
+			if (failed)
+				return false;
+		}
+		if (done)
+			return true;
+	}
+}
+
+
+
+// ### ZlibInputDevice::Pipeline ###
+
+/**
+ * The state which is shared by the device and its helper job.
+ *
+ * The decoder state is protected by decoder_mutex, the queue of
+ * decompressed chunks by queue_mutex. A thread which holds decoder_mutex
+ * may lock queue_mutex, but not vice versa, except by tryLock().
+ */
+class ZlibInputDevice::Pipeline
+{
+public:
+	explicit Pipeline(QIODevice* source)
+	 : source(source)
+	 , input(compressed_chunk_size, Qt::Uninitialized)
+	 , queued_size(0)
+	 , finished(false)
+	 , stopped(false)
+	 , helper_running(false)
+	{
+		std::memset(&stream, 0, sizeof(stream));
+		initialized = (inflateInit(&stream) == Z_OK);
+		if (!initialized)
+			finish(ZlibInputDevice::tr("Cannot initialize the decompression."));
+	}
+	
+	~Pipeline()
+	{
+		if (initialized)
+			inflateEnd(&stream);
+	}
+	
+	/**
+	 * Decompresses the next chunk and appends it to the queue.
+	 *
+	 * Returns false when there is nothing more to do.
+	 * The caller must hold decoder_mutex.
+	 */
+	bool decodeChunk()
+	{
+		{
+			QMutexLocker lock(&queue_mutex);
+			if (finished || stopped)
+				return false;
+		}
+		
+		QByteArray chunk(uncompressed_chunk_size, Qt::Uninitialized);
+		stream.next_out  = reinterpret_cast<Bytef*>(chunk.data());
+		stream.avail_out = uInt(chunk.size());
+		QString error;
+		bool end = false;
+		while (stream.avail_out > 0 && !end)
+		{
+			if (stream.avail_in == 0)
+			{
+				const qint64 size = source->read(input.data(), input.size());
+				if (size <= 0)
+				{
+					error = (size < 0) ? source->errorString() : ZlibInputDevice::tr("The file is truncated.");
+					break;
+				}
+				stream.next_in  = reinterpret_cast<Bytef*>(input.data());
+				stream.avail_in = uInt(size);
+			}
+			
+			const int result = inflate(&stream, Z_NO_FLUSH);
+			if (result == Z_STREAM_END)
+			{
+				end = true;
+			}
+			else if (result != Z_OK)
+			{
+				error = ZlibInputDevice::tr("The compressed data is corrupt.");
+				break;
+			}
+		}
+		chunk.truncate(chunk.size() - int(stream.avail_out));
+		
+		QMutexLocker lock(&queue_mutex);
+		if (!chunk.isEmpty())
+		{
+			queued_size += chunk.size();
+			queue.push_back(chunk);
+		}
+		if (end || !error.isEmpty())
+		{
+			finished = true;
+			this->error = error;
+		}
+		queue_changed.wakeAll();
+		return !finished;
+	}
+	
+	/**
+	 * The loop of the helper job.
+	 *
+	 * The helper returns when it is ahead by max_queued_size, instead of
+	 * waiting in a thread of the pool. startHelper() tells the reader when
+	 * to start a new helper job.
+	 */
+	void runHelper()
+	{
+		forever
+		{
+			{
+				QMutexLocker lock(&queue_mutex);
+				if (queued_size >= max_queued_size || stopped || finished)
+				{
+					helper_running = false;
+					return;
+				}
+			}
+			QMutexLocker decoder_lock(&decoder_mutex);
+			if (!decodeChunk())
+			{
+				QMutexLocker lock(&queue_mutex);
+				helper_running = false;
+				return;
+			}
+		}
+	}
+	
+	/**
+	 * Returns true if a new helper job shall be started.
+	 *
+	 * This is the case when no helper is running, and the queue has less
+	 * than half of max_queued_size. The helper is marked as running.
+	 */
+	bool startHelper()
+	{
+		QMutexLocker lock(&queue_mutex);
+		if (helper_running || stopped || finished || queued_size > max_queued_size / 2)
+			return false;
+		helper_running = true;
+		return true;
+	}
+	
+	/**
+	 * Takes the next chunk from the queue, waiting for it if necessary.
+	 *
+	 * Returns false at the end of the stream.
+	 */
+	bool takeChunk(QByteArray& chunk)
+	{
+		QMutexLocker lock(&queue_mutex);
+		while (queue.empty() && !finished)
+		{
+			if (decoder_mutex.tryLock())
+			{
+				// The helper is not busy, maybe not even started.
+				lock.unlock();
+				decodeChunk();
+				decoder_mutex.unlock();
+				lock.relock();
+			}
+			else
+			{
+				queue_changed.wait(&queue_mutex);
+			}
+		}
+		if (queue.empty())
+			return false;
+		
+		chunk = queue.front();
+		queue.pop_front();
+		queued_size -= chunk.size();
+		return true;
+	}
+	
+	/** Stops decoding. Waits for the current chunk to be finished. */
+	void stop()
+	{
+		{
+			QMutexLocker lock(&queue_mutex);
+			stopped = true;
+			queue_changed.wakeAll();
+		}
+		// After this, the source is no longer accessed.
+		QMutexLocker decoder_lock(&decoder_mutex);
+	}
+	
+	/** Marks the end of the stream, with the given error. */
+	void finish(const QString& error)
+	{
+		QMutexLocker lock(&queue_mutex);
+		finished = true;
+		this->error = error;
+	}
+	
+	qint64 queuedSize() const
+	{
+		QMutexLocker lock(&queue_mutex);
+		return queued_size;
+	}
+	
+	bool isFinished() const
+	{
+		QMutexLocker lock(&queue_mutex);
+		return finished && queue.empty();
+	}
+	
+	QString errorString() const
+	{
+		QMutexLocker lock(&queue_mutex);
+		return error;
+	}
+
+private:
+	// Decoder state
+	QMutex decoder_mutex;
+	QIODevice* const source;
+	z_stream stream;
+	bool initialized;
+	QByteArray input;
+	
+	// Queue state
+	mutable QMutex queue_mutex;
+	QWaitCondition queue_changed;
+	std::deque<QByteArray> queue;
+	qint64 queued_size;
+	bool finished;
+	bool stopped;
+	bool helper_running;
+	QString error;
+};
+
+
+
+// ### ZlibInputDevice::HelperJob ###
+
+/**
+ * Decompresses chunks ahead of the reader.
+ *
+ * The job returns when it is far enough ahead, and the device starts a new
+ * job when the reader has caught up. The job shares the pipeline with the
+ * device, so it may start or finish after the device was closed.
+ */
+class ZlibInputDevice::HelperJob : public QRunnable
+{
+public:
+	explicit HelperJob(std::shared_ptr<Pipeline> pipeline)
+	 : pipeline(std::move(pipeline))
+	{
+		// nothing else
+	}
+	
+	void run() override
+	{
+		pipeline->runHelper();
+	}
+
+private:
+	std::shared_ptr<Pipeline> pipeline;
+};
+
+
+
+// ### ZlibInputDevice ###
+
+ZlibInputDevice::ZlibInputDevice(QIODevice* source)
+ : source(source)
+ , current_pos(0)
+ , failed(false)
+{
+	// nothing else
+}
+
+ZlibInputDevice::~ZlibInputDevice()
+{
+	close();
+}
+
+bool ZlibInputDevice::open(OpenMode mode)
+{
+	if ((mode & ReadWrite) != ReadOnly || isOpen())
+		return false;
+	
+	pipeline = std::make_shared<Pipeline>(source);
+	current.clear();
+	current_pos = 0;
+	failed = false;
+	if (pipeline->startHelper())
+		TaskPool::start(new HelperJob(pipeline), TaskPool::Interactive);
+	return QIODevice::open(mode);
+}
+
+void ZlibInputDevice::close()
+{
+	if (pipeline)
+	{
+		pipeline->stop();
+		pipeline.reset();
+	}
+	current.clear();
+	current_pos = 0;
+	QIODevice::close();
+}
+
+bool ZlibInputDevice::isSequential() const
+{
+	return true;
+}
+
+qint64 ZlibInputDevice::bytesAvailable() const
+{
+	qint64 available = QIODevice::bytesAvailable() + (current.size() - current_pos);
+	if (pipeline)
+		available += pipeline->queuedSize();
+	return available;
+}
+
+bool ZlibInputDevice::atEnd() const
+{
+	return QIODevice::bytesAvailable() == 0
+	       && current_pos == current.size()
+	       && (!pipeline || pipeline->isFinished());
+}
+
+bool ZlibInputDevice::hasError() const
+{
+	return failed;
+}
+
+qint64 ZlibInputDevice::readData(char* data, qint64 max_size)
+{
+	if (!pipeline)
+		return -1;
+	
+	qint64 size = 0;
+	while (size < max_size)
+	{
+		if (current_pos == current.size())
+		{
+			current_pos = 0;
+			if (!pipeline->takeChunk(current))
+			{
+				current.clear();
+				const QString error = pipeline->errorString();
+				if (!error.isEmpty())
+				{
+					setErrorString(error);
+					failed = true;
+					return (size > 0) ? size : -1;
+				}
+				break;
+			}
+			if (pipeline->startHelper())
+				TaskPool::start(new HelperJob(pipeline), TaskPool::Interactive);
+		}
+		
+		const int block = int(qMin(max_size - size, qint64(current.size() - current_pos)));
+		std::memcpy(data + size, current.constData() + current_pos, std::size_t(block));
+		current_pos += block;
+		size += block;
+	}
+	return size;
+}
+
+qint64 ZlibInputDevice::writeData(const char*, qint64)
+{
+	return -1;
+}
@@ -0,0 +1,159 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_ZLIB_DEVICE_H_
+#define _OPENORIENTEERING_ZLIB_DEVICE_H_
+
+#include <memory>
+
+#include <QByteArray>
+#include <QIODevice>
+
+struct z_stream_s;
+
+
+/**
+ * @brief A write-only device which compresses the data to another device.
+ *
+ * The data is compressed as a zlib stream while it is written, in chunks,
+ * so the uncompressed data is never held in memory as a whole. The stream
+ * is completed by close(), which is called by the destructor, too.
+ *
+ * Errors of the target device are reported by write() and close() returning
+ * false, and by errorString().
+ *
+ * Synopsis:
+ *
+ * ZlibOutputDevice device(&file);
+ * device.open(QIODevice::WriteOnly);
+ * xml.setDevice(&device);
+ * ...
+ * if (!device.finish())
+ *     handleError(device.errorString());
+ */
+class ZlibOutputDevice : public QIODevice
+{
+Q_OBJECT
+public:
+	/** Constructs a device which writes to the given target device. */
+	explicit ZlibOutputDevice(QIODevice* target, int level = 6);
+	
+	/** Destructor. Completes the stream if needed. */
+	~ZlibOutputDevice() override;
+	
+	/** Opens the device. Only QIODevice::WriteOnly is supported. */
+	bool open(OpenMode mode) override;
+	
+	/** Completes the stream and closes the device. */
+	void close() override;
+	
+	/**
+	 * Completes the stream and closes the device.
+	 *
+	 * Returns false if any data could not be written.
+	 */
+	bool finish();
+	
+	/** Returns true. */
+	bool isSequential() const override;
+
+protected:
+	qint64 readData(char* data, qint64 max_size) override;
+	
+	qint64 writeData(const char* data, qint64 size) override;
+
+private:
+	/** Compresses the pending input, writing full output chunks to the target. */
+	bool deflate(int flush);
+	
+	QIODevice* const target;
+	const int level;
+	std::unique_ptr<z_stream_s> stream;
+	QByteArray output;
+	bool failed;
+};
+
+
+
+/**
+ * @brief A read-only device which decompresses the data from another device.
+ *
+ * The data is expected to be a zlib stream. It is decompressed in chunks
+ * by a helper job while the data is read from this device. So decompressing
+ * the next chunks overlaps with processing the previous ones, e.g. by a
+ * QXmlStreamReader. The helper stays ahead by a limited number of bytes.
+ * Then it returns its thread to the pool, and a new helper is started when
+ * the reader has caught up. When no helper is running, e.g. because all
+ * threads are busy, the reading thread decompresses the chunks itself.
+ *
+ * Reading blocks until data is available, so read() returns less than the
+ * requested size only at the end of the stream. Truncated and corrupt
+ * streams are reported by read() returning -1, and by errorString().
+ *
+ * The source device must not be used by others until this device is closed.
+ */
+class ZlibInputDevice : public QIODevice
+{
+Q_OBJECT
+public:
+	/** Constructs a device which reads from the given source device. */
+	explicit ZlibInputDevice(QIODevice* source);
+	
+	/** Destructor. Stops the helper job. */
+	~ZlibInputDevice() override;
+	
+	/** Opens the device. Only QIODevice::ReadOnly is supported. */
+	bool open(OpenMode mode) override;
+	
+	/** Stops the helper job and closes the device. */
+	void close() override;
+	
+	/** Returns true. */
+	bool isSequential() const override;
+	
+	/** Returns the number of bytes which can be read without blocking. */
+	qint64 bytesAvailable() const override;
+	
+	/** Returns true when all data of the stream has been read. */
+	bool atEnd() const override;
+	
+	/** Returns true if the data could not be read or decompressed. */
+	bool hasError() const;
+
+protected:
+	qint64 readData(char* data, qint64 max_size) override;
+	
+	qint64 writeData(const char* data, qint64 size) override;
+
+private:
+	class Pipeline;
+	class HelperJob;
+	
+	QIODevice* const source;
+	std::shared_ptr<Pipeline> pipeline;
+	
+	/** The chunk which is currently read, and the position in it. */
+	QByteArray current;
+	int current_pos;
+	
+	bool failed;
+};
+
+#endif
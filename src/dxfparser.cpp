@@ -19,9 +19,51 @@
 
 #include "dxfparser.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include <QApplication>
-#include <QBuffer>
 #include <QDebug>
+#include <QFileDevice>
+
+
+namespace
+{
+	/** The size of the chunks for reading devices which cannot be mapped. */
+	const qint64 read_chunk_size = 0x100000;
+	
+	inline
+	bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+	
+	inline
+	bool isDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+	
+	/** Parses an integer, returning 0 (like QString::toInt()) for invalid input. */
+	int parseInt(const char* begin, const char* end)
+	{
+		const bool negative = (begin != end && *begin == '-');
+		if (begin != end && (*begin == '-' || *begin == '+'))
+			++begin;
+		if (begin == end)
+			return 0;
+		
+		int value = 0;
+		for (; begin != end; ++begin)
+		{
+			if (!isDigit(*begin))
+				return 0;
+			value = 10 * value + (*begin - '0');
+		}
+		return negative ? -value : value;
+	}
+}
+
 
 
 QString DXFParser::parse()
@@ -38,22 +80,16 @@ QString DXFParser::parse()
 		must_close_device = true;
 	}
 	
-	int code;
-	QString value;
-	
-	QByteArray head(device->peek(16));
-	QBuffer buffer(&head);
-	buffer.open(QIODevice::ReadOnly);
-	readNextCodeValue(&buffer, code, value);
-	buffer.close();
-	if (code != 0 || value != "SECTION")
+	startReading();
+	if (!readNextCodeValue() || group_code != 0 || !valueIs("SECTION"))
 	{
 		// File does not start with DXF section
+		finishReading();
 		return QApplication::translate("DXFParser", "The file is not an DXF file.");
 	}
 
 	paths = QList<DXFPath>();
-	current_section = NOTHING;
+	current_section = SECTION;
 	QPointF bottom_right, top_left;
 	
 	/*
@@ -64,83 +100,103 @@ QString DXFParser::parse()
 	ENDSEC
 	EOF
 	  */
-	while (readNextCodeValue(device, code, value))
+	int num_values = 0;
+	int num_filtered = 0;
+	while (readNextCodeValue())
 	{
-		if (code == 0 && value == "ENDSEC")
+		if (progress_handler && (++num_values & 0xfff) == 0 && !progress_handler(position()))
+		{
+			finishReading();
+			if (must_close_device)
+				device->close();
+			return QApplication::translate("DXFParser", "Loading was cancelled.");
+		}
+		
+		if (filter.isValid() && paths.size() > num_filtered)
+		{
+			applyFilter(num_filtered);
+			num_filtered = paths.size();
+		}
+		
+		if (group_code == 0 && valueIs("ENDSEC"))
 		{
 			current_section = NOTHING;
 		}
-		else if (code == 0 && value == "EOF")
+		else if (group_code == 0 && valueIs("EOF"))
 		{
 			current_section = NOTHING;
 		}
 		else if (current_section == NOTHING)
 		{
-			if (code == 0 && value == "SECTION")
+			if (group_code == 0 && valueIs("SECTION"))
 			{
 				current_section = SECTION;
 			}
-			else if (value == "EOF")
+			else if (valueIs("EOF"))
 			{
 				break;
 			}
 		}
 		else if (current_section == SECTION)
 		{
-			if (code == 2 && value == "ENTITIES")
+			if (group_code == 2 && valueIs("ENTITIES"))
 			{
 				current_section = ENTITIES;
 			}
-			if (code == 2 && value == "HEADER")
+			if (group_code == 2 && valueIs("HEADER"))
 			{
 				current_section = HEADER;
 			}
 		}
 		else if (current_section == ENTITIES)
 		{
-			if (code == 0 && value == "LINE")
-				parseLine(device, &paths);
-			else if (code == 0 && value == "POLYLINE")
+			if (group_code == 0 && valueIs("LINE"))
+				parseLine(&paths);
+			else if (group_code == 0 && valueIs("POLYLINE"))
 			{
-				parsePolyline(device, &paths);
+				parsePolyline(&paths);
 				current_section = POLYLINE;
 			}
-			else if (code == 0 && value == "LWPOLYLINE")
-				parseLwPolyline(device, &paths);
-			else if (code == 0 && value == "SPLINE")
-				parseSpline(device, &paths);
-			else if (code == 0 && value == "CIRCLE")
-				parseCircle(device, &paths);
-			else if (code == 0 && value == "POINT")
-				parsePoint(device, &paths);
-			else if (code == 0 && value == "TEXT")
-				parseText(device, &paths);
-			else if (code == 0 && value == "ARC")
-				parseArc(device, &paths);
+			else if (group_code == 0 && valueIs("LWPOLYLINE"))
+				parseLwPolyline(&paths);
+			else if (group_code == 0 && valueIs("SPLINE"))
+				parseSpline(&paths);
+			else if (group_code == 0 && valueIs("CIRCLE"))
+				parseCircle(&paths);
+			else if (group_code == 0 && valueIs("POINT"))
+				parsePoint(&paths);
+			else if (group_code == 0 && valueIs("TEXT"))
+				parseText(&paths);
+			else if (group_code == 0 && valueIs("ARC"))
+				parseArc(&paths);
 #if defined(MAPPER_DEVELOPMENT_BUILD)
-			else if (code == 0)
-				qDebug() << "Unknown entity:" << value;
+			else if (group_code == 0)
+				qDebug() << "Unknown entity:" << valueToString();
 #endif
 		}
 		else if (current_section == HEADER)
 		{
-			if (code == 9 && value == "$EXTMIN")
-				parseExtminmax(device, bottom_right);
-			else if (code == 9 && value == "$EXTMAX")
-				parseExtminmax(device, top_left);
+			if (group_code == 9 && valueIs("$EXTMIN"))
+				parseExtminmax(bottom_right);
+			else if (group_code == 9 && valueIs("$EXTMAX"))
+				parseExtminmax(top_left);
 		}
 		else if (current_section == POLYLINE)
 		{
-			if (code == 0 && value == "SEQEND")
+			if (group_code == 0 && valueIs("SEQEND"))
 			{
-				parseSeqend(device, &paths);
+				parseSeqend(&paths);
 				current_section = ENTITIES;
 			}
-			else if (code == 0 && value == "VERTEX")
-				parseVertex(device, &paths);
+			else if (group_code == 0 && valueIs("VERTEX"))
+				parseVertex(&paths);
 		}
 	}
 	
+	if (filter.isValid())
+		applyFilter(num_filtered);
+	
+	finishReading();
 	if (must_close_device)
 	{
 		device->close();
@@ -150,50 +206,261 @@ QString DXFParser::parse()
 	return QString();
 }
 
+void DXFParser::applyFilter(int first)
+{
+	auto outside = [this](const DXFPath& path) {
+		if (path.coords.isEmpty())
+			return true;
+		
+		// Zero-sized extents must be handled, so QRectF::intersects() is not used.
+		qreal left = path.coords.front().x, right = left;
+		qreal top = path.coords.front().y, bottom = top;
+		for (const DXFCoordinate& coord : path.coords)
+		{
+			left   = qMin(left, coord.x);
+			right  = qMax(right, coord.x);
+			top    = qMin(top, coord.y);
+			bottom = qMax(bottom, coord.y);
+		}
+		return right + path.radius < filter.left()
+		       || left - path.radius > filter.right()
+		       || bottom + path.radius < filter.top()
+		       || top - path.radius > filter.bottom();
+	};
+	paths.erase(std::remove_if(paths.begin() + first, paths.end(), outside), paths.end());
+}
+
+void DXFParser::startReading()
+{
+	data_pos = device->pos();
+	mapped_data = nullptr;
+	
+	// Memory-mapping avoids copying the data of files.
+	QFileDevice* file = qobject_cast<QFileDevice*>(device);
+	if (file && !file->isSequential() && file->size() > data_pos)
+		mapped_data = file->map(data_pos, file->size() - data_pos);
+	
+	if (mapped_data)
+	{
+		data_begin = reinterpret_cast<const char*>(mapped_data);
+		data_end   = data_begin + (file->size() - data_pos);
+	}
+	else
+	{
+		buffer.clear();
+		data_begin = data_end = buffer.constData();
+	}
+	cursor = data_begin;
+}
+
+void DXFParser::finishReading()
+{
+	if (mapped_data)
+	{
+		static_cast<QFileDevice*>(device)->unmap(mapped_data);
+		mapped_data = nullptr;
+	}
+	buffer.clear();
+	data_begin = data_end = cursor = nullptr;
+}
+
+void DXFParser::prepareLines(int count)
+{
+	if (mapped_data)
+		return;
+	
+	for (;;)
+	{
+		int lines = 0;
+		for (auto pos = cursor; lines < count; ++lines)
+		{
+			pos = static_cast<const char*>(memchr(pos, '\n', data_end - pos));
+			if (!pos)
+				break;
+			++pos;
+		}
+		if (lines == count || device->atEnd())
+			return;
+		
+		// Keep the unread data, and append the next chunk.
+		const int offset = cursor - data_begin;
+		buffer.remove(0, offset);
+		const QByteArray chunk = device->read(read_chunk_size);
+		if (chunk.isEmpty())
+			return;
+		buffer.append(chunk);
+		data_pos += offset;
+		data_begin = cursor = buffer.constData();
+		data_end = data_begin + buffer.size();
+	}
+}
+
+inline
+bool DXFParser::readLine(const char*& begin, const char*& end)
+{
+	if (cursor == data_end)
+		return false;
+	
+	begin = cursor;
+	end = static_cast<const char*>(memchr(cursor, '\n', data_end - cursor));
+	if (end)
+		cursor = end + 1;
+	else
+		cursor = end = data_end;
+	
+	while (begin != end && isSpace(*begin))
+		++begin;
+	while (end != begin && isSpace(*(end-1)))
+		--end;
+	return true;
+}
+
+inline
+qint64 DXFParser::position() const
+{
+	return data_pos + (cursor - data_begin);
+}
+
+inline
+bool DXFParser::atEntityEnd()
+{
+	prepareLines(1);
+	const char* saved_cursor = cursor;
+	const char* begin;
+	const char* end;
+	const bool at_end = readLine(begin, end) && end - begin == 1 && *begin == '0';
+	cursor = saved_cursor;
+	return at_end;
+}
+
+inline
+bool DXFParser::readNextCodeValue()
+{
+	prepareLines(2);
+	const char* begin;
+	const char* end;
+	if (!readLine(begin, end))
+		return false;
+	group_code = parseInt(begin, end);
+	if (!readLine(begin, end))
+		return false;
+	value_data = begin;
+	value_size = end - begin;
+	return true;
+}
+
+inline
+bool DXFParser::valueIs(const char* text) const
+{
+	return qstrlen(text) == uint(value_size) && memcmp(value_data, text, value_size) == 0;
+}
+
 inline
-bool DXFParser::atEntityEnd(QIODevice* d)
+int DXFParser::valueToInt() const
 {
-	QByteArray data = d->peek(5);
-	const int linebreak = data.indexOf('\n');
-	if (linebreak > 0)
-		data.truncate(linebreak);
-	return data.trimmed() == "0";
+	return parseInt(value_data, value_data + value_size);
+}
+
+double DXFParser::valueToDouble() const
+{
+	const char* const end = value_data + value_size;
+	const char* pos = value_data;
+	const bool negative = (pos != end && *pos == '-');
+	if (pos != end && (*pos == '-' || *pos == '+'))
+		++pos;
+	
+	// Up to 19 significant digits fit into the mantissa.
+	quint64 mantissa = 0;
+	int significant_digits = 0;
+	int num_digits = 0;
+	int exponent = 0;
+	for (; pos != end && isDigit(*pos); ++pos, ++num_digits)
+	{
+		if (significant_digits < 19)
+		{
+			mantissa = 10 * mantissa + quint64(*pos - '0');
+			significant_digits += (mantissa != 0);
+		}
+		else
+		{
+			++exponent;
+		}
+	}
+	if (pos != end && *pos == '.')
+	{
+		for (++pos; pos != end && isDigit(*pos); ++pos, ++num_digits)
+		{
+			if (significant_digits < 19)
+			{
+				mantissa = 10 * mantissa + quint64(*pos - '0');
+				significant_digits += (mantissa != 0);
+				--exponent;
+			}
+		}
+	}
+	if (num_digits > 0 && pos != end && (*pos == 'e' || *pos == 'E'))
+	{
+		++pos;
+		const bool negative_exponent = (pos != end && *pos == '-');
+		if (pos != end && (*pos == '-' || *pos == '+'))
+			++pos;
+		int value = 0;
+		for (; pos != end && isDigit(*pos); ++pos)
+			value = qMin(10 * value + (*pos - '0'), 10000);
+		exponent += negative_exponent ? -value : value;
+	}
+	
+	// The result is exact if both the mantissa and the power of ten
+	// are exactly representable as double. Otherwise, or for unusual
+	// notations, Qt's conversion is used.
+	static const double powers_of_ten[] = {
+	    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	if (num_digits == 0 || pos != end || significant_digits > 15 || exponent < -22 || exponent > 22)
+		return QByteArray(value_data, value_size).toDouble();
+	
+	double result = double(mantissa);
+	if (exponent < 0)
+		result /= powers_of_ten[-exponent];
+	else
+		result *= powers_of_ten[exponent];
+	return negative ? -result : result;
 }
 
 inline
-bool DXFParser::readNextCodeValue(QIODevice *device, int &code, QString &value)
+QString DXFParser::valueToString() const
 {
-	code  = device->readLine(128).trimmed().toInt();
-	value = device->readLine(256).trimmed();
-	return !device->atEnd();
+	return QString::fromUtf8(value_data, value_size);
 }
 
 inline
-void DXFParser::parseCommon(int code, const QString& value, DXFPath& path)
+void DXFParser::parseCommon(DXFPath& path)
 {
-	if (code == 8)
+	if (group_code == 8)
 	{
-		path.layer = value;
+		path.layer = valueToString();
 	}
-	else if (code == 420)
+	else if (group_code == 420)
 	{
+		const QString value = valueToString();
 		QColor color;
 		color.setRed(value.left(2).toInt());
 		color.setGreen(value.mid(2, 2).toInt());
 		color.setBlue(value.right(2).toInt());
 		path.color = color;
 	}
-	else if (code == 430)
+	else if (group_code == 430)
 	{
-		path.color.setNamedColor(value);
+		path.color.setNamedColor(valueToString());
 	}
-	else if (code == 440)
+	else if (group_code == 440)
 	{
-		path.color.setAlpha(value.toInt());
+		path.color.setAlpha(valueToInt());
 	}
 }
 
-void DXFParser::parseLine(QIODevice *d, QList<DXFPath> *p)
+void DXFParser::parseLine(QList<DXFPath> *p)
 {
 	if (in_vertex)
 	{
@@ -206,26 +473,24 @@ void DXFParser::parseLine(QIODevice *d, QList<DXFPath> *p)
 	DXFCoordinate co1;
 	DXFCoordinate co2;
 	
-	int code;
-	QString value;
-	while (!atEntityEnd(d) && readNextCodeValue(d, code, value))
-	{
-		if (code == 39)
-			path.thickness = value.toInt();
-		else if (code == 10)
-			co1.x = value.toDouble();
-		else if (code == 20)
-			co1.y = value.toDouble();
-		else if (code == 30 || code == 50)
-			co1.z = value.toDouble();
-		else if (code == 11)
-			co2.x = value.toDouble();
-		else if (code == 21)
-			co2.y = value.toDouble();
-		else if (code == 31)
-			co2.z = value.toDouble();
+	while (!atEntityEnd() && readNextCodeValue())
+	{
+		if (group_code == 39)
+			path.thickness = valueToInt();
+		else if (group_code == 10)
+			co1.x = valueToDouble();
+		else if (group_code == 20)
+			co1.y = valueToDouble();
+		else if (group_code == 30 || group_code == 50)
+			co1.z = valueToDouble();
+		else if (group_code == 11)
+			co2.x = valueToDouble();
+		else if (group_code == 21)
+			co2.y = valueToDouble();
+		else if (group_code == 31)
+			co2.z = valueToDouble();
 		else
-			parseCommon(code, value, path);
+			parseCommon(path);
 	}
 	
 	path.coords.append(co1);
@@ -233,55 +498,53 @@ void DXFParser::parseLine(QIODevice *d, QList<DXFPath> *p)
 	p->append(path);
 }
 
-void DXFParser::parsePolyline(QIODevice *d, QList<DXFPath> *p)
+void DXFParser::parsePolyline(QList<DXFPath> *p)
 {
 	Q_UNUSED(p)
 	
 	vertex_main = DXFPath(LINE);
-	vertices = QList<DXFCoordinate>();
+	vertices.clear();
 	in_vertex = true;
 	
-	int code;
-	QString value;
-	while (!atEntityEnd(d) && readNextCodeValue(d, code, value))
+	while (!atEntityEnd() && readNextCodeValue())
 	{
-		if (code == 39)
-			vertex_main.thickness = value.toInt();
+		if (group_code == 39)
+			vertex_main.thickness = valueToInt();
 		else
-			parseCommon(code, value, vertex_main);
+			parseCommon(vertex_main);
 	}
 }
 
-void DXFParser::parseLwPolyline(QIODevice *d, QList<DXFPath> *p)
+void DXFParser::parseLwPolyline(QList<DXFPath> *p)
 {
 	DXFPath path(LINE);
-	QList<DXFCoordinate> coordinates;
+	QVector<DXFCoordinate> coordinates;
 	DXFCoordinate coord;
 	bool have_x = false;
 	bool have_y = false;
 
-	int code;
-	QString value;
-	while (!atEntityEnd(d) && readNextCodeValue(d, code, value))
+	while (!atEntityEnd() && readNextCodeValue())
 	{
-		if (code == 39)
-			path.thickness = value.toInt();
-		else if (code == 10)
+		if (group_code == 39)
+			path.thickness = valueToInt();
+		else if (group_code == 90)
+			coordinates.reserve(valueToInt());
+		else if (group_code == 10)
 		{
-			coord.x = value.toDouble();
+			coord.x = valueToDouble();
 			have_x = true;
 		}
-		else if (code == 20)
+		else if (group_code == 20)
 		{
-			coord.y = value.toDouble();
+			coord.y = valueToDouble();
 			have_y = true;
 		}
-		else if (code == 70)
+		else if (group_code == 70)
 		{
-			path.closed = (value.toInt() & 1) == 1;
+			path.closed = (valueToInt() & 1) == 1;
 		}
 		else
-			parseCommon(code, value, path);
+			parseCommon(path);
 		
 		if (have_x && have_y)
 		{
@@ -294,43 +557,41 @@ void DXFParser::parseLwPolyline(QIODevice *d, QList<DXFPath> *p)
 	p->append(path);
 }
 
-void DXFParser::parseSpline(QIODevice* d, QList<DXFPath>* p)
+void DXFParser::parseSpline(QList<DXFPath>* p)
 {
 	DXFPath path(SPLINE);
-	QList<DXFCoordinate> coordinates;
+	QVector<DXFCoordinate> coordinates;
 	DXFCoordinate coord;
 	bool have_x = false;
 	bool have_y = false;
 	
 	// TODO: very basic implementation assuming cubic bezier splines.
-	int code;
-	QString value;
-	while (!atEntityEnd(d) && readNextCodeValue(d, code, value))
+	while (!atEntityEnd() && readNextCodeValue())
 	{
-		if (code == 71)
+		if (group_code == 71)
 		{
-			if (value != "3")
+			if (!valueIs("3"))
 			{
-				qWarning() << QString("DXFParser: Splines of degree %1 are not supported!").arg(value);
+				qWarning() << QString("DXFParser: Splines of degree %1 are not supported!").arg(valueToString());
 				return;
 			}
 		}
-		else if (code == 10)
+		else if (group_code == 10)
 		{
-			coord.x = value.toDouble();
+			coord.x = valueToDouble();
 			have_x = true;
 		}
-		else if (code == 20)
+		else if (group_code == 20)
 		{
-			coord.y = value.toDouble();
+			coord.y = valueToDouble();
 			have_y = true;
 		}
-		else if (code == 70)
+		else if (group_code == 70)
 		{
-			path.closed = (value.toInt() & 1) == 1;
+			path.closed = (valueToInt() & 1) == 1;
 		}
 		else
-			parseCommon(code, value, path);
+			parseCommon(path);
 		
 		if (have_x && have_y)
 		{
@@ -343,7 +604,7 @@ void DXFParser::parseSpline(QIODevice* d, QList<DXFPath>* p)
 	p->append(path);
 }
 
-void DXFParser::parseCircle(QIODevice *d, QList<DXFPath> *p)
+void DXFParser::parseCircle(QList<DXFPath> *p)
 {
 	if (in_vertex)
 	{
@@ -355,28 +616,26 @@ void DXFParser::parseCircle(QIODevice *d, QList<DXFPath> *p)
 	DXFPath path(CIRCLE);
 	DXFCoordinate co;
 
-	int code;
-	QString value;
-	while (!atEntityEnd(d) && readNextCodeValue(d, code, value))
-	{
-		if (code == 39)
-			path.thickness = value.toInt();
-		else if (code == 10)
-			co.x = value.toDouble();
-		else if (code == 20)
-			co.y = value.toDouble();
-		else if (code == 30 || code == 50)
-			co.z = value.toDouble();
-		else if (code == 40)
-			path.radius = value.toInt();
+	while (!atEntityEnd() && readNextCodeValue())
+	{
+		if (group_code == 39)
+			path.thickness = valueToInt();
+		else if (group_code == 10)
+			co.x = valueToDouble();
+		else if (group_code == 20)
+			co.y = valueToDouble();
+		else if (group_code == 30 || group_code == 50)
+			co.z = valueToDouble();
+		else if (group_code == 40)
+			path.radius = valueToDouble();
 		else
-			parseCommon(code, value, path);
+			parseCommon(path);
 	}
 	path.coords.append(co);
 	p->append(path);
 }
 
-void DXFParser::parsePoint(QIODevice *d, QList<DXFPath> *p)
+void DXFParser::parsePoint(QList<DXFPath> *p)
 {
 	if (in_vertex)
 	{
@@ -388,48 +647,44 @@ void DXFParser::parsePoint(QIODevice *d, QList<DXFPath> *p)
 	DXFPath path(POINT);
 	DXFCoordinate co;
 	
-	int code;
-	QString value;
-	while (!atEntityEnd(d) && readNextCodeValue(d, code, value))
-	{
-		if (code == 39)
-			path.thickness = value.toInt();
-		else if (code == 10)
-			co.x = value.toDouble();
-		else if (code == 20)
-			co.y = value.toDouble();
-		else if (code == 30)
-			co.z = value.toDouble();
-		else if (code == 50)
-			path.rotation = value.toDouble();
+	while (!atEntityEnd() && readNextCodeValue())
+	{
+		if (group_code == 39)
+			path.thickness = valueToInt();
+		else if (group_code == 10)
+			co.x = valueToDouble();
+		else if (group_code == 20)
+			co.y = valueToDouble();
+		else if (group_code == 30)
+			co.z = valueToDouble();
+		else if (group_code == 50)
+			path.rotation = valueToDouble();
 		else
-			parseCommon(code, value, path);
+			parseCommon(path);
 	}
 	path.coords.append(co);
 	p->append(path);
 }
 
-void DXFParser::parseVertex(QIODevice *d, QList<DXFPath> *p)
+void DXFParser::parseVertex(QList<DXFPath> *p)
 {
 	Q_UNUSED(p)
 	
 	DXFCoordinate co;
 	
-	int code;
-	QString value;
-	while (!atEntityEnd(d) && readNextCodeValue(d, code, value))
+	while (!atEntityEnd() && readNextCodeValue())
 	{
-		if (code == 10)
-			co.x = value.toDouble();
-		if (code == 20)
-			co.y = value.toDouble();
-		if (code == 30 || code == 50)
-			co.z = value.toDouble();
+		if (group_code == 10)
+			co.x = valueToDouble();
+		if (group_code == 20)
+			co.y = valueToDouble();
+		if (group_code == 30 || group_code == 50)
+			co.z = valueToDouble();
 	}
 	vertices.append(co);
 }
 
-void DXFParser::parseSeqend(QIODevice *d, QList<DXFPath> *p)
+void DXFParser::parseSeqend(QList<DXFPath> *p)
 {
 	if (in_vertex)
 	{
@@ -438,15 +693,13 @@ void DXFParser::parseSeqend(QIODevice *d, QList<DXFPath> *p)
 		in_vertex = false;
 	}
 	
-	int code;
-	QString value;
-	while (!atEntityEnd(d) && readNextCodeValue(d, code, value))
+	while (!atEntityEnd() && readNextCodeValue())
 	{
 		; // nothing
 	}
 }
 
-void DXFParser::parseText(QIODevice *d, QList<DXFPath> *p)
+void DXFParser::parseText(QList<DXFPath> *p)
 {
 	if (in_vertex)
 	{
@@ -462,32 +715,30 @@ void DXFParser::parseText(QIODevice *d, QList<DXFPath> *p)
 	int alignment = 0;
 	int valignment = 0;
 	
-	int code;
-	QString value;
-	while (!atEntityEnd(d) && readNextCodeValue(d, code, value))
-	{
-		if (code == 39)
-			path.thickness = value.toInt();
-		else if (code == 10)
-			co.x = value.toDouble();
-		else if (code == 20)
-			co.y = value.toDouble();
-		else if (code == 30)
-			co.z = value.toDouble();
-		else if (code == 50)
-			path.rotation = value.toDouble();
-		else if (code == 1)
-			path.text = path.text.insert(path.text.indexOf(">")+1, value);
-		else if (code == 7)
-			path.text = path.text.arg(QString("font-family:")+value+QString(";%1"));
-		else if (code == 40)
-			path.font.setPointSizeF(value.toDouble());
-		else if (code == 72)
-			alignment = value.toInt();
-		else if (code == 73)
-			valignment = value.toInt();
+	while (!atEntityEnd() && readNextCodeValue())
+	{
+		if (group_code == 39)
+			path.thickness = valueToInt();
+		else if (group_code == 10)
+			co.x = valueToDouble();
+		else if (group_code == 20)
+			co.y = valueToDouble();
+		else if (group_code == 30)
+			co.z = valueToDouble();
+		else if (group_code == 50)
+			path.rotation = valueToDouble();
+		else if (group_code == 1)
+			path.text = path.text.insert(path.text.indexOf(">")+1, valueToString());
+		else if (group_code == 7)
+			path.text = path.text.arg(QString("font-family:")+valueToString()+QString(";%1"));
+		else if (group_code == 40)
+			path.font.setPointSizeF(valueToDouble());
+		else if (group_code == 72)
+			alignment = valueToInt();
+		else if (group_code == 73)
+			valignment = valueToInt();
 		else
-			parseCommon(code, value, path);
+			parseCommon(path);
 	}
 	
 	if (path.color != QColor(127,127,127))
@@ -531,7 +782,7 @@ void DXFParser::parseText(QIODevice *d, QList<DXFPath> *p)
 	p->append(path);
 }
 
-void DXFParser::parseArc(QIODevice *d, QList<DXFPath> *p)
+void DXFParser::parseArc(QList<DXFPath> *p)
 {
 	if (in_vertex)
 	{
@@ -543,46 +794,42 @@ void DXFParser::parseArc(QIODevice *d, QList<DXFPath> *p)
 	DXFPath path(ARC);
 	DXFCoordinate co;
 	
-	int code;
-	QString value;
-	while (!atEntityEnd(d) && readNextCodeValue(d, code, value))
-	{
-		if (code == 39)
-			path.thickness = value.toInt();
-		else if (code == 10)
-			co.x = value.toDouble();
-		else if (code == 20)
-			co.y = value.toDouble();
-		else if (code == 30)
-			co.z = value.toDouble();
-		else if (code == 40)
-			path.radius = value.toDouble();
-		else if (code == 50)
-			path.start_angle = value.toDouble();
-		else if (code == 51)
-			path.end_angle = value.toDouble();
+	while (!atEntityEnd() && readNextCodeValue())
+	{
+		if (group_code == 39)
+			path.thickness = valueToInt();
+		else if (group_code == 10)
+			co.x = valueToDouble();
+		else if (group_code == 20)
+			co.y = valueToDouble();
+		else if (group_code == 30)
+			co.z = valueToDouble();
+		else if (group_code == 40)
+			path.radius = valueToDouble();
+		else if (group_code == 50)
+			path.start_angle = valueToDouble();
+		else if (group_code == 51)
+			path.end_angle = valueToDouble();
 		else
-			parseCommon(code, value, path);
+			parseCommon(path);
 	}
 	//qDebug() << "start: " << path.startAngle <<" stop "<< path.endAngle << " radius " << path.radius;
 	path.coords.append(co);
 	p->append(path);
 }
 
-void DXFParser::parseExtminmax(QIODevice *d, QPointF &point)
+void DXFParser::parseExtminmax(QPointF &point)
 {
-	int code;
-	QString value;
-	while (!atEntityEnd(d) && readNextCodeValue(d, code, value))
+	while (!atEntityEnd() && readNextCodeValue())
 	{
-		if (code == 10)
-			point.setX(value.toDouble());
-		if (code == 20)
-			point.setY(value.toDouble());
+		if (group_code == 10)
+			point.setX(valueToDouble());
+		if (group_code == 20)
+			point.setY(valueToDouble());
 	}
 }
 
-void DXFParser::parseUnknown(QIODevice *d)
+void DXFParser::parseUnknown()
 {
 	if (in_vertex)
 	{
@@ -591,9 +838,7 @@ void DXFParser::parseUnknown(QIODevice *d)
 		in_vertex = false;
 	}
 	
-	int code;
-	QString value;
-	while (!atEntityEnd(d) && readNextCodeValue(d, code, value))
+	while (!atEntityEnd() && readNextCodeValue())
 	{
 		; // nothing
 	}
@@ -21,12 +21,15 @@
 #ifndef _OPENORIENTEERING_DXFPARSER_H_
 #define _OPENORIENTEERING_DXFPARSER_H_
 
+#include <functional>
+
 #include <QColor>
 #include <QFont>
 #include <QIODevice>
 #include <QList>
 #include <QRectF>
 #include <QString>
+#include <QVector>
 
 struct DXFCoordinate
 {
@@ -48,7 +51,7 @@ class DXFPath
 public:
 	DXFPath(type_e type);
 	
-	QList<DXFCoordinate> coords;
+	QVector<DXFCoordinate> coords;
 	QString layer;
 	QColor  color;
 	qreal   thickness;
@@ -66,13 +69,30 @@ public:
 /**
  * Parses DXF input data into lists of path_t.
  * 
+ * The data is read as a stream. With a filter extent, only the entities
+ * which intersect this extent are kept, so that the memory needed for large
+ * files depends on the size of the region of interest.
+ * 
+ * Files are memory-mapped if possible, and other devices are read in large
+ * chunks. The group codes and values are parsed directly from this buffer,
+ * without creating strings for numbers.
+ * 
  * TODO: Should be reviewed.
  */
 class DXFParser
 {
 public:
+	/**
+	 * A function which is called regularly during parsing, with the current
+	 * position in the data. Parsing is cancelled when it returns false.
+	 */
+	using ProgressHandler = std::function<bool (qint64)>;
+	
 	DXFParser();
 	void setData(QIODevice *data) { device = data; in_vertex = false; }
+	/** Sets the extent of the entities to be kept. An invalid rect keeps all entities. */
+	void setFilter(const QRectF& extent) { filter = extent; }
+	void setProgressHandler(const ProgressHandler& handler) { progress_handler = handler; }
 	QString parse();
 	QList<DXFPath> getData() { return paths; }
 	QRectF getSize() { return size; }
@@ -81,32 +101,67 @@ private:
 	QIODevice* device;
 	QList<DXFPath> paths;
 
-	QList<DXFCoordinate> vertices;
+	QVector<DXFCoordinate> vertices;
 	DXFPath vertex_main;
 	bool in_vertex;
 
 	QRectF size;
+	
+	QRectF filter;
+	ProgressHandler progress_handler;
 
 	int current_section;
-
-	bool readNextCodeValue(QIODevice* device, int& code, QString& value);
-
-	void parseCommon(int code, const QString& value, DXFPath& path);
-
-	void parseLine(QIODevice *d, QList<DXFPath> *p);
-	void parsePolyline(QIODevice *d, QList<DXFPath> *p);
-	void parseLwPolyline(QIODevice* d, QList<DXFPath> *p);
-	void parseSpline(QIODevice* d, QList<DXFPath> *p);
-	void parseCircle(QIODevice *d, QList<DXFPath> *p);
-	void parsePoint(QIODevice *d, QList<DXFPath> *p);
-	void parseVertex(QIODevice *d, QList<DXFPath> *p);
-	void parseSeqend(QIODevice *d, QList<DXFPath> *p);
-	void parseText(QIODevice *d, QList<DXFPath> *p);
-	void parseArc(QIODevice *d, QList<DXFPath> *p);
-	void parseExtminmax(QIODevice *d, QPointF &p);
-	void parseUnknown(QIODevice *d);
 	
-	bool atEntityEnd(QIODevice *d);
+	// The input buffer: either the mapped file, or a chunk of the data
+	QByteArray buffer;
+	uchar* mapped_data;
+	const char* data_begin;
+	const char* data_end;
+	const char* cursor;
+	qint64 data_pos;      ///< The device position of data_begin
+	
+	// The current group
+	int group_code;
+	const char* value_data;
+	int value_size;
+	
+	/** Starts reading from the device at its current position. */
+	void startReading();
+	/** Releases the input buffer. */
+	void finishReading();
+	/** Makes sure that the given number of lines is buffered, unless the data ends before. */
+	void prepareLines(int count);
+	/** Returns the next line without leading and trailing whitespace. */
+	bool readLine(const char*& begin, const char*& end);
+	/** Returns the position of the cursor in the device. */
+	qint64 position() const;
+	
+	bool readNextCodeValue();
+	
+	bool valueIs(const char* text) const;
+	int valueToInt() const;
+	double valueToDouble() const;
+	QString valueToString() const;
+
+	void parseCommon(DXFPath& path);
+
+	void parseLine(QList<DXFPath> *p);
+	void parsePolyline(QList<DXFPath> *p);
+	void parseLwPolyline(QList<DXFPath> *p);
+	void parseSpline(QList<DXFPath> *p);
+	void parseCircle(QList<DXFPath> *p);
+	void parsePoint(QList<DXFPath> *p);
+	void parseVertex(QList<DXFPath> *p);
+	void parseSeqend(QList<DXFPath> *p);
+	void parseText(QList<DXFPath> *p);
+	void parseArc(QList<DXFPath> *p);
+	void parseExtminmax(QPointF &p);
+	void parseUnknown();
+	
+	bool atEntityEnd();
+	
+	/** Removes the paths from the given index onwards which are outside the filter. */
+	void applyFilter(int first);
 
 	enum{
 		HEADER, ENTITIES, SECTION, NOTHING, POLYLINE
@@ -143,7 +198,15 @@ DXFPath::DXFPath(type_e type)
 inline
 DXFParser::DXFParser()
  : device(0),
-   vertex_main(UNKNOWN)
+   vertex_main(UNKNOWN),
+   mapped_data(0),
+   data_begin(0),
+   data_end(0),
+   cursor(0),
+   data_pos(0),
+   group_code(-1),
+   value_data(0),
+   value_size(0)
 {
 	; // nothing
 }
@@ -21,6 +21,7 @@
 
 #include "file_format_native.h"
 
+#include <QBuffer>
 #include <QFile>
 #include <QScopedValueRollback>
 
@@ -124,6 +125,17 @@ void NativeFileImport::import(bool load_symbols_only)
                             "Support for this format is to be removed from this program soon. "
                             "To be able to open the file in the future, save it again."));
 
+    // The format is read in many small pieces. Reading the whole file at
+    // once and parsing it from memory is much faster.
+    QBuffer buffer;
+    QScopedValueRollback<QIODevice*> stream_rollback(stream);
+    if (!qobject_cast<QBuffer*>(stream) && !stream->isSequential())
+    {
+        buffer.setData(stream->readAll());
+        buffer.open(QIODevice::ReadOnly);
+        stream = &buffer;
+    }
+
     MapCoord::boundsOffset().reset(true);
 
     char buffer[4];
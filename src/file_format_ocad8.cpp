@@ -21,18 +21,24 @@
 #include "file_format_ocad8.h"
 #include "file_format_ocad8_p.h"
 
+#include <functional>
+#include <utility>
+
 #include <qmath.h>
 #include <QDateTime>
 #include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QImageReader>
+#include <QRectF>
 #include <QTextCodec>
 
 #include "core/georeferencing.h"
 #include "core/map_color.h"
 #include "core/map_coord.h"
 #include "core/map_view.h"
+#include "core/task_pool.h"
 #include "file_format_xml.h"
 #include "file_import_export.h"
 #include "map.h"
@@ -108,13 +114,21 @@ void OCAD8FileImport::import(bool load_symbols_only)
 {
     //qint64 start = QDateTime::currentMSecsSinceEpoch();
 	
-	u32 size = stream->bytesAvailable();
-	u8* buffer = (u8*)malloc(size);
-	if (!buffer)
-		throw FileFormatException(tr("Could not allocate buffer."));
-	if (stream->read((char*)buffer, size) != size)
-		throw FileFormatException(Importer::tr("Could not read file: %1").arg(stream->errorString()));
-	int err = ocad_file_open_memory(&file, buffer, size);
+	// Memory-mapping avoids copying the data of local files.
+	int err = -10;
+	QFile* local_file = qobject_cast<QFile*>(stream);
+	if (local_file && stream->pos() == 0 && !local_file->fileName().startsWith(QLatin1Char(':')))
+		err = ocad_file_open_mapped(&file, QFile::encodeName(local_file->fileName()).constData());
+	if (err != 0)
+	{
+		u32 size = stream->bytesAvailable();
+		u8* buffer = (u8*)malloc(size);
+		if (!buffer)
+			throw FileFormatException(tr("Could not allocate buffer."));
+		if (stream->read((char*)buffer, size) != size)
+			throw FileFormatException(Importer::tr("Could not read file: %1").arg(stream->errorString()));
+		err = ocad_file_open_memory(&file, buffer, size);
+	}
     if (err != 0) throw FileFormatException(Importer::tr("Could not read file: %1").arg(tr("libocad returned %1").arg(err)));
 	
 	if (file->header->major <= 5 || file->header->major >= 9)
@@ -285,20 +299,30 @@ void OCAD8FileImport::import(bool load_symbols_only)
 
 		// Place all objects into a single OCAD import part
 		MapPart* part = new MapPart(tr("OCAD import layer"), map);
-		for (OCADObjectIndex *idx = ocad_objidx_first(file); idx != NULL; idx = ocad_objidx_next(file, idx))
-		{
-			for (int i = 0; i < 256; i++)
+		std::pair<OCAD8FileImport*, MapPart*> param(this, part);
+		auto import_entry = [](void* param, OCADFile* file, OCADObjectEntry* entry) -> bool {
+			auto importer = static_cast<std::pair<OCAD8FileImport*, MapPart*>*>(param);
+			OCADObject *ocad_obj = ocad_object(file, entry);
+			if (ocad_obj != NULL)
 			{
-				OCADObjectEntry *entry = ocad_object_entry_at(file, idx, i);
-				OCADObject *ocad_obj = ocad_object(file, entry);
-				if (ocad_obj != NULL)
-				{
-					Object *object = importObject(ocad_obj, part);
-					if (object != NULL) {
-						part->objects.push_back(object);
-					}
+				Object *object = importer->first->importObject(ocad_obj, importer->second);
+				if (object != NULL) {
+					importer->second->objects.push_back(object);
 				}
 			}
+			return true;
+		};
+		const QRectF clip_rect = clipRegion().boundingRect();
+		if (!clip_rect.isNull())
+		{
+			// The index blocks hold the bounding boxes, so objects outside
+			// of the region are skipped without touching their data.
+			const OCADRect ocad_rect = convertRect(clip_rect);
+			ocad_object_entry_iterate_rect(file, &ocad_rect, import_entry, &param);
+		}
+		else
+		{
+			ocad_object_entry_iterate(file, import_entry, &param);
 		}
 		delete map->parts[0];
 		map->parts[0] = part;
@@ -1089,7 +1113,7 @@ bool OCAD8FileImport::importRectangleObject(const OCADObject* ocad_object, MapPa
 		coords.emplace_back(top_left_f + right * handle_radius);
 		coords.emplace_back(top_left_f + right * rect.corner_radius);
 	}
-	PathObject *border_path = new PathObject(rect.border_line, coords, map);
+	PathObject *border_path = new PathObject(rect.border_line, std::move(coords), map);
 	border_path->parts().front().setClosed(true, false);
 	part->objects.push_back(border_path);
 	
@@ -1495,6 +1519,18 @@ void OCAD8FileImport::convertPoint(MapCoord &coord, int ocad_x, int ocad_y)
     coord.setNativeY(offset_y + (qint32)ocad_y * (-10));
 }
 
+OCADRect OCAD8FileImport::convertRect(const QRectF& map_rect) const
+{
+	// Inverse of convertPoint(), with points in the upper 24 bits.
+	OCADRect rect;
+	rect.min.x = qFloor((map_rect.left() * 1000 - offset_x) / 10) << 8;
+	rect.max.x = qCeil((map_rect.right() * 1000 - offset_x) / 10) << 8;
+	// Y-axis is flipped.
+	rect.min.y = qFloor((map_rect.bottom() * 1000 - offset_y) / -10) << 8;
+	rect.max.y = qCeil((map_rect.top() * 1000 - offset_y) / -10) << 8;
+	return rect;
+}
+
 qint32 OCAD8FileImport::convertSize(int ocad_size) {
     // OCAD uses hundredths of a millimeter.
     // oo-mapper uses 1/1000 mm
@@ -1519,6 +1555,13 @@ double OCAD8FileImport::convertTemplateScale(double ocad_scale)
 
 // ### OCAD8FileExport ###
 
+namespace
+{
+	/** The minimum number of objects for which coordinates are encoded in worker threads. */
+	const int min_concurrent_export_size = 1000;
+}
+
+
 OCAD8FileExport::OCAD8FileExport(QIODevice* stream, Map* map, MapView* view)
  : Exporter(stream, map, view),
    uses_registration_color(false),
@@ -1655,141 +1698,210 @@ void OCAD8FileExport::doExport()
 	}
 	
 	// Objects
-	OCADObject* ocad_object = ocad_object_alloc(NULL);
+	// Text coordinates depend on the text layout which is done by the update.
+	map->updateObjects();
+	
+	// The coordinates of point and path objects are encoded concurrently,
+	// into a single buffer at offsets which are determined in advance.
+	// Text objects need font metrics, so they are encoded sequentially.
+	std::vector<Object*> objects;
+	std::vector<std::size_t> coords_offsets;
+	std::size_t num_coords = 0;
+	u32 reserved_size = 0;
 	for (int l = 0; l < map->getNumParts(); ++l)
 	{
-		for (int o = 0; o < map->getPart(l)->getNumObjects(); ++o)
+		MapPart* part = map->getPart(l);
+		objects.reserve(objects.size() + part->getNumObjects());
+		coords_offsets.reserve(objects.capacity());
+		for (int o = 0; o < part->getNumObjects(); ++o)
 		{
-			memset(ocad_object, 0, sizeof(OCADObject) - sizeof(OCADPoint) + 8 * (ocad_object->npts + ocad_object->ntext));
-			Object* object = map->getPart(l)->getObject(o);
-			object->update();
+			Object* object = part->getObject(o);
+			objects.push_back(object);
+			coords_offsets.push_back(num_coords);
 			
-			// Fill some common entries of object struct
-			OCADPoint* coord_buffer = ocad_object->pts;
+			u32 npts;
 			if (object->getType() != Object::Text)
-				ocad_object->npts = exportCoordinates(object->getRawCoordinateVector(), &coord_buffer, object->getSymbol());
-			else
-				ocad_object->npts = exportTextCoordinates(static_cast<TextObject*>(object), &coord_buffer);
-			
-			if (object->getType() == Object::Point)
 			{
-				PointObject* point = static_cast<PointObject*>(object);
-				ocad_object->angle = convertRotation(point->getRotation());
+				num_coords += object->getRawCoordinateVector().size();
+				npts = u32(qMin(object->getRawCoordinateVector().size(), std::size_t(OCAD_MAX_OBJECT_PTS)));
 			}
-			else if (object->getType() == Object::Path)
+			else
 			{
-				PathObject* path = static_cast<PathObject*>(object);
-				ocad_object->angle = convertRotation(path->getPatternRotation());
-				if (path->getPatternOrigin() != MapCoord(0, 0))
-					addWarning(tr("Unable to export fill pattern shift for an area object"));
+				npts = 5 + static_cast<TextObject*>(object)->getText().length() / 4 + 1;
 			}
-			else if (object->getType() == Object::Text)
+			auto found = symbol_index.constFind(object->getSymbol());
+			reserved_size += ocad_object_size_npts(npts) * (found == symbol_index.constEnd() ? 1 : found->size());
+		}
+	}
+	
+	std::vector<OCADPoint> coords(num_coords);
+	const int num_objects = int(objects.size());
+	std::function<void (int)> encode = [&objects, &coords_offsets, &coords](int i) {
+		const Object* object = objects[i];
+		if (object->getType() != Object::Text)
+		{
+			OCADPoint* coord_buffer = coords.data() + coords_offsets[i];
+			exportCoordinates(object->getRawCoordinateVector(), &coord_buffer, object->getSymbol());
+		}
+	};
+	if (num_objects >= min_concurrent_export_size)
+	{
+		TaskPool::forEach(num_objects, 64, encode);
+	}
+	else
+	{
+		for (int i = 0; i < num_objects; ++i)
+			encode(i);
+	}
+	
+	// Avoid repeated reallocation of the file buffer while adding the objects.
+	reserved_size += (num_objects / 256 + 1) * sizeof(OCADObjectIndex);
+	ocad_file_reserve(file, reserved_size);
+	
+	OCADObject* ocad_object = ocad_object_alloc(NULL);
+	for (int i = 0; i < num_objects; ++i)
+	{
+		memset(ocad_object, 0, sizeof(OCADObject) - sizeof(OCADPoint) + 8 * (ocad_object->npts + ocad_object->ntext));
+		Object* object = objects[i];
+		
+		// Fill some common entries of object struct
+		OCADPoint* coord_buffer = ocad_object->pts;
+		if (object->getType() != Object::Text)
+		{
+			std::size_t npts = object->getRawCoordinateVector().size();
+			if (npts > OCAD_MAX_OBJECT_PTS)
 			{
-				TextObject* text = static_cast<TextObject*>(object);
-				ocad_object->unicode = 1;
-				ocad_object->angle = convertRotation(text->getRotation());
-				int num_letters = convertWideCString(text->getText(), (unsigned char*)coord_buffer, 8 * (OCAD_MAX_OBJECT_PTS - ocad_object->npts));
-				ocad_object->ntext = qCeil(num_letters / 4.0f);
+				addWarning(tr("Unable to export all coordinates of an object with more than %1 coordinates.").arg(OCAD_MAX_OBJECT_PTS));
+				npts = OCAD_MAX_OBJECT_PTS;
 			}
+			if (npts > 0)
+				memcpy(coord_buffer, coords.data() + coords_offsets[i], npts * sizeof(OCADPoint));
+			ocad_object->npts = u16(npts);
+			coord_buffer += npts;
+		}
+		else
+		{
+			ocad_object->npts = exportTextCoordinates(static_cast<TextObject*>(object), &coord_buffer);
+		}
+		
+		if (object->getType() == Object::Point)
+		{
+			PointObject* point = static_cast<PointObject*>(object);
+			ocad_object->angle = convertRotation(point->getRotation());
+		}
+		else if (object->getType() == Object::Path)
+		{
+			PathObject* path = static_cast<PathObject*>(object);
+			ocad_object->angle = convertRotation(path->getPatternRotation());
+			if (path->getPatternOrigin() != MapCoord(0, 0))
+				addWarning(tr("Unable to export fill pattern shift for an area object"));
+		}
+		else if (object->getType() == Object::Text)
+		{
+			TextObject* text = static_cast<TextObject*>(object);
+			ocad_object->unicode = 1;
+			ocad_object->angle = convertRotation(text->getRotation());
+			int num_letters = convertWideCString(text->getText(), (unsigned char*)coord_buffer, 8 * (OCAD_MAX_OBJECT_PTS - ocad_object->npts));
+			ocad_object->ntext = qCeil(num_letters / 4.0f);
+		}
+		
+		// Insert an object into the map for every symbol contained in the symbol_index
+		std::set<s16> index_set;
+		if (symbol_index.contains(object->getSymbol()))
+			index_set = symbol_index[object->getSymbol()];
+		else
+			index_set.insert(-1);	// export as undefined symbol
+		
+		for (std::set<s16>::const_iterator it = index_set.begin(), end = index_set.end(); it != end; ++it)
+		{
+			s16 index_to_use = *it;
 			
-			// Insert an object into the map for every symbol contained in the symbol_index
-			std::set<s16> index_set;
-			if (symbol_index.contains(object->getSymbol()))
-				index_set = symbol_index[object->getSymbol()];
-			else
-				index_set.insert(-1);	// export as undefined symbol
-			
-			for (std::set<s16>::const_iterator it = index_set.begin(), end = index_set.end(); it != end; ++it)
+			// For text objects, check if we have to change / create a new text symbol because of the formatting
+			if (object->getType() == Object::Text && symbol_index.contains(object->getSymbol()))
 			{
-				s16 index_to_use = *it;
-				
-				// For text objects, check if we have to change / create a new text symbol because of the formatting
-				if (object->getType() == Object::Text && symbol_index.contains(object->getSymbol()))
+				TextObject* text_object = static_cast<TextObject*>(object);
+				const TextSymbol* text_symbol = static_cast<const TextSymbol*>(object->getSymbol());
+				if (!text_format_map.contains(text_symbol))
 				{
-					TextObject* text_object = static_cast<TextObject*>(object);
-					const TextSymbol* text_symbol = static_cast<const TextSymbol*>(object->getSymbol());
-					if (!text_format_map.contains(text_symbol))
-					{
-						// Adjust the formatting in the first created symbol to this object
-						OCADTextSymbol* ocad_text_symbol = (OCADTextSymbol*)ocad_symbol(file, *it);
-						setTextSymbolFormatting(ocad_text_symbol, text_object);
-						
-						TextFormatList new_list;
-						new_list.push_back(std::make_pair(text_object, *it));
-						text_format_map.insert(text_symbol, new_list);
-					}
-					else
+					// Adjust the formatting in the first created symbol to this object
+					OCADTextSymbol* ocad_text_symbol = (OCADTextSymbol*)ocad_symbol(file, *it);
+					setTextSymbolFormatting(ocad_text_symbol, text_object);
+					
+					TextFormatList new_list;
+					new_list.push_back(std::make_pair(text_object, *it));
+					text_format_map.insert(text_symbol, new_list);
+				}
+				else
+				{
+					// Check if this formatting has already been created as symbol.
+					// If yes, use this symbol, else create a new symbol
+					TextFormatList& format_list = text_format_map[text_symbol];
+					bool found = false;
+					for (size_t i = 0, end = format_list.size(); i < end; ++i)
 					{
-						// Check if this formatting has already been created as symbol.
-						// If yes, use this symbol, else create a new symbol
-						TextFormatList& format_list = text_format_map[text_symbol];
-						bool found = false;
-						for (size_t i = 0, end = format_list.size(); i < end; ++i)
-						{
-							if (format_list[i].first->getHorizontalAlignment() == text_object->getHorizontalAlignment())
-							{
-								index_to_use = format_list[i].second;
-								found = true;
-								break;
-							}
-						}
-						if (!found)
+						if (format_list[i].first->getHorizontalAlignment() == text_object->getHorizontalAlignment())
 						{
-							// Copy the symbol and adjust the formatting
-							// TODO: insert these symbols directly after the original symbols
-							OCADTextSymbol* ocad_text_symbol = (OCADTextSymbol*)ocad_symbol(file, *it);
-							OCADTextSymbol* new_symbol = (OCADTextSymbol*)ocad_symbol_new(file, ocad_text_symbol->size);
-							// Get the pointer to the first symbol again as it might have changed during ocad_symbol_new()
-							ocad_text_symbol = (OCADTextSymbol*)ocad_symbol(file, *it);
-							
-							memcpy(new_symbol, ocad_text_symbol, ocad_text_symbol->size);
-							setTextSymbolFormatting(new_symbol, text_object);
-							
-							// Give the new symbol a unique number
-							while (symbol_numbers.find(new_symbol->number) != symbol_numbers.end())
-								++new_symbol->number;
-							symbol_numbers.insert(new_symbol->number);
-							index_to_use = new_symbol->number;
-
-							// Store packed new_symbol->number in separate variable first,
-							// otherwise when compiling for Android this causes the error:
-							// cannot bind packed field 'new_symbol->_OCADTextSymbol::number' to 'short int&'
-							s16 new_symbol_number = new_symbol->number;
-							format_list.push_back(std::make_pair(text_object, new_symbol_number));
+							index_to_use = format_list[i].second;
+							found = true;
+							break;
 						}
 					}
+					if (!found)
+					{
+						// Copy the symbol and adjust the formatting
+						// TODO: insert these symbols directly after the original symbols
+						OCADTextSymbol* ocad_text_symbol = (OCADTextSymbol*)ocad_symbol(file, *it);
+						OCADTextSymbol* new_symbol = (OCADTextSymbol*)ocad_symbol_new(file, ocad_text_symbol->size);
+						// Get the pointer to the first symbol again as it might have changed during ocad_symbol_new()
+						ocad_text_symbol = (OCADTextSymbol*)ocad_symbol(file, *it);
+						
+						memcpy(new_symbol, ocad_text_symbol, ocad_text_symbol->size);
+						setTextSymbolFormatting(new_symbol, text_object);
+						
+						// Give the new symbol a unique number
+						while (symbol_numbers.find(new_symbol->number) != symbol_numbers.end())
+							++new_symbol->number;
+						symbol_numbers.insert(new_symbol->number);
+						index_to_use = new_symbol->number;
+
+						// Store packed new_symbol->number in separate variable first,
+						// otherwise when compiling for Android this causes the error:
+						// cannot bind packed field 'new_symbol->_OCADTextSymbol::number' to 'short int&'
+						s16 new_symbol_number = new_symbol->number;
+						format_list.push_back(std::make_pair(text_object, new_symbol_number));
+					}
 				}
-				
-				ocad_object->symbol = index_to_use;
-				if (object->getType() == Object::Point)
-					ocad_object->type = 1;
-				else if (object->getType() == Object::Path)
-				{
-					OCADSymbol* ocad_sym = ocad_symbol(file, index_to_use);
-					if (!ocad_sym)
-						ocad_object->type = 2;	// This case is for undefined lines; TODO: make another case for undefined areas, as soon as they are implemented
-					else if (ocad_sym->type == 2)
-						ocad_object->type = 2;	// Line
-					else //if (ocad_symbol->type == 3)
-						ocad_object->type = 3;	// Area
-				}
-				else if (object->getType() == Object::Text)
-				{
-					TextObject* text_object = static_cast<TextObject*>(object);
-					if (text_object->hasSingleAnchor())
-						ocad_object->type = 4;
-					else
-						ocad_object->type = 5;
-				}
-				
-				OCADObjectEntry* entry;
-				ocad_object_add(file, ocad_object, &entry);
-				// This is done internally by libocad (in a slightly more imprecise way using the extent specified in the symbol)
-				//entry->rect.min = convertPoint(MapCoord(object->getExtent().topLeft()));
-				//entry->rect.max = convertPoint(MapCoord(object->getExtent().bottomRight()));
-				entry->npts = ocad_object->npts + ocad_object->ntext;
-				//entry->symbol = index_to_use;
 			}
+			
+			ocad_object->symbol = index_to_use;
+			if (object->getType() == Object::Point)
+				ocad_object->type = 1;
+			else if (object->getType() == Object::Path)
+			{
+				OCADSymbol* ocad_sym = ocad_symbol(file, index_to_use);
+				if (!ocad_sym)
+					ocad_object->type = 2;	// This case is for undefined lines; TODO: make another case for undefined areas, as soon as they are implemented
+				else if (ocad_sym->type == 2)
+					ocad_object->type = 2;	// Line
+				else //if (ocad_symbol->type == 3)
+					ocad_object->type = 3;	// Area
+			}
+			else if (object->getType() == Object::Text)
+			{
+				TextObject* text_object = static_cast<TextObject*>(object);
+				if (text_object->hasSingleAnchor())
+					ocad_object->type = 4;
+				else
+					ocad_object->type = 5;
+			}
+			
+			OCADObjectEntry* entry;
+			ocad_object_add(file, ocad_object, &entry);
+			// This is done internally by libocad (in a slightly more imprecise way using the extent specified in the symbol)
+			//entry->rect.min = convertPoint(MapCoord(object->getExtent().topLeft()));
+			//entry->rect.max = convertPoint(MapCoord(object->getExtent().bottomRight()));
+			entry->npts = ocad_object->npts + ocad_object->ntext;
+			//entry->symbol = index_to_use;
 		}
 	}
 	
@@ -45,7 +45,12 @@ class PointSymbol;
 class Template;
 class TextSymbol;
 
-/** Importer for OCD version 8 files. */
+/**
+ * Importer for OCD version 8 files.
+ * 
+ * When importing a region, the objects outside of the region are skipped
+ * by means of the bounding boxes in the object index, without decoding them.
+ */
 class OCAD8FileImport : public Importer
 {
 	friend class OcdFileImport;
@@ -86,6 +91,8 @@ protected:
 
 	// Object import
 	Object *importObject(const OCADObject *ocad_object, MapPart* part);
+	/// Returns the OCAD rectangle covering the given rectangle in map coordinates.
+	OCADRect convertRect(const QRectF& map_rect) const;
 	bool importRectangleObject(const OCADObject* ocad_object, MapPart* part, const RectangleInfo& rect);
 
 	// String import
@@ -170,7 +177,8 @@ protected:
 	
 	// Helper functions
 	/// Returns the number of exported coordinates. If not NULL, the given symbol is used to determine the meaning of dash points.
-	u16 exportCoordinates(const MapCoordVector& coords, OCADPoint** buffer, const Symbol* symbol);
+	/// This function is thread-safe.
+	static u16 exportCoordinates(const MapCoordVector& coords, OCADPoint** buffer, const Symbol* symbol);
 	u16 exportTextCoordinates(TextObject* object, OCADPoint** buffer);
 	int getOcadColor(QRgb rgb);
 	s16 getPointSymbolExtent(const PointSymbol* symbol);
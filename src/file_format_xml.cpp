@@ -22,12 +22,14 @@
 #include "file_format_xml.h"
 #include "file_format_xml_p.h"
 
+#include <QBuffer>
 #include <QDebug>
 #include <QFile>
 #include <QScopedValueRollback>
 #include <QStringBuilder>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
+#include <QtEndian>
 
 #ifdef QT_PRINTSUPPORT_LIB
 #  include <QPrinter>
@@ -38,8 +40,10 @@
 #include "core/map_grid.h"
 #include "core/map_printer.h"
 #include "core/map_view.h"
+#include "core/zlib_device.h"
 #include "file_import_export.h"
 #include "map.h"
+#include "map_part.h"
 #include "object.h"
 #include "object_text.h"
 #include "settings.h"
@@ -56,6 +60,7 @@
 
 const int XMLFileFormat::minimum_version = 2;
 const int XMLFileFormat::current_version = 6;
+const int XMLFileFormat::barrier_version = 7;
 
 int XMLFileFormat::active_version = 5; // updated by XMLFileExporter::doExport()
 
@@ -89,6 +94,64 @@ Exporter *XMLFileFormat::createExporter(QIODevice* stream, Map *map, MapView *vi
 
 
 
+// ### CompactXMLFileFormat definition ###
+
+const char CompactXMLFileFormat::magic_bytes[8] = { 'O', 'O', 'M', 'A', 'P', 'B', 'I', 'N' };
+const quint32 CompactXMLFileFormat::container_version = 1;
+
+CompactXMLFileFormat::CompactXMLFileFormat()
+ : FileFormat(MapFile, "XML-Compact", ImportExport::tr("OpenOrienteering Mapper (compact)"), "omapc",
+              ImportSupported | ExportSupported)
+{
+	// Nothing
+}
+
+bool CompactXMLFileFormat::understands(const unsigned char *buffer, size_t sz) const
+{
+	return sz >= sizeof(magic_bytes) && memcmp(buffer, magic_bytes, sizeof(magic_bytes)) == 0;
+}
+
+Importer *CompactXMLFileFormat::createImporter(QIODevice* stream, Map *map, MapView *view) const
+{
+	return new CompactXMLFileImporter(stream, map, view);
+}
+
+Exporter *CompactXMLFileFormat::createExporter(QIODevice* stream, Map *map, MapView *view) const
+{
+	return new CompactXMLFileExporter(stream, map, view);
+}
+
+
+
+// ### CompressedXMLFileFormat definition ###
+
+const char CompressedXMLFileFormat::magic_bytes[8] = { 'O', 'O', 'M', 'A', 'P', 'Z', 'I', 'P' };
+const quint32 CompressedXMLFileFormat::container_version = 1;
+
+CompressedXMLFileFormat::CompressedXMLFileFormat()
+ : FileFormat(MapFile, "XML-Compressed", ImportExport::tr("OpenOrienteering Mapper (compressed)"), "omapz",
+              ImportSupported | ExportSupported)
+{
+	// Nothing
+}
+
+bool CompressedXMLFileFormat::understands(const unsigned char *buffer, size_t sz) const
+{
+	return sz >= sizeof(magic_bytes) && memcmp(buffer, magic_bytes, sizeof(magic_bytes)) == 0;
+}
+
+Importer *CompressedXMLFileFormat::createImporter(QIODevice* stream, Map *map, MapView *view) const
+{
+	return new CompressedXMLFileImporter(stream, map, view);
+}
+
+Exporter *CompressedXMLFileFormat::createExporter(QIODevice* stream, Map *map, MapView *view) const
+{
+	return new CompressedXMLFileExporter(stream, map, view);
+}
+
+
+
 // ### A namespace which collects various string constants of type QLatin1String. ###
 
 namespace literal
@@ -162,7 +225,8 @@ namespace literal
 
 XMLFileExporter::XMLFileExporter(QIODevice* stream, Map *map, MapView *view)
 : Exporter(stream, map, view),
-  xml(stream)
+  xml(stream),
+  has_map_state(false)
 {
 	// Determine auto-formatting default from filename, if possible.
 	auto file = qobject_cast<const QFileDevice*>(stream);
@@ -175,9 +239,7 @@ void XMLFileExporter::doExport()
 	if (option("autoFormatting").toBool() == true)
 		xml.setAutoFormatting(true);
 	
-	int current_version = XMLFileFormat::current_version;
-	bool retain_compatibility = Settings::getInstance().getSetting(Settings::General_RetainCompatiblity).toBool();
-	XMLFileFormat::active_version = retain_compatibility ? current_version-1 : current_version;
+	activateVersion();
 	
 	if (XMLFileFormat::active_version < 6 && map->getNumParts() != 1)
 	{
@@ -191,7 +253,10 @@ void XMLFileExporter::doExport()
 		XmlElementWriter map_element(xml, literal::map);
 		map_element.writeAttribute(literal::version, XMLFileFormat::active_version);
 		
-		xml.writeTextElement(literal::notes, map->getMapNotes());
+		if (has_map_state)
+			copyMapState(literal::templates);
+		else
+			xml.writeTextElement(literal::notes, map->getMapNotes());
 		
 		exportGeoreferencing();
 		exportColors();
@@ -208,25 +273,107 @@ void XMLFileExporter::doExport()
 		}
 		exportSymbols();
 		exportMapParts();
-		exportTemplates();
-		exportView();
-		exportPrint();
+		if (has_map_state)
+		{
+			copyMapState(literal::undo);
+		}
+		else
+		{
+			exportTemplates();
+			exportView();
+			exportPrint();
+		}
 		delete barrier;
 
 		// Prevent Mapper versions < 0.6.0 from crashing
 		// when compatibilty mode IS activated
 		// Incompatible feature: new undo step types
+		// Prevent Mapper versions < 0.6.1 from silently dropping the history
+		// when compatibilty mode is NOT activated
+		// Incompatible feature: packed undo steps
 		barrier = new XmlElementWriter(xml, literal::barrier);
-		barrier->writeAttribute(literal::version, 6);
-		barrier->writeAttribute(literal::required, "0.6.0");
-		exportUndo();
-		exportRedo();
+		if (XMLFileFormat::active_version >= 6)
+		{
+			barrier->writeAttribute(literal::version, 7);
+			barrier->writeAttribute(literal::required, "0.6.1");
+		}
+		else
+		{
+			barrier->writeAttribute(literal::version, 6);
+			barrier->writeAttribute(literal::required, "0.6.0");
+		}
+		if (has_map_state)
+		{
+			copyMapState(QLatin1String());
+		}
+		else
+		{
+			exportUndo();
+			exportRedo();
+		}
 		delete barrier;
 	}
 	
 	xml.writeEndDocument();
 }
 
+void XMLFileExporter::exportMapState()
+{
+	activateVersion();
+	
+	xml.writeDefaultNamespace(XMLFileFormat::mapper_namespace);
+	xml.writeStartDocument();
+	{
+		// The order of the elements matches doExport().
+		XmlElementWriter map_element(xml, literal::map);
+		xml.writeTextElement(literal::notes, map->getMapNotes());
+		exportTemplates();
+		exportView();
+		exportPrint();
+		exportUndo();
+		exportRedo();
+	}
+	xml.writeEndDocument();
+}
+
+void XMLFileExporter::setMapState(const QByteArray& state)
+{
+	map_state.clear();
+	map_state.addData(state);
+	// Enter the map element, and go to its first child.
+	map_state.readNextStartElement();
+	map_state.readNextStartElement();
+	has_map_state = true;
+}
+
+void XMLFileExporter::activateVersion()
+{
+	int current_version = XMLFileFormat::current_version;
+	bool retain_compatibility = Settings::getInstance().getSetting(Settings::General_RetainCompatiblity).toBool();
+	XMLFileFormat::active_version = retain_compatibility ? current_version-1 : current_version;
+}
+
+void XMLFileExporter::copyMapState(const QLatin1String& stop_name)
+{
+	while (map_state.isStartElement() && map_state.name() != stop_name)
+	{
+		int depth = 0;
+		do
+		{
+			if (map_state.isStartElement())
+				++depth;
+			else if (map_state.isEndElement())
+				--depth;
+			xml.writeCurrentToken(map_state);
+			map_state.readNext();
+		}
+		while (depth > 0 && !map_state.atEnd());
+	}
+	
+	if (map_state.hasError())
+		throw FileFormatException(map_state.errorString());
+}
+
 void XMLFileExporter::exportGeoreferencing()
 {
 	map->getGeoreferencing().save(xml);
@@ -372,12 +519,13 @@ void XMLFileExporter::exportPrint()
 
 void XMLFileExporter::exportUndo()
 {
-	map->undoManager().saveUndo(xml);
+	// Packed steps are hidden from older Mapper versions by a barrier.
+	map->undoManager().saveUndo(xml, XMLFileFormat::active_version >= 6);
 }
 
 void XMLFileExporter::exportRedo()
 {
-	map->undoManager().saveRedo(xml);
+	map->undoManager().saveRedo(xml, XMLFileFormat::active_version >= 6);
 }
 
 
@@ -419,8 +567,20 @@ void XMLFileImporter::import(bool load_symbols_only)
 	QScopedValueRollback<MapCoord::BoundsOffset> rollback { MapCoord::boundsOffset() };
 	MapCoord::boundsOffset().reset(true);
 	georef_offset_adjusted = false;
+	symbols_complete = false;
 	importElements(load_symbols_only);
 	
+	// Deferred map parts must be loaded with the offset of the other data.
+	for (MapPart* part : map->parts)
+	{
+		if (part->isLoaded())
+			continue;
+		else if (part == map->getCurrentPart() || MapCoord::boundsOffset().check_for_offset)
+			part->loadDeferredObjects();
+		else
+			part->setDeferredBoundsOffset(MapCoord::boundsOffset());
+	}
+	
 	auto offset = MapCoord::boundsOffset();
 	if (!load_symbols_only && !offset.isZero())
 	{
@@ -462,13 +622,16 @@ void XMLFileImporter::importElements(bool load_symbols_only)
 		if (name == literal::colors)
 			importColors();
 		else if (name == literal::symbols)
+		{
 			importSymbols();
+			symbols_complete = load_symbols_only;
+		}
 		else if (name == literal::georeferencing)
 			importGeoreferencing(load_symbols_only);
 		else if (name == literal::barrier)
 		{
 			XmlElementReader barrier(xml);
-			if (barrier.attribute<int>(literal::version) > XMLFileFormat::current_version)
+			if (barrier.attribute<int>(literal::version) > XMLFileFormat::barrier_version)
 			{
 				QString required_version = barrier.attribute<QString>(literal::required);
 				if (required_version.isEmpty())
@@ -481,6 +644,12 @@ void XMLFileImporter::importElements(bool load_symbols_only)
 				importElements(load_symbols_only);
 			}
 		}
+		else if (symbols_complete)
+		{
+			// Stop reading. In a large map file, the objects would take
+			// much longer to skip than the symbols took to load.
+			xml.raiseError(QStringLiteral("Symbols complete"));
+		}
 		else if (load_symbols_only)
 			xml.skipCurrentElement();
 		/******************************************************
@@ -507,7 +676,7 @@ void XMLFileImporter::importElements(bool load_symbols_only)
 		}
 	}
 	
-	if (xml.error())
+	if (xml.error() && !symbols_complete)
 		throw FileFormatException(
 		        tr("Error at line %1 column %2: %3")
 		        .arg(xml.lineNumber())
@@ -751,11 +920,30 @@ void XMLFileImporter::importMapParts()
 	map->parts.clear();
 	map->parts.reserve(qMin(num_parts, 20)); // 20 is not a limit
 	
+	// For importing a region, the objects outside are dropped part by part,
+	// so that they do not accumulate.
+	const QRectF clip_rect = clipRegion().boundingRect();
+	
+	// Binary coordinate blocks are available during the import only.
+	const bool defer_loading = !BinaryCoordBlocks::forDevice(xml.device())
+	                           && clip_rect.isNull()
+	                           && Settings::getInstance().getSetting(Settings::General_DeferMapPartLoading).toBool();
+	
 	while (xml.readNextStartElement())
 	{
 		if (xml.name() == literal::part)
 		{
-			map->parts.push_back(MapPart::load(xml, *map, symbol_dict));
+			if (defer_loading && map->getNumParts() != current_part_index)
+			{
+				map->parts.push_back(MapPart::loadDeferred(xml, *map, symbol_dict));
+			}
+			else
+			{
+				map->parts.push_back(MapPart::load(xml, *map, symbol_dict));
+				// Shifted coordinates are handled after the import.
+				if (!clip_rect.isNull() && MapCoord::boundsOffset().isZero())
+					removeObjectsOutside(map->parts.back(), clip_rect);
+			}
 		}
 		else
 		{
@@ -887,3 +1075,203 @@ void XMLFileImporter::importRedo()
 		map->undoManager().clear();
 	}
 }
+
+
+
+// ### CompactXMLFileExporter definition ###
+
+namespace
+{
+	/** The size of the container header, without the table of contents. */
+	const int compact_header_size = 24;
+	
+	/** Returns the number of padding bytes needed after size bytes. */
+	int paddingFor(quint64 size)
+	{
+		return int((8 - size % 8) % 8);
+	}
+	
+	void writeOrThrow(QIODevice* stream, const char* data, qint64 size)
+	{
+		if (stream->write(data, size) != size)
+			throw FileFormatException(stream->errorString());
+	}
+}
+
+CompactXMLFileExporter::CompactXMLFileExporter(QIODevice* stream, Map *map, MapView *view)
+: XMLFileExporter(stream, map, view)
+{
+	setOption("autoFormatting", false);
+}
+
+void CompactXMLFileExporter::doExport()
+{
+	QByteArray xml_data;
+	BinaryCoordBlocks blocks;
+	BinaryCoordBlocks::Buffer xml_buffer(&xml_data, blocks);
+	xml_buffer.open(QIODevice::WriteOnly);
+	xml.setDevice(&xml_buffer);
+	XMLFileExporter::doExport();
+	xml.setDevice(stream);
+	
+	const std::vector<quint64>& offsets = blocks.offsets();
+	QByteArray header(compact_header_size + 8 * int(offsets.size()), '\0');
+	uchar* pos = reinterpret_cast<uchar*>(header.data());
+	memcpy(pos, CompactXMLFileFormat::magic_bytes, sizeof(CompactXMLFileFormat::magic_bytes));
+	qToLittleEndian<quint32>(CompactXMLFileFormat::container_version, pos + 8);
+	qToLittleEndian<quint32>(quint32(offsets.size()), pos + 12);
+	qToLittleEndian<quint64>(quint64(xml_data.size()), pos + 16);
+	pos += compact_header_size;
+	for (quint64 offset : offsets)
+	{
+		qToLittleEndian<quint64>(offset, pos);
+		pos += 8;
+	}
+	
+	// The block data starts at a multiple of eight bytes, for direct access.
+	xml_data.append(QByteArray(paddingFor(header.size() + xml_data.size()), '\0'));
+	
+	writeOrThrow(stream, header.constData(), header.size());
+	writeOrThrow(stream, xml_data.constData(), xml_data.size());
+	writeOrThrow(stream, blocks.data().constData(), blocks.data().size());
+}
+
+
+
+// ### CompactXMLFileImporter definition ###
+
+CompactXMLFileImporter::CompactXMLFileImporter(QIODevice* stream, Map *map, MapView *view)
+: XMLFileImporter(stream, map, view)
+{
+	//NOP
+}
+
+void CompactXMLFileImporter::import(bool load_symbols_only)
+{
+	const QByteArray data = stream->readAll();
+	const uchar* pos = reinterpret_cast<const uchar*>(data.constData());
+	if (data.size() < compact_header_size || memcmp(pos, CompactXMLFileFormat::magic_bytes, sizeof(CompactXMLFileFormat::magic_bytes)) != 0)
+		throw FileFormatException(Importer::tr("Unsupported file format."));
+	
+	const quint32 version = qFromLittleEndian<quint32>(pos + 8);
+	if (version != CompactXMLFileFormat::container_version)
+		throw FileFormatException(Importer::tr("Invalid file format version."));
+	
+	const quint64 num_blocks = qFromLittleEndian<quint32>(pos + 12);
+	const quint64 xml_size   = qFromLittleEndian<quint64>(pos + 16);
+	const quint64 xml_offset = compact_header_size + 8 * num_blocks;
+	if (xml_offset > quint64(data.size()) || xml_size > quint64(data.size()) - xml_offset)
+		throw FileFormatException(tr("The file is truncated."));
+	
+	std::vector<quint64> offsets;
+	offsets.reserve(num_blocks);
+	for (pos += compact_header_size; offsets.size() < num_blocks; pos += 8)
+		offsets.push_back(qFromLittleEndian<quint64>(pos));
+	
+	const quint64 data_offset = qMin(quint64(data.size()), xml_offset + xml_size + paddingFor(xml_offset + xml_size));
+	BinaryCoordBlocks blocks(QByteArray::fromRawData(data.constData() + data_offset, data.size() - int(data_offset)), offsets);
+	
+	QByteArray xml_data = QByteArray::fromRawData(data.constData() + xml_offset, int(xml_size));
+	BinaryCoordBlocks::Buffer xml_buffer(&xml_data, blocks);
+	xml_buffer.open(QIODevice::ReadOnly);
+	xml.setDevice(&xml_buffer);
+	XMLFileImporter::import(load_symbols_only);
+	xml.setDevice(stream);
+}
+
+
+
+// ### CompressedXMLFileExporter definition ###
+
+namespace
+{
+	/** The size of the header of the compressed container. */
+	const int compressed_header_size = 16;
+}
+
+CompressedXMLFileExporter::CompressedXMLFileExporter(QIODevice* stream, Map *map, MapView *view)
+: XMLFileExporter(stream, map, view)
+{
+	setOption("autoFormatting", false);
+}
+
+void CompressedXMLFileExporter::doExport()
+{
+	QByteArray header(compressed_header_size, '\0');
+	uchar* pos = reinterpret_cast<uchar*>(header.data());
+	memcpy(pos, CompressedXMLFileFormat::magic_bytes, sizeof(CompressedXMLFileFormat::magic_bytes));
+	qToLittleEndian<quint32>(CompressedXMLFileFormat::container_version, pos + 8);
+	qToLittleEndian<quint32>(CompressedXMLFileFormat::Zlib, pos + 12);
+	writeOrThrow(stream, header.constData(), header.size());
+	
+	// The plain XML document is streamed to the compressor. The compact
+	// format would need to hold the document in memory.
+	ZlibOutputDevice device(stream);
+	if (!device.open(QIODevice::WriteOnly))
+		throw FileFormatException(device.errorString());
+	
+	xml.setDevice(&device);
+	{
+		QScopedValueRollback<QIODevice*> rollback { stream, &device };
+		XMLFileExporter::doExport();
+	}
+	xml.setDevice(stream);
+	
+	if (!device.finish())
+		throw FileFormatException(device.errorString());
+}
+
+
+
+// ### CompressedXMLFileImporter definition ###
+
+CompressedXMLFileImporter::CompressedXMLFileImporter(QIODevice* stream, Map *map, MapView *view)
+: CompactXMLFileImporter(stream, map, view)
+{
+	//NOP
+}
+
+void CompressedXMLFileImporter::import(bool load_symbols_only)
+{
+	const QByteArray header = stream->read(compressed_header_size);
+	const uchar* pos = reinterpret_cast<const uchar*>(header.constData());
+	if (header.size() < compressed_header_size || memcmp(pos, CompressedXMLFileFormat::magic_bytes, sizeof(CompressedXMLFileFormat::magic_bytes)) != 0)
+		throw FileFormatException(Importer::tr("Unsupported file format."));
+	
+	const quint32 version = qFromLittleEndian<quint32>(pos + 8);
+	if (version != CompressedXMLFileFormat::container_version)
+		throw FileFormatException(Importer::tr("Invalid file format version."));
+	
+	const quint32 method = qFromLittleEndian<quint32>(pos + 12);
+	if (method != CompressedXMLFileFormat::Zlib)
+		throw FileFormatException(Importer::tr("Unsupported compression method."));
+	
+	ZlibInputDevice device(stream);
+	if (!device.open(QIODevice::ReadOnly))
+		throw FileFormatException(device.errorString());
+	
+	const bool compact = device.peek(sizeof(CompactXMLFileFormat::magic_bytes))
+	                     == QByteArray::fromRawData(CompactXMLFileFormat::magic_bytes, sizeof(CompactXMLFileFormat::magic_bytes));
+	
+	xml.setDevice(&device);
+	try
+	{
+		QScopedValueRollback<QIODevice*> rollback { stream, &device };
+		if (compact)
+			CompactXMLFileImporter::import(load_symbols_only);
+		else
+			XMLFileImporter::import(load_symbols_only);
+	}
+	catch (FileFormatException&)
+	{
+		xml.setDevice(stream);
+		// A parser error is a consequence of a decompression error.
+		if (device.hasError())
+			throw FileFormatException(device.errorString());
+		throw;
+	}
+	xml.setDevice(stream);
+	
+	if (device.hasError())
+		throw FileFormatException(device.errorString());
+}
@@ -53,6 +53,14 @@ public:
 	 */
 	static const int current_version;
 	
+	/** @brief The highest version of barrier elements supported by this implementation.
+	 * 
+	 * This may be higher than current_version when a feature must be hidden
+	 * from older implementations without changing the file format version.
+	 * Version 7 marks packed undo steps.
+	 */
+	static const int barrier_version;
+	
 	/** @brief The actual XML file format version to be written.
 	 * 
 	 * This value must be less than or equal to current_version.
@@ -68,4 +76,96 @@ public:
 	static const QString mapper_namespace;
 };
 
+
+/** @brief Interface for dealing with compact binary containers of XML maps.
+ * 
+ * This format stores the same XML document as XMLFileFormat, but the
+ * coordinates of all objects are stored in binary blocks which follow the
+ * document (cf. BinaryCoordBlocks). All values are little-endian.
+ * 
+ * Layout:
+ * - The magic bytes (8 bytes).
+ * - The container version (quint32).
+ * - The number of coordinate blocks (quint32).
+ * - The size of the XML document (quint64).
+ * - The table of contents: the offset of each block in the block data (quint64 each).
+ * - The XML document, padded to a multiple of eight bytes.
+ * - The block data.
+ */
+class CompactXMLFileFormat : public FileFormat
+{
+public:
+	/** @brief Creates a new file format of type XML-Compact.
+	 */
+	CompactXMLFileFormat();
+	
+	/** @brief Returns true if the file starts with the magic bytes.
+	 */
+	bool understands(const unsigned char *buffer, size_t sz) const;
+	
+	/** @brief Creates an importer for compact XML files.
+	 */
+	Importer *createImporter(QIODevice* stream, Map *map, MapView *view) const;
+	
+	/** @brief Creates an exporter for compact XML files.
+	 */
+	Exporter *createExporter(QIODevice* stream, Map *map, MapView *view) const;
+	
+	/** @brief The characteristic magic bytes at the beginning of the file: "OOMAPBIN"
+	 */
+	static const char magic_bytes[8];
+	
+	/** @brief The version of the container layout created by this implementation.
+	 */
+	static const quint32 container_version;
+};
+
+
+
+/** @brief The zlib compressed container of the xml based map format.
+ * 
+ * The file starts with a header of 16 bytes: the magic bytes, the container
+ * version and the compression method, both as little-endian 32 bit integers.
+ * The compressed stream follows. It contains a document in the plain XML
+ * format, or in the compact format.
+ * 
+ * The document is compressed while it is written, and decompressed in a
+ * helper thread while it is parsed, so the uncompressed document is never
+ * held in memory as a whole.
+ */
+class CompressedXMLFileFormat : public FileFormat
+{
+public:
+	/** @brief Creates a new file format of type XML-Compressed.
+	 */
+	CompressedXMLFileFormat();
+	
+	/** @brief Returns true if the file starts with the magic bytes.
+	 */
+	bool understands(const unsigned char *buffer, size_t sz) const;
+	
+	/** @brief Creates an importer for compressed XML files.
+	 */
+	Importer *createImporter(QIODevice* stream, Map *map, MapView *view) const;
+	
+	/** @brief Creates an exporter for compressed XML files.
+	 */
+	Exporter *createExporter(QIODevice* stream, Map *map, MapView *view) const;
+	
+	/** @brief The characteristic magic bytes at the beginning of the file: "OOMAPZIP"
+	 */
+	static const char magic_bytes[8];
+	
+	/** @brief The version of the container layout created by this implementation.
+	 */
+	static const quint32 container_version;
+	
+	/** @brief The compression methods.
+	 */
+	enum CompressionMethod
+	{
+		Zlib = 1
+	};
+};
+
 #endif // _OPENORIENTEERING_FILE_FORMAT_XML_H
@@ -38,7 +38,33 @@ public:
 	
 	virtual void doExport();
 	
+	/**
+	 * Writes the notes, the templates, the view, the print configuration and
+	 * the undo history of the map into a separate document.
+	 * 
+	 * These parts are not contained in a snapshot of the map (cf.
+	 * Map::snapshot()). The document can be passed to the exporter of the
+	 * snapshot, cf. setMapState().
+	 */
+	void exportMapState();
+	
+	/**
+	 * Sets a document from exportMapState() which replaces the notes, the
+	 * templates, the view, the print configuration and the undo history of
+	 * the exported map.
+	 */
+	void setMapState(const QByteArray& state);
+	
 protected:
+	/** Sets XMLFileFormat::active_version from the settings. */
+	void activateVersion();
+	
+	/**
+	 * Copies the top-level elements of the map state to the document, up to
+	 * the element with the given name, or to the end.
+	 */
+	void copyMapState(const QLatin1String& stop_name);
+	
 	void exportGeoreferencing();
 	void exportColors();
 	void exportSymbols();
@@ -49,8 +75,11 @@ protected:
 	void exportUndo();
 	void exportRedo();
 	
-private:
 	QXmlStreamWriter xml;
+	
+	/// The map state from setMapState(), positioned at the next element to copy
+	QXmlStreamReader map_state;
+	bool has_map_state;
 };
 
 
@@ -81,6 +110,58 @@ protected:
 	QXmlStreamReader xml;
 	SymbolDictionary symbol_dict;
 	bool georef_offset_adjusted;
+	/// Set when loading symbols only, after the symbols were imported.
+	bool symbols_complete;
+};
+
+
+/** Map exporter for the compact binary container of the xml based map format. */
+class CompactXMLFileExporter : public XMLFileExporter
+{
+public:
+	CompactXMLFileExporter(QIODevice* stream, Map *map, MapView *view);
+	virtual ~CompactXMLFileExporter() {}
+	
+	virtual void doExport();
+};
+
+
+/** Map importer for the compact binary container of the xml based map format. */
+class CompactXMLFileImporter : public XMLFileImporter
+{
+public:
+	CompactXMLFileImporter(QIODevice* stream, Map *map, MapView *view);
+	virtual ~CompactXMLFileImporter() {}
+	
+protected:
+	virtual void import(bool load_symbols_only);
+};
+
+
+/** Map exporter for the compressed container of the xml based map format. */
+class CompressedXMLFileExporter : public XMLFileExporter
+{
+public:
+	CompressedXMLFileExporter(QIODevice* stream, Map *map, MapView *view);
+	virtual ~CompressedXMLFileExporter() {}
+	
+	virtual void doExport();
+};
+
+
+/**
+ * Map importer for the compressed container of the xml based map format.
+ * 
+ * The compressed document may use the plain or the compact format.
+ */
+class CompressedXMLFileImporter : public CompactXMLFileImporter
+{
+public:
+	CompressedXMLFileImporter(QIODevice* stream, Map *map, MapView *view);
+	virtual ~CompressedXMLFileImporter() {}
+	
+protected:
+	virtual void import(bool load_symbols_only);
 };
 
 #endif
@@ -21,14 +21,25 @@
 
 #include "file_import_export.h"
 
+#include <algorithm>
+#include <initializer_list>
+#include <memory>
+
 #include <QFileInfo>
 
+#include "core/georeferencing.h"
+#include "core/map_view.h"
+#include "core/tracing.h"
 #include "map.h"
+#include "map_part.h"
+#include "settings.h"
 #include "symbol.h"
 #include "template.h"
 #include "object.h"
 #include "symbol_line.h"
 #include "symbol_point.h"
+#include "tool_boolean.h"
+#include "util.h"
 
 
 // ### ImportExport ###
@@ -48,6 +59,8 @@ Importer::~Importer()
 
 void Importer::doImport(bool load_symbols_only, const QString& map_path)
 {
+	MAPPER_TRACE_SCOPE("file", "Importer::doImport");
+	
 	import(load_symbols_only);
 	
 	// Object post processing:
@@ -56,36 +69,13 @@ void Importer::doImport(bool load_symbols_only, const QString& map_path)
 	// - make sure that there are no special points in wrong places (e.g. curve starts inside curves)
 	for (int p = 0; p < map->getNumParts(); ++p)
 	{
+		// Deferred parts are post-processed when they are loaded.
 		MapPart* part = map->getPart(p);
-		for (int o = 0; o < part->getNumObjects(); ++o)
-		{
-			Object* object = part->getObject(o);
-			if (object->getSymbol() == NULL)
-			{
-				addWarning(Importer::tr("Found an object without symbol."));
-				if (object->getType() == Object::Point)
-					object->setSymbol(map->getUndefinedPoint(), true);
-				else if (object->getType() == Object::Path)
-					object->setSymbol(map->getUndefinedLine(), true);
-				else
-				{
-					// There is no undefined symbol for this type of object, delete the object
-					part->deleteObject(o, false);
-					--o;
-					continue;
-				}
-			}
-			
-			if (object->getType() == Object::Path)
-			{
-				PathObject* path = object->asPath();
-				Symbol::Type contained_types = path->getSymbol()->getContainedTypes();
-				if (contained_types & Symbol::Area && !(contained_types & Symbol::Line))
-					path->closeAllParts();
-				
-				path->normalize();
-			}
-		}
+		if (!part->isLoaded())
+			continue;
+		
+		for (int i = part->postProcessObjects(); i > 0; --i)
+			addWarning(Importer::tr("Found an object without symbol."));
 	}
 	
 	if (auto deleted = map->deleteIrregularObjects())
@@ -100,18 +90,28 @@ void Importer::doImport(bool load_symbols_only, const QString& map_path)
 			throw FileFormatException(Importer::tr("Error during symbol post-processing."));
 	}
 	
-	// Template loading: try to find all template files
+	// Region import: objects which were not skipped by the importer
+	const QPolygonF clip_region = clipRegion();
+	if (!clip_region.isEmpty())
+		clipObjects(clip_region);
+	
+	// Template loading: try to find all template files,
+	// and load them in the background.
+	// When loading on demand, hidden templates are loaded when they are shown.
+	const bool load_on_demand = Settings::getInstance().getSettingCached(Settings::Templates_LoadOnDemand).toBool();
 	bool have_lost_template = false;
 	for (int i = 0; i < map->getNumTemplates(); ++i)
 	{
 		Template* temp = map->getTemplate(i);
 		
 		bool loaded_from_template_dir = false;
-		temp->tryToFindAndReloadTemplateFile(map_path, &loaded_from_template_dir);
+		bool found = temp->tryToFindTemplateFile(map_path, &loaded_from_template_dir);
+		if (!found || !load_on_demand || !view || view->isTemplateVisible(temp))
+			temp->loadTemplateFileAsync();
 		if (loaded_from_template_dir)
 			addWarning(Importer::tr("Template \"%1\" has been loaded from the map's directory instead of the relative location to the map file where it was previously.").arg(temp->getTemplateFilename()));
 		
-		if (temp->getTemplateState() != Template::Loaded)
+		if (temp->getTemplateState() == Template::Invalid)
 			have_lost_template = true;
 	}
 	if (have_lost_template)
@@ -130,6 +130,104 @@ void Importer::finishImport()
 	// Nothing, not inlined
 }
 
+QPolygonF Importer::clipRegion() const
+{
+	const QRectF clip_rect = option(QString::fromLatin1("clipRect")).toRectF();
+	if (clip_rect.isValid())
+		return QPolygonF(clip_rect);
+	
+	const QRectF projected_rect = option(QString::fromLatin1("clipProjectedRect")).toRectF();
+	if (!projected_rect.isValid())
+		return QPolygonF();
+	
+	// With grivation, the region is a rotated rectangle in map coordinates.
+	const Georeferencing& georef = map->getGeoreferencing();
+	QPolygonF region;
+	region.reserve(5);
+	for (const QPointF& corner : { projected_rect.bottomLeft(), projected_rect.bottomRight(), projected_rect.topRight(), projected_rect.topLeft() })
+		region.append(georef.toMapCoordF(corner));
+	region.append(region.first());
+	return region;
+}
+
+bool Importer::isOutsideClipRect(const QRectF& box, const QRectF& clip_rect)
+{
+	return box.right() < clip_rect.left()
+	       || box.left() > clip_rect.right()
+	       || box.bottom() < clip_rect.top()
+	       || box.top() > clip_rect.bottom();
+}
+
+bool Importer::isOutsideClipRect(const Object* object, const QRectF& clip_rect)
+{
+	// The control points of curves enclose the curves.
+	const MapCoordVector& coords = object->getRawCoordinateVector();
+	if (coords.empty())
+		return false;
+	
+	QRectF box(QPointF(coords.front()), QSizeF(0, 0));
+	for (const MapCoord& coord : coords)
+		rectInclude(box, QPointF(coord));
+	return isOutsideClipRect(box, clip_rect);
+}
+
+void Importer::removeObjectsOutside(MapPart* part, const QRectF& clip_rect)
+{
+	std::vector<int> outside;
+	for (int i = 0, count = part->getNumObjects(); i < count; ++i)
+	{
+		if (isOutsideClipRect(part->getObject(i), clip_rect))
+			outside.push_back(i);
+	}
+	part->deleteObjects(outside, false);
+}
+
+void Importer::clipObjects(const QPolygonF& region)
+{
+	const QRectF clip_rect = region.boundingRect();
+	for (int p = 0; p < map->getNumParts(); ++p)
+	{
+		MapPart* part = map->getPart(p);
+		if (!part->isLoaded())
+			continue;
+		
+		removeObjectsOutside(part, clip_rect);
+		if (!option(QString::fromLatin1("clipAreas")).toBool())
+			continue;
+		
+		// Cut the areas which cross the boundary. Other symbols would get
+		// artificial borders, so they are kept as they are.
+		for (int i = part->getNumObjects() - 1; i >= 0; --i)
+		{
+			Object* object = part->getObject(i);
+			const Symbol* symbol = object->getSymbol();
+			if (object->getType() != Object::Path || !symbol || symbol->getType() != Symbol::Area)
+				continue;
+			
+			const MapCoordVector& coords = object->getRawCoordinateVector();
+			if (std::all_of(coords.begin(), coords.end(), [&region](const MapCoord& coord) {
+				return region.containsPoint(QPointF(coord), Qt::OddEvenFill);
+			}))
+				continue;
+			
+			PathObject* area = object->asPath();
+			std::unique_ptr<PathObject> clip_path(new PathObject(symbol));
+			for (int j = 0; j < region.size() - 1; ++j)
+				clip_path->addCoordinate(MapCoord(region[j]));
+			clip_path->closeAllParts();
+			
+			BooleanTool::PathObjects in_objects = { area, clip_path.get() };
+			BooleanTool::PathObjects out_objects;
+			if (!BooleanTool(BooleanTool::Intersection, map).executeForObjects(area, in_objects, out_objects))
+				continue;
+			
+			part->deleteObject(i, false);
+			for (std::size_t j = 0; j < out_objects.size(); ++j)
+				part->addObject(out_objects[j], i + int(j));
+		}
+	}
+}
+
 
 // ### Exporter ###
 
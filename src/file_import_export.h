@@ -24,6 +24,8 @@
 
 #include <QHash>
 #include <QObject>
+#include <QPolygonF>
+#include <QRectF>
 #include <QVariant>
 
 #include "file_format.h"
@@ -33,7 +35,9 @@ class QIODevice;
 class Importer;
 class Exporter;
 class Map;
+class MapPart;
 class MapView;
+class Object;
 
 
 /** Abstract base class for both importer and exporters; provides support for configuring the map and
@@ -119,6 +123,17 @@ class ImportAction
  *     action item will have its satisfy() method called with the user's choice.
  *  -# finishImport() will be called. If any action items were created, this method
  *     should finish the import based on the values supplied by the user.
+ *
+ *  All importers support the following options for importing a region of a map:
+ *  - "clipRect": A QRectF in map coordinates. Objects which are wholly outside
+ *    this rectangle are not imported.
+ *  - "clipProjectedRect": The same in projected coordinates. It is used when
+ *    "clipRect" is not set.
+ *  - "clipAreas": If true, area objects which cross the boundary of the region
+ *    are cut at the boundary (default: false).
+ *
+ *  Importers should skip the objects outside of the region while parsing,
+ *  where possible. Any remaining objects are removed by doImport().
  */
 class Importer : public ImportExport
 {
@@ -161,7 +176,32 @@ protected:
 	 */
 	inline void addAction(const ImportAction &action);
 	
+	/** Returns the region given by the "clipRect" or "clipProjectedRect" option, in map
+	 *  coordinates, or an empty polygon if no region is set. Projected coordinates are
+	 *  converted with the map's current georeferencing, so the georeferencing must be
+	 *  imported before calling this function.
+	 */
+	QPolygonF clipRegion() const;
+	
+	/** Returns true if the box is wholly outside of the clip rectangle. Unlike
+	 *  QRectF::intersects(), this handles boxes of zero width or height.
+	 */
+	static bool isOutsideClipRect(const QRectF& box, const QRectF& clip_rect);
+	
+	/** Returns true if the object's coordinates are wholly outside of the clip rectangle.
+	 */
+	static bool isOutsideClipRect(const Object* object, const QRectF& clip_rect);
+	
+	/** Deletes the objects of the part which are wholly outside of the clip rectangle.
+	 */
+	static void removeObjectsOutside(MapPart* part, const QRectF& clip_rect);
+	
 private:
+	/** Removes the objects outside of the clip region from all loaded parts,
+	 *  and cuts the areas at its boundary if the "clipAreas" option is set.
+	 */
+	void clipObjects(const QPolygonF& region);
+	
 	/// A list of action items that must be resolved before the import can be completed
 	std::vector<ImportAction> act;
 };
@@ -238,7 +278,9 @@ inline
 Importer::Importer(QIODevice* stream, Map* map, MapView* view)
  : ImportExport(stream, map, view)
 {
-	// Nothing
+	setOption(QString::fromLatin1("clipRect"), QRectF());
+	setOption(QString::fromLatin1("clipProjectedRect"), QRectF());
+	setOption(QString::fromLatin1("clipAreas"), false);
 }
 
 inline
@@ -23,9 +23,14 @@
 #include "ocd_file_format.h"
 #include "ocd_file_format_p.h"
 
+#include <functional>
+#include <initializer_list>
+#include <limits>
+
 #include <QBuffer>
 #include <QDebug>
 #include <QDir>
+#include <QFileDevice>
 #include <QFileInfo>
 #include <QImageReader>
 
@@ -36,6 +41,7 @@
 #include "../core/map_color.h"
 #include "../core/map_view.h"
 #include "../core/georeferencing.h"
+#include "../core/task_pool.h"
 #include "../file_format_ocad8.h"
 #include "../file_format_ocad8_p.h"
 #include "../map.h"
@@ -52,6 +58,63 @@
 #include "../util.h"
 
 
+namespace
+{
+	/**
+	 * Maps the contents of a file device to memory, for the lifetime of this
+	 * object.
+	 * 
+	 * When the data is no longer mapped, the given buffer is cleared because
+	 * it may refer to the mapped memory.
+	 */
+	class FileMapping
+	{
+	public:
+		FileMapping(QIODevice* stream, QByteArray& buffer)
+		 : file(qobject_cast<QFileDevice*>(stream))
+		 , data(nullptr)
+		 , size(0)
+		 , buffer(buffer)
+		{
+			if (file && !file->isSequential() && file->size() > 0 && file->size() <= std::numeric_limits<int>::max())
+			{
+				size = file->size();
+				data = file->map(0, size);
+			}
+		}
+		
+		~FileMapping()
+		{
+			if (data)
+			{
+				buffer.clear();
+				file->unmap(data);
+			}
+		}
+		
+		FileMapping(const FileMapping&) = delete;
+		FileMapping& operator=(const FileMapping&) = delete;
+		
+		/** Returns the mapped data without copying, or an empty array if mapping failed. */
+		QByteArray byteArray() const
+		{
+			return data ? QByteArray::fromRawData(reinterpret_cast<const char*>(data), int(size)) : QByteArray();
+		}
+		
+	private:
+		QFileDevice* file;
+		uchar* data;
+		qint64 size;
+		QByteArray& buffer;
+	};
+	
+	
+	/** The minimum number of objects for which the import uses worker threads. */
+	const std::size_t min_concurrent_import_size = 1000;
+}
+
+
+
 // ### OcdFileFormat ###
 
 OcdFileFormat::OcdFileFormat()
@@ -158,6 +221,8 @@ void OcdFileImport::importImplementation< Ocd::FormatLegacyImporter >(bool load_
 	QBuffer new_stream(&buffer);
 	new_stream.open(QIODevice::ReadOnly);
 	delegate.reset(new OCAD8FileImport(&new_stream, map, view));
+	for (const char* name : { "clipRect", "clipProjectedRect", "clipAreas" })
+		delegate->setOption(QString::fromLatin1(name), option(QString::fromLatin1(name)));
 	
 	delegate->import(load_symbols_only);
 	
@@ -471,41 +536,107 @@ void OcdFileImport::importSymbols(const OcdFile< F >& file)
 template< >
 void OcdFileImport::importObjects< struct Ocd::FormatV8 >(const OcdFile< Ocd::FormatV8 >& file)
 {
-	MapPart* part = map->getCurrentPart();
-	Q_ASSERT(part);
-	
+	const QRectF clip_rect = clipRegion().boundingRect();
+	std::vector< const Ocd::FormatV8::Object* > ocd_objects;
 	for (auto&& object_entry : file.objects())
 	{
-		if (object_entry.symbol)
-		{
-			auto object = importObject(file[object_entry], part);
-			if (object)
-			{
-				part->addObject(object, part->getNumObjects());
-			}
-		}
+		if (object_entry.symbol
+		    && (clip_rect.isNull() || !isEntryOutside(object_entry, clip_rect)))
+			ocd_objects.push_back(&file[object_entry]);
 	}
+	importObjectList(ocd_objects);
 }
 
 template< class F >
 void OcdFileImport::importObjects(const OcdFile< F >& file)
 {
-	MapPart* part = map->getCurrentPart();
-	Q_ASSERT(part);
-	
+	const QRectF clip_rect = clipRegion().boundingRect();
+	std::vector< const typename F::Object* > ocd_objects;
 	for (auto&& object_entry : file.objects())
 	{
 		if ( object_entry.symbol
 		     && object_entry.status != OcdFile< F >::ObjectIndex::EntryType::StatusDeleted
-		     && object_entry.status != OcdFile< F >::ObjectIndex::EntryType::StatusDeletedForUndo )
+		     && object_entry.status != OcdFile< F >::ObjectIndex::EntryType::StatusDeletedForUndo
+		     && (clip_rect.isNull() || !isEntryOutside(object_entry, clip_rect)) )
 		{
-			auto object = importObject(file[object_entry], part);
-			if (object)
-			{
-				part->addObject(object, part->getNumObjects());
-			}
+			ocd_objects.push_back(&file[object_entry]);
 		}
 	}
+	importObjectList(ocd_objects);
+}
+
+template< class E >
+bool OcdFileImport::isEntryOutside(const E& object_entry, const QRectF& clip_rect) const
+{
+	// The bounds include the extent of the symbol.
+	const QPointF bottom_left(convertOcdPoint(object_entry.bottom_left_bound));
+	const QPointF top_right(convertOcdPoint(object_entry.top_right_bound));
+	return isOutsideClipRect(QRectF(bottom_left, top_right).normalized(), clip_rect);
+}
+
+template< class O >
+void OcdFileImport::importObjectList(const std::vector< const O* >& ocd_objects)
+{
+	MapPart* part = map->getCurrentPart();
+	Q_ASSERT(part);
+	
+	// Prepare the symbols, and select the objects which can be decoded
+	// concurrently. Text objects use fonts, and rectangle objects create
+	// additional objects, so these are imported in this thread later.
+	const int num_objects = int(ocd_objects.size());
+	std::vector< Symbol* > concurrent_symbols(ocd_objects.size(), nullptr);
+	for (int i = 0; i < num_objects; ++i)
+	{
+		const O& ocd_object = *ocd_objects[i];
+		Symbol* symbol = importObjectSymbol(ocd_object);
+		if (!symbol)
+			continue;
+		
+		switch (symbol->getType())
+		{
+		case Symbol::Line:
+			if (rectangle_info.contains(ocd_object.symbol))
+				break;
+			// fall through
+		case Symbol::Point:
+		case Symbol::Area:
+		case Symbol::Combined:
+			concurrent_symbols[i] = symbol;
+			break;
+		default:
+			break;
+		}
+	}
+	
+	std::vector< Object* > decoded(ocd_objects.size(), nullptr);
+	const std::function<void (int)> decode = [this, &ocd_objects, &concurrent_symbols, &decoded](int i) {
+		if (concurrent_symbols[i])
+			decoded[i] = importPointOrPathObject(*ocd_objects[i], concurrent_symbols[i]);
+	};
+	if (ocd_objects.size() >= min_concurrent_import_size)
+	{
+		TaskPool::forEach(num_objects, 64, decode);
+	}
+	else
+	{
+		for (int i = 0; i < num_objects; ++i)
+			decode(i);
+	}
+	
+	// Keep the order of the file.
+	std::vector< Object* > objects;
+	objects.reserve(ocd_objects.size());
+	for (int i = 0; i < num_objects; ++i)
+	{
+		Object* object = decoded[i];
+		if (!object && !concurrent_symbols[i])
+			object = importObject(*ocd_objects[i], objects);
+		if (object)
+			objects.push_back(object);
+	}
+	
+	// The renderables are generated after loading, by Map::updateObjects().
+	part->appendObjects(objects);
 }
 
 template< class F >
@@ -1515,12 +1646,12 @@ void OcdFileImport::setupPointSymbolPattern(PointSymbol* symbol, std::size_t dat
 }
 
 template< class O >
-Object* OcdFileImport::importObject(const O& ocd_object, MapPart* part)
+Symbol* OcdFileImport::importObjectSymbol(const O& ocd_object)
 {
 	Symbol* symbol = nullptr;
 	if (ocd_object.symbol >= 0)
 	{
-		symbol = symbol_index[ocd_object.symbol];
+		symbol = symbol_index.value(ocd_object.symbol);
 	}
 	
 	if (!symbol)
@@ -1539,47 +1670,41 @@ Object* OcdFileImport::importObject(const O& ocd_object, MapPart* part)
 			symbol = map->getUndefinedText();
 			break;
 		default:
-			addWarning(tr("Unable to load object"));
-			qDebug() << "Undefined object type" << ocd_object.type << " for object of symbol" << ocd_object.symbol;
 			return nullptr;
 		}
 	}
+	
+	if (symbol->getType() == Symbol::Point && ocd_object.angle != 0)
+	{
+		// extra properties: rotation
+		PointSymbol* point_symbol = reinterpret_cast<PointSymbol*>(symbol);
+		if (!point_symbol->isRotatable() && !point_symbol->isSymmetrical())
+			point_symbol->setRotatable(true);
+	}
+	
+	return symbol;
+}
+
+template< class O >
+Object* OcdFileImport::importObject(const O& ocd_object, std::vector< Object* >& extra_objects)
+{
+	Symbol* symbol = importObjectSymbol(ocd_object);
+	if (!symbol)
+	{
+		addWarning(tr("Unable to load object"));
+		qDebug() << "Undefined object type" << ocd_object.type << " for object of symbol" << ocd_object.symbol;
+		return nullptr;
+	}
 		
 	if (symbol->getType() == Symbol::Line && rectangle_info.contains(ocd_object.symbol))
 	{
-		Object* object = importRectangleObject(ocd_object, part, rectangle_info[ocd_object.symbol]);
+		Object* object = importRectangleObject(ocd_object, extra_objects, rectangle_info[ocd_object.symbol]);
 		if (!object)
 			addWarning(tr("Unable to import rectangle object"));
 		return object;
 	}
 	
-	if (symbol->getType() == Symbol::Point)
-	{
-		PointObject* p = new PointObject();
-		p->setSymbol(symbol, true);
-		
-		// extra properties: rotation
-		PointSymbol* point_symbol = reinterpret_cast<PointSymbol*>(symbol);
-		if (point_symbol->isRotatable())
-		{
-			p->setRotation(convertAngle(ocd_object.angle));
-		}
-		else if (ocd_object.angle != 0)
-		{
-			if (!point_symbol->isSymmetrical())
-			{
-				point_symbol->setRotatable(true);
-				p->setRotation(convertAngle(ocd_object.angle));
-			}
-		}
-		
-		const MapCoord pos = convertOcdPoint(ocd_object.coords[0]);
-		p->setPosition(pos.nativeX(), pos.nativeY());
-		
-		p->setMap(map);
-		return p;
-	}
-	else if (symbol->getType() == Symbol::Text)
+	if (symbol->getType() == Symbol::Text)
 	{
 		TextObject *t = new TextObject(symbol);
 		t->setText(getObjectText(ocd_object));
@@ -1595,9 +1720,28 @@ Object* OcdFileImport::importObject(const O& ocd_object, MapPart* part)
 			delete t;
 			return nullptr;
 		}
-		t->setMap(map);
 		return t;
 	}
+	
+	return importPointOrPathObject(ocd_object, symbol);
+}
+
+template< class O >
+Object* OcdFileImport::importPointOrPathObject(const O& ocd_object, Symbol* symbol) const
+{
+	if (symbol->getType() == Symbol::Point)
+	{
+		PointObject* p = new PointObject();
+		p->setSymbol(symbol, true);
+		
+		// The symbol is made rotatable by importObjectSymbol() when needed.
+		if (static_cast<const PointSymbol*>(symbol)->isRotatable())
+			p->setRotation(convertAngle(ocd_object.angle));
+		
+		const MapCoord pos = convertOcdPoint(ocd_object.coords[0]);
+		p->setPosition(pos.nativeX(), pos.nativeY());
+		return p;
+	}
 	else if (symbol->getType() == Symbol::Line || symbol->getType() == Symbol::Area || symbol->getType() == Symbol::Combined)
 	{
 		OcdImportedPathObject *p = new OcdImportedPathObject(symbol);
@@ -1606,7 +1750,6 @@ Object* OcdFileImport::importObject(const O& ocd_object, MapPart* part)
 		// Normal path
 		fillPathCoords(p, symbol->getType() == Symbol::Area, ocd_object.num_items, (Ocd::OcdPoint32*)ocd_object.coords);
 		p->recalculateParts();
-		p->setMap(map);
 		return p;
 	}
 	
@@ -1645,7 +1788,7 @@ QString OcdFileImport::getObjectText(const O& ocd_object) const
 }
 
 template< class O >
-Object* OcdFileImport::importRectangleObject(const O& ocd_object, MapPart* part, const OcdFileImport::RectangleInfo& rect)
+Object* OcdFileImport::importRectangleObject(const O& ocd_object, std::vector< Object* >& grid_objects, const OcdFileImport::RectangleInfo& rect)
 {
 	if (ocd_object.num_items != 4)
 	{
@@ -1699,7 +1842,7 @@ Object* OcdFileImport::importRectangleObject(const O& ocd_object, MapPart* part,
 		coords.emplace_back(top_left_f + right * handle_radius);
 		coords.emplace_back(top_left_f + right * rect.corner_radius);
 	}
-	PathObject *border_path = new PathObject(rect.border_line, coords, map);
+	PathObject *border_path = new PathObject(rect.border_line, std::move(coords), map);
 	border_path->parts().front().setClosed(true, false);
 	
 	if (rect.has_grid && rect.cell_width > 0 && rect.cell_height > 0)
@@ -1721,7 +1864,7 @@ Object* OcdFileImport::importRectangleObject(const O& ocd_object, MapPart* part,
 			coords[1] = MapCoord(bottom_left_f + x * cell_width * right);
 			
 			PathObject *path = new PathObject(rect.inner_line, coords, map);
-			part->addObject(path, part->getNumObjects());
+			grid_objects.push_back(path);
 		}
 		for (int y = 1; y < num_cells_y; ++y)
 		{
@@ -1729,7 +1872,7 @@ Object* OcdFileImport::importRectangleObject(const O& ocd_object, MapPart* part,
 			coords[1] = MapCoord(top_right_f + y * cell_height * down);
 			
 			PathObject *path = new PathObject(rect.inner_line, coords, map);
-			part->addObject(path, part->getNumObjects());
+			grid_objects.push_back(path);
 		}
 		
 		// Create grid text
@@ -1761,7 +1904,7 @@ Object* OcdFileImport::importRectangleObject(const O& ocd_object, MapPart* part,
 					double position_x = (x + 0.07f) * cell_width;
 					double position_y = (y + 0.04f) * cell_height + rect.text->getFontMetrics().ascent() / rect.text->calculateInternalScaling() - rect.text->getFontSize();
 					object->setAnchorPosition(top_left_f + position_x * right + position_y * down);
-					part->addObject(object, part->getNumObjects());
+					grid_objects.push_back(object);
 					
 					//pts[0].Y -= rectinfo.gridText.FontAscent - rectinfo.gridText.FontEmHeight;
 				}
@@ -1772,7 +1915,7 @@ Object* OcdFileImport::importRectangleObject(const O& ocd_object, MapPart* part,
 	return border_path;
 }
 
-void OcdFileImport::setPathHolePoint(OcdImportedPathObject *object, int pos)
+void OcdFileImport::setPathHolePoint(OcdImportedPathObject *object, int pos) const
 {
 	// Look for curve start points before the current point and apply hole point only if no such point is there.
 	// This prevents hole points in the middle of a curve caused by incorrect map objects.
@@ -1786,7 +1929,7 @@ void OcdFileImport::setPathHolePoint(OcdImportedPathObject *object, int pos)
 		object->coords[pos].setHolePoint(true);
 }
 
-void OcdFileImport::setPointFlags(OcdImportedPathObject* object, quint16 pos, bool is_area, const Ocd::OcdPoint32& ocd_point)
+void OcdFileImport::setPointFlags(OcdImportedPathObject* object, quint16 pos, bool is_area, const Ocd::OcdPoint32& ocd_point) const
 {
 	// We can support CurveStart, HolePoint, DashPoint.
 	// CurveStart needs to be applied to the main point though, not the control point, and
@@ -1801,7 +1944,7 @@ void OcdFileImport::setPointFlags(OcdImportedPathObject* object, quint16 pos, bo
 
 /** Translates the OC*D path given in the last two arguments into an Object.
  */
-void OcdFileImport::fillPathCoords(OcdImportedPathObject *object, bool is_area, quint16 num_points, const Ocd::OcdPoint32* ocd_points)
+void OcdFileImport::fillPathCoords(OcdImportedPathObject *object, bool is_area, quint16 num_points, const Ocd::OcdPoint32* ocd_points) const
 {
 	object->coords.resize(num_points);
 	for (int i = 0; i < num_points; i++)
@@ -1881,8 +2024,11 @@ void OcdFileImport::import(bool load_symbols_only)
 {
 	Q_ASSERT(buffer.isEmpty());
 	
-	buffer.clear();
-	buffer.append(stream->readAll());
+	// Read the file from mapped memory if possible, avoiding a copy.
+	FileMapping mapping(stream, buffer);
+	buffer = mapping.byteArray();
+	if (buffer.isEmpty())
+		buffer.append(stream->readAll());
 	if (buffer.isEmpty())
 		throw FileFormatException(Importer::tr("Could not read file: %1").arg(stream->errorString()));
 	
@@ -27,6 +27,7 @@
 #include <QTextCodec>
 
 #include <cmath>
+#include <vector>
 
 #include "ocd_types.h"
 #include "../file_import_export.h"
@@ -156,6 +157,16 @@ protected:
 	template< class F >
 	void importObjects(const OcdFile< F >& file);
 	
+	/// Returns true if the bounding box of the object index entry is wholly
+	/// outside of the clip rectangle. Such objects are not decoded.
+	template< class E >
+	bool isEntryOutside(const E& object_entry, const QRectF& clip_rect) const;
+	
+	/// Imports the given objects into the current part, without updating them.
+	/// Point and path objects are decoded concurrently if there are many.
+	template< class O >
+	void importObjectList(const std::vector< const O* >& ocd_objects);
+	
 	template< class F >
 	void importTemplates(const OcdFile< F >& file);
 	
@@ -200,22 +211,35 @@ protected:
 	
 	// Object import
 	
+	/// Returns the symbol of the object, or nullptr if the object's type is undefined.
+	/// Point symbols are made rotatable when needed for the object.
+	template< class O >
+	Symbol* importObjectSymbol(const O& ocd_object);
+	
+	/// Imports a single object. Objects which are created in addition,
+	/// such as the grid of rectangles, are appended to extra_objects.
+	template< class O >
+	Object* importObject(const O& ocd_object, std::vector< Object* >& extra_objects);
+	
+	/// Creates a point or path object, with the symbol from importObjectSymbol().
+	/// This modifies neither the importer nor the symbol, so it may be called
+	/// from multiple threads at the same time.
 	template< class O >
-	Object* importObject(const O& ocd_object, MapPart* part);
+	Object* importPointOrPathObject(const O& ocd_object, Symbol* symbol) const;
 	
 	template< class O >
 	QString getObjectText(const O& ocd_object) const;
 	
 	template< class O >
-	Object* importRectangleObject(const O& ocd_object, MapPart* part, const OcdFileImport::RectangleInfo& rect);
+	Object* importRectangleObject(const O& ocd_object, std::vector< Object* >& grid_objects, const OcdFileImport::RectangleInfo& rect);
 	
 	// Some helper functions that are used in multiple places
 	
-	void setPointFlags(OcdImportedPathObject* object, quint16 pos, bool is_area, const Ocd::OcdPoint32& ocd_point);
+	void setPointFlags(OcdImportedPathObject* object, quint16 pos, bool is_area, const Ocd::OcdPoint32& ocd_point) const;
 	
-	void setPathHolePoint(OcdFileImport::OcdImportedPathObject* object, int i);
+	void setPathHolePoint(OcdFileImport::OcdImportedPathObject* object, int i) const;
 	
-	void fillPathCoords(OcdFileImport::OcdImportedPathObject* object, bool is_area, quint16 num_points, const Ocd::OcdPoint32* ocd_points);
+	void fillPathCoords(OcdFileImport::OcdImportedPathObject* object, bool is_area, quint16 num_points, const Ocd::OcdPoint32* ocd_points) const;
 	
 	bool fillTextPathCoords(TextObject* object, TextSymbol* symbol, quint16 npts, const Ocd::OcdPoint32* ocd_points);
 	
@@ -223,6 +247,7 @@ protected:
 	/// The locale is used for number formatting.
 	QLocale locale;
 	
+	/// The file data. During import(), it may refer to the memory-mapped file.
 	QByteArray buffer;
 	
 	QScopedPointer< OCAD8FileImport > delegate;
@@ -32,6 +32,8 @@ void doStaticInitializations()
 {
 	// Register the supported file formats
 	FileFormats.registerFormat(new XMLFileFormat());
+	FileFormats.registerFormat(new CompactXMLFileFormat());
+	FileFormats.registerFormat(new CompressedXMLFileFormat());
 	FileFormats.registerFormat(new OcdFileFormat());
 #ifndef NO_NATIVE_FILE_FORMAT
 	FileFormats.registerFormat(new NativeFileFormat()); // TODO: Remove before release 1.0
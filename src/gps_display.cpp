@@ -27,9 +27,12 @@
 #  include <jni.h>
 #  include <QtAndroidExtras/QAndroidJniObject>
 #endif
+#include <QDateTime>
+#include <QGuiApplication>
 #include <QPainter>
 #include <QDebug>
 #include <qmath.h>
+#include <QScreen>
 #include <QTimer>
 
 #include "core/georeferencing.h"
@@ -37,8 +40,25 @@
 #include "util.h"
 #include "compass.h"
 
+
+namespace
+{
+	/** The assumed maximum speed of the receiver, in meters per second. */
+	const double filter_max_speed = 5.0;
+	
+	/** The accuracy (in meters) which is assumed for fixes without accuracy. */
+	const double filter_default_accuracy = 10.0;
+	
+	/** After a gap of this time (in milliseconds), the filter starts again. */
+	const qint64 filter_reset_time = 10000;
+}
+
+
 GPSDisplay::GPSDisplay(MapWidget* widget, const Georeferencing& georeferencing)
  : QObject()
+ , filtered_gps_coord_variance(-1.0)
+ , filtered_gps_coord_time(0)
+ , marker_update_timer(new QTimer(this))
  , visible(false)
  , source(NULL)
  , widget(widget)
@@ -51,6 +71,12 @@ GPSDisplay::GPSDisplay(MapWidget* widget, const Georeferencing& georeferencing)
 	distance_rings_enabled = false;
 	heading_indicator_enabled = false;
 	
+	// Coalesce the fixes which arrive within one display frame.
+	const qreal refresh_rate = QGuiApplication::primaryScreen() ? QGuiApplication::primaryScreen()->refreshRate() : 60.0;
+	marker_update_timer->setSingleShot(true);
+	marker_update_timer->setInterval(qMax(1, qRound(1000 / qMax(qreal(1), refresh_rate))));
+	connect(marker_update_timer, &QTimer::timeout, this, &GPSDisplay::updateMapWidget);
+	
 #if defined(QT_POSITIONING_LIB)
 	source = QGeoPositionInfoSource::createDefaultSource(this);
 	if (!source)
@@ -113,6 +139,7 @@ void GPSDisplay::startUpdates()
 	if (source)
 	{
 		checkGPSEnabled();
+		filtered_gps_coord_variance = -1.0;
 		source->startUpdates();
 	}
 #endif
@@ -158,14 +185,18 @@ void GPSDisplay::enableHeadingIndicator(bool enable)
 void GPSDisplay::paint(QPainter* painter)
 {
 	if (!visible || !has_valid_position)
+	{
+		marker_rect = QRect();
 		return;
+	}
 	
 	// Get GPS position on map widget
 	bool ok = true;
-	MapCoordF gps_coord = calcLatestGPSCoord(ok);
-	if (!ok)
+	calcLatestGPSCoord(ok);
+	if (!ok || filtered_gps_coord_variance < 0)
 		return;
-	QPointF gps_pos = widget->mapToViewport(gps_coord);
+	QPointF gps_pos = widget->mapToViewport(filtered_gps_coord);
+	marker_rect = markerRect(gps_pos);
 	
 	// Draw center dot or arrow
 	painter->setPen(Qt::NoPen);
@@ -246,6 +277,7 @@ void GPSDisplay::positionUpdated(const QGeoPositionInfo& info)
 	calcLatestGPSCoord(ok);
 	if (ok)
 	{
+		filterLatestGPSCoord(info.timestamp().isValid() ? info.timestamp().toMSecsSinceEpoch() : QDateTime::currentMSecsSinceEpoch());
 		emit mapPositionUpdated(latest_gps_coord, latest_gps_coord_accuracy);
 		emit latLonUpdated(
 			info.coordinate().latitude(),
@@ -255,7 +287,7 @@ void GPSDisplay::positionUpdated(const QGeoPositionInfo& info)
 		);
 	}
 	
-	updateMapWidget();
+	scheduleMarkerUpdate();
 }
 
 void GPSDisplay::error(QGeoPositionInfoSource::Error positioningError)
@@ -312,7 +344,8 @@ void GPSDisplay::debugPositionUpdate()
 	has_valid_position = true;
 	latest_gps_coord = coord;
 	latest_gps_coord_accuracy = accuracy;
-	updateMapWidget();
+	filterLatestGPSCoord(QDateTime::currentMSecsSinceEpoch());
+	scheduleMarkerUpdate();
 #endif
 }
 
@@ -357,8 +390,68 @@ MapCoordF GPSDisplay::calcLatestGPSCoord(bool& ok)
 #endif
 }
 
+void GPSDisplay::filterLatestGPSCoord(qint64 timestamp)
+{
+	// A Kalman filter for a position which moves at unknown speed, with
+	// the same variance in both dimensions.
+	const double meters_to_map = 1000.0 / georeferencing.getScaleDenominator();
+	const double accuracy = (latest_gps_coord_accuracy >= 0) ? latest_gps_coord_accuracy : filter_default_accuracy;
+	const double measurement_variance = qMax(1e-6, accuracy * accuracy * meters_to_map * meters_to_map);
+	const qint64 elapsed = timestamp - filtered_gps_coord_time;
+	if (filtered_gps_coord_variance < 0 || elapsed < 0 || elapsed > filter_reset_time)
+	{
+		filtered_gps_coord = latest_gps_coord;
+		filtered_gps_coord_variance = measurement_variance;
+	}
+	else
+	{
+		const double max_distance = filter_max_speed * (elapsed / 1000.0) * meters_to_map;
+		const double predicted_variance = filtered_gps_coord_variance + max_distance * max_distance;
+		const double gain = predicted_variance / (predicted_variance + measurement_variance);
+		filtered_gps_coord += (latest_gps_coord - filtered_gps_coord) * gain;
+		filtered_gps_coord_variance = (1.0 - gain) * predicted_variance;
+	}
+	filtered_gps_coord_time = timestamp;
+}
+
+void GPSDisplay::scheduleMarkerUpdate()
+{
+	if (!marker_update_timer->isActive())
+		marker_update_timer->start();
+}
+
+QRect GPSDisplay::markerRect(const QPointF& gps_pos) const
+{
+	// The heading line is very long.
+	if (heading_indicator_enabled)
+		return widget->rect();
+	
+	qreal radius = Util::mmToPixelLogical(0.5f);
+	if (distance_rings_enabled)
+	{
+		const int num_distance_rings = 2;
+		const float distance_ring_radius_meters = 10;
+		radius = qMax(radius, num_distance_rings * widget->getMapView()->lengthToPixel(100000.0 * distance_ring_radius_meters / georeferencing.getScaleDenominator()));
+	}
+	if (latest_gps_coord_accuracy >= 0)
+		radius = qMax(radius, widget->getMapView()->lengthToPixel(1000000.0 * latest_gps_coord_accuracy / georeferencing.getScaleDenominator()));
+	
+	// Pen width and antialiasing
+	radius += Util::mmToPixelLogical(0.2f) + 2;
+	return QRectF(gps_pos.x() - radius, gps_pos.y() - radius, 2 * radius, 2 * radius).toAlignedRect();
+}
+
 void GPSDisplay::updateMapWidget()
 {
-	// TODO: Limit update region to union of old and new bounding rect
-	widget->update();
+	// Repaint the union of the old and the new marker area.
+	QRect dirty_rect = marker_rect;
+	if (visible && has_valid_position)
+	{
+		bool ok = true;
+		calcLatestGPSCoord(ok);
+		if (ok && filtered_gps_coord_variance >= 0)
+			rectIncludeSafe(dirty_rect, markerRect(widget->mapToViewport(filtered_gps_coord)));
+	}
+	if (dirty_rect.isValid())
+		widget->update(dirty_rect);
 }
@@ -22,6 +22,7 @@
 #define _OPENORIENTEERING_GPS_DISPLAY_H_
 
 #include <QObject>
+#include <QRect>
 #if defined(QT_POSITIONING_LIB)
 	#include <QtPositioning/QGeoPositionInfo>
 	#include <QtPositioning/QGeoPositionInfoSource>
@@ -31,6 +32,7 @@
 
 QT_BEGIN_NAMESPACE
 class QPainter;
+class QTimer;
 QT_END_NAMESPACE
 class MapWidget;
 class Georeferencing;
@@ -40,6 +42,12 @@ class QGeoPositionInfoSource;
 
 /**
  * Retrieves the GPS position and displays a marker at this position on a MapWidget.
+ * 
+ * The signals are emitted for every position fix, with the unfiltered values.
+ * The marker shows the position after smoothing by a simple Kalman filter.
+ * Fixes which arrive faster than the display refresh rate are coalesced into
+ * a single update of the marker, and only the marker's old and new areas of
+ * the map widget are repainted.
  */
 class GPSDisplay : public QObject
 {
@@ -87,6 +95,8 @@ public:
 	const MapCoordF& getLatestGPSCoord() const {return latest_gps_coord;}
 	/// Returns the accuracy of the latest received GPS coord, or -1 if unknown. Check hasValidPosition() beforehand!
 	float getLatestGPSCoordAccuracy() const {return latest_gps_coord_accuracy;}
+	/// Returns the smoothed GPS coord which is displayed. Check hasValidPosition() beforehand!
+	const MapCoordF& getFilteredGPSCoord() const {return filtered_gps_coord;}
 	
 signals:
 	/// Is emitted whenever a new position update happens.
@@ -113,6 +123,13 @@ private slots:
 	
 private:
 	MapCoordF calcLatestGPSCoord(bool& ok);
+	/// Feeds the latest GPS coord into the filter for the displayed position.
+	void filterLatestGPSCoord(qint64 timestamp);
+	/// Schedules updateMapWidget() for the end of the current display frame.
+	void scheduleMarkerUpdate();
+	/// Returns the area covered by the marker at the given position, in viewport coordinates.
+	QRect markerRect(const QPointF& gps_pos) const;
+	/// Repaints the old and the new area of the marker.
 	void updateMapWidget();
 	
 	bool gps_updated;
@@ -121,6 +138,17 @@ private:
 #endif
 	MapCoordF latest_gps_coord;
 	float latest_gps_coord_accuracy;
+	
+	MapCoordF filtered_gps_coord;
+	/// The variance of the filtered position, in square map units (mm²). Negative when not initialized.
+	double filtered_gps_coord_variance;
+	/// The time of the last filtered fix, in milliseconds since the epoch.
+	qint64 filtered_gps_coord_time;
+	
+	/// The area of the last painted marker, in viewport coordinates.
+	QRect marker_rect;
+	QTimer* marker_update_timer;
+	
 	bool tracking_lost;
 	bool has_valid_position;
 	
@@ -21,11 +21,18 @@
 
 #include "gps_track.h"
 
+#include <cmath>
+#include <initializer_list>
+
+#include <qmath.h>
 #include <QApplication>
 #include <QFile>
+#include <QFileInfo>
 #include <QHash>
 #include <QInputDialog> // TODO: get rid of this
 #include <QMessageBox>
+#include <QProgressDialog>
+#include <QScopedPointer>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
@@ -40,6 +47,100 @@ namespace
 	// Shared definition of standard geographic CRS.
 	// TODO: Merge with Georeferencing.
 	static const QString geographic_crs_spec = "+proj=latlong +datum=WGS84";
+	
+	/** The size of GPX files for which the loading progress is shown, in bytes. */
+	const qint64 progress_file_size = 10000000;
+	
+	/** Returns the number of days from 1970-01-01 to the given date. */
+	qint64 daysFromCivil(int year, int month, int day)
+	{
+		year -= (month <= 2) ? 1 : 0;
+		const int era = (year >= 0 ? year : year - 399) / 400;
+		const int year_of_era = year - era * 400;
+		const int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+		const int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+		return qint64(era) * 146097 + day_of_era - 719468;
+	}
+	
+	/** Parses the number of the given digits at position, advancing position. */
+	bool parseDigits(const QString& text, int& position, int digits, int& value)
+	{
+		if (position + digits > text.length())
+			return false;
+		
+		value = 0;
+		for (int end = position + digits; position < end; ++position)
+		{
+			const int digit = text.at(position).unicode() - '0';
+			if (digit < 0 || digit > 9)
+				return false;
+			value = 10 * value + digit;
+		}
+		return true;
+	}
+	
+	/**
+	 * Parses a GPX time (ISO 8601, e.g. 2015-06-30T12:34:56.789Z) to
+	 * UTC milliseconds since the epoch.
+	 * 
+	 * Times without a zone designator are taken as UTC, as GPX requires.
+	 * Returns TrackPoint::no_timestamp if the text cannot be parsed.
+	 */
+	qint64 parseTimestamp(const QString& text)
+	{
+		int year, month, day, hour, minute, second;
+		int position = 0;
+		const bool ok = parseDigits(text, position, 4, year)
+		                && text.midRef(position, 1) == QLatin1String("-") && parseDigits(text, ++position, 2, month)
+		                && text.midRef(position, 1) == QLatin1String("-") && parseDigits(text, ++position, 2, day)
+		                && text.midRef(position, 1).compare(QLatin1String("T"), Qt::CaseInsensitive) == 0
+		                && parseDigits(text, ++position, 2, hour)
+		                && text.midRef(position, 1) == QLatin1String(":") && parseDigits(text, ++position, 2, minute)
+		                && text.midRef(position, 1) == QLatin1String(":") && parseDigits(text, ++position, 2, second);
+		if (!ok || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+		{
+			// Unusual but valid representations
+			const QDateTime datetime = QDateTime::fromString(text, Qt::ISODate);
+			return datetime.isValid() ? datetime.toMSecsSinceEpoch() : TrackPoint::no_timestamp;
+		}
+		
+		qint64 msecs = 0;
+		if (position < text.length() && text.at(position) == QLatin1Char('.'))
+		{
+			int scale = 100;
+			for (++position; position < text.length() && text.at(position).isDigit(); ++position)
+			{
+				msecs += scale * (text.at(position).unicode() - '0');
+				scale /= 10;
+			}
+		}
+		
+		qint64 offset = 0;
+		if (position < text.length() && (text.at(position) == QLatin1Char('+') || text.at(position) == QLatin1Char('-')))
+		{
+			const int sign = (text.at(position) == QLatin1Char('-')) ? -1 : 1;
+			int offset_hours = 0, offset_minutes = 0;
+			if (!parseDigits(text, ++position, 2, offset_hours))
+				return TrackPoint::no_timestamp;
+			if (position < text.length() && text.at(position) == QLatin1Char(':'))
+				++position;
+			if (position < text.length() && !parseDigits(text, position, 2, offset_minutes))
+				return TrackPoint::no_timestamp;
+			offset = sign * (offset_hours * 60 + offset_minutes) * 60;
+		}
+		
+		const qint64 seconds = ((daysFromCivil(year, month, day) * 24 + hour) * 60 + minute) * 60 + second - offset;
+		return seconds * 1000 + msecs;
+	}
+	
+	/** Returns the approximate squared distance of the positions, in square meters. */
+	double distanceSquared(const LatLon& a, const LatLon& b)
+	{
+		const double meters_per_degree = 6371000.0 * M_PI / 180.0;
+		const double dy = (b.latitude() - a.latitude()) * meters_per_degree;
+		const double dx = (b.longitude() - a.longitude()) * meters_per_degree * std::cos(a.latitude() * M_PI / 180.0);
+		return dx * dx + dy * dy;
+	}
 }
 
 
@@ -55,7 +156,7 @@ TrackPoint::TrackPoint(LatLon coord, QDateTime datetime, float elevation, int nu
 {
 	gps_coord = coord;
 	is_curve_start = false;
-	this->datetime = datetime;
+	timestamp = datetime.isValid() ? datetime.toMSecsSinceEpoch() : no_timestamp;
 	this->elevation = elevation;
 	this->num_satellites = num_satellites;
 	this->hDOP = hDOP;
@@ -65,8 +166,8 @@ void TrackPoint::save(QXmlStreamWriter* stream) const
 	stream->writeAttribute("lat", QString::number(gps_coord.latitude(), 'f', 12));
 	stream->writeAttribute("lon", QString::number(gps_coord.longitude(), 'f', 12));
 	
-	if (datetime.isValid())
-		stream->writeTextElement("time", datetime.toString(Qt::ISODate) + 'Z');
+	if (timestamp != no_timestamp)
+		stream->writeTextElement("time", dateTime().toString(Qt::ISODate));
 	if (elevation > -9999)
 		stream->writeTextElement("ele", QString::number(elevation, 'f', 3));
 	if (num_satellites >= 0)
@@ -75,21 +176,28 @@ void TrackPoint::save(QXmlStreamWriter* stream) const
 		stream->writeTextElement("hdop", QString::number(hDOP, 'f', 3));
 }
 
+QDateTime TrackPoint::dateTime() const
+{
+	if (timestamp == no_timestamp)
+		return QDateTime();
+	return QDateTime::fromMSecsSinceEpoch(timestamp, Qt::UTC);
+}
+
 
 
 // ### Track ###
 
-Track::Track() : track_crs(NULL)
+Track::Track() : min_point_distance(0.0), track_crs(NULL)
 {
 	current_segment_finished = true;
 }
 
-Track::Track(const Georeferencing& map_georef) : track_crs(NULL), map_georef(map_georef)
+Track::Track(const Georeferencing& map_georef) : min_point_distance(0.0), track_crs(NULL), map_georef(map_georef)
 {
 	current_segment_finished = true;
 }
 
-Track::Track(const Track& other)
+Track::Track(const Track& other) : track_crs(NULL)
 {
 	waypoints = other.waypoints;
 	waypoint_names = other.waypoint_names;
@@ -99,6 +207,8 @@ Track::Track(const Track& other)
 	segment_names  = other.segment_names;
 	
 	current_segment_finished = other.current_segment_finished;
+	min_point_distance = other.min_point_distance;
+	spatial_filter = other.spatial_filter;
 	
 	element_tags   = other.element_tags;
 	
@@ -127,6 +237,8 @@ Track& Track::operator=(const Track& rhs)
 	segment_names  = rhs.segment_names;
 	
 	current_segment_finished = rhs.current_segment_finished;
+	min_point_distance = rhs.min_point_distance;
+	spatial_filter = rhs.spatial_filter;
 	
 	element_tags   = rhs.element_tags;
 	
@@ -149,6 +261,7 @@ void Track::clear()
 	segment_names.clear();
 	current_segment_finished = true;
 	element_tags.clear();
+	error_string.clear();
 	delete track_crs;
 	track_crs = NULL;
 }
@@ -157,7 +270,10 @@ bool Track::loadFrom(const QString& path, bool project_points, QWidget* dialog_p
 {
 	QFile file(path);
 	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		error_string = file.errorString();
 		return false;
+	}
 	
 	clear();
 
@@ -250,19 +366,17 @@ void Track::appendWaypoint(TrackPoint& point, const QString& name)
 	waypoint_names.push_back(name);
 }
 
-void Track::changeMapGeoreferencing(const Georeferencing& new_map_georef)
+bool Track::changeMapGeoreferencing(const Georeferencing& new_map_georef)
 {
 	map_georef = new_map_georef;
 	
-	projectPoints();
+	return projectPoints();
 }
 
 void Track::setTrackCRS(Georeferencing* track_crs)
 {
 	delete this->track_crs;
 	this->track_crs = track_crs;
-	
-	projectPoints();
 }
 
 int Track::getNumSegments() const
@@ -344,65 +458,154 @@ LatLon Track::calcAveragePosition() const
 
 bool Track::loadFromGPX(QFile* file, bool project_points, QWidget* dialog_parent)
 {
-	Q_UNUSED(dialog_parent);
-	
 	track_crs = new Georeferencing();
 	track_crs->setProjectedCRS("", geographic_crs_spec);
 	track_crs->setTransformationDirectly(QTransform());
 	
+	// Progress is shown for large files only.
+	QScopedPointer<QProgressDialog> progress;
+	const qint64 file_size = file->size();
+	if (dialog_parent && file_size > progress_file_size)
+	{
+		progress.reset(new QProgressDialog(dialog_parent));
+		progress->setLabelText(TemplateTrack::tr("Loading %1...").arg(QFileInfo(file->fileName()).fileName()));
+		progress->setRange(0, 1000);
+		progress->setWindowModality(Qt::WindowModal);
+	}
+	int num_points = 0;
+	
 	TrackPoint point;
 	QString point_name;
-
+	
+	// Decimation while loading
+	const double min_distance_squared = min_point_distance * min_point_distance;
+	TrackPoint skipped_point;
+	bool has_skipped_point = false;
+	
+	// Spatial filtering while loading. The points next to the extent
+	// are kept so that segments crossing its border are not cut short.
+	const bool filtering = spatial_filter.isValid();
+	TrackPoint outside_point;
+	bool has_outside_point = false;
+	bool previous_inside = true;
+	
 	QXmlStreamReader stream(file);
 	while (!stream.atEnd())
 	{
 		stream.readNext();
 		if (stream.tokenType() == QXmlStreamReader::StartElement)
 		{
-			if (stream.name().compare("wpt", Qt::CaseInsensitive) == 0 ||
-				stream.name().compare("trkpt", Qt::CaseInsensitive) == 0 ||
-				stream.name().compare("rtept", Qt::CaseInsensitive) == 0)
+			const QStringRef name = stream.name();
+			if (name.compare(QLatin1String("trkpt"), Qt::CaseInsensitive) == 0 ||
+				name.compare(QLatin1String("wpt"), Qt::CaseInsensitive) == 0 ||
+				name.compare(QLatin1String("rtept"), Qt::CaseInsensitive) == 0)
 			{
-				point = TrackPoint(LatLon(stream.attributes().value("lat").toString().toDouble(),
-				                          stream.attributes().value("lon").toString().toDouble()));
-				if (project_points)
-					point.map_coord = map_georef.toMapCoordF(point.gps_coord); // TODO: check for errors
-				point_name = "";
+				const QXmlStreamAttributes attributes = stream.attributes();
+				point = TrackPoint(LatLon(attributes.value(QLatin1String("lat")).toDouble(),
+				                          attributes.value(QLatin1String("lon")).toDouble()));
+				point_name.clear();
+				
+				if (progress && (++num_points & 0xfff) == 0)
+				{
+					progress->setValue(int(1000 * file->pos() / file_size));
+					if (progress->wasCanceled())
+					{
+						error_string = TemplateTrack::tr("Loading was cancelled.");
+						return false;
+					}
+				}
 			}
-			else if (stream.name().compare("trkseg", Qt::CaseInsensitive) == 0 ||
-				stream.name().compare("rte", Qt::CaseInsensitive) == 0)
+			else if (name.compare(QLatin1String("trkseg"), Qt::CaseInsensitive) == 0 ||
+				name.compare(QLatin1String("rte"), Qt::CaseInsensitive) == 0)
 			{
 				if (segment_starts.size() == 0 ||
 					segment_starts.back() < (int)segment_points.size())
 				{
 					segment_starts.push_back(segment_points.size());
 				}
+				previous_inside = !filtering;
+				has_outside_point = false;
 			}
-			else if (stream.name().compare("ele", Qt::CaseInsensitive) == 0)
+			else if (name.compare(QLatin1String("ele"), Qt::CaseInsensitive) == 0)
 				point.elevation = stream.readElementText().toFloat();
-			else if (stream.name().compare("time", Qt::CaseInsensitive) == 0)
-				point.datetime = QDateTime::fromString(stream.readElementText(), Qt::ISODate);
-			else if (stream.name().compare("sat", Qt::CaseInsensitive) == 0)
+			else if (name.compare(QLatin1String("time"), Qt::CaseInsensitive) == 0)
+				point.timestamp = parseTimestamp(stream.readElementText());
+			else if (name.compare(QLatin1String("sat"), Qt::CaseInsensitive) == 0)
 				point.num_satellites = stream.readElementText().toInt();
-			else if (stream.name().compare("hdop", Qt::CaseInsensitive) == 0)
+			else if (name.compare(QLatin1String("hdop"), Qt::CaseInsensitive) == 0)
 				point.hDOP = stream.readElementText().toFloat();
-			else if (stream.name().compare("name", Qt::CaseInsensitive) == 0)
+			else if (name.compare(QLatin1String("name"), Qt::CaseInsensitive) == 0)
 				point_name = stream.readElementText();
 		}
 		else if (stream.tokenType() == QXmlStreamReader::EndElement)
 		{
-			if (stream.name().compare("wpt", Qt::CaseInsensitive) == 0)
+			const QStringRef name = stream.name();
+			if (name.compare(QLatin1String("trkpt"), Qt::CaseInsensitive) == 0 ||
+				name.compare(QLatin1String("rtept"), Qt::CaseInsensitive) == 0)
 			{
-				waypoints.push_back(point);
-				waypoint_names.push_back(point_name);
+				if (filtering && !spatial_filter.contains(fakeMapCoordF(point.gps_coord)))
+				{
+					if (previous_inside)
+					{
+						// Leaving the extent: Keep this point as end of the segment.
+						if (has_skipped_point)
+							segment_points.push_back(skipped_point);
+						has_skipped_point = false;
+						segment_points.push_back(point);
+						previous_inside = false;
+					}
+					else
+					{
+						outside_point = point;
+						has_outside_point = true;
+					}
+					continue;
+				}
+				
+				if (!previous_inside)
+				{
+					// Entering the extent: Start a new segment at the last outside point.
+					if (segment_starts.empty() || segment_starts.back() < (int)segment_points.size())
+						segment_starts.push_back(segment_points.size());
+					if (has_outside_point)
+						segment_points.push_back(outside_point);
+					has_outside_point = false;
+					previous_inside = true;
+				}
+				
+				if (min_distance_squared > 0.0 &&
+				    !segment_points.empty() &&
+				    segment_starts.back() < (int)segment_points.size() &&
+				    distanceSquared(segment_points.back().gps_coord, point.gps_coord) < min_distance_squared)
+				{
+					skipped_point = point;
+					has_skipped_point = true;
+				}
+				else
+				{
+					segment_points.push_back(point);
+					has_skipped_point = false;
+				}
 			}
-			else if (stream.name().compare("trkpt", Qt::CaseInsensitive) == 0 ||
-				stream.name().compare("rtept", Qt::CaseInsensitive) == 0)
+			else if (name.compare(QLatin1String("trkseg"), Qt::CaseInsensitive) == 0 ||
+				name.compare(QLatin1String("rte"), Qt::CaseInsensitive) == 0)
 			{
-				segment_points.push_back(point);
+				// Keep the end of the segment.
+				if (has_skipped_point)
+					segment_points.push_back(skipped_point);
+				has_skipped_point = false;
+			}
+			else if (name.compare(QLatin1String("wpt"), Qt::CaseInsensitive) == 0)
+			{
+				if (filtering && !spatial_filter.contains(fakeMapCoordF(point.gps_coord)))
+					continue;
+				waypoints.push_back(point);
+				waypoint_names.push_back(point_name);
 			}
 		}
 	}
+	if (has_skipped_point)
+		segment_points.push_back(skipped_point);
 	
 	if (segment_starts.size() > 0 &&
 		segment_starts.back() == (int)segment_points.size())
@@ -410,17 +613,43 @@ bool Track::loadFromGPX(QFile* file, bool project_points, QWidget* dialog_parent
 		segment_starts.pop_back();
 	}
 	
+	// All points are projected in a single batch.
+	if (project_points && !projectPoints())
+		return false;
+	
 	return true;
 }
 
 bool Track::loadFromDXF(QFile* file, bool project_points, QWidget* dialog_parent)
 {
+	// Progress is shown for large files only.
+	QScopedPointer<QProgressDialog> progress;
+	const qint64 file_size = file->size();
+	if (dialog_parent && file_size > progress_file_size)
+	{
+		progress.reset(new QProgressDialog(dialog_parent));
+		progress->setLabelText(TemplateTrack::tr("Loading %1...").arg(QFileInfo(file->fileName()).fileName()));
+		progress->setRange(0, 1000);
+		progress->setWindowModality(Qt::WindowModal);
+	}
+	
 	DXFParser* parser = new DXFParser();
 	parser->setData(file);
+	parser->setFilter(spatial_filter);
+	if (progress)
+	{
+		QProgressDialog* dialog = progress.data();
+		parser->setProgressHandler([dialog, file_size](qint64 pos) {
+			dialog->setValue(int(1000 * pos / file_size));
+			return !dialog->wasCanceled();
+		});
+	}
 	QString result = parser->parse();
 	if (!result.isEmpty())
 	{
-		QMessageBox::critical(dialog_parent, TemplateTrack::tr("Error reading"), TemplateTrack::tr("There was an error reading the DXF file %1:\n\n%2").arg(file->fileName(), result));
+		error_string = result;
+		if (dialog_parent)
+			QMessageBox::critical(dialog_parent, TemplateTrack::tr("Error reading"), TemplateTrack::tr("There was an error reading the DXF file %1:\n\n%2").arg(file->fileName(), result));
 		delete parser;
 		return false;
 	}
@@ -616,26 +845,36 @@ bool Track::loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent
 	return true;
 }
 
-void Track::projectPoints()
+bool Track::projectPoints()
 {
-	if (track_crs->getProjectedCRSSpec() == geographic_crs_spec)
-	{
-		int size = waypoints.size();
-		for (int i = 0; i < size; ++i)
-			waypoints[i].map_coord = map_georef.toMapCoordF(waypoints[i].gps_coord, NULL); // FIXME: check for errors
-			
-		size = segment_points.size();
-		for (int i = 0; i < size; ++i)
-			segment_points[i].map_coord = map_georef.toMapCoordF(segment_points[i].gps_coord, NULL); // FIXME: check for errors
-	}
-	else
+	// All points are transformed in a single batch.
+	const bool geographic = track_crs->getProjectedCRSSpec() == geographic_crs_spec;
+	std::vector<LatLon> lat_lon;
+	std::vector<MapCoordF> track_coords;
+	std::vector<MapCoordF> map_coords;
+	for (auto points : { &waypoints, &segment_points })
 	{
-		int size = waypoints.size();
-		for (int i = 0; i < size; ++i)
-			waypoints[i].map_coord = map_georef.toMapCoordF(track_crs, fakeMapCoordF(waypoints[i].gps_coord), NULL); // FIXME: check for errors
-			
-		size = segment_points.size();
-		for (int i = 0; i < size; ++i)
-			segment_points[i].map_coord = map_georef.toMapCoordF(track_crs, fakeMapCoordF(segment_points[i].gps_coord), NULL); // FIXME: check for errors
+		lat_lon.clear();
+		track_coords.clear();
+		for (const auto& point : *points)
+		{
+			if (geographic)
+				lat_lon.push_back(point.gps_coord);
+			else
+				track_coords.push_back(fakeMapCoordF(point.gps_coord));
+		}
+		
+		const bool ok = geographic
+		                ? map_georef.toMapCoordF(lat_lon, map_coords)
+		                : map_georef.toMapCoordF(track_crs, track_coords, map_coords);
+		if (!ok)
+		{
+			error_string = TemplateTrack::tr("Cannot project the track points to the map.");
+			return false;
+		}
+		
+		for (std::size_t i = 0; i < points->size(); ++i)
+			(*points)[i].map_coord = map_coords[i];
 	}
+	return true;
 }
@@ -25,6 +25,7 @@
 
 #include <QDate>
 #include <QHash>
+#include <QRectF>
 #include <QString>
 
 #include "core/georeferencing.h"
@@ -46,14 +47,20 @@ struct TrackPoint
 	MapCoordF map_coord;
 	bool is_curve_start;
 	
-	QDateTime datetime;		// QDateTime() if invalid
+	qint64 timestamp;		// UTC milliseconds since the epoch, no_timestamp if invalid
 	float elevation;		// -9999 if invalid
 	int num_satellites;		// -1 if invalid
 	float hDOP;				// -1 if invalid
 	
+	/** The value of timestamp for points without time. */
+	static const qint64 no_timestamp = Q_INT64_C(-0x7fffffffffffffff) - 1;
+	
 	TrackPoint(LatLon coord = LatLon(), QDateTime datetime = QDateTime(),
 			   float elevation = -9999, int num_satellites = -1, float hDOP = -1);
 	void save(QXmlStreamWriter* stream) const;
+	
+	/** Returns the time of the point, or QDateTime() if the point has no time. */
+	QDateTime dateTime() const;
 };
 
 /**
@@ -77,7 +84,20 @@ public:
 	
 	/// Attempts to load the track from the given file.
 	/// If you choose not to project_point, you have to call changeProjectionParams() afterwards.
+	/// For large files, the progress is shown if a dialog_parent is given.
 	bool loadFrom(const QString& path, bool project_points, QWidget* dialog_parent = NULL);
+	
+	/// Sets the minimum distance of consecutive track points, in meters.
+	/// When loading a GPX file, points closer to the previous point are skipped,
+	/// except for the last point of each segment. The default of 0 keeps all points.
+	void setMinimumPointDistance(double meters) {min_point_distance = meters;}
+	/// Sets an extent in track coordinates (x: longitude or easting, y: latitude
+	/// or northing) for loading GPX and DXF files. Only the waypoints and paths
+	/// within this extent are kept, and track segments are split where they leave
+	/// the extent. The default invalid rect keeps all data.
+	void setSpatialFilter(const QRectF& extent) {spatial_filter = extent;}
+	/// Returns the reason of the last loading failure, if known.
+	const QString& errorString() const {return error_string;}
 	/// Attempts to save the track to the given file
 	bool saveTo(const QString& path) const;
 	
@@ -105,11 +125,17 @@ public:
 	 */
 	void appendWaypoint(TrackPoint& point, const QString& name);
 	
-	/** Updates the map positions of all points based on the new georeferencing. */
-	void changeMapGeoreferencing(const Georeferencing& new_georef);
+	/**
+	 * Updates the map positions of all points based on the new georeferencing.
+	 * 
+	 * Returns false and sets the error string if the points cannot be
+	 * projected. Points which were not projected keep their old positions.
+	 */
+	bool changeMapGeoreferencing(const Georeferencing& new_georef);
 	
 	/// Sets the track coordinate reference system.
 	/// The Track object takes ownership of the Georeferencing object.
+	/// The map positions are updated by changeMapGeoreferencing().
 	void setTrackCRS(Georeferencing* track_crs);
 	
 	// Getters
@@ -145,7 +171,8 @@ private:
 	bool loadFromDXF(QFile* file, bool project_points, QWidget* dialog_parent);
 	bool loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent);
 	
-	void projectPoints();
+	/// Projects all points to the map, or returns false and sets the error string.
+	bool projectPoints();
 	
 	
 	/** A mapping of element id to tags. */
@@ -161,6 +188,10 @@ private:
 	
 	bool current_segment_finished;
 	
+	double min_point_distance;
+	QRectF spatial_filter;
+	QString error_string;
+	
 	Georeferencing* track_crs;
 	Georeferencing map_georef;
 };
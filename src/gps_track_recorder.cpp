@@ -38,6 +38,8 @@ GPSTrackRecorder::GPSTrackRecorder(GPSDisplay* gps_display, TemplateTrack* targe
 	
 	// Start with a new segment
 	target_template->getTrack().finishCurrentSegment();
+	drawn_segment = target_template->getTrack().getNumSegments();
+	drawn_point = 0;
 	
 	connect(gps_display, SIGNAL(latLonUpdated(double,double,double,float)), this, SLOT(newPosition(double,double,double,float)));
 	connect(gps_display, SIGNAL(positionUpdatesInterrupted()), this, SLOT(positionUpdatesInterrupted()));
@@ -93,9 +95,13 @@ void GPSTrackRecorder::drawUpdate()
 	
 	if (track_changed_since_last_update)
 	{
+		// Only the new part of the track needs to be redrawn.
 		if (widget->getMapView()->isTemplateVisible(target_template))
-			target_template->setTemplateAreaDirty();
+			target_template->setTrackAreaDirty(drawn_segment, drawn_point);
 		
+		const Track& track = target_template->getTrack();
+		drawn_segment = qMax(0, track.getNumSegments() - 1);
+		drawn_point = (track.getNumSegments() > 0) ? qMax(0, track.getSegmentPointCount(drawn_segment) - 1) : 0;
 		track_changed_since_last_update = false;
 	}
 }
@@ -50,6 +50,9 @@ private:
 	QTimer draw_update_timer;
 	bool track_changed_since_last_update;
 	bool is_active;
+	/** The last point which was drawn, by segment index and point index. */
+	int drawn_segment;
+	int drawn_point;
 };
 
 #endif
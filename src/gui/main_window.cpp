@@ -42,6 +42,8 @@
 
 #include "about_dialog.h"
 #include "autosave_dialog.h"
+#include "../autosave_journal.h"
+#include "../core/background_file_writer.h"
 #include "../file_format_registry.h"
 #include "../file_import_export.h"
 #include "home_screen_controller.h"
@@ -51,6 +53,7 @@
 #include "../mapper_resource.h"
 #include "../file_format.h"
 #include "../settings.h"
+#include "../startup_timer.h"
 #include "settings_dialog.h"
 #include "text_browser_dialog.h"
 #include "../util.h"
@@ -66,6 +69,8 @@ int MainWindow::num_open_files = 0;
 MainWindow::MainWindow(bool as_main_window)
 : QMainWindow()
 , has_autosave_conflict(false)
+, autosave_writer(new BackgroundFileWriter(this))
+, autosave_blocking_msecs(0)
 , homescreen_disabled(false)
 {
 #if (defined Q_OS_MAC)
@@ -120,6 +125,8 @@ MainWindow::MainWindow(bool as_main_window)
 #endif
 	
 	connect(&Settings::getInstance(), SIGNAL(settingsChanged()), this, SLOT(settingsChanged()));
+	connect(autosave_writer, SIGNAL(finished(QString,bool,QString)), this, SLOT(autosaveWritten(QString,bool,QString)));
+	connect(this, SIGNAL(autosaveFinished(bool,qint64,qint64)), this, SLOT(showAutosaveResult(bool,qint64,qint64)));
 }
 
 MainWindow::~MainWindow()
@@ -137,6 +144,27 @@ void MainWindow::settingsChanged()
 	updateRecentFileActions();
 }
 
+void MainWindow::autosaveWritten(const QString& path, bool success, const QString& error_string)
+{
+	Q_UNUSED(path);
+	Q_UNUSED(error_string);
+	if (!success)
+	{
+		// The next autosave must be a full one.
+		controller->setAutosaveJournalBase(false);
+	}
+	emit autosaveFinished(success, autosave_blocking_msecs, autosave_timer.elapsed());
+}
+
+void MainWindow::showAutosaveResult(bool success, qint64 blocking_msecs, qint64 total_msecs)
+{
+	Q_UNUSED(blocking_msecs);
+	if (success)
+		showStatusBarMessage(tr("Autosaved in %1 s.").arg(locale().toString(total_msecs / 1000.0, 'f', 1)), 3000);
+	else
+		showStatusBarMessage(tr("Autosaving failed!"), 6000);
+}
+
 const QString& MainWindow::appName() const
 {
 	static QString app_name(APP_NAME);
@@ -748,6 +776,7 @@ bool MainWindow::openPath(const QString &path)
 		settings.remove(reopen_blocker);
 		return false;
 	}
+	StartupTimer::mark("File loaded");
 	
 	MainWindow* open_window = this;
 #if !defined(Q_OS_ANDROID)
@@ -756,6 +785,7 @@ bool MainWindow::openPath(const QString &path)
 #endif
 	
 	open_window->setController(new_controller, path);
+	StartupTimer::mark("Controller attached");
 	open_window->actual_path = new_actual_path;
 	open_window->setHasAutosaveConflict(new_autosave_conflict);
 	open_window->setHasUnsavedChanges(false);
@@ -829,6 +859,13 @@ void MainWindow::openPathBacklog()
 	for (auto&& path : path_backlog)
 		openPath(path);
 	path_backlog.clear();
+	
+	// Startup may have skipped the home screen.
+	if (!controller)
+		setController(new HomeScreenController());
+	
+	// The files given on the command line are opened, so startup is complete.
+	StartupTimer::finish();
 }
 
 void MainWindow::openRecentFile()
@@ -875,9 +912,20 @@ void MainWindow::setHasAutosaveConflict(bool value)
 
 bool MainWindow::removeAutosaveFile() const
 {
+	// Don't let a pending autosave recreate the file.
+	autosave_writer->waitForFinished();
+	
 	if (!currentPath().isEmpty() && !has_autosave_conflict)
 	{
-		QFile autosave_file(autosavePath(currentPath()));
+		if (controller)
+			controller->setAutosaveJournalBase(false);
+		
+		const QString autosave_path = autosavePath(currentPath());
+		QFile journal_file(AutosaveJournal::journalPath(autosave_path));
+		if (journal_file.exists())
+			journal_file.remove();
+		
+		QFile autosave_file(autosave_path);
 		return !autosave_file.exists() || autosave_file.remove();
 	}
 	return false;
@@ -890,25 +938,48 @@ Autosave::AutosaveResult MainWindow::autosave()
 	{
 		return Autosave::PermanentFailure;
 	}
-	else if (controller->isEditingInProgress())
+	else if (controller->isEditingInProgress() || autosave_writer->isRunning())
 	{
+		// Retry soon, instead of waiting for the previous autosave.
 		return Autosave::TemporaryFailure;
 	}
 	else
 	{
 		showStatusBarMessage(tr("Autosaving..."), 0);
-		if (controller->exportTo(autosavePath(currentPath())))
+		autosave_timer.start();
+		const QString autosave_path = autosavePath(path);
+		QByteArray data;
+		bool append = false;
+		if (controller->exportAutosaveJournal(autosave_path, data, append))
 		{
-			// Success
-			clearStatusBarMessage();
+			autosave_blocking_msecs = autosave_timer.elapsed();
+			if (data.isEmpty())
+			{
+				// Nothing changed since the last autosave.
+				emit autosaveFinished(true, autosave_blocking_msecs, autosave_blocking_msecs);
+			}
+			else
+			{
+				const BackgroundFileWriter::Mode mode = append ? BackgroundFileWriter::Append : BackgroundFileWriter::Replace;
+				autosave_writer->start(AutosaveJournal::journalPath(autosave_path), data, mode);
+			}
 			return Autosave::Success;
 		}
-		else
+		
+		auto serializer = controller->prepareExportToData(autosave_path);
+		if (serializer)
 		{
-			// Failure
-			showStatusBarMessage(tr("Autosaving failed!"), 6000);
-			return Autosave::PermanentFailure;
+			// The map is serialized and written in the background, cf. autosaveWritten().
+			autosave_blocking_msecs = autosave_timer.elapsed();
+			autosave_writer->start(autosave_path, serializer);
+			controller->setAutosaveJournalBase(true);
+			return Autosave::Success;
 		}
+		
+		// Failure
+		const qint64 msecs = autosave_timer.elapsed();
+		emit autosaveFinished(false, msecs, msecs);
+		return Autosave::PermanentFailure;
 	}
 }
 
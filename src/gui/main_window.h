@@ -22,6 +22,7 @@
 #ifndef _OPENORIENTEERING_MAIN_WINDOW_H_
 #define _OPENORIENTEERING_MAIN_WINDOW_H_
 
+#include <QElapsedTimer>
 #include <QMainWindow>
 
 #include "../core/autosave.h"
@@ -33,6 +34,7 @@ class QStackedWidget;
 class QTimer;
 QT_END_NAMESPACE
 
+class BackgroundFileWriter;
 class MainWindowController;
 
 /** The MainWindow class provides the generic application window. 
@@ -282,6 +284,16 @@ signals:
 	 */
 	void autosaveConflictResolved();
 	
+	/**
+	 * This signal is emitted when an autosave attempt finished.
+	 * 
+	 * blocking_msecs is the time spent in the GUI thread, i.e. taking a
+	 * snapshot of the map, or exporting the changes for the journal.
+	 * total_msecs also includes serializing the snapshot and writing the file
+	 * in the background. The result is shown in the status bar.
+	 */
+	void autosaveFinished(bool success, qint64 blocking_msecs, qint64 total_msecs);
+	
 protected slots:
 	/**
 	 * Switches to a different controller and loads the given path.
@@ -308,6 +320,18 @@ protected slots:
 	 */
 	void settingsChanged();
 	
+	/**
+	 * Reports the result of writing an autosave file in the background.
+	 */
+	void autosaveWritten(const QString& path, bool success, const QString& error_string);
+	
+	/**
+	 * Shows the result and duration of an autosave in the status bar.
+	 * 
+	 * @see autosaveFinished()
+	 */
+	void showAutosaveResult(bool success, qint64 blocking_msecs, qint64 total_msecs);
+	
 protected:
 	/** 
 	 * @brief Sets the path of the file edited by this windows' controller.
@@ -397,6 +421,12 @@ private:
 	bool has_unsaved_changes;
 	/// Indicates the presence of an autosave conflict. @see setHasAutosaveConflict()
 	bool has_autosave_conflict;
+	/// Writes the autosave files, so that editing can continue meanwhile.
+	BackgroundFileWriter* autosave_writer;
+	/// Measures the duration of the current autosave.
+	QElapsedTimer autosave_timer;
+	/// The part of the current autosave's duration which was spent in the GUI thread.
+	qint64 autosave_blocking_msecs;
 	
 	/// Was the window maximized before going into fullscreen mode? In this case, we have to show it maximized again when leaving fullscreen mode.
 	bool maximized_before_fullscreen;
@@ -46,6 +46,26 @@ bool MainWindowController::exportTo(const QString& path, const FileFormat* forma
 	return false;
 }
 
+std::function<bool (QByteArray&, QString&)> MainWindowController::prepareExportToData(const QString& path, const FileFormat* format)
+{
+	Q_UNUSED(path);
+	Q_UNUSED(format);
+	return {};
+}
+
+bool MainWindowController::exportAutosaveJournal(const QString& base_path, QByteArray& data, bool& append)
+{
+	Q_UNUSED(base_path);
+	Q_UNUSED(data);
+	Q_UNUSED(append);
+	return false;
+}
+
+void MainWindowController::setAutosaveJournalBase(bool valid)
+{
+	Q_UNUSED(valid);
+}
+
 bool MainWindowController::load(const QString& path, QWidget* dialog_parent)
 {
 	Q_UNUSED(path);
@@ -22,6 +22,8 @@
 #ifndef _OPENORIENTEERING_MAIN_WINDOW_CONTROLLER_H_
 #define _OPENORIENTEERING_MAIN_WINDOW_CONTROLLER_H_
 
+#include <functional>
+
 #include <QWidget>
 
 class MainWindow;
@@ -52,6 +54,31 @@ public:
 	 *  @return true if saving was sucessful, false on errors
 	 */
 	virtual bool exportTo(const QString& path, const FileFormat* format = NULL);
+	
+	/** Prepare an export into memory in a worker thread, for writing the
+	 *  data to the given path later. This does not change the modified state.
+	 *  @param path the path the data is meant for
+	 *  @param format the file format (automatically determined if NULL)
+	 *  @return a function which creates the contents of the file in any
+	 *      thread, or an empty function on errors
+	 *  @see Map::prepareExportToData()
+	 */
+	virtual std::function<bool (QByteArray&, QString&)> prepareExportToData(const QString& path, const FileFormat* format = NULL);
+	
+	/** Export the changes since the last autosave as an autosave journal record.
+	 *  @param base_path the path of the (full) autosave file
+	 *  @param data receives the record, empty when there are no new changes
+	 *  @param append receives whether the data must be appended to the journal
+	 *  @return true if the changes could be journaled, false if a full autosave is needed
+	 *  @see AutosaveJournal
+	 */
+	virtual bool exportAutosaveJournal(const QString& base_path, QByteArray& data, bool& append);
+	
+	/** Set or reset the base of the autosave journal.
+	 *  @param valid true after a full autosave was exported, false when the
+	 *      autosave file was removed or could not be written
+	 */
+	virtual void setAutosaveJournalBase(bool valid);
 
 	/** Load from a file.
 	 *  @param path the path to load from
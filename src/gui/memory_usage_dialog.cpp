@@ -0,0 +1,111 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "memory_usage_dialog.h"
+
+#include <QApplication>
+#include <QClipboard>
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+#include "../memory_usage.h"
+
+
+MemoryUsageDialog::MemoryUsageDialog(QWidget* parent, const Map& map, const MapWidget* widget)
+: QDialog(parent, Qt::WindowSystemMenuHint | Qt::WindowTitleHint)
+, map(map)
+, widget(widget)
+{
+	setWindowTitle(tr("Memory usage"));
+	
+	table = new QTableWidget(MemoryUsage::NumCategories + 1, 2);
+	table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	table->setSelectionMode(QAbstractItemView::NoSelection);
+	table->setHorizontalHeaderLabels(QStringList() << tr("Subsystem") << tr("Memory"));
+	table->verticalHeader()->setVisible(false);
+	table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+	table->horizontalHeader()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+	
+	objects_label = new QLabel();
+	
+	QDialogButtonBox* button_box = new QDialogButtonBox(QDialogButtonBox::Close);
+	QPushButton* refresh_button = button_box->addButton(tr("Refresh"), QDialogButtonBox::ActionRole);
+	QPushButton* copy_button = button_box->addButton(tr("Copy"), QDialogButtonBox::ActionRole);
+	
+	QVBoxLayout* layout = new QVBoxLayout();
+	layout->addWidget(table);
+	layout->addWidget(objects_label);
+	layout->addWidget(button_box);
+	setLayout(layout);
+	
+	connect(refresh_button, SIGNAL(clicked()), this, SLOT(refresh()));
+	connect(copy_button, SIGNAL(clicked()), this, SLOT(copyToClipboard()));
+	connect(button_box, SIGNAL(rejected()), this, SLOT(reject()));
+	
+	refresh();
+	resize(400, sizeHint().height());
+}
+
+MemoryUsageDialog::~MemoryUsageDialog()
+{
+	; // nothing
+}
+
+void MemoryUsageDialog::refresh()
+{
+	const MemoryUsage usage = MemoryUsage::measure(map, widget);
+	
+	auto setRow = [this](int row, const QString& label, qint64 bytes) {
+		QTableWidgetItem* bytes_item = new QTableWidgetItem(MemoryUsage::formatBytes(bytes));
+		bytes_item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+		bytes_item->setToolTip(tr("%1 bytes").arg(QLocale().toString(bytes)));
+		table->setItem(row, 0, new QTableWidgetItem(label));
+		table->setItem(row, 1, bytes_item);
+	};
+	
+	for (int i = 0; i < MemoryUsage::NumCategories; ++i)
+	{
+		const auto category = MemoryUsage::Category(i);
+		setRow(i, MemoryUsage::label(category), usage.bytes(category));
+	}
+	
+	const int total_row = MemoryUsage::NumCategories;
+	setRow(total_row, tr("Total"), usage.total());
+	for (int column = 0; column < 2; ++column)
+	{
+		QFont font = table->item(total_row, column)->font();
+		font.setBold(true);
+		table->item(total_row, column)->setFont(font);
+	}
+	
+	objects_label->setText(tr("Objects: %1").arg(usage.numObjects()) + QLatin1Char('\n')
+	                       + tr("Released by compaction: %1").arg(MemoryUsage::formatBytes(usage.reclaimedBytes())));
+	text = usage.toText();
+}
+
+void MemoryUsageDialog::copyToClipboard()
+{
+	QApplication::clipboard()->setText(text);
+}
@@ -0,0 +1,73 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_MEMORY_USAGE_DIALOG_H_
+#define _OPENORIENTEERING_MEMORY_USAGE_DIALOG_H_
+
+#include <QDialog>
+
+class QLabel;
+class QTableWidget;
+
+class Map;
+class MapWidget;
+
+
+/**
+ * @brief A dialog which shows the memory used by the map, by subsystem.
+ * 
+ * The figures are measured with MemoryUsage when the dialog is opened,
+ * and again when the user asks for a refresh.
+ */
+class MemoryUsageDialog : public QDialog
+{
+Q_OBJECT
+public:
+	/**
+	 * Constructs the dialog for the given map and (optional) map widget.
+	 */
+	MemoryUsageDialog(QWidget* parent, const Map& map, const MapWidget* widget = nullptr);
+	
+	/**
+	 * Destructor.
+	 */
+	virtual ~MemoryUsageDialog();
+	
+public slots:
+	/**
+	 * Measures the memory usage again and updates the table.
+	 */
+	void refresh();
+	
+	/**
+	 * Copies the figures to the clipboard, as plain text.
+	 */
+	void copyToClipboard();
+	
+private:
+	const Map& map;
+	const MapWidget* widget;
+	
+	QTableWidget* table;
+	QLabel* objects_label;
+	QString text;
+};
+
+#endif
@@ -30,6 +30,7 @@
 PointHandles::PointHandles(int scale_factor)
 : scale_factor(scale_factor)
 , handle_image(loadHandleImage(scale_factor))
+, handle_pixmap(QPixmap::fromImage(handle_image))
 {
 	; // nothing
 }
@@ -54,18 +55,48 @@ void PointHandles::draw(
         MapCoordVector::size_type hover_point,
         bool draw_curve_handles,
         PointHandleState base_state ) const
+{
+	Batch batch;
+	collect(batch, painter, widget, object, hover_point, draw_curve_handles, base_state);
+	flush(painter, batch);
+}
+
+void PointHandles::draw(
+        QPainter* painter,
+        const MapWidget* widget,
+        const std::set<Object*>& objects,
+        const Object* hover_object,
+        MapCoordVector::size_type hover_point,
+        bool draw_curve_handles,
+        PointHandleState base_state ) const
+{
+	const auto no_point = std::numeric_limits<MapCoordVector::size_type>::max();
+	Batch batch;
+	for (const auto object : objects)
+		collect(batch, painter, widget, object, (object == hover_object) ? hover_point : no_point, draw_curve_handles, base_state);
+	flush(painter, batch);
+}
+
+void PointHandles::collect(
+        Batch& batch,
+        QPainter* painter,
+        const MapWidget* widget,
+        const Object* object,
+        MapCoordVector::size_type hover_point,
+        bool draw_curve_handles,
+        PointHandleState base_state ) const
 {
 	if (object->getType() == Object::Point)
 	{
 		const PointObject* point = reinterpret_cast<const PointObject*>(object);
-		draw(painter, widget->mapToViewport(point->getCoordF()), NormalHandle, (hover_point == 0) ? ActiveHandleState : base_state);
+		collect(batch, widget->mapToViewport(point->getCoordF()), NormalHandle, (hover_point == 0) ? ActiveHandleState : base_state);
 	}
 	else if (object->getType() == Object::Text)
 	{
 		const TextObject* text = reinterpret_cast<const TextObject*>(object);
 		std::vector<QPointF> text_handles(text->controlPoints());
 		for (std::size_t i = 0; i < text_handles.size(); ++i)
-			draw(painter, widget->mapToViewport(text_handles[i]), NormalHandle, (hover_point == i) ? ActiveHandleState : base_state);
+			collect(batch, widget->mapToViewport(text_handles[i]), NormalHandle, (hover_point == i) ? ActiveHandleState : base_state);
 	}
 	else if (object->getType() == Object::Path)
 	{
@@ -100,7 +131,7 @@ void PointHandles::draw(
 					auto curve_index = (i == part.first_index) ? (part.last_index - 1) : (i - 1);
 					curve_handle = widget->mapToViewport(path->getCoordinate(curve_index));
 					drawCurveHandleLine(painter, point, curve_handle, handle_type, is_active ? ActiveHandleState : base_state);
-					draw(painter, curve_handle, CurveHandle, (is_active || hover_point == curve_index) ? ActiveHandleState : base_state);
+					collect(batch, curve_handle, CurveHandle, (is_active || hover_point == curve_index) ? ActiveHandleState : base_state);
 					have_curve = false;
 				}
 				
@@ -112,14 +143,14 @@ void PointHandles::draw(
 				}
 				
 				// Draw point
-				draw(painter, point, handle_type, is_active ? ActiveHandleState : base_state);
+				collect(batch, point, handle_type, is_active ? ActiveHandleState : base_state);
 				
 				// Draw outgoing curve handle, second part
 				if (coord.isCurveStart())
 				{
 					if (draw_curve_handles)
 					{
-						draw(painter, curve_handle, CurveHandle, (is_active || hover_point == i + 1) ? ActiveHandleState : base_state);
+						collect(batch, curve_handle, CurveHandle, (is_active || hover_point == i + 1) ? ActiveHandleState : base_state);
 						have_curve = true;
 					}
 					i += 2;
@@ -138,6 +169,35 @@ void PointHandles::draw(QPainter* painter, QPointF position, PointHandleType typ
 	painter->drawImage(qRound(position.x()) - offset, qRound(position.y()) - offset, image(), (int)type * width, (int)state * width, width, width);
 }
 
+void PointHandles::collect(Batch& batch, QPointF position, PointHandleType type, PointHandleState state) const
+{
+	int width = scale_factor * 11;
+	int x = qRound(position.x());
+	int y = qRound(position.y());
+	
+	// Handles closer than half a handle would hide each other.
+	int cell_size = width / 2;
+	auto cell_x = quint32(x >= 0 ? x / cell_size : (x + 1) / cell_size - 1);
+	auto cell_y = quint32(y >= 0 ? y / cell_size : (y + 1) / cell_size - 1);
+	auto cell = (quint64(cell_x) << 32) | cell_y;
+	if (!batch.occupied.insert(cell).second && state != ActiveHandleState)
+		return;
+	
+	// Fragment positions refer to the center of the target rect.
+	auto center_offset = (width - 1) / 2 - width / 2.0;
+	batch.fragments.push_back(QPainter::PixmapFragment::create(
+	        QPointF(x - center_offset, y - center_offset),
+	        QRectF((int)type * width, (int)state * width, width, width) ));
+}
+
+void PointHandles::flush(QPainter* painter, Batch& batch) const
+{
+	if (!batch.fragments.isEmpty())
+		painter->drawPixmapFragments(batch.fragments.constData(), batch.fragments.size(), handle_pixmap);
+	batch.fragments.clear();
+	batch.occupied.clear();
+}
+
 void PointHandles::drawCurveHandleLine(QPainter* painter, QPointF anchor_point, QPointF curve_handle, PointHandleType type, PointHandleState state) const
 {
 	const float handle_radius = 3 * scale_factor;
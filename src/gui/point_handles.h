@@ -21,8 +21,14 @@
 #ifndef _OPENORIENTEERING_POINT_HANDLES_H
 #define _OPENORIENTEERING_POINT_HANDLES_H
 
+#include <set>
+#include <unordered_set>
+
 #include <QImage>
+#include <QPainter>
+#include <QPixmap>
 #include <QPointF>
+#include <QVector>
 
 #include "../core/map_coord.h"
 
@@ -112,6 +118,25 @@ public:
 	        PointHandleState base_state = NormalHandleState
 	) const;
 	
+	/**
+	 * @brief Draws all point handles for the given objects in a single batch.
+	 * 
+	 * Handles which would be drawn on top of an earlier handle at the current
+	 * zoom are skipped, except for the handle at hover_point.
+	 * 
+	 * @param hover_object The object which hover_point refers to, or nullptr.
+	 * 
+	 * For the other parameters, see the single object variant.
+	 */
+	void draw(QPainter* painter,
+	        const MapWidget* widget,
+	        const std::set<Object*>& objects,
+	        const Object* hover_object = nullptr,
+	        MapCoordVector::size_type hover_point = std::numeric_limits<MapCoordVector::size_type>::max(),
+	        bool draw_curve_handles = true,
+	        PointHandleState base_state = NormalHandleState
+	) const;
+	
 	/**
 	 * @brief Draws a point handle line.
 	 * 
@@ -120,6 +145,44 @@ public:
 	void drawCurveHandleLine(QPainter* painter, QPointF anchor_point, QPointF curve_handle, PointHandleType type, PointHandleState state) const;
 	
 private:
+	/**
+	 * @brief Handles collected for drawing in a single call.
+	 * 
+	 * Curve handle lines are drawn immediately, the handles themselves
+	 * are drawn from a single pixmap via QPainter::drawPixmapFragments()
+	 * when the batch is flushed. This keeps the handles on top of the lines.
+	 */
+	struct Batch
+	{
+		QVector<QPainter::PixmapFragment> fragments;
+		std::unordered_set<quint64> occupied;
+	};
+	
+	/**
+	 * @brief Adds the handles of a single object to the batch.
+	 */
+	void collect(Batch& batch,
+	        QPainter* painter,
+	        const MapWidget* widget,
+	        const Object* object,
+	        MapCoordVector::size_type hover_point,
+	        bool draw_curve_handles,
+	        PointHandleState base_state
+	) const;
+	
+	/**
+	 * @brief Adds a single handle to the batch.
+	 * 
+	 * Unless the handle is active, it is skipped when another handle was
+	 * already added at the same position (rounded to half a handle size).
+	 */
+	void collect(Batch& batch, QPointF position, PointHandleType type, PointHandleState state) const;
+	
+	/**
+	 * @brief Draws and clears the collected handles.
+	 */
+	void flush(QPainter* painter, Batch& batch) const;
+	
 	/**
 	 * @brief Loads and returns the image for a for a particular scale.
 	 * 
@@ -131,6 +194,7 @@ private:
 	
 	int scale_factor;
 	QImage handle_image;
+	QPixmap handle_pixmap;
 };
 
 
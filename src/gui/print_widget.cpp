@@ -28,6 +28,7 @@
 #include <QButtonGroup>
 #include <QDialogButtonBox>
 #include <QComboBox>
+#include <QDir>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QFormLayout>
@@ -47,6 +48,8 @@
 
 #include "main_window.h"
 #include "print_progress_dialog.h"
+#include "../core/banded_tiff_writer.h"
+#include "../core/color_transform.h"
 #include "../core/map_printer.h"
 #include "../map.h"
 #include "../map_editor.h"
@@ -250,6 +253,9 @@ PrintWidget::PrintWidget(Map* map, MainWindow* main_window, MapView* main_view,
 	export_button = new QPushButton(tr("Export..."));
 	export_button->hide();
 	button_box->addButton(export_button, QDialogButtonBox::ActionRole);
+	export_parts_button = new QPushButton(tr("Export parts..."));
+	export_parts_button->hide();
+	button_box->addButton(export_parts_button, QDialogButtonBox::ActionRole);
 	QPushButton* close_button = button_box->addButton(QDialogButtonBox::Close);
 	outer_layout->addWidget(button_box);
 	
@@ -279,6 +285,7 @@ PrintWidget::PrintWidget(Map* map, MainWindow* main_window, MapView* main_view,
 	connect(preview_button, SIGNAL(clicked(bool)), this, SLOT(previewClicked()));
 	connect(print_button, SIGNAL(clicked(bool)), this, SLOT(printClicked()));
 	connect(export_button, SIGNAL(clicked(bool)), this, SLOT(printClicked()));
+	connect(export_parts_button, SIGNAL(clicked(bool)), this, SLOT(exportPartsClicked()));
 	connect(close_button, SIGNAL(clicked(bool)), this, SIGNAL(closeClicked()));
 	
 	policy = map_printer->config().single_page_print_area ? SinglePage : CustomArea;
@@ -536,6 +543,7 @@ void PrintWidget::setTarget(const QPrinterInfo* target)
 	print_button->setDefault(is_printer);
 	export_button->setVisible(!is_printer);
 	export_button->setDefault(!is_printer);
+	export_parts_button->setVisible(target == MapPrinter::pdfTarget() && map->getNumParts() > 1);
 	
 	bool is_image_target = target == MapPrinter::imageTarget();
 	vector_mode_button->setEnabled(!is_image_target);
@@ -909,8 +917,9 @@ void PrintWidget::updateResolutions(const QPrinterInfo* target) const
 
 void PrintWidget::updateColorMode()
 {
-	bool enable = map_printer->getTarget() == MapPrinter::pdfTarget()
-	              && !raster_mode_button->isChecked();
+	// For images, device CMYK is supported by the TIFF export.
+	bool enable = (map_printer->getTarget() == MapPrinter::pdfTarget() && !raster_mode_button->isChecked())
+	              || map_printer->getTarget() == MapPrinter::imageTarget();
 	color_mode_combo->setEnabled(enable);
 	layout->labelForField(color_mode_combo)->setEnabled(enable);
 	if (!enable)
@@ -1073,6 +1082,73 @@ void PrintWidget::printClicked()
 		print();
 }
 
+// slot
+void PrintWidget::exportPartsClicked()
+{
+	if (checkForEmptyMap())
+		return;
+	
+	if (map_printer->getOptions().mode == MapPrinterOptions::Separations)
+	{
+		QMessageBox::warning(this, tr("Error"), tr("Parts cannot be exported in separations mode."));
+		return;
+	}
+	
+	QString directory = QFileDialog::getExistingDirectory(this, tr("Export parts ..."));
+	if (directory.isEmpty())
+		return;
+	
+	// The first part is the base map. Each other part (e.g. a course)
+	// is exported to a file named after the part.
+	std::vector<std::unique_ptr<QPrinter>> printers;
+	std::vector<MapPrinter::Variant> variants;
+	QStringList paths;
+	for (int i = 1; i < map->getNumParts(); ++i)
+	{
+		auto printer = map_printer->makePrinter();
+		if (!printer)
+		{
+			QMessageBox::warning(this, tr("Error"), tr("Failed to prepare the PDF export."));
+			return;
+		}
+		
+		const MapPart* part = map->getPart(i);
+		QString name = part->getName();
+		name.replace(QRegExp(QLatin1String("[/\\\\:*?\"<>|]")), QLatin1String("_"));
+		paths.push_back(QDir(directory).filePath(name + QLatin1String(".pdf")));
+		
+		printer->setOutputFormat(QPrinter::PdfFormat);
+		printer->setNumCopies(copies_edit->value());
+		printer->setCreator(main_window->appName());
+		printer->setDocName(part->getName());
+		printer->setOutputFileName(paths.back());
+		variants.push_back(MapPrinter::Variant(part, printer.get()));
+		printers.push_back(std::move(printer));
+	}
+	
+	PrintProgressDialog progress(map_printer, main_window);
+	progress.setWindowTitle(tr("Export parts ..."));
+	
+	// Export the parts
+	if (!map_printer->printVariants(map->getPart(0), variants))
+	{
+		for (const auto& path : paths)
+			QFile(path).remove();
+		QMessageBox::warning(this, tr("Error"), tr("Failed to finish the PDF export."));
+	}
+	else if (!progress.wasCanceled())
+	{
+		main_window->showStatusBarMessage(tr("Exported successfully to %1").arg(directory), 4000);
+		emit finished(0);
+	}
+	else
+	{
+		for (const auto& path : paths)
+			QFile(path).remove();
+		main_window->showStatusBarMessage(tr("Canceled."), 4000);
+	}
+}
+
 void PrintWidget::exportToImage()
 {
 	static const QString filter_template("%1 (%2)");
@@ -1096,6 +1172,13 @@ void PrintWidget::exportToImage()
 	qreal pixel_per_mm = map_printer->getOptions().resolution / 25.4;
 	int print_width = qRound(map_printer->getPrintAreaPaperSize().width() * pixel_per_mm);
 	int print_height = qRound(map_printer->getPrintAreaPaperSize().height() * pixel_per_mm);
+	
+	if (BandedTiffWriter::canWrite(path))
+	{
+		exportToTiff(path, QSize(print_width, print_height));
+		return;
+	}
+	
 	QImage image(print_width, print_height, QImage::Format_ARGB32_Premultiplied);
 	if (image.isNull())
 	{
@@ -1128,6 +1211,51 @@ void PrintWidget::exportToImage()
 	return;
 }
 
+void PrintWidget::exportToTiff(const QString& path, const QSize& size)
+{
+	// Draw and write the image in horizontal bands,
+	// so that the memory needed does not depend on the height of the image.
+	const int resolution = map_printer->getOptions().resolution;
+	const int band_height = qBound(1, (1 << 24) / qMax(1, size.width()), size.height());
+	const QRectF print_area = map_printer->getPrintArea();
+	const qreal map_mm_per_pixel = 25.4 / resolution / map_printer->getScaleAdjustment();
+	
+	const auto cmyk_transform = map_printer->makeCmykTransform();
+	BandedTiffWriter writer(path, size, resolution, cmyk_transform.get());
+	bool ok = writer.open();
+	QImage band;
+	for (int top = 0; ok && top < size.height(); top += band.height())
+	{
+		const int height = qMin(band_height, size.height() - top);
+		if (band.height() != height)
+			band = QImage(size.width(), height, QImage::Format_ARGB32_Premultiplied);
+		if (band.isNull())
+		{
+			QMessageBox::warning(this, tr("Error"), tr("Failed to prepare the image. Not enough memory."));
+			return;
+		}
+		
+		const QRectF band_extent(print_area.left(), print_area.top() + top * map_mm_per_pixel,
+		                         print_area.width(), height * map_mm_per_pixel);
+		QPainter p(&band);
+		map_printer->drawPage(&p, resolution, band_extent, true, &band);
+		ok = p.isActive();
+		p.end();
+		
+		ok = ok && writer.writeBand(band);
+	}
+	
+	if (!ok || !writer.finish())
+	{
+		QMessageBox::warning(this, tr("Error"), tr("Failed to save the image. Does the path exist? Do you have sufficient rights?"));
+	}
+	else
+	{
+		main_window->showStatusBarMessage(tr("Exported successfully to %1").arg(path), 4000);
+		emit finished(0);
+	}
+}
+
 void PrintWidget::exportToPdf()
 {
 	auto printer = map_printer->makePrinter();
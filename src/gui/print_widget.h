@@ -201,6 +201,10 @@ protected slots:
 	/** Starts printing and terminates this dialog. */
 	void printClicked();
 	
+	/** Exports each map part except the first one to its own PDF file,
+	 *  drawn on top of the first part. */
+	void exportPartsClicked();
+	
 protected:
 	/** Alternative policies of handling the print area. */
 	enum PrintAreaPolicy
@@ -241,6 +245,9 @@ protected:
 	/** Exports to an image file. */
 	void exportToImage();
 	
+	/** Exports to a TIFF file of the given size, drawing the image in bands. */
+	void exportToTiff(const QString& path, const QSize& size);
+	
 	/** Exports to a PDF file. */
 	void exportToPdf();
 	
@@ -293,6 +300,7 @@ private:
 	QPushButton* preview_button;
 	QPushButton* print_button;
 	QPushButton* export_button;
+	QPushButton* export_parts_button;
 	
 	QList<QPrinterInfo> printers;
 	
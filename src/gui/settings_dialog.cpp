@@ -36,6 +36,7 @@
 #include <QVBoxLayout>
 
 #include "../settings.h"
+#include "../undo_manager.h"
 #include "../util.h"
 #include "../util_gui.h"
 #include "../util_translation.h"
@@ -162,6 +163,27 @@ EditorPage::EditorPage(QWidget* parent)
 	text_antialiasing->setToolTip(tr("Antialiasing makes the map look much better, but also slows down the map display"));
 	layout->addWidget(text_antialiasing, row++, 0, 1, 2);
 	
+	QLabel* cache_margin_label = new QLabel(tr("Pre-rendered margin around the view:"));
+	QSpinBox* cache_margin = Util::SpinBox::create(0, 2048, tr("px", "pixels"));
+	cache_margin->setSpecialValueText(tr("Disabled"));
+	cache_margin->setToolTip(tr("A larger margin allows for smooth panning, but needs more memory"));
+	layout->addWidget(cache_margin_label, row, 0);
+	layout->addWidget(cache_margin, row++, 1);
+	
+	QCheckBox* reduced_color_depth = new QCheckBox(tr("Reduced color depth for templates below the map"));
+	reduced_color_depth->setToolTip(tr("Needs less memory and makes drawing faster, but shows less accurate colors"));
+	layout->addWidget(reduced_color_depth, row++, 0, 1, 2);
+	
+	QLabel* pixel_ratio_policy_label = new QLabel(tr("Resolution on high-dpi screens:"));
+	pixel_ratio_policy = new QComboBox();
+	pixel_ratio_policy->addItem(tr("Native resolution"), (int)Settings::PixelRatio_Native);
+	pixel_ratio_policy->addItem(tr("Native resolution for the map only"), (int)Settings::PixelRatio_NativeMapOnly);
+	pixel_ratio_policy->addItem(tr("Native resolution when idle"), (int)Settings::PixelRatio_NativeWhenIdle);
+	pixel_ratio_policy->addItem(tr("Low resolution"), (int)Settings::PixelRatio_Logical);
+	pixel_ratio_policy->setToolTip(tr("The native resolution looks sharper, but needs more memory and makes drawing slower"));
+	layout->addWidget(pixel_ratio_policy_label, row, 0);
+	layout->addWidget(pixel_ratio_policy, row++, 1);
+	
 	QLabel* tolerance_label = new QLabel(tr("Click tolerance:"));
 	QSpinBox* tolerance = Util::SpinBox::create(0, 50, tr("mm", "millimeters"));
 	layout->addWidget(tolerance_label, row, 0);
@@ -189,6 +211,31 @@ EditorPage::EditorPage(QWidget* parent)
 	QCheckBox* keep_settings_of_closed_templates = new QCheckBox(tr("Templates: keep settings of closed templates"));
 	layout->addWidget(keep_settings_of_closed_templates, row++, 0, 1, 2);
 	
+	QLabel* image_memory_limit_label = new QLabel(tr("Templates: memory for large images:"));
+	QSpinBox* image_memory_limit = Util::SpinBox::create(16, 65536, tr("MB", "megabytes"));
+	layout->addWidget(image_memory_limit_label, row, 0);
+	layout->addWidget(image_memory_limit, row++, 1);
+	
+	load_templates_on_demand = new QCheckBox(tr("Templates: load only when shown"));
+	layout->addWidget(load_templates_on_demand, row++, 0, 1, 2);
+	
+	QLabel* unload_idle_minutes_label = new QLabel(tr("Templates: unload when hidden for:"));
+	unload_idle_minutes = Util::SpinBox::create(0, 1440, tr("min", "minutes"));
+	unload_idle_minutes->setSpecialValueText(tr("Never"));
+	layout->addWidget(unload_idle_minutes_label, row, 0);
+	layout->addWidget(unload_idle_minutes, row++, 1);
+	
+	QLabel* image_cache_label = new QLabel(tr("Templates: disk cache for decoded images:"));
+	QSpinBox* image_cache = Util::SpinBox::create(0, 1048576, tr("MB", "megabytes"));
+	image_cache->setSpecialValueText(tr("Disabled"));
+	layout->addWidget(image_cache_label, row, 0);
+	layout->addWidget(image_cache, row++, 1);
+	
+	QLabel* undo_memory_limit_label = new QLabel(tr("Undo: memory for the history:"));
+	QSpinBox* undo_memory_limit = Util::SpinBox::create(4, 65536, tr("MB", "megabytes"));
+	layout->addWidget(undo_memory_limit_label, row, 0);
+	layout->addWidget(undo_memory_limit, row++, 1);
+	
 	
 	layout->setRowMinimumHeight(row++, 16);
 	layout->addWidget(Util::Headline::create(tr("Edit tool:")), row++, 0, 1, 2);
@@ -221,6 +268,9 @@ EditorPage::EditorPage(QWidget* parent)
 	
 	antialiasing->setChecked(Settings::getInstance().getSetting(Settings::MapDisplay_Antialiasing).toBool());
 	text_antialiasing->setChecked(Settings::getInstance().getSetting(Settings::MapDisplay_TextAntialiasing).toBool());
+	cache_margin->setValue(Settings::getInstance().getSetting(Settings::MapDisplay_CacheMargin).toInt());
+	reduced_color_depth->setChecked(Settings::getInstance().getSetting(Settings::MapDisplay_ReducedColorDepth).toBool());
+	pixel_ratio_policy->setCurrentIndex(pixel_ratio_policy->findData(Settings::getInstance().getSetting(Settings::MapDisplay_PixelRatioPolicy).toInt()));
 	tolerance->setValue(Settings::getInstance().getSetting(Settings::MapEditor_ClickToleranceMM).toInt());
 	snap_distance->setValue(Settings::getInstance().getSetting(Settings::MapEditor_SnapDistanceMM).toInt());
 	fixed_angle_stepping->setValue(Settings::getInstance().getSetting(Settings::MapEditor_FixedAngleStepping).toInt());
@@ -228,6 +278,11 @@ EditorPage::EditorPage(QWidget* parent)
 	zoom_out_away_from_cursor->setChecked(Settings::getInstance().getSetting(Settings::MapEditor_ZoomOutAwayFromCursor).toBool());
 	draw_last_point_on_right_click->setChecked(Settings::getInstance().getSetting(Settings::MapEditor_DrawLastPointOnRightClick).toBool());
 	keep_settings_of_closed_templates->setChecked(Settings::getInstance().getSetting(Settings::Templates_KeepSettingsOfClosed).toBool());
+	image_memory_limit->setValue(Settings::getInstance().getSetting(Settings::Templates_ImageMemoryLimitMB).toInt());
+	load_templates_on_demand->setChecked(Settings::getInstance().getSetting(Settings::Templates_LoadOnDemand).toBool());
+	unload_idle_minutes->setValue(Settings::getInstance().getSetting(Settings::Templates_UnloadIdleMinutes).toInt());
+	image_cache->setValue(Settings::getInstance().getSetting(Settings::Templates_ImageCacheMB).toInt());
+	undo_memory_limit->setValue(Settings::getInstance().getSetting(Settings::General_UndoMemoryLimitMB).toInt());
 	
 	edit_tool_delete_bezier_point_action->setCurrentIndex(edit_tool_delete_bezier_point_action->findData(Settings::getInstance().getSetting(Settings::EditTool_DeleteBezierPointAction).toInt()));
 	edit_tool_delete_bezier_point_action_alternative->setCurrentIndex(edit_tool_delete_bezier_point_action_alternative->findData(Settings::getInstance().getSetting(Settings::EditTool_DeleteBezierPointActionAlternative).toInt()));
@@ -241,6 +296,9 @@ EditorPage::EditorPage(QWidget* parent)
 
 	connect(antialiasing, &QAbstractButton::toggled, this, &EditorPage::antialiasingClicked);
 	connect(text_antialiasing, &QAbstractButton::toggled, this, &EditorPage::textAntialiasingClicked);
+	connect(cache_margin, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &EditorPage::cacheMarginChanged);
+	connect(reduced_color_depth, &QAbstractButton::clicked, this, &EditorPage::reducedColorDepthClicked);
+	connect(pixel_ratio_policy, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &EditorPage::pixelRatioPolicyChanged);
 	connect(tolerance, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &EditorPage::toleranceChanged);
 	connect(snap_distance, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &EditorPage::snapDistanceChanged);
 	connect(fixed_angle_stepping, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &EditorPage::fixedAngleSteppingChanged);
@@ -248,6 +306,11 @@ EditorPage::EditorPage(QWidget* parent)
 	connect(zoom_out_away_from_cursor, &QAbstractButton::clicked, this, &EditorPage::zoomOutAwayFromCursorClicked);
 	connect(draw_last_point_on_right_click, &QAbstractButton::clicked, this, &EditorPage::drawLastPointOnRightClickClicked);
 	connect(keep_settings_of_closed_templates, &QAbstractButton::clicked, this, &EditorPage::keepSettingsOfClosedTemplatesClicked);
+	connect(image_memory_limit, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &EditorPage::imageMemoryLimitChanged);
+	connect(load_templates_on_demand, &QAbstractButton::clicked, this, &EditorPage::loadTemplatesOnDemandClicked);
+	connect(unload_idle_minutes, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &EditorPage::unloadIdleMinutesChanged);
+	connect(image_cache, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &EditorPage::imageCacheChanged);
+	connect(undo_memory_limit, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &EditorPage::undoMemoryLimitChanged);
 	
 	connect(edit_tool_delete_bezier_point_action, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &EditorPage::editToolDeleteBezierPointActionChanged);
 	connect(edit_tool_delete_bezier_point_action_alternative, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &EditorPage::editToolDeleteBezierPointActionAlternativeChanged);
@@ -264,6 +327,7 @@ QString EditorPage::title() const
 void EditorPage::updateWidgets()
 {
 	text_antialiasing->setEnabled(antialiasing->isChecked());
+	unload_idle_minutes->setEnabled(load_templates_on_demand->isChecked());
 }
 
 void EditorPage::antialiasingClicked(bool checked)
@@ -277,6 +341,21 @@ void EditorPage::textAntialiasingClicked(bool checked)
 	changes.insert(Settings::getInstance().getSettingPath(Settings::MapDisplay_TextAntialiasing), QVariant(checked));
 }
 
+void EditorPage::cacheMarginChanged(int value)
+{
+	changes.insert(Settings::getInstance().getSettingPath(Settings::MapDisplay_CacheMargin), QVariant(value));
+}
+
+void EditorPage::reducedColorDepthClicked(bool checked)
+{
+	changes.insert(Settings::getInstance().getSettingPath(Settings::MapDisplay_ReducedColorDepth), QVariant(checked));
+}
+
+void EditorPage::pixelRatioPolicyChanged(int index)
+{
+	changes.insert(Settings::getInstance().getSettingPath(Settings::MapDisplay_PixelRatioPolicy), pixel_ratio_policy->itemData(index));
+}
+
 void EditorPage::toleranceChanged(int value)
 {
 	changes.insert(Settings::getInstance().getSettingPath(Settings::MapEditor_ClickToleranceMM), QVariant(value));
@@ -312,6 +391,32 @@ void EditorPage::keepSettingsOfClosedTemplatesClicked(bool checked)
 	changes.insert(Settings::getInstance().getSettingPath(Settings::Templates_KeepSettingsOfClosed), QVariant(checked));
 }
 
+void EditorPage::imageMemoryLimitChanged(int value)
+{
+	changes.insert(Settings::getInstance().getSettingPath(Settings::Templates_ImageMemoryLimitMB), QVariant(value));
+}
+
+void EditorPage::loadTemplatesOnDemandClicked(bool checked)
+{
+	changes.insert(Settings::getInstance().getSettingPath(Settings::Templates_LoadOnDemand), QVariant(checked));
+	updateWidgets();
+}
+
+void EditorPage::unloadIdleMinutesChanged(int value)
+{
+	changes.insert(Settings::getInstance().getSettingPath(Settings::Templates_UnloadIdleMinutes), QVariant(value));
+}
+
+void EditorPage::imageCacheChanged(int value)
+{
+	changes.insert(Settings::getInstance().getSettingPath(Settings::Templates_ImageCacheMB), QVariant(value));
+}
+
+void EditorPage::undoMemoryLimitChanged(int value)
+{
+	changes.insert(Settings::getInstance().getSettingPath(Settings::General_UndoMemoryLimitMB), QVariant(value));
+}
+
 void EditorPage::editToolDeleteBezierPointActionChanged(int index)
 {
 	changes.insert(Settings::getInstance().getSettingPath(Settings::EditTool_DeleteBezierPointAction), edit_tool_delete_bezier_point_action->itemData(index));
@@ -404,7 +509,13 @@ GeneralPage::GeneralPage(QWidget* parent)
 	compatibility_check->setChecked(Settings::getInstance().getSetting(Settings::General_RetainCompatiblity).toBool());
 	layout->addWidget(compatibility_check, row, 1, 1, 2);
 	
-	// Possible point: limit size of undo/redo journal
+	row++;
+	QLabel* saved_undo_steps_label = new QLabel(tr("Undo steps saved with the map:"));
+	layout->addWidget(saved_undo_steps_label, row, 1);
+	
+	QSpinBox* saved_undo_steps_edit = Util::SpinBox::create(0, int(UndoManager::max_undo_steps));
+	saved_undo_steps_edit->setValue(Settings::getInstance().getSetting(Settings::General_SavedUndoSteps).toInt());
+	layout->addWidget(saved_undo_steps_edit, row, 2);
 	
 	int autosave_interval = Settings::getInstance().getSetting(Settings::General_AutosaveInterval).toInt();
 	
@@ -461,6 +572,31 @@ GeneralPage::GeneralPage(QWidget* parent)
 	ocd_importer_check->setChecked(Settings::getInstance().getSetting(Settings::General_NewOcd8Implementation).toBool());
 	layout->addWidget(ocd_importer_check, row, 1, 1, 2);
 	
+	row++;
+	QCheckBox* defer_loading_check = new QCheckBox(tr("Load the objects of inactive map parts when needed"));
+	defer_loading_check->setChecked(Settings::getInstance().getSetting(Settings::General_DeferMapPartLoading).toBool());
+	layout->addWidget(defer_loading_check, row, 1, 1, 2);
+	
+	row++;
+	layout->addItem(Util::SpacerItem::create(this), row, 1);
+	
+	row++;
+	layout->addWidget(Util::Headline::create(tr("Power consumption")), row, 1, 1, 2);
+	
+	row++;
+	QCheckBox* power_saving_check = new QCheckBox(tr("Save battery power at the expense of display quality"));
+	power_saving_check->setChecked(Settings::getInstance().getSetting(Settings::General_PowerSaving).toBool());
+	layout->addWidget(power_saving_check, row, 1, 1, 2);
+	
+	row++;
+	QLabel* max_threads_label = new QLabel(tr("Worker threads:"));
+	layout->addWidget(max_threads_label, row, 1);
+	
+	QSpinBox* max_threads_edit = Util::SpinBox::create(0, 64);
+	max_threads_edit->setSpecialValueText(tr("Automatic"));
+	max_threads_edit->setValue(Settings::getInstance().getSetting(Settings::General_MaxThreads).toInt());
+	layout->addWidget(max_threads_edit, row, 2);
+	
 	row++;
 	layout->setRowStretch(row, 1);
 	
@@ -480,9 +616,13 @@ GeneralPage::GeneralPage(QWidget* parent)
 	connect(tips_visible_check, &QAbstractButton::clicked, this, &GeneralPage::tipsVisibleClicked);
 	connect(encoding_box, &QComboBox::currentTextChanged, this, &GeneralPage::encodingChanged);
 	connect(ocd_importer_check, &QAbstractButton::clicked, this, &GeneralPage::ocdImporterClicked);
+	connect(defer_loading_check, &QAbstractButton::clicked, this, &GeneralPage::deferMapPartLoadingClicked);
+	connect(power_saving_check, &QAbstractButton::clicked, this, &GeneralPage::powerSavingClicked);
+	connect(max_threads_edit, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &GeneralPage::maxThreadsChanged);
 	connect(autosave_check, &QAbstractButton::clicked, this, &GeneralPage::autosaveChanged);
 	connect(autosave_interval_edit, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &GeneralPage::autosaveIntervalChanged);
 	connect(compatibility_check, &QAbstractButton::clicked, this, &GeneralPage::retainCompatibilityChanged);
+	connect(saved_undo_steps_edit, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &GeneralPage::savedUndoStepsChanged);
 }
 
 QString GeneralPage::title() const
@@ -640,6 +780,22 @@ void GeneralPage::ocdImporterClicked(bool state)
 	changes.insert(Settings::getInstance().getSettingPath(Settings::General_NewOcd8Implementation), state);
 }
 
+// slot
+void GeneralPage::deferMapPartLoadingClicked(bool state)
+{
+	changes.insert(Settings::getInstance().getSettingPath(Settings::General_DeferMapPartLoading), state);
+}
+
+void GeneralPage::powerSavingClicked(bool state)
+{
+	changes.insert(Settings::getInstance().getSettingPath(Settings::General_PowerSaving), state);
+}
+
+void GeneralPage::maxThreadsChanged(int value)
+{
+	changes.insert(Settings::getInstance().getSettingPath(Settings::General_MaxThreads), value);
+}
+
 void GeneralPage::openTranslationFileDialog()
 {
 	Settings& settings = Settings::getInstance();
@@ -691,6 +847,11 @@ void GeneralPage::retainCompatibilityChanged(bool state)
 	changes.insert(Settings::getInstance().getSettingPath(Settings::General_RetainCompatiblity), state);
 }
 
+void GeneralPage::savedUndoStepsChanged(int value)
+{
+	changes.insert(Settings::getInstance().getSettingPath(Settings::General_SavedUndoSteps), value);
+}
+
 void GeneralPage::ppiChanged(double ppi)
 {
 	changes.insert(Settings::getInstance().getSettingPath(Settings::General_PixelsPerInch), QVariant(ppi));
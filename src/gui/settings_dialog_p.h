@@ -60,6 +60,9 @@ public:
 private slots:
 	void antialiasingClicked(bool checked);
 	void textAntialiasingClicked(bool checked);
+	void cacheMarginChanged(int value);
+	void reducedColorDepthClicked(bool checked);
+	void pixelRatioPolicyChanged(int index);
 	void toleranceChanged(int value);
 	void snapDistanceChanged(int value);
 	void fixedAngleSteppingChanged(int value);
@@ -74,12 +77,20 @@ private slots:
 	void rectanglePreviewLineWidthChanged(bool checked);
 	
 	void keepSettingsOfClosedTemplatesClicked(bool checked);
+	void imageMemoryLimitChanged(int value);
+	void loadTemplatesOnDemandClicked(bool checked);
+	void unloadIdleMinutesChanged(int value);
+	void imageCacheChanged(int value);
+	void undoMemoryLimitChanged(int value);
 	
 private:
 	void updateWidgets();
 	
 	QCheckBox* antialiasing;
 	QCheckBox* text_antialiasing;
+	QCheckBox* load_templates_on_demand;
+	QSpinBox*  unload_idle_minutes;
+	QComboBox* pixel_ratio_policy;
 	QComboBox* edit_tool_delete_bezier_point_action;
 	QComboBox* edit_tool_delete_bezier_point_action_alternative;
 };
@@ -115,12 +126,20 @@ private slots:
 	
 	void ocdImporterClicked(bool state);
 	
+	void deferMapPartLoadingClicked(bool state);
+	
+	void powerSavingClicked(bool state);
+	
+	void maxThreadsChanged(int value);
+	
 	void autosaveChanged(bool state);
 	
 	void autosaveIntervalChanged(int value);
 	
 	void retainCompatibilityChanged(bool state);
 	
+	void savedUndoStepsChanged(int value);
+	
 private:
 	/** Adds the available languages to the language combo box,
 	 *  and sets the current element.
@@ -0,0 +1,143 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "symbol_cost_dialog.h"
+
+#include <QApplication>
+#include <QClipboard>
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+#include "../memory_usage.h"
+#include "../symbol_cost_report.h"
+
+
+namespace
+{
+	/** A table item which is sorted by a number instead of by its text. */
+	class NumberItem : public QTableWidgetItem
+	{
+	public:
+		NumberItem(const QString& text, qint64 value)
+		: QTableWidgetItem(text)
+		, value(value)
+		{
+			setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+		}
+		
+		bool operator<(const QTableWidgetItem& other) const override
+		{
+			return value < static_cast<const NumberItem&>(other).value;
+		}
+	
+	private:
+		qint64 value;
+	};
+}
+
+
+
+SymbolCostDialog::SymbolCostDialog(QWidget* parent, Map& map, const MapView& view)
+: QDialog(parent, Qt::WindowSystemMenuHint | Qt::WindowTitleHint)
+, map(map)
+, view(view)
+{
+	setWindowTitle(tr("Symbol rendering cost"));
+	
+	table = new QTableWidget(0, 6);
+	table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	table->setSelectionBehavior(QAbstractItemView::SelectRows);
+	table->setHorizontalHeaderLabels(QStringList() << tr("Symbol") << tr("Objects") << tr("Renderables") << tr("Memory") << tr("Update") << tr("Render"));
+	table->verticalHeader()->setVisible(false);
+	table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+	for (int column = 1; column < 6; ++column)
+		table->horizontalHeader()->setSectionResizeMode(column, QHeaderView::ResizeToContents);
+	table->horizontalHeader()->setSortIndicator(5, Qt::DescendingOrder);
+	
+	total_label = new QLabel();
+	
+	QDialogButtonBox* button_box = new QDialogButtonBox(QDialogButtonBox::Close);
+	QPushButton* refresh_button = button_box->addButton(tr("Refresh"), QDialogButtonBox::ActionRole);
+	QPushButton* copy_button = button_box->addButton(tr("Copy"), QDialogButtonBox::ActionRole);
+	
+	QVBoxLayout* layout = new QVBoxLayout();
+	layout->addWidget(table);
+	layout->addWidget(total_label);
+	layout->addWidget(button_box);
+	setLayout(layout);
+	
+	connect(refresh_button, SIGNAL(clicked()), this, SLOT(refresh()));
+	connect(copy_button, SIGNAL(clicked()), this, SLOT(copyToClipboard()));
+	connect(button_box, SIGNAL(rejected()), this, SLOT(reject()));
+	
+	refresh();
+	resize(640, 480);
+}
+
+SymbolCostDialog::~SymbolCostDialog()
+{
+	; // nothing
+}
+
+void SymbolCostDialog::refresh()
+{
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+	const SymbolCostReport report = SymbolCostReport::measure(map, view);
+	QApplication::restoreOverrideCursor();
+	
+	// Inserting rows into a sorted table would move them while they are filled.
+	table->setSortingEnabled(false);
+	table->setRowCount(int(report.entries().size()));
+	
+	const QLocale locale;
+	int row = 0;
+	for (const auto& entry : report.entries())
+	{
+		QTableWidgetItem* memory_item = new NumberItem(MemoryUsage::formatBytes(entry.memory), entry.memory);
+		memory_item->setToolTip(tr("%1 bytes").arg(locale.toString(entry.memory)));
+		table->setItem(row, 0, new QTableWidgetItem(SymbolCostReport::label(entry)));
+		table->setItem(row, 1, new NumberItem(locale.toString(entry.num_objects), entry.num_objects));
+		table->setItem(row, 2, new NumberItem(locale.toString(entry.num_renderables), entry.num_renderables));
+		table->setItem(row, 3, memory_item);
+		table->setItem(row, 4, new NumberItem(SymbolCostReport::formatTime(entry.update_time), entry.update_time));
+		table->setItem(row, 5, new NumberItem(SymbolCostReport::formatTime(entry.render_time), entry.render_time));
+		++row;
+	}
+	table->setSortingEnabled(true);
+	
+	const auto& total = report.total();
+	total_label->setText(tr("Total: %1 objects, %2 renderables, %3, update %4, render %5")
+	                     .arg(locale.toString(total.num_objects),
+	                          locale.toString(total.num_renderables),
+	                          MemoryUsage::formatBytes(total.memory),
+	                          SymbolCostReport::formatTime(total.update_time),
+	                          SymbolCostReport::formatTime(total.render_time)));
+	text = report.toText();
+}
+
+void SymbolCostDialog::copyToClipboard()
+{
+	QApplication::clipboard()->setText(text);
+}
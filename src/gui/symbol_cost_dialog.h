@@ -0,0 +1,74 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_SYMBOL_COST_DIALOG_H_
+#define _OPENORIENTEERING_SYMBOL_COST_DIALOG_H_
+
+#include <QDialog>
+
+class QLabel;
+class QTableWidget;
+
+class Map;
+class MapView;
+
+
+/**
+ * @brief A dialog which shows the rendering cost of the map's objects, by symbol.
+ *
+ * The figures are measured with SymbolCostReport when the dialog is opened,
+ * and again when the user asks for a refresh. The table can be sorted by
+ * each column.
+ */
+class SymbolCostDialog : public QDialog
+{
+Q_OBJECT
+public:
+	/**
+	 * Constructs the dialog for the given map, measuring at the view's zoom.
+	 */
+	SymbolCostDialog(QWidget* parent, Map& map, const MapView& view);
+	
+	/**
+	 * Destructor.
+	 */
+	virtual ~SymbolCostDialog();
+
+public slots:
+	/**
+	 * Measures the rendering cost again and updates the table.
+	 */
+	void refresh();
+	
+	/**
+	 * Copies the figures to the clipboard, as plain text.
+	 */
+	void copyToClipboard();
+
+private:
+	Map& map;
+	const MapView& view;
+	
+	QTableWidget* table;
+	QLabel* total_label;
+	QString text;
+};
+
+#endif
@@ -20,6 +20,9 @@
 
 #include "compass_display.h"
 
+#include <cmath>
+
+#include <qmath.h>
 #include <QPainter>
 #include <QtNumeric>
 
@@ -41,10 +44,13 @@ CompassDisplay::~CompassDisplay()
 
 void CompassDisplay::setAzimuth(float azimuth_deg)
 {
+	if (!isVisible() || window()->isMinimized())
+		return;
+	
 	constexpr int update_interval = 200;
 	QTime current_time = QTime::currentTime();
 	if (qAbs(last_update_time.msecsTo(current_time)) >= update_interval
-	    && azimuth != azimuth_deg)
+	    && isPerceptibleChange(azimuth_deg))
 	{
 		last_update_time = current_time;
 		azimuth = azimuth_deg;
@@ -54,6 +60,17 @@ void CompassDisplay::setAzimuth(float azimuth_deg)
 	}
 }
 
+bool CompassDisplay::isPerceptibleChange(float azimuth_deg) const
+{
+	if (qIsNaN(azimuth))
+		return true;
+	
+	// The tip of the needle must move by at least one pixel.
+	const qreal needle_length = 0.5 * height();
+	const qreal change = qAbs(std::remainder(azimuth_deg - azimuth, 360.0));
+	return qDegreesToRadians(change) * needle_length >= 1.0;
+}
+
 QSize CompassDisplay::sizeHint() const
 {
 	auto width = qRound(Util::mmToPixelLogical(20.0));
@@ -49,7 +49,8 @@ public:
 	/** 
 	 * Sets the compass direction, and updates the widget.
 	 * 
-	 * This does nothing unless at least 200 ms elapsed since the last change.
+	 * This does nothing unless at least 200 ms elapsed since the last change,
+	 * and unless the change is visible at the widget's size.
 	 */
 	void setAzimuth(float azimuth_deg);
 	
@@ -62,6 +63,9 @@ protected:
 	
 	void paintEvent(QPaintEvent* event) override;
 	
+	/** Returns true if changing to the given azimuth would move the needle. */
+	bool isPerceptibleChange(float azimuth_deg) const;
+	
 	qreal azimuth;
 	QTime last_update_time;
 };
@@ -31,12 +31,14 @@
 #include <QLabel>
 #include <QListWidget>
 #include <QPainter>
+#include <QPixmap>
 #include <QProcessEnvironment>
 #include <QScroller>
 #include <QStackedLayout>
 
 #include "../home_screen_controller.h"
 #include "../main_window.h"
+#include "../../core/map_thumbnail_cache.h"
 #include "../../file_format_registry.h"
 #include "../../mapper_resource.h"
 
@@ -45,9 +47,13 @@
 
 AbstractHomeScreenWidget::AbstractHomeScreenWidget(HomeScreenController* controller, QWidget* parent)
 : QWidget(parent),
-  controller(controller)
+  controller(controller),
+  thumbnail_list(nullptr)
 {
 	Q_ASSERT(controller->getWindow() != NULL);
+	
+	thumbnails = new MapThumbnailCache(3 * fontMetrics().height(), this);
+	connect(thumbnails, &MapThumbnailCache::thumbnailReady, this, &AbstractHomeScreenWidget::thumbnailReady);
 }
 
 AbstractHomeScreenWidget::~AbstractHomeScreenWidget()
@@ -55,6 +61,45 @@ AbstractHomeScreenWidget::~AbstractHomeScreenWidget()
 	// nothing
 }
 
+void AbstractHomeScreenWidget::setThumbnailList(QListWidget* list)
+{
+	const int size = thumbnails->thumbnailSize();
+	list->setIconSize(QSize(size, size));
+	thumbnail_list = list;
+}
+
+void AbstractHomeScreenWidget::requestThumbnail(QListWidgetItem* item)
+{
+	Q_ASSERT(item->listWidget() == thumbnail_list);
+	
+	// Until the thumbnail is available, an empty icon keeps the items aligned.
+	QImage image = thumbnails->thumbnail(item->data(Qt::UserRole).toString());
+	if (image.isNull())
+	{
+		QPixmap placeholder(thumbnail_list->iconSize());
+		placeholder.fill(Qt::transparent);
+		item->setIcon(placeholder);
+	}
+	else
+	{
+		item->setIcon(QPixmap::fromImage(image));
+	}
+}
+
+void AbstractHomeScreenWidget::thumbnailReady(const QString& path, const QImage& image)
+{
+	if (!thumbnail_list)
+		return;
+	
+	const QIcon icon(QPixmap::fromImage(image));
+	for (int i = 0; i < thumbnail_list->count(); ++i)
+	{
+		QListWidgetItem* item = thumbnail_list->item(i);
+		if (item->data(Qt::UserRole).toString() == path)
+			item->setIcon(icon);
+	}
+}
+
 QLabel* AbstractHomeScreenWidget::makeHeadline(const QString& text, QWidget* parent) const
 {
 	QLabel* title_label = new QLabel(text, parent);
@@ -195,6 +240,7 @@ QWidget* HomeScreenWidgetDesktop::makeRecentFilesWidget(HomeScreenController* co
 	}
 	recent_files_list->setFont(list_font);
 	recent_files_list->setSpacing(pixel_size/2);
+	setThumbnailList(recent_files_list);
 	recent_files_list->setCursor(Qt::PointingHandCursor);
 	recent_files_list->setStyleSheet(" \
 	  QListWidget::item:hover { \
@@ -269,6 +315,7 @@ void HomeScreenWidgetDesktop::setRecentFiles(const QStringList& files)
 		new_item->setData(Qt::UserRole, file);
 		new_item->setToolTip(file);
 		recent_files_list->addItem(new_item);
+		requestThumbnail(new_item);
 	}
 }
 
@@ -455,6 +502,7 @@ QWidget* HomeScreenWidgetMobile::makeFileListWidget(HomeScreenController* contro
 	}
 	file_list->setFont(list_font);
 	file_list->setSpacing(pixel_size/2);
+	setThumbnailList(file_list);
 	file_list->setCursor(Qt::PointingHandCursor);
 	file_list->setStyleSheet(" \
 	  QListWidget::item:hover { \
@@ -520,5 +568,6 @@ void HomeScreenWidgetMobile::addFilesToFileList(QListWidget* file_list, const QS
 		new_item->setData(Qt::UserRole, it.filePath());
 		new_item->setToolTip(it.filePath());
 		file_list->addItem(new_item);
+		requestThumbnail(new_item);
 	}
 }
@@ -28,6 +28,7 @@
 QT_BEGIN_NAMESPACE
 class QAbstractButton;
 class QCheckBox;
+class QImage;
 class QLabel;
 class QListWidget;
 class QListWidgetItem;
@@ -38,6 +39,7 @@ class QStackedLayout;
 QT_END_NAMESPACE
 
 class HomeScreenController;
+class MapThumbnailCache;
 
 /**
  * The user interface of the OpenOrienteering Mapper home screen.
@@ -69,7 +71,17 @@ public slots:
 	 *  sets the "checked" state of the control for displaying the tip. */
 	virtual void setTipsVisible(bool state) = 0;
 	
+protected slots:
+	/** Sets the icon of the list items of the given map file. */
+	void thumbnailReady(const QString& path, const QImage& image);
+	
 protected:
+	/** Prepares the list for showing the thumbnails of map files as icons. */
+	void setThumbnailList(QListWidget* list);
+	
+	/** Shows the thumbnail of the item's map file as its icon, as soon as it is available. */
+	void requestThumbnail(QListWidgetItem* item);
+	
 	/** Returns a QLabel for displaying a headline in the home screen. */
 	QLabel* makeHeadline(const QString& text, QWidget* parent = NULL) const;
 	
@@ -84,6 +96,10 @@ protected:
 	
 	
 	HomeScreenController* controller;
+	
+	MapThumbnailCache* thumbnails;
+	
+	QListWidget* thumbnail_list;
 };
 
 
@@ -21,33 +21,130 @@
 
 #include "measure_widget.h"
 
+#include <QCoreApplication>
+#include <QEvent>
 #include <QLocale>
+#include <QPointer>
+#include <QRunnable>
 #include <QScroller>
 #include <QStringBuilder>
+#include <QUrl>
 
 #include "../../map.h"
+#include "../../map_part.h"
 #include "../../object.h"
 #include "../../symbol.h"
 #include "../../symbol_area.h"
 #include "../../symbol_line.h"
 
 
+namespace
+{
+	/** Larger selections are summed up in a worker thread. */
+	const std::size_t max_synchronous_objects = 20000;
+	
+	/** The delay of updates after edits. */
+	const int update_delay_msecs = 200;
+	
+	/** The link which starts collecting the statistics of all objects. */
+	const QLatin1String statistics_link("statistics");
+}
+
+
+
+/**
+ * Sums up the measures of objects in a worker thread, and passes the result
+ * to the widget in the GUI thread when finished.
+ *
+ * The job is an object of the GUI thread. It deletes itself after
+ * finishing, even if the widget was deleted in the meantime. The worker
+ * thread only compares the symbols of the measures by address. The widget
+ * cancels the job when symbols are changed or deleted, so the result's
+ * symbols are valid unless the job is cancelled.
+ */
+class MeasureWidget::Job : public QObject, public QRunnable
+{
+public:
+	Job(MeasureWidget* widget, std::vector<ObjectStatistics::Measures> measures,
+	    const QString& headline, std::shared_ptr<TaskPool::CancellationToken> token)
+	 : widget(widget)
+	 , measures(std::move(measures))
+	 , headline(headline)
+	 , token(std::move(token))
+	{
+		setAutoDelete(false);
+	}
+	
+	void run() override
+	{
+		result = ObjectStatistics::sum(measures, token.get());
+		// Nothing must be accessed after posting the event.
+		QCoreApplication::postEvent(this, new QEvent(finishedEvent()));
+	}
+	
+	bool event(QEvent* event) override
+	{
+		if (event->type() != finishedEvent())
+			return QObject::event(event);
+		
+		if (widget && !token->isCancelled())
+		{
+			widget->running_job.reset();
+			result.sort();
+			widget->showStatistics(headline, result);
+		}
+		deleteLater();
+		return true;
+	}
+
+private:
+	static QEvent::Type finishedEvent()
+	{
+		static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+		return type;
+	}
+	
+	QPointer<MeasureWidget> widget;
+	std::vector<ObjectStatistics::Measures> measures;
+	QString headline;
+	std::shared_ptr<TaskPool::CancellationToken> token;
+	ObjectStatistics result;
+};
+
+
+
+// ### MeasureWidget ###
+
 MeasureWidget::MeasureWidget(Map* map, QWidget* parent)
 : QTextBrowser(parent)
 , map(map)
 {
 	QScroller::grabGesture(viewport(), QScroller::TouchGesture);
+	setOpenLinks(false);
+	
+	update_timer.setSingleShot(true);
+	update_timer.setInterval(update_delay_msecs);
+	connect(&update_timer, &QTimer::timeout, this, &MeasureWidget::objectSelectionChanged);
 	
 	connect(map, &Map::objectSelectionChanged, this, &MeasureWidget::objectSelectionChanged);
-	connect(map, &Map::selectedObjectEdited, this, &MeasureWidget::objectSelectionChanged);
-	connect(map, &Map::symbolChanged, this, &MeasureWidget::objectSelectionChanged);
+	connect(map, &Map::selectedObjectEdited, this, &MeasureWidget::objectsEdited);
+	connect(map, &Map::symbolChanged, this, &MeasureWidget::objectsEdited);
+	connect(map, &Map::symbolDeleted, this, &MeasureWidget::objectsEdited);
+	connect(this, &QTextBrowser::anchorClicked, this, &MeasureWidget::linkClicked);
 	
 	objectSelectionChanged();
 }
 
 MeasureWidget::~MeasureWidget()
 {
-	// nothing
+	cancelJob();
+}
+
+void MeasureWidget::objectsEdited()
+{
+	// Results of a running job may refer to deleted symbols.
+	cancelJob();
+	update_timer.start();
 }
 
 void MeasureWidget::objectSelectionChanged()
@@ -56,14 +153,41 @@ void MeasureWidget::objectSelectionChanged()
 	QString body;       // HTML blocks
 	QString extra_text; // inline HTML
 	
+	update_timer.stop();
+	cancelJob();
+	
 	auto& selected_objects = map->selectedObjects();
 	if (selected_objects.empty())
 	{
-		extra_text = tr("No object selected.");
+		extra_text = tr("No object selected.")
+		             % QLatin1String("<br/><a href=\"") % statistics_link % QLatin1String("\">")
+		             % tr("Show the statistics of all objects.") % QLatin1String("</a>");
 	}
 	else if (selected_objects.size() > 1)
 	{
-		extra_text = tr("%1 objects selected.").arg(locale().toString(map->getNumSelectedObjects()));
+		headline = tr("%1 objects selected.").arg(locale().toString(map->getNumSelectedObjects()));
+		if (selected_objects.size() <= max_synchronous_objects)
+		{
+			ObjectStatistics statistics;
+			for (const Object* object : selected_objects)
+			{
+				object->update();
+				statistics.add(object);
+			}
+			showStatistics(headline, statistics);
+		}
+		else
+		{
+			std::vector<ObjectStatistics::Measures> measures;
+			measures.reserve(selected_objects.size());
+			for (const Object* object : selected_objects)
+			{
+				object->update();
+				measures.push_back(ObjectStatistics::measure(object));
+			}
+			startJob(std::move(measures), headline);
+		}
+		return;
 	}
 	else
 	{
@@ -88,7 +212,7 @@ void MeasureWidget::objectSelectionChanged()
 			const PathPartVector& parts = static_cast<const PathObject*>(object)->parts();
 			Q_ASSERT(!parts.empty());
 			
-			auto paper_length = parts.front().length();
+			auto paper_length = ObjectStatistics::pathLength(parts);
 			auto real_length  = paper_length * paper_to_real;
 			
 			auto paper_length_text = locale().toString(paper_length, 'f', 2);
@@ -100,13 +224,7 @@ void MeasureWidget::objectSelectionChanged()
 				                          paper_length_text, tr("mm", "millimeters"),
 				                          real_length_text, tr("m", "meters")));
 				
-				auto paper_area = parts.front().calculateArea();
-				if (parts.size() > 1)
-				{
-					paper_area *= 2;
-					for (const auto& part : parts)
-						paper_area -= part.calculateArea();
-				}
+				auto paper_area = ObjectStatistics::pathArea(parts);
 				double real_area = paper_area * paper_to_real * paper_to_real;
 				
 				auto paper_area_text = locale().toString(paper_area, 'f', 2);
@@ -161,3 +279,86 @@ void MeasureWidget::objectSelectionChanged()
 		body.append(QLatin1String("<p>") % extra_text % QLatin1String("</p>"));
 	setHtml(QLatin1String("<p><b>") % headline % QLatin1String("</b></p>") % body);
 }
+
+void MeasureWidget::linkClicked(const QUrl& link)
+{
+	if (link.toString() != statistics_link)
+		return;
+	
+	std::vector<ObjectStatistics::Measures> measures;
+	for (int p = 0; p < map->getNumParts(); ++p)
+	{
+		const MapPart* part = map->getPart(std::size_t(p));
+		for (int i = 0; i < part->getNumObjects(); ++i)
+		{
+			const Object* object = part->getObject(i);
+			object->update();
+			measures.push_back(ObjectStatistics::measure(object));
+		}
+	}
+	startJob(std::move(measures), tr("All objects"));
+}
+
+void MeasureWidget::cancelJob()
+{
+	if (running_job)
+	{
+		running_job->cancel();
+		running_job.reset();
+	}
+}
+
+void MeasureWidget::startJob(std::vector<ObjectStatistics::Measures> measures, const QString& headline)
+{
+	cancelJob();
+	running_job = std::make_shared<TaskPool::CancellationToken>();
+	
+	setHtml(QLatin1String("<p><b>") % headline % QLatin1String("</b></p><p>") % tr("Calculating...") % QLatin1String("</p>"));
+	TaskPool::start(new Job(this, std::move(measures), headline, running_job), TaskPool::Interactive);
+}
+
+void MeasureWidget::showStatistics(const QString& headline, const ObjectStatistics& statistics)
+{
+	static const QString table_row{ QLatin1String{
+	  "<tr><td>%1</td><td align=\"right\">%2</td><td align=\"right\">%3</td><td align=\"right\">%4</td></tr>"
+	} };
+	
+	double paper_to_real = 0.001 * map->getScaleDenominator();
+	auto total_length = 0.0;
+	auto total_area   = 0.0;
+	
+	QString body = QLatin1String("<table cellspacing=\"4\">")
+	               % table_row.arg(tr("Symbol"), tr("Objects"),
+	                               tr("Length (%1)").arg(tr("m", "meters")),
+	                               tr("Area (%1)").arg(trUtf8("m²", "square meters")));
+	for (const auto& entry : statistics.entries())
+	{
+		const Symbol* symbol = entry.symbol;
+		auto real_length = entry.length * paper_to_real;
+		auto real_area   = entry.area * paper_to_real * paper_to_real;
+		
+		// Lines have a length, areas have an area and a boundary length.
+		QString length_text;
+		QString area_text;
+		if (symbol->getContainedTypes() & Symbol::Area)
+		{
+			area_text = locale().toString(real_area, 'f', 0);
+			total_area += real_area;
+		}
+		else if (symbol->getContainedTypes() & Symbol::Line)
+		{
+			length_text = locale().toString(real_length, 'f', 0);
+			total_length += real_length;
+		}
+		
+		body.append(table_row.arg(symbol->getNumberAsString() % QLatin1Char(' ') % symbol->getPlainTextName().toHtmlEscaped(),
+		                          locale().toString(entry.count), length_text, area_text));
+	}
+	body.append(table_row.arg(QLatin1String("<b>") % tr("Total") % QLatin1String("</b>"),
+	                          locale().toString(statistics.count()),
+	                          locale().toString(total_length, 'f', 0),
+	                          locale().toString(total_area, 'f', 0)));
+	body.append(QLatin1String("</table>"));
+	
+	setHtml(QLatin1String("<p><b>") % headline % QLatin1String("</b></p>") % body);
+}
@@ -22,13 +22,30 @@
 #ifndef OPENORIENTEERING_MEASURE_WIDGET_H
 #define OPENORIENTEERING_MEASURE_WIDGET_H
 
+#include <memory>
+#include <vector>
+
 #include <QTextBrowser>
+#include <QTimer>
+
+#include "../../core/task_pool.h"
+#include "../../object_statistics.h"
+
+class QUrl;
 
 class Map;
 
 /**
  * The widget which is shown in a dock widget when the measure tool is active.
  * Displays information about the currently selected objects.
+ * 
+ * For multiple objects, the number, length and area are listed by symbol.
+ * The measures of the objects are taken from their maintained values. For
+ * large selections, and for all objects of the map, they are summed up in a
+ * worker thread.
+ * 
+ * Edits of the selected objects and of symbols update the content after a
+ * short delay, so that a sequence of edits is measured only once.
  */
 class MeasureWidget : public QTextBrowser
 {
@@ -37,7 +54,7 @@ public:
 	/** Creates a new MeasureWidget for a given map. */
 	MeasureWidget(Map* map, QWidget* parent = nullptr);
 
-	/** Destroys the MeasureWidget. */
+	/** Destroys the MeasureWidget, cancelling a running job. */
 	~MeasureWidget() override;
 	
 protected slots:
@@ -47,8 +64,36 @@ protected slots:
 	 */
 	void objectSelectionChanged();
 	
+	/**
+	 * Is called when the selected objects or the symbols are edited.
+	 * Cancels a running job and schedules an update of the widget content.
+	 */
+	void objectsEdited();
+	
+	/** Starts collecting the statistics of all objects when the link is clicked. */
+	void linkClicked(const QUrl& link);
+	
 private:
+	class Job;
+	
+	/** Cancels the running job, if any. */
+	void cancelJob();
+	
+	/**
+	 * Sums up the given measures in a worker thread, cancelling a running job.
+	 */
+	void startJob(std::vector<ObjectStatistics::Measures> measures, const QString& headline);
+	
+	/** Shows the statistics with the given headline. */
+	void showStatistics(const QString& headline, const ObjectStatistics& statistics);
+	
 	Map* map;
+	
+	/** Delays updates after edits. */
+	QTimer update_timer;
+	
+	/** The token of the running job, or nullptr. */
+	std::shared_ptr<TaskPool::CancellationToken> running_job;
 };
 
 #endif
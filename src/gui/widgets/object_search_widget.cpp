@@ -0,0 +1,119 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "object_search_widget.h"
+
+#include <vector>
+
+#include <QCheckBox>
+#include <QFormLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+
+#include "../../core/map_view.h"
+#include "../../map.h"
+#include "../../map_editor.h"
+#include "../../map_widget.h"
+#include "../../tool.h"
+
+
+ObjectSearchWidget::ObjectSearchWidget(Map* map, MapEditorController* controller, QWidget* parent)
+ : QWidget(parent)
+ , map(map)
+ , controller(controller)
+{
+	key_edit = new QLineEdit();
+	value_edit = new QLineEdit();
+	value_edit->setPlaceholderText(tr("Any value"));
+	symbol_check = new QCheckBox(tr("Only objects with the selected symbol"));
+	area_check = new QCheckBox(tr("Only objects in the visible area"));
+	search_button = new QPushButton(tr("Select matching objects"));
+	result_label = new QLabel();
+	result_label->setWordWrap(true);
+	
+	QFormLayout* layout = new QFormLayout();
+	layout->addRow(tr("Tag key:"), key_edit);
+	layout->addRow(tr("Tag value:"), value_edit);
+	layout->addRow(symbol_check);
+	layout->addRow(area_check);
+	layout->addRow(search_button);
+	layout->addRow(result_label);
+	setLayout(layout);
+	
+	connect(key_edit, &QLineEdit::textChanged, this, &ObjectSearchWidget::updateWidgets);
+	connect(symbol_check, &QCheckBox::toggled, this, &ObjectSearchWidget::updateWidgets);
+	connect(area_check, &QCheckBox::toggled, this, &ObjectSearchWidget::updateWidgets);
+	connect(key_edit, &QLineEdit::returnPressed, this, &ObjectSearchWidget::search);
+	connect(value_edit, &QLineEdit::returnPressed, this, &ObjectSearchWidget::search);
+	connect(search_button, &QPushButton::clicked, this, &ObjectSearchWidget::search);
+	
+	updateWidgets();
+}
+
+ObjectSearchWidget::~ObjectSearchWidget()
+{
+	; // Nothing
+}
+
+// slot
+void ObjectSearchWidget::updateWidgets()
+{
+	value_edit->setEnabled(!key_edit->text().trimmed().isEmpty());
+	search_button->setEnabled(!key_edit->text().trimmed().isEmpty() || symbol_check->isChecked() || area_check->isChecked());
+}
+
+// slot
+void ObjectSearchWidget::search()
+{
+	if (!search_button->isEnabled())
+		return;
+	
+	ObjectQuery query;
+	query.part = map->getCurrentPart();
+	query.tag_key = key_edit->text().trimmed();
+	if (!query.tag_key.isEmpty() && !value_edit->text().isEmpty())
+		query.tag_value = value_edit->text();
+	if (symbol_check->isChecked())
+	{
+		query.symbol = controller->activeSymbol();
+		if (!query.symbol)
+		{
+			result_label->setText(tr("No symbol is selected."));
+			return;
+		}
+	}
+	if (area_check->isChecked())
+	{
+		MapWidget* map_widget = controller->getMainWidget();
+		query.area = map_widget->getMapView()->calculateViewedRect(map_widget->viewportToView(map_widget->rect()));
+	}
+	
+	map->updateObjects();
+	const std::vector<Object*> objects = map->findObjects(query);
+	
+	map->clearObjectSelection(false);
+	map->addObjectsToSelection(objects, false);
+	map->emitSelectionChanged();
+	if (!objects.empty() && controller->getTool() && controller->getTool()->isDrawTool())
+		controller->setEditTool();
+	
+	result_label->setText(tr("%n object(s) selected.", nullptr, int(objects.size())));
+}
@@ -0,0 +1,74 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_OBJECT_SEARCH_WIDGET_H
+#define OPENORIENTEERING_OBJECT_SEARCH_WIDGET_H
+
+#include <QWidget>
+
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QPushButton;
+
+class Map;
+class MapEditorController;
+
+
+/**
+ * A widget which selects the objects of the current map part which match
+ * a combination of tag, symbol and area criteria.
+ * 
+ * The search uses Map::findObjects().
+ */
+class ObjectSearchWidget : public QWidget
+{
+Q_OBJECT
+public:
+	/** Constructs a new search widget for the given map. */
+	explicit ObjectSearchWidget(Map* map, MapEditorController* controller, QWidget* parent = nullptr);
+	
+	/** Destroys the widget. */
+	~ObjectSearchWidget() override;
+	
+protected slots:
+	/**
+	 * Selects the objects which match the criteria.
+	 */
+	void search();
+	
+	/**
+	 * Enables the search button when there is at least one criterion.
+	 */
+	void updateWidgets();
+	
+private:
+	Map* map;
+	MapEditorController* controller;
+	
+	QLineEdit* key_edit;
+	QLineEdit* value_edit;
+	QCheckBox* symbol_check;
+	QCheckBox* area_check;
+	QPushButton* search_button;
+	QLabel* result_label;
+};
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "quality_check_widget.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QHeaderView>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLocale>
+#include <QPointer>
+#include <QPushButton>
+#include <QRunnable>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+#include "../../map.h"
+#include "../../map_editor.h"
+#include "../../map_part.h"
+#include "../../map_widget.h"
+#include "../../object.h"
+#include "../../symbol.h"
+
+
+/**
+ * Runs the check on a snapshot of the map in a worker thread, and passes
+ * the result to the widget in the GUI thread when finished.
+ *
+ * The job is an object of the GUI thread. It deletes itself after
+ * finishing, even if the widget was deleted in the meantime.
+ */
+class QualityCheckWidget::Job : public QObject, public QRunnable
+{
+public:
+	Job(QualityCheckWidget* widget, std::shared_ptr<const Map> snapshot, std::shared_ptr<TaskPool::CancellationToken> token)
+	 : widget(widget)
+	 , snapshot(std::move(snapshot))
+	 , token(std::move(token))
+	{
+		setAutoDelete(false);
+	}
+	
+	void run() override
+	{
+		QElapsedTimer timer;
+		timer.start();
+		result = MapQualityCheck::run(*snapshot, MapQualityCheck::Options(), token.get());
+		msecs = timer.elapsed();
+		// Nothing must be accessed after posting the event.
+		QCoreApplication::postEvent(this, new QEvent(finishedEvent()));
+	}
+	
+	bool event(QEvent* event) override
+	{
+		if (event->type() != finishedEvent())
+			return QObject::event(event);
+		
+		if (widget && !token->isCancelled())
+			widget->finishCheck(result, msecs);
+		deleteLater();
+		return true;
+	}
+
+private:
+	static QEvent::Type finishedEvent()
+	{
+		static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+		return type;
+	}
+	
+	QPointer<QualityCheckWidget> widget;
+	std::shared_ptr<const Map> snapshot;
+	std::shared_ptr<TaskPool::CancellationToken> token;
+	MapQualityCheck result;
+	qint64 msecs = 0;
+};
+
+
+
+// ### QualityCheckWidget ###
+
+QualityCheckWidget::QualityCheckWidget(Map* map, MapEditorController* controller, QWidget* parent)
+: QWidget(parent)
+, map(map)
+, controller(controller)
+{
+	issue_table = new QTableWidget(0, 3);
+	issue_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	issue_table->setSelectionMode(QAbstractItemView::SingleSelection);
+	issue_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+	issue_table->setHorizontalHeaderLabels(QStringList() << tr("Issue") << tr("Symbol") << tr("Part"));
+	issue_table->verticalHeader()->setVisible(false);
+	issue_table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+	issue_table->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
+	issue_table->horizontalHeader()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
+	
+	status_label = new QLabel(tr("Not checked yet."));
+	status_label->setWordWrap(true);
+	
+	check_button = new QPushButton(tr("Check"));
+	
+	QHBoxLayout* button_layout = new QHBoxLayout();
+	button_layout->addWidget(status_label, 1);
+	button_layout->addWidget(check_button);
+	
+	QVBoxLayout* layout = new QVBoxLayout();
+	layout->setContentsMargins(0, 0, 0, 0);
+	layout->addWidget(issue_table, 1);
+	layout->addLayout(button_layout);
+	setLayout(layout);
+	
+	connect(check_button, SIGNAL(clicked()), this, SLOT(startCheck()));
+	connect(issue_table, SIGNAL(itemSelectionChanged()), this, SLOT(currentRowChanged()));
+	connect(issue_table, SIGNAL(cellActivated(int,int)), this, SLOT(zoomToIssue(int)));
+}
+
+QualityCheckWidget::~QualityCheckWidget()
+{
+	if (running_check)
+		running_check->cancel();
+}
+
+void QualityCheckWidget::startCheck()
+{
+	if (running_check)
+		running_check->cancel();
+	running_check = std::make_shared<TaskPool::CancellationToken>();
+	
+	// The snapshot has the same objects in the same order.
+	pending_objects.clear();
+	pending_objects.resize(std::size_t(map->getNumParts()));
+	for (int p = 0; p < map->getNumParts(); ++p)
+	{
+		MapPart* part = map->getPart(std::size_t(p));
+		auto& objects = pending_objects[std::size_t(p)];
+		objects.reserve(std::size_t(part->getNumObjects()));
+		for (int i = 0; i < part->getNumObjects(); ++i)
+			objects.push_back(part->getObject(i));
+	}
+	
+	status_label->setText(tr("Checking..."));
+	TaskPool::start(new Job(this, map->snapshot(), running_check), TaskPool::Interactive);
+}
+
+void QualityCheckWidget::finishCheck(const MapQualityCheck& result, qint64 msecs)
+{
+	running_check.reset();
+	checked_objects.swap(pending_objects);
+	pending_objects.clear();
+	issues = result.issues();
+	
+	issue_table->clearContents();
+	issue_table->setRowCount(int(issues.size()));
+	for (int row = 0; row < int(issues.size()); ++row)
+	{
+		const auto& issue = issues[std::size_t(row)];
+		const std::vector<Object*> objects = objectsOfIssue(row);
+		const Symbol* symbol = objects.empty() ? nullptr : objects.front()->getSymbol();
+		const QString symbol_label = symbol ? symbol->getNumberAsString() + QLatin1Char(' ') + symbol->getPlainTextName() : tr("(deleted)");
+		const QString part_name = (issue.part_index < map->getNumParts()) ? map->getPart(std::size_t(issue.part_index))->getName() : QString();
+		issue_table->setItem(row, 0, new QTableWidgetItem(MapQualityCheck::typeName(issue.type)));
+		issue_table->setItem(row, 1, new QTableWidgetItem(symbol_label));
+		issue_table->setItem(row, 2, new QTableWidgetItem(part_name));
+	}
+	
+	const QLocale locale;
+	status_label->setText(tr("%1 issues found in %2 s.")
+	                      .arg(locale.toString(int(issues.size())),
+	                           locale.toString(msecs / 1000.0, 'f', 1)));
+}
+
+std::vector<Object*> QualityCheckWidget::objectsOfIssue(int row) const
+{
+	std::vector<Object*> objects;
+	if (row < 0 || row >= int(issues.size()))
+		return objects;
+	
+	const auto& issue = issues[std::size_t(row)];
+	if (issue.part_index >= map->getNumParts())
+		return objects;
+	
+	const MapPart* part = map->getPart(std::size_t(issue.part_index));
+	const auto& candidates = checked_objects[std::size_t(issue.part_index)];
+	for (int index : { issue.object_index, issue.other_object_index })
+	{
+		if (index >= 0 && part->contains(candidates[std::size_t(index)]))
+			objects.push_back(candidates[std::size_t(index)]);
+	}
+	return objects;
+}
+
+void QualityCheckWidget::currentRowChanged()
+{
+	const int row = issue_table->currentRow();
+	const std::vector<Object*> objects = objectsOfIssue(row);
+	if (objects.empty())
+		return;
+	
+	const auto part_index = std::size_t(issues[std::size_t(row)].part_index);
+	if (map->getCurrentPartIndex() != part_index)
+		map->setCurrentPartIndex(part_index);
+	
+	map->clearObjectSelection(false);
+	for (Object* object : objects)
+		map->addObjectToSelection(object, false);
+	map->emitSelectionChanged();
+	
+	controller->getMainWidget()->ensureVisibilityOfRect(issues[std::size_t(row)].extent, MapWidget::ContinuousZoom);
+}
+
+void QualityCheckWidget::zoomToIssue(int row)
+{
+	if (objectsOfIssue(row).empty())
+		return;
+	
+	// Tiny issues would end up at the maximum zoom.
+	QRectF extent = issues[std::size_t(row)].extent;
+	const qreal margin = qMax(1.0, qMax(extent.width(), extent.height()) / 4);
+	extent.adjust(-margin, -margin, margin, margin);
+	controller->getMainWidget()->adjustViewToRect(extent, MapWidget::ContinuousZoom);
+}
@@ -0,0 +1,100 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_QUALITY_CHECK_WIDGET_H
+#define OPENORIENTEERING_QUALITY_CHECK_WIDGET_H
+
+#include <memory>
+#include <vector>
+
+#include <QWidget>
+
+#include "../../map_quality_check.h"
+
+class QLabel;
+class QPushButton;
+class QTableWidget;
+
+class Map;
+class MapEditorController;
+class Object;
+
+
+/**
+ * @brief A widget which lists the issues found by MapQualityCheck.
+ *
+ * The check runs in a worker thread on a snapshot of the map, so the user
+ * may continue editing. Selecting an issue selects the objects and scrolls
+ * them into view, activating an issue zooms to them. Issues whose objects
+ * were deleted in the meantime are shown, but cannot be selected.
+ *
+ * This widget is used inside a dock widget.
+ */
+class QualityCheckWidget : public QWidget
+{
+Q_OBJECT
+public:
+	/** Constructs a new widget for the map of the given controller. */
+	explicit QualityCheckWidget(Map* map, MapEditorController* controller, QWidget* parent = nullptr);
+	
+	/** Destroys the widget, cancelling a running check. */
+	~QualityCheckWidget() override;
+
+public slots:
+	/** Starts a new check, cancelling a running one. */
+	void startCheck();
+
+protected slots:
+	/** Selects the objects of the current issue. */
+	void currentRowChanged();
+	
+	/** Zooms to the objects of the issue in the given row. */
+	void zoomToIssue(int row);
+
+private:
+	class Job;
+	
+	/** Shows the result of the job. */
+	void finishCheck(const MapQualityCheck& result, qint64 msecs);
+	
+	/** Returns the objects of the issue in the given row which still exist. */
+	std::vector<Object*> objectsOfIssue(int row) const;
+	
+	Map* const map;
+	MapEditorController* const controller;
+	
+	QTableWidget* issue_table;
+	QLabel* status_label;
+	QPushButton* check_button;
+	
+	/** The token of the running check, or nullptr. */
+	std::shared_ptr<TaskPool::CancellationToken> running_check;
+	
+	/** The objects of the map when the running check was started, by part. */
+	std::vector< std::vector<Object*> > pending_objects;
+	
+	/** The objects of the map when the last finished check was started, by part. */
+	std::vector< std::vector<Object*> > checked_objects;
+	
+	/** The issues of the last check. */
+	std::vector<MapQualityCheck::Issue> issues;
+};
+
+#endif
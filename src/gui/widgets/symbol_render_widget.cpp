@@ -41,6 +41,7 @@
 #include "../../symbol.h"
 #include "../../symbol_area.h"
 #include "../../symbol_combined.h"
+#include "../../symbol_icon_renderer.h"
 #include "../../symbol_line.h"
 #include "../../symbol_point.h"
 #include "../../symbol_setting_dialog.h"
@@ -274,6 +275,9 @@ SymbolRenderWidget::SymbolRenderWidget(Map* map, bool mobile_mode, QWidget* pare
 	connect(map, SIGNAL(symbolDeleted(int, const Symbol*)), this, SLOT(symbolDeleted(int, const Symbol*)));
 	connect(map, SIGNAL(symbolChanged(int, const Symbol*, const Symbol*)), this, SLOT(symbolChanged(int, const Symbol*, const Symbol*)));
 	connect(map, SIGNAL(symbolIconChanged(int)), this, SLOT(updateSingleIcon(int)));
+	
+	icon_renderer = new SymbolIconRenderer(map, this);
+	connect(icon_renderer, SIGNAL(iconChanged(int)), this, SLOT(updateSingleIcon(int)));
 }
 
 SymbolRenderWidget::~SymbolRenderWidget()
@@ -497,7 +501,16 @@ void SymbolRenderWidget::drawIcon(QPainter &painter, int i) const
 	painter.save();
 	
 	Symbol* symbol = map->getSymbol(i);
-	painter.drawImage(0, 0, symbol->getIcon(map));
+	const QImage icon = icon_renderer->icon(symbol);
+	if (icon.isNull())
+	{
+		// Placeholder until the icon is rendered in the background
+		painter.drawText(QRect(0, 0, icon_size - 1, icon_size - 1), Qt::AlignCenter, symbol->getNumberAsString());
+	}
+	else
+	{
+		painter.drawImage(0, 0, icon);
+	}
 	
 	if (isSymbolSelected(i) || i == current_symbol_index)
 	{
@@ -1012,7 +1025,7 @@ void SymbolRenderWidget::setSelectedSymbolVisibility(bool checked)
 		Symbol* symbol = map->getSymbol(*it);
 		if (symbol->isHidden() != checked)
 		{
-			symbol->setHidden(checked);
+			map->setSymbolHidden(symbol, checked);
 			updateSingleIcon(*it);
 			if (checked)
 				selection_changed |= map->removeSymbolFromSelection(symbol, false);
@@ -1020,7 +1033,6 @@ void SymbolRenderWidget::setSelectedSymbolVisibility(bool checked)
 	}
 	if (selection_changed)
 		map->emitSelectionChanged();
-	map->updateAllMapWidgets();
 	map->setSymbolsDirty();
 	emitGuarded_selectedSymbolsChanged();
 }
@@ -1032,7 +1044,7 @@ void SymbolRenderWidget::setSelectedSymbolProtection(bool checked)
 		Symbol* symbol = map->getSymbol(*it);
 		if (symbol->isProtected() != checked)
 		{
-			symbol->setProtected(checked);
+			map->setSymbolProtected(symbol, checked);
 			updateSingleIcon(*it);
 			if (checked)
 				selection_changed |= map->removeSymbolFromSelection(symbol, false);
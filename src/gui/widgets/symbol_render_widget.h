@@ -33,8 +33,9 @@ QT_END_NAMESPACE
 
 class Map;
 class Symbol;
-class SymbolToolTip;
 class SymbolIconDecorator;
+class SymbolIconRenderer;
+class SymbolToolTip;
 
 /**
  * @brief Shows all symbols from a map in a size-constrained widget.
@@ -343,6 +344,7 @@ private:
 	QAction* sort_manual_action;
 	
 	SymbolToolTip* tooltip;
+	SymbolIconRenderer* icon_renderer;
 	
 	QScopedPointer<SymbolIconDecorator> hidden_symbol_decoration;
 	QScopedPointer<SymbolIconDecorator> protected_symbol_decoration;
@@ -21,6 +21,8 @@
 
 #include "template_list_widget.h"
 
+#include <algorithm>
+
 #include <QCheckBox>
 #include <QFileDialog>
 #include <QHeaderView>
@@ -38,6 +40,7 @@
 #include "segmented_button_layout.h"
 #include "../main_window.h"
 #include "../../core/georeferencing.h"
+#include "../../core/tile_fetcher.h"
 #include "../../map.h"
 #include "../../map_editor.h"
 #include "../../map_widget.h"
@@ -47,6 +50,7 @@
 #include "../../template_adjust.h"
 #include "../../template_map.h"
 #include "../../template_position_dock_widget.h"
+#include "../../template_tile_server.h"
 #include "../../template_tool_move.h"
 #include "../../util.h"
 #include "../../util/item_delegates.h"
@@ -132,7 +136,7 @@ TemplateListWidget::TemplateListWidget(Map* map, MapView* main_view, MapEditorCo
 	template_table->installEventFilter(this);
 	template_table->setEditTriggers(QAbstractItemView::AllEditTriggers);
 	template_table->setSelectionBehavior(QAbstractItemView::SelectRows);
-	template_table->setSelectionMode(QAbstractItemView::SingleSelection);
+	template_table->setSelectionMode(mobile_mode ? QAbstractItemView::SingleSelection : QAbstractItemView::ExtendedSelection);
 	template_table->verticalHeader()->setVisible(false);
 #ifdef NO_TEMPLATE_GROUP_SUPPORT
 	// Template grouping is not yet implemented.
@@ -178,14 +182,24 @@ TemplateListWidget::TemplateListWidget(Map* map, MapView* main_view, MapEditorCo
 	auto percentage_delegate = new PercentageDelegate(this, 5);
 	template_table->setItemDelegateForColumn(1, percentage_delegate);
 	
+	// Resizing to contents would measure all rows after each change.
 	for (int i = 1; i < 3; ++i)
-		header_view->setSectionResizeMode(i, QHeaderView::ResizeToContents);
+		header_view->setSectionResizeMode(i, QHeaderView::Fixed);
 	header_view->setSectionResizeMode(name_column, QHeaderView::Stretch);
 	header_view->setSectionsClickable(false);
 	
 	for (int i = 0; i < map->getNumTemplates() + 1; ++i)
 		addRowItems(i);
 	
+	template_table->resizeColumnToContents(1);
+	auto opacity_width = template_table->fontMetrics().width(percentage_delegate->displayText(1.0f, locale()))
+	                     + style()->pixelMetric(QStyle::PM_SmallIconSize)
+	                     + 4 * (style()->pixelMetric(QStyle::PM_FocusFrameHMargin) + 1);
+	template_table->setColumnWidth(1, qMax(template_table->columnWidth(1), opacity_width));
+	template_table->resizeColumnToContents(2);
+	for (int i = 0; i < map->getNumTemplates(); ++i)
+		connect(map->getTemplate(i), &Template::templateStateChanged, this, &TemplateListWidget::templateStateChanged, Qt::UniqueConnection);
+	
 	all_templates_layout = new QVBoxLayout();
 	all_templates_layout->setMargin(0);
 	all_templates_layout->addWidget(top_bar_widget);
@@ -241,6 +255,7 @@ TemplateListWidget::TemplateListWidget(Map* map, MapView* main_view, MapEditorCo
 	position_action = edit_menu->addAction(tr("Positioning..."));
 	position_action->setCheckable(true);
 	import_action =  edit_menu->addAction(tr("Import and remove"), this, SLOT(importClicked()));
+	prefetch_action = edit_menu->addAction(tr("Download for offline use..."), this, SLOT(prefetchClicked()));
 	
 	edit_button = newToolButton(QIcon(":/images/settings.png"), MapEditorController::tr("&Edit").remove(QChar('&')));
 	edit_button->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
@@ -442,7 +457,10 @@ bool TemplateListWidget::eventFilter(QObject* watched, QEvent* event)
 				if (row >= 0 && template_table->item(row, 1)->flags().testFlag(Qt::ItemIsEnabled))
 				{
 					bool is_checked = template_table->item(row, 0)->checkState() != Qt::Unchecked;
-					template_table->item(row, 0)->setCheckState(is_checked ? Qt::Unchecked : Qt::Checked);
+					auto rows = selectedRows();
+					if (std::find(begin(rows), end(rows), row) == end(rows))
+						rows = { row };
+					setRowsVisible(rows, !is_checked);
 				}
 				return true;
 			}
@@ -667,18 +685,11 @@ void TemplateListWidget::cellChange(int row, int column)
 				bool visible = template_table->item(row, column)->checkState() == Qt::Checked;
 				if (visibility->visible != visible)
 				{
-					if (!visible)
-					{
-						setAreaDirty();
-						visibility->visible = false;
-					}
-					else
-					{
-						visibility->visible = true;
-						setAreaDirty();
-					}
-					updateRow(row);
-					updateButtons();
+					// Toggling a selected row applies to all selected rows.
+					auto rows = selectedRows();
+					if (std::find(begin(rows), end(rows), row) == end(rows))
+						rows = { row };
+					setRowsVisible(rows, visible);
 				}
 			}
 			break;
@@ -721,6 +732,60 @@ void TemplateListWidget::cellChange(int row, int column)
 	}
 }
 
+void TemplateListWidget::setRowsVisible(const std::vector<int>& rows, bool visible)
+{
+	std::vector<int> changed_rows;
+	std::vector<int> changed_positions;
+	std::vector<TemplateVisibility*> changed_visibilities;
+	for (int row : rows)
+	{
+		int pos = posFromRow(row);
+		auto visibility = main_view->getMapVisibility();
+		if (pos >= 0)
+		{
+			Template* temp = map->getTemplate(pos);
+			if (temp->getTemplateState() == Template::Invalid)
+				continue;
+			visibility = main_view->getTemplateVisibility(temp);
+		}
+		if (visibility->visible == visible)
+			continue;
+		
+		changed_rows.push_back(row);
+		changed_positions.push_back(pos);
+		changed_visibilities.push_back(visibility);
+	}
+	if (changed_rows.empty())
+		return;
+	
+	// The template area must be marked dirty while the templates are visible.
+	if (!visible)
+		map->setTemplateAreaDirty(changed_positions);
+	for (auto visibility : changed_visibilities)
+		visibility->visible = visible;
+	if (visible)
+		map->setTemplateAreaDirty(changed_positions);
+	
+	if (std::find(begin(changed_positions), end(changed_positions), -1) != end(changed_positions))
+		main_view->updateAllMapWidgets();  // Map change - doesn't need to update the map cache
+	
+	for (int row : changed_rows)
+		updateRow(row);
+	updateButtons();
+}
+
+std::vector<int> TemplateListWidget::selectedRows()
+{
+	std::vector<int> rows;
+	for (auto&& item : template_table->selectedItems())
+	{
+		const int row = item->row();
+		if (std::find(begin(rows), end(rows), row) == end(rows))
+			rows.push_back(row);
+	}
+	return rows;
+}
+
 void TemplateListWidget::updateButtons()
 {
 	bool map_row_selected = false;  // does the selection contain the map row?
@@ -759,6 +824,7 @@ void TemplateListWidget::updateButtons()
 	bool custom_visible = false;
 	bool custom_active  = false;
 	bool import_active  = false;
+	bool prefetch_active = false;
 	if (mobile_mode)
 	{
 		// Leave most buttons invisible
@@ -778,6 +844,7 @@ void TemplateListWidget::updateButtons()
 			custom_active = template_table->item(visited_row, 0)->checkState() == Qt::Checked;
 		}
 		import_active = qobject_cast<TemplateMap*>(getCurrentTemplate());
+		prefetch_active = qobject_cast<TemplateTileServer*>(getCurrentTemplate()) && TileFetcher::isSupported();
 	}
 	else if (single_row_selected)
 	{
@@ -794,6 +861,7 @@ void TemplateListWidget::updateButtons()
 	position_action->setEnabled(custom_active);
 	position_action->setVisible(custom_visible);
 	import_action->setVisible(import_active);
+	prefetch_action->setVisible(prefetch_active);
 	
 /*	if (enable_active_buttons)
 	{
@@ -966,6 +1034,38 @@ void TemplateListWidget::importClicked()
 	}
 }
 
+void TemplateListWidget::prefetchClicked()
+{
+	TemplateTileServer* templ = qobject_cast< TemplateTileServer* >(getCurrentTemplate());
+	if (!templ || templ->getTemplateState() != Template::Loaded)
+		return;
+	
+	// The area shown in the main map widget
+	const MapWidget* widget = controller->getMainWidget();
+	const QRect rect = widget->rect();
+	QRectF area;
+	for (const auto& corner : { rect.topLeft(), rect.topRight(), rect.bottomLeft(), rect.bottomRight() })
+		rectIncludeSafe(area, widget->viewportToMapF(corner));
+	
+	const int current_zoom = templ->zoomForResolution(main_view->calculateFinalZoomFactor());
+	bool ok = false;
+	const int max_zoom = QInputDialog::getInt( window(),
+	  tr("Download for offline use"),
+	  tr("Download the tiles of the visible area up to zoom level:"),
+	  qMin(current_zoom + 2, templ->getMaxZoom()), 0, templ->getMaxZoom(), 1, &ok );
+	if (!ok)
+		return;
+	
+	const qint64 num_tiles = templ->countTiles(area, max_zoom);
+	if (QMessageBox::question( window(),
+	      tr("Download for offline use"),
+	      tr("Up to %1 tiles will be downloaded. Continue?").arg(locale().toString(num_tiles)),
+	      QMessageBox::Yes | QMessageBox::No ) != QMessageBox::Yes)
+		return;
+	
+	templ->prefetch(area, max_zoom);
+}
+
 void TemplateListWidget::moreActionClicked(QAction* action)
 {
 	Q_UNUSED(action);
@@ -974,11 +1074,19 @@ void TemplateListWidget::moreActionClicked(QAction* action)
 
 void TemplateListWidget::templateAdded(int pos, const Template* temp)
 {
-	Q_UNUSED(temp);
 	int row = rowFromPos(pos);
 	template_table->insertRow(row);
 	addRowItems(row);
 	template_table->setCurrentCell(row, 0);
+	connect(temp, &Template::templateStateChanged, this, &TemplateListWidget::templateStateChanged, Qt::UniqueConnection);
+}
+
+void TemplateListWidget::templateStateChanged()
+{
+	// Closed templates are not in the list.
+	int pos = map->findTemplateIndex(qobject_cast<Template*>(sender()));
+	if (pos >= 0)
+		updateRow(rowFromPos(pos));
 }
 
 void TemplateListWidget::templatePositionDockWidgetClosed(Template* temp)
@@ -1011,6 +1119,7 @@ void TemplateListWidget::updateRow(int row)
 	QString name;
 	QString path;
 	bool valid = true;
+	bool loading = false;
 	
 	TemplateVisibility* vis = nullptr;
 	
@@ -1028,6 +1137,9 @@ void TemplateListWidget::updateRow(int row)
 		name = temp->getTemplateFilename();
 		path = temp->getTemplatePath();
 		valid = temp->getTemplateState() != Template::Invalid;
+		loading = temp->getTemplateState() == Template::Loading;
+		if (loading)
+			name = tr("%1 (loading...)").arg(name);
 		/// @todo Get visibility values from the MapView of the active MapWidget (instead of always main_view)
 		vis = main_view->getTemplateVisibility(temp);
 	}
@@ -1087,6 +1199,12 @@ void TemplateListWidget::updateRow(int row)
 		enabled = Qt::NoItemFlags;
 	}
 	
+	if (loading)
+	{
+		// Placeholder until the template appears
+		text_color = QPalette().color(QPalette::Disabled, QPalette::Foreground);
+	}
+	
 	auto foreground = QBrush(text_color);
 	auto background = QBrush(background_color);
 	
@@ -22,6 +22,7 @@
 #define _OPENORIENTEERING_TEMPLATE_LIST_WIDGET_H_
 
 #include <memory>
+#include <vector>
 
 #include <QWidget>
 
@@ -93,9 +94,11 @@ protected slots:
 	//void groupClicked();
 	void positionClicked(bool checked);
 	void importClicked();
+	void prefetchClicked();
 	void moreActionClicked(QAction* action);
 	
 	void templateAdded(int pos, const Template* temp);
+	void templateStateChanged();
 	void templatePositionDockWidgetClosed(Template* temp);
 	
 	void changeTemplateFile(int pos);
@@ -105,6 +108,18 @@ protected slots:
 private:
 	void addRowItems(int row);
 	void updateRow(int row);
+	
+	/**
+	 * Shows or hides the templates (or the map) of the given rows.
+	 * 
+	 * The affected area of all templates is invalidated at once.
+	 * Rows of invalid templates are not changed.
+	 */
+	void setRowsVisible(const std::vector<int>& rows, bool visible);
+	
+	/** Returns the rows which have at least one selected item. */
+	std::vector<int> selectedRows();
+	
 	int posFromRow(int row);
 	int rowFromPos(int pos);
 	Template* getCurrentTemplate();
@@ -123,6 +138,7 @@ private:
 	QAction* move_by_hand_action;
 	QAction* position_action;
 	QAction* import_action;
+	QAction* prefetch_action;
 	
 	// Buttons
 	QWidget* list_buttons_group;
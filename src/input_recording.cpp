@@ -0,0 +1,305 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "input_recording.h"
+
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QIODevice>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QStringList>
+#include <QTextStream>
+#include <QUrl>
+#include <QWheelEvent>
+
+#include "map_widget.h"
+#include "core/map_view.h"
+
+
+namespace
+{
+	/** The first line of the file format. */
+	const char* const file_header = "# OpenOrienteering Mapper input recording 1";
+	
+	/** Encodes a string as a single field without spaces. */
+	QString encoded(const QString& string)
+	{
+		return QString::fromLatin1(QUrl::toPercentEncoding(string));
+	}
+	
+	QString decoded(const QString& field)
+	{
+		return QUrl::fromPercentEncoding(field.toLatin1());
+	}
+}
+
+
+
+// ### InputRecording ###
+
+InputRecording::InputRecording()
+ : symbol_index(-1)
+ , view_zoom(1.0)
+ , view_rotation(0.0)
+{
+	; // nothing
+}
+
+void InputRecording::begin(const MapWidget& widget)
+{
+	events.clear();
+	widget_size = widget.size();
+	if (const MapView* view = widget.getMapView())
+	{
+		view_center = view->center();
+		view_zoom = view->getZoom();
+		view_rotation = view->getRotation();
+	}
+	clock.start();
+}
+
+void InputRecording::record(const QEvent* event)
+{
+	Event recorded = { clock.isValid() ? clock.elapsed() : 0, event->type(), QPoint(), Qt::NoButton, Qt::NoButton, Qt::NoModifier, 0, QString(), 0 };
+	switch (event->type())
+	{
+	case QEvent::MouseButtonPress:
+	case QEvent::MouseButtonRelease:
+	case QEvent::MouseButtonDblClick:
+	case QEvent::MouseMove:
+		{
+			const QMouseEvent* mouse_event = static_cast<const QMouseEvent*>(event);
+			recorded.pos = mouse_event->pos();
+			recorded.button = mouse_event->button();
+			recorded.buttons = mouse_event->buttons();
+			recorded.modifiers = mouse_event->modifiers();
+		}
+		break;
+	
+	case QEvent::Wheel:
+		{
+			const QWheelEvent* wheel_event = static_cast<const QWheelEvent*>(event);
+			if (wheel_event->orientation() != Qt::Vertical)
+				return;
+			recorded.pos = wheel_event->pos();
+			recorded.buttons = wheel_event->buttons();
+			recorded.modifiers = wheel_event->modifiers();
+			recorded.delta = wheel_event->delta();
+		}
+		break;
+	
+	case QEvent::KeyPress:
+	case QEvent::KeyRelease:
+		{
+			const QKeyEvent* key_event = static_cast<const QKeyEvent*>(event);
+			recorded.modifiers = key_event->modifiers();
+			recorded.key = key_event->key();
+			recorded.text = key_event->text();
+		}
+		break;
+	
+	default:
+		return;
+	}
+	events.push_back(recorded);
+}
+
+bool InputRecording::write(QIODevice* device) const
+{
+	QTextStream stream(device);
+	stream << file_header << '\n'
+	       << "map " << encoded(map_path) << '\n'
+	       << "tool " << encoded(tool_name) << '\n'
+	       << "symbol " << symbol_index << '\n'
+	       << "view " << widget_size.width() << ' ' << widget_size.height() << ' '
+	       << view_center.nativeX() << ' ' << view_center.nativeY() << ' '
+	       << QString::number(view_zoom, 'g', 17) << ' ' << QString::number(view_rotation, 'g', 17) << '\n';
+	
+	// time type x y button buttons modifiers key delta text
+	for (const auto& event : events)
+	{
+		stream << event.time << ' ' << int(event.type) << ' '
+		       << event.pos.x() << ' ' << event.pos.y() << ' '
+		       << int(event.button) << ' ' << int(event.buttons) << ' ' << int(event.modifiers) << ' '
+		       << event.key << ' ' << event.delta << ' ' << encoded(event.text) << '\n';
+	}
+	
+	stream.flush();
+	return stream.status() == QTextStream::Ok;
+}
+
+bool InputRecording::read(QIODevice* device)
+{
+	QTextStream stream(device);
+	if (stream.readLine() != QLatin1String(file_header))
+		return false;
+	
+	InputRecording recording;
+	for (int i = 0; i < 4; ++i)
+	{
+		const QStringList fields = stream.readLine().split(QLatin1Char(' '));
+		if (fields.size() < 2)
+			return false;
+		
+		bool ok = true;
+		if (fields[0] == QLatin1String("map"))
+			recording.map_path = decoded(fields[1]);
+		else if (fields[0] == QLatin1String("tool"))
+			recording.tool_name = decoded(fields[1]);
+		else if (fields[0] == QLatin1String("symbol"))
+			recording.symbol_index = fields[1].toInt(&ok);
+		else if (fields[0] == QLatin1String("view") && fields.size() == 7)
+		{
+			bool values_ok[6];
+			recording.widget_size = QSize(fields[1].toInt(&values_ok[0]), fields[2].toInt(&values_ok[1]));
+			recording.view_center = MapCoord::fromNative(fields[3].toInt(&values_ok[2]), fields[4].toInt(&values_ok[3]));
+			recording.view_zoom = fields[5].toDouble(&values_ok[4]);
+			recording.view_rotation = fields[6].toDouble(&values_ok[5]);
+			ok = std::all_of(values_ok, values_ok + 6, [](bool value) { return value; });
+		}
+		else
+			ok = false;
+		
+		if (!ok)
+			return false;
+	}
+	
+	while (!stream.atEnd())
+	{
+		const QString line = stream.readLine();
+		if (line.isEmpty())
+			continue;
+		
+		const QStringList fields = line.split(QLatin1Char(' '));
+		if (fields.size() != 10)
+			return false;
+		
+		bool ok[9];
+		Event event;
+		event.time = fields[0].toLongLong(&ok[0]);
+		event.type = QEvent::Type(fields[1].toInt(&ok[1]));
+		event.pos = QPoint(fields[2].toInt(&ok[2]), fields[3].toInt(&ok[3]));
+		event.button = Qt::MouseButton(fields[4].toInt(&ok[4]));
+		event.buttons = Qt::MouseButtons(fields[5].toInt(&ok[5]));
+		event.modifiers = Qt::KeyboardModifiers(fields[6].toInt(&ok[6]));
+		event.key = fields[7].toInt(&ok[7]);
+		event.delta = fields[8].toInt(&ok[8]);
+		event.text = decoded(fields[9]);
+		if (!std::all_of(ok, ok + 9, [](bool value) { return value; }))
+			return false;
+		
+		recording.events.push_back(event);
+	}
+	
+	if (stream.status() != QTextStream::Ok)
+		return false;
+	
+	*this = recording;
+	return true;
+}
+
+std::vector<InputRecording::Latency> InputRecording::replay(MapWidget* widget) const
+{
+	widget->resize(widget_size);
+	if (MapView* view = widget->getMapView())
+	{
+		view->setZoom(view_zoom);
+		view->setRotation(view_rotation);
+		view->setCenter(view_center);
+	}
+	// Don't measure the initial painting.
+	QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+	
+	std::vector<Latency> latencies;
+	latencies.reserve(events.size());
+	QElapsedTimer timer;
+	for (const auto& event : events)
+	{
+		Latency latency = { event.type, 0, 0 };
+		timer.start();
+		switch (event.type)
+		{
+		case QEvent::MouseButtonPress:
+		case QEvent::MouseButtonRelease:
+		case QEvent::MouseButtonDblClick:
+		case QEvent::MouseMove:
+			{
+				QMouseEvent mouse_event(event.type, event.pos, widget->mapToGlobal(event.pos), event.button, event.buttons, event.modifiers);
+				QCoreApplication::sendEvent(widget, &mouse_event);
+			}
+			break;
+		
+		case QEvent::Wheel:
+			{
+				QWheelEvent wheel_event(event.pos, widget->mapToGlobal(event.pos), event.delta, event.buttons, event.modifiers, Qt::Vertical);
+				QCoreApplication::sendEvent(widget, &wheel_event);
+			}
+			break;
+		
+		case QEvent::KeyPress:
+			{
+				QKeyEvent key_event(event.type, event.key, event.modifiers, event.text);
+				widget->keyPressEventFilter(&key_event);
+			}
+			break;
+		
+		case QEvent::KeyRelease:
+			{
+				QKeyEvent key_event(event.type, event.key, event.modifiers, event.text);
+				widget->keyReleaseEventFilter(&key_event);
+			}
+			break;
+		
+		default:
+			continue;
+		}
+		latency.processing_time = timer.nsecsElapsed();
+		
+		// Deliver the update requests resulting from the event.
+		timer.start();
+		QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+		latency.repaint_time = timer.nsecsElapsed();
+		
+		latencies.push_back(latency);
+	}
+	return latencies;
+}
+
+std::vector<qint64> InputRecording::totalTimes(const std::vector<Latency>& latencies)
+{
+	std::vector<qint64> times;
+	times.reserve(latencies.size());
+	for (const auto& latency : latencies)
+		times.push_back(latency.processing_time + latency.repaint_time);
+	return times;
+}
+
+qint64 InputRecording::percentile(std::vector<qint64> values, int percent)
+{
+	if (values.empty())
+		return 0;
+	
+	const std::size_t rank = (values.size() * std::size_t(qBound(0, percent, 100)) + 99) / 100;
+	const auto nth = values.begin() + (rank > 0 ? rank - 1 : 0);
+	std::nth_element(values.begin(), nth, values.end());
+	return *nth;
+}
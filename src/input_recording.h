@@ -0,0 +1,184 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_INPUT_RECORDING_H_
+#define _OPENORIENTEERING_INPUT_RECORDING_H_
+
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QPoint>
+#include <QSize>
+#include <QString>
+
+#include "core/map_coord.h"
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+class MapWidget;
+
+
+/**
+ * A recording of the input events of a MapWidget, for measuring the latency
+ * of the editing tools.
+ *
+ * While a recording is set on a MapWidget, the widget adds its mouse, wheel
+ * and key events by calling record(). The positions are recorded in viewport
+ * coordinates. The size of the widget and the state of the view are recorded
+ * at the start, so that a replay with the same state hits the same objects.
+ * The tool and the symbol which were active at the start are recorded by
+ * their class name and by their index in the map, respectively.
+ *
+ * replay() sends the events to a MapWidget as fast as possible. For each
+ * event, it measures the time for processing the event, i.e. mostly the
+ * tool's event handler, and the time for the repaint caused by the event.
+ *
+ * Synopsis:
+ *
+ * InputRecording recording;
+ * recording.begin(*map_widget);
+ * map_widget->setInputRecording(&recording);
+ * ... // Interact with the map widget.
+ * map_widget->setInputRecording(nullptr);
+ * recording.write(&file);
+ *
+ * auto latencies = recording.replay(other_map_widget);
+ * auto p95 = InputRecording::percentile(InputRecording::totalTimes(latencies), 95);
+ */
+class InputRecording
+{
+public:
+	/** A recorded input event. */
+	struct Event
+	{
+		/** The time of the event, in milliseconds since the start of the recording. */
+		qint64 time;
+		
+		/** The type of the event: mouse, wheel or key event. */
+		QEvent::Type type;
+		
+		/** The position of mouse and wheel events, in viewport coordinates. */
+		QPoint pos;
+		
+		/** The button which caused a mouse event. */
+		Qt::MouseButton button;
+		
+		/** The state of the mouse buttons. */
+		Qt::MouseButtons buttons;
+		
+		/** The state of the keyboard modifiers. */
+		Qt::KeyboardModifiers modifiers;
+		
+		/** The key of key events. */
+		int key;
+		
+		/** The text of key events. */
+		QString text;
+		
+		/** The angle of wheel events, in eighths of a degree. */
+		int delta;
+	};
+	
+	/** The time needed for a replayed event. */
+	struct Latency
+	{
+		/** The type of the event. */
+		QEvent::Type type;
+		
+		/** The time for processing the event, in nanoseconds. */
+		qint64 processing_time;
+		
+		/** The time for repainting after the event, in nanoseconds. */
+		qint64 repaint_time;
+	};
+	
+	
+	/** Constructs an empty recording. */
+	InputRecording();
+	
+	/**
+	 * Clears the events, records the widget size and the view state,
+	 * and starts the clock for the event times.
+	 */
+	void begin(const MapWidget& widget);
+	
+	/** Adds the event if it is a mouse, wheel or key event. */
+	void record(const QEvent* event);
+	
+	
+	/** Writes the recording in a line-based text format. Returns false on error. */
+	bool write(QIODevice* device) const;
+	
+	/** Reads a recording which was written by write(). Returns false on error. */
+	bool read(QIODevice* device);
+	
+	
+	/**
+	 * Sends the recorded events to the widget, and measures the latencies.
+	 *
+	 * The widget is resized to the recorded size, and its view is set to
+	 * the recorded state. Setting up the tool and the symbol is up to the
+	 * caller. The widget should be visible, so that it is actually repainted.
+	 * Key events are sent to MapWidget::keyPressEventFilter() and
+	 * MapWidget::keyReleaseEventFilter(), like in the map editor.
+	 */
+	std::vector<Latency> replay(MapWidget* widget) const;
+	
+	/** Returns the sums of the processing and repainting times. */
+	static std::vector<qint64> totalTimes(const std::vector<Latency>& latencies);
+	
+	/**
+	 * Returns the given percentile (nearest rank) of the values,
+	 * or 0 if there are no values.
+	 */
+	static qint64 percentile(std::vector<qint64> values, int percent);
+	
+	
+	/** The path of the map when recording, for information. */
+	QString map_path;
+	
+	/** The class name of the active tool at the start. */
+	QString tool_name;
+	
+	/** The index of the active symbol at the start, or -1. */
+	int symbol_index;
+	
+	/** The size of the widget. */
+	QSize widget_size;
+	
+	/** The center of the view at the start. */
+	MapCoord view_center;
+	
+	/** The zoom of the view at the start. */
+	double view_zoom;
+	
+	/** The rotation of the view at the start. */
+	double view_rotation;
+	
+	/** The recorded events. */
+	std::vector<Event> events;
+
+private:
+	QElapsedTimer clock;
+};
+
+#endif
@@ -26,6 +26,10 @@
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#define MMAP_AVAILABLE
+#endif
 
 #include "libocad.h"
 
@@ -170,10 +174,6 @@ int ocad_file_open(OCADFile **pfile, const char *filename) {
 	file->size = fs.st_size;
 	file->reserved_size = file->size;
 
-#ifdef MMAP_AVAILABLE
-	file->buffer = mmap(NULL, file->size, PROT_READ | PROT_WRITE, 0, file->fd, 0);
-	if (file->buffer == NULL || file->buffer == MAP_FAILED) { err = -4; goto ocad_file_open_1; }
-#else
 	file->mapped = FALSE;
 	file->buffer = malloc(file->size);
 	if (file->buffer == NULL) { err = -1; goto ocad_file_open_1; }
@@ -184,7 +184,6 @@ int ocad_file_open(OCADFile **pfile, const char *filename) {
 		if (got <= 0) { fprintf(stderr,"got=%d sz=%d\n",got,file->size);err = -4; goto ocad_file_open_1; }
 		p += got; left -= got;
 	}
-#endif
 
 	file->header = (OCADFileHeader *)file->buffer;
 	file->colors = (OCADColor *)(file->buffer + 0x48);
@@ -201,7 +200,47 @@ ocad_file_open_0:
 }
 
 int ocad_file_open_mapped(OCADFile **pfile, const char *filename) {
+#ifdef MMAP_AVAILABLE
+	struct stat fs;
+	int err = 0;
+	void *map;
+	dword offs;
+	OCADFile *file = *pfile;
+	if (file == NULL) {
+		file = (OCADFile *)malloc(sizeof(OCADFile));
+		if (file == NULL) return -1;
+	}
+	memset(file, 0, sizeof(OCADFile));
+	file->filename = (const char *)my_strdup(filename);
+	file->fd = open(file->filename, O_RDONLY | O_BINARY);
+	if (file->fd <= 0) { err = -2; goto ocad_file_open_mapped_1; }
+	if (fstat(file->fd, &fs) < 0) { err = -3; goto ocad_file_open_mapped_1; }
+	if (fs.st_size < (off_t)sizeof(OCADFileHeader)) { err = -4; goto ocad_file_open_mapped_1; }
+	file->size = fs.st_size;
+	file->reserved_size = file->size;
+
+	// A private mapping: changes of the buffer are never written to the file.
+	map = mmap(NULL, file->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file->fd, 0);
+	if (map == MAP_FAILED) { err = -4; goto ocad_file_open_mapped_1; }
+	file->buffer = (u8 *)map;
+	file->mapped = TRUE;
+
+	file->header = (OCADFileHeader *)file->buffer;
+	file->colors = (OCADColor *)(file->buffer + 0x48);
+	offs = file->header->osetup;
+	if (offs > 0) file->setup = (OCADSetup *)(file->buffer + offs);
+
+	*pfile = file;
+	goto ocad_file_open_mapped_0;
+
+ocad_file_open_mapped_1:
+	ocad_file_close(file);
+	if (*pfile == NULL) free(file);
+ocad_file_open_mapped_0:
+	return err;
+#else
 	return -10;
+#endif
 }
 
 int ocad_file_open_memory(OCADFile **pfile, u8* buffer, u32 size) {
@@ -228,12 +267,21 @@ int ocad_file_open_memory(OCADFile **pfile, u8* buffer, u32 size) {
 	return 0;
 }
 
-int ocad_file_close(OCADFile *pfile) {
+/** Releases the buffer of the file, which may be mapped.
+ */
+static void ocad_file_release_buffer(OCADFile *pfile) {
+	if (pfile->buffer == NULL) return;
 #ifdef MMAP_AVAILABLE
-	if (pfile->buffer) munmap(pfile->buffer, pfile->size);
-#else
-	if (pfile->buffer) free(pfile->buffer);
+	if (pfile->mapped) munmap(pfile->buffer, pfile->reserved_size);
+	else
 #endif
+	free(pfile->buffer);
+	pfile->buffer = NULL;
+	pfile->mapped = FALSE;
+}
+
+int ocad_file_close(OCADFile *pfile) {
+	ocad_file_release_buffer(pfile);
 	if (pfile->fd) close(pfile->fd);
 	if (pfile->filename) free((void *)pfile->filename);
 	return 0;
@@ -241,7 +289,7 @@ int ocad_file_close(OCADFile *pfile) {
 
 int ocad_file_save(OCADFile *pfile) {
 	if (pfile->mapped) {
-		// FIXME: sync the memory map
+		// The mapping is private, and the file must not be truncated while it is mapped.
 		return -10;
 	}
 	return ocad_file_save_as(pfile, pfile->filename);
@@ -322,6 +370,8 @@ int ocad_file_reserve(OCADFile *file, int amount) {
 	u32 old_reserved_size = file->reserved_size;
 	if (file->reserved_size - file->size >= amount)
 		return 0;
+	if (file->mapped)
+		return -1; // A mapped buffer cannot grow.
 	
 	u32 header_offset = (u8*)file->header - file->buffer;
 	u32 colors_offset = (u8*)file->colors - file->buffer;
@@ -398,9 +448,10 @@ int ocad_file_compact(OCADFile *pfile) {
 	p = b.p;
 	pnew->size = (p - dest);
 	fprintf(stderr, "Compaction changed size from %x to %x\n", pfile->size, pnew->size);
-	free(pfile->buffer);
+	ocad_file_release_buffer(pfile);
 	pfile->buffer = pnew->buffer;
 	pfile->size = pnew->size;
+	pfile->reserved_size = pnew->reserved_size;
 	pfile->header = pnew->header;
 	pfile->colors = pnew->colors;
 	pfile->setup = pnew->setup;
@@ -718,6 +718,9 @@ int ocad_file_open(OCADFile **pfile, const char *filename);
 /** Behaves exactly like ocad_file_open(), except that the system attempts to open the file via memory
  *  mapping.
  *
+ *  The mapping is private: changes of the buffer are not written to the file. The buffer cannot grow,
+ *  and ocad_file_save() fails. This is meant for reading large files without copying them.
+ *
  *  Returns 0 on success, one of the error codes returned by ocad_file_open(), or one of the following:<ul>
  *     <li>OCAD_MMAP_NOT_SUPPORTED: Memory mapping is not supported with this combination of system and libraries.
  * </ul>
@@ -948,6 +951,14 @@ int ocad_object_remove(OCADFile *pfile, OCADObjectEntry *entry);
 bool ocad_object_entry_iterate(OCADFile *pfile, OCADObjectEntryCallback callback, void *param);
 
 
+/** Iterates over the object entries whose bounding rectangle intersects the given rectangle.
+ *  Only the rectangles in the object index blocks are tested, so the objects of the other
+ *  entries are not touched. Like ocad_object_entry_iterate(), returns FALSE if the callback
+ *  stopped the iteration, TRUE otherwise.
+ */
+bool ocad_object_entry_iterate_rect(OCADFile *pfile, const OCADRect *rect, OCADObjectEntryCallback callback, void *param);
+
+
 /** Returns a pointer to the object in the specified location within the index block, or NULL if there
  *  is no such object.
  */
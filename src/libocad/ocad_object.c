@@ -154,6 +154,20 @@ bool ocad_object_entry_iterate(OCADFile *pfile, OCADObjectEntryCallback callback
 	return TRUE;
 }
 
+bool ocad_object_entry_iterate_rect(OCADFile *pfile, const OCADRect *rect, OCADObjectEntryCallback callback, void *param) {
+	OCADObjectIndex *idx;
+	for (idx = ocad_objidx_first(pfile); idx != NULL; idx = ocad_objidx_next(pfile, idx)) {
+		int i;
+		for (i = 0; i < 256; i++) {
+			OCADObjectEntry *entry = ocad_object_entry_at(pfile, idx, i);
+			if (entry != NULL && entry->ptr && entry->symbol && ocad_rect_intersects(&(entry->rect), rect)) {
+				if (!callback(param, pfile, entry)) return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
 OCADObject *ocad_object_at(OCADFile *pfile, OCADObjectIndex *current, int index) {
 	OCADObjectEntry *entry = ocad_object_entry_at(pfile, current, index);
 	dword offs;
@@ -302,10 +302,10 @@ void ocad_rect_union(OCADRect *r1, const OCADRect *r2) {
 	if (y3 < y1) y1 = y3;
 	if (x4 > x2) x2 = x4;
 	if (y4 > y2) y2 = y4;
-	r1->min.x = (r1->min.x & 0xff) | (x1 << 8);
-	r1->max.y = (r1->min.y & 0xff) | (y1 << 8);
-	r1->min.x = (r1->max.x & 0xff) | (x2 << 8);
-	r1->max.y = (r1->max.y & 0xff) | (y2 << 8);
+	r1->min.x = (r1->min.x & 0xff) | x1;
+	r1->min.y = (r1->min.y & 0xff) | y1;
+	r1->max.x = (r1->max.x & 0xff) | x2;
+	r1->max.y = (r1->max.y & 0xff) | y2;
 }
 
 
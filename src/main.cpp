@@ -19,11 +19,20 @@
  */
 
 
+#include <cstdio>
+#include <initializer_list>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <QLibraryInfo>
 #include <QLocale>
 #include <QSettings>
 #include <QStyle>
 #include <QStyleFactory>
+#include <QThread>
 #include <QTranslator>
 
 #ifdef Q_OS_ANDROID
@@ -44,20 +53,198 @@
 #endif
 
 #include "global.h"
+#include "core/batch_exporter.h"
 #include "gui/home_screen_controller.h"
 #include "gui/main_window.h"
 #include "gui/widgets/mapper_proxystyle.h"
+#include "map.h"
+#include "map_part.h"
+#include "memory_usage.h"
 #include "settings.h"
+#include "startup_timer.h"
+#include "template.h"
 #include "util_translation.h"
 #include "util/recording_translator.h"
 
+#ifndef Q_OS_ANDROID
+/**
+ * Loads the given map files and all their templates, and prints the memory
+ * usage of each map to stdout. Arguments starting with '-' are ignored.
+ * 
+ * Returns the exit code for main().
+ */
+int printMemoryReports(const QStringList& args)
+{
+	int result = 0;
+	for (const auto& arg : args)
+	{
+		if (arg.startsWith(QLatin1Char('-')))
+			continue;
+		
+		Map map;
+		if (!map.loadFrom(arg, nullptr, nullptr, false, false))
+		{
+			std::fprintf(stderr, "Cannot load '%s'.\n", qPrintable(arg));
+			result = 1;
+			continue;
+		}
+		
+		for (int i = 0; i < map.getNumParts(); ++i)
+			map.getPart(i)->ensureLoaded();
+		
+		const QString map_directory = QFileInfo(arg).absolutePath();
+		for (int i = 0; i < map.getNumTemplates(); ++i)
+		{
+			Template* temp = map.getTemplate(i);
+			if (temp->getTemplateState() != Template::Loaded)
+				temp->tryToFindAndReloadTemplateFile(map_directory);
+		}
+		
+		std::printf("%s\n%s\n\n", qPrintable(arg), qPrintable(MemoryUsage::measure(map).toText()));
+	}
+	return result;
+}
+#endif
+
+#if !defined(Q_OS_ANDROID) && defined(QT_PRINTSUPPORT_LIB)
+/**
+ * Exports the map files given on the command line, without showing any
+ * window, and prints the time taken for each map to stdout.
+ * Run "Mapper --export --help" for the options.
+ * 
+ * Returns the exit code for main().
+ */
+int exportMaps(const QCoreApplication& app)
+{
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QString::fromLatin1("Exports maps without user interaction."));
+	parser.addHelpOption();
+	QCommandLineOption export_option(QString::fromLatin1("export"), QString::fromLatin1("Exports the given maps instead of opening them."));
+	QCommandLineOption format_option(QString::fromLatin1("format"), QString::fromLatin1("The output format: pdf, separations, png, bmp, tif or jpg. The default is determined by --output, or pdf."), QString::fromLatin1("format"));
+	QCommandLineOption output_option(QString::fromLatin1("output"), QString::fromLatin1("The output file, for a single map."), QString::fromLatin1("file"));
+	QCommandLineOption output_dir_option(QString::fromLatin1("output-dir"), QString::fromLatin1("The output directory. The default is the directory of each map."), QString::fromLatin1("directory"));
+	QCommandLineOption area_option(QString::fromLatin1("area"), QString::fromLatin1("The map area to be exported, in mm. The default is the map's print area."), QString::fromLatin1("x,y,width,height"));
+	QCommandLineOption scale_option(QString::fromLatin1("scale"), QString::fromLatin1("The scale to be used. The default is the map's print scale."), QString::fromLatin1("denominator"));
+	QCommandLineOption dpi_option(QString::fromLatin1("dpi"), QString::fromLatin1("The resolution. The default is the map's print resolution."), QString::fromLatin1("dpi"));
+	QCommandLineOption templates_option(QString::fromLatin1("templates"), QString::fromLatin1("Exports the templates which are visible in the saved view."));
+	QCommandLineOption overprinting_option(QString::fromLatin1("overprinting"), QString::fromLatin1("Simulates the overprinting of spot colors."));
+	QCommandLineOption threads_option(QString::fromLatin1("threads"), QString::fromLatin1("The number of maps to be exported in parallel."), QString::fromLatin1("number"), QString::number(QThread::idealThreadCount()));
+	for (const auto& option : { export_option, format_option, output_option, output_dir_option, area_option, scale_option, dpi_option, templates_option, overprinting_option, threads_option })
+		parser.addOption(option);
+	parser.addPositionalArgument(QString::fromLatin1("maps"), QString::fromLatin1("The map files to be exported."), QString::fromLatin1("<map files...>"));
+	parser.process(app);
+	
+	const QStringList paths = parser.positionalArguments();
+	if (paths.isEmpty() || (paths.size() > 1 && parser.isSet(output_option)))
+		parser.showHelp(1);
+	
+	BatchExporter::Job job;
+	QString suffix = parser.value(format_option).toLower();
+	if (suffix.isEmpty())
+	{
+		suffix = parser.isSet(output_option) ? QFileInfo(parser.value(output_option)).suffix().toLower() : QString::fromLatin1("pdf");
+		job.format = BatchExporter::formatForPath(parser.value(output_option));
+	}
+	else if (suffix == QLatin1String("separations"))
+	{
+		suffix = QString::fromLatin1("pdf");
+		job.format = BatchExporter::Separations;
+	}
+	else
+	{
+		job.format = BatchExporter::formatForPath(QLatin1String("map.") + suffix);
+		if (job.format == BatchExporter::Pdf && suffix != QLatin1String("pdf"))
+		{
+			std::fprintf(stderr, "Unknown format '%s'.\n", qPrintable(suffix));
+			return 1;
+		}
+	}
+	
+	if (parser.isSet(area_option))
+	{
+		const QStringList values = parser.value(area_option).split(QLatin1Char(','));
+		bool ok = values.size() == 4;
+		qreal numbers[4] = {};
+		for (int i = 0; ok && i < 4; ++i)
+			numbers[i] = values[i].toDouble(&ok);
+		job.print_area = QRectF(numbers[0], numbers[1], numbers[2], numbers[3]);
+		if (!ok || !job.print_area.isValid())
+		{
+			std::fprintf(stderr, "Invalid area '%s'.\n", qPrintable(parser.value(area_option)));
+			return 1;
+		}
+	}
+	job.scale = parser.value(scale_option).toUInt();
+	job.resolution = parser.value(dpi_option).toUInt();
+	job.show_templates = parser.isSet(templates_option);
+	job.simulate_overprinting = parser.isSet(overprinting_option);
+	
+	std::vector<BatchExporter::Job> jobs;
+	jobs.reserve(std::size_t(paths.size()));
+	for (const auto& path : paths)
+	{
+		const QFileInfo input(path);
+		job.input_path = input.absoluteFilePath();
+		if (parser.isSet(output_option))
+			job.output_path = QFileInfo(parser.value(output_option)).absoluteFilePath();
+		else
+		{
+			const QDir output_dir(parser.isSet(output_dir_option) ? parser.value(output_dir_option) : input.absolutePath());
+			job.output_path = output_dir.absoluteFilePath(input.completeBaseName() + QLatin1Char('.') + suffix);
+		}
+		jobs.push_back(job);
+	}
+	
+	QElapsedTimer timer;
+	timer.start();
+	const auto results = BatchExporter::run(jobs, parser.value(threads_option).toInt());
+	const qint64 total_time = timer.elapsed();
+	
+	int failures = 0;
+	for (std::size_t i = 0; i < jobs.size(); ++i)
+	{
+		const auto& result = results[i];
+		if (result.success)
+		{
+			std::printf("%s -> %s: load %lld ms, export %lld ms\n",
+			            qPrintable(jobs[i].input_path), qPrintable(jobs[i].output_path),
+			            (long long)result.load_time, (long long)result.export_time);
+		}
+		else
+		{
+			std::fprintf(stderr, "%s: %s\n", qPrintable(jobs[i].input_path), qPrintable(result.error));
+			++failures;
+		}
+	}
+	std::printf("%d of %d maps exported in %lld ms\n", int(jobs.size()) - failures, int(jobs.size()), (long long)total_time);
+	return failures ? 1 : 0;
+}
+#endif
+
 int main(int argc, char** argv)
 {
+	StartupTimer::start(argc, argv);
+	
+	// Command line modes which do not open any window
+	bool batch_mode = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (qstrcmp(argv[i], "--export") == 0 || qstrcmp(argv[i], "--memory-report") == 0)
+			batch_mode = true;
+	}
+#ifndef Q_OS_ANDROID
+	// Batch mode must work without a display, e.g. on build servers.
+	// Like the tests, use the "minimal" platform unless told otherwise.
+	if (batch_mode && qgetenv("QT_QPA_PLATFORM").isEmpty())
+		qputenv("QT_QPA_PLATFORM", "minimal");
+#endif
+	
 #if MAPPER_USE_QTSINGLEAPPLICATION
 	// Create single-instance application.
 	// Use "oo-mapper" instead of the executable as identifier, in case we launch from different paths.
 	QtSingleApplication qapp("oo-mapper", argc, argv);
-	if (qapp.isRunning()) {
+	// Measuring the startup needs a new instance.
+	if (qapp.isRunning() && !batch_mode && !StartupTimer::isActive()) {
 		// Send a message to activate the running app, and optionally open a file
 		qapp.sendMessage((argc > 1) ? argv[1] : "");
 		return 0;
@@ -65,6 +252,7 @@ int main(int argc, char** argv)
 #else
 	QApplication qapp(argc, argv);
 #endif
+	StartupTimer::mark("Application");
 	
 	// Load resources
 #ifdef MAPPER_USE_QT_CONF_QRC
@@ -72,6 +260,7 @@ int main(int argc, char** argv)
 #endif
 	Q_INIT_RESOURCE(resources);
 	Q_INIT_RESOURCE(licensing);
+	StartupTimer::mark("Resources");
 	
 	// QSettings on OS X benefits from using an internet domain here.
 	QCoreApplication::setOrganizationName("OpenOrienteering.org");
@@ -80,6 +269,7 @@ int main(int argc, char** argv)
 	// Set settings defaults
 	Settings& settings = Settings::getInstance();
 	settings.applySettings();
+	StartupTimer::mark("Settings");
 	
 #ifdef WIN32
 	// Load plugins on Windows
@@ -101,9 +291,23 @@ int main(int argc, char** argv)
 #endif
 	qapp.installTranslator(&translation.getQtTranslator());
 	qapp.installTranslator(&translation.getAppTranslator());
+	StartupTimer::mark("Translations");
 	
 	// Initialize static things like the file format registry.
 	doStaticInitializations();
+	StartupTimer::mark("Static initializations");
+	
+#ifndef Q_OS_ANDROID
+	// Print the memory usage of the given files instead of opening them.
+	if (qapp.arguments().contains(QLatin1String("--memory-report")))
+		return printMemoryReports(qapp.arguments().mid(1));
+#endif
+	
+#if !defined(Q_OS_ANDROID) && defined(QT_PRINTSUPPORT_LIB)
+	// Export the given files instead of opening them.
+	if (qapp.arguments().contains(QLatin1String("--export")))
+		return exportMaps(qapp);
+#endif
 	
 	QStyle* base_style = nullptr;
 #if !defined(Q_OS_WIN) && !defined(Q_OS_OSX)
@@ -118,11 +322,12 @@ int main(int argc, char** argv)
 #if !defined(Q_OS_OSX)
 	QApplication::setPalette(QApplication::style()->standardPalette());
 #endif
+	StartupTimer::mark("Style");
 	
 	// Create first main window
 	MainWindow first_window(true);
 	first_window.setAttribute(Qt::WA_DeleteOnClose, false);
-	first_window.setController(new HomeScreenController());
+	StartupTimer::mark("Main window");
 	
 	bool no_files_given = true;
 #ifdef Q_OS_ANDROID
@@ -146,10 +351,11 @@ int main(int argc, char** argv)
 		QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
 		if (!first_window.openPath(local_file))
 			return -1;
+		StartupTimer::finish();
 		return qapp.exec();
 	}
 #else
-	// Open given files later, i.e. after the initial home screen has been
+	// Open given files later, i.e. after the main window has been
 	// displayed. In this way, error messages for missing files will show on 
 	// top of a regular main window (home screen or other file).
 	
@@ -171,7 +377,18 @@ int main(int argc, char** argv)
 	{
 		QStringList files(settings.getSettingCached(Settings::General_RecentFilesList).toStringList());
 		if (!files.isEmpty())
+		{
 			first_window.openPathLater(files[0]);
+			no_files_given = false;
+		}
+	}
+	
+	// The home screen is not needed when a file is opened on startup.
+	// If opening fails, MainWindow::openPathBacklog() will set it.
+	if (no_files_given)
+	{
+		first_window.setController(new HomeScreenController());
+		StartupTimer::mark("Home screen");
 	}
 	
 #if MAPPER_USE_QTSINGLEAPPLICATION
@@ -183,6 +400,8 @@ int main(int argc, char** argv)
 	// Let application run
 	first_window.setVisible(true);
 	first_window.raise();
+	if (no_files_given)
+		StartupTimer::finish();  // Otherwise when the files are opened.
 	return qapp.exec();
 }
 
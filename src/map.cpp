@@ -22,23 +22,41 @@
 #include "map.h"
 
 #include <algorithm>
-
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <unordered_set>
+
+#include <QAtomicInt>
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDateTime>
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
+#include <QHash>
 #include <qmath.h>
 #include <QMessageBox>
+#include <QMutexLocker>
 #include <QPainter>
 #include <QSaveFile>
+#include <QThread>
+#include <QTimer>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
 #include "core/georeferencing.h"
 #include "core/map_color.h"
 #include "core/map_printer.h"
+#include "core/render_statistics.h"
+#include "core/task_pool.h"
+#include "core/tracing.h"
 #include "core/map_view.h"
 #include "file_format_ocad8.h"
 #include "file_format_registry.h"
+#include "file_format_xml_p.h"
 #include "file_import_export.h"
 #include "map_editor.h"
 #include "map_part.h"
@@ -47,8 +65,10 @@
 #include "object.h"
 #include "object_operations.h"
 #include "renderable.h"
+#include "settings.h"
 #include "symbol.h"
 #include "symbol_combined.h"
+#include "symbol_icon_cache.h"
 #include "symbol_line.h"
 #include "symbol_point.h"
 #include "symbol_text.h"
@@ -91,6 +111,88 @@ struct MapColorSetMergeItem
  *  to colors in a destination MapColorSet. */
 typedef std::vector<MapColorSetMergeItem> MapColorSetMergeList;
 
+
+/** The minimum number of objects for which updateObjects() uses worker threads. */
+const std::size_t min_concurrent_update_size = 1000;
+
+/** The number of objects which updateObjectsFor() updates between checks of the time. */
+const std::size_t object_update_batch_size = 4 * min_concurrent_update_size;
+
+/** The time for each continuation of updateObjectsFor() from the event loop. */
+const int max_continued_update_msecs = 50;
+
+/** The number of insertions of renderables after which the renderables are compacted. */
+const quint64 renderables_compaction_churn = 10000;
+
+/** The time without insertions of renderables before the compaction starts, in ms. */
+const int renderables_compaction_delay = 2000;
+
+/** The time for each step of the compaction from the event loop. */
+const int max_compaction_msecs = 10;
+
+/**
+ * Applies the transformation to the objects, concurrently for many objects.
+ * 
+ * The objects are marked as dirty but not updated.
+ */
+template <class Transformation>
+void transformObjects(const std::vector<Object*>& objects, const Transformation& transformation)
+{
+	for (Object* object : objects)
+		object->setOutputDirty();
+	
+	if (objects.size() < min_concurrent_update_size || TaskPool::maxThreads() < 2)
+	{
+		for (Object* object : objects)
+			transformation(object);
+		return;
+	}
+	
+	// The objects are marked as dirty in advance, so that transforming them
+	// does not schedule updates from the worker threads.
+	TaskPool::forEach(int(objects.size()), 256, [&objects, &transformation](int i) {
+		transformation(objects[i]);
+	});
+}
+
+
+/** The maximum number of symbol sets in the cache. */
+const int max_cached_symbol_sets = 8;
+
+/**
+ * A symbol set which was loaded by Map::loadFrom() with load_symbols_only.
+ */
+struct CachedSymbolSet
+{
+	QDateTime last_modified;
+	qint64 size;
+	quint64 last_use;
+	Map* map;
+};
+
+/** Returns the symbol set cache, keyed by canonical file path. */
+QHash<QString, CachedSymbolSet>& symbolSetCache()
+{
+	static QHash<QString, CachedSymbolSet> cache;
+	return cache;
+}
+
+/** Deletes all cached symbol sets. */
+void clearSymbolSetCache()
+{
+	auto& cache = symbolSetCache();
+	for (const CachedSymbolSet& entry : cache)
+		delete entry.map;
+	cache.clear();
+}
+
+/** Returns a new renderables generation, unique among all maps. */
+int newRenderablesGeneration()
+{
+	static QAtomicInt last_generation;
+	return last_generation.fetchAndAddRelaxed(1) + 1;
+}
+
 } // namespace
 
 
@@ -122,11 +224,63 @@ void Map::MapColorSet::erase(int pos)
 
 void Map::MapColorSet::adjustColorPriorities(int first, int last)
 {
-	// TODO: delete or update RenderStates with these colors
+	// The render keys of the colors do not change.
 	for (int i = first; i < last; ++i)
 		colors[i]->setPriority(i);
 }
 
+void Map::MapColorSet::makeRenderKeyUnique(MapColor* color)
+{
+	const int key = color->getRenderKey();
+	int max_key = -1;
+	bool unique = true;
+	for (const MapColor* other : colors)
+	{
+		if (other == color)
+			continue;
+		const int other_key = other->getRenderKey();
+		max_key = qMax(max_key, other_key);
+		unique &= (other_key != key);
+	}
+	if (!unique || key < 0)
+		color->setRenderKey(qMax(max_key + 1, int(colors.size())));
+}
+
+int Map::MapColorSet::renderKeyToPriority(int render_key) const
+{
+	if (render_key < 0)
+		return render_key;
+	
+	QMutexLocker locker(&render_key_mutex);
+	auto lookup = [this](int render_key) -> int {
+		if (std::size_t(render_key) < priorities_by_render_key.size())
+		{
+			const int priority = priorities_by_render_key[std::size_t(render_key)];
+			if (priority >= 0 && std::size_t(priority) < colors.size()
+			    && colors[std::size_t(priority)]->getRenderKey() == render_key)
+				return priority;
+		}
+		return -1;
+	};
+	
+	int priority = lookup(render_key);
+	if (priority < 0)
+	{
+		priorities_by_render_key.clear();
+		for (std::size_t i = 0; i < colors.size(); ++i)
+		{
+			const int key = colors[i]->getRenderKey();
+			if (key < 0)
+				continue;
+			if (std::size_t(key) >= priorities_by_render_key.size())
+				priorities_by_render_key.resize(std::size_t(key) + 1, -1);
+			priorities_by_render_key[std::size_t(key)] = int(i);
+		}
+		priority = lookup(render_key);
+	}
+	return (priority >= 0) ? priority : std::numeric_limits<int>::max();
+}
+
 // This algorithm tries to maintain the relative order of colors.
 MapColorMap Map::MapColorSet::importSet(const Map::MapColorSet& other, std::vector< bool >* filter, Map* map)
 {
@@ -178,6 +332,12 @@ MapColorMap Map::MapColorSet::importSet(const Map::MapColorSet& other, std::vect
 		
 		bool priorities_changed = false;
 		
+		// Find candidates for equal colors by their hash
+		QMultiHash<uint, std::size_t> color_indices;
+		color_indices.reserve(int(colors.size()));
+		for (std::size_t k = 0, colors_size = colors.size(); k < colors_size; ++k)
+			color_indices.insert(colors[k]->contentHash(), k);
+		
 		// Initialize merge_list
 		MapColorSetMergeList::iterator merge_list_item = merge_list.begin();
 		for (std::size_t i = 0; i < other.colors.size(); ++i)
@@ -186,7 +346,9 @@ MapColorMap Map::MapColorSet::importSet(const Map::MapColorSet& other, std::vect
 			
 			MapColor* src_color = other.colors[i];
 			merge_list_item->src_color = src_color;
-			for (std::size_t k = 0, colors_size = colors.size(); k < colors_size; ++k)
+			auto candidates = color_indices.values(src_color->contentHash());
+			std::sort(candidates.begin(), candidates.end());
+			for (std::size_t k : candidates)
 			{
 				if (colors[k]->equals(*src_color, false))
 				{
@@ -388,11 +550,23 @@ CombinedSymbol* Map::covering_combined_line;
 Map::Map()
  : color_set()
  , has_spot_colors(false)
+ , color_symbol_index_valid(false)
  , undo_manager(new UndoManager(this))
+ , map_tile_store(std::make_shared<MapTileStore>())
+ , template_loading_timer(new QTimer(this))
+ , object_update_timer(new QTimer(this))
+ , renderables_compaction_timer(new QTimer(this))
+ , change_feed_timer(new QTimer(this))
  , renderables(new MapRenderables(this))
  , selection_renderables(new MapRenderables(this))
+ , selection_renderables_dirty(false)
  , renderable_options(Symbol::RenderNormal)
  , printer_config(nullptr)
+ , objects_revision(0)
+ , properties_revision(0)
+ , snapshot_objects_revision(0)
+ , snapshot_properties_revision(0)
+ , renderables_generation(newRenderablesGeneration())
 {
 	if (!static_initialized)
 		initStatic();
@@ -404,6 +578,39 @@ Map::Map()
 	connect(this, &Map::colorChanged, this, &Map::checkSpotColorPresence);
 	connect(this, &Map::colorDeleted, this, &Map::checkSpotColorPresence);
 	connect(undo_manager.data(), &UndoManager::cleanChanged, this, &Map::undoCleanChanged);
+	
+	connect(this, &Map::colorAdded, this, [this](int, const MapColor* color) {
+		recordColorChange(MapChange::ColorAdded, color);
+	});
+	connect(this, &Map::colorChanged, this, [this](int, const MapColor* color) {
+		recordColorChange(MapChange::ColorModified, color);
+	});
+	connect(this, &Map::colorDeleted, this, [this](int, const MapColor* color) {
+		recordColorChange(MapChange::ColorRemoved, color);
+	});
+	connect(this, &Map::symbolAdded, this, [this](int, const Symbol* symbol) {
+		recordSymbolChange(MapChange::SymbolAdded, symbol);
+	});
+	connect(this, &Map::symbolChanged, this, [this](int, const Symbol* new_symbol, const Symbol*) {
+		recordSymbolChange(MapChange::SymbolModified, new_symbol);
+	});
+	connect(this, &Map::symbolDeleted, this, [this](int, const Symbol* symbol) {
+		recordSymbolChange(MapChange::SymbolRemoved, symbol);
+	});
+	
+	template_loading_timer->setInterval(1000);
+	connect(template_loading_timer, &QTimer::timeout, this, &Map::updateTemplateLoading);
+	
+	object_update_timer->setSingleShot(true);
+	object_update_timer->setInterval(0);
+	connect(object_update_timer, &QTimer::timeout, this, &Map::continueObjectUpdates);
+	
+	renderables_compaction_timer->setSingleShot(true);
+	connect(renderables_compaction_timer, &QTimer::timeout, this, &Map::continueRenderablesCompaction);
+	
+	change_feed_timer->setSingleShot(true);
+	change_feed_timer->setInterval(0);
+	connect(change_feed_timer, &QTimer::timeout, this, &Map::emitChangesRecorded);
 }
 
 Map::~Map()
@@ -429,8 +636,10 @@ void Map::clear()
 void Map::init()
 {
 	color_set = new MapColorSet();
+	renderables->invalidateSeparationTables();
 	
 	symbols.clear();
+	invalidateColorSymbolIndex();
 	templates.clear();
 	closed_templates.clear();
 	parts.clear();
@@ -442,8 +651,22 @@ void Map::init()
 	
 	object_selection.clear();
 	first_selected_object = nullptr;
+	dirty_objects.clear();
+	advanceObjectsRevision();
+	change_feed.invalidate();
+	renderables_compaction_timer->stop();
+	renderables_insertions = 0;
+	compacted_insertions = 0;
+	checked_insertions = 0;
+	compaction_part = 0;
+	compaction_object = 0;
+	reclaimed_renderables_memory = 0;
+	tag_strings.clear();
+	object_index.reset();
 	
 	widgets.clear();
+	template_usage.clear();
+	template_loading_timer->stop();
 	
 	undo_manager->clear();
 	undo_manager->setClean();
@@ -488,13 +711,16 @@ void Map::changeScale(unsigned int new_scale_denominator, const MapCoord& scalin
 	
 	double factor = getScaleDenominator() / (double)new_scale_denominator;
 	
-	if (scale_symbols)
-		scaleAllSymbols(factor);
 	if (scale_objects)
 	{
 		undo_manager->clear();
-		scaleAllObjects(factor, scaling_center);
+		scaleObjects(factor, scaling_center);
 	}
+	// The renderables are generated once, for the scaled objects and symbols.
+	if (scale_symbols)
+		scaleAllSymbols(factor);
+	else
+		updateObjects();
 	if (scale_georeferencing)
 		georeferencing->setMapRefPoint(scaling_center + factor * (georeferencing->getMapRefPoint() - scaling_center));
 	if (scale_templates)
@@ -587,9 +813,78 @@ bool Map::saveTo(const QString& path, MapView* view)
 }
 
 bool Map::exportTo(const QString& path, MapView* view, const FileFormat* format)
+{
+	QSaveFile file(path);
+	return exportToDevice(file, path, view, format);
+}
+
+bool Map::exportToData(const QString& path, QByteArray& data, MapView* view, const FileFormat* format)
+{
+	data.clear();
+	QBuffer buffer(&data);
+	return exportToDevice(buffer, path, view, format);
+}
+
+std::function<bool (QByteArray&, QString&)> Map::prepareExportToData(const QString& path, MapView* view, const FileFormat* format)
 {
 	Q_ASSERT(view && "Saving a file without view information is not supported!");
 	
+	format = prepareExport(path, format);
+	if (!format)
+		return {};
+	
+	QByteArray state;
+	QBuffer buffer(&state);
+	QScopedPointer<Exporter> exporter(format->createExporter(&buffer, this, view));
+	auto xml_exporter = qobject_cast<XMLFileExporter*>(exporter.data());
+	if (!xml_exporter)
+	{
+		// Only the XML based formats can be exported from a snapshot.
+		QByteArray data;
+		if (!exportToData(path, data, view, format))
+			return {};
+		return [data](QByteArray& out_data, QString& /*error_string*/) -> bool {
+			out_data = data;
+			return true;
+		};
+	}
+	
+	buffer.open(QIODevice::WriteOnly);
+	try
+	{
+		xml_exporter->exportMapState();
+	}
+	catch (std::exception &e)
+	{
+		const QString error = QString::fromLocal8Bit(e.what());
+		QMessageBox::warning(nullptr, tr("Error"), tr("Internal error while saving:\n%1").arg(error));
+		return {};
+	}
+	
+	std::shared_ptr<const Map> snapshot = this->snapshot();
+	return [format, snapshot, state](QByteArray& data, QString& error_string) -> bool {
+		data.clear();
+		QBuffer buffer(&data);
+		buffer.open(QIODevice::WriteOnly);
+		// The exporter does not modify the map.
+		QScopedPointer<Exporter> exporter(format->createExporter(&buffer, const_cast<Map*>(snapshot.get()), nullptr));
+		qobject_cast<XMLFileExporter*>(exporter.data())->setMapState(state);
+		try
+		{
+			MAPPER_TRACE_SCOPE("file", "Exporter::doExport");
+			exporter->doExport();
+		}
+		catch (std::exception &e)
+		{
+			error_string = QString::fromLocal8Bit(e.what());
+			return false;
+		}
+		return true;
+	};
+}
+
+const FileFormat* Map::prepareExport(const QString& path, const FileFormat* format)
+{
 	if (!format)
 		format = FileFormats.findFormatForFilename(path);
 
@@ -599,12 +894,12 @@ bool Map::exportTo(const QString& path, MapView* view, const FileFormat* format)
 	if (!format)
 	{
 		QMessageBox::warning(nullptr, tr("Error"), tr("Cannot export the map as\n\"%1\"\nbecause the format is unknown.").arg(path));
-		return false;
+		return nullptr;
 	}
 	else if (!format->supportsExport())
 	{
 		QMessageBox::warning(nullptr, tr("Error"), tr("Cannot export the map as\n\"%1\"\nbecause saving as %2 (.%3) is not supported.").arg(path).arg(format->description()).arg(format->fileExtensions().join(", ")));
-		return false;
+		return nullptr;
 	}
 	
 	// Update the relative paths of templates
@@ -626,24 +921,48 @@ bool Map::exportTo(const QString& path, MapView* view, const FileFormat* format)
 			temp->setTemplateRelativePath(map_dir.relativeFilePath(temp->getTemplatePath()));
 	}
 	
-	QSaveFile file(path);
-	QScopedPointer<Exporter> exporter(format->createExporter(&file, this, view));
+	// A part whose objects could not be loaded would be saved without them.
+	for (const MapPart* part : parts)
+	{
+		part->ensureLoaded();
+		if (!part->isLoaded())
+		{
+			QMessageBox::warning(nullptr, tr("Error"), tr("Cannot save the map because the objects of map part \"%1\" could not be loaded:\n%2").arg(part->getName(), part->loadingError()));
+			return nullptr;
+		}
+	}
+	
+	return format;
+}
+
+bool Map::exportToDevice(QIODevice& device, const QString& path, MapView* view, const FileFormat* format)
+{
+	Q_ASSERT(view && "Saving a file without view information is not supported!");
+	
+	format = prepareExport(path, format);
+	if (!format)
+		return false;
+	
+	QSaveFile* save_file = qobject_cast<QSaveFile*>(&device);
+	QScopedPointer<Exporter> exporter(format->createExporter(&device, this, view));
 	bool success = false;
-	if (file.open(QIODevice::WriteOnly))
+	if (device.open(QIODevice::WriteOnly))
 	{
 		try
 		{
+			MAPPER_TRACE_SCOPE("file", "Exporter::doExport");
 			exporter->doExport();
 		}
 		catch (std::exception &e)
 		{
-			file.cancelWriting();
+			if (save_file)
+				save_file->cancelWriting();
 			const QString error = QString::fromLocal8Bit(e.what());
 			QMessageBox::warning(nullptr, tr("Error"), tr("Internal error while saving:\n%1").arg(error));
 			return false;
 		}
 		
-		success = file.commit();
+		success = save_file ? save_file->commit() : true;
 	}
 	
 	if (!success)
@@ -652,7 +971,7 @@ bool Map::exportTo(const QString& path, MapView* view, const FileFormat* format)
 		  nullptr,
 		  tr("Error"),
 		  /** @todo: Switch to the latter when translated. */ true ?
-		  tr("Cannot open file:\n%1\n\n%2").arg(path).arg(file.errorString()) :
+		  tr("Cannot open file:\n%1\n\n%2").arg(path).arg(device.errorString()) :
 		  tr("Cannot save file\n%1:\n%2")
 		);
 	}
@@ -674,6 +993,9 @@ bool Map::exportTo(const QString& path, MapView* view, const FileFormat* format)
 
 bool Map::loadFrom(const QString& path, QWidget* dialog_parent, MapView* view, bool load_symbols_only, bool show_error_messages)
 {
+	if (load_symbols_only && loadSymbolSetFromCache(path))
+		return true;
+	
 	// Ensure the file exists and is readable.
 	QFile file(path);
 	if (!file.open(QIODevice::ReadOnly))
@@ -772,13 +1094,106 @@ bool Map::loadFrom(const QString& path, QWidget* dialog_parent, MapView* view, b
 	}
 
 	// Update all objects without trying to remove their renderables first, this gives a significant speedup when loading large files
-	updateAllObjects(); // TODO: is the comment above still applicable?
+	// TODO: is the comment above still applicable?
+	// Parts with deferred loading are loaded after returning to the event loop.
+	bool has_deferred_parts = false;
+	for (MapPart* part : parts)
+	{
+		if (part->isLoaded())
+			part->applyOnAllObjects(ObjectOp::SetOutputDirty());
+		else
+			has_deferred_parts = true;
+	}
+	updateObjects();
+	if (has_deferred_parts)
+		QTimer::singleShot(0, this, SLOT(loadDeferredPart()));
 	
 	setHasUnsavedChanges(false);
+	
+	if (load_symbols_only)
+	{
+		if (!SymbolIconCache::restoreIcons(*this, path))
+			SymbolIconCache::saveIcons(*this, path);
+		cacheSymbolSet(path);
+	}
 
 	return true;
 }
 
+bool Map::loadSymbolSetFromCache(const QString& path)
+{
+	const QFileInfo file_info(path);
+	auto& cache = symbolSetCache();
+	auto entry = cache.find(file_info.canonicalFilePath());
+	if (entry == cache.end())
+		return false;
+	
+	if (entry->last_modified != file_info.lastModified() || entry->size != file_info.size())
+	{
+		// The file was modified.
+		delete entry->map;
+		cache.erase(entry);
+		return false;
+	}
+	
+	static quint64 use_counter = 0;
+	entry->last_use = ++use_counter;
+	
+	reset();
+	importSymbolSet(entry->map);
+	setHasUnsavedChanges(false);
+	return true;
+}
+
+void Map::cacheSymbolSet(const QString& path) const
+{
+	const QFileInfo file_info(path);
+	const QString key = file_info.canonicalFilePath();
+	if (key.isEmpty() || !QCoreApplication::instance())
+		return;
+	
+	// Symbols must not outlive the application object (fonts).
+	static bool clear_on_quit = false;
+	if (!clear_on_quit)
+	{
+		QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, &clearSymbolSetCache);
+		clear_on_quit = true;
+	}
+	
+	auto& cache = symbolSetCache();
+	auto entry = cache.find(key);
+	if (entry != cache.end())
+	{
+		delete entry->map;
+		cache.erase(entry);
+	}
+	
+	while (cache.size() >= max_cached_symbol_sets)
+	{
+		auto least_recently_used = cache.begin();
+		for (auto it = cache.begin(); it != cache.end(); ++it)
+		{
+			if (it->last_use < least_recently_used->last_use)
+				least_recently_used = it;
+		}
+		delete least_recently_used->map;
+		cache.erase(least_recently_used);
+	}
+	
+	Map* copy = new Map();
+	copy->importSymbolSet(const_cast<Map*>(this));
+	cache.insert(key, { file_info.lastModified(), file_info.size(), 0, copy });
+}
+
+void Map::importSymbolSet(Map* other)
+{
+	setGeoreferencing(other->getGeoreferencing());
+	MapColorMap color_map(color_set->importSet(*other->color_set, nullptr, this));
+	renderables->invalidateSeparationTables();
+	importSymbols(other, color_map, -1, false);
+	checkSpotColorPresence();
+}
+
 void Map::importMap(Map* other, ImportMode mode, QWidget* dialog_parent, std::vector<bool>* filter, int symbol_insert_pos,
 					bool merge_duplicate_symbols, QHash<const Symbol*, Symbol*>* out_symbol_map)
 {
@@ -833,6 +1248,7 @@ void Map::importMap(Map* other, ImportMode mode, QWidget* dialog_parent, std::ve
 	
 	// Import colors
 	MapColorMap color_map(color_set->importSet(*other->color_set, &color_filter, this));
+	renderables->invalidateSeparationTables();
 	
 	if (mode == ColorImport)
 		return;
@@ -899,6 +1315,7 @@ bool Map::exportToIODevice(QIODevice* stream)
 	try {
 		const FileFormat* native_format = FileFormats.findFormat(QStringLiteral("XML"));
 		exporter = native_format->createExporter(stream, this, nullptr);
+		MAPPER_TRACE_SCOPE("file", "Exporter::doExport");
 		exporter->doExport();
 		stream->close();
 	}
@@ -943,6 +1360,27 @@ void Map::draw(QPainter* painter, const RenderConfig& config)
 	renderables->draw(painter, config);
 }
 
+void Map::drawUpdated(QPainter* painter, const RenderConfig& config) const
+{
+	renderables->draw(painter, config);
+}
+
+void Map::drawPart(QPainter* painter, const RenderConfig& config, const MapPart* part)
+{
+	part->ensureLoaded();
+	
+	// Update the renderables of all objects marked as dirty
+	updateObjects();
+	
+	MapRenderables::ObjectSet objects;
+	objects.reserve(part->getNumObjects());
+	for (int i = 0; i < part->getNumObjects(); ++i)
+		objects.insert(part->getObject(i));
+	
+	// The actual drawing
+	renderables->draw(painter, config, &objects);
+}
+
 void Map::drawOverprintingSimulation(QPainter* painter, const RenderConfig& config)
 {
 	// Update the renderables of all objects marked as dirty
@@ -961,6 +1399,37 @@ void Map::drawColorSeparation(QPainter* painter, const RenderConfig& config, con
 	renderables->drawColorSeparation(painter, config, spot_color, use_color);
 }
 
+void Map::drawColorSeparations(QPainter* painter, const RenderConfig& config, const std::vector<const MapColor*>& spot_colors, const std::function<void ()>& next_separation)
+{
+	// Update the renderables of all objects marked as dirty
+	updateObjects();
+	
+	MapRenderables::VisibleObjects visible;
+	renderables->findVisibleObjects(config, visible);
+	
+	// The actual drawing
+	for (std::size_t i = 0; i < spot_colors.size(); ++i)
+	{
+		if (i > 0)
+			next_separation();
+		renderables->drawColorSeparation(painter, config, spot_colors[i], false, &visible);
+	}
+}
+
+void Map::drawObjectsSeparately(QPainter* painter, const RenderConfig& config, const std::function<void (const Object*, const MapColor*)>& begin_object)
+{
+	// Update the renderables of all objects marked as dirty
+	updateObjects();
+	
+	// The actual drawing
+	renderables->drawObjectsSeparately(painter, config, begin_object);
+}
+
+bool Map::hasRenderablesAt(const QRectF& map_coords_rect) const
+{
+	return renderables->intersects(map_coords_rect);
+}
+
 void Map::drawGrid(QPainter* painter, QRectF bounding_box, bool on_screen)
 {
 	grid.draw(painter, bounding_box, this, on_screen);
@@ -992,62 +1461,291 @@ void Map::drawTemplates(QPainter* painter, QRectF bounding_box, int first_templa
 
 void Map::updateObjects()
 {
-	// TODO: It maybe would be better if the objects entered themselves into a separate list when they get dirty so not all objects have to be traversed here
-	applyOnAllObjects(ObjectOp::Update());
+	MAPPER_TRACE_SCOPE("object", "Map::updateObjects");
+	
+	// Registers objects which were added by importers, and updates them.
+	for (MapPart* part : parts)
+		part->ensureSpatialIndex();
+	
+	if (dirty_objects.empty())
+		return;
+	
+	std::vector<const Object*> objects;
+	objects.swap(dirty_objects);
+	updateObjects(objects);
 }
 
-void Map::removeRenderablesOfObject(const Object* object, bool mark_area_as_dirty)
-{
-	renderables->removeRenderablesOfObject(object, mark_area_as_dirty);
-	if (isObjectSelected(object))
-		removeSelectionRenderables(object);
-}
-void Map::insertRenderablesOfObject(const Object* object)
+bool Map::updateObjectsFor(int msecs, const QRectF& visible_rect)
 {
-	renderables->insertRenderablesOfObject(object);
-	if (isObjectSelected(object))
-		addSelectionRenderables(object);
+	MAPPER_TRACE_SCOPE("object", "Map::updateObjectsFor");
+	
+	for (MapPart* part : parts)
+		part->ensureSpatialIndex();
+	
+	QElapsedTimer timer;
+	timer.start();
+	
+	if (visible_rect.isValid() && !dirty_objects.empty())
+	{
+		// The entries in dirty_objects are skipped later when they are clean.
+		std::vector<Object*> found;
+		for (const MapPart* part : parts)
+			part->findObjectsInRect(visible_rect, found);
+		std::vector<const Object*> visible_objects;
+		for (const Object* object : found)
+		{
+			if (object->isOutputDirty())
+				visible_objects.push_back(object);
+		}
+		updateObjects(visible_objects);
+	}
+	
+	while (!dirty_objects.empty())
+	{
+		if (dirty_objects.size() <= object_update_batch_size)
+		{
+			std::vector<const Object*> objects;
+			objects.swap(dirty_objects);
+			updateObjects(objects);
+			break;
+		}
+		
+		std::vector<const Object*> objects(dirty_objects.end() - object_update_batch_size, dirty_objects.end());
+		dirty_objects.resize(dirty_objects.size() - object_update_batch_size);
+		updateObjects(objects);
+		if (timer.elapsed() >= msecs)
+			break;
+	}
+	
+	if (dirty_objects.empty())
+		return true;
+	
+	object_update_timer->start();
+	return false;
 }
 
-
-void Map::markAsIrregular(Object* object)
+void Map::continueObjectUpdates()
 {
-	irregular_objects.insert(object);
+	updateObjectsFor(max_continued_update_msecs);
 }
 
-const std::set<Object*> Map::irregularObjects() const
+qint64 Map::compactRenderables()
 {
-	return irregular_objects;
+	const qint64 old_reclaimed_memory = reclaimed_renderables_memory;
+	compaction_part = 0;
+	compaction_object = 0;
+	compactRenderablesFor(-1);
+	compacted_insertions = renderables_insertions;
+	renderables_compaction_timer->stop();
+	return reclaimed_renderables_memory - old_reclaimed_memory;
 }
 
-std::size_t Map::deleteIrregularObjects()
+bool Map::compactRenderablesFor(int msecs)
 {
-	std::size_t result = 0;
-	std::set<Object*> unhandled;
-	for (auto object : irregular_objects)
+	MAPPER_TRACE_SCOPE("object", "Map::compactRenderablesFor");
+	
+	QElapsedTimer timer;
+	timer.start();
+	
+	for (; compaction_part < parts.size(); ++compaction_part, compaction_object = 0)
 	{
-		for (auto part : parts)
+		// Compaction must not trigger the loading of deferred objects.
+		MapPart* part = parts[compaction_part];
+		if (!part->isLoaded())
+			continue;
+		
+		while (compaction_object < part->getNumObjects())
 		{
-			if (part->deleteObject(object, false))
-			{
-				++result;
-				goto next_object;
-			}
+			// Objects which wait for an update will get new renderables anyway.
+			Object* object = part->getObject(compaction_object);
+			if (!object->isOutputDirty())
+				reclaimed_renderables_memory += object->compactRenderables();
+			++compaction_object;
+			
+			if (msecs >= 0 && compaction_object % 64 == 0 && timer.elapsed() >= msecs)
+				return false;
 		}
-		unhandled.insert(object);
-next_object:
-		; // nothing else
 	}
 	
-	irregular_objects.swap(unhandled);
-	return result;
+	reclaimed_renderables_memory += renderables->compact();
+	reclaimed_renderables_memory += selection_renderables->compact();
+	compaction_part = 0;
+	compaction_object = 0;
+	return true;
 }
 
+void Map::continueRenderablesCompaction()
+{
+	// Wait until the objects are no longer being updated.
+	if (!dirty_objects.empty() || renderables_insertions != checked_insertions)
+	{
+		checked_insertions = renderables_insertions;
+		renderables_compaction_timer->start(renderables_compaction_delay);
+		return;
+	}
+	
+	if (!compactRenderablesFor(max_compaction_msecs))
+		renderables_compaction_timer->start(0);
+	else
+		compacted_insertions = renderables_insertions;
+}
 
-void Map::getSelectionToSymbolCompatibility(const Symbol* symbol, bool& out_compatible, bool& out_different) const
+void Map::updateObjects(std::vector<const Object*>& objects)
 {
-	out_compatible = symbol && !object_selection.empty();
-	out_different = false;
+	// Drop objects which are not (or no longer) in the map, and duplicates.
+	auto not_in_map = [this](const Object* object) -> bool {
+		for (const MapPart* part : parts)
+		{
+			if (part->contains(object))
+				return !object->isOutputDirty();
+		}
+		return true;
+	};
+	objects.erase(std::remove_if(objects.begin(), objects.end(), not_in_map), objects.end());
+	RenderStatistics::addUpdatedObjects(int(objects.size()));
+	MAPPER_TRACE_COUNTER("object", "updated objects", qint64(objects.size()));
+	
+	if (objects.size() < min_concurrent_update_size || TaskPool::maxThreads() < 2)
+	{
+		for (const Object* object : objects)
+			object->update();
+		return;
+	}
+	
+	std::sort(objects.begin(), objects.end());
+	objects.erase(std::unique(objects.begin(), objects.end()), objects.end());
+	
+	// Text layout depends on font handling, which must stay in this thread.
+	std::vector<const Object*> concurrent_objects;
+	std::vector<QRectF> old_extents;
+	concurrent_objects.reserve(objects.size());
+	old_extents.reserve(objects.size());
+	for (const Object* object : objects)
+	{
+		const Symbol* symbol = object->getSymbol();
+		if (!symbol || (symbol->getContainedTypes() & Symbol::Text))
+		{
+			object->update();
+			continue;
+		}
+		
+		const QRectF& extent = object->getExtent();
+		if (extent.isValid())
+			setObjectAreaDirty(extent);
+		concurrent_objects.push_back(object);
+		old_extents.push_back(extent);
+	}
+	
+	// Generate the renderables concurrently. This thread takes part, too.
+	const Symbol::RenderableOptions options = QFlag(renderableOptions());
+	TaskPool::forEach(int(concurrent_objects.size()), 32, [&concurrent_objects, options](int i) {
+		concurrent_objects[i]->updateRenderables(options);
+	});
+	
+	// MapRenderables and the spatial indices are not thread-safe.
+	for (std::size_t i = 0; i < concurrent_objects.size(); ++i)
+	{
+		const Object* object = concurrent_objects[i];
+		insertRenderablesOfObject(object);
+		updateSpatialIndex(object);
+		const QRectF& extent = object->getExtent();
+		if (extent.isValid())
+			setObjectAreaDirty(extent);
+		rectIncludeSafe(old_extents[i], extent);
+		recordObjectChange(MapChange::ObjectModified, object, nullptr, old_extents[i]);
+	}
+}
+
+void Map::scheduleObjectUpdate(const Object* object)
+{
+	dirty_objects.push_back(object);
+}
+
+void Map::removeRenderablesOfObject(const Object* object, bool mark_area_as_dirty)
+{
+	renderables->removeRenderablesOfObject(object, mark_area_as_dirty);
+	if (isObjectSelected(object))
+		removeSelectionRenderables(object);
+}
+void Map::insertRenderablesOfObject(const Object* object)
+{
+	// Only maps which are shown are compacted from the event loop.
+	// Other maps, e.g. snapshots, may be in use by other threads.
+	++renderables_insertions;
+	if (renderables_insertions - compacted_insertions >= renderables_compaction_churn
+	    && !widgets.empty()
+	    && !renderables_compaction_timer->isActive())
+	{
+		renderables_compaction_timer->start(renderables_compaction_delay);
+	}
+	
+	renderables->insertRenderablesOfObject(object);
+	if (isObjectSelected(object))
+		addSelectionRenderables(object);
+}
+
+void Map::updateSpatialIndex(const Object* object)
+{
+	for (MapPart* part : parts)
+	{
+		if (part->updateSpatialIndex(object))
+			break;
+	}
+}
+
+void Map::updateSymbolIndex(Object* object, const Symbol* old_symbol)
+{
+	for (MapPart* part : parts)
+	{
+		if (part->updateSymbolIndex(object, old_symbol))
+			break;
+	}
+}
+
+
+void Map::markAsIrregular(Object* object)
+{
+	irregular_objects.insert(object);
+}
+
+void Map::unmarkAsIrregular(Object* object)
+{
+	irregular_objects.erase(object);
+}
+
+const std::set<Object*> Map::irregularObjects() const
+{
+	return irregular_objects;
+}
+
+std::size_t Map::deleteIrregularObjects()
+{
+	std::size_t result = 0;
+	std::set<Object*> unhandled;
+	for (auto object : irregular_objects)
+	{
+		for (auto part : parts)
+		{
+			if (part->deleteObject(object, false))
+			{
+				++result;
+				goto next_object;
+			}
+		}
+		unhandled.insert(object);
+next_object:
+		; // nothing else
+	}
+	
+	irregular_objects.swap(unhandled);
+	return result;
+}
+
+
+void Map::getSelectionToSymbolCompatibility(const Symbol* symbol, bool& out_compatible, bool& out_different) const
+{
+	out_compatible = symbol && !object_selection.empty();
+	out_different = false;
 	
 	if (symbol)
 	{
@@ -1075,19 +1773,22 @@ void Map::deleteSelectedObjects()
 		AddObjectsUndoStep* undo_step = new AddObjectsUndoStep(this);
 		MapPart* part = getCurrentPart();
 	
+		std::vector<int> positions;
+		positions.reserve(getNumSelectedObjects());
 		for (; obj != end; ++obj)
 		{
 			int index = part->findObjectIndex(*obj);
 			if (index >= 0)
 			{
 				undo_step->addObject(index, *obj);
-				part->deleteObject(index, true);
+				positions.push_back(index);
 			}
 			else
 			{
 				qDebug() << this << "::deleteSelectedObjects(): Object" << *obj << "not found in current map part.";
 			}
 		}
+		part->deleteObjects(positions, true);
 		
 		setObjectsDirty();
 		clearObjectSelection(true);
@@ -1105,13 +1806,6 @@ void Map::drawSelection(QPainter* painter, bool force_min_size, MapWidget* widge
 {
 	MapView* view = widget->getMapView();
 	
-	painter->save();
-	painter->translate(widget->width() / 2.0 + view->panOffset().x(), widget->height() / 2.0 + view->panOffset().y());
-	painter->setWorldTransform(view->worldTransform(), true);
-	
-	if (!replacement_renderables)
-		replacement_renderables = selection_renderables.data();
-	
 	RenderConfig::Options options = RenderConfig::Screen | RenderConfig::HelperSymbols;
 	qreal selection_opacity = 1.0;
 	if (force_min_size)
@@ -1121,10 +1815,42 @@ void Map::drawSelection(QPainter* painter, bool force_min_size, MapWidget* widge
 		options |= RenderConfig::Highlighted;
 		selection_opacity = 0.4;
 	}
-	RenderConfig config = { *this, view->calculateViewedRect(widget->viewportToView(widget->rect())), view->calculateFinalZoomFactor(), options, selection_opacity };
-	replacement_renderables->draw(painter, config);
 	
-	painter->restore();
+	if (replacement_renderables)
+	{
+		painter->save();
+		painter->translate(widget->width() / 2.0 + view->panOffset().x(), widget->height() / 2.0 + view->panOffset().y());
+		painter->setWorldTransform(view->worldTransform(), true);
+		RenderConfig config = { *this, view->calculateViewedRect(widget->viewportToView(widget->rect())), view->calculateFinalZoomFactor(), options, selection_opacity };
+		replacement_renderables->draw(painter, config);
+		painter->restore();
+		return;
+	}
+	
+	ensureSelectionRenderables();
+	if (selection_renderables->empty())
+		return;
+	
+	// The selection renderables are drawn via the widget's selection cache,
+	// so that the tools' overlays do not have to redraw large selections.
+	// The cache is redrawn where the selection or the selected objects
+	// changed, see setSelectionAreaDirty() and MapWidget::markObjectAreaDirty().
+	QRect dirty_rect;
+	QImage& cache = widget->getSelectionCache(int(options), dirty_rect);
+	if (dirty_rect.isValid())
+	{
+		QPainter cache_painter(&cache);
+		cache_painter.setRenderHints(painter->renderHints());
+		cache_painter.setCompositionMode(QPainter::CompositionMode_Source);
+		cache_painter.fillRect(dirty_rect, Qt::transparent);
+		cache_painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+		cache_painter.setClipRect(dirty_rect);
+		cache_painter.translate(widget->width() / 2.0, widget->height() / 2.0);
+		cache_painter.setWorldTransform(view->worldTransform(), true);
+		RenderConfig config = { *this, view->calculateViewedRect(widget->viewportToView(dirty_rect)), view->calculateFinalZoomFactor(), options, selection_opacity };
+		selection_renderables->draw(&cache_painter, config);
+	}
+	painter->drawImage(view->panOffset(), cache);
 }
 
 void Map::addObjectToSelection(Object* object, bool emit_selection_changed)
@@ -1138,6 +1864,58 @@ void Map::addObjectToSelection(Object* object, bool emit_selection_changed)
 		emit(objectSelectionChanged());
 }
 
+std::size_t Map::addObjectsToSelection(const std::vector<Object*>& objects, bool emit_selection_changed)
+{
+	// Inserting in order with a hint takes amortized constant time.
+	std::vector<Object*> sorted_objects(objects);
+	std::sort(begin(sorted_objects), end(sorted_objects));
+	
+	QRectF extent;
+	const auto old_size = object_selection.size();
+	auto hint = object_selection.begin();
+	for (Object* object : sorted_objects)
+	{
+		const auto size = object_selection.size();
+		hint = object_selection.insert(hint, object);
+		if (object_selection.size() != size)
+			rectIncludeSafe(extent, object->getExtent());
+		++hint;
+	}
+	
+	const auto num_added = object_selection.size() - old_size;
+	if (num_added > 0)
+	{
+		if (!first_selected_object)
+			first_selected_object = sorted_objects.front();
+		invalidateSelectionRenderables(extent);
+		if (emit_selection_changed)
+			emit(objectSelectionChanged());
+	}
+	return num_added;
+}
+
+std::size_t Map::removeObjectsFromSelection(const std::vector<Object*>& objects, bool emit_selection_changed)
+{
+	QRectF extent;
+	const auto old_size = object_selection.size();
+	for (Object* object : objects)
+	{
+		if (object_selection.erase(object))
+			rectIncludeSafe(extent, object->getExtent());
+	}
+	
+	const auto num_removed = old_size - object_selection.size();
+	if (num_removed > 0)
+	{
+		if (!isObjectSelected(first_selected_object))
+			first_selected_object = object_selection.empty() ? nullptr : *object_selection.begin();
+		invalidateSelectionRenderables(extent);
+		if (emit_selection_changed)
+			emit(objectSelectionChanged());
+	}
+	return num_removed;
+}
+
 void Map::removeObjectFromSelection(Object* object, bool emit_selection_changed)
 {
 	bool removed = object_selection.erase(object);
@@ -1195,7 +1973,12 @@ bool Map::toggleObjectSelection(Object* object, bool emit_selection_changed)
 
 void Map::clearObjectSelection(bool emit_selection_changed)
 {
+	QRectF selection_extent;
+	includeSelectionRect(selection_extent);
+	setSelectionAreaDirty(selection_extent);
+	
 	selection_renderables->clear();
+	selection_renderables_dirty = false;
 	object_selection.clear();
 	first_selected_object = nullptr;
 	
@@ -1216,11 +1999,14 @@ void Map::emitSelectionEdited()
 void Map::addMapWidget(MapWidget* widget)
 {
 	widgets.push_back(widget);
+	template_loading_timer->start();
 }
 
 void Map::removeMapWidget(MapWidget* widget)
 {
 	widgets.erase(std::remove(begin(widgets), end(widgets), widget), end(widgets));
+	if (widgets.empty())
+		template_loading_timer->stop();
 }
 
 
@@ -1298,8 +2084,16 @@ void Map::setColor(MapColor* color, int pos)
 {
 	// MapColor* old_color = color_set->colors[pos];
 	
+	const bool moved = color->getPriority() != pos;
 	color_set->colors[pos] = color;
 	color->setPriority(pos);
+	color_set->makeRenderKeyUnique(color);
+	renderables->invalidateSeparationTables();
+	
+	// When colors are swapped, the first call leaves the color at two
+	// positions. The renderables are moved when the set is consistent again.
+	if (moved && std::count(color_set->colors.begin(), color_set->colors.end(), color) == 1)
+		updateRenderablesColorPriorities();
 	
 	if (color->getSpotColorMethod() == MapColor::SpotColor)
 	{
@@ -1318,6 +2112,7 @@ void Map::setColor(MapColor* color, int pos)
 						if (map_color->getRgbColorMethod() == MapColor::SpotColor)
 							map_color->setRgbFromSpotColors();
 						updateSymbolIcons(map_color);
+						setObjectsWithColorDirty(map_color);
 						emit colorChanged(map_color->getPriority(), map_color);
 					}
 				}
@@ -1333,12 +2128,14 @@ void Map::setColor(MapColor* color, int pos)
 			    && map_color->removeSpotColorComponent(color))
 			{
 				updateSymbolIcons(map_color);
+				setObjectsWithColorDirty(map_color);
 				emit colorChanged(map_color->getPriority(), map_color);
 			}
 		}
 	}
 	
 	updateSymbolIcons(color);
+	setObjectsWithColorDirty(color);
 	emit(colorChanged(pos, color));
 }
 
@@ -1353,6 +2150,8 @@ void Map::addColor(MapColor* color, int pos)
 	setColorsDirty();
 	emit(colorAdded(pos, color));
 	color->setPriority(pos);
+	color_set->makeRenderKeyUnique(color);
+	updateRenderablesColorPriorities();
 }
 
 void Map::deleteColor(int pos)
@@ -1372,6 +2171,8 @@ void Map::deleteColor(int pos)
 	}
 	
 	color_set->erase(pos);
+	renderables->invalidateSeparationTables();
+	updateRenderablesColorPriorities();
 	
 	if (getNumColors() == 0)
 	{
@@ -1390,6 +2191,7 @@ void Map::deleteColor(int pos)
 		if (symbol->getType() != Symbol::Combined)
 			symbol->colorDeleted(color);
 	}
+	invalidateColorSymbolIndex();
 	emit(colorDeleted(pos, color));
 	
 	delete color;
@@ -1410,15 +2212,33 @@ int Map::findColorIndex(const MapColor* color) const
 	return -1;
 }
 
+int Map::renderKeyToPriority(int render_key) const
+{
+	return color_set->renderKeyToPriority(render_key);
+}
+
+void Map::updateRenderablesColorPriorities()
+{
+	renderables->updateColorPriorities();
+	selection_renderables->updateColorPriorities();
+	updateAllMapWidgets();
+}
+
 void Map::setColorsDirty()
 {
+	invalidateColorSymbolIndex();
+	renderables->invalidateSeparationTables();
 	colors_dirty = true;
+	++properties_revision;
 	setHasUnsavedChanges(true);
 }
 
 void Map::useColorsFrom(Map* map)
 {
 	color_set = map->color_set;
+	change_feed.invalidate();
+	invalidateColorSymbolIndex();
+	renderables->invalidateSeparationTables();
 }
 
 bool Map::isColorUsedByASymbol(const MapColor* color) const
@@ -1483,6 +2303,15 @@ void Map::importSymbols(Map* other, const MapColorMap& color_map, int insert_pos
 	if (!out_pointermap)
 		out_pointermap = &local_pointermap;
 	
+	// Find candidates for duplicates by their hash
+	QMultiHash<uint, size_t> symbol_indices;
+	if (merge_duplicates)
+	{
+		symbol_indices.reserve(int(symbols.size()));
+		for (size_t k = 0, symbols_size = symbols.size(); k < symbols_size; ++k)
+			symbol_indices.insert(symbols[k]->contentHash(), k);
+	}
+	
 	for (size_t i = 0, end = other->symbols.size(); i < end; ++i)
 	{
 		if (filter && !filter->at(i))
@@ -1496,22 +2325,20 @@ void Map::importSymbols(Map* other, const MapColorMap& color_map, int insert_pos
 		}
 		
 		// Check if symbol is already present
-		size_t k = 0;
-		size_t symbols_size = symbols.size();
-		for (; k < symbols_size; ++k)
+		auto candidates = symbol_indices.values(other_symbol->contentHash());
+		std::sort(candidates.begin(), candidates.end());
+		auto found = std::find_if(candidates.begin(), candidates.end(), [this, other_symbol](size_t k) {
+			return symbols[k]->equals(other_symbol, Qt::CaseInsensitive, false);
+		});
+		if (found != candidates.end())
 		{
-			if (symbols[k]->equals(other_symbol, Qt::CaseInsensitive, false))
-			{
-				// Symbol is already present
-				if (out_indexmap)
-					out_indexmap->insert(i, k);
-				if (out_pointermap)
-					out_pointermap->insert(other_symbol, symbols[k]);
-				break;
-			}
+			// Symbol is already present
+			if (out_indexmap)
+				out_indexmap->insert(i, *found);
+			if (out_pointermap)
+				out_pointermap->insert(other_symbol, symbols[*found]);
 		}
-		
-		if (k >= symbols_size)
+		else
 		{
 			// Symbols does not exist in this map yet, mark it to be added
 			added_symbols.push_back(other_symbol);
@@ -1551,7 +2378,9 @@ void Map::importSymbols(Map* other, const MapColorMap& color_map, int insert_pos
 void Map::addSelectionRenderables(const Object* object)
 {
 	object->update();
-	selection_renderables->insertRenderablesOfObject(object);
+	if (!selection_renderables_dirty)
+		selection_renderables->insertRenderablesOfObject(object);
+	setSelectionAreaDirty(object->getExtent());
 }
 
 void Map::updateSelectionRenderables(const Object* object)
@@ -1562,7 +2391,35 @@ void Map::updateSelectionRenderables(const Object* object)
 
 void Map::removeSelectionRenderables(const Object* object)
 {
-	selection_renderables->removeRenderablesOfObject(object, false);
+	if (!selection_renderables_dirty)
+		selection_renderables->removeRenderablesOfObject(object, false);
+	setSelectionAreaDirty(object->getExtent());
+}
+
+void Map::invalidateSelectionRenderables(const QRectF& map_coords_rect)
+{
+	selection_renderables_dirty = true;
+	setSelectionAreaDirty(map_coords_rect);
+}
+
+void Map::ensureSelectionRenderables()
+{
+	if (!selection_renderables_dirty)
+		return;
+	
+	selection_renderables->clear();
+	for (const Object* object : object_selection)
+	{
+		object->update();
+		selection_renderables->insertRenderablesOfObject(object);
+	}
+	selection_renderables_dirty = false;
+}
+
+void Map::setSelectionAreaDirty(const QRectF& map_coords_rect)
+{
+	for (MapWidget* widget : widgets)
+		widget->markSelectionAreaDirty(map_coords_rect);
 }
 
 void Map::initStatic()
@@ -1667,8 +2524,10 @@ void Map::setSymbol(Symbol* symbol, int pos)
 			continue;
 		
 		if (symbols[i]->symbolChanged(symbols[pos], symbol))
-			updateAllObjectsWithSymbol(symbols[i]);
+			scheduleUpdateOfAllObjectsWithSymbol(symbols[i]);
 	}
+	for (const Object* object : object_selection)
+		object->update();
 	
 	// Change the symbol
 	symbols[pos] = symbol;
@@ -1734,20 +2593,73 @@ int Map::findSymbolIndex(const Symbol* symbol) const
 
 void Map::setSymbolsDirty()
 {
+	invalidateColorSymbolIndex();
 	symbols_dirty = true;
+	++properties_revision;
 	setHasUnsavedChanges(true);
 }
 
 void Map::updateSymbolIcons(const MapColor* color)
 {
-	for (std::size_t i = 0, size = symbols.size(); i < size; ++i)
+	for (int i : findSymbolsWithColor(color))
+	{
+		symbols[i]->resetIcon();
+		emit(symbolIconChanged(i));
+	}
+}
+
+const std::vector<int>& Map::findSymbolsWithColor(const MapColor* color) const
+{
+	if (!color_symbol_index_valid)
+	{
+		color_symbol_index.clear();
+		color_symbol_index_valid = true;
+	}
+	
+	// The entries are added when a color is looked up for the first time.
+	auto found = color_symbol_index.find(color);
+	if (found == color_symbol_index.end())
 	{
-		if (symbols[i]->containsColor(color))
+		found = color_symbol_index.emplace(color, std::vector<int>()).first;
+		for (std::size_t i = 0, size = symbols.size(); i < size; ++i)
 		{
-			symbols[i]->resetIcon();
-			emit(symbolIconChanged(i));
+			if (symbols[i]->containsColor(color))
+				found->second.push_back(int(i));
 		}
 	}
+	return found->second;
+}
+
+void Map::invalidateColorSymbolIndex()
+{
+	color_symbol_index_valid = false;
+}
+
+void Map::setObjectsWithColorDirty(const MapColor* color)
+{
+	const auto& dependent_symbols = findSymbolsWithColor(color);
+	if (dependent_symbols.empty())
+		return;
+	
+	std::set<const Symbol*> symbols_with_color;
+	for (int i : dependent_symbols)
+		symbols_with_color.insert(symbols[i]);
+	
+	QRectF dirty_rect;
+	for (const MapPart* part : parts)
+	{
+		if (!part->isLoaded())
+			continue;
+		
+		for (int i = 0, size = part->getNumObjects(); i < size; ++i)
+		{
+			const Object* object = part->getObject(i);
+			if (symbols_with_color.count(object->getSymbol()))
+				rectIncludeSafe(dirty_rect, object->getExtent());
+		}
+	}
+	if (dirty_rect.isValid())
+		setObjectAreaDirty(dirty_rect);
 }
 
 void Map::scaleAllSymbols(double factor)
@@ -1767,16 +2679,8 @@ void Map::scaleAllSymbols(double factor)
 void Map::determineSymbolsInUse(std::vector< bool >& out)
 {
 	out.assign(symbols.size(), false);
-	for (std::size_t l = 0; l < parts.size(); ++l)
-	{
-		for (int o = 0; o < parts[l]->getNumObjects(); ++o)
-		{
-			const Symbol* symbol = parts[l]->getObject(o)->getSymbol();
-			int index = findSymbolIndex(symbol);
-			if (index >= 0)
-				out[index] = true;
-		}
-	}
+	for (std::size_t i = 0; i < symbols.size(); ++i)
+		out[i] = existsObjectWithSymbol(symbols[i]);
 	
 	determineSymbolUseClosure(out);
 }
@@ -1847,6 +2751,7 @@ void Map::removeTemplate(int pos)
 		widget->getMapView()->deleteTemplateVisibility(temp);
 	
 	templates.erase(it);
+	template_usage.remove(temp);
 	
 	if (templates.empty())
 	{
@@ -1883,6 +2788,127 @@ void Map::setTemplateAreaDirty(int i)
 	Q_ASSERT(i >= 0 && i < (int)templates.size());
 	
 	templates[i]->setTemplateAreaDirty();
+	
+	// The template may have been shown.
+	if (templates[i]->getTemplateState() == Template::Unloaded)
+		QTimer::singleShot(0, this, SLOT(updateTemplateLoading()));
+}
+
+void Map::setTemplateAreaDirty(const std::vector<int>& positions)
+{
+	for (MapWidget* widget : widgets)
+	{
+		const MapView* map_view = widget->getMapView();
+		QRectF dirty_area[2];
+		int pixel_border[2] = { 0, 0 };
+		for (int i : positions)
+		{
+			if (i == -1)
+				continue;
+			Q_ASSERT(i >= 0 && i < (int)templates.size());
+			
+			Template* temp = templates[i];
+			if (!map_view->isTemplateVisible(temp))
+				continue;
+			
+			const int front_cache = (i >= getFirstFrontTemplate()) ? 1 : 0;
+			rectIncludeSafe(dirty_area[front_cache], map_view->calculateViewBoundingBox(temp->calculateTemplateBoundingBox()));
+			pixel_border[front_cache] = qMax(pixel_border[front_cache], temp->getTemplateBoundingBoxPixelBorder());
+		}
+		
+		for (int front_cache = 0; front_cache < 2; ++front_cache)
+		{
+			if (dirty_area[front_cache].isValid())
+				widget->markTemplateCacheDirty(dirty_area[front_cache], pixel_border[front_cache], front_cache == 1);
+		}
+	}
+	
+	// Some of the templates may have been shown.
+	for (int i : positions)
+	{
+		if (i != -1 && templates[i]->getTemplateState() == Template::Unloaded)
+		{
+			QTimer::singleShot(0, this, SLOT(updateTemplateLoading()));
+			break;
+		}
+	}
+}
+
+void Map::loadVisibleTemplates(const MapView& view)
+{
+	for (Template* temp : templates)
+	{
+		if (!view.isTemplateVisible(temp))
+			continue;
+		
+		if (temp->getTemplateState() == Template::Loading)
+			temp->unloadTemplateFile();
+		if (temp->getTemplateState() == Template::Unloaded)
+		{
+			if (temp->loadTemplateFile(false))
+				temp->setTemplateAreaDirty();
+		}
+	}
+}
+
+void Map::updateTemplateLoading()
+{
+	if (!Settings::getInstance().getSettingCached(Settings::Templates_LoadOnDemand).toBool())
+		return;
+	
+	const qint64 now = QDateTime::currentMSecsSinceEpoch();
+	// In power saving mode, idle templates are kept instead of loading them again.
+	const qint64 idle_time = Settings::getInstance().getSettingCached(Settings::General_PowerSaving).toBool()
+	                         ? 0
+	                         : qint64(Settings::getInstance().getSettingCached(Settings::Templates_UnloadIdleMinutes).toInt()) * 60000;
+	for (Template* temp : templates)
+	{
+		auto usage = template_usage.find(temp);
+		if (usage == template_usage.end())
+			usage = template_usage.insert(temp, { now, QRectF() });
+		
+		const auto state = temp->getTemplateState();
+		if (state == Template::Loaded)
+			usage->extent = temp->calculateTemplateBoundingBox();
+		
+		const auto areas = viewedAreas(temp);
+		const bool shown = std::any_of(begin(areas), end(areas), [usage](const QRectF& area) {
+			return !usage->extent.isValid() || usage->extent.intersects(area);
+		});
+		if (shown)
+		{
+			usage->last_shown = now;
+			if (state == Template::Unloaded)
+				temp->loadTemplateFileAsync();
+		}
+		else if (state == Template::Loaded
+		         && idle_time > 0
+		         && now - usage->last_shown > idle_time
+		         && !temp->hasUnsavedChanges())
+		{
+			temp->setTemplateAreaDirty();
+			temp->unloadTemplateFile();
+		}
+	}
+}
+
+std::vector<QRectF> Map::viewedAreas(const Template* temp) const
+{
+	std::vector<QRectF> areas;
+	areas.reserve(widgets.size());
+	for (const MapWidget* widget : widgets)
+	{
+		const MapView* view = widget->getMapView();
+		if (view->areAllTemplatesHidden() || !view->isTemplateVisible(temp))
+			continue;
+		
+		const QRect rect = widget->rect();
+		QRectF area;
+		for (const auto& corner : { rect.topLeft(), rect.topRight(), rect.bottomLeft(), rect.bottomRight() })
+			rectIncludeSafe(area, widget->viewportToMapF(corner));
+		areas.push_back(area);
+	}
+	return areas;
 }
 
 int Map::findTemplateIndex(const Template* temp) const
@@ -1900,6 +2926,7 @@ int Map::findTemplateIndex(const Template* temp) const
 void Map::setTemplatesDirty()
 {
 	templates_dirty = true;
+	++properties_revision;
 	setHasUnsavedChanges(true);
 }
 
@@ -1926,7 +2953,8 @@ void Map::closeTemplate(int i)
 	Template* temp = getTemplate(i);
 	removeTemplate(i);
 	
-	if (temp->getTemplateState() == Template::Loaded)
+	if (temp->getTemplateState() == Template::Loaded
+	    || temp->getTemplateState() == Template::Loading)
 		temp->unloadTemplateFile();
 	
 	closed_templates.push_back(temp);
@@ -1968,12 +2996,42 @@ void Map::push(UndoStep *step)
 	undo_manager->push(step);
 }
 
+void Map::recordObjectChange(MapChange::Type type, const Object* object, const MapPart* part, const QRectF& extent)
+{
+	change_feed.recordObject(type, object, part, extent);
+	scheduleChangesRecorded();
+}
+
+void Map::recordSymbolChange(MapChange::Type type, const Symbol* symbol)
+{
+	change_feed.recordSymbol(type, symbol);
+	scheduleChangesRecorded();
+}
+
+void Map::recordColorChange(MapChange::Type type, const MapColor* color)
+{
+	change_feed.recordColor(type, color);
+	scheduleChangesRecorded();
+}
+
+void Map::scheduleChangesRecorded()
+{
+	if (change_feed.isRecording() && !change_feed_timer->isActive())
+		change_feed_timer->start();
+}
+
+void Map::emitChangesRecorded()
+{
+	emit changesRecorded(change_feed.version());
+}
+
 
 void Map::addPart(MapPart* part, std::size_t index)
 {
 	Q_ASSERT(index <= parts.size());
 	
 	parts.insert(parts.begin() + index, part);
+	advanceObjectsRevision();
 	if (current_part_index >= index)
 		setCurrentPartIndex(current_part_index + 1);
 	
@@ -2022,6 +3080,18 @@ int Map::findPartIndex(const MapPart* part) const
 	return -1;
 }
 
+void Map::loadDeferredPart()
+{
+	auto part = std::find_if(parts.begin(), parts.end(), [](const MapPart* part) {
+		return !part->isLoaded() && part->loadingError().isEmpty();
+	});
+	if (part != parts.end())
+	{
+		(*part)->ensureLoaded();
+		QTimer::singleShot(0, this, SLOT(loadDeferredPart()));
+	}
+}
+
 void Map::setCurrentPartIndex(std::size_t index)
 {
 	Q_ASSERT(index < parts.size());
@@ -2034,6 +3104,7 @@ void Map::setCurrentPartIndex(std::size_t index)
 	}
 	
 	MapPart* const new_part = parts[current_part_index];
+	new_part->ensureLoaded();
 	if (new_part != old_part)
 	{
 		clearObjectSelection(true);
@@ -2046,24 +3117,19 @@ std::size_t Map::reassignObjectsToMapPart(std::set<Object*>::const_iterator begi
 	Q_ASSERT(source < parts.size());
 	Q_ASSERT(destination < parts.size());
 	
-	std::size_t count = 0;
 	MapPart* const source_part = parts[source];
 	MapPart* const target_part = parts[destination];
-	for (std::set<Object*>::const_iterator it = begin; it != end; ++it)
-	{
-		Object* const object = *it;
-		source_part->deleteObject(object, true);
-
-		int index = target_part->getNumObjects();
-		target_part->addObject(object, index);
-		
-		++count;
-	}
 	
-	setOtherDirty();
+	std::vector<int> positions;
+	positions.reserve(std::size_t(std::distance(begin, end)));
+	for (std::set<Object*>::const_iterator it = begin; it != end; ++it)
+		positions.push_back(source_part->findObjectIndex(*it));
 	
+	std::size_t const target_begin = target_part->getNumObjects();
+	source_part->moveObjectsTo(*target_part, positions);
 	std::size_t const target_end   = target_part->getNumObjects();
-	std::size_t const target_begin = target_end - count;
+	
+	setOtherDirty();
 	
 	if (current_part_index == source)
 	{
@@ -2092,33 +3158,30 @@ std::size_t Map::reassignObjectsToMapPart(std::vector<int>::const_iterator begin
 	
 	bool selection_changed = false;
 	
-	std::size_t count = 0;
 	MapPart* const source_part = parts[source];
 	MapPart* const target_part = parts[destination];
-	for (std::vector<int>::const_iterator it = begin; it != end; ++it)
+	if (current_part_index == source)
 	{
-		Object* const object = source_part->getObject(*it);
-		
-		if (current_part_index == source && isObjectSelected(object))
+		for (std::vector<int>::const_iterator it = begin; it != end; ++it)
 		{
-			removeObjectFromSelection(object, false);
-			selection_changed = true;
+			Object* const object = source_part->getObject(*it);
+			if (isObjectSelected(object))
+			{
+				removeObjectFromSelection(object, false);
+				selection_changed = true;
+			}
 		}
-		
-		source_part->deleteObject(object, true);
-		
-		int index = target_part->getNumObjects();
-		target_part->addObject(object, index);
-		
-		++count;
 	}
 	
+	std::size_t const target_begin = target_part->getNumObjects();
+	source_part->moveObjectsTo(*target_part, std::vector<int>(begin, end));
+	
 	setOtherDirty();
 	
 	if (selection_changed)
 		emit objectSelectionChanged();
 	
-	return target_part->getNumObjects() - count;
+	return target_begin;
 }
 
 std::size_t Map::mergeParts(std::size_t source, std::size_t destination)
@@ -2126,28 +3189,20 @@ std::size_t Map::mergeParts(std::size_t source, std::size_t destination)
 	Q_ASSERT(source < parts.size());
 	Q_ASSERT(destination < parts.size());
 	
-	std::size_t count = 0;
 	MapPart* const source_part = parts[source];
 	MapPart* const target_part = parts[destination];
-	// Preserve order (but not efficient)
-	for (std::size_t i = source_part->getNumObjects(); i > 0 ; --i)
-	{
-		Object* object = source_part->getObject(0);
-		source_part->deleteObject(0, true);
-		
-		int index = target_part->getNumObjects();
-		target_part->addObject(object, index);
-		
-		++count;
-	}
+	if (source == destination)
+		return 0;
+	
+	std::size_t const target_begin = target_part->getNumObjects();
+	source_part->moveAllObjectsTo(*target_part);
 	
 	if (current_part_index == source)
 		setCurrentPartIndex(destination);
 	
-	if (destination != source)
-		removePart(source);
+	removePart(source);
 	
-	return target_part->getNumObjects() - count;
+	return target_begin;
 }
 
 
@@ -2168,6 +3223,19 @@ int Map::addObject(Object* object, int part_index)
 	return object_index;
 }
 
+int Map::addObjects(const std::vector<Object*>& objects, int part_index)
+{
+	MapPart* part = parts[(part_index < 0) ? current_part_index : part_index];
+	int object_index = part->getNumObjects();
+	part->appendObjects(objects);
+	updateObjects();
+	
+	if (object_index == 0 && getNumObjects() == int(objects.size()))
+		updateAllMapWidgets();
+	
+	return object_index;
+}
+
 void Map::deleteObject(Object* object, bool remove_only)
 {
 	for (MapPart* part : parts)
@@ -2184,6 +3252,7 @@ void Map::deleteObject(Object* object, bool remove_only)
 void Map::setObjectsDirty()
 {
 	objects_dirty = true;
+	advanceObjectsRevision();
 	setHasUnsavedChanges(true);
 }
 
@@ -2216,6 +3285,40 @@ void Map::setObjectAreaDirty(QRectF map_coords_rect)
 {
 	for (MapWidget* widget : widgets)
 		widget->markObjectAreaDirty(map_coords_rect);
+	emit objectAreaChanged(map_coords_rect);
+}
+
+void Map::setObjectsWithSymbolAreaDirty(const Symbol* symbol)
+{
+	std::vector<Object*> objects;
+	for (const MapPart* part : parts)
+		part->findObjectsWithSymbol(symbol, objects);
+	
+	QRectF rect;
+	for (const Object* object : objects)
+		rectIncludeSafe(rect, object->getExtent());
+	if (rect.isValid())
+		setObjectAreaDirty(rect);
+}
+
+void Map::setSymbolHidden(Symbol* symbol, bool hidden)
+{
+	if (symbol->isHidden() == hidden)
+		return;
+	
+	symbol->setHidden(hidden);
+	advanceObjectsRevision();
+	// Drawing skips the objects of hidden symbols, so only their area changes.
+	setObjectsWithSymbolAreaDirty(symbol);
+}
+
+void Map::setSymbolProtected(Symbol* symbol, bool is_protected)
+{
+	if (symbol->isProtected() == is_protected)
+		return;
+	
+	symbol->setProtected(is_protected);
+	advanceObjectsRevision();
 }
 
 void Map::findObjectsAt(
@@ -2253,6 +3356,188 @@ void Map::findObjectsAtBox(
 	getCurrentPart()->findObjectsAtBox(corner1, corner2, include_hidden_objects, include_protected_objects, out);
 }
 
+void Map::findAllObjectsAtBox(
+        MapCoordF corner1,
+        MapCoordF corner2,
+        bool include_hidden_objects,
+        bool include_protected_objects,
+        std::vector< Object* >& out ) const
+{
+	for (const MapPart* part : parts)
+		part->findObjectsAtBox(corner1, corner2, include_hidden_objects, include_protected_objects, out);
+}
+
+void Map::advanceObjectsRevision()
+{
+	++objects_revision;
+}
+
+/**
+ * The index of the map's symbols and tags, for findObjects().
+ */
+struct Map::ObjectIndex
+{
+	/// The objects revision for which the index was built.
+	quint64 objects_revision;
+	
+	/// The objects by symbol.
+	QHash<const Symbol*, std::vector<Object*>> by_symbol;
+	
+	/// The objects by tag key.
+	QHash<QString, std::vector<Object*>> by_key;
+	
+	/// The objects by tag key and value.
+	QHash<QPair<QString, QString>, std::vector<Object*>> by_key_value;
+};
+
+QString Map::internTagString(const QString& string) const
+{
+	QMutexLocker locker(&index_mutex);
+	auto found = tag_strings.constFind(string);
+	if (found != tag_strings.constEnd())
+		return *found;
+	
+	tag_strings.insert(string);
+	return string;
+}
+
+void Map::internTags(QHash<QString, QString>& tags) const
+{
+	QHash<QString, QString> interned;
+	interned.reserve(tags.size());
+	for (auto tag = tags.constBegin(), end = tags.constEnd(); tag != end; ++tag)
+		interned.insert(internTagString(tag.key()), internTagString(tag.value()));
+	tags.swap(interned);
+}
+
+std::vector<Object*> Map::findObjectsWithTag(const QString& key) const
+{
+	QMutexLocker locker(&index_mutex);
+	ensureObjectIndex();
+	return object_index->by_key.value(key);
+}
+
+std::vector<Object*> Map::findObjectsWithTag(const QString& key, const QString& value) const
+{
+	QMutexLocker locker(&index_mutex);
+	ensureObjectIndex();
+	return object_index->by_key_value.value(qMakePair(key, value));
+}
+
+std::vector<Object*> Map::findObjects(const ObjectQuery& query) const
+{
+	auto matches = [&query](const Object* object) -> bool {
+		if (query.symbol && object->getSymbol() != query.symbol)
+			return false;
+		if (!query.tag_key.isEmpty())
+		{
+			auto tag = object->tags().constFind(query.tag_key);
+			if (tag == object->tags().constEnd())
+				return false;
+			if (!query.tag_value.isNull() && tag.value() != query.tag_value)
+				return false;
+		}
+		if (query.part && !query.part->contains(object))
+			return false;
+		if (query.area.isValid() && !query.area.intersects(object->getExtent()))
+			return false;
+		return true;
+	};
+	
+	std::vector<Object*> result;
+	
+	// Start from the shortest list of candidates offered by the index.
+	{
+		QMutexLocker locker(&index_mutex);
+		ensureObjectIndex();
+		static const std::vector<Object*> none;
+		const std::vector<Object*>* candidates = nullptr;
+		if (!query.tag_key.isEmpty() && query.tag_value.isNull())
+		{
+			auto found = object_index->by_key.constFind(query.tag_key);
+			candidates = (found == object_index->by_key.constEnd()) ? &none : &*found;
+		}
+		else if (!query.tag_key.isEmpty())
+		{
+			auto found = object_index->by_key_value.constFind(qMakePair(query.tag_key, query.tag_value));
+			candidates = (found == object_index->by_key_value.constEnd()) ? &none : &*found;
+		}
+		if (query.symbol)
+		{
+			auto found = object_index->by_symbol.constFind(query.symbol);
+			const std::vector<Object*>* by_symbol = (found == object_index->by_symbol.constEnd()) ? &none : &*found;
+			if (!candidates || by_symbol->size() < candidates->size())
+				candidates = by_symbol;
+		}
+		if (candidates)
+		{
+			std::copy_if(candidates->begin(), candidates->end(), std::back_inserter(result), matches);
+			return result;
+		}
+	}
+	
+	for (MapPart* part : parts)
+	{
+		if (query.part && part != query.part)
+			continue;
+		
+		if (query.area.isValid())
+		{
+			// The spatial index does not keep the order of the objects.
+			std::vector<Object*> in_area;
+			part->findObjectsInRect(query.area, in_area);
+			if (in_area.empty())
+				continue;
+			const std::unordered_set<const Object*> candidates(in_area.begin(), in_area.end());
+			for (int i = 0, num_objects = part->getNumObjects(); i < num_objects; ++i)
+			{
+				Object* object = part->getObject(i);
+				if (candidates.count(object) && matches(object))
+					result.push_back(object);
+			}
+		}
+		else
+		{
+			for (int i = 0, num_objects = part->getNumObjects(); i < num_objects; ++i)
+			{
+				Object* object = part->getObject(i);
+				if (matches(object))
+					result.push_back(object);
+			}
+		}
+	}
+	return result;
+}
+
+void Map::ensureObjectIndex() const
+{
+	if (object_index && object_index->objects_revision == objects_revision)
+		return;
+	
+	object_index.reset(new ObjectIndex());
+	object_index->objects_revision = objects_revision;
+	for (MapPart* part : parts)
+	{
+		for (int i = 0, num_objects = part->getNumObjects(); i < num_objects; ++i)
+		{
+			Object* object = part->getObject(i);
+			object_index->by_symbol[object->getSymbol()].push_back(object);
+			const Object::Tags& tags = object->tags();
+			for (auto tag = tags.constBegin(), end = tags.constEnd(); tag != end; ++tag)
+			{
+				object_index->by_key[tag.key()].push_back(object);
+				object_index->by_key_value[qMakePair(tag.key(), tag.value())].push_back(object);
+			}
+		}
+	}
+}
+
+void Map::invalidateObjectIndex()
+{
+	QMutexLocker locker(&index_mutex);
+	object_index.reset();
+}
+
 int Map::countObjectsInRect(QRectF map_coord_rect, bool include_hidden_objects)
 {
 	int count = 0;
@@ -2263,46 +3548,178 @@ int Map::countObjectsInRect(QRectF map_coord_rect, bool include_hidden_objects)
 
 void Map::scaleAllObjects(double factor, const MapCoord& scaling_center)
 {
-	applyOnAllObjects(ObjectOp::Scale(factor, scaling_center));
+	scaleObjects(factor, scaling_center);
+	updateObjects();
+}
+
+void Map::scaleObjects(double factor, const MapCoord& scaling_center)
+{
+	const auto center = MapCoordF(scaling_center);
+	transformObjects(allObjects(), [center, factor](Object* object) {
+		object->scale(center, factor);
+	});
 }
 
 void Map::rotateAllObjects(double rotation, const MapCoord& center)
 {
-	applyOnAllObjects(ObjectOp::Rotate(rotation, center));
+	const auto center_f = MapCoordF(center);
+	transformObjects(allObjects(), [center_f, rotation](Object* object) {
+		object->rotateAround(center_f, rotation);
+	});
+	updateObjects();
+}
+
+std::vector<Object*> Map::allObjects()
+{
+	std::vector<Object*> objects;
+	objects.reserve(std::size_t(getNumObjects()));
+	for (MapPart* part : parts)
+	{
+		part->applyOnAllObjects([&objects](Object* object, MapPart*, int) -> bool {
+			objects.push_back(object);
+			return true;
+		});
+	}
+	return objects;
 }
 
 void Map::updateAllObjects()
 {
-	applyOnAllObjects(ObjectOp::ForceUpdate());
+	renderables_generation = newRenderablesGeneration();
+	applyOnAllObjects(ObjectOp::SetOutputDirty());
+	updateObjects();
+}
+
+void Map::scheduleUpdateOfAllObjects()
+{
+	renderables_generation = newRenderablesGeneration();
+	applyOnAllObjects(ObjectOp::SetOutputDirty());
+	object_update_timer->start();
 }
 
 void Map::updateAllObjectsWithSymbol(const Symbol* symbol)
 {
-	applyOnMatchingObjects(ObjectOp::ForceUpdate(), ObjectOp::HasSymbol(symbol));
+	scheduleUpdateOfAllObjectsWithSymbol(symbol);
+	updateObjects();
+}
+
+void Map::scheduleUpdateOfAllObjectsWithSymbol(const Symbol* symbol)
+{
+	renderables_generation = newRenderablesGeneration();
+	std::vector<Object*> objects;
+	for (const MapPart* part : parts)
+		part->findObjectsWithSymbol(symbol, objects);
+	for (Object* object : objects)
+		object->setOutputDirty();
+	object_update_timer->start();
 }
 
 void Map::changeSymbolForAllObjects(const Symbol* old_symbol, const Symbol* new_symbol)
 {
-	applyOnMatchingObjects(ObjectOp::ChangeSymbol(new_symbol), ObjectOp::HasSymbol(old_symbol));
+	renderables_generation = newRenderablesGeneration();
+	for (MapPart* part : parts)
+	{
+		// Setting the symbol changes the index.
+		std::vector<Object*> objects;
+		part->findObjectsWithSymbol(old_symbol, objects);
+		for (Object* object : objects)
+		{
+			if (!object->setSymbol(new_symbol, false))
+				part->deleteObject(object, false);
+			else
+				object->setOutputDirty();
+		}
+	}
+	
+	// The other objects are updated when drawn, without blocking the user
+	// interface. Tools need the selected objects up to date.
+	for (const Object* object : object_selection)
+		object->update();
+	object_update_timer->start();
+}
+
+int Map::changeSymbols(const QHash<const Symbol*, const Symbol*>& mapping)
+{
+	if (mapping.isEmpty())
+		return 0;
+	
+	renderables_generation = newRenderablesGeneration();
+	CombinedUndoStep* undo_step = new CombinedUndoStep(this);
+	int num_changed = 0;
+	bool selection_changed = false;
+	for (std::size_t p = 0; p < parts.size(); ++p)
+	{
+		MapPart* part = parts[p];
+		SwitchSymbolUndoStep* switch_step = nullptr;
+		for (int i = 0, num_objects = part->getNumObjects(); i < num_objects; ++i)
+		{
+			Object* object = part->getObject(i);
+			const Symbol* old_symbol = object->getSymbol();
+			auto found = mapping.constFind(old_symbol);
+			if (found == mapping.constEnd() || found.value() == old_symbol || !found.value()->isTypeCompatibleTo(object))
+				continue;
+			
+			if (!switch_step)
+			{
+				switch_step = new SwitchSymbolUndoStep(this);
+				switch_step->setPartIndex(int(p));
+				undo_step->push(switch_step);
+			}
+			switch_step->addObject(i, old_symbol);
+			object->setSymbol(found.value(), true);
+			selection_changed |= isObjectSelected(object);
+			++num_changed;
+		}
+	}
+	
+	if (num_changed == 0)
+	{
+		delete undo_step;
+		return 0;
+	}
+	
+	updateObjects();
+	setObjectsDirty();
+	push(undo_step);
+	if (selection_changed)
+	{
+		emitSelectionEdited();
+		emitSelectionChanged();
+	}
+	return num_changed;
 }
 
 bool Map::deleteAllObjectsWithSymbol(const Symbol* symbol)
 {
-	bool exists = existsObject(ObjectOp::HasSymbol(symbol));
+	bool exists = existsObjectWithSymbol(symbol);
 	if (exists)
 	{
 		// Remove objects from selection
 		removeSymbolFromSelection(symbol, true);
 	
 		// Delete objects from map
-		applyOnMatchingObjects(ObjectOp::Delete(), ObjectOp::HasSymbol(symbol));
+		for (MapPart* part : parts)
+		{
+			if (!part->existsObjectWithSymbol(symbol))
+				continue;
+			
+			std::vector<int> positions;
+			for (int i = 0, num_objects = part->getNumObjects(); i < num_objects; ++i)
+			{
+				if (part->getObject(i)->getSymbol() == symbol)
+					positions.push_back(i);
+			}
+			part->deleteObjects(positions, false);
+		}
 	}
 	return exists;
 }
 
 bool Map::existsObjectWithSymbol(const Symbol* symbol) const
 {
-	return existsObject(ObjectOp::HasSymbol(symbol));
+	return std::any_of(begin(parts), end(parts), [symbol](const MapPart* part) {
+		return part->existsObjectWithSymbol(symbol);
+	});
 }
 
 void Map::setGeoreferencing(const Georeferencing& georeferencing)
@@ -2320,7 +3737,7 @@ void Map::setGrid(const MapGrid &grid)
 		{
 			MapView* view = widget->getMapView();
 			if (view && view->isGridVisible())
-				view->updateAllMapWidgets();
+				widget->updateGrid();
 		}
 		setOtherDirty();
 	}
@@ -2334,10 +3751,19 @@ bool Map::isAreaHatchingEnabled() const
 
 void Map::setAreaHatchingEnabled(bool enabled)
 {
+	if (enabled == isAreaHatchingEnabled())
+		return;
+	
 	if (enabled)
 		renderable_options |= Symbol::RenderAreasHatched;
 	else
 		renderable_options &= ~Symbol::RenderAreasHatched;
+	
+	// The normal renderables are hatched when drawn. Only the baseline
+	// renderables contain the hatching.
+	if (isBaselineViewEnabled())
+		applyOnMatchingObjects(ObjectOp::ForceUpdate(), ObjectOp::ContainsSymbolType(Symbol::Area));
+	updateAllMapWidgets();
 }
 
 
@@ -2348,10 +3774,31 @@ bool Map::isBaselineViewEnabled() const
 
 void Map::setBaselineViewEnabled(bool enabled)
 {
+	if (enabled == isBaselineViewEnabled())
+		return;
+	
 	if (enabled)
 		renderable_options |= Symbol::RenderBaselines;
 	else
 		renderable_options &= ~Symbol::RenderBaselines;
+	
+	// Switch the renderables of the up-to-date objects. Dirty objects
+	// and deferred map parts get the right renderables when updated.
+	for (MapPart* part : parts)
+	{
+		if (!part->isLoaded())
+			continue;
+		
+		for (int i = 0, count = part->getNumObjects(); i < count; ++i)
+		{
+			const Object* object = part->getObject(i);
+			if (object->isOutputDirty())
+				continue;
+			removeRenderablesOfObject(object, false);
+			insertRenderablesOfObject(object);
+		}
+	}
+	updateAllMapWidgets();
 }
 
 
@@ -2424,9 +3871,62 @@ void Map::setHasUnsavedChanges(bool has_unsaved_changes)
 void Map::setOtherDirty()
 {
 	other_dirty = true;
+	++properties_revision;
 	setHasUnsavedChanges(true);
 }
 
+std::shared_ptr<const Map> Map::snapshot()
+{
+	// Pending updates advance the objects revision.
+	updateObjects();
+	
+	auto current = last_snapshot.lock();
+	if (current
+	    && snapshot_objects_revision == objects_revision
+	    && snapshot_properties_revision == properties_revision)
+	{
+		return current;
+	}
+	
+	// The last job may release the snapshot in a worker thread.
+	auto copy = std::shared_ptr<Map>(new Map(), [](Map* map) {
+		if (map->thread() == QThread::currentThread())
+			delete map;
+		else
+			map->deleteLater();
+	});
+	copy->setGeoreferencing(getGeoreferencing());
+	copy->renderable_options = renderable_options;
+	
+	MapColorMap color_map(copy->color_set->importSet(*color_set, nullptr, copy.get()));
+	QHash<const Symbol*, Symbol*> symbol_map;
+	copy->importSymbols(this, color_map, -1, false, nullptr, nullptr, &symbol_map);
+	
+	// The objects are duplicated and updated concurrently for large parts.
+	for (std::size_t i = 0; i < parts.size(); ++i)
+	{
+		MapPart* part = copy->parts.front();
+		if (i == 0)
+		{
+			part->setName(parts[i]->getName());
+		}
+		else
+		{
+			part = new MapPart(parts[i]->getName(), copy.get());
+			copy->parts.push_back(part);
+		}
+		part->importPart(parts[i], symbol_map, false);
+	}
+	copy->current_part_index = current_part_index;
+	copy->undoManager().clear();
+	copy->setHasUnsavedChanges(false);
+	
+	last_snapshot = copy;
+	snapshot_objects_revision = objects_revision;
+	snapshot_properties_revision = properties_revision;
+	return copy;
+}
+
 // slot
 void Map::undoCleanChanged(bool is_clean)
 {
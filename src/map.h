@@ -22,13 +22,18 @@
 #ifndef _OPENORIENTEERING_MAP_H_
 #define _OPENORIENTEERING_MAP_H_
 
+#include <functional>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include <set>
 
 #include <QHash>
+#include <QMutex>
 #include <QObject>
 #include <QRect>
 #include <QScopedPointer>
+#include <QSet>
 #include <QSharedData>
 #include <QString>
 
@@ -36,11 +41,14 @@
 #include "core/map_coord.h"
 #include "core/map_grid.h"
 #include "file_format.h"
+#include "map_change_feed.h"
 #include "map_part.h"
 
 QT_BEGIN_NAMESPACE
+class QByteArray;
 class QIODevice;
 class QPainter;
+class QTimer;
 class QWidget;
 class QXmlStreamReader;
 class QXmlStreamWriter;
@@ -66,6 +74,31 @@ class UndoStep;
 class OCAD8FileImport;
 class Georeferencing;
 class MapGrid;
+class MapTileStore;
+
+
+/**
+ * The criteria of a query for map objects, cf. Map::findObjects().
+ * 
+ * Criteria which are not set match all objects.
+ */
+struct ObjectQuery
+{
+	/** If not null, the objects must have this symbol. */
+	const Symbol* symbol = nullptr;
+	
+	/** If not empty, the objects must have a tag with this key. */
+	QString tag_key;
+	
+	/** If tag_key is not empty and this is not null, the tag must have this value. */
+	QString tag_value;
+	
+	/** If not null, the objects must belong to this map part. */
+	const MapPart* part = nullptr;
+	
+	/** If valid, the objects' extent must intersect this rectangle. */
+	QRectF area;
+};
 
 /** Central class for an OpenOrienteering map */
 class Map : public QObject
@@ -166,6 +199,41 @@ public:
 	              MapView* view = nullptr,
 	              const FileFormat* format = nullptr);
 	
+	/**
+	 * Exports the map for the given file and format into memory.
+	 * 
+	 * This works like exportTo(), but the file is not written. Instead, the
+	 * contents of the file are returned in data, e.g. for writing the file
+	 * in a BackgroundFileWriter.
+	 */
+	bool exportToData(const QString& path,
+	                  QByteArray& data,
+	                  MapView* view = nullptr,
+	                  const FileFormat* format = nullptr);
+	
+	/**
+	 * Prepares exporting the map for the given file into memory in a worker thread.
+	 * 
+	 * This takes a snapshot of the colors, symbols and objects (cf. snapshot()),
+	 * and it serializes the notes, templates, view, print configuration and
+	 * undo history, which are not part of the snapshot. The returned function
+	 * creates the contents of the file from this state. It may be called in
+	 * any thread, e.g. by a BackgroundFileWriter. On failure, it returns false
+	 * and sets the error string.
+	 * 
+	 * Formats which are not based on the XML format are exported immediately,
+	 * and the returned function only provides the data.
+	 * 
+	 * Shows error messages for errors which are detected immediately, and
+	 * returns an empty function then.
+	 * 
+	 * This function must be called from the thread which owns the map.
+	 */
+	std::function<bool (QByteArray& data, QString& error_string)> prepareExportToData(
+	        const QString& path,
+	        MapView* view = nullptr,
+	        const FileFormat* format = nullptr);
+	
 	/**
 	 * Attempts to load the map from the specified path. Returns true on success.
 	 * 
@@ -174,7 +242,8 @@ public:
 	 *     This should never be nullptr in a QWidgets application.
 	 * @param view If not nullptr, restores this map view.
 	 * @param load_symbols_only Loads only symbols from the chosen file.
-	 *     Useful to load symbol sets.
+	 *     Useful to load symbol sets. Symbol sets are cached by file path and
+	 *     modification time, for repeated loading.
 	 * @param show_error_messages Whether to show import errors and warnings.
 	 */
 	bool loadFrom(const QString& path,
@@ -219,6 +288,29 @@ public:
 	 */
 	void draw(QPainter* painter, const RenderConfig& config);
 	
+	/**
+	 * Draws the part of the map which is visible in the bounding box,
+	 * without updating the renderables first.
+	 * 
+	 * This is meant for maps which are not modified after updateObjects()
+	 * was called, such as map templates. Unlike draw(), it may be called
+	 * from multiple threads at the same time.
+	 * 
+	 * @param painter The QPainter used for drawing.
+	 * @param config  The rendering configuration
+	 */
+	void drawUpdated(QPainter* painter, const RenderConfig& config) const;
+	
+	/**
+	 * Draws the objects of the given map part which are visible in the
+	 * bounding box.
+	 * 
+	 * @param painter The QPainter used for drawing.
+	 * @param config  The rendering configuration
+	 * @param part    The map part to be drawn.
+	 */
+	void drawPart(QPainter* painter, const RenderConfig& config, const MapPart* part);
+	
 	/**
 	 * Draws a spot color overprinting simulation for the part of the map
 	 * which is visible in the given bounding box.
@@ -244,6 +336,44 @@ public:
 	void drawColorSeparation(QPainter* painter, const RenderConfig& config,
 		const MapColor* spot_color, bool use_color = false);
 	
+	/**
+	 * Draws the separations for the given spot colors, one after the other.
+	 * 
+	 * The objects which are visible in the bounding box are determined only
+	 * once for all separations. The function next_separation is called
+	 * before drawing each separation except the first one, e.g. for starting
+	 * a new page.
+	 * 
+	 * @param painter The QPainter used for drawing.
+	 * @param config  The rendering configuration
+	 * @param spot_colors The spot colors to draw the separations for.
+	 * @param next_separation Called between the separations.
+	 */
+	void drawColorSeparations(QPainter* painter, const RenderConfig& config,
+		const std::vector<const MapColor*>& spot_colors, const std::function<void ()>& next_separation);
+	
+	/**
+	 * Draws the objects which are visible in the bounding box one after the
+	 * other, calling begin_object before each object and color.
+	 * 
+	 * This is slower than draw(). It is meant for paint devices which need to
+	 * attribute the drawing operations to objects, e.g. for vector exports.
+	 * 
+	 * @param painter The QPainter used for drawing.
+	 * @param config  The rendering configuration
+	 * @param begin_object Called before the renderables of an object are drawn in a color.
+	 */
+	void drawObjectsSeparately(QPainter* painter, const RenderConfig& config,
+		const std::function<void (const Object*, const MapColor*)>& begin_object);
+	
+	/**
+	 * Returns true if the renderables of any object touch the given rect.
+	 * 
+	 * This is a fast test based on the spatial index of the renderables.
+	 * The renderables must be up to date, cf. updateObjects().
+	 */
+	bool hasRenderablesAt(const QRectF& map_coords_rect) const;
+	
 	/**
 	 * Draws the map grid.
 	 * 
@@ -278,9 +408,73 @@ public:
 	/**
 	 * Updates the renderables and extent of all objects which have changed.
 	 * This is automatically called by draw(), you normally do not need to call it directly.
+	 * 
+	 * Only the objects which were scheduled by scheduleObjectUpdate() are
+	 * visited, so the cost depends on the number of changed objects, not on
+	 * the size of the map.
+	 * 
+	 * When there are many objects to be updated, their renderables are
+	 * generated by multiple threads. The map's renderables are still updated
+	 * by the calling thread.
 	 */
 	void updateObjects();
 	
+	/**
+	 * Updates the objects which have changed, for about the given time.
+	 * 
+	 * This is meant for drawing on screen without blocking the user
+	 * interface when many objects need an update, e.g. after a symbol was
+	 * changed. The objects are updated in batches until the time is used
+	 * up, and the remaining objects are updated later, from the event loop.
+	 * Until then, these objects keep their previous renderables, so that
+	 * drawUpdated() shows them unchanged. Each updated object marks its
+	 * area as dirty, so that map widgets redraw it.
+	 * 
+	 * If visible_rect is valid, the objects whose previous extent intersects
+	 * this rect (in map coordinates) are updated first.
+	 * 
+	 * Returns true if there are no more objects to be updated.
+	 */
+	bool updateObjectsFor(int msecs, const QRectF& visible_rect = QRectF());
+	
+	/**
+	 * Releases memory which is occupied by unused containers of renderables.
+	 * 
+	 * When objects are updated, their renderables keep entries for symbol
+	 * configurations and colors which are no longer used, and the containers
+	 * keep their excess capacity. After many updates, this memory is released
+	 * from the event loop in small steps when the objects are not being
+	 * updated, so there is normally no need to call this function directly.
+	 * Objects which are waiting for an update are skipped.
+	 * 
+	 * Returns the approximate number of bytes which were released.
+	 */
+	qint64 compactRenderables();
+	
+	/**
+	 * Returns the approximate number of bytes which were released by the
+	 * compaction of renderables since the map was loaded.
+	 */
+	qint64 getReclaimedRenderablesMemory() const;
+	
+	/**
+	 * Schedules an object for the next updateObjects().
+	 * 
+	 * This is called by Object::setOutputDirty(). Objects which are not
+	 * contained in one of the map's parts at the time of the update are
+	 * ignored, so it is safe to schedule objects which will be removed
+	 * or deleted before the update.
+	 */
+	void scheduleObjectUpdate(const Object* object);
+	
+	/**
+	 * Returns true if objects were scheduled for an update which did not
+	 * happen yet.
+	 * 
+	 * The extents of such objects may be outdated.
+	 */
+	bool hasScheduledObjectUpdates() const;
+	
 	/** 
 	 * Calculates the extent of all map elements. 
 	 * 
@@ -302,6 +496,12 @@ public:
 	 */
 	void removeMapWidget(MapWidget* widget);
 	
+	/**
+	 * Returns the store of rendered map tiles which is shared by the widgets
+	 * of this map, see MapTileCache.
+	 */
+	const std::shared_ptr<MapTileStore>& getMapTileStore() const;
+	
 	/**
 	 * Redraws all map widgets completely - this can be slow!
 	 * Try to avoid this and do partial redraws instead, if possible.
@@ -417,6 +617,15 @@ public:
 	 */
 	int findColorIndex(const MapColor* color) const;
 	
+	/**
+	 * Returns the current priority of the color with the given render key.
+	 * 
+	 * Renderables identify their colors by render key, cf.
+	 * MapColor::getRenderKey(). Negative keys are returned unchanged.
+	 * For unknown keys, the result is not a valid color index.
+	 */
+	int renderKeyToPriority(int render_key) const;
+	
 	/**
 	 * Marks the colors as "dirty", i.e. as having unsaved changes.
 	 * Emits hasUnsavedChanges(true) if the map did not have unsaved changed before.
@@ -507,6 +716,15 @@ public:
 	 */
 	void updateSymbolIcons(const MapColor* color);
 	
+	/**
+	 * Returns the indices of the symbols which contain the given color.
+	 * 
+	 * The result is taken from an index of the colors' dependent symbols.
+	 * The entry for a color is built when it is requested first. The index
+	 * is discarded when symbols or colors are added, changed or deleted.
+	 */
+	const std::vector<int>& findSymbolsWithColor(const MapColor* color) const;
+	
 	/**
 	 * Scales all symbols by the given factor.
 	 */
@@ -591,6 +809,31 @@ public:
 	 */
 	void setTemplateAreaDirty(int i);
 	
+	/**
+	 * Marks the whole area of the templates at the given positions
+	 * as "to be repainted".
+	 * 
+	 * This is equivalent to calling setTemplateAreaDirty(int) for each
+	 * position, but it invalidates the template caches of each widget
+	 * only once. Positions of -1 are ignored.
+	 */
+	void setTemplateAreaDirty(const std::vector<int>& positions);
+	
+	/**
+	 * Loads the templates which are visible in the given view but not loaded.
+	 * Templates which are loading in the background are loaded immediately.
+	 * 
+	 * This is needed before printing when templates are loaded on demand,
+	 * see updateTemplateLoading().
+	 */
+	void loadVisibleTemplates(const MapView& view);
+	
+	/**
+	 * Returns the map areas shown by the map widgets
+	 * in which the given template is visible.
+	 */
+	std::vector<QRectF> viewedAreas(const Template* temp) const;
+	
 	/**
 	 * Loops over all templates in the map and looks for the given template pointer.
 	 * Returns the index of the template. The template must be contained in the map,
@@ -668,6 +911,30 @@ public:
 	void push(UndoStep* step);
 	
 	
+	// Change feed
+	
+	/**
+	 * Returns the feed of the changes of objects, symbols and colors.
+	 * 
+	 * While the feed has consumers, changesRecorded() is emitted once for
+	 * each batch of changes, when control returns to the event loop.
+	 */
+	MapChangeFeed& changeFeed();
+	
+	/**
+	 * Returns the feed of the changes of objects, symbols and colors.
+	 */
+	const MapChangeFeed& changeFeed() const;
+	
+	/**
+	 * Records a change of an object in the change feed.
+	 * 
+	 * This is called by the map parts and by the objects. The part may be
+	 * nullptr if it is not known.
+	 */
+	void recordObjectChange(MapChange::Type type, const Object* object, const MapPart* part, const QRectF& extent);
+	
+	
 	// Map parts
 	
 	/**
@@ -769,6 +1036,17 @@ public:
 	 */
 	int addObject(Object* object, int part_index = -1);
 	
+	/**
+	 * Adds the objects at the end of the part with the given index,
+	 * or of the current part if the default -1 is passed.
+	 * Returns the index of the first added object in the part.
+	 * 
+	 * The objects are updated by updateObjects(), i.e. concurrently when
+	 * there are many of them. This is much faster than adding the objects
+	 * one by one.
+	 */
+	int addObjects(const std::vector<Object*>& objects, int part_index = -1);
+	
 	/**
 	 * Deletes the given object from the map.
 	 * remove_only will remove the object from the map, but not call "delete object";
@@ -790,6 +1068,31 @@ public:
 	 */
 	void setObjectAreaDirty(QRectF map_coords_rect);
 	
+	/**
+	 * Marks the area covered by the objects with the given symbol as "dirty",
+	 * i.e. as "must be redrawn".
+	 * 
+	 * This is what needs to be redrawn when the symbol is hidden or shown.
+	 * The objects are taken from the map parts' symbol index.
+	 */
+	void setObjectsWithSymbolAreaDirty(const Symbol* symbol);
+	
+	/**
+	 * Hides or shows the objects with the given symbol.
+	 * 
+	 * This advances the objects revision, because queries skip the objects
+	 * of hidden symbols, and it marks the area of these objects as dirty.
+	 */
+	void setSymbolHidden(Symbol* symbol, bool hidden);
+	
+	/**
+	 * Protects or unprotects the objects with the given symbol.
+	 * 
+	 * This advances the objects revision, because queries may skip the
+	 * objects of protected symbols.
+	 */
+	void setSymbolProtected(Symbol* symbol, bool is_protected);
+	
 	/**
 	 * Finds and returns all objects at the given position in the current part.
 	 * 
@@ -840,6 +1143,86 @@ public:
 		bool include_hidden_objects, bool include_protected_objects,
 		std::vector<Object*>& out) const;
 	
+	/**
+	 * Finds and returns all objects intersecting the given box in all parts.
+	 * 
+	 * @see Map::findObjectsAtBox
+	 */
+	void findAllObjectsAtBox(MapCoordF corner1, MapCoordF corner2,
+		bool include_hidden_objects, bool include_protected_objects,
+		std::vector<Object*>& out) const;
+	
+	/**
+	 * Returns a number which changes whenever objects are added to or
+	 * removed from the map parts, whenever an object's extent is
+	 * recalculated, whenever the objects are marked as dirty, and whenever
+	 * a symbol is hidden, shown, protected or unprotected.
+	 * 
+	 * As long as this number does not change, the result of queries such
+	 * as findAllObjectsAtBox() remain valid, and the object pointers
+	 * remain valid.
+	 */
+	quint64 getObjectsRevision() const;
+	
+	/**
+	 * Changes the objects revision.
+	 * 
+	 * This is called by the map parts. See getObjectsRevision().
+	 */
+	void advanceObjectsRevision();
+	
+	/**
+	 * Returns a string which is equal to the given tag key or value, and
+	 * which shares its data with all equal strings returned before.
+	 * 
+	 * Imported data often carries the same few keys and values on many
+	 * objects. Interned strings store the characters only once per map.
+	 * This function is thread-safe.
+	 */
+	QString internTagString(const QString& string) const;
+	
+	/**
+	 * Replaces the keys and values of the given tags by interned strings.
+	 * 
+	 * @see internTagString()
+	 */
+	void internTags(QHash<QString, QString>& tags) const;
+	
+	/**
+	 * Returns the objects which have a tag with the given key, in map order.
+	 * 
+	 * The query uses an index of all symbols and tags which is built on
+	 * first use, and which is kept until objects are added, removed or
+	 * modified.
+	 */
+	std::vector<Object*> findObjectsWithTag(const QString& key) const;
+	
+	/**
+	 * Returns the objects which have a tag with the given key and value,
+	 * in map order.
+	 * 
+	 * @see findObjectsWithTag(const QString&)
+	 */
+	std::vector<Object*> findObjectsWithTag(const QString& key, const QString& value) const;
+	
+	/**
+	 * Returns the objects which match all criteria of the query, in map order.
+	 * 
+	 * The candidates are taken from the index of symbols and tags, or from
+	 * the parts' spatial index, so that queries on large maps do not need
+	 * to visit all objects. The objects' extents must be up to date,
+	 * cf. updateObjects().
+	 */
+	std::vector<Object*> findObjects(const ObjectQuery& query) const;
+	
+	/**
+	 * Discards the index which is used by findObjectsWithTag() and
+	 * findObjects().
+	 * 
+	 * This is called by objects when their symbol or tags are modified.
+	 */
+	void invalidateObjectIndex();
+	
 	/**
 	 * Counts the objects whose bounding boxes intersect the given rect.
 	 * 
@@ -875,21 +1258,79 @@ public:
 	template<typename Operation>
 	bool applyOnAllObjects(const Operation& operation);
 	
-	/** Scales all objects by the given factor. */
+	/**
+	 * Scales all objects by the given factor.
+	 * 
+	 * The coordinates are transformed and the renderables are generated
+	 * concurrently for many objects.
+	 */
 	void scaleAllObjects(double factor, const MapCoord& scaling_center);
 	
-	/** Rotates all objects by the given rotation angle (in radians). */
+	/**
+	 * Rotates all objects by the given rotation angle (in radians).
+	 * 
+	 * The coordinates are transformed and the renderables are generated
+	 * concurrently for many objects.
+	 */
 	void rotateAllObjects(double rotation, const MapCoord& center);
 	
-	/** Forces an update of all objects, i.e. calls update(true) on each map object. */
+	/**
+	 * Forces an update of all objects.
+	 * 
+	 * The objects are marked as dirty and updated by updateObjects(), which
+	 * generates the renderables of large numbers of objects concurrently.
+	 */
 	void updateAllObjects();
 	
-	/** Forces an update of all objects with the given symbol. */
+	/**
+	 * Marks all objects as dirty, like updateAllObjects(), but leaves the
+	 * update to the next drawing or to updateObjects().
+	 */
+	void scheduleUpdateOfAllObjects();
+	
+	/** Forces an update of all objects with the given symbol, like updateAllObjects(). */
 	void updateAllObjectsWithSymbol(const Symbol* symbol);
 	
-	/** For all symbols with old_symbol, replaces the symbol by new_symbol. */
+	/**
+	 * Marks all objects with the given symbol as dirty, like
+	 * updateAllObjectsWithSymbol(), but leaves the update to the next
+	 * drawing or to updateObjects().
+	 */
+	void scheduleUpdateOfAllObjectsWithSymbol(const Symbol* symbol);
+	
+	/**
+	 * Returns a number which changes whenever all objects, or all objects
+	 * with a particular symbol, are forced to update.
+	 * 
+	 * Such updates follow changes of symbols or colors. Thus symbols may
+	 * share renderables between the objects of the same generation. The
+	 * number is unique among all maps.
+	 */
+	int getRenderablesGeneration() const;
+	
+	/**
+	 * For all objects with old_symbol, replaces the symbol by new_symbol.
+	 * 
+	 * Only the selected objects are updated immediately. The other objects
+	 * are updated by the next updateObjects(), or updateObjectsFor() in the
+	 * background.
+	 */
 	void changeSymbolForAllObjects(const Symbol* old_symbol, const Symbol* new_symbol);
 	
+	/**
+	 * For all objects, replaces the symbol according to the given mapping
+	 * from old symbols to new symbols, and pushes a single undo step.
+	 * 
+	 * All objects are visited once, regardless of the size of the mapping.
+	 * Objects which are not compatible to the new symbol keep their symbol.
+	 * The changed objects are updated by updateObjects(), i.e. concurrently
+	 * when there are many of them. This is much faster than calling
+	 * changeSymbolForAllObjects() for each symbol of a symbol set.
+	 * 
+	 * @return The number of changed objects.
+	 */
+	int changeSymbols(const QHash<const Symbol*, const Symbol*>& mapping);
+	
 	/**
 	 * Deletes all objects with the given symbol.
 	 * 
@@ -901,6 +1342,9 @@ public:
 	 * Returns if at least one object with the given symbol exists in the map.
 	 * WARNING: Even if no objects exist directly, the symbol could still be
 	 *          required by another (combined) symbol used by an object!
+	 * 
+	 * This function and the ones above use the map parts' symbol index, so
+	 * they touch only the objects with the given symbol.
 	 */
 	bool existsObjectWithSymbol(const Symbol* symbol) const;
 	
@@ -916,12 +1360,32 @@ public:
 	 */
 	void insertRenderablesOfObject(const Object* object);
 	
+	/**
+	 * Updates the spatial index entry of the given object in its map part.
+	 * 
+	 * This is called when the object's extent was recalculated.
+	 */
+	void updateSpatialIndex(const Object* object);
+	
+	/**
+	 * Updates the symbol index entry of the given object in its map part.
+	 * 
+	 * This is called when the object's symbol was changed from old_symbol.
+	 */
+	void updateSymbolIndex(Object* object, const Symbol* old_symbol);
+	
 	
 	/**
 	 * Marks an object as irregular.
 	 */
 	void markAsIrregular(Object* object);
 	
+	/**
+	 * Removes the mark of an object which is deleted before it was added
+	 * to a map part.
+	 */
+	void unmarkAsIrregular(Object* object);
+	
 	/**
 	 * Returns the list of objects marked as irregular.
 	 */
@@ -997,6 +1461,11 @@ public:
 	 *     Of the selection renderables. TODO: HACK
 	 * @param draw_normal If set to true, draws the objects like normal objects,
 	 *     otherwise draws transparent highlights.
+	 * 
+	 * Unless replacement renderables are given, the selection is drawn via
+	 * the widget's selection cache. Only the parts of the cache which were
+	 * affected by changes of the selection or of the selected objects are
+	 * redrawn.
 	 */
 	void drawSelection(QPainter* painter, bool force_min_size, MapWidget* widget,
 		MapRenderables* replacement_renderables = nullptr, bool draw_normal = false);
@@ -1017,6 +1486,33 @@ public:
 	 */
 	void removeObjectFromSelection(Object* object, bool emit_selection_changed);
 	
+	/**
+	 * Adds the given objects to the selection.
+	 * 
+	 * Objects which are already selected are skipped. Unlike repeated calls
+	 * of addObjectToSelection(), this does not build the selection
+	 * renderables for each object. They are rebuilt when the selection is
+	 * drawn next time. Returns the number of objects which were added.
+	 * 
+	 * @param objects The objects to add.
+	 * @param emit_selection_changed If set to true, objectSelectionChanged()
+	 *     is emitted once if any object was added.
+	 */
+	std::size_t addObjectsToSelection(const std::vector<Object*>& objects, bool emit_selection_changed);
+	
+	/**
+	 * Removes the given objects from the selection.
+	 * 
+	 * Objects which are not selected are skipped. Like addObjectsToSelection(),
+	 * this defers the update of the selection renderables. Returns the number
+	 * of objects which were removed.
+	 * 
+	 * @param objects The objects to remove.
+	 * @param emit_selection_changed If set to true, objectSelectionChanged()
+	 *     is emitted once if any object was removed.
+	 */
+	std::size_t removeObjectsFromSelection(const std::vector<Object*>& objects, bool emit_selection_changed);
+	
 	/**
 	 * Removes from the selection all objects with the given symbol.
 	 * Returns true if at least one object has been removed.
@@ -1134,14 +1630,25 @@ public:
 	/** Returns if area hatching is enabled. */
 	bool isAreaHatchingEnabled() const;
 	
-	/** Sets if area hatching is enabled. */
+	/**
+	 * Sets if area hatching is enabled.
+	 * 
+	 * Map widgets draw the objects' normal renderables with hatched area
+	 * fills, so only the baseline renderables need to be regenerated.
+	 */
 	void setAreaHatchingEnabled(bool enabled);
 	
 	
 	/** Returns if the baseline view is enabled. */
 	bool isBaselineViewEnabled() const;
 	
-	/** Sets if the baseline view is enabled. */
+	/**
+	 * Sets if the baseline view is enabled.
+	 * 
+	 * The objects keep their normal renderables. When the setting changes,
+	 * the map switches to the objects' baseline renderables, which are
+	 * generated on demand, or back.
+	 */
 	void setBaselineViewEnabled(bool enabled);
 	
 	
@@ -1220,6 +1727,34 @@ public:
 	 */
 	void setOtherDirty();
 	
+	/**
+	 * Returns a number which changes whenever the colors, the symbols, the
+	 * template settings or other properties are marked as dirty.
+	 * 
+	 * Unlike object changes, these changes are not recorded by the undo
+	 * manager.
+	 */
+	quint64 getPropertiesRevision() const;
+	
+	/**
+	 * Returns an immutable copy of the map's colors, symbols and objects.
+	 * 
+	 * The copy is meant for jobs in worker threads which need a consistent
+	 * state of the map while the user continues editing, such as background
+	 * rendering or exporting. Its renderables are up to date, so it may be
+	 * drawn by drawUpdated() from multiple threads at the same time. Other
+	 * const functions which do not update objects are safe, too. The copy
+	 * has no templates, undo steps or selection.
+	 * 
+	 * As long as a snapshot is in use and the objects and properties
+	 * revisions of this map do not change, repeated calls return the same
+	 * snapshot. Otherwise a new one is created. The snapshot is destroyed
+	 * when the last job releases it, in the thread which created it.
+	 * 
+	 * This function must be called from the thread which owns the map.
+	 */
+	std::shared_ptr<const Map> snapshot();
+	
 	
 	// Static
 	
@@ -1313,6 +1848,13 @@ signals:
 	void selectedObjectEdited();
 
 	
+	/**
+	 * Emitted when objects were changed, added or removed in the given area.
+	 * 
+	 * This accompanies setObjectAreaDirty().
+	 */
+	void objectAreaChanged(const QRectF& map_coords_rect);
+	
 	/**
 	 * Emitted when the map part currently used for drawing changes.
 	 * 
@@ -1344,11 +1886,55 @@ signals:
 	 */
 	void mapPartDeleted(std::size_t index, const MapPart* part);
 	
+	/**
+	 * Emitted when the deferred loading of the objects of a part failed.
+	 * 
+	 * The part remains without objects, and the map cannot be saved.
+	 * This may be emitted from functions which access the part's objects,
+	 * so receivers which interact with the user should use a queued
+	 * connection.
+	 * 
+	 * @see MapPart::loadingError()
+	 */
+	void mapPartLoadingFailed(const QString& part_name, const QString& error);
+	
+	/**
+	 * Emitted after changes were recorded in the change feed.
+	 * 
+	 * @see changeFeed()
+	 */
+	void changesRecorded(quint64 version);
+	
 protected slots:
 	void checkSpotColorPresence();
 	
+	/**
+	 * Loads the objects of the first map part whose loading was deferred,
+	 * and schedules the next call if there are more such parts.
+	 */
+	void loadDeferredPart();
+	
+	/**
+	 * Loads and unloads templates on demand, if enabled in the settings.
+	 * 
+	 * A template is loaded when it is visible in the view of a map widget
+	 * and its last known extent (if any) intersects the widget's viewport.
+	 * A template which was not shown for the configured idle time is unloaded,
+	 * unless it has unsaved changes.
+	 */
+	void updateTemplateLoading();
+	
 	void undoCleanChanged(bool is_clean);
 	
+	/** Continues the updates of objects which were left by updateObjectsFor(). */
+	void continueObjectUpdates();
+	
+	/** Continues the compaction of renderables when the map is idle. */
+	void continueRenderablesCompaction();
+	
+	/** Emits changesRecorded() for the current batch of changes. */
+	void emitChangesRecorded();
+	
 private:
 	typedef std::vector<MapColor*> ColorVector;
 	typedef std::vector<Symbol*> SymbolVector;
@@ -1356,6 +1942,13 @@ private:
 	typedef std::vector<MapPart*> PartVector;
 	typedef std::vector<MapWidget*> WidgetVector;
 	
+	/** Information for loading templates on demand */
+	struct TemplateUsage
+	{
+		qint64 last_shown;  ///< The time when the template was last shown, in ms since the epoch
+		QRectF extent;      ///< The template's bounding box when it was last loaded
+	};
+	
 	class MapColorSet : public QSharedData
 	{
 	public:
@@ -1386,11 +1979,26 @@ private:
 		                      std::vector<bool>* filter = nullptr,
 		                      Map* map = nullptr);
 		
+		/**
+		 * Gives the color a new render key if its key is already used
+		 * by another color in this set.
+		 */
+		void makeRenderKeyUnique(MapColor* color);
+		
+		/**
+		 * @see Map::renderKeyToPriority()
+		 */
+		int renderKeyToPriority(int render_key) const;
+		
 	private:
 		/**
 		 * Adjust the priorities of the colors in the range [first,last).
 		 */
 		void adjustColorPriorities(int first, int last);
+		
+		/** The priorities by render key, rebuilt when outdated. */
+		mutable std::vector<int> priorities_by_render_key;
+		mutable QMutex render_key_mutex;
 	};
 	
 	/// Imports the other symbol set into this set, only importing the symbols for which filter[color_index] == true and
@@ -1398,15 +2006,122 @@ private:
 	void importSymbols(Map* other, const MapColorMap& color_map, int insert_pos = -1, bool merge_duplicates = true, std::vector<bool>* filter = nullptr,
 					   QHash<int, int>* out_indexmap = nullptr, QHash<const Symbol*, Symbol*>* out_pointermap = nullptr);
 	
+	/**
+	 * Replaces the map's content with a copy of the cached symbol set which
+	 * was loaded from the given file.
+	 * 
+	 * Returns false if there is no such symbol set, or if the file was
+	 * modified after it was loaded.
+	 */
+	bool loadSymbolSetFromCache(const QString& path);
+	
+	/**
+	 * Scales all objects by the given factor, concurrently for many objects.
+	 * 
+	 * The objects are marked as dirty but not updated.
+	 */
+	void scaleObjects(double factor, const MapCoord& scaling_center);
+	
+	/** Returns the objects of all map parts. */
+	std::vector<Object*> allObjects();
+	
+	/**
+	 * Adds a copy of the map's symbol set to the cache, for repeated loading
+	 * from the given file with Map::loadFrom() with load_symbols_only.
+	 */
+	void cacheSymbolSet(const QString& path) const;
+	
+	/**
+	 * Imports the georeferencing, all colors and all symbols of the other map.
+	 * 
+	 * This map is expected to be empty.
+	 */
+	void importSymbolSet(Map* other);
+	
+	/** Updates the given objects which are still in the map and dirty. */
+	void updateObjects(std::vector<const Object*>& objects);
+	
+	/**
+	 * Compacts the renderables of the objects for about the given time,
+	 * continuing where the previous call stopped. A negative time means
+	 * no limit.
+	 * 
+	 * Returns true when all objects are done.
+	 */
+	bool compactRenderablesFor(int msecs);
+	
+	/**
+	 * Moves the renderables to the current priorities of their colors,
+	 * after colors were added, removed or reordered.
+	 */
+	void updateRenderablesColorPriorities();
+	
+	/** Records a change of a symbol in the change feed. */
+	void recordSymbolChange(MapChange::Type type, const Symbol* symbol);
+	
+	/** Records a change of a color in the change feed. */
+	void recordColorChange(MapChange::Type type, const MapColor* color);
+	
+	/** Starts the timer for changesRecorded() if needed. */
+	void scheduleChangesRecorded();
+	
 	void addSelectionRenderables(const Object* object);
 	void updateSelectionRenderables(const Object* object);
 	void removeSelectionRenderables(const Object* object);
 	
+	/**
+	 * Marks the selection renderables as outdated, after bulk changes of the
+	 * selection. The given rect is marked as dirty in the selection caches.
+	 */
+	void invalidateSelectionRenderables(const QRectF& map_coords_rect);
+	
+	/**
+	 * Rebuilds the selection renderables if they were invalidated.
+	 */
+	void ensureSelectionRenderables();
+	
+	/**
+	 * Marks the given area of the selection cache of all widgets as dirty.
+	 */
+	void setSelectionAreaDirty(const QRectF& map_coords_rect);
+	
+	/**
+	 * Marks the area of all objects whose symbols contain the given color
+	 * as dirty.
+	 * 
+	 * The renderables refer to colors by priority, so changing the definition
+	 * of a color needs to repaint these objects, but not to update them.
+	 */
+	void setObjectsWithColorDirty(const MapColor* color);
+	
+	/**
+	 * Discards the index of the colors' dependent symbols.
+	 */
+	void invalidateColorSymbolIndex();
+	
+	/**
+	 * Finds the format for exporting the map to the given path, and prepares
+	 * the templates and map parts for export.
+	 * 
+	 * Shows an error message and returns nullptr on failure.
+	 */
+	const FileFormat* prepareExport(const QString& path, const FileFormat* format);
+	
+	/**
+	 * Exports the map for the given path to the given device.
+	 * 
+	 * Shows error messages and warnings. A QSaveFile is committed on success.
+	 */
+	bool exportToDevice(QIODevice& device, const QString& path, MapView* view, const FileFormat* format);
+	
 	static void initStatic();
 	
 	QExplicitlySharedDataPointer<MapColorSet> color_set;
 	bool has_spot_colors;
 	SymbolVector symbols;
+	/// See findSymbolsWithColor().
+	mutable std::unordered_map<const MapColor*, std::vector<int>> color_symbol_index;
+	mutable bool color_symbol_index_valid;
 	TemplateVector templates;
 	TemplateVector closed_templates;
 	int first_front_template;		// index of the first template in templates which should be drawn in front of the map
@@ -1416,8 +2131,16 @@ private:
 	QScopedPointer<UndoManager> undo_manager;
 	std::size_t current_part_index;
 	WidgetVector widgets;
+	std::shared_ptr<MapTileStore> map_tile_store;
+	QHash<const Template*, TemplateUsage> template_usage;
+	QTimer* template_loading_timer;
+	QTimer* object_update_timer;
+	QTimer* renderables_compaction_timer;
+	QTimer* change_feed_timer;
+	MapChangeFeed change_feed;
 	QScopedPointer<MapRenderables> renderables;
 	QScopedPointer<MapRenderables> selection_renderables;
+	bool selection_renderables_dirty;  ///< Indicates that the selection renderables must be rebuilt.
 	
 	QString map_notes;
 	
@@ -1443,6 +2166,54 @@ private:
 	
 	std::set<Object*> irregular_objects;
 	
+	/// Objects which were scheduled for update, see scheduleObjectUpdate().
+	/// Never dereference an element unless it is found in one of the parts!
+	std::vector<const Object*> dirty_objects;
+	
+	/// See getObjectsRevision().
+	quint64 objects_revision;
+	
+	/// See getPropertiesRevision().
+	quint64 properties_revision;
+	
+	/// See snapshot().
+	std::weak_ptr<const Map> last_snapshot;
+	quint64 snapshot_objects_revision;
+	quint64 snapshot_properties_revision;
+	
+	/// See getRenderablesGeneration().
+	int renderables_generation;
+	
+	/// The number of insertions of renderables, for triggering the compaction.
+	quint64 renderables_insertions;
+	
+	/// The value of renderables_insertions when the last compaction was completed.
+	quint64 compacted_insertions;
+	
+	/// The value of renderables_insertions when continueRenderablesCompaction() was called last.
+	quint64 checked_insertions;
+	
+	/// The position of the next object to be compacted, see compactRenderablesFor().
+	std::size_t compaction_part;
+	int compaction_object;
+	
+	/// See getReclaimedRenderablesMemory().
+	qint64 reclaimed_renderables_memory;
+	
+	struct ObjectIndex;
+	
+	/// Builds the object index unless it is up to date. index_mutex must be locked.
+	void ensureObjectIndex() const;
+	
+	/// Protects tag_strings and object_index.
+	mutable QMutex index_mutex;
+	
+	/// The tag keys and values, see internTagString().
+	mutable QSet<QString> tag_strings;
+	
+	/// The index for findObjects(), or null when it must be rebuilt.
+	mutable QScopedPointer<ObjectIndex> object_index;
+	
 	// Static
 	
 	static bool static_initialized;
@@ -1581,6 +2352,18 @@ const UndoManager& Map::undoManager() const
 	return *(undo_manager.data());
 }
 
+inline
+MapChangeFeed& Map::changeFeed()
+{
+	return change_feed;
+}
+
+inline
+const MapChangeFeed& Map::changeFeed() const
+{
+	return change_feed;
+}
+
 inline
 int Map::getNumParts() const
 {
@@ -1611,6 +2394,42 @@ std::size_t Map::getCurrentPartIndex() const
 	return current_part_index;
 }
 
+inline
+quint64 Map::getObjectsRevision() const
+{
+	return objects_revision;
+}
+
+inline
+quint64 Map::getPropertiesRevision() const
+{
+	return properties_revision;
+}
+
+inline
+bool Map::hasScheduledObjectUpdates() const
+{
+	return !dirty_objects.empty();
+}
+
+inline
+int Map::getRenderablesGeneration() const
+{
+	return renderables_generation;
+}
+
+inline
+qint64 Map::getReclaimedRenderablesMemory() const
+{
+	return reclaimed_renderables_memory;
+}
+
+inline
+const std::shared_ptr<MapTileStore>& Map::getMapTileStore() const
+{
+	return map_tile_store;
+}
+
 inline
 const Map::ObjectSelection& Map::selectedObjects() const
 {
@@ -0,0 +1,99 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "map_change_feed.h"
+
+#include <algorithm>
+
+#include <QtGlobal>
+
+
+// ### MapChangeFeed ###
+
+MapChangeFeed::MapChangeFeed(std::size_t capacity)
+ : capacity(qMax(std::size_t(1), capacity))
+ , num_consumers(0)
+ , last_version(0)
+ , complete_since(0)
+{
+	// nothing else
+}
+
+void MapChangeFeed::addConsumer()
+{
+	++num_consumers;
+}
+
+void MapChangeFeed::removeConsumer()
+{
+	Q_ASSERT(num_consumers > 0);
+	if (--num_consumers == 0)
+		invalidate();
+}
+
+bool MapChangeFeed::changesSince(quint64 version, std::vector<MapChange>& out) const
+{
+	if (version < complete_since || version > last_version)
+		return false;
+	
+	auto first = std::upper_bound(begin(entries), end(entries), version, [](quint64 version, const MapChange& change) {
+		return version < change.version;
+	});
+	out.insert(end(out), first, end(entries));
+	return true;
+}
+
+void MapChangeFeed::recordObject(MapChange::Type type, const Object* object, const MapPart* part, const QRectF& extent)
+{
+	record({ 0, type, object, part, nullptr, nullptr, extent });
+}
+
+void MapChangeFeed::recordSymbol(MapChange::Type type, const Symbol* symbol)
+{
+	record({ 0, type, nullptr, nullptr, symbol, nullptr, QRectF() });
+}
+
+void MapChangeFeed::recordColor(MapChange::Type type, const MapColor* color)
+{
+	record({ 0, type, nullptr, nullptr, nullptr, color, QRectF() });
+}
+
+void MapChangeFeed::record(const MapChange& change)
+{
+	if (!isRecording())
+	{
+		invalidate();
+		return;
+	}
+	
+	if (entries.size() >= capacity)
+	{
+		complete_since = entries.front().version;
+		entries.pop_front();
+	}
+	entries.push_back(change);
+	entries.back().version = ++last_version;
+}
+
+void MapChangeFeed::invalidate()
+{
+	entries.clear();
+	complete_since = ++last_version;
+}
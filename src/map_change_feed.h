@@ -0,0 +1,193 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_MAP_CHANGE_FEED_H_
+#define _OPENORIENTEERING_MAP_CHANGE_FEED_H_
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include <QRectF>
+
+class MapColor;
+class MapPart;
+class Object;
+class Symbol;
+
+
+/**
+ * @brief A single entry of a MapChangeFeed.
+ *
+ * Depending on the type, either the object, the symbol or the color is set.
+ * The pointers identify the changed items. They must not be dereferenced
+ * for removed items, and for other items only after checking that they
+ * are still in the map.
+ */
+struct MapChange
+{
+	/** The kinds of changes. */
+	enum Type
+	{
+		ObjectAdded    = 0,
+		ObjectRemoved  = 1,
+		ObjectModified = 2,
+		SymbolAdded    = 3,
+		SymbolRemoved  = 4,
+		SymbolModified = 5,
+		ColorAdded     = 6,
+		ColorRemoved   = 7,
+		ColorModified  = 8
+	};
+	
+	/** The version of the feed which was reached by this change. */
+	quint64 version;
+	
+	/** The kind of change. */
+	Type type;
+	
+	/** The changed object, or nullptr. */
+	const Object* object;
+	
+	/** The part of the changed object, or nullptr if not known. */
+	const MapPart* part;
+	
+	/** The changed symbol (the new one for modifications), or nullptr. */
+	const Symbol* symbol;
+	
+	/** The changed color, or nullptr. */
+	const MapColor* color;
+	
+	/**
+	 * The area affected by an object change, in map coordinates.
+	 * For modifications, this covers the old and the new extent.
+	 */
+	QRectF extent;
+};
+
+
+
+/**
+ * @brief MapChangeFeed records the changes of a map as a sequence of entries.
+ *
+ * Each change advances the version of the feed by one. Consumers remember
+ * the version which they have processed, and they fetch the later entries
+ * by changesSince(). When the feed cannot provide all of these entries,
+ * changesSince() returns false, and the consumer must rescan the map.
+ *
+ * Entries are recorded only while there are consumers, cf. addConsumer(),
+ * and only up to a limited number. Changes which are not recorded still
+ * advance the version. Some changes, e.g. clearing the map, are recorded
+ * only by invalidate().
+ *
+ * An added object is usually reported as modified directly after it was
+ * added, when its extent is known. Objects which are moved to another part
+ * are reported as modified, with the new part.
+ *
+ * Synopsis:
+ *
+ * map.changeFeed().addConsumer();
+ * quint64 version = map.changeFeed().version();
+ * rescan(map);
+ * ...
+ * std::vector<MapChange> changes;
+ * if (map.changeFeed().changesSince(version, changes))
+ *     process(changes);
+ * else
+ *     rescan(map);
+ * version = map.changeFeed().version();
+ */
+class MapChangeFeed
+{
+public:
+	/** The default maximum number of recorded entries. */
+	static const std::size_t default_capacity = 100000;
+	
+	/** Constructs an empty feed with the given capacity. */
+	explicit MapChangeFeed(std::size_t capacity = default_capacity);
+	
+	/** Returns the version which was reached by the last change. */
+	quint64 version() const;
+	
+	/** Returns true while entries are recorded, i.e. while there are consumers. */
+	bool isRecording() const;
+	
+	/** Registers a consumer. Entries are recorded from now on. */
+	void addConsumer();
+	
+	/** Unregisters a consumer. Recording stops with the last consumer. */
+	void removeConsumer();
+	
+	/**
+	 * Appends the entries which are newer than the given version to out,
+	 * in the order of their versions.
+	 *
+	 * Returns false and appends nothing if some of these entries were not
+	 * recorded or were already discarded.
+	 */
+	bool changesSince(quint64 version, std::vector<MapChange>& out) const;
+	
+	/** Records a change of an object. */
+	void recordObject(MapChange::Type type, const Object* object, const MapPart* part, const QRectF& extent);
+	
+	/** Records a change of a symbol. */
+	void recordSymbol(MapChange::Type type, const Symbol* symbol);
+	
+	/** Records a change of a color. */
+	void recordColor(MapChange::Type type, const MapColor* color);
+	
+	/**
+	 * Records a change which cannot be described by entries.
+	 *
+	 * After this, changesSince() returns false for all earlier versions.
+	 */
+	void invalidate();
+
+private:
+	/** Appends the entry, or invalidates if not recording. */
+	void record(const MapChange& change);
+	
+	std::deque<MapChange> entries;
+	std::size_t capacity;
+	int num_consumers;
+	
+	/** The version of the last change. */
+	quint64 last_version;
+	
+	/** All changes after this version are in the entries. */
+	quint64 complete_since;
+};
+
+
+
+// ### MapChangeFeed inline code ###
+
+inline
+quint64 MapChangeFeed::version() const
+{
+	return last_version;
+}
+
+inline
+bool MapChangeFeed::isRecording() const
+{
+	return num_consumers > 0;
+}
+
+#endif
@@ -22,7 +22,9 @@
 #include "map_editor.h"
 #include "map_editor_p.h"
 
+#include <cmath>
 #include <limits>
+#include <memory>
 
 #include <qmath.h>
 #include <QApplication>
@@ -42,6 +44,7 @@
 #include <QMimeData>
 #include <QPainter>
 #include <QPushButton>
+#include <QSaveFile>
 #include <QSettings>
 #include <QSignalMapper>
 #include <QSizeGrip>
@@ -58,12 +61,16 @@
 #endif
 
 #include "core/georeferencing.h"
+#include "core/map_tile_exporter.h"
 #include "gui/configure_grid_dialog.h"
 #include "gui/georeferencing_dialog.h"
+#include "gui/memory_usage_dialog.h"
+#include "gui/symbol_cost_dialog.h"
 #include "gui/widgets/action_grid_bar.h"
 #include "gui/widgets/compass_display.h"
 #include "gui/widgets/symbol_widget.h"
 #include "gui/widgets/template_list_widget.h"
+#include "autosave_journal.h"
 #include "color_dock_widget.h"
 #include "compass.h"
 #include "file_format_registry.h"
@@ -77,14 +84,20 @@
 #include "gps_display.h"
 #include "gps_temporary_markers.h"
 #include "gps_track_recorder.h"
+#include "input_recording.h"
 #include "gui/main_window.h"
 #include "gui/print_widget.h"
 #include "gui/widgets/measure_widget.h"
+#include "gui/widgets/object_search_widget.h"
+#include "gui/widgets/quality_check_widget.h"
 #include "gui/widgets/tags_widget.h"
 #include "object_operations.h"
 #include "object_text.h"
+#include "core/tracing.h"
+#include "render_profiler.h"
 #include "renderable.h"
 #include "settings.h"
+#include "startup_timer.h"
 #include "symbol.h"
 #include "symbol_area.h"
 #include "symbol_dialog_replace.h"
@@ -158,6 +171,60 @@ namespace
 		return splitter;
 	}
 	
+	
+	const QString objects_mime_type = QStringLiteral("openorienteering/objects");
+	
+	/**
+	 * Clipboard data which holds copied objects in a map.
+	 * 
+	 * Pasting in the same process takes the objects directly from the map.
+	 * The map is serialized only when another process asks for the data.
+	 */
+	class ObjectsMimeData : public QMimeData
+	{
+	public:
+		/** Takes ownership of the map. The extent is the one of its objects. */
+		ObjectsMimeData(Map* map, const QRectF& extent)
+		 : objects_map(map)
+		 , objects_extent(extent)
+		{}
+		
+		Map* map() const
+		{
+			return objects_map.get();
+		}
+		
+		const QRectF& extent() const
+		{
+			return objects_extent;
+		}
+		
+		QStringList formats() const override
+		{
+			return { objects_mime_type };
+		}
+		
+	protected:
+		QVariant retrieveData(const QString& mime_type, QVariant::Type type) const override
+		{
+			if (mime_type != objects_mime_type)
+				return QMimeData::retrieveData(mime_type, type);
+			
+			if (serialized.isEmpty())
+			{
+				QBuffer buffer;
+				if (objects_map->exportToIODevice(&buffer))
+					serialized = buffer.data();
+			}
+			return serialized;
+		}
+		
+	private:
+		std::unique_ptr<Map> objects_map;
+		QRectF objects_extent;
+		mutable QByteArray serialized;
+	};
+	
 } // namespace
 
 
@@ -197,6 +264,7 @@ MapEditorController::MapEditorController(OperatingMode mode, Map* map)
 	paste_act = NULL;
 	reopen_template_act = NULL;
 	overprinting_simulation_act = NULL;
+	soft_proof_act = NULL;
 	
 	toolbar_view = NULL;
 	toolbar_mapparts = NULL;
@@ -242,6 +310,10 @@ MapEditorController::~MapEditorController()
 		delete template_dock_widget;
 	if (tags_dock_widget)
 		delete tags_dock_widget;
+	if (search_dock_widget)
+		delete search_dock_widget;
+	if (quality_check_dock_widget)
+		delete quality_check_dock_widget;
 	delete cut_hole_menu;
 	delete mappart_merge_act;
 	delete mappart_merge_menu;
@@ -351,6 +423,8 @@ void MapEditorController::setEditingInProgress(bool value)
 		symbol_widget->setEnabled(!editing_in_progress);
 		if (color_dock_widget)
 			color_dock_widget->widget()->setEnabled(!editing_in_progress);
+		if (quality_check_dock_widget)
+			quality_check_dock_widget->widget()->setEnabled(!editing_in_progress);
 		if (mappart_selector_box)
 			mappart_selector_box->setEnabled(!editing_in_progress);
 		
@@ -373,10 +447,12 @@ void MapEditorController::setEditingInProgress(bool value)
 		mappart_move_menu->setEnabled(!editing_in_progress && num_parts > 1);
 		mappart_merge_act->setEnabled(!editing_in_progress && num_parts > 1);
 		mappart_merge_menu->setEnabled(!editing_in_progress && num_parts > 1);
+		boolean_union_all_act->setEnabled(!editing_in_progress);
 		
 		// Symbol menu
 		scale_all_symbols_act->setEnabled(!editing_in_progress);
 		load_symbols_from_act->setEnabled(!editing_in_progress);
+		symbol_cost_act->setEnabled(!editing_in_progress);
 		
 		updateObjectDependentActions();
 		updateSymbolDependentActions();
@@ -492,6 +568,37 @@ bool MapEditorController::exportTo(const QString& path, const FileFormat* format
 	return false;
 }
 
+std::function<bool (QByteArray&, QString&)> MapEditorController::prepareExportToData(const QString& path, const FileFormat* format)
+{
+	if (map && !editing_in_progress)
+	{
+		return map->prepareExportToData(path, main_view, format);
+	}
+	
+	return {};
+}
+
+bool MapEditorController::exportAutosaveJournal(const QString& base_path, QByteArray& data, bool& append)
+{
+	if (autosave_journal && !editing_in_progress)
+	{
+		return autosave_journal->exportChanges(base_path, data, append);
+	}
+	
+	return false;
+}
+
+void MapEditorController::setAutosaveJournalBase(bool valid)
+{
+	if (!autosave_journal)
+		return;
+	
+	if (valid)
+		autosave_journal->setBase();
+	else
+		autosave_journal->reset();
+}
+
 bool MapEditorController::load(const QString& path, QWidget* dialog_parent)
 {
 	if (!dialog_parent)
@@ -505,6 +612,11 @@ bool MapEditorController::load(const QString& path, QWidget* dialog_parent)
 	bool success = map->loadFrom(path, dialog_parent, main_view);
 	if (success)
 	{
+		QString error_string;
+		if (!AutosaveJournal::replay(*map, path, error_string))
+		{
+			QMessageBox::warning(dialog_parent, tr("Warning"), tr("Not all autosaved changes could be restored:\n%1").arg(error_string));
+		}
 		setMap(map, false);
 	}
 	else
@@ -591,6 +703,7 @@ void MapEditorController::attach(MainWindow* window)
 		gps_marker_display = new GPSTemporaryMarkers(map_widget, gps_display);
 		
 		createActions();
+		StartupTimer::mark("Editor actions");
 		if (mobile_mode)
 		{
 			createMobileGUI();
@@ -606,6 +719,7 @@ void MapEditorController::attach(MainWindow* window)
 			
 			createMenuAndToolbars();
 			restoreWindowState();
+			StartupTimer::mark("Editor menus and toolbars");
 		}
 	}
 	else if (mode == SymbolEditor)
@@ -631,14 +745,14 @@ void MapEditorController::attach(MainWindow* window)
 		}
 		else
 		{
+			// The other dock widgets start hidden.
+			// They are created when they are shown for the first time.
 			symbol_window_act->trigger();
-			createColorWindow();
-			createTemplateWindow();
-			createTagEditor();
 			
 			if (map->getNumColors() == 0)
-				QTimer::singleShot(0, color_dock_widget, SLOT(show()));
+				QTimer::singleShot(0, color_window_act, SLOT(trigger()));
 		}
+		StartupTimer::mark("Editor dock widgets");
 		
 		// Auto-select the edit tool
 		edit_tool_act->setChecked(true);
@@ -765,10 +879,14 @@ void MapEditorController::createActions()
 	print_act_mapper->setMapping(export_image_act, PrintWidget::EXPORT_IMAGE_TASK);
 	export_pdf_act = newAction("export-pdf", tr("&PDF"), print_act_mapper, SLOT(map()), NULL, QString::null, "file_menu.html");
 	print_act_mapper->setMapping(export_pdf_act, PrintWidget::EXPORT_PDF_TASK);
+	export_tiles_act = newAction("export-tiles", tr("&Web map tiles..."), this, SLOT(exportTilesClicked()), NULL, QString::null, "file_menu.html");
+	export_vector_tiles_act = newAction("export-vector-tiles", tr("&Vector map tiles..."), this, SLOT(exportVectorTilesClicked()), NULL, QString::null, "file_menu.html");
 #else
 	print_act = NULL;
 	export_image_act = NULL;
 	export_pdf_act = NULL;
+	export_tiles_act = NULL;
+	export_vector_tiles_act = NULL;
 #endif
 	
 	undo_act = newAction("undo", tr("Undo"), this, SLOT(undo()), "undo.png", tr("Undo the last step"), "edit_menu.html");
@@ -799,6 +917,17 @@ void MapEditorController::createActions()
 	baseline_view_act = newCheckAction("baselineview", tr("Baseline view"), this, SLOT(baselineView(bool)), NULL, QString::null, "view_menu.html");
 	hide_all_templates_act = newCheckAction("hidealltemplates", tr("Hide all templates"), this, SLOT(hideAllTemplates(bool)), NULL, QString::null, "view_menu.html");
 	overprinting_simulation_act = newCheckAction("overprintsimulation", tr("Overprinting simulation"), this, SLOT(overprintingSimulation(bool)), NULL, QString::null, "view_menu.html");
+	soft_proof_act = newCheckAction("softproof", tr("CMYK soft proof"), this, SLOT(softProof(bool)), NULL, QString::null, "view_menu.html");
+	render_profiler_act = newCheckAction("renderprofiler", tr("Show render profiler"), this, SLOT(showRenderProfiler(bool)), NULL, QString::null, "view_menu.html");
+	export_render_profile_act = newAction("exportrenderprofile", tr("Export render profile..."), this, SLOT(exportRenderProfile()), NULL, QString::null, "view_menu.html");
+	export_render_profile_act->setEnabled(false);
+#ifdef MAPPER_TRACING
+	record_trace_act = newCheckAction("recordtrace", tr("Record performance trace"), this, SLOT(recordTrace(bool)), NULL, QString::null, "view_menu.html");
+#else
+	record_trace_act = nullptr;
+#endif
+	record_input_act = newCheckAction("recordinput", tr("Record input"), this, SLOT(recordInput(bool)), NULL, QString::null, "view_menu.html");
+	memory_usage_act = newAction("memoryusage", tr("Memory usage..."), this, SLOT(showMemoryUsage()), NULL, QString::null, "view_menu.html");
 	
 	symbol_window_act = newCheckAction("symbolwindow", tr("Symbol window"), this, SLOT(showSymbolWindow(bool)), "symbols.png", tr("Show/Hide the symbol window"), "symbol_dock_widget.html");
 	color_window_act = newCheckAction("colorwindow", tr("Color window"), this, SLOT(showColorWindow(bool)), "colors.png", tr("Show/Hide the color window"), "color_dock_widget.html");
@@ -806,6 +935,7 @@ void MapEditorController::createActions()
 	/*QAction* load_colors_from_act = newAction("loadcolors", tr("Load colors from..."), this, SLOT(loadColorsFromClicked()), NULL, tr("Replace the colors with those from another map file"));*/
 	
 	scale_all_symbols_act = newAction("scaleall", tr("Scale all symbols..."), this, SLOT(scaleAllSymbolsClicked()), NULL, tr("Scale the whole symbol set"), "map_menu.html");
+	symbol_cost_act = newAction("symbolcost", tr("Symbol rendering cost..."), this, SLOT(showSymbolCost()), NULL, tr("Measure the rendering cost of the objects, by symbol"), "symbols_menu.html");
 	georeferencing_act = newAction("georef", tr("Georeferencing..."), this, SLOT(editGeoreferencing()), NULL, QString::null, "georeferencing.html");
 	scale_map_act = newAction("scalemap", tr("Change map scale..."), this, SLOT(scaleMapClicked()), "tool-scale.png", tr("Change the map scale and adjust map objects and symbol sizes"), "map_menu.html");
 	rotate_map_act = newAction("rotatemap", tr("Rotate map..."), this, SLOT(rotateMapClicked()), "tool-rotate.png", tr("Rotate the whole map"), "map_menu.html");
@@ -818,6 +948,8 @@ void MapEditorController::createActions()
 	reopen_template_act = newAction("reopentemplate", tr("Reopen template..."), this, SLOT(reopenTemplateClicked()), NULL, QString::null, "templates_menu.html");
 	
 	tags_window_act = newCheckAction("tagswindow", tr("Tag editor"), this, SLOT(showTagsWindow(bool)), "window-new", tr("Show/Hide the tag editor window"), "tag_editor.html");
+	search_window_act = newCheckAction("searchwindow", tr("Find objects"), this, SLOT(showSearchWindow(bool)), "window-new", tr("Show/Hide the object search window"), "tag_editor.html");
+	quality_check_window_act = newCheckAction("qualitycheckwindow", tr("Quality check"), this, SLOT(showQualityCheckWindow(bool)), "window-new", tr("Show/Hide the map quality check window"), "view_menu.html");
 	
 	edit_tool_act = newToolAction("editobjects", tr("Edit objects"), this, SLOT(editToolClicked()), "tool-edit.png", QString::null, "toolbars.html#tool_edit_point");
 	edit_line_tool_act = newToolAction("editlines", tr("Edit lines"), this, SLOT(editLineToolClicked()), "tool-edit-line.png", QString::null, "toolbars.html#tool_edit_line");
@@ -859,6 +991,7 @@ void MapEditorController::createActions()
 	boolean_difference_act = newAction("booleandifference", tr("Cut away from area"), this, SLOT(booleanDifferenceClicked()), "tool-boolean-difference.png", QString::null, "toolbars.html#area_difference");
 	boolean_xor_act = newAction("booleanxor", tr("Area XOr"), this, SLOT(booleanXOrClicked()), "tool-boolean-xor.png", QString::null, "toolbars.html#area_xor");
 	boolean_merge_holes_act = newAction("booleanmergeholes", tr("Merge area holes"), this, SLOT(booleanMergeHolesClicked()), "tool-boolean-merge-holes.png", QString::null, "toolbars.html#area_merge_holes"); // TODO:documentation
+	boolean_union_all_act = newAction("booleanunionall", tr("Unify all areas"), this, SLOT(booleanUnionAllClicked()), NULL, tr("Unify the overlapping areas of each symbol in the current map part"), "toolbars.html#unify_areas");
 	convert_to_curves_act = newAction("converttocurves", tr("Convert to curves"), this, SLOT(convertToCurvesClicked()), "tool-convert-to-curves.png", QString::null, "toolbars.html#convert_to_curves");
 	simplify_path_act = newAction("simplify", tr("Simplify path"), this, SLOT(simplifyPathClicked()), "tool-simplify-path.png", QString::null, "toolbars.html#simplify_path");
 	cutout_physical_act = newToolAction("cutoutphysical", tr("Cutout"), this, SLOT(cutoutPhysicalClicked()), "tool-cutout-physical.png", QString::null, "toolbars.html#cutout_physical");
@@ -943,6 +1076,8 @@ void MapEditorController::createMenuAndToolbars()
 	QMenu* export_menu = new QMenu(tr("&Export as..."), file_menu);
 	export_menu->addAction(export_image_act);
 	export_menu->addAction(export_pdf_act);
+	export_menu->addAction(export_tiles_act);
+	export_menu->addAction(export_vector_tiles_act);
 	file_menu->insertMenu(insertion_act, export_menu);
 #endif
 	file_menu->insertSeparator(insertion_act);
@@ -978,6 +1113,7 @@ void MapEditorController::createMenuAndToolbars()
 	view_menu->addAction(hatch_areas_view_act);
 	view_menu->addAction(baseline_view_act);
 	view_menu->addAction(overprinting_simulation_act);
+	view_menu->addAction(soft_proof_act);
 	view_menu->addAction(hide_all_templates_act);
 	view_menu->addSeparator();
 	QMenu* coordinates_menu = new QMenu(tr("Display coordinates as..."), view_menu);
@@ -989,7 +1125,16 @@ void MapEditorController::createMenuAndToolbars()
 	view_menu->addSeparator();
 	view_menu->addAction(fullscreen_act);
 	view_menu->addSeparator();
+	view_menu->addAction(render_profiler_act);
+	view_menu->addAction(export_render_profile_act);
+	if (record_trace_act)
+		view_menu->addAction(record_trace_act);
+	view_menu->addAction(record_input_act);
+	view_menu->addAction(memory_usage_act);
+	view_menu->addSeparator();
 	view_menu->addAction(tags_window_act);
+	view_menu->addAction(search_window_act);
+	view_menu->addAction(quality_check_window_act);
 	view_menu->addAction(color_window_act);
 	view_menu->addAction(symbol_window_act);
 	view_menu->addAction(template_window_act);
@@ -1016,6 +1161,7 @@ void MapEditorController::createMenuAndToolbars()
 	tools_menu->addAction(boolean_difference_act);
 	tools_menu->addAction(boolean_xor_act);
 	tools_menu->addAction(boolean_merge_holes_act);
+	tools_menu->addAction(boolean_union_all_act);
 	tools_menu->addAction(cut_tool_act);
 	tools_menu->addMenu(cut_hole_menu);
 	tools_menu->addAction(rotate_act);
@@ -1055,6 +1201,7 @@ void MapEditorController::createMenuAndToolbars()
 	symbols_menu->addSeparator();
 	symbols_menu->addAction(scale_all_symbols_act);
 	symbols_menu->addAction(load_symbols_from_act);
+	symbols_menu->addAction(symbol_cost_act);
 	/*symbols_menu->addAction(load_colors_from_act);*/
 	
 	// Templates menu
@@ -1435,6 +1582,59 @@ void MapEditorController::printClicked(int task)
 #endif
 }
 
+void MapEditorController::exportTilesClicked()
+{
+	exportTiles(false);
+}
+
+void MapEditorController::exportVectorTilesClicked()
+{
+	exportTiles(true);
+}
+
+void MapEditorController::exportTiles(bool vector_tiles)
+{
+	const Georeferencing& georef = map->getGeoreferencing();
+	if (!georef.isValid() || georef.isLocal())
+	{
+		QMessageBox::warning(window, tr("Error"), tr("Web map tiles can only be exported from a georeferenced map."));
+		return;
+	}
+	
+	QScopedPointer<MapTileExporter>& exporter = vector_tiles ? vector_tile_exporter : tile_exporter;
+	if (!exporter)
+	{
+		exporter.reset(new MapTileExporter(*map, vector_tiles ? MapTileExporter::VectorTiles : MapTileExporter::RasterTiles));
+		MapTileExporter* new_exporter = exporter.data();
+		connect(map, &Map::objectAreaChanged, this, [new_exporter](const QRectF& map_area) {
+			new_exporter->markChanged(map_area);
+		});
+	}
+	
+	const QString title = vector_tiles ? tr("Export vector map tiles") : tr("Export web map tiles");
+	const QString directory = QFileDialog::getExistingDirectory(window, title);
+	if (directory.isEmpty())
+		return;
+	
+	bool ok = false;
+	const int max_zoom = QInputDialog::getInt(window, title, tr("Highest zoom level:"),
+	                                          exporter->suggestedMaxZoom(), 0, MapTileExporter::max_zoom_level, 1, &ok);
+	if (!ok)
+		return;
+	const int min_zoom = QInputDialog::getInt(window, title, tr("Lowest zoom level:"),
+	                                          qMax(0, max_zoom - 4), 0, max_zoom, 1, &ok);
+	if (!ok)
+		return;
+	
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+	ok = exporter->exportTiles(directory, min_zoom, max_zoom);
+	QApplication::restoreOverrideCursor();
+	if (!ok)
+		QMessageBox::warning(window, tr("Error"), tr("Failed to export the web map tiles."));
+	else
+		window->showStatusBarMessage(tr("Exported successfully to %1").arg(directory), 4000);
+}
+
 void MapEditorController::undo()
 {
 	doUndo(false);
@@ -1494,8 +1694,10 @@ void MapEditorController::copy()
 	copy_map->importMap(map, Map::MinimalSymbolImport, window, &symbol_filter, -1, true, &symbol_map);
 	
 	// Duplicate all selected objects into copy map
+	QRectF extent;
 	for (Map::ObjectSelection::const_iterator it = map->selectedObjectsBegin(), end = map->selectedObjectsEnd(); it != end; ++it)
 	{
+		rectIncludeSafe(extent, (*it)->getExtent());
 		Object* new_object = (*it)->duplicate();
 		if (symbol_map.contains(new_object->getSymbol()))
 			new_object->setSymbol(symbol_map.value(new_object->getSymbol()), true);
@@ -1503,20 +1705,8 @@ void MapEditorController::copy()
 		copy_map->addObject(new_object);
 	}
 	
-	// Save map to memory
-	QBuffer buffer;
-	if (!copy_map->exportToIODevice(&buffer))
-	{
-		delete copy_map;
-		QMessageBox::warning(NULL, tr("Error"), tr("An internal error occurred, sorry!"));
-		return;
-	}
-	delete copy_map;
-	
-	// Put buffer into clipboard
-	QMimeData* mime_data = new QMimeData();
-	mime_data->setData("openorienteering/objects", buffer.data());
-	QApplication::clipboard()->setMimeData(mime_data);
+	// Put the map into the clipboard. It is serialized on demand only.
+	QApplication::clipboard()->setMimeData(new ObjectsMimeData(copy_map, extent));
 	
 	// Show message
 	window->showStatusBarMessage(tr("Copied %1 object(s)").arg(map->getNumSelectedObjects()), 2000);
@@ -1526,28 +1716,41 @@ void MapEditorController::paste()
 {
 	if (editing_in_progress)
 		return;
-	if (!QApplication::clipboard()->mimeData()->hasFormat("openorienteering/objects"))
+	const QMimeData* mime_data = QApplication::clipboard()->mimeData();
+	if (!mime_data->hasFormat(objects_mime_type))
 	{
 		QMessageBox::warning(NULL, tr("Error"), tr("There are no objects in clipboard which could be pasted!"));
 		return;
 	}
 	
-	// Get buffer from clipboard
-	QByteArray byte_array = QApplication::clipboard()->mimeData()->data("openorienteering/objects");
-	QBuffer buffer(&byte_array);
-	buffer.open(QIODevice::ReadOnly);
-	
-	// Create map from buffer
-	Map* paste_map = new Map();
-	if (!paste_map->importFromIODevice(&buffer))
+	// Objects copied in this process are taken from the clipboard's map,
+	// unless importing would need to change its scale.
+	std::unique_ptr<Map> deserialized_map;
+	Map* paste_map = nullptr;
+	auto objects_data = dynamic_cast<const ObjectsMimeData*>(mime_data);
+	if (objects_data && objects_data->map()->getScaleDenominator() == map->getScaleDenominator())
 	{
-		QMessageBox::warning(NULL, tr("Error"), tr("An internal error occurred, sorry!"));
-		return;
+		paste_map = objects_data->map();
+	}
+	else
+	{
+		// Create map from buffer
+		QByteArray byte_array = mime_data->data(objects_mime_type);
+		QBuffer buffer(&byte_array);
+		buffer.open(QIODevice::ReadOnly);
+		
+		deserialized_map.reset(new Map());
+		if (!deserialized_map->importFromIODevice(&buffer))
+		{
+			QMessageBox::warning(NULL, tr("Error"), tr("An internal error occurred, sorry!"));
+			return;
+		}
+		paste_map = deserialized_map.get();
 	}
 	
 	// Move objects in paste_map so their bounding box center is at this map's viewport center.
 	// This makes the pasted objects appear at the center of the viewport.
-	QRectF paste_extent = paste_map->calculateExtent(true, false, NULL);
+	QRectF paste_extent = deserialized_map ? paste_map->calculateExtent(true, false, NULL) : objects_data->extent();
 	auto offset = main_view->center() - paste_extent.center();
 	
 	MapPart* part = paste_map->getCurrentPart();
@@ -1559,7 +1762,13 @@ void MapEditorController::paste()
 	
 	// Show message
 	window->showStatusBarMessage(tr("Pasted %1 object(s)").arg(paste_map->getNumObjects()), 2000);
-	delete paste_map;
+	
+	// The clipboard's map is pasted again from the original position.
+	if (!deserialized_map)
+	{
+		for (int i = 0; i < part->getNumObjects(); ++i)
+			part->getObject(i)->move(-offset);
+	}
 }
 
 void MapEditorController::clearUndoRedoHistory()
@@ -1626,14 +1835,11 @@ void MapEditorController::setCustomZoomFactorClicked()
 void MapEditorController::hatchAreas(bool checked)
 {
 	map->setAreaHatchingEnabled(checked);
-	// Update all areas
-	map->applyOnMatchingObjects(ObjectOp::ForceUpdate(), ObjectOp::ContainsSymbolType(Symbol::Area));
 }
 
 void MapEditorController::baselineView(bool checked)
 {
 	map->setBaselineViewEnabled(checked);
-	map->updateAllObjects();
 }
 
 void MapEditorController::hideAllTemplates(bool checked)
@@ -1651,6 +1857,108 @@ void MapEditorController::overprintingSimulation(bool checked)
 	main_view->setOverprintingSimulationEnabled(checked);
 }
 
+void MapEditorController::softProof(bool checked)
+{
+	main_view->setSoftProofEnabled(checked);
+}
+
+void MapEditorController::showRenderProfiler(bool checked)
+{
+	map_widget->setProfilerEnabled(checked);
+	export_render_profile_act->setEnabled(checked);
+}
+
+void MapEditorController::exportRenderProfile()
+{
+	const RenderProfiler* profiler = map_widget->getProfiler();
+	if (!profiler)
+		return;
+	
+	QString path = QFileDialog::getSaveFileName(window, tr("Export render profile"), {}, tr("CSV files (*.csv)") + QLatin1String(";;") + tr("All files (*.*)"));
+	if (path.isEmpty())
+		return;
+	if (!path.endsWith(QLatin1String(".csv"), Qt::CaseInsensitive))
+		path.append(QLatin1String(".csv"));
+	
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text) || !profiler->writeCsv(&file) || !file.commit())
+		QMessageBox::warning(window, tr("Error"), tr("Failed to export the render profile:\n%1").arg(file.errorString()));
+	else
+		window->showStatusBarMessage(tr("Exported successfully to %1").arg(path), 4000);
+}
+
+void MapEditorController::recordTrace(bool checked)
+{
+	if (checked)
+	{
+		Tracing::start();
+		window->showStatusBarMessage(tr("Recording a performance trace"), 2000);
+		return;
+	}
+	
+	Tracing::stop();
+	QString path = QFileDialog::getSaveFileName(window, tr("Save performance trace"), {}, tr("Chrome trace files (*.json)") + QLatin1String(";;") + tr("All files (*.*)"));
+	if (path.isEmpty())
+		return;
+	if (!path.endsWith(QLatin1String(".json"), Qt::CaseInsensitive))
+		path.append(QLatin1String(".json"));
+	
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly) || !Tracing::writeChromeTrace(&file) || !file.commit())
+		QMessageBox::warning(window, tr("Error"), tr("Failed to save the performance trace:\n%1").arg(file.errorString()));
+	else
+		window->showStatusBarMessage(tr("Exported successfully to %1").arg(path), 4000);
+}
+
+void MapEditorController::recordInput(bool checked)
+{
+	if (checked)
+	{
+		input_recording.reset(new InputRecording());
+		input_recording->map_path = window->currentPath();
+		if (current_tool)
+			input_recording->tool_name = QString::fromLatin1(current_tool->metaObject()->className());
+		if (activeSymbol())
+			input_recording->symbol_index = map->findSymbolIndex(activeSymbol());
+		input_recording->begin(*map_widget);
+		map_widget->setInputRecording(input_recording.data());
+		window->showStatusBarMessage(tr("Recording the input"), 2000);
+		return;
+	}
+	
+	map_widget->setInputRecording(nullptr);
+	if (!input_recording)
+		return;
+	
+	QString path = QFileDialog::getSaveFileName(window, tr("Save input recording"), {}, tr("Input recordings (*.input)") + QLatin1String(";;") + tr("All files (*.*)"));
+	if (!path.isEmpty())
+	{
+		if (!path.endsWith(QLatin1String(".input"), Qt::CaseInsensitive))
+			path.append(QLatin1String(".input"));
+		
+		QSaveFile file(path);
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Text) || !input_recording->write(&file) || !file.commit())
+			QMessageBox::warning(window, tr("Error"), tr("Failed to save the input recording:\n%1").arg(file.errorString()));
+		else
+			window->showStatusBarMessage(tr("Exported successfully to %1").arg(path), 4000);
+	}
+	input_recording.reset();
+}
+
+void MapEditorController::showMemoryUsage()
+{
+	MemoryUsageDialog dialog(window, *map, map_widget);
+	dialog.setWindowModality(Qt::WindowModal);
+	dialog.exec();
+}
+
+void MapEditorController::showSymbolCost()
+{
+	SymbolCostDialog dialog(window, *map, *main_view);
+	dialog.setWindowModality(Qt::WindowModal);
+	dialog.exec();
+}
+
 void MapEditorController::coordsDisplayChanged()
 {
 	if (geographic_coordinates_dms_act->isChecked())
@@ -1877,6 +2185,50 @@ void MapEditorController::showTagsWindow(bool show)
 	tags_dock_widget->setVisible(show);
 }
 
+void MapEditorController::createObjectSearch()
+{
+	Q_ASSERT(!search_dock_widget);
+	
+	ObjectSearchWidget* search_widget = new ObjectSearchWidget(map, this);
+	search_dock_widget = new EditorDockWidget(tr("Find Objects"), search_window_act, this, window);
+	search_dock_widget->setWidget(search_widget);
+	search_dock_widget->setObjectName("Object search dock widget");
+	if (!window->restoreDockWidget(search_dock_widget))
+		window->addDockWidget(Qt::RightDockWidgetArea, search_dock_widget, Qt::Vertical);
+	search_dock_widget->setVisible(false);
+}
+
+void MapEditorController::showSearchWindow(bool show)
+{
+	if (!search_dock_widget)
+		createObjectSearch();
+	
+	search_window_act->setChecked(show);
+	search_dock_widget->setVisible(show);
+}
+
+void MapEditorController::createQualityCheck()
+{
+	Q_ASSERT(!quality_check_dock_widget);
+	
+	quality_check_dock_widget = new EditorDockWidget(tr("Quality Check"), quality_check_window_act, this, window);
+	quality_check_dock_widget->setWidget(new QualityCheckWidget(map, this));
+	quality_check_dock_widget->widget()->setEnabled(!editing_in_progress);
+	quality_check_dock_widget->setObjectName("Quality check dock widget");
+	if (!window->restoreDockWidget(quality_check_dock_widget))
+		window->addDockWidget(Qt::RightDockWidgetArea, quality_check_dock_widget, Qt::Vertical);
+	quality_check_dock_widget->setVisible(false);
+}
+
+void MapEditorController::showQualityCheckWindow(bool show)
+{
+	if (!quality_check_dock_widget)
+		createQualityCheck();
+	
+	quality_check_window_act->setChecked(show);
+	quality_check_dock_widget->setVisible(show);
+}
+
 void MapEditorController::editGeoreferencing()
 {
 	if (georeferencing_dialog.isNull())
@@ -2220,7 +2572,7 @@ void MapEditorController::updatePasteAvailability()
 	{
 		paste_act->setEnabled(
 			QApplication::clipboard()->mimeData()
-			&& QApplication::clipboard()->mimeData()->hasFormat("openorienteering/objects")
+			&& QApplication::clipboard()->mimeData()->hasFormat(objects_mime_type)
 			&& !editing_in_progress);
 	}
 }
@@ -2500,17 +2852,15 @@ void MapEditorController::selectObjectsClicked(bool select_exclusively)
 		map->clearObjectSelection(false);
 	}
 
-	bool object_selected = false;	
+	std::vector<Object*> objects;
 	MapPart* part = map->getCurrentPart();
 	for (int i = 0, size = part->getNumObjects(); i < size; ++i)
 	{
 		Object* object = part->getObject(i);
-		if (symbol_widget->isSymbolSelected(object->getSymbol()) && !(!select_exclusively && map->isObjectSelected(object)))
-		{
-			map->addObjectToSelection(object, false);
-			object_selected = true;
-		}
+		if (symbol_widget->isSymbolSelected(object->getSymbol()))
+			objects.push_back(object);
 	}
+	bool object_selected = map->addObjectsToSelection(objects, false) > 0;
 	
 	selection_changed |= object_selected;
 	if (selection_changed)
@@ -2526,18 +2876,15 @@ void MapEditorController::selectObjectsClicked(bool select_exclusively)
 }
 void MapEditorController::deselectObjectsClicked()
 {
-	bool selection_changed = false;
-	
+	std::vector<Object*> objects;
 	MapPart* part = map->getCurrentPart();
 	for (int i = 0, size = part->getNumObjects(); i < size; ++i)
 	{
 		Object* object = part->getObject(i);
-		if (symbol_widget->isSymbolSelected(object->getSymbol()) && map->isObjectSelected(object))
-		{
-			map->removeObjectFromSelection(object, false);
-			selection_changed = true;
-		}
+		if (symbol_widget->isSymbolSelected(object->getSymbol()))
+			objects.push_back(object);
 	}
+	bool selection_changed = map->removeObjectsFromSelection(objects, false) > 0;
 	
 	if (selection_changed)
 	{
@@ -2551,11 +2898,13 @@ void MapEditorController::deselectObjectsClicked()
 void MapEditorController::selectAll()
 {
 	auto num_selected_objects = map->getNumSelectedObjects();
+	std::vector<Object*> objects;
+	MapPart* part = map->getCurrentPart();
+	objects.reserve(std::size_t(part->getNumObjects()));
+	for (int i = 0, size = part->getNumObjects(); i < size; ++i)
+		objects.push_back(part->getObject(i));
 	map->clearObjectSelection(false);
-	map->getCurrentPart()->applyOnAllObjects([this](Object* object, MapPart*, int) {
-		map->addObjectToSelection(object, false);
-		return true;
-	});
+	map->addObjectsToSelection(objects, false);
 	
 	if (map->getNumSelectedObjects() != num_selected_objects)
 	{
@@ -2573,15 +2922,16 @@ void MapEditorController::selectNothing()
 
 void MapEditorController::invertSelection()
 {
-	auto selection = Map::ObjectSelection{ map->selectedObjects() };
+	std::vector<Object*> objects;
+	MapPart* part = map->getCurrentPart();
+	for (int i = 0, size = part->getNumObjects(); i < size; ++i)
+	{
+		Object* object = part->getObject(i);
+		if (!map->isObjectSelected(object))
+			objects.push_back(object);
+	}
 	map->clearObjectSelection(false);
-	map->getCurrentPart()->applyOnAllObjects([this, &selection](Object* object, MapPart*, int) {
-		if (selection.find(object) == end(selection))
-		{
-			map->addObjectToSelection(object, false);
-		}
-		return true;
-	});
+	map->addObjectsToSelection(objects, false);
 	
 	if (map->getCurrentPart()->getNumObjects() > 0)
 	{
@@ -2928,6 +3278,15 @@ void MapEditorController::booleanMergeHolesClicked()
 		QMessageBox::warning(window, tr("Error"), tr("Merging holes failed."));
 }
 
+void MapEditorController::booleanUnionAllClicked()
+{
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+	const bool have_changes = BooleanTool(BooleanTool::Union, map).executeForCurrentPart();
+	QApplication::restoreOverrideCursor();
+	if (!have_changes)
+		QMessageBox::information(window, tr("Unify all areas"), tr("No overlapping areas were found."));
+}
+
 void MapEditorController::convertToCurvesClicked()
 {
 	ReplaceObjectsUndoStep* undo_step = new ReplaceObjectsUndoStep(map);
@@ -3025,19 +3384,15 @@ void MapEditorController::distributePointsClicked()
 		return;
 	
 	// Add points to map
-	for (size_t i = 0; i < created_objects.size(); ++i)
-		map->addObject(created_objects[i]);
+	const std::vector<Object*> objects(created_objects.begin(), created_objects.end());
+	const int first_index = map->addObjects(objects);
 	
 	// Create undo step and select new objects
-	map->clearObjectSelection(false);
-	MapPart* part = map->getCurrentPart();
 	DeleteObjectsUndoStep* delete_step = new DeleteObjectsUndoStep(map);
-	for (size_t i = 0; i < created_objects.size(); ++i)
-	{
-		Object* object = created_objects[i];
-		delete_step->addObject(part->findObjectIndex(object));
-		map->addObjectToSelection(object, i == created_objects.size() - 1);
-	}
+	for (int i = 0; i < int(objects.size()); ++i)
+		delete_step->addObject(first_index + i);
+	map->clearObjectSelection(false);
+	map->addObjectsToSelection(objects, true);
 	map->push(delete_step);
 	map->setObjectsDirty();
 }
@@ -3278,8 +3633,11 @@ void MapEditorController::alignMapWithNorthUpdate()
 	if (map_widget->getTimeSinceLastInteraction() < interaction_time_threshold)
 		return;
 	
-	// Set map rotation
-	main_view->setRotation(-1 * M_PI / 180.0f * Compass::getInstance().getCurrentAzimuth());
+	// Set map rotation, unless the change is too small to justify redrawing the map
+	const double rotation = -1 * M_PI / 180.0f * Compass::getInstance().getCurrentAzimuth();
+	const double min_change = M_PI / 180.0; // 1 degree
+	if (qAbs(std::remainder(rotation - main_view->getRotation(), 2 * M_PI)) >= min_change)
+		main_view->setRotation(rotation);
 }
 
 void MapEditorController::hideTopActionBar()
@@ -3381,6 +3739,11 @@ void MapEditorController::updateMapPartsUI()
 	}
 }
 
+void MapEditorController::mapPartLoadingFailed(const QString& part_name, const QString& error)
+{
+	QMessageBox::warning(window, tr("Error"), tr("The objects of map part \"%1\" could not be loaded:\n%2\n\nThe map cannot be saved.").arg(part_name, error));
+}
+
 void MapEditorController::addMapPart()
 {
 	bool accepted = false;
@@ -3607,6 +3970,7 @@ void MapEditorController::setMap(Map* map, bool create_new_map_view)
 	}
 	
 	this->map = map;
+	autosave_journal.reset(new AutosaveJournal(map));
 	if (create_new_map_view)
 	{
 		main_view = new MapView(map);
@@ -3623,6 +3987,7 @@ void MapEditorController::setMap(Map* map, bool create_new_map_view)
 	connect(map, SIGNAL(mapPartAdded(std::size_t,const MapPart*)), this, SLOT(updateMapPartsUI()));
 	connect(map, SIGNAL(mapPartChanged(std::size_t,const MapPart*)), this, SLOT(updateMapPartsUI()));
 	connect(map, SIGNAL(mapPartDeleted(std::size_t,const MapPart*)), this, SLOT(updateMapPartsUI()));
+	connect(map, SIGNAL(mapPartLoadingFailed(QString,QString)), this, SLOT(mapPartLoadingFailed(QString,QString)), Qt::QueuedConnection);
 	
 	if (symbol_widget)
 	{
@@ -3648,6 +4013,7 @@ void MapEditorController::updateWidgets()
 			show_grid_act->setChecked(main_view->isGridVisible());
 			hide_all_templates_act->setChecked(main_view->areAllTemplatesHidden());
 			overprinting_simulation_act->setChecked(main_view->isOverprintingSimulationEnabled());
+			soft_proof_act->setChecked(main_view->isSoftProofEnabled());
 		}
 		if (map)
 		{
@@ -3742,7 +4108,18 @@ void MapEditorController::importGeoFile(const QString& filename)
 	TemplateTrack temp(filename, map);
 	if (!temp.configureAndLoad(window, main_view))
 		return;
-	temp.import(window);
+	
+	// Large files may be imported partially, for the area of interest.
+	QRectF extent;
+	const QRectF viewed_rect = main_view->calculateViewedRect(map_widget->viewportToView(map_widget->rect()));
+	const QRectF bbox = temp.calculateTemplateBoundingBox();
+	if (bbox.isValid() && viewed_rect.intersects(bbox) && !viewed_rect.contains(bbox))
+	{
+		int res = QMessageBox::question(window, tr("Import"), tr("Import only the objects in the visible area?"), QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+		if (res == QMessageBox::Yes)
+			extent = viewed_rect;
+	}
+	temp.import(window, extent);
 }
 
 bool MapEditorController::importMapFile(const QString& filename)
@@ -3769,6 +4146,7 @@ void MapEditorController::setViewOptionsEnabled(bool enabled)
 // 	hatch_areas_view_act->setEnabled(enabled);
 // 	baseline_view_act->setEnabled(enabled);
 	overprinting_simulation_act->setEnabled(enabled);
+	soft_proof_act->setEnabled(enabled);
 	hide_all_templates_act->setEnabled(enabled);
 }
 
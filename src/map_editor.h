@@ -45,14 +45,17 @@ class QToolButton;
 QT_END_NAMESPACE
 
 class ActionGridBar;
+class AutosaveJournal;
 class CompassDisplay;
 class EditorDockWidget;
 class GeoreferencingDialog;
+class InputRecording;
 class Map;
 class MapView;
 class MapWidget;
 class MapEditorActivity;
 class MapEditorTool;
+class MapTileExporter;
 class GPSDisplay;
 class GPSTemporaryMarkers;
 class GPSTrackRecorder;
@@ -220,6 +223,12 @@ public:
 	/** Override from MainWindowController */
 	virtual bool exportTo(const QString& path, const FileFormat* format = NULL);
 	/** Override from MainWindowController */
+	virtual std::function<bool (QByteArray&, QString&)> prepareExportToData(const QString& path, const FileFormat* format = NULL);
+	/** Override from MainWindowController */
+	virtual bool exportAutosaveJournal(const QString& base_path, QByteArray& data, bool& append);
+	/** Override from MainWindowController */
+	virtual void setAutosaveJournalBase(bool valid);
+	/** Override from MainWindowController */
 	virtual bool load(const QString& path, QWidget* dialog_parent = NULL);
 	
 	/** Override from MainWindowController */
@@ -246,6 +255,19 @@ public slots:
 	 */
 	void printClicked(int task);
 	
+	/**
+	 * Exports the map as a pyramid of web map tiles to a directory chosen by
+	 * the user. A repeated export only updates the tiles of changed areas.
+	 */
+	void exportTilesClicked();
+	
+	/**
+	 * Exports the map as a pyramid of Mapbox vector tiles to a directory
+	 * chosen by the user. A repeated export only updates the tiles of changed
+	 * areas.
+	 */
+	void exportVectorTilesClicked();
+	
 	/** Undoes the last object edit step. */
 	void undo();
 	/** Redoes the last object edit step */
@@ -281,6 +303,18 @@ public slots:
 	void hideAllTemplates(bool checked);
 	/** Sets the overprinting simulation view option. */
 	void overprintingSimulation(bool checked);
+	/** Sets the CMYK soft proof view option. */
+	void softProof(bool checked);
+	/** Shows or hides the render profiler overlay of the map widget. */
+	void showRenderProfiler(bool checked);
+	/** Writes the frames measured by the render profiler to a CSV file. */
+	void exportRenderProfile();
+	/** Starts recording a trace, or stops recording and saves the trace. */
+	void recordTrace(bool checked);
+	/** Starts recording the input of the map widget, or stops recording and saves the recording. */
+	void recordInput(bool checked);
+	/** Shows the memory used by the map, its undo steps, templates and caches. */
+	void showMemoryUsage();
 	
 	/** Adjusts the coordinates display of the map widget to the selected option. */
 	void coordsDisplayChanged();
@@ -295,6 +329,8 @@ public slots:
 	void loadColorsFromClicked();
 	/** Shows the "scale all symbols" dialog. */
 	void scaleAllSymbolsClicked();
+	/** Shows the rendering cost of the objects, by symbol. */
+	void showSymbolCost();
 	
 	/** Shows the ScaleMapDialog. */
 	void scaleMapClicked();
@@ -316,6 +352,10 @@ public slots:
 	
 	/** Shows or hides the tags editor dock widget. */
 	void showTagsWindow(bool show);
+	/** Shows or hides the object search dock widget. */
+	void showSearchWindow(bool show);
+	/** Shows or hides the map quality check dock widget. */
+	void showQualityCheckWindow(bool show);
 	
 	/** Shows the GeoreferencingDialog. */
 	void editGeoreferencing();
@@ -420,6 +460,8 @@ public slots:
 	void booleanXOrClicked();
 	/** Merges holes of the (single) selected area object */
 	void booleanMergeHolesClicked();
+	/** Calculates the boolean union of all overlapping same-symbol area objects in the current map part */
+	void booleanUnionAllClicked();
 	/** Converts selected polygonal paths to curves */
 	void convertToCurvesClicked();
 	/** Tries to remove points of selected paths while retaining their shape */
@@ -555,6 +597,11 @@ protected slots:
 	 */
 	void updateMapPartsUI();
 	
+	/**
+	 * Informs the user that the objects of a map part could not be loaded.
+	 */
+	void mapPartLoadingFailed(const QString& part_name, const QString& error);
+	
 private:
 	void setMap(Map* map, bool create_new_map_view);
 	
@@ -568,6 +615,11 @@ private:
 	void createTemplateWindow();
 	
 	void createTagEditor();
+	void createObjectSearch();
+	void createQualityCheck();
+	
+	/// Asks for a directory and zoom levels, and exports raster or vector tiles.
+	void exportTiles(bool vector_tiles);
 	
 	QAction* newAction(const char* id, const QString& tr_text, QObject* receiver, const char* slot, const char* icon = NULL, const QString& tr_tip = QString::null, const QString& whatsThisLink = QString::null);
 	QAction* newCheckAction(const char* id, const QString& tr_text, QObject* receiver, const char* slot, const char* icon = NULL, const QString& tr_tip = QString::null, const QString& whatsThisLink = QString::null);
@@ -607,6 +659,8 @@ private:
 	QAction* print_act;
 	QAction* export_image_act;
 	QAction* export_pdf_act;
+	QAction* export_tiles_act;
+	QAction* export_vector_tiles_act;
 	
 	QAction* undo_act;
 	QAction* redo_act;
@@ -632,6 +686,12 @@ private:
 	QAction* baseline_view_act;
 	QAction* hide_all_templates_act;
 	QAction* overprinting_simulation_act;
+	QAction* soft_proof_act;
+	QAction* render_profiler_act;
+	QAction* export_render_profile_act;
+	QAction* record_trace_act;
+	QAction* record_input_act;
+	QAction* memory_usage_act;
 	
 	QAction* map_coordinates_act;
 	QAction* projected_coordinates_act;
@@ -639,6 +699,7 @@ private:
 	QAction* geographic_coordinates_dms_act;
 	
 	QAction* scale_all_symbols_act;
+	QAction* symbol_cost_act;
 	QAction* georeferencing_act;
 	QAction* scale_map_act;
 	QAction* rotate_map_act;
@@ -660,6 +721,10 @@ private:
 	
 	QAction* tags_window_act;
 	QPointer<EditorDockWidget> tags_dock_widget;
+	QAction* search_window_act;
+	QPointer<EditorDockWidget> search_dock_widget;
+	QAction* quality_check_window_act;
+	QPointer<EditorDockWidget> quality_check_dock_widget;
 	
 	QAction* edit_tool_act;
 	QAction* edit_line_tool_act;
@@ -691,6 +756,7 @@ private:
 	QAction* boolean_difference_act;
 	QAction* boolean_xor_act;
 	QAction* boolean_merge_holes_act;
+	QAction* boolean_union_all_act;
 	QAction* convert_to_curves_act;
 	QAction* simplify_path_act;
 	QAction* cutout_physical_act;
@@ -743,7 +809,12 @@ private:
 	
 	QComboBox* mappart_selector_box;
 	
+	QScopedPointer<AutosaveJournal> autosave_journal;
+	
 	QScopedPointer<GeoreferencingDialog> georeferencing_dialog;
+	QScopedPointer<InputRecording> input_recording;
+	QScopedPointer<MapTileExporter> tile_exporter;
+	QScopedPointer<MapTileExporter> vector_tile_exporter;
 	QScopedPointer<ReopenTemplateDialog> reopen_template_dialog;
 	
 	QHash<Template*, TemplatePositionDockWidget*> template_position_widgets;
@@ -24,15 +24,20 @@
 #include <algorithm>
 
 #include <qmath.h>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QScopedValueRollback>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
+#include "core/task_pool.h"
 #include "file_format.h"
 #include "map.h"
 #include "object.h"
 #include "object_operations.h"
 #include "object_undo.h"
 #include "renderable.h"
+#include "symbol.h"
 #include "util.h"
 #include "util/xml_stream_util.h"
 
@@ -47,12 +52,38 @@ namespace literal
 }
 
 
+/** The minimum number of objects for which importPart() uses worker threads. */
+const std::size_t min_concurrent_import_size = 1000;
+
+
+
+// ### MapPart::DeferredObjects ###
+
+/**
+ * The data which is needed for loading a part's objects later.
+ */
+struct MapPart::DeferredObjects
+{
+	QByteArray xml;                       ///< The part's element
+	SymbolDictionary symbol_dict;
+	MapCoord::BoundsOffset bounds_offset;
+	QString error;                        ///< The error from loading, or empty
+};
+
+
+
+// ### MapPart ###
+
+
 MapPart::MapPart(const QString& name, Map* map)
 : name(name)
+, symbol_index_size(0)
+, object_index_size(0)
 , map(map)
 {
 	Q_ASSERT(map);
-	; // nothing else
+	for (CachedExtent& cached : cached_extents)
+		cached.valid = false;
 }
 
 MapPart::~MapPart()
@@ -96,6 +127,12 @@ bool MapPart::load(QIODevice* file, int version, Map* map)
 
 void MapPart::save(QXmlStreamWriter& xml) const
 {
+	ensureLoaded();
+	
+	// Saving without the objects would lose them silently.
+	if (deferred)
+		throw FileFormatException(QCoreApplication::translate("MapPart", "The objects of map part \"%1\" could not be loaded:\n%2").arg(name, deferred->error));
+	
 	XmlElementWriter part_element(xml, literal::part);
 	part_element.writeAttribute(literal::name, name);
 	{
@@ -113,9 +150,37 @@ MapPart* MapPart::load(QXmlStreamReader& xml, Map& map, SymbolDictionary& symbol
 {
 	Q_ASSERT(xml.name() == literal::part);
 	
-	XmlElementReader part_element(xml);
-	MapPart* part = new MapPart(part_element.attribute<QString>(literal::name), &map);
+	MapPart* part = new MapPart(xml.attributes().value(literal::name).toString(), &map);
+	part->loadObjects(xml, symbol_dict);
+	return part;
+}
+
+MapPart* MapPart::loadDeferred(QXmlStreamReader& xml, Map& map, SymbolDictionary& symbol_dict)
+{
+	Q_ASSERT(xml.name() == literal::part);
+	
+	MapPart* part = new MapPart(xml.attributes().value(literal::name).toString(), &map);
+	part->deferred.reset(new DeferredObjects());
+	part->deferred->symbol_dict = symbol_dict;
+	part->deferred->bounds_offset = MapCoord::boundsOffset();
+	
+	// Copy the element, leaving the stream at its end element.
+	QXmlStreamWriter writer(&part->deferred->xml);
+	for (int depth = 0; !xml.hasError(); xml.readNext())
+	{
+		writer.writeCurrentToken(xml);
+		if (xml.isStartElement())
+			++depth;
+		else if (xml.isEndElement() && --depth == 0)
+			break;
+	}
 	
+	return part;
+}
+
+void MapPart::loadObjects(QXmlStreamReader& xml, SymbolDictionary& symbol_dict)
+{
+	XmlElementReader part_element(xml);
 	while (xml.readNextStartElement())
 	{
 		if (xml.name() == literal::objects)
@@ -124,65 +189,206 @@ MapPart* MapPart::load(QXmlStreamReader& xml, Map& map, SymbolDictionary& symbol
 			
 			std::size_t num_objects = objects_element.attribute<std::size_t>(literal::count);
 			if (num_objects > 0)
-				part->objects.reserve(qMin(num_objects, (std::size_t)20000)); // 20000 is not a limit
+				objects.reserve(qMin(num_objects, (std::size_t)20000)); // 20000 is not a limit
 			
+			// The coordinates are parsed concurrently after reading the elements.
+			ObjectLoadQueue queue;
 			while (xml.readNextStartElement())
 			{
 				if (xml.name() == literal::object)
-					part->objects.push_back(Object::load(xml, &map, symbol_dict));
+					objects.push_back(Object::load(xml, map, symbol_dict, nullptr, &queue));
 				else
 					xml.skipCurrentElement(); // unknown
 			}
+			queue.finish();
 		}
 		else
 			xml.skipCurrentElement(); // unknown
 	}
+}
+
+QString MapPart::loadingError() const
+{
+	return deferred ? deferred->error : QString();
+}
+
+void MapPart::loadDeferredObjects()
+{
+	Q_ASSERT(objects.empty());
 	
-	return part;
+	// Release the data first: accessing the objects must not recurse.
+	std::unique_ptr<DeferredObjects> data;
+	data.swap(deferred);
+	
+	try
+	{
+		QXmlStreamReader xml(data->xml);
+		if (xml.readNextStartElement() && xml.name() == literal::part)
+			loadObjects(xml, data->symbol_dict);
+		
+		if (xml.hasError())
+			throw FileFormatException(xml.errorString());
+	}
+	catch (FileFormatException& e)
+	{
+		// An incomplete part must neither be shown nor saved.
+		for (Object* object : objects)
+		{
+			map->unmarkAsIrregular(object);
+			delete object;
+		}
+		objects.clear();
+		data->error = e.message();
+		deferred.swap(data);
+		throw;
+	}
+}
+
+void MapPart::completeDeferredLoading()
+{
+	Q_ASSERT(deferred);
+	if (!deferred->error.isEmpty())
+		return;
+	
+	QScopedValueRollback<MapCoord::BoundsOffset> rollback { MapCoord::boundsOffset() };
+	MapCoord::boundsOffset() = deferred->bounds_offset;
+	try
+	{
+		loadDeferredObjects();
+	}
+	catch (FileFormatException& e)
+	{
+		qWarning() << "MapPart: Failed to load the objects of" << name << ":" << e.message();
+		emit map->mapPartLoadingFailed(name, e.message());
+		return;
+	}
+	
+	// The loaded objects are not recorded one by one.
+	map->changeFeed().invalidate();
+	
+	if (int num_undefined = postProcessObjects())
+		qDebug() << "MapPart: Found" << num_undefined << "object(s) without symbol in" << name;
+	map->deleteIrregularObjects();
+	
+	applyOnAllObjects(ObjectOp::SetOutputDirty());
+	map->updateObjects();
+	map->updateAllMapWidgets();
+}
+
+void MapPart::setDeferredBoundsOffset(const MapCoord::BoundsOffset& offset)
+{
+	if (deferred)
+		deferred->bounds_offset = offset;
+}
+
+bool MapPart::contains(const Object* object) const
+{
+	ensureSpatialIndex();
+	return spatial_index.contains(object);
 }
 
 int MapPart::findObjectIndex(const Object* object) const
 {
-	int size = objects.size();
-	for (int i = size - 1; i >= 0; --i)
+	int pos = lookupObjectIndex(object);
+	Q_ASSERT(pos >= 0);
+	return pos;
+}
+
+int MapPart::lookupObjectIndex(const Object* object) const
+{
+	ensureLoaded();
+	
+	auto entry = object_index.find(object);
+	if (entry != object_index.end()
+	    && std::size_t(entry->second) < object_index_size
+	    && objects[entry->second] == object)
 	{
-		if (objects[i] == object)
-			return i;
+		return entry->second;
 	}
-	Q_ASSERT(false);
-	return -1;
+	
+	// Renumber the remaining positions, including appended objects.
+	for (std::size_t i = object_index_size, size = objects.size(); i < size; ++i)
+		object_index[objects[i]] = int(i);
+	object_index_size = objects.size();
+	
+	entry = object_index.find(object);
+	return (entry != object_index.end()) ? entry->second : -1;
+}
+
+void MapPart::invalidateObjectIndex(std::size_t pos)
+{
+	object_index_size = qMin(object_index_size, pos);
 }
 
 void MapPart::setObject(Object* object, int pos, bool delete_old)
 {
+	ensureLoaded();
+	map->recordObjectChange(MapChange::ObjectRemoved, objects[pos], this, objects[pos]->getExtent());
 	map->removeRenderablesOfObject(objects[pos], true);
+	spatial_index.remove(objects[pos]);
+	removeFromSymbolIndex(objects[pos]);
+	object_index.erase(objects[pos]);
 	if (delete_old)
 		delete objects[pos];
 	
 	objects[pos] = object;
+	if (std::size_t(pos) < object_index_size)
+		object_index[object] = pos;
 	object->setMap(map);
+	map->recordObjectChange(MapChange::ObjectAdded, object, this, object->getExtent());
 	object->update();
+	spatial_index.insert(object, object->getExtent());
+	addToSymbolIndex(object);
+	map->advanceObjectsRevision();
 	map->setObjectsDirty(); // TODO: remove from here, dirty state handling should be separate
 }
 
 void MapPart::addObject(Object* object, int pos)
 {
+	ensureLoaded();
 	objects.insert(objects.begin() + pos, object);
+	invalidateObjectIndex(pos);
 	object->setMap(map);
+	map->recordObjectChange(MapChange::ObjectAdded, object, this, object->getExtent());
 	object->update();
+	spatial_index.insert(object, object->getExtent());
+	addToSymbolIndex(object);
+	map->advanceObjectsRevision();
 	
 	if (objects.size() == 1 && map->getNumObjects() == 1)
 		map->updateAllMapWidgets();
 }
 
+void MapPart::appendObjects(const std::vector<Object*>& new_objects)
+{
+	ensureLoaded();
+	objects.reserve(objects.size() + new_objects.size());
+	for (Object* object : new_objects)
+	{
+		objects.push_back(object);
+		object->setMap(map); // schedules the update
+		spatial_index.insert(object, object->getExtent());
+		addToSymbolIndex(object);
+		map->recordObjectChange(MapChange::ObjectAdded, object, this, object->getExtent());
+	}
+	map->advanceObjectsRevision();
+}
+
 void MapPart::deleteObject(int pos, bool remove_only)
 {
+	ensureLoaded();
+	map->recordObjectChange(MapChange::ObjectRemoved, objects[pos], this, objects[pos]->getExtent());
 	map->removeRenderablesOfObject(objects[pos], true);
+	spatial_index.remove(objects[pos]);
+	removeFromSymbolIndex(objects[pos]);
+	object_index.erase(objects[pos]);
 	if (remove_only)
 		objects[pos]->setMap(nullptr);
 	else
 		delete objects[pos];
 	objects.erase(objects.begin() + pos);
+	invalidateObjectIndex(pos);
+	map->advanceObjectsRevision();
 	
 	if (objects.empty() && map->getNumObjects() == 0)
 		map->updateAllMapWidgets();
@@ -190,20 +396,115 @@ void MapPart::deleteObject(int pos, bool remove_only)
 
 bool MapPart::deleteObject(Object* object, bool remove_only)
 {
-	int size = objects.size();
-	for (int i = size - 1; i >= 0; --i)
+	int pos = lookupObjectIndex(object);
+	if (pos < 0)
+		return false;
+	
+	deleteObject(pos, remove_only);
+	return true;
+}
+
+void MapPart::deleteObjects(const std::vector<int>& positions, bool remove_only)
+{
+	ensureLoaded();
+	if (positions.empty())
+		return;
+	
+	for (int pos : positions)
 	{
-		if (objects[i] == object)
+		map->recordObjectChange(MapChange::ObjectRemoved, objects[pos], this, objects[pos]->getExtent());
+		map->removeRenderablesOfObject(objects[pos], true);
+		spatial_index.remove(objects[pos]);
+		removeFromSymbolIndex(objects[pos]);
+		object_index.erase(objects[pos]);
+		if (remove_only)
+			objects[pos]->setMap(nullptr);
+		else
+			delete objects[pos];
+		objects[pos] = nullptr;
+	}
+	objects.erase(std::remove(objects.begin(), objects.end(), nullptr), objects.end());
+	invalidateObjectIndex(std::size_t(*std::min_element(positions.begin(), positions.end())));
+	map->advanceObjectsRevision();
+	
+	if (objects.empty() && map->getNumObjects() == 0)
+		map->updateAllMapWidgets();
+}
+
+void MapPart::moveObjectsTo(MapPart& target, const std::vector<int>& positions)
+{
+	Q_ASSERT(&target != this);
+	Q_ASSERT(target.map == map);
+	
+	ensureLoaded();
+	target.ensureLoaded();
+	if (positions.empty())
+		return;
+	
+	target.objects.reserve(target.objects.size() + positions.size());
+	for (int pos : positions)
+	{
+		Object* const object = objects[pos];
+		spatial_index.remove(object);
+		removeFromSymbolIndex(object);
+		object_index.erase(object);
+		objects[pos] = nullptr;
+		
+		// Appending does not invalidate the target's object index.
+		target.objects.push_back(object);
+		target.spatial_index.insert(object, object->getExtent());
+		target.addToSymbolIndex(object);
+		map->recordObjectChange(MapChange::ObjectModified, object, &target, object->getExtent());
+	}
+	objects.erase(std::remove(objects.begin(), objects.end(), nullptr), objects.end());
+	invalidateObjectIndex(std::size_t(*std::min_element(positions.begin(), positions.end())));
+	map->advanceObjectsRevision();
+}
+
+void MapPart::moveAllObjectsTo(MapPart& target)
+{
+	Q_ASSERT(&target != this);
+	Q_ASSERT(target.map == map);
+	
+	ensureLoaded();
+	target.ensureLoaded();
+	if (objects.empty())
+		return;
+	
+	for (const Object* object : objects)
+		map->recordObjectChange(MapChange::ObjectModified, object, &target, object->getExtent());
+	
+	if (target.objects.empty())
+	{
+		target.objects.swap(objects);
+		target.spatial_index.swap(spatial_index);
+		target.symbol_index.swap(symbol_index);
+		std::swap(target.symbol_index_size, symbol_index_size);
+		target.object_index.swap(object_index);
+		std::swap(target.object_index_size, object_index_size);
+	}
+	else
+	{
+		target.objects.reserve(target.objects.size() + objects.size());
+		for (Object* object : objects)
 		{
-			deleteObject(i, remove_only);
-			return true;
+			target.objects.push_back(object);
+			target.spatial_index.insert(object, object->getExtent());
+			target.addToSymbolIndex(object);
 		}
+		objects.clear();
+		spatial_index.clear();
+		symbol_index.clear();
+		symbol_index_size = 0;
+		object_index.clear();
+		object_index_size = 0;
 	}
-	return false;
+	map->advanceObjectsRevision();
 }
 
 void MapPart::importPart(MapPart* other, QHash<const Symbol*, Symbol*>& symbol_map, bool select_new_objects)
 {
+	ensureLoaded();
 	if (other->getNumObjects() == 0)
 		return;
 	
@@ -212,20 +513,46 @@ void MapPart::importPart(MapPart* other, QHash<const Symbol*, Symbol*>& symbol_m
 	if (select_new_objects)
 		map->clearObjectSelection(false);
 	
-	objects.reserve(objects.size() + other->objects.size());
-	for (const Object* object: other->objects)
+	// Duplicate the objects and replace the symbols, in parallel for many objects.
+	// The objects do not belong to a map yet, so the jobs share no state.
+	const std::vector<Object*>& source = other->objects;
+	std::vector<Object*> new_objects(source.size());
+	auto duplicate = [&source, &new_objects, &symbol_map](int i) {
+		Object* new_object = source[i]->duplicate();
+		auto symbol = symbol_map.constFind(new_object->getSymbol());
+		if (symbol != symbol_map.constEnd())
+			new_object->setSymbol(symbol.value(), true);
+		new_objects[i] = new_object;
+	};
+	if (source.size() >= min_concurrent_import_size)
+	{
+		TaskPool::forEach(int(source.size()), 64, duplicate);
+	}
+	else
+	{
+		for (int i = 0; i < int(source.size()); ++i)
+			duplicate(i);
+	}
+	
+	objects.reserve(objects.size() + new_objects.size());
+	for (Object* new_object : new_objects)
 	{
-		Object* new_object = object->duplicate();
-		if (symbol_map.contains(new_object->getSymbol()))
-			new_object->setSymbol(symbol_map.value(new_object->getSymbol()), true);
-		
 		objects.push_back(new_object);
-		new_object->setMap(map);
-		new_object->update();
-		
+		new_object->setMap(map); // schedules the update
+		spatial_index.insert(new_object, new_object->getExtent());
+		addToSymbolIndex(new_object);
+		map->recordObjectChange(MapChange::ObjectAdded, new_object, this, new_object->getExtent());
 		undo_step->addObject((int)objects.size() - 1);
-		if (select_new_objects)
-			map->addObjectToSelection(new_object, false);
+	}
+	map->advanceObjectsRevision();
+	
+	// Generates the renderables, concurrently for many objects.
+	map->updateObjects();
+	
+	if (select_new_objects)
+	{
+		map->addObjectToSelection(new_objects.front(), false);
+		map->addObjectsToSelection(new_objects, false);
 	}
 	
 	map->push(undo_step);
@@ -249,14 +576,20 @@ void MapPart::findObjectsAt(
         bool include_protected_objects,
         SelectionInfoVector& out ) const
 {
-	for (Object* object : objects)
+	ensureLoaded();
+	map->updateObjects();
+	
+	// Point objects are tested against the squared tolerance.
+	const qreal margin = qMax(qreal(tolerance), qSqrt(qreal(tolerance)));
+	std::vector<Object*> candidates;
+	spatial_index.query(QRectF(coord.x() - margin, coord.y() - margin, 2 * margin, 2 * margin), candidates);
+	for (Object* object : candidates)
 	{
 		if (!include_hidden_objects && object->getSymbol()->isHidden())
 			continue;
 		if (!include_protected_objects && object->getSymbol()->isProtected())
 			continue;
 		
-		object->update();
 		int selected_type = object->isPointOnObject(coord, tolerance, treat_areas_as_paths, extended_selection);
 		if (selected_type != (int)Symbol::NoSymbol)
 			out.emplace_back(selected_type, object);
@@ -270,28 +603,50 @@ void MapPart::findObjectsAtBox(
         bool include_protected_objects,
         std::vector< Object* >& out ) const
 {
+	ensureLoaded();
+	map->updateObjects();
+	
 	auto rect = QRectF(corner1, corner2).normalized();
-	for (Object* object : objects)
+	std::vector<Object*> candidates;
+	spatial_index.query(rect, candidates);
+	for (Object* object : candidates)
 	{
 		if (!include_hidden_objects && object->getSymbol()->isHidden())
 			continue;
 		if (!include_protected_objects && object->getSymbol()->isProtected())
 			continue;
 		
-		object->update();
 		if (rect.intersects(object->getExtent()) && object->intersectsBox(rect))
 			out.push_back(object);
 	}
 }
 
+void MapPart::findObjectsInRect(const QRectF& rect, std::vector<Object*>& out) const
+{
+	ensureLoaded();
+	ensureSpatialIndex();
+	
+	std::vector<Object*> candidates;
+	spatial_index.query(rect, candidates);
+	for (Object* object : candidates)
+	{
+		if (rect.intersects(object->getExtent()))
+			out.push_back(object);
+	}
+}
+
 int MapPart::countObjectsInRect(QRectF map_coord_rect, bool include_hidden_objects) const
 {
+	ensureLoaded();
+	map->updateObjects();
+	
 	int count = 0;
-	for (const Object* object : objects)
+	std::vector<Object*> candidates;
+	spatial_index.query(map_coord_rect, candidates);
+	for (const Object* object : candidates)
 	{
 		if (object->getSymbol()->isHidden() && !include_hidden_objects)
 			continue;
-		object->update();
 		if (object->getExtent().intersects(map_coord_rect))
 			++count;
 	}
@@ -300,6 +655,19 @@ int MapPart::countObjectsInRect(QRectF map_coord_rect, bool include_hidden_objec
 
 QRectF MapPart::calculateExtent(bool include_helper_symbols) const
 {
+	ensureLoaded();
+	
+	// The index is incomplete when objects were added without addObject().
+	CachedExtent& cached = cached_extents[include_helper_symbols ? 1 : 0];
+	if (cached.valid
+	    && cached.objects_revision == map->getObjectsRevision()
+	    && cached.properties_revision == map->getPropertiesRevision()
+	    && !map->hasScheduledObjectUpdates()
+	    && spatial_index.size() == objects.size())
+	{
+		return cached.rect;
+	}
+	
 	QRectF rect;
 	
 	int i = 0;
@@ -323,5 +691,127 @@ QRectF MapPart::calculateExtent(bool include_helper_symbols) const
 		}
 	}
 	
+	// Updating the objects may have changed the revision.
+	cached = { rect, map->getObjectsRevision(), map->getPropertiesRevision(), true };
 	return rect;
 }
+
+int MapPart::postProcessObjects()
+{
+	ensureLoaded();
+	
+	int num_undefined = 0;
+	for (int o = 0; o < getNumObjects(); ++o)
+	{
+		Object* object = objects[o];
+		if (object->getSymbol() == NULL)
+		{
+			++num_undefined;
+			if (object->getType() == Object::Point)
+				object->setSymbol(map->getUndefinedPoint(), true);
+			else if (object->getType() == Object::Path)
+				object->setSymbol(map->getUndefinedLine(), true);
+			else
+			{
+				// There is no undefined symbol for this type of object, delete the object
+				deleteObject(o, false);
+				--o;
+				continue;
+			}
+		}
+		
+		if (object->getType() == Object::Path)
+		{
+			PathObject* path = object->asPath();
+			Symbol::Type contained_types = path->getSymbol()->getContainedTypes();
+			if (contained_types & Symbol::Area && !(contained_types & Symbol::Line))
+				path->closeAllParts();
+			
+			path->normalize();
+		}
+	}
+	return num_undefined;
+}
+
+bool MapPart::updateSpatialIndex(const Object* object)
+{
+	if (!spatial_index.update(object, object->getExtent()))
+		return false;
+	
+	map->advanceObjectsRevision();
+	return true;
+}
+
+void MapPart::ensureSpatialIndex() const
+{
+	if (spatial_index.size() != objects.size())
+	{
+		// Objects were added without addObject(), e.g. when loading a file.
+		spatial_index.clear();
+		for (Object* object : objects)
+			spatial_index.insert(object, object->getExtent());
+		map->advanceObjectsRevision();
+		
+		// Updating an object also updates its index entry.
+		for (const Object* object : objects)
+			object->update();
+	}
+}
+
+bool MapPart::existsObjectWithSymbol(const Symbol* symbol) const
+{
+	ensureLoaded();
+	ensureSymbolIndex();
+	return symbol_index.find(symbol) != symbol_index.end();
+}
+
+void MapPart::findObjectsWithSymbol(const Symbol* symbol, std::vector<Object*>& out) const
+{
+	ensureLoaded();
+	ensureSymbolIndex();
+	auto found = symbol_index.find(symbol);
+	if (found != symbol_index.end())
+		out.insert(out.end(), found->second.begin(), found->second.end());
+}
+
+bool MapPart::updateSymbolIndex(Object* object, const Symbol* old_symbol)
+{
+	auto found = symbol_index.find(old_symbol);
+	if (found == symbol_index.end() || !found->second.erase(object))
+		return false;
+	
+	if (found->second.empty())
+		symbol_index.erase(found);
+	symbol_index[object->getSymbol()].insert(object);
+	return true;
+}
+
+void MapPart::ensureSymbolIndex() const
+{
+	// The index holds only objects of this part, so equal sizes mean that
+	// all objects are registered.
+	if (symbol_index_size != objects.size())
+	{
+		symbol_index.clear();
+		for (Object* object : objects)
+			symbol_index[object->getSymbol()].insert(object);
+		symbol_index_size = objects.size();
+	}
+}
+
+void MapPart::addToSymbolIndex(Object* object)
+{
+	if (symbol_index[object->getSymbol()].insert(object).second)
+		++symbol_index_size;
+}
+
+void MapPart::removeFromSymbolIndex(Object* object)
+{
+	auto found = symbol_index.find(object->getSymbol());
+	if (found != symbol_index.end() && found->second.erase(object))
+	{
+		--symbol_index_size;
+		if (found->second.empty())
+			symbol_index.erase(found);
+	}
+}
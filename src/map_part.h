@@ -22,12 +22,18 @@
 #ifndef _OPENORIENTEERING_MAP_PART_H_
 #define _OPENORIENTEERING_MAP_PART_H_
 
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <QHash>
 #include <QRect>
 #include <QString>
 
+#include "core/map_coord.h"
+#include "core/spatial_index.h"
+
 QT_BEGIN_NAMESPACE
 class QIODevice;
 class QXmlStreamReader;
@@ -35,7 +41,6 @@ class QXmlStreamWriter;
 QT_END_NAMESPACE
 
 class Map;
-class MapCoord;
 class MapCoordF;
 class Object;
 class OCAD8FileImport;
@@ -63,6 +68,7 @@ typedef std::vector< std::pair< int, Object* > > SelectionInfoVector;
 class MapPart
 {
 friend class OCAD8FileImport;
+friend class XMLFileImporter;
 public:
 	/**
 	 * Creates a new map part with the given name for a map.
@@ -92,6 +98,41 @@ public:
 	 */
 	static MapPart* load(QXmlStreamReader& xml, Map& map, SymbolDictionary& symbol_dict);
 	
+	/**
+	 * Reads the map part in xml format from the given stream, but defers
+	 * the loading of the objects until they are needed.
+	 * 
+	 * The part's element is kept as unparsed XML. The objects are loaded
+	 * by ensureLoaded(), which is called by all functions which access the
+	 * objects. Until then, the symbols in the dictionary must not be deleted.
+	 */
+	static MapPart* loadDeferred(QXmlStreamReader& xml, Map& map, SymbolDictionary& symbol_dict);
+	
+	/**
+	 * Returns false if the loading of the objects was deferred and is
+	 * still pending, or if it failed.
+	 */
+	bool isLoaded() const;
+	
+	/**
+	 * Loads the objects if their loading was deferred.
+	 * 
+	 * The new objects are updated and shown in the map widgets.
+	 * 
+	 * If the loading fails, the part remains not loaded and without objects,
+	 * and the map is not modified otherwise. Map::mapPartLoadingFailed() is
+	 * emitted, and the loading is not tried again.
+	 */
+	void ensureLoaded() const;
+	
+	/**
+	 * Returns the error message if the loading of the deferred objects
+	 * failed, or an empty string.
+	 * 
+	 * A map with such a part must not be saved: its objects are missing.
+	 */
+	QString loadingError() const;
+	
 	/**
 	 * Returns the part's name.
 	 */
@@ -118,11 +159,18 @@ public:
 	 */
 	Object* getObject(int i);
 	
+	/**
+	 * Returns true if the given object is contained in this part.
+	 * 
+	 * This lookup takes constant time. The object pointer is not dereferenced.
+	 */
+	bool contains(const Object* object) const;
+	
 	/**
 	 * Returns the index of the object.
 	 * 
-	 * Loops over all objects in the part and looks for the given pointer.
-	 * The object must be contained in this part,
+	 * This is a lookup in the part's object index which takes amortized
+	 * constant time. The object must be contained in this part,
 	 * otherwise an assert is triggered (in debug builds),
 	 * or -1 is returned (release builds).
 	 */
@@ -140,6 +188,15 @@ public:
 	 */
 	void addObject(Object* object, int pos);
 	
+	/**
+	 * Adds the objects at the end of the part, without updating them.
+	 * 
+	 * Unlike addObject(), this leaves the generation of the renderables to
+	 * the next Map::updateObjects(), which processes many objects
+	 * concurrently. This is meant for importers.
+	 */
+	void appendObjects(const std::vector<Object*>& new_objects);
+	
 	/**
 	 * Deleted the object from the given index.
 	 * 
@@ -159,6 +216,34 @@ public:
 	 */
 	bool deleteObject(Object* object, bool remove_only);
 	
+	/**
+	 * Deletes the objects at the given indices, in a single pass.
+	 * 
+	 * If remove_only is set, does not call "delete object".
+	 * The indices must be distinct. Their order does not matter.
+	 */
+	void deleteObjects(const std::vector<int>& positions, bool remove_only);
+	
+	/**
+	 * Moves the objects at the given positions to the end of the target part.
+	 * 
+	 * This is a pure container operation: The objects keep their renderables,
+	 * and their entries in the spatial index and in the symbol index are
+	 * transferred to the target part. The objects are appended in the order
+	 * of the positions. The positions must be distinct.
+	 * 
+	 * The target part must belong to the same map.
+	 */
+	void moveObjectsTo(MapPart& target, const std::vector<int>& positions);
+	
+	/**
+	 * Moves all objects to the end of the target part.
+	 * 
+	 * Like moveObjectsTo(), but when the target part is empty, the objects
+	 * and the indices are exchanged as a whole.
+	 */
+	void moveAllObjectsTo(MapPart& target);
+	
 	
 	/**
 	 * Imports the contents another part into this part.
@@ -166,6 +251,9 @@ public:
 	 * The other part can be from another map.
 	 * Uses symbol_map to replace all symbols contained there.
 	 * No replacement is done for symbols which are not in the symbol_map.
+	 * 
+	 * For many objects, duplication and the generation of renderables
+	 * runs in worker threads.
 	 */
 	void importPart(MapPart* other, QHash<const Symbol*, Symbol*>& symbol_map,
 		bool select_new_objects);
@@ -185,6 +273,15 @@ public:
 		bool include_hidden_objects, bool include_protected_objects,
 		std::vector<Object*>& out) const;
 	
+	/**
+	 * Appends the objects whose extent intersects the given rect to out,
+	 * in no particular order.
+	 * 
+	 * This uses only the spatial index. The objects' extents must be up to
+	 * date, cf. Map::updateObjects().
+	 */
+	void findObjectsInRect(const QRectF& rect, std::vector<Object*>& out) const;
+	
 	/** 
 	 * @see Map::countObjectsInRect().
 	 */
@@ -192,9 +289,67 @@ public:
 	
 	/**
 	 * Calculates and returns the bounding box of all objects in this map part.
+	 * 
+	 * The result is cached. It is calculated again only when the objects
+	 * revision or the properties revision of the map has changed, or when
+	 * object updates are pending.
 	 */
 	QRectF calculateExtent(bool include_helper_symbols) const;
 	
+	/**
+	 * Prepares the objects for use after importing.
+	 * 
+	 * Objects without symbol get the map's undefined symbol, or they are
+	 * deleted if there is no undefined symbol for their type. Area-only paths
+	 * are closed, and all paths are normalized.
+	 * 
+	 * @return The number of objects which had no symbol.
+	 */
+	int postProcessObjects();
+	
+	/**
+	 * Updates the spatial index entry of the given object from its extent.
+	 * 
+	 * This is called by Object::update() (via Map) when the object's extent
+	 * has been recalculated.
+	 * 
+	 * @return False if the object is not registered in this part's index.
+	 */
+	bool updateSpatialIndex(const Object* object);
+	
+	/**
+	 * Brings the spatial index in sync with the objects.
+	 * 
+	 * Objects which were added directly to the object list (e.g. by importers)
+	 * are registered and updated. This is a cheap operation when the index
+	 * is already in sync.
+	 */
+	void ensureSpatialIndex() const;
+	
+	/**
+	 * Returns true if there is an object with the given symbol in this part.
+	 * 
+	 * This is a lookup in the part's symbol index.
+	 */
+	bool existsObjectWithSymbol(const Symbol* symbol) const;
+	
+	/**
+	 * Appends the objects with the given symbol to out, in no particular order.
+	 * 
+	 * This is a lookup in the part's symbol index.
+	 */
+	void findObjectsWithSymbol(const Symbol* symbol, std::vector<Object*>& out) const;
+	
+	/**
+	 * Moves the given object from the symbol index entry of old_symbol to
+	 * the entry of its current symbol.
+	 * 
+	 * This is called by Object::setSymbol() (via Map).
+	 * 
+	 * @return False if the object is not registered in this part's index.
+	 */
+	bool updateSymbolIndex(Object* object, const Symbol* old_symbol);
+	
 	
 	/**
 	 * Applies a condition on all objects (until the first match is found).
@@ -227,9 +382,97 @@ public:
 	
 private:
 	typedef std::vector<Object*> ObjectList;
-
+	
+	struct DeferredObjects;
+	
+	/**
+	 * Loads the objects from the given stream.
+	 * 
+	 * The stream must be positioned at the part's start element.
+	 */
+	void loadObjects(QXmlStreamReader& xml, SymbolDictionary& symbol_dict);
+	
+	/**
+	 * Loads the deferred objects, using the current global bounds offset.
+	 * 
+	 * This is used by the importer, and by completeDeferredLoading().
+	 * Errors are reported by throwing a FileFormatException. Then the
+	 * objects which were loaded are deleted, and the part keeps the deferred
+	 * data together with the error message.
+	 */
+	void loadDeferredObjects();
+	
+	/**
+	 * Loads the deferred objects, post-processes and updates them.
+	 * 
+	 * Does nothing if the loading failed before.
+	 */
+	void completeDeferredLoading();
+	
+	/**
+	 * Sets the bounds offset to be used when loading the deferred objects.
+	 */
+	void setDeferredBoundsOffset(const MapCoord::BoundsOffset& offset);
+	
+	/**
+	 * Brings the symbol index in sync with the objects.
+	 * 
+	 * Like ensureSpatialIndex(), this rebuilds the index when objects were
+	 * added directly to the object list.
+	 */
+	void ensureSymbolIndex() const;
+	
+	/** Registers an object in the symbol index. */
+	void addToSymbolIndex(Object* object);
+	
+	/** Removes an object from the symbol index. */
+	void removeFromSymbolIndex(Object* object);
+	
+	/**
+	 * Returns the index of the object, or -1 if it is not in this part.
+	 */
+	int lookupObjectIndex(const Object* object) const;
+	
+	/**
+	 * Marks the object index as invalid from the given position.
+	 * 
+	 * This must be called when objects are inserted or removed at pos.
+	 * Appending objects does not invalidate the index.
+	 */
+	void invalidateObjectIndex(std::size_t pos);
+	
+	
+	typedef std::unordered_map<const Symbol*, std::unordered_set<Object*>> SymbolIndex;
+	
+	/**
+	 * A lookup of object positions.
+	 * 
+	 * Only the entries for positions before object_index_size are valid.
+	 * Insertions and removals lower this limit instead of renumbering the
+	 * entries immediately, so that a series of changes near the end of the
+	 * list stays cheap. findObjectIndex() renumbers the remaining entries
+	 * when needed.
+	 */
+	typedef std::unordered_map<const Object*, int> ObjectIndex;
+	
+	/** A result of calculateExtent(), with the map revisions it is valid for. */
+	struct CachedExtent
+	{
+		QRectF rect;
+		quint64 objects_revision;
+		quint64 properties_revision;
+		bool valid;
+	};
+	
 	QString name;
-	ObjectList objects;  ///< @todo This could be a spatial representation optimized for quick access
+	ObjectList objects;
+	mutable SpatialIndex<Object> spatial_index;  ///< Lookup of objects by extent
+	mutable SymbolIndex symbol_index;            ///< Lookup of objects by symbol
+	mutable std::size_t symbol_index_size;       ///< The number of objects in symbol_index
+	mutable ObjectIndex object_index;            ///< Lookup of positions by object
+	mutable std::size_t object_index_size;       ///< The number of valid positions in object_index
+	mutable CachedExtent cached_extents[2];      ///< Without and with helper symbols
+	std::unique_ptr<DeferredObjects> deferred;   ///< Pending objects, or nullptr
 	Map* const map;
 };
 
@@ -243,27 +486,44 @@ const QString& MapPart::getName() const
 	return name;
 }
 
+inline
+bool MapPart::isLoaded() const
+{
+	return !deferred;
+}
+
+inline
+void MapPart::ensureLoaded() const
+{
+	if (Q_UNLIKELY(deferred))
+		const_cast<MapPart*>(this)->completeDeferredLoading();
+}
+
 inline
 int MapPart::getNumObjects() const
 {
+	ensureLoaded();
 	return (int)objects.size();
 }
 
 inline
 Object* MapPart::getObject(int i)
 {
+	ensureLoaded();
 	return objects[i];
 }
 
 inline
 const Object* MapPart::getObject(int i) const
 {
+	ensureLoaded();
 	return objects[i];
 }
 
 template<typename Condition>
 bool MapPart::existsObject(const Condition& condition) const
 {
+   ensureLoaded();
    for (ObjectList::const_iterator object = objects.begin(), end = objects.end(); object != end; ++object)
    {
 	   if (condition(*object))
@@ -275,6 +535,7 @@ bool MapPart::existsObject(const Condition& condition) const
 template<typename Operation, typename Condition>
 bool MapPart::applyOnMatchingObjects(const Operation& operation, const Condition& condition)
 {
+   ensureLoaded();
    bool result = true;
    if (!objects.empty())
    {
@@ -294,6 +555,7 @@ bool MapPart::applyOnMatchingObjects(const Operation& operation, const Condition
 template<typename Operation>
 bool MapPart::applyOnAllObjects(const Operation& operation)
 {
+   ensureLoaded();
    bool result = true;
    if (!objects.empty())
    {
@@ -311,6 +573,7 @@ bool MapPart::applyOnAllObjects(const Operation& operation)
 template<typename Operation>
 bool MapPart::applyOnAllObjects(Operation& operation)
 {
+	ensureLoaded();
 	bool result = true;
 	if (!objects.empty())
 	{
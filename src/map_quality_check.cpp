@@ -0,0 +1,537 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "map_quality_check.h"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+#include <QHash>
+
+#include "map.h"
+#include "map_part.h"
+#include "object.h"
+#include "object_text.h"
+#include "symbol.h"
+#include "symbol_area.h"
+#include "symbol_line.h"
+
+
+namespace
+{
+	/** Paths which are shorter than this are degenerate, in mm. */
+	const double min_path_length = 0.001;
+	
+	/** Areas which are smaller than this are degenerate, in mm². */
+	const double min_path_area = 0.000001;
+	
+	/** Points which are closer to a boundary are on the boundary, in mm. */
+	const double boundary_tolerance = 0.001;
+	
+	
+	/**
+	 * The flattened geometry of a single object.
+	 *
+	 * The geometry is calculated from the object's coordinates instead of
+	 * using the object's own path parts: These may be updated lazily, which
+	 * must not happen concurrently, and a snapshot may be shared with other
+	 * jobs.
+	 */
+	struct Geometry
+	{
+		std::vector<PathPart> parts;
+		double length = 0.0;
+		double area = 0.0;
+		uint hash = 0;
+	};
+	
+	
+	/** Returns a hash of the symbol, the type and the coordinates of the object. */
+	uint objectHash(const Object* object)
+	{
+		uint hash = qHash(object->getSymbol()) ^ uint(object->getType());
+		for (const MapCoord& coord : object->getRawCoordinateVector())
+		{
+			hash = 31 * hash + uint(coord.nativeX());
+			hash = 31 * hash + uint(coord.nativeY());
+			hash = 31 * hash + uint(coord.flags());
+		}
+		if (object->getType() == Object::Text)
+			hash ^= qHash(object->asText()->getText());
+		return hash;
+	}
+	
+	/** Returns true if the rects touch, including rects of zero width or height. */
+	bool touches(const QRectF& a, const QRectF& b)
+	{
+		return a.left() <= b.right() && b.left() <= a.right()
+		       && a.top() <= b.bottom() && b.top() <= a.bottom();
+	}
+	
+	/** Returns the bounding box of a segment. */
+	QRectF segmentBox(MapCoordF a, MapCoordF b)
+	{
+		return QRectF(a, b).normalized();
+	}
+	
+	/** Returns a square with the given half size around pos. */
+	QRectF boxAround(MapCoordF pos, double size)
+	{
+		return QRectF(pos.x() - size, pos.y() - size, 2 * size, 2 * size);
+	}
+	
+	/** Returns the distance of pos from the segment from a to b. */
+	double distanceToSegment(MapCoordF pos, MapCoordF a, MapCoordF b)
+	{
+		const MapCoordF ab = b - a;
+		const double length_sq = ab.lengthSquared();
+		if (length_sq <= 0.0)
+			return pos.distanceTo(a);
+		const double t = qBound(0.0, MapCoordF::dotProduct(pos - a, ab) / length_sq, 1.0);
+		return pos.distanceTo(a + ab * t);
+	}
+	
+	/**
+	 * Returns +1 or -1 for the side of the line through a and b on which pos
+	 * is, or 0 if pos is closer to the line than the boundary tolerance.
+	 */
+	int side(MapCoordF a, MapCoordF b, MapCoordF pos)
+	{
+		const double cross = (b.x() - a.x()) * (pos.y() - a.y()) - (b.y() - a.y()) * (pos.x() - a.x());
+		const double limit = boundary_tolerance * a.distanceTo(b);
+		return (cross > limit) ? 1 : ((cross < -limit) ? -1 : 0);
+	}
+	
+	/**
+	 * Returns true if the segments cross each other at a single point
+	 * which is not at their ends.
+	 */
+	bool segmentsCross(MapCoordF a0, MapCoordF a1, MapCoordF b0, MapCoordF b1)
+	{
+		return side(b0, b1, a0) * side(b0, b1, a1) < 0
+		       && side(a0, a1, b0) * side(a0, a1, b1) < 0;
+	}
+	
+	/**
+	 * Builds the segment boxes of the part.
+	 *
+	 * Afterwards, the part may be searched from multiple threads.
+	 */
+	void prepareSegmentBoxes(const PathPart& part)
+	{
+		part.path_coords.visitSegments([](const QRectF&) { return false; },
+		                               [](std::size_t) { return false; });
+	}
+	
+	/** Returns true if pos is inside the area of the geometry, considering holes. */
+	bool isInside(const Geometry& geometry, MapCoordF pos)
+	{
+		bool inside = false;
+		for (const auto& part : geometry.parts)
+		{
+			if (part.isPointInside(pos))
+				inside = !inside;
+		}
+		return inside;
+	}
+	
+	/** Returns true if pos is on the boundary of the geometry. */
+	bool isOnBoundary(const Geometry& geometry, MapCoordF pos)
+	{
+		const QRectF box = boxAround(pos, boundary_tolerance);
+		for (const auto& part : geometry.parts)
+		{
+			const auto& coords = part.path_coords;
+			if (coords.visitSegments(
+			        [&box](const QRectF& segment_box) { return touches(segment_box, box); },
+			        [&coords, pos](std::size_t i) {
+			            return distanceToSegment(pos, coords[i].pos, coords[i+1].pos) <= boundary_tolerance;
+			        }))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+	
+	/**
+	 * Returns true if a vertex or a segment midpoint of inner, within the
+	 * given rect, is strictly inside the area of outer.
+	 */
+	bool hasInteriorPoint(const Geometry& inner, const Geometry& outer, const QRectF& rect)
+	{
+		auto isInterior = [&outer, &rect](MapCoordF pos) {
+			return touches(rect, QRectF(pos, pos))
+			       && isInside(outer, pos)
+			       && !isOnBoundary(outer, pos);
+		};
+		
+		for (const auto& part : inner.parts)
+		{
+			const auto& coords = part.path_coords;
+			for (std::size_t i = 0; i + 1 < coords.size(); ++i)
+			{
+				const MapCoordF pos = coords[i].pos;
+				if (isInterior(pos) || isInterior((pos + coords[i+1].pos) / 2))
+					return true;
+			}
+		}
+		return false;
+	}
+	
+	/**
+	 * Returns true if the areas of the geometries overlap in more than
+	 * their boundaries. The overlap must be within the given rect.
+	 */
+	bool areasOverlap(const Geometry& a, const Geometry& b, const QRectF& rect)
+	{
+		auto rectTest = [&rect](const QRectF& box) { return touches(box, rect); };
+		for (const auto& part_a : a.parts)
+		{
+			const auto& coords_a = part_a.path_coords;
+			if (coords_a.visitSegments(rectTest, [&coords_a, &rect, &b](std::size_t i) {
+				const MapCoordF a0 = coords_a[i].pos;
+				const MapCoordF a1 = coords_a[i+1].pos;
+				const QRectF box_a = segmentBox(a0, a1);
+				if (!touches(box_a, rect))
+					return false;
+				
+				for (const auto& part_b : b.parts)
+				{
+					const auto& coords_b = part_b.path_coords;
+					if (coords_b.visitSegments(
+					        [&box_a](const QRectF& box) { return touches(box, box_a); },
+					        [&coords_b, a0, a1](std::size_t j) {
+					            return segmentsCross(a0, a1, coords_b[j].pos, coords_b[j+1].pos);
+					        }))
+					{
+						return true;
+					}
+				}
+				return false;
+			}))
+			{
+				return true;
+			}
+		}
+		
+		// Without crossing boundaries, one area may still contain the other.
+		return hasInteriorPoint(b, a, rect) || hasInteriorPoint(a, b, rect);
+	}
+	
+	
+	
+	/**
+	 * Checks the objects of a single map part.
+	 *
+	 * prepare() and checkObject() may be called concurrently for different
+	 * objects, but all objects must be prepared before the first one is
+	 * checked.
+	 */
+	class PartChecker
+	{
+	public:
+		PartChecker(const MapPart* part, int part_index, const MapQualityCheck::Options& options)
+		 : part(part)
+		 , part_index(part_index)
+		 , options(options)
+		 , geometries(std::size_t(part->getNumObjects()))
+		{
+			object_indices.reserve(geometries.size());
+			for (int i = 0; i < part->getNumObjects(); ++i)
+				object_indices[part->getObject(i)] = i;
+		}
+		
+		/** Flattens, measures and hashes the object with the given index. */
+		void prepare(int i)
+		{
+			const Object* object = part->getObject(i);
+			Geometry& geometry = geometries[std::size_t(i)];
+			geometry.hash = objectHash(object);
+			if (object->getType() != Object::Path)
+				return;
+			
+			const PathPartVector parts = PathPart::calculatePathParts(VirtualCoordVector(object->getRawCoordinateVector()));
+			geometry.parts.assign(parts.begin(), parts.end());
+			for (const auto& path_part : geometry.parts)
+			{
+				prepareSegmentBoxes(path_part);
+				geometry.length += path_part.length();
+			}
+			
+			// The first part is the outline, the other parts are holes.
+			for (const auto& path_part : geometry.parts)
+			{
+				if (path_part.path_coords.empty())
+					continue;
+				if (&path_part == &geometry.parts.front())
+					geometry.area += path_part.calculateArea();
+				else
+					geometry.area -= path_part.calculateArea();
+			}
+			geometry.area = std::max(0.0, geometry.area);
+		}
+		
+		/** Runs the checks of single objects and of pairs with objects of higher index. */
+		void checkObject(int i, std::vector<MapQualityCheck::Issue>& issues) const
+		{
+			const Object* object = part->getObject(i);
+			const Symbol* symbol = object->getSymbol();
+			if (object->getType() != Object::Path || !symbol)
+				return;
+			
+			const Geometry& geometry = geometries[std::size_t(i)];
+			const QRectF& extent = object->getExtent();
+			const auto types = symbol->getContainedTypes();
+			const bool is_area = types & Symbol::Area;
+			if (geometry.length < min_path_length || (is_area && geometry.area < min_path_area))
+			{
+				issues.push_back({ MapQualityCheck::DegeneratePath, part_index, i, -1, extent });
+				return;
+			}
+			
+			if (isBelowMinimumSize(symbol, geometry))
+				issues.push_back({ MapQualityCheck::BelowMinimumSize, part_index, i, -1, extent });
+			
+			if (is_area)
+				checkOverlaps(i, object, issues);
+			else if (types & Symbol::Line)
+				checkLineEnds(i, object, issues);
+		}
+		
+		/** Finds objects which are equal to an object of lower index. */
+		void checkDuplicates(std::vector<MapQualityCheck::Issue>& issues) const
+		{
+			std::vector<int> order(geometries.size());
+			std::iota(begin(order), end(order), 0);
+			std::stable_sort(begin(order), end(order), [this](int a, int b) {
+				return geometries[std::size_t(a)].hash < geometries[std::size_t(b)].hash;
+			});
+			
+			for (auto first = begin(order); first != end(order); )
+			{
+				const uint hash = geometries[std::size_t(*first)].hash;
+				auto last = std::find_if(first, end(order), [this, hash](int i) {
+					return geometries[std::size_t(i)].hash != hash;
+				});
+				for (auto current = first + 1; current < last; ++current)
+				{
+					const Object* object = part->getObject(*current);
+					auto original = std::find_if(first, current, [this, object](int i) {
+						return part->getObject(i)->equals(object, true);
+					});
+					if (original != current)
+						issues.push_back({ MapQualityCheck::DuplicateObject, part_index, *current, *original, object->getExtent() });
+				}
+				first = last;
+			}
+		}
+	
+	private:
+		/** Returns true if the geometry is smaller than the symbol's minimum size. */
+		bool isBelowMinimumSize(const Symbol* symbol, const Geometry& geometry) const
+		{
+			// The minimum sizes are in 0.001 mm and 0.001 mm², respectively.
+			switch (symbol->getType())
+			{
+			case Symbol::Line:
+				return geometry.length < 0.001 * symbol->asLine()->getMinimumLength();
+			case Symbol::Area:
+				return geometry.area < 0.001 * symbol->asArea()->getMinimumArea();
+			default:
+				return false;
+			}
+		}
+		
+		/** Returns the index of another object with the same symbol, or -1. */
+		int indexOfSimilar(const Object* object, const Object* other) const
+		{
+			if (other->getSymbol() != object->getSymbol() || other->getType() != Object::Path)
+				return -1;
+			auto found = object_indices.find(other);
+			return (found == object_indices.end()) ? -1 : found->second;
+		}
+		
+		void checkOverlaps(int i, const Object* object, std::vector<MapQualityCheck::Issue>& issues) const
+		{
+			const Geometry& geometry = geometries[std::size_t(i)];
+			const QRectF& extent = object->getExtent();
+			std::vector<Object*> candidates;
+			part->findObjectsInRect(extent, candidates);
+			for (const Object* other : candidates)
+			{
+				const int j = indexOfSimilar(object, other);
+				if (j <= i)
+					continue;
+				
+				// Duplicates are reported separately.
+				const Geometry& other_geometry = geometries[std::size_t(j)];
+				if (other_geometry.hash == geometry.hash && other->equals(object, true))
+					continue;
+				
+				// Areas which only touch have no common interior.
+				const QRectF common = extent.intersected(other->getExtent());
+				if (common.isEmpty())
+					continue;
+				
+				if (areasOverlap(geometry, other_geometry, common))
+					issues.push_back({ MapQualityCheck::OverlappingAreas, part_index, i, j, extent.united(other->getExtent()) });
+			}
+		}
+		
+		void checkLineEnds(int i, const Object* object, std::vector<MapQualityCheck::Issue>& issues) const
+		{
+			const double tolerance = options.end_gap_tolerance;
+			auto isGap = [tolerance](MapCoordF a, MapCoordF b) {
+				const double distance = a.distanceTo(b);
+				return distance > 0.0 && distance <= tolerance;
+			};
+			
+			std::vector<int> reported;
+			std::vector<Object*> candidates;
+			for (const auto& path_part : geometries[std::size_t(i)].parts)
+			{
+				const auto& coords = path_part.path_coords;
+				if (path_part.isClosed() || coords.size() < 2)
+					continue;
+				
+				const MapCoordF ends[2] = { coords.front().pos, coords.back().pos };
+				if (isGap(ends[0], ends[1]) && path_part.length() > 2 * tolerance)
+					issues.push_back({ MapQualityCheck::AlmostTouchingEnds, part_index, i, -1, segmentBox(ends[0], ends[1]) });
+				
+				for (const MapCoordF& line_end : ends)
+				{
+					candidates.clear();
+					part->findObjectsInRect(boxAround(line_end, tolerance), candidates);
+					for (const Object* other : candidates)
+					{
+						const int j = indexOfSimilar(object, other);
+						if (j <= i || std::find(begin(reported), end(reported), j) != end(reported))
+							continue;
+						
+						for (const auto& other_part : geometries[std::size_t(j)].parts)
+						{
+							const auto& other_coords = other_part.path_coords;
+							if (other_part.isClosed() || other_coords.empty())
+								continue;
+							
+							const MapCoordF other_end = isGap(line_end, other_coords.front().pos) ? other_coords.front().pos : other_coords.back().pos;
+							if (isGap(line_end, other_end))
+							{
+								issues.push_back({ MapQualityCheck::AlmostTouchingEnds, part_index, i, j, segmentBox(line_end, other_end) });
+								reported.push_back(j);
+								break;
+							}
+						}
+					}
+				}
+			}
+		}
+		
+		const MapPart* const part;
+		const int part_index;
+		const MapQualityCheck::Options& options;
+		std::vector<Geometry> geometries;
+		std::unordered_map<const Object*, int> object_indices;
+	};
+
+}
+
+
+
+// ### MapQualityCheck::Options ###
+
+MapQualityCheck::Options::Options()
+ : end_gap_tolerance(0.2)
+{
+	// nothing else
+}
+
+
+
+// ### MapQualityCheck ###
+
+MapQualityCheck::MapQualityCheck()
+{
+	; // nothing
+}
+
+MapQualityCheck MapQualityCheck::run(const Map& map, const Options& options, const TaskPool::CancellationToken* token)
+{
+	MapQualityCheck result;
+	
+	for (int p = 0; p < map.getNumParts(); ++p)
+	{
+		const MapPart* part = map.getPart(std::size_t(p));
+		const int num_objects = part->getNumObjects();
+		if (num_objects == 0)
+			continue;
+		
+		// The jobs only read the index, so it must be in sync before.
+		part->ensureSpatialIndex();
+		
+		PartChecker checker(part, p, options);
+		TaskPool::forEach(num_objects, 64, [&checker](int i) {
+			checker.prepare(i);
+		}, token);
+		
+		std::vector< std::vector<Issue> > object_issues(std::size_t(num_objects), std::vector<Issue>());
+		TaskPool::forEach(num_objects, 16, [&checker, &object_issues](int i) {
+			checker.checkObject(i, object_issues[std::size_t(i)]);
+		}, token);
+		
+		if (token && token->isCancelled())
+			break;
+		
+		checker.checkDuplicates(result.issue_list);
+		for (const auto& issues : object_issues)
+			result.issue_list.insert(end(result.issue_list), begin(issues), end(issues));
+	}
+	
+	std::sort(begin(result.issue_list), end(result.issue_list), [](const Issue& a, const Issue& b) {
+		if (a.part_index != b.part_index)
+			return a.part_index < b.part_index;
+		if (a.type != b.type)
+			return a.type < b.type;
+		if (a.object_index != b.object_index)
+			return a.object_index < b.object_index;
+		return a.other_object_index < b.other_object_index;
+	});
+	return result;
+}
+
+QString MapQualityCheck::typeName(IssueType type)
+{
+	switch (type)
+	{
+	case DuplicateObject:
+		return tr("Duplicate object");
+	case OverlappingAreas:
+		return tr("Overlapping areas");
+	case DegeneratePath:
+		return tr("Degenerate path");
+	case BelowMinimumSize:
+		return tr("Below minimum size");
+	case AlmostTouchingEnds:
+		return tr("Almost touching line ends");
+	}
+	return QString();
+}
@@ -0,0 +1,135 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_MAP_QUALITY_CHECK_H_
+#define _OPENORIENTEERING_MAP_QUALITY_CHECK_H_
+
+#include <vector>
+
+#include <QCoreApplication>
+#include <QRectF>
+#include <QString>
+
+#include "core/task_pool.h"
+
+class Map;
+
+
+/**
+ * @brief MapQualityCheck finds common mistakes in the objects of a map.
+ *
+ * The check reports:
+ *
+ * - objects which are exact duplicates of another object of the same part,
+ * - area objects which overlap another area object with the same symbol,
+ * - paths which have no length or no area,
+ * - lines and areas which are smaller than their symbol's minimum size,
+ * - line ends which almost, but not exactly, meet another end of a line
+ *   with the same symbol or the other end of the same line.
+ *
+ * Candidates for pairwise checks are taken from the spatial index of the
+ * map parts, and the objects are checked concurrently. The map is not
+ * modified, so the check may run on a snapshot (cf. Map::snapshot()) in a
+ * worker thread. The objects must be up to date, cf. Map::updateObjects().
+ *
+ * Curves are checked in their flattened form. Combined symbols have no
+ * minimum size, so their objects are not checked for it.
+ */
+class MapQualityCheck
+{
+	Q_DECLARE_TR_FUNCTIONS(MapQualityCheck)
+
+public:
+	/** The kinds of issues. */
+	enum IssueType
+	{
+		DuplicateObject    = 0,
+		OverlappingAreas   = 1,
+		DegeneratePath     = 2,
+		BelowMinimumSize   = 3,
+		AlmostTouchingEnds = 4
+	};
+	
+	/** A single issue. */
+	struct Issue
+	{
+		/** The kind of issue. */
+		IssueType type;
+		
+		/** The index of the map part of the objects. */
+		int part_index;
+		
+		/** The index of the object in its part. */
+		int object_index;
+		
+		/** The index of the other object of a pair, or -1. */
+		int other_object_index;
+		
+		/** The area of the map where the issue is, in map coordinates. */
+		QRectF extent;
+	};
+	
+	/** Parameters of the check. */
+	struct Options
+	{
+		/**
+		 * The largest gap between line ends which is reported, in mm.
+		 * Ends at the same position are regarded as connected.
+		 */
+		double end_gap_tolerance;
+		
+		/** Constructs the default options. */
+		Options();
+	};
+	
+	/** Constructs an empty result. */
+	MapQualityCheck();
+	
+	/**
+	 * Checks the objects of the given map.
+	 *
+	 * When the token is cancelled, the check stops early and the result
+	 * is incomplete.
+	 */
+	static MapQualityCheck run(const Map& map, const Options& options = Options(),
+	                           const TaskPool::CancellationToken* token = nullptr);
+	
+	/**
+	 * Returns the issues, sorted by part, by type and by object index.
+	 */
+	const std::vector<Issue>& issues() const;
+	
+	/** Returns a short, translated name of the given type of issue. */
+	static QString typeName(IssueType type);
+
+private:
+	std::vector<Issue> issue_list;
+};
+
+
+
+// ### MapQualityCheck inline code ###
+
+inline
+const std::vector<MapQualityCheck::Issue>& MapQualityCheck::issues() const
+{
+	return issue_list;
+}
+
+#endif
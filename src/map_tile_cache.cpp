@@ -0,0 +1,481 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "map_tile_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <QPainter>
+#include <QRect>
+#include <QRectF>
+#include <QRegion>
+#include <qmath.h>
+
+
+namespace
+{
+	/** Returns true if the two values are equal up to rounding errors. */
+	bool almostEqual(qreal a, qreal b)
+	{
+		return qAbs(a - b) <= 1e-9 * qMax(qreal(1.0), qMax(qAbs(a), qAbs(b)));
+	}
+
+	/** Returns true if the value differs from an integer by less than 0.05. */
+	bool almostInteger(qreal value)
+	{
+		return qAbs(value - qRound(value)) < 0.05;
+	}
+
+	/** Returns the index of the tile which contains the given coordinate. */
+	int tileIndex(qreal coord)
+	{
+		return qFloor(coord / MapTileCache::tile_size);
+	}
+}
+
+
+
+// ### MapTileStore ###
+
+MapTileStore::MapTileStore()
+ : num_tiles(0)
+ , use_counter(0)
+{
+	; // nothing
+}
+
+MapTileStore::~MapTileStore()
+{
+	Q_ASSERT(caches.empty());
+}
+
+inline
+MapTileStore::TileKey MapTileStore::key(int x, int y)
+{
+	return (TileKey(std::uint32_t(x)) << 32) | TileKey(std::uint32_t(y));
+}
+
+inline
+QPoint MapTileStore::tilePos(TileKey key)
+{
+	return QPoint(int(std::int32_t(std::uint32_t(key >> 32))), int(std::int32_t(std::uint32_t(key))));
+}
+
+bool MapTileStore::matches(const Level& level, const QTransform& map_to_viewport, int render_key)
+{
+	const QTransform& t = level.transform;
+	return level.render_key == render_key &&
+	       almostEqual(t.m11(), map_to_viewport.m11()) &&
+	       almostEqual(t.m12(), map_to_viewport.m12()) &&
+	       almostEqual(t.m21(), map_to_viewport.m21()) &&
+	       almostEqual(t.m22(), map_to_viewport.m22()) &&
+	       almostInteger(map_to_viewport.dx() - t.dx()) &&
+	       almostInteger(map_to_viewport.dy() - t.dy());
+}
+
+MapTileStore::Level* MapTileStore::acquireLevel(const QTransform& map_to_viewport, int render_key)
+{
+	auto level = levels.begin();
+	while (level != levels.end() && !matches(*level, map_to_viewport, render_key))
+		++level;
+
+	if (level == levels.end())
+	{
+		Level new_level;
+		new_level.transform = map_to_viewport;
+		new_level.render_key = render_key;
+		new_level.users = 0;
+		levels.push_front(new_level);
+	}
+	else if (level != levels.begin())
+	{
+		levels.splice(levels.begin(), levels, level);
+	}
+
+	Level& selected = levels.front();
+	selected.last_use = ++use_counter;
+	++selected.users;
+	return &selected;
+}
+
+void MapTileStore::releaseLevel(Level* level)
+{
+	if (level)
+	{
+		Q_ASSERT(level->users > 0);
+		--level->users;
+	}
+}
+
+std::size_t MapTileStore::maxTiles() const
+{
+	std::size_t result = 0;
+	for (const MapTileCache* cache : caches)
+		result += cache->max_tiles;
+	return result;
+}
+
+qint64 MapTileStore::memoryUsage() const
+{
+	qint64 result = 0;
+	for (const Level& level : levels)
+	{
+		for (const auto& tile : level.tiles)
+			result += tile.second.image.byteCount();
+	}
+	return result;
+}
+
+void MapTileStore::invalidate(const QRectF& map_rect, int pixel_border)
+{
+	if (map_rect.width() < 0 || map_rect.height() < 0)
+		return;
+
+	for (auto& level : levels)
+	{
+		const QRectF rect = level.transform.mapRect(map_rect).adjusted(-pixel_border, -pixel_border, pixel_border, pixel_border);
+		const int first_x = tileIndex(rect.left());
+		const int first_y = tileIndex(rect.top());
+		const int last_x  = tileIndex(rect.right());
+		const int last_y  = tileIndex(rect.bottom());
+
+		auto& tiles = level.tiles;
+		for (auto tile = tiles.begin(); tile != tiles.end(); )
+		{
+			const QPoint pos = tilePos(tile->first);
+			if (pos.x() < first_x || pos.x() > last_x || pos.y() < first_y || pos.y() > last_y)
+			{
+				++tile;
+			}
+			else if (level.users > 0)
+			{
+				// Keep the content for display until the tile is redrawn.
+				tile->second.valid = false;
+				++tile;
+			}
+			else
+			{
+				tile = tiles.erase(tile);
+				--num_tiles;
+			}
+		}
+	}
+}
+
+void MapTileStore::invalidateAll()
+{
+	for (auto level = levels.begin(); level != levels.end(); )
+	{
+		if (level->users > 0)
+		{
+			for (auto& tile : level->tiles)
+				tile.second.valid = false;
+			++level;
+		}
+		else
+		{
+			num_tiles -= level->tiles.size();
+			level = levels.erase(level);
+		}
+	}
+}
+
+void MapTileStore::evict(std::size_t reserve)
+{
+	// Empty levels are of no use when they are not selected. Without this,
+	// a series of small rotations would push out the last rendered level.
+	for (auto level = levels.begin(); level != levels.end(); )
+	{
+		if (level->users == 0 && level->tiles.empty())
+			level = levels.erase(level);
+		else
+			++level;
+	}
+
+	// Unselected levels are discarded beyond the limit, least recently used first.
+	const std::size_t max_num_levels = MapTileCache::max_levels * std::max(std::size_t(1), caches.size());
+	for (auto level = levels.end(); levels.size() > max_num_levels && level != levels.begin(); )
+	{
+		--level;
+		if (level->users == 0)
+		{
+			num_tiles -= level->tiles.size();
+			level = levels.erase(level);
+		}
+	}
+
+	// Tiles of selected levels are in use since the oldest draw() of the caches.
+	std::uint64_t oldest_draw = use_counter;
+	for (const MapTileCache* cache : caches)
+	{
+		if (cache->current)
+			oldest_draw = std::min(oldest_draw, cache->last_draw);
+	}
+
+	const std::size_t max_tiles = maxTiles();
+	while (num_tiles + reserve > max_tiles)
+	{
+		auto least_recently_used_level = levels.end();
+		auto least_recently_used = std::map<TileKey, Tile>::iterator();
+		for (auto level = levels.begin(); level != levels.end(); ++level)
+		{
+			const std::uint64_t in_use = level->users > 0 ? oldest_draw : use_counter;
+			for (auto tile = level->tiles.begin(); tile != level->tiles.end(); ++tile)
+			{
+				if (tile->second.last_use < in_use &&
+				    (least_recently_used_level == levels.end() || tile->second.last_use < least_recently_used->second.last_use))
+				{
+					least_recently_used_level = level;
+					least_recently_used = tile;
+				}
+			}
+		}
+		if (least_recently_used_level == levels.end())
+			break; // Only tiles which are in use
+
+		least_recently_used_level->tiles.erase(least_recently_used);
+		--num_tiles;
+		if (least_recently_used_level->tiles.empty() && least_recently_used_level->users == 0)
+			levels.erase(least_recently_used_level);
+	}
+}
+
+
+
+// ### MapTileCache ###
+
+MapTileCache::MapTileCache()
+ : store(std::make_shared<MapTileStore>())
+ , current(nullptr)
+ , max_tiles(256)
+ , last_draw(0)
+{
+	store->caches.push_back(this);
+}
+
+MapTileCache::~MapTileCache()
+{
+	detach();
+}
+
+void MapTileCache::detach()
+{
+	store->releaseLevel(current);
+	current = nullptr;
+	auto& caches = store->caches;
+	caches.erase(std::remove(begin(caches), end(caches), this), end(caches));
+}
+
+void MapTileCache::setStore(const std::shared_ptr<MapTileStore>& store)
+{
+	Q_ASSERT(store);
+	if (this->store == store)
+		return;
+
+	detach();
+	this->store->evict();
+	this->store = store;
+	store->caches.push_back(this);
+	store->evict();
+}
+
+void MapTileCache::setMaxTiles(std::size_t max_tiles)
+{
+	this->max_tiles = max_tiles;
+	store->evict();
+}
+
+std::size_t MapTileCache::numFreeTiles() const
+{
+	const std::size_t max_tiles = store->maxTiles();
+	return store->num_tiles < max_tiles ? max_tiles - store->num_tiles : 0;
+}
+
+void MapTileCache::setTransform(const QTransform& map_to_viewport, int render_key)
+{
+	current_transform = map_to_viewport;
+
+	// Acquire before release, so that the level is kept when it is unchanged.
+	MapTileStore::Level* level = store->acquireLevel(map_to_viewport, render_key);
+	store->releaseLevel(current);
+	current = level;
+	offset = QPoint(qRound(map_to_viewport.dx() - current->transform.dx()),
+	                qRound(map_to_viewport.dy() - current->transform.dy()));
+
+	store->evict();
+}
+
+void MapTileCache::invalidate(const QRectF& map_rect, int pixel_border)
+{
+	store->invalidate(map_rect, pixel_border);
+}
+
+void MapTileCache::invalidateAll()
+{
+	store->invalidateAll();
+}
+
+void MapTileCache::clear()
+{
+	store->releaseLevel(current);
+	current = nullptr;
+	store->evict();
+}
+
+qint64 MapTileCache::memoryUsage() const
+{
+	return store->memoryUsage();
+}
+
+QRect MapTileCache::nextInvalidTile(const QRect& rect) const
+{
+	if (!current || rect.isEmpty())
+		return QRect();
+
+	const QRect level_rect = rect.translated(-offset);
+	const int first_x = tileIndex(level_rect.left());
+	const int first_y = tileIndex(level_rect.top());
+	const int last_x  = tileIndex(level_rect.right());
+	const int last_y  = tileIndex(level_rect.bottom());
+	for (int y = first_y; y <= last_y; ++y)
+	{
+		for (int x = first_x; x <= last_x; ++x)
+		{
+			auto tile = current->tiles.find(MapTileStore::key(x, y));
+			if (tile == current->tiles.end() || !tile->second.valid)
+				return QRect(x * tile_size + offset.x(), y * tile_size + offset.y(), tile_size, tile_size);
+		}
+	}
+	return QRect();
+}
+
+QImage& MapTileCache::tileImage(const QRect& tile_rect)
+{
+	Q_ASSERT(current);
+
+	const QPoint pos = tile_rect.topLeft() - offset;
+	Q_ASSERT(pos.x() % tile_size == 0);
+	Q_ASSERT(pos.y() % tile_size == 0);
+	const MapTileStore::TileKey tile_key = MapTileStore::key(tileIndex(pos.x()), tileIndex(pos.y()));
+
+	auto& tiles = current->tiles;
+	auto tile = tiles.find(tile_key);
+	if (tile == tiles.end())
+	{
+		store->evict(1);
+		tile = tiles.insert(std::make_pair(tile_key, MapTileStore::Tile())).first;
+		++store->num_tiles;
+	}
+
+	MapTileStore::Tile& new_tile = tile->second;
+	if (new_tile.image.isNull())
+		new_tile.image = QImage(tile_size, tile_size, QImage::Format_ARGB32_Premultiplied);
+	new_tile.valid = true;
+	new_tile.last_use = store->use_counter;
+	return new_tile.image;
+}
+
+void MapTileCache::draw(QPainter* painter, const QRect& rect)
+{
+	last_draw = ++store->use_counter;
+	if (!current || rect.isEmpty())
+		return;
+
+	const QRect level_rect = rect.translated(-offset);
+	const int first_x = tileIndex(level_rect.left());
+	const int first_y = tileIndex(level_rect.top());
+	const int last_x  = tileIndex(level_rect.right());
+	const int last_y  = tileIndex(level_rect.bottom());
+
+	QRegion missing;
+	for (int y = first_y; y <= last_y; ++y)
+	{
+		for (int x = first_x; x <= last_x; ++x)
+		{
+			const QPoint target(x * tile_size + offset.x(), y * tile_size + offset.y());
+			auto tile = current->tiles.find(MapTileStore::key(x, y));
+			if (tile == current->tiles.end() || tile->second.image.isNull())
+			{
+				missing += QRect(target, QSize(tile_size, tile_size)).intersected(rect);
+				continue;
+			}
+			tile->second.last_use = last_draw;
+			painter->drawImage(target, tile->second.image);
+		}
+	}
+
+	if (missing.isEmpty())
+		return;
+
+	// Preview the missing tiles from the other level with the same render key
+	// which is closest in scale, preferring the most recently used one.
+	const qreal current_scale = qAbs(current->transform.determinant());
+	if (current_scale <= 0)
+		return;
+	const MapTileStore::Level* preview_level = nullptr;
+	qreal preview_distance = std::numeric_limits<qreal>::max();
+	for (const auto& level : store->levels)
+	{
+		if (&level == current || level.render_key != current->render_key || level.tiles.empty())
+			continue;
+		const qreal scale = qAbs(level.transform.determinant());
+		if (scale <= 0)
+			continue;
+		const qreal distance = qAbs(std::log(scale / current_scale));
+		if (distance < preview_distance)
+		{
+			preview_level = &level;
+			preview_distance = distance;
+		}
+	}
+	if (!preview_level)
+		return;
+	const MapTileStore::Level& preview = *preview_level;
+	bool invertible = false;
+	const QTransform map_to_level = preview.transform.inverted(&invertible);
+	if (!invertible)
+		return;
+	const QTransform level_to_viewport = map_to_level * current_transform;
+	const QTransform viewport_to_level = level_to_viewport.inverted(&invertible);
+	if (!invertible)
+		return;
+
+	const QRectF preview_rect = viewport_to_level.mapRect(QRectF(missing.boundingRect()));
+	const int preview_first_x = tileIndex(preview_rect.left());
+	const int preview_first_y = tileIndex(preview_rect.top());
+	const int preview_last_x  = tileIndex(preview_rect.right());
+	const int preview_last_y  = tileIndex(preview_rect.bottom());
+
+	painter->save();
+	painter->setClipRegion(missing, painter->hasClipping() ? Qt::IntersectClip : Qt::ReplaceClip);
+	painter->setTransform(level_to_viewport, true);
+	painter->setRenderHint(QPainter::SmoothPixmapTransform);
+	for (auto& tile : preview.tiles)
+	{
+		const QPoint pos = MapTileStore::tilePos(tile.first);
+		if (pos.x() < preview_first_x || pos.x() > preview_last_x ||
+		    pos.y() < preview_first_y || pos.y() > preview_last_y)
+			continue;
+		painter->drawImage(pos * tile_size, tile.second.image);
+	}
+	painter->restore();
+}
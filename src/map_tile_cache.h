@@ -0,0 +1,283 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_MAP_TILE_CACHE_H_
+#define _OPENORIENTEERING_MAP_TILE_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QImage>
+#include <QPoint>
+#include <QTransform>
+
+QT_BEGIN_NAMESPACE
+class QPainter;
+class QRect;
+class QRectF;
+QT_END_NAMESPACE
+
+class MapTileCache;
+
+
+/**
+ * The rendered map tiles of one or more MapTileCache objects.
+ *
+ * A map keeps a single store for all of its widgets. The levels are
+ * identified by the map-to-viewport transformation, up to translations by
+ * full pixels, and by a render key which stands for the options that change
+ * the content of the tiles, such as the overprinting simulation. Thus
+ * widgets which show the map at the same zoom and rotation draw the same
+ * tiles, and each tile is rendered only once.
+ *
+ * The levels which are selected by a cache are kept. The number of other
+ * levels and the number of tiles are limited by the sum of the budgets of
+ * the caches.
+ */
+class MapTileStore
+{
+public:
+	/** Constructs an empty store. */
+	MapTileStore();
+
+	/** Destructor. */
+	~MapTileStore();
+
+	/**
+	 * Returns the memory used by the tile images, in bytes.
+	 */
+	qint64 memoryUsage() const;
+
+private:
+	Q_DISABLE_COPY(MapTileStore)
+
+	friend class MapTileCache;
+
+	typedef std::uint64_t TileKey;
+
+	struct Tile
+	{
+		QImage image;
+		std::uint64_t last_use;
+		bool valid;
+	};
+
+	struct Level
+	{
+		/** The transformation from map coordinates to level coordinates. */
+		QTransform transform;
+		std::map<TileKey, Tile> tiles;
+		std::uint64_t last_use;
+		int render_key;
+		/** The number of caches which selected this level. */
+		int users;
+	};
+
+	static TileKey key(int x, int y);
+
+	static QPoint tilePos(TileKey key);
+
+	/** Returns true if the level can be used with the given transformation and render key. */
+	static bool matches(const Level& level, const QTransform& map_to_viewport, int render_key);
+
+	/**
+	 * Returns the level for the given transformation and render key,
+	 * creating a new level when needed, and counts a new user of it.
+	 */
+	Level* acquireLevel(const QTransform& map_to_viewport, int render_key);
+
+	/** Counts one user less of the given level, which may be nullptr. */
+	void releaseLevel(Level* level);
+
+	/** Returns the sum of the budgets of the caches. */
+	std::size_t maxTiles() const;
+
+	/** See MapTileCache::invalidate(). */
+	void invalidate(const QRectF& map_rect, int pixel_border);
+
+	/** See MapTileCache::invalidateAll(). */
+	void invalidateAll();
+
+	/**
+	 * Discards least recently used tiles and levels, until there is room
+	 * for the given number of additional tiles.
+	 */
+	void evict(std::size_t reserve = 0);
+
+
+	/** The levels, beginning with the most recently selected one. */
+	std::list<Level> levels;
+
+	/** The caches which use this store. */
+	std::vector<const MapTileCache*> caches;
+
+	std::size_t num_tiles;
+
+	std::uint64_t use_counter;
+};
+
+
+
+/**
+ * A cache of rendered map tiles for a MapWidget.
+ *
+ * The tiles are organized in levels. Each level stands for a particular
+ * map-to-viewport transformation, up to translations by full pixels. Thus
+ * panning the view keeps using the same level, and changing the zoom or the
+ * rotation selects another level. The most recently used levels are kept, so
+ * returning to a previous zoom and position needs no redrawing.
+ *
+ * The levels and tiles are kept in a MapTileStore which may be shared by
+ * the caches of several widgets showing the same map. A tile which is drawn
+ * for one widget is valid for all widgets using the same level.
+ *
+ * Tiles which are invalidated in a selected level keep their content for
+ * display until they are redrawn. Tiles of other levels are discarded.
+ * Where the current level has no tile yet, draw() shows the content of
+ * the other level which is closest in scale, transformed to the current view.
+ * Thus tiles which are rendered in advance for a neighbouring zoom level
+ * are shown immediately when zooming.
+ *
+ * All rects are given in viewport coordinates (pixels) of the current
+ * transformation, unless the name says otherwise.
+ */
+class MapTileCache
+{
+public:
+	/** The width and height of the tiles, in pixels. */
+	static const int tile_size = 256;
+
+	/** The maximum number of levels per cache. */
+	static const std::size_t max_levels = 4;
+
+	/** Constructs an empty cache with a store of its own. */
+	MapTileCache();
+
+	/** Destructor. */
+	~MapTileCache();
+
+	/**
+	 * Makes this cache use the tiles of the given store.
+	 *
+	 * The store may be shared with other caches. No level is selected
+	 * afterwards.
+	 */
+	void setStore(const std::shared_ptr<MapTileStore>& store);
+
+	/**
+	 * Sets the maximum number of tiles which this cache adds to the budget
+	 * of its store.
+	 *
+	 * The tiles which were used in the last call to draw() are not discarded.
+	 */
+	void setMaxTiles(std::size_t max_tiles);
+
+	/**
+	 * Returns the number of tiles which can be added without discarding
+	 * other tiles.
+	 */
+	std::size_t numFreeTiles() const;
+
+	/**
+	 * Selects the level for the given transformation from map coordinates
+	 * to viewport coordinates and the given render key, creating a new level
+	 * when needed.
+	 *
+	 * Tiles which are rendered with different options must use different
+	 * render keys.
+	 */
+	void setTransform(const QTransform& map_to_viewport, int render_key = 0);
+
+	/**
+	 * Invalidates the tiles which intersect the given map rect, with an
+	 * additional border given in pixels.
+	 */
+	void invalidate(const QRectF& map_rect, int pixel_border);
+
+	/**
+	 * Invalidates all tiles.
+	 */
+	void invalidateAll();
+
+	/**
+	 * Deselects the current level.
+	 *
+	 * The tiles remain in the store for other caches.
+	 */
+	void clear();
+
+	/**
+	 * Returns the rect of the next tile which intersects the given rect and
+	 * which needs to be drawn.
+	 *
+	 * Returns an invalid rect if all these tiles are valid.
+	 */
+	QRect nextInvalidTile(const QRect& rect) const;
+
+	/**
+	 * Returns the image of the tile with the given rect and marks the tile
+	 * as valid.
+	 *
+	 * The caller must redraw the image completely. The rect must be a tile
+	 * rect as returned by nextInvalidTile().
+	 */
+	QImage& tileImage(const QRect& tile_rect);
+
+	/**
+	 * Draws the tiles which intersect the given rect.
+	 */
+	void draw(QPainter* painter, const QRect& rect);
+
+	/**
+	 * Returns the memory used by the tile images of the store, in bytes.
+	 */
+	qint64 memoryUsage() const;
+
+private:
+	Q_DISABLE_COPY(MapTileCache)
+
+	friend class MapTileStore;
+
+	/** Unregisters this cache from its store. */
+	void detach();
+
+
+	std::shared_ptr<MapTileStore> store;
+
+	/** The selected level in the store, or nullptr. */
+	MapTileStore::Level* current;
+
+	/** The offset from the current level's coordinates to viewport coordinates. */
+	QPoint offset;
+
+	/** The current transformation from map coordinates to viewport coordinates. */
+	QTransform current_transform;
+
+	std::size_t max_tiles;
+
+	/** The use counter of the store in the last call to draw(). */
+	std::uint64_t last_draw;
+};
+
+#endif
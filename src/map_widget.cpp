@@ -24,18 +24,23 @@
 #include <cmath>
 
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QLabel>
 #include <QPainter>
 #include <QPinchGesture>
+#include <qmath.h>
 #include <QTimer>
 #include <QTouchEvent>
 
 #include "core/georeferencing.h"
 #include "core/map_color.h"
+#include "core/tracing.h"
 #include "gui/widgets/action_grid_bar.h"
 #include "gui/widgets/key_button_bar.h"
+#include "input_recording.h"
 #include "map.h"
 #include "map_editor_activity.h"
+#include "render_profiler.h"
 #include "settings.h"
 #include "template.h"
 #include "tool.h"
@@ -48,6 +53,56 @@
 #include "gui/widgets/pie_menu.h"
 
 
+namespace
+{
+	/** The time (in milliseconds) which may be spent on redrawing the caches per paint event. */
+	const int cache_update_time_limit = 40;
+	
+	/**
+	 * The time (in milliseconds) which may be spent on updating changed objects
+	 * before drawing a map tile. Objects in the tile are updated first. Other
+	 * objects are drawn as before, until their update in the background is
+	 * finished.
+	 */
+	const int object_update_time_limit = 20;
+	
+	/** The initial height (in pixels) of the slices in which the caches are redrawn. */
+	const int cache_slice_height = 128;
+	
+	/** The time (in milliseconds) after the last zoom or rotation until templates are drawn smoothly. */
+	const int template_refinement_delay = 300;
+	
+	/** The time (in milliseconds) after the last wheel zoom step until the caches are redrawn. */
+	const int zoom_settle_delay = 150;
+	
+	/**
+	 * The time (in milliseconds) after the last small rotation until the caches are redrawn.
+	 * 
+	 * It is longer than the interval of the compass-driven rotation updates.
+	 */
+	const int rotation_settle_delay = 1500;
+	
+	/** The largest rotation (in radians) which is shown by rotating the existing map tiles. */
+	const double max_preview_rotation = 10.0 * M_PI / 180.0;
+	
+	/** The time (in milliseconds) between the steps of redrawing caches while idle. */
+	const int idle_update_delay = 50;
+	
+	/** The time (in milliseconds) after the last interaction until neighbouring zoom levels are rendered. */
+	const int zoom_prefetch_idle_time = 500;
+	
+	/** The scale factor between neighbouring zoom levels, as used by MapView::zoomSteps(). */
+	const qreal zoom_step_factor = std::sqrt(2.0);
+	
+	/** Returns the pixels of the image which cover the given rect in device independent pixels. */
+	QRectF imagePixels(const QImage& image, const QRect& rect)
+	{
+		const qreal ratio = image.devicePixelRatio();
+		return QRectF(QPointF(rect.topLeft()) * ratio, QSizeF(rect.size()) * ratio);
+	}
+}
+
+
 MapWidget::MapWidget(bool show_help, bool force_antialiasing, QWidget* parent)
  : QWidget(parent)
  , view(nullptr)
@@ -62,15 +117,28 @@ MapWidget::MapWidget(bool show_help, bool force_antialiasing, QWidget* parent)
  , dragging(false)
  , pinching(false)
  , pinching_factor(1.0)
+ , cache_margin(0)
+ , power_saving(false)
+ , reduced_color_depth(false)
+ , pixel_ratio_policy(Settings::PixelRatio_Logical)
+ , idle_update_timer(new QTimer(this))
  , below_template_cache_dirty_rect(rect())
  , above_template_cache_dirty_rect(rect())
- , map_cache_dirty_rect(rect())
+ , draft_templates(false)
+ , template_refinement_timer(new QTimer(this))
+ , zoom_settle_timer(new QTimer(this))
+ , rotation_settle_timer(new QTimer(this))
+ , tile_rotation(0.0)
+ , cache_update_scheduled(false)
+ , grid_cache_dirty(true)
+ , selection_cache_options(0)
  , drawing_dirty_rect_border(0)
  , activity_dirty_rect_border(0)
  , last_mouse_release_time(QTime::currentTime())
  , current_pressed_buttons(0)
  , gps_display(nullptr)
  , marker_display(nullptr)
+ , input_recording(nullptr)
 {
 	context_menu = new PieMenu(this);
 // 	context_menu->setMinimumActionCount(8);
@@ -83,6 +151,25 @@ MapWidget::MapWidget(bool show_help, bool force_antialiasing, QWidget* parent)
 	setMouseTracking(true);
 	setFocusPolicy(Qt::ClickFocus);
 	setSizePolicy(QSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding));
+	
+	template_refinement_timer->setSingleShot(true);
+	template_refinement_timer->setInterval(template_refinement_delay);
+	connect(template_refinement_timer, &QTimer::timeout, this, &MapWidget::refineTemplateCaches);
+	
+	zoom_settle_timer->setSingleShot(true);
+	zoom_settle_timer->setInterval(zoom_settle_delay);
+	connect(zoom_settle_timer, &QTimer::timeout, this, &MapWidget::continueCacheUpdates);
+	
+	rotation_settle_timer->setSingleShot(true);
+	rotation_settle_timer->setInterval(rotation_settle_delay);
+	connect(rotation_settle_timer, &QTimer::timeout, this, &MapWidget::continueCacheUpdates);
+	
+	idle_update_timer->setSingleShot(true);
+	idle_update_timer->setInterval(idle_update_delay);
+	connect(idle_update_timer, &QTimer::timeout, this, &MapWidget::updateCachesWhileIdle);
+	
+	updateDisplaySettings();
+	connect(&Settings::getInstance(), &Settings::settingsChanged, this, &MapWidget::updateDisplaySettings);
 }
 
 MapWidget::~MapWidget()
@@ -101,7 +188,12 @@ void MapWidget::setMapView(MapView* view)
 		this->view = view;
 		
 		if (view)
+		{
 			view->addMapWidget(this);
+			cache_transform = viewportTransform();
+			map_tiles.setStore(view->getMap()->getMapTileStore());
+		}
+		map_tiles.clear();
 		
 		connect(view->getMap(), &Map::objectSelectionChanged, this, static_cast<void (MapWidget::*)()>(&MapWidget::updateObjectTagLabel));
 		
@@ -230,9 +322,18 @@ void MapWidget::viewChanged(MapView::ChangeFlags changes)
 {
 	setDrawingBoundingBox(drawing_dirty_rect_map, drawing_dirty_rect_border, true);
 	setActivityBoundingBox(activity_dirty_rect_map, activity_dirty_rect_border, true);
-	updateEverything();
+	warpCaches();
 	if (changes.testFlag(MapView::ZoomChange))
 		updateZoomLabel();
+	if (changes.testFlag(MapView::RotationChange))
+	{
+		// Small rotations are shown by rotating the map tiles of the last
+		// rendered rotation, until the rotation settles.
+		if (qAbs(std::remainder(view->getRotation() - tile_rotation, 2 * M_PI)) < max_preview_rotation)
+			rotation_settle_timer->start();
+		else
+			rotation_settle_timer->stop();
+	}
 }
 
 void MapWidget::setPanOffset(QPoint offset)
@@ -382,7 +483,28 @@ void MapWidget::adjustViewToRect(const QRectF& map_rect, ZoomOption zoom_option)
 void MapWidget::moveDirtyRect(QRect& dirty_rect, qreal x, qreal y)
 {
 	if (dirty_rect.isValid())
-		dirty_rect = dirty_rect.translated(x, y).intersected(rect());
+		dirty_rect = dirty_rect.translated(x, y).intersected(cacheRect());
+}
+
+void MapWidget::moveDirtyArea(QRect& dirty_rect, QRegion& margin_dirty, int dx, int dy)
+{
+	QRect moved = dirty_rect.isValid() ? dirty_rect.translated(dx, dy) : QRect();
+	QRegion moved_margin = margin_dirty.translated(dx, dy);
+	dirty_rect = QRect();
+	margin_dirty = QRegion();
+	markDirty(dirty_rect, margin_dirty, moved);
+	for (const QRect& part : moved_margin.rects())
+		markDirty(dirty_rect, margin_dirty, part);
+}
+
+void MapWidget::markDirty(QRect& dirty_rect, QRegion& margin_dirty, const QRect& area)
+{
+	if (!area.isValid())
+		return;
+	
+	rectIncludeSafe(dirty_rect, area.intersected(rect()));
+	if (cache_margin > 0)
+		margin_dirty += QRegion(area.intersected(cacheRect())) - QRegion(rect());
 }
 
 void MapWidget::markTemplateCacheDirty(QRectF view_rect, int pixel_border, bool front_cache)
@@ -392,20 +514,50 @@ void MapWidget::markTemplateCacheDirty(QRectF view_rect, int pixel_border, bool
 	QRect integer_rect = QRect(viewport_rect.left() - (1+pixel_border), viewport_rect.top() - (1+pixel_border),
 							   viewport_rect.width() + 2*(1+pixel_border), viewport_rect.height() + 2*(1+pixel_border));
 	
-	if (!integer_rect.intersects(rect()))
+	if (!integer_rect.intersects(cacheRect()))
 		return;
 	
-	if (cache_dirty_rect.isValid())
-		cache_dirty_rect = cache_dirty_rect.united(integer_rect);
-	else
-		cache_dirty_rect = integer_rect;
+	markDirty(cache_dirty_rect, front_cache ? above_template_cache_margin_dirty : below_template_cache_margin_dirty, integer_rect);
 	
-	update(integer_rect);
+	if (integer_rect.intersects(rect()))
+		update(integer_rect);
 }
 
 void MapWidget::markObjectAreaDirty(QRectF map_rect)
 {
-	updateMapRect(map_rect, 0, map_cache_dirty_rect);
+	// Changes are not to be hidden by the tiles of the last rendered rotation.
+	rotation_settle_timer->stop();
+	map_tiles.invalidate(map_rect, 1);
+	// The changed objects may be selected.
+	markSelectionAreaDirty(map_rect);
+	updateDrawing(map_rect, 0);
+}
+
+void MapWidget::markSelectionAreaDirty(const QRectF& map_rect)
+{
+	// The border covers the minimum size of lines, and antialiasing.
+	if (view && map_rect.isValid() && !selection_cache.isNull())
+		rectIncludeSafe(selection_cache_dirty_rect, calculateViewportBoundingBox(map_rect, 2));
+}
+
+QImage& MapWidget::getSelectionCache(int options, QRect& dirty_rect)
+{
+	const QTransform transform = viewportTransform();
+	if (selection_cache.size() != size())
+	{
+		selection_cache = QImage(size(), QImage::Format_ARGB32_Premultiplied);
+		selection_cache_dirty_rect = rect();
+	}
+	else if (options != selection_cache_options || transform != selection_cache_transform)
+	{
+		selection_cache_dirty_rect = rect();
+	}
+	selection_cache_options = options;
+	selection_cache_transform = transform;
+	
+	dirty_rect = selection_cache_dirty_rect.intersected(rect());
+	selection_cache_dirty_rect = QRect();
+	return selection_cache;
 }
 
 void MapWidget::setDrawingBoundingBox(QRectF map_rect, int pixel_border, bool do_update)
@@ -504,17 +656,30 @@ void MapWidget::updateDrawingLaterSlot()
 
 void MapWidget::updateEverything()
 {
-	map_cache_dirty_rect = rect();
-	below_template_cache_dirty_rect = map_cache_dirty_rect;
-	above_template_cache_dirty_rect = map_cache_dirty_rect;
-	update(map_cache_dirty_rect);
+	if (view)
+		cache_transform = viewportTransform();
+	rotation_settle_timer->stop();
+	map_tiles.invalidateAll();
+	markDirty(below_template_cache_dirty_rect, below_template_cache_margin_dirty, cacheRect());
+	markDirty(above_template_cache_dirty_rect, above_template_cache_margin_dirty, cacheRect());
+	grid_cache_dirty = true;
+	selection_cache_dirty_rect = rect();
+	update();
+}
+
+void MapWidget::updateGrid()
+{
+	grid_cache_dirty = true;
+	update();
 }
 
 void MapWidget::updateEverythingInRect(const QRect& dirty_rect)
 {
-	rectIncludeSafe(map_cache_dirty_rect, dirty_rect);
-	rectIncludeSafe(below_template_cache_dirty_rect, dirty_rect);
-	rectIncludeSafe(above_template_cache_dirty_rect, dirty_rect);
+	if (view && dirty_rect.isValid())
+		map_tiles.invalidate(view->calculateViewedRect(viewportToView(dirty_rect)), 1);
+	markDirty(below_template_cache_dirty_rect, below_template_cache_margin_dirty, dirty_rect);
+	markDirty(above_template_cache_dirty_rect, above_template_cache_margin_dirty, dirty_rect);
+	rectIncludeSafe(selection_cache_dirty_rect, dirty_rect);
 	update(dirty_rect);
 }
 
@@ -652,6 +817,30 @@ void MapWidget::setTemporaryMarkerDisplay(GPSTemporaryMarkers* marker_display)
 	this->marker_display = marker_display;
 }
 
+void MapWidget::setProfilerEnabled(bool enabled)
+{
+	if (enabled == bool(profiler))
+		return;
+	
+	profiler.reset(enabled ? new RenderProfiler() : nullptr);
+	update();
+}
+
+const RenderProfiler* MapWidget::getProfiler() const
+{
+	return profiler.data();
+}
+
+void MapWidget::setInputRecording(InputRecording* recording)
+{
+	input_recording = recording;
+}
+
+qint64 MapWidget::cacheMemoryUsage() const
+{
+	return below_template_cache.byteCount() + above_template_cache.byteCount() + grid_cache.byteCount() + selection_cache.byteCount() + map_tiles.memoryUsage();
+}
+
 QWidget* MapWidget::getContextMenu()
 {
 	return context_menu;
@@ -761,15 +950,44 @@ void MapWidget::paintEvent(QPaintEvent* event)
 		return;
 	}
 	
+	// Repaints of the profiler overlay alone are not measured.
+	const bool profile_frame = profiler && !profiler->overlayRect(rect()).contains(exposed);
+	if (profile_frame)
+		profiler->beginFrame(exposed);
+	
 	// No colors, symbols, or objects? Provide a litte help message ...
 	bool no_contents = view->getMap()->getNumObjects() == 0 && view->getMap()->getNumTemplates() == 0 && !view->isGridVisible();
 	
 	QTransform transform = painter.worldTransform();
 	
-	// Update all dirty caches
-	// TODO: It would be an idea to do these updates in a background thread and use the old caches in the meantime
-	updateAllDirtyCaches();
+	// Update the dirty caches. When this takes too long, the remaining parts
+	// are redrawn in subsequent paint events, so that input is not blocked.
+	// Until then, the old (warped) content of the caches is displayed.
+	// During wheel zooming, pinching and small rotations, nothing is redrawn.
+	// The transformed old content is shown immediately, and the caches are
+	// redrawn when the view has settled.
+	if (pinching || zoom_settle_timer->isActive() || rotation_settle_timer->isActive())
+	{
+		map_tiles.setTransform(mapTileTransform(), mapTileRenderKey());
+	}
+	else if (!updateDirtyCaches(cache_update_time_limit) || (cache_update_rect.isValid() && !exposed.contains(cache_update_rect)))
+	{
+		if (!cache_update_scheduled)
+		{
+			cache_update_scheduled = true;
+			QTimer::singleShot(0, this, SLOT(continueCacheUpdates()));
+		}
+	}
+	else
+	{
+		cache_update_rect = QRect();
+		if (!idle_update_timer->isActive())
+			idle_update_timer->start();
+	}
 	
+	// The part of the caches which is to be drawn, in viewport coordinates
+	// of the caches, and its position in the widget.
+	QRect source = exposed;
 	QRect target = exposed;
 	if (pinching)
 	{
@@ -781,23 +999,18 @@ void MapWidget::paintEvent(QPaintEvent* event)
 	}
 	else if (pan_offset != QPoint())
 	{
-		// Background color
-		if (pan_offset.x() > 0)
-			painter.fillRect(QRect(0, pan_offset.y(), pan_offset.x(), height() - pan_offset.y()), QColor(Qt::gray));
-		else if (pan_offset.x() < 0)
-			painter.fillRect(QRect(width() + pan_offset.x(), pan_offset.y(), -pan_offset.x(), height() - pan_offset.y()), QColor(Qt::gray));
-		
-		if (pan_offset.y() > 0)
-			painter.fillRect(QRect(0, 0, width(), pan_offset.y()), QColor(Qt::gray));
-		else if (pan_offset.y() < 0)
-			painter.fillRect(QRect(0, height() + pan_offset.y(), width(), -pan_offset.y()), QColor(Qt::gray));
-		
-		target.translate(pan_offset);
+		// The margins of the caches fill the uncovered area as far as possible.
+		source = exposed.translated(-pan_offset).intersected(cacheRect());
+		target = source.translated(pan_offset);
+		if (target != exposed)
+			painter.fillRect(exposed, QColor(Qt::gray));
 	}
+	const QRect cache_source = source.translated(cache_margin, cache_margin);
 	
 	if (!view->areAllTemplatesHidden() && isBelowTemplateVisible() && !below_template_cache.isNull() && view->getMap()->getFirstFrontTemplate() > 0)
 	{
-		painter.drawImage(target, below_template_cache, exposed);
+		RenderProfiler::PhaseTimer phase_timer(profiler.data(), RenderProfiler::Blit);
+		painter.drawImage(target, below_template_cache, imagePixels(below_template_cache, cache_source));
 	}
 	else if (show_help && no_contents)
 	{
@@ -817,57 +1030,96 @@ void MapWidget::paintEvent(QPaintEvent* event)
 	}
 	
 	const auto map_visibility = view->effectiveMapVisibility();
-	if (!map_cache.isNull() && map_visibility->visible)
+	if (map_visibility->visible)
 	{
-		qreal saved_opacity = painter.opacity();
+		RenderProfiler::PhaseTimer phase_timer(profiler.data(), RenderProfiler::Blit);
+		painter.save();
 		painter.setOpacity(map_visibility->opacity);
-		painter.drawImage(target, map_cache, exposed);
-		painter.setOpacity(saved_opacity);
+		painter.translate(target.topLeft() - source.topLeft());
+		const qreal ratio = mapTilePixelRatio();
+		painter.scale(1 / ratio, 1 / ratio);
+		map_tiles.draw(&painter, toMapTilePixels(source));
+		painter.restore();
+	}
+	
+	if (view->isGridVisible())
+	{
+		updateGridCache();
+		RenderProfiler::PhaseTimer phase_timer(profiler.data(), RenderProfiler::Blit);
+		const QRect grid_source = source.intersected(rect());
+		painter.drawImage(grid_source.translated(target.topLeft() - source.topLeft()), grid_cache, grid_source);
 	}
 	
 	if (!view->areAllTemplatesHidden() && isAboveTemplateVisible() && !above_template_cache.isNull() && view->getMap()->getNumTemplates() - view->getMap()->getFirstFrontTemplate() > 0)
-		painter.drawImage(target, above_template_cache, exposed);
+	{
+		RenderProfiler::PhaseTimer phase_timer(profiler.data(), RenderProfiler::Blit);
+		painter.drawImage(target, above_template_cache, imagePixels(above_template_cache, cache_source));
+	}
 	
 	//painter.setClipRect(exposed);
 	
-	// Show current drawings
-	if (activity_dirty_rect.isValid())
-		activity->draw(&painter, this);
-	
-	if (drawing_dirty_rect.isValid())
-		tool->draw(&painter, this);
-	
-	
-	// Draw temporary GPS marker display
-	if (marker_display)
-		marker_display->paint(&painter);
-	
-	// Draw GPS display
-	if (gps_display)
-		gps_display->paint(&painter);
-	
-	// Draw touch cursor
-	if (touch_cursor && tool && tool->usesTouchCursor())
-		touch_cursor->paint(&painter);
+	{
+		RenderProfiler::PhaseTimer phase_timer(profiler.data(), RenderProfiler::ToolOverlay);
+		
+		// Show current drawings
+		if (activity_dirty_rect.isValid())
+			activity->draw(&painter, this);
+		
+		if (drawing_dirty_rect.isValid())
+			tool->draw(&painter, this);
+		
+		
+		// Draw temporary GPS marker display
+		if (marker_display)
+			marker_display->paint(&painter);
+		
+		// Draw GPS display
+		if (gps_display)
+			gps_display->paint(&painter);
+		
+		// Draw touch cursor
+		if (touch_cursor && tool && tool->usesTouchCursor())
+			touch_cursor->paint(&painter);
+	}
 	
 	
 	painter.setWorldTransform(transform, false);
+	
+	if (profiler)
+	{
+		profiler->endFrame();
+		profiler->draw(&painter, rect());
+		
+		// Keep the overlay up to date when only other parts were painted.
+		const QRect overlay_rect = profiler->overlayRect(rect());
+		if (profile_frame && !exposed.contains(overlay_rect))
+			update(overlay_rect);
+	}
 }
 
 void MapWidget::resizeEvent(QResizeEvent* event)
 {
-	map_cache_dirty_rect = rect();
-	below_template_cache_dirty_rect = map_cache_dirty_rect;
-	above_template_cache_dirty_rect = map_cache_dirty_rect;
-	
-	if (map_cache.width() < map_cache_dirty_rect.width() ||
-	    map_cache.height() < map_cache_dirty_rect.height())
+	if (view)
+		cache_transform = viewportTransform();
+	below_template_cache_dirty_rect = QRect();
+	above_template_cache_dirty_rect = QRect();
+	below_template_cache_margin_dirty = QRegion();
+	above_template_cache_margin_dirty = QRegion();
+	markDirty(below_template_cache_dirty_rect, below_template_cache_margin_dirty, cacheRect());
+	markDirty(above_template_cache_dirty_rect, above_template_cache_margin_dirty, cacheRect());
+	below_template_cache_draft_rect = QRect();
+	above_template_cache_draft_rect = QRect();
+	
+	const QSize cache_size = cacheRect().size();
+	if (below_template_cache.width() < cache_size.width() || below_template_cache.height() < cache_size.height() ||
+	    above_template_cache.width() < cache_size.width() || above_template_cache.height() < cache_size.height())
 	{
-		map_cache = QImage();
 		below_template_cache = QImage();
 		above_template_cache = QImage();
 	}
 	
+	updateMapTileBudget();
+	
 	for (QObject* const child : children())
 	{
 		if (QWidget* child_widget = qobject_cast<ActionGridBar*>(child))
@@ -891,6 +1143,9 @@ void MapWidget::resizeEvent(QResizeEvent* event)
 
 void MapWidget::mousePressEvent(QMouseEvent* event)
 {
+	if (input_recording)
+		input_recording->record(event);
+	
 	current_pressed_buttons = event->buttons();
 	if (touch_cursor && tool && tool->usesTouchCursor())
 	{
@@ -932,6 +1187,9 @@ void MapWidget::_mousePressEvent(QMouseEvent* event)
 
 void MapWidget::mouseMoveEvent(QMouseEvent* event)
 {
+	if (input_recording)
+		input_recording->record(event);
+	
 	if (touch_cursor && tool && tool->usesTouchCursor())
 	{
 		if (!touch_cursor->mouseMoveEvent(event))
@@ -967,6 +1225,9 @@ void MapWidget::_mouseMoveEvent(QMouseEvent* event)
 
 void MapWidget::mouseReleaseEvent(QMouseEvent* event)
 {
+	if (input_recording)
+		input_recording->record(event);
+	
 	current_pressed_buttons = event->buttons();
 	last_mouse_release_time = QTime::currentTime();
 	if (touch_cursor && tool && tool->usesTouchCursor())
@@ -995,6 +1256,9 @@ void MapWidget::_mouseReleaseEvent(QMouseEvent* event)
 
 void MapWidget::mouseDoubleClickEvent(QMouseEvent* event)
 {
+	if (input_recording)
+		input_recording->record(event);
+	
 	if (touch_cursor && tool && tool->usesTouchCursor())
 	{
 		if (!touch_cursor->mouseDoubleClickEvent(event))
@@ -1016,6 +1280,9 @@ void MapWidget::_mouseDoubleClickEvent(QMouseEvent* event)
 
 void MapWidget::wheelEvent(QWheelEvent* event)
 {
+	if (input_recording)
+		input_recording->record(event);
+	
 	if (event->orientation() == Qt::Vertical)
 	{
 		float degrees = event->delta() / 8.0f;
@@ -1026,6 +1293,7 @@ void MapWidget::wheelEvent(QWheelEvent* event)
 			bool preserve_cursor_pos = (event->modifiers() & Qt::ControlModifier) == 0;
 			if (num_steps < 0 && !Settings::getInstance().getSettingCached(Settings::MapEditor_ZoomOutAwayFromCursor).toBool())
 				preserve_cursor_pos = !preserve_cursor_pos;
+			zoom_settle_timer->start();
 			view->zoomSteps(num_steps, preserve_cursor_pos, viewportToView(event->pos()));
 			
 			// Send a mouse move event to the current tool as zooming out can move the mouse position on the map
@@ -1051,6 +1319,9 @@ void MapWidget::leaveEvent(QEvent* event)
 
 bool MapWidget::keyPressEventFilter(QKeyEvent* event)
 {
+	if (input_recording)
+		input_recording->record(event);
+	
 	if (tool && tool->keyPressEvent(event))
 	{
 		return true;
@@ -1088,6 +1359,9 @@ bool MapWidget::keyPressEventFilter(QKeyEvent* event)
 
 bool MapWidget::keyReleaseEventFilter(QKeyEvent* event)
 {
+	if (input_recording)
+		input_recording->record(event);
+	
 	if (tool && tool->keyReleaseEvent(event))
 	{
 		return true;
@@ -1159,123 +1433,575 @@ bool MapWidget::isBelowTemplateVisible() const
 	return containsVisibleTemplate(0, view->getMap()->getFirstFrontTemplate() - 1);
 }
 
-void MapWidget::updateTemplateCache(QImage& cache, QRect& dirty_rect, int first_template, int last_template, bool use_background)
+void MapWidget::updateTemplateCache(QImage& cache, const QRect& rect, int first_template, int last_template, bool use_background)
 {
 	Q_ASSERT(containsVisibleTemplate(first_template, last_template));
+	Q_ASSERT(!cache.isNull());
+	
+	RenderProfiler::PhaseTimer phase_timer(profiler.data(), RenderProfiler::TemplateCache);
+	MAPPER_TRACE_SCOPE("render", "MapWidget::updateTemplateCache");
 	
-	if (cache.isNull())
-	{
-		// Lazy allocation of cache image
-		cache = QImage(size(), QImage::Format_ARGB32_Premultiplied);
-		dirty_rect = rect();
-	}
-	else
-	{
-		// Make sure not to use a bigger draw rect than necessary
-		dirty_rect = dirty_rect.intersected(rect());
-	}
-		
 	// Start drawing
 	QPainter painter(&cache);
-	painter.setClipRect(dirty_rect);
+	painter.translate(cache_margin, cache_margin);
+	painter.setClipRect(rect);
 	
 	// Fill with background color (TODO: make configurable)
 	if (use_background)
-		painter.fillRect(dirty_rect, Qt::white);
+		painter.fillRect(rect, Qt::white);
 	else
 	{
 		QPainter::CompositionMode mode = painter.compositionMode();
 		painter.setCompositionMode(QPainter::CompositionMode_Clear);
-		painter.fillRect(dirty_rect, Qt::transparent);
+		painter.fillRect(rect, Qt::transparent);
 		painter.setCompositionMode(mode);
 	}
 	
 	// Draw templates
+	painter.setRenderHint(QPainter::SmoothPixmapTransform, !draft_templates && !power_saving);
 	painter.translate(width() / 2.0, height() / 2.0);
 	painter.setWorldTransform(view->worldTransform(), true);
 	
 	Map* map = view->getMap();
-	QRectF map_view_rect = view->calculateViewedRect(viewportToView(dirty_rect));
+	QRectF map_view_rect = view->calculateViewedRect(viewportToView(rect));
 	
 	map->drawTemplates(&painter, map_view_rect, first_template, last_template, view, true);
-	
-	dirty_rect.setWidth(-1); // => !dirty_rect.isValid()
 }
 
-void MapWidget::updateMapCache(bool use_background)
+void MapWidget::updateMapTile(QImage& tile, const QRect& rect, qreal scale)
 {
-	if (map_cache.isNull())
-	{
-		// Lazy allocation of cache image
-		map_cache = QImage(size(), QImage::Format_ARGB32_Premultiplied);
-		map_cache_dirty_rect = rect();
-	}
-	else
-	{
-		// Make sure not to use a bigger draw rect than necessary
-		map_cache_dirty_rect = map_cache_dirty_rect.intersected(rect());
-	}
+	Q_ASSERT(!tile.isNull());
+	
+	RenderProfiler::PhaseTimer phase_timer(profiler.data(), view->isOverprintingSimulationEnabled() ? RenderProfiler::Overprinting : RenderProfiler::MapCache);
+	MAPPER_TRACE_SCOPE("render", "MapWidget::updateMapTile");
+	
+	tile.fill(Qt::transparent);
 	
 	// Start drawing
 	QPainter painter;
-	painter.begin(&map_cache);
-	painter.setClipRect(map_cache_dirty_rect);
+	painter.begin(&tile);
 	
-	// Fill with background color (TODO: make configurable)
-	if (use_background)
+	RenderConfig::Options options(RenderConfig::Screen | RenderConfig::HelperSymbols);
+	if (view->getMap()->isAreaHatchingEnabled())
+		options |= RenderConfig::HatchedAreas;
+	if (useMapTileAntialiasing())
 	{
-		painter.fillRect(map_cache_dirty_rect, Qt::white);
+		// Sub-pixel details are only faint shadows with antialiasing.
+		painter.setRenderHint(QPainter::Antialiasing);
+		options |= RenderConfig::ReducedDetail;
 	}
 	else
 	{
-		QPainter::CompositionMode mode = painter.compositionMode();
-		painter.setCompositionMode(QPainter::CompositionMode_Clear);
-		painter.fillRect(map_cache_dirty_rect, Qt::transparent);
-		painter.setCompositionMode(mode);
-	}
-	
-	RenderConfig::Options options(RenderConfig::Screen | RenderConfig::HelperSymbols);
-	bool use_antialiasing = force_antialiasing || Settings::getInstance().getSettingCached(Settings::MapDisplay_Antialiasing).toBool();
-	if (use_antialiasing)
-		painter.setRenderHint(QPainter::Antialiasing);
-	else
 		options |= RenderConfig::DisableAntialiasing | RenderConfig::ForceMinSize;
+	}
+	if (!view->isOverprintingSimulationEnabled())
+	{
+		// Most of the area fills in dense maps are hidden by other fills.
+		options |= RenderConfig::OcclusionCulling;
+		if (view->isSoftProofEnabled())
+			options |= RenderConfig::SoftProof;
+	}
 		
 	Map* map = view->getMap();
-	QRectF map_view_rect = view->calculateViewedRect(viewportToView(map_cache_dirty_rect));
+	const QTransform transform = mapTileTransform(scale);
+	QRectF map_view_rect = transform.inverted().mapRect(QRectF(rect));
 
-	RenderConfig config = { *map, map_view_rect, view->calculateFinalZoomFactor(), options, 1.0 };
+	RenderConfig config = { *map, map_view_rect, view->calculateFinalZoomFactor() * scale * mapTilePixelRatio(), options, 1.0 };
 	
-	painter.translate(width() / 2.0, height() / 2.0);
-	painter.setWorldTransform(view->worldTransform(), true);
+	painter.translate(-rect.left(), -rect.top());
+	painter.setWorldTransform(transform, true);
 #ifndef Q_OS_ANDROID
 	if (view->isOverprintingSimulationEnabled())
 		map->drawOverprintingSimulation(&painter, config);
 	else
 #endif
-		map->draw(&painter, config);
-	
-	if (view->isGridVisible())
-		map->drawGrid(&painter, map_view_rect, true);
+	{
+		map->updateObjectsFor(object_update_time_limit, map_view_rect);
+		map->drawUpdated(&painter, config);
+	}
 	
 	// Finish drawing
 	painter.end();
+}
+
+void MapWidget::updateGridCache()
+{
+	const QTransform transform = viewportTransform();
+	if (!grid_cache_dirty && grid_cache.size() == size() && grid_cache_transform == transform)
+		return;
+	
+	MAPPER_TRACE_SCOPE("render", "MapWidget::updateGridCache");
+	
+	if (grid_cache.size() != size())
+		grid_cache = QImage(size(), QImage::Format_ARGB32_Premultiplied);
+	grid_cache.fill(Qt::transparent);
+	
+	QPainter painter(&grid_cache);
+	bool use_antialiasing = force_antialiasing || (!power_saving && Settings::getInstance().getSettingCached(Settings::MapDisplay_Antialiasing).toBool());
+	painter.setRenderHint(QPainter::Antialiasing, use_antialiasing);
+	painter.translate(width() / 2.0, height() / 2.0);
+	painter.setWorldTransform(view->worldTransform(), true);
+	
+	QRectF map_view_rect = view->calculateViewedRect(viewportToView(rect()));
+	view->getMap()->drawGrid(&painter, map_view_rect, true);
+	painter.end();
+	
+	grid_cache_transform = transform;
+	grid_cache_dirty = false;
+}
+
+bool MapWidget::updateDirtyCaches(int time_limit)
+{
+	QElapsedTimer timer;
+	timer.start();
 	
-	map_cache_dirty_rect.setWidth(-1); // => !map_cache_dirty_rect.isValid()
+	// The map tiles come first.
+	tile_rotation = view->getRotation();
+	map_tiles.setTransform(mapTileTransform(), mapTileRenderKey());
+	const QRect tile_rect = toMapTilePixels(rect());
+	for (QRect tile = map_tiles.nextInvalidTile(tile_rect); tile.isValid(); tile = map_tiles.nextInvalidTile(tile_rect))
+	{
+		updateMapTile(map_tiles.tileImage(tile), tile);
+		rectIncludeSafe(cache_update_rect, fromMapTilePixels(tile).translated(pan_offset).intersected(rect()));
+		if (time_limit >= 0 && timer.elapsed() >= time_limit)
+			return false;
+	}
+	
+	releaseUnusedTemplateCaches();
+	
+	int slice_height = cache_slice_height;
+	while (true)
+	{
+		// Select the next cache to be updated
+		QImage* cache = nullptr;
+		QRect* dirty_rect = nullptr;
+		QRect* draft_rect = nullptr;
+		int first_template = 0;
+		int last_template = -1;
+		bool use_background = false;
+		if (!view->areAllTemplatesHidden() && below_template_cache_dirty_rect.isValid() && isBelowTemplateVisible())
+		{
+			cache = &below_template_cache;
+			dirty_rect = &below_template_cache_dirty_rect;
+			draft_rect = &below_template_cache_draft_rect;
+			last_template = view->getMap()->getFirstFrontTemplate() - 1;
+			use_background = true;
+		}
+		else if (!view->areAllTemplatesHidden() && above_template_cache_dirty_rect.isValid() && isAboveTemplateVisible())
+		{
+			cache = &above_template_cache;
+			dirty_rect = &above_template_cache_dirty_rect;
+			draft_rect = &above_template_cache_draft_rect;
+			first_template = view->getMap()->getFirstFrontTemplate();
+			last_template = view->getMap()->getNumTemplates() - 1;
+		}
+		else
+		{
+			return true;
+		}
+		
+		if (cache->isNull())
+		{
+			// Lazy allocation of cache image. The cache below the map is opaque.
+			const bool opaque = use_background && reduced_color_depth;
+			const qreal ratio = templateCachePixelRatio();
+			*cache = QImage(cacheRect().size() * ratio, opaque ? QImage::Format_RGB16 : QImage::Format_ARGB32_Premultiplied);
+			cache->setDevicePixelRatio(ratio);
+			*dirty_rect = rect();
+			QRegion& margin_dirty = (cache == &below_template_cache) ? below_template_cache_margin_dirty : above_template_cache_margin_dirty;
+			margin_dirty = QRegion(cacheRect()) - QRegion(rect());
+			cache_transform = viewportTransform();
+		}
+		else
+		{
+			// Make sure not to use a bigger draw rect than necessary
+			*dirty_rect = dirty_rect->intersected(rect());
+			if (!dirty_rect->isValid())
+				continue;
+		}
+		
+		// Take a slice from the top of the dirty rect
+		QRect slice = *dirty_rect;
+		if (time_limit >= 0 && slice.height() > slice_height)
+		{
+			slice.setHeight(slice_height);
+			dirty_rect->setTop(slice.bottom() + 1);
+		}
+		else
+		{
+			dirty_rect->setWidth(-1); // => !dirty_rect->isValid()
+		}
+		
+		const qint64 slice_start = timer.elapsed();
+		updateTemplateCache(*cache, slice, first_template, last_template, use_background);
+		rectIncludeSafe(cache_update_rect, slice);
+		if (draft_templates)
+			rectIncludeSafe(*draft_rect, slice);
+		
+		if (time_limit >= 0)
+		{
+			const qint64 elapsed = timer.elapsed();
+			if (elapsed >= time_limit)
+				return false;
+			if (4 * (elapsed - slice_start) < time_limit)
+				slice_height *= 2;
+		}
+	}
+}
+
+void MapWidget::releaseUnusedTemplateCaches()
+{
+	// Caches with another pixel ratio are released, too.
+	const bool all_hidden = view->areAllTemplatesHidden();
+	const qreal ratio = templateCachePixelRatio();
+	if (!below_template_cache.isNull() && (all_hidden || !isBelowTemplateVisible() || below_template_cache.devicePixelRatio() != ratio))
+	{
+		below_template_cache = QImage();
+		below_template_cache_dirty_rect = rect();
+		below_template_cache_margin_dirty = QRegion();
+		below_template_cache_draft_rect = QRect();
+	}
+	if (!above_template_cache.isNull() && (all_hidden || !isAboveTemplateVisible() || above_template_cache.devicePixelRatio() != ratio))
+	{
+		above_template_cache = QImage();
+		above_template_cache_dirty_rect = rect();
+		above_template_cache_margin_dirty = QRegion();
+		above_template_cache_draft_rect = QRect();
+	}
 }
 
-void MapWidget::updateAllDirtyCaches()
+bool MapWidget::updateCacheMargins(int time_limit)
 {
-	if (map_cache_dirty_rect.isValid())
-		updateMapCache(false);
+	QElapsedTimer timer;
+	timer.start();
+	
+	const QRect cache_rect = toMapTilePixels(cacheRect());
+	map_tiles.setTransform(mapTileTransform(), mapTileRenderKey());
+	for (QRect tile = map_tiles.nextInvalidTile(cache_rect); tile.isValid(); tile = map_tiles.nextInvalidTile(cache_rect))
+	{
+		updateMapTile(map_tiles.tileImage(tile), tile);
+		const QRect visible_part = fromMapTilePixels(tile).translated(pan_offset).intersected(rect());
+		if (visible_part.isValid())
+			update(visible_part);
+		if (timer.elapsed() >= time_limit)
+			return false;
+	}
 	
-	if (!view->areAllTemplatesHidden())
+	while (true)
 	{
-		if (below_template_cache_dirty_rect.isValid() && isBelowTemplateVisible())
-			updateTemplateCache(below_template_cache, below_template_cache_dirty_rect, 0, view->getMap()->getFirstFrontTemplate() - 1, true);
+		// Select the next cache to be updated
+		QImage* cache = nullptr;
+		QRegion* margin_dirty = nullptr;
+		int first_template = 0;
+		int last_template = -1;
+		bool use_background = false;
+		if (!view->areAllTemplatesHidden() && !below_template_cache_margin_dirty.isEmpty() && !below_template_cache.isNull() && isBelowTemplateVisible())
+		{
+			cache = &below_template_cache;
+			margin_dirty = &below_template_cache_margin_dirty;
+			last_template = view->getMap()->getFirstFrontTemplate() - 1;
+			use_background = true;
+		}
+		else if (!view->areAllTemplatesHidden() && !above_template_cache_margin_dirty.isEmpty() && !above_template_cache.isNull() && isAboveTemplateVisible())
+		{
+			cache = &above_template_cache;
+			margin_dirty = &above_template_cache_margin_dirty;
+			first_template = view->getMap()->getFirstFrontTemplate();
+			last_template = view->getMap()->getNumTemplates() - 1;
+		}
+		else
+		{
+			return true;
+		}
 		
-		if (above_template_cache_dirty_rect.isValid() && isAboveTemplateVisible())
-			updateTemplateCache(above_template_cache, above_template_cache_dirty_rect, view->getMap()->getFirstFrontTemplate(), view->getMap()->getNumTemplates() - 1, false);
+		// Take a slice from the top of the first dirty part
+		QRect slice = margin_dirty->rects().front();
+		if (slice.height() > cache_slice_height)
+			slice.setHeight(cache_slice_height);
+		*margin_dirty -= slice;
+		
+		updateTemplateCache(*cache, slice, first_template, last_template, use_background);
+		if (timer.elapsed() >= time_limit)
+			return false;
+	}
+}
+
+void MapWidget::continueCacheUpdates()
+{
+	cache_update_scheduled = false;
+	
+	QRect update_rect = cache_update_rect;
+	const QRect tile = map_tiles.nextInvalidTile(toMapTilePixels(rect()));
+	if (tile.isValid())
+		rectIncludeSafe(update_rect, fromMapTilePixels(tile).translated(pan_offset).intersected(rect()));
+	rectIncludeSafe(update_rect, below_template_cache_dirty_rect.intersected(rect()));
+	rectIncludeSafe(update_rect, above_template_cache_dirty_rect.intersected(rect()));
+	cache_update_rect = QRect();
+	if (update_rect.isValid())
+		update(update_rect);
+}
+
+void MapWidget::refineTemplateCaches()
+{
+	draft_templates = false;
+	
+	QRect refine_rect;
+	for (QRect* draft_rect : { &below_template_cache_draft_rect, &above_template_cache_draft_rect })
+	{
+		rectIncludeSafe(refine_rect, draft_rect->intersected(cacheRect()));
+		*draft_rect = QRect();
+	}
+	if (mapTilePixelRatio() != 1 && pixel_ratio_policy == Settings::PixelRatio_NativeWhenIdle)
+		update(); // The map tiles of the native level
+	if (power_saving)
+		return; // The drafts are final.
+	
+	markDirty(below_template_cache_dirty_rect, below_template_cache_margin_dirty, refine_rect);
+	markDirty(above_template_cache_dirty_rect, above_template_cache_margin_dirty, refine_rect);
+	
+	const QRect update_rect = refine_rect.intersected(rect());
+	if (update_rect.isValid())
+		update(update_rect);
+}
+
+void MapWidget::updateCachesWhileIdle()
+{
+	// The viewport comes first, and nothing is drawn in draft mode.
+	// The next completed paint event restarts the timer.
+	if (!view || pinching || draft_templates || cache_update_scheduled || zoom_settle_timer->isActive() || rotation_settle_timer->isActive())
+		return;
+	
+	if (!updateCacheMargins(cache_update_time_limit))
+		idle_update_timer->start();
+	else if (power_saving)
+		return; // No speculative rendering of other zoom levels
+	else if (getTimeSinceLastInteraction() < zoom_prefetch_idle_time)
+		idle_update_timer->start();
+	else if (!prefetchZoomLevels())
+		idle_update_timer->start();
+}
+
+void MapWidget::updateDisplaySettings()
+{
+	const int margin = qMax(0, Settings::getInstance().getSettingCached(Settings::MapDisplay_CacheMargin).toInt());
+	const bool saving = Settings::getInstance().getSettingCached(Settings::General_PowerSaving).toBool();
+	const bool reduced = Settings::getInstance().getSettingCached(Settings::MapDisplay_ReducedColorDepth).toBool();
+	const int policy = Settings::getInstance().getSettingCached(Settings::MapDisplay_PixelRatioPolicy).toInt();
+	if (margin != cache_margin || saving != power_saving || reduced != reduced_color_depth || policy != pixel_ratio_policy)
+	{
+		cache_margin = margin;
+		power_saving = saving;
+		reduced_color_depth = reduced;
+		pixel_ratio_policy = policy;
+		below_template_cache = QImage();
+		above_template_cache = QImage();
+		below_template_cache_margin_dirty = QRegion();
+		above_template_cache_margin_dirty = QRegion();
+		below_template_cache_draft_rect = QRect();
+		above_template_cache_draft_rect = QRect();
+		updateMapTileBudget();
+		if (view)
+			updateEverything();
+	}
+}
+
+void MapWidget::updateMapTileBudget()
+{
+	// Keep some screens of map tiles, including the neighbouring zoom levels.
+	// Power saving mode keeps more tiles instead of rendering them again.
+	const QSize cache_size = cacheRect().size() * (pixel_ratio_policy == Settings::PixelRatio_Logical ? 1 : nativePixelRatio());
+	const std::size_t tiles_per_screen = std::size_t(cache_size.width() / MapTileCache::tile_size + 2) * std::size_t(cache_size.height() / MapTileCache::tile_size + 2);
+	const std::size_t screens = power_saving ? 8 : 4;
+	map_tiles.setMaxTiles(qMax(std::size_t(256), screens * tiles_per_screen));
+}
+
+bool MapWidget::useMapTileAntialiasing() const
+{
+	return force_antialiasing || (!power_saving && Settings::getInstance().getSettingCached(Settings::MapDisplay_Antialiasing).toBool());
+}
+
+int MapWidget::mapTileRenderKey() const
+{
+	// The tiles are shared with the other widgets of the map
+	// which render with the same options.
+	int key = useMapTileAntialiasing() ? 1 : 0;
+	if (view->isOverprintingSimulationEnabled())
+		key |= 2;
+	else if (view->isSoftProofEnabled())
+		key |= 4;
+	return key;
+}
+
+QRect MapWidget::cacheRect() const
+{
+	return rect().adjusted(-cache_margin, -cache_margin, cache_margin, cache_margin);
+}
+
+QTransform MapWidget::viewportTransform(qreal scale) const
+{
+	return view->worldTransform() * QTransform::fromScale(scale, scale) * QTransform::fromTranslate(width() / 2.0, height() / 2.0);
+}
+
+qreal MapWidget::nativePixelRatio() const
+{
+#if QT_VERSION >= 0x050600
+	return devicePixelRatioF();
+#else
+	return devicePixelRatio();
+#endif
+}
+
+qreal MapWidget::mapTilePixelRatio() const
+{
+	switch (pixel_ratio_policy)
+	{
+	case Settings::PixelRatio_Logical:
+		return 1;
+	case Settings::PixelRatio_NativeWhenIdle:
+		return draft_templates ? 1 : nativePixelRatio();
+	default:
+		return nativePixelRatio();
+	}
+}
+
+qreal MapWidget::templateCachePixelRatio() const
+{
+	return (pixel_ratio_policy == Settings::PixelRatio_Native) ? nativePixelRatio() : 1;
+}
+
+QTransform MapWidget::mapTileTransform(qreal scale) const
+{
+	const qreal ratio = mapTilePixelRatio();
+	QTransform transform = viewportTransform(scale);
+	if (ratio != 1)
+	{
+		transform *= QTransform::fromScale(ratio, ratio);
+		transform.setMatrix(transform.m11(), transform.m12(), transform.m13(),
+		                    transform.m21(), transform.m22(), transform.m23(),
+		                    qRound(transform.dx()), qRound(transform.dy()), transform.m33());
+	}
+	return transform;
+}
+
+QRect MapWidget::toMapTilePixels(const QRect& rect) const
+{
+	const qreal ratio = mapTilePixelRatio();
+	return QRectF(QPointF(rect.topLeft()) * ratio, QSizeF(rect.size()) * ratio).toAlignedRect();
+}
+
+QRect MapWidget::fromMapTilePixels(const QRect& rect) const
+{
+	const qreal ratio = mapTilePixelRatio();
+	return QRectF(QPointF(rect.topLeft()) / ratio, QSizeF(rect.size()) / ratio).toAlignedRect();
+}
+
+bool MapWidget::prefetchZoomLevels()
+{
+	if (!view->effectiveMapVisibility()->visible)
+		return true;
+	
+	// Render at most one tile per call, so that input is not blocked for long.
+	// Existing tiles are not evicted for neighbouring levels.
+	QRect tile;
+	for (qreal scale : { zoom_step_factor, 1 / zoom_step_factor })
+	{
+		const qreal zoom = view->getZoom() * scale;
+		if (zoom > MapView::zoom_in_limit || zoom < MapView::zoom_out_limit)
+			continue;
+		
+		map_tiles.setTransform(mapTileTransform(scale), mapTileRenderKey());
+		tile = map_tiles.nextInvalidTile(toMapTilePixels(rect()));
+		if (tile.isValid() && map_tiles.numFreeTiles() > 0)
+		{
+			updateMapTile(map_tiles.tileImage(tile), tile, scale);
+			break;
+		}
+		tile = QRect();
+	}
+	map_tiles.setTransform(mapTileTransform(), mapTileRenderKey());
+	return !tile.isValid();
+}
+
+void MapWidget::warpCaches()
+{
+	const QTransform new_transform = viewportTransform();
+	if (new_transform == cache_transform)
+	{
+		updateEverything();
+		return;
+	}
+	
+	QTransform transform = cache_transform.inverted() * new_transform;
+	const int dx = qRound(transform.dx());
+	const int dy = qRound(transform.dy());
+	const bool shifted = transform.type() <= QTransform::TxTranslate &&
+	                     qAbs(transform.dx() - dx) < 0.05 && qAbs(transform.dy() - dy) < 0.05;
+	if (shifted)
+		transform = QTransform::fromTranslate(dx, dy);
+	
+	// The caches' pixels are offset by the margin from viewport coordinates.
+	const QTransform cache_warp = QTransform::fromTranslate(-cache_margin, -cache_margin) * transform * QTransform::fromTranslate(cache_margin, cache_margin);
+	warpCache(below_template_cache, cache_warp, Qt::white);
+	warpCache(above_template_cache, cache_warp, Qt::transparent);
+	
+	if (shifted)
+	{
+		// The view was shifted by full pixels, so the warped caches are valid
+		// except for the uncovered borders. Content from the margins moves
+		// into the viewport.
+		const QRect cache_rect = cacheRect();
+		QRect uncovered_x, uncovered_y;
+		if (dx > 0)
+			uncovered_x = QRect(cache_rect.left(), cache_rect.top(), dx, cache_rect.height());
+		else if (dx < 0)
+			uncovered_x = QRect(cache_rect.right() + 1 + dx, cache_rect.top(), -dx, cache_rect.height());
+		if (dy > 0)
+			uncovered_y = QRect(cache_rect.left(), cache_rect.top(), cache_rect.width(), dy);
+		else if (dy < 0)
+			uncovered_y = QRect(cache_rect.left(), cache_rect.bottom() + 1 + dy, cache_rect.width(), -dy);
+		
+		moveDirtyArea(below_template_cache_dirty_rect, below_template_cache_margin_dirty, dx, dy);
+		moveDirtyArea(above_template_cache_dirty_rect, above_template_cache_margin_dirty, dx, dy);
+		for (const QRect& uncovered : { uncovered_x, uncovered_y })
+		{
+			markDirty(below_template_cache_dirty_rect, below_template_cache_margin_dirty, uncovered);
+			markDirty(above_template_cache_dirty_rect, above_template_cache_margin_dirty, uncovered);
+		}
+		for (QRect* draft_rect : { &below_template_cache_draft_rect, &above_template_cache_draft_rect })
+			moveDirtyRect(*draft_rect, dx, dy);
+	}
+	else
+	{
+		below_template_cache_dirty_rect = rect();
+		above_template_cache_dirty_rect = below_template_cache_dirty_rect;
+		below_template_cache_margin_dirty = QRegion(cacheRect()) - QRegion(rect());
+		above_template_cache_margin_dirty = below_template_cache_margin_dirty;
+		below_template_cache_draft_rect = QRect();
+		above_template_cache_draft_rect = QRect();
+		
+		// Draw fast until the view settles.
+		draft_templates = true;
+		template_refinement_timer->start();
+	}
+	
+	// The map tiles are selected by transformation in updateDirtyCaches().
+	cache_transform = new_transform;
+	update();
+}
+
+void MapWidget::warpCache(QImage& cache, const QTransform& transform, const QColor& background)
+{
+	if (!cache.isNull())
+	{
+		QImage new_cache(cache.size(), cache.format());
+		new_cache.setDevicePixelRatio(cache.devicePixelRatio());
+		new_cache.fill(background);
+		QPainter painter(&new_cache);
+		painter.setRenderHint(QPainter::SmoothPixmapTransform);
+		painter.setTransform(transform);
+		painter.drawImage(0, 0, cache);
+		painter.end();
+		cache = new_cache;
 	}
 }
 
@@ -1284,6 +2010,7 @@ void MapWidget::shiftCache(int sx, int sy, QImage& cache)
 	if (!cache.isNull())
 	{
 		QImage new_cache(cache.size(), cache.format());
+		new_cache.setDevicePixelRatio(cache.devicePixelRatio());
 		QPainter painter(&new_cache);
 		painter.setCompositionMode(QPainter::CompositionMode_Source);
 		painter.drawImage(sx, sy, cache);
@@ -26,21 +26,27 @@
 
 #include <QImage>
 #include <QPixmap>
+#include <QRegion>
 #include <QTime>
+#include <QTransform>
 #include <QWidget>
 
 #include "core/map_view.h"
 #include "map.h"
+#include "map_tile_cache.h"
 
 QT_BEGIN_NAMESPACE
 class QGestureEvent;
 class QLabel;
+class QTimer;
 QT_END_NAMESPACE
 
+class InputRecording;
 class MapEditorActivity;
 class MapEditorTool;
 class MapView;
 class PieMenu;
+class RenderProfiler;
 class TouchCursor;
 class GPSDisplay;
 class CompassDisplay;
@@ -54,11 +60,16 @@ class GPSTemporaryMarkers;
  * are of the same size as the widget area. If then for example the map changes,
  * the other caches do not need to be redrawn.
  * <ul>
- * <li>The <b>map cache</b> contains the currently visible part of the map</li>
+ * <li>The <b>map cache</b> contains tiles of the map, for the recently
+ *     used zoom levels (see MapTileCache). The tiles are shared with the
+ *     other widgets of the same map.</li>
  * <li>The <b>below template cache</b> contains the currently
  *     visible part of all templates below the map</li>
  * <li>The <b>above template cache</b> contains the currently
  *     visible part of all templates above the map</li>
+ * <li>The <b>selection cache</b> contains the highlighted selection,
+ *     which the tools draw on top of the other layers (see
+ *     Map::drawSelection())</li>
  * </ul>
  */
 class MapWidget : public QWidget
@@ -216,6 +227,24 @@ public:
 	 */
 	void markObjectAreaDirty(QRectF map_rect);
 	
+	/**
+	 * Mark a rectangular region given in map coordinates of the selection
+	 * cache as dirty, i.e. redraw needed.
+	 * This rect is united with possible previous dirty rects of that cache.
+	 */
+	void markSelectionAreaDirty(const QRectF& map_rect);
+	
+	/**
+	 * Returns the cache for the highlighted selection, for Map::drawSelection().
+	 * 
+	 * The cache has the size of the widget, and it is based on the viewport
+	 * transformation without the pan offset. It becomes entirely dirty when
+	 * the transformation or the given drawing options change. The dirty
+	 * rect is returned in dirty_rect, and the cache is considered clean
+	 * afterwards, i.e. the caller must redraw this part.
+	 */
+	QImage& getSelectionCache(int options, QRect& dirty_rect);
+	
 	/**
 	 * Set the given rect as bounding box for the current drawing, i.e. the
 	 * graphical display of the active tool.
@@ -272,6 +301,12 @@ public:
 	 */
 	void updateEverythingInRect(const QRect& dirty_rect);
 	
+	/**
+	 * Redraws the grid, e.g. after the grid settings or its visibility
+	 * changed. The map and template caches are kept.
+	 */
+	void updateGrid();
+	
 	/** Specify the label where the MapWidget will display zoom information. */
 	void setZoomLabel(QLabel* zoom_label);
 	/** Specify the label where the MapWidget will display cursor position information. */
@@ -298,6 +333,30 @@ public:
 	/** Returns the widget's context menu widget. */
 	QWidget* getContextMenu();
 	
+	/**
+	 * Enables or disables the render profiler.
+	 * 
+	 * While enabled, the profiler measures each frame, and it shows
+	 * the measurements as an overlay in the top left corner.
+	 */
+	void setProfilerEnabled(bool enabled);
+	
+	/** Returns the render profiler, or nullptr if it is disabled. */
+	const RenderProfiler* getProfiler() const;
+	
+	/**
+	 * Sets the recording which receives the input events of this widget.
+	 * 
+	 * Does not take ownership. Pass nullptr to stop recording.
+	 */
+	void setInputRecording(InputRecording* recording);
+	
+	/**
+	 * Returns the memory used by the template caches, by the map cache and
+	 * by the selection cache, in bytes.
+	 */
+	qint64 cacheMemoryUsage() const;
+	
 	/** Returns the widget's preferred size. */
 	virtual QSize sizeHint() const;
 	
@@ -320,6 +379,17 @@ public slots:
 private slots:
 	void updateObjectTagLabel();
 	void updateDrawingLaterSlot();
+	/** Continues redrawing the caches after a paint event ran out of time. */
+	void continueCacheUpdates();
+	/** Redraws the template cache parts which were drawn without smoothing. */
+	void refineTemplateCaches();
+	/**
+	 * Redraws parts of the cache margins, and then renders neighbouring zoom
+	 * levels, while the widget is idle.
+	 */
+	void updateCachesWhileIdle();
+	/** Reads the cache margin and the power saving mode from the settings. */
+	void updateDisplaySettings();
 	
 protected:
 	virtual bool event(QEvent *event);
@@ -355,23 +425,110 @@ private:
 	/** Checks if there is any visible template below the map. */
 	bool isBelowTemplateVisible() const;
 	/**
-	 * Redraws the template cache.
-	 * @param cache Reference to pointer to the cache.
-	 * @param dirty_rect Rectangle of the cache to redraw, in viewport coordinates.
+	 * Redraws a part of a template cache.
+	 * @param cache Reference to the cache.
+	 * @param rect Rectangle of the cache to redraw, in viewport coordinates.
 	 * @param first_template Lowest template index to draw.
 	 * @param last_template Highest template index to draw.
 	 * @param use_background If set to true, fills the cache with white before
 	 *     drawing the templates, else makes it transparent.
+	 * 
+	 * While draft_templates is set, images are drawn without smoothing.
 	 */
-	void updateTemplateCache(QImage& cache, QRect& dirty_rect, int first_template, int last_template, bool use_background);
+	void updateTemplateCache(QImage& cache, const QRect& rect, int first_template, int last_template, bool use_background);
 	/**
-	 * Redraws the map cache in the map cache dirty rect.
-	 * @param use_background If set to true, fills the cache with white before
-	 *     drawing the map, else makes it transparent.
+	 * Redraws a tile of the map cache.
+	 * @param tile Reference to the tile's image.
+	 * @param rect Rectangle of the tile, in map tile pixels.
+	 * @param scale The scale relative to the current view, for rendering
+	 *     other zoom levels. The center of the viewport is kept fixed.
+	 */
+	void updateMapTile(QImage& tile, const QRect& rect, qreal scale = 1.0);
+	/**
+	 * Redraws the grid cache if the grid or the viewport transformation
+	 * changed since it was drawn.
+	 */
+	void updateGridCache();
+	/**
+	 * Redraws the dirty caches slice by slice, until all caches are up to date
+	 * or until the given time (in milliseconds) is exceeded.
+	 * A negative time means no limit.
+	 * Returns true if all caches are up to date.
+	 */
+	bool updateDirtyCaches(int time_limit);
+	/**
+	 * Releases the template caches which have no visible templates.
+	 * 
+	 * When there are no visible templates above the map, the map tiles are
+	 * drawn directly over the cache of the templates below the map, so only
+	 * a single full-size template cache is held.
+	 */
+	void releaseUnusedTemplateCaches();
+	/**
+	 * Redraws the dirty parts of the cache margins, until they are up to date
+	 * or until the given time (in milliseconds) is exceeded.
+	 * Returns true if the margins are up to date.
+	 */
+	bool updateCacheMargins(int time_limit);
+	/**
+	 * Returns the area covered by the caches, in viewport coordinates.
+	 * 
+	 * It extends the viewport by the cache margin on each side.
+	 */
+	QRect cacheRect() const;
+	/** Sets the size of the map tile cache, depending on the cache size. */
+	void updateMapTileBudget();
+	/** Returns true if the map tiles are drawn with antialiasing. */
+	bool useMapTileAntialiasing() const;
+	/**
+	 * Returns the render key of the map tiles, see MapTileCache::setTransform().
+	 * 
+	 * It stands for the options which change the content of the tiles.
+	 */
+	int mapTileRenderKey() const;
+	/**
+	 * Returns the transformation from map coordinates to viewport coordinates.
+	 * 
+	 * A scale other than 1 gives the transformation for another zoom level,
+	 * with the same center of the viewport.
 	 */
-	void updateMapCache(bool use_background);
-	/** Redraws all dirty caches. */
-	void updateAllDirtyCaches();
+	QTransform viewportTransform(qreal scale = 1.0) const;
+	/** Returns the ratio of device pixels to logical pixels of this widget's screen. */
+	qreal nativePixelRatio() const;
+	/**
+	 * Returns the number of map tile pixels per viewport pixel.
+	 * 
+	 * It depends on the pixel ratio policy. With PixelRatio_NativeWhenIdle,
+	 * the tiles are rendered in logical pixels while draft_templates is set.
+	 */
+	qreal mapTilePixelRatio() const;
+	/** Returns the number of template cache pixels per viewport pixel. */
+	qreal templateCachePixelRatio() const;
+	/**
+	 * Returns the transformation from map coordinates to map tile pixels.
+	 * 
+	 * For pixel ratios other than 1, the translation is rounded to full
+	 * pixels, so that panning by full viewport pixels keeps the tile level
+	 * even for fractional ratios.
+	 */
+	QTransform mapTileTransform(qreal scale = 1.0) const;
+	/** Returns the map tile pixels covering the given rect in viewport coordinates. */
+	QRect toMapTilePixels(const QRect& rect) const;
+	/** Returns the viewport area covering the given rect in map tile pixels. */
+	QRect fromMapTilePixels(const QRect& rect) const;
+	/**
+	 * Renders a map tile of the next or previous zoom level, for the current
+	 * viewport, so that the first zoom step can show it immediately.
+	 * Returns true when there is nothing left to render.
+	 */
+	bool prefetchZoomLevels();
+	/**
+	 * Reprojects the caches' content to the current view, for display until
+	 * the caches are redrawn, and marks the caches as dirty where needed.
+	 */
+	void warpCaches();
+	/** Draws the cache's content with the given transformation. */
+	void warpCache(QImage& cache, const QTransform& transform, const QColor& background);
 	/** Shifts the content in the cache by the given amount of pixels. */
 	void shiftCache(int sx, int sy, QImage& cache);
 	void shiftCache(int sx, int sy, QPixmap& cache);
@@ -388,6 +545,17 @@ private:
 	
 	/** Moves the dirty rect by the given amount of pixels. */
 	void moveDirtyRect(QRect& dirty_rect, qreal x, qreal y);
+	/**
+	 * Moves the dirty areas of a template cache by the given amount of pixels.
+	 * Dirty parts which move into the viewport are added to the dirty rect,
+	 * and dirty parts which move out of it are added to the margin.
+	 */
+	void moveDirtyArea(QRect& dirty_rect, QRegion& margin_dirty, int dx, int dy);
+	/**
+	 * Marks the given rect of a template cache as dirty. The part in the
+	 * viewport is added to the dirty rect, the rest to the margin.
+	 */
+	void markDirty(QRect& dirty_rect, QRegion& margin_dirty, const QRect& area);
 	
 	/** Starts a dragging interaction at the given cursor position. */
 	void startDragging(QPoint cursor_pos);
@@ -450,17 +618,112 @@ private:
 	QPoint pan_offset;
 	
 	// Template caches
+	/**
+	 * The width of the margin around the viewport which is covered by the
+	 * caches, in pixels.
+	 * 
+	 * The margin is drawn while the widget is idle. Panning by no more than
+	 * the margin shows pre-rendered content and needs no redrawing.
+	 */
+	int cache_margin;
+	/**
+	 * Power saving mode: The map is drawn without antialiasing, templates
+	 * are drawn without smoothing, and only the visible zoom level is
+	 * rendered in advance. More map tiles are kept.
+	 */
+	bool power_saving;
+	/**
+	 * Reduced color depth: The cache for the templates below the map, which
+	 * is opaque, uses 16 bits per pixel. This halves the memory and the
+	 * bandwidth needed for this cache, at the expense of color accuracy.
+	 */
+	bool reduced_color_depth;
+	/**
+	 * The resolution of the caches on screens with a device pixel ratio
+	 * other than 1, cf. Settings::PixelRatioPolicy.
+	 * 
+	 * Native resolution means four times the pixels at a ratio of 2.
+	 * So the map tiles may be rendered in logical pixels while the view
+	 * changes, and in native pixels when the view has settled.
+	 */
+	int pixel_ratio_policy;
+	/** Schedules updateCachesWhileIdle() after completed paint events. */
+	QTimer* idle_update_timer;
+	
 	/** Cache for templates below map layer */
 	QImage below_template_cache;
+	/** Dirty rect in the viewport, drawn by paint events. */
 	QRect below_template_cache_dirty_rect;
+	/** Dirty parts of the margin, drawn while idle. */
+	QRegion below_template_cache_margin_dirty;
 	
 	/** Cache for templates above map layer */
 	QImage above_template_cache;
 	QRect above_template_cache_dirty_rect;
+	QRegion above_template_cache_margin_dirty;
+	
+	/**
+	 * Draw images without smoothing during zooming and rotating.
+	 * 
+	 * Resampling large images with smoothing is expensive. So after a view
+	 * change which requires redrawing the whole caches, the templates are
+	 * drawn without smoothing, and the draft rects record where this
+	 * happened. When the view has settled, refineTemplateCaches() redraws
+	 * these parts with smoothing. With PixelRatio_NativeWhenIdle, the map
+	 * tiles are rendered in logical pixels during this time, too.
+	 */
+	bool draft_templates;
+	QRect below_template_cache_draft_rect;
+	QRect above_template_cache_draft_rect;
+	QTimer* template_refinement_timer;
+	
+	/**
+	 * Runs from each wheel zoom step until the zoom has settled.
+	 * 
+	 * While it is active, paint events show the warped caches and the map
+	 * tiles of other zoom levels, so that each step is displayed without
+	 * delay. On timeout, the caches are redrawn.
+	 */
+	QTimer* zoom_settle_timer;
+	
+	/**
+	 * Runs from each small rotation until the rotation has settled.
+	 * 
+	 * While it is active, paint events show the map tiles of the last
+	 * rendered rotation, rotated to the current view. On timeout, the
+	 * caches are redrawn.
+	 */
+	QTimer* rotation_settle_timer;
+	
+	/** The rotation of the view when the map tiles were last rendered. */
+	double tile_rotation;
+	
+	/** Map layer cache, organized in tiles */
+	MapTileCache map_tiles;
+	
+	/** Cache for the grid, drawn on top of the map layer */
+	QImage grid_cache;
+	/** The viewport transformation which the grid cache's content is based on. */
+	QTransform grid_cache_transform;
+	/** True if the grid cache must be redrawn regardless of the transformation. */
+	bool grid_cache_dirty;
 	
-	/** Map layer cache  */
-	QImage map_cache;
-	QRect map_cache_dirty_rect;
+	/** Cache for the highlighted selection */
+	QImage selection_cache;
+	QRect selection_cache_dirty_rect;
+	/** The viewport transformation which the selection cache's content is based on. */
+	QTransform selection_cache_transform;
+	/** The drawing options which the selection cache's content is based on. */
+	int selection_cache_options;
+	
+	/** The viewport transformation which the template caches' content is based on. */
+	QTransform cache_transform;
+	
+	/** Cache parts which were redrawn but not yet shown, in viewport coordinates. */
+	QRect cache_update_rect;
+	
+	/** Indicates that continueCacheUpdates() is scheduled. */
+	bool cache_update_scheduled;
 	
 	// Dirty regions for drawings (tools) and activities
 	/** Dirty rect for the current tool, in viewport coordinates (pixels). */
@@ -490,6 +753,12 @@ private:
 	/** Optional touch cursor for mobile devices */
 	QScopedPointer<TouchCursor> touch_cursor;
 	
+	/** Optional render profiler, see setProfilerEnabled() */
+	QScopedPointer<RenderProfiler> profiler;
+	
+	/** Optional input recording, see setInputRecording() */
+	InputRecording* input_recording;
+	
 	/** For checking for interaction with the widget: the last QTime where
 	 *  a mouse release event happened. Check for current_pressed_buttons == 0
 	 *  and a last_mouse_release_time a given time interval in the past to check
@@ -0,0 +1,166 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "memory_usage.h"
+
+#include <QLocale>
+#include <QStringList>
+
+#include "map.h"
+#include "map_part.h"
+#include "map_widget.h"
+#include "object.h"
+#include "symbol.h"
+#include "template.h"
+#include "undo_manager.h"
+
+
+namespace
+{
+	/** Returns the category of the renderables of objects with the given symbol. */
+	MemoryUsage::Category renderablesCategory(const Symbol* symbol)
+	{
+		switch (symbol ? symbol->getType() : Symbol::NoSymbol)
+		{
+		case Symbol::Point:
+			return MemoryUsage::PointRenderables;
+		case Symbol::Line:
+			return MemoryUsage::LineRenderables;
+		case Symbol::Area:
+			return MemoryUsage::AreaRenderables;
+		case Symbol::Text:
+			return MemoryUsage::TextRenderables;
+		default:
+			return MemoryUsage::CombinedRenderables;
+		}
+	}
+}
+
+
+
+MemoryUsage::MemoryUsage()
+ : reclaimed_bytes(0)
+ , num_objects(0)
+{
+	for (auto& value : category_bytes)
+		value = 0;
+}
+
+MemoryUsage MemoryUsage::measure(const Map& map, const MapWidget* widget)
+{
+	MemoryUsage result;
+	
+	for (int i = 0; i < map.getNumParts(); ++i)
+	{
+		// Measuring must not trigger the loading of deferred objects.
+		const MapPart* part = map.getPart(i);
+		if (!part->isLoaded())
+			continue;
+		
+		for (int j = 0; j < part->getNumObjects(); ++j)
+		{
+			const Object* object = part->getObject(j);
+			result.category_bytes[ObjectCoords] += object->coordsMemoryUsage();
+			result.category_bytes[PathCoords] += object->derivedCoordsMemoryUsage();
+			result.category_bytes[renderablesCategory(object->getSymbol())] += object->renderablesMemoryUsage();
+		}
+		result.num_objects += part->getNumObjects();
+	}
+	
+	result.reclaimed_bytes = map.getReclaimedRenderablesMemory();
+	
+	result.category_bytes[UndoSteps] = map.undoManager().undoMemoryUsage();
+	result.category_bytes[RedoSteps] = map.undoManager().redoMemoryUsage();
+	
+	for (int i = 0; i < map.getNumTemplates(); ++i)
+		result.category_bytes[TemplateImages] += map.getTemplate(i)->memoryUsage();
+	
+	if (widget)
+		result.category_bytes[WidgetCaches] = widget->cacheMemoryUsage();
+	
+	return result;
+}
+
+qint64 MemoryUsage::total() const
+{
+	qint64 result = 0;
+	for (auto value : category_bytes)
+		result += value;
+	return result;
+}
+
+QString MemoryUsage::label(MemoryUsage::Category category)
+{
+	switch (category)
+	{
+	case ObjectCoords:
+		return tr("Object coordinates");
+	case PathCoords:
+		return tr("Path coordinates");
+	case PointRenderables:
+		return tr("Renderables of point symbols");
+	case LineRenderables:
+		return tr("Renderables of line symbols");
+	case AreaRenderables:
+		return tr("Renderables of area symbols");
+	case TextRenderables:
+		return tr("Renderables of text symbols");
+	case CombinedRenderables:
+		return tr("Renderables of combined symbols");
+	case UndoSteps:
+		return tr("Undo steps");
+	case RedoSteps:
+		return tr("Redo steps");
+	case TemplateImages:
+		return tr("Templates");
+	case WidgetCaches:
+		return tr("Map widget caches");
+	case NumCategories:
+		; // nothing
+	}
+	Q_UNREACHABLE();
+}
+
+QString MemoryUsage::formatBytes(qint64 bytes)
+{
+	const QLocale locale;
+	if (bytes < (qint64(1) << 10))
+		return tr("%1 B").arg(locale.toString(bytes));
+	if (bytes < (qint64(1) << 20))
+		return tr("%1 KiB").arg(locale.toString(bytes / 1024.0, 'f', 1));
+	if (bytes < (qint64(1) << 30))
+		return tr("%1 MiB").arg(locale.toString(bytes / 1048576.0, 'f', 1));
+	return tr("%1 GiB").arg(locale.toString(bytes / 1073741824.0, 'f', 2));
+}
+
+QString MemoryUsage::toText() const
+{
+	// The bytes are printed unformatted, so that the output can be processed by scripts.
+	QStringList lines;
+	for (int i = 0; i < NumCategories; ++i)
+	{
+		const Category category = Category(i);
+		lines << QString::fromLatin1("%1 %2").arg(label(category) + QLatin1Char(':'), -36).arg(bytes(category), 14);
+	}
+	lines << QString::fromLatin1("%1 %2").arg(tr("Total") + QLatin1Char(':'), -36).arg(total(), 14);
+	lines << QString::fromLatin1("%1 %2").arg(tr("Objects") + QLatin1Char(':'), -36).arg(num_objects, 14);
+	lines << QString::fromLatin1("%1 %2").arg(tr("Reclaimed renderables") + QLatin1Char(':'), -36).arg(reclaimed_bytes, 14);
+	return lines.join(QLatin1Char('\n'));
+}
@@ -0,0 +1,135 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef _OPENORIENTEERING_MEMORY_USAGE_H_
+#define _OPENORIENTEERING_MEMORY_USAGE_H_
+
+#include <QCoreApplication>
+#include <QString>
+
+class Map;
+class MapWidget;
+
+
+/**
+ * @brief MemoryUsage accounts for the memory which is used by a map, by subsystem.
+ * 
+ * The figures are estimates from the sizes of the containers and images which
+ * belong to the map's objects, undo steps and templates, and to the caches of
+ * a map widget. Allocator overhead and memory which is shared between maps
+ * (e.g. symbols and fonts) is not included. So the figures are meant for
+ * comparing subsystems and for tuning memory limits, rather than for
+ * predicting the total memory of the process.
+ * 
+ * Measuring visits all objects of the map. It is meant to be done on request,
+ * not continuously.
+ */
+class MemoryUsage
+{
+	Q_DECLARE_TR_FUNCTIONS(MemoryUsage)
+	
+public:
+	/** The subsystems for which memory is accounted. */
+	enum Category
+	{
+		ObjectCoords,
+		PathCoords,
+		PointRenderables,
+		LineRenderables,
+		AreaRenderables,
+		TextRenderables,
+		CombinedRenderables,
+		UndoSteps,
+		RedoSteps,
+		TemplateImages,
+		WidgetCaches,
+		NumCategories  ///< Not a category, but the number of categories
+	};
+	
+	/** Constructs an empty account. */
+	MemoryUsage();
+	
+	/**
+	 * Measures the memory used by the given map.
+	 * 
+	 * If the widget is not null, the memory used by its caches is included.
+	 * Map parts whose loading was deferred and is still pending are skipped.
+	 */
+	static MemoryUsage measure(const Map& map, const MapWidget* widget = nullptr);
+	
+	/** Returns the memory used by the given category, in bytes. */
+	qint64 bytes(Category category) const;
+	
+	/** Returns the sum of all categories, in bytes. */
+	qint64 total() const;
+	
+	/** Returns the number of objects which were measured. */
+	int numObjects() const;
+	
+	/**
+	 * Returns the memory which was released by the compaction of the
+	 * renderables, in bytes, cf. Map::compactRenderables().
+	 * 
+	 * This memory is no longer used, so it is not included in the total.
+	 */
+	qint64 reclaimedBytes() const;
+	
+	/** Returns the translated name of the given category. */
+	static QString label(Category category);
+	
+	/** Returns a human-readable representation of the given number of bytes. */
+	static QString formatBytes(qint64 bytes);
+	
+	/**
+	 * Returns a plain text table of all categories and the total,
+	 * one per line, for logging and for the command line.
+	 */
+	QString toText() const;
+	
+private:
+	qint64 category_bytes[NumCategories];
+	qint64 reclaimed_bytes;
+	int num_objects;
+};
+
+
+
+// ### MemoryUsage inline code ###
+
+inline
+qint64 MemoryUsage::bytes(MemoryUsage::Category category) const
+{
+	return category_bytes[category];
+}
+
+inline
+int MemoryUsage::numObjects() const
+{
+	return num_objects;
+}
+
+inline
+qint64 MemoryUsage::reclaimedBytes() const
+{
+	return reclaimed_bytes;
+}
+
+#endif
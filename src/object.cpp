@@ -33,6 +33,8 @@
 
 #include <private/qbezier_p.h>
 
+#include "core/task_pool.h"
+#include "core/tracing.h"
 #include "util.h"
 #include "file_import_export.h"
 #include "symbol.h"
@@ -65,15 +67,56 @@ namespace literal
 
 
 
+namespace
+{
+	/** The minimum number of objects for which ObjectLoadQueue uses worker threads. */
+	const std::size_t min_concurrent_load_size = 1000;
+	
+	/** Registers objects with irregular coordinates in their map. */
+	void markIfIrregular(Object* object)
+	{
+		const MapCoordVector& coords = object->getRawCoordinateVector();
+		if (object->getMap() &&
+		    ( coords.empty()
+		      || !coords.front().isRegular()
+		      || !coords.back().isRegular() ) )
+		{
+			object->getMap()->markAsIrregular(object);
+		}
+	}
+	
+	/**
+	 * Returns the index of the last coordinate of the part which starts at
+	 * part_start, like PathCoordVector::update(), but without calculating
+	 * path coords.
+	 */
+	MapCoordVector::size_type partEndIndex(const MapCoordVector& coords, MapCoordVector::size_type part_start)
+	{
+		auto part_end = coords.size() - 1;
+		for (auto index = part_start + 1; index <= part_end; ++index)
+		{
+			if (coords[index-1].isCurveStart())
+				index += 2;
+			if (index < part_end && coords[index].isHolePoint())
+				part_end = index;
+		}
+		return part_end;
+	}
+}
+
+
+
 // ### Object implementation ###
 
 Object::Object(Object::Type type, const Symbol* symbol)
 : type(type),
   symbol(symbol),
   map(nullptr),
+  local_changes_only(false),
   output_dirty(true),
   extent(),
-  output(*this)
+  output(*this),
+  output_options(Symbol::RenderNormal)
 {
 	// nothing
 }
@@ -83,9 +126,25 @@ Object::Object(Object::Type type, const Symbol* symbol, const MapCoordVector& co
    symbol(symbol),
    coords(coords),
    map(map),
+   local_changes_only(false),
    output_dirty(true),
    extent(),
-   output(*this)
+   output(*this),
+   output_options(Symbol::RenderNormal)
+{
+	// nothing
+}
+
+Object::Object(Object::Type type, const Symbol* symbol, MapCoordVector&& coords, Map* map)
+ : type(type),
+   symbol(symbol),
+   coords(std::move(coords)),
+   map(map),
+   local_changes_only(false),
+   output_dirty(true),
+   extent(),
+   output(*this),
+   output_options(Symbol::RenderNormal)
 {
 	// nothing
 }
@@ -96,9 +155,11 @@ Object::Object(const Object& proto)
  , coords(proto.coords)
  , map(nullptr)
  , object_tags(proto.object_tags)
+ , local_changes_only(false)
  , output_dirty(true)
  , extent(proto.extent)
  , output(*this)
+ , output_options(Symbol::RenderNormal)
 {
 	// nothing
 }
@@ -111,11 +172,19 @@ Object::~Object()
 Object& Object::operator=(const Object& other)
 {
 	Q_ASSERT(type == other.type);
+	const Symbol* old_symbol = symbol;
 	symbol = other.symbol;
 	coords = other.coords;
 	// map unchanged!
 	object_tags = other.object_tags;
-	output_dirty = true;
+	if (map)
+	{
+		map->internTags(object_tags);
+		map->invalidateObjectIndex();
+		if (symbol != old_symbol)
+			map->updateSymbolIndex(this, old_symbol);
+	}
+	setOutputDirty();
 	extent = other.extent;
 	return *this;
 }
@@ -259,12 +328,11 @@ void Object::load(QIODevice* file, int version, Map* map)
 	coords.clear();
 	coords.reserve(num_coords);
 	
-	LegacyMapCoord coord;
-	for (int i = 0; i < num_coords; ++i)
-	{
-		file->read((char*)&coord, sizeof(LegacyMapCoord));
+	// One read for all coordinates
+	std::vector<LegacyMapCoord> legacy_coords(std::size_t(qMax(0, num_coords)));
+	file->read((char*)legacy_coords.data(), qint64(legacy_coords.size() * sizeof(LegacyMapCoord)));
+	for (const auto& coord : legacy_coords)
 		coords.emplace_back(coord);
-	}
 	
 	if (version <= 8)
 	{
@@ -381,7 +449,7 @@ void Object::save(QXmlStreamWriter& xml) const
 	}
 }
 
-Object* Object::load(QXmlStreamReader& xml, Map* map, const SymbolDictionary& symbol_dict, const Symbol* symbol)
+Object* Object::load(QXmlStreamReader& xml, Map* map, const SymbolDictionary& symbol_dict, const Symbol* symbol, ObjectLoadQueue* queue)
 {
 	Q_ASSERT(xml.name() == literal::object);
 	
@@ -444,13 +512,26 @@ Object* Object::load(QXmlStreamReader& xml, Map* map, const SymbolDictionary& sy
 		text->setVerticalAlignment(object_element.attribute<TextObject::VerticalAlignment>(literal::v_align));
 	}
 	
+	bool queued = false;
 	while (xml.readNextStartElement())
 	{
 		if (xml.name() == literal::coords)
 		{
 			XmlElementReader coords_element(xml);
 			try {
-				coords_element.read(object->coords);
+				if (queue)
+				{
+					const qint64 line = xml.lineNumber();
+					const qint64 column = xml.columnNumber();
+					QString text;
+					queued = coords_element.readText(object->coords, text);
+					if (queued)
+						queue->append(object, text, coords_element.attribute<unsigned int>(literal::count), line, column);
+				}
+				else
+				{
+					coords_element.read(object->coords);
+				}
 			}
 			catch (FileFormatException e)
 			{
@@ -491,25 +572,24 @@ Object* Object::load(QXmlStreamReader& xml, Map* map, const SymbolDictionary& sy
 		else if (xml.name() == literal::tags)
 		{
 			XmlElementReader(xml).read(object->object_tags);
+			if (map)
+				map->internTags(object->object_tags);
 		}
 		else
 			xml.skipCurrentElement(); // unknown
 	}
 	
+	object->output_dirty = true;
+	if (queued)
+		return object; // completed by ObjectLoadQueue::finish()
+	
 	if (object_type == Path)
 	{
 		PathObject* path = reinterpret_cast<PathObject*>(object);
 		path->recalculateParts();
 	}
-	object->output_dirty = true;
 	
-	if (map &&
-	    ( object->coords.empty()
-	      || !object->coords.front().isRegular()
-	      || !object->coords.back().isRegular() ) )
-	{
-		map->markAsIrregular(object);
-	}
+	markIfIrregular(object);
 	
 	return object;
 }
@@ -517,6 +597,7 @@ Object* Object::load(QXmlStreamReader& xml, Map* map, const SymbolDictionary& sy
 void Object::forceUpdate() const
 {
 	output_dirty = true;
+	local_changes_only = false;
 	update();
 }
 
@@ -525,33 +606,92 @@ bool Object::update() const
 	if (!output_dirty)
 		return false;
 	
+	MAPPER_TRACE_SCOPE("object", "Object::update");
+	
 	Symbol::RenderableOptions options = Symbol::RenderNormal;
+	QRectF old_extent;
 	if (map)
 	{
 		options = QFlag(map->renderableOptions());
-		if (extent.isValid())
-			map->setObjectAreaDirty(extent);
+		old_extent = extent;
 	}
 	
-	output.deleteRenderables();
+	updateRenderables(options);
 	
+	if (map)
+	{
+		map->insertRenderablesOfObject(this);
+		map->updateSpatialIndex(this);
+		QRectF affected_extent = old_extent;
+		rectIncludeSafe(affected_extent, extent);
+		map->recordObjectChange(MapChange::ObjectModified, this, nullptr, affected_extent);
+		const QRectF changed_extent = changedExtent();
+		if (changed_extent.isValid())
+		{
+			map->setObjectAreaDirty(changed_extent);
+		}
+		else
+		{
+			if (old_extent.isValid())
+				map->setObjectAreaDirty(old_extent);
+			if (extent.isValid())
+				map->setObjectAreaDirty(extent);
+		}
+	}
+	
+	return true;
+}
+
+void Object::updateRenderables(Symbol::RenderableOptions options) const
+{
+	// The map may still draw the previous renderables. They are replaced
+	// when the map takes the new ones, and released with the last reference.
+	output.takeRenderables();
 	extent = QRectF();
 	
 	updateEvent();
 	
-	createRenderables(output, options);
+	// The normal output is always kept. Baselines are generated in addition.
+	// Area hatching is applied when drawing the normal output, but the
+	// baseline output contains the hatching.
+	output_options = options & ~Symbol::RenderBaselines;
+	createRenderables(output, output_options & ~Symbol::RenderAreasHatched);
+	if (!options.testFlag(Symbol::RenderBaselines))
+	{
+		baseline_output.reset();
+	}
+	else if (baseline_output)
+	{
+		baseline_output->takeRenderables();
+		baseline_extent = QRectF();
+		createRenderables(*baseline_output, output_options | Symbol::RenderBaselines);
+	}
+	else
+	{
+		baselineRenderables();
+	}
 	
 	Q_ASSERT(extent.right() < 999999);	// assert if bogus values are returned
 	output_dirty = false;
-	
-	if (map)
+	local_changes_only = false;
+}
+
+const ObjectRenderables& Object::renderables() const
+{
+	if (map && map->isBaselineViewEnabled())
+		return baselineRenderables();
+	return output;
+}
+
+const ObjectRenderables& Object::baselineRenderables() const
+{
+	if (!baseline_output)
 	{
-		map->insertRenderablesOfObject(this);
-		if (extent.isValid())
-			map->setObjectAreaDirty(extent);
+		baseline_extent = QRectF();
+		baseline_output.reset(new ObjectRenderables(baseline_extent));
+		createRenderables(*baseline_output, output_options | Symbol::RenderBaselines);
 	}
-	
-	return true;
+	return *baseline_output;
 }
 
 void Object::updateEvent() const
@@ -559,8 +699,26 @@ void Object::updateEvent() const
 	// nothing here
 }
 
+QRectF Object::changedExtent() const
+{
+	return QRectF();
+}
+
+void Object::scheduleUpdate() const
+{
+	Q_ASSERT(map);
+	map->scheduleObjectUpdate(this);
+}
+
+void Object::internTags()
+{
+	Q_ASSERT(map);
+	map->internTags(object_tags);
+}
+
 void Object::createRenderables(ObjectRenderables& output, Symbol::RenderableOptions options) const
 {
+	MAPPER_TRACE_SCOPE("symbol", "Symbol::createRenderables");
 	symbol->createRenderables(this, VirtualCoordVector(coords), output, options);
 }
 
@@ -722,14 +880,46 @@ int Object::isPointOnObject(MapCoordF coord, float tolerance, bool treat_areas_a
 void Object::takeRenderables()
 {
 	output.takeRenderables();
+	baseline_output.reset();
 }
 
 void Object::clearRenderables()
 {
 	output.deleteRenderables();
+	if (baseline_output)
+	{
+		baseline_output->deleteRenderables();
+		baseline_output.reset();
+	}
 	extent = QRectF();
 }
 
+qint64 Object::compactRenderables()
+{
+	qint64 result = output.compact();
+	if (baseline_output)
+		result += baseline_output->compact();
+	return result;
+}
+
+qint64 Object::renderablesMemoryUsage() const
+{
+	qint64 result = output.memoryUsage();
+	if (baseline_output)
+		result += baseline_output->memoryUsage();
+	return result;
+}
+
+qint64 Object::coordsMemoryUsage() const
+{
+	return qint64(coords.capacity() * sizeof(MapCoord));
+}
+
+qint64 Object::derivedCoordsMemoryUsage() const
+{
+	return 0;
+}
+
 bool Object::setSymbol(const Symbol* new_symbol, bool no_checks)
 {
 	if (!no_checks && new_symbol)
@@ -738,7 +928,13 @@ bool Object::setSymbol(const Symbol* new_symbol, bool no_checks)
 			return false;
 	}
 	
+	const Symbol* old_symbol = symbol;
 	symbol = new_symbol;
+	if (map && symbol != old_symbol)
+	{
+		map->invalidateObjectIndex();
+		map->updateSymbolIndex(this, old_symbol);
+	}
 	setOutputDirty();
 	return true;
 }
@@ -765,6 +961,8 @@ void Object::setTags(const Object::Tags& tags)
 		object_tags = tags;
 		if (map)
 		{
+			map->internTags(object_tags);
+			map->invalidateObjectIndex();
 			map->setObjectsDirty();
 			if (map->isObjectSelected(this))
 				map->emitSelectionEdited();
@@ -776,13 +974,18 @@ void Object::setTag(const QString& key, const QString& value)
 {
 	if (!object_tags.contains(key) || object_tags.value(key) != value)
 	{
-		object_tags.insert(key, value);
 		if (map)
 		{
+			object_tags.insert(map->internTagString(key), map->internTagString(value));
+			map->invalidateObjectIndex();
 			map->setObjectsDirty();
 			if (map->isObjectSelected(this))
 				map->emitSelectionEdited();
 		}
+		else
+		{
+			object_tags.insert(key, value);
+		}
 	}
 }
 
@@ -792,7 +995,10 @@ void Object::removeTag(const QString& key)
 	{
 		object_tags.remove(key);
 		if (map)
+		{
+			map->invalidateObjectIndex();
 			map->setObjectsDirty();
+		}
 	}
 }
 
@@ -816,6 +1022,69 @@ void Object::includeControlPointsRect(QRectF& rect) const
 }
 
 
+
+// ### ObjectLoadQueue ###
+
+ObjectLoadQueue::ObjectLoadQueue()
+{
+	// nothing
+}
+
+ObjectLoadQueue::~ObjectLoadQueue()
+{
+	// nothing
+}
+
+void ObjectLoadQueue::append(Object* object, const QString& text, unsigned int count, qint64 line, qint64 column)
+{
+	entries.push_back({ object, text, count, line, column, QString() });
+}
+
+void ObjectLoadQueue::process(Entry& entry)
+{
+	Object* object = entry.object;
+	try
+	{
+		XmlElementReader::parseText(entry.text, entry.count, object->coords);
+	}
+	catch (FileFormatException& e)
+	{
+		entry.error = ImportExport::tr("Error while loading an object of type %1 at %2:%3: %4").
+		  arg(object->getType()).arg(entry.line).arg(entry.column).arg(e.message());
+		return;
+	}
+	entry.text = QString();
+	
+	if (object->getType() == Object::Path)
+		object->asPath()->recalculateParts();
+}
+
+void ObjectLoadQueue::finish()
+{
+	if (entries.size() < min_concurrent_load_size || TaskPool::maxThreads() < 2)
+	{
+		for (Entry& entry : entries)
+			process(entry);
+	}
+	else
+	{
+		TaskPool::forEach(int(entries.size()), 16, [this](int i) {
+			process(entries[i]);
+		});
+	}
+	
+	std::vector<Entry> processed;
+	processed.swap(entries);
+	for (Entry& entry : processed)
+	{
+		if (!entry.error.isEmpty())
+			throw FileFormatException(entry.error);
+		// Map is not thread-safe.
+		markIfIrregular(entry.object);
+	}
+}
+
+
 // ### PathPart ###
 
 /* 
@@ -833,6 +1102,7 @@ PathPart::PathPart(PathObject& path, const VirtualPath& proto)
 	{
 		path_coords.reserve(proto.path_coords.size());
 		path_coords.insert(end(path_coords), begin(proto.path_coords), end(proto.path_coords));
+		path_coords.doubled_area = proto.path_coords.doubled_area;
 	}
 }
 
@@ -916,6 +1186,39 @@ void PathPart::reverse()
 	path->setOutputDirty();
 }
 
+void PathPart::copyRange(
+        PathCoord::length_type start_len,
+        PathCoord::length_type end_len,
+        MapCoordVector& out_coords) const
+{
+	if (end_len == 0.0)
+		end_len = path_coords.back().clen;
+	
+	auto part_begin = SplitPathCoord::begin(path_coords);
+	auto part_end   = SplitPathCoord::end(path_coords);
+	auto start      = SplitPathCoord::at(start_len, part_begin);
+	
+	if (end_len <= start_len)
+	{
+		// Make sure part_end has the right curve end points for start.
+		part_end = SplitPathCoord::at(part_end.clen, start);
+		copy(start, part_end, out_coords);
+		out_coords.back().setHolePoint(false);
+		out_coords.back().setClosePoint(false);
+		
+		auto end = SplitPathCoord::at(end_len, part_begin);
+		copy(part_begin, end, out_coords);
+	}
+	else
+	{
+		auto end = SplitPathCoord::at(end_len, start);
+		copy(start, end, out_coords);
+	}
+	
+	out_coords.back().setHolePoint(true);
+	out_coords.back().setClosePoint(false);
+}
+
 PathPartVector PathPart::calculatePathParts(const VirtualCoordVector& coords)
 {
 	PathPartVector parts;
@@ -927,6 +1230,7 @@ PathPartVector PathPart::calculatePathParts(const VirtualCoordVector& coords)
 		auto part_end = path_coords.update(part_start);
 		parts.emplace_back(coords, part_start, part_end);
 		parts.back().path_coords.swap(path_coords);
+		parts.back().path_coords.doubled_area = path_coords.doubled_area;
 		part_start = part_end + 1;
 	}
 	return parts;
@@ -950,6 +1254,9 @@ PathObject::PathObject(const Symbol* symbol)
  : Object(Object::Path, symbol)
  , pattern_rotation(0.0)
  , pattern_origin(0, 0)
+ , dirty_first(0)
+ , dirty_last(0)
+ , path_coords_dirty(false)
 {
 	Q_ASSERT(!symbol || (symbol->getType() == Symbol::Line || symbol->getType() == Symbol::Area || symbol->getType() == Symbol::Combined));
 }
@@ -958,6 +1265,21 @@ PathObject::PathObject(const Symbol* symbol, const MapCoordVector& coords, Map*
  : Object(Object::Path, symbol, coords, map)
  , pattern_rotation(0.0)
  , pattern_origin(0, 0)
+ , dirty_first(0)
+ , dirty_last(0)
+ , path_coords_dirty(false)
+{
+	Q_ASSERT(!symbol || (symbol->getType() == Symbol::Line || symbol->getType() == Symbol::Area || symbol->getType() == Symbol::Combined));
+	recalculateParts();
+}
+
+PathObject::PathObject(const Symbol* symbol, MapCoordVector&& coords, Map* map)
+ : Object(Object::Path, symbol, std::move(coords), map)
+ , pattern_rotation(0.0)
+ , pattern_origin(0, 0)
+ , dirty_first(0)
+ , dirty_last(0)
+ , path_coords_dirty(false)
 {
 	Q_ASSERT(!symbol || (symbol->getType() == Symbol::Line || symbol->getType() == Symbol::Area || symbol->getType() == Symbol::Combined));
 	recalculateParts();
@@ -967,6 +1289,9 @@ PathObject::PathObject(const Symbol* symbol, const PathObject& proto, MapCoordVe
  : Object { Object::Path, symbol }
  , pattern_rotation { 0.0f }
  , pattern_origin { 0, 0 }
+ , dirty_first { 0 }
+ , dirty_last { 0 }
+ , path_coords_dirty { false }
 {
 	auto begin = proto.coords.begin() + piece;
 	auto part  = proto.findPartForIndex(piece);
@@ -994,6 +1319,9 @@ PathObject::PathObject(const PathObject& proto)
  : Object(proto)
  , pattern_rotation(proto.pattern_rotation)
  , pattern_origin(proto.pattern_origin)
+ , dirty_first(0)
+ , dirty_last(0)
+ , path_coords_dirty(proto.path_coords_dirty)
 {
 	path_parts.reserve(proto.path_parts.size());
 	for (const PathPart& part : proto.path_parts)
@@ -1006,6 +1334,9 @@ PathObject::PathObject(const PathPart &proto_part)
  : Object(*proto_part.path)
  , pattern_rotation(proto_part.path->pattern_rotation)
  , pattern_origin(proto_part.path->pattern_origin)
+ , dirty_first(0)
+ , dirty_last(0)
+ , path_coords_dirty(proto_part.path->path_coords_dirty)
 {
 	auto begin = proto_part.path->coords.begin();
 	coords.reserve(proto_part.size());
@@ -1036,6 +1367,7 @@ Object& PathObject::operator=(const Object& other)
 	{
 		path_parts.emplace_back(*this, part);
 	}
+	path_coords_dirty = other_path.path_coords_dirty;
 	return *this;
 }
 
@@ -1075,6 +1407,8 @@ void PathObject::normalize()
 
 bool PathObject::intersectsBox(QRectF box) const
 {
+	ensurePathCoords();
+	
 	// Check path parts for an intersection with box
 	if (std::any_of(begin(path_parts), end(path_parts), [&box](const PathPart& part) { return part.intersectsBox(box); }))
 	{
@@ -1114,6 +1448,7 @@ PathPartVector::size_type PathObject::findPartIndexForIndex(MapCoordVector::size
 
 PathCoord PathObject::findPathCoordForIndex(MapCoordVector::size_type index) const
 {
+	ensurePathCoords();
 	auto part = findPartForIndex(index);
 	if (part != end(path_parts))
 	{
@@ -1179,6 +1514,7 @@ void PathObject::calcClosestPointOnPath(
         MapCoordVector::size_type end_index) const
 {
 	update();
+	ensurePathCoords();
 	
 	auto bound = std::numeric_limits<float>::max();
 	for (const auto& part : path_parts)
@@ -1490,39 +1826,14 @@ void PathObject::changePathBounds(
         PathCoord::length_type end_len)
 {
 	update();
+	ensurePathCoords();
 	
 	PathPart& part = path_parts[part_index];
 	auto part_size = part.size();
 
 	MapCoordVector out_coords;
 	out_coords.reserve(part_size + 2);
-	
-	if (end_len == 0.0)
-		end_len = part.path_coords.back().clen;
-	
-	auto part_begin = SplitPathCoord::begin(part.path_coords);
-	auto part_end   = SplitPathCoord::end(part.path_coords);
-	auto start      = SplitPathCoord::at(start_len, part_begin);
-	
-	if (end_len <= start_len)
-	{
-		// Make sure part_end has the right curve end points for start.
-		part_end = SplitPathCoord::at(part_end.clen, start);
-		part.copy(start, part_end, out_coords);
-		out_coords.back().setHolePoint(false);
-		out_coords.back().setClosePoint(false);
-		
-		auto end = SplitPathCoord::at(end_len, part_begin);
-		part.copy(part_begin, end, out_coords);
-	}
-	else
-	{
-		auto end = SplitPathCoord::at(end_len, start);
-		part.copy(start, end, out_coords);
-	}
-	
-	out_coords.back().setHolePoint(true);
-	out_coords.back().setClosePoint(false);
+	part.copyRange(start_len, end_len, out_coords);
 	
 	const auto copy_size  = qMin(out_coords.size(), (MapCoordVector::size_type)part_size);
 	const auto part_start = begin(coords) + part.first_index;
@@ -2414,15 +2725,23 @@ int PathObject::isPointOnPath(MapCoordF coord, float tolerance, bool treat_areas
 	if ((contained_types & Symbol::Line || treat_areas_as_paths) && tolerance > 0)
 	{
 		update();
+		ensurePathCoords();
+		
+		// Only segments within the tolerance can match.
+		auto max_tolerance = qMax(tolerance, side_tolerance);
+		auto box_test = [coord, max_tolerance](const QRectF& segment_box)
+		{
+			return segment_box.adjusted(-max_tolerance, -max_tolerance, max_tolerance, max_tolerance).contains(coord);
+		};
+		
 		for (const auto& part : path_parts)
 		{
 			const auto& path_coords = part.path_coords;
-			auto size = path_coords.size();
-			for (PathCoordVector::size_type i = 0; i < size - 1; ++i)
+			auto on_segment = [this, &path_coords, coord, tolerance, side_tolerance](PathCoordVector::size_type i)
 			{
 				Q_ASSERT(path_coords[i].index < coords.size());
 				if (coords[path_coords[i].index].isHolePoint())
-					continue;
+					return false;
 				
 				MapCoordF to_coord = coord - path_coords[i].pos;
 				MapCoordF to_next = path_coords[i+1].pos - path_coords[i].pos;
@@ -2431,24 +2750,25 @@ int PathObject::isPointOnPath(MapCoordF coord, float tolerance, bool treat_areas
 				
 				float dist_along_line = MapCoordF::dotProduct(to_coord, tangent);
 				if (dist_along_line < -tolerance)
-					continue;
+					return false;
 				else if (dist_along_line < 0 && to_coord.lengthSquared() <= tolerance*tolerance)
-					return Symbol::Line;
+					return true;
 				
 				float line_length = path_coords[i+1].clen - path_coords[i].clen;
 				if (line_length < 1e-7)
-					continue;
+					return false;
 				if (dist_along_line > line_length + tolerance)
-					continue;
+					return false;
 				else if (dist_along_line > line_length && coord.distanceSquaredTo(path_coords[i+1].pos) <= tolerance*tolerance)
-					return Symbol::Line;
+					return true;
 				
 				auto right = tangent.perpRight();
 				
 				float dist_from_line = qAbs(MapCoordF::dotProduct(right, to_coord));
-				if (dist_from_line <= side_tolerance)
-					return Symbol::Line;
-			}
+				return dist_from_line <= side_tolerance;
+			};
+			if (path_coords.visitSegments(box_test, on_segment))
+				return Symbol::Line;
 		}
 	}
 	
@@ -2465,6 +2785,7 @@ int PathObject::isPointOnPath(MapCoordF coord, float tolerance, bool treat_areas
 bool PathObject::isPointInsideArea(MapCoordF coord) const
 {
 	update();
+	ensurePathCoords();
 	bool inside = false;
 	for (const auto& part : path_parts)
 	{
@@ -2482,6 +2803,8 @@ double PathObject::calcMaximumDistanceTo(
         MapCoordVector::size_type other_end_index) const
 {
 	update();
+	ensurePathCoords();
+	other->ensurePathCoords();
 	
 	Q_ASSERT(other_start_index == 0);
 	Q_ASSERT(other_end_index == other->coords.size()-1);
@@ -2560,6 +2883,8 @@ void PathObject::calcAllIntersectionsWith(const PathObject* other, PathObject::I
 {
 	update();
 	other->update();
+	ensurePathCoords();
+	other->ensurePathCoords();
 	
 	const double epsilon = 1e-10;
 	const double zero_minus_epsilon = 0 - epsilon;
@@ -2827,14 +3152,44 @@ void PathObject::setCoordinate(MapCoordVector::size_type pos, MapCoord c)
 {
 	Q_ASSERT(pos < getCoordinateCount());
 	
-	const PathPart& part = *findPartForIndex(pos);
+	// The const version doesn't mark the output dirty.
+	const PathObject* const_this = this;
+	const PathPart& part = *const_this->findPartForIndex(pos);
 	if (part.isClosed() && pos == part.last_index)
 		pos = part.first_index;
+	const bool same_flags = coords[pos].flags() == c.flags();
 	coords[pos] = c;
 	if (part.isClosed() && pos == part.first_index)
 		setClosingPoint(part.last_index, c);
 	
+	if (!same_flags)
+		setOutputDirty();
+	else if (part.isClosed() && pos == part.first_index)
+		setCoordinatesDirty(part.first_index, part.last_index);
+	else
+		setCoordinatesDirty(pos, pos);
+}
+
+void PathObject::setCoordinatesDirty(MapCoordVector::size_type first, MapCoordVector::size_type last)
+{
+	Q_ASSERT(first <= last);
+	Q_ASSERT(last < coords.size());
+	
+	// Local changes can only be combined with other local changes.
+	const bool local = !isOutputDirty() || local_changes_only;
+	if (!isOutputDirty())
+	{
+		dirty_first = first;
+		dirty_last  = last;
+	}
+	else if (local)
+	{
+		dirty_first = qMin(dirty_first, first);
+		dirty_last  = qMax(dirty_last, last);
+	}
+	
 	setOutputDirty();
+	local_changes_only = local;
 }
 
 void PathObject::addCoordinate(MapCoordVector::size_type pos, MapCoord c)
@@ -3077,6 +3432,45 @@ void PathObject::assignCoordinates(const PathObject& proto, MapCoordVector::size
 }
 
 void PathObject::updatePathCoords() const
+{
+	changed_extent = QRectF();
+	if (local_changes_only && !path_coords_dirty)
+	{
+		// Consumed here: another call must not miss the old positions.
+		local_changes_only = false;
+		auto part = std::lower_bound(begin(path_parts), end(path_parts), dirty_first, PathPartVector::compareEndIndex);
+		if (part != end(path_parts) && dirty_last <= part->last_index)
+		{
+			auto box = part->path_coords.updateLocally(dirty_first, dirty_last);
+			if (symbol && symbol->hasLocalPathOutput())
+			{
+				// Miter joins may extend up to twice the line width.
+				auto margin = 4 * symbol->calculateLargestLineExtent(map);
+				changed_extent = box.adjusted(-margin, -margin, margin, margin);
+			}
+			return;
+		}
+	}
+	local_changes_only = false;
+	
+	if (symbol && !symbol->needsPathCoords())
+	{
+		// Only the part indices are needed now.
+		auto part_start = MapCoordVector::size_type { 0 };
+		for (auto& part : path_parts)
+		{
+			part.first_index = part_start;
+			part.last_index  = partEndIndex(coords, part_start);
+			part_start = part.last_index+1;
+		}
+		path_coords_dirty = true;
+		return;
+	}
+	
+	updateAllPathCoords();
+}
+
+void PathObject::updateAllPathCoords() const
 {
 	auto part_start = MapCoordVector::size_type { 0 };
 	for (auto& part : path_parts)
@@ -3085,6 +3479,7 @@ void PathObject::updatePathCoords() const
 		part.last_index  = part.path_coords.update(part_start);
 		part_start = part.last_index+1;
 	}
+	path_coords_dirty = false;
 }
 
 void PathObject::recalculateParts()
@@ -3130,9 +3525,25 @@ void PathObject::updateEvent() const
 
 void PathObject::createRenderables(ObjectRenderables& output, Symbol::RenderableOptions options) const
 {
+	MAPPER_TRACE_SCOPE("symbol", "Symbol::createRenderables");
+	if (options != Symbol::RenderNormal)
+		ensurePathCoords();  // for baselines and hatching
 	symbol->createRenderables(this, path_parts, output, options);
 }
 
+QRectF PathObject::changedExtent() const
+{
+	return changed_extent;
+}
+
+qint64 PathObject::derivedCoordsMemoryUsage() const
+{
+	qint64 result = qint64(path_parts.capacity() * sizeof(PathPart));
+	for (const auto& part : path_parts)
+		result += part.path_coords.memoryUsage();
+	return result;
+}
+
 
 // ### PointObject ###
 
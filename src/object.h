@@ -23,6 +23,7 @@
 #define _OPENORIENTEERING_OBJECT_H_
 
 #include <limits>
+#include <memory>
 #include <vector>
 
 #include <QRectF>
@@ -42,6 +43,7 @@ class QXmlStreamWriter;
 QT_END_NAMESPACE
 
 class Map;
+class ObjectLoadQueue;
 class PointObject;
 class PathObject;
 class TextObject;
@@ -62,6 +64,8 @@ class Object
 friend class ObjectRenderables;
 friend class OCAD8FileImport;
 friend class XMLImportExport;
+friend class ObjectLoadQueue;
+friend class PackedCoordinates;
 public:
 	/** Enumeration of possible object types. */
 	enum Type
@@ -91,6 +95,9 @@ public:
 	/** Creates an empty object with the given type, symbol, coords and (optional) map. */
 	explicit Object(Type type, const Symbol* symbol, const MapCoordVector& coords, Map* map = nullptr);
 	
+	/** Creates an object with the given type, symbol and (optional) map, taking the given coords. */
+	explicit Object(Type type, const Symbol* symbol, MapCoordVector&& coords, Map* map = nullptr);
+	
 	/**
 	 * Constructs a Object, initialized from the given prototype.
 	 * 
@@ -148,8 +155,11 @@ public:
 	 * @param symbol_dict A dictionary mapping symbol IDs to symbol pointers.
 	 * @param symbol If set, this symbol will be assigned to the object, rather
 	 *               than reading the symbol from the stream.
+	 * @param queue If set, the parsing of the coordinates may be left to this
+	 *              queue. Then the object must not be used before
+	 *              ObjectLoadQueue::finish() was called.
 	 */
-	static Object* load(QXmlStreamReader& xml, Map* map, const SymbolDictionary& symbol_dict, const Symbol* symbol = nullptr);
+	static Object* load(QXmlStreamReader& xml, Map* map, const SymbolDictionary& symbol_dict, const Symbol* symbol = nullptr, ObjectLoadQueue* queue = nullptr);
 	
 	
 	/**
@@ -164,6 +174,16 @@ public:
 	 */
 	void forceUpdate() const;
 	
+	/**
+	 * Regenerates output and extent, without updating the object's map.
+	 * 
+	 * This is the part of update() which does not touch shared data, so it
+	 * may run concurrently for different objects whose symbols contain no
+	 * text. The caller is responsible for updating the map's renderables
+	 * and spatial index afterwards.
+	 */
+	void updateRenderables(Symbol::RenderableOptions options) const;
+	
 	
 	/** Moves the whole object
 	 * @param dx X offset in native map coordinates.
@@ -212,9 +232,49 @@ public:
 	/** Deletes the renderables (and extent), undoing update() */
 	void clearRenderables();
 	
-	/** Returns the renderables, read-only */
+	/**
+	 * Releases memory which is occupied by unused containers of renderables,
+	 * cf. ObjectRenderables::compact().
+	 * 
+	 * Returns the approximate number of bytes which were released.
+	 */
+	qint64 compactRenderables();
+	
+	/**
+	 * Returns the renderables for the map's current view, read-only.
+	 * 
+	 * In baseline view, these are the baseline renderables.
+	 */
 	const ObjectRenderables& renderables() const;
 	
+	/**
+	 * Returns the baseline renderables, read-only.
+	 * 
+	 * The baseline renderables are kept alongside the normal renderables.
+	 * They are generated on demand and discarded when the object's output
+	 * is regenerated. Their extent is not included in the object's extent.
+	 */
+	const ObjectRenderables& baselineRenderables() const;
+	
+	/**
+	 * Returns the approximate amount of memory used by the renderables,
+	 * including the baseline renderables, in bytes.
+	 */
+	qint64 renderablesMemoryUsage() const;
+	
+	/**
+	 * Returns the memory allocated for the coordinates, in bytes.
+	 */
+	qint64 coordsMemoryUsage() const;
+	
+	/**
+	 * Returns the memory allocated for coordinates which are derived from
+	 * the object's coordinates, such as the path coords, in bytes.
+	 * 
+	 * The default implementation returns 0.
+	 */
+	virtual qint64 derivedCoordsMemoryUsage() const;
+	
 	// Getters / Setters
 	
 	/**
@@ -223,7 +283,12 @@ public:
 	 */
 	const MapCoordVector& getRawCoordinateVector() const;
 	
-	/** Sets the object output's dirty state. */
+	/**
+	 * Sets the object output's dirty state.
+	 * 
+	 * When the output becomes dirty, the object is scheduled for update in
+	 * its map (if set).
+	 */
 	void setOutputDirty(bool dirty = true);
 	/** Returns if the object's output must be regenerated. */
 	bool isOutputDirty() const;
@@ -285,16 +350,95 @@ protected:
 	
 	virtual void createRenderables(ObjectRenderables& output, Symbol::RenderableOptions options) const;
 	
+	/**
+	 * Returns the area which was affected by the last update, or an invalid
+	 * rect if the whole old and new extent must be regarded as changed.
+	 * 
+	 * The default implementation returns an invalid rect.
+	 */
+	virtual QRectF changedExtent() const;
+	
+	/** Schedules this object for update in the map. Requires a map. */
+	void scheduleUpdate() const;
+	
+	/** Shares the tag strings with equal strings in the map. Requires a map. */
+	void internTags();
+	
 	Type type;
 	const Symbol* symbol;
 	MapCoordVector coords;
 	Map* map;
 	Tags object_tags;
 	
+	/**
+	 * True while all pending changes are tracked by the subclass for a local
+	 * update, cf. PathObject::setCoordinatesDirty().
+	 * 
+	 * setOutputDirty() resets this flag.
+	 */
+	mutable bool local_changes_only;
+	
 private:
 	mutable bool output_dirty;        // does the output have to be re-generated because of changes?
 	mutable QRectF extent;            // only valid after calling update()
 	mutable ObjectRenderables output; // only valid after calling update()
+	mutable Symbol::RenderableOptions output_options;
+	mutable QRectF baseline_extent;
+	mutable std::unique_ptr<ObjectRenderables> baseline_output; // generated on demand
+};
+
+
+
+/**
+ * A queue of objects whose loading is completed concurrently.
+ * 
+ * Object::load() may copy the text of an object's coordinates to the queue
+ * instead of parsing it. finish() parses the coordinates of all queued
+ * objects on multiple threads, and completes their loading. The XML stream
+ * is not needed for this step. The objects keep their order.
+ */
+class ObjectLoadQueue
+{
+public:
+	/** Constructs an empty queue. */
+	ObjectLoadQueue();
+	
+	/** Destructor. Does not delete the queued objects. */
+	~ObjectLoadQueue();
+	
+	ObjectLoadQueue(const ObjectLoadQueue&) = delete;
+	ObjectLoadQueue& operator=(const ObjectLoadQueue&) = delete;
+	
+	/**
+	 * Appends an object and the text of its coordinates.
+	 * 
+	 * Line and column refer to the coords element, for error messages.
+	 */
+	void append(Object* object, const QString& text, unsigned int count, qint64 line, qint64 column);
+	
+	/**
+	 * Parses the coordinates of all queued objects, completes their loading,
+	 * and clears the queue.
+	 * 
+	 * Throws a FileFormatException for the first object which fails.
+	 */
+	void finish();
+	
+private:
+	struct Entry
+	{
+		Object* object;
+		QString text;
+		unsigned int count;
+		qint64 line;
+		qint64 column;
+		QString error;
+	};
+	
+	/** Completes the loading of a single object, recording any error in the entry. */
+	static void process(Entry& entry);
+	
+	std::vector<Entry> entries;
 };
 
 
@@ -360,6 +504,24 @@ public:
 	 */
 	void reverse();
 	
+	/**
+	 * Appends the coordinates of the range from start_len to end_len to
+	 * out_coords.
+	 * 
+	 * If end_len is not greater than start_len, the range continues from the
+	 * end of the part at its beginning. An end_len of zero stands for the
+	 * end of the part. The last appended coordinate is a hole point.
+	 * 
+	 * The ends of the range are found by binary search on the path coords,
+	 * so the cost depends on the size of the range, not on the size of the
+	 * part. The path coords must be up to date.
+	 */
+	void copyRange(
+	        PathCoord::length_type start_len,
+	        PathCoord::length_type end_len,
+	        MapCoordVector& out_coords
+	) const;
+	
 	static PathPartVector calculatePathParts(const VirtualCoordVector& coords);
 };
 
@@ -449,6 +611,9 @@ public:
 	/** Constructs a PathObject, assigning initial coords and optionally the map pointer. */
 	PathObject(const Symbol* symbol, const MapCoordVector& coords, Map* map = nullptr);
 	
+	/** Constructs a PathObject, taking the initial coords and optionally the map pointer. */
+	PathObject(const Symbol* symbol, MapCoordVector&& coords, Map* map = nullptr);
+	
 	/** Constructs a PathObject, assigning initial coords from a single piece of a line. */
 	PathObject(const Symbol* symbol, const PathObject& proto, MapCoordVector::size_type piece);
 	
@@ -488,9 +653,26 @@ public:
 	/** Returns the i-th coordinate. */
 	MapCoord& getCoordinate(MapCoordVector::size_type pos);
 	
-	/** Replaces the i-th coordinate with c. */
+	/**
+	 * Replaces the i-th coordinate with c.
+	 * 
+	 * If the flags are unchanged, this is a local edit as described for
+	 * setCoordinatesDirty().
+	 */
 	void setCoordinate(MapCoordVector::size_type pos, MapCoord c);
 	
+	/**
+	 * Marks the output as dirty after the coordinates from first to last
+	 * were moved, without changing any flags or the number of coordinates.
+	 * 
+	 * Unless there are other modifications before the next update, this
+	 * update recalculates only the path coords of the segments adjacent to
+	 * the range. For symbols with local output, cf.
+	 * Symbol::hasLocalPathOutput(), only the area of these segments is
+	 * marked as dirty in the map. The renderables are always regenerated.
+	 */
+	void setCoordinatesDirty(MapCoordVector::size_type first, MapCoordVector::size_type last);
+	
 	/** Adds the coordinate at the given index. */
 	void addCoordinate(MapCoordVector::size_type pos, MapCoord c);
 	
@@ -560,16 +742,25 @@ public:
 	
 	/**
 	 * Returns the vector of path parts.
+	 * 
+	 * The path coords of the parts are calculated if needed.
 	 */
 	const PathPartVector& parts() const;
 	
 	/**
 	 * Returns the vector of path parts.
 	 * 
+	 * The path coords of the parts are calculated if needed.
 	 * Marks the output as dirty.
 	 */
 	PathPartVector& parts();
 	
+	/**
+	 * Returns the memory allocated for the path parts and their path coords,
+	 * in bytes.
+	 */
+	qint64 derivedCoordsMemoryUsage() const override;
+	
 	/**
 	 * Deletes the i-th path part.
 	 */
@@ -795,9 +986,23 @@ public:
 	 */
 	void calcAllIntersectionsWith(const PathObject* other, Intersections& out) const;
 	
-	/** Called by Object::update() */
+	/**
+	 * Called by Object::update().
+	 * 
+	 * When the symbol does not need the path coords for its renderables,
+	 * only the part indices are updated, and the path coords are left for
+	 * ensurePathCoords().
+	 */
 	void updatePathCoords() const;
 	
+	/**
+	 * Calculates the path coords if the last update left them out.
+	 * 
+	 * This is done implicitly by parts() and by the functions which
+	 * measure or search the path.
+	 */
+	void ensurePathCoords() const;
+	
 	/** Called by Object::load() */
 	void recalculateParts();
 	
@@ -877,7 +1082,14 @@ protected:
 	
 	void createRenderables(ObjectRenderables& output, Symbol::RenderableOptions options) const override;
 	
+	QRectF changedExtent() const override;
+	
 private:
+	/**
+	 * Calculates the path coords of all parts and clears path_coords_dirty.
+	 */
+	void updateAllPathCoords() const;
+	
 	/**
 	 * Rotation angle of the object pattern. Only used if the object
 	 * has a symbol which interprets this value.
@@ -892,6 +1104,16 @@ private:
 	
 	/** Path parts list */
 	mutable PathPartVector path_parts;
+	
+	/** The range of coordinates given to setCoordinatesDirty(). */
+	MapCoordVector::size_type dirty_first;
+	MapCoordVector::size_type dirty_last;
+	
+	/** The area affected by the last local update, or an invalid rect. */
+	mutable QRectF changed_extent;
+	
+	/** True when the path coords of the parts are not up to date. */
+	mutable bool path_coords_dirty;
 };
 
 
@@ -995,11 +1217,6 @@ Object::Type Object::getType() const
 	return type;
 }
 
-inline
-const ObjectRenderables& Object::renderables() const
-{
-	return output;
-}
 
 inline
 const MapCoordVector& Object::getRawCoordinateVector() const
@@ -1010,7 +1227,10 @@ const MapCoordVector& Object::getRawCoordinateVector() const
 inline
 void Object::setOutputDirty(bool dirty)
 {
+	if (dirty && !output_dirty && map)
+		scheduleUpdate();
 	output_dirty = dirty;
+	local_changes_only = false;
 }
 
 inline
@@ -1035,7 +1255,14 @@ inline
 void Object::setMap(Map* map)
 {
 	this->map = map;
-	setOutputDirty();
+	output_dirty = true;
+	local_changes_only = false;
+	if (map)
+	{
+		scheduleUpdate();
+		if (!object_tags.isEmpty())
+			internTags();
+	}
 }
 
 inline
@@ -1118,6 +1345,7 @@ MapCoord& PathObject::getCoordinate(MapCoordVector::size_type pos)
 inline
 const PathPartVector& PathObject::parts() const
 {
+	ensurePathCoords();
 	return path_parts;
 }
 
@@ -1125,9 +1353,17 @@ inline
 PathPartVector& PathObject::parts()
 {
 	setOutputDirty();
+	ensurePathCoords();
 	return path_parts;
 }
 
+inline
+void PathObject::ensurePathCoords() const
+{
+	if (Q_UNLIKELY(path_coords_dirty))
+		updateAllPathCoords();
+}
+
 inline
 float PathObject::getPatternRotation() const
 {
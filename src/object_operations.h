@@ -142,6 +142,18 @@ namespace ObjectOp
 		}
 	};
 	
+	/** Marks the objects' output as dirty, i.e. schedules their update. */
+	struct SetOutputDirty
+	{
+		inline bool operator()(Object* object, MapPart* part, int object_index) const
+		{
+			Q_UNUSED(part);
+			Q_UNUSED(object_index);
+			object->setOutputDirty();
+			return true;
+		}
+	};
+	
 	/**
 	 * Changes the objects' symbols.
 	 * NOTE: Make sure to apply this to correctly fitting objects only!
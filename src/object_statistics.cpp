@@ -0,0 +1,175 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "object_statistics.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "map.h"
+#include "map_part.h"
+#include "object.h"
+#include "symbol.h"
+
+
+namespace
+{
+	/** Orders symbols by number, and symbols with the same number by address. */
+	bool symbolLessThan(const Symbol* a, const Symbol* b)
+	{
+		if (Symbol::compareByNumber(a, b))
+			return true;
+		if (Symbol::compareByNumber(b, a))
+			return false;
+		return std::less<const Symbol*>()(a, b);
+	}
+}
+
+
+
+// ### ObjectStatistics ###
+
+ObjectStatistics::ObjectStatistics()
+{
+	// nothing
+}
+
+void ObjectStatistics::add(const Object* object)
+{
+	const Measures measures = measure(object);
+	add(measures.symbol, measures.length, measures.area);
+}
+
+void ObjectStatistics::add(const Symbol* symbol, double length, double area)
+{
+	auto entry = std::lower_bound(begin(entry_list), end(entry_list), symbol, [](const Entry& entry, const Symbol* symbol) {
+		return symbolLessThan(entry.symbol, symbol);
+	});
+	if (entry == end(entry_list) || entry->symbol != symbol)
+		entry = entry_list.insert(entry, { symbol, 0, 0.0, 0.0 });
+	
+	++entry->count;
+	entry->length += length;
+	entry->area   += area;
+}
+
+// static
+ObjectStatistics ObjectStatistics::collect(const std::vector<const Object*>& objects, const TaskPool::CancellationToken* token)
+{
+	std::vector<Measures> measures(objects.size());
+	TaskPool::forEach(int(objects.size()), 256, [&objects, &measures](int i) {
+		measures[std::size_t(i)] = measure(objects[std::size_t(i)]);
+	}, token);
+	
+	if (token && token->isCancelled())
+		return ObjectStatistics();
+	
+	ObjectStatistics result = sum(measures, token);
+	result.sort();
+	return result;
+}
+
+// static
+ObjectStatistics ObjectStatistics::sum(const std::vector<Measures>& measures, const TaskPool::CancellationToken* token)
+{
+	ObjectStatistics result;
+	auto& entries = result.entry_list;
+	for (std::size_t i = 0; i < measures.size(); ++i)
+	{
+		if (token && i % 4096 == 0 && token->isCancelled())
+			return ObjectStatistics();
+		
+		const Measures& object_measures = measures[i];
+		auto entry = std::lower_bound(begin(entries), end(entries), object_measures.symbol, [](const Entry& entry, const Symbol* symbol) {
+			return std::less<const Symbol*>()(entry.symbol, symbol);
+		});
+		if (entry == end(entries) || entry->symbol != object_measures.symbol)
+			entry = entries.insert(entry, { object_measures.symbol, 0, 0.0, 0.0 });
+		
+		++entry->count;
+		entry->length += object_measures.length;
+		entry->area   += object_measures.area;
+	}
+	return result;
+}
+
+// static
+ObjectStatistics ObjectStatistics::collect(const Map& map, const TaskPool::CancellationToken* token)
+{
+	std::vector<const Object*> objects;
+	for (int p = 0; p < map.getNumParts(); ++p)
+	{
+		const MapPart* part = map.getPart(std::size_t(p));
+		for (int i = 0; i < part->getNumObjects(); ++i)
+			objects.push_back(part->getObject(i));
+	}
+	return collect(objects, token);
+}
+
+void ObjectStatistics::sort()
+{
+	std::sort(begin(entry_list), end(entry_list), [](const Entry& a, const Entry& b) {
+		return symbolLessThan(a.symbol, b.symbol);
+	});
+}
+
+int ObjectStatistics::count() const
+{
+	int result = 0;
+	for (const auto& entry : entry_list)
+		result += entry.count;
+	return result;
+}
+
+// static
+double ObjectStatistics::pathLength(const PathPartVector& parts)
+{
+	double length = 0.0;
+	for (const auto& part : parts)
+		length += part.length();
+	return length;
+}
+
+// static
+double ObjectStatistics::pathArea(const PathPartVector& parts)
+{
+	if (parts.empty())
+		return 0.0;
+	
+	// The first part is the outline, the other parts are holes.
+	double area = parts.front().calculateArea();
+	for (auto part = begin(parts) + 1; part != end(parts); ++part)
+		area -= part->calculateArea();
+	return std::max(0.0, area);
+}
+
+// static
+ObjectStatistics::Measures ObjectStatistics::measure(const Object* object)
+{
+	Measures result = { object->getSymbol(), 0.0, 0.0 };
+	if (object->getType() == Object::Path)
+	{
+		const PathPartVector& parts = static_cast<const PathObject*>(object)->parts();
+		result.length = pathLength(parts);
+		if (object->getSymbol()->getContainedTypes() & Symbol::Area)
+			result.area = pathArea(parts);
+	}
+	return result;
+}
@@ -0,0 +1,153 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_OBJECT_STATISTICS_H_
+#define _OPENORIENTEERING_OBJECT_STATISTICS_H_
+
+#include <vector>
+
+#include "core/task_pool.h"
+
+class Map;
+class Object;
+class PathPartVector;
+class Symbol;
+
+
+/**
+ * @brief ObjectStatistics sums up the number, length and area of objects by symbol.
+ *
+ * The length of a path is the length of all of its parts. The area is
+ * determined for paths whose symbol contains an area: The first part is the
+ * outline, the other parts are holes.
+ *
+ * The measures are taken from the path parts of the objects, which maintain
+ * their length and area when the coordinates change. So the objects must be
+ * up to date, cf. Object::update(). Then the objects are not modified, and
+ * the statistics of a snapshot (cf. Map::snapshot()) may be collected in a
+ * worker thread.
+ *
+ * Synopsis:
+ *
+ * ObjectStatistics statistics;
+ * for (const Object* object : map->selectedObjects())
+ *     statistics.add(object);
+ * for (const auto& entry : statistics.entries())
+ *     show(entry.symbol, entry.count, entry.length, entry.area);
+ */
+class ObjectStatistics
+{
+public:
+	/** The statistics of the objects of a single symbol. */
+	struct Entry
+	{
+		/** The symbol of the objects. */
+		const Symbol* symbol;
+		
+		/** The number of objects. */
+		int count;
+		
+		/** The total length of the paths, in mm. */
+		double length;
+		
+		/** The total area of the paths, in mm². */
+		double area;
+	};
+	
+	/** The measures of a single object. */
+	struct Measures
+	{
+		/** The symbol of the object. */
+		const Symbol* symbol;
+		
+		/** The length of the path, in mm. */
+		double length;
+		
+		/** The area of the path, in mm². */
+		double area;
+	};
+	
+	/** Constructs empty statistics. */
+	ObjectStatistics();
+	
+	/** Adds a single object. */
+	void add(const Object* object);
+	
+	/**
+	 * Collects the statistics of the given objects concurrently.
+	 *
+	 * When the token is cancelled, the collection stops early and the result
+	 * is incomplete.
+	 */
+	static ObjectStatistics collect(const std::vector<const Object*>& objects,
+	                                const TaskPool::CancellationToken* token = nullptr);
+	
+	/**
+	 * Sums up the given measures by symbol.
+	 *
+	 * The symbols are compared by address only, but not accessed. So the
+	 * measures of the objects of a map may be taken in the GUI thread and
+	 * summed up in a worker thread. The entries are not in order until
+	 * sort() is called in the thread which owns the symbols.
+	 *
+	 * When the token is cancelled, the result is empty.
+	 */
+	static ObjectStatistics sum(const std::vector<Measures>& measures,
+	                            const TaskPool::CancellationToken* token = nullptr);
+	
+	/** Collects the statistics of all objects of the given map concurrently. */
+	static ObjectStatistics collect(const Map& map,
+	                                const TaskPool::CancellationToken* token = nullptr);
+	
+	/** Orders the entries by symbol number, cf. sum(). */
+	void sort();
+	
+	/** Returns the entries, sorted by symbol number. */
+	const std::vector<Entry>& entries() const;
+	
+	/** Returns the total number of objects. */
+	int count() const;
+	
+	/** Returns the length of the path parts, in mm. */
+	static double pathLength(const PathPartVector& parts);
+	
+	/** Returns the area enclosed by the path parts, in mm². */
+	static double pathArea(const PathPartVector& parts);
+	
+	/** Returns the measures of the object. It must be up to date. */
+	static Measures measure(const Object* object);
+
+private:
+	/** Adds the given measures to the entry of the symbol. */
+	void add(const Symbol* symbol, double length, double area);
+	
+	std::vector<Entry> entry_list;
+};
+
+
+
+// ### ObjectStatistics inline code ###
+
+inline
+const std::vector<ObjectStatistics::Entry>& ObjectStatistics::entries() const
+{
+	return entry_list;
+}
+
+#endif
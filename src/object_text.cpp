@@ -21,8 +21,11 @@
 
 #include "object_text.h"
 
+#include <algorithm>
+
 #include <qmath.h>
 
+#include "map.h"
 #include "symbol.h"
 #include "symbol_text.h"
 #include "settings.h"
@@ -118,6 +121,9 @@ TextObject::TextObject(const Symbol* symbol)
  , h_align(AlignHCenter)
  , v_align(AlignVCenter)
  , rotation(0.0f)
+ , layout_symbol(nullptr)
+ , layout_generation(0)
+ , layout_delta_y(0.0)
 {
 	Q_ASSERT(!symbol || (symbol->getType() == Symbol::Text));
 	coords.reserve(2);
@@ -131,6 +137,11 @@ TextObject::TextObject(const TextObject& proto)
  , v_align(proto.v_align)
  , rotation(proto.rotation)
  , line_infos(proto.line_infos)
+ , layout_symbol(proto.layout_symbol)
+ , layout_generation(proto.layout_generation)
+ , layout_box(proto.layout_box)
+ , layout_text(proto.layout_text)
+ , layout_delta_y(proto.layout_delta_y)
 {
 	// nothing
 }
@@ -149,6 +160,11 @@ Object& TextObject::operator=(const Object& other)
 	v_align = other_text.v_align;
 	rotation = other_text.rotation;
 	line_infos = other_text.line_infos;
+	layout_symbol = other_text.layout_symbol;
+	layout_generation = other_text.layout_generation;
+	layout_box = other_text.layout_box;
+	layout_text = other_text.layout_text;
+	layout_delta_y = other_text.layout_delta_y;
 	return *this;
 }
 
@@ -157,6 +173,7 @@ void TextObject::setAnchorPosition(qint32 x, qint32 y)
 	coords.resize(1);
 	coords[0].setNativeX(x);
 	coords[0].setNativeY(y);
+	invalidateLineInfos();
 	setOutputDirty();
 }
 
@@ -165,6 +182,7 @@ void TextObject::setAnchorPosition(MapCoordF coord)
 	coords.resize(1);
 	coords[0].setX(coord.x());
 	coords[0].setY(coord.y());
+	invalidateLineInfos();
 	setOutputDirty();
 }
 
@@ -179,6 +197,7 @@ void TextObject::setBox(qint32 mid_x, qint32 mid_y, double width, double height)
 	coords[0].setNativeX(mid_x);
 	coords[0].setNativeY(mid_y);
 	coords[1] = MapCoord(width, height);
+	invalidateLineInfos();
 	setOutputDirty();
 }
 
@@ -238,18 +257,21 @@ void TextObject::setText(const QString& text)
 {
 	this->text = text;
 	this->text.remove(QChar('\r'));
+	// The next layout is an incremental update when nothing else changed.
 	setOutputDirty();
 }
 
 void TextObject::setHorizontalAlignment(TextObject::HorizontalAlignment h_align)
 {
 	this->h_align = h_align;
+	invalidateLineInfos();
 	setOutputDirty();
 }
 
 void TextObject::setVerticalAlignment(TextObject::VerticalAlignment v_align)
 {
 	this->v_align = v_align;
+	invalidateLineInfos();
 	setOutputDirty();
 }
 
@@ -319,7 +341,103 @@ const TextObjectLineInfo& TextObject::findLineInfoForIndex(int index) const
 	return *line_info;
 }
 
+void TextObject::invalidateLineInfos()
+{
+	layout_symbol = nullptr;
+}
+
 void TextObject::prepareLineInfos() const
+{
+	const MapCoord box = hasSingleAnchor() ? MapCoord() : coords[1];
+	const int generation = map ? map->getRenderablesGeneration() : 0;
+	if (symbol == layout_symbol && generation == layout_generation && box == layout_box)
+	{
+		if (text == layout_text)
+			return;
+		
+		// Only the text was changed, e.g. by typing.
+		if (updateChangedLineInfos())
+		{
+			layout_text = text;
+			return;
+		}
+	}
+	
+	double line_y = 0.0;
+	line_infos.clear();
+	layoutLines(0, text.length(), line_y);
+	alignLines();
+	
+	layout_symbol = symbol;
+	layout_generation = generation;
+	layout_box = box;
+	layout_text = text;
+}
+
+bool TextObject::updateChangedLineInfos() const
+{
+	if (line_infos.empty())
+		return false;
+	
+	const QChar line_break('\n');
+	const int old_length = layout_text.length();
+	const int new_length = text.length();
+	const int length_delta = new_length - old_length;
+	
+	// The changed range is between the common prefix and the common suffix.
+	int prefix = 0;
+	const int max_common = qMin(old_length, new_length);
+	while (prefix < max_common && text[prefix] == layout_text[prefix])
+		++prefix;
+	int suffix = 0;
+	while (suffix < max_common - prefix && text[new_length - 1 - suffix] == layout_text[old_length - 1 - suffix])
+		++suffix;
+	
+	// Word wrapping depends on the whole paragraph, but not on other paragraphs.
+	const int paragraph_start = (prefix > 0) ? (layout_text.lastIndexOf(line_break, prefix - 1) + 1) : 0;
+	int old_paragraph_end = layout_text.indexOf(line_break, old_length - suffix);
+	if (old_paragraph_end == -1)
+		old_paragraph_end = old_length;
+	const int new_paragraph_end = old_paragraph_end + length_delta;
+	
+	// The first line of the paragraph, and the first line after it.
+	std::size_t first = 0;
+	while (first < line_infos.size() && line_infos[first].start_index < paragraph_start)
+		++first;
+	std::size_t next = first;
+	while (next < line_infos.size() && line_infos[next].start_index <= old_paragraph_end)
+		++next;
+	if (first == line_infos.size())
+		return false; // Unexpected layout, use the regular way
+	
+	unalignLines();
+	
+	LineInfoContainer following(line_infos.begin() + next, line_infos.end());
+	const double next_y = following.empty() ? 0.0 : following.front().line_y;
+	double line_y = line_infos[first].line_y;
+	line_infos.erase(line_infos.begin() + first, line_infos.end());
+	layoutLines(paragraph_start, new_paragraph_end, line_y);
+	
+	// The following lines keep their layout, shifted by the changes.
+	const double delta_y = line_y - next_y;
+	for (TextObjectLineInfo& line_info : following)
+	{
+		line_info.start_index += length_delta;
+		line_info.end_index += length_delta;
+		line_info.line_y += delta_y;
+		for (TextObjectPartInfo& part_info : line_info.part_infos)
+		{
+			part_info.start_index += length_delta;
+			part_info.end_index += length_delta;
+		}
+	}
+	line_infos.insert(line_infos.end(), following.begin(), following.end());
+	
+	alignLines();
+	return true;
+}
+
+void TextObject::layoutLines(int line_start, int last_index, double& line_y) const
 {
 	const TextSymbol* text_symbol = reinterpret_cast<const TextSymbol*>(symbol);
 	
@@ -327,19 +445,14 @@ void TextObject::prepareLineInfos() const
 	QFontMetricsF metrics = text_symbol->getFontMetrics();
 	double line_spacing = text_symbol->getLineSpacing() * metrics.lineSpacing();
 	double paragraph_spacing = scaling * text_symbol->getParagraphSpacing() + (text_symbol->hasLineBelow() ? (scaling * (text_symbol->getLineBelowDistance() + text_symbol->getLineBelowWidth())) : 0);
-	double ascent = metrics.ascent();
 	
 	bool word_wrap = ! hasSingleAnchor();
 	double box_width  = word_wrap ? (scaling * getBoxWidth())  : 0.0;
-	double box_height = word_wrap ? (scaling * getBoxHeight()) : 0.0;
 	
-	int text_end = text.length();
 	const QChar line_break('\n');
 	const QChar part_break('\t');
 	const QChar word_break(' ');
 	
-	line_infos.clear();
-	
 	// Initialize offsets
 	
 	double line_x = 0.0;
@@ -347,26 +460,27 @@ void TextObject::prepareLineInfos() const
 		line_x -= 0.5 * box_width;
 	else if (h_align == TextObject::AlignRight)
 		line_x += 0.5 * box_width;
-
-	double line_y = 0.0;
-	if (v_align == TextObject::AlignTop || v_align == TextObject::AlignBaseline)
-		line_y += -0.5 * box_height;
-	if (v_align != TextObject::AlignBaseline)
-		line_y += ascent;
+	
+	if (line_start == 0)
+	{
+		double box_height = word_wrap ? (scaling * getBoxHeight()) : 0.0;
+		line_y = 0.0;
+		if (v_align == TextObject::AlignTop || v_align == TextObject::AlignBaseline)
+			line_y += -0.5 * box_height;
+		if (v_align != TextObject::AlignBaseline)
+			line_y += metrics.ascent();
+	}
 	
 	// Determine lines and parts
 	
 	//double next_line_x_offset = 0; // to keep indentation after word wrap in a line with tabs
-	int num_paragraphs = 0;
-	int line_num = 0;
-	int line_start = 0;
-	while (line_start <= text_end) 
+	while (line_start <= last_index) 
 	{
 		// Initialize input line
 		double line_width = 0.0;
 		int line_end = text.indexOf(line_break, line_start);
 		if (line_end == -1)
-			line_end = text_end;
+			line_end = text.length();
 		bool paragraph_end = true;
 		
 		std::vector<TextObjectPartInfo> part_infos;
@@ -387,6 +501,8 @@ void TextObject::prepareLineInfos() const
 				part_x = line_x + text_symbol->getNextTab(part_x - line_x);
 			
 			QString part = text.mid(part_start, part_end - part_start);
+			// Trial parts are measured without the shaped text cache.
+			// Only the final parts are shaped, below.
 			double part_width = metrics.boundingRect(part).width();
 			
 			if (word_wrap)
@@ -421,7 +537,7 @@ void TextObject::prepareLineInfos() const
 				break;
 			
 			// Add the current part
-			part_infos.push_back( { part, part_start, part_end, part_x, metrics.width(part), metrics } );
+			part_infos.push_back( { part, part_start, part_end, part_x, text_symbol->getShapedText(part).width, metrics } );
 			
 			// Advance to next part position
 			part_start = part_end + 1;
@@ -449,21 +565,30 @@ void TextObject::prepareLineInfos() const
 		// Advance to next line
 		line_y += line_spacing;
 		if (paragraph_end)
-		{
 			line_y += paragraph_spacing;
-			num_paragraphs++;
-		}
-		line_num++;
 		line_start = next_line_start;
 	}
-	
+}
+
+void TextObject::alignLines() const
+{
 	// Update the line and part offset for every other alignment than top-left or baseline-left
 	
 	double delta_y = 0.0;
 	if (v_align == TextObject::AlignBottom || v_align == TextObject::AlignVCenter)
 	{
+		const TextSymbol* text_symbol = reinterpret_cast<const TextSymbol*>(symbol);
+		double scaling = text_symbol->calculateInternalScaling();
+		QFontMetricsF metrics = text_symbol->getFontMetrics();
+		double line_spacing = text_symbol->getLineSpacing() * metrics.lineSpacing();
+		double paragraph_spacing = scaling * text_symbol->getParagraphSpacing() + (text_symbol->hasLineBelow() ? (scaling * (text_symbol->getLineBelowDistance() + text_symbol->getLineBelowWidth())) : 0);
+		double box_height = hasSingleAnchor() ? 0.0 : (scaling * getBoxHeight());
+		
 		int num_lines = getNumLines();
-		double height = ascent + (num_lines - 1) * line_spacing + (num_paragraphs - 1) * paragraph_spacing;
+		int num_paragraphs = std::count_if(line_infos.begin(), line_infos.end(), [](const TextObjectLineInfo& line_info) {
+			return line_info.paragraph_end;
+		});
+		double height = metrics.ascent() + (num_lines - 1) * line_spacing + (num_paragraphs - 1) * paragraph_spacing;
 		
 		if (v_align == TextObject::AlignVCenter)
 			delta_y = -0.5 * height;
@@ -473,25 +598,40 @@ void TextObject::prepareLineInfos() const
 	
 	if (delta_y != 0.0 || h_align != TextObject::AlignLeft)
 	{
-		int num_lines = getNumLines();
-		for (int i = 0; i < num_lines; i++)
+		for (TextObjectLineInfo& line_info : line_infos)
 		{
-			TextObjectLineInfo* line_info = &line_infos[i];
-			
 			double delta_x = 0.0;
 			if (h_align == TextObject::AlignHCenter)
-				delta_x = -0.5 * line_info->width;
+				delta_x = -0.5 * line_info.width;
 			else if (h_align == TextObject::AlignRight)
-				delta_x -= line_info->width;
+				delta_x -= line_info.width;
 			
-			line_info->line_x += delta_x;
-			line_info->line_y += delta_y;
+			line_info.line_x += delta_x;
+			line_info.line_y += delta_y;
 			
-			int num_parts = line_info->part_infos.size();
-			for (int j = 0; j < num_parts; j++)
-			{
-				line_info->part_infos.at(j).part_x += delta_x;
-			}
+			for (TextObjectPartInfo& part_info : line_info.part_infos)
+				part_info.part_x += delta_x;
 		}
 	}
+	
+	layout_delta_y = delta_y;
+}
+
+void TextObject::unalignLines() const
+{
+	for (TextObjectLineInfo& line_info : line_infos)
+	{
+		double delta_x = 0.0;
+		if (h_align == TextObject::AlignHCenter)
+			delta_x = -0.5 * line_info.width;
+		else if (h_align == TextObject::AlignRight)
+			delta_x -= line_info.width;
+		
+		line_info.line_x -= delta_x;
+		line_info.line_y -= layout_delta_y;
+		
+		for (TextObjectPartInfo& part_info : line_info.part_infos)
+			part_info.part_x -= delta_x;
+	}
+	layout_delta_y = 0.0;
 }
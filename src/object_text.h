@@ -273,10 +273,44 @@ public:
 	const TextObjectLineInfo& findLineInfoForIndex(int index) const;
 	
 	/** Prepare the text layout information.
+	 * 
+	 * The layout is kept as long as the text, the alignment, the box size
+	 * and the symbol are unchanged, and as long as the map's renderables
+	 * generation is unchanged (cf. Map::getRenderablesGeneration()).
+	 * Thus moving or rotating the object does not repeat the layout.
+	 * 
+	 * When only the text was changed, only the changed paragraphs are laid
+	 * out again. The other lines are kept, so typing stays fast for long
+	 * texts.
 	 */
 	void prepareLineInfos() const;
 	
 private:
+	/** Marks the text layout information as invalid.
+	 */
+	void invalidateLineInfos();
+	
+	/** Updates the layout for the changes from layout_text to text.
+	 * 
+	 * Returns false if the layout must be prepared from scratch.
+	 */
+	bool updateChangedLineInfos() const;
+	
+	/** Appends the layout of the lines from line_start to last_index.
+	 * 
+	 * The lines start at line_y, unless line_start is 0. On return, line_y
+	 * is the position of the next line. The alignment is not applied.
+	 */
+	void layoutLines(int line_start, int last_index, double& line_y) const;
+	
+	/** Applies the alignment to the lines.
+	 */
+	void alignLines() const;
+	
+	/** Reverts alignLines().
+	 */
+	void unalignLines() const;
+	
 	QString text;
 	HorizontalAlignment h_align;
 	VerticalAlignment v_align;
@@ -285,6 +319,17 @@ private:
 	/** Information about the text layout.
 	 */
 	mutable LineInfoContainer line_infos;
+	
+	/** The symbol, map renderables generation and box size of line_infos.
+	 */
+	mutable const Symbol* layout_symbol;
+	mutable int layout_generation;
+	mutable MapCoord layout_box;
+	
+	/** The text of line_infos, and the vertical offset of the alignment.
+	 */
+	mutable QString layout_text;
+	mutable double layout_delta_y;
 };
 
 
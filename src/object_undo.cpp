@@ -93,6 +93,11 @@ void ObjectModifyingUndoStep::getModifiedObjects(int part_index, ObjectSet& out)
 	}
 }
 
+qint64 ObjectModifyingUndoStep::memoryUsage() const
+{
+	return sizeof(ObjectModifyingUndoStep) + qint64(modified_objects.capacity() * sizeof(int));
+}
+
 #ifndef NO_NATIVE_FILE_FORMAT
 
 bool ObjectModifyingUndoStep::load(QIODevice* file, int version)
@@ -226,6 +231,22 @@ void ObjectCreatingUndoStep::getModifiedObjects(int part_index, ObjectSet& out)
 		out.insert(objects.begin(), objects.end());
 }
 
+qint64 ObjectCreatingUndoStep::memoryUsage() const
+{
+	qint64 result = sizeof(ObjectCreatingUndoStep)
+	                + qint64(modified_objects.capacity() * sizeof(int))
+	                + qint64(objects.capacity() * sizeof(Object*))
+	                + qint64(packed_coords.capacity() * sizeof(PackedCoordinates));
+	for (const Object* object : objects)
+	{
+		if (object)
+			result += sizeof(PathObject) + object->coordsMemoryUsage() + object->derivedCoordsMemoryUsage() + object->renderablesMemoryUsage();
+	}
+	for (const PackedCoordinates& packed : packed_coords)
+		result += packed.memoryUsage();
+	return result;
+}
+
 void ObjectCreatingUndoStep::saveImpl(QXmlStreamWriter& xml) const
 {
 	ObjectModifyingUndoStep::saveImpl(xml);
@@ -235,8 +256,13 @@ void ObjectCreatingUndoStep::saveImpl(QXmlStreamWriter& xml) const
 	xml.writeAttribute("count", QString::number(size));
 	for (int i = 0; i < size; ++i)
 	{
+		const bool packed = std::size_t(i) < packed_coords.size() && !packed_coords[i].isEmpty();
+		if (packed)
+			packed_coords[i].restore(objects[i]);
 		objects[i]->setMap(map);	// IMPORTANT: only if the object's map pointer is set it will save its symbol index correctly
 		objects[i]->save(xml);
+		if (packed)
+			packed_coords[i].release(objects[i]);
 	}
 	xml.writeEndElement(/*contained_objects*/);
 }
@@ -302,6 +328,13 @@ ReplaceObjectsUndoStep::~ReplaceObjectsUndoStep()
 		objects.clear();
 }
 
+void ReplaceObjectsUndoStep::addObject(int existing_index, Object* object)
+{
+	ObjectCreatingUndoStep::addObject(existing_index, object);
+	packed_coords.resize(objects.size());
+	packed_coords.back().pack(object);
+}
+
 UndoStep* ReplaceObjectsUndoStep::undo()
 {
 	int const part_index = getPartIndex();
@@ -313,14 +346,32 @@ UndoStep* ReplaceObjectsUndoStep::undo()
 	std::size_t size = objects.size();
 	for (std::size_t i = 0; i < size; ++i)
 	{
-		undo_step->addObject(modified_objects[i], part->getObject(modified_objects[i]));
+		// The replaced object is packed by the new step only after it has
+		// left the map part.
+		Object* replaced = part->getObject(modified_objects[i]);
+		if (i < packed_coords.size())
+			packed_coords[i].restore(objects[i]);
 		part->setObject(objects[i], modified_objects[i], false);
+		undo_step->addObject(modified_objects[i], replaced);
 	}
+	packed_coords.clear();
 	
 	undone = true;
 	return undo_step;
 }
 
+UndoStep* ReplaceObjectsUndoStep::makeRedoStep() const
+{
+	ReplaceObjectsUndoStep* redo_step = new ReplaceObjectsUndoStep(map);
+	redo_step->setPartIndex(getPartIndex());
+	
+	MapPart* part = map->getPart(getPartIndex());
+	for (int index : modified_objects)
+		redo_step->addObject(index, part->getObject(index)->duplicate());
+	
+	return redo_step;
+}
+
 
 
 // ### DeleteObjectsUndoStep ###
@@ -343,20 +394,28 @@ UndoStep* DeleteObjectsUndoStep::undo()
 	AddObjectsUndoStep* undo_step = new AddObjectsUndoStep(map);
 	undo_step->setPartIndex(part_index);
 	
-	// Make sure to delete the objects in the right order so the other objects' indices stay valid
 	std::sort(modified_objects.begin(), modified_objects.end(), std::greater<int>());
 	
 	MapPart* part = map->getPart(part_index);
-	int size = (int)modified_objects.size();
-	for (int i = 0; i < size; ++i)
-	{
-		undo_step->addObject(modified_objects[i], part->getObject(modified_objects[i]));
-		part->deleteObject(modified_objects[i], true);
-	}
+	for (int index : modified_objects)
+		undo_step->addObject(index, part->getObject(index));
+	part->deleteObjects(modified_objects, true);
 	
 	return undo_step;
 }
 
+UndoStep* DeleteObjectsUndoStep::makeRedoStep() const
+{
+	AddObjectsUndoStep* redo_step = new AddObjectsUndoStep(map);
+	redo_step->setPartIndex(getPartIndex());
+	
+	MapPart* part = map->getPart(getPartIndex());
+	for (int index : modified_objects)
+		redo_step->addObject(index, part->getObject(index)->duplicate());
+	
+	return redo_step;
+}
+
 bool DeleteObjectsUndoStep::getModifiedParts(PartSet&) const
 {
 	return false;
@@ -411,21 +470,35 @@ UndoStep* AddObjectsUndoStep::undo()
 	return undo_step;
 }
 
+UndoStep* AddObjectsUndoStep::makeRedoStep() const
+{
+	DeleteObjectsUndoStep* redo_step = new DeleteObjectsUndoStep(map);
+	redo_step->setPartIndex(getPartIndex());
+	for (int index : modified_objects)
+		redo_step->addObject(index);
+	return redo_step;
+}
+
 void AddObjectsUndoStep::removeContainedObjects(bool emit_selection_changed)
 {
 	MapPart* part = map->getPart(getPartIndex());
-	int size = (int)objects.size();
 	bool object_deselected = false;
-	for (int i = 0; i < size; ++i)
+	std::vector<int> positions;
+	positions.reserve(objects.size());
+	for (Object* object : objects)
 	{
-		if (map->isObjectSelected(objects[i]))
+		if (map->isObjectSelected(object))
 		{
-			map->removeObjectFromSelection(objects[i], false);
+			map->removeObjectFromSelection(object, false);
 			object_deselected = true;
 		}
-		part->deleteObject(objects[i], true);
-		map->setObjectsDirty();
+		int index = part->findObjectIndex(object);
+		if (index >= 0)
+			positions.push_back(index);
 	}
+	part->deleteObjects(positions, true);
+	if (!positions.empty())
+		map->setObjectsDirty();
 	if (object_deselected && emit_selection_changed)
 		map->emitSelectionChanged();
 }
@@ -476,6 +549,16 @@ UndoStep* SwitchPartUndoStep::undo()
 	return undo;
 }
 
+UndoStep* SwitchPartUndoStep::makeRedoStep() const
+{
+	// undo() appends the objects to the objects of the target part.
+	std::size_t index = map->getPart(getPartIndex())->getNumObjects();
+	SwitchPartUndoStep* redo_step = new SwitchPartUndoStep(map, getPartIndex(), source_index);
+	for (std::size_t i = 0; i < modified_objects.size(); ++i, ++index)
+		redo_step->addObject(int(index));
+	return redo_step;
+}
+
 #ifndef NO_NATIVE_FILE_FORMAT
 
 // virtual
@@ -556,6 +639,18 @@ UndoStep* SwitchSymbolUndoStep::undo()
 	return undo_step;
 }
 
+UndoStep* SwitchSymbolUndoStep::makeRedoStep() const
+{
+	SwitchSymbolUndoStep* redo_step = new SwitchSymbolUndoStep(map);
+	redo_step->setPartIndex(getPartIndex());
+	
+	MapPart* part = map->getPart(getPartIndex());
+	for (int index : modified_objects)
+		redo_step->addObject(index, part->getObject(index)->getSymbol());
+	
+	return redo_step;
+}
+
 #ifndef NO_NATIVE_FILE_FORMAT
 
 bool SwitchSymbolUndoStep::load(QIODevice* file, int version)
@@ -672,6 +767,15 @@ UndoStep* SwitchDashesUndoStep::undo()
 	return undo_step;
 }
 
+UndoStep* SwitchDashesUndoStep::makeRedoStep() const
+{
+	SwitchDashesUndoStep* redo_step = new SwitchDashesUndoStep(map);
+	redo_step->setPartIndex(getPartIndex());
+	for (int index : modified_objects)
+		redo_step->addObject(index);
+	return redo_step;
+}
+
 
 
 // ### ObjectTagsUndoStep ###
@@ -712,6 +816,15 @@ UndoStep* ObjectTagsUndoStep::undo()
 	return redo_step;
 }
 
+UndoStep* ObjectTagsUndoStep::makeRedoStep() const
+{
+	ObjectTagsUndoStep* redo_step = new ObjectTagsUndoStep(map);
+	redo_step->setPartIndex(getPartIndex());
+	for (ObjectTagsMap::const_iterator it = object_tags_map.begin(), end = object_tags_map.end(); it != end; ++it)
+		redo_step->addObject(it->first);
+	return redo_step;
+}
+
 void ObjectTagsUndoStep::saveImpl(QXmlStreamWriter &xml) const
 {
 	UndoStep::saveImpl(xml);
@@ -26,6 +26,7 @@
 
 #include "object.h"
 #include "symbol.h"
+#include "packed_coordinates.h"
 #include "undo.h"
 
 QT_BEGIN_NAMESPACE
@@ -97,6 +98,11 @@ public:
 	 */
 	virtual void getModifiedObjects(int part_index, ObjectSet& out) const;
 	
+	/**
+	 * Returns the memory used by this step, including the list of objects.
+	 */
+	virtual qint64 memoryUsage() const;
+	
 	
 #ifndef NO_NATIVE_FILE_FORMAT
 	/**
@@ -187,7 +193,7 @@ public:
 	/**
 	 * Adds an object to the undo step with given index.
 	 */
-	void addObject(int existing_index, Object* object);
+	virtual void addObject(int existing_index, Object* object);
 	
 	/**
 	 * Adds an object to the undo step with the index of the existing object.
@@ -199,6 +205,12 @@ public:
 	 */
 	virtual void getModifiedObjects(int, ObjectSet&) const;
 	
+	/**
+	 * Returns the memory used by this step, including the objects and
+	 * the packed coordinates.
+	 */
+	virtual qint64 memoryUsage() const;
+	
 	
 #ifndef NO_NATIVE_FILE_FORMAT
 	/**
@@ -235,6 +247,13 @@ protected:
 	 */
 	std::vector<Object*> objects;
 	
+	/**
+	 * The packed coordinates of the objects, by position in objects.
+	 * 
+	 * The vector is empty if no object was packed.
+	 */
+	std::vector<PackedCoordinates> packed_coords;
+	
 	/**
 	 * A flag indicating whether this step is still valid.
 	 */
@@ -254,8 +273,20 @@ public:
 	
 	virtual ~ReplaceObjectsUndoStep();
 	
+	using ObjectCreatingUndoStep::addObject;
+	
+	/**
+	 * Adds an object to the undo step with given index.
+	 * 
+	 * The object must not be part of the map. Its coordinates are kept as
+	 * PackedCoordinates, sharing unchanged chunks with other undo steps.
+	 */
+	virtual void addObject(int existing_index, Object* object);
+	
 	virtual UndoStep* undo();
 	
+	virtual UndoStep* makeRedoStep() const;
+	
 private:
 	bool undone;
 };
@@ -275,6 +306,8 @@ public:
 	
 	virtual UndoStep* undo();
 	
+	virtual UndoStep* makeRedoStep() const;
+	
 	virtual bool getModifiedParts(PartSet& out) const;
 	
 	virtual void getModifiedObjects(int part_index, ObjectSet& out) const;
@@ -296,6 +329,8 @@ public:
 	
 	virtual UndoStep* undo();
 	
+	virtual UndoStep* makeRedoStep() const;
+	
 	/**
 	 * Removes all contained objects from the map.
 	 * 
@@ -328,6 +363,8 @@ public:
 	
 	virtual UndoStep* undo();
 	
+	virtual UndoStep* makeRedoStep() const;
+	
 #ifndef NO_NATIVE_FILE_FORMAT
 	virtual bool load(QIODevice* file, int version);
 #endif
@@ -360,6 +397,8 @@ public:
 	
 	virtual UndoStep* undo();
 	
+	virtual UndoStep* makeRedoStep() const;
+	
 #ifndef NO_NATIVE_FILE_FORMAT
 	virtual bool load(QIODevice* file, int version);
 #endif
@@ -394,6 +433,8 @@ public:
 	virtual ~SwitchDashesUndoStep();
 	
 	virtual UndoStep* undo();
+	
+	virtual UndoStep* makeRedoStep() const;
 };
 
 
@@ -415,6 +456,8 @@ public:
 	
 	virtual UndoStep* undo();
 	
+	virtual UndoStep* makeRedoStep() const;
+	
 protected:
 	virtual void saveImpl(QXmlStreamWriter& xml) const;
 	
@@ -0,0 +1,179 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "packed_coordinates.h"
+
+#include <QHash>
+
+#include "object.h"
+
+
+namespace
+{
+	/**
+	 * Chunk boundaries are placed after coordinates whose hash has these
+	 * bits cleared, so the average chunk holds 64 coordinates.
+	 */
+	const uint boundary_mask = 63;
+	
+	/** The maximum number of coordinates in a chunk. */
+	const std::size_t max_chunk_size = 1024;
+	
+	/** The number of pool insertions between removals of expired chunks. */
+	const int pool_sweep_interval = 1024;
+	
+	uint hashCoord(const MapCoord& coord)
+	{
+		uint h = uint(coord.nativeX()) * 0x9E3779B1u;
+		h ^= uint(coord.nativeY()) + 0x7F4A7C15u + (h << 6) + (h >> 2);
+		h ^= uint(coord.flags()) + (h << 6) + (h >> 2);
+		return h;
+	}
+	
+	/**
+	 * The chunks which are currently in use, by content hash.
+	 */
+	struct ChunkPool
+	{
+		QHash<uint, std::weak_ptr<const std::vector<MapCoord>>> chunks;
+		int insertions_since_sweep = 0;
+		
+		void sweep()
+		{
+			for (auto it = chunks.begin(); it != chunks.end(); )
+			{
+				if (it->expired())
+					it = chunks.erase(it);
+				else
+					++it;
+			}
+			insertions_since_sweep = 0;
+		}
+	};
+	
+	ChunkPool& chunkPool()
+	{
+		static ChunkPool pool;
+		return pool;
+	}
+}
+
+
+
+// ### PackedCoordinates ###
+
+PackedCoordinates::PackedCoordinates()
+ : num_coords(0)
+{
+	; // nothing
+}
+
+PackedCoordinates::~PackedCoordinates()
+{
+	; // nothing
+}
+
+PackedCoordinates::SharedChunk PackedCoordinates::share(Chunk&& chunk)
+{
+	uint hash = 0;
+	for (const MapCoord& coord : chunk)
+		hash = hash * 31 + hashCoord(coord);
+	
+	ChunkPool& pool = chunkPool();
+	for (auto it = pool.chunks.find(hash); it != pool.chunks.end() && it.key() == hash; ++it)
+	{
+		SharedChunk existing = it->lock();
+		if (existing && *existing == chunk)
+			return existing;
+	}
+	
+	SharedChunk shared = std::make_shared<const Chunk>(std::move(chunk));
+	pool.chunks.insertMulti(hash, shared);
+	if (++pool.insertions_since_sweep >= pool_sweep_interval)
+		pool.sweep();
+	return shared;
+}
+
+void PackedCoordinates::pack(Object* object)
+{
+	clear();
+	
+	// Reading must not detach coordinates which are shared with a duplicate.
+	const MapCoordVector& coords = object->coords;
+	if (coords.size() < min_size)
+		return;
+	
+	Chunk chunk;
+	for (const MapCoord& coord : coords)
+	{
+		chunk.push_back(coord);
+		if ((hashCoord(coord) & boundary_mask) == 0 || chunk.size() >= max_chunk_size)
+		{
+			chunks.push_back(share(std::move(chunk)));
+			chunk = Chunk();
+		}
+	}
+	if (!chunk.empty())
+		chunks.push_back(share(std::move(chunk)));
+	num_coords = coords.size();
+	
+	release(object);
+}
+
+void PackedCoordinates::restore(Object* object) const
+{
+	if (chunks.empty())
+		return;
+	
+	MapCoordVector& coords = object->coords;
+	coords.clear();
+	coords.reserve(num_coords);
+	for (const SharedChunk& chunk : chunks)
+		coords.insert(coords.end(), chunk->begin(), chunk->end());
+	
+	if (object->getType() == Object::Path)
+		object->asPath()->recalculateParts();
+	object->setOutputDirty();
+}
+
+void PackedCoordinates::release(Object* object) const
+{
+	if (chunks.empty())
+		return;
+	
+	MapCoordVector().swap(object->coords);
+	if (object->getType() == Object::Path)
+		object->asPath()->recalculateParts();
+}
+
+void PackedCoordinates::clear()
+{
+	chunks.clear();
+	num_coords = 0;
+}
+
+qint64 PackedCoordinates::memoryUsage() const
+{
+	qint64 result = qint64(chunks.capacity() * sizeof(SharedChunk));
+	for (const SharedChunk& chunk : chunks)
+		result += qint64(chunk->capacity() * sizeof(MapCoord)) / qMax(long(1), chunk.use_count());
+	return result;
+}
@@ -0,0 +1,118 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef _OPENORIENTEERING_PACKED_COORDINATES_H_
+#define _OPENORIENTEERING_PACKED_COORDINATES_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "core/map_coord.h"
+
+class Object;
+
+
+/**
+ * A compact copy of an object's coordinates, for objects which are kept
+ * outside of the map, e.g. in undo steps.
+ * 
+ * The coordinates are split into chunks at positions which depend only on
+ * the local content. Chunks with equal content are shared between all
+ * instances. Successive copies of a large object which differ in only a few
+ * coordinates thus need little additional memory, even when coordinates
+ * were inserted or removed.
+ * 
+ * This class is not thread-safe. It is meant to be used in the GUI thread.
+ */
+class PackedCoordinates
+{
+public:
+	/** The minimum number of coordinates for which packing is worthwhile. */
+	static const std::size_t min_size = 64;
+	
+	/** Constructs an empty object. */
+	PackedCoordinates();
+	
+	/** Destructor. */
+	~PackedCoordinates();
+	
+	/**
+	 * Returns true if no coordinates are packed.
+	 */
+	bool isEmpty() const;
+	
+	/**
+	 * Moves the object's coordinates into this container.
+	 * 
+	 * Does nothing if the object has less than min_size coordinates.
+	 * Otherwise the object is left without coordinates until restore()
+	 * is called.
+	 */
+	void pack(Object* object);
+	
+	/**
+	 * Gives the packed coordinates back to the object.
+	 * 
+	 * The packed coordinates are kept, so that after a call to release(),
+	 * the object can be restored again without packing.
+	 */
+	void restore(Object* object) const;
+	
+	/**
+	 * Removes the object's coordinates again, after restore().
+	 */
+	void release(Object* object) const;
+	
+	/**
+	 * Discards the packed coordinates.
+	 */
+	void clear();
+	
+	/**
+	 * Returns this container's share of the memory used by the packed
+	 * coordinates, in bytes.
+	 * 
+	 * The memory of a shared chunk is split evenly between its users.
+	 */
+	qint64 memoryUsage() const;
+	
+private:
+	typedef std::vector<MapCoord> Chunk;
+	typedef std::shared_ptr<const Chunk> SharedChunk;
+	
+	static SharedChunk share(Chunk&& chunk);
+	
+	std::vector<SharedChunk> chunks;
+	std::size_t num_coords;
+};
+
+
+
+// ### PackedCoordinates inline code ###
+
+inline
+bool PackedCoordinates::isEmpty() const
+{
+	return chunks.empty();
+}
+
+#endif
@@ -19,6 +19,8 @@
 
 #include "advanced_pdf_printer.h"
 
+#include <QPainter>
+
 #include <advanced_pdf_p.h>
 #include <printengine_advanced_pdf_p.h>
 
@@ -48,3 +50,51 @@ QPaintEngine::Type AdvancedPdfPrinter::paintEngineType()
 {
 	return AdvancedPdfEngine::PaintEngineType;
 }
+
+bool AdvancedPdfPrinter::beginForm(QPainter& painter)
+{
+#if QT_VERSION >= 0x050300
+	auto paint_engine = painter.paintEngine();
+	if (!paint_engine || paint_engine->type() != paintEngineType())
+		return false;
+	
+	painter.save();
+	painter.resetTransform();
+	painter.setClipping(false);
+	paint_engine->syncState();
+	static_cast<AdvancedPdfEngine*>(paint_engine)->beginForm();
+	return true;
+#else
+	Q_UNUSED(painter);
+	return false;
+#endif
+}
+
+int AdvancedPdfPrinter::endForm(QPainter& painter, const QRectF& bounding_box)
+{
+	int form = 0;
+#if QT_VERSION >= 0x050300
+	auto paint_engine = painter.paintEngine();
+	Q_ASSERT(paint_engine && paint_engine->type() == paintEngineType());
+	form = static_cast<AdvancedPdfEngine*>(paint_engine)->endForm(bounding_box);
+	painter.restore();
+#else
+	Q_UNUSED(painter);
+	Q_UNUSED(bounding_box);
+#endif
+	return form;
+}
+
+void AdvancedPdfPrinter::drawForm(QPainter& painter, int form, const QTransform& transform)
+{
+#if QT_VERSION >= 0x050300
+	auto paint_engine = painter.paintEngine();
+	Q_ASSERT(paint_engine && paint_engine->type() == paintEngineType());
+	paint_engine->syncState();
+	static_cast<AdvancedPdfEngine*>(paint_engine)->drawForm(form, transform * painter.combinedTransform());
+#else
+	Q_UNUSED(painter);
+	Q_UNUSED(form);
+	Q_UNUSED(transform);
+#endif
+}
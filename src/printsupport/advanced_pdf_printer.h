@@ -25,6 +25,12 @@
 #include <QPaintEngine>
 #include <QPrinter>
 
+QT_BEGIN_NAMESPACE
+class QPainter;
+class QRectF;
+class QTransform;
+QT_END_NAMESPACE
+
 
 class AdvancedPdfPrintEngine;
 
@@ -43,6 +49,31 @@ public:
 	/** Returns the paint engine type which is used for advanced pdf generation. */
 	static QPaintEngine::Type paintEngineType();
 	
+	/**
+	 * Starts recording a form XObject from the painter's drawing operations.
+	 * 
+	 * Forms are drawn once to the PDF file and may be placed many times.
+	 * The painter's state is saved, and its transformation and clipping are
+	 * reset, so that the form is recorded in its own coordinates.
+	 * Returns false if the painter does not draw to an AdvancedPdfPrinter,
+	 * or if forms are not supported by the Qt version.
+	 */
+	static bool beginForm(QPainter& painter);
+	
+	/**
+	 * Finishes the recording started by beginForm() and restores the painter.
+	 * 
+	 * Returns the identifier of the form. Recordings with identical content
+	 * and bounding box share the same form.
+	 */
+	static int endForm(QPainter& painter, const QRectF& bounding_box);
+	
+	/**
+	 * Places a form, mapping its coordinates by the given transformation
+	 * and the painter's current transformation.
+	 */
+	static void drawForm(QPainter& painter, int form, const QTransform& transform);
+	
 private:
 	std::unique_ptr<AdvancedPdfPrintEngine> engine;
 };
@@ -13,6 +13,9 @@ cd $SUBDIR
 patch -p1 < ../patches/producer.diff || exit 1
 patch -p1 < ../patches/devicecmyk.diff || exit 1
 patch -p1 < ../patches/enginetype.diff || exit 1
+patch -p1 < ../patches/formxobject.diff || exit 1
+patch -p1 < ../patches/streaming.diff || exit 1
+patch -p1 < ../patches/fontcache.diff || exit 1
 cd
 
 exit 0
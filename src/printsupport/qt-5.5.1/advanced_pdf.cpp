@@ -24,6 +24,9 @@
  * - Change of the PDF Producer property
  * - Use of DeviceCMYK color space in PDF output
  * - Distinct paint engine type
+ * - Form XObjects for repeated content
+ * - Bounded memory for page content streams
+ * - Font subset cache shared by all documents
  */
 /****************************************************************************
 **
@@ -38,7 +41,9 @@
 
 #include "qplatformdefs.h"
 #include <qdebug.h>
+#include <qcache.h>
 #include <qfile.h>
+#include <qmutex.h>
 #include <qtemporaryfile.h>
 #include <private/qmath_p.h>
 #include <private/qpainter_p.h>
@@ -178,31 +183,36 @@ namespace AdvancedPdf {
         delete dev;
     }
 
+    inline void ByteStream::write(const char *data, qint64 len)
+    {
+        // Check the size while writing, so that the memory used by large
+        // streams is bounded by maxMemorySize().
+        if (handleDirty || (fileBackingEnabled && !fileBackingActive && dev->size() > maxMemorySize()))
+            prepareBuffer();
+        dev->write(data, len);
+    }
+
     ByteStream &ByteStream::operator <<(char chr)
     {
-        if (handleDirty) prepareBuffer();
-        dev->write(&chr, 1);
+        write(&chr, 1);
         return *this;
     }
 
     ByteStream &ByteStream::operator <<(const char *str)
     {
-        if (handleDirty) prepareBuffer();
-        dev->write(str, strlen(str));
+        write(str, strlen(str));
         return *this;
     }
 
     ByteStream &ByteStream::operator <<(const QByteArray &str)
     {
-        if (handleDirty) prepareBuffer();
-        dev->write(str);
+        write(str.constData(), str.size());
         return *this;
     }
 
     ByteStream &ByteStream::operator <<(const ByteStream &src)
     {
         Q_ASSERT(!src.dev->isSequential());
-        if (handleDirty) prepareBuffer();
         // We do play nice here, even though it looks ugly.
         // We save the position and restore it afterwards.
         ByteStream &s = const_cast<ByteStream&>(src);
@@ -210,7 +220,7 @@ namespace AdvancedPdf {
         s.dev->reset();
         while (!s.dev->atEnd()) {
             QByteArray buf = s.dev->read(chunkSize());
-            dev->write(buf);
+            write(buf.constData(), buf.size());
         }
         s.dev->seek(pos);
         return *this;
@@ -1224,6 +1234,53 @@ void AdvancedPdfEngine::setBrush()
 }
 
 
+void AdvancedPdfEngine::beginForm()
+{
+    Q_D(AdvancedPdfEngine);
+    Q_ASSERT(!d->formParentPage);
+
+    // The form is recorded like a page. The graphics state is nested in the
+    // same way, but the clip path is inherited from the place of use.
+    d->formParentPage = d->currentPage;
+    d->currentPage = new AdvancedPdfPage;
+    d->stroker.stream = d->currentPage;
+    *d->currentPage << "q q\n";
+}
+
+int AdvancedPdfEngine::endForm(const QRectF &boundingBox)
+{
+    Q_D(AdvancedPdfEngine);
+    Q_ASSERT(d->formParentPage);
+
+    *d->currentPage << "Q Q\n";
+    AdvancedPdfPage *form = d->currentPage;
+    d->currentPage = d->formParentPage;
+    d->formParentPage = 0;
+    d->stroker.stream = d->currentPage;
+
+    // The page's graphics state was not touched while recording. The painter
+    // state must be restored by the caller.
+    const int object = d->addForm(form, boundingBox);
+    delete form;
+    return object;
+}
+
+void AdvancedPdfEngine::drawForm(int form, const QTransform &matrix)
+{
+    Q_D(AdvancedPdfEngine);
+
+    if (d->clipEnabled && d->allClipped)
+        return;
+
+    // With a simple pen, the current transformation is already applied.
+    const QTransform ctm = d->simplePen ? d->stroker.matrix : QTransform();
+    *d->currentPage << "q\n"
+                    << AdvancedPdf::generateMatrix(matrix * ctm.inverted())
+                    << "/Im" << form << " Do\nQ\n";
+    if (!d->currentPage->images.contains(form))
+        d->currentPage->images.append(form);
+}
+
 bool AdvancedPdfEngine::newPage()
 {
     Q_D(AdvancedPdfEngine);
@@ -1340,6 +1397,7 @@ AdvancedPdfEnginePrivate::AdvancedPdfEnginePrivate()
     resolution = 1200;
     currentObject = 1;
     currentPage = 0;
+    formParentPage = 0;
     stroker.stream = 0;
 
     streampos = 0;
@@ -1391,6 +1449,7 @@ bool AdvancedPdfEngine::begin(QPaintDevice *pdev)
     d->pages.clear();
     d->imageCache.clear();
     d->alphaCache.clear();
+    d->formCache.clear();
 
     setActive(true);
     d->writeHeader();
@@ -1508,11 +1567,67 @@ void AdvancedPdfEnginePrivate::writePageRoot()
 }
 
 
+namespace {
+    // Batch exports of variants of the same map embed the same font subsets
+    // again and again. The subsets are cached for the lifetime of the process.
+    struct CachedFontSubset
+    {
+        QByteArray truetype;
+        QFixed emSquare;
+        QVector<QFixed> widths;
+    };
+
+    QMutex fontSubsetCacheMutex;
+    QCache<QByteArray, CachedFontSubset> fontSubsetCache(32000000);
+
+    QByteArray fontSubsetKey(const QFontSubset *font)
+    {
+        QByteArray key;
+        const QFontEngine::FaceId face_id = font->fontEngine->faceId();
+        if (face_id.filename.isEmpty() && face_id.uuid.isEmpty())
+            return key;
+
+        const QFontDef &fontDef = font->fontEngine->fontDef;
+        QDataStream s(&key, QIODevice::WriteOnly);
+        s << face_id.filename << face_id.uuid << face_id.index
+          << fontDef.pixelSize << int(fontDef.weight) << int(fontDef.styleHint)
+          << font->glyph_indices;
+        return key;
+    }
+
+    // Returns the result of font->toTruetype(), from the cache if possible.
+    QByteArray cachedTruetype(QFontSubset *font)
+    {
+        const QByteArray key = fontSubsetKey(font);
+        if (key.isEmpty())
+            return font->toTruetype();
+
+        {
+            QMutexLocker locker(&fontSubsetCacheMutex);
+            if (const CachedFontSubset *cached = fontSubsetCache.object(key)) {
+                // toTruetype() also provides the data for widthArray().
+                font->emSquare = cached->emSquare;
+                font->widths = cached->widths;
+                return cached->truetype;
+            }
+        }
+
+        CachedFontSubset *subset = new CachedFontSubset;
+        subset->truetype = font->toTruetype();
+        subset->emSquare = font->emSquare;
+        subset->widths = font->widths;
+        const QByteArray truetype = subset->truetype;
+        QMutexLocker locker(&fontSubsetCacheMutex);
+        fontSubsetCache.insert(key, subset, qMax(1, truetype.size()));
+        return truetype;
+    }
+}
+
 void AdvancedPdfEnginePrivate::embedFont(QFontSubset *font)
 {
     //qDebug() << "embedFont" << font->object_id;
     int fontObject = font->object_id;
-    QByteArray fontData = font->toTruetype();
+    QByteArray fontData = cachedTruetype(font);
 #ifdef FONT_DUMP
     static int i = 0;
     QString fileName("font%1.ttf");
@@ -1629,6 +1744,41 @@ void AdvancedPdfEnginePrivate::writeFonts()
     fonts.clear();
 }
 
+void AdvancedPdfEnginePrivate::writeResources(const AdvancedPdfPage *page)
+{
+    xprintf("<<\n"
+            "/ColorSpace <<\n"
+            "/PCSp %d 0 R\n"
+            "/CSp /DeviceCMYK\n"
+            "/CSpg /DeviceGray\n"
+            ">>\n"
+            "/ExtGState <<\n"
+            "/GSa %d 0 R\n",
+            patternColorSpace, graphicsState);
+
+    for (int i = 0; i < page->graphicStates.size(); ++i)
+        xprintf("/GState%d %d 0 R\n", page->graphicStates.at(i), page->graphicStates.at(i));
+    xprintf(">>\n");
+
+    xprintf("/Pattern <<\n");
+    for (int i = 0; i < page->patterns.size(); ++i)
+        xprintf("/Pat%d %d 0 R\n", page->patterns.at(i), page->patterns.at(i));
+    xprintf(">>\n");
+
+    xprintf("/Font <<\n");
+    for (int i = 0; i < page->fonts.size();++i)
+        xprintf("/F%d %d 0 R\n", page->fonts[i], page->fonts[i]);
+    xprintf(">>\n");
+
+    xprintf("/XObject <<\n");
+    for (int i = 0; i<page->images.size(); ++i) {
+        xprintf("/Im%d %d 0 R\n", page->images.at(i), page->images.at(i));
+    }
+    xprintf(">>\n");
+
+    xprintf(">>\n");
+}
+
 void AdvancedPdfEnginePrivate::writePage()
 {
     if (pages.empty())
@@ -1656,38 +1806,8 @@ void AdvancedPdfEnginePrivate::writePage()
             currentPage->pageSize.width(), currentPage->pageSize.height());
 
     addXrefEntry(resources);
-    xprintf("<<\n"
-            "/ColorSpace <<\n"
-            "/PCSp %d 0 R\n"
-            "/CSp /DeviceCMYK\n"
-            "/CSpg /DeviceGray\n"
-            ">>\n"
-            "/ExtGState <<\n"
-            "/GSa %d 0 R\n",
-            patternColorSpace, graphicsState);
-
-    for (int i = 0; i < currentPage->graphicStates.size(); ++i)
-        xprintf("/GState%d %d 0 R\n", currentPage->graphicStates.at(i), currentPage->graphicStates.at(i));
-    xprintf(">>\n");
-
-    xprintf("/Pattern <<\n");
-    for (int i = 0; i < currentPage->patterns.size(); ++i)
-        xprintf("/Pat%d %d 0 R\n", currentPage->patterns.at(i), currentPage->patterns.at(i));
-    xprintf(">>\n");
-
-    xprintf("/Font <<\n");
-    for (int i = 0; i < currentPage->fonts.size();++i)
-        xprintf("/F%d %d 0 R\n", currentPage->fonts[i], currentPage->fonts[i]);
-    xprintf(">>\n");
-
-    xprintf("/XObject <<\n");
-    for (int i = 0; i<currentPage->images.size(); ++i) {
-        xprintf("/Im%d %d 0 R\n", currentPage->images.at(i), currentPage->images.at(i));
-    }
-    xprintf(">>\n");
-
-    xprintf(">>\n"
-            "endobj\n");
+    writeResources(currentPage);
+    xprintf("endobj\n");
 
     addXrefEntry(annots);
     xprintf("[ ");
@@ -1871,16 +1991,11 @@ int AdvancedPdfEnginePrivate::writeCompressed(const char *src, int len)
 {
 #ifndef QT_NO_COMPRESS
     if(do_compress) {
-        uLongf destLen = len + len/100 + 13; // zlib requirement
-        Bytef* dest = new Bytef[destLen];
-        if (Z_OK == ::compress(dest, &destLen, (const Bytef*) src, (uLongf)len)) {
-            stream->writeRawData((const char*)dest, destLen);
-        } else {
-            qWarning("AdvancedPdfStream::writeCompressed: Error in compress()");
-            destLen = 0;
-        }
-        delete [] dest;
-        len = destLen;
+        // Compress in chunks, so that large image data is not duplicated.
+        QByteArray data = QByteArray::fromRawData(src, len);
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        return writeCompressed(&buffer);
     } else
 #endif
     {
@@ -2378,6 +2493,59 @@ static inline bool is_monochrome(const QVector<QRgb> &colorTable)
 /*!
  * Adds an image to the pdf and return the pdf-object id. Returns -1 if adding the image failed.
  */
+int AdvancedPdfEnginePrivate::addForm(AdvancedPdfPage *form, const QRectF &boundingBox)
+{
+    QByteArray content = form->stream()->readAll();
+
+    // Repeated symbols result in identical forms which are written only once.
+    QByteArray key;
+    {
+        AdvancedPdf::ByteStream s(&key);
+        s << boundingBox.left() << boundingBox.top() << boundingBox.right() << boundingBox.bottom();
+        for (int i = 0; i < form->graphicStates.size(); ++i)
+            s << "/GState" << int(form->graphicStates.at(i));
+        for (int i = 0; i < form->patterns.size(); ++i)
+            s << "/Pat" << int(form->patterns.at(i));
+        for (int i = 0; i < form->fonts.size(); ++i)
+            s << "/F" << int(form->fonts.at(i));
+        for (int i = 0; i < form->images.size(); ++i)
+            s << "/Im" << int(form->images.at(i));
+        s << "\n" << content;
+    }
+    QHash<QByteArray, uint>::const_iterator cached = formCache.constFind(key);
+    if (cached != formCache.constEnd())
+        return *cached;
+
+    QByteArray bbox;
+    {
+        AdvancedPdf::ByteStream s(&bbox);
+        s << "/BBox [" << boundingBox.left() << boundingBox.top() << boundingBox.right() << boundingBox.bottom() << "]\n";
+    }
+
+    const int object = addXrefEntry(-1);
+    const int lenobj = requestObject();
+    xprintf("<<\n"
+            "/Type /XObject\n"
+            "/Subtype /Form\n");
+    write(bbox);
+    xprintf("/Resources\n");
+    writeResources(form);
+    xprintf("/Length %d 0 R\n", lenobj);
+    if (do_compress)
+        xprintf("/Filter /FlateDecode\n");
+    xprintf(">>\n"
+            "stream\n");
+    const int len = writeCompressed(content);
+    xprintf("endstream\n"
+            "endobj\n");
+    addXrefEntry(lenobj);
+    xprintf("%d\n"
+            "endobj\n", len);
+
+    formCache.insert(key, object);
+    return object;
+}
+
 int AdvancedPdfEnginePrivate::addImage(const QImage &img, bool *bitmap, qint64 serial_no)
 {
     if (img.isNull())
@@ -22,6 +22,8 @@
  *   - Adjustment of include statements
  *   - Removal of Q_XXX_EXPORT
  *   - Distinct paint engine type
+ * - Form XObjects for repeated content
+ * - Bounded memory for page content streams
  */
 /****************************************************************************
 **
@@ -68,9 +70,9 @@ namespace AdvancedPdf {
     {
     public:
         // fileBacking means that ByteStream will buffer the contents on disk
-        // if the size exceeds a certain threshold. In this case, if a byte
-        // array was passed in, its contents may no longer correspond to the
-        // ByteStream contents.
+        // as soon as the size exceeds a certain threshold. In this case, if a
+        // byte array was passed in, its contents may no longer correspond to
+        // the ByteStream contents.
         explicit ByteStream(bool fileBacking = false);
         explicit ByteStream(QByteArray *ba, bool fileBacking = false);
         ~ByteStream();
@@ -85,8 +87,8 @@ namespace AdvancedPdf {
         QIODevice *stream();
         void clear();
 
-        static inline int maxMemorySize() { return 100000000; }
-        static inline int chunkSize()     { return 10000000; }
+        static inline int maxMemorySize() { return 16000000; }
+        static inline int chunkSize()     { return 1000000; }
 
     protected:
         void constructor_helper(QIODevice *dev);
@@ -94,6 +96,7 @@ namespace AdvancedPdf {
 
     private:
         void prepareBuffer();
+        void write(const char *data, qint64 len);
 
     private:
         QIODevice *dev;
@@ -215,6 +218,11 @@ public:
     void setBrush();
     void setupGraphicsState(QPaintEngine::DirtyFlags flags);
 
+    // Form XObjects for repeated content
+    void beginForm();
+    int endForm(const QRectF &boundingBox);
+    void drawForm(int form, const QTransform &matrix);
+
 private:
     void updateClipPath(const QPainterPath & path, Qt::ClipOperation op);
 };
@@ -232,6 +240,7 @@ public:
     void writeTail();
 
     int addImage(const QImage &image, bool *bitmap, qint64 serial_no);
+    int addForm(AdvancedPdfPage *form, const QRectF &boundingBox);
     int addConstantAlphaObject(int brushAlpha, int penAlpha = 255);
     int addBrushPattern(const QTransform &matrix, bool *specifyColor, int *gStateObject);
 
@@ -244,6 +253,7 @@ public:
     int currentObject;
 
     AdvancedPdfPage* currentPage;
+    AdvancedPdfPage* formParentPage;
     AdvancedPdf::Stroker stroker;
 
     QPointF brushOrigin;
@@ -285,6 +295,7 @@ private:
 
     void writeInfo();
     void writePageRoot();
+    void writeResources(const AdvancedPdfPage *page);
     void writeFonts();
     void embedFont(QFontSubset *font);
 
@@ -313,6 +324,7 @@ private:
     QVector<uint> pages;
     QHash<qint64, uint> imageCache;
     QHash<QPair<uint, uint>, uint > alphaCache;
+    QHash<QByteArray, uint> formCache;
 };
 
 QT_END_NAMESPACE
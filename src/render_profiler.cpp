@@ -0,0 +1,196 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "render_profiler.h"
+
+#include <algorithm>
+
+#include <QFontMetrics>
+#include <QIODevice>
+#include <QPainter>
+#include <QStringList>
+#include <QTextStream>
+
+
+namespace
+{
+	/** The number of recent frames for the averages in the overlay. */
+	const std::size_t average_frames = 30;
+	
+	/** The overlay's margin and padding, in pixels. */
+	const int overlay_margin = 8;
+	
+	QString milliseconds(qint64 nsecs)
+	{
+		return QString::number(nsecs / 1000000.0, 'f', 3);
+	}
+}
+
+
+
+// ### RenderProfiler::PhaseTimer ###
+
+RenderProfiler::PhaseTimer::PhaseTimer(RenderProfiler* profiler, Phase phase)
+ : profiler(profiler)
+ , phase(phase)
+{
+	if (profiler)
+		timer.start();
+}
+
+RenderProfiler::PhaseTimer::~PhaseTimer()
+{
+	if (profiler)
+		profiler->addTime(phase, timer.nsecsElapsed());
+}
+
+
+
+// ### RenderProfiler ###
+
+const std::size_t RenderProfiler::max_frames;
+
+RenderProfiler::RenderProfiler()
+ : in_frame(false)
+{
+	clock.start();
+	RenderStatistics::setEnabled(true);
+}
+
+RenderProfiler::~RenderProfiler()
+{
+	RenderStatistics::setEnabled(false);
+}
+
+void RenderProfiler::beginFrame(const QRect& exposed)
+{
+	current = Frame();
+	current.start = clock.elapsed();
+	current.exposed_size = exposed.size();
+	std::fill(current.phase_time, current.phase_time + NumPhases, 0);
+	frame_timer.start();
+	in_frame = true;
+}
+
+void RenderProfiler::addTime(Phase phase, qint64 nsecs)
+{
+	if (in_frame)
+		current.phase_time[phase] += nsecs;
+}
+
+void RenderProfiler::endFrame()
+{
+	if (!in_frame)
+		return;
+	
+	current.total_time = frame_timer.nsecsElapsed();
+	current.counters = RenderStatistics::take();
+	in_frame = false;
+	
+	if (recorded_frames.size() >= max_frames)
+		recorded_frames.pop_front();
+	recorded_frames.push_back(current);
+}
+
+QRect RenderProfiler::overlayRect(const QRect& widget_rect) const
+{
+	// Sized for the longest lines, independent of the actual values
+	QFontMetrics metrics(QFont{});
+	const int width  = metrics.width(QString(64, QLatin1Char('0'))) + 2 * overlay_margin;
+	const int height = 4 * metrics.lineSpacing() + 2 * overlay_margin;
+	return QRect(widget_rect.topLeft() + QPoint(overlay_margin, overlay_margin), QSize(width, height));
+}
+
+void RenderProfiler::draw(QPainter* painter, const QRect& widget_rect) const
+{
+	if (recorded_frames.empty())
+		return;
+	
+	const Frame& last = recorded_frames.back();
+	const std::size_t num_average = std::min(average_frames, recorded_frames.size());
+	qint64 average_total = 0;
+	for (auto frame = recorded_frames.end() - std::ptrdiff_t(num_average); frame != recorded_frames.end(); ++frame)
+		average_total += frame->total_time;
+	average_total /= qint64(num_average);
+	
+	QStringList phases;
+	for (int i = 0; i < NumPhases; ++i)
+		phases << QString::fromLatin1("%1 %2").arg(QLatin1String(phaseName(Phase(i))), milliseconds(last.phase_time[i]));
+	
+	const QString text = QString::fromLatin1("Frame %1 ms (%2 ms average)\n%3\n%4\nRenderables %5 visited, %6 drawn; objects updated %7")
+	                     .arg(milliseconds(last.total_time), milliseconds(average_total))
+	                     .arg(phases.mid(0, 3).join(QLatin1String(", ")), phases.mid(3).join(QLatin1String(", ")))
+	                     .arg(last.counters.visited_renderables)
+	                     .arg(last.counters.drawn_renderables)
+	                     .arg(last.counters.updated_objects);
+	
+	const QRect rect = overlayRect(widget_rect);
+	painter->save();
+	painter->setFont(QFont{});
+	painter->fillRect(rect, QColor(0, 0, 0, 160));
+	painter->setPen(Qt::white);
+	painter->drawText(rect.adjusted(overlay_margin, overlay_margin, -overlay_margin, -overlay_margin), Qt::AlignLeft | Qt::AlignTop, text);
+	painter->restore();
+}
+
+bool RenderProfiler::writeCsv(QIODevice* device) const
+{
+	QTextStream stream(device);
+	stream << "start_ms,width,height,total_ms";
+	for (int i = 0; i < NumPhases; ++i)
+		stream << ',' << QString::fromLatin1(phaseName(Phase(i))).toLower().replace(QLatin1Char(' '), QLatin1Char('_')) << "_ms";
+	stream << ",visited_renderables,drawn_renderables,updated_objects\n";
+	
+	for (const auto& frame : recorded_frames)
+	{
+		stream << frame.start << ','
+		       << frame.exposed_size.width() << ',' << frame.exposed_size.height() << ','
+		       << milliseconds(frame.total_time);
+		for (int i = 0; i < NumPhases; ++i)
+			stream << ',' << milliseconds(frame.phase_time[i]);
+		stream << ',' << frame.counters.visited_renderables
+		       << ',' << frame.counters.drawn_renderables
+		       << ',' << frame.counters.updated_objects << '\n';
+	}
+	
+	stream.flush();
+	return stream.status() == QTextStream::Ok;
+}
+
+const char* RenderProfiler::phaseName(Phase phase)
+{
+	switch (phase)
+	{
+	case TemplateCache:
+		return "Template cache";
+	case MapCache:
+		return "Map cache";
+	case Overprinting:
+		return "Overprinting";
+	case ToolOverlay:
+		return "Tool overlay";
+	case Blit:
+		return "Blit";
+	case NumPhases:
+		; // nothing
+	}
+	Q_UNREACHABLE();
+	return nullptr;
+}
@@ -0,0 +1,167 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_RENDER_PROFILER_H_
+#define _OPENORIENTEERING_RENDER_PROFILER_H_
+
+#include <deque>
+
+#include <QElapsedTimer>
+#include <QRect>
+
+#include "core/render_statistics.h"
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+class QPainter;
+QT_END_NAMESPACE
+
+
+/**
+ * Measures the time spent in the phases of painting the MapWidget.
+ * 
+ * While a profiler exists, the RenderStatistics are enabled. The profiler
+ * records the phase times and the counters for each frame, keeping the most
+ * recent frames. It draws them as an overlay on the map widget, and it
+ * writes them as a CSV trace.
+ * 
+ * Synopsis:
+ * 
+ * profiler.beginFrame(exposed_rect);
+ * {
+ *     RenderProfiler::PhaseTimer timer(&profiler, RenderProfiler::MapCache);
+ *     ... // Update the map cache.
+ * }
+ * profiler.endFrame();
+ * profiler.draw(&painter, rect());
+ */
+class RenderProfiler
+{
+public:
+	/** The phases of painting the map widget. */
+	enum Phase
+	{
+		TemplateCache = 0,
+		MapCache,
+		Overprinting,
+		ToolOverlay,
+		Blit,
+		NumPhases
+	};
+	
+	/** The measurements of a single frame. */
+	struct Frame
+	{
+		/** The start of the frame, in milliseconds since the start of the profiler. */
+		qint64 start;
+		
+		/** The duration of the whole frame, in nanoseconds. */
+		qint64 total_time;
+		
+		/** The time spent in each phase, in nanoseconds. */
+		qint64 phase_time[NumPhases];
+		
+		/** The size of the painted region. */
+		QSize exposed_size;
+		
+		/** The counters since the previous frame. */
+		RenderStatistics::Counters counters;
+	};
+	
+	/**
+	 * Measures the time between construction and destruction as time
+	 * of the given phase. Does nothing if the profiler is nullptr.
+	 */
+	class PhaseTimer
+	{
+	public:
+		PhaseTimer(RenderProfiler* profiler, Phase phase);
+		~PhaseTimer();
+		
+	private:
+		Q_DISABLE_COPY(PhaseTimer)
+		
+		RenderProfiler* const profiler;
+		const Phase phase;
+		QElapsedTimer timer;
+	};
+	
+	
+	/** The maximum number of recorded frames. */
+	static const std::size_t max_frames = 10000;
+	
+	/** Constructs a profiler, and enables the RenderStatistics. */
+	RenderProfiler();
+	
+	/** Disables the RenderStatistics. */
+	~RenderProfiler();
+	
+	/** Starts measuring a frame which paints the given rect. */
+	void beginFrame(const QRect& exposed);
+	
+	/** Adds time to the given phase of the current frame. */
+	void addTime(Phase phase, qint64 nsecs);
+	
+	/** Finishes the current frame, and records it. */
+	void endFrame();
+	
+	/**
+	 * Returns the area covered by the overlay, for a widget of the given size.
+	 */
+	QRect overlayRect(const QRect& widget_rect) const;
+	
+	/**
+	 * Draws the measurements of the last frame, and averages of recent frames,
+	 * in the top left corner of the given widget rect.
+	 */
+	void draw(QPainter* painter, const QRect& widget_rect) const;
+	
+	/**
+	 * Writes the recorded frames in CSV format, with times in milliseconds.
+	 * 
+	 * Returns false on error.
+	 */
+	bool writeCsv(QIODevice* device) const;
+	
+	/** Returns the recorded frames, oldest first. */
+	const std::deque<Frame>& frames() const;
+	
+	/** Returns the name of the phase, for display and for the trace header. */
+	static const char* phaseName(Phase phase);
+	
+private:
+	QElapsedTimer clock;
+	QElapsedTimer frame_timer;
+	Frame current;
+	bool in_frame;
+	std::deque<Frame> recorded_frames;
+};
+
+
+
+// ### RenderProfiler inline code ###
+
+inline
+const std::deque<RenderProfiler::Frame>& RenderProfiler::frames() const
+{
+	return recorded_frames;
+}
+
+#endif
@@ -20,13 +20,26 @@
 
 #include "renderable.h"
 
+#include <algorithm>
+#include <functional>
+
+#include <QCoreApplication>
 #include <QPainter>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadStorage>
 #include <qmath.h>
 
 #include "core/image_transparency_fixup.h"
 #include "core/map_color.h"
+#include "core/render_statistics.h"
+#include "core/renderable_arena.h"
+#include "core/task_pool.h"
+#include "core/tracing.h"
 #include "map.h"
 #include "object.h"
+#include "renderable_implementation.h"
 #include "symbol.h"
 #include "util.h"
 
@@ -69,6 +82,318 @@ static_assert(false, "This file needs to be modified for correct printing on And
 #endif
 
 
+namespace
+{
+	/** The maximum amount of memory (in bytes) for concurrently drawn separations. */
+	const qint64 max_separations_memory = qint64(256) << 20;
+	
+	/** The minimum number of objects in each concurrently drawn layer. */
+	const std::size_t min_layer_objects = 2000;
+	
+	/** The number of rows and columns of the coverage mask for occlusion culling. */
+	const int occlusion_grid_size = 16;
+	
+	/**
+	 * Returns x / 255, rounded, for x in 0..65535.
+	 */
+	inline
+	unsigned int div255(unsigned int x)
+	{
+		x += 128;
+		return (x + (x >> 8)) >> 8;
+	}
+	
+	/**
+	 * Composes the source over the destination with multiplication.
+	 * 
+	 * This is equivalent to QPainter::CompositionMode_Multiply, but it does
+	 * not suffer from the inaccuracy which ImageTransparencyFixup repairs.
+	 * Both images must be of Format_ARGB32_Premultiplied. The pixel (x, y)
+	 * of dest is composed with the pixel (x, y) + offset of source, so the
+	 * source must cover the rect of dest translated by offset.
+	 * 
+	 * dest must not be the device of an active QPainter.
+	 * 
+	 * All four channels use the same formula,
+	 * result = s * d + s * (1 - d_alpha) + d * (1 - s_alpha),
+	 * so the compiler may vectorize the inner loop.
+	 */
+	void multiply(QImage& dest, const QImage& source, const QPoint& offset)
+	{
+		Q_ASSERT(dest.format() == QImage::Format_ARGB32_Premultiplied);
+		Q_ASSERT(source.format() == QImage::Format_ARGB32_Premultiplied);
+		Q_ASSERT(source.rect().contains(dest.rect().translated(offset)) || dest.isNull());
+		
+		const int width = dest.width();
+		for (int y = 0; y < dest.height(); ++y)
+		{
+			QRgb* d = reinterpret_cast<QRgb*>(dest.scanLine(y));
+			const QRgb* s = reinterpret_cast<const QRgb*>(source.constScanLine(y + offset.y())) + offset.x();
+			for (int x = 0; x < width; ++x)
+			{
+				const QRgb src = s[x];
+				if (src == 0)
+					continue; // Fully transparent source
+				
+				const QRgb dst = d[x];
+				const unsigned int src_inv_alpha = 255 - (src >> 24);
+				const unsigned int dst_inv_alpha = 255 - (dst >> 24);
+				QRgb result = 0;
+				for (int shift = 0; shift < 32; shift += 8)
+				{
+					const unsigned int sc = (src >> shift) & 0xff;
+					const unsigned int dc = (dst >> shift) & 0xff;
+					result |= div255(sc * dc + sc * dst_inv_alpha + dc * src_inv_alpha) << shift;
+				}
+				d[x] = result;
+			}
+		}
+	}
+	
+#if MAPPER_OVERPRINTING_CORRECTION == -1
+	/**
+	 * Reduces the opacity of light pixels, for the Mapper 0.5.0 correction.
+	 * 
+	 * This works on a QImage of Format_ARGB32_Premultiplied, in place.
+	 */
+	void reduceOpacityOfLightPixels(QImage& image)
+	{
+		Q_ASSERT(image.format() == QImage::Format_ARGB32_Premultiplied);
+		
+		const int width = image.width();
+		for (int y = 0; y < image.height(); ++y)
+		{
+			QRgb* px = reinterpret_cast<QRgb*>(image.scanLine(y));
+			for (int x = 0; x < width; ++x)
+			{
+				const unsigned int old_alpha = qAlpha(px[x]);
+				if (old_alpha == 0)
+					continue;
+				const unsigned int red   = (qRed(px[x]) * 255 + old_alpha / 2) / old_alpha;
+				const unsigned int green = (qGreen(px[x]) * 255 + old_alpha / 2) / old_alpha;
+				const unsigned int blue  = (qBlue(px[x]) * 255 + old_alpha / 2) / old_alpha;
+				const unsigned int alpha = (old_alpha * (255 - qGray(red, green, blue))) >> 8;
+				px[x] = qRgba(div255(red * alpha), div255(green * alpha), div255(blue * alpha), alpha);
+			}
+		}
+	}
+#endif
+	
+	/**
+	 * Collects the objects which intersect the bounding box and which are not
+	 * excluded by the symbol settings.
+	 */
+	void findVisible(const ObjectRenderablesMap& renderables, const RenderConfig& config,
+	                 std::vector<ObjectRenderablesMap::const_iterator>& objects)
+	{
+		renderables.findIntersecting(config.bounding_box, objects);
+		auto is_hidden = [&config](ObjectRenderablesMap::const_iterator object) {
+			const Symbol* symbol = object->first->getSymbol();
+			return (!config.testFlag(RenderConfig::HelperSymbols) && symbol->isHelperSymbol())
+			       || symbol->isHidden()
+			       || !object->first->getExtent().intersects(config.bounding_box);
+		};
+		objects.erase(std::remove_if(objects.begin(), objects.end(), is_hidden), objects.end());
+	}
+	
+	/**
+	 * A job which draws a single spot color separation in a worker thread.
+	 */
+	class SeparationJob : public QRunnable
+	{
+	public:
+		SeparationJob(const MapRenderables& renderables, const RenderConfig& config, const MapColor* color,
+		              QPainter::RenderHints hints, const QTransform& transform, QImage& image, QSemaphore& done,
+		              const MapRenderables::VisibleObjects* visible)
+		 : renderables(renderables),
+		   config(config),
+		   color(color),
+		   hints(hints),
+		   transform(transform),
+		   image(image),
+		   done(done),
+		   visible(visible)
+		{ }
+		
+		void run() override
+		{
+			drawSeparation(renderables, config, color, hints, transform, image, visible);
+			done.release();
+		}
+		
+		/**
+		 * Draws the separation of the given color to the image, in color.
+		 */
+		static void drawSeparation(const MapRenderables& renderables, const RenderConfig& config, const MapColor* color,
+		                           QPainter::RenderHints hints, const QTransform& transform, QImage& image,
+		                           const MapRenderables::VisibleObjects* visible)
+		{
+			image.fill(Qt::transparent);
+			QPainter p(&image);
+			p.setRenderHints(hints);
+			p.setWorldTransform(transform, false);
+			renderables.drawColorSeparation(&p, config, color, true, visible);
+			p.end();
+		}
+		
+	private:
+		const MapRenderables& renderables;
+		const RenderConfig& config;
+		const MapColor* const color;
+		const QPainter::RenderHints hints;
+		const QTransform transform;
+		QImage& image;
+		QSemaphore& done;
+		const MapRenderables::VisibleObjects* const visible;
+	};
+	
+	
+	
+	/**
+	 * A coarse grid over a rect, recording the cells which are completely
+	 * covered by opaque fills.
+	 */
+	class CoverageMask
+	{
+	public:
+		CoverageMask(const QRectF& rect, int size)
+		 : rect(rect),
+		   size(size),
+		   cell_width(rect.width() / size),
+		   cell_height(rect.height() / size),
+		   cells(std::size_t(size * size), false),
+		   num_covered(0)
+		{ }
+		
+		/**
+		 * Returns true if the given rect is inside the mask's rect and
+		 * touches only covered cells.
+		 */
+		bool covers(const QRectF& extent) const
+		{
+			if (num_covered == 0 || !rect.contains(extent))
+				return false;
+			
+			const int left   = qBound(0, int((extent.left() - rect.left()) / cell_width), size - 1);
+			const int right  = qBound(0, int((extent.right() - rect.left()) / cell_width), size - 1);
+			const int top    = qBound(0, int((extent.top() - rect.top()) / cell_height), size - 1);
+			const int bottom = qBound(0, int((extent.bottom() - rect.top()) / cell_height), size - 1);
+			for (int y = top; y <= bottom; ++y)
+			{
+				for (int x = left; x <= right; ++x)
+				{
+					if (!cells[std::size_t(y * size + x)])
+						return false;
+				}
+			}
+			return true;
+		}
+		
+		/**
+		 * Marks the cells which are completely inside the given filled path.
+		 * 
+		 * Only cells inside the path's extent are tested.
+		 */
+		void add(const QPainterPath& path, const QRectF& extent)
+		{
+			const int left   = qMax(0, qCeil((extent.left() - rect.left()) / cell_width));
+			const int right  = qMin(size, qFloor((extent.right() - rect.left()) / cell_width));
+			const int top    = qMax(0, qCeil((extent.top() - rect.top()) / cell_height));
+			const int bottom = qMin(size, qFloor((extent.bottom() - rect.top()) / cell_height));
+			for (int y = top; y < bottom; ++y)
+			{
+				for (int x = left; x < right; ++x)
+				{
+					auto cell = cells.begin() + (y * size + x);
+					if (*cell)
+						continue;
+					
+					const QRectF cell_rect(rect.left() + x * cell_width, rect.top() + y * cell_height, cell_width, cell_height);
+					if (path.contains(cell_rect))
+					{
+						*cell = true;
+						++num_covered;
+					}
+				}
+			}
+		}
+		
+	private:
+		const QRectF rect;
+		const int size;
+		const qreal cell_width;
+		const qreal cell_height;
+		std::vector<bool> cells;
+		int num_covered;
+	};
+}
+
+
+
+// ### MapRenderables::LayerJob ###
+
+/**
+ * A job which draws a band of colors into a transparent layer in a worker thread.
+ */
+class MapRenderables::LayerJob : public QRunnable
+{
+public:
+	LayerJob(const MapRenderables& renderables, const RenderConfig& config,
+	         MapRenderables::const_reverse_iterator first, MapRenderables::const_reverse_iterator last,
+	         QPainter::RenderHints hints, const QTransform& transform, const QPainterPath* clip,
+	         const MapRenderables::RenderableSet* occluded, QImage& image, QSemaphore& done)
+	 : renderables(renderables),
+	   config(config),
+	   first(first),
+	   last(last),
+	   hints(hints),
+	   transform(transform),
+	   clip(clip),
+	   occluded(occluded),
+	   image(image),
+	   done(done)
+	{ }
+	
+	void run() override
+	{
+		drawLayer(renderables, config, first, last, hints, transform, clip, occluded, image);
+		done.release();
+	}
+	
+	/**
+	 * Draws the colors from first to last (exclusive) to the image.
+	 * 
+	 * The clip path is given in the coordinates of the transform.
+	 */
+	static void drawLayer(const MapRenderables& renderables, const RenderConfig& config,
+	                      MapRenderables::const_reverse_iterator first, MapRenderables::const_reverse_iterator last,
+	                      QPainter::RenderHints hints, const QTransform& transform, const QPainterPath* clip,
+	                      const MapRenderables::RenderableSet* occluded, QImage& image)
+	{
+		image.fill(Qt::transparent);
+		QPainter p(&image);
+		p.setRenderHints(hints);
+		p.setWorldTransform(transform, false);
+		if (clip)
+			p.setClipPath(*clip);
+		renderables.drawColors(&p, config, nullptr, occluded, first, last);
+		p.end();
+	}
+	
+private:
+	const MapRenderables& renderables;
+	const RenderConfig& config;
+	const MapRenderables::const_reverse_iterator first;
+	const MapRenderables::const_reverse_iterator last;
+	const QPainter::RenderHints hints;
+	const QTransform transform;
+	const QPainterPath* const clip;
+	const MapRenderables::RenderableSet* const occluded;
+	QImage& image;
+	QSemaphore& done;
+};
+
+
 
 // ### Renderable ###
 
@@ -77,6 +402,16 @@ Renderable::~Renderable()
 	; // nothing, not inlined
 }
 
+void* Renderable::operator new(std::size_t size)
+{
+	return RenderableArena::allocate(size);
+}
+
+void Renderable::operator delete(void* p)
+{
+	RenderableArena::deallocate(p);
+}
+
 
 
 // ### SharedRenderables ###
@@ -96,29 +431,46 @@ void SharedRenderables::deleteRenderables()
 		}
 		renderables->second.clear();
 		if (renderables->first.clip_path != NULL)
-		{
-			iterator it = renderables;
-			++renderables;
-			erase(it);
-		}
+			renderables = erase(renderables);
 		else
 			++renderables;
 	}
 }
 
-void SharedRenderables::compact()
+qint64 SharedRenderables::compact()
 {
+	auto const overhead = [this]() -> qint64 {
+		qint64 result = capacity() * sizeof(value_type);
+		for (const auto& config_renderables : *this)
+			result += config_renderables.second.capacity() * sizeof(Renderable*);
+		return result;
+	};
+	
+	qint64 const old_overhead = overhead();
 	for (iterator renderables = begin(); renderables != end(); )
 	{
-		if (renderables->second.size() == 0)
+		if (renderables->second.empty())
 		{
-			iterator it = renderables;
-			++renderables;
-			erase(it);
+			renderables = erase(renderables);
+			continue;
 		}
-		else
-			++renderables;
+		renderables->second.shrink_to_fit();
+		++renderables;
 	}
+	shrink_to_fit();
+	return old_overhead - overhead();
+}
+
+qint64 SharedRenderables::memoryUsage() const
+{
+	qint64 result = sizeof(SharedRenderables) + capacity() * sizeof(value_type);
+	for (const auto& config_renderables : *this)
+	{
+		result += config_renderables.second.capacity() * sizeof(Renderable*);
+		for (const Renderable* renderable : config_renderables.second)
+			result += renderable->memoryUsage();
+	}
+	return result;
 }
 
 
@@ -131,6 +483,13 @@ ObjectRenderables::ObjectRenderables(Object& object)
 	;
 }
 
+ObjectRenderables::ObjectRenderables(QRectF& extent)
+: extent(extent),
+  clip_path(NULL)
+{
+	;
+}
+
 ObjectRenderables::~ObjectRenderables()
 {
 	;
@@ -154,7 +513,7 @@ void ObjectRenderables::draw(const QColor& color, QPainter* painter, const Rende
 			
 			for (Renderable* renderable : config_renderables.second)
 			{
-				if (renderable->intersects(config.bounding_box))
+				if (renderable->intersects(config.bounding_box) && !renderable->isBelowDetailLimit(config))
 				{
 					renderable->render(*painter, config);
 				}
@@ -185,6 +544,28 @@ void ObjectRenderables::insertRenderable(Renderable* r, PainterConfig state)
 	}
 }
 
+bool ObjectRenderables::insertPatternRenderables(const ObjectRenderables& prototype, const QVector<QPointF>& positions, const QVector<qreal>& rotations)
+{
+	for (const auto& color_renderables : prototype)
+	{
+		for (const auto& config_renderables : *color_renderables.second)
+		{
+			if (config_renderables.first.clip_path)
+				return false;
+		}
+	}
+	
+	for (const auto& color_renderables : prototype)
+	{
+		for (const auto& config_renderables : *color_renderables.second)
+		{
+			if (!config_renderables.second.empty())
+				insertRenderable(new PatternRenderable(config_renderables.first, color_renderables.second, positions, rotations, clip_path != nullptr));
+		}
+	}
+	return true;
+}
+
 void ObjectRenderables::clear()
 {
 	for (auto& renderables : *this)
@@ -216,20 +597,289 @@ void ObjectRenderables::deleteRenderables()
 	}
 }
 
+qint64 ObjectRenderables::memoryUsage() const
+{
+	qint64 result = capacity() * sizeof(value_type);
+	for (const auto& color_renderables : *this)
+	{
+		if (color_renderables.second)
+			result += color_renderables.second->memoryUsage();
+	}
+	return result;
+}
+
+qint64 ObjectRenderables::compact()
+{
+	qint64 result = capacity() * sizeof(value_type);
+	for (iterator color = begin(); color != end(); )
+	{
+		SharedRenderables* const renderables = color->second.data();
+		if (renderables)
+		{
+			result += renderables->compact();
+			if (!renderables->empty() || renderables->ref.load() > 1)
+			{
+				++color;
+				continue;
+			}
+			result += renderables->memoryUsage();
+		}
+		color = erase(color);
+	}
+	shrink_to_fit();
+	return result - qint64(capacity() * sizeof(value_type));
+}
+
+int ObjectRenderables::numRenderables() const
+{
+	int result = 0;
+	for (const auto& color_renderables : *this)
+	{
+		if (!color_renderables.second)
+			continue;
+		for (const auto& config_renderables : *color_renderables.second)
+			result += int(config_renderables.second.size());
+	}
+	return result;
+}
+
+
+
+// ### ObjectRenderablesMap ###
+
+void ObjectRenderablesMap::insert(const Object* object, const SharedRenderables::Pointer& renderables)
+{
+	base_type::operator[](object) = renderables;
+	spatial_index.insert(object, object->getExtent());
+}
+
+void ObjectRenderablesMap::erase(iterator pos)
+{
+	spatial_index.remove(pos->first);
+	base_type::erase(pos);
+}
+
+void ObjectRenderablesMap::clear()
+{
+	spatial_index.clear();
+	base_type::clear();
+}
+
+void ObjectRenderablesMap::swap(ObjectRenderablesMap& other)
+{
+	spatial_index.swap(other.spatial_index);
+	base_type::swap(other);
+}
+
+void ObjectRenderablesMap::findIntersecting(const QRectF& rect, std::vector<const_iterator>& out) const
+{
+	std::vector<const Object*> objects;
+	spatial_index.query(rect, objects);
+	std::sort(objects.begin(), objects.end(), std::less<const Object*>());
+	
+	out.reserve(out.size() + objects.size());
+	for (const Object* object : objects)
+	{
+		const_iterator element = find(object);
+		Q_ASSERT(element != end());
+		out.push_back(element);
+	}
+}
+
+bool ObjectRenderablesMap::intersects(const QRectF& rect) const
+{
+	std::vector<const Object*> objects;
+	spatial_index.query(rect, objects);
+	return !objects.empty();
+}
+
 
 
 // ### MapRenderables ###
 
 MapRenderables::MapRenderables(Map* map)
  : map(map)
+ , proof_transform_valid(false)
 {
 	; // nothing
 }
 
-void MapRenderables::draw(QPainter *painter, const RenderConfig &config) const
+void MapRenderables::draw(QPainter *painter, const RenderConfig &config, const ObjectSet* filter) const
+{
+	MAPPER_TRACE_SCOPE("render", "MapRenderables::draw");
+	
+	RenderableSet occluded;
+	if (config.testFlag(RenderConfig::OcclusionCulling))
+		findOccludedRenderables(config, filter, occluded);
+	const RenderableSet* occluded_ptr = occluded.empty() ? nullptr : &occluded;
+	
+	if (!filter && drawConcurrently(painter, config, occluded_ptr))
+		return;
+	
+	drawColors(painter, config, filter, occluded_ptr, rbegin(), rend());
+}
+
+void MapRenderables::findOccludedRenderables(const RenderConfig& config, const ObjectSet* filter, RenderableSet& occluded) const
+{
+	MAPPER_TRACE_SCOPE("render", "MapRenderables::findOccludedRenderables");
+	
+	// Hatched or translucent areas do not occlude anything.
+	if (config.testFlag(RenderConfig::HatchedAreas) || config.opacity < 1.0)
+		return;
+	
+	// Antialiasing and minimum sizes may extend the drawing by a pixel.
+	const qreal margin = (config.scaling > 0) ? 1.0 / config.scaling : 0.0;
+	
+	CoverageMask mask(config.bounding_box, occlusion_grid_size);
+	std::vector<ObjectRenderablesMap::const_iterator> objects;
+	std::vector<const AreaRenderable*> occluders;
+	
+	// From the highest to the lowest priority, i.e. front to back
+	for (const_iterator color = begin(); color != end(); ++color)
+	{
+		if (color->first >= map->getNumColors())
+			continue;
+		
+		if ( config.testFlag(RenderConfig::RequireSpotColor) &&
+		     (color->first < 0 || map->getColor(color->first)->getSpotColorMethod() == MapColor::UndefinedMethod) )
+		{
+			continue;
+		}
+		
+		const MapColor* map_color = map->getColor(color->first);
+		if (!map_color)
+			continue;
+		
+		const bool opaque = color->first >= 0
+		                    && map_color->getOpacity() >= 1.0
+		                    && (map_color->getSpotColorMethod() != MapColor::SpotColor || map_color->getKnockout());
+		
+		objects.clear();
+		color->second.findIntersecting(config.bounding_box, objects);
+		occluders.clear();
+		for (ObjectRenderablesMap::const_iterator object : objects)
+		{
+			if (filter && !filter->count(object->first))
+				continue;
+			
+			const Symbol* symbol = object->first->getSymbol();
+			if (!config.testFlag(RenderConfig::HelperSymbols) && symbol->isHelperSymbol())
+				continue;
+			if (symbol->isHidden())
+				continue;
+			
+			for (const auto& config_renderables : *object->second)
+			{
+				const PainterConfig& state = config_renderables.first;
+				for (Renderable* renderable : config_renderables.second)
+				{
+					if (!renderable->intersects(config.bounding_box) || renderable->isBelowDetailLimit(config))
+						continue;
+					
+					if (mask.covers(renderable->getExtent().adjusted(-margin, -margin, margin, margin)))
+					{
+						occluded.insert(renderable);
+					}
+					else if (opaque && state.mode == PainterConfig::AreaFill && !state.clip_path)
+					{
+						if (auto area = dynamic_cast<const AreaRenderable*>(renderable))
+							occluders.push_back(area);
+					}
+				}
+			}
+		}
+		
+		// The renderables of a single color do not occlude each other.
+		for (const AreaRenderable* area : occluders)
+			mask.add(*area->painterPath(), area->getExtent());
+	}
+}
+
+bool MapRenderables::drawConcurrently(QPainter* painter, const RenderConfig& config, const RenderableSet* occluded) const
 {
-	// TODO: improve performance by using some spatial acceleration structure?
+	// Worker threads are busy with drawing tiles already, and the layers
+	// are composed exactly only under the default composition.
+	const int num_threads = TaskPool::maxThreads();
+	if ( num_threads < 2
+	     || QThread::currentThread() != QCoreApplication::instance()->thread()
+	     || !painter->device()
+	     || painter->device()->devType() != QInternal::Image
+	     || painter->compositionMode() != QPainter::CompositionMode_SourceOver
+	     || painter->opacity() != 1.0 )
+	{
+		return false;
+	}
+	
+	QImage* image = static_cast<QImage*>(painter->device());
+	if (image->format() != QImage::Format_ARGB32_Premultiplied)
+		return false;
+	
+	// The number of visible objects of each color, as a measure of the work
+	std::vector<std::size_t> weights;
+	std::size_t total_weight = 0;
+	std::vector<ObjectRenderablesMap::const_iterator> objects;
+	for (auto color = rbegin(); color != rend(); ++color)
+	{
+		objects.clear();
+		if (color->first < map->getNumColors())
+			color->second.findIntersecting(config.bounding_box, objects);
+		weights.push_back(objects.size());
+		total_weight += objects.size();
+	}
+	
+	const qint64 layer_size = qint64(image->bytesPerLine()) * image->height();
+	std::size_t num_layers = std::min(std::size_t(num_threads), total_weight / min_layer_objects);
+	num_layers = std::min(num_layers, std::size_t(qMax(qint64(1), max_separations_memory / qMax(qint64(1), layer_size))));
+	if (num_layers < 2)
+		return false;
+	
+	// Contiguous bands of colors with similar weight
+	std::vector<const_reverse_iterator> bounds = { rbegin() };
+	std::size_t weight = 0;
+	auto color = rbegin();
+	for (std::size_t w : weights)
+	{
+		weight += w;
+		++color;
+		if (weight * num_layers >= total_weight * bounds.size() && bounds.size() < num_layers && color != rend())
+			bounds.push_back(color);
+	}
+	bounds.push_back(rend());
+	num_layers = bounds.size() - 1;
 	
+	std::vector<QImage> layers;
+	layers.reserve(num_layers);
+	for (std::size_t i = 0; i < num_layers; ++i)
+	{
+		layers.push_back(QImage(image->size(), QImage::Format_ARGB32_Premultiplied));
+		layers.back().setDevicePixelRatio(image->devicePixelRatio());
+	}
+	
+	const QPainter::RenderHints hints = painter->renderHints();
+	const QTransform transform = painter->worldTransform();
+	const QPainterPath clip_path = painter->hasClipping() ? painter->clipPath() : QPainterPath();
+	const QPainterPath* clip = painter->hasClipping() ? &clip_path : nullptr;
+	
+	QSemaphore done;
+	for (std::size_t i = 1; i < num_layers; ++i)
+		TaskPool::start(new LayerJob(*this, config, bounds[i], bounds[i+1], hints, transform, clip, occluded, layers[i], done), TaskPool::Interactive);
+	LayerJob::drawLayer(*this, config, bounds[0], bounds[1], hints, transform, clip, occluded, layers[0]);
+	done.acquire(int(num_layers - 1));
+	
+	// Layers are composed in the order of drawing, so that the result equals
+	// drawing one color over the other.
+	painter->save();
+	painter->resetTransform();
+	for (const QImage& layer : layers)
+		painter->drawImage(0, 0, layer);
+	painter->restore();
+	
+	return true;
+}
+
+void MapRenderables::drawColors(QPainter* painter, const RenderConfig& config, const ObjectSet* filter,
+                                const RenderableSet* occluded, const_reverse_iterator first, const_reverse_iterator last) const
+{
 #ifdef Q_OS_ANDROID
 	const qreal min_dimension = 1.0/config.scaling;
 #endif
@@ -237,24 +887,48 @@ void MapRenderables::draw(QPainter *painter, const RenderConfig &config) const
 	QPainterPath initial_clip = painter->clipPath();
 	const QPainterPath* current_clip = NULL;
 	
+	// The objects of the current color which intersect the bounding box
+	std::vector<ObjectRenderablesMap::const_iterator> objects;
+	
+	// The renderables of these objects, to be batched by painter configuration
+	typedef std::pair<const PainterConfig*, const RenderableVector*> Batch;
+	std::vector<Batch> batches;
+	
+	const ColorTransform* proof = config.testFlag(RenderConfig::SoftProof) ? &proofTransform() : nullptr;
+	
+	int visited_renderables = 0;
+	int drawn_renderables = 0;
+	
 	painter->save();
-	const_reverse_iterator end_of_colors = rend();
-	const_reverse_iterator color = rbegin();
-	while (color != end_of_colors && color->first >= map->getNumColors())
-	{
-		++color;
-	}
-	for (; color != end_of_colors; ++color)
+	for (const_reverse_iterator color = first; color != last; ++color)
 	{
+		if (color->first >= map->getNumColors())
+			continue;
+		
 		if ( config.testFlag(RenderConfig::RequireSpotColor) &&
 		     (color->first < 0 || map->getColor(color->first)->getSpotColorMethod() == MapColor::UndefinedMethod) )
 		{
 			continue;
 		}
 		
-		ObjectRenderablesMap::const_iterator end_of_objects = color->second.end();
-		for (ObjectRenderablesMap::const_iterator object = color->second.begin(); object != end_of_objects; ++object)
+		const MapColor* map_color = map->getColor(color->first);
+		if (!map_color)
+		{
+			Q_ASSERT(color->first == MapColor::Reserved);
+			continue; // in release build
+		}
+		QColor qcolor = proof ? proof->proofColor(map_color) : QColor(*map_color);
+		if (color->first >= 0 && map_color->getOpacity() < 1.0)
+			qcolor.setAlphaF(map_color->getOpacity());
+		
+		objects.clear();
+		color->second.findIntersecting(config.bounding_box, objects);
+		batches.clear();
+		for (ObjectRenderablesMap::const_iterator object : objects)
 		{
+			if (filter && !filter->count(object->first))
+				continue;
+			
 			// Settings check
 			const Symbol* symbol = object->first->getSymbol();
 			if (!config.testFlag(RenderConfig::HelperSymbols) && symbol->isHelperSymbol())
@@ -265,105 +939,172 @@ void MapRenderables::draw(QPainter *painter, const RenderConfig &config) const
 			if (!object->first->getExtent().intersects(config.bounding_box))
 				continue;
 			
-			SharedRenderables::const_iterator it_end = object->second->end();
-			for (SharedRenderables::const_iterator it = object->second->begin(); it != it_end; ++it)
+			for (const auto& config_renderables : *object->second)
+				batches.push_back(Batch(&config_renderables.first, &config_renderables.second));
+		}
+		
+		// All renderables of a priority have the same color, so the order of
+		// drawing does not matter. Sorting by painter configuration changes
+		// the painter state only once per distinct configuration.
+		std::stable_sort(batches.begin(), batches.end(), [](const Batch& a, const Batch& b) {
+			return *a.first < *b.first;
+		});
+		
+		const PainterConfig* active_state = nullptr;
+		bool active = false;
+		for (const Batch& batch : batches)
+		{
+			const PainterConfig& state = *batch.first;
+			if (!active_state || state != *active_state)
+			{
+				active_state = &state;
+				active = state.activate(painter, current_clip, config, qcolor, initial_clip);
+			}
+			if (!active)
+				continue;
+			
+			visited_renderables += int(batch.second->size());
+			for (Renderable* renderable : *batch.second)
 			{
-				// Render the renderables
-				const PainterConfig& state = it->first;
-				const MapColor* map_color = map->getColor(state.color_priority);
-				if (!map_color)
-				{
-					Q_ASSERT(state.color_priority == MapColor::Reserved);
-					continue; // in release build
-				}
-				QColor color = *map_color;
-				if (state.color_priority >= 0 && map_color->getOpacity() < 1.0)
-					color.setAlphaF(map_color->getOpacity());
-				if (!state.activate(painter, current_clip, config, color, initial_clip))
-				    continue;
-				
-				for (Renderable* renderable : it->second)
-				{
 #ifdef Q_OS_ANDROID
-					const QRectF& extent = renderable->getExtent();
-					if (extent.width() < min_dimension && extent.height() < min_dimension)
-						continue;
+				const QRectF& extent = renderable->getExtent();
+				if (extent.width() < min_dimension && extent.height() < min_dimension)
+					continue;
 #endif
-					if (renderable->intersects(config.bounding_box))
-					{
-						renderable->render(*painter, config);
-					}
+				if (occluded && occluded->count(renderable))
+					continue;
+				if (renderable->intersects(config.bounding_box) && !renderable->isBelowDetailLimit(config))
+				{
+					renderable->render(*painter, config);
+					++drawn_renderables;
 				}
-				
-			} // each common render attributes
+			}
 			
-		} // each object
+		} // each batch of common render attributes
 		
 	} // each map color
 	
 	painter->restore();
+	
+	RenderStatistics::addRenderables(visited_renderables, drawn_renderables);
 }
 
 void MapRenderables::drawOverprintingSimulation(QPainter* painter, const RenderConfig& config) const
 {
 	// NOTE: painter must be a QPainter on a QImage of Format_ARGB32_Premultiplied.
 	QImage* image = static_cast<QImage*>(painter->device());
-	ImageTransparencyFixup image_fixup(image);
 	
 	QPainter::RenderHints hints = painter->renderHints();
 	QTransform t = painter->worldTransform();
 	painter->save();
 	
 	painter->resetTransform();
-	painter->setCompositionMode(QPainter::CompositionMode_Multiply); // Alternative: CompositionMode_Darken
 	
-	QImage separation(image->size(), QImage::Format_ARGB32_Premultiplied);
+	// Only the clipped part of the image is composed. The own kernel handles
+	// rectangular clips and does not produce the pixels which need the
+	// fixup. QPainter (with the fixup) is used only for other clip shapes.
+	QRect dirty_rect = image->rect();
+	bool use_painter = false;
+	if (painter->hasClipping())
+	{
+		const QRegion clip_region = painter->clipRegion();
+		dirty_rect &= clip_region.boundingRect();
+		use_painter = clip_region.rectCount() > 1;
+	}
+	ImageTransparencyFixup image_fixup(image, dirty_rect);
+	
+	// The own kernel must not write to the image while the painter is active
+	// on it. It composes a copy of the dirty rect instead. This copy replaces
+	// the original pixels when all separations are done.
+	QImage composition;
+	if (!use_painter)
+	{
+		composition = image->copy(dirty_rect);
+		composition.setDevicePixelRatio(1); // like the separations
+	}
 	
+	// The spot colors, in the order of composition
+	std::vector<const MapColor*> spot_colors;
 	for (Map::ColorVector::reverse_iterator map_color = map->color_set->colors.rbegin();
 	     map_color != map->color_set->colors.rend();
 	     map_color++)
 	{
 		if ((*map_color)->getSpotColorMethod() == MapColor::SpotColor)
+			spot_colors.push_back(*map_color);
+	}
+	
+	// The separations are drawn concurrently, in batches of limited size.
+	const qint64 separation_size = qint64(image->bytesPerLine()) * image->height();
+	std::size_t batch_size = std::size_t(TaskPool::maxThreads());
+	batch_size = std::min(batch_size, std::size_t(qMax(qint64(1), max_separations_memory / qMax(qint64(1), separation_size))));
+	batch_size = std::min(batch_size, qMax(std::size_t(1), spot_colors.size()));
+	std::vector<QImage> separations;
+	separations.reserve(batch_size);
+	for (std::size_t i = 0; i < batch_size; ++i)
+		separations.push_back(QImage(image->size(), QImage::Format_ARGB32_Premultiplied));
+	
+	// The objects are determined once for all separations.
+	VisibleObjects visible;
+	findVisibleObjects(config, visible);
+	
+	for (std::size_t first = 0; first < spot_colors.size(); first += batch_size)
+	{
+		const std::size_t count = std::min(batch_size, spot_colors.size() - first);
+		
+		// Collect all halftones and knockouts of the colors
+		QSemaphore done;
+		for (std::size_t i = 1; i < count; ++i)
+			TaskPool::start(new SeparationJob(*this, config, spot_colors[first + i], hints, t, separations[i], done, &visible), TaskPool::Interactive);
+		SeparationJob::drawSeparation(*this, config, spot_colors[first], hints, t, separations[0], &visible);
+		done.acquire(int(count - 1));
+		
+		for (std::size_t i = 0; i < count; ++i)
 		{
-			separation.fill((Qt::GlobalColor)Qt::transparent);
-			
-			// Collect all halftones and knockouts of a single color
-			QPainter p(&separation);
-			p.setRenderHints(hints);
-			p.setWorldTransform(t, false);
-			drawColorSeparation(&p, config, *map_color, true);
-			p.end();
-			
 			// Add this separation to the composition with multiplication.
-			painter->setCompositionMode(QPainter::CompositionMode_Multiply);
-			painter->drawImage(0, 0, separation);
-			image_fixup();
+			if (use_painter)
+			{
+				painter->setCompositionMode(QPainter::CompositionMode_Multiply);
+				painter->drawImage(0, 0, separations[i]);
+				image_fixup();
+			}
+			else
+			{
+				multiply(composition, separations[i], dirty_rect.topLeft());
+			}
 			
 #if MAPPER_OVERPRINTING_CORRECTION == -1
 			// Add some opacity to the multiplication, but not for black,
 			// since halftones (i.e. grey) might unduly lighten the composition.
-			if (static_cast<QRgb>(**map_color) != 0xff000000)
+			if (static_cast<QRgb>(*spot_colors[first + i]) != 0xff000000)
 			{
-				// FIXME: Implement this for Format_ARGB32_Premultiplied,
-				//        if efficiently possible.
-				QImage copy = separation.convertToFormat(QImage::Format_ARGB32);
-				QRgb* dest = (QRgb*)copy.bits();
-				const QRgb* dest_end = dest + copy.byteCount() / sizeof(QRgb);
-				for (QRgb* px = dest; px < dest_end; ++px)
+				reduceOpacityOfLightPixels(separations[i]);
+				if (use_painter)
+				{
+					painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
+					painter->drawImage(0, 0, separations[i]);
+				}
+				else
 				{
-					const unsigned int alpha = qAlpha(*px) * ((255-qGray(*px)) << 16) & 0xff000000;
-					*px = alpha | (*px & 0xffffff);
+					QPainter p(&composition);
+					p.drawImage(-dirty_rect.topLeft(), separations[i]);
 				}
-				painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
-				painter->drawImage(0, 0, copy);
 			}
 #endif
 		}
 	}
 	
+	if (!composition.isNull())
+	{
+		// Replace the dirty rect with the composition, pixel by pixel.
+		composition.setDevicePixelRatio(image->devicePixelRatio());
+		painter->setCompositionMode(QPainter::CompositionMode_Source);
+		painter->drawImage(QPointF(dirty_rect.topLeft()) / image->devicePixelRatio(), composition);
+	}
+	
 	painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
 	
 #if MAPPER_OVERPRINTING_CORRECTION > 0
+	QImage& separation = separations.front();
 	separation.fill((Qt::GlobalColor)Qt::transparent);
 	QPainter p(&separation);
 	p.setRenderHints(hints);
@@ -400,7 +1141,62 @@ void MapRenderables::drawOverprintingSimulation(QPainter* painter, const RenderC
 	painter->restore();
 }
 
-void MapRenderables::drawColorSeparation(QPainter* painter, const RenderConfig& config, const MapColor* separation, bool use_color) const
+void MapRenderables::findVisibleObjects(const RenderConfig& config, VisibleObjects& visible) const
+{
+	visible.clear();
+	for (const auto& color : *this)
+	{
+		if (color.first >= map->getNumColors())
+			continue;
+		
+		std::vector<ObjectRenderablesMap::const_iterator> objects;
+		findVisible(color.second, config, objects);
+		if (!objects.empty())
+			visible[color.first].swap(objects);
+	}
+}
+
+void MapRenderables::drawObjectsSeparately(QPainter* painter, const RenderConfig& config, const std::function<void (const Object*, const MapColor*)>& begin_object) const
+{
+	const QPainterPath initial_clip = painter->clipPath();
+	const QPainterPath* current_clip = nullptr;
+	
+	VisibleObjects visible;
+	findVisibleObjects(config, visible);
+	
+	const ColorTransform* proof = config.testFlag(RenderConfig::SoftProof) ? &proofTransform() : nullptr;
+	
+	painter->save();
+	for (auto color = visible.rbegin(); color != visible.rend(); ++color)
+	{
+		const MapColor* map_color = map->getColor(color->first);
+		if (!map_color)
+			continue;
+		
+		QColor qcolor = proof ? proof->proofColor(map_color) : QColor(*map_color);
+		if (color->first >= 0 && map_color->getOpacity() < 1.0)
+			qcolor.setAlphaF(map_color->getOpacity());
+		
+		for (ObjectRenderablesMap::const_iterator object : color->second)
+		{
+			begin_object(object->first, map_color);
+			for (const auto& config_renderables : *object->second)
+			{
+				if (!config_renderables.first.activate(painter, current_clip, config, qcolor, initial_clip))
+					continue;
+				
+				for (Renderable* renderable : config_renderables.second)
+				{
+					if (renderable->intersects(config.bounding_box) && !renderable->isBelowDetailLimit(config))
+						renderable->render(*painter, config);
+				}
+			}
+		}
+	}
+	painter->restore();
+}
+
+void MapRenderables::drawColorSeparation(QPainter* painter, const RenderConfig& config, const MapColor* separation, bool use_color, const VisibleObjects* visible) const
 {
 	painter->save();
 	
@@ -411,6 +1207,14 @@ void MapRenderables::drawColorSeparation(QPainter* painter, const RenderConfig&
 	// we need to take care of knockouts.
 	bool drawing_started = false;
 	
+	// The objects of the current color which intersect the bounding box
+	std::vector<ObjectRenderablesMap::const_iterator> objects;
+	
+	// How the regular colors contribute to this separation
+	const SeparationTable* separation_table = nullptr;
+	if (separation->getPriority() != MapColor::Reserved)
+		separation_table = &separationTable(separation);
+	
 	// For each pair of color priority and its renderables collection...
 	const_reverse_iterator end_of_colors = rend();
 	const_reverse_iterator color = rbegin();
@@ -425,67 +1229,29 @@ void MapRenderables::drawColorSeparation(QPainter* painter, const RenderConfig&
 		// Check whether the current color [priority] applies to the current separation.
 		if (color->first > MapColor::Reserved)
 		{
-			if (separation->getPriority() == MapColor::Reserved)
+			if (!separation_table)
 			{
 				// Don't process regular colors for the "Reserved" separation.
 				continue;
 			}
 			
-			switch (drawing_color.spot_color->getSpotColorMethod())
+			Q_ASSERT(color->first < int(separation_table->size()));
+			if (color->first >= int(separation_table->size()))
+				continue; // in release build
+			
+			const SeparationComponent& entry = (*separation_table)[color->first];
+			if (entry.component.spot_color)
 			{
-				case MapColor::UndefinedMethod:
-					continue;
-				
-				case MapColor::SpotColor:
-					if (drawing_color.spot_color == separation)
-					{
-						; // okay
-					}
-					else if (drawing_started && drawing_color.spot_color->getKnockout())
-					{
-						drawing_color.factor = 0.0f;
-					}
-					else
-					{
-						continue;
-					}
-					break;
-				
-				case MapColor::CustomColor:
-				{
-					// First, check if the renderables draw color to this separation
-					// TODO: Use an efficient data structure to avoid reiterating each time a separation is drawn
-					const SpotColorComponents& components = drawing_color.spot_color->getComponents();
-					for ( SpotColorComponents::const_iterator component = components.begin(), c_end = components.end();
-						component != c_end;
-						++component )
-					{
-						if (component->spot_color == separation)
-						{
-							// The renderables do draw the current spot color
-							drawing_color = *component;
-							break;
-						}
-					}
-					if (drawing_color.spot_color != separation)
-					{
-						// If the renderables do not explicitly draw color to this separation,
-						// check if they need a knockout.
-						if (drawing_started && drawing_color.spot_color->getKnockout())
-						{
-							drawing_color = SpotColorComponent(separation, 0.0f);
-						}
-						else
-						{
-							continue;
-						}
-					}
-					break;
-				}
-				
-				default:
-					Q_ASSERT(false); // in development builds
-					continue;        // in release build
+				// The renderables do draw the current spot color
+				drawing_color = entry.component;
+			}
+			else if (drawing_started && entry.knockout)
+			{
+				drawing_color = SpotColorComponent(separation, 0.0f);
+			}
+			else
+			{
+				continue;
 			}
 		}
 		else if (separation->getPriority() == MapColor::Reserved)
@@ -512,20 +1278,24 @@ void MapRenderables::drawColorSeparation(QPainter* painter, const RenderConfig&
 			continue;
 		}
 		
-		// For each pair of object and its renderables [states] for a particular map color...
-		ObjectRenderablesMap::const_iterator end_of_objects = color->second.end();
-		for (ObjectRenderablesMap::const_iterator object = color->second.begin(); object != end_of_objects; ++object)
+		// The objects which are to be drawn at all
+		const std::vector<ObjectRenderablesMap::const_iterator>* color_objects = &objects;
+		if (visible)
 		{
-			// Check whether the symbol and object is to be drawn at all.
-			const Symbol* symbol = object->first->getSymbol();
-			if (!config.testFlag(RenderConfig::HelperSymbols) && symbol->isHelperSymbol())
-				continue;
-			if (symbol->isHidden())
+			auto found = visible->find(color->first);
+			if (found == visible->end())
 				continue;
-			
-			if (!object->first->getExtent().intersects(config.bounding_box))
-				continue;
-			
+			color_objects = &found->second;
+		}
+		else
+		{
+			objects.clear();
+			findVisible(color->second, config, objects);
+		}
+		
+		// For each pair of object and its renderables [states] for a particular map color...
+		for (ObjectRenderablesMap::const_iterator object : *color_objects)
+		{
 			// For each pair of common rendering attributes and collection of renderables...
 			SharedRenderables::const_iterator it_end = object->second->end();
 			for (SharedRenderables::const_iterator it = object->second->begin(); it != it_end; ++it)
@@ -558,7 +1328,7 @@ void MapRenderables::drawColorSeparation(QPainter* painter, const RenderConfig&
 				// Render the renderable
 				for (Renderable* renderable : it->second)
 				{
-					if (renderable->intersects(config.bounding_box))
+					if (renderable->intersects(config.bounding_box) && !renderable->isBelowDetailLimit(config))
 					{
 						renderable->render(*painter, config);
 						drawing_started |= drawing;
@@ -574,13 +1344,135 @@ void MapRenderables::drawColorSeparation(QPainter* painter, const RenderConfig&
 	painter->restore();
 }
 
+void MapRenderables::invalidateSeparationTables()
+{
+	QMutexLocker locker(&separation_tables_mutex);
+	separation_tables.clear();
+	proof_transform.clear();
+	proof_transform_valid = false;
+}
+
+void MapRenderables::updateColorPriorities()
+{
+	// All renderables in an entry share the render key of their color.
+	auto render_key = [](const ObjectRenderablesMap& objects) -> int {
+		for (const auto& object : objects)
+		{
+			for (const auto& config_renderables : *object.second)
+				return config_renderables.first.color_priority;
+		}
+		return MapColor::Reserved;
+	};
+	
+	std::map<int, ObjectRenderablesMap> moved;
+	for (auto& color : *this)
+	{
+		if (color.second.empty())
+			continue;
+		
+		ObjectRenderablesMap& target = moved[map->renderKeyToPriority(render_key(color.second))];
+		if (target.empty())
+		{
+			target.swap(color.second);
+		}
+		else
+		{
+			// Not expected for consistent colors
+			for (const auto& object : color.second)
+				target.insert(object.first, object.second);
+		}
+	}
+	std::map<int, ObjectRenderablesMap>::swap(moved);
+	invalidateSeparationTables();
+}
+
+const MapRenderables::SeparationTable& MapRenderables::separationTable(const MapColor* separation) const
+{
+	QMutexLocker locker(&separation_tables_mutex);
+	
+	auto found = separation_tables.find(separation);
+	if (found != separation_tables.end())
+		return found->second;
+	
+	SeparationTable& table = separation_tables[separation];
+	table.resize(map->getNumColors());
+	for (int priority = 0; priority < map->getNumColors(); ++priority)
+	{
+		const MapColor* color = map->getColor(priority);
+		SeparationComponent& entry = table[priority];
+		entry.knockout = false;
+		
+		switch (color->getSpotColorMethod())
+		{
+			case MapColor::UndefinedMethod:
+				break;
+			
+			case MapColor::SpotColor:
+				if (color == separation)
+					entry.component = SpotColorComponent(color, 1.0f);
+				else
+					entry.knockout = color->getKnockout();
+				break;
+			
+			case MapColor::CustomColor:
+				for (const SpotColorComponent& component : color->getComponents())
+				{
+					if (component.spot_color == separation)
+					{
+						entry.component = component;
+						break;
+					}
+				}
+				if (!entry.component.spot_color)
+					entry.knockout = color->getKnockout();
+				break;
+			
+			default:
+				Q_ASSERT(false);
+		}
+	}
+	return table;
+}
+
+const ColorTransform& MapRenderables::proofTransform() const
+{
+	QMutexLocker locker(&separation_tables_mutex);
+	
+	if (!proof_transform_valid)
+	{
+		for (int priority = 0; priority < map->getNumColors(); ++priority)
+			proof_transform.addColor(map->getColor(priority));
+		proof_transform_valid = true;
+	}
+	return proof_transform;
+}
+
 void MapRenderables::insertRenderablesOfObject(const Object* object)
 {
 	ObjectRenderables::const_iterator end_of_colors = object->renderables().end();
 	ObjectRenderables::const_iterator color = object->renderables().begin();
 	for (; color != end_of_colors; ++color)
 	{
-		operator[](color->first)[object] = color->second;
+		// The object's renderables are grouped by render key.
+		const int priority = map->renderKeyToPriority(color->first);
+		const SharedRenderables& shared = *color->second;
+		auto has_renderables = std::any_of(shared.begin(), shared.end(), [](const SharedRenderables::value_type& entry) {
+			return !entry.second.empty();
+		});
+		if (has_renderables)
+		{
+			operator[](priority).insert(object, color->second);
+			continue;
+		}
+		
+		// Drop the previous renderables of a color which the object no longer uses.
+		iterator color_renderables = find(priority);
+		if (color_renderables != end())
+		{
+			ObjectRenderablesMap::iterator obj = color_renderables->second.find(object);
+			if (obj != color_renderables->second.end())
+				color_renderables->second.erase(obj);
+		}
 	}
 }
 
@@ -615,6 +1507,34 @@ void MapRenderables::removeRenderablesOfObject(const Object* object, bool mark_a
 	}
 }
 
+qint64 MapRenderables::compact()
+{
+	qint64 result = 0;
+	for (iterator color = begin(); color != end(); )
+	{
+		if (color->second.empty())
+		{
+			result += sizeof(value_type);
+			color = erase(color);
+		}
+		else
+		{
+			++color;
+		}
+	}
+	return result;
+}
+
+bool MapRenderables::intersects(const QRectF& rect) const
+{
+	for (const auto& color : *this)
+	{
+		if (color.second.intersects(rect))
+			return true;
+	}
+	return false;
+}
+
 void MapRenderables::clear(bool mark_area_as_dirty)
 {
 	if (mark_area_as_dirty)
@@ -657,6 +1577,95 @@ namespace {
 			return QColor(255 - factor * (255 - original.red()), 255 - factor * (255 - original.green()), 255 - factor * (255 - original.blue()), highlight_alpha);
 		}
 	}
+	
+	/**
+	 * Returns true if the path is a single axis-aligned rectangle,
+	 * as created by QPainterPath::addRect().
+	 */
+	bool isRectangle(const QPainterPath& path)
+	{
+		if (path.elementCount() != 5 || !path.elementAt(0).isMoveTo())
+			return false;
+		
+		for (int i = 1; i < 5; ++i)
+		{
+			const QPainterPath::Element& previous = path.elementAt(i-1);
+			const QPainterPath::Element& current = path.elementAt(i);
+			if (!current.isLineTo() || (current.x != previous.x && current.y != previous.y))
+				return false;
+		}
+		const QPainterPath::Element& first = path.elementAt(0);
+		const QPainterPath::Element& last = path.elementAt(4);
+		return first.x == last.x && first.y == last.y;
+	}
+	
+	/**
+	 * A cache of the intersections of clip paths with initial clips.
+	 * 
+	 * The map is drawn repeatedly with the same clip paths, e.g. the areas of
+	 * pattern fills, and often with the same initial clip. The entries hold
+	 * implicitly shared copies of the paths. Comparing a copy to its source
+	 * is cheap, and comparing it to another path with the same address (after
+	 * the source was deleted) only costs a comparison of the elements.
+	 */
+	class ClipIntersectionCache
+	{
+	public:
+		const QPainterPath& intersected(const QPainterPath& initial_clip, const QPainterPath& clip_path)
+		{
+			for (const Entry& entry : entries)
+			{
+				if (entry.clip_path == clip_path && entry.initial_clip == initial_clip)
+					return entry.intersection;
+			}
+			
+			if (entries.size() < max_entries)
+				entries.resize(entries.size() + 1);
+			else
+				next_entry %= max_entries;
+			Entry& entry = entries[next_entry++];
+			entry = { initial_clip, clip_path, initial_clip.intersected(clip_path) };
+			return entry.intersection;
+		}
+		
+	private:
+		struct Entry
+		{
+			QPainterPath initial_clip;
+			QPainterPath clip_path;
+			QPainterPath intersection;
+		};
+		
+		static const std::size_t max_entries = 64;
+		
+		std::vector<Entry> entries;
+		std::size_t next_entry = 0;
+	};
+	
+	/** Each drawing thread has its own cache. */
+	Q_GLOBAL_STATIC(QThreadStorage<ClipIntersectionCache>, clip_intersection_caches)
+	
+	/**
+	 * Returns a brush which draws thin diagonal lines in the given color.
+	 * 
+	 * Like the hatching which AreaSymbol used to generate, the lines are 1 mm
+	 * apart, but at least a few pixels. They are one device pixel wide.
+	 */
+	QBrush hatchingBrush(const QColor& color, const QPainter* painter)
+	{
+		const qreal scale = std::sqrt(qAbs(painter->transform().determinant()));
+		const int size = qBound(6, qRound(M_SQRT2 * scale), 256);
+		QImage texture(size, size, QImage::Format_ARGB32_Premultiplied);
+		texture.fill(Qt::transparent);
+		const QRgb pixel = qPremultiply(color.rgba());
+		for (int i = 0; i < size; ++i)
+			reinterpret_cast<QRgb*>(texture.scanLine(i))[size - 1 - i] = pixel;
+		
+		QBrush brush(texture);
+		if (scale > 0)
+			brush.setTransform(QTransform::fromScale(1/scale, 1/scale));
+		return brush;
+	}
 }
 
 bool PainterConfig::activate(QPainter* painter, const QPainterPath*& current_clip, const RenderConfig& config, const QColor& color, const QPainterPath& initial_clip) const
@@ -676,11 +1685,28 @@ bool PainterConfig::activate(QPainter* painter, const QPainterPath*& current_cli
 			 * with Windows and Mac printers (cf. [tickets:#196]), and 
 			 * with Linux PDF export (cf. [tickets:#225]).
 			 * But it seems to be faster in general.
+			 * 
+			 * The bounding rects avoid the path boolean operation in the
+			 * common cases, and the cache avoids repeating it per frame.
 			 */
-			QPainterPath merged = initial_clip.intersected(*clip_path);
-			if (merged.isEmpty())
+			const QRectF initial_rect = initial_clip.boundingRect();
+			const QRectF clip_rect = clip_path->boundingRect();
+			if (!initial_rect.intersects(clip_rect))
 				return false; // outside of initial clip
-			painter->setClipPath(merged, Qt::ReplaceClip);
+			
+			if (initial_rect.contains(clip_rect) && isRectangle(initial_clip))
+			{
+				painter->setClipPath(*clip_path, Qt::ReplaceClip);
+			}
+			else
+			{
+				const QPainterPath& merged = clip_intersection_caches.isDestroyed()
+				                             ? initial_clip.intersected(*clip_path)
+				                             : clip_intersection_caches->localData().intersected(initial_clip, *clip_path);
+				if (merged.isEmpty())
+					return false; // outside of initial clip
+				painter->setClipPath(merged, Qt::ReplaceClip);
+			}
 		}
 		else
 		{
@@ -723,7 +1749,12 @@ bool PainterConfig::activate(QPainter* painter, const QPainterPath*& current_cli
 		painter->setPen(QPen(brush, actual_pen_width));
 		painter->setBrush(QBrush(Qt::NoBrush));
 	}
-	else if (mode == PainterConfig::BrushOnly)
+	else if (mode == PainterConfig::AreaFill && config.testFlag(RenderConfig::HatchedAreas))
+	{
+		painter->setPen(QPen(Qt::NoPen));
+		painter->setBrush(hatchingBrush(brush.color(), painter));
+	}
+	else if (mode != PainterConfig::Reserved)
 	{
 		painter->setPen(QPen(Qt::NoPen));
 		painter->setBrush(brush);
@@ -21,14 +21,23 @@
 #ifndef _OPENORIENTEERING_RENDERABLE_H_
 #define _OPENORIENTEERING_RENDERABLE_H_
 
+#include <cstddef>
+#include <functional>
 #include <map>
+#include <unordered_set>
 #include <vector>
 
+#include <QMutex>
+#include <QPointF>
 #include <QRectF>
 #include <QSharedData>
 #include <QExplicitlySharedDataPointer>
+#include <QVector>
 
+#include "core/color_transform.h"
+#include "core/flat_map.h"
 #include "core/map_color.h"
+#include "core/spatial_index.h"
 
 class QColor;
 class QPainter;
@@ -66,6 +75,20 @@ public:
 		HelperSymbols       = 1<<3, ///< Activates display of symbols with the "helper symbol" flag.
 		Highlighted         = 1<<4, ///< Makes the color appear highlighted.
 		RequireSpotColor    = 1<<5, ///< Skips colors which do not have a spot color definition.
+		ReducedDetail       = 1<<6, ///< Simplifies details which are smaller than detail_limit
+		                            ///  pixels: Tiny renderables are skipped, fine patterns
+		                            ///  become tinted flat fills, dashed lines with tiny gaps are
+		                            ///  drawn solid, and small text is drawn as boxes.
+		                            ///  Meant for fast overviews on the screen.
+		HatchedAreas        = 1<<7, ///< Fills areas with thin hatching instead of opaque color.
+		                            ///  The renderables are not changed for this.
+		OcclusionCulling    = 1<<8, ///< Skips renderables which are completely hidden by opaque
+		                            ///  area fills of colors with higher priority, in a coarse
+		                            ///  grid over the bounding box. Only for MapRenderables::draw(),
+		                            ///  not for overprinting simulation or separations.
+		SoftProof           = 1<<9, ///< Draws the colors as they are expected to be printed by
+		                            ///  a CMYK process, cf. ColorTransform. Not for overprinting
+		                            ///  simulation or separations.
 		Tool                = Screen | ForceMinSize | HelperSymbols, ///< The recommended flags for tools.
 		NoOptions           = 0     ///< No option activated.
 	};
@@ -86,18 +109,30 @@ public:
 	
 	qreal   scaling;      ///< The scaling.
 	                      ///  Used to calculate the final object sizes when
-                          ///  ForceMinSize is set.
+                          ///  ForceMinSize or ReducedDetail is set.
     
 	Options options;      ///< The rendering options.
 	
 	qreal   opacity;      ///< The opacity.
 	
+	/**
+	 * The size in pixels below which details are simplified when the
+	 * ReducedDetail option is set.
+	 */
+	static constexpr qreal detail_limit = 1.0;
+	
 	/**
 	 * A convenience method for testing flags in the options value.
 	 * 
 	 * \see QFlags::testFlag()
 	 */
 	bool testFlag(const Option flag) const;
+	
+	/**
+	 * Returns true if the ReducedDetail option is set and if the given
+	 * size (in map units) is drawn smaller than the detail limit.
+	 */
+	bool isBelowDetailLimit(qreal size) const;
 };
 
 
@@ -126,6 +161,19 @@ public:
 	 */
 	virtual ~Renderable();
 	
+	/**
+	 * Allocates memory for a renderable from the RenderableArena.
+	 * 
+	 * Renderables are created and deleted in large numbers whenever objects
+	 * are updated, and the arena makes this much cheaper than the heap.
+	 */
+	static void* operator new(std::size_t size);
+	
+	/**
+	 * Returns the memory of a renderable to the RenderableArena.
+	 */
+	static void operator delete(void* p);
+	
 	/**
 	 * Returns the extent (bounding box).
 	 */
@@ -136,6 +184,14 @@ public:
 	 */
 	bool intersects(const QRectF& rect) const;
 	
+	/**
+	 * Tests whether the renderable's extent is too small to be drawn
+	 * with the given configuration.
+	 * 
+	 * \see RenderConfig::ReducedDetail
+	 */
+	bool isBelowDetailLimit(const RenderConfig& config) const;
+	
 	/**
 	 * Returns the painter configuration information.
 	 * 
@@ -148,8 +204,18 @@ public:
 	 */
 	virtual void render(QPainter& painter, const RenderConfig& config) const = 0;
 	
+	/**
+	 * Returns the approximate amount of memory used by this renderable,
+	 * in bytes, including the renderable itself.
+	 */
+	virtual qint64 memoryUsage() const = 0;
+	
 protected:
-	/** The color priority is a major attribute and cannot be modified. */
+	/**
+	 * The color is a major attribute and cannot be modified.
+	 * 
+	 * It is identified by its render key, cf. MapColor::getRenderKey().
+	 */
 	const int color_priority;
 	
 	/** The extent must be set by inheriting classes. */
@@ -164,7 +230,8 @@ protected:
  * When painting a renderable item, the QPainter shall be configured according
  * to this information.
  * 
- * A PainterConfig is an immutable values, constructed with initializer lists.
+ * A PainterConfig is a value, constructed with initializer lists.
+ * It is meant to be used as a key which is not modified after construction.
  */
 class PainterConfig
 {
@@ -173,12 +240,13 @@ public:
 	{
 		BrushOnly = 0,  ///< Render using the brush only.
 		PenOnly   = 1,  ///< Render using the pen only.
+		AreaFill  = 2,  ///< Render using the brush only, which may be hatched.
 		Reserved  = -1	///< Not used.
 	};
 	
-	const int color_priority;       ///< The color priority which determines rendering order
-	const PainterMode mode;         ///< The mode of painting
-	const qreal pen_width;          ///< The width of the pen
+	int color_priority;             ///< The color's render key, cf. MapColor::getRenderKey()
+	PainterMode mode;               ///< The mode of painting
+	qreal pen_width;                ///< The width of the pen
 	const QPainterPath* clip_path;  ///< A clip_path which may be shared by several Renderables
 	
 	/**
@@ -230,32 +298,69 @@ typedef std::vector<Renderable*> RenderableVector;
  * 
  * This shared container can be used in different collections. When the last
  * reference to this container is dropped, it will delete the renderables.
+ * 
+ * An object has only a few distinct painter configurations, so they are
+ * kept in a contiguous sorted vector which is cheap to visit when drawing.
  */
-class SharedRenderables : public QSharedData, public std::map< PainterConfig, RenderableVector >
+class SharedRenderables : public QSharedData, public FlatMap< PainterConfig, RenderableVector >
 {
 public:
 	typedef QExplicitlySharedDataPointer<SharedRenderables> Pointer;
 	~SharedRenderables();
 	void deleteRenderables();
-	void compact(); // release memory which is occupied by unused PainterConfig, FIXME: maybe call this regularly...
+	
+	/**
+	 * Releases memory which is occupied by unused painter configurations
+	 * and by the excess capacity of the containers.
+	 * 
+	 * Returns the approximate number of bytes which were released.
+	 */
+	qint64 compact();
+	
+	/**
+	 * Returns the approximate amount of memory used by this container
+	 * and by the renderables, in bytes.
+	 */
+	qint64 memoryUsage() const;
 };
 
 
 
 /**
  * A high-level container for all renderables of a single object, 
- * grouped by color priority and common render attributes.
+ * grouped by color and common render attributes.
+ * 
+ * The colors are identified by render key, cf. MapColor::getRenderKey().
+ * The keys are kept in a contiguous sorted vector.
  */
-class ObjectRenderables : protected std::map<int, SharedRenderables::Pointer>
+class ObjectRenderables : protected FlatMap<int, SharedRenderables::Pointer>
 {
 friend class MapRenderables;
 public:
 	ObjectRenderables(Object& object);
+	
+	/**
+	 * Constructs a container which accumulates the renderables' extent
+	 * in the given rect instead of the object's extent.
+	 */
+	explicit ObjectRenderables(QRectF& extent);
+	
 	~ObjectRenderables();
 	
 	inline void insertRenderable(Renderable* r);
 	void insertRenderable(Renderable* r, PainterConfig state);
 	
+	/**
+	 * Inserts renderables which draw the prototype's renderables at each of
+	 * the given positions, optionally rotated by the given angles (radians).
+	 * 
+	 * The prototype's renderables are shared, so the prototype must not be
+	 * modified afterwards. It may be used for further insertions, though.
+	 * Nothing is changed and false is returned if the prototype uses clip
+	 * paths.
+	 */
+	bool insertPatternRenderables(const ObjectRenderables& prototype, const QVector<QPointF>& positions, const QVector<qreal>& rotations = QVector<qreal>());
+	
 	void clear();
 	void deleteRenderables();
 	void takeRenderables();
@@ -271,6 +376,26 @@ public:
 	
 	const QRectF& getExtent() const;
 	
+	/**
+	 * Returns the approximate amount of memory used by the renderables
+	 * in this container, in bytes.
+	 */
+	qint64 memoryUsage() const;
+	
+	/**
+	 * Releases memory which is occupied by unused painter configurations
+	 * and colors, and by the excess capacity of the containers.
+	 * 
+	 * A color's container is released only if it is empty and not shared.
+	 * Returns the approximate number of bytes which were released.
+	 */
+	qint64 compact();
+	
+	/**
+	 * Returns the number of renderables in this container.
+	 */
+	int numRenderables() const;
+	
 private:
 	QRectF& extent;
 	const QPainterPath* clip_path; // no memory management here!
@@ -284,8 +409,61 @@ private:
  * 
  * This container uses a smart pointer to the renderable collection
  * of each single object.
+ * 
+ * The container maintains a spatial index of the objects' extents, so that
+ * the objects which are relevant for a particular area can be found without
+ * visiting all objects.
  */
-typedef std::map<const Object*, SharedRenderables::Pointer> ObjectRenderablesMap;
+class ObjectRenderablesMap : protected std::map<const Object*, SharedRenderables::Pointer>
+{
+public:
+	typedef std::map<const Object*, SharedRenderables::Pointer> base_type;
+	
+	using base_type::iterator;
+	using base_type::const_iterator;
+	using base_type::begin;
+	using base_type::end;
+	using base_type::find;
+	using base_type::empty;
+	using base_type::size;
+	
+	/**
+	 * Sets the renderables for the given object.
+	 * 
+	 * The object's current extent is recorded in the spatial index.
+	 */
+	void insert(const Object* object, const SharedRenderables::Pointer& renderables);
+	
+	/**
+	 * Removes the element at the given position.
+	 */
+	void erase(iterator pos);
+	
+	/**
+	 * Removes all elements.
+	 */
+	void clear();
+	
+	/**
+	 * Exchanges the elements of this container and another.
+	 */
+	void swap(ObjectRenderablesMap& other);
+	
+	/**
+	 * Appends the elements whose objects' extent touches the given rect.
+	 * 
+	 * The elements are appended in the order of this container.
+	 */
+	void findIntersecting(const QRectF& rect, std::vector<const_iterator>& out) const;
+	
+	/**
+	 * Returns true if any object's extent touches the given rect.
+	 */
+	bool intersects(const QRectF& rect) const;
+	
+private:
+	SpatialIndex<const Object> spatial_index;
+};
 
 
 
@@ -293,20 +471,43 @@ typedef std::map<const Object*, SharedRenderables::Pointer> ObjectRenderablesMap
  * A high-level container for renderables of multiple objects
  * grouped by color priority, object and common render attributes.
  * 
+ * Unlike the renderables, this container uses the colors' current
+ * priorities, in order to draw the colors in the right order.
+ * 
  * This container is able to draw the renderables.
  */
 class MapRenderables : protected std::map<int, ObjectRenderablesMap>
 {
 public:
+	/** A set of objects, for restricting the drawing to these objects. */
+	typedef std::unordered_set<const Object*> ObjectSet;
+	
+	/** The objects to be drawn for a particular configuration, by color priority. */
+	typedef std::map<int, std::vector<ObjectRenderablesMap::const_iterator> > VisibleObjects;
+	
+	/** A set of renderables, e.g. those which are hidden by others. */
+	typedef std::unordered_set<const Renderable*> RenderableSet;
+	
 	MapRenderables(Map* map);
 	
 	/**
 	 * Draws the renderables normally (one opaque over the other).
 	 * 
+	 * For complex drawings on a QImage in the main thread, bands of color
+	 * priorities are drawn concurrently into transparent layers, which are
+	 * then composed in the order of the priorities.
+	 * 
+	 * With the OcclusionCulling option, a pre-pass visits the colors from
+	 * front to back and records which cells of a coarse grid over the
+	 * bounding box are completely covered by opaque area fills. Renderables
+	 * which touch only covered cells of colors with higher priority are not
+	 * drawn.
+	 * 
 	 * @param painter The QPainter used for drawing.
 	 * @param config  The rendering configuration
+	 * @param objects If not null, only the renderables of these objects are drawn.
 	 */
-	void draw(QPainter* painter, const RenderConfig& config) const;
+	void draw(QPainter* painter, const RenderConfig& config, const ObjectSet* objects = nullptr) const;
 	
 	/**
 	 * Draws the renderables in a spot color overprinting simulation.
@@ -327,9 +528,34 @@ public:
 	 * @param config  The rendering configuration
 	 * @param separation The spot color to draw the separation for.
 	 * @param use_color  If true, forces the separation to be drawn in its actual color.
+	 * @param visible    If not null, the result of findVisibleObjects() for the same configuration.
 	 */
 	void drawColorSeparation(QPainter* painter, const RenderConfig& config,
-		const MapColor* separation, bool use_color = false) const;
+		const MapColor* separation, bool use_color = false, const VisibleObjects* visible = nullptr) const;
+	
+	/**
+	 * Collects the objects which are drawn for the given configuration,
+	 * for all color priorities.
+	 * 
+	 * The result remains valid as long as the renderables are not modified.
+	 * It can be shared by the separations of the same area.
+	 */
+	void findVisibleObjects(const RenderConfig& config, VisibleObjects& visible) const;
+	
+	/**
+	 * Draws the renderables one object after the other, in regular order.
+	 * 
+	 * Unlike draw(), this does not batch the renderables of different objects.
+	 * The function begin_object is called before the renderables of an object
+	 * are drawn in a particular color. This allows paint devices to attribute
+	 * the drawing operations to objects and colors.
+	 * 
+	 * @param painter The QPainter used for drawing.
+	 * @param config  The rendering configuration
+	 * @param begin_object Called for each object and color which is drawn.
+	 */
+	void drawObjectsSeparately(QPainter* painter, const RenderConfig& config,
+		const std::function<void (const Object*, const MapColor*)>& begin_object) const;
 	
 	void insertRenderablesOfObject(const Object* object);
 	
@@ -340,8 +566,99 @@ public:
 	
 	inline bool empty() const;
 	
+	/**
+	 * Returns true if the extent of any object with renderables touches the given rect.
+	 */
+	bool intersects(const QRectF& rect) const;
+	
+	/**
+	 * Discards the cached information about the colors' contribution to
+	 * the spot color separations, and the cached soft proof colors.
+	 * 
+	 * This must be called whenever map colors are added, removed, reordered
+	 * or modified.
+	 */
+	void invalidateSeparationTables();
+	
+	/**
+	 * Moves the renderables to the current priorities of their colors.
+	 * 
+	 * The renderables identify their colors by render key, which is stable
+	 * when colors are added, removed or reordered. Only this container's
+	 * grouping by priority needs to follow such changes. This must be called
+	 * after such changes.
+	 */
+	void updateColorPriorities();
+	
+	/**
+	 * Removes the entries of color priorities which have no objects.
+	 * 
+	 * Returns the approximate number of bytes which were released.
+	 */
+	qint64 compact();
+	
 private:
+	class LayerJob;
+	
+	/**
+	 * Draws the renderables of the colors from first to last (exclusive),
+	 * i.e. from the lowest to the highest priority.
+	 */
+	void drawColors(QPainter* painter, const RenderConfig& config, const ObjectSet* filter,
+	                const RenderableSet* occluded, const_reverse_iterator first, const_reverse_iterator last) const;
+	
+	/**
+	 * Draws bands of colors concurrently, as described for draw().
+	 * 
+	 * Returns false and draws nothing when this is not possible or not
+	 * worthwhile for the given painter and configuration.
+	 */
+	bool drawConcurrently(QPainter* painter, const RenderConfig& config, const RenderableSet* occluded) const;
+	
+	/**
+	 * Collects the renderables which are completely hidden by opaque area
+	 * fills, as described for draw().
+	 */
+	void findOccludedRenderables(const RenderConfig& config, const ObjectSet* filter, RenderableSet& occluded) const;
+	
+	/**
+	 * Describes how the renderables of a regular color priority contribute
+	 * to a particular spot color separation.
+	 */
+	struct SeparationComponent
+	{
+		/** The contribution to the separation. Its spot color is null if there is none. */
+		SpotColorComponent component;
+		
+		/** True if the renderables knock out the separation where they do not contribute. */
+		bool knockout;
+	};
+	
+	/** The separation components of all regular colors, indexed by color priority. */
+	typedef std::vector<SeparationComponent> SeparationTable;
+	
+	/**
+	 * Returns the separation table for the given spot color.
+	 * 
+	 * The table is built on first use. This function may be called
+	 * concurrently from multiple threads.
+	 */
+	const SeparationTable& separationTable(const MapColor* separation) const;
+	
+	/**
+	 * Returns the transform for the SoftProof option, with all map colors.
+	 * 
+	 * The transform is built on first use. This function may be called
+	 * concurrently from multiple threads.
+	 */
+	const ColorTransform& proofTransform() const;
+	
 	Map* const map;
+	
+	mutable QMutex separation_tables_mutex;
+	mutable std::map<const MapColor*, SeparationTable> separation_tables;
+	mutable ColorTransform proof_transform;
+	mutable bool proof_transform_valid;
 };
 
 
@@ -356,13 +673,19 @@ bool RenderConfig::testFlag(const RenderConfig::Option flag) const
 	return options.testFlag(flag);
 }
 
+inline
+bool RenderConfig::isBelowDetailLimit(qreal size) const
+{
+	return options.testFlag(ReducedDetail) && size * scaling < detail_limit;
+}
+
 
 
 // ### Renderable ###
 
 inline
 Renderable::Renderable(const MapColor* color)
- : color_priority(color ? color->getPriority() : MapColor::Reserved)
+ : color_priority(color ? color->getRenderKey() : MapColor::Reserved)
 {
 	; // nothing
 }
@@ -379,6 +702,12 @@ bool Renderable::intersects(const QRectF& rect) const
 	return extent.intersects(rect);
 }
 
+inline
+bool Renderable::isBelowDetailLimit(const RenderConfig& config) const
+{
+	return config.isBelowDetailLimit(qMax(extent.width(), extent.height()));
+}
+
 
 
 // ### PainterConfig ###
@@ -388,8 +717,8 @@ bool operator==(const PainterConfig& lhs, const PainterConfig& rhs)
 {
 	return (lhs.color_priority == rhs.color_priority) &&
 	       (lhs.mode == rhs.mode) &&
-	       (lhs.pen_width == rhs.pen_width || lhs.mode == PainterConfig::BrushOnly) &&
-	       (lhs.clip_path != rhs.clip_path);
+	       (lhs.pen_width == rhs.pen_width || lhs.mode != PainterConfig::PenOnly) &&
+	       (lhs.clip_path == rhs.clip_path);
 }
 
 inline
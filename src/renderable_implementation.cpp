@@ -20,6 +20,8 @@
 
 #include "renderable_implementation.h"
 
+#include <cmath>
+
 #include <qmath.h>
 
 #include "core/map_color.h"
@@ -33,6 +35,47 @@
 #include "symbol_text.h"
 #include "util.h"
 
+#if defined(QT_PRINTSUPPORT_LIB)
+#  include <advanced_pdf_printer.h>
+#endif
+
+
+namespace
+{
+	/** Returns the approximate memory used by the elements of the path. */
+	qint64 pathMemoryUsage(const QPainterPath& path)
+	{
+		return qint64(path.elementCount()) * qint64(sizeof(QPainterPath::Element));
+	}
+	
+	/**
+	 * Returns the bounding rect of the path, with a minimum size like
+	 * PathCoordVector::calculateExtent(), so that it is always valid.
+	 */
+	QRectF pathExtent(const QPainterPath& path)
+	{
+		auto extent = path.boundingRect();
+		extent.setWidth(qMax(extent.width(), 0.0001));
+		extent.setHeight(qMax(extent.height(), 0.0001));
+		return extent;
+	}
+	
+	/**
+	 * The minimum number of path elements for flattening the curves of an
+	 * area once per zoom bucket, instead of in each repaint.
+	 */
+	const int min_flattened_area_elements = 64;
+	
+	/** Returns the memory allocated by the vector. */
+	template <class T>
+	qint64 vectorMemoryUsage(const QVector<T>& vector)
+	{
+		return qint64(vector.capacity()) * qint64(sizeof(T));
+	}
+}
+
+
+
 // ### DotRenderable ###
 
 DotRenderable::DotRenderable(const PointSymbol* symbol, MapCoordF coord)
@@ -49,6 +92,11 @@ PainterConfig DotRenderable::getPainterConfig(const QPainterPath* clip_path) con
 	return { color_priority, PainterConfig::BrushOnly, 0, clip_path };
 }
 
+qint64 DotRenderable::memoryUsage() const
+{
+	return sizeof(DotRenderable);
+}
+
 void DotRenderable::render(QPainter &painter, const RenderConfig &config) const
 {
 	if (config.options.testFlag(RenderConfig::ForceMinSize) && extent.width() * config.scaling < 1.5f)
@@ -77,6 +125,11 @@ PainterConfig CircleRenderable::getPainterConfig(const QPainterPath* clip_path)
 	return { color_priority, PainterConfig::PenOnly, line_width, clip_path };
 }
 
+qint64 CircleRenderable::memoryUsage() const
+{
+	return sizeof(CircleRenderable);
+}
+
 void CircleRenderable::render(QPainter &painter, const RenderConfig &config) const
 {
 	if (config.options.testFlag(RenderConfig::ForceMinSize) && rect.width() * config.scaling < 1.5f)
@@ -92,6 +145,21 @@ void CircleRenderable::render(QPainter &painter, const RenderConfig &config) con
 LineRenderable::LineRenderable(const LineSymbol* symbol, const VirtualPath& virtual_path, bool closed)
  : Renderable(symbol->getColor())
  , line_width(0.001f * symbol->getLineWidth())
+ , gap_length(0.0f)
+{
+	build(symbol, virtual_path, closed, true);
+}
+
+LineRenderable::LineRenderable(const LineSymbol* symbol, const VirtualPath& virtual_path, bool closed, const LineRenderable& same_path)
+ : Renderable(symbol->getColor())
+ , line_width(0.001f * symbol->getLineWidth())
+ , gap_length(same_path.gap_length)
+ , path(same_path.path)
+{
+	build(symbol, virtual_path, closed, false);
+}
+
+void LineRenderable::build(const LineSymbol* symbol, const VirtualPath& virtual_path, bool closed, bool build_path)
 {
 	Q_ASSERT(virtual_path.size() >= 2);
 	
@@ -115,12 +183,15 @@ LineRenderable::LineRenderable(const LineSymbol* symbol, const VirtualPath& virt
 	auto& coords = virtual_path.coords;
 	
 	bool has_curve = false;
+	bool has_hole = false;
 	bool hole = false;
 	bool gap = false;
+	MapCoordF gap_start;
 	QPainterPath first_subpath;
 	
 	auto i = virtual_path.first_index;
-	path.moveTo(coords[i]);
+	if (build_path)
+		path.moveTo(coords[i]);
 	extent = QRectF(coords[i].x(), coords[i].y(), 0.0001f, 0.0001f);
 	extentIncludeCap(i, half_line_width, false, symbol, virtual_path);
 	
@@ -136,12 +207,16 @@ LineRenderable::LineRenderable(const LineSymbol* symbol, const VirtualPath& virt
 			else if (flags[i].isGapPoint())
 			{
 				gap = false;
-				if (first_subpath.isEmpty() && closed)
+				if (build_path)
 				{
-					first_subpath = path;
-					path = QPainterPath();
+					gap_length = qMax(gap_length, float(coords[i].distanceTo(gap_start)));
+					if (first_subpath.isEmpty() && closed)
+					{
+						first_subpath = path;
+						path = QPainterPath();
+					}
+					path.moveTo(coords[i]);
 				}
-				path.moveTo(coords[i]);
 				extentIncludeCap(i, half_line_width, false, symbol, virtual_path);
 			}
 			continue;
@@ -150,12 +225,15 @@ LineRenderable::LineRenderable(const LineSymbol* symbol, const VirtualPath& virt
 		if (hole)
 		{
 			Q_ASSERT(!flags[i].isHolePoint() && "Two hole points in a row!");
-			if (first_subpath.isEmpty() && closed)
+			if (build_path)
 			{
-				first_subpath = path;
-				path = QPainterPath();
+				if (first_subpath.isEmpty() && closed)
+				{
+					first_subpath = path;
+					path = QPainterPath();
+				}
+				path.moveTo(coords[i]);
 			}
-			path.moveTo(coords[i]);
 			extentIncludeCap(i, half_line_width, false, symbol, virtual_path);
 			hole = false;
 			continue;
@@ -165,16 +243,23 @@ LineRenderable::LineRenderable(const LineSymbol* symbol, const VirtualPath& virt
 		{
 			Q_ASSERT(i < virtual_path.last_index-1);
 			has_curve = true;
-			path.cubicTo(coords[i], coords[i+1], coords[i+2]);
+			if (build_path)
+				path.cubicTo(coords[i], coords[i+1], coords[i+2]);
 			i += 2;
 		}
-		else
+		else if (build_path)
 			path.lineTo(coords[i]);
 		
 		if (flags[i].isHolePoint())
+		{
 			hole = true;
+			has_hole = true;
+		}
 		else if (flags[i].isGapPoint())
+		{
 			gap = true;
+			gap_start = coords[i];
+		}
 		
 		if ((i < virtual_path.last_index && !hole && !gap) || (i == virtual_path.last_index && closed))
 			extentIncludeJoin(i, half_line_width, symbol, virtual_path);
@@ -182,7 +267,7 @@ LineRenderable::LineRenderable(const LineSymbol* symbol, const VirtualPath& virt
 			extentIncludeCap(i, half_line_width, true, symbol, virtual_path);
 	}
 	
-	if (closed)
+	if (closed && build_path)
 	{
 		if (first_subpath.isEmpty())
 			path.closeSubpath();
@@ -190,6 +275,9 @@ LineRenderable::LineRenderable(const LineSymbol* symbol, const VirtualPath& virt
 			path.connectPath(first_subpath);
 	}
 	
+	if (has_hole)
+		gap_length = 0.0f; // Holes must not be closed.
+	
 	// If we do not have the path coords, but there was a curve, calculate path coords.
 	if (has_curve)
 	{
@@ -217,27 +305,6 @@ LineRenderable::LineRenderable(const LineSymbol* symbol, const VirtualPath& virt
 	Q_ASSERT(extent.right() < 999999);	// assert if bogus values are returned
 }
 
-LineRenderable::LineRenderable(const LineSymbol* symbol, QPointF first, QPointF second)
- : Renderable(symbol->getColor())
- , line_width(0.001f * symbol->getLineWidth())
- , cap_style(Qt::FlatCap)
- , join_style(Qt::MiterJoin)
-{
-	qreal half_line_width = (color_priority < 0) ? 0.0f : 0.5f * line_width;
-	
-	auto right = MapCoordF(second - first).perpRight();
-	right.normalize();
-	right *= half_line_width;
-	
-	extent.setTopLeft(first + right);
-	rectInclude(extent, first - right);
-	rectInclude(extent, second - right);
-	rectInclude(extent, second + right);
-	
-	path.moveTo(first);
-	path.lineTo(second);
-}
-
 void LineRenderable::extentIncludeCap(quint32 i, float half_line_width, bool end_cap, const LineSymbol* symbol, const VirtualPath& path)
 {
 	auto coords = path.coords;
@@ -290,6 +357,11 @@ PainterConfig LineRenderable::getPainterConfig(const QPainterPath* clip_path) co
 	return { color_priority, PainterConfig::PenOnly, line_width, clip_path };
 }
 
+qint64 LineRenderable::memoryUsage() const
+{
+	return sizeof(LineRenderable) + pathMemoryUsage(path);
+}
+
 void LineRenderable::render(QPainter &painter, const RenderConfig &config) const
 {
 	QPen pen(painter.pen());
@@ -299,6 +371,13 @@ void LineRenderable::render(QPainter &painter, const RenderConfig &config) const
 		pen.setMiterLimit(LineSymbol::miterLimit());
 	painter.setPen(pen);
 	
+	if (gap_length > 0.0f && config.isBelowDetailLimit(gap_length))
+	{
+		// The gaps would not be recognized.
+		painter.drawPath(solidPath());
+		return;
+	}
+	
 	// One-time adjustment for line width
 	QRectF bounding_box = config.bounding_box.adjusted(-line_width, -line_width, line_width, line_width);
 	const int count = path.elementCount();
@@ -450,6 +529,94 @@ void LineRenderable::render(QPainter &painter, const RenderConfig &config) const
 	painter.setPen(pen);*/
 }
 
+QPainterPath LineRenderable::solidPath() const
+{
+	QPainterPath solid_path;
+	const int count = path.elementCount();
+	for (int i = 0; i < count; ++i)
+	{
+		const QPainterPath::Element& element = path.elementAt(i);
+		if (element.isCurveTo())
+		{
+			Q_ASSERT(i < count - 2);
+			solid_path.cubicTo(element, path.elementAt(i + 1), path.elementAt(i + 2));
+			i += 2;
+		}
+		else if (element.isMoveTo() && i == 0)
+		{
+			solid_path.moveTo(element);
+		}
+		else
+		{
+			solid_path.lineTo(element);
+		}
+	}
+	return solid_path;
+}
+
+
+
+// ### HatchingRenderable ###
+
+HatchingRenderable::HatchingRenderable(const LineSymbol* symbol, qreal line_spacing, const QVector<QLineF>& lines)
+ : Renderable(symbol->getColor())
+ , line_width(0.001f * symbol->getLineWidth())
+ , line_spacing(line_spacing)
+ , lines(lines)
+{
+	Q_ASSERT(!lines.isEmpty());
+	
+	extent = QRectF(lines.front().p1(), lines.front().p2()).normalized();
+	for (const QLineF& line : lines)
+	{
+		rectInclude(extent, line.p1());
+		rectInclude(extent, line.p2());
+	}
+	const qreal half_line_width = (color_priority < 0) ? 0.0 : 0.5 * line_width;
+	extent.adjust(-half_line_width, -half_line_width, half_line_width, half_line_width);
+}
+
+PainterConfig HatchingRenderable::getPainterConfig(const QPainterPath* clip_path) const
+{
+	return { color_priority, PainterConfig::PenOnly, line_width, clip_path };
+}
+
+qint64 HatchingRenderable::memoryUsage() const
+{
+	return sizeof(HatchingRenderable) + vectorMemoryUsage(lines);
+}
+
+void HatchingRenderable::render(QPainter& painter, const RenderConfig& config) const
+{
+	if (config.isBelowDetailLimit(line_spacing))
+	{
+		// The lines would not be recognized. Tint the clip area.
+		painter.save();
+		painter.setBrush(painter.pen().brush());
+		painter.setPen(Qt::NoPen);
+		painter.setOpacity(painter.opacity() * qMin(qreal(1.0), line_width / line_spacing));
+		painter.drawRect(extent);
+		painter.restore();
+		return;
+	}
+	
+	QPen pen(painter.pen());
+	pen.setCapStyle(Qt::FlatCap);
+	painter.setPen(pen);
+	
+	const QRectF bounding_box = config.bounding_box.adjusted(-line_width, -line_width, line_width, line_width);
+	QVector<QLineF> visible_lines;
+	visible_lines.reserve(lines.size());
+	for (const QLineF& line : lines)
+	{
+		if (QRectF(line.p1(), line.p2()).normalized().intersects(bounding_box))
+			visible_lines.push_back(line);
+	}
+	painter.drawLines(visible_lines);
+}
+
+
+
 // ### AreaRenderable ###
 
 AreaRenderable::AreaRenderable(const AreaSymbol* symbol, const PathPartVector& path_parts)
@@ -460,15 +627,13 @@ AreaRenderable::AreaRenderable(const AreaSymbol* symbol, const PathPartVector& p
 		auto part = begin(path_parts);
 		if (part->size() > 2)
 		{
-			extent = part->path_coords.calculateExtent();
-			addSubpath(*part);
-			
+			// The path coords may not be calculated yet, cf. AreaSymbol::needsPathCoords().
 			auto last = end(path_parts);
-			for (++part; part != last; ++part)
+			for (; part != last; ++part)
 			{
-				rectInclude(extent, part->path_coords.calculateExtent());
 				addSubpath(*part);
 			}
+			extent = pathExtent(path);
 		}
 	}
 	Q_ASSERT(extent.right() < 999999);	// assert if bogus values are returned
@@ -477,8 +642,8 @@ AreaRenderable::AreaRenderable(const AreaSymbol* symbol, const PathPartVector& p
 AreaRenderable::AreaRenderable(const AreaSymbol* symbol, const VirtualPath& virtual_path)
  : Renderable(symbol->getColor())
 {
-	extent = virtual_path.path_coords.calculateExtent();
 	addSubpath(virtual_path);
+	extent = pathExtent(path);
 }
 
 void AreaRenderable::addSubpath(const VirtualPath& virtual_path)
@@ -495,6 +660,7 @@ void AreaRenderable::addSubpath(const VirtualPath& virtual_path)
 		{
 			Q_ASSERT(i+2 < coords.size());
 			path.cubicTo(coords[i], coords[i+1], coords[i+2]);
+			has_curves = true;
 			i += 2;
 		}
 		else
@@ -507,11 +673,54 @@ void AreaRenderable::addSubpath(const VirtualPath& virtual_path)
 
 PainterConfig AreaRenderable::getPainterConfig(const QPainterPath* clip_path) const
 {
-	return { color_priority, PainterConfig::BrushOnly, 0, clip_path };
+	return { color_priority, PainterConfig::AreaFill, 0, clip_path };
+}
+
+qint64 AreaRenderable::memoryUsage() const
+{
+	auto usage = qint64(sizeof(AreaRenderable)) + pathMemoryUsage(path);
+	if (auto flattened_path = std::atomic_load(&flattened))
+		usage += qint64(sizeof(FlattenedPath)) + pathMemoryUsage(flattened_path->path);
+	return usage;
+}
+
+std::shared_ptr<const AreaRenderable::FlattenedPath> AreaRenderable::flattenedPath(qreal scale) const
+{
+	// Zoom buckets are powers of two. Flattening is done at the upper end
+	// of the bucket, so the error stays below half a pixel.
+	const int zoom_bucket = qCeil(std::log2(scale));
+	auto flattened_path = std::atomic_load(&flattened);
+	if (flattened_path && flattened_path->zoom_bucket == zoom_bucket)
+		return flattened_path;
+	
+	const qreal bucket_scale = std::ldexp(1.0, zoom_bucket);
+	auto new_path = std::make_shared<FlattenedPath>();
+	new_path->zoom_bucket = zoom_bucket;
+	new_path->path.setFillRule(path.fillRule());
+	const auto to_bucket = QTransform::fromScale(bucket_scale, bucket_scale);
+	const auto from_bucket = QTransform::fromScale(1/bucket_scale, 1/bucket_scale);
+	for (const QPolygonF& polygon : path.toSubpathPolygons(to_bucket))
+	{
+		new_path->path.addPolygon(from_bucket.map(polygon));
+		new_path->path.closeSubpath();
+	}
+	
+	// Concurrent renderers may replace each other's result. That is harmless.
+	flattened_path = std::move(new_path);
+	std::atomic_store(&flattened, flattened_path);
+	return flattened_path;
 }
 
-void AreaRenderable::render(QPainter &painter, const RenderConfig &) const
+void AreaRenderable::render(QPainter &painter, const RenderConfig &config) const
 {
+	const qreal scale = std::sqrt(qAbs(painter.transform().determinant()));
+	if (has_curves && config.testFlag(RenderConfig::Screen)
+	    && path.elementCount() >= min_flattened_area_elements && scale > 0)
+	{
+		painter.drawPath(flattenedPath(scale)->path);
+		return;
+	}
+	
 	painter.drawPath(path);
 	
 	// DEBUG: show all control points
@@ -529,6 +738,144 @@ void AreaRenderable::render(QPainter &painter, const RenderConfig &) const
 	painter.setBrush(brush);*/
 }
 
+// ### PatternRenderable ###
+
+PatternRenderable::PatternRenderable(const PainterConfig& config, const SharedRenderables::Pointer& container,
+                                     const QVector<QPointF>& positions, const QVector<qreal>& rotations,
+                                     bool fill)
+ : Renderable(*container->find(config)->second.front()) // copies the color priority
+ , mode(config.mode)
+ , pen_width(config.pen_width)
+ , fill(fill)
+ , prototype_container(container)
+ , prototype(container->find(config)->second)
+ , positions(positions)
+ , rotations(rotations)
+{
+	Q_ASSERT(!prototype.empty());
+	Q_ASSERT(!positions.isEmpty());
+	Q_ASSERT(rotations.isEmpty() || rotations.size() == positions.size());
+	Q_ASSERT(!config.clip_path);
+	
+	prototype_extent = prototype.front()->getExtent();
+	for (const Renderable* renderable : prototype)
+		rectInclude(prototype_extent, renderable->getExtent());
+	
+	// The radius of a circle around the origin which contains the prototype
+	prototype_radius = 0.0;
+	for (const QPointF& corner : { prototype_extent.topLeft(), prototype_extent.topRight(),
+	                               prototype_extent.bottomLeft(), prototype_extent.bottomRight() })
+		prototype_radius = qMax(prototype_radius, qSqrt(corner.x() * corner.x() + corner.y() * corner.y()));
+	
+	extent = instanceExtent(0);
+	for (int i = 1; i < positions.size(); ++i)
+		rectInclude(extent, instanceExtent(i));
+}
+
+PatternRenderable::~PatternRenderable()
+{
+	// The prototype renderables are deleted by their container.
+}
+
+PainterConfig PatternRenderable::getPainterConfig(const QPainterPath* clip_path) const
+{
+	return { color_priority, mode, pen_width, clip_path };
+}
+
+qint64 PatternRenderable::memoryUsage() const
+{
+	qint64 prototype_usage = qint64(prototype.capacity() * sizeof(Renderable*));
+	for (const Renderable* renderable : prototype)
+		prototype_usage += renderable->memoryUsage();
+	
+	// A shared prototype is accounted in equal shares.
+	return sizeof(PatternRenderable)
+	       + vectorMemoryUsage(positions)
+	       + vectorMemoryUsage(rotations)
+	       + prototype_usage / qMax(1, prototype_container->ref.load());
+}
+
+inline
+QTransform PatternRenderable::instanceTransform(int i) const
+{
+	const QPointF& position = positions[i];
+	if (rotations.isEmpty() || rotations[i] == 0.0)
+		return QTransform::fromTranslate(position.x(), position.y());
+	
+	const qreal cosr = qCos(rotations[i]);
+	const qreal sinr = qSin(rotations[i]);
+	return QTransform(cosr, sinr, -sinr, cosr, position.x(), position.y());
+}
+
+inline
+QRectF PatternRenderable::instanceExtent(int i) const
+{
+	const QPointF& position = positions[i];
+	if (rotations.isEmpty() || rotations[i] == 0.0)
+		return prototype_extent.translated(position);
+	
+	// Both the circle around the origin and the rotated extent contain the instance.
+	const QRectF circle_extent(position.x() - prototype_radius, position.y() - prototype_radius,
+	                           2 * prototype_radius, 2 * prototype_radius);
+	return circle_extent.intersected(instanceTransform(i).mapRect(prototype_extent));
+}
+
+void PatternRenderable::render(QPainter& painter, const RenderConfig& config) const
+{
+	if (fill && config.isBelowDetailLimit(qMax(prototype_extent.width(), prototype_extent.height())))
+	{
+		// The single elements would not be recognized. Tint the clip area
+		// according to the (approximate) coverage by the pattern.
+		const qreal prototype_area = prototype_extent.width() * prototype_extent.height();
+		const qreal coverage = positions.size() * prototype_area / (extent.width() * extent.height());
+		painter.save();
+		if (mode == PainterConfig::PenOnly)
+			painter.setBrush(painter.pen().brush());
+		painter.setPen(Qt::NoPen);
+		painter.setOpacity(painter.opacity() * qMin(qreal(1.0), coverage));
+		painter.drawRect(extent);
+		painter.restore();
+		return;
+	}
+	
+#if defined(QT_PRINTSUPPORT_LIB)
+	if (positions.size() > 1 && AdvancedPdfPrinter::beginForm(painter))
+	{
+		// Write the prototype to the PDF file once, and place it per instance.
+		const QRectF form_box = prototype_extent.adjusted(-pen_width, -pen_width, pen_width, pen_width);
+		RenderConfig form_config = config;
+		form_config.bounding_box = form_box;
+		for (const Renderable* renderable : prototype)
+			renderable->render(painter, form_config);
+		const int form = AdvancedPdfPrinter::endForm(painter, form_box);
+		
+		for (int i = 0; i < positions.size(); ++i)
+		{
+			if (instanceExtent(i).intersects(config.bounding_box))
+				AdvancedPdfPrinter::drawForm(painter, form, instanceTransform(i));
+		}
+		return;
+	}
+#endif
+	
+	const QTransform transform = painter.worldTransform();
+	RenderConfig instance_config = config;
+	for (int i = 0; i < positions.size(); ++i)
+	{
+		if (!instanceExtent(i).intersects(config.bounding_box))
+			continue;
+		
+		const QTransform instance_transform = instanceTransform(i);
+		painter.setWorldTransform(instance_transform * transform);
+		instance_config.bounding_box = instance_transform.inverted().mapRect(config.bounding_box);
+		for (const Renderable* renderable : prototype)
+			renderable->render(painter, instance_config);
+	}
+	painter.setWorldTransform(transform);
+}
+
+
+
 // ### TextRenderable ###
 
 TextRenderable::TextRenderable(const TextSymbol* symbol, const TextObject* text_object, const MapColor* color, double anchor_x, double anchor_y, bool framing_line)
@@ -546,39 +893,61 @@ TextRenderable::TextRenderable(const TextSymbol* symbol, const TextObject* text_
 	path.setFillRule(Qt::WindingFill);	// Otherwise, when text and an underline intersect, holes appear
 	
 	int num_lines = text_object->getNumLines();
-	for (int i=0; i < num_lines; i++)
+	line_boxes.reserve(num_lines);
+	for (int i = 0; i < num_lines; ++i)
 	{
 		const TextObjectLineInfo* line_info = text_object->getLineInfo(i);
-		
-		double line_y = line_info->line_y;
-		
-		double underline_x0 = 0.0;
-		double underline_y0 = line_info->line_y + metrics.underlinePos();
-		double underline_y1 = underline_y0 + metrics.lineWidth();
-		
-		int num_parts = line_info->part_infos.size();
-		for (int j=0; j < num_parts; j++)
+		line_boxes.push_back(QRectF(line_info->line_x, line_info->line_y - line_info->ascent,
+		                            line_info->width, line_info->ascent + line_info->descent));
+	}
+	line_height = scale_factor * metrics.height();
+	
+	if (num_lines == 1 && text_object->getLineInfo(0)->part_infos.size() == 1)
+	{
+		// Share the symbol's cached outline.
+		const TextObjectLineInfo* line_info = text_object->getLineInfo(0);
+		const TextObjectPartInfo& part(line_info->part_infos.front());
+		path = symbol->getShapedText(part.part_text).path;
+		path_offset = QPointF(part.part_x, line_info->line_y);
+	}
+	else
+	{
+		for (int i=0; i < num_lines; i++)
 		{
-			const TextObjectPartInfo& part(line_info->part_infos.at(j));
-			if (font.underline())
+			const TextObjectLineInfo* line_info = text_object->getLineInfo(i);
+			
+			double line_y = line_info->line_y;
+			
+			double underline_x0 = 0.0;
+			double underline_y0 = line_info->line_y + metrics.underlinePos();
+			double underline_y1 = underline_y0 + metrics.lineWidth();
+			
+			int num_parts = line_info->part_infos.size();
+			for (int j=0; j < num_parts; j++)
 			{
-				if (j > 0)
+				const TextObjectPartInfo& part(line_info->part_infos.at(j));
+				if (font.underline())
 				{
-					// draw underline for gap between parts as rectangle
-					// TODO: watch out for inconsistency between text and gap underline
-					path.moveTo(underline_x0, underline_y0);
-					path.lineTo(part.part_x,  underline_y0);
-					path.lineTo(part.part_x,  underline_y1);
-					path.lineTo(underline_x0, underline_y1);
-					path.closeSubpath();
+					if (j > 0)
+					{
+						// draw underline for gap between parts as rectangle
+						// TODO: watch out for inconsistency between text and gap underline
+						path.moveTo(underline_x0, underline_y0);
+						path.lineTo(part.part_x,  underline_y0);
+						path.lineTo(part.part_x,  underline_y1);
+						path.lineTo(underline_x0, underline_y1);
+						path.closeSubpath();
+					}
+					underline_x0 = part.part_x;
 				}
-				underline_x0 = part.part_x;
+				QPainterPath part_path = symbol->getShapedText(part.part_text).path;
+				part_path.translate(part.part_x, line_y);
+				path.addPath(part_path);
 			}
-			path.addText(part.part_x, line_y, font, part.part_text);
 		}
 	}
 	
-	extent = path.controlPointRect();
+	extent = path.controlPointRect().translated(path_offset);
 	extent = QRectF(scale_factor * (extent.left() - 0.5f * framing_line_width),
 					scale_factor * (extent.top() - 0.5f * framing_line_width),
 					scale_factor * (extent.width() + framing_line_width),
@@ -616,8 +985,18 @@ PainterConfig TextRenderable::getPainterConfig(const QPainterPath* clip_path) co
 	                    : PainterConfig{ color_priority, PainterConfig::BrushOnly, 0, clip_path };
 }
 
+qint64 TextRenderable::memoryUsage() const
+{
+	return sizeof(TextRenderable) + pathMemoryUsage(path) + vectorMemoryUsage(line_boxes);
+}
+
 void TextRenderable::render(QPainter &painter, const RenderConfig &config) const
 {
+	// Text which is too small to be read is drawn as a box for each line.
+	const bool draw_boxes = config.isBelowDetailLimit(0.25 * line_height);
+	if (draw_boxes && framing_line)
+		return;
+	
 	painter.save();
 	
 	bool disable_antialiasing = config.options.testFlag(RenderConfig::Screen) && !(Settings::getInstance().getSettingCached(Settings::MapDisplay_TextAntialiasing).toBool());
@@ -639,7 +1018,16 @@ void TextRenderable::render(QPainter &painter, const RenderConfig &config) const
 	if (rotation != 0)
 		painter.rotate(-rotation * 180 / M_PI);
 	painter.scale(scale_factor, scale_factor);
-	painter.drawPath(path);
+	if (draw_boxes)
+	{
+		painter.setOpacity(0.5 * painter.opacity());
+		painter.drawRects(line_boxes);
+	}
+	else
+	{
+		painter.translate(path_offset);
+		painter.drawPath(path);
+	}
 	
 	painter.restore();
 }
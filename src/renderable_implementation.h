@@ -22,7 +22,11 @@
 #ifndef _OPENORIENTEERING_RENDERABLE_IMPLENTATION_H_
 #define _OPENORIENTEERING_RENDERABLE_IMPLENTATION_H_
 
+#include <memory>
+
+#include <QLineF>
 #include <QPainter>
+#include <QVector>
 
 #include "object.h"
 #include "renderable.h"
@@ -49,6 +53,7 @@ public:
 	DotRenderable(const PointSymbol* symbol, MapCoordF coord);
 	virtual void render(QPainter& painter, const RenderConfig& config) const override;
 	virtual PainterConfig getPainterConfig(const QPainterPath* clip_path = nullptr) const override;
+	virtual qint64 memoryUsage() const override;
 };
 
 /** Renderable for displaying a circle. */
@@ -58,6 +63,7 @@ public:
 	CircleRenderable(const PointSymbol* symbol, MapCoordF coord);
 	virtual void render(QPainter& painter, const RenderConfig& config) const override;
 	virtual PainterConfig getPainterConfig(const QPainterPath* clip_path = nullptr) const override;
+	virtual qint64 memoryUsage() const override;
 	
 protected:
 	const float line_width;
@@ -69,22 +75,68 @@ class LineRenderable : public Renderable
 {
 public:
 	LineRenderable(const LineSymbol* symbol, const VirtualPath& virtual_path, bool closed);
-	LineRenderable(const LineSymbol* symbol, QPointF first, QPointF second);
+	
+	/**
+	 * Constructs a renderable for the same path as another line renderable,
+	 * but with another symbol.
+	 * 
+	 * The painter path is shared with same_path. Only the extent, which
+	 * depends on the line width, caps and joins, is calculated.
+	 */
+	LineRenderable(const LineSymbol* symbol, const VirtualPath& virtual_path, bool closed, const LineRenderable& same_path);
+	
 	virtual void render(QPainter& painter, const RenderConfig& config) const override;
 	virtual PainterConfig getPainterConfig(const QPainterPath* clip_path = nullptr) const override;
+	virtual qint64 memoryUsage() const override;
 	
 protected:
+	/**
+	 * Calculates the extent, and the painter path and the gap length
+	 * unless build_path is false.
+	 */
+	void build(const LineSymbol* symbol, const VirtualPath& virtual_path, bool closed, bool build_path);
+	
 	void extentIncludeCap(quint32 i, float half_line_width, bool end_cap, const LineSymbol* symbol, const VirtualPath& path);
 	
 	void extentIncludeJoin(quint32 i, float half_line_width, const LineSymbol* symbol, const VirtualPath& path);
 	
+	/** Returns the path with the gaps closed. */
+	QPainterPath solidPath() const;
+	
 	const float line_width;
+	float gap_length;  ///< The length of the longest gap, or 0 if the gaps must be kept.
 	QPainterPath path;
 	Qt::PenCapStyle cap_style;
 	Qt::PenJoinStyle join_style;
 };
 
-/** Renderable for displaying an area. */
+/**
+ * Renderable for displaying the lines of a line pattern fill.
+ * 
+ * The lines are clipped to an area. With reduced detail, narrowly spaced
+ * lines are drawn as a tinted fill of the clip area.
+ */
+class HatchingRenderable : public Renderable
+{
+public:
+	HatchingRenderable(const LineSymbol* symbol, qreal line_spacing, const QVector<QLineF>& lines);
+	virtual void render(QPainter& painter, const RenderConfig& config) const override;
+	virtual PainterConfig getPainterConfig(const QPainterPath* clip_path = nullptr) const override;
+	virtual qint64 memoryUsage() const override;
+	
+protected:
+	const float line_width;
+	const qreal line_spacing;
+	QVector<QLineF> lines;
+};
+
+/**
+ * Renderable for displaying an area.
+ * 
+ * On the screen, large areas with curves are filled from a copy of the path
+ * with the curves flattened for the current zoom level. This copy is kept
+ * for further repaints at similar zoom levels, in all threads.
+ */
 class AreaRenderable : public Renderable
 {
 public:
@@ -92,13 +144,79 @@ public:
 	AreaRenderable(const AreaSymbol* symbol, const VirtualPath& path);
 	virtual void render(QPainter& painter, const RenderConfig& config) const override;
 	virtual PainterConfig getPainterConfig(const QPainterPath* clip_path = nullptr) const override;
+	virtual qint64 memoryUsage() const override;
 	
 	inline const QPainterPath* painterPath() const;
 	
 protected:
 	void addSubpath(const VirtualPath& virtual_path);
 	
+	/** The path with flattened curves, for a particular zoom bucket. */
+	struct FlattenedPath
+	{
+		int zoom_bucket;
+		QPainterPath path;
+	};
+	
+	/** Returns the path with flattened curves for the given scale. */
+	std::shared_ptr<const FlattenedPath> flattenedPath(qreal scale) const;
+	
 	QPainterPath path;
+	bool has_curves = false;
+	mutable std::shared_ptr<const FlattenedPath> flattened;  ///< Accessed atomically.
+};
+
+/**
+ * Renderable for displaying the same renderables at many positions.
+ * 
+ * This is used for the point patterns of area fills, and for the dash and
+ * mid symbols of lines. The prototype renderables are given relative to the
+ * origin, and they are rotated and translated to each position when
+ * rendering. This needs much less memory than separate renderables for each
+ * point. The painter still receives the exact geometry of each point, so
+ * vector output is not affected.
+ */
+class PatternRenderable : public Renderable
+{
+public:
+	/**
+	 * Constructs a pattern renderable for the prototype renderables of the
+	 * given painter configuration, which must not have a clip path.
+	 * 
+	 * The prototype container is shared, i.e. several pattern renderables
+	 * may draw the same prototype renderables. The container must not be
+	 * modified afterwards.
+	 * 
+	 * The rotations (in radians) are either empty, or they have the same
+	 * size as the positions.
+	 * 
+	 * A fill pattern is clipped to an area. With reduced detail, it may be
+	 * drawn as a tinted fill of the clip area.
+	 */
+	PatternRenderable(const PainterConfig& config, const SharedRenderables::Pointer& prototype,
+	                  const QVector<QPointF>& positions, const QVector<qreal>& rotations,
+	                  bool fill);
+	virtual ~PatternRenderable() override;
+	virtual void render(QPainter& painter, const RenderConfig& config) const override;
+	virtual PainterConfig getPainterConfig(const QPainterPath* clip_path = nullptr) const override;
+	virtual qint64 memoryUsage() const override;
+	
+protected:
+	/** Returns the transformation from prototype coordinates for the instance at index i. */
+	QTransform instanceTransform(int i) const;
+	
+	/** Returns the extent of the instance at index i. */
+	QRectF instanceExtent(int i) const;
+	
+	const PainterConfig::PainterMode mode;
+	const qreal pen_width;
+	const bool fill;
+	const SharedRenderables::Pointer prototype_container;
+	const RenderableVector& prototype;
+	QRectF prototype_extent;
+	qreal prototype_radius;
+	QVector<QPointF> positions;
+	QVector<qreal> rotations;
 };
 
 /** Renderable for displaying text. */
@@ -108,9 +226,13 @@ public:
 	TextRenderable(const TextSymbol* symbol, const TextObject* text_object, const MapColor* color, double anchor_x, double anchor_y, bool framing_line = false);
 	virtual void render(QPainter& painter, const RenderConfig& config) const override;
 	virtual PainterConfig getPainterConfig(const QPainterPath* clip_path = nullptr) const override;
+	virtual qint64 memoryUsage() const override;
 	
 protected:
 	QPainterPath path;
+	QPointF path_offset;
+	QVector<QRectF> line_boxes;  ///< For drawing small text with reduced detail
+	double line_height;
 	double anchor_x;
 	double anchor_y;
 	double rotation;
@@ -29,6 +29,7 @@
 #include <QStringList>
 
 #include "util.h"
+#include "core/task_pool.h"
 
 Settings::Settings()
  : QObject()
@@ -38,6 +39,8 @@ Settings::Settings()
 	float map_editor_click_tolerance_default;
 	float map_editor_snap_distance_default;
 	int start_drag_distance_default;
+	int image_memory_limit_mb_default;
+	bool reduced_color_depth_default;
 	
 	// Platform-specific settings defaults
 	#if defined(ANDROID)
@@ -45,11 +48,15 @@ Settings::Settings()
 		map_editor_click_tolerance_default = 4.0f;
 		map_editor_snap_distance_default = 15.0f;
 		start_drag_distance_default = Util::mmToPixelLogical(3.0f);
+		image_memory_limit_mb_default = 128;
+		reduced_color_depth_default = true;
 	#else
 		symbol_widget_icon_size_mm_default = 8;
 		map_editor_click_tolerance_default = 3.0f;
 		map_editor_snap_distance_default = 10.0f;
 		start_drag_distance_default = QApplication::startDragDistance();
+		image_memory_limit_mb_default = 512;
+		reduced_color_depth_default = false;
 	#endif
 	
 	qreal ppi = QApplication::primaryScreen()->physicalDotsPerInch();
@@ -58,6 +65,9 @@ Settings::Settings()
 		ppi = QApplication::primaryScreen()->logicalDotsPerInch();
 	
 	registerSetting(MapDisplay_TextAntialiasing, "MapDisplay/text_antialiasing", false);
+	registerSetting(MapDisplay_CacheMargin, "MapDisplay/cache_margin_px", 256); // 0: disabled
+	registerSetting(MapDisplay_ReducedColorDepth, "MapDisplay/reduced_color_depth", reduced_color_depth_default);
+	registerSetting(MapDisplay_PixelRatioPolicy, "MapDisplay/pixel_ratio_policy", (int)PixelRatio_NativeWhenIdle);
 	registerSetting(MapEditor_ClickToleranceMM, "MapEditor/click_tolerance_mm", map_editor_click_tolerance_default);
 	registerSetting(MapEditor_SnapDistanceMM, "MapEditor/snap_distance_mm", map_editor_snap_distance_default);
 	registerSetting(MapEditor_FixedAngleStepping, "MapEditor/fixed_angle_stepping", 15);
@@ -72,6 +82,11 @@ Settings::Settings()
 	registerSetting(RectangleTool_PreviewLineWidth, "RectangleTool/preview_line_with", true);
 	
 	registerSetting(Templates_KeepSettingsOfClosed, "Templates/keep_settings_of_closed_templates", true);
+	registerSetting(Templates_ImageMemoryLimitMB, "Templates/image_memory_limit_mb", image_memory_limit_mb_default);
+	registerSetting(Templates_LoadOnDemand, "Templates/load_on_demand", false);
+	registerSetting(Templates_UnloadIdleMinutes, "Templates/unload_idle_minutes", 10); // 0: never
+	registerSetting(Templates_ImageCacheMB, "Templates/image_cache_mb", 2048); // 0: disabled
+	registerSetting(Templates_TrackImportToleranceMM, "Templates/track_import_tolerance_mm", 0.05); // 0: no simplification
 	
 	registerSetting(ActionGridBar_ButtonSizeMM, "ActionGridBar/button_size_mm", touch_button_minimum_size_default);
 	registerSetting(SymbolWidget_IconSizeMM, "SymbolWidget/icon_size_mm", symbol_widget_icon_size_mm_default);
@@ -85,7 +100,12 @@ Settings::Settings()
 	registerSetting(General_OpenMRUFile, "openMRUFile", false);
 	registerSetting(General_Local8BitEncoding, "local_8bit_encoding", "Windows-1252");
 	registerSetting(General_NewOcd8Implementation, "new_ocd8_implementation_v0.6", true);
+	registerSetting(General_DeferMapPartLoading, "deferMapPartLoading", false);
 	registerSetting(General_StartDragDistance, "startDragDistance", start_drag_distance_default);
+	registerSetting(General_UndoMemoryLimitMB, "undoMemoryLimit", 64); // unit: MiB
+	registerSetting(General_SavedUndoSteps, "savedUndoSteps", 128);
+	registerSetting(General_PowerSaving, "powerSaving", false);
+	registerSetting(General_MaxThreads, "maxThreads", 0); // 0: automatic
 	
 	registerSetting(HomeScreen_TipsVisible, "HomeScreen/tipsVisible", true);
 	registerSetting(HomeScreen_CurrentTip, "HomeScreen/currentTip", -1);
@@ -202,6 +222,7 @@ void Settings::applySettings()
 	
 	// Invalidate cache as settings could be changed
 	settings_cache.clear();
+	TaskPool::applySettings();
 	emit settingsChanged();
 }
 
@@ -41,6 +41,9 @@ public:
 	{
 		MapDisplay_Antialiasing = 0,
 		MapDisplay_TextAntialiasing,
+		MapDisplay_CacheMargin,
+		MapDisplay_ReducedColorDepth,
+		MapDisplay_PixelRatioPolicy,
 		MapEditor_ClickToleranceMM,
 		MapEditor_SnapDistanceMM,
 		MapEditor_FixedAngleStepping,
@@ -52,6 +55,11 @@ public:
 		RectangleTool_HelperCrossRadiusMM,
 		RectangleTool_PreviewLineWidth,
 		Templates_KeepSettingsOfClosed,
+		Templates_ImageMemoryLimitMB,
+		Templates_LoadOnDemand,
+		Templates_UnloadIdleMinutes,
+		Templates_ImageCacheMB,
+		Templates_TrackImportToleranceMM,
 		SymbolWidget_IconSizeMM,
 		ActionGridBar_ButtonSizeMM,
 		General_RetainCompatiblity,
@@ -63,7 +71,12 @@ public:
 		General_OpenMRUFile,
 		General_Local8BitEncoding,
 		General_NewOcd8Implementation,
+		General_DeferMapPartLoading,
 		General_StartDragDistance,
+		General_UndoMemoryLimitMB,
+		General_SavedUndoSteps,
+		General_PowerSaving,
+		General_MaxThreads,
 		HomeScreen_TipsVisible,
 		HomeScreen_CurrentTip,
 		END_OF_SETTINGSENUM /* Don't add items below this line. */
@@ -76,6 +89,15 @@ public:
 		DeleteBezierPoint_KeepHandles
 	};
 	
+	/// The resolution of the map display caches on high-dpi screens
+	enum PixelRatioPolicy
+	{
+		PixelRatio_Logical = 0,      ///< Logical pixels, scaled up by the screen
+		PixelRatio_Native,           ///< Native pixels for the map and the templates
+		PixelRatio_NativeMapOnly,    ///< Native pixels for the map, logical pixels for the templates
+		PixelRatio_NativeWhenIdle    ///< Like PixelRatio_NativeMapOnly, but logical pixels while zooming or rotating
+	};
+	
 	/// Retrieve a setting from QSettings without caching
 	QVariant getSetting(SettingsEnum setting) const;
 	
@@ -9,7 +9,7 @@ CONFIG  -= debug_and_release
 
 include(../oo-mapper-version.pri)
 include($$OUT_PWD/../prerequisites.pri)
-LIBS *= -lpolyclipping -lqtsingleapplication -locd
+LIBS *= -lpolyclipping -lqtsingleapplication -locd -lz
 win32: LIBS *= -lproj-9
 else:  LIBS *= -lproj
 
@@ -33,6 +33,7 @@ else {
 	           QT_NO_DEBUG QT_NO_DEBUG_OUTPUT
 }
 DEFINES += \"CLIPPER_VERSION='\\"6.1.3a\\"'\"
+DEFINES += MAPPER_TRACING
 DEFINES += \"MAPPER_HELP_NAMESPACE='\\"openorienteering.mapper-$${Mapper_VERSION_MAJOR}.$${Mapper_VERSION_MINOR}.$${Mapper_VERSION_PATCH}.help\\"'\"
 
 # Input
@@ -59,6 +60,7 @@ HEADERS += \
   symbol_area.h \
   symbol_combined.h \
   symbol_dialog_replace.h \
+  symbol_icon_renderer.h \
   symbol_line.h \
   symbol_point.h \
   symbol_point_editor.h \
@@ -70,6 +72,8 @@ HEADERS += \
   template_dialog_reopen.h \
   template_track.h \
   template_image.h \
+  template_mosaic.h \
+  template_tile_server.h \
   template_map.h \
   template_position_dock_widget.h \
   template_tool_move.h \
@@ -100,8 +104,11 @@ HEADERS += \
   undo_manager.h \
   util_task_dialog.h \
   core/autosave_p.h \
+  core/background_file_writer.h \
   core/georeferencing.h \
   core/map_printer.h \
+  core/map_thumbnail_cache.h \
+  core/tile_fetcher.h \
   fileformats/ocd_file_format_p.h \
   gui/about_dialog.h \
   gui/autosave_dialog.h \
@@ -111,6 +118,8 @@ HEADERS += \
   gui/home_screen_controller.h \
   gui/main_window.h \
   gui/main_window_controller.h \
+  gui/memory_usage_dialog.h \
+  gui/symbol_cost_dialog.h \
   gui/print_progress_dialog.h \
   gui/print_tool.h \
   gui/print_widget.h \
@@ -127,7 +136,9 @@ HEADERS += \
   gui/widgets/key_button_bar.h \
   gui/widgets/mapper_proxystyle.h \
   gui/widgets/measure_widget.h \
+  gui/widgets/object_search_widget.h \
   gui/widgets/pie_menu.h \
+  gui/widgets/quality_check_widget.h \
   gui/widgets/segmented_button_layout.h \
   gui/widgets/symbol_dropdown.h \
   gui/widgets/symbol_render_widget.h \
@@ -138,15 +149,31 @@ HEADERS += \
   util/item_delegates.h \
   util/overriding_shortcut.h \
   util/recording_translator.h \
+  core/banded_tiff_writer.h \
+  core/batch_exporter.h \
+  core/color_transform.h \
   core/crs_template.h \
   core/crs_template_implementation.h \
+  core/decoded_image_cache.h \
+  core/flat_map.h \
+  core/image_pyramid.h \
   core/image_transparency_fixup.h \
   core/latlon.h \
   core/map_coord.h \
   core/map_grid.h \
+  core/map_tile_exporter.h \
   core/path_coord.h \
+  core/render_statistics.h \
+  core/renderable_arena.h \
+  core/spatial_index.h \
+  core/task_pool.h \
+  core/tiled_image.h \
+  core/tracing.h \
+  core/vector_tile_writer.h \
   core/virtual_path.cpp \
   core/virtual_coord_vector.h \
+  core/warp_grid.h \
+  core/zlib_device.h \
   fileformats/ocd_file_format.h \
   fileformats/ocd_types.h \
   fileformats/ocd_types_v8.h \
@@ -155,29 +182,58 @@ HEADERS += \
   fileformats/ocd_types_v11.h \
   gui/point_handles.h \
   util/scoped_signals_blocker.h \
+  autosave_journal.h \
   map_part.h \
   map_part_undo.h \
+  map_tile_cache.h \
+  memory_usage.h \
+  symbol_cost_report.h \
+  map_quality_check.h \
+  object_statistics.h \
+  map_change_feed.h \
+  startup_timer.h \
+  input_recording.h \
+  render_profiler.h \
   object_operations.h \
   renderable.h \
   renderable_implementation.h \
   symbol.h \
+  symbol_icon_cache.h \
+  packed_coordinates.h \
   undo.h
 
 SOURCES += \
   main.cpp \
   core/autosave.cpp \
+  core/background_file_writer.cpp \
+  core/banded_tiff_writer.cpp \
+  core/batch_exporter.cpp \
+  core/color_transform.cpp \
   core/crs_template.cpp \
   core/crs_template_implementation.cpp \
+  core/decoded_image_cache.cpp \
   core/georeferencing.cpp \
+  core/image_pyramid.cpp \
   core/latlon.cpp \
   core/map_color.cpp \
   core/map_coord.cpp \
   core/map_grid.cpp \
   core/map_printer.cpp \
+  core/map_thumbnail_cache.cpp \
+  core/map_tile_exporter.cpp \
   core/map_view.cpp \
   core/path_coord.cpp \
+  core/render_statistics.cpp \
+  core/renderable_arena.cpp \
+  core/task_pool.cpp \
+  core/tiled_image.cpp \
+  core/tile_fetcher.cpp \
+  core/tracing.cpp \
+  core/vector_tile_writer.cpp \
   core/virtual_path.cpp \
   core/virtual_coord_vector.cpp \
+  core/warp_grid.cpp \
+  core/zlib_device.cpp \
   global.cpp \
   util.cpp \
   util_task_dialog.cpp \
@@ -185,14 +241,24 @@ SOURCES += \
   mapper_resource.cpp \
   undo.cpp \
   undo_manager.cpp \
+  autosave_journal.cpp \
+  memory_usage.cpp \
+  symbol_cost_report.cpp \
+  map_quality_check.cpp \
+  object_statistics.cpp \
+  map_change_feed.cpp \
   matrix.cpp \
   transformation.cpp \
   settings.cpp \
+  startup_timer.cpp \
   map.cpp \
   map_part.cpp \
   map_part_undo.cpp \
   map_widget.cpp \
+  map_tile_cache.cpp \
   touch_cursor.cpp \
+  input_recording.cpp \
+  render_profiler.cpp \
   map_editor.cpp \
   map_editor_activity.cpp \
   object_undo.cpp \
@@ -210,12 +276,17 @@ SOURCES += \
   symbol_area.cpp \
   symbol_text.cpp \
   symbol_combined.cpp \
+  symbol_icon_cache.cpp \
+  symbol_icon_renderer.cpp \
+  packed_coordinates.cpp \
   renderable.cpp \
   renderable_implementation.cpp \
   object.cpp \
   object_text.cpp \
   template.cpp \
   template_image.cpp \
+  template_mosaic.cpp \
+  template_tile_server.cpp \
   template_track.cpp \
   template_map.cpp \
   template_dialog_reopen.cpp \
@@ -269,6 +340,8 @@ SOURCES += \
   gui/main_window.cpp \
   gui/main_window_controller.cpp \
   gui/configure_grid_dialog.cpp \
+  gui/memory_usage_dialog.cpp \
+  gui/symbol_cost_dialog.cpp \
   gui/modifier_key.cpp \
   gui/point_handles.cpp \
   gui/print_progress_dialog.cpp \
@@ -286,7 +359,9 @@ SOURCES += \
   gui/widgets/key_button_bar.cpp \
   gui/widgets/mapper_proxystyle.cpp \
   gui/widgets/measure_widget.cpp \
+  gui/widgets/object_search_widget.cpp \
   gui/widgets/pie_menu.cpp \
+  gui/widgets/quality_check_widget.cpp \
   gui/widgets/segmented_button_layout.cpp \
   gui/widgets/symbol_dropdown.cpp \
   gui/widgets/symbol_render_widget.cpp \
@@ -0,0 +1,99 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "startup_timer.h"
+
+#include <cstdio>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QStringList>
+
+
+namespace
+{
+	struct Phase
+	{
+		const char* name;
+		qint64 nsecs;  ///< The time since the start, in nanoseconds.
+	};
+	
+	QElapsedTimer& clock()
+	{
+		static QElapsedTimer timer;
+		return timer;
+	}
+	
+	std::vector<Phase>& phases()
+	{
+		static std::vector<Phase> recorded;
+		return recorded;
+	}
+}
+
+
+
+bool StartupTimer::active = false;
+
+void StartupTimer::start(int argc, char** argv)
+{
+	active = !qgetenv("MAPPER_STARTUP_TIMING").isEmpty();
+	for (int i = 1; i < argc && !active; ++i)
+		active = qstrcmp(argv[i], "--startup-timing") == 0;
+	
+	if (active)
+	{
+		phases().reserve(32);
+		clock().start();
+	}
+}
+
+void StartupTimer::mark(const char* phase)
+{
+	if (active)
+		phases().push_back({ phase, clock().nsecsElapsed() });
+}
+
+QString StartupTimer::report()
+{
+	QStringList lines;
+	qint64 last = 0;
+	for (const auto& phase : phases())
+	{
+		lines << QString::fromLatin1("%1 %2 ms %3 ms")
+		         .arg(QString::fromLatin1(phase.name) + QLatin1Char(':'), -32)
+		         .arg((phase.nsecs - last) / 1000000.0, 9, 'f', 1)
+		         .arg(phase.nsecs / 1000000.0, 9, 'f', 1);
+		last = phase.nsecs;
+	}
+	return lines.join(QLatin1Char('\n'));
+}
+
+void StartupTimer::finish()
+{
+	if (!active)
+		return;
+	
+	mark("Ready");
+	std::fprintf(stderr, "Startup timing (phase, duration, since start):\n%s\n", qPrintable(report()));
+	active = false;
+	phases().clear();
+	phases().shrink_to_fit();
+}
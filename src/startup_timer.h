@@ -0,0 +1,83 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_STARTUP_TIMER_H_
+#define _OPENORIENTEERING_STARTUP_TIMER_H_
+
+#include <QString>
+
+
+/**
+ * @brief StartupTimer measures the phases of the application startup.
+ *
+ * The timer is started at the beginning of main(). Code which takes part in
+ * the startup calls mark() at the end of each phase. When the first window is
+ * ready for editing, finish() prints the duration of each phase to stderr and
+ * stops the timer. Later calls of mark() and finish() do nothing, so the
+ * functions may be called from code which also runs after startup.
+ *
+ * The timer is active only if the command line contains "--startup-timing",
+ * or if the environment variable MAPPER_STARTUP_TIMING is set. Otherwise,
+ * mark() costs a single test of a flag.
+ *
+ * All functions must be called from the main thread.
+ */
+class StartupTimer
+{
+public:
+	/**
+	 * Starts the timer if the arguments contain "--startup-timing",
+	 * or if the environment variable MAPPER_STARTUP_TIMING is set.
+	 */
+	static void start(int argc, char** argv);
+	
+	/** Returns true if the timer is measuring. */
+	static bool isActive();
+	
+	/**
+	 * Records the end of a startup phase.
+	 *
+	 * The phase is expected to be a string literal.
+	 */
+	static void mark(const char* phase);
+	
+	/**
+	 * Returns a plain text table of the phases recorded so far,
+	 * with the duration of each phase and the time since the start.
+	 */
+	static QString report();
+	
+	/** Prints the report to stderr, and stops the timer. */
+	static void finish();
+
+private:
+	static bool active;
+};
+
+
+
+// ### StartupTimer inline code ###
+
+inline
+bool StartupTimer::isActive()
+{
+	return active;
+}
+
+#endif
@@ -87,6 +87,27 @@ bool Symbol::equals(const Symbol* other, Qt::CaseSensitivity case_sensitivity, b
 	return equalsImpl(other, case_sensitivity);
 }
 
+uint Symbol::contentHash() const
+{
+	// Only members which are compared in equals() are taken into account,
+	// and strings are hashed case-insensitively.
+	auto combine = [](uint hash, uint value) {
+		return hash ^ (value + 0x9e3779b9u + (hash << 6) + (hash >> 2));
+	};
+	
+	uint hash = qHash(int(type));
+	for (int i = 0; i < number_components; ++i)
+	{
+		hash = combine(hash, qHash(number[i]));
+		if (number[i] == -1)
+			break;
+	}
+	hash = combine(hash, qHash(int(is_helper_symbol)));
+	hash = combine(hash, qHash(name.toCaseFolded()));
+	hash = combine(hash, qHash(description.toCaseFolded()));
+	return hash;
+}
+
 const PointSymbol* Symbol::asPoint() const
 {
 	Q_ASSERT(type == Point);
@@ -511,6 +532,16 @@ float Symbol::calculateLargestLineExtent(Map* map) const
 	return 0.0f;
 }
 
+bool Symbol::hasLocalPathOutput() const
+{
+	return false;
+}
+
+bool Symbol::needsPathCoords() const
+{
+	return true;
+}
+
 QString Symbol::getPlainTextName() const
 {
 	if (name.contains('<'))
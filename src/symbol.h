@@ -89,6 +89,7 @@ public:
 	{
 		RenderBaselines    = 1 << 0,   ///< Paint cosmetique contours and baselines
 		RenderAreasHatched = 1 << 1,   ///< Paint hatching instead of opaque fill
+		RenderPreview      = 1 << 2,   ///< Paint plain strokes and contours only, for fast previews
 		RenderNormal       = 0         ///< Paint normally
 	};
 	Q_DECLARE_FLAGS(RenderableOptions, RenderableOption)
@@ -106,6 +107,15 @@ public:
 	 */
 	bool equals(const Symbol* other, Qt::CaseSensitivity case_sensitivity = Qt::CaseSensitive, bool compare_state = false) const;
 	
+	/**
+	 * Returns a hash value of the symbol's content.
+	 * 
+	 * Symbols which are equal according to equals(), in any mode, have the
+	 * same hash value. This allows to find duplicates without comparing each
+	 * pair of symbols.
+	 */
+	uint contentHash() const;
+	
 	
 	/** Returns the type of the symbol */
 	inline Type getType() const {return type;}
@@ -265,6 +275,12 @@ public:
 	/** Clear the symbol's icon. It will be recreated when it is needed. */
 	void resetIcon() { icon = QImage(); }
 	
+	/** Returns true if the symbol's icon is created, i.e. getIcon() will not render it. */
+	bool hasIcon() const { return !icon.isNull(); }
+	
+	/** Set the symbol's icon, e.g. from a cache. It must match createIcon(). */
+	void setIcon(const QImage& image) { icon = image; }
+	
 	/**
 	 * Returns the largest extent (half width) of all line symbols
 	 * which may be included in this symbol.
@@ -272,6 +288,26 @@ public:
 	 */
 	virtual float calculateLargestLineExtent(Map* map) const;
 	
+	/**
+	 * Returns true if moving a coordinate of a path with this symbol changes
+	 * the output only near the adjacent segments, within the largest line
+	 * extent (plus miter joins).
+	 * 
+	 * This is false for symbols which distribute elements along the whole
+	 * path, such as dashes and mid symbols.
+	 */
+	virtual bool hasLocalPathOutput() const;
+	
+	/**
+	 * Returns true if the renderables of paths with this symbol are created
+	 * from the path coords (PathCoordVector), e.g. for dashes, mid symbols or
+	 * lengths.
+	 * 
+	 * If this returns false, PathObject calculates the path coords only
+	 * when they are requested.
+	 */
+	virtual bool needsPathCoords() const;
+	
 	
 	// Getters / Setters
 	
@@ -237,6 +237,14 @@ void AreaSymbol::FillPattern::createRenderables(QRectF extent, float delta_rotat
 	if (point && point->isRotatable())
 		point_object.setRotation(delta_rotation);
 	
+	// For point patterns, the renderables of a single point at the origin,
+	// and the positions where they are to be drawn
+	ObjectRenderables point_renderables(point_object);
+	QVector<QPointF> point_positions;
+	
+	// For line patterns, the lines to be drawn
+	QVector<QLineF> lines;
+	
 	MapCoordF first, second;
 	
 	// Determine real extent to fill
@@ -253,9 +261,8 @@ void AreaSymbol::FillPattern::createRenderables(QRectF extent, float delta_rotat
 	}
 	else
 	{
-		// TODO: Ugly method to get the point's extent
-		point_object.update();
-		fill_extent = point_object.getExtent();
+		point->createRenderablesScaled(MapCoordF(0, 0), -point_object.getRotation(), point_renderables);
+		fill_extent = point_renderables.getExtent();
 	}
 	extent = QRectF(extent.topLeft() - fill_extent.bottomRight(), extent.bottomRight() - fill_extent.topLeft());
 	
@@ -286,7 +293,7 @@ void AreaSymbol::FillPattern::createRenderables(QRectF extent, float delta_rotat
 		{
 			first = MapCoordF(cur, extent.top());
 			second = MapCoordF(cur, extent.bottom());
-			createLine(first, second, delta_along_line_offset, &line, &point_object, output);
+			createLine(first, second, delta_along_line_offset, lines, point_positions);
 		}
 	}
 	else if (qAbs(rotation - 0) < 0.0001)
@@ -297,7 +304,7 @@ void AreaSymbol::FillPattern::createRenderables(QRectF extent, float delta_rotat
 		{
 			first = MapCoordF(extent.left(), cur);
 			second = MapCoordF(extent.right(), cur);
-			createLine(first, second, delta_along_line_offset, &line, &point_object, output);
+			createLine(first, second, delta_along_line_offset, lines, point_positions);
 		}
 	}
 	else
@@ -344,7 +351,7 @@ void AreaSymbol::FillPattern::createRenderables(QRectF extent, float delta_rotat
 				// Create the renderable(s)
 				first = MapCoordF(start_x, start_y);
 				second = MapCoordF(end_x, end_y);
-				createLine(first, second, delta_along_line_offset, &line, &point_object, output);
+				createLine(first, second, delta_along_line_offset, lines, point_positions);
 				
 				// Move to next position
 				start_x += dist_x;
@@ -381,7 +388,7 @@ void AreaSymbol::FillPattern::createRenderables(QRectF extent, float delta_rotat
 				// Create the renderable(s)
 				first = MapCoordF(start_x, start_y);
 				second = MapCoordF(end_x, end_y);
-				createLine(first, second, delta_along_line_offset, &line, &point_object, output);
+				createLine(first, second, delta_along_line_offset, lines, point_positions);
 				
 				// Move to next position
 				start_x += dist_x;
@@ -389,13 +396,24 @@ void AreaSymbol::FillPattern::createRenderables(QRectF extent, float delta_rotat
 			} while (true);
 		}
 	}
+	
+	if (!lines.isEmpty())
+		output.insertRenderable(new HatchingRenderable(&line, line_spacing_f, lines));
+	
+	if (!point_positions.isEmpty() && !output.insertPatternRenderables(point_renderables, point_positions))
+	{
+		// The point cannot be drawn as a pattern, so create the renderables for each position.
+		const float point_rotation = -point_object.getRotation();
+		for (const QPointF& position : point_positions)
+			point->createRenderablesScaled(MapCoordF(position), point_rotation, output);
+	}
 }
 
-void AreaSymbol::FillPattern::createLine(MapCoordF first, MapCoordF second, float delta_offset, LineSymbol* line, PointObject* point_object, ObjectRenderables& output) const
+void AreaSymbol::FillPattern::createLine(MapCoordF first, MapCoordF second, float delta_offset, QVector<QLineF>& lines, QVector<QPointF>& point_positions) const
 {
 	if (type == LinePattern)
 	{
-		output.insertRenderable(new LineRenderable(line, first, second));
+		lines.push_back(QLineF(first, second));
 	}
 	else
 	{
@@ -410,10 +428,9 @@ void AreaSymbol::FillPattern::createLine(MapCoordF first, MapCoordF second, floa
 		auto to_next = direction * step_length;
 		
 		auto coord = first + direction * start_length;
-		auto rotation = -point_object->getRotation();
 		for (auto cur = start_length; cur < length; cur += step_length)
 		{
-			point->createRenderablesScaled(coord, rotation, output);
+			point_positions.push_back(coord);
 			coord += to_next;
 		}
 	}
@@ -639,6 +656,18 @@ void AreaSymbol::scale(double factor)
 	resetIcon();
 }
 
+bool AreaSymbol::hasLocalPathOutput() const
+{
+	// The patterns are aligned to the pattern origin, not to the path.
+	return minimum_area <= 0;
+}
+
+bool AreaSymbol::needsPathCoords() const
+{
+	// The fill is drawn from the raw coordinates.
+	return false;
+}
+
 bool AreaSymbol::hasRotatableFillPattern() const
 {
 	for (int i = 0, size = (int)patterns.size(); i < size; ++i)
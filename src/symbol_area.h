@@ -22,6 +22,10 @@
 #ifndef _OPENORIENTEERING_SYMBOL_AREA_H_
 #define _OPENORIENTEERING_SYMBOL_AREA_H_
 
+#include <QLineF>
+#include <QPointF>
+#include <QVector>
+
 #include "symbol.h"
 #include "symbol_properties_widget.h"
 
@@ -129,13 +133,17 @@ public:
 			ObjectRenderables& output
 		) const;
 		
-		/** Creates one line of renderables, called by createRenderables(). */
+		/**
+		 * Creates one line of the pattern, called by createRenderables().
+		 * 
+		 * For line patterns, this collects the line. For point patterns,
+		 * this collects the positions of the points.
+		 */
 		void createLine(
 			MapCoordF first, MapCoordF second,
 			float delta_offset,
-			LineSymbol* line,
-			PointObject* point_object,
-			ObjectRenderables& output
+			QVector<QLineF>& lines,
+			QVector<QPointF>& point_positions
 		) const;
 		/** Spatially scales the pattern settings by the given factor. */
 		void scale(double factor);
@@ -176,6 +184,8 @@ public:
 	bool containsColor(const MapColor* color) const override;
 	const MapColor* guessDominantColor() const override;
 	void scale(double factor) override;
+	bool hasLocalPathOutput() const override;
+	bool needsPathCoords() const override;
 	
 	// Getters / Setters
 	inline const MapColor* getColor() const {return color;}
@@ -38,6 +38,8 @@
 #include "gui/widgets/symbol_dropdown.h"
 #include "map.h"
 #include "object.h"
+#include "renderable_implementation.h"
+#include "symbol_line.h"
 #include "symbol_setting_dialog.h"
 #include "symbol_properties_widget.h"
 
@@ -89,10 +91,44 @@ void CombinedSymbol::createRenderables(
         ObjectRenderables &output,
         Symbol::RenderableOptions options) const
 {
+	const bool normal = !options.testFlag(Symbol::RenderBaselines) && !options.testFlag(Symbol::RenderPreview);
+	
+	// Plain line parts, like the casing and the fill of a road, share the
+	// painter paths of the first one.
+	std::vector<const LineRenderable*> line_renderables;
 	for (auto subsymbol : parts)
 	{
-		if (subsymbol)
-			subsymbol->createRenderables(object, path_parts, output, options);
+		if (!subsymbol)
+			continue;
+		
+		if (normal && subsymbol->getType() == Symbol::Line && subsymbol->asLine()->isPlainLine())
+		{
+			auto line_symbol = subsymbol->asLine();
+			if (line_renderables.empty())
+			{
+				for (const auto& part : path_parts)
+				{
+					LineRenderable* renderable = nullptr;
+					if (part.size() >= 2)
+					{
+						renderable = new LineRenderable(line_symbol, part, part.isClosed());
+						output.insertRenderable(renderable);
+					}
+					line_renderables.push_back(renderable);
+				}
+			}
+			else
+			{
+				for (std::size_t i = 0; i < path_parts.size(); ++i)
+				{
+					if (line_renderables[i])
+						output.insertRenderable(new LineRenderable(line_symbol, path_parts[i], path_parts[i].isClosed(), *line_renderables[i]));
+				}
+			}
+			continue;
+		}
+		
+		subsymbol->createRenderables(object, path_parts, output, options);
 	}
 }
 
@@ -359,6 +395,26 @@ float CombinedSymbol::calculateLargestLineExtent(Map* map) const
 	return result;
 }
 
+bool CombinedSymbol::hasLocalPathOutput() const
+{
+	for (size_t i = 0, end = parts.size(); i < end; ++i)
+	{
+		if (parts[i] && !parts[i]->hasLocalPathOutput())
+			return false;
+	}
+	return true;
+}
+
+bool CombinedSymbol::needsPathCoords() const
+{
+	for (size_t i = 0, end = parts.size(); i < end; ++i)
+	{
+		if (parts[i] && parts[i]->needsPathCoords())
+			return true;
+	}
+	return false;
+}
+
 void CombinedSymbol::setPart(int i, const Symbol* symbol, bool is_private)
 {
 	if (private_parts[i])
@@ -81,6 +81,9 @@ public:
 	
     float calculateLargestLineExtent(Map* map) const override;
 	
+	bool hasLocalPathOutput() const override;
+	bool needsPathCoords() const override;
+	
 	// Getters / Setter
 	inline int getNumParts() const {return (int)parts.size();}
 	inline void setNumParts(int num) {parts.resize(num, NULL); private_parts.resize(num, false);}
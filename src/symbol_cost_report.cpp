@@ -0,0 +1,178 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "symbol_cost_report.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include <QElapsedTimer>
+#include <QImage>
+#include <QLocale>
+#include <QPainter>
+#include <QStringList>
+
+#include "map.h"
+#include "map_part.h"
+#include "object.h"
+#include "renderable.h"
+#include "symbol.h"
+#include "core/map_view.h"
+
+
+namespace
+{
+	/** The size of the image for drawing single objects, in pixels. */
+	const int image_size = 512;
+	
+	/** Returns the cost by which the entries are sorted. */
+	qint64 cost(const SymbolCostReport::Entry& entry)
+	{
+		return entry.update_time + entry.render_time;
+	}
+}
+
+
+
+SymbolCostReport::SymbolCostReport()
+{
+	total_entry = { nullptr, 0, 0, 0, 0, 0 };
+}
+
+SymbolCostReport SymbolCostReport::measure(Map& map, const MapView& view)
+{
+	SymbolCostReport result;
+	
+	std::unordered_map<const Symbol*, std::size_t> entry_index;
+	auto entryFor = [&result, &entry_index](const Symbol* symbol) -> Entry& {
+		auto found = entry_index.find(symbol);
+		if (found == entry_index.end())
+		{
+			found = entry_index.insert(std::make_pair(symbol, result.symbol_entries.size())).first;
+			result.symbol_entries.push_back({ symbol, 0, 0, 0, 0, 0 });
+		}
+		return result.symbol_entries[found->second];
+	};
+	
+	// The pixels are reused for all objects: Drawing over old content is
+	// not slower than drawing on a clear image, but clearing would be measured.
+	QImage image(image_size, image_size, QImage::Format_ARGB32_Premultiplied);
+	image.fill(Qt::transparent);
+	QPainter painter(&image);
+	painter.setRenderHint(QPainter::Antialiasing);
+	
+	const qreal zoom = view.calculateFinalZoomFactor();
+	QElapsedTimer timer;
+	for (int i = 0; i < map.getNumParts(); ++i)
+	{
+		// Measuring must not trigger the loading of deferred objects.
+		MapPart* part = map.getPart(i);
+		if (!part->isLoaded())
+			continue;
+		
+		for (int j = 0; j < part->getNumObjects(); ++j)
+		{
+			const Object* object = part->getObject(j);
+			if (!object->getSymbol())
+				continue;
+			
+			Entry& entry = entryFor(object->getSymbol());
+			
+			timer.start();
+			object->forceUpdate();
+			entry.update_time += timer.nsecsElapsed();
+			
+			// Draw the object in the center of the image, at the view's zoom
+			// unless the object would not fit into the image.
+			const QRectF extent = object->getExtent();
+			const qreal size = qMax(extent.width(), extent.height());
+			const qreal scaling = (size > 0) ? qMin(zoom, (image_size - 2) / size) : zoom;
+			painter.resetTransform();
+			painter.translate(image_size / 2.0, image_size / 2.0);
+			painter.scale(scaling, scaling);
+			painter.translate(-extent.center());
+			
+			const RenderConfig config = { map, extent, scaling, RenderConfig::Screen | RenderConfig::HelperSymbols, 1.0 };
+			const ObjectRenderables& renderables = object->renderables();
+			timer.start();
+			renderables.draw(QColor(Qt::black), &painter, config);
+			entry.render_time += timer.nsecsElapsed();
+			
+			++entry.num_objects;
+			entry.num_renderables += renderables.numRenderables();
+			entry.memory += object->renderablesMemoryUsage();
+		}
+	}
+	painter.end();
+	
+	for (const auto& entry : result.symbol_entries)
+	{
+		result.total_entry.num_objects += entry.num_objects;
+		result.total_entry.num_renderables += entry.num_renderables;
+		result.total_entry.memory += entry.memory;
+		result.total_entry.update_time += entry.update_time;
+		result.total_entry.render_time += entry.render_time;
+	}
+	
+	std::stable_sort(begin(result.symbol_entries), end(result.symbol_entries), [](const Entry& a, const Entry& b) {
+		return cost(a) > cost(b);
+	});
+	
+	return result;
+}
+
+QString SymbolCostReport::label(const Entry& entry)
+{
+	if (!entry.symbol)
+		return tr("Total");
+	return entry.symbol->getNumberAsString() + QLatin1Char(' ') + entry.symbol->getPlainTextName();
+}
+
+QString SymbolCostReport::formatTime(qint64 nsecs)
+{
+	return tr("%1 ms").arg(QLocale().toString(nsecs / 1000000.0, 'f', 2));
+}
+
+QString SymbolCostReport::toText() const
+{
+	// The figures are printed unformatted, so that the output can be processed by scripts.
+	QStringList lines;
+	lines << QString::fromLatin1("%1 %2 %3 %4 %5 %6")
+	         .arg(tr("Symbol"), -36)
+	         .arg(tr("Objects"), 10)
+	         .arg(tr("Renderables"), 12)
+	         .arg(tr("Bytes"), 14)
+	         .arg(tr("Update ns"), 14)
+	         .arg(tr("Render ns"), 14);
+	
+	auto line = [](const Entry& entry) {
+		return QString::fromLatin1("%1 %2 %3 %4 %5 %6")
+		       .arg(label(entry), -36)
+		       .arg(entry.num_objects, 10)
+		       .arg(entry.num_renderables, 12)
+		       .arg(entry.memory, 14)
+		       .arg(entry.update_time, 14)
+		       .arg(entry.render_time, 14);
+	};
+	for (const auto& entry : symbol_entries)
+		lines << line(entry);
+	lines << line(total_entry);
+	return lines.join(QLatin1Char('\n'));
+}
@@ -0,0 +1,131 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_SYMBOL_COST_REPORT_H_
+#define _OPENORIENTEERING_SYMBOL_COST_REPORT_H_
+
+#include <vector>
+
+#include <QCoreApplication>
+#include <QString>
+
+class Map;
+class MapView;
+class Symbol;
+
+
+/**
+ * @brief SymbolCostReport measures the rendering cost of the objects of a map, by symbol.
+ *
+ * For each symbol which is used by objects in the map, the report gives the
+ * number of objects, the number of renderables and the memory they use, and
+ * the time for updating the objects (i.e. regenerating the renderables) and
+ * for drawing the renderables. This helps to identify the symbols which make
+ * a map slow, e.g. area symbols with fine patterns or lines with many dashes.
+ *
+ * The objects are drawn one by one onto an image at the zoom of the given
+ * view, so the render times do not include the effects of clipping and of
+ * the map widget's caches. They are meant for comparing symbols, rather than
+ * for predicting the time of a repaint.
+ *
+ * Measuring updates and draws all objects of the map. It is meant to be done
+ * on request, not continuously.
+ */
+class SymbolCostReport
+{
+	Q_DECLARE_TR_FUNCTIONS(SymbolCostReport)
+
+public:
+	/** The figures of a single symbol. */
+	struct Entry
+	{
+		/** The symbol, or nullptr for the total. */
+		const Symbol* symbol;
+		
+		/** The number of objects with this symbol. */
+		int num_objects;
+		
+		/** The number of renderables of these objects. */
+		int num_renderables;
+		
+		/** The memory used by the renderables, in bytes. */
+		qint64 memory;
+		
+		/** The time for updating the objects, in nanoseconds. */
+		qint64 update_time;
+		
+		/** The time for drawing the renderables, in nanoseconds. */
+		qint64 render_time;
+	};
+	
+	/** Constructs an empty report. */
+	SymbolCostReport();
+	
+	/**
+	 * Measures the rendering cost of the objects of the given map.
+	 *
+	 * The objects are updated, so the map's renderables are regenerated.
+	 * The render times are measured at the zoom of the given view.
+	 * Map parts whose loading was deferred and is still pending are skipped.
+	 */
+	static SymbolCostReport measure(Map& map, const MapView& view);
+	
+	/**
+	 * Returns the entries of the symbols which are used by objects,
+	 * the most expensive first (by update and render time).
+	 */
+	const std::vector<Entry>& entries() const;
+	
+	/** Returns the sums of all entries. */
+	const Entry& total() const;
+	
+	/** Returns the number and name of the symbol of the given entry. */
+	static QString label(const Entry& entry);
+	
+	/** Returns a human-readable representation of the given time in nanoseconds. */
+	static QString formatTime(qint64 nsecs);
+	
+	/**
+	 * Returns a plain text table of all entries and the total,
+	 * one per line, for logging and for the command line.
+	 */
+	QString toText() const;
+
+private:
+	std::vector<Entry> symbol_entries;
+	Entry total_entry;
+};
+
+
+
+// ### SymbolCostReport inline code ###
+
+inline
+const std::vector<SymbolCostReport::Entry>& SymbolCostReport::entries() const
+{
+	return symbol_entries;
+}
+
+inline
+const SymbolCostReport::Entry& SymbolCostReport::total() const
+{
+	return total_entry;
+}
+
+#endif
@@ -33,7 +33,6 @@
 #include "gui/main_window.h"
 #include "gui/widgets/symbol_dropdown.h"
 #include "map.h"
-#include "object.h"
 #include "undo_manager.h"
 #include "util.h"
 
@@ -119,28 +118,6 @@ void ReplaceSymbolSetDialog::showHelp()
 	Util::showHelp(this, "symbol_replace_dialog.html");
 }
 
-struct ReplaceSymbolSetOperation
-{
-	inline ReplaceSymbolSetOperation(QHash<const Symbol*, const Symbol*>* mapping, QHash<const Symbol*, Symbol*>* import_symbol_map)
-	 : mapping(mapping), import_symbol_map(import_symbol_map)
-	{
-	}
-	inline bool operator()(Object* object, MapPart* part, int object_index) const
-	{
-		Q_UNUSED(part);
-		Q_UNUSED(object_index);
-		if (mapping->contains(object->getSymbol()))
-		{
-			const Symbol* target_symbol = import_symbol_map->value(mapping->value(object->getSymbol()));
-			object->setSymbol(target_symbol, true);
-		}
-		return true;
-	}
-private:
-	QHash<const Symbol*, const Symbol*>* mapping;
-	QHash<const Symbol*, Symbol*>* import_symbol_map;
-};
-
 void ReplaceSymbolSetDialog::apply()
 {
 	QHash<const Symbol*, Symbol*> import_symbol_map;
@@ -155,22 +132,18 @@ void ReplaceSymbolSetDialog::apply()
 	}
 	
 	// Import new symbols
+	const int num_colors = map->getNumColors();
 	std::vector<bool>* symbol_filter = NULL;
 	if (!import_all_check->isChecked())
 	{
 		// Import only symbols which are chosen as replacement symbols
 		symbol_filter = new std::vector<bool>();
 		symbol_filter->resize(symbol_map->getNumSymbols(), false);
+		const auto replacements = mapping.values().toSet();
 		for (int i = 0; i < symbol_map->getNumSymbols(); ++i)
 		{
-			for (QHash<const Symbol*, const Symbol*>::iterator it = mapping.begin(), end = mapping.end(); it != end; ++it)
-			{
-				if (it.value() == symbol_map->getSymbol(i))
-				{
-					symbol_filter->at(i) = true;
-					break;
-				}
-			}
+			if (replacements.contains(symbol_map->getSymbol(i)))
+				symbol_filter->at(i) = true;
 		}
 	}
 	map->importMap(symbol_map, Map::MinimalSymbolImport, this, symbol_filter, -1, false, &import_symbol_map);
@@ -182,13 +155,16 @@ void ReplaceSymbolSetDialog::apply()
 		for (QHash<const Symbol*, const Symbol*>::iterator it = mapping.begin(), end = mapping.end(); it != end; ++it)
 		{
 			Symbol* target_symbol = import_symbol_map.value(it.value());
-			target_symbol->setHidden(it.key()->isHidden());
-			target_symbol->setProtected(it.key()->isProtected());
+			map->setSymbolHidden(target_symbol, it.key()->isHidden());
+			map->setSymbolProtected(target_symbol, it.key()->isProtected());
 		}
 	}
 	
-	// Change symbols for all objects
-	map->applyOnAllObjects(ReplaceSymbolSetOperation(&mapping, &import_symbol_map));
+	// Change symbols for all objects, in a single pass
+	QHash<const Symbol*, const Symbol*> object_symbol_map;
+	for (QHash<const Symbol*, const Symbol*>::const_iterator it = mapping.constBegin(), end = mapping.constEnd(); it != end; ++it)
+		object_symbol_map.insert(it.key(), import_symbol_map.value(it.value()));
+	map->changeSymbols(object_symbol_map);
 	
 	// Delete unused old symbols
 	if (delete_unused_symbols_check->isChecked())
@@ -225,10 +201,14 @@ void ReplaceSymbolSetDialog::apply()
 	}
 	
 	// Finish
-	map->updateAllObjects();
+	// Imported colors may change the order of the existing colors.
+	if (map->getNumColors() != num_colors)
+		map->updateAllObjects();
 	map->setObjectsDirty();
 	map->setSymbolsDirty();
-	map->undoManager().clear();
+	// Deleted symbols and colors cannot be restored by undo.
+	if (delete_unused_symbols_check->isChecked() || delete_unused_colors_check->isChecked())
+		map->undoManager().clear();
 	accept();
 }
 
@@ -0,0 +1,182 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "symbol_icon_cache.h"
+
+#include <vector>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QImage>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QXmlStreamWriter>
+
+#include <mapper_config.h>
+
+#include "map.h"
+#include "settings.h"
+#include "symbol.h"
+#include "core/map_color.h"
+
+
+namespace
+{
+	/** Identifies the data of a cache entry. */
+	const quint32 magic = 0x4f4f4943; // "OOIC"
+}
+
+
+
+// ### SymbolIconCache ###
+
+QString SymbolIconCache::entryPath(const QString& path)
+{
+	const QFileInfo file_info(path);
+	const QString canonical_path = file_info.canonicalFilePath();
+	if (canonical_path.isEmpty())
+		return QString();
+	
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(QByteArray(APP_VERSION));
+	hash.addData(canonical_path.toUtf8());
+	hash.addData(QByteArray::number(file_info.size()));
+	hash.addData(QByteArray::number(file_info.lastModified().toMSecsSinceEpoch()));
+	hash.addData(QByteArray::number(Settings::getInstance().getSymbolWidgetIconSizePx()));
+	
+	const QString cache_dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+	if (cache_dir.isEmpty())
+		return QString();
+	
+	return cache_dir + QLatin1String("/symbol-icons/") + QString::fromLatin1(hash.result().toHex()) + QLatin1String(".icons");
+}
+
+bool SymbolIconCache::restoreIcons(Map& map, const QString& path)
+{
+	const QString entry_path = entryPath(path);
+	QFile file(entry_path);
+	if (entry_path.isEmpty() || !file.open(QIODevice::ReadOnly))
+		return false;
+	
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_2);
+	quint32 entry_magic;
+	qint32 num_icons;
+	stream >> entry_magic >> num_icons;
+	if (stream.status() != QDataStream::Ok || entry_magic != magic || num_icons != map.getNumSymbols())
+		return false;
+	
+	std::vector<QImage> icons(num_icons);
+	for (QImage& icon : icons)
+		stream >> icon;
+	if (stream.status() != QDataStream::Ok)
+		return false;
+	
+	for (int i = 0; i < num_icons; ++i)
+		map.getSymbol(i)->setIcon(icons[i]);
+	return true;
+}
+
+void SymbolIconCache::saveIcons(const Map& map, const QString& path)
+{
+	// Icons of text symbols need fonts.
+	if (!qobject_cast<QGuiApplication*>(QCoreApplication::instance()))
+		return;
+	
+	const QString entry_path = entryPath(path);
+	if (entry_path.isEmpty() || !QDir().mkpath(QFileInfo(entry_path).absolutePath()))
+		return;
+	
+	QSaveFile file(entry_path);
+	if (!file.open(QIODevice::WriteOnly))
+		return;
+	
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_2);
+	stream << magic << qint32(map.getNumSymbols());
+	for (int i = 0; i < map.getNumSymbols(); ++i)
+		stream << map.getSymbol(i)->getIcon(&map);
+	
+	if (stream.status() == QDataStream::Ok)
+		file.commit();
+}
+
+QString SymbolIconCache::symbolIconDirectory()
+{
+	const QString cache_dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+	if (cache_dir.isEmpty())
+		return QString();
+	
+	return cache_dir + QLatin1String("/symbol-icons/single");
+}
+
+QByteArray SymbolIconCache::symbolIconKey(const Symbol& symbol, const Map& map, int icon_size)
+{
+	QByteArray definition;
+	{
+		QXmlStreamWriter xml(&definition);
+		symbol.save(xml, map);
+	}
+	
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(QByteArray(APP_VERSION));
+	hash.addData(definition);
+	for (int i = 0; i < map.getNumColors(); ++i)
+	{
+		const MapColor* color = map.getColor(i);
+		if (symbol.containsColor(color))
+		{
+			hash.addData(QByteArray::number(i));
+			hash.addData(QByteArray::number(QRgb(*color)));
+			hash.addData(QByteArray::number(color->getOpacity()));
+		}
+	}
+	hash.addData(QByteArray::number(map.getScaleDenominator()));
+	hash.addData(QByteArray::number(icon_size));
+	return hash.result().toHex();
+}
+
+QImage SymbolIconCache::loadSymbolIcon(const QString& directory, const QByteArray& key, int icon_size)
+{
+	if (directory.isEmpty())
+		return QImage();
+	
+	QImage icon(directory + QLatin1Char('/') + QString::fromLatin1(key) + QLatin1String(".png"));
+	if (icon.width() != icon_size || icon.height() != icon_size)
+		return QImage();
+	
+	return icon.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+void SymbolIconCache::saveSymbolIcon(const QString& directory, const QByteArray& key, const QImage& icon)
+{
+	if (directory.isEmpty() || icon.isNull() || !QDir().mkpath(directory))
+		return;
+	
+	QSaveFile file(directory + QLatin1Char('/') + QString::fromLatin1(key) + QLatin1String(".png"));
+	if (file.open(QIODevice::WriteOnly) && icon.save(&file, "PNG"))
+		file.commit();
+}
@@ -0,0 +1,99 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef _OPENORIENTEERING_SYMBOL_ICON_CACHE_H_
+#define _OPENORIENTEERING_SYMBOL_ICON_CACHE_H_
+
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+
+class Map;
+class Symbol;
+
+
+/**
+ * A persistent cache of the symbol icons of symbol set files.
+ * 
+ * Rendering the icons of a symbol set takes much longer than loading the
+ * symbols. The cache stores the icons in the user's cache directory. Its
+ * entries are keyed by the program version, the symbol set file's path,
+ * size and modification time, and the icon size. So outdated entries are
+ * never used.
+ * 
+ * In addition, the cache stores the icons of single symbols, keyed by the
+ * program version, the symbol's definition and colors, and the icon size.
+ * These entries are used for the symbols of any map, and the functions for
+ * them may be called from any thread.
+ */
+class SymbolIconCache
+{
+public:
+	/**
+	 * Sets the icons of the map's symbols from the cache entry for the
+	 * given symbol set file.
+	 * 
+	 * Returns false if there is no matching entry.
+	 */
+	static bool restoreIcons(Map& map, const QString& path);
+	
+	/**
+	 * Renders the icons of the map's symbols, and stores them in the cache
+	 * entry for the given symbol set file.
+	 */
+	static void saveIcons(const Map& map, const QString& path);
+	
+	/**
+	 * Returns the directory of the icons of single symbols,
+	 * or an empty string if there is no cache location.
+	 * 
+	 * This function must be called from the main thread.
+	 */
+	static QString symbolIconDirectory();
+	
+	/**
+	 * Returns the key of the icon of the given symbol and size.
+	 * 
+	 * The key is a hash of the symbol's definition and of the colors which
+	 * are used by the symbol. The map must provide the symbol's colors.
+	 */
+	static QByteArray symbolIconKey(const Symbol& symbol, const Map& map, int icon_size);
+	
+	/**
+	 * Returns the icon with the given key from the given directory,
+	 * or a null image if there is no matching icon.
+	 */
+	static QImage loadSymbolIcon(const QString& directory, const QByteArray& key, int icon_size);
+	
+	/**
+	 * Stores the icon with the given key in the given directory.
+	 */
+	static void saveSymbolIcon(const QString& directory, const QByteArray& key, const QImage& icon);
+	
+private:
+	/**
+	 * Returns the path of the cache entry for the given symbol set file,
+	 * or an empty string if the file does not exist.
+	 */
+	static QString entryPath(const QString& path);
+};
+
+#endif
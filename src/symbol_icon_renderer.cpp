@@ -0,0 +1,208 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "symbol_icon_renderer.h"
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QPointer>
+#include <QRunnable>
+
+#include "core/task_pool.h"
+#include "map.h"
+#include "settings.h"
+#include "symbol.h"
+#include "symbol_combined.h"
+#include "symbol_icon_cache.h"
+
+
+
+// ### SymbolIconRenderer::Job ###
+
+/**
+ * Renders the icon of a copy of a symbol in a worker thread, and passes it
+ * to the renderer in the GUI thread when finished.
+ * 
+ * The job is an object of the GUI thread. It deletes itself after
+ * finishing, even if the renderer was deleted in the meantime.
+ */
+class SymbolIconRenderer::Job : public QObject, public QRunnable
+{
+public:
+	Job(SymbolIconRenderer* renderer, const Symbol* symbol, Symbol* copy, std::shared_ptr<Map> colors, int icon_size, const QString& cache_directory)
+	 : renderer(renderer)
+	 , symbol(symbol)
+	 , colors(std::move(colors))
+	 , copy(copy)
+	 , icon_size(icon_size)
+	 , cache_directory(cache_directory)
+	{
+		setAutoDelete(false);
+	}
+	
+	void run() override
+	{
+		const QByteArray key = SymbolIconCache::symbolIconKey(*copy, *colors, icon_size);
+		icon = SymbolIconCache::loadSymbolIcon(cache_directory, key, icon_size);
+		if (icon.isNull())
+		{
+			icon = copy->createIcon(colors.get(), icon_size, true, 1);
+			SymbolIconCache::saveSymbolIcon(cache_directory, key, icon);
+		}
+		// Nothing must be accessed after posting the event.
+		QCoreApplication::postEvent(this, new QEvent(finishedEvent()));
+	}
+	
+	bool event(QEvent* event) override
+	{
+		if (event->type() != finishedEvent())
+			return QObject::event(event);
+		
+		if (renderer)
+			renderer->finishJob(this, symbol, icon);
+		deleteLater();
+		return true;
+	}
+	
+private:
+	static QEvent::Type finishedEvent()
+	{
+		static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+		return type;
+	}
+	
+	QPointer<SymbolIconRenderer> renderer;
+	const Symbol* symbol;                  ///< The original symbol, to be compared only.
+	std::shared_ptr<Map> colors;
+	std::unique_ptr<Symbol> copy;          ///< Destroyed before the colors.
+	const int icon_size;
+	const QString cache_directory;
+	QImage icon;
+};
+
+
+
+// ### SymbolIconRenderer ###
+
+SymbolIconRenderer::SymbolIconRenderer(Map* map, QObject* parent)
+ : QObject(parent)
+ , map(map)
+ , cache_directory(SymbolIconCache::symbolIconDirectory())
+{
+	connect(map, &Map::symbolChanged, this, &SymbolIconRenderer::symbolChanged);
+	connect(map, &Map::symbolDeleted, this, &SymbolIconRenderer::symbolDeleted);
+	connect(map, &Map::symbolIconChanged, this, &SymbolIconRenderer::symbolIconChanged);
+	connect(map, &Map::colorAdded, this, &SymbolIconRenderer::colorsChanged);
+	connect(map, &Map::colorChanged, this, &SymbolIconRenderer::colorsChanged);
+	connect(map, &Map::colorDeleted, this, &SymbolIconRenderer::colorsChanged);
+}
+
+SymbolIconRenderer::~SymbolIconRenderer()
+{
+	; // nothing
+}
+
+QImage SymbolIconRenderer::icon(Symbol* symbol)
+{
+	if (symbol->hasIcon() || symbol->getContainedTypes() & Symbol::Text)
+		return symbol->getIcon(map);
+	
+	if (jobs.find(symbol) != jobs.end())
+		return QImage();
+	
+	if (colors && colors->getScaleDenominator() != map->getScaleDenominator())
+		colorsChanged();
+	
+	if (!colors)
+	{
+		colors = std::make_shared<Map>();
+		colors->setScaleDenominator(map->getScaleDenominator());
+		for (int i = 0; i < map->getNumColors(); ++i)
+		{
+			const MapColor* color = map->getColor(i);
+			MapColor* color_copy = new MapColor(*color);
+			colors->addColor(color_copy, i);
+			color_map[color] = color_copy;
+		}
+	}
+	
+	auto job = new Job(this, symbol, duplicateSymbol(symbol), colors, Settings::getInstance().getSymbolWidgetIconSizePx(), cache_directory);
+	jobs[symbol] = job;
+	TaskPool::start(job, TaskPool::Interactive);
+	return QImage();
+}
+
+Symbol* SymbolIconRenderer::duplicateSymbol(const Symbol* symbol) const
+{
+	Symbol* copy = symbol->duplicate(&color_map);
+	if (copy->getType() == Symbol::Combined)
+	{
+		// Parts which are not private are owned by the map.
+		CombinedSymbol* combined = copy->asCombined();
+		for (int i = 0; i < combined->getNumParts(); ++i)
+		{
+			const Symbol* part = combined->getPart(i);
+			if (part && !combined->isPartPrivate(i))
+				combined->setPart(i, duplicateSymbol(part), true);
+		}
+	}
+	return copy;
+}
+
+void SymbolIconRenderer::finishJob(const Job* job, const Symbol* symbol, const QImage& icon)
+{
+	auto found = jobs.find(symbol);
+	if (found == jobs.end() || found->second != job)
+		return;
+	
+	jobs.erase(found);
+	const int pos = map->findSymbolIndex(symbol);
+	if (pos >= 0 && !icon.isNull())
+	{
+		map->getSymbol(pos)->setIcon(icon);
+		emit iconChanged(pos);
+	}
+}
+
+void SymbolIconRenderer::symbolChanged(int pos, const Symbol* new_symbol, const Symbol* old_symbol)
+{
+	Q_UNUSED(pos);
+	jobs.erase(new_symbol);
+	jobs.erase(old_symbol);
+}
+
+void SymbolIconRenderer::symbolDeleted(int pos, const Symbol* old_symbol)
+{
+	Q_UNUSED(pos);
+	jobs.erase(old_symbol);
+}
+
+void SymbolIconRenderer::symbolIconChanged(int pos)
+{
+	jobs.erase(map->getSymbol(pos));
+}
+
+void SymbolIconRenderer::colorsChanged()
+{
+	// Running jobs keep their own reference to the old colors.
+	colors.reset();
+	color_map.clear();
+}
@@ -0,0 +1,122 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef _OPENORIENTEERING_SYMBOL_ICON_RENDERER_H_
+#define _OPENORIENTEERING_SYMBOL_ICON_RENDERER_H_
+
+#include <memory>
+#include <unordered_map>
+
+#include <QImage>
+#include <QObject>
+#include <QString>
+
+#include "core/map_color.h"
+
+class Map;
+class Symbol;
+
+
+/**
+ * @brief Renders the icons of a map's symbols in worker threads.
+ * 
+ * Rendering an icon draws a small map, which takes noticeable time for
+ * complex symbols. Widgets which show many icons use this class in order to
+ * keep the user interface responsive: icon() returns a null image while the
+ * icon is rendered in the background, and iconChanged() is emitted when the
+ * symbol's icon has been set.
+ * 
+ * The worker threads operate on copies of the symbol and of the map's colors,
+ * so the map may be edited while rendering is in progress. The results for
+ * symbols which were changed or deleted in the meantime are discarded.
+ * Rendered icons are stored by SymbolIconCache, so that they need not be
+ * rendered again after a restart.
+ * 
+ * Text symbols are rendered immediately because font rendering is not
+ * available in worker threads on all platforms.
+ */
+class SymbolIconRenderer : public QObject
+{
+Q_OBJECT
+public:
+	/**
+	 * Constructs a renderer for the symbols of the given map.
+	 */
+	SymbolIconRenderer(Map* map, QObject* parent = nullptr);
+	
+	/**
+	 * Destructor.
+	 * 
+	 * Unfinished jobs continue in the background, but their results are
+	 * discarded.
+	 */
+	~SymbolIconRenderer() override;
+	
+	/**
+	 * Returns the icon of the given symbol of the map.
+	 * 
+	 * If the icon is not available yet, starts rendering it in the background
+	 * and returns a null image.
+	 */
+	QImage icon(Symbol* symbol);
+	
+signals:
+	/**
+	 * Indicates that the icon of the symbol at the given position was set
+	 * after rendering in the background.
+	 */
+	void iconChanged(int pos);
+	
+private slots:
+	void symbolChanged(int pos, const Symbol* new_symbol, const Symbol* old_symbol);
+	void symbolDeleted(int pos, const Symbol* old_symbol);
+	void symbolIconChanged(int pos);
+	void colorsChanged();
+	
+private:
+	class Job;
+	
+	/**
+	 * Returns a copy of the symbol which does not depend on the map,
+	 * using the colors of the colors snapshot.
+	 */
+	Symbol* duplicateSymbol(const Symbol* symbol) const;
+	
+	/**
+	 * Sets the icon of the symbol if the job is the current job for the symbol.
+	 */
+	void finishJob(const Job* job, const Symbol* symbol, const QImage& icon);
+	
+	Map* map;
+	
+	/** A copy of the map's colors, shared with the jobs until the colors change. */
+	std::shared_ptr<Map> colors;
+	
+	/** Maps the map's colors to the colors of the snapshot. */
+	MapColorMap color_map;
+	
+	/** The current job for each symbol which is being rendered. */
+	std::unordered_map<const Symbol*, const Job*> jobs;
+	
+	QString cache_directory;
+};
+
+#endif
@@ -21,9 +21,15 @@
 
 #include "symbol_line.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include <QtNumeric>
 #include <QGridLayout>
+#include <QCache>
 #include <QIODevice>
+#include <QMutex>
 #include <QScrollArea>
 #include <QScrollBar>
 #include <QTimer>
@@ -45,6 +51,52 @@
 #include "gui/widgets/color_dropdown.h"
 
 
+namespace
+{
+	/** Combines a value into a hash, like boost::hash_combine. */
+	quint64 combineHash(quint64 seed, quint64 value)
+	{
+		return seed ^ (value + Q_UINT64_C(0x9e3779b97f4a7c15) + (seed << 6) + (seed >> 2));
+	}
+	
+	/** Returns the bits of a double, for hashing. */
+	quint64 hashBits(double value)
+	{
+		quint64 bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+	
+	/** Rounds a length or parameter for use in a cache key. */
+	qint64 keyValue(double value)
+	{
+		return qRound64(value * 1e6);
+	}
+	
+	/**
+	 * Returns sin(acos(c)) for the cosine c of the angle between two unit vectors.
+	 * 
+	 * The cosine is clamped to [-1, 1]: Rounding errors in nearly parallel
+	 * segments must not turn into NaN.
+	 */
+	inline
+	double sinFromCos(double c)
+	{
+		return std::sqrt(std::max(0.0, 1.0 - c * c));
+	}
+	
+	/**
+	 * Returns tan(acos(c)) for the cosine c of the angle between two unit vectors.
+	 */
+	inline
+	double tanFromCos(double c)
+	{
+		return sinFromCos(c) / c;
+	}
+}
+
+
+
 // ### LineSymbolBorder ###
 
 void LineSymbolBorder::reset()
@@ -162,9 +214,290 @@ void LineSymbolBorder::scale(double factor)
 }
 
 
+// ### LineSymbol::DashGroupsCache ###
+
+/**
+ * A cache for the dash layout of line sections between dash points.
+ * 
+ * The layout of a section depends only on the dash parameters and on the
+ * geometry of the section (including the part which is carried over from
+ * the previous section). Thus unchanged sections of a modified line can
+ * reuse the previous result.
+ * 
+ * Each line symbol has its own cache, which is cleared when the dash
+ * parameters change. Entries are found by a hash of the section and verified
+ * against its geometry. They are distributed over a few shards with separate
+ * locks, so that concurrent updates of renderables rarely wait for each
+ * other. Each shard drops its least recently used entries when it holds too
+ * many coordinates.
+ */
+class LineSymbol::DashGroupsCache
+{
+public:
+	/** Identifies where the next section continues drawing. */
+	enum Continuation
+	{
+		ContinueFromLineStart,
+		ContinueFromEnd,
+		ContinueFromOffset
+	};
+	
+	/** The dash parameters which the layout depends on. */
+	struct Parameters
+	{
+		int dash_length;
+		int break_length;
+		int in_group_break_length;
+		int dashes_in_group;
+		bool half_outer_dashes;
+		
+		bool operator==(const Parameters& other) const
+		{
+			return dash_length == other.dash_length
+			       && break_length == other.break_length
+			       && in_group_break_length == other.in_group_break_length
+			       && dashes_in_group == other.dashes_in_group
+			       && half_outer_dashes == other.half_outer_dashes;
+		}
+	};
+	
+	/** Identifies a section of a path. */
+	struct Key
+	{
+		Key(const VirtualPath& path,
+		    bool path_closed,
+		    const SplitPathCoord& line_start,
+		    const SplitPathCoord& start,
+		    const SplitPathCoord& end,
+		    bool is_part_start,
+		    bool is_part_end);
+		
+		const VirtualPath& path;
+		VirtualCoordVector::size_type first;
+		VirtualCoordVector::size_type last;
+		qint64 start_param;
+		qint64 start_offset;
+		int options;
+		quint64 hash;
+	};
+	
+	/** The layout of a section. */
+	struct Entry
+	{
+		/** Returns true if this entry was created for the given section. */
+		bool matches(const Key& key) const;
+		
+		// The section
+		qint64 start_param;
+		qint64 start_offset;
+		int options;
+		std::vector<int> input_flags;
+		MapCoordVectorF input_coords;
+		
+		// The layout
+		MapCoordVector flags;
+		MapCoordVectorF coords;
+		Continuation continuation;
+		PathCoord::length_type offset;  ///< Relative to the line start, for ContinueFromOffset
+	};
+	
+	DashGroupsCache();
+	
+	/**
+	 * Looks up the layout of a section.
+	 * 
+	 * If found, appends the layout to the output (cf. append()), sets the
+	 * continuation and offset, and returns true.
+	 */
+	bool find(
+	        const Parameters& parameters,
+	        const Key& key,
+	        const SplitPathCoord& line_start,
+	        MapCoordVector& out_flags,
+	        MapCoordVectorF& out_coords,
+	        Continuation& continuation,
+	        PathCoord::length_type& offset );
+	
+	/** Stores the layout of a section. */
+	void insert(const Parameters& parameters, const Key& key, Entry* entry);
+	
+	/**
+	 * Appends the layout of a section to the output, joining it with the
+	 * previous output in the same way as VirtualPath::copy() does.
+	 */
+	static void append(
+	        const Entry& entry,
+	        const SplitPathCoord& line_start,
+	        MapCoordVector& out_flags,
+	        MapCoordVectorF& out_coords );
+	
+private:
+	struct Shard
+	{
+		QMutex mutex;
+		Parameters parameters;
+		QCache<quint64, Entry> entries;  ///< The cost is the number of coordinates.
+	};
+	
+	Shard& shard(const Key& key);
+	
+	/** Clears the shard when the parameters differ. Requires the shard's lock. */
+	static void validate(Shard& shard, const Parameters& parameters);
+	
+	static const int num_shards = 8;
+	static const int max_coords_per_shard = 1 << 13;
+	
+	Shard shards[num_shards];
+};
+
+
+LineSymbol::DashGroupsCache::Key::Key(
+        const VirtualPath& path,
+        bool path_closed,
+        const SplitPathCoord& line_start,
+        const SplitPathCoord& start,
+        const SplitPathCoord& end,
+        bool is_part_start,
+        bool is_part_end )
+ : path(path)
+ , first(line_start.index)
+ , last(end.index)
+ , start_param(keyValue(line_start.param))
+ , start_offset(keyValue(start.clen - line_start.clen))
+ , options(int(path_closed) | int(is_part_start) << 1 | int(is_part_end) << 2)
+{
+	auto& flags  = path.coords.flags;
+	auto& coords = path.coords;
+	hash = combineHash(quint64(options), quint64(start_param));
+	hash = combineHash(hash, quint64(start_offset));
+	for (auto i = first; i <= last; ++i)
+	{
+		hash = combineHash(hash, quint64(flags[i].flags()));
+		hash = combineHash(hash, hashBits(coords[i].x()));
+		hash = combineHash(hash, hashBits(coords[i].y()));
+	}
+}
+
+bool LineSymbol::DashGroupsCache::Entry::matches(const Key& key) const
+{
+	if (options != key.options
+	    || start_param != key.start_param
+	    || start_offset != key.start_offset
+	    || input_coords.size() != key.last - key.first + 1)
+		return false;
+	
+	auto& flags  = key.path.coords.flags;
+	auto& coords = key.path.coords;
+	for (auto i = key.first; i <= key.last; ++i)
+	{
+		auto j = i - key.first;
+		if (input_flags[j] != flags[i].flags() || input_coords[j] != coords[i])
+			return false;
+	}
+	return true;
+}
+
+LineSymbol::DashGroupsCache::DashGroupsCache()
+{
+	for (auto& shard : shards)
+	{
+		shard.parameters = { -1, -1, -1, -1, false };
+		shard.entries.setMaxCost(max_coords_per_shard);
+	}
+}
+
+LineSymbol::DashGroupsCache::Shard& LineSymbol::DashGroupsCache::shard(const Key& key)
+{
+	return shards[key.hash % num_shards];
+}
+
+void LineSymbol::DashGroupsCache::validate(Shard& shard, const Parameters& parameters)
+{
+	if (!(shard.parameters == parameters))
+	{
+		shard.entries.clear();
+		shard.parameters = parameters;
+	}
+}
+
+bool LineSymbol::DashGroupsCache::find(
+        const Parameters& parameters,
+        const Key& key,
+        const SplitPathCoord& line_start,
+        MapCoordVector& out_flags,
+        MapCoordVectorF& out_coords,
+        Continuation& continuation,
+        PathCoord::length_type& offset )
+{
+	auto& shard = this->shard(key);
+	QMutexLocker locker(&shard.mutex);
+	validate(shard, parameters);
+	auto entry = shard.entries.object(key.hash);
+	if (!entry || !entry->matches(key))
+		return false;
+	
+	append(*entry, line_start, out_flags, out_coords);
+	continuation = entry->continuation;
+	offset = entry->offset;
+	return true;
+}
+
+void LineSymbol::DashGroupsCache::insert(const Parameters& parameters, const Key& key, Entry* entry)
+{
+	auto& flags  = key.path.coords.flags;
+	auto& coords = key.path.coords;
+	entry->start_param = key.start_param;
+	entry->start_offset = key.start_offset;
+	entry->options = key.options;
+	entry->input_flags.reserve(key.last - key.first + 1);
+	entry->input_coords.reserve(key.last - key.first + 1);
+	for (auto i = key.first; i <= key.last; ++i)
+	{
+		entry->input_flags.push_back(flags[i].flags());
+		entry->input_coords.push_back(coords[i]);
+	}
+	auto cost = int(entry->input_coords.size() + entry->coords.size());
+	
+	auto& shard = this->shard(key);
+	QMutexLocker locker(&shard.mutex);
+	validate(shard, parameters);
+	shard.entries.insert(key.hash, entry, cost);  // Takes ownership
+}
+
+void LineSymbol::DashGroupsCache::append(
+        const Entry& entry,
+        const SplitPathCoord& line_start,
+        MapCoordVector& out_flags,
+        MapCoordVectorF& out_coords )
+{
+	if (entry.coords.empty())
+		return;
+	
+	// The first coordinate is the line start.
+	Q_ASSERT(entry.coords.size() > 1);
+	if (out_coords.empty() ||
+	    out_flags.back().isHolePoint() ||
+	    out_coords.back() != line_start.pos)
+	{
+		out_flags.push_back(entry.flags.front());
+		out_coords.push_back(line_start.pos);
+	}
+	else
+	{
+		out_flags.back().setHolePoint(false);
+		out_flags.back().setClosePoint(false);
+		out_flags.back().setCurveStart(entry.flags.front().isCurveStart());
+	}
+	out_flags.insert(out_flags.end(), entry.flags.begin() + 1, entry.flags.end());
+	out_coords.insert(out_coords.end(), entry.coords.begin() + 1, entry.coords.end());
+}
+
+
 // ### LineSymbol ###
 
-LineSymbol::LineSymbol() : Symbol(Symbol::Line)
+LineSymbol::LineSymbol()
+ : Symbol(Symbol::Line)
+ , dash_groups_cache(new DashGroupsCache())
 {
 	line_width = 0;
 	color = NULL;
@@ -266,6 +599,18 @@ void LineSymbol::createRenderables(
 	{
 		createBaselineRenderables(object, path_parts, output, guessDominantColor());
 	}
+	else if (options.testFlag(Symbol::RenderPreview))
+	{
+		createPreviewRenderables(path_parts, output);
+	}
+	else if (isPlainLine())
+	{
+		for (const auto& part : path_parts)
+		{
+			if (part.size() >= 2)
+				output.insertRenderable(new LineRenderable(this, part, part.isClosed()));
+		}
+	}
 	else
 	{
 		for (const auto& part : path_parts)
@@ -275,6 +620,40 @@ void LineSymbol::createRenderables(
 	}
 }
 
+bool LineSymbol::isPlainLine() const
+{
+	if (!color || line_width <= 0 || dashed)
+		return false;
+	if (cap_style == PointedCap && pointed_cap_length > 0)
+		return false;
+	if (have_border_lines && (border.isVisible() || right_border.isVisible()))
+		return false;
+	if ((start_symbol && !start_symbol->isEmpty()) ||
+	    (mid_symbol && !mid_symbol->isEmpty() && segment_length > 0) ||
+	    (end_symbol && !end_symbol->isEmpty()) ||
+	    (dash_symbol && !dash_symbol->isEmpty()))
+		return false;
+	return true;
+}
+
+void LineSymbol::createPreviewRenderables(const PathPartVector& path_parts, ObjectRenderables& output) const
+{
+	// The main line as a plain stroke, without dashes, borders and symbols
+	LineSymbol line_symbol;
+	line_symbol.color = (color && line_width > 0) ? color : guessDominantColor();
+	line_symbol.line_width = (color && line_width > 0) ? line_width : 0;
+	line_symbol.cap_style = (cap_style == PointedCap) ? FlatCap : cap_style;
+	line_symbol.join_style = join_style;
+	if (!line_symbol.color)
+		return;
+	
+	for (const auto& part : path_parts)
+	{
+		if (part.size() >= 2)
+			output.insertRenderable(new LineRenderable(&line_symbol, part, part.isClosed()));
+	}
+}
+
 void LineSymbol::createPathRenderables(const Object* object, bool path_closed, const MapCoordVector& flags, const MapCoordVectorF& coords, ObjectRenderables& output) const
 {
 	auto path = VirtualPath { flags, coords };
@@ -567,8 +946,7 @@ void LineSymbol::shiftCoordinates(const VirtualPath& path, double main_shift, Ma
 				{
 					middle1 = tangent_in + middle0;
 					middle1.normalize();
-					double phi1 = acos(MapCoordF::dotProduct(middle1, tangent_in));
-					offset = tan(phi1) * u_border_shift;
+					offset = tanFromCos(MapCoordF::dotProduct(middle1, tangent_in)) * u_border_shift;
 					
 					if (i > 0 && !qIsNaN(offset))
 					{
@@ -596,8 +974,7 @@ void LineSymbol::shiftCoordinates(const VirtualPath& path, double main_shift, Ma
 						// Two border corner points
 						middle1 = tangent_in + middle0;
 						middle1.normalize();
-						double phi1 = acos(MapCoordF::dotProduct(middle1, tangent_in));
-						offset = miter_limit * fabs(main_shift) + tan(phi1) * u_border_shift;
+						offset = miter_limit * fabs(main_shift) + tanFromCos(MapCoordF::dotProduct(middle1, tangent_in)) * u_border_shift;
 						
 						if (i > 0 && !qIsNaN(offset))
 						{
@@ -609,8 +986,7 @@ void LineSymbol::shiftCoordinates(const VirtualPath& path, double main_shift, Ma
 					}
 					else
 					{
-						double phi = acos(MapCoordF::dotProduct(middle0.perpRight(), tangent_in));
-						offset = fabs(1.0/tan(phi) * shift);
+						offset = fabs(shift / tanFromCos(MapCoordF::dotProduct(middle0.perpRight(), tangent_in)));
 					}
 				}
 				
@@ -627,8 +1003,7 @@ void LineSymbol::shiftCoordinates(const VirtualPath& path, double main_shift, Ma
 				// Inner side of corner (or no corner), and both sides are beziers
 				// old behaviour
 				right_vector = middle0.perpRight();
-				double phi = acos(MapCoordF::dotProduct(right_vector, tangent_in));
-				double sin_phi = sin(phi);
+				double sin_phi = sinFromCos(MapCoordF::dotProduct(right_vector, tangent_in));
 				double inset = (sin_phi > (1.0/miter_limit)) ? (1.0 / sin_phi) : miter_limit;
 				segment_start = coords_i + (shift * inset) * right_vector;
 			}
@@ -637,8 +1012,8 @@ void LineSymbol::shiftCoordinates(const VirtualPath& path, double main_shift, Ma
 				// Inner side of corner (or no corner), and no more than on bezier involved
 				
 				// Default solution
-				double phi = acos(MapCoordF::dotProduct(middle0.perpRight(), tangent_in));
-				double tan_phi = tan(phi);
+				double cos_phi = MapCoordF::dotProduct(middle0.perpRight(), tangent_in);
+				double tan_phi = tanFromCos(cos_phi);
 				offset = -fabs(shift/tan_phi);
 				
 				if (tan_phi >= 1.0)
@@ -665,7 +1040,7 @@ void LineSymbol::shiftCoordinates(const VirtualPath& path, double main_shift, Ma
 						out_coords.push_back(coords_i + shift * right_vector - offset * tangent_out);
 						
 						out_flags.push_back(no_flags);
-						out_coords.push_back(out_coords.back() - (shift - main_shift) * qMax(0.0, 1.0 / sin(phi) - miter_limit) * middle0);
+						out_coords.push_back(out_coords.back() - (shift - main_shift) * qMax(0.0, 1.0 / sinFromCos(cos_phi) - miter_limit) * middle0);
 						
 						// single or second border corner point
 						segment_start = coords_i + shift * right_vector - offset * tangent_out;
@@ -1032,6 +1407,11 @@ void LineSymbol::processDashedLine(
 	
 	auto last = path.last_index;
 	
+	// Without mid symbols and pointed caps, the layout of each section
+	// between dash points creates no renderables, so it can be cached.
+	bool use_cache = !(mid_symbols_per_spot > 0 && mid_symbol && !mid_symbol->isEmpty())
+	                 && !(cap_style == PointedCap && pointed_cap_length > 0);
+	
 	auto groups_start = SplitPathCoord::begin(path_coords);
 	auto line_start   = groups_start;
 	for (bool is_part_end = false; !is_part_end; )
@@ -1045,16 +1425,75 @@ void LineSymbol::processDashedLine(
 		bool is_part_start = (groups_start.index == path.first_index);
 		is_part_end = (groups_end_index == last);
 		
-		line_start = createDashGroups(path, path_closed,
-		                              line_start, groups_start, groups_end,
-		                              is_part_start, is_part_end,
-		                              out_flags, out_coords, output);
+		if (use_cache)
+			line_start = createCachedDashGroups(path, path_closed,
+			                                    line_start, groups_start, groups_end,
+			                                    is_part_start, is_part_end,
+			                                    out_flags, out_coords, output);
+		else
+			line_start = createDashGroups(path, path_closed,
+			                              line_start, groups_start, groups_end,
+			                              is_part_start, is_part_end,
+			                              out_flags, out_coords, output);
 		
 		groups_start = groups_end; // Search then next split (node) after groups_end (current node).
 	}
 	Q_ASSERT(line_start.clen == groups_start.clen);
 }
 
+SplitPathCoord LineSymbol::createCachedDashGroups(
+        const VirtualPath& path,
+        bool path_closed,
+        const SplitPathCoord& line_start,
+        const SplitPathCoord& start,
+        const SplitPathCoord& end,
+        bool is_part_start,
+        bool is_part_end,
+        MapCoordVector& out_flags,
+        MapCoordVectorF& out_coords,
+        ObjectRenderables& output ) const
+{
+	// The parameters and the key cover everything which createDashGroups()
+	// depends on when there are no mid symbols and no pointed caps.
+	const DashGroupsCache::Parameters parameters = {
+	    dash_length, break_length, in_group_break_length, dashes_in_group, half_outer_dashes
+	};
+	const DashGroupsCache::Key key(path, path_closed, line_start, start, end, is_part_start, is_part_end);
+	
+	auto continuation = DashGroupsCache::ContinueFromLineStart;
+	auto offset = PathCoord::length_type(0);
+	if (!dash_groups_cache->find(parameters, key, line_start, out_flags, out_coords, continuation, offset))
+	{
+		auto entry = new DashGroupsCache::Entry();
+		auto next_line_start = createDashGroups(path, path_closed,
+		                                        line_start, start, end,
+		                                        is_part_start, is_part_end,
+		                                        entry->flags, entry->coords, output);
+		offset = next_line_start.clen - line_start.clen;
+		if (next_line_start.clen == line_start.clen)
+			continuation = DashGroupsCache::ContinueFromLineStart;
+		else if (next_line_start.clen == end.clen)
+			continuation = DashGroupsCache::ContinueFromEnd;
+		else
+			continuation = DashGroupsCache::ContinueFromOffset;
+		entry->continuation = continuation;
+		entry->offset = offset;
+		DashGroupsCache::append(*entry, line_start, out_flags, out_coords);
+		dash_groups_cache->insert(parameters, key, entry);
+	}
+	
+	switch (continuation)
+	{
+	case DashGroupsCache::ContinueFromLineStart:
+		return line_start;
+	case DashGroupsCache::ContinueFromEnd:
+		return end;
+	case DashGroupsCache::ContinueFromOffset:
+		break;
+	}
+	return SplitPathCoord::at(line_start.clen + offset, line_start);
+}
+
 SplitPathCoord LineSymbol::createDashGroups(
         const VirtualPath& path,
         bool path_closed,
@@ -1279,6 +1718,9 @@ void LineSymbol::createDashSymbolRenderables(
 		++i;
 	}
 	
+	// Unscaled instances share their renderables.
+	QVector<QPointF> positions;
+	QVector<qreal> rotations;
 	for (; i <= last; ++i)
 	{
 		if (flags[i].isDashPoint())
@@ -1286,9 +1728,18 @@ void LineSymbol::createDashSymbolRenderables(
 			auto params = path.calculateTangentScaling(i);
 			//params.first.perpRight();
 			params.second = qMin(params.second, 2.0 * LineSymbol::miterLimit());
-			dash_symbol->createRenderablesScaled(coords[i], params.first.angle(), output, params.second);
+			if (qAbs(params.second - 1.0) < 0.0001)
+			{
+				positions.push_back(coords[i]);
+				rotations.push_back(params.first.angle());
+			}
+			else
+			{
+				dash_symbol->createRenderablesScaled(coords[i], params.first.angle(), output, params.second);
+			}
 		}
 	}
+	dash_symbol->createRenderablesForInstances(positions, rotations, output);
 }
 
 void LineSymbol::createMidSymbolRenderables(
@@ -1311,13 +1762,18 @@ void LineSymbol::createMidSymbolRenderables(
 	auto& path_coords = path.path_coords;
 	Q_ASSERT(!path_coords.empty());
 	
+	// All instances share their renderables.
+	QVector<QPointF> positions;
+	QVector<qreal> rotations;
+	
 	auto groups_start = SplitPathCoord::begin(path_coords);
 	if (end_length == 0 && !path_closed)
 	{
 		// Insert point at start coordinate
 		if (mid_symbol_rotatable)
 			orientation = groups_start.tangentVector().angle();
-		mid_symbol->createRenderablesScaled(groups_start.pos, orientation, output);
+		positions.push_back(groups_start.pos);
+		rotations.push_back(orientation);
 	}
 	
 	auto part_end = path.last_index;
@@ -1344,12 +1800,14 @@ void LineSymbol::createMidSymbolRenderables(
 					// Insert point at start coordinate
 					if (mid_symbol_rotatable)
 						orientation = groups_start.tangentVector().angle();
-					mid_symbol->createRenderablesScaled(groups_start.pos, orientation, output);
+					positions.push_back(groups_start.pos);
+					rotations.push_back(orientation);
 					
 					// Insert point at end coordinate
 					if (mid_symbol_rotatable)
 						orientation = groups_end.tangentVector().angle();
-					mid_symbol->createRenderablesScaled(groups_end.pos, orientation, output);
+					positions.push_back(groups_end.pos);
+					rotations.push_back(orientation);
 				}
 			}
 			else
@@ -1377,7 +1835,8 @@ void LineSymbol::createMidSymbolRenderables(
 							split = SplitPathCoord::at(position, split);
 							if (mid_symbol_rotatable)
 								orientation = split.tangentVector().angle();
-							mid_symbol->createRenderablesScaled(split.pos, orientation, output);
+							positions.push_back(split.pos);
+							rotations.push_back(orientation);
 						}
 					}
 				}
@@ -1413,7 +1872,8 @@ void LineSymbol::createMidSymbolRenderables(
 							split = SplitPathCoord::at(position, split);
 							if (mid_symbol_rotatable)
 								orientation = split.tangentVector().angle();
-							mid_symbol->createRenderablesScaled(split.pos, orientation, output);
+							positions.push_back(split.pos);
+							rotations.push_back(orientation);
 						}
 					}
 				}
@@ -1422,11 +1882,14 @@ void LineSymbol::createMidSymbolRenderables(
 			// Insert point at end coordinate
 			if (mid_symbol_rotatable)
 				orientation = groups_end.tangentVector().angle();
-			mid_symbol->createRenderablesScaled(groups_end.pos, orientation, output);
+			positions.push_back(groups_end.pos);
+			rotations.push_back(orientation);
 		}
 		
 		groups_start = groups_end; // Search then next split (node) after groups_end (current node).
 	}
+	
+	mid_symbol->createRenderablesForInstances(positions, rotations, output);
 }
 
 void LineSymbol::colorDeleted(const MapColor* color)
@@ -1643,6 +2106,20 @@ float LineSymbol::calculateLargestLineExtent(Map* map) const
 	return result;
 }
 
+bool LineSymbol::hasLocalPathOutput() const
+{
+	if (dashed || minimum_length > 0 || cap_style == PointedCap)
+		return false;
+	if ((start_symbol && !start_symbol->isEmpty()) ||
+	    (mid_symbol && !mid_symbol->isEmpty()) ||
+	    (end_symbol && !end_symbol->isEmpty()) ||
+	    (dash_symbol && !dash_symbol->isEmpty()))
+		return false;
+	if (have_border_lines && (border.dashed || right_border.dashed))
+		return false;
+	return true;
+}
+
 void LineSymbol::setStartSymbol(PointSymbol* symbol)
 {
 	replaceSymbol(start_symbol, symbol, LineSymbolSettings::tr("Start symbol"));
@@ -22,6 +22,8 @@
 #ifndef _OPENORIENTEERING_SYMBOL_LINE_H_
 #define _OPENORIENTEERING_SYMBOL_LINE_H_
 
+#include <memory>
+
 #include "object.h"
 #include "symbol.h"
 #include "symbol_properties_widget.h"
@@ -121,6 +123,24 @@ public:
 	 */
 	void createPathCoordRenderables(const Object* object, const VirtualPath& path, bool path_closed, ObjectRenderables& output) const;
 	
+	/**
+	 * Creates the renderables for Symbol::RenderPreview: the main line as a
+	 * plain stroke with the line width, or a thin line in the dominant color
+	 * if there is no main line.
+	 */
+	void createPreviewRenderables(const PathPartVector& path_parts, ObjectRenderables& output) const;
+	
+	/**
+	 * Returns true if this symbol is rendered as a single solid stroke:
+	 * with a color and a line width, but without dashes, borders, pointed
+	 * caps and point symbols.
+	 * 
+	 * The renderables for such symbols are created in a plain loop over the
+	 * path parts. This is determined once per object, not for every part,
+	 * because the symbol settings are modified directly by the editor.
+	 */
+	bool isPlainLine() const;
+	
 	void colorDeleted(const MapColor* color) override;
 	bool containsColor(const MapColor* color) const override;
 	const MapColor* guessDominantColor() const override;
@@ -149,6 +169,8 @@ public:
 	 */
 	float calculateLargestLineExtent(Map* map) const override;
 	
+	bool hasLocalPathOutput() const override;
+	
 	/**
 	 * Returns the limit for miter joins in units of the line width.
 	 * See the Qt docs for QPainter::setMiterJoin().
@@ -295,6 +317,26 @@ protected:
 	        ObjectRenderables& output
 	) const;
 	
+	class DashGroupsCache;
+	
+	/**
+	 * Like createDashGroups(), but reuses the cached result for sections
+	 * of identical geometry. This must be used only when the dash groups
+	 * create no renderables.
+	 */
+	SplitPathCoord createCachedDashGroups(
+	        const VirtualPath& path,
+	        bool path_closed,
+	        const SplitPathCoord& line_start,
+	        const SplitPathCoord& start,
+	        const SplitPathCoord& end,
+	        bool is_part_start,
+	        bool is_part_end,
+	        MapCoordVector& out_flags,
+	        MapCoordVectorF& out_coords,
+	        ObjectRenderables& output
+	) const;
+	
 	void createDashSymbolRenderables(
 	        const VirtualPath& path,
 	        bool path_closed,
@@ -347,6 +389,9 @@ protected:
 	bool have_border_lines;
 	LineSymbolBorder border;
 	LineSymbolBorder right_border;
+	
+	// Cached layout of dashed sections, cf. createCachedDashGroups()
+	std::unique_ptr<DashGroupsCache> dash_groups_cache;
 };
 
 
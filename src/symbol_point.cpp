@@ -21,6 +21,9 @@
 
 #include "symbol_point.h"
 
+#include <memory>
+
+#include <QMutex>
 #include <QVBoxLayout>
 #include <QXmlStreamAttributes>
 
@@ -31,10 +34,26 @@
 #include "symbol_properties_widget.h"
 #include "symbol_point_editor.h"
 #include "renderable_implementation.h"
+#include "symbol_area.h"
 #include "util.h"
 #include "util_gui.h"
 
-PointSymbol::PointSymbol() : Symbol(Symbol::Point)
+/**
+ * The prototype renderables which are shared by the objects of a point symbol.
+ */
+struct PointSymbol::PrototypeCache
+{
+	QMutex mutex;
+	QRectF extent;
+	std::unique_ptr<ObjectRenderables> renderables;
+	int generation = 0;  ///< Map renderables generations start at 1.
+};
+
+
+
+PointSymbol::PointSymbol()
+ : Symbol(Symbol::Point)
+ , prototype_cache(new PrototypeCache())
 {
 	rotatable = false;
 	inner_radius = 1000;
@@ -99,12 +118,41 @@ void PointSymbol::createRenderables(
 			point->setInnerColor(temp_color);
 		}
 	}
-	else
+	else if (!createSharedRenderables(object, coords[0], rotation, output))
 	{
 		createRenderablesScaled(coords[0], rotation, output, 1.0f);
 	}
 }
 
+bool PointSymbol::createSharedRenderables(const Object* object, MapCoordF coord, float rotation, ObjectRenderables& output) const
+{
+	const Map* map = object->getMap();
+	if (!map || objects.empty())
+		return false;
+	
+	// Fill patterns of area elements are aligned to the map, not to the point.
+	for (const Symbol* symbol : symbols)
+	{
+		if (symbol->getType() == Symbol::Area && symbol->asArea()->getNumFillPatterns() > 0)
+			return false;
+	}
+	
+	QMutexLocker locker(&prototype_cache->mutex);
+	if (prototype_cache->generation != map->getRenderablesGeneration())
+	{
+		// Renderables which still use the old prototype keep it alive.
+		prototype_cache->extent = QRectF();
+		prototype_cache->renderables.reset(new ObjectRenderables(prototype_cache->extent));
+		createRenderablesScaled(MapCoordF(0, 0), 0.0f, *prototype_cache->renderables);
+		prototype_cache->generation = map->getRenderablesGeneration();
+	}
+	
+	QVector<qreal> rotations;
+	if (rotation != 0.0f)
+		rotations.push_back(rotation);
+	return output.insertPatternRenderables(*prototype_cache->renderables, QVector<QPointF>(1, coord), rotations);
+}
+
 void PointSymbol::createRenderablesScaled(MapCoordF coord, float rotation, ObjectRenderables& output, float coord_scale) const
 {
 	if (inner_color && inner_radius > 0)
@@ -151,6 +199,34 @@ void PointSymbol::createRenderablesScaled(MapCoordF coord, float rotation, Objec
 	}
 }
 
+void PointSymbol::createRenderablesForInstances(const QVector<QPointF>& positions, const QVector<qreal>& rotations, ObjectRenderables& output) const
+{
+	Q_ASSERT(rotations.isEmpty() || rotations.size() == positions.size());
+	
+	// Fill patterns of area elements are aligned to the map, not to the point.
+	bool can_share = positions.size() > 1;
+	if (can_share && !rotations.isEmpty())
+	{
+		for (const Symbol* symbol : symbols)
+		{
+			if (symbol->getType() == Symbol::Area && symbol->asArea()->getNumFillPatterns() > 0)
+				can_share = false;
+		}
+	}
+	
+	if (can_share)
+	{
+		PointObject point_object(this);
+		ObjectRenderables prototype(point_object);
+		createRenderablesScaled(MapCoordF(0, 0), 0.0f, prototype);
+		if (output.insertPatternRenderables(prototype, positions, rotations))
+			return;
+	}
+	
+	for (int i = 0; i < positions.size(); ++i)
+		createRenderablesScaled(MapCoordF(positions[i]), rotations.isEmpty() ? 0.0f : rotations[i], output);
+}
+
 int PointSymbol::getNumElements() const
 {
 	return (int)objects.size();
@@ -22,6 +22,8 @@
 #ifndef _OPENORIENTEERING_SYMBOL_POINT_H_
 #define _OPENORIENTEERING_SYMBOL_POINT_H_
 
+#include <QScopedPointer>
+
 #include "symbol.h"
 #include "symbol_properties_widget.h"
 
@@ -69,6 +71,19 @@ public:
 	
 	void createRenderablesScaled(MapCoordF coord, float rotation, ObjectRenderables& output, float coord_scale = 1.0f) const;
 	
+	/**
+	 * Creates the renderables for many instances of this symbol.
+	 * 
+	 * The renderables of a single instance are created only once, and they
+	 * are shared by all instances (cf. PatternRenderable).
+	 * 
+	 * @param positions The positions of the instances.
+	 * @param rotations The rotations of the instances (radians), either
+	 *                  empty or of the same size as positions.
+	 * @param output    The container which receives the renderables.
+	 */
+	void createRenderablesForInstances(const QVector<QPointF>& positions, const QVector<qreal>& rotations, ObjectRenderables& output) const;
+	
 	void colorDeleted(const MapColor* color) override;
 	bool containsColor(const MapColor* color) const override;
 	const MapColor* guessDominantColor() const override;
@@ -126,6 +141,22 @@ protected:
 	bool loadImpl(QXmlStreamReader& xml, const Map& map, SymbolDictionary& symbol_dict) override;
 	bool equalsImpl(const Symbol* other, Qt::CaseSensitivity case_sensitivity) const override;
 	
+	/**
+	 * Creates the renderables of a point object by sharing the renderables
+	 * of a prototype at the origin.
+	 * 
+	 * The prototype is created once per renderables generation of the
+	 * object's map (cf. Map::getRenderablesGeneration()). The renderables
+	 * of the objects are lightweight instances (cf. PatternRenderable).
+	 * 
+	 * Returns false if the renderables cannot be shared. This is the case
+	 * for objects which are not in a map, for symbols without elements, and
+	 * for elements with fill patterns which are aligned to the map.
+	 */
+	bool createSharedRenderables(const Object* object, MapCoordF coord, float rotation, ObjectRenderables& output) const;
+	
+	struct PrototypeCache;
+	
 	std::vector<Object*> objects;
 	std::vector<Symbol*> symbols;
 	
@@ -134,6 +165,8 @@ protected:
 	const MapColor* inner_color;
 	int outer_width;		// in 1/1000 mm
 	const MapColor* outer_color;
+	
+	mutable QScopedPointer<PrototypeCache> prototype_cache;
 };
 
 
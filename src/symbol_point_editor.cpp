@@ -328,7 +328,7 @@ bool PointSymbolEditorWidget::changeCurrentCoordinate(MapCoordF new_coord)
 	}
 	
 	updateCoordsTable();
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 	return true;
 }
@@ -360,7 +360,7 @@ bool PointSymbolEditorWidget::addCoordinate(MapCoordF new_coord)
 	
 	updateCoordsTable();
 	coords_table->setCurrentItem(coords_table->item(row, (coords_table->currentColumn() < 0) ? 0 : coords_table->currentColumn()));
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 	return true;
 }
@@ -509,7 +509,7 @@ void PointSymbolEditorWidget::deleteCurrentElement()
 	int pos = row - 1;
 	symbol->deleteElement(pos);
 	delete element_list->item(row);
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
@@ -582,7 +582,7 @@ void PointSymbolEditorWidget::pointInnerRadiusChanged(double value)
 {
 	PointSymbol* symbol = reinterpret_cast<PointSymbol*>(getCurrentElementSymbol());
 	symbol->inner_radius = qRound(1000 * 0.5 * value);
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
@@ -590,7 +590,7 @@ void PointSymbolEditorWidget::pointInnerColorChanged()
 {
 	PointSymbol* symbol = reinterpret_cast<PointSymbol*>(getCurrentElementSymbol());
 	symbol->inner_color = point_inner_color_edit->color();
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
@@ -598,7 +598,7 @@ void PointSymbolEditorWidget::pointOuterWidthChanged(double value)
 {
 	PointSymbol* symbol = reinterpret_cast<PointSymbol*>(getCurrentElementSymbol());
 	symbol->outer_width = qRound(1000 * value);
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
@@ -606,7 +606,7 @@ void PointSymbolEditorWidget::pointOuterColorChanged()
 {
 	PointSymbol* symbol = reinterpret_cast<PointSymbol*>(getCurrentElementSymbol());
 	symbol->outer_color = point_outer_color_edit->color();
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
@@ -614,7 +614,7 @@ void PointSymbolEditorWidget::lineWidthChanged(double value)
 {
 	LineSymbol* symbol = reinterpret_cast<LineSymbol*>(getCurrentElementSymbol());
 	symbol->line_width = qRound(1000 * value);
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
@@ -622,7 +622,7 @@ void PointSymbolEditorWidget::lineColorChanged()
 {
 	LineSymbol* symbol = reinterpret_cast<LineSymbol*>(getCurrentElementSymbol());
 	symbol->color = line_color_edit->color();
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
@@ -630,7 +630,7 @@ void PointSymbolEditorWidget::lineCapChanged(int index)
 {
 	LineSymbol* symbol = reinterpret_cast<LineSymbol*>(getCurrentElementSymbol());
 	symbol->cap_style = static_cast<LineSymbol::CapStyle>(line_cap_edit->itemData(index).toInt());
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
@@ -638,7 +638,7 @@ void PointSymbolEditorWidget::lineJoinChanged(int index)
 {
 	LineSymbol* symbol = reinterpret_cast<LineSymbol*>(getCurrentElementSymbol());
 	symbol->join_style = static_cast<LineSymbol::JoinStyle>(line_join_edit->itemData(index).toInt());
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
@@ -657,7 +657,7 @@ void PointSymbolEditorWidget::lineClosedClicked(bool checked)
 		path->deleteCoordinate(path->getCoordinateCount() - 1, false);
 	
 	updateCoordsTable();
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
@@ -665,7 +665,7 @@ void PointSymbolEditorWidget::areaColorChanged()
 {
 	AreaSymbol* symbol = reinterpret_cast<AreaSymbol*>(getCurrentElementSymbol());
 	symbol->color = area_color_edit->color();
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
@@ -703,7 +703,7 @@ void PointSymbolEditorWidget::coordinateChanged(int row, int column)
 					path->getCoordinate(row).setY(-new_value);
 			}
 			
-			map->updateAllObjectsWithSymbol(symbol);
+			updateEditedSymbol();
 			emit symbolEdited();
 		}
 		else
@@ -732,7 +732,7 @@ void PointSymbolEditorWidget::coordinateChanged(int row, int column)
 		path->setCoordinate(row, coord);
 		
 		updateCoordsTable();
-		map->updateAllObjectsWithSymbol(symbol);
+		updateEditedSymbol();
 		emit symbolEdited();
 	}
 }
@@ -768,7 +768,7 @@ void PointSymbolEditorWidget::deleteCoordClicked()
 	updateCoordsTable();	// NOTE: incremental updates (to the curve start boxes) would be possible but mean some implementation effort
 	center_coords_button->setEnabled(path->getCoordinateCount() > 0);
 	updateDeleteCoordButton();
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
@@ -807,7 +807,7 @@ void PointSymbolEditorWidget::centerCoordsClicked()
 	}
 	
 	updateCoordsTable();
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
@@ -919,10 +919,19 @@ void PointSymbolEditorWidget::insertElement(Object* object, Symbol* element_symb
 	symbol->addElement(pos, object, element_symbol);
 	element_list->insertItem(row, getLabelForSymbol(element_symbol));
 	element_list->setCurrentRow(row);
-	map->updateAllObjectsWithSymbol(symbol);
+	updateEditedSymbol();
 	emit symbolEdited();
 }
 
+void PointSymbolEditorWidget::updateEditedSymbol()
+{
+	// Only the preview of the edited symbol is needed immediately.
+	// Other objects and dependent symbols' objects follow in the background.
+	map->scheduleUpdateOfAllObjectsWithSymbol(symbol);
+	if (midpoint_object)
+		midpoint_object->update();
+}
+
 QString PointSymbolEditorWidget::getLabelForSymbol(const Symbol* symbol) const
 {
 	if (symbol->getType() == Symbol::Point)
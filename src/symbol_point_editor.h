@@ -118,6 +118,10 @@ private:
 	void updateCoordsRow(int row);
 	
 	void insertElement(Object* object, Symbol* symbol);
+	
+	/** Updates the edited symbol's preview now, and other objects later. */
+	void updateEditedSymbol();
+	
 	QString getLabelForSymbol(const Symbol* symbol) const;
 	
 	Symbol* getCurrentElementSymbol();
@@ -21,18 +21,25 @@
 
 #include "symbol_setting_dialog.h"
 
+#include <memory>
+
 #include <QColorDialog>
+#include <QCoreApplication>
 #include <QDialogButtonBox>
+#include <QEvent>
 #include <QGridLayout>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QMenu>
+#include <QPointer>
 #include <QPushButton>
+#include <QRunnable>
 #include <QSplitter>
 #include <QStringBuilder>
 #include <QToolButton>
 #include <QVBoxLayout>
 
+#include "core/task_pool.h"
 #include "gui/widgets/template_list_widget.h"
 #include "map.h"
 #include "object.h"
@@ -50,18 +57,94 @@
 #include "symbol_point_editor.h"
 #include "symbol_combined.h"
 #include "symbol_properties_widget.h"
+#include "settings.h"
 #include "util.h"
 
+namespace
+{
+	/**
+	 * The time of no further modifications before the preview is updated.
+	 * 
+	 * Dragging a spin box produces many intermediate values.
+	 */
+	const int preview_update_delay_msecs = 100;
+}
+
+
+
+// ### SymbolSettingDialog::IconJob ###
+
+/**
+ * Renders the icon of a copy of the edited symbol in a worker thread.
+ * 
+ * The copy still refers to the source map's colors and symbols, which are
+ * not modified while the modal dialog is open. The job is an object of the
+ * GUI thread. It deletes itself after finishing, even if the dialog was
+ * deleted in the meantime.
+ */
+class SymbolSettingDialog::IconJob : public QObject, public QRunnable
+{
+public:
+	IconJob(SymbolSettingDialog* dialog, Symbol* copy, const Map* map)
+	 : dialog(dialog)
+	 , copy(copy)
+	 , map(map)
+	 , icon_size(Settings::getInstance().getSymbolWidgetIconSizePx())
+	{
+		setAutoDelete(false);
+	}
+	
+	void run() override
+	{
+		icon = copy->createIcon(map, icon_size, true, 1);
+		// Nothing must be accessed after posting the event.
+		QCoreApplication::postEvent(this, new QEvent(finishedEvent()));
+	}
+	
+	bool event(QEvent* event) override
+	{
+		if (event->type() != finishedEvent())
+			return QObject::event(event);
+		
+		if (dialog)
+			dialog->finishIconJob(this, icon);
+		deleteLater();
+		return true;
+	}
+	
+private:
+	static QEvent::Type finishedEvent()
+	{
+		static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+		return type;
+	}
+	
+	QPointer<SymbolSettingDialog> dialog;
+	std::unique_ptr<Symbol> copy;
+	const Map* map;
+	const int icon_size;
+	QImage icon;
+};
+
+
+
+// ### SymbolSettingDialog ###
+
 SymbolSettingDialog::SymbolSettingDialog(Symbol* source_symbol, Map* source_map, QWidget* parent)
 : QDialog(parent, Qt::CustomizeWindowHint | Qt::WindowTitleHint | Qt::WindowMaximizeButtonHint),
   source_map(source_map),
   source_symbol(source_symbol),
-  source_symbol_copy(source_symbol->duplicate())	// don't rely on external entity
+  source_symbol_copy(source_symbol->duplicate()),	// don't rely on external entity
+  icon_job(nullptr)
 {
 	setWindowTitle(tr("Symbol settings"));
 	setSizeGripEnabled(true);
 	symbol_modified = false;
 	
+	preview_update_timer.setSingleShot(true);
+	preview_update_timer.setInterval(preview_update_delay_msecs);
+	connect(&preview_update_timer, &QTimer::timeout, this, &SymbolSettingDialog::updatePreview);
+	
 	symbol = source_symbol->duplicate();
 	symbol->setHidden(false);
 	
@@ -186,8 +269,33 @@ Symbol* SymbolSettingDialog::getNewSymbol() const
 
 void SymbolSettingDialog::updatePreview()
 {
-	symbol_icon_label->setPixmap(QPixmap::fromImage(symbol->getIcon(source_map, true)));
-	preview_map->updateAllObjects();
+	preview_update_timer.stop();
+	updateSymbolIcon();
+	preview_map->scheduleUpdateOfAllObjects();
+}
+
+void SymbolSettingDialog::updateSymbolIcon()
+{
+	if (symbol->getContainedTypes() & Symbol::Text)
+	{
+		icon_job = nullptr;
+		symbol_icon_label->setPixmap(QPixmap::fromImage(symbol->getIcon(source_map, true)));
+		return;
+	}
+	
+	auto job = new IconJob(this, symbol->duplicate(), source_map);
+	icon_job = job;
+	TaskPool::start(job, TaskPool::Interactive);
+}
+
+void SymbolSettingDialog::finishIconJob(const IconJob* job, const QImage& icon)
+{
+	if (job != icon_job)
+		return;
+	
+	icon_job = nullptr;
+	symbol->setIcon(icon);
+	symbol_icon_label->setPixmap(QPixmap::fromImage(icon));
 }
 
 void SymbolSettingDialog::loadTemplateClicked()
@@ -245,7 +353,7 @@ void SymbolSettingDialog::centerTemplateGravity()
 
 void SymbolSettingDialog::createPreviewMap()
 {
-	symbol_icon_label->setPixmap(QPixmap::fromImage(symbol->getIcon(source_map)));
+	updateSymbolIcon();
 	
 	for (int i = 0; i < (int)preview_objects.size(); ++i)
 		preview_map->deleteObject(preview_objects[i], false);
@@ -469,8 +577,12 @@ void SymbolSettingDialog::setSymbolModified(bool modified)
 {
 	symbol_modified = modified;
 	updateSymbolLabel();
-	updatePreview();
 	updateButtons();
+	
+	// A running icon job may have seen an older state of the symbol.
+	icon_job = nullptr;
+	symbol->resetIcon();
+	preview_update_timer.start();
 }
 
 void SymbolSettingDialog::updateSymbolLabel()
@@ -22,6 +22,7 @@
 #define _OPENORIENTEERING_SYMBOL_SETTING_DIALOG_H_
 
 #include <QDialog>
+#include <QTimer>
 
 class QLabel;
 class QToolButton;
@@ -114,6 +115,9 @@ public slots:
 	
 	/** 
 	 * Updates the preview from the current symbol settings.
+	 * 
+	 * The icon is rendered in a worker thread, and the preview map's objects
+	 * are updated when they are drawn.
 	 */
 	void updatePreview();
 	
@@ -146,6 +150,20 @@ protected:
 	void createPreviewMap();
 	
 private:
+	class IconJob;
+	
+	/**
+	 * Starts rendering the icon of the current symbol.
+	 * 
+	 * Text symbols are rendered immediately.
+	 */
+	void updateSymbolIcon();
+	
+	/**
+	 * Shows the icon if the job is the most recent icon job.
+	 */
+	void finishIconJob(const IconJob* job, const QImage& icon);
+	
 	bool symbol_modified;
 	
 	Map* const source_map;
@@ -169,6 +187,12 @@ private:
 	QLabel* symbol_text_label;
 	
 	SymbolPropertiesWidget* properties_widget;
+	
+	/** Delays the preview update while the settings change rapidly. */
+	QTimer preview_update_timer;
+	
+	/** The most recent icon job, to be compared only. */
+	const IconJob* icon_job;
 };
 
 #endif
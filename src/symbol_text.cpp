@@ -302,6 +302,28 @@ void TextSymbol::updateQFont()
 
 	metrics = QFontMetricsF(qfont);
 	tab_interval = 8.0 * metrics.averageCharWidth();
+	
+	QMutexLocker locker(&shaped_text_mutex);
+	shaped_text_cache.clear();
+}
+
+TextSymbol::ShapedText TextSymbol::getShapedText(const QString& text) const
+{
+	QMutexLocker locker(&shaped_text_mutex);
+	auto cached = shaped_text_cache.constFind(text);
+	if (cached != shaped_text_cache.constEnd())
+		return *cached;
+	
+	ShapedText shaped_text;
+	shaped_text.path.setFillRule(Qt::WindingFill); // Otherwise, when text and an underline intersect, holes appear
+	shaped_text.path.addText(0.0, 0.0, qfont, text);
+	shaped_text.width = metrics.width(text);
+	
+	// Maps with many different labels must not grow the cache without limit.
+	if (shaped_text_cache.size() >= 4096)
+		shaped_text_cache.clear();
+	shaped_text_cache.insert(text, shaped_text);
+	return shaped_text;
 }
 
 #ifndef NO_NATIVE_FILE_FORMAT
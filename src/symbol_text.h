@@ -26,6 +26,9 @@
 
 #include <QGroupBox>
 #include <QDialog>
+#include <QHash>
+#include <QMutex>
+#include <QPainterPath>
 
 #include "symbol_properties_widget.h"
 
@@ -103,6 +106,25 @@ public:
 	/** Updates the internal QFont from the font settings. */
 	void updateQFont();
 	
+	/** The outline and the metrics of a text in the internal font. */
+	struct ShapedText
+	{
+		QPainterPath path;     ///< The glyph outlines, for the origin at the left end of the baseline
+		qreal width;           ///< QFontMetricsF::width() of the text
+	};
+	
+	/**
+	 * Returns the outline and the metrics of the given text.
+	 * 
+	 * The results are cached, so objects with the same text and symbol share
+	 * the outline. The cache is cleared by updateQFont().
+	 * 
+	 * This is meant for the final parts of a text layout. Intermediate
+	 * strings, e.g. while trying word wrap positions, shall be measured with
+	 * getFontMetrics() so that they do not fill the cache.
+	 */
+	ShapedText getShapedText(const QString& text) const;
+	
 	/** Calculates the factor to convert from the real font size to the internal font size */
 	inline double calculateInternalScaling() const {return internal_point_size / (0.001 * font_size);}
 	
@@ -180,6 +202,9 @@ protected:
 	std::vector<int> custom_tabs;
 	
 	double tab_interval;		/// default tab interval length in text coordinates
+	
+	mutable QMutex shaped_text_mutex;
+	mutable QHash<QString, ShapedText> shaped_text_cache;
 };
 
 class TextSymbolSettings : public SymbolPropertiesWidget
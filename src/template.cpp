@@ -23,18 +23,25 @@
 
 #include <QCoreApplication>
 #include <QDebug>
+#include <QEvent>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QPainter>
 #include <QPixmap>
+#include <QPointer>
+#include <QRunnable>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
 #include "core/map_view.h"
+#include "core/task_pool.h"
+#include "core/tracing.h"
 #include "map.h"
 #include "template_image.h"
 #include "template_map.h"
+#include "template_mosaic.h"
+#include "template_tile_server.h"
 #include "template_track.h"
 #include "util.h"
 #include "util/xml_stream_util.h"
@@ -99,11 +106,74 @@ void TemplateTransform::load(QXmlStreamReader& xml)
 
 
 
+// ### TemplatePreloader ###
+
+TemplatePreloader::~TemplatePreloader()
+{
+	; // nothing
+}
+
+
+
+// ### Template::LoadJob ###
+
+/**
+ * Runs a template's preloader in a worker thread, and lets the template
+ * continue loading in the GUI thread when the preloader has finished.
+ * 
+ * The job is an object of the GUI thread. It deletes itself after
+ * finishing, even if the template was deleted in the meantime.
+ */
+class Template::LoadJob : public QObject, public QRunnable
+{
+public:
+	LoadJob(Template* temp, std::unique_ptr<TemplatePreloader> preloader)
+	 : temp(temp)
+	 , preloader(std::move(preloader))
+	{
+		setAutoDelete(false);
+	}
+	
+	void run() override
+	{
+		{
+			MAPPER_TRACE_SCOPE("template", "Template::Preloader::run");
+			preloader->run();
+		}
+		// Nothing must be accessed after posting the event.
+		QCoreApplication::postEvent(this, new QEvent(finishedEvent()));
+	}
+	
+	bool event(QEvent* event) override
+	{
+		if (event->type() != finishedEvent())
+			return QObject::event(event);
+		
+		if (temp)
+			temp->finishLoading(this, std::move(preloader));
+		deleteLater();
+		return true;
+	}
+	
+private:
+	static QEvent::Type finishedEvent()
+	{
+		static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+		return type;
+	}
+	
+	QPointer<Template> temp;
+	std::unique_ptr<TemplatePreloader> preloader;
+};
+
+
+
 // ### Template ###
 
 Template::Template(const QString& path, Map* map)
  : map(map)
  , template_group(0)
+ , load_job(nullptr)
 {
 	template_path = path;
 	if (! QFileInfo(path).canonicalFilePath().isEmpty())
@@ -118,6 +188,8 @@ Template::Template(const QString& path, Map* map)
 	
 	adjusted = false;
 	adjustment_dirty = true;
+	warped = false;
+	warp_grid_dirty = true;
 	
 	updateTransformationMatrices();
 }
@@ -146,6 +218,7 @@ Template* Template::duplicate() const
 	copy->other_transform = other_transform;
 	copy->adjusted = adjusted;
 	copy->adjustment_dirty = adjustment_dirty;
+	copy->warped = warped;
 	
 	copy->map_to_template = map_to_template;
 	copy->template_to_map = template_to_map;
@@ -242,6 +315,8 @@ void Template::saveTemplateConfiguration(QXmlStreamWriter& xml, bool open)
 			xml.writeAttribute("adjusted", "true");
 		if (adjustment_dirty)
 			xml.writeAttribute("adjustment_dirty", "true");
+		if (warped)
+			xml.writeAttribute("warped", "true");
 		int num_passpoints = (int)passpoints.size();
 		xml.writeAttribute("passpoints", QString::number(num_passpoints));
 		
@@ -295,6 +370,7 @@ std::unique_ptr<Template> Template::loadTemplateConfiguration(QXmlStreamReader&
 		{
 			temp->adjusted = (xml.attributes().value("adjusted") == "true");
 			temp->adjustment_dirty = (xml.attributes().value("adjustment_dirty") == "true");
+			temp->warped = (xml.attributes().value("warped") == "true");
 			int num_passpoints = xml.attributes().value("passpoints").toString().toInt();
 Q_ASSERT(temp->passpoints.size() == 0);
 			temp->passpoints.reserve(qMin(num_passpoints, 10)); // 10 is not a limit
@@ -377,6 +453,10 @@ void Template::switchTemplateFile(const QString& new_path, bool load_file)
 		setTemplateAreaDirty();
 		unloadTemplateFile();
 	}
+	else if (template_state == Loading)
+	{
+		unloadTemplateFile();
+	}
 	
 	template_path          = new_path;
 	template_file          = QFileInfo(new_path).fileName();
@@ -486,6 +566,44 @@ bool Template::tryToFindAndReloadTemplateFile(QString map_directory, bool* out_l
 	return false;
 }
 
+bool Template::tryToFindTemplateFile(QString map_directory, bool* out_found_in_map_dir)
+{
+	if (!map_directory.isEmpty() && !map_directory.endsWith('/'))
+		map_directory.append('/');
+	if (out_found_in_map_dir)
+		*out_found_in_map_dir = false;
+	
+	const QString old_absolute_path = getTemplatePath();
+	
+	// First try relative path (if this information is available)
+	if (!getTemplateRelativePath().isEmpty() && !map_directory.isEmpty())
+	{
+		setTemplatePath(map_directory + getTemplateRelativePath());
+		if (QFileInfo(getTemplatePath()).exists())
+			return true;
+	}
+	
+	// Then try absolute path
+	setTemplatePath(old_absolute_path);
+	if (QFileInfo(getTemplatePath()).exists())
+		return true;
+	
+	// Then try the template filename in the map's directory
+	if (!map_directory.isEmpty())
+	{
+		setTemplatePath(map_directory + getTemplateFilename());
+		if (QFileInfo(getTemplatePath()).exists())
+		{
+			if (out_found_in_map_dir)
+				*out_found_in_map_dir = true;
+			return true;
+		}
+	}
+	
+	setTemplatePath(old_absolute_path);
+	return false;
+}
+
 bool Template::preLoadConfiguration(QWidget* dialog_parent)
 {
 	Q_UNUSED(dialog_parent);
@@ -495,7 +613,9 @@ bool Template::preLoadConfiguration(QWidget* dialog_parent)
 bool Template::loadTemplateFile(bool configuring)
 {
 	Q_ASSERT(template_state != Loaded);
+	MAPPER_TRACE_SCOPE("template", "Template::loadTemplateFile");
 	
+	load_job = nullptr;
 	const State old_state = template_state;
 	bool result = QFileInfo(template_path).exists();
 	if (!result)
@@ -531,6 +651,51 @@ bool Template::loadTemplateFile(bool configuring)
 	return result;
 }
 
+void Template::loadTemplateFileAsync()
+{
+	Q_ASSERT(template_state != Loaded);
+	Q_ASSERT(template_state != Loading);
+	
+	std::unique_ptr<TemplatePreloader> new_preloader;
+	if (QFileInfo(template_path).exists())
+		new_preloader = createPreloader();
+	if (!new_preloader)
+	{
+		if (loadTemplateFile(false))
+			setTemplateAreaDirty();
+		return;
+	}
+	
+	auto job = new LoadJob(this, std::move(new_preloader));
+	load_job = job;
+	template_state = Loading;
+	emit templateStateChanged();
+	TaskPool::start(job, TaskPool::Background);
+}
+
+void Template::finishLoading(const LoadJob* job, std::unique_ptr<TemplatePreloader> finished_preloader)
+{
+	// Ignore jobs which were cancelled, or superseded by a new one.
+	if (job != load_job || template_state != Loading)
+		return;
+	
+	preloader = std::move(finished_preloader);
+	loadTemplateFile(false);
+	preloader.reset();
+	if (template_state == Loaded)
+		setTemplateAreaDirty();
+}
+
+std::unique_ptr<TemplatePreloader> Template::createPreloader() const
+{
+	return {};
+}
+
+std::unique_ptr<TemplatePreloader> Template::takePreloader()
+{
+	return std::move(preloader);
+}
+
 bool Template::postLoadConfiguration(QWidget* dialog_parent, bool& out_center_in_view)
 {
 	Q_UNUSED(dialog_parent);
@@ -540,7 +705,16 @@ bool Template::postLoadConfiguration(QWidget* dialog_parent, bool& out_center_in
 
 void Template::unloadTemplateFile()
 {
-	Q_ASSERT(template_state == Loaded);
+	Q_ASSERT(template_state == Loaded || template_state == Loading);
+	if (template_state == Loading)
+	{
+		// Cancel loading, the result will be discarded.
+		load_job = nullptr;
+		template_state = Unloaded;
+		emit templateStateChanged();
+		return;
+	}
+	
 	if (hasUnsavedChanges())
 	{
 		// The changes are lost
@@ -593,6 +767,8 @@ QRectF Template::calculateTemplateBoundingBox() const
 {
 	// Create bounding box by calculating the positions of all corners of the transformed extent rect
 	QRectF extent = getTemplateExtent();
+	if (const WarpGrid* grid = getWarpGrid())
+		extent = extent.united(grid->boundingRect());
 	QRectF bbox;
 	rectIncludeSafe(bbox, templateToMap(extent.topLeft()));
 	rectInclude(bbox, templateToMap(extent.topRight()));
@@ -632,14 +808,17 @@ void Template::addPassPoint(const PassPoint& point, int pos)
 {
 	Q_ASSERT(!is_georeferenced);
 	passpoints.insert(passpoints.begin() + pos, point);
+	warp_grid_dirty = true;
 }
 void Template::deletePassPoint(int pos)
 {
 	passpoints.erase(passpoints.begin() + pos);
+	warp_grid_dirty = true;
 }
 void Template::clearPassPoints()
 {
 	passpoints.clear();
+	warp_grid_dirty = true;
 	setAdjustmentDirty(true);
 	adjusted = false;
 }
@@ -708,6 +887,47 @@ void Template::setAdjustmentDirty(bool value)
 		map->setTemplatesDirty();
 }
 
+void Template::setAdjustmentWarped(bool value)
+{
+	if (warped == value)
+		return;
+	
+	setTemplateAreaDirty();
+	warped = value;
+	warp_grid_dirty = true;
+	setTemplateAreaDirty();
+	map->setTemplatesDirty();
+}
+
+const WarpGrid* Template::getWarpGrid() const
+{
+	if (is_georeferenced || !warped || !adjusted || !canBeWarped())
+		return nullptr;
+	
+	const QRectF extent = getTemplateExtent();
+	if (warp_grid_dirty || warp_grid.extent() != extent)
+	{
+		// The pass points' source in template coordinates, and their
+		// destination in the template coordinates of the adjusted transformation
+		Matrix map_to_template_other;
+		template_to_map_other.invert(map_to_template_other);
+		std::vector<QPointF> src_points;
+		std::vector<QPointF> dest_points;
+		src_points.reserve(passpoints.size());
+		dest_points.reserve(passpoints.size());
+		for (const auto& point : passpoints)
+		{
+			const MapCoordF& src = point.src_coords;
+			src_points.push_back(QPointF(map_to_template_other.get(0, 0) * src.x() + map_to_template_other.get(0, 1) * src.y() + map_to_template_other.get(0, 2),
+			                             map_to_template_other.get(1, 0) * src.x() + map_to_template_other.get(1, 1) * src.y() + map_to_template_other.get(1, 2)));
+			dest_points.push_back(mapToTemplate(point.dest_coords));
+		}
+		warp_grid.fitThinPlateSpline(extent, src_points, dest_points);
+		warp_grid_dirty = false;
+	}
+	return warp_grid.isEmpty() ? nullptr : &warp_grid;
+}
+
 const std::vector<QByteArray>& Template::supportedExtensions()
 {
 	static std::vector<QByteArray> extensions;
@@ -716,12 +936,18 @@ const std::vector<QByteArray>& Template::supportedExtensions()
 		auto& image_extensions = TemplateImage::supportedExtensions();
 		auto& map_extensions   = TemplateMap::supportedExtensions();
 		auto& track_extensions = TemplateTrack::supportedExtensions();
+		auto& mosaic_extensions = TemplateMosaic::supportedExtensions();
+		auto& tile_server_extensions = TemplateTileServer::supportedExtensions();
 		extensions.reserve(image_extensions.size()
 		                   + map_extensions.size()
-		                   + track_extensions.size());
+		                   + track_extensions.size()
+		                   + mosaic_extensions.size()
+		                   + tile_server_extensions.size());
 		extensions.insert(end(extensions), begin(image_extensions), end(image_extensions));
 		extensions.insert(end(extensions), begin(map_extensions), end(map_extensions));
 		extensions.insert(end(extensions), begin(track_extensions), end(track_extensions));
+		extensions.insert(end(extensions), begin(mosaic_extensions), end(mosaic_extensions));
+		extensions.insert(end(extensions), begin(tile_server_extensions), end(tile_server_extensions));
 	}
 	return extensions;
 }
@@ -742,6 +968,10 @@ std::unique_ptr<Template> Template::templateForFile(const QString& path, Map* ma
 		t.reset(new TemplateMap(path, map));
 	else if (path_ends_with_any_of(TemplateTrack::supportedExtensions()))
 		t.reset(new TemplateTrack(path, map));
+	else if (path_ends_with_any_of(TemplateMosaic::supportedExtensions()))
+		t.reset(new TemplateMosaic(path, map));
+	else if (path_ends_with_any_of(TemplateTileServer::supportedExtensions()))
+		t.reset(new TemplateTileServer(path, map));
 	
 	return t;
 }
@@ -806,4 +1036,5 @@ void Template::updateTransformationMatrices()
 	template_to_map.set(2, 2, 1);
 	
 	template_to_map.invert(map_to_template);
+	warp_grid_dirty = true;
 }
@@ -26,6 +26,7 @@
 
 #include "matrix.h"
 #include "transformation.h"
+#include "core/warp_grid.h"
 
 QT_BEGIN_NAMESPACE
 class QIODevice;
@@ -41,6 +42,22 @@ class Map;
 class MapView;
 class MapWidget;
 
+/**
+ * Reads a template file in a worker thread.
+ * 
+ * A preloader must not access the template or the map, because it runs
+ * concurrently with the GUI thread. When it has finished, its result is
+ * handed to the template's loadTemplateFileImpl() in the GUI thread.
+ */
+class TemplatePreloader
+{
+public:
+	virtual ~TemplatePreloader();
+	
+	/// Reads the file. Called from a worker thread.
+	virtual void run() = 0;
+};
+
 /** Transformation parameters for non-georeferenced templates */
 class TemplateTransform
 {
@@ -76,7 +93,9 @@ public:
 		Unloaded,
 		/// A required resource cannot be found (e.g. missing image or font),
 		/// so the template is invalid
-		Invalid
+		Invalid,
+		/// The template file is being read in the background, see loadTemplateFileAsync()
+		Loading
 	};
 	
 	
@@ -143,6 +162,11 @@ public:
 	/// loaded using the template filename in the map's directory (3rd option).
 	bool tryToFindAndReloadTemplateFile(QString map_directory, bool* out_loaded_from_map_dir = NULL);
 	
+	/// Like tryToFindAndReloadTemplateFile(), but only sets the template path
+	/// to the first position where the file exists, without loading it.
+	/// Returns true if the file was found.
+	bool tryToFindTemplateFile(QString map_directory, bool* out_found_in_map_dir = NULL);
+	
 	/// Does the pre-load configuration when the template is opened initially
 	/// (after the user chooses the template file, but before it is loaded).
 	/// Derived classes can show dialogs here to get user input which is needed
@@ -159,6 +183,13 @@ public:
 	/// In this case, the next step is to call postLoadConfiguration().
 	bool loadTemplateFile(bool configuring);
 	
+	/// Starts loading the template file in the background, for templates which are
+	/// not being configured. The state becomes Loading until the file is loaded,
+	/// then Loaded or Invalid, and templateStateChanged() is emitted for each change.
+	/// Templates which do not provide a preloader are loaded immediately.
+	/// Can be called if the template state is Invalid or Unloaded.
+	void loadTemplateFileAsync();
+	
 	/// Does the post-load configuration when the template is opened initially
 	/// (after the chosen template file is loaded).
 	/// If the implementation returns false, loading the template is aborted.
@@ -167,6 +198,7 @@ public:
 	virtual bool postLoadConfiguration(QWidget* dialog_parent, bool& out_center_in_view);
 	
 	/// Unloads the template file. Can be called if the template state is Loaded.
+	/// If the state is Loading, loading is cancelled.
 	/// Must not be called if the template file is already unloaded, or invalid.
 	void unloadTemplateFile();
 	
@@ -187,6 +219,10 @@ public:
 	/// cannot be calculated.
 	virtual int getTemplateBoundingBoxPixelBorder() {return 0;}
 	
+	/// Returns the approximate amount of memory used by the loaded template data,
+	/// such as decoded images, in bytes. The default implementation returns 0.
+	virtual qint64 memoryUsage() const {return 0;}
+	
 	/// Marks the whole area of the template as "to be redrawn".
 	/// Use this before and after modifications to the template transformation.
 	/// The default implementation marks everything as "to be redrawn" for georeferenced
@@ -197,6 +233,10 @@ public:
 	/// Must return if freehand drawing onto the template is possible
 	virtual bool canBeDrawnOnto() const {return false;}
 	
+	/// Must return if the template can be drawn warped by the adjustment,
+	/// see isAdjustmentWarped()
+	virtual bool canBeWarped() const {return false;}
+	
 	/// Draws onto the template. coords is an array of points with which the
 	/// drawn line is defined and must contain at least 2 points.
 	/// map_bbox can be an invalid rect, then the method will calculate it itself.
@@ -327,6 +367,16 @@ public:
 	inline bool isAdjustmentDirty() const {return adjustment_dirty;}
 	void setAdjustmentDirty(bool value);
 	
+	/// If true, the applied adjustment warps the template through the pass points
+	/// (rubber-sheeting) in addition to the estimated transformation.
+	inline bool isAdjustmentWarped() const {return warped;}
+	void setAdjustmentWarped(bool value);
+	
+	/// Returns the grid which warps the template, in template coordinates,
+	/// or nullptr if the template is not warped. The grid is fitted to the
+	/// pass points when it is needed after changes.
+	const WarpGrid* getWarpGrid() const;
+	
 	// Static
 	/**
 	 * Returns the filename extensions supported by known subclasses.
@@ -377,6 +427,16 @@ protected:
 	/// Derived classes must unload the template file here
 	virtual void unloadTemplateFileImpl() = 0;
 	
+	/// Derived classes may return a preloader which reads the template file
+	/// in a worker thread for loadTemplateFileAsync(). The default implementation
+	/// returns nullptr, i.e. the template is loaded in the GUI thread.
+	virtual std::unique_ptr<TemplatePreloader> createPreloader() const;
+	
+	/// Returns the preloader which has finished reading the template file,
+	/// transferring ownership to the caller. Returns nullptr if the template
+	/// file is not loaded by loadTemplateFileAsync().
+	std::unique_ptr<TemplatePreloader> takePreloader();
+	
 	
 	/// Must be implemented to draw the polyline given by the points onto the template if canBeDrawnOnto() returns true
 	virtual void drawOntoTemplateImpl(MapCoordF* coords, int num_coords, QColor color, float width);
@@ -431,6 +491,15 @@ protected:
 	/// List of pass points for position adjustment
 	PassPointList passpoints;
 	
+	/// If true, the applied adjustment also warps the template through the pass points
+	bool warped;
+	
+	/// The warp grid for the current pass points and transformations, see getWarpGrid()
+	mutable WarpGrid warp_grid;
+	
+	/// If true, warp_grid has to be fitted again
+	mutable bool warp_grid_dirty;
+	
 	/// Number of the template group. If the template is not grouped, this is set to -1.
 	int template_group;
 	
@@ -438,6 +507,18 @@ protected:
 	Matrix map_to_template;
 	Matrix template_to_map;
 	Matrix template_to_map_other;
+	
+private:
+	class LoadJob;
+	
+	/// Continues loading with the finished preloader of the given job.
+	void finishLoading(const LoadJob* job, std::unique_ptr<TemplatePreloader> preloader);
+	
+	/// The job which is loading the template file in the background
+	const LoadJob* load_job;
+	
+	/// The finished preloader, see takePreloader()
+	std::unique_ptr<TemplatePreloader> preloader;
 };
 
 
@@ -220,6 +220,9 @@ TemplateAdjustWidget::TemplateAdjustWidget(Template* temp, MapEditorController*
 	
 	apply_check = new QCheckBox(tr("Apply pass points"));
 	apply_check->setChecked(temp->isAdjustmentApplied());
+	warp_check = new QCheckBox(tr("Warp through the pass points (rubber-sheeting)"));
+	warp_check->setChecked(temp->isAdjustmentWarped());
+	warp_check->setEnabled(temp->canBeWarped());
 	QPushButton* help_button = new QPushButton(QIcon(":/images/help.png"), tr("Help"));
 	clear_and_apply_button = new QPushButton(tr("Apply && clear all"));
 	clear_and_revert_button = new QPushButton(tr("Clear all"));
@@ -236,6 +239,7 @@ TemplateAdjustWidget::TemplateAdjustWidget(Template* temp, MapEditorController*
 	layout->addWidget(toolbar);
 	layout->addWidget(table, 1);
 	layout->addWidget(apply_check);
+	layout->addWidget(warp_check);
 	layout->addSpacing(16);
 	layout->addLayout(buttons_layout);
 	setLayout(layout);
@@ -247,6 +251,7 @@ TemplateAdjustWidget::TemplateAdjustWidget(Template* temp, MapEditorController*
 	connect(delete_act, SIGNAL(triggered(bool)), this, SLOT(deleteClicked(bool)));
 	
 	connect(apply_check, SIGNAL(clicked(bool)), this, SLOT(applyClicked(bool)));
+	connect(warp_check, SIGNAL(clicked(bool)), this, SLOT(warpClicked(bool)));
 	connect(help_button, SIGNAL(clicked(bool)), this, SLOT(showHelp()));
 	connect(clear_and_apply_button, SIGNAL(clicked(bool)), this, SLOT(clearAndApplyClicked(bool)));
 	connect(clear_and_revert_button, SIGNAL(clicked(bool)), this, SLOT(clearAndRevertClicked(bool)));
@@ -394,6 +399,14 @@ void TemplateAdjustWidget::applyClicked(bool checked)
 	updateDirtyRect();
 }
 
+void TemplateAdjustWidget::warpClicked(bool checked)
+{
+	temp->setAdjustmentWarped(checked);
+	react_to_changes = false;
+	controller->getMap()->emitTemplateChanged(temp);
+	react_to_changes = true;
+}
+
 void TemplateAdjustWidget::clearAndApplyClicked(bool checked)
 {
 	Q_UNUSED(checked);
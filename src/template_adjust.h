@@ -112,6 +112,7 @@ protected slots:
 	void deleteClicked(bool checked);
 	
 	void applyClicked(bool checked);
+	void warpClicked(bool checked);
 	void clearAndApplyClicked(bool checked);
 	void clearAndRevertClicked(bool checked);
 	
@@ -124,6 +125,7 @@ private:
 	
 	QTableWidget* table;
 	QCheckBox* apply_check;
+	QCheckBox* warp_check;
 	QPushButton* clear_and_apply_button;
 	QPushButton* clear_and_revert_button;
 	
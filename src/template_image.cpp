@@ -21,7 +21,10 @@
 
 #include "template_image.h"
 
+#include <algorithm>
+
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QHBoxLayout>
 #include <QImageReader>
@@ -33,13 +36,159 @@
 #include <QRadioButton>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
+#include <qmath.h>
 
+#include "core/decoded_image_cache.h"
 #include "core/georeferencing.h"
+#include "core/tiled_image.h"
 #include "gui/georeferencing_dialog.h"
 #include "gui/select_crs_dialog.h"
 #include "map.h"
+#include "settings.h"
 #include "util.h"
 
+
+namespace
+{
+	/**
+	 * Adds the indices of the tiles of the given size which intersect the
+	 * given rect to the list.
+	 */
+	void addTileIndices(std::vector<QPoint>& indices, const QRect& rect, int tile_size)
+	{
+		if (rect.isEmpty())
+			return;
+		
+		for (int y = rect.top() / tile_size; y <= rect.bottom() / tile_size; ++y)
+		{
+			for (int x = rect.left() / tile_size; x <= rect.right() / tile_size; ++x)
+				indices.push_back(QPoint(x, y));
+		}
+	}
+	
+	/**
+	 * Exchanges the pixels of the part with the pixels of the image
+	 * at the given position.
+	 * 
+	 * The part must fit into the image. It is converted to the image's format
+	 * if necessary, so that the image may have been converted meanwhile.
+	 */
+	void swapPixels(QImage& image, QImage& part, int x, int y)
+	{
+		Q_ASSERT(image.rect().contains(QRect(x, y, part.width(), part.height())));
+		
+		if (part.format() != image.format())
+			part = part.convertToFormat(image.format());
+		
+		if (image.depth() < 8)
+		{
+			// Pixels are not aligned to bytes.
+			QImage current = image.copy(x, y, part.width(), part.height());
+			QPainter painter(&image);
+			painter.setCompositionMode(QPainter::CompositionMode_Source);
+			painter.drawImage(x, y, part);
+			painter.end();
+			part = current;
+			return;
+		}
+		
+		const int offset = x * (image.depth() / 8);
+		const int length = part.width() * (image.depth() / 8);
+		for (int row = 0; row < part.height(); ++row)
+		{
+			uchar* line = image.scanLine(y + row) + offset;
+			std::swap_ranges(line, line + length, part.scanLine(row));
+		}
+	}
+}
+
+
+
+// ### TemplateImage::Preloader ###
+
+/**
+ * Decodes the image file, or prepares loading it by tiles
+ * if it is too large for the memory limit.
+ *
+ * Images which are slow to decode are stored in the disk cache,
+ * and restored from there when the template is loaded again.
+ */
+class TemplateImage::Preloader : public TemplatePreloader
+{
+public:
+	/** Images which take less time to decode are not stored in the disk cache. */
+	static const qint64 min_cached_decoding_ms = 200;
+	
+	Preloader(const QString& path, qint64 memory_limit, const DecodedImageCache& disk_cache)
+	 : path(path)
+	 , memory_limit(memory_limit)
+	 , disk_cache(disk_cache)
+	{
+		; // nothing
+	}
+	
+	void run() override
+	{
+		QImageReader reader(path);
+		const QSize size = reader.size();
+		const QImage::Format format = reader.imageFormat();
+		if (!size.isEmpty() && qint64(size.width()) * size.height() * 4 > memory_limit && TiledImage::canLoad(reader))
+		{
+			// Too large for memory: decode tiles on demand
+			tiled_image.reset(new TiledImage(path));
+			tiled_image->setMemoryLimit(memory_limit);
+			tiled_image->setDiskCache(disk_cache);
+			if (!tiled_image->load())
+			{
+				error_string = tiled_image->errorString();
+				tiled_image.reset();
+			}
+			return;
+		}
+		
+		const QString cache_name = QString::fromLatin1("image");
+		image = disk_cache.restore(cache_name);
+		if (!image.isNull() && (size.isEmpty() || image.size() == size))
+			return;
+		
+		QElapsedTimer decoding_timer;
+		decoding_timer.start();
+		if (size.isEmpty() || format == QImage::Format_Invalid)
+		{
+			// Leave memory allocation to QImageReader
+			image = reader.read();
+		}
+		else
+		{
+			// Pre-allocate the memory in order to catch errors
+			image = QImage(size, format);
+			if (image.isNull())
+			{
+				error_string = TemplateImage::tr("Not enough free memory (image size: %1x%2 pixels)").arg(size.width()).arg(size.height());
+				return;
+			}
+			// Read into pre-allocated image
+			reader.read(&image);
+		}
+		
+		if (image.isNull())
+			error_string = reader.errorString();
+		else if (decoding_timer.elapsed() >= min_cached_decoding_ms)
+			disk_cache.save(cache_name, image);
+	}
+	
+	const QString path;
+	const qint64 memory_limit;
+	const DecodedImageCache disk_cache;
+	QImage image;
+	std::unique_ptr<TiledImage> tiled_image;
+	QString error_string;
+};
+
+
+
+// ### TemplateImage ###
+
 const std::vector<QByteArray>& TemplateImage::supportedExtensions()
 {
 	static std::vector<QByteArray> extensions;
@@ -70,6 +219,9 @@ TemplateImage::~TemplateImage()
 
 bool TemplateImage::saveTemplateFile() const
 {
+	if (tiled_image)
+		return true; // Cannot be modified
+	
 	return image.save(template_path);
 }
 
@@ -110,32 +262,43 @@ bool TemplateImage::loadTypeSpecificTemplateConfiguration(QXmlStreamReader& xml)
 	return true;
 }
 
+std::unique_ptr<TemplatePreloader> TemplateImage::createPreloader() const
+{
+	const qint64 memory_limit = qint64(Settings::getInstance().getSettingCached(Settings::Templates_ImageMemoryLimitMB).toInt()) << 20;
+	return std::unique_ptr<TemplatePreloader>(new Preloader(template_path, memory_limit, diskCache()));
+}
+
+DecodedImageCache TemplateImage::diskCache() const
+{
+	const qint64 size_limit = qint64(Settings::getInstance().getSettingCached(Settings::Templates_ImageCacheMB).toInt()) << 20;
+	return DecodedImageCache(template_path, size_limit);
+}
+
 bool TemplateImage::loadTemplateFileImpl(bool configuring)
 {
-	QImageReader reader(template_path);
-	const QSize size = reader.size();
-	const QImage::Format format = reader.imageFormat();
-	if (size.isEmpty() || format == QImage::Format_Invalid)
+	pyramid.clear();
+	tiled_image.reset();
+	
+	// The image is decoded in a worker thread for loadTemplateFileAsync().
+	std::unique_ptr<Preloader> preloader(static_cast<Preloader*>(takePreloader().release()));
+	if (!preloader)
+	{
+		preloader.reset(static_cast<Preloader*>(createPreloader().release()));
+		preloader->run();
+	}
+	
+	if (preloader->tiled_image)
 	{
-		// Leave memory allocation to QImageReader
-		image = reader.read();
+		tiled_image.reset(preloader->tiled_image.release());
 	}
 	else
 	{
-		// Pre-allocate the memory in order to catch errors
-		image = QImage(size, format);
-		if (image.isNull())
-		{
-			setErrorString(tr("Not enough free memory (image size: %1x%2 pixels)").arg(size.width()).arg(size.height()));
-			return false;
-		}
-		// Read into pre-allocated image
-		reader.read(&image);
+		image = preloader->image;
+		preloader->image = QImage();
 	}
-	
-	if (image.isNull())
+	if (!tiled_image && image.isNull())
 	{
-		setErrorString(reader.errorString());
+		setErrorString(preloader->error_string);
 		return false;
 	}
 	
@@ -180,7 +343,7 @@ bool TemplateImage::postLoadConfiguration(QWidget* dialog_parent, bool& out_cent
 			// Make sure that the map is georeferenced;
 			// use the center coordinates of the image as initial reference point.
 			calculateGeoreferencing();
-			QPointF template_coords_center = georef->toProjectedCoords(MapCoordF(0.5 * (image.width() - 1), 0.5 * (image.height() - 1)));
+			QPointF template_coords_center = georef->toProjectedCoords(MapCoordF(0.5 * (getImageSize().width() - 1), 0.5 * (getImageSize().height() - 1)));
 			bool template_coords_probably_geographic =
 				template_coords_center.x() >= -90 && template_coords_center.x() <= 90 &&
 				template_coords_center.y() >= -90 && template_coords_center.y() <= 90;
@@ -236,42 +399,85 @@ bool TemplateImage::postLoadConfiguration(QWidget* dialog_parent, bool& out_cent
 
 void TemplateImage::unloadTemplateFileImpl()
 {
+	pyramid.clear();
+	tiled_image.reset();
 	image = QImage();
 }
 
 void TemplateImage::drawTemplate(QPainter* painter, QRectF& clip_rect, double scale, bool on_screen, float opacity) const
 {
-	Q_UNUSED(clip_rect);
 	Q_UNUSED(scale);
-	Q_UNUSED(on_screen);
 	
 	applyTemplateTransform(painter);
 	
-	painter->setRenderHint(QPainter::SmoothPixmapTransform);
+	QRectF template_clip_rect;
+	rectIncludeSafe(template_clip_rect, mapToTemplate(MapCoordF(clip_rect.topLeft())));
+	rectIncludeSafe(template_clip_rect, mapToTemplate(MapCoordF(clip_rect.topRight())));
+	rectIncludeSafe(template_clip_rect, mapToTemplate(MapCoordF(clip_rect.bottomLeft())));
+	rectIncludeSafe(template_clip_rect, mapToTemplate(MapCoordF(clip_rect.bottomRight())));
+	
+	// On screen, the map widget may ask for fast drawing without smoothing.
+	if (!on_screen)
+		painter->setRenderHint(QPainter::SmoothPixmapTransform);
 	painter->setOpacity(opacity);
-	painter->drawImage(QPointF(-image.width() * 0.5, -image.height() * 0.5), image);
+	const QSize size = getImageSize();
+	const QPointF origin(-size.width() * 0.5, -size.height() * 0.5);
+	if (tiled_image)
+	{
+		tiled_image->draw(painter, origin, template_clip_rect);
+	}
+	else if (const WarpGrid* warp_grid = getWarpGrid())
+	{
+		// Draw the pyramid level which matches the resolution, cell by cell
+		const qreal resolution = qSqrt(qAbs(painter->worldTransform().determinant()));
+		const QImage& level_image = pyramid.level(image, ImagePyramid::levelForResolution(image, resolution));
+		warp_grid->draw(painter, level_image, getTemplateExtent(), template_clip_rect);
+	}
+	else
+	{
+		pyramid.draw(painter, image, origin, template_clip_rect);
+	}
 	painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
 }
 QRectF TemplateImage::getTemplateExtent() const
 {
-    // If the image is invalid, the extent is an empty rectangle.
-    if (image.isNull())
+	// If the image is invalid, the extent is an empty rectangle.
+	const QSize size = getImageSize();
+	if (size.isEmpty())
 		return QRectF();
-	return QRectF(-image.width() * 0.5, -image.height() * 0.5, image.width(), image.height());
+	return QRectF(-size.width() * 0.5, -size.height() * 0.5, size.width(), size.height());
+}
+
+QSize TemplateImage::getImageSize() const
+{
+	return tiled_image ? tiled_image->size() : image.size();
+}
+
+qint64 TemplateImage::memoryUsage() const
+{
+	qint64 result = image.byteCount() + pyramid.memoryUsage();
+	if (tiled_image)
+		result += tiled_image->overview().byteCount() + tiled_image->memoryUsage();
+	for (const auto& step : undo_steps)
+		result += step.memoryUsage();
+	return result;
 }
 
 QPointF TemplateImage::calcCenterOfGravity(QRgb background_color)
 {
+	// For tiled images, the overview must be sufficient.
+	const QImage& source = tiled_image ? tiled_image->overview() : image;
+	
 	int num_points = 0;
 	QPointF center = QPointF(0, 0);
-	int width = image.width();
-	int height = image.height();
+	int width = source.width();
+	int height = source.height();
 	
 	for (int x = 0; x < width; ++x)
 	{
 		for (int y = 0; y < height; ++y)
 		{
-			QRgb pixel = image.pixel(x, y);
+			QRgb pixel = source.pixel(x, y);
 			if (qAlpha(pixel) < 127 || pixel == background_color)
 				continue;
 			
@@ -282,7 +488,12 @@ QPointF TemplateImage::calcCenterOfGravity(QRgb background_color)
 	
 	if (num_points > 0)
 		center = QPointF(center.x() / num_points, center.y() / num_points);
-	center -= QPointF(image.width() * 0.5 - 0.5, image.height() * 0.5 - 0.5);
+	
+	const QSize size = getImageSize();
+	const qreal scale_x = width  > 0 ? qreal(size.width())  / width  : 1.0;
+	const qreal scale_y = height > 0 ? qreal(size.height()) / height : 1.0;
+	center = QPointF((center.x() + 0.5) * scale_x, (center.y() + 0.5) * scale_y);
+	center -= QPointF(size.width() * 0.5, size.height() * 0.5);
 	
 	return center;
 }
@@ -297,6 +508,14 @@ Template* TemplateImage::duplicateImpl() const
 {
 	TemplateImage* new_template = new TemplateImage(template_path, map);
 	new_template->image = image;
+	if (tiled_image)
+	{
+		new_template->tiled_image.reset(new TiledImage(template_path));
+		new_template->tiled_image->setMemoryLimit(qint64(Settings::getInstance().getSettingCached(Settings::Templates_ImageMemoryLimitMB).toInt()) << 20);
+		new_template->tiled_image->setDiskCache(diskCache());
+		if (!new_template->tiled_image->load())
+			new_template->tiled_image.reset();
+	}
 	new_template->available_georef = available_georef;
 	return new_template;
 }
@@ -306,6 +525,15 @@ void TemplateImage::drawOntoTemplateImpl(MapCoordF* coords, int num_coords, QCol
 	QPointF* points;
 	QRect radius_bbox;
 	int draw_iterations = 1;
+	
+	// The rect of pixels which may be affected by painting along the given rect
+	auto strokeRect = [width](const QRectF& rect) {
+		return QRect(
+			qFloor(rect.left() - width - 1), qFloor(rect.top() - width - 1),
+			qCeil(rect.width() + 2*width + 2.5f), qCeil(rect.height() + 2*width + 2.5f)
+		);
+	};
+	std::vector<QPoint> tile_indices;
 
 	bool all_coords_equal = true;
 	for (int i = 1; i < num_coords; ++i)
@@ -339,6 +567,8 @@ void TemplateImage::drawOntoTemplateImpl(MapCoordF* coords, int num_coords, QCol
 			qFloor(points[3].x() - width - 1), qFloor(points[4].y() - width - 1),
 			qCeil(2 * ring_radius + 2*width + 2.5f), qCeil(2 * ring_radius + 2*width + 2.5f)
 		);
+		radius_bbox = radius_bbox.intersected(image.rect());
+		addTileIndices(tile_indices, radius_bbox, undo_tile_size);
 	}
 	else
 	{
@@ -348,20 +578,30 @@ void TemplateImage::drawOntoTemplateImpl(MapCoordF* coords, int num_coords, QCol
 		{
 			points[i] = mapToTemplate(coords[i]) + QPointF(image.width() * 0.5f, image.height() * 0.5f);
 			rectIncludeSafe(bbox, points[i]);
+			if (i > 0)
+			{
+				// Long diagonal strokes touch far fewer tiles than their bounding box covers.
+				const QRect segment_rect = strokeRect(QRectF(points[i-1], points[i]).normalized());
+				addTileIndices(tile_indices, segment_rect.intersected(image.rect()), undo_tile_size);
+			}
 		}
-		radius_bbox = QRect(
-			qFloor(bbox.left() - width - 1), qFloor(bbox.top() - width - 1),
-			qCeil(bbox.width() + 2*width + 2.5f), qCeil(bbox.height() + 2*width + 2.5f)
-		);
-		radius_bbox = radius_bbox.intersected(QRect(0, 0, image.width(), image.height()));
+		radius_bbox = strokeRect(bbox).intersected(image.rect());
 	}
 	
-	// Create undo step
+	// Create undo step, saving the touched tiles only
+	std::sort(begin(tile_indices), end(tile_indices), [](const QPoint& a, const QPoint& b) {
+		return a.y() < b.y() || (a.y() == b.y() && a.x() < b.x());
+	});
+	tile_indices.erase(std::unique(begin(tile_indices), end(tile_indices)), end(tile_indices));
 	DrawOnImageUndoStep undo_step;
-	undo_step.x = radius_bbox.left();
-	undo_step.y = radius_bbox.top();
-	undo_step.image = image.copy(radius_bbox);
-	addUndoStep(undo_step);
+	undo_step.tiles.reserve(tile_indices.size());
+	for (const QPoint& index : tile_indices)
+	{
+		const QRect tile_rect = QRect(index * undo_tile_size, QSize(undo_tile_size, undo_tile_size)).intersected(image.rect());
+		undo_step.tiles.push_back(UndoTile{ image.copy(tile_rect), tile_rect.left(), tile_rect.top() });
+		undo_step.bbox |= tile_rect;
+	}
+	addUndoStep(std::move(undo_step));
 	
 	// This conversion is to prevent a very strange bug where the behavior of the
 	// default QPainter composition mode seems to be incorrect for images which are
@@ -387,6 +627,8 @@ void TemplateImage::drawOntoTemplateImpl(MapCoordF* coords, int num_coords, QCol
 	
 	painter.end();
 	delete[] points;
+	
+	pyramid.update(image, radius_bbox);
 }
 
 void TemplateImage::drawOntoTemplateUndo(bool redo)
@@ -405,41 +647,58 @@ void TemplateImage::drawOntoTemplateUndo(bool redo)
 			return;
 	}
 	
+	// Swapping the pixels turns the undo step into the redo step, and vice versa.
 	DrawOnImageUndoStep& step = undo_steps[step_index];
-	QImage undo_image = step.image.copy();
-	step.image = image.copy(step.x, step.y, step.image.width(), step.image.height());
-	QPainter painter(&image);
-	painter.setCompositionMode(QPainter::CompositionMode_Source);
-	painter.drawImage(step.x, step.y, undo_image);
+	for (UndoTile& tile : step.tiles)
+		swapPixels(image, tile.image, tile.x, tile.y);
+	pyramid.update(image, step.bbox);
 	
 	undo_index += redo ? 1 : -1;
 	
-	qreal template_left = step.x - 0.5 * image.width();
-	qreal template_top = step.y - 0.5 * image.height();
+	if (step.bbox.isEmpty())
+		return;
+	
+	qreal template_left = step.bbox.left() - 0.5 * image.width();
+	qreal template_top = step.bbox.top() - 0.5 * image.height();
+	qreal template_right = template_left + step.bbox.width();
+	qreal template_bottom = template_top + step.bbox.height();
 	QRectF map_bbox;
 	rectIncludeSafe(map_bbox, templateToMap(QPointF(template_left, template_top)));
-	rectIncludeSafe(map_bbox, templateToMap(QPointF(template_left + step.image.width(), template_top)));
-	rectIncludeSafe(map_bbox, templateToMap(QPointF(template_left, template_top + step.image.height())));
-	rectIncludeSafe(map_bbox, templateToMap(QPointF(template_left + step.image.width(), template_top + step.image.height())));
+	rectIncludeSafe(map_bbox, templateToMap(QPointF(template_right, template_top)));
+	rectIncludeSafe(map_bbox, templateToMap(QPointF(template_left, template_bottom)));
+	rectIncludeSafe(map_bbox, templateToMap(QPointF(template_right, template_bottom)));
 	map->setTemplateAreaDirty(this, map_bbox, 0);
 	
 	setHasUnsavedChanges(true);
 }
 
-void TemplateImage::addUndoStep(const TemplateImage::DrawOnImageUndoStep& new_step)
+void TemplateImage::addUndoStep(TemplateImage::DrawOnImageUndoStep&& new_step)
 {
-	// TODO: undo step limitation based on used memory
-	const int max_undo_steps = 5;
-	
 	while (static_cast<int>(undo_steps.size()) > undo_index)
 		undo_steps.pop_back();
-	while (static_cast<int>(undo_steps.size()) >= max_undo_steps)
-		undo_steps.erase(undo_steps.begin());
 	
-	undo_steps.push_back(new_step);
+	qint64 memory = new_step.memoryUsage();
+	for (const auto& step : undo_steps)
+		memory += step.memoryUsage();
+	while (!undo_steps.empty()
+	       && (memory > max_undo_memory || static_cast<int>(undo_steps.size()) >= max_undo_steps))
+	{
+		memory -= undo_steps.front().memoryUsage();
+		undo_steps.pop_front();
+	}
+	
+	undo_steps.push_back(std::move(new_step));
 	undo_index = static_cast<int>(undo_steps.size());
 }
 
+qint64 TemplateImage::DrawOnImageUndoStep::memoryUsage() const
+{
+	qint64 result = 0;
+	for (const auto& tile : tiles)
+		result += tile.image.byteCount();
+	return result;
+}
+
 void TemplateImage::calculateGeoreferencing()
 {
 	// Calculate georeferencing of image coordinates where the coordinate (0, 0)
@@ -473,37 +732,33 @@ void TemplateImage::updatePosFromGeoreferencing()
 {
 	// Determine map coords of three image corner points
 	// by transforming the points from one Georeferencing into the other
-	bool ok;
-	MapCoordF top_left = map->getGeoreferencing().toMapCoordF(georef.data(), MapCoordF(-0.5, -0.5), &ok);
-	if (!ok)
-	{
-		qDebug() << "updatePosFromGeoreferencing() failed";
-		return; // TODO: proper error message?
-	}
-	MapCoordF top_right = map->getGeoreferencing().toMapCoordF(georef.data(), MapCoordF(image.width() - 0.5, -0.5), &ok);
-	if (!ok)
-	{
-		qDebug() << "updatePosFromGeoreferencing() failed";
-		return; // TODO: proper error message?
-	}
-	MapCoordF bottom_left = map->getGeoreferencing().toMapCoordF(georef.data(), MapCoordF(-0.5, image.height() - 0.5), &ok);
-	if (!ok)
+	const QSize size = getImageSize();
+	const std::vector<MapCoordF> corners = {
+	    MapCoordF(-0.5, -0.5),                                 // top left
+	    MapCoordF(size.width() - 0.5, -0.5),                   // top right
+	    MapCoordF(-0.5, size.height() - 0.5),                  // bottom left
+	};
+	std::vector<MapCoordF> map_corners;
+	if (!map->getGeoreferencing().toMapCoordF(georef.data(), corners, map_corners))
 	{
 		qDebug() << "updatePosFromGeoreferencing() failed";
 		return; // TODO: proper error message?
 	}
+	const MapCoordF& top_left = map_corners[0];
+	const MapCoordF& top_right = map_corners[1];
+	const MapCoordF& bottom_left = map_corners[2];
 	
 	// Calculate template transform as similarity transform from pixels to map coordinates
 	PassPointList pp_list;
 	
 	PassPoint pp;
-	pp.src_coords = MapCoordF(-0.5 * image.width(), -0.5 * image.height());
+	pp.src_coords = MapCoordF(-0.5 * size.width(), -0.5 * size.height());
 	pp.dest_coords = top_left;
 	pp_list.push_back(pp);
-	pp.src_coords = MapCoordF(0.5 * image.width(), -0.5 * image.height());
+	pp.src_coords = MapCoordF(0.5 * size.width(), -0.5 * size.height());
 	pp.dest_coords = top_right;
 	pp_list.push_back(pp);
-	pp.src_coords = MapCoordF(-0.5 * image.width(), 0.5 * image.height());
+	pp.src_coords = MapCoordF(-0.5 * size.width(), 0.5 * size.height());
 	pp.dest_coords = bottom_left;
 	pp_list.push_back(pp);
 	
@@ -595,7 +850,7 @@ TemplateImageOpenDialog::TemplateImageOpenDialog(TemplateImage* templ, QWidget*
 	setWindowTitle(tr("Opening %1").arg(templ->getTemplateFilename()));
 	
 	QLabel* size_label = new QLabel("<b>" + tr("Image size:") + QString("</b> %1 x %2")
-		.arg(templ->getImage().width()).arg(templ->getImage().height()));
+		.arg(templ->getImageSize().width()).arg(templ->getImageSize().height()));
 	
 	QLabel* desc_label = new QLabel(tr("Specify how to position or scale the image:"));
 	
@@ -23,9 +23,14 @@
 
 #include "template.h"
 
+#include <deque>
+#include <vector>
+
 #include <QDialog>
 #include <QImage>
 
+#include "core/image_pyramid.h"
+
 QT_BEGIN_NAMESPACE
 class QCheckBox;
 class QRadioButton;
@@ -33,7 +38,9 @@ class QXmlStreamReader;
 class QXmlStreamWriter;
 QT_END_NAMESPACE
 
+class DecodedImageCache;
 class Georeferencing;
+class TiledImage;
 
 /**
  * Template showing a raster image.
@@ -71,7 +78,8 @@ public:
 	
     virtual void drawTemplate(QPainter* painter, QRectF& clip_rect, double scale, bool on_screen, float opacity) const;
 	virtual QRectF getTemplateExtent() const;
-	virtual bool canBeDrawnOnto() const {return true;}
+	virtual bool canBeDrawnOnto() const {return !tiled_image;}
+	virtual bool canBeWarped() const {return !tiled_image;}
 
 	/**
 	 * Calculates the image's center of gravity in template coordinates by
@@ -79,19 +87,28 @@ public:
 	 */
 	QPointF calcCenterOfGravity(QRgb background_color);
 	
-	/** Returns the internal QImage. */
+	/**
+	 * Returns the internal QImage.
+	 * 
+	 * The image is null when the template is loaded by tiles.
+	 */
 	inline const QImage& getImage() const {return image;}
 	
+	/** Returns the size of the image in pixels. */
+	QSize getImageSize() const;
+	
+	/**
+	 * Returns the memory used by the decoded image, its reduced resolution
+	 * levels or tiles, and the undo steps for drawing, in bytes.
+	 */
+	qint64 memoryUsage() const override;
+	
 	/**
 	 * Returns which georeferencing method (if any) is available.
 	 * (This does not mean that the image is in georeferenced mode)
 	 */
 	inline GeoreferencingType getAvailableGeoreferencing() const {return available_georef;}
 	
-public slots:
-	void updateGeoreferencing();
-	
-protected:
 	/** Holds a pixel-to-world transform loaded from a world file. */
 	struct WorldFile
 	{
@@ -109,10 +126,14 @@ protected:
 		bool tryToLoadForImage(const QString& image_path);
 	};
 	
-	/** Information about an undo step for the paint-on-template functionality. */
-	struct DrawOnImageUndoStep
+public slots:
+	void updateGeoreferencing();
+	
+protected:
+	/** A part of the image which is saved for undo. */
+	struct UndoTile
 	{
-		/** Copy of previous image part */
+		/** Copy of the previous image part */
 		QImage image;
 		
 		/** X position of image part origin */
@@ -122,16 +143,60 @@ protected:
 		int y;
 	};
 	
+	/**
+	 * Information about an undo step for the paint-on-template functionality.
+	 * 
+	 * Only the tiles of the image which are touched by a stroke are saved.
+	 * Undo and redo swap the pixels of these tiles with the image.
+	 */
+	struct DrawOnImageUndoStep
+	{
+		std::vector<UndoTile> tiles;
+		
+		/** The bounding box of the tiles, in image pixels */
+		QRect bbox;
+		
+		/** Returns the memory used by the saved tiles, in bytes. */
+		qint64 memoryUsage() const;
+	};
+	
+	/** The width and height of the tiles saved for undo, in pixels. */
+	static const int undo_tile_size = 64;
+	
+	/** The memory which may be used by the undo steps, in bytes. */
+	static const qint64 max_undo_memory = 64 * 1024 * 1024;
+	
+	/** The maximum number of undo steps. */
+	static const int max_undo_steps = 128;
+	
+	class Preloader;
+	
 	virtual Template* duplicateImpl() const;
+	virtual std::unique_ptr<TemplatePreloader> createPreloader() const;
+	/// Returns the disk cache for the decoded image, as configured in the settings.
+	DecodedImageCache diskCache() const;
 	virtual void drawOntoTemplateImpl(MapCoordF* coords, int num_coords, QColor color, float width);
 	virtual void drawOntoTemplateUndo(bool redo);
-	void addUndoStep(const DrawOnImageUndoStep& new_step);
+	/**
+	 * Adds an undo step, discarding the redo steps and, within the memory
+	 * budget, the oldest undo steps.
+	 */
+	void addUndoStep(DrawOnImageUndoStep&& new_step);
 	void calculateGeoreferencing();
 	void updatePosFromGeoreferencing();
 
 	QImage image;
 	
-	std::vector< DrawOnImageUndoStep > undo_steps;
+	/// Reduced resolution levels of the image, for drawing at low zoom.
+	ImagePyramid pyramid;
+	
+	/// The image decoded by tiles, for images which exceed the memory limit.
+	/// When this is set, image is null.
+	QScopedPointer<TiledImage> tiled_image;
+	
+	/// The undo steps, from the oldest to the newest. The oldest steps are
+	/// dropped when the memory budget is exceeded.
+	std::deque< DrawOnImageUndoStep > undo_steps;
 	/// Current index in undo_steps, where 0 means before the first item.
 	int undo_index;
 	
@@ -21,13 +21,39 @@
 
 #include "template_map.h"
 
+#include <cmath>
+
+#include <qmath.h>
 #include <QPainter>
 
+#include "core/georeferencing.h"
 #include "map_widget.h"
 #include "renderable.h"
 #include "settings.h"
 #include "util.h"
 
+
+namespace
+{
+	/** The width and height of the cached tiles, in pixels. */
+	const int tile_size = 256;
+	
+	/** The maximum size of the tile cache, in KiB. */
+	const int max_tile_cache_size = 64 * 1024;
+	
+	/** The maximum width and height of the overview image, in pixels. */
+	const int max_overview_size = 2048;
+	
+	/** Returns the key of a tile in the tile cache. */
+	quint64 tileKey(int level, int x, int y)
+	{
+		return (quint64(quint8(level)) << 56)
+		       | (quint64(quint32(x) & 0xfffffff) << 28)
+		       | quint64(quint32(y) & 0xfffffff);
+	}
+}
+
+
 QStringList TemplateMap::locked_maps;
 
 const std::vector<QByteArray>& TemplateMap::supportedExtensions()
@@ -36,8 +62,18 @@ const std::vector<QByteArray>& TemplateMap::supportedExtensions()
 	return extensions;
 }
 
-TemplateMap::TemplateMap(const QString& path, Map* map) : Template(path, map), template_map(NULL)
+TemplateMap::TemplateMap(const QString& path, Map* map)
+ : Template(path, map)
+ , template_map(NULL)
+ , tile_cache(max_tile_cache_size)
+ , tile_cache_antialiasing(false)
+ , overview_resolution(0.0)
 {
+	const Georeferencing& georef = map->getGeoreferencing();
+	connect(&georef, SIGNAL(projectionChanged()), this, SLOT(updateGeoreferencing()));
+	connect(&georef, SIGNAL(transformationChanged()), this, SLOT(updateGeoreferencing()));
+	connect(&georef, SIGNAL(stateChanged()), this, SLOT(updateGeoreferencing()));
+	connect(&georef, SIGNAL(declinationChanged()), this, SLOT(updateGeoreferencing()));
 }
 
 TemplateMap::~TemplateMap()
@@ -70,7 +106,18 @@ bool TemplateMap::loadTemplateFileImpl(bool configuring)
 		new_template_map->deleteTemplate(i);
 	}
 	
+	// The template map is not modified after loading, so its renderables
+	// are built once, concurrently, and drawn without updating them.
+	new_template_map->updateObjects();
+	
 	template_map = new_template_map;
+	template_map_extent = template_map->calculateExtent(true, false, nullptr);
+	overview_resolution = 0.0;
+	if (template_map_extent.isValid())
+		overview_resolution = max_overview_size / qMax(template_map_extent.width(), template_map_extent.height());
+	overview = QImage();
+	tile_cache.clear();
+	updateGeoreferencing();
 	return true;
 }
 
@@ -91,14 +138,19 @@ void TemplateMap::unloadTemplateFileImpl()
 {
 	delete template_map;
 	template_map = NULL;
+	overview = QImage();
+	tile_cache.clear();
 }
 
 void TemplateMap::drawTemplate(QPainter* painter, QRectF& clip_rect, double scale, bool on_screen, float opacity) const
 {
 	if (!is_georeferenced)
 		applyTemplateTransform(painter);
+	else
+		painter->setTransform(georef_transform, true);
 	
-	if (Settings::getInstance().getSettingCached(Settings::MapDisplay_Antialiasing).toBool())
+	const bool antialiasing = Settings::getInstance().getSettingCached(Settings::MapDisplay_Antialiasing).toBool();
+	if (antialiasing)
 		painter->setRenderHint(QPainter::Antialiasing);
 	
 	QRectF transformed_clip_rect;
@@ -111,22 +163,142 @@ void TemplateMap::drawTemplate(QPainter* painter, QRectF& clip_rect, double scal
 	}
 	else
 	{
-		// TODO!
+		transformed_clip_rect = georef_transform.inverted().mapRect(clip_rect);
 	}
 	
-	RenderConfig::Options options;
 	if (on_screen)
-		options |= RenderConfig::Screen;
+	{
+		painter->setOpacity(opacity);
+		drawTiles(painter, transformed_clip_rect, antialiasing);
+		return;
+	}
+	
+	RenderConfig::Options options;
 	RenderConfig config = { *template_map, transformed_clip_rect, scale, options, opacity };
 	// TODO: introduce template-specific options, adjustable by the user, to allow changing some of these parameters
-	template_map->draw(painter, config);
+	template_map->drawUpdated(painter, config);
+}
+
+void TemplateMap::drawTiles(QPainter* painter, const QRectF& clip_rect, bool antialiasing) const
+{
+	if (antialiasing != tile_cache_antialiasing)
+	{
+		tile_cache.clear();
+		overview = QImage();
+		tile_cache_antialiasing = antialiasing;
+	}
+	
+	// The resolution of the tiles is the next power of two of the device resolution.
+	const double device_resolution = std::sqrt(std::abs(painter->transform().determinant()));
+	if (device_resolution <= 0.0)
+		return;
+	
+	// At low zoom, the overview has enough resolution.
+	if (device_resolution <= overview_resolution)
+	{
+		drawOverview(painter, antialiasing);
+		return;
+	}
+	const int level = qBound(-64, int(std::ceil(std::log2(device_resolution))), 63);
+	const double resolution = std::ldexp(1.0, level);  // pixels per millimeter
+	const double tile_extent = tile_size / resolution;  // millimeters
+	
+	const QRectF area = clip_rect.intersected(template_map_extent);
+	if (area.isEmpty())
+		return;
+	
+	// Smoothing is left to the map widget, which may draw fast while zooming.
+	const int first_x = int(std::floor(area.left() / tile_extent));
+	const int last_x  = int(std::floor(area.right() / tile_extent));
+	const int first_y = int(std::floor(area.top() / tile_extent));
+	const int last_y  = int(std::floor(area.bottom() / tile_extent));
+	for (int y = first_y; y <= last_y; ++y)
+	{
+		for (int x = first_x; x <= last_x; ++x)
+		{
+			const QRectF tile_rect(x * tile_extent, y * tile_extent, tile_extent, tile_extent);
+			const quint64 key = tileKey(level, x, y);
+			QImage* tile = tile_cache.object(key);
+			if (!tile)
+			{
+				tile = new QImage(tile_size, tile_size, QImage::Format_ARGB32_Premultiplied);
+				tile->fill(Qt::transparent);
+				
+				QPainter tile_painter(tile);
+				if (antialiasing)
+					tile_painter.setRenderHint(QPainter::Antialiasing);
+				tile_painter.scale(resolution, resolution);
+				tile_painter.translate(-tile_rect.topLeft());
+				RenderConfig config = { *template_map, tile_rect, resolution, RenderConfig::Screen, 1.0 };
+				template_map->drawUpdated(&tile_painter, config);
+				tile_painter.end();
+				
+				tile_cache.insert(key, tile, tile_size * tile_size * 4 / 1024);
+			}
+			painter->drawImage(tile_rect, *tile);
+		}
+	}
+}
+
+void TemplateMap::drawOverview(QPainter* painter, bool antialiasing) const
+{
+	if (overview.isNull())
+	{
+		const QSize size(qMax(1, qCeil(template_map_extent.width() * overview_resolution)),
+		                 qMax(1, qCeil(template_map_extent.height() * overview_resolution)));
+		overview = QImage(size, QImage::Format_ARGB32_Premultiplied);
+		overview.fill(Qt::transparent);
+		
+		QPainter overview_painter(&overview);
+		if (antialiasing)
+			overview_painter.setRenderHint(QPainter::Antialiasing);
+		overview_painter.scale(overview_resolution, overview_resolution);
+		overview_painter.translate(-template_map_extent.topLeft());
+		RenderConfig config = { *template_map, template_map_extent, overview_resolution, RenderConfig::Screen, 1.0 };
+		template_map->drawUpdated(&overview_painter, config);
+		overview_painter.end();
+	}
+	
+	const QRectF target(template_map_extent.topLeft(),
+	                    QSizeF(overview.width() / overview_resolution, overview.height() / overview_resolution));
+	painter->drawImage(target, overview);
 }
 
 QRectF TemplateMap::getTemplateExtent() const
 {
     // If the template is invalid, the extent is an empty rectangle.
     if (!template_map) return QRectF();
-	return template_map->calculateExtent(false, false, NULL);
+	const QRectF extent = template_map->calculateExtent(false, false, NULL);
+	return is_georeferenced ? georef_transform.mapRect(extent) : extent;
+}
+
+void TemplateMap::updateGeoreferencing()
+{
+	georef_transform.reset();
+	if (!template_map || !is_georeferenced)
+		return;
+	
+	// The transformation is approximated by an affine transformation
+	// which matches three corners of the template map's extent.
+	QRectF extent = template_map_extent;
+	if (!extent.isValid())
+		extent = QRectF(-1.0, -1.0, 2.0, 2.0);
+	const std::vector<MapCoordF> corners = {
+	    MapCoordF(extent.topLeft()),
+	    MapCoordF(extent.topRight()),
+	    MapCoordF(extent.bottomLeft()),
+	};
+	std::vector<MapCoordF> map_corners;
+	if (!map->getGeoreferencing().toMapCoordF(&template_map->getGeoreferencing(), corners, map_corners))
+		return;
+	
+	const QPointF u = corners[1] - corners[0];
+	const QPointF v = corners[2] - corners[0];
+	const QTransform from_unit(u.x(), u.y(), v.x(), v.y(), corners[0].x(), corners[0].y());
+	const QPointF map_u = map_corners[1] - map_corners[0];
+	const QPointF map_v = map_corners[2] - map_corners[0];
+	const QTransform to_map(map_u.x(), map_u.y(), map_v.x(), map_v.y(), map_corners[0].x(), map_corners[0].y());
+	georef_transform = from_unit.inverted() * to_map;
 }
 
 Template* TemplateMap::duplicateImpl() const
@@ -23,7 +23,10 @@
 
 #include "template.h"
 
+#include <QCache>
+#include <QImage>
 #include <QStringList>
+#include <QTransform>
 
 /** Template displaying a map file. */
 class TemplateMap : public Template
@@ -46,13 +49,40 @@ public:
 	
     virtual void drawTemplate(QPainter* painter, QRectF& clip_rect, double scale, bool on_screen, float opacity) const;
 	virtual QRectF getTemplateExtent() const;
+	
+public slots:
+	/// Updates the transformation of a georeferenced template map.
+	void updateGeoreferencing();
 
 protected:
 	virtual Template* duplicateImpl() const;
 	
 private:
+	/// Draws the template map from cached raster tiles.
+	void drawTiles(QPainter* painter, const QRectF& clip_rect, bool antialiasing) const;
+	
+	/// Draws the template map from a single raster image of its extent.
+	void drawOverview(QPainter* painter, bool antialiasing) const;
+	
 	Map* template_map;
 	
+	/// The extent of the template map's objects, including helper symbols.
+	QRectF template_map_extent;
+	
+	/// For georeferenced templates, the transformation from template map
+	/// coordinates to map coordinates.
+	QTransform georef_transform;
+	
+	/// Rendered tiles of the template map, for on-screen drawing.
+	/// The key is made from the resolution level and the tile position.
+	mutable QCache<quint64, QImage> tile_cache;
+	mutable bool tile_cache_antialiasing;
+	
+	/// A raster image of the whole template map, for low zoom levels.
+	mutable QImage overview;
+	/// The resolution of the overview image, in pixels per millimeter.
+	double overview_resolution;
+	
 	static QStringList locked_maps;
 };
 
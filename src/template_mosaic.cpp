@@ -0,0 +1,541 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "template_mosaic.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QEvent>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMessageBox>
+#include <QPainter>
+#include <QPointer>
+#include <QRunnable>
+#include <QTextStream>
+#include <qmath.h>
+
+#include "core/georeferencing.h"
+#include "core/task_pool.h"
+#include "map.h"
+#include "settings.h"
+#include "template_image.h"
+#include "util.h"
+
+
+namespace
+{
+	/** Returns the memory limit for decoded images, as configured in the settings. */
+	qint64 imageMemoryLimit()
+	{
+		return qint64(Settings::getInstance().getSettingCached(Settings::Templates_ImageMemoryLimitMB).toInt()) << 20;
+	}
+}
+
+
+
+// ### TemplateMosaic::Preloader ###
+
+/**
+ * Reads the index file, the world files and the sizes of the images.
+ *
+ * The images themselves are not decoded.
+ */
+class TemplateMosaic::Preloader : public TemplatePreloader
+{
+public:
+	explicit Preloader(const QString& path)
+	 : path(path)
+	{
+		; // nothing
+	}
+	
+	void run() override
+	{
+		QFile file(path);
+		if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		{
+			error_string = file.errorString();
+			return;
+		}
+		
+		const QDir dir = QFileInfo(path).dir();
+		QTransform world_to_template;
+		QTextStream stream(&file);
+		while (!stream.atEnd())
+		{
+			const QString line = stream.readLine().trimmed();
+			if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+				continue;
+			
+			if (line.startsWith(QLatin1String("crs:")))
+			{
+				crs_spec = line.mid(4).trimmed();
+				continue;
+			}
+			
+			Tile tile;
+			tile.path = dir.absoluteFilePath(line);
+			QImageReader reader(tile.path);
+			tile.size = reader.size();
+			if (tile.size.isEmpty())
+				tile.size = reader.read().size(); // The format does not provide the size.
+			
+			TemplateImage::WorldFile world_file;
+			if (tile.size.isEmpty() || !world_file.tryToLoadForImage(tile.path))
+			{
+				error_string = TemplateMosaic::tr("Cannot load the image or its world file: %1").arg(line);
+				tiles.clear();
+				return;
+			}
+			
+			// World files refer to the center of the top-left pixel.
+			const QTransform tile_to_world = QTransform::fromTranslate(-0.5, -0.5) * world_file.pixel_to_world;
+			if (tiles.empty())
+			{
+				bool invertible = false;
+				template_to_world = tile_to_world;
+				world_to_template = template_to_world.inverted(&invertible);
+				if (!invertible)
+				{
+					error_string = TemplateMosaic::tr("Invalid world file for: %1").arg(line);
+					return;
+				}
+			}
+			
+			tile.to_template = tile_to_world * world_to_template;
+			tile.extent = tile.to_template.mapRect(QRectF(QPointF(0.0, 0.0), QSizeF(tile.size)));
+			tile.level = 0;
+			tile.pending_level = -1;
+			tile.last_used = 0;
+			tiles.push_back(tile);
+		}
+		
+		if (tiles.empty() && error_string.isEmpty())
+			error_string = TemplateMosaic::tr("The index does not list any images.");
+	}
+	
+	const QString path;
+	std::vector<Tile> tiles;
+	QTransform template_to_world;
+	QString crs_spec;
+	QString error_string;
+};
+
+
+
+// ### TemplateMosaic::DecodingJob ###
+
+/**
+ * Decodes a single image of the mosaic in a worker thread.
+ *
+ * Like Template::LoadJob, the job is an object of the GUI thread.
+ * It hands over the image and deletes itself after finishing,
+ * even if the template was deleted in the meantime.
+ */
+class TemplateMosaic::DecodingJob : public QObject, public QRunnable
+{
+public:
+	DecodingJob(TemplateMosaic* mosaic, int index, int level)
+	 : mosaic(mosaic)
+	 , index(index)
+	 , generation(mosaic->generation)
+	 , path(mosaic->tiles[index].path)
+	 , size(mosaic->tiles[index].size)
+	 , level(level)
+	{
+		setAutoDelete(false);
+	}
+	
+	void run() override
+	{
+		image = TemplateMosaic::decode(path, size, level);
+		// Nothing must be accessed after posting the event.
+		QCoreApplication::postEvent(this, new QEvent(finishedEvent()));
+	}
+	
+	bool event(QEvent* event) override
+	{
+		if (event->type() != finishedEvent())
+			return QObject::event(event);
+		
+		if (mosaic)
+			mosaic->finishDecoding(index, generation, image, level);
+		deleteLater();
+		return true;
+	}
+
+private:
+	static QEvent::Type finishedEvent()
+	{
+		static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+		return type;
+	}
+	
+	QPointer<TemplateMosaic> mosaic;
+	const int index;
+	const int generation;
+	const QString path;
+	const QSize size;
+	const int level;
+	QImage image;
+};
+
+
+
+// ### TemplateMosaic ###
+
+const std::vector<QByteArray>& TemplateMosaic::supportedExtensions()
+{
+	static std::vector<QByteArray> extensions = { "mosaic" };
+	return extensions;
+}
+
+TemplateMosaic::TemplateMosaic(const QString& path, Map* map)
+ : Template(path, map)
+ , georef(new Georeferencing())
+ , image_memory(0)
+ , memory_limit(imageMemoryLimit())
+ , draw_count(0)
+ , generation(0)
+{
+	const Georeferencing& georef = map->getGeoreferencing();
+	connect(&georef, SIGNAL(projectionChanged()), this, SLOT(updateGeoreferencing()));
+	connect(&georef, SIGNAL(transformationChanged()), this, SLOT(updateGeoreferencing()));
+}
+
+TemplateMosaic::~TemplateMosaic()
+{
+	if (template_state == Loaded)
+		unloadTemplateFile();
+}
+
+std::unique_ptr<TemplatePreloader> TemplateMosaic::createPreloader() const
+{
+	return std::unique_ptr<TemplatePreloader>(new Preloader(template_path));
+}
+
+bool TemplateMosaic::loadTemplateFileImpl(bool configuring)
+{
+	// The index is read in a worker thread for loadTemplateFileAsync().
+	std::unique_ptr<Preloader> preloader(static_cast<Preloader*>(takePreloader().release()));
+	if (!preloader)
+	{
+		preloader.reset(static_cast<Preloader*>(createPreloader().release()));
+		preloader->run();
+	}
+	
+	if (preloader->tiles.empty())
+	{
+		setErrorString(preloader->error_string);
+		return false;
+	}
+	
+	++generation;
+	memory_limit = imageMemoryLimit();
+	crs_spec = preloader->crs_spec;
+	template_to_world = preloader->template_to_world;
+	setTiles(std::move(preloader->tiles));
+	
+	if (!configuring)
+	{
+		is_georeferenced = true;
+		calculateGeoreferencing();
+	}
+	
+	return true;
+}
+
+bool TemplateMosaic::postLoadConfiguration(QWidget* dialog_parent, bool& out_center_in_view)
+{
+	Q_UNUSED(out_center_in_view);
+	
+	if (!map->getGeoreferencing().isValid())
+	{
+		QMessageBox::warning(dialog_parent, tr("Error"), tr("A mosaic can only be loaded into a georeferenced map."));
+		return false;
+	}
+	
+	is_georeferenced = true;
+	calculateGeoreferencing();
+	return true;
+}
+
+void TemplateMosaic::unloadTemplateFileImpl()
+{
+	// Pending decoding jobs are ignored when they finish.
+	++generation;
+	tile_index.reset();
+	tiles.clear();
+	extent = QRectF();
+	image_memory = 0;
+}
+
+void TemplateMosaic::setTiles(std::vector<Tile>&& new_tiles)
+{
+	tiles = std::move(new_tiles);
+	image_memory = 0;
+	extent = QRectF();
+	if (tiles.empty())
+	{
+		tile_index.reset();
+		return;
+	}
+	
+	// For a regular grid of images, each image touches up to four cells.
+	const QRectF& first_extent = tiles.front().extent;
+	const qreal cell_size = qMax(first_extent.width(), first_extent.height());
+	tile_index.reset(new SpatialIndex<Tile>(cell_size > 0.0 ? cell_size : 512.0));
+	for (auto& tile : tiles)
+	{
+		rectIncludeSafe(extent, tile.extent);
+		tile_index->insert(&tile, tile.extent);
+	}
+}
+
+void TemplateMosaic::drawTemplate(QPainter* painter, QRectF& clip_rect, double scale, bool on_screen, float opacity) const
+{
+	Q_UNUSED(scale);
+	
+	if (!tile_index)
+		return;
+	
+	applyTemplateTransform(painter);
+	
+	QRectF template_clip_rect;
+	rectIncludeSafe(template_clip_rect, mapToTemplate(MapCoordF(clip_rect.topLeft())));
+	rectIncludeSafe(template_clip_rect, mapToTemplate(MapCoordF(clip_rect.topRight())));
+	rectIncludeSafe(template_clip_rect, mapToTemplate(MapCoordF(clip_rect.bottomLeft())));
+	rectIncludeSafe(template_clip_rect, mapToTemplate(MapCoordF(clip_rect.bottomRight())));
+	if (!template_clip_rect.isValid())
+		template_clip_rect = extent;
+	
+	std::vector<Tile*> visible_tiles;
+	tile_index->query(template_clip_rect, visible_tiles);
+	
+	// On screen, the map widget may ask for fast drawing without smoothing.
+	if (!on_screen)
+		painter->setRenderHint(QPainter::SmoothPixmapTransform);
+	painter->setOpacity(opacity);
+	
+	++draw_count;
+	const QTransform template_transform = painter->worldTransform();
+	for (Tile* tile : visible_tiles)
+	{
+		const QTransform tile_transform = tile->to_template * template_transform;
+		const int level = levelForResolution(*tile, qSqrt(qAbs(tile_transform.determinant())));
+		if (tile->image.isNull() || tile->level > level)
+		{
+			// On screen, a coarser image is drawn until the better one is ready.
+			if (!on_screen)
+				setTileImage(*tile, decode(tile->path, tile->size, level), level);
+			else if (tile->pending_level < 0 || tile->pending_level > level)
+				startDecoding(int(tile - tiles.data()), level);
+		}
+		
+		tile->last_used = draw_count;
+		if (tile->image.isNull())
+			continue;
+		
+		painter->setWorldTransform(tile_transform);
+		painter->drawImage(QRectF(QPointF(0.0, 0.0), QSizeF(tile->size)), tile->image);
+	}
+	painter->setWorldTransform(template_transform);
+	painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+	
+	enforceMemoryLimit();
+}
+
+QRectF TemplateMosaic::getTemplateExtent() const
+{
+	return extent;
+}
+
+qint64 TemplateMosaic::memoryUsage() const
+{
+	return image_memory;
+}
+
+int TemplateMosaic::levelForResolution(const Tile& tile, qreal resolution)
+{
+	// Use the smallest level which still offers one pixel per device pixel.
+	const int max_size = qMax(tile.size.width(), tile.size.height());
+	int level = 0;
+	while ((max_size >> (level + 1)) > 0 && resolution * (2 << level) <= 1.0)
+		++level;
+	return level;
+}
+
+QImage TemplateMosaic::decode(const QString& path, const QSize& size, int level)
+{
+	QImageReader reader(path);
+	if (level > 0)
+		reader.setScaledSize(QSize(qMax(1, size.width() >> level), qMax(1, size.height() >> level)));
+	
+	QImage image = reader.read();
+	if (image.isNull())
+	{
+		qDebug() << "TemplateMosaic: cannot decode" << path << reader.errorString();
+		return image;
+	}
+	
+	// These formats are drawn without conversion.
+	const QImage::Format format = image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+	if (image.format() != format)
+		image = image.convertToFormat(format);
+	return image;
+}
+
+void TemplateMosaic::setTileImage(Tile& tile, const QImage& image, int level) const
+{
+	image_memory -= tile.image.byteCount();
+	tile.image = image;
+	tile.level = level;
+	image_memory += tile.image.byteCount();
+}
+
+void TemplateMosaic::startDecoding(int index, int level) const
+{
+	tiles[index].pending_level = level;
+	// The job needs to call back into the template,
+	// which is logically not modified by drawing.
+	auto job = new DecodingJob(const_cast<TemplateMosaic*>(this), index, level);
+	TaskPool::start(job, TaskPool::Background);
+}
+
+void TemplateMosaic::finishDecoding(int index, int generation, const QImage& image, int level)
+{
+	if (generation != this->generation || index >= int(tiles.size()))
+		return;
+	
+	Tile& tile = tiles[index];
+	if (tile.pending_level == level)
+		tile.pending_level = -1;
+	if (image.isNull() || (!tile.image.isNull() && tile.level <= level))
+		return;
+	
+	// Protect the new image until the next drawing pass.
+	setTileImage(tile, image, level);
+	tile.last_used = draw_count;
+	enforceMemoryLimit();
+	
+	QRectF area;
+	rectIncludeSafe(area, templateToMap(tile.extent.topLeft()));
+	rectInclude(area, templateToMap(tile.extent.topRight()));
+	rectInclude(area, templateToMap(tile.extent.bottomRight()));
+	rectInclude(area, templateToMap(tile.extent.bottomLeft()));
+	map->setTemplateAreaDirty(this, area, 0);
+}
+
+void TemplateMosaic::enforceMemoryLimit() const
+{
+	// Images which were used in the last drawing pass are kept.
+	while (image_memory > memory_limit)
+	{
+		Tile* oldest = nullptr;
+		for (auto& tile : tiles)
+		{
+			if (!tile.image.isNull() && tile.last_used < draw_count
+			    && (!oldest || tile.last_used < oldest->last_used))
+				oldest = &tile;
+		}
+		if (!oldest)
+			break;
+		
+		setTileImage(*oldest, QImage(), 0);
+	}
+}
+
+void TemplateMosaic::updateGeoreferencing()
+{
+	if (is_georeferenced && template_state == Template::Loaded)
+		updatePosFromGeoreferencing();
+}
+
+Template* TemplateMosaic::duplicateImpl() const
+{
+	TemplateMosaic* new_template = new TemplateMosaic(template_path, map);
+	new_template->crs_spec = crs_spec;
+	new_template->template_to_world = template_to_world;
+	
+	// The decoded images are not shared.
+	std::vector<Tile> new_tiles = tiles;
+	for (auto& tile : new_tiles)
+	{
+		tile.image = QImage();
+		tile.level = 0;
+		tile.pending_level = -1;
+		tile.last_used = 0;
+	}
+	new_template->setTiles(std::move(new_tiles));
+	if (tile_index)
+		new_template->calculateGeoreferencing();
+	return new_template;
+}
+
+void TemplateMosaic::calculateGeoreferencing()
+{
+	georef.reset(new Georeferencing());
+	const QString& spec = crs_spec.isEmpty() ? map->getGeoreferencing().getProjectedCRSSpec() : crs_spec;
+	if (!spec.isEmpty())
+		georef->setProjectedCRS("", spec);
+	georef->setTransformationDirectly(template_to_world);
+	
+	if (map->getGeoreferencing().isValid())
+		updatePosFromGeoreferencing();
+}
+
+void TemplateMosaic::updatePosFromGeoreferencing()
+{
+	// Determine map coords of three corner points of the extent
+	// by transforming the points from one Georeferencing into the other
+	const std::vector<MapCoordF> corners = {
+	    MapCoordF(extent.topLeft()),
+	    MapCoordF(extent.topRight()),
+	    MapCoordF(extent.bottomLeft()),
+	};
+	std::vector<MapCoordF> map_corners;
+	if (!map->getGeoreferencing().toMapCoordF(georef.data(), corners, map_corners))
+	{
+		qDebug() << "TemplateMosaic::updatePosFromGeoreferencing() failed";
+		return;
+	}
+	
+	// Calculate template transform as similarity transform from template to map coordinates
+	PassPointList pp_list;
+	for (std::size_t i = 0; i < corners.size(); ++i)
+	{
+		PassPoint pp;
+		pp.src_coords = corners[i];
+		pp.dest_coords = map_corners[i];
+		pp_list.push_back(pp);
+	}
+	
+	QTransform q_transform;
+	if (!pp_list.estimateNonIsometricSimilarityTransform(&q_transform))
+	{
+		qDebug() << "TemplateMosaic::updatePosFromGeoreferencing() failed";
+		return;
+	}
+	qTransformToTemplateTransform(q_transform, &transform);
+	updateTransformationMatrices();
+}
@@ -0,0 +1,189 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_TEMPLATE_MOSAIC_H_
+#define _OPENORIENTEERING_TEMPLATE_MOSAIC_H_
+
+#include "template.h"
+
+#include <memory>
+#include <vector>
+
+#include <QImage>
+#include <QScopedPointer>
+#include <QTransform>
+
+#include "core/spatial_index.h"
+
+class Georeferencing;
+
+
+/**
+ * A template which shows a set of georeferenced raster images as one layer.
+ *
+ * The template file is a plain text index, with the extension ".mosaic".
+ * Each line names an image file, relative to the index file. Each image
+ * must have a world file. Empty lines and lines starting with '#' are
+ * ignored. A line "crs: <spec>" gives the PROJ.4 specification of the
+ * coordinate reference system of the world files. Without such a line,
+ * the world files are expected to use the map's projected CRS.
+ *
+ * Loading the template reads only the index, the world files and the image
+ * sizes. The footprints of the images are kept in a spatial index. Drawing
+ * decodes only the images which intersect the clip rect, at a reduced
+ * resolution which matches the zoom. On screen, missing images are decoded
+ * in worker threads, and the affected area is redrawn when they are ready.
+ * Decoded images are discarded, least recently used first, when the memory
+ * limit for image templates is exceeded.
+ *
+ * The template coordinates are the pixel coordinates of the grid of the
+ * first image. The template is always georeferenced.
+ */
+class TemplateMosaic : public Template
+{
+Q_OBJECT
+public:
+	/**
+	 * Returns the filename extensions supported by this template class.
+	 */
+	static const std::vector<QByteArray>& supportedExtensions();
+	
+	TemplateMosaic(const QString& path, Map* map);
+	virtual ~TemplateMosaic();
+	virtual QString getTemplateType() const {return "TemplateMosaic";}
+	virtual bool isRasterGraphics() const {return true;}
+	
+	virtual bool loadTemplateFileImpl(bool configuring);
+	virtual bool postLoadConfiguration(QWidget* dialog_parent, bool& out_center_in_view);
+	virtual void unloadTemplateFileImpl();
+	
+	virtual void drawTemplate(QPainter* painter, QRectF& clip_rect, double scale, bool on_screen, float opacity) const;
+	virtual QRectF getTemplateExtent() const;
+	
+	/** Returns the number of images in the mosaic. */
+	int getNumTiles() const;
+	
+	/** Returns the memory used by the decoded images, in bytes. */
+	qint64 memoryUsage() const override;
+
+public slots:
+	void updateGeoreferencing();
+
+protected:
+	/** An image of the mosaic. */
+	struct Tile
+	{
+		/** The path of the image file. */
+		QString path;
+		
+		/** The size of the image in pixels. */
+		QSize size;
+		
+		/** Maps the image's pixel coordinates to template coordinates. */
+		QTransform to_template;
+		
+		/** The extent of the image in template coordinates. */
+		QRectF extent;
+		
+		/** The decoded image, at the reduced resolution of level. */
+		QImage image;
+		
+		/** The reduction of the decoded image: its size is size / 2^level. */
+		int level;
+		
+		/** The level of a pending decoding job, or -1. */
+		int pending_level;
+		
+		/** The number of the last drawing pass which used the image. */
+		quint64 last_used;
+	};
+	
+	class DecodingJob;
+	class Preloader;
+	
+	virtual Template* duplicateImpl() const;
+	virtual std::unique_ptr<TemplatePreloader> createPreloader() const;
+	
+	/** Takes the tiles, builds the spatial index and the extent. */
+	void setTiles(std::vector<Tile>&& new_tiles);
+	
+	/** Returns the level which matches the given device pixels per image pixel. */
+	static int levelForResolution(const Tile& tile, qreal resolution);
+	
+	/** Decodes an image at the given level. Thread-safe. */
+	static QImage decode(const QString& path, const QSize& size, int level);
+	
+	/** Stores a decoded image in a tile, and accounts for its memory. */
+	void setTileImage(Tile& tile, const QImage& image, int level) const;
+	
+	/** Starts decoding a tile in a worker thread. */
+	void startDecoding(int index, int level) const;
+	
+	/** Takes the result of a decoding job. */
+	void finishDecoding(int index, int generation, const QImage& image, int level);
+	
+	/** Discards decoded images until the memory limit is met. */
+	void enforceMemoryLimit() const;
+	
+	void calculateGeoreferencing();
+	void updatePosFromGeoreferencing();
+	
+	
+	/** The images of the mosaic. The vector is not resized after loading. */
+	mutable std::vector<Tile> tiles;
+	
+	/** The footprints of the images, in template coordinates. */
+	std::unique_ptr<SpatialIndex<Tile>> tile_index;
+	
+	/** The union of the images' extents. */
+	QRectF extent;
+	
+	/** Maps template coordinates to world coordinates. */
+	QTransform template_to_world;
+	
+	/** The PROJ.4 specification of the world coordinates, or empty for the map CRS. */
+	QString crs_spec;
+	
+	QScopedPointer<Georeferencing> georef;
+	
+	/** The memory used by the decoded images. */
+	mutable qint64 image_memory;
+	
+	/** The limit for image_memory. */
+	qint64 memory_limit;
+	
+	/** Counts the drawing passes, for discarding the least recently used images. */
+	mutable quint64 draw_count;
+	
+	/** Changes with each (un)loading, so that late decoding results can be recognized. */
+	int generation;
+};
+
+
+
+// ### TemplateMosaic inline code ###
+
+inline
+int TemplateMosaic::getNumTiles() const
+{
+	return int(tiles.size());
+}
+
+#endif
@@ -0,0 +1,705 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "template_tile_server.h"
+
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QEvent>
+#include <QFile>
+#include <QFileInfo>
+#include <QLineF>
+#include <QMessageBox>
+#include <QPainter>
+#include <QPointer>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <qmath.h>
+
+#include "core/georeferencing.h"
+#include "core/task_pool.h"
+#include "core/tile_fetcher.h"
+#include "map.h"
+#include "settings.h"
+#include "util.h"
+
+
+namespace
+{
+	/** The PROJ.4 specification of the Web Mercator projection (EPSG:3857). */
+	const char* web_mercator_spec = "+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs";
+	
+	/** Half of the width and height of the Web Mercator world, in meters. */
+	const qreal half_world = 20037508.342789244;
+	
+	/** The number of lower zoom levels which are searched for drawing a missing tile. */
+	const int max_fallback_levels = 6;
+	
+	/**
+	 * The maximum number of device pixels per tile pixel.
+	 *
+	 * A slightly coarser zoom level is accepted, instead of loading four
+	 * times as many tiles.
+	 */
+	const qreal max_tile_magnification = 1.25;
+	
+	quint64 tileKey(int zoom, int x, int y)
+	{
+		return (quint64(zoom) << 58) | (quint64(x) << 29) | quint64(y);
+	}
+	
+	int keyZoom(quint64 key)
+	{
+		return int(key >> 58);
+	}
+	
+	int keyX(quint64 key)
+	{
+		return int((key >> 29) & ((1 << 29) - 1));
+	}
+	
+	int keyY(quint64 key)
+	{
+		return int(key & ((1 << 29) - 1));
+	}
+	
+	/** Decodes the data of a tile, in a format which is drawn without conversion. */
+	QImage decodeTile(const QByteArray& data)
+	{
+		QImage image = QImage::fromData(data);
+		if (!image.isNull())
+		{
+			const QImage::Format format = image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+			if (image.format() != format)
+				image = image.convertToFormat(format);
+		}
+		return image;
+	}
+	
+	/** Returns the size limit of the decoded tiles in memory, in KiB. */
+	int memoryLimitKiB()
+	{
+		return Settings::getInstance().getSettingCached(Settings::Templates_ImageMemoryLimitMB).toInt() * 1024;
+	}
+}
+
+
+
+// ### TemplateTileServer::TileJob ###
+
+/**
+ * Reads a tile from the disk cache, or stores a downloaded tile there,
+ * and decodes the tile, in a worker thread.
+ *
+ * Like Template::LoadJob, the job is an object of the GUI thread.
+ * It hands over the image and deletes itself after finishing,
+ * even if the template was deleted in the meantime.
+ */
+class TemplateTileServer::TileJob : public QObject, public QRunnable
+{
+public:
+	/**
+	 * Constructs a new job.
+	 *
+	 * If data is empty, the tile is read from the path. Otherwise,
+	 * the data is stored at the path. If decode is false, the template
+	 * is not notified.
+	 */
+	TileJob(TemplateTileServer* temp, quint64 key, const QString& path, const QByteArray& data, bool decode)
+	 : temp(temp)
+	 , key(key)
+	 , generation(temp->generation)
+	 , path(path)
+	 , data(data)
+	 , downloaded(!data.isEmpty())
+	 , decode(decode)
+	{
+		setAutoDelete(false);
+	}
+	
+	void run() override
+	{
+		if (downloaded)
+		{
+			QDir().mkpath(QFileInfo(path).path());
+			QSaveFile file(path);
+			if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+				qDebug() << "TemplateTileServer: cannot store" << path << file.errorString();
+		}
+		else
+		{
+			QFile file(path);
+			if (file.open(QIODevice::ReadOnly))
+				data = file.readAll();
+		}
+		
+		if (decode && !data.isEmpty())
+			image = decodeTile(data);
+		data.clear();
+		
+		// Nothing must be accessed after posting the event.
+		QCoreApplication::postEvent(this, new QEvent(finishedEvent()));
+	}
+	
+	bool event(QEvent* event) override
+	{
+		if (event->type() != finishedEvent())
+			return QObject::event(event);
+		
+		if (decode && temp)
+			temp->tileLoaded(key, generation, image, downloaded);
+		deleteLater();
+		return true;
+	}
+
+private:
+	static QEvent::Type finishedEvent()
+	{
+		static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+		return type;
+	}
+	
+	QPointer<TemplateTileServer> temp;
+	const quint64 key;
+	const int generation;
+	const QString path;
+	QByteArray data;
+	const bool downloaded;
+	const bool decode;
+	QImage image;
+};
+
+
+
+// ### TemplateTileServer ###
+
+const std::vector<QByteArray>& TemplateTileServer::supportedExtensions()
+{
+	static std::vector<QByteArray> extensions = { "tiles" };
+	return extensions;
+}
+
+TemplateTileServer::TemplateTileServer(const QString& path, Map* map)
+ : Template(path, map)
+ , min_zoom(0)
+ , max_zoom(19)
+ , tile_size(256)
+ , tiles(memoryLimitKiB())
+ , fetcher(new TileFetcher(this))
+ , georef(new Georeferencing())
+ , generation(0)
+{
+	connect(fetcher, &TileFetcher::tileFetched, this, &TemplateTileServer::tileFetched);
+	connect(fetcher, &TileFetcher::tileFailed, this, &TemplateTileServer::tileFailed);
+	
+	const Georeferencing& georef = map->getGeoreferencing();
+	connect(&georef, SIGNAL(projectionChanged()), this, SLOT(updateGeoreferencing()));
+	connect(&georef, SIGNAL(transformationChanged()), this, SLOT(updateGeoreferencing()));
+}
+
+TemplateTileServer::~TemplateTileServer()
+{
+	if (template_state == Loaded)
+		unloadTemplateFile();
+}
+
+bool TemplateTileServer::readConfiguration()
+{
+	QFile file(template_path);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		setErrorString(file.errorString());
+		return false;
+	}
+	
+	url_template.clear();
+	min_zoom = 0;
+	max_zoom = 19;
+	tile_size = 256;
+	
+	QTextStream stream(&file);
+	while (!stream.atEnd())
+	{
+		const QString line = stream.readLine().trimmed();
+		if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+			continue;
+		
+		const int colon = line.indexOf(QLatin1Char(':'));
+		const QString key = line.left(colon).trimmed();
+		const QString value = line.mid(colon + 1).trimmed();
+		bool ok = true;
+		if (colon < 0)
+			ok = false;
+		else if (key == QLatin1String("url"))
+			url_template = value;
+		else if (key == QLatin1String("min_zoom"))
+			min_zoom = value.toInt(&ok);
+		else if (key == QLatin1String("max_zoom"))
+			max_zoom = value.toInt(&ok);
+		else if (key == QLatin1String("tile_size"))
+			tile_size = value.toInt(&ok);
+		else
+			qDebug() << "TemplateTileServer: unknown key" << key;
+		
+		if (!ok)
+		{
+			setErrorString(tr("Invalid line: %1").arg(line));
+			return false;
+		}
+	}
+	
+	// Zoom levels are limited by the tile keys.
+	if (url_template.isEmpty() || min_zoom < 0 || max_zoom > 29 || min_zoom > max_zoom || tile_size <= 0)
+	{
+		setErrorString(tr("The file does not describe a tile server."));
+		return false;
+	}
+	
+	const QByteArray hash = QCryptographicHash::hash(url_template.toUtf8(), QCryptographicHash::Sha1).toHex();
+	cache_dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+	            + QLatin1String("/online-tiles/") + QString::fromLatin1(hash);
+	return true;
+}
+
+bool TemplateTileServer::loadTemplateFileImpl(bool configuring)
+{
+	if (!readConfiguration())
+		return false;
+	
+	++generation;
+	tiles.setMaxCost(memoryLimitKiB());
+	
+	if (!configuring)
+	{
+		is_georeferenced = true;
+		calculateGeoreferencing();
+	}
+	
+	return true;
+}
+
+bool TemplateTileServer::postLoadConfiguration(QWidget* dialog_parent, bool& out_center_in_view)
+{
+	Q_UNUSED(out_center_in_view);
+	
+	const Georeferencing& map_georef = map->getGeoreferencing();
+	if (!map_georef.isValid() || map_georef.isLocal())
+	{
+		QMessageBox::warning(dialog_parent, tr("Error"), tr("Online tiles can only be shown in a map with geographic georeferencing."));
+		return false;
+	}
+	
+	is_georeferenced = true;
+	calculateGeoreferencing();
+	return true;
+}
+
+void TemplateTileServer::unloadTemplateFileImpl()
+{
+	// Pending tile jobs are ignored when they finish.
+	++generation;
+	fetcher->cancelAll();
+	tiles.clear();
+	wanted.clear();
+	loading.clear();
+	failed.clear();
+}
+
+void TemplateTileServer::drawTemplate(QPainter* painter, QRectF& clip_rect, double scale, bool on_screen, float opacity) const
+{
+	Q_UNUSED(scale);
+	
+	applyTemplateTransform(painter);
+	
+	QRectF template_clip_rect;
+	rectIncludeSafe(template_clip_rect, mapToTemplate(MapCoordF(clip_rect.topLeft())));
+	rectIncludeSafe(template_clip_rect, mapToTemplate(MapCoordF(clip_rect.topRight())));
+	rectIncludeSafe(template_clip_rect, mapToTemplate(MapCoordF(clip_rect.bottomLeft())));
+	rectIncludeSafe(template_clip_rect, mapToTemplate(MapCoordF(clip_rect.bottomRight())));
+	template_clip_rect = template_clip_rect.intersected(QRectF(-half_world, -half_world, 2 * half_world, 2 * half_world));
+	if (template_clip_rect.isEmpty())
+		return;
+	
+	const int zoom = zoomForTemplateResolution(qSqrt(qAbs(painter->worldTransform().determinant())));
+	const TileRange range = tileRange(template_clip_rect, zoom);
+	const QPointF center = template_clip_rect.center();
+	
+	// On screen, the map widget may ask for fast drawing without smoothing.
+	if (!on_screen)
+		painter->setRenderHint(QPainter::SmoothPixmapTransform);
+	painter->setOpacity(opacity);
+	
+	for (int y = range.top; y <= range.bottom; ++y)
+	{
+		for (int x = range.left; x <= range.right; ++x)
+		{
+			const quint64 key = tileKey(zoom, x, y);
+			const QRectF extent = tileExtent(zoom, x, y);
+			if (const QImage* image = tiles.object(key))
+			{
+				painter->drawImage(extent, *image);
+				continue;
+			}
+			
+			if (!on_screen)
+			{
+				// Printing and exporting do not wait for downloads.
+				QFile file(tilePath(zoom, x, y));
+				const QImage image = file.open(QIODevice::ReadOnly) ? decodeTile(file.readAll()) : QImage();
+				if (!image.isNull())
+				{
+					painter->drawImage(extent, image);
+					continue;
+				}
+			}
+			
+			drawFallback(painter, zoom, x, y);
+			
+			if (on_screen && failed.find(key) == failed.end())
+			{
+				// The tiles near the center are requested first.
+				const qreal priority = QLineF(center, extent.center()).length();
+				auto found = wanted.find(key);
+				if (found != wanted.end())
+				{
+					found->second = priority;
+					if (fetcher->isRequested(key))
+						fetcher->request(key, tileUrl(zoom, x, y), priority);
+				}
+				else
+				{
+					wanted.insert(std::make_pair(key, priority));
+					if (loading.find(key) == loading.end() && !fetcher->isRequested(key))
+						startLoading(zoom, x, y);
+				}
+			}
+		}
+	}
+	painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+	
+	if (on_screen)
+		cancelHiddenTiles(zoom);
+}
+
+void TemplateTileServer::drawFallback(QPainter* painter, int zoom, int x, int y) const
+{
+	for (int dz = 1; dz <= max_fallback_levels && zoom - dz >= min_zoom; ++dz)
+	{
+		const int parent_x = x >> dz;
+		const int parent_y = y >> dz;
+		if (const QImage* image = tiles.object(tileKey(zoom - dz, parent_x, parent_y)))
+		{
+			const qreal part_width = qreal(image->width()) / (1 << dz);
+			const qreal part_height = qreal(image->height()) / (1 << dz);
+			const QRectF source((x - (parent_x << dz)) * part_width, (y - (parent_y << dz)) * part_height, part_width, part_height);
+			painter->drawImage(tileExtent(zoom, x, y), *image, source);
+			return;
+		}
+	}
+}
+
+qint64 TemplateTileServer::memoryUsage() const
+{
+	return qint64(tiles.totalCost()) * 1024;
+}
+
+int TemplateTileServer::zoomForResolution(qreal pixels_per_mm) const
+{
+	// The template scale is given in mm on the map per template unit.
+	return zoomForTemplateResolution(pixels_per_mm * qSqrt(qAbs(transform.template_scale_x * transform.template_scale_y)));
+}
+
+int TemplateTileServer::zoomForTemplateResolution(qreal resolution) const
+{
+	// Use the smallest zoom level which offers about one tile pixel per device pixel.
+	const qreal pixels_per_meter = tile_size / (2 * half_world);
+	int zoom = min_zoom;
+	while (zoom < max_zoom && pixels_per_meter * (quint64(1) << zoom) * max_tile_magnification < resolution)
+		++zoom;
+	return zoom;
+}
+
+QRectF TemplateTileServer::tileExtent(int zoom, int x, int y)
+{
+	const qreal size = 2 * half_world / (quint64(1) << zoom);
+	return QRectF(-half_world + x * size, -half_world + y * size, size, size);
+}
+
+TemplateTileServer::TileRange TemplateTileServer::tileRange(const QRectF& template_rect, int zoom)
+{
+	const int num_tiles = 1 << zoom;
+	const qreal size = 2 * half_world / num_tiles;
+	auto index = [num_tiles, size](qreal value) {
+		value = qBound(-half_world, value, half_world);
+		return qBound(0, int(qFloor((value + half_world) / size)), num_tiles - 1);
+	};
+	return { zoom, index(template_rect.left()), index(template_rect.top()), index(template_rect.right()), index(template_rect.bottom()) };
+}
+
+QRectF TemplateTileServer::mapRectToTemplate(const QRectF& map_rect) const
+{
+	QRectF result;
+	rectIncludeSafe(result, mapToTemplate(MapCoordF(map_rect.topLeft())));
+	rectIncludeSafe(result, mapToTemplate(MapCoordF(map_rect.topRight())));
+	rectIncludeSafe(result, mapToTemplate(MapCoordF(map_rect.bottomLeft())));
+	rectIncludeSafe(result, mapToTemplate(MapCoordF(map_rect.bottomRight())));
+	return result;
+}
+
+QUrl TemplateTileServer::tileUrl(int zoom, int x, int y) const
+{
+	const QString z = QString::number(zoom);
+	const QString col = QString::number(x);
+	const QString row = QString::number(y);
+	QString url = url_template;
+	url.replace(QLatin1String("{z}"), z)
+	   .replace(QLatin1String("{x}"), col)
+	   .replace(QLatin1String("{y}"), row)
+	   .replace(QLatin1String("{-y}"), QString::number((1 << zoom) - 1 - y))
+	   .replace(QLatin1String("{TileMatrix}"), z)
+	   .replace(QLatin1String("{TileCol}"), col)
+	   .replace(QLatin1String("{TileRow}"), row);
+	return QUrl(url);
+}
+
+QString TemplateTileServer::tilePath(int zoom, int x, int y) const
+{
+	return cache_dir + QString::fromLatin1("/%1/%2/%3").arg(zoom).arg(x).arg(y);
+}
+
+void TemplateTileServer::startLoading(int zoom, int x, int y) const
+{
+	const quint64 key = tileKey(zoom, x, y);
+	loading.insert(key);
+	// The job needs to call back into the template,
+	// which is logically not modified by drawing.
+	auto job = new TileJob(const_cast<TemplateTileServer*>(this), key, tilePath(zoom, x, y), QByteArray(), true);
+	TaskPool::start(job, TaskPool::Interactive);
+}
+
+void TemplateTileServer::tileLoaded(quint64 key, int generation, const QImage& image, bool downloaded)
+{
+	if (generation != this->generation)
+		return;
+	
+	loading.erase(key);
+	if (!image.isNull())
+	{
+		tiles.insert(key, new QImage(image), qMax(1, image.byteCount() / 1024));
+		if (wanted.erase(key))
+			setTileAreaDirty(keyZoom(key), keyX(key), keyY(key));
+		return;
+	}
+	
+	auto found = wanted.find(key);
+	if (found == wanted.end())
+		return;
+	
+	if (downloaded || !TileFetcher::isSupported())
+	{
+		if (downloaded)
+		{
+			qDebug() << "TemplateTileServer: cannot decode" << tileUrl(keyZoom(key), keyX(key), keyY(key));
+			failed.insert(key);
+		}
+		wanted.erase(found);
+		return;
+	}
+	
+	// Not in the disk cache
+	fetcher->request(key, tileUrl(keyZoom(key), keyX(key), keyY(key)), found->second);
+}
+
+void TemplateTileServer::tileFetched(quint64 key, const QByteArray& data)
+{
+	// Prefetched tiles which are not shown are only stored.
+	const bool decode = wanted.find(key) != wanted.end();
+	if (decode)
+		loading.insert(key);
+	auto job = new TileJob(this, key, tilePath(keyZoom(key), keyX(key), keyY(key)), data, decode);
+	TaskPool::start(job, TaskPool::Interactive);
+}
+
+void TemplateTileServer::tileFailed(quint64 key, const QString& error_string)
+{
+	qDebug() << "TemplateTileServer: cannot download" << tileUrl(keyZoom(key), keyX(key), keyY(key)) << error_string;
+	failed.insert(key);
+	wanted.erase(key);
+}
+
+void TemplateTileServer::cancelHiddenTiles(int zoom) const
+{
+	// With a single view, tiles of other zoom levels are no longer needed.
+	// With multiple views, the other views may need them.
+	std::vector<TileRange> ranges;
+	const auto areas = map->viewedAreas(this);
+	const bool single_view = areas.size() <= 1;
+	for (const auto& area : areas)
+	{
+		const QRectF template_area = mapRectToTemplate(area);
+		if (single_view)
+			ranges.push_back(tileRange(template_area, zoom));
+		else
+			for (int z = min_zoom; z <= max_zoom; ++z)
+				ranges.push_back(tileRange(template_area, z));
+	}
+	
+	auto shown = [&ranges](quint64 key) {
+		const int z = keyZoom(key);
+		const int x = keyX(key);
+		const int y = keyY(key);
+		return std::any_of(begin(ranges), end(ranges), [z, x, y](const TileRange& range) {
+			return range.zoom == z
+			       && x >= range.left && x <= range.right
+			       && y >= range.top && y <= range.bottom;
+		});
+	};
+	
+	fetcher->cancelUnless(shown);
+	for (auto it = wanted.begin(); it != wanted.end(); )
+	{
+		if (shown(it->first))
+			++it;
+		else
+			it = wanted.erase(it);
+	}
+}
+
+void TemplateTileServer::setTileAreaDirty(int zoom, int x, int y)
+{
+	const QRectF extent = tileExtent(zoom, x, y);
+	QRectF area;
+	rectIncludeSafe(area, templateToMap(extent.topLeft()));
+	rectInclude(area, templateToMap(extent.topRight()));
+	rectInclude(area, templateToMap(extent.bottomRight()));
+	rectInclude(area, templateToMap(extent.bottomLeft()));
+	map->setTemplateAreaDirty(this, area, 0);
+}
+
+qint64 TemplateTileServer::countTiles(const QRectF& map_rect, int max_zoom) const
+{
+	const QRectF template_rect = mapRectToTemplate(map_rect);
+	qint64 count = 0;
+	for (int zoom = min_zoom; zoom <= qMin(max_zoom, this->max_zoom); ++zoom)
+	{
+		const TileRange range = tileRange(template_rect, zoom);
+		count += qint64(range.right - range.left + 1) * (range.bottom - range.top + 1);
+	}
+	return count;
+}
+
+int TemplateTileServer::prefetch(const QRectF& map_rect, int max_zoom)
+{
+	if (!TileFetcher::isSupported())
+		return 0;
+	
+	const QRectF template_rect = mapRectToTemplate(map_rect);
+	int count = 0;
+	for (int zoom = min_zoom; zoom <= qMin(max_zoom, this->max_zoom); ++zoom)
+	{
+		const TileRange range = tileRange(template_rect, zoom);
+		for (int y = range.top; y <= range.bottom; ++y)
+		{
+			for (int x = range.left; x <= range.right; ++x)
+			{
+				if (QFile::exists(tilePath(zoom, x, y)))
+					continue;
+				
+				const quint64 key = tileKey(zoom, x, y);
+				failed.erase(key);
+				fetcher->prefetch(key, tileUrl(zoom, x, y));
+				++count;
+			}
+		}
+	}
+	return count;
+}
+
+void TemplateTileServer::updateGeoreferencing()
+{
+	if (is_georeferenced && template_state == Template::Loaded)
+		updatePosFromGeoreferencing();
+}
+
+Template* TemplateTileServer::duplicateImpl() const
+{
+	TemplateTileServer* new_template = new TemplateTileServer(template_path, map);
+	new_template->url_template = url_template;
+	new_template->min_zoom = min_zoom;
+	new_template->max_zoom = max_zoom;
+	new_template->tile_size = tile_size;
+	new_template->cache_dir = cache_dir;
+	new_template->calculateGeoreferencing();
+	return new_template;
+}
+
+void TemplateTileServer::calculateGeoreferencing()
+{
+	// Template coordinates are Web Mercator meters, with y pointing south.
+	georef.reset(new Georeferencing());
+	georef->setProjectedCRS("", QString::fromLatin1(web_mercator_spec));
+	georef->setTransformationDirectly(QTransform(1.0, 0.0, 0.0, -1.0, 0.0, 0.0));
+	
+	if (map->getGeoreferencing().isValid())
+		updatePosFromGeoreferencing();
+}
+
+void TemplateTileServer::updatePosFromGeoreferencing()
+{
+	// Both projections are conformal, so a similarity transform
+	// is a good approximation in the neighbourhood of the map.
+	const MapCoordF ref_point(map->getGeoreferencing().getMapRefPoint());
+	const std::vector<MapCoordF> map_points = {
+	    ref_point,
+	    ref_point + MapCoordF(100.0, 0.0),
+	    ref_point + MapCoordF(0.0, 100.0),
+	};
+	std::vector<MapCoordF> template_points;
+	if (!georef->toMapCoordF(&map->getGeoreferencing(), map_points, template_points))
+	{
+		qDebug() << "TemplateTileServer::updatePosFromGeoreferencing() failed";
+		return;
+	}
+	
+	// Calculate template transform as similarity transform from template to map coordinates
+	PassPointList pp_list;
+	for (std::size_t i = 0; i < map_points.size(); ++i)
+	{
+		PassPoint pp;
+		pp.src_coords = template_points[i];
+		pp.dest_coords = map_points[i];
+		pp_list.push_back(pp);
+	}
+	
+	QTransform q_transform;
+	if (!pp_list.estimateNonIsometricSimilarityTransform(&q_transform))
+	{
+		qDebug() << "TemplateTileServer::updatePosFromGeoreferencing() failed";
+		return;
+	}
+	qTransformToTemplateTransform(q_transform, &transform);
+	updateTransformationMatrices();
+}
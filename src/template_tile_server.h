@@ -0,0 +1,215 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_TEMPLATE_TILE_SERVER_H_
+#define _OPENORIENTEERING_TEMPLATE_TILE_SERVER_H_
+
+#include "template.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <QCache>
+#include <QImage>
+#include <QScopedPointer>
+#include <QUrl>
+
+class Georeferencing;
+class TileFetcher;
+
+
+/**
+ * A template which shows the tiles of an online tile server.
+ *
+ * The template file is a small text file with the extension ".tiles".
+ * It has lines of the form "key: value", and lines starting with '#' are
+ * ignored. The keys are:
+ *
+ * - url: The URL of the tiles, with the placeholders {z}, {x} and {y}.
+ *   {-y} is replaced by the row counted from the bottom (TMS).
+ *   For WMTS, {TileMatrix}, {TileCol} and {TileRow} may be used instead.
+ * - min_zoom, max_zoom: The range of zoom levels offered by the server
+ *   (default: 0 to 19).
+ * - tile_size: The width and height of the tiles in pixels (default: 256).
+ *
+ * The tiles must be in the Web Mercator projection (EPSG:3857), with tile
+ * (0, 0) in the north-west, as used by XYZ servers and by the
+ * GoogleMapsCompatible tile matrix set of WMTS.
+ *
+ * Tiles are taken from memory, then from a disk cache, and finally from the
+ * server. Disk access and decoding is done in worker threads, and downloads
+ * are prioritized by the distance from the center of the drawn area. Requests
+ * for tiles which are no longer shown in any map widget are cancelled. Until
+ * a tile is available, a lower zoom level tile from memory is drawn instead,
+ * and the tile's area is redrawn when the tile arrives.
+ *
+ * Drawing for printing and export uses only the memory and disk caches.
+ * prefetch() downloads the tiles of a region to the disk cache for working
+ * without network. The disk cache is not pruned automatically, so that such
+ * downloads are not lost.
+ *
+ * The template coordinates are Web Mercator meters, with y pointing south.
+ * The template is always georeferenced.
+ */
+class TemplateTileServer : public Template
+{
+Q_OBJECT
+public:
+	/**
+	 * Returns the filename extensions supported by this template class.
+	 */
+	static const std::vector<QByteArray>& supportedExtensions();
+	
+	TemplateTileServer(const QString& path, Map* map);
+	virtual ~TemplateTileServer();
+	virtual QString getTemplateType() const {return "TemplateTileServer";}
+	virtual bool isRasterGraphics() const {return true;}
+	
+	virtual bool loadTemplateFileImpl(bool configuring);
+	virtual bool postLoadConfiguration(QWidget* dialog_parent, bool& out_center_in_view);
+	virtual void unloadTemplateFileImpl();
+	
+	virtual void drawTemplate(QPainter* painter, QRectF& clip_rect, double scale, bool on_screen, float opacity) const;
+	
+	/** Returns the memory used by the decoded tiles, in bytes. */
+	qint64 memoryUsage() const override;
+	
+	/** Returns the highest zoom level offered by the server. */
+	int getMaxZoom() const;
+	
+	/** Returns the zoom level which is drawn at the given resolution (pixels per mm on the map). */
+	int zoomForResolution(qreal pixels_per_mm) const;
+	
+	/**
+	 * Returns the number of tiles which cover the given map area
+	 * at the zoom levels up to max_zoom.
+	 */
+	qint64 countTiles(const QRectF& map_rect, int max_zoom) const;
+	
+	/**
+	 * Downloads the tiles which cover the given map area at the zoom levels
+	 * up to max_zoom, unless they are in the disk cache already.
+	 *
+	 * Returns the number of tiles which are downloaded.
+	 */
+	int prefetch(const QRectF& map_rect, int max_zoom);
+
+public slots:
+	void updateGeoreferencing();
+
+protected:
+	/** The range of tiles of a zoom level. */
+	struct TileRange
+	{
+		int zoom;
+		int left;
+		int top;
+		int right;   ///< inclusive
+		int bottom;  ///< inclusive
+	};
+	
+	class TileJob;
+	
+	virtual Template* duplicateImpl() const;
+	
+	/** Reads the template file, returning false on error. */
+	bool readConfiguration();
+	
+	/** Returns the zoom level for the given number of device pixels per template unit. */
+	int zoomForTemplateResolution(qreal resolution) const;
+	
+	/** Returns the extent of a tile in template coordinates. */
+	static QRectF tileExtent(int zoom, int x, int y);
+	
+	/** Returns the tiles at the given zoom which cover a rect in template coordinates. */
+	static TileRange tileRange(const QRectF& template_rect, int zoom);
+	
+	/** Returns the template rect which covers the given map rect. */
+	QRectF mapRectToTemplate(const QRectF& map_rect) const;
+	
+	QUrl tileUrl(int zoom, int x, int y) const;
+	
+	QString tilePath(int zoom, int x, int y) const;
+	
+	/** Draws the closest lower zoom level tile from memory which covers a tile. */
+	void drawFallback(QPainter* painter, int zoom, int x, int y) const;
+	
+	/** Starts loading a wanted tile from the disk cache, in a worker thread. */
+	void startLoading(int zoom, int x, int y) const;
+	
+	/** Takes the result of a TileJob which read the disk cache or a download. */
+	void tileLoaded(quint64 key, int generation, const QImage& image, bool downloaded);
+	
+	/** Handles a downloaded tile. */
+	void tileFetched(quint64 key, const QByteArray& data);
+	
+	/** Handles a failed download. */
+	void tileFailed(quint64 key, const QString& error_string);
+	
+	/** Cancels the downloads of tiles which are not shown in any map widget. */
+	void cancelHiddenTiles(int zoom) const;
+	
+	/** Marks the area of a tile as "to be redrawn". */
+	void setTileAreaDirty(int zoom, int x, int y);
+	
+	void calculateGeoreferencing();
+	void updatePosFromGeoreferencing();
+	
+	
+	QString url_template;
+	int min_zoom;
+	int max_zoom;
+	int tile_size;
+	
+	/** The directory of the disk cache of this tile server. */
+	QString cache_dir;
+	
+	/** Decoded tiles, by tile key. The cost is given in KiB. */
+	mutable QCache<quint64, QImage> tiles;
+	
+	/** Tiles which are needed for drawing, with their priority. */
+	mutable std::unordered_map<quint64, qreal> wanted;
+	
+	/** Tiles which are loaded in worker threads. */
+	mutable std::unordered_set<quint64> loading;
+	
+	/** Tiles which could not be downloaded. They are not requested again. */
+	std::unordered_set<quint64> failed;
+	
+	TileFetcher* fetcher;
+	
+	QScopedPointer<Georeferencing> georef;
+	
+	/** Changes with each (un)loading, so that late results can be recognized. */
+	int generation;
+};
+
+
+
+// ### TemplateTileServer inline code ###
+
+inline
+int TemplateTileServer::getMaxZoom() const
+{
+	return max_zoom;
+}
+
+#endif
@@ -21,12 +21,19 @@
 
 #include "template_track.h"
 
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <utility>
+
 #include <qmath.h>
+#include <QApplication>
 #include <QComboBox>
 #include <QCommandLinkButton>
 #include <QFormLayout>
 #include <QMessageBox>
 #include <QPainter>
+#include <QPolygonF>
 #include <QRadioButton>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
@@ -36,12 +43,142 @@
 #include "map_widget.h"
 #include "object_undo.h"
 #include "object.h"
+#include "settings.h"
 #include "symbol_line.h"
 #include "symbol_point.h"
 #include "util.h"
 #include "util_task_dialog.h"
 #include "util_gui.h"
 
+
+namespace
+{
+	/** The maximum number of points in a cached piece of a track segment. */
+	const int max_piece_points = 1024;
+	
+	/** The tolerance of the finest decimated paths, in template units. */
+	const qreal min_decimation_tolerance = 0.01;
+	
+	/** The number of decimated paths. Each level has four times the tolerance of the previous one. */
+	const int num_decimation_levels = 8;
+	
+	/**
+	 * Returns which of the points of a polyline are kept by a Douglas-Peucker
+	 * simplification with the given tolerance.
+	 * 
+	 * The function point_at returns the point at the given index as a QPointF.
+	 * The first and the last point are always kept.
+	 */
+	template< class PointAt >
+	std::vector<bool> douglasPeucker(int size, qreal tolerance, PointAt point_at)
+	{
+		std::vector<bool> keep(std::size_t(qMax(size, 0)), false);
+		if (size == 0)
+			return keep;
+		
+		keep.front() = keep.back() = true;
+		std::vector<std::pair<int, int>> ranges = { { 0, size - 1 } };
+		const qreal tolerance_squared = tolerance * tolerance;
+		while (!ranges.empty())
+		{
+			const auto range = ranges.back();
+			ranges.pop_back();
+			
+			const QPointF start = point_at(range.first);
+			const QPointF segment = point_at(range.second) - start;
+			const qreal length_squared = QPointF::dotProduct(segment, segment);
+			qreal max_distance_squared = 0.0;
+			int farthest = -1;
+			for (int i = range.first + 1; i < range.second; ++i)
+			{
+				const QPointF offset = point_at(i) - start;
+				qreal distance_squared = QPointF::dotProduct(offset, offset);
+				if (length_squared > 0.0)
+				{
+					const qreal cross = segment.x() * offset.y() - segment.y() * offset.x();
+					distance_squared = cross * cross / length_squared;
+				}
+				if (distance_squared > max_distance_squared)
+				{
+					max_distance_squared = distance_squared;
+					farthest = i;
+				}
+			}
+			if (farthest >= 0 && max_distance_squared > tolerance_squared)
+			{
+				keep[std::size_t(farthest)] = true;
+				ranges.push_back({ range.first, farthest });
+				ranges.push_back({ farthest, range.second });
+			}
+		}
+		return keep;
+	}
+	
+	/** Returns a Douglas-Peucker simplification of a path made of a single polyline. */
+	QPainterPath decimated(const QPainterPath& path, qreal tolerance)
+	{
+		const int size = path.elementCount();
+		if (size < 3)
+			return path;
+		
+		const std::vector<bool> keep = douglasPeucker(size, tolerance, [&path](int i) {
+			return QPointF(path.elementAt(i));
+		});
+		
+		QPainterPath result(path.elementAt(0));
+		for (int i = 1; i < size; ++i)
+		{
+			if (keep[std::size_t(i)])
+				result.lineTo(path.elementAt(i));
+		}
+		return result;
+	}
+	
+	/** Returns true if the rectangles overlap, even if one of them has no width or height. */
+	bool overlaps(const QRectF& a, const QRectF& b)
+	{
+		return a.left() <= b.right() && b.left() <= a.right()
+		       && a.top() <= b.bottom() && b.top() <= a.bottom();
+	}
+}
+
+
+
+// ### TemplateTrack::Preloader ###
+
+/**
+ * Reads a GPX or DXF file into a Track.
+ * 
+ * The track is a copy of the template's unloaded track, so that it has the
+ * same settings. OSM files are not preloaded because errors are reported
+ * in message boxes while reading them.
+ */
+class TemplateTrack::Preloader : public TemplatePreloader
+{
+public:
+	Preloader(const QString& path, const Track& track)
+	 : path(path)
+	 , track(track)
+	 , loaded(false)
+	{
+		; // nothing
+	}
+	
+	void run() override
+	{
+		loaded = track.loadFrom(path, false, NULL);
+	}
+	
+	QString path;
+	Track track;
+	bool loaded;
+};
+
+
+
+// ### TemplateTrack ###
+
+
 const std::vector<QByteArray>& TemplateTrack::supportedExtensions()
 {
 	static std::vector<QByteArray> extensions = { "dxf", "gpx", "osm" };
@@ -50,6 +187,9 @@ const std::vector<QByteArray>& TemplateTrack::supportedExtensions()
 
 TemplateTrack::TemplateTrack(const QString& path, Map* map)
  : Template(path, map)
+ , track_paths_segments(0)
+ , track_paths_points(0)
+ , track_paths_valid(false)
 {
 	// set default value
 	track_crs_spec = "+proj=latlong +datum=WGS84";
@@ -58,7 +198,8 @@ TemplateTrack::TemplateTrack(const QString& path, Map* map)
 	connect(&georef, SIGNAL(projectionChanged()), this, SLOT(updateGeoreferencing()));
 	connect(&georef, SIGNAL(transformationChanged()), this, SLOT(updateGeoreferencing()));
 	connect(&georef, SIGNAL(stateChanged()), this, SLOT(updateGeoreferencing()));
-	connect(&georef, SIGNAL(declinationChanged()), this, SLOT(updateGeoreferencing()));
+	// The declination does not change the track's map coordinates. A change
+	// of the grivation is signalled by transformationChanged().
 }
 
 TemplateTrack::~TemplateTrack()
@@ -102,10 +243,35 @@ bool TemplateTrack::saveTemplateFile() const
     return track.saveTo(template_path);
 }
 
+std::unique_ptr<TemplatePreloader> TemplateTrack::createPreloader() const
+{
+	if (!template_path.endsWith(QLatin1String(".gpx"), Qt::CaseInsensitive)
+	    && !template_path.endsWith(QLatin1String(".dxf"), Qt::CaseInsensitive))
+	{
+		return {};
+	}
+	return std::unique_ptr<TemplatePreloader>(new Preloader(template_path, track));
+}
+
 bool TemplateTrack::loadTemplateFileImpl(bool configuring)
 {
-	if (!track.loadFrom(template_path, false))
+	// The file is read in a worker thread for loadTemplateFileAsync().
+	std::unique_ptr<Preloader> preloader(static_cast<Preloader*>(takePreloader().release()));
+	if (preloader)
+	{
+		if (!preloader->loaded)
+		{
+			setErrorString(preloader->track.errorString());
+			return false;
+		}
+		track = preloader->track;
+	}
+	// When the template is opened interactively, the progress of large files is shown.
+	else if (!track.loadFrom(template_path, false, configuring ? QApplication::activeWindow() : NULL))
+	{
+		setErrorString(track.errorString());
 		return false;
+	}
 	
 	if (!configuring)
 	{
@@ -116,11 +282,16 @@ bool TemplateTrack::loadTemplateFileImpl(bool configuring)
 		track.setTrackCRS(track_crs);
 		
 		bool crs_is_geographic = track_crs_spec.contains("+proj=latlong");
-		if (!is_georeferenced && crs_is_geographic)
-			calculateLocalGeoreferencing();
-		else
-			track.changeMapGeoreferencing(map->getGeoreferencing());
+		bool projected = (!is_georeferenced && crs_is_geographic)
+		                 ? calculateLocalGeoreferencing()
+		                 : track.changeMapGeoreferencing(map->getGeoreferencing());
+		if (!projected)
+		{
+			setErrorString(track.errorString());
+			return false;
+		}
 	}
+	invalidateTrackPaths();
 	
 	return true;
 }
@@ -215,10 +386,15 @@ bool TemplateTrack::postLoadConfiguration(QWidget* dialog_parent, bool& out_cent
 	
 	// If the track is loaded as not georeferenced,
 	// the map coords for the track coordinates have to be calculated
-	if (!is_georeferenced && crs_is_geographic)
-		calculateLocalGeoreferencing();
-	else
-		track.changeMapGeoreferencing(map->getGeoreferencing());
+	bool projected = (!is_georeferenced && crs_is_geographic)
+	                 ? calculateLocalGeoreferencing()
+	                 : track.changeMapGeoreferencing(map->getGeoreferencing());
+	if (!projected)
+	{
+		QMessageBox::warning(dialog_parent, tr("Error"), track.errorString());
+		return false;
+	}
+	invalidateTrackPaths();
 	
 	return true;
 }
@@ -226,22 +402,35 @@ bool TemplateTrack::postLoadConfiguration(QWidget* dialog_parent, bool& out_cent
 void TemplateTrack::unloadTemplateFileImpl()
 {
 	track.clear();
+	invalidateTrackPaths();
 }
 
 void TemplateTrack::drawTemplate(QPainter* painter, QRectF& clip_rect, double scale, bool on_screen, float opacity) const
 {
-	Q_UNUSED(clip_rect);
-	Q_UNUSED(scale);
-	
 	painter->save();
 	painter->setOpacity(opacity);
-	drawTracks(painter, on_screen);
+	drawTracks(painter, clip_rect, scale, on_screen);
 	drawWaypoints(painter);
 	painter->restore();
 }
 
-void TemplateTrack::drawTracks(QPainter* painter, bool on_screen) const
+void TemplateTrack::drawTracks(QPainter* painter, const QRectF& clip_rect, double scale, bool on_screen) const
 {
+	updateTrackPaths();
+	
+	// The pieces' extents are in template coordinates.
+	QRectF visible_area = clip_rect;
+	if (!is_georeferenced && clip_rect.isValid())
+	{
+		QPolygonF corners;
+		for (const auto& corner : { clip_rect.topLeft(), clip_rect.topRight(), clip_rect.bottomRight(), clip_rect.bottomLeft() })
+			corners << mapToTemplate(MapCoordF(corner));
+		visible_area = corners.boundingRect();
+	}
+	
+	// Half a pixel on screen, in template units
+	const qreal tolerance = (on_screen && scale > 0.0) ? 0.5 / Util::mmToPixelPhysical(scale) : 0.0;
+	
 	painter->save();
 	if (!is_georeferenced)
 		applyTemplateTransform(painter);
@@ -255,34 +444,116 @@ void TemplateTrack::drawTracks(QPainter* painter, bool on_screen) const
 	painter->setPen(pen);
 	painter->setBrush(Qt::NoBrush);
 	
-	// TODO: could speed that up by storing the template coords of the GPS points in a separate vector or caching the painter paths
-	for (int i = 0; i < track.getNumSegments(); ++i)
+	for (auto& piece : track_paths)
 	{
-		QPainterPath path;
-		int size = track.getSegmentPointCount(i);
-		for (int k = 0; k < size; ++k)
+		if (!visible_area.isValid() || overlaps(piece.extent, visible_area))
+			painter->drawPath(trackPath(piece, tolerance));
+	}
+	
+	painter->restore();
+}
+
+void TemplateTrack::updateTrackPaths() const
+{
+	const int num_segments = track.getNumSegments();
+	int num_points = 0;
+	for (int i = 0; i < num_segments; ++i)
+		num_points += track.getSegmentPointCount(i);
+	if (track_paths_valid && num_segments == track_paths_segments && num_points == track_paths_points)
+		return;
+	
+	// While the paths are valid, points are only appended to the track,
+	// e.g. during GPS recording. Then only the last piece is rebuilt,
+	// followed by the pieces of the new points.
+	int segment = 0;
+	int first = 0;
+	if (track_paths_valid && !track_paths.empty() && num_segments >= track_paths_segments && num_points > track_paths_points)
+	{
+		segment = track_paths.back().segment;
+		first = track_paths.back().first;
+		track_paths.pop_back();
+	}
+	else
+	{
+		track_paths.clear();
+	}
+	
+	for (int i = segment; i < num_segments; ++i)
+		appendTrackPaths(i, (i == segment) ? first : 0);
+	
+	track_paths_segments = num_segments;
+	track_paths_points = num_points;
+	track_paths_valid = true;
+}
+
+void TemplateTrack::appendTrackPaths(int segment, int first) const
+{
+	const int size = track.getSegmentPointCount(segment);
+	if (first >= size)
+		return;
+	
+	bool curved = false;
+	for (int k = 0; k < size && !curved; ++k)
+		curved = track.getSegmentPoint(segment, k).is_curve_start;
+	if (curved)
+		first = 0;
+	
+	// Long polylines are split into pieces which share their end points.
+	while (true)
+	{
+		const int end = curved ? size : qMin(size, first + max_piece_points);
+		QPainterPath path(track.getSegmentPoint(segment, first).map_coord);
+		for (int k = first + 1; k < end; ++k)
 		{
-			const TrackPoint& point = track.getSegmentPoint(i, k);
-			
-			if (k > 0)
+			const TrackPoint& point = track.getSegmentPoint(segment, k);
+			if (track.getSegmentPoint(segment, k - 1).is_curve_start && k < size - 2)
 			{
-				if (track.getSegmentPoint(i, k - 1).is_curve_start && k < track.getSegmentPointCount(i) - 2)
-				{
-					path.cubicTo(point.map_coord,
-					             track.getSegmentPoint(i, k + 1).map_coord,
-					             track.getSegmentPoint(i, k + 2).map_coord);
-					k += 2;
-				}
-				else
-					path.lineTo(point.map_coord.x(), point.map_coord.y());
+				path.cubicTo(point.map_coord,
+				             track.getSegmentPoint(segment, k + 1).map_coord,
+				             track.getSegmentPoint(segment, k + 2).map_coord);
+				k += 2;
 			}
 			else
-				path.moveTo(point.map_coord.x(), point.map_coord.y());
+				path.lineTo(point.map_coord);
 		}
-		painter->drawPath(path);
+		
+		TrackPathPiece piece;
+		piece.extent = path.controlPointRect();
+		piece.segment = segment;
+		piece.first = first;
+		piece.decimate = !curved;
+		piece.levels.push_back(path);
+		track_paths.push_back(std::move(piece));
+		
+		if (end >= size)
+			break;
+		first = end - 1;
 	}
+}
+
+void TemplateTrack::invalidateTrackPaths()
+{
+	track_paths.clear();
+	track_paths_valid = false;
+}
+
+const QPainterPath& TemplateTrack::trackPath(TrackPathPiece& piece, qreal tolerance) const
+{
+	if (!piece.decimate || tolerance < min_decimation_tolerance)
+		return piece.levels.front();
 	
-	painter->restore();
+	int level = 1;
+	qreal level_tolerance = min_decimation_tolerance;
+	while (level < num_decimation_levels && 4 * level_tolerance <= tolerance)
+	{
+		++level;
+		level_tolerance *= 4;
+	}
+	
+	// Each level is decimated from the previous one, on demand.
+	for (int next = int(piece.levels.size()); next <= level; ++next)
+		piece.levels.push_back(decimated(piece.levels.back(), min_decimation_tolerance * std::pow(4.0, next - 1)));
+	return piece.levels[level];
 }
 
 void TemplateTrack::drawWaypoints(QPainter* painter) const
@@ -354,6 +625,24 @@ QRectF TemplateTrack::calculateTemplateBoundingBox() const
 	return bbox;
 }
 
+void TemplateTrack::setTrackAreaDirty(int segment, int first_point)
+{
+	QRectF bbox;
+	for (int i = qMax(0, segment); i < track.getNumSegments(); ++i)
+	{
+		const int size = track.getSegmentPointCount(i);
+		for (int k = (i == segment) ? qMax(0, first_point) : 0; k < size; ++k)
+		{
+			MapCoordF point = track.getSegmentPoint(i, k).map_coord;
+			rectIncludeSafe(bbox, is_georeferenced ? point : templateToMap(point));
+		}
+	}
+	
+	// The tracks are drawn with a cosmetic pen.
+	if (bbox.isValid())
+		map->setTemplateAreaDirty(this, bbox, 1);
+}
+
 int TemplateTrack::getTemplateBoundingBoxPixelBorder()
 {
 	// As we don't estimate the extent of the widest waypoint text,
@@ -368,30 +657,44 @@ Template* TemplateTrack::duplicateImpl() const
 	return copy;
 }
 
-PathObject* TemplateTrack::importPathStart()
+PathObject* TemplateTrack::importPath(const std::vector<MapCoordF>& coords, const std::vector<bool>& curve_starts, qreal tolerance) const
 {
-	PathObject* path = new PathObject();
-	path->setSymbol(map->getUndefinedLine(), true);
-	return path;
-}
-
-void TemplateTrack::importPathEnd(PathObject* path)
-{
-	map->addObject(path);
-	map->addObjectToSelection(path, false);
+	const int size = int(coords.size());
+	std::vector<bool> keep(coords.size(), true);
+	
+	// Curves need all of their control points.
+	const bool has_curves = std::find(begin(curve_starts), end(curve_starts), true) != end(curve_starts);
+	if (tolerance > 0.0 && !has_curves && size > 2)
+	{
+		keep = douglasPeucker(size, tolerance, [&coords](int i) {
+			return QPointF(coords[std::size_t(i)]);
+		});
+	}
+	
+	MapCoordVector path_coords;
+	path_coords.reserve(std::size_t(std::count(begin(keep), end(keep), true)));
+	for (int i = 0; i < size; ++i)
+	{
+		if (!keep[std::size_t(i)])
+			continue;
+		
+		auto coord = MapCoord { coords[std::size_t(i)] };
+		if (curve_starts[std::size_t(i)] && i < size - 3)
+			coord.setCurveStart(true);
+		path_coords.push_back(coord);
+	}
+	return new PathObject(map->getUndefinedLine(), std::move(path_coords));
 }
 
-PointObject* TemplateTrack::importWaypoint(const MapCoordF& position, const QString& name)
+PointObject* TemplateTrack::importWaypoint(const MapCoordF& position, const QString& name) const
 {
 	PointObject* point = new PointObject(map->getUndefinedPoint());
 	point->setPosition(position);
 	point->setTag("name", name);
-	map->addObject(point);
-	map->addObjectToSelection(point, false);
 	return point;
 }
 
-bool TemplateTrack::import(QWidget* dialog_parent)
+bool TemplateTrack::import(QWidget* dialog_parent, const QRectF& map_extent)
 {
 	if (track.getNumWaypoints() == 0 && track.getNumSegments() == 0)
 	{
@@ -400,26 +703,44 @@ bool TemplateTrack::import(QWidget* dialog_parent)
 	}
 	
 	const Track::ElementTags& tags = track.tags();
-	DeleteObjectsUndoStep* undo_step = new DeleteObjectsUndoStep(map);
-	MapPart* part = map->getCurrentPart();
+	const qreal tolerance = Settings::getInstance().getSettingCached(Settings::Templates_TrackImportToleranceMM).toReal();
 	std::vector< Object* > result;
 	
 	map->clearObjectSelection(false);
 	
-	if (track.getNumWaypoints() > 0)
+	// Without a valid extent, everything is imported.
+	const bool filtering = map_extent.isValid();
+	auto inside = [this, &map_extent](const TrackPoint& point) {
+		return map_extent.contains(templateToMap(point.map_coord));
+	};
+	
+	std::vector<int> waypoints;
+	waypoints.reserve(track.getNumWaypoints());
+	for (int i = 0; i < track.getNumWaypoints(); i++)
+	{
+		if (!filtering || inside(track.getWaypoint(i)))
+			waypoints.push_back(i);
+	}
+	
+	// The coordinates of the current path
+	std::vector<MapCoordF> coords;
+	std::vector<bool> curve_starts;
+	
+	if (!waypoints.empty())
 	{
 		int res = QMessageBox::question(dialog_parent, tr("Question"), tr("Should the waypoints be imported as a line going through all points?"), QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
 		if (res == QMessageBox::No)
 		{
-			for (int i = 0; i < track.getNumWaypoints(); i++)
+			for (int i : waypoints)
 				result.push_back(importWaypoint(templateToMap(track.getWaypoint(i).map_coord), track.getWaypointName(i)));
 		}
 		else
 		{
-			PathObject* path = importPathStart();
-			for (int i = 0; i < track.getNumWaypoints(); i++)
-				path->addCoordinate(MapCoord(templateToMap(track.getWaypoint(i).map_coord)));
-			importPathEnd(path);
+			for (int i : waypoints)
+				coords.push_back(templateToMap(track.getWaypoint(i).map_coord));
+			curve_starts.assign(coords.size(), false);
+			// The line goes through all waypoints, without simplification.
+			PathObject* path = importPath(coords, curve_starts, 0.0);
 			path->setTag("name", "");
 			result.push_back(path);
 		}
@@ -435,7 +756,25 @@ bool TemplateTrack::import(QWidget* dialog_parent)
 			continue; // Don't create path without objects.
 		}
 		
-		PathObject* path = importPathStart();
+		if (filtering)
+		{
+			bool reaches_extent = false;
+			for (int j = 0; j < segment_size && !reaches_extent; j++)
+				reaches_extent = inside(track.getSegmentPoint(i, j));
+			if (!reaches_extent)
+				continue;
+		}
+		
+		coords.clear();
+		curve_starts.clear();
+		for (int j = 0; j < segment_size; j++)
+		{
+			const TrackPoint& track_point = track.getSegmentPoint(i, j);
+			coords.push_back(templateToMap(track_point.map_coord));
+			curve_starts.push_back(track_point.is_curve_start);
+		}
+		
+		PathObject* path = importPath(coords, curve_starts, tolerance);
 		QString name = track.getSegmentName(i);
 		if (!tags[name].isEmpty())
 		{
@@ -445,29 +784,31 @@ bool TemplateTrack::import(QWidget* dialog_parent)
 		{
 			path->setTag("name", name);
 		}
-		
-		for (int j = 0; j < segment_size; j++)
-		{
-			const TrackPoint& track_point = track.getSegmentPoint(i, j);
-			auto coord = MapCoord { templateToMap(track_point.map_coord) };
-			if (track_point.is_curve_start && j < segment_size - 3)
-				coord.setCurveStart(true);
-			path->addCoordinate(coord);
-		}
 		if (track.getSegmentPoint(i, 0).gps_coord == track.getSegmentPoint(i, segment_size-1).gps_coord)
 		{
 			path->closeAllParts();
 		}
-		importPathEnd(path);
 		result.push_back(path);
 	}
 	
-	for (int i = 0; i < (int)result.size(); ++i) // keep as separate loop to get the correct (final) indices
-		undo_step->addObject(part->findObjectIndex(result[i]));
+	if (result.empty())
+	{
+		QMessageBox::information(dialog_parent, tr("Import"), tr("There is nothing to import in the given area."));
+		return false;
+	}
+	
+	// The objects are added at once, and updated concurrently.
+	const int first_index = map->addObjects(result);
+	map->updateObjects();
+	
+	DeleteObjectsUndoStep* undo_step = new DeleteObjectsUndoStep(map);
+	for (int i = 0; i < int(result.size()); ++i)
+		undo_step->addObject(first_index + i);
 	
 	map->setObjectsDirty();
 	map->push(undo_step);
 	
+	map->addObjectsToSelection(result, false);
 	map->emitSelectionChanged();
 	map->emitSelectionEdited();		// TODO: is this necessary here?
 	
@@ -492,7 +833,9 @@ void TemplateTrack::configureForGPSTrack()
 	track_crs->setTransformationDirectly(QTransform());
 	track.setTrackCRS(track_crs);
 	
+	// The track is still empty, so there is nothing which could fail.
 	track.changeMapGeoreferencing(map->getGeoreferencing());
+	invalidateTrackPaths();
 	
 	template_state = Template::Loaded;
 }
@@ -501,12 +844,15 @@ void TemplateTrack::updateGeoreferencing()
 {
 	if (is_georeferenced && template_state == Template::Loaded)
 	{
-		track.changeMapGeoreferencing(map->getGeoreferencing());
+		// On failure, the track keeps its previous positions.
+		if (!track.changeMapGeoreferencing(map->getGeoreferencing()))
+			setErrorString(track.errorString());
+		invalidateTrackPaths();
 		map->updateAllMapWidgets();
 	}
 }
 
-void TemplateTrack::calculateLocalGeoreferencing()
+bool TemplateTrack::calculateLocalGeoreferencing()
 {
 	LatLon proj_center = track.calcAveragePosition();
 	
@@ -515,7 +861,9 @@ void TemplateTrack::calculateLocalGeoreferencing()
 	georef.setProjectedCRS("", QString("+proj=ortho +datum=WGS84 +lat_0=%1 +lon_0=%2")
 		.arg(proj_center.latitude()).arg(proj_center.longitude()));
 	georef.setGeographicRefPoint(proj_center);
-	track.changeMapGeoreferencing(georef);
+	bool projected = track.changeMapGeoreferencing(georef);
+	invalidateTrackPaths();
+	return projected;
 }
 
 
@@ -23,7 +23,11 @@
 
 #include "template.h"
 
+#include <vector>
+
 #include <QDialog>
+#include <QPainterPath>
+#include <QRectF>
 
 #include "gps_track.h"
 
@@ -63,16 +67,30 @@ public:
     virtual QRectF calculateTemplateBoundingBox() const;
     virtual int getTemplateBoundingBoxPixelBorder();
 	
+	/// Marks only the area of the track points from the given point onwards
+	/// as dirty, instead of the whole template and its waypoint texts.
+	/// The position is given by the segment index and the point index in
+	/// this segment. This point is included, so that the connection to
+	/// points which were appended after it is redrawn.
+	void setTrackAreaDirty(int segment, int first_point);
+	
 	
 	/// Draws all tracks.
-	void drawTracks(QPainter* painter, bool on_screen) const;
+	/// Pieces outside of the clip rect (in map coordinates) are skipped.
+	/// On screen, the tracks are decimated according to the scale.
+	void drawTracks(QPainter* painter, const QRectF& clip_rect, double scale, bool on_screen) const;
 	
 	/// Draws all waypoints.
 	void drawWaypoints(QPainter* painter) const;
 	
 	/// Import the track as map object(s), returns true if something has been imported.
+	/// If a valid map extent is given, only the waypoints within this extent and
+	/// the segments reaching into it are imported.
+	/// Track segments are simplified within the tolerance given by the setting
+	/// Templates_TrackImportToleranceMM. The objects are added to the map at
+	/// once, and their renderables are created concurrently.
 	/// TODO: should this be moved to the Track class?
-	bool import(QWidget* dialog_parent = NULL);
+	bool import(QWidget* dialog_parent = NULL, const QRectF& map_extent = QRectF());
 	
 	/// Replaces the calls to pre/postLoadConfiguration() if creating a new GPS track.
 	/// Assumes that the map's georeferencing is valid.
@@ -85,21 +103,58 @@ public slots:
 	void updateGeoreferencing();
 	
 protected:
+	class Preloader;
+	
 	virtual Template* duplicateImpl() const;
+	virtual std::unique_ptr<TemplatePreloader> createPreloader() const;
     virtual bool loadTypeSpecificTemplateConfiguration(QIODevice* stream, int version);
     virtual void saveTypeSpecificTemplateConfiguration(QXmlStreamWriter& xml) const;
     virtual bool loadTypeSpecificTemplateConfiguration(QXmlStreamReader& xml);
 	
-	/// Projects the track in non-georeferenced mode
-	void calculateLocalGeoreferencing();
+	/// Projects the track in non-georeferenced mode.
+	/// Returns false if the track cannot be projected.
+	bool calculateLocalGeoreferencing();
 	
-	PathObject* importPathStart();
-	void importPathEnd(PathObject* path);
-	PointObject* importWaypoint(const MapCoordF& position, const QString &name = QString());
+	/// Creates a path object with the given map coordinates, which is simplified
+	/// within the given tolerance (in mm) unless it contains curves.
+	/// The object is not added to the map.
+	PathObject* importPath(const std::vector<MapCoordF>& coords, const std::vector<bool>& curve_starts, qreal tolerance) const;
+	
+	/// Creates a point object. The object is not added to the map.
+	PointObject* importWaypoint(const MapCoordF& position, const QString &name = QString()) const;
 	
 	
 	Track track;
 	QString track_crs_spec;
+	
+private:
+	/// A piece of a track segment, with cached paths in template coordinates.
+	struct TrackPathPiece
+	{
+		QRectF extent;
+		int segment;                       ///< The index of the segment
+		int first;                         ///< The index of the first point in the segment
+		bool decimate;                     ///< False for pieces with curves
+		std::vector<QPainterPath> levels;  ///< The full path, followed by decimated paths
+	};
+	
+	/// Rebuilds the cached paths if they are invalid or the number of points changed.
+	/// When points were appended, only the affected pieces are rebuilt.
+	void updateTrackPaths() const;
+	
+	/// Appends the pieces of the given segment, beginning at the given point.
+	void appendTrackPaths(int segment, int first) const;
+	
+	/// Discards the cached paths. Must be called when the points are projected again.
+	void invalidateTrackPaths();
+	
+	/// Returns the coarsest path of the piece which does not exceed the tolerance.
+	const QPainterPath& trackPath(TrackPathPiece& piece, qreal tolerance) const;
+	
+	mutable std::vector<TrackPathPiece> track_paths;
+	mutable int track_paths_segments;
+	mutable int track_paths_points;
+	mutable bool track_paths_valid;
 };
 
 /**
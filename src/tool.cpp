@@ -292,12 +292,13 @@ void MapEditorTool::finishEditingSelection(MapRenderables& renderables, MapRende
 	editor->setEditingInProgress(false);
 }
 
-void MapEditorTool::updateSelectionEditPreview(MapRenderables& renderables)
+void MapEditorTool::updateSelectionEditPreview(MapRenderables& renderables, int renderable_options)
 {
 	for (Object* object : map()->selectedObjects())
 	{
-		object->forceUpdate(); /// @todo get rid of force if possible;
-		// NOTE: only necessary because of setMap(nullptr) in startEditingSelection(..)
+		// The objects have no map while editing, cf. startEditingSelection(..),
+		// so this doesn't touch the map's renderables.
+		object->updateRenderables(QFlag(renderable_options));
 		renderables.insertRenderablesOfObject(object);
 	}
 }
@@ -307,7 +307,7 @@ protected:
 	void startEditingSelection(MapRenderables& old_renderables);
 	void resetEditedObjects();
 	void finishEditingSelection(MapRenderables& renderables, MapRenderables& old_renderables, bool create_undo_step, bool delete_objects = false);
-	void updateSelectionEditPreview(MapRenderables& renderables);
+	void updateSelectionEditPreview(MapRenderables& renderables, int renderable_options = 0);
 	void deleteOldSelectionRenderables(MapRenderables& old_renderables, bool set_area_dirty);
 	
 	/**
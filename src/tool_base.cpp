@@ -47,6 +47,7 @@ MapEditorToolBase::MapEditorToolBase(const QCursor& cursor, MapEditorTool::Type
   snap_exclude_object(NULL),
   cur_map_widget(editor->getMainWidget()),
   key_button_bar(NULL),
+  preview_renderable_options(0),
   cursor(cursor),
   preview_update_triggered(false),
   dragging(false),
@@ -377,7 +378,7 @@ void MapEditorToolBase::updatePreviewObjects()
 		qWarning("MapEditorToolBase::updatePreviewObjects() called but editing == false");
 		return;
 	}
-	updateSelectionEditPreview(*renderables);
+	updateSelectionEditPreview(*renderables, preview_renderable_options);
 	updateDirtyRect();
 }
 
@@ -406,6 +407,7 @@ void MapEditorToolBase::startEditing()
 	Q_ASSERT(!editingInProgress());
 	
 	setEditingInProgress(true);
+	preview_renderable_options = 0;
 	startEditingSelection(*old_renderables);
 }
 
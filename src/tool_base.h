@@ -195,6 +195,12 @@ protected:
 	/// active_modifiers and destruct it when the tool is destructed.
 	QPointer<KeyButtonBar> key_button_bar;
 	
+	/// The Symbol::RenderableOptions for updatePreviewObjects().
+	/// startEditing() resets this to normal rendering. Tools may select
+	/// Symbol::RenderPreview afterwards, for fast interactive updates.
+	/// The objects are rendered normally when the editing is finished.
+	int preview_renderable_options;
+	
 private:
 	// Miscellaneous internals
 	QCursor cursor;
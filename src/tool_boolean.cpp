@@ -22,11 +22,15 @@
 #include "tool_boolean.h"
 
 #include <algorithm>
+#include <limits>
 #include <memory>
 
 #include <QDebug>
 
+#include "core/task_pool.h"
+#include "core/tracing.h"
 #include "map.h"
+#include "map_part.h"
 #include "symbol.h"
 #include "object.h"
 #include "object_undo.h"
@@ -81,6 +85,107 @@ bool operator==(const ClipperLib::IntPoint& lhs, const MapCoord& rhs)
 	return rhs == lhs;
 }
 
+namespace
+{
+	/**
+	 * The bounding box of an object's coordinates, in native map coordinates.
+	 * 
+	 * Curves are contained in the box of their control points.
+	 */
+	struct NativeBox
+	{
+		qint64 left, top, right, bottom;
+		
+		explicit NativeBox(const PathObject* object)
+		 : left(std::numeric_limits<qint64>::max())
+		 , top(std::numeric_limits<qint64>::max())
+		 , right(std::numeric_limits<qint64>::min())
+		 , bottom(std::numeric_limits<qint64>::min())
+		{
+			for (const MapCoord& coord : object->getRawCoordinateVector())
+			{
+				left   = qMin(left, qint64(coord.nativeX()));
+				top    = qMin(top, qint64(coord.nativeY()));
+				right  = qMax(right, qint64(coord.nativeX()));
+				bottom = qMax(bottom, qint64(coord.nativeY()));
+			}
+		}
+		
+		/** Returns true if the boxes overlap or touch. */
+		bool touches(const NativeBox& other) const
+		{
+			return left <= other.right && other.left <= right
+			       && top <= other.bottom && other.top <= bottom;
+		}
+	};
+	
+	int findRoot(std::vector<int>& parent, int i)
+	{
+		while (parent[i] != i)
+		{
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	}
+	
+	/**
+	 * Splits the objects into clusters which are connected by touching
+	 * bounding boxes.
+	 * 
+	 * Objects in different clusters cannot overlap. The original order of
+	 * the objects is kept within each cluster.
+	 */
+	std::vector<BooleanTool::PathObjects> overlappingClusters(const BooleanTool::PathObjects& objects)
+	{
+		const int num_objects = int(objects.size());
+		std::vector<NativeBox> boxes;
+		boxes.reserve(objects.size());
+		for (const PathObject* object : objects)
+			boxes.push_back(NativeBox(object));
+		
+		std::vector<int> by_left(objects.size());
+		for (int i = 0; i < num_objects; ++i)
+			by_left[i] = i;
+		std::sort(begin(by_left), end(by_left), [&boxes](int a, int b) {
+			return boxes[a].left < boxes[b].left;
+		});
+		
+		// Sweep from left to right, keeping the boxes which may still touch.
+		std::vector<int> parent(by_left.size());
+		for (int i = 0; i < num_objects; ++i)
+			parent[i] = i;
+		std::vector<int> active;
+		for (int i : by_left)
+		{
+			const NativeBox& box = boxes[i];
+			active.erase(std::remove_if(begin(active), end(active), [&boxes, &box](int a) {
+				return boxes[a].right < box.left;
+			}), end(active));
+			for (int a : active)
+			{
+				if (box.touches(boxes[a]))
+					parent[findRoot(parent, a)] = findRoot(parent, i);
+			}
+			active.push_back(i);
+		}
+		
+		std::vector<BooleanTool::PathObjects> clusters;
+		std::vector<int> cluster_index(objects.size(), -1);
+		for (int i = 0; i < num_objects; ++i)
+		{
+			int& index = cluster_index[findRoot(parent, i)];
+			if (index < 0)
+			{
+				index = int(clusters.size());
+				clusters.push_back(BooleanTool::PathObjects());
+			}
+			clusters[index].push_back(objects[i]);
+		}
+		return clusters;
+	}
+}
+
 
 
 //### BooleanTool ###
@@ -94,6 +199,8 @@ BooleanTool::BooleanTool(Operation op, Map* map)
 
 bool BooleanTool::execute()
 {
+	MAPPER_TRACE_SCOPE("tool", "BooleanTool::execute");
+	
 	// Check basic prerequisite
 	Object* const primary_object = map->getFirstSelectedObject();
 	if (primary_object->getType() != Object::Path)
@@ -145,12 +252,40 @@ bool BooleanTool::executePerSymbol()
 			backlog.push_back(object->asPath());
 	}
 	
-	QScopedPointer<CombinedUndoStep> undo_step(new CombinedUndoStep(map));
+	return executePerSymbol(backlog);
+}
+
+bool BooleanTool::executeForCurrentPart()
+{
+	MapPart* const part = map->getCurrentPart();
+	PathObjects backlog;
+	backlog.reserve(part->getNumObjects());
+	
+	// Filter visible, editable area objects into initial backlog
+	for (int i = 0, count = part->getNumObjects(); i < count; ++i)
+	{
+		Object* const object = part->getObject(i);
+		const Symbol* const symbol = object->getSymbol();
+		if (symbol && !symbol->isHidden() && !symbol->isProtected()
+		    && (symbol->getContainedTypes() & Symbol::Area))
+		{
+			backlog.push_back(object->asPath());
+		}
+	}
+	
+	return executePerSymbol(backlog);
+}
+
+bool BooleanTool::executePerSymbol(PathObjects& backlog)
+{
+	// Objects in different clusters do not interact for these operations.
+	const bool use_clusters = (op == Union || op == MergeHoles);
+	
+	std::vector<Job> jobs;
 	PathObjects new_backlog;
 	new_backlog.reserve(backlog.size()/2);
 	PathObjects in_objects;
 	in_objects.reserve(backlog.size()/2);
-	PathObjects out_objects;
 	while (!backlog.empty())
 	{
 		PathObject* const primary_object = backlog.front();
@@ -179,11 +314,32 @@ bool BooleanTool::executePerSymbol()
 		if (in_objects.size() == 1)
 			continue;
 		
-		// Perform the core operation
-		out_objects.clear();
-		executeForObjects(primary_object, in_objects, out_objects, *undo_step);
+		// The jobs must not update the objects concurrently.
+		for (PathObject* object : in_objects)
+			object->update();
+		
+		if (!use_clusters)
+		{
+			jobs.push_back({ primary_object, in_objects, PathObjects(), false });
+			continue;
+		}
+		
+		for (PathObjects& cluster : overlappingClusters(in_objects))
+		{
+			// A single object is left unchanged by a union.
+			if (cluster.size() == 1 && op == Union)
+				continue;
+			
+			auto subject = std::find(begin(cluster), end(cluster), primary_object);
+			jobs.push_back({ subject == end(cluster) ? cluster.front() : primary_object, cluster, PathObjects(), false });
+		}
 	}
 	
+	executeJobs(jobs);
+	
+	QScopedPointer<CombinedUndoStep> undo_step(new CombinedUndoStep(map));
+	replaceObjects(jobs, *undo_step);
+	
 	bool const have_changes = undo_step->getNumSubSteps() > 0;
 	if (have_changes)
 	{
@@ -195,6 +351,14 @@ bool BooleanTool::executePerSymbol()
 	return have_changes;
 }
 
+void BooleanTool::executeJobs(std::vector<Job>& jobs)
+{
+	TaskPool::forEach(int(jobs.size()), 1, [this, &jobs](int i) {
+		Job& job = jobs[i];
+		job.success = executeForObjects(job.subject, job.in_objects, job.out_objects);
+	});
+}
+
 bool BooleanTool::executeForObjects(PathObject* subject, PathObjects& in_objects, PathObjects& out_objects, CombinedUndoStep& undo_step)
 {
 	if (!executeForObjects(subject, in_objects, out_objects))
@@ -203,6 +367,12 @@ bool BooleanTool::executeForObjects(PathObject* subject, PathObjects& in_objects
 		return false; // in release build
 	}
 	
+	replaceObjects(subject, in_objects, out_objects, undo_step);
+	return true;
+}
+
+void BooleanTool::replaceObjects(PathObject* subject, PathObjects& in_objects, PathObjects& out_objects, CombinedUndoStep& undo_step)
+{
 	// Add original objects to undo step, and remove them from map.
 	QScopedPointer<AddObjectsUndoStep> add_step(new AddObjectsUndoStep(map));
 	for (PathObject* object : in_objects)
@@ -239,25 +409,92 @@ bool BooleanTool::executeForObjects(PathObject* subject, PathObjects& in_objects
 	
 	undo_step.push(add_step.take());
 	undo_step.push(delete_step.take());
-	return true;
+}
+
+void BooleanTool::replaceObjects(std::vector<Job>& jobs, CombinedUndoStep& undo_step)
+{
+	MapPart* part = map->getCurrentPart();
+	
+	// A single lookup table instead of searching the part for every object
+	QHash<const Object*, int> object_index;
+	object_index.reserve(part->getNumObjects());
+	for (int i = 0, count = part->getNumObjects(); i < count; ++i)
+		object_index.insert(part->getObject(i), i);
+	
+	// Add original objects to undo step, and remove them from map.
+	QScopedPointer<AddObjectsUndoStep> add_step(new AddObjectsUndoStep(map));
+	std::vector<int> removed_indices;
+	std::vector<bool> select_result(jobs.size(), false);
+	for (std::size_t j = 0; j < jobs.size(); ++j)
+	{
+		Job& job = jobs[j];
+		if (!job.success)
+			continue;
+		
+		select_result[j] = map->isObjectSelected(job.subject);
+		for (PathObject* object : job.in_objects)
+		{
+			if (op != Difference || object == job.subject)
+			{
+				const int index = object_index.value(object, -1);
+				Q_ASSERT(index >= 0);
+				add_step->addObject(index, object);
+				removed_indices.push_back(index);
+				if (map->isObjectSelected(object))
+					map->removeObjectFromSelection(object, false);
+			}
+		}
+	}
+	part->deleteObjects(removed_indices, true);
+	for (std::size_t j = 0; j < jobs.size(); ++j)
+	{
+		if (!jobs[j].success)
+			continue;
+		
+		for (PathObject* object : jobs[j].in_objects)
+		{
+			if (op != Difference || object == jobs[j].subject)
+				object->setMap(map); // necessary so objects are saved correctly
+		}
+	}
+	
+	// Add resulting objects to map, and create delete step for them
+	QScopedPointer<DeleteObjectsUndoStep> delete_step(new DeleteObjectsUndoStep(map));
+	for (std::size_t j = 0; j < jobs.size(); ++j)
+	{
+		if (!jobs[j].success)
+			continue;
+		
+		for (PathObject* object : jobs[j].out_objects)
+		{
+			delete_step->addObject(map->addObject(object));
+			if (select_result[j])
+				map->addObjectToSelection(object, false);
+		}
+	}
+	
+	if (add_step->isEmpty() && delete_step->isEmpty())
+		return;
+	
+	undo_step.push(add_step.take());
+	undo_step.push(delete_step.take());
 }
 
 bool BooleanTool::executeForObjects(PathObject* subject, PathObjects& in_objects, PathObjects& out_objects)
 {
-	// Convert the objects to Clipper polygons and
-	// create a hash map, mapping point positions to the PathCoords.
-	// These paths are to be regarded as closed.
-	PolyMap polymap;
+	// Convert the objects to Clipper polygons, and record the origin of
+	// each polygon. These paths are to be regarded as closed.
+	PolygonSources sources;
 	
 	ClipperLib::Paths subject_polygons;
-	pathObjectToPolygons(subject, subject_polygons, polymap);
+	pathObjectToPolygons(subject, subject_polygons, nullptr, &sources);
 	
 	ClipperLib::Paths clip_polygons;
 	for (PathObject* object : in_objects)
 	{
 		if (object != subject)
 		{
-			pathObjectToPolygons(object, clip_polygons, polymap);
+			pathObjectToPolygons(object, clip_polygons, nullptr, &sources);
 		}
 	}
 	
@@ -289,34 +526,62 @@ bool BooleanTool::executeForObjects(PathObject* subject, PathObjects& in_objects
 	bool success = clipper.Execute(clip_type, solution, fill_type, fill_type);
 	if (success)
 	{
+		// Contours which equal an input polygon are copied from the original.
+		ClipperLib::Paths polygons;
+		polygons.reserve(subject_polygons.size() + clip_polygons.size());
+		polygons.insert(polygons.end(), subject_polygons.begin(), subject_polygons.end());
+		polygons.insert(polygons.end(), clip_polygons.begin(), clip_polygons.end());
+		auto unchanged_parts = findUnchangedParts(solution, polygons, sources);
+		
+		// For the other contours, create a hash map, mapping point
+		// positions to the PathCoords, in order to rebuild the curves.
+		PolyMap polymap;
+		if (unchanged_parts.size() < solution.Total())
+		{
+			ClipperLib::Paths unused;
+			for (PathObject* object : in_objects)
+				pathObjectToPolygons(object, unused, &polymap);
+		}
+		
 		// Try to convert the solution polygons to objects again
-		polyTreeToPathObjects(solution, out_objects, subject, polymap);
+		polyTreeToPathObjects(solution, out_objects, subject, polymap, unchanged_parts);
 	}
 	
 	return success;
 }
 
-void BooleanTool::polyTreeToPathObjects(const ClipperLib::PolyTree& tree, PathObjects& out_objects, const PathObject* proto, const PolyMap& polymap)
+void BooleanTool::polyTreeToPathObjects(const ClipperLib::PolyTree& tree, PathObjects& out_objects, const PathObject* proto, const PolyMap& polymap, const UnchangedParts& unchanged_parts)
 {
 	for (int i = 0, count = tree.ChildCount(); i < count; ++i)
-		outerPolyNodeToPathObjects(*tree.Childs[i], out_objects, proto, polymap);
+		outerPolyNodeToPathObjects(*tree.Childs[i], out_objects, proto, polymap, unchanged_parts);
 }
 
-void BooleanTool::outerPolyNodeToPathObjects(const ClipperLib::PolyNode& node, PathObjects& out_objects, const PathObject* proto, const PolyMap& polymap)
+void BooleanTool::outerPolyNodeToPathObjects(const ClipperLib::PolyNode& node, PathObjects& out_objects, const PathObject* proto, const PolyMap& polymap, const UnchangedParts& unchanged_parts)
 {
-	auto object = std::unique_ptr<PathObject>{ new PathObject{ *proto } };
-	object->clearCoordinates();
+	// Copying the proto would also copy its path coords, only to clear them.
+	auto object = std::unique_ptr<PathObject>{ new PathObject{ proto->getSymbol() } };
+	object->setTags(proto->tags());
+	object->setPatternRotation(proto->getPatternRotation());
+	object->setPatternOrigin(proto->getPatternOrigin());
+	
+	auto contourToPathPart = [&polymap, &unchanged_parts, &object](const ClipperLib::Path& contour) {
+		auto unchanged = unchanged_parts.constFind(&contour);
+		if (unchanged != unchanged_parts.constEnd())
+			copyPathPart(*unchanged, object.get());
+		else
+			polygonToPathPart(contour, polymap, object.get());
+	};
 	
 	try
 	{
-		polygonToPathPart(node.Contour, polymap, object.get());
+		contourToPathPart(node.Contour);
 		for (int i = 0, i_count = node.ChildCount(); i < i_count; ++i)
 		{
-			polygonToPathPart(node.Childs[i]->Contour, polymap, object.get());
+			contourToPathPart(node.Childs[i]->Contour);
 			
 			// Add outer polygons contained by (nested within) holes ...
 			for (int j = 0, j_count = node.Childs[i]->ChildCount(); j < j_count; ++j)
-				outerPolyNodeToPathObjects(*node.Childs[i]->Childs[j], out_objects, proto, polymap);
+				outerPolyNodeToPathObjects(*node.Childs[i]->Childs[j], out_objects, proto, polymap, unchanged_parts);
 		}
 		
 		out_objects.push_back(object.release());
@@ -327,6 +592,77 @@ void BooleanTool::outerPolyNodeToPathObjects(const ClipperLib::PolyNode& node, P
 	}
 }
 
+BooleanTool::UnchangedParts BooleanTool::findUnchangedParts(const ClipperLib::PolyTree& solution, const ClipperLib::Paths& polygons, const PolygonSources& sources)
+{
+	Q_ASSERT(polygons.size() == sources.size());
+	
+	// Each polygon is registered by its smallest point.
+	auto less = [](const ClipperLib::IntPoint& a, const ClipperLib::IntPoint& b) {
+		return a.X < b.X || (a.X == b.X && a.Y < b.Y);
+	};
+	auto smallestPoint = [&less](const ClipperLib::Path& polygon) {
+		return std::min_element(polygon.begin(), polygon.end(), less);
+	};
+	
+	QHash<ClipperLib::IntPoint, std::size_t> polygon_by_point;
+	polygon_by_point.reserve(int(polygons.size()));
+	for (std::size_t i = 0; i < polygons.size(); ++i)
+	{
+		if (polygons[i].size() >= 3)
+			polygon_by_point.insertMulti(*smallestPoint(polygons[i]), i);
+	}
+	
+	UnchangedParts unchanged_parts;
+	for (auto node = solution.GetFirst(); node; node = node->GetNext())
+	{
+		const ClipperLib::Path& contour = node->Contour;
+		if (contour.size() < 3)
+			continue;
+		
+		const auto contour_start = smallestPoint(contour);
+		for (auto it = polygon_by_point.constFind(*contour_start); it != polygon_by_point.constEnd() && it.key() == *contour_start; ++it)
+		{
+			const ClipperLib::Path& polygon = polygons[it.value()];
+			if (polygon.size() != contour.size())
+				continue;
+			
+			// Compare both sequences, starting at the smallest point.
+			const auto polygon_start = smallestPoint(polygon);
+			const auto offset = polygon_start - polygon.begin();
+			const auto contour_offset = contour_start - contour.begin();
+			const auto size = polygon.size();
+			bool equal = true;
+			for (std::size_t k = 0; k < size && equal; ++k)
+				equal = (polygon[(offset + k) % size] == contour[(contour_offset + k) % size]);
+			
+			if (equal)
+			{
+				unchanged_parts.insert(&contour, sources[it.value()]);
+				break;
+			}
+		}
+	}
+	return unchanged_parts;
+}
+
+void BooleanTool::copyPathPart(const PolygonSource& source, PathObject* object)
+{
+	const PathPart& part = *source.part;
+	const PathObject* original = part.path;
+	for (auto i = part.first_index; i <= part.last_index; ++i)
+	{
+		MapCoord coord = original->getCoordinate(i);
+		coord.setClosePoint(false);
+		coord.setHolePoint(false);
+		object->addCoordinate(coord, i == part.first_index);
+	}
+	
+	PathPart& new_part = object->parts().back();
+	new_part.setClosed(true, true);
+	if (source.reversed)
+		new_part.reverse();
+}
+
 
 
 void BooleanTool::executeForLine(const PathObject* area, const PathObject* line, BooleanTool::PathObjects& out_objects)
@@ -415,10 +751,11 @@ void BooleanTool::executeForLine(const PathObject* area, const PathObject* line,
 void BooleanTool::pathObjectToPolygons(
         const PathObject* object,
         ClipperLib::Paths& polygons,
-        PolyMap& polymap)
+        PolyMap* polymap,
+        PolygonSources* sources)
 {
 	object->update();
-	auto coords = object->getRawCoordinateVector();
+	const auto& coords = object->getRawCoordinateVector();
 	
 	polygons.reserve(polygons.size() + object->parts().size());
 	
@@ -443,18 +780,22 @@ void BooleanTool::pathObjectToPolygons(
 				auto point = MapCoord { path_coord.pos };
 				polygon.push_back(ClipperLib::IntPoint(point.nativeX(), point.nativeY()));
 			}
-			polymap.insertMulti(polygon.back(), std::make_pair(&part, &path_coord));
+			if (polymap)
+				polymap->insertMulti(polygon.back(), std::make_pair(&part, &path_coord));
 		}
 		
 		bool orientation = Orientation(polygon);
-		if ( (&part == &object->parts().front()) != orientation )
+		bool reversed = (&part == &object->parts().front()) != orientation;
+		if (reversed)
 		{
 			std::reverse(polygon.begin(), polygon.end());
 		}
+		if (sources)
+			sources->push_back({ &part, reversed });
 		
 		// Push_back shall move the polygon.
 		static_assert(std::is_nothrow_move_constructible<ClipperLib::Path>::value, "ClipperLib::Path must be nothrow move constructible");
-		polygons.push_back(polygon);
+		polygons.push_back(std::move(polygon));
 	}
 }
 
@@ -48,6 +48,8 @@ class Symbol;
  */
 class BooleanTool
 {
+friend class BooleanToolTest;
+
 public:
 	/**
 	 * A list of PathObject elements.
@@ -93,10 +95,25 @@ public:
 	 * operation failed for remain unchanged. The operation continues for other
 	 * groups of objects.
 	 * 
+	 * For union and for merging holes, each group is further split into
+	 * clusters of objects with overlapping extents. The clusters are
+	 * processed independently and concurrently.
+	 * 
 	 * @return True if the map was changed, false otherwise.
 	 */
 	bool executePerSymbol();
 	
+	/**
+	 * Executes the operation per symbol on all area objects in the current
+	 * map part, like executePerSymbol().
+	 * 
+	 * Objects with hidden or protected symbols are ignored. The changes
+	 * are recorded in a single undo step.
+	 * 
+	 * @return True if the map was changed, false otherwise.
+	 */
+	bool executeForCurrentPart();
+	
 	/**
 	 * Executes the operation on particular objects.
 	 * 
@@ -129,6 +146,70 @@ private:
 	
 	typedef QHash< ClipperLib::IntPoint, PathCoordInfo > PolyMap;
 	
+	/**
+	 * The origin of a polygon created by pathObjectToPolygons().
+	 */
+	struct PolygonSource
+	{
+		const PathPart* part;
+		bool reversed;
+	};
+	
+	typedef std::vector< PolygonSource > PolygonSources;
+	
+	/**
+	 * A lookup of result contours which are identical to input polygons.
+	 */
+	typedef QHash< const ClipperLib::Path*, PolygonSource > UnchangedParts;
+	
+	/**
+	 * The input and output of a single operation within executePerSymbol().
+	 */
+	struct Job
+	{
+		PathObject* subject;
+		PathObjects in_objects;
+		PathObjects out_objects;
+		bool success;
+	};
+	
+	/**
+	 * Executes the operation per symbol on the given area objects.
+	 * 
+	 * @see executePerSymbol()
+	 */
+	bool executePerSymbol(PathObjects& backlog);
+	
+	/**
+	 * Runs executeForObjects() for each of the given jobs, concurrently.
+	 * 
+	 * This function does not change the map. The objects' output must be
+	 * up to date.
+	 */
+	void executeJobs(std::vector< Job >& jobs);
+	
+	/**
+	 * Replaces in_objects by out_objects in the map, and provides undo steps.
+	 * 
+	 * @see executeForObjects()
+	 */
+	void replaceObjects(
+	        PathObject* subject,
+	        PathObjects& in_objects,
+	        PathObjects& out_objects,
+	        CombinedUndoStep& undo_step );
+	
+	/**
+	 * Replaces the input objects by the output objects of all successful
+	 * jobs, and provides undo steps.
+	 * 
+	 * The output objects are selected if the job's subject was selected.
+	 * This function takes time linear in the size of the map part.
+	 */
+	void replaceObjects(
+	        std::vector< Job >& jobs,
+	        CombinedUndoStep& undo_step );
+	
 	/**
 	 * Executes the operation on particular objects, and provides undo steps.
 	 * 
@@ -154,7 +235,8 @@ private:
 	        const ClipperLib::PolyTree& tree,
 	        PathObjects& out_objects,
 	        const PathObject* proto,
-	        const PolyMap& polymap );
+	        const PolyMap& polymap,
+	        const UnchangedParts& unchanged_parts );
 
 	/**
 	 * Converts a ClipperLib::PolyNode to PathObjects.
@@ -167,15 +249,39 @@ private:
 	        const ClipperLib::PolyNode& node,
 	        PathObjects& out_objects,
 	        const PathObject* proto,
-	        const PolyMap& polymap );
+	        const PolyMap& polymap,
+	        const UnchangedParts& unchanged_parts );
 	
 	/**
-	 * Constructs ClipperLib::Paths from a PathObject.
+	 * Constructs ClipperLib::Paths from a PathObject, one polygon per part.
+	 * 
+	 * If polymap is not null, the polygon points are recorded in the polymap.
+	 * If sources is not null, the origin of each polygon is appended.
 	 */
 	static void pathObjectToPolygons(
 	        const PathObject* object,
 	        ClipperLib::Paths& polygons,
-	        PolyMap& polymap );
+	        PolyMap* polymap,
+	        PolygonSources* sources = nullptr );
+	
+	/**
+	 * Finds the contours in the solution which are identical to one of the
+	 * given polygons, up to the start point.
+	 * 
+	 * Such contours can be replaced by a copy of the original path part,
+	 * without rebuilding the curves.
+	 */
+	static UnchangedParts findUnchangedParts(
+	        const ClipperLib::PolyTree& solution,
+	        const ClipperLib::Paths& polygons,
+	        const PolygonSources& sources );
+	
+	/**
+	 * Adds a copy of the given original part to the object.
+	 */
+	static void copyPathPart(
+	        const PolygonSource& source,
+	        PathObject* object );
 	
 	/**
 	 * Reconstructs a PathObject from a polygon given as ClipperLib::Path.
@@ -21,12 +21,18 @@
 
 #include "tool_cut.h"
 
+#include <algorithm>
+
 #include <QApplication>
+#include <QHash>
 #include <QMessageBox>
 #include <QMouseEvent>
 #include <QPainter>
 
+#include "core/task_pool.h"
+#include "core/tracing.h"
 #include "map.h"
+#include "map_part.h"
 #include "map_widget.h"
 #include "object.h"
 #include "object_undo.h"
@@ -46,6 +52,219 @@ namespace
 	 * will still be displayed (and can be edited).
 	 */
 	static unsigned int max_objects_for_handle_display = 10;
+	
+	/**
+	 * The threshold for connecting the split line to the pieces of an area.
+	 */
+	const double split_threshold = 0.01;
+	
+	/**
+	 * Returns the two pieces of splitting an area along the given split path,
+	 * which runs from the boundary position start_len to end_len of the
+	 * given part.
+	 * 
+	 * Holes of the area are distributed to the pieces.
+	 * This function does not access the map, and the area must be up to date.
+	 */
+	std::vector<PathObject*> splitArea(
+	        const PathObject* area,
+	        PathPartVector::size_type part_index,
+	        PathCoord::length_type start_len,
+	        PathCoord::length_type end_len,
+	        PathObject* split_path,
+	        Map* map)
+	{
+		PathObject* holes = nullptr; // if the area contains holes, they are saved in this temporary object
+		if (area->parts().size() > 1)
+		{
+			holes = area->duplicate()->asPath();
+			holes->deletePart(0);
+		}
+		
+		bool ok; Q_UNUSED(ok); // "ok" is only used in Q_ASSERT.
+		PathObject* out_paths[2] = { new PathObject { area->parts().front() }, nullptr };
+		const PathPart& drag_part = area->parts()[part_index];
+		if (drag_part.isClosed())
+		{
+			out_paths[1] = new PathObject { *out_paths[0] };
+			
+			out_paths[0]->changePathBounds(part_index, start_len, end_len);
+			ok = out_paths[0]->connectIfClose(split_path, split_threshold);
+			Q_ASSERT(ok);
+			
+			out_paths[1]->changePathBounds(part_index, end_len, start_len);
+			ok = out_paths[1]->connectIfClose(split_path, split_threshold);
+			Q_ASSERT(ok);
+		}
+		else
+		{
+			float min_cut_pos = qMin(start_len, end_len);
+			float max_cut_pos = qMax(start_len, end_len);
+			float path_len = drag_part.path_coords.back().clen;
+			if (min_cut_pos <= 0 && max_cut_pos >= path_len)
+			{
+				ok = out_paths[0]->connectIfClose(split_path, split_threshold);
+				Q_ASSERT(ok);
+				
+				out_paths[1] = new PathObject { *split_path };
+				out_paths[1]->setSymbol(area->getSymbol(), false);
+			}
+			else if (min_cut_pos <= 0 || max_cut_pos >= path_len)
+			{
+				float cut_pos = (min_cut_pos <= 0) ? max_cut_pos : min_cut_pos;
+				out_paths[1] = new PathObject { *out_paths[0] };
+				
+				out_paths[0]->changePathBounds(part_index, 0, cut_pos);
+				ok = out_paths[0]->connectIfClose(split_path, split_threshold);
+				Q_ASSERT(ok);
+				
+				out_paths[1]->changePathBounds(part_index, cut_pos, path_len);
+				ok = out_paths[1]->connectIfClose(split_path, split_threshold);
+				Q_ASSERT(ok);
+			}
+			else
+			{
+				out_paths[1] = new PathObject { *out_paths[0] };
+				PathObject* temp_path = new PathObject { *out_paths[0] };
+				
+				out_paths[0]->changePathBounds(part_index, min_cut_pos, max_cut_pos);
+				ok = out_paths[0]->connectIfClose(split_path, split_threshold);
+				Q_ASSERT(ok);
+				
+				out_paths[1]->changePathBounds(part_index, 0, min_cut_pos);
+				ok = out_paths[1]->connectIfClose(split_path, split_threshold);
+				Q_ASSERT(ok);
+				
+				temp_path->changePathBounds(part_index, max_cut_pos, path_len);
+				ok = out_paths[1]->connectIfClose(temp_path, split_threshold);
+				Q_ASSERT(ok);
+				
+				delete temp_path;
+			}
+		}
+		
+		if (holes)
+		{
+			for (auto&& object : out_paths)
+			{
+				BooleanTool hole_tool = { BooleanTool::Intersection, map };
+				BooleanTool::PathObjects out_objects;
+				for (auto&& hole : holes->parts())
+				{
+					out_objects.clear();
+					PathObject hole_object(hole);
+					hole_tool.executeForLine(object, &hole_object, out_objects);
+					for (auto&& new_hole : out_objects)
+						object->appendPathPart(new_hole->parts().front());
+				}
+			}
+			delete holes;
+		}
+		
+		return { out_paths[0], out_paths[1] };
+	}
+	
+	/**
+	 * Returns the pieces of splitting a line at all given intersections.
+	 * 
+	 * Returns an empty vector when the line is not changed, or when it has
+	 * got more than a single part (cf. PathObject::splitLineAt()).
+	 */
+	std::vector<PathObject*> splitLineAt(const PathObject* line, const PathObject::Intersections& intersections)
+	{
+		std::vector<PathObject*> pieces;
+		if (line->parts().size() != 1)
+			return pieces;
+		
+		const PathPart& part = line->parts().front();
+		const auto first_len = part.path_coords.front().clen;
+		const auto last_len  = part.path_coords.back().clen;
+		std::vector<PathCoord::length_type> positions;
+		for (const auto& intersection : intersections)
+		{
+			if (part.isClosed() || (intersection.length > first_len && intersection.length < last_len))
+				positions.push_back(intersection.length);
+		}
+		positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+		if (positions.empty())
+			return pieces;
+		
+		if (part.isClosed())
+		{
+			for (std::size_t i = 0; i < positions.size(); ++i)
+			{
+				PathObject* piece = line->duplicate()->asPath();
+				piece->changePathBounds(0, positions[i], positions[(i + 1) % positions.size()]);
+				pieces.push_back(piece);
+			}
+		}
+		else
+		{
+			positions.insert(positions.begin(), first_len);
+			positions.push_back(last_len);
+			for (std::size_t i = 1; i < positions.size(); ++i)
+			{
+				PathObject* piece = line->duplicate()->asPath();
+				piece->changePathBounds(0, positions[i-1], positions[i]);
+				pieces.push_back(piece);
+			}
+		}
+		return pieces;
+	}
+	
+	/**
+	 * An object to be cut along a straight line, and the resulting pieces.
+	 */
+	struct CutJob
+	{
+		PathObject* object;
+		std::vector<PathObject*> pieces;
+	};
+	
+	/**
+	 * Determines the pieces of cutting the job's object along the knife.
+	 * 
+	 * Lines are split at every intersection. Areas are split only if the
+	 * knife crosses their outer boundary exactly twice, and none of the holes.
+	 * This function does not access the map, and the objects must be up to
+	 * date, so that jobs can be executed concurrently.
+	 */
+	void executeCutJob(CutJob& job, const PathObject* knife, Map* map)
+	{
+		const PathObject* object = job.object;
+		PathObject::Intersections intersections;
+		object->calcAllIntersectionsWith(knife, intersections);
+		intersections.normalize();
+		if (intersections.empty())
+			return;
+		
+		if (!(object->getSymbol()->getContainedTypes() & Symbol::Area))
+		{
+			job.pieces = splitLineAt(object, intersections);
+			return;
+		}
+		
+		if (intersections.size() != 2 ||
+		    intersections[0].part_index != 0 ||
+		    intersections[1].part_index != 0 ||
+		    intersections[0].length == intersections[1].length)
+		{
+			return;
+		}
+		
+		PathObject split_path { object->getSymbol(), MapCoordVector { MapCoord(intersections[0].coord), MapCoord(intersections[1].coord) } };
+		job.pieces = splitArea(object, 0, intersections[0].length, intersections[1].length, &split_path, map);
+	}
+	
+	/**
+	 * Executes the jobs concurrently.
+	 */
+	void executeCutJobs(std::vector<CutJob>& jobs, const PathObject* knife, Map* map)
+	{
+		TaskPool::forEach(int(jobs.size()), 1, [&jobs, knife, map](int i) {
+			executeCutJob(jobs[i], knife, map);
+		});
+	}
 }
 
 
@@ -168,6 +387,10 @@ bool CutTool::mouseReleaseEvent(QMouseEvent* event, MapCoordF map_coord, MapWidg
 			Q_ASSERT(edit_object->getType() == Object::Path);
 			splitLine(edit_object, drag_part_index, drag_start_len, drag_end_len);
 		}
+		else if (map_coord != click_pos_map)
+		{
+			cutAlongLine(click_pos_map, map_coord);
+		}
 		
 		deletePreviewPath();
 		dragging = false;
@@ -226,12 +449,7 @@ void CutTool::draw(QPainter* painter, MapWidget* widget)
 {
 	Map* map = this->map();
 	map->drawSelection(painter, true, widget, nullptr);
-	for (const auto object: map->selectedObjects())
-	{
-		auto hover_point = MapCoordVector::size_type
-		                   { (hover_object == object) ? this->hover_point : std::numeric_limits<MapCoordVector::size_type>::max() };
-		pointHandles().draw(painter, widget, object, hover_point);
-	}
+	pointHandles().draw(painter, widget, map->selectedObjects(), hover_object, hover_point);
 	
 	if (preview_path)
 	{
@@ -273,7 +491,11 @@ void CutTool::updateDragging(MapCoordF cursor_pos_map, MapWidget* widget)
 {
 	Q_UNUSED(widget);
 	
-	if (dragging_on_line)
+	if (!dragging_on_line)
+	{
+		updateKnifePreview(cursor_pos_map);
+	}
+	else
 	{
 		PathCoord path_coord;
 		if (hover_state != EditTool::OverObjectNode)
@@ -436,6 +658,19 @@ void CutTool::updatePreviewObjects()
 	updateDirtyRect();
 }
 
+void CutTool::updateKnifePreview(MapCoordF cursor_pos_map)
+{
+	deletePreviewPath();
+	
+	const MapCoordVector knife_coords = { MapCoord(click_pos_map), MapCoord(cursor_pos_map) };
+	preview_path = new PathObject { Map::getCoveringCombinedLine(), knife_coords };
+	preview_path->update();
+	renderables->insertRenderablesOfObject(preview_path);
+	
+	QRectF rect = preview_path->getExtent();
+	updateDirtyRect(&rect);
+}
+
 void CutTool::deletePreviewPath()
 {
 	if (preview_path)
@@ -482,6 +717,8 @@ void CutTool::pathAborted()
 
 void CutTool::pathFinished(PathObject* split_path)
 {
+	MAPPER_TRACE_SCOPE("tool", "CutTool::pathFinished");
+	
 	Map* map = this->map();
 	
 	// Get path endpoint and check if it is on the area boundary
@@ -518,8 +755,6 @@ void CutTool::pathFinished(PathObject* split_path)
 	split_path->setCoordinate(split_path->getCoordinateCount() - 1, MapCoord(end_path_coord.pos));
 	
 	// Do the splitting
-	const double split_threshold = 0.01;
-	
 	MapPart* part = map->getCurrentPart();
 	AddObjectsUndoStep* add_step = new AddObjectsUndoStep(map);
 	add_step->addObject(part->findObjectIndex(edited_path), edited_path);
@@ -529,91 +764,8 @@ void CutTool::pathFinished(PathObject* split_path)
 	
 	DeleteObjectsUndoStep* delete_step = new DeleteObjectsUndoStep(map);
 	
-	PathObject* holes = nullptr; // if the edited path contains holes, they are saved in this temporary object
-	if (edited_path->parts().size() > 1)
-	{
-		holes = edited_path->duplicate()->asPath();
-		holes->deletePart(0);
-	}
-	
-	bool ok; Q_UNUSED(ok); // "ok" is only used in Q_ASSERT.
-	PathObject* out_paths[2] = { new PathObject { edited_path->parts().front() }, nullptr };
-	const PathPart& drag_part = edited_path->parts()[drag_part_index];
-	if (drag_part.isClosed())
+	for (auto&& object : splitArea(edited_path, drag_part_index, drag_start_len, end_path_coord.clen, split_path, map))
 	{
-		out_paths[1] = new PathObject { *out_paths[0] };
-		
-		out_paths[0]->changePathBounds(drag_part_index, drag_start_len, end_path_coord.clen);
-		ok = out_paths[0]->connectIfClose(split_path, split_threshold);
-		Q_ASSERT(ok);
-
-		out_paths[1]->changePathBounds(drag_part_index, end_path_coord.clen, drag_start_len);
-		ok = out_paths[1]->connectIfClose(split_path, split_threshold);
-		Q_ASSERT(ok);
-	}
-	else
-	{
-		float min_cut_pos = qMin(drag_start_len, end_path_coord.clen);
-		float max_cut_pos = qMax(drag_start_len, end_path_coord.clen);
-		float path_len = drag_part.path_coords.back().clen;
-		if (min_cut_pos <= 0 && max_cut_pos >= path_len)
-		{
-			ok = out_paths[0]->connectIfClose(split_path, split_threshold);
-			Q_ASSERT(ok);
-			
-			out_paths[1] = new PathObject { *split_path };
-			out_paths[1]->setSymbol(edited_path->getSymbol(), false);
-		}
-		else if (min_cut_pos <= 0 || max_cut_pos >= path_len)
-		{
-			float cut_pos = (min_cut_pos <= 0) ? max_cut_pos : min_cut_pos;
-			out_paths[1] = new PathObject { *out_paths[0] };
-			
-			out_paths[0]->changePathBounds(drag_part_index, 0, cut_pos);
-			ok = out_paths[0]->connectIfClose(split_path, split_threshold);
-			Q_ASSERT(ok);
-			
-			out_paths[1]->changePathBounds(drag_part_index, cut_pos, path_len);
-			ok = out_paths[1]->connectIfClose(split_path, split_threshold);
-			Q_ASSERT(ok);
-		}
-		else
-		{
-			out_paths[1] = new PathObject { *out_paths[0] };
-			PathObject* temp_path = new PathObject { *out_paths[0] };
-			
-			out_paths[0]->changePathBounds(drag_part_index, min_cut_pos, max_cut_pos);
-			ok = out_paths[0]->connectIfClose(split_path, split_threshold);
-			Q_ASSERT(ok);
-			
-			out_paths[1]->changePathBounds(drag_part_index, 0, min_cut_pos);
-			ok = out_paths[1]->connectIfClose(split_path, split_threshold);
-			Q_ASSERT(ok);
-			
-			temp_path->changePathBounds(drag_part_index, max_cut_pos, path_len);
-			ok = out_paths[1]->connectIfClose(temp_path, split_threshold);
-			Q_ASSERT(ok);
-			
-			delete temp_path;
-		}
-	}
-	
-	for (auto&& object : out_paths)
-	{
-		if (holes)
-		{
-			BooleanTool hole_tool = { BooleanTool::Intersection, map };
-			BooleanTool::PathObjects out_objects;
-			for (auto&& hole : holes->parts())
-			{
-				out_objects.clear();
-				PathObject hole_object(hole);
-				hole_tool.executeForLine(object, &hole_object, out_objects);
-				for (auto&& new_hole : out_objects)
-					object->appendPathPart(new_hole->parts().front());
-			}
-		}
-		
 		map->addObject(object);
 		delete_step->addObject(part->findObjectIndex(object));
 		map->addObjectToSelection(object, false);
@@ -670,9 +822,88 @@ void CutTool::replaceObject(PathObject* object, const std::vector<PathObject*>&
 	map->emitSelectionChanged();
 }
 
+void CutTool::cutAlongLine(MapCoordF start, MapCoordF end)
+{
+	Map* map = this->map();
+	MapPart* part = map->getCurrentPart();
+	
+	const MapCoordVector knife_coords = { MapCoord(start), MapCoord(end) };
+	PathObject knife { Map::getCoveringCombinedLine(), knife_coords };
+	knife.update();
+	
+	std::vector<Object*> candidates;
+	part->findObjectsAtBox(start, end, false, false, candidates);
+	
+	std::vector<CutJob> jobs;
+	jobs.reserve(candidates.size());
+	for (Object* object : candidates)
+	{
+		if (object->getType() != Object::Path ||
+		    !(object->getSymbol()->getContainedTypes() & (Symbol::Line | Symbol::Area)) ||
+		    !map->isObjectSelected(object))
+		{
+			continue;
+		}
+		
+		// The jobs must not modify the objects concurrently.
+		object->update();
+		jobs.push_back({ object->asPath(), {} });
+	}
+	
+	executeCutJobs(jobs, &knife, map);
+	
+	// A single lookup table instead of searching the part for every object
+	QHash<const Object*, int> object_index;
+	object_index.reserve(part->getNumObjects());
+	for (int i = 0, count = part->getNumObjects(); i < count; ++i)
+		object_index.insert(part->getObject(i), i);
+	
+	// Add original objects to undo step, and remove them from map.
+	QScopedPointer<AddObjectsUndoStep> add_step(new AddObjectsUndoStep(map));
+	std::vector<int> removed_indices;
+	for (const CutJob& job : jobs)
+	{
+		if (job.pieces.empty())
+			continue;
+		
+		const int index = object_index.value(job.object, -1);
+		Q_ASSERT(index >= 0);
+		add_step->addObject(index, job.object);
+		removed_indices.push_back(index);
+		map->removeObjectFromSelection(job.object, false);
+	}
+	if (removed_indices.empty())
+		return;
+	
+	part->deleteObjects(removed_indices, true);
+	
+	// Add the pieces to map, and create delete step for them
+	QScopedPointer<DeleteObjectsUndoStep> delete_step(new DeleteObjectsUndoStep(map));
+	for (const CutJob& job : jobs)
+	{
+		if (job.pieces.empty())
+			continue;
+		
+		job.object->setMap(map); // necessary so objects are saved correctly
+		for (PathObject* piece : job.pieces)
+		{
+			delete_step->addObject(map->addObject(piece));
+			map->addObjectToSelection(piece, false);
+		}
+	}
+	
+	CombinedUndoStep* undo_step = new CombinedUndoStep(map);
+	undo_step->push(add_step.take());
+	undo_step->push(delete_step.take());
+	map->push(undo_step);
+	map->setObjectsDirty();
+	
+	map->emitSelectionChanged();
+}
+
 void CutTool::updateStatusText()
 {
-	setStatusBarText(tr("<b>Click</b> on a line: Split it into two. <b>Drag</b> along a line: Remove this line part. <b>Click or Drag</b> at an area boundary: Start a split line. "));
+	setStatusBarText(tr("<b>Click</b> on a line: Split it into two. <b>Drag</b> along a line: Remove this line part. <b>Click or Drag</b> at an area boundary: Start a split line. <b>Drag</b> elsewhere: Cut the selected objects along a straight line. "));
 }
 
 void CutTool::startCuttingArea(const PathCoord& coord, MapWidget* widget)
@@ -97,8 +97,19 @@ protected:
 	 */
 	void replaceObject(PathObject* object, const std::vector<PathObject*>& replacement) const;
 	
+	/**
+	 * Cuts all selected lines and areas which are crossed by the straight
+	 * line from start to end.
+	 * 
+	 * Candidates are taken from the map part's spatial index, and the pieces
+	 * are computed concurrently. All changes are recorded in a single undo
+	 * step.
+	 */
+	void cutAlongLine(MapCoordF start, MapCoordF end);
+	
 	void updateStatusText();
 	void updatePreviewObjects();
+	void updateKnifePreview(MapCoordF cursor_pos_map);
 	void deletePreviewPath();
 	void updateDirtyRect(const QRectF* path_rect = nullptr) const;
 	void updateDragging(MapCoordF cursor_pos_map, MapWidget* widget);
@@ -25,6 +25,7 @@
 #include <QMouseEvent>
 #include <QMessageBox>
 
+#include "core/tracing.h"
 #include "map.h"
 #include "object_undo.h"
 #include "map_widget.h"
@@ -194,6 +195,8 @@ void CutHoleTool::pathAborted()
 
 void CutHoleTool::pathFinished(PathObject* hole_path)
 {
+	MAPPER_TRACE_SCOPE("tool", "CutHoleTool::pathFinished");
+	
 	if (map()->getNumSelectedObjects() == 0)
 	{
 		pathAborted();
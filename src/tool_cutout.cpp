@@ -21,8 +21,13 @@
 
 #include "tool_cutout.h"
 
+#include <algorithm>
+#include <unordered_set>
+
 #include <QKeyEvent>
 
+#include "core/task_pool.h"
+#include "core/tracing.h"
 #include "object.h"
 #include "map.h"
 #include "map_widget.h"
@@ -171,135 +176,194 @@ void CutoutTool::dragFinish()
 }
 
 
-struct PhysicalCutoutOperation
+namespace
 {
-	inline PhysicalCutoutOperation(Map* map, PathObject* cutout_object, bool cut_away)
-	: map(map), cutout_object(cutout_object), cut_away(cut_away)
+	/**
+	 * The result of clipping a single object which touches the cutout's extent.
+	 */
+	struct CutoutJob
 	{
-		add_step = new AddObjectsUndoStep(map);
-		delete_step = new DeleteObjectsUndoStep(map);
-	}
+		Object* object;
+		bool remove;
+		BooleanTool::PathObjects new_objects;
+	};
 	
-	inline bool operator()(Object* object, MapPart* part, int object_index)
+	/**
+	 * Classifies a single object against the cutout, and clips it if needed.
+	 * 
+	 * This must not modify the map. The cutout object and the job's object
+	 * must be up to date, so that concurrent jobs need not update them.
+	 */
+	void runCutoutJob(Map* map, PathObject* cutout_object, bool cut_away, CutoutJob& job)
 	{
-		Q_UNUSED(part);
-		Q_UNUSED(object_index);
-		
-		// If there is a selection, only clip selected objects
-		if (map->getNumSelectedObjects() > 0 && !map->isObjectSelected(object))
-			return true;
-		// Don't clip object itself
-		if (object == cutout_object)
-			return true;
-		
-		// Early out
-		if (!object->getExtent().intersects(cutout_object->getExtent()))
-		{
-			if (!cut_away)
-				add_step->addObject(object, object);
-			return true;
-		}
+		Object* const object = job.object;
+		job.remove = false;
 		
 		if (object->getType() == Object::Point ||
 			object->getType() == Object::Text)
 		{
 			// Simple check if the (first) point is inside the area
-			if (cutout_object->isPointInsideArea(MapCoordF(object->getRawCoordinateVector().at(0))) == cut_away)
-				add_step->addObject(object, object);
+			job.remove = cutout_object->isPointInsideArea(MapCoordF(object->getRawCoordinateVector().at(0))) == cut_away;
 		}
 		else if (object->getType() == Object::Path)
 		{
+			BooleanTool boolean_tool(cut_away ? BooleanTool::Difference : BooleanTool::Intersection, map);
 			if (object->getSymbol()->getContainedTypes() & Symbol::Area)
 			{
 				// Use the Clipper library to clip the area
-				BooleanTool boolean_tool(cut_away ? BooleanTool::Difference : BooleanTool::Intersection, map);
 				BooleanTool::PathObjects in_objects;
 				in_objects.push_back(cutout_object);
 				in_objects.push_back(object->asPath());
-				BooleanTool::PathObjects out_objects;
-				if (!boolean_tool.executeForObjects(object->asPath(), in_objects, out_objects))
-					return true;
-				
-				add_step->addObject(object, object);
-				new_objects.insert(new_objects.end(), out_objects.begin(), out_objects.end());
+				job.remove = boolean_tool.executeForObjects(object->asPath(), in_objects, job.new_objects);
 			}
 			else
 			{
 				// Use some custom code to clip the line
-				BooleanTool boolean_tool(cut_away ? BooleanTool::Difference : BooleanTool::Intersection, map);
-				BooleanTool::PathObjects out_objects;
-				boolean_tool.executeForLine(cutout_object, object->asPath(), out_objects);
-				
-				add_step->addObject(object, object);
-				new_objects.insert(new_objects.end(), out_objects.begin(), out_objects.end());
+				boolean_tool.executeForLine(cutout_object, object->asPath(), job.new_objects);
+				job.remove = true;
 			}
 		}
-		
-		return true;
 	}
 	
-	UndoStep* finish()
+	
+	/**
+	 * Combines the results of the cutout jobs in the map and in undo steps.
+	 */
+	struct PhysicalCutoutOperation
 	{
-		MapPart* part = map->getCurrentPart();
+		inline PhysicalCutoutOperation(Map* map)
+		: map(map)
+		{
+			add_step = new AddObjectsUndoStep(map);
+			delete_step = new DeleteObjectsUndoStep(map);
+		}
 		
-		map->clearObjectSelection(false);
-		add_step->removeContainedObjects(false);
-		for (size_t i = 0; i < new_objects.size(); ++i)
+		void removeObject(Object* object)
 		{
-			Object* object = new_objects[i];
-			map->addObject(object);
+			add_step->addObject(object, object);
 		}
-		// Do not merge this loop into the upper one;
-		// theoretically undo step indices could be wrong this way.
-		for (size_t i = 0; i < new_objects.size(); ++i)
+		
+		void addObjects(const BooleanTool::PathObjects& objects)
 		{
-			Object* object = new_objects[i];
-			delete_step->addObject(part->findObjectIndex(object));
+			new_objects.insert(new_objects.end(), objects.begin(), objects.end());
 		}
-		map->emitSelectionChanged();
 		
-		// Return undo step
-		if (delete_step->isEmpty())
+		UndoStep* finish()
 		{
-			delete delete_step;
-			if (add_step->isEmpty())
+			MapPart* part = map->getCurrentPart();
+		
+			map->clearObjectSelection(false);
+			add_step->removeContainedObjects(false);
+			for (size_t i = 0; i < new_objects.size(); ++i)
 			{
-				delete add_step;
-				return NULL;
+				Object* object = new_objects[i];
+				map->addObject(object);
 			}
-			else
-				return add_step;
-		}
-		else
-		{
-			if (add_step->isEmpty())
+			// Do not merge this loop into the upper one;
+			// theoretically undo step indices could be wrong this way.
+			for (size_t i = 0; i < new_objects.size(); ++i)
+			{
+				Object* object = new_objects[i];
+				delete_step->addObject(part->findObjectIndex(object));
+			}
+			map->emitSelectionChanged();
+		
+			// Return undo step
+			if (delete_step->isEmpty())
 			{
-				delete add_step;
-				return delete_step;	
+				delete delete_step;
+				if (add_step->isEmpty())
+				{
+					delete add_step;
+					return NULL;
+				}
+				else
+					return add_step;
 			}
 			else
 			{
-				CombinedUndoStep* combined_step = new CombinedUndoStep(map);
-				combined_step->push(add_step);
-				combined_step->push(delete_step);
-				return combined_step;
+				if (add_step->isEmpty())
+				{
+					delete add_step;
+					return delete_step;	
+				}
+				else
+				{
+					CombinedUndoStep* combined_step = new CombinedUndoStep(map);
+					combined_step->push(add_step);
+					combined_step->push(delete_step);
+					return combined_step;
+				}
 			}
 		}
-	}
-private:
-	Map* map;
-	PathObject* cutout_object;
-	bool cut_away;
-	
-	std::vector<PathObject*> new_objects;
-	AddObjectsUndoStep* add_step;
-	DeleteObjectsUndoStep* delete_step;
-};
+	private:
+		Map* map;
+		
+		std::vector<PathObject*> new_objects;
+		AddObjectsUndoStep* add_step;
+		DeleteObjectsUndoStep* delete_step;
+	};
+}
 
 void CutoutTool::apply(Map* map, PathObject* cutout_object, bool cut_away)
 {
-	PhysicalCutoutOperation operation(map, cutout_object, cut_away);
-	map->getCurrentPart()->applyOnAllObjects(operation);
+	MAPPER_TRACE_SCOPE("tool", "CutoutTool::apply");
+	
+	MapPart* part = map->getCurrentPart();
+	
+	// The jobs must not update the objects concurrently.
+	map->updateObjects();
+	cutout_object->update();
+	
+	// If there is a selection, only clip selected objects.
+	const bool selection_only = map->getNumSelectedObjects() > 0;
+	auto is_affected = [map, cutout_object, selection_only](Object* object) {
+		return object != cutout_object
+		       && (!selection_only || map->isObjectSelected(object));
+	};
+	
+	// Only the objects which touch the cutout's extent need to be clipped.
+	std::vector<Object*> candidates;
+	part->findObjectsInRect(cutout_object->getExtent(), candidates);
+	
+	std::vector<CutoutJob> jobs;
+	jobs.reserve(candidates.size());
+	for (Object* object : candidates)
+	{
+		if (is_affected(object))
+			jobs.push_back({ object, false, {} });
+	}
+	
+	// Keep the order of the objects independent of the spatial index.
+	std::sort(begin(jobs), end(jobs), [part](const CutoutJob& a, const CutoutJob& b) {
+		return part->findObjectIndex(a.object) > part->findObjectIndex(b.object);
+	});
+	
+	TaskPool::forEach(int(jobs.size()), 1, [map, cutout_object, cut_away, &jobs](int i) {
+		runCutoutJob(map, cutout_object, cut_away, jobs[std::size_t(i)]);
+	});
+	
+	PhysicalCutoutOperation operation(map);
+	if (!cut_away)
+	{
+		// Objects outside of the cutout's extent are removed.
+		std::unordered_set<const Object*> touching(begin(candidates), end(candidates));
+		for (int i = part->getNumObjects() - 1; i >= 0; --i)
+		{
+			Object* object = part->getObject(i);
+			if (!touching.count(object) && is_affected(object))
+				operation.removeObject(object);
+		}
+	}
+	for (const CutoutJob& job : jobs)
+	{
+		if (job.remove)
+		{
+			operation.removeObject(job.object);
+			operation.addObjects(job.new_objects);
+		}
+	}
+	
 	UndoStep* undo_step = operation.finish();
 	if (undo_step)
 	{
@@ -21,6 +21,8 @@
 
 #include "tool_draw_freehand.h"
 
+#include <cstddef>
+
 #include <QKeyEvent>
 #include <QMouseEvent>
 
@@ -32,6 +34,35 @@
 #include "map_editor.h"
 
 
+namespace
+{
+	/** The maximum distance of removed samples from the simplified path, squared. */
+	const float split_distance_sq = 0.09f*0.09f;
+	
+	/** The number of samples after which a tail is fixed, limiting the work per sample. */
+	const std::size_t max_tail_size = 100;
+	
+	/** Returns the squared distance of coord from the segment from start to end. */
+	float distanceSquaredToSegment(MapCoordF coord, MapCoordF start, MapCoordF end)
+	{
+		MapCoordF to_coord = coord - start;
+		MapCoordF tangent = end - start;
+		tangent.normalize();
+		
+		float dist_along_line = MapCoordF::dotProduct(to_coord, tangent);
+		if (dist_along_line <= 0)
+			return to_coord.lengthSquared();
+		
+		float line_length = end.distanceTo(start);
+		if (dist_along_line >= line_length)
+			return coord.distanceSquaredTo(end);
+		
+		float distance = qAbs(MapCoordF::dotProduct(tangent.perpRight(), to_coord));
+		return distance * distance;
+	}
+}
+
+
 DrawFreehandTool::DrawFreehandTool(MapEditorController* editor, QAction* tool_button, bool is_helper_tool)
 : DrawLineAndAreaTool(editor, DrawFreehand, tool_button, is_helper_tool)
 {
@@ -178,43 +209,16 @@ void DrawFreehandTool::checkLineSegment(int a, int b, std::vector< bool >& point
 	if (b <= a + 1)
 		return;
 	
-	const MapCoord& start_coord = preview_path->getRawCoordinateVector()[a];
-	const MapCoord& end_coord = preview_path->getRawCoordinateVector()[b];
+	const MapCoordF start_coord = MapCoordF(preview_path->getRawCoordinateVector()[a]);
+	const MapCoordF end_coord = MapCoordF(preview_path->getRawCoordinateVector()[b]);
 	
 	// Find point between a and b with highest distance from line segment
 	float max_distance_sq = -1;
 	int best_index = a + 1;
 	for (int i = a + 1; i < b; ++ i)
 	{
-		const MapCoord& coord = preview_path->getRawCoordinateVector()[i];
-		
-		MapCoordF to_coord = MapCoordF(coord.x() - start_coord.x(), coord.y() - start_coord.y());
-		MapCoordF to_next = MapCoordF(end_coord.x() - start_coord.x(), end_coord.y() - start_coord.y());
-		MapCoordF tangent = to_next;
-		tangent.normalize();
-		
-		float distance_sq;
-		
-		float dist_along_line = MapCoordF::dotProduct(to_coord, tangent);
-		if (dist_along_line <= 0)
-		{
-			distance_sq = to_coord.lengthSquared();
-		}
-		else
-		{
-			float line_length = MapCoordF(end_coord).distanceTo(MapCoordF(start_coord));
-			if (dist_along_line >= line_length)
-			{
-				distance_sq = MapCoordF(coord).distanceSquaredTo(MapCoordF(end_coord));
-			}
-			else
-			{
-				auto right = tangent.perpRight();
-				distance_sq = qAbs(MapCoordF::dotProduct(right, to_coord));
-				distance_sq = distance_sq*distance_sq;
-			}
-		}
-		
+		const MapCoordF coord = MapCoordF(preview_path->getRawCoordinateVector()[i]);
+		float distance_sq = distanceSquaredToSegment(coord, start_coord, end_coord);
 		if (distance_sq > max_distance_sq)
 		{
 			max_distance_sq = distance_sq;
@@ -223,8 +227,6 @@ void DrawFreehandTool::checkLineSegment(int a, int b, std::vector< bool >& point
 	}
 	
 	// Make new segment?
-	const float split_distance_sq = 0.09f*0.09f;
-	
 	if (max_distance_sq > split_distance_sq)
 	{
 		point_mask[best_index] = true;
@@ -241,12 +243,26 @@ void DrawFreehandTool::updatePath()
 	{
 		preview_path->clearCoordinates();
 		preview_path->addCoordinate(MapCoord(cur_pos_map));
+		tail.clear();
 	}
 	else
 	{
 		if (last_pos_map.distanceSquaredTo(cur_pos_map) < length_threshold_sq)
 			return;
-		preview_path->addCoordinate(MapCoord(cur_pos_map));
+		
+		auto last = preview_path->getCoordinateCount() - 1;
+		if (last > 0 && tail.size() < max_tail_size && tailFitsSegment(cur_pos_map))
+		{
+			// The last coordinate moves on, and its old position joins the tail.
+			tail.push_back(MapCoordF(preview_path->getCoordinate(last)));
+			preview_path->setCoordinate(last, MapCoord(cur_pos_map));
+		}
+		else
+		{
+			// The last coordinate is fixed.
+			tail.clear();
+			preview_path->addCoordinate(MapCoord(cur_pos_map));
+		}
 	}
 	last_pos_map = cur_pos_map;
 	
@@ -254,6 +270,22 @@ void DrawFreehandTool::updatePath()
 	setDirtyRect();
 }
 
+bool DrawFreehandTool::tailFitsSegment(MapCoordF end) const
+{
+	auto count = preview_path->getCoordinateCount();
+	const MapCoordF start = MapCoordF(preview_path->getCoordinate(count - 2));
+	const MapCoordF last = MapCoordF(preview_path->getCoordinate(count - 1));
+	if (distanceSquaredToSegment(last, start, end) > split_distance_sq)
+		return false;
+	
+	for (const MapCoordF& coord : tail)
+	{
+		if (distanceSquaredToSegment(coord, start, end) > split_distance_sq)
+			return false;
+	}
+	return true;
+}
+
 void DrawFreehandTool::setDirtyRect()
 {
 	QRectF rect;
@@ -53,6 +53,21 @@ protected:
 	
 	void checkLineSegment(int a, int b, std::vector<bool>& point_mask);
 	
+	/**
+	 * Returns true if all samples in tail are close enough to the straight
+	 * segment from the path's second-last coordinate to the given end.
+	 */
+	bool tailFitsSegment(MapCoordF end) const;
+	
+	/**
+	 * The samples between the path's last two coordinates.
+	 * 
+	 * While dragging, the last coordinate of the path follows the pointer.
+	 * The samples which it has passed are kept here, so that the path is
+	 * simplified during drawing and the preview stays small.
+	 */
+	std::vector<MapCoordF> tail;
+	
 	QPoint click_pos;
 	MapCoordF last_pos_map;
 	QPoint cur_pos;
@@ -967,11 +967,7 @@ void DrawPathTool::startFollowing(SnappingToolHelperSnapInfo& snap_info, const M
 
 void DrawPathTool::updateFollowing()
 {
-	PathCoord path_coord;
-	float distance_sq;
-	const auto& part = follow_object->parts()[follow_helper->getPartIndex()];
-	follow_object->calcClosestPointOnPath(cur_pos_map, distance_sq, path_coord, part.first_index, part.last_index);
-	auto followed_path = follow_helper->updateFollowing(path_coord);
+	auto followed_path = follow_helper->updateFollowing(cur_pos_map);
 	
 	// Append the temporary object to the preview object at follow_start_index
 	// 1. Delete everything appended, except for the point where following started
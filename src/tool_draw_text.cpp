@@ -272,9 +272,15 @@ void DrawTextTool::setDrawingSymbol(const Symbol* symbol)
 
 void DrawTextTool::selectionChanged(bool text_change)
 {
-	Q_UNUSED(text_change);
-	preview_text->setOutputDirty(); // TODO: Check if neccessary here.
-	updatePreviewText();
+	if (text_change)
+	{
+		preview_text->setOutputDirty(); // TODO: Check if neccessary here.
+		updatePreviewText();
+	}
+	else
+	{
+		updateDirtyRect();
+	}
 }
 
 void DrawTextTool::updateDirtyRect()
@@ -148,14 +148,28 @@ bool ObjectSelector::selectBox(MapCoordF corner1, MapCoordF corner2, bool toggle
 		map->clearObjectSelection(false);
 	}
 	
-	int size = objects.size();
-	for (int i = 0; i < size; ++i)
+	if (toggle)
 	{
-		if (toggle)
-			map->toggleObjectSelection(objects[i], i == size - 1);
-		else
-			map->addObjectToSelection(objects[i], i == size - 1);
-			
+		std::vector<Object*> selected_objects;
+		std::vector<Object*> unselected_objects;
+		for (Object* object : objects)
+		{
+			if (map->isObjectSelected(object))
+				selected_objects.push_back(object);
+			else
+				unselected_objects.push_back(object);
+		}
+		map->removeObjectsFromSelection(selected_objects, false);
+		map->addObjectsToSelection(unselected_objects, false);
+	}
+	else
+	{
+		map->addObjectsToSelection(objects, false);
+	}
+	
+	if (!objects.empty())
+	{
+		map->emitSelectionChanged();
 		selection_changed = true;
 	}
 	
@@ -333,6 +333,9 @@ void EditPointTool::dragStart()
 		startEditing();
 		startEditingSetup();
 		
+		// Simplified symbols while dragging, full symbols on release
+		preview_renderable_options = Symbol::RenderPreview;
+		
 		if (active_modifiers & Qt::ControlModifier)
 			activateAngleHelperWhileEditing();
 		if (active_modifiers & Qt::ShiftModifier)
@@ -569,12 +572,8 @@ void EditPointTool::drawImpl(QPainter* painter, MapWidget* widget)
 			
 			if (num_selected_objects <= max_objects_for_handle_display)
 			{
-				for (const auto object: map()->selectedObjects())
-				{
-					auto active = hover_state.testFlag(OverObjectNode) && hover_object == object;
-					auto hover_point = active ? this->hover_point : no_point;
-					pointHandles().draw(painter, widget, object, hover_point, true, PointHandles::NormalHandleState);
-				}
+				auto active_object = hover_state.testFlag(OverObjectNode) ? hover_object : nullptr;
+				pointHandles().draw(painter, widget, map()->selectedObjects(), active_object, hover_point, true, PointHandles::NormalHandleState);
 			}
 		}
 	}
@@ -595,8 +594,11 @@ void EditPointTool::drawImpl(QPainter* painter, MapWidget* widget)
 
 void EditPointTool::textSelectionChanged(bool text_change)
 {
-	Q_UNUSED(text_change);
-	updatePreviewObjects();
+	// The renderables are updated once for a burst of key strokes,
+	// while the cursor and the selection are redrawn immediately.
+	if (text_change)
+		updatePreviewObjectsAsynchronously();
+	updateDirtyRect();
 }
 
 void EditPointTool::finishEditing()
@@ -22,6 +22,7 @@
 #include "tool_fill.h"
 
 #include <limits>
+#include <memory>
 
 #include <QMessageBox>
 #include <QLabel>
@@ -220,34 +221,13 @@ QImage FillTool::rasterizeMap(const QRectF& extent, QTransform& out_transform)
 	painter.translate(image_size.width() / 2.0, image_size.height() / 2.0);
 	painter.setWorldTransform(view->worldTransform(), true);
 	
-	auto original_area_hatching = map()->isAreaHatchingEnabled();
-	if (original_area_hatching)
-	{
-		map()->setAreaHatchingEnabled(false);
-	}
-	
-	if (!map()->isBaselineViewEnabled())
-	{
-		// Temporarily enable baseline view and draw map once.
-		map()->setBaselineViewEnabled(true);
-		map()->updateAllObjects();
-		drawObjectIDs(map(), &painter, config);
-		map()->setBaselineViewEnabled(false);
-		map()->updateAllObjects();
-	}
-	else if (original_area_hatching)
-	{
-		map()->updateAllObjects();
-	}
-	
-	// Draw the map in original mode (but without area hatching)
-	drawObjectIDs(map(), &painter, config);
-	
-	if (original_area_hatching)
-	{
-		map()->setAreaHatchingEnabled(original_area_hatching);
-		map()->updateAllObjects();
-	}
+	// Draw baselines first, unless the map is already in baseline view,
+	// then draw the map in original mode (but without area hatching).
+	// The map's own renderables are not rebuilt for this.
+	const Symbol::RenderableOptions map_options = QFlag(map()->renderableOptions());
+	if (!map_options.testFlag(Symbol::RenderBaselines))
+		drawObjectIDs(map(), &painter, config, Symbol::RenderBaselines);
+	drawObjectIDs(map(), &painter, config, map_options & ~Symbol::RenderAreasHatched);
 	
 	out_transform = painter.combinedTransform();
 	painter.end();
@@ -255,8 +235,14 @@ QImage FillTool::rasterizeMap(const QRectF& extent, QTransform& out_transform)
 	return image;
 }
 
-void FillTool::drawObjectIDs(Map* map, QPainter* painter, const RenderConfig &config)
+void FillTool::drawObjectIDs(Map* map, QPainter* painter, const RenderConfig &config, Symbol::RenderableOptions options)
 {
+	const Symbol::RenderableOptions map_options = QFlag(map->renderableOptions());
+	// The normal renderables do not contain the area hatching.
+	const bool use_map_renderables = (options == (map_options & ~Symbol::RenderAreasHatched))
+	                                 && !map_options.testFlag(Symbol::RenderBaselines);
+	const bool use_baseline_renderables = (options == Symbol::RenderBaselines && !map_options.testFlag(Symbol::RenderAreasHatched));
+	
 	MapPart* part = map->getCurrentPart();
 	for (int o = 0, num_objects = part->getNumObjects(); o < num_objects; ++o)
 	{
@@ -267,11 +253,24 @@ void FillTool::drawObjectIDs(Map* map, QPainter* painter, const RenderConfig &co
 			continue;
 		
 		object->update();
-		object->renderables().draw(
-			qRgb(o % 256, (o / 256) % 256, (o / (256 * 256)) % 256),
-			painter,
-			config
-		);
+		if (!object->getExtent().intersects(config.bounding_box))
+			continue;
+		
+		const QColor color = qRgb(o % 256, (o / 256) % 256, (o / (256 * 256)) % 256);
+		if (use_map_renderables)
+		{
+			object->renderables().draw(color, painter, config);
+		}
+		else if (use_baseline_renderables)
+		{
+			object->baselineRenderables().draw(color, painter, config);
+		}
+		else
+		{
+			std::unique_ptr<Object> temp_object(object->duplicate());
+			temp_object->updateRenderables(options);
+			temp_object->renderables().draw(color, painter, config);
+		}
 	}
 }
 
@@ -23,6 +23,7 @@
 #define _OPENORIENTEERING_TOOL_FILL_H_
 
 #include "tool_base.h"
+#include "symbol.h"
 
 class MapView;
 class PathObject;
@@ -76,8 +77,14 @@ protected:
 	
 	/**
 	 * Helper method for rasterizeMap().
+	 * 
+	 * Draws the path objects of the current map part which intersect the
+	 * config's bounding box, as rendered with the given options. The objects'
+	 * current or baseline renderables are used where they match the options.
+	 * Otherwise the renderables are created for temporary copies of the
+	 * objects, so that the map's renderables are left untouched.
 	 */
-	void drawObjectIDs(Map* map, QPainter* painter, const RenderConfig& config);
+	void drawObjectIDs(Map* map, QPainter* painter, const RenderConfig& config, Symbol::RenderableOptions options);
 	
 	/**
 	 * Traces the boundary around an "island" in the given image, starting from the
@@ -21,6 +21,8 @@
 
 #include "tool_helpers.h"
 
+#include <limits>
+
 #include <qmath.h>
 #include <QApplication>
 #include <QKeyEvent>
@@ -168,8 +170,7 @@ bool TextObjectEditorHelper::keyPressEvent(QKeyEvent* event)
 			--selection_end;
 			--selection_start;
 		}
-		object->setText(text);
-		emit(selectionChanged(true));
+		setText(text);
 	}
 	else if (event->key() == Qt::Key_Delete)
 	{
@@ -184,8 +185,7 @@ bool TextObjectEditorHelper::keyPressEvent(QKeyEvent* event)
 		}
 		else
 			text.remove(selection_start, 1);
-		object->setText(text);
-		emit(selectionChanged(true));
+		setText(text);
 	}
 	else if (event->matches(QKeySequence::MoveToPreviousChar) || event->matches(QKeySequence::SelectPreviousChar))
 	{
@@ -370,7 +370,8 @@ void TextObjectEditorHelper::alignmentChanged(int horz, int vert)
 {
 	object->setHorizontalAlignment((TextObject::HorizontalAlignment)horz);
 	object->setVerticalAlignment((TextObject::VerticalAlignment)vert);
-	emit(selectionChanged(false));
+	object->prepareLineInfos();
+	emit(selectionChanged(true));
 }
 
 void TextObjectEditorHelper::insertText(QString insertion)
@@ -381,7 +382,16 @@ void TextObjectEditorHelper::insertText(QString insertion)
 	selection_start += insertion.length();
 	selection_end = selection_start;
 	
+	setText(text);
+}
+void TextObjectEditorHelper::setText(const QString& text)
+{
 	object->setText(text);
+	
+	// The selection is drawn from the layout, so it must be up to date now.
+	// This is an incremental update, for the changed paragraph only.
+	// The renderables may be updated later.
+	object->prepareLineInfos();
 	emit(selectionChanged(true));
 }
 void TextObjectEditorHelper::updateDragging(MapCoordF map_coord)
@@ -676,6 +686,7 @@ SnappingToolHelper::SnappingToolHelper(MapEditorTool* tool, SnapObjects filter)
    filter(filter),
    snapped_type(NoSnapping),
    map(tool->map()),
+   snap_candidates_revision(0),
    point_handles(tool->scaleFactor())
 {
 }
@@ -709,15 +720,15 @@ MapCoord SnappingToolHelper::snapToObject(MapCoordF position, MapWidget* widget,
 	if (filter & (ObjectCorners | ObjectPaths))
 	{
 		// Find map objects at the given position
-		SelectionInfoVector objects;
-		map->findAllObjectsAt(position, snap_distance, true, false, false, true, objects);
+		updateSnapCandidates(position, snap_distance);
 		
 		// Find closest snap spot from map objects
-		for (SelectionInfoVector::const_iterator it = objects.begin(), end = objects.end(); it != end; ++it)
+		for (Object* object : snap_candidates)
 		{
-			Object* object = it->second;
 			if (object == exclude_object)
 				continue;
+			if (object->isPointOnObject(position, snap_distance, true, false) == Symbol::NoSymbol)
+				continue;
 			
 			float distance_sq;
 			if (object->getType() == Object::Point && filter & ObjectCorners)
@@ -809,6 +820,24 @@ MapCoord SnappingToolHelper::snapToObject(MapCoordF position, MapWidget* widget,
 	return result_position;
 }
 
+void SnappingToolHelper::updateSnapCandidates(MapCoordF position, float snap_distance)
+{
+	// Cf. MapPart::findObjectsAt(): Point objects are tested against the squared distance.
+	const qreal margin = qMax(qreal(snap_distance), qSqrt(qreal(snap_distance)));
+	const QRectF needed_rect(position.x() - margin, position.y() - margin, 2 * margin, 2 * margin);
+	
+	// Apply pending object updates before checking the revision.
+	map->updateObjects();
+	if (snap_candidates_revision == map->getObjectsRevision() && snap_candidates_rect.contains(needed_rect))
+		return;
+	
+	const qreal search_margin = 4 * margin;
+	snap_candidates_rect = needed_rect.adjusted(-search_margin, -search_margin, search_margin, search_margin);
+	snap_candidates.clear();
+	map->findAllObjectsAtBox(MapCoordF(snap_candidates_rect.topLeft()), MapCoordF(snap_candidates_rect.bottomRight()), false, true, snap_candidates);
+	snap_candidates_revision = map->getObjectsRevision();
+}
+
 bool SnappingToolHelper::snapToDirection(MapCoordF position, MapWidget* widget, ConstrainAngleToolHelper* angle_tool, MapCoord* out_snap_position)
 {
 	// As getting a direction from the map grid is not supported, remove grid from filter
@@ -950,19 +979,39 @@ std::unique_ptr<PathObject> FollowPathToolHelper::updateFollowing(const PathCoor
 		end_clen = new_end_clen;
 		if (end_clen != start_clen)
 		{
-			// Create output path
-			result.reset(new PathObject { part });
+			// Create output path, copying only the followed range
+			MapCoordVector coords;
 			if (drag_forward)
-			{
-				result->changePathBounds(0, start_clen, end_clen);
-			}
+				part.copyRange(start_clen, end_clen, coords);
 			else
-			{
-				result->changePathBounds(0, end_clen, start_clen);
+				part.copyRange(end_clen, start_clen, coords);
+			
+			result.reset(new PathObject { path->getSymbol(), std::move(coords) });
+			if (!drag_forward)
 				result->reverse();
-			}
 		}
 	}
 	
 	return result;
 }
+
+std::unique_ptr<PathObject> FollowPathToolHelper::updateFollowing(const MapCoordF& pos)
+{
+	if (!path)
+		return {};
+	
+	path->update();
+	const auto& part = path->parts()[part_index];
+	
+	// The previous end of the range is on the part, so the closest point
+	// cannot be farther away. The margin covers rounding errors.
+	auto end = SplitPathCoord::at(end_clen, SplitPathCoord::begin(part.path_coords));
+	auto bound = float(pos.distanceSquaredTo(end.pos)) * 1.001f + 1e-6f;
+	
+	float distance_sq;
+	auto path_coord = part.findClosestPointTo(pos, distance_sq, bound, part.first_index, part.last_index);
+	if (distance_sq >= bound)
+		path_coord = part.findClosestPointTo(pos, distance_sq, std::numeric_limits<float>::max(), part.first_index, part.last_index);
+	
+	return updateFollowing(path_coord);
+}
@@ -24,6 +24,7 @@
 
 #include <memory>
 #include <set>
+#include <vector>
 
 #include <QCursor>
 #include <QObject>
@@ -79,11 +80,18 @@ public slots:
 	void setFocus();
 	
 signals:
-	/// Emitted when a user action changes the selection (not called by setSelection()), or the text alignment. If the text is also changed, text_change is true.
+	/**
+	 * Emitted when a user action changes the selection (not called by setSelection()), the text or the text alignment.
+	 * 
+	 * If the text or the alignment is changed, text_change is true, and the
+	 * renderables of the object must be updated. Otherwise only the selection
+	 * overlay needs to be redrawn. The layout of the text is always up to date.
+	 */
 	void selectionChanged(bool text_change);
 	
 private:
 	void insertText(QString text);
+	void setText(const QString& text);
 	void updateDragging(MapCoordF map_coord);
 	bool getNextLinesSelectionRect(int& line, QRectF& out);
 	
@@ -290,6 +298,17 @@ signals:
 	void displayChanged() const;
 	
 private:
+	/**
+	 * Provides the objects which may be within the snap distance of the
+	 * given position in snap_candidates.
+	 * 
+	 * The candidates are found for an area which is larger than needed,
+	 * and they are reused as long as the position stays within this area
+	 * and the map's objects do not change. Thus most mouse moves need no
+	 * map query.
+	 */
+	void updateSnapCandidates(MapCoordF position, float snap_distance);
+	
 	SnapObjects filter;
 	
 	SnapObjects snapped_type;
@@ -297,6 +316,11 @@ private:
 	
 	Map* map;
 	
+	/** Objects which intersect snap_candidates_rect, cf. updateSnapCandidates() */
+	std::vector<Object*> snap_candidates;
+	QRectF snap_candidates_rect;
+	quint64 snap_candidates_revision;
+	
 	PointHandles point_handles;
 };
 
@@ -321,6 +345,12 @@ public:
  * Helper class to 'follow' (i.e. extract continuous parts from) PathObjects.
  * 
  * A FollowPathToolHelper can be reused for following different paths.
+ * 
+ * The followed range is extracted by binary search on the cumulative
+ * lengths of the path coords. When following to the closest point of a
+ * position, the search starts with the distance to the previous end of the
+ * range, so that the segment boxes of the path coords exclude most of the
+ * part. So following along long paths stays fast.
  */
 class FollowPathToolHelper
 {
@@ -351,6 +381,14 @@ public:
 	 */
 	std::unique_ptr<PathObject> updateFollowing(const PathCoord& end_coord);
 	
+	/**
+	 * Updates the process for the point of the followed part which is
+	 * closest to the given position, and returns the followed part of the path.
+	 * 
+	 * \see updateFollowing(const PathCoord&)
+	 */
+	std::unique_ptr<PathObject> updateFollowing(const MapCoordF& pos);
+	
 	/**
 	 * Returns the index of the path part which is being followed.
 	 */
@@ -21,6 +21,7 @@
 
 #include "undo.h"
 
+#include <memory>
 #include <vector>
 
 #include <QXmlStreamReader>
@@ -98,6 +99,11 @@ bool UndoStep::isValid() const
 	return true;
 }
 
+UndoStep* UndoStep::makeRedoStep() const
+{
+	return nullptr;
+}
+
 bool UndoStep::getModifiedParts(PartSet& out) const
 {
 	Q_UNUSED(out);
@@ -109,6 +115,11 @@ void UndoStep::getModifiedObjects(int, ObjectSet&) const
 	; // nothing
 }
 
+qint64 UndoStep::memoryUsage() const
+{
+	return sizeof(UndoStep);
+}
+
 // static
 UndoStep* UndoStep::load(QXmlStreamReader& xml, Map* map, SymbolDictionary& symbol_dict)
 {
@@ -177,6 +188,32 @@ UndoStep* CombinedUndoStep::undo()
 	return undo_step;
 }
 
+UndoStep* CombinedUndoStep::makeRedoStep() const
+{
+	UndoStep::PartSet parts;
+	for (const UndoStep* step : steps)
+	{
+		auto object_step = dynamic_cast<const ObjectModifyingUndoStep*>(step);
+		if (!object_step
+		    || object_step->getType() == SwitchPartUndoStepType
+		    || !parts.insert(object_step->getPartIndex()).second)
+		{
+			return nullptr;
+		}
+	}
+	
+	std::unique_ptr<CombinedUndoStep> redo_step(new CombinedUndoStep(map));
+	redo_step->steps.reserve(steps.size());
+	for (StepList::const_reverse_iterator step = steps.rbegin(), end = steps.rend(); step != end; ++step)
+	{
+		UndoStep* sub_step = (*step)->makeRedoStep();
+		if (!sub_step)
+			return nullptr;
+		redo_step->push(sub_step);
+	}
+	return redo_step.release();
+}
+
 bool CombinedUndoStep::getModifiedParts(PartSet &out) const
 {
 	for (StepList::const_iterator step = steps.begin(), end = steps.end(); step != end; ++step)
@@ -194,6 +231,14 @@ void CombinedUndoStep::getModifiedObjects(int part_index, ObjectSet &out) const
 	}
 }
 
+qint64 CombinedUndoStep::memoryUsage() const
+{
+	qint64 result = sizeof(CombinedUndoStep) + qint64(steps.capacity() * sizeof(UndoStep*));
+	for (const UndoStep* step : steps)
+		result += step->memoryUsage();
+	return result;
+}
+
 #ifndef NO_NATIVE_FILE_FORMAT
 
 bool CombinedUndoStep::load(QIODevice* file, int version)
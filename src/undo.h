@@ -123,6 +123,19 @@ public:
 	 */
 	virtual UndoStep* undo() = 0;
 	
+	/**
+	 * Creates the step which undo() would return, without changing the map.
+	 * 
+	 * The redo step is derived from the current state of the map. So this
+	 * must be called while the map is in the state which this step undoes,
+	 * i.e. before any other change is made after the change recorded by
+	 * this step.
+	 * 
+	 * The default implementation returns nullptr, meaning that the redo step
+	 * cannot be determined without executing this step.
+	 */
+	virtual UndoStep* makeRedoStep() const;
+	
 	
 	/**
 	 * Adds the list of the step's modified parts to the container provided by out.
@@ -143,6 +156,15 @@ public:
 	virtual void getModifiedObjects(int part_index, ObjectSet& out) const;
 	
 	
+	/**
+	 * Returns the approximate amount of memory used by this step, in bytes.
+	 * 
+	 * The default implementation returns the size of an UndoStep. Derived
+	 * classes which hold significant amounts of data shall add their size.
+	 */
+	virtual qint64 memoryUsage() const;
+	
+	
 #ifndef NO_NATIVE_FILE_FORMAT
 	/**
 	 * Loads the undo step from the file in the old "native" format.
@@ -228,6 +250,15 @@ public:
 	 */
 	virtual UndoStep* undo();
 	
+	/**
+	 * Creates the redo steps of all sub steps.
+	 * 
+	 * This is supported only when the sub steps modify objects of distinct
+	 * map parts, so that they do not depend on each other's changes.
+	 * Otherwise, this returns nullptr.
+	 */
+	virtual UndoStep* makeRedoStep() const;
+	
 	
 	/**
 	 * Adds the modified parts of all sub steps to the given set.
@@ -239,6 +270,11 @@ public:
 	 */
 	virtual void getModifiedObjects(int part_index, ObjectSet& out) const;
 	
+	/**
+	 * Returns the memory used by this step and by all sub steps.
+	 */
+	virtual qint64 memoryUsage() const;
+	
 	
 	/** 
 	 * Returns the number of sub steps.
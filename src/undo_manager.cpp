@@ -21,19 +21,201 @@
 
 #include "undo_manager.h"
 
+#include <algorithm>
 #include <vector>
 
+#include <QDebug>
 #include <QMessageBox>
+#include <QTemporaryFile>
 #include <QWidget>
 
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
+#include "file_format.h"
 #include "map.h"
 #include "object_undo.h"
+#include "settings.h"
 #include "util/xml_stream_util.h"
 
 
+namespace literal
+{
+	const QLatin1String packed_step("packed_step");
+	const QLatin1String type("type");
+	const QLatin1String compression("compression");
+	const QLatin1String zlib("zlib");
+}
+
+
+
+namespace
+{
+	/**
+	 * A placeholder for an undo step which was moved to the spill file.
+	 * 
+	 * The step was saved in XML format. The symbols which it references by
+	 * index are recorded, so that the step can be loaded after changes to
+	 * the map's symbols.
+	 * 
+	 * Steps which are loaded from a file in packed form are placed in the
+	 * spill file, too. Their symbols are resolved via the file's symbol
+	 * dictionary instead of the map's symbol indices.
+	 */
+	class SpilledUndoStep : public UndoStep
+	{
+	public:
+		SpilledUndoStep(Type type, Map* map, qint64 offset, const QByteArray& data, const SymbolDictionary* symbol_dict = nullptr);
+		
+		virtual ~SpilledUndoStep();
+		
+		virtual bool isValid() const;
+		
+		virtual UndoStep* undo();
+		
+#ifndef NO_NATIVE_FILE_FORMAT
+		virtual bool load(QIODevice* file, int version);
+#endif
+		
+		/**
+		 * Loads the original step from the spill file.
+		 * 
+		 * Returns nullptr on error.
+		 */
+		UndoStep* restore(QIODevice* file) const;
+		
+		void symbolChanged(const Symbol* new_symbol, const Symbol* old_symbol);
+		
+		void symbolDeleted(const Symbol* old_symbol);
+		
+	private:
+		qint64 offset;
+		qint64 size;
+		std::vector< std::pair<QString, const Symbol*> > symbols;
+		bool valid;
+	};
+	
+	SpilledUndoStep::SpilledUndoStep(Type type, Map* map, qint64 offset, const QByteArray& data, const SymbolDictionary* symbol_dict)
+	: UndoStep(type, map)
+	, offset(offset)
+	, size(data.size())
+	, valid(true)
+	{
+		QXmlStreamReader xml(data);
+		while (!xml.atEnd())
+		{
+			if (xml.readNext() != QXmlStreamReader::StartElement)
+				continue;
+			
+			const QString key = xml.attributes().value(QLatin1String("symbol")).toString();
+			if (key.isEmpty())
+				continue;
+			
+			auto symbol = std::find_if(symbols.begin(), symbols.end(), [&key](const std::pair<QString, const Symbol*>& entry) {
+				return entry.first == key;
+			});
+			if (symbol != symbols.end())
+				continue;
+			
+			if (symbol_dict)
+			{
+				if (const Symbol* dict_symbol = symbol_dict->value(key))
+					symbols.push_back(std::make_pair(key, dict_symbol));
+				continue;
+			}
+			
+			const int index = key.toInt();
+			if (index >= 0 && index < map->getNumSymbols())
+				symbols.push_back(std::make_pair(key, map->getSymbol(index)));
+		}
+	}
+	
+	SpilledUndoStep::~SpilledUndoStep()
+	{
+		; // nothing
+	}
+	
+	bool SpilledUndoStep::isValid() const
+	{
+		return valid;
+	}
+	
+	UndoStep* SpilledUndoStep::undo()
+	{
+		qWarning("SpilledUndoStep::undo() must not be called");
+		return new NoOpUndoStep(map, false);
+	}
+	
+#ifndef NO_NATIVE_FILE_FORMAT
+	
+	bool SpilledUndoStep::load(QIODevice*, int)
+	{
+		qWarning("SpilledUndoStep::load(QIODevice*, int) must not be called");
+		return false;
+	}
+	
+#endif
+	
+	UndoStep* SpilledUndoStep::restore(QIODevice* file) const
+	{
+		if (!valid || !file->seek(offset))
+			return nullptr;
+		
+		const QByteArray data = file->read(size);
+		if (data.size() != size)
+		{
+			qDebug() << "UndoManager: Cannot read spilled undo step:" << file->errorString();
+			return nullptr;
+		}
+		
+		SymbolDictionary symbol_dict;
+		for (auto& symbol : symbols)
+			symbol_dict.insert(symbol.first, const_cast<Symbol*>(symbol.second));
+		
+		QXmlStreamReader xml(data);
+		if (!xml.readNextStartElement() || xml.name() != "step")
+			return nullptr;
+		
+		UndoStep* step = nullptr;
+		try
+		{
+			step = UndoStep::load(xml, map, symbol_dict);
+		}
+		catch (FileFormatException& e)
+		{
+			qDebug() << "UndoManager: Cannot load spilled undo step:" << e.what();
+			return nullptr;
+		}
+		
+		if (xml.hasError())
+		{
+			qDebug() << "UndoManager: Cannot load spilled undo step:" << xml.errorString();
+			delete step;
+			return nullptr;
+		}
+		return step;
+	}
+	
+	void SpilledUndoStep::symbolChanged(const Symbol* new_symbol, const Symbol* old_symbol)
+	{
+		for (auto& symbol : symbols)
+		{
+			if (symbol.second == old_symbol)
+				symbol.second = new_symbol;
+		}
+	}
+	
+	void SpilledUndoStep::symbolDeleted(const Symbol* old_symbol)
+	{
+		for (auto& symbol : symbols)
+		{
+			if (symbol.second == old_symbol)
+				valid = false;
+		}
+	}
+}
+
+
 
 // ### UndoManager::State ###
 
@@ -52,12 +234,19 @@ UndoManager::State::State(UndoManager const *manager)
 
 UndoManager::UndoManager(Map* map)
 : QObject()
+, next_serial(1)
+, recording_forward_steps(false)
 , map(map)
 , current_index(0)
+, dropped_step_count(0)
 , clean_state_reachable(false)
 , loaded_state_reachable(false)
 {
-	; // nothing else
+	if (map)
+	{
+		connect(map, &Map::symbolChanged, this, &UndoManager::symbolChanged);
+		connect(map, &Map::symbolDeleted, this, &UndoManager::symbolDeleted);
+	}
 }
 
 UndoManager::~UndoManager()
@@ -90,6 +279,10 @@ void UndoManager::clear()
 	}
 	
 	Q_ASSERT(undo_steps.empty());
+	step_serials.clear();
+	forward_steps.clear();
+	dropped_step_count = 0;
+	spill_file.reset();
 }
 
 void UndoManager::push(UndoStep* step)
@@ -100,8 +293,20 @@ void UndoManager::push(UndoStep* step)
 	
 	UndoManager::State const old_state(this);
 	undo_steps.push_back(step);
+	addStepSerials();
 	++current_index;
-	validateUndoSteps();
+	
+	if (recording_forward_steps && step->isValid())
+		recordForwardStep(step, step_serials.back());
+	
+	// Only the new step needs to be checked here: If it is invalid, the
+	// older steps are no longer reachable.
+	if (!step->isValid())
+		dropUndoSteps(current_index - 1);
+	else if (current_index > max_undo_steps)
+		dropUndoSteps(current_index - max_undo_steps);
+	
+	limitMemoryUsage();
 	emitChangedSignals(old_state);
 }
 
@@ -115,6 +320,7 @@ bool UndoManager::undo(QWidget* dialog_parent)
 		return false;
 	}
 	
+	unspill(current_index - 1);
 	UndoStep* step = nextUndoStep();
 	if (!step->isValid())
 	{
@@ -153,6 +359,7 @@ bool UndoManager::redo(QWidget* dialog_parent)
 		return false;
 	}
 	
+	unspill(current_index);
 	UndoStep* step = nextRedoStep();
 	if (!step->isValid())
 	{
@@ -205,6 +412,7 @@ void UndoManager::clearRedoSteps()
 	if (canRedo())
 	{
 		clear(undo_steps, undo_steps.begin() + current_index, undo_steps.end());
+		step_serials.erase(step_serials.begin() + current_index, step_serials.end());
 		clean_state_reachable  &= (clean_state_index <= current_index);
 		loaded_state_reachable &= (loaded_state_index <= current_index);
 		emit canRedoChanged(false);
@@ -256,26 +464,37 @@ void UndoManager::validateUndoSteps()
 			++step;
 		}
 		
-		for (; step != end; ++step)
-		{
-			if ((*step)->getType() != UndoStep::InvalidUndoStepType)
-			{
-				delete *step;
-				*step = new NoOpUndoStep(map, false);
-			}
-		}
-		
-		if (clean_state_reachable)
-			clean_state_reachable = (clean_state_index  >= current_index) || undo_steps[clean_state_index]->isValid();
-		
-		if (loaded_state_reachable)
-			loaded_state_reachable = (loaded_state_index >= current_index) || undo_steps[loaded_state_index]->isValid();
+		dropUndoSteps(current_index - count);
 		
 		if (!canUndo())
 			emit canUndoChanged(false);
 	}
 }
 
+void UndoManager::dropUndoSteps(std::size_t count)
+{
+	Q_ASSERT(count <= current_index);
+	if (count == 0)
+		return;
+	
+	clear(undo_steps, undo_steps.begin(), undo_steps.begin() + count);
+	step_serials.erase(step_serials.begin(), step_serials.begin() + count);
+	current_index -= count;
+	dropped_step_count += count;
+	
+	if (clean_state_reachable)
+	{
+		clean_state_reachable = (clean_state_index >= count);
+		clean_state_index -= qMin(count, clean_state_index);
+	}
+	
+	if (loaded_state_reachable)
+	{
+		loaded_state_reachable = (loaded_state_index >= count);
+		loaded_state_index -= qMin(count, loaded_state_index);
+	}
+}
+
 void UndoManager::validateRedoSteps()
 {
 	if (canRedo())
@@ -290,6 +509,7 @@ void UndoManager::validateRedoSteps()
 			++step;
 		}
 		
+		step_serials.erase(step_serials.begin() + (step - undo_steps.begin()), step_serials.end());
 		clear(undo_steps, step, end);
 		
 		if (clean_state_reachable)
@@ -303,6 +523,133 @@ void UndoManager::validateRedoSteps()
 	}
 }
 
+qint64 UndoManager::undoMemoryUsage() const
+{
+	qint64 result = 0;
+	for (std::size_t i = 0; i < current_index; ++i)
+		result += undo_steps[i]->memoryUsage();
+	return result;
+}
+
+qint64 UndoManager::redoMemoryUsage() const
+{
+	qint64 result = 0;
+	for (std::size_t i = current_index; i < undo_steps.size(); ++i)
+		result += undo_steps[i]->memoryUsage();
+	return result;
+}
+
+void UndoManager::limitMemoryUsage()
+{
+	if (!map || current_index < 2)
+		return;
+	
+	const qint64 memory_limit = qint64(Settings::getInstance().getSettingCached(Settings::General_UndoMemoryLimitMB).toInt()) << 20;
+	qint64 memory_usage = 0;
+	bool spilling = false;
+	bool have_spilled_steps = false;
+	for (std::size_t i = current_index; i > 0; --i)
+	{
+		UndoStep*& step = undo_steps[i - 1];
+		if (dynamic_cast<SpilledUndoStep*>(step))
+		{
+			have_spilled_steps = true;
+			continue;
+		}
+		if (!step->isValid())
+			continue;
+		
+		if (!spilling)
+		{
+			memory_usage += step->memoryUsage();
+			spilling = memory_usage > memory_limit && i < current_index;
+		}
+		if (spilling)
+		{
+			if (!spill(step))
+				break;
+			have_spilled_steps = true;
+		}
+	}
+	
+	if (!have_spilled_steps)
+		spill_file.reset();
+}
+
+bool UndoManager::spill(UndoStep*& step)
+{
+	QByteArray data;
+	{
+		QXmlStreamWriter xml(&data);
+		step->save(xml);
+	}
+	
+	const qint64 offset = writeSpillData(data);
+	if (offset < 0)
+		return false;
+	
+	UndoStep* placeholder = new SpilledUndoStep(step->getType(), map, offset, data);
+	delete step;
+	step = placeholder;
+	return true;
+}
+
+qint64 UndoManager::writeSpillData(const QByteArray& data)
+{
+	if (!spill_file)
+	{
+		spill_file.reset(new QTemporaryFile());
+		if (!spill_file->open())
+		{
+			qDebug() << "UndoManager: Cannot open spill file:" << spill_file->errorString();
+			spill_file.reset();
+			return -1;
+		}
+	}
+	
+	const qint64 offset = spill_file->size();
+	if (!spill_file->seek(offset) || spill_file->write(data) != data.size())
+	{
+		qDebug() << "UndoManager: Cannot write spill file:" << spill_file->errorString();
+		return -1;
+	}
+	return offset;
+}
+
+void UndoManager::unspill(std::size_t index)
+{
+	auto spilled_step = dynamic_cast<SpilledUndoStep*>(undo_steps[index]);
+	if (!spilled_step)
+		return;
+	
+	UndoStep* step = spill_file ? spilled_step->restore(spill_file.get()) : nullptr;
+	if (!step)
+		step = new NoOpUndoStep(map, false);
+	
+	delete spilled_step;
+	undo_steps[index] = step;
+}
+
+void UndoManager::symbolChanged(int pos, const Symbol* new_symbol, const Symbol* old_symbol)
+{
+	Q_UNUSED(pos);
+	for (UndoStep* step : undo_steps)
+	{
+		if (auto spilled_step = dynamic_cast<SpilledUndoStep*>(step))
+			spilled_step->symbolChanged(new_symbol, old_symbol);
+	}
+}
+
+void UndoManager::symbolDeleted(int pos, const Symbol* old_symbol)
+{
+	Q_UNUSED(pos);
+	for (UndoStep* step : undo_steps)
+	{
+		if (auto spilled_step = dynamic_cast<SpilledUndoStep*>(step))
+			spilled_step->symbolDeleted(old_symbol);
+	}
+}
+
 void UndoManager::emitChangedSignals(const UndoManager::State& old_state)
 {
 	bool const is_clean = isClean();
@@ -344,6 +691,7 @@ bool UndoManager::load(QIODevice* file, int version)
 		{
 			undo_steps.insert(undo_steps.end(), loaded_steps.rbegin(), loaded_steps.rend());
 		}
+		addStepSerials();
 		
 		emitChangedSignals(old_state);
 	}
@@ -370,32 +718,132 @@ bool UndoManager::loadSteps(StepList& steps, QIODevice* file, int version)
 
 #endif
 
-void UndoManager::saveUndo(QXmlStreamWriter& xml)
+void UndoManager::saveUndo(QXmlStreamWriter& xml, bool packed)
 {
 	XmlElementWriter undo_element(xml, QLatin1String("undo"));
 	
 	validateUndoSteps();
+	const std::size_t max_saved_steps = std::size_t(qMax(0, Settings::getInstance().getSettingCached(Settings::General_SavedUndoSteps).toInt()));
 	StepList::iterator begin = undo_steps.begin();
 	StepList::iterator end   = begin + undoStepCount();
+	if (undoStepCount() > max_saved_steps)
+		begin = end - max_saved_steps;
 	while (begin != end && !(*begin)->isValid())
 		++begin;
 	
-	saveSteps(begin, end, xml);
+	saveSteps(begin, end, xml, packed);
 }
 
-void UndoManager::saveRedo(QXmlStreamWriter& xml)
+void UndoManager::saveRedo(QXmlStreamWriter& xml, bool packed)
 {
 	XmlElementWriter redo_element(xml, QLatin1String("redo"));
 	
 	validateRedoSteps();
-	saveSteps(undo_steps.rbegin(), undo_steps.rbegin() + redoStepCount(), xml);
+	const std::size_t max_saved_steps = std::size_t(qMax(0, Settings::getInstance().getSettingCached(Settings::General_SavedUndoSteps).toInt()));
+	const std::size_t num_skipped_steps = redoStepCount() - qMin(redoStepCount(), max_saved_steps);
+	saveSteps(undo_steps.rbegin() + num_skipped_steps, undo_steps.rbegin() + redoStepCount(), xml, packed);
+}
+
+void UndoManager::setRecordingForwardSteps(bool recording)
+{
+	recording_forward_steps = recording;
+	if (!recording)
+		forward_steps.clear();
+}
+
+void UndoManager::clearForwardSteps()
+{
+	forward_steps.clear();
+}
+
+bool UndoManager::saveForwardSteps(std::size_t first_index, QByteArray& data) const
+{
+	Q_ASSERT(first_index <= current_index);
+	
+	// Along the current history, the serial numbers are ascending, and so
+	// are the recorded forward steps.
+	std::vector<const QByteArray*> steps;
+	steps.reserve(current_index - first_index);
+	auto recorded = forward_steps.begin();
+	for (std::size_t i = first_index; i < current_index; ++i)
+	{
+		const quint64 serial = step_serials[i];
+		recorded = std::find_if(recorded, forward_steps.end(), [serial](const std::pair<quint64, QByteArray>& entry) {
+			return entry.first == serial;
+		});
+		if (recorded == forward_steps.end())
+			return false;
+		steps.push_back(&recorded->second);
+	}
+	
+	for (const QByteArray* step : steps)
+		data.append(*step);
+	return true;
+}
+
+void UndoManager::addStepSerials()
+{
+	while (step_serials.size() < undo_steps.size())
+		step_serials.push_back(next_serial++);
+}
+
+void UndoManager::recordForwardStep(const UndoStep* step, quint64 serial)
+{
+	std::unique_ptr<UndoStep> forward_step(step->makeRedoStep());
+	if (!forward_step)
+		return;
+	
+	QByteArray data;
+	{
+		QXmlStreamWriter xml(&data);
+		forward_step->save(xml);
+	}
+	
+	if (forward_steps.size() >= max_undo_steps)
+		forward_steps.pop_front();
+	forward_steps.emplace_back(serial, data);
 }
 
 template <class iterator>
-void UndoManager::saveSteps(iterator begin, iterator end, QXmlStreamWriter& xml)
+void UndoManager::saveSteps(iterator begin, iterator end, QXmlStreamWriter& xml, bool packed)
 {
 	for (iterator step = begin; step != end; ++step)
-		(*step)->save(xml);
+	{
+		if (auto spilled_step = dynamic_cast<SpilledUndoStep*>(*step))
+		{
+			// Spilled steps refer to the symbols by their former index.
+			std::unique_ptr<UndoStep> restored_step(spill_file ? spilled_step->restore(spill_file.get()) : nullptr);
+			if (!restored_step)
+				restored_step.reset(new NoOpUndoStep(map, false));
+			saveStep(restored_step.get(), xml, packed);
+		}
+		else
+		{
+			saveStep(*step, xml, packed);
+		}
+	}
+}
+
+void UndoManager::saveStep(UndoStep* step, QXmlStreamWriter& xml, bool packed)
+{
+	if (!packed)
+	{
+		step->save(xml);
+		return;
+	}
+	
+	// Each step is compressed on its own, so that only a single step
+	// needs to be held in memory when saving and loading.
+	QByteArray data;
+	{
+		QXmlStreamWriter step_xml(&data);
+		step->save(step_xml);
+	}
+	
+	XmlElementWriter element(xml, literal::packed_step);
+	element.writeAttribute(literal::type, int(step->getType()));
+	element.writeAttribute(literal::compression, QString(literal::zlib));
+	xml.writeCharacters(QString::fromLatin1(qCompress(data).toBase64()));
 }
 
 
@@ -414,6 +862,7 @@ bool UndoManager::loadUndo(QXmlStreamReader& xml, SymbolDictionary& symbol_dict)
 		
 		UndoManager::State old_state(this);
 		undo_steps.swap(loaded_steps);
+		addStepSerials();
 		current_index = undo_steps.size();
 		setLoaded();
 		setClean();
@@ -437,6 +886,7 @@ bool UndoManager::loadRedo(QXmlStreamReader& xml, SymbolDictionary& symbol_dict)
 		
 		UndoManager::State old_state(this);
 		undo_steps.insert(undo_steps.end(), loaded_steps.rbegin(), loaded_steps.rend());
+		addStepSerials();
 		emitChangedSignals(old_state);
 	}
 	return success;
@@ -448,8 +898,33 @@ bool UndoManager::loadSteps(StepList& steps, QXmlStreamReader& xml, SymbolDictio
 	{
 		if (xml.name() == "step")
 			steps.push_back(UndoStep::load(xml, map, symbol_dict));
+		else if (xml.name() == literal::packed_step)
+			steps.push_back(loadPackedStep(xml, symbol_dict));
 		else
 			xml.skipCurrentElement(); // unknown
 	}
 	return true;
 }
+
+UndoStep* UndoManager::loadPackedStep(QXmlStreamReader& xml, SymbolDictionary& symbol_dict)
+{
+	Q_ASSERT(xml.name() == literal::packed_step);
+	
+	const auto type = UndoStep::Type(xml.attributes().value(literal::type).toString().toInt());
+	const bool zlib = xml.attributes().value(literal::compression) == literal::zlib;
+	const QByteArray data = xml.readElementText().toLatin1();
+	const QByteArray step_data = zlib ? qUncompress(QByteArray::fromBase64(data)) : QByteArray();
+	if (step_data.isEmpty())
+		return new NoOpUndoStep(map, false);
+	
+	// The step is not parsed before it is actually needed.
+	const qint64 offset = writeSpillData(step_data);
+	if (offset >= 0)
+		return new SpilledUndoStep(type, map, offset, step_data, &symbol_dict);
+	
+	// Without a spill file, the step is loaded immediately.
+	QXmlStreamReader step_xml(step_data);
+	if (!step_xml.readNextStartElement() || step_xml.name() != "step")
+		return new NoOpUndoStep(map, false);
+	return UndoStep::load(step_xml, map, symbol_dict);
+}
@@ -22,15 +22,19 @@
 #ifndef _OPENORIENTEERING_UNDO_MANAGER_H_
 #define _OPENORIENTEERING_UNDO_MANAGER_H_
 
+#include <QByteArray>
 #include <QObject>
 
 #include <deque>
+#include <memory>
+#include <utility>
 
 #include "symbol.h"
 #include "undo.h"
 
 QT_BEGIN_NAMESPACE
 class QIODevice;
+class QTemporaryFile;
 class QXmlStreamReader;
 class QXmlStreamWriter;
 QT_END_NAMESPACE
@@ -71,6 +75,10 @@ public:
 	 * Adds a new undo step to the manager.
 	 * 
 	 * All recorded redo steps will be deleted.
+	 * 
+	 * The step must be pushed immediately after the change which it undoes.
+	 * While recording forward steps, the forward step is derived from the
+	 * current state of the map.
 	 */
 	void push(UndoStep* step);
 	
@@ -150,6 +158,35 @@ public:
 	 */
 	UndoStep* nextUndoStep() const;
 	
+	/**
+	 * Returns the undo step at the given index.
+	 * 
+	 * Index 0 is the oldest step. The index must be less than undoStepCount().
+	 */
+	UndoStep* undoStep(std::size_t index) const;
+	
+	/**
+	 * Returns the number of old steps which were dropped from the beginning
+	 * of the undo history since the last call to clear().
+	 * 
+	 * Dropping steps decreases the index of the remaining steps. So the sum
+	 * of this number and undoStepCount() identifies the current state across
+	 * calls to push().
+	 */
+	std::size_t droppedStepCount() const;
+	
+	/**
+	 * Returns the serial number of the undo step at the given index.
+	 * 
+	 * Each pushed or loaded step gets a new serial number, and serial numbers
+	 * are never reused. The serial number is kept when the step is undone
+	 * and redone, or when it is moved to and from the spill file. So it
+	 * identifies a change independent of the objects which represent it.
+	 * 
+	 * The index must be less than undoStepCount(). Serial numbers are never 0.
+	 */
+	quint64 undoStepSerial(std::size_t index) const;
+	
 	
 	/**
 	 * Returns the current number of redo steps.
@@ -165,6 +202,20 @@ public:
 	UndoStep* nextRedoStep() const;
 	
 	
+	/**
+	 * Returns the approximate amount of memory used by the undo steps,
+	 * in bytes. Steps which were moved to the spill file count with the
+	 * size of their placeholder only.
+	 */
+	qint64 undoMemoryUsage() const;
+	
+	/**
+	 * Returns the approximate amount of memory used by the redo steps,
+	 * in bytes.
+	 */
+	qint64 redoMemoryUsage() const;
+	
+	
 	/**
 	 * Loads the undo steps from the file in the old "native" format.
 	 */
@@ -172,18 +223,61 @@ public:
 	
 	/**
 	 * Saves the undo steps to the file in xml format.
+	 * 
+	 * The number of saved steps is limited by the setting
+	 * Settings::General_SavedUndoSteps.
+	 * 
+	 * If packed is true, each step is saved as a compressed packed_step
+	 * element. Such steps are loaded lazily. Older versions ignore this
+	 * element, so the file must hide it from them (cf. the barrier elements
+	 * of XMLFileExporter).
 	 */
-	void saveUndo(QXmlStreamWriter& xml);
+	void saveUndo(QXmlStreamWriter& xml, bool packed = false);
 	
 	/**
 	 * Saves the undo steps to the file in xml format.
+	 * 
+	 * The number of saved steps is limited by the setting
+	 * Settings::General_SavedUndoSteps.
+	 * 
+	 * @see saveUndo()
+	 */
+	void saveRedo(QXmlStreamWriter& xml, bool packed = false);
+	
+	/**
+	 * Starts or stops recording forward steps for new undo steps.
+	 * 
+	 * While recording, push() saves the step which redoes the change of the
+	 * pushed step, as obtained from UndoStep::makeRedoStep(). At most
+	 * max_undo_steps forward steps are kept. Stopping the recording discards
+	 * all recorded steps.
+	 */
+	void setRecordingForwardSteps(bool recording);
+	
+	/**
+	 * Discards all recorded forward steps.
+	 */
+	void clearForwardSteps();
+	
+	/**
+	 * Appends the recorded forward steps which redo the changes made by the
+	 * undo steps from the given index up to the current state to data.
+	 * 
+	 * The forward steps are saved in xml format, as sequence of step
+	 * elements. Neither the map nor the undo steps are touched.
+	 * 
+	 * Returns false, without any changes, if the forward step of one of the
+	 * undo steps was not recorded.
 	 */
-	void saveRedo(QXmlStreamWriter& xml);
+	bool saveForwardSteps(std::size_t first_index, QByteArray& data) const;
 	
 	/**
 	 * Loads the undo steps from the file in xml format.
 	 * 
 	 * Any existing undo/redo steps will be deleted first.
+	 * 
+	 * Packed steps are not parsed before they are needed by undo() or
+	 * redo(). Until then, they are kept in the spill file.
 	 */
 	bool loadUndo(QXmlStreamReader& xml, SymbolDictionary& symbol_dict);
 	
@@ -198,9 +292,9 @@ public:
 	/**
 	 * The maximum number of steps kept for undo() and redo(), respectively.
 	 * 
-	 * This limits the amount of memory occupied by undo steps.
-	 * 
-	 * @todo Make this configurable (maybe by used memory instead of step count)
+	 * The memory occupied by the undo steps is limited separately, by the
+	 * setting Settings::General_UndoMemoryLimitMB. Undo steps which exceed
+	 * this limit are moved to a temporary file.
 	 */
 	static const std::size_t max_undo_steps = 128;
 	
@@ -246,15 +340,25 @@ protected:
 	/**
 	 * Validates the list of steps available for undo().
 	 * 
-	 * In order to maintain the validness of current_index etc., this
-	 * method does not remove elements from undo_steps.
-	 * Instead, it replaces steps which are no longer reachable via valid steps,
-	 * or which exceed the max_undo_steps limit, with invalid NoOpUndoStep objects,
-	 * thus releasing the memory which was orginally occupied by now obsolete
-	 * undo steps.
+	 * This method removes steps from undo_steps which are no longer reachable
+	 * via valid steps, or which exceed the max_undo_steps limit.
+	 * 
+	 * Steps may become invalid at any time, e.g. when a symbol is deleted.
+	 * push() only checks the new step and the limit, so this method is
+	 * called before the full list of undo steps is needed.
 	 */
 	void validateUndoSteps();
 	
+	/**
+	 * Deletes the given number of oldest undo steps and removes them from
+	 * undo_steps.
+	 * 
+	 * Adjusts current_index, clean_state_index and loaded_state_index.
+	 * The clean and loaded state become unreachable if they were before the
+	 * remaining steps.
+	 */
+	void dropUndoSteps(std::size_t count);
+	
 	/**
 	 * Validates the list of steps available for redo().
 	 * 
@@ -298,13 +402,71 @@ protected:
 	 */
 	void updateMapState(const UndoStep* step) const;
 	
+	/**
+	 * Moves old undo steps to the spill file while the estimated memory
+	 * usage of the undo steps exceeds the limit.
+	 * 
+	 * The most recent undo step is always kept in memory. Redo steps are
+	 * not moved.
+	 */
+	void limitMemoryUsage();
+	
+	/**
+	 * Moves the given step to the spill file.
+	 * 
+	 * On success, the step is deleted and replaced by a placeholder.
+	 * Returns false on error, leaving the step unchanged.
+	 */
+	bool spill(UndoStep*& step);
+	
+	/**
+	 * Appends the given data to the spill file, creating it if needed.
+	 * 
+	 * Returns the offset of the data, or -1 on error.
+	 */
+	qint64 writeSpillData(const QByteArray& data);
+	
+	/**
+	 * Loads the step at the given index from the spill file if it was
+	 * moved there.
+	 * 
+	 * If the step cannot be loaded, it is replaced by an invalid step.
+	 */
+	void unspill(std::size_t index);
+	
+protected slots:
+	/**
+	 * Updates the symbols referenced by spilled steps.
+	 */
+	void symbolChanged(int pos, const Symbol* new_symbol, const Symbol* old_symbol);
+	
+	/**
+	 * Invalidates spilled steps which reference the deleted symbol.
+	 */
+	void symbolDeleted(int pos, const Symbol* old_symbol);
+	
 private:
+	/**
+	 * Assigns new serial numbers to the steps which were added to the end
+	 * of undo_steps.
+	 */
+	void addStepSerials();
+	
+	/**
+	 * Records the forward step for the given step, which was just pushed.
+	 */
+	void recordForwardStep(const UndoStep* step, quint64 serial);
+	
 	bool loadSteps(StepList& steps, QIODevice* file, int version);
 	
 	bool loadSteps(StepList& steps, QXmlStreamReader& xml, SymbolDictionary& symbol_dict);
 	
+	UndoStep* loadPackedStep(QXmlStreamReader& xml, SymbolDictionary& symbol_dict);
+	
 	template <class iterator>
-	void saveSteps(iterator begin, iterator end, QXmlStreamWriter& xml);
+	void saveSteps(iterator begin, iterator end, QXmlStreamWriter& xml, bool packed);
+	
+	void saveStep(UndoStep* step, QXmlStreamWriter& xml, bool packed);
 	
 	/**
 	 * The list of all steps available for undo() and redo().
@@ -313,6 +475,31 @@ private:
 	 */
 	StepList undo_steps;
 	
+	/**
+	 * The serial numbers of the steps in undo_steps, at the same indices.
+	 * 
+	 * @see undoStepSerial()
+	 */
+	std::deque<quint64> step_serials;
+	
+	/**
+	 * The serial number for the next new step.
+	 */
+	quint64 next_serial;
+	
+	/**
+	 * The recorded forward steps in xml format, by serial number of the
+	 * undo step, in the order of recording.
+	 * 
+	 * @see setRecordingForwardSteps()
+	 */
+	std::deque< std::pair<quint64, QByteArray> > forward_steps;
+	
+	/**
+	 * Indicates whether forward steps are recorded.
+	 */
+	bool recording_forward_steps;
+	
 	/**
 	 * The map which this UndoManager operates on.
 	 */
@@ -326,6 +513,11 @@ private:
 	 */
 	std::size_t current_index;
 	
+	/**
+	 * The number of steps removed by dropUndoSteps() since the last clear().
+	 */
+	std::size_t dropped_step_count;
+	
 	/**
 	 * The index of the clean state.
 	 * 
@@ -349,6 +541,13 @@ private:
 	 * Indicates whether the loaded state is reachable through undo() or redo().
 	 */
 	bool loaded_state_reachable;
+	
+	/**
+	 * The temporary file which holds the spilled undo steps.
+	 * 
+	 * It is created when needed, and removed when no spilled steps are left.
+	 */
+	std::unique_ptr<QTemporaryFile> spill_file;
 };
 
 
@@ -380,6 +579,26 @@ UndoStep* UndoManager::nextUndoStep() const
 	return undo_steps[current_index - 1];
 }
 
+inline
+UndoStep* UndoManager::undoStep(std::size_t index) const
+{
+	Q_ASSERT(index < current_index);
+	return undo_steps[index];
+}
+
+inline
+std::size_t UndoManager::droppedStepCount() const
+{
+	return dropped_step_count;
+}
+
+inline
+quint64 UndoManager::undoStepSerial(std::size_t index) const
+{
+	Q_ASSERT(index < current_index);
+	return step_serials[index];
+}
+
 inline
 std::size_t UndoManager::redoStepCount() const
 {
@@ -20,20 +20,54 @@
 
 #include "xml_stream_util.h"
 
-#include <QTextStream>
+#include <algorithm>
+#include <cstddef>
+
+#include <QString>
+#include <QtEndian>
 
 #include "../core/map_coord.h"
 #include "../file_format_xml.h"
 #include "../file_import_export.h"
 
 
+namespace
+{
+	void parseCoordsText(const QChar* pos, const QChar* last, MapCoordVector& coords)
+	{
+		while (pos != last)
+		{
+			coords.emplace_back();
+			pos = MapCoord::parse(pos, last, coords.back());
+			if (!pos)
+			{
+				throw FileFormatException(ImportExport::tr("Could not parse the coordinates."));
+			}
+		}
+	}
+	
+	void ensureCoordsCount(const MapCoordVector& coords, unsigned int count)
+	{
+		if (coords.size() != count)
+		{
+			throw FileFormatException(ImportExport::tr("Expected %1 coordinates, found %2.").arg(count).arg(coords.size()));
+		}
+	}
+}
+
+
 void XmlElementWriter::write(const MapCoordVector& coords)
 {
 	namespace literal = XmlStreamLiteral;
 	
 	writeAttribute(literal::count, coords.size());
 	
-	if (XMLFileFormat::active_version < 6 || xml.autoFormatting())
+	if (auto blocks = BinaryCoordBlocks::forDevice(xml.device()))
+	{
+		// Compact file format: coordinates in a separate binary block
+		writeAttribute(literal::block, blocks->append(coords));
+	}
+	else if (XMLFileFormat::active_version < 6 || xml.autoFormatting())
 	{
 		// XMAP files and old format: syntactically rich output
 		for (auto& coord : coords)
@@ -43,12 +77,23 @@ void XmlElementWriter::write(const MapCoordVector& coords)
 	{
 		// Default: efficient plain text format
 		//   Note that it is more efficient to concatenate the data
-		// than to call writeCharacters() multiple times.
-		QString data;
-		data.reserve(coords.size() * 16);
+		// than to call writeCharacters() for every coordinate.
+		// The coordinates are formatted into a fixed buffer which is
+		// written in chunks.
+		constexpr std::size_t chunk_size = 4096;
+		QChar buffer[chunk_size];
+		QChar* const chunk_limit = buffer + chunk_size - MapCoord::max_string_length;
+		QChar* pos = buffer;
 		for (auto& coord : coords)
-			data.append(coord.toString());
-		xml.writeCharacters(data);
+		{
+			pos = coord.toString(pos);
+			if (pos > chunk_limit)
+			{
+				xml.writeCharacters(QString::fromRawData(buffer, pos - buffer));
+				pos = buffer;
+			}
+		}
+		xml.writeCharacters(QString::fromRawData(buffer, pos - buffer));
 	}
 }
 
@@ -64,6 +109,14 @@ void XmlElementReader::read(MapCoordVector& coords)
 	
 	try
 	{
+		if (hasAttribute(literal::block))
+		{
+			auto blocks = BinaryCoordBlocks::forDevice(xml.device());
+			if (!blocks)
+				throw FileFormatException(ImportExport::tr("Could not parse the coordinates."));
+			blocks->read(attribute<unsigned int>(literal::block), coords);
+		}
+		
 		for( xml.readNext(); xml.tokenType() != QXmlStreamReader::EndElement; xml.readNext() )
 		{
 			const QXmlStreamReader::TokenType token = xml.tokenType();
@@ -74,23 +127,71 @@ void XmlElementReader::read(MapCoordVector& coords)
 			else if (token == QXmlStreamReader::Characters && !xml.isWhitespace())
 			{
 				QStringRef text = xml.text();
-				QString data = QString::fromRawData(text.constData(), text.length());
-				
-				QTextStream stream(&data, QIODevice::ReadOnly);
-				stream.setIntegerBase(10);
-				while (!stream.atEnd())
+				parseCoordsText(text.constData(), text.constData() + text.length(), coords);
+			}
+			else if (token == QXmlStreamReader::StartElement)
+			{
+				if (xml.name() == literal::coord)
 				{
-					coords.emplace_back();
-					stream >> coords.back();
+					coords.emplace_back(MapCoord::load(xml));
 				}
-				
-				if (stream.status() == QTextStream::ReadCorruptData)
+				else
 				{
-					throw FileFormatException(ImportExport::tr("Could not parse the coordinates."));
+					xml.skipCurrentElement();
 				}
 			}
+			// otherwise: ignore element
+		}
+	}
+	catch (std::range_error &e)
+	{
+		throw FileFormatException(MapCoord::tr(e.what()));
+	}
+	
+	ensureCoordsCount(coords, num_coords);
+}
+
+bool XmlElementReader::readText(MapCoordVector& coords, QString& text)
+{
+	namespace literal = XmlStreamLiteral;
+	
+	if (hasAttribute(literal::block) || MapCoord::boundsOffset().check_for_offset)
+	{
+		read(coords);
+		return false;
+	}
+	
+	coords.clear();
+	text.clear();
+	
+	// Rich XML (coord elements) is read directly.
+	bool direct = false;
+	try
+	{
+		for( xml.readNext(); xml.tokenType() != QXmlStreamReader::EndElement; xml.readNext() )
+		{
+			const QXmlStreamReader::TokenType token = xml.tokenType();
+			if (xml.error() || token == QXmlStreamReader::EndDocument)
+			{
+				throw FileFormatException(ImportExport::tr("Could not parse the coordinates."));
+			}
+			else if (token == QXmlStreamReader::Characters && !xml.isWhitespace())
+			{
+				QStringRef characters = xml.text();
+				if (direct)
+					parseCoordsText(characters.constData(), characters.constData() + characters.length(), coords);
+				else
+					text.append(characters);
+			}
 			else if (token == QXmlStreamReader::StartElement)
 			{
+				if (!direct)
+				{
+					parseCoordsText(text.constData(), text.constData() + text.length(), coords);
+					text.clear();
+					direct = true;
+				}
+				
 				if (xml.name() == literal::coord)
 				{
 					coords.emplace_back(MapCoord::load(xml));
@@ -108,8 +209,109 @@ void XmlElementReader::read(MapCoordVector& coords)
 		throw FileFormatException(MapCoord::tr(e.what()));
 	}
 	
-	if (coords.size() != num_coords)
+	if (direct)
+	{
+		ensureCoordsCount(coords, attribute<unsigned int>(literal::count));
+		return false;
+	}
+	return true;
+}
+
+void XmlElementReader::parseText(const QString& text, unsigned int count, MapCoordVector& coords)
+{
+	coords.clear();
+	coords.reserve(std::min(count, 500000u));
+	try
+	{
+		parseCoordsText(text.constData(), text.constData() + text.length(), coords);
+	}
+	catch (std::range_error &e)
+	{
+		throw FileFormatException(MapCoord::tr(e.what()));
+	}
+	ensureCoordsCount(coords, count);
+}
+
+
+
+// ### BinaryCoordBlocks ###
+
+BinaryCoordBlocks::BinaryCoordBlocks()
+{
+	// nothing else
+}
+
+BinaryCoordBlocks::BinaryCoordBlocks(const QByteArray& data, const std::vector<quint64>& offsets)
+ : block_data(data)
+ , block_offsets(offsets)
+{
+	// nothing else
+}
+
+quint32 BinaryCoordBlocks::append(const MapCoordVector& coords)
+{
+	const auto index = quint32(block_offsets.size());
+	const auto offset = block_data.size();
+	block_offsets.push_back(quint64(offset));
+	
+	const auto count = quint32(coords.size());
+	const auto size = (4 + 9 * int(count) + 3) & ~3;
+	block_data.resize(offset + size);
+	
+	auto pos = reinterpret_cast<uchar*>(block_data.data() + offset);
+	qToLittleEndian<quint32>(count, pos);
+	pos += 4;
+	for (auto& coord : coords)
+	{
+		qToLittleEndian<qint32>(coord.nativeX(), pos);
+		qToLittleEndian<qint32>(coord.nativeY(), pos + 4);
+		pos += 8;
+	}
+	for (auto& coord : coords)
+	{
+		*pos = uchar(coord.flags());
+		++pos;
+	}
+	
+	// Padding
+	auto end = reinterpret_cast<uchar*>(block_data.data() + offset + size);
+	std::fill(pos, end, uchar(0));
+	
+	return index;
+}
+
+void BinaryCoordBlocks::read(quint32 index, MapCoordVector& coords) const
+{
+	if (index >= block_offsets.size() || block_offsets[index] + 4 > quint64(block_data.size()))
+		throw FileFormatException(ImportExport::tr("Could not parse the coordinates."));
+	
+	auto pos = reinterpret_cast<const uchar*>(block_data.constData() + block_offsets[index]);
+	const auto count = qFromLittleEndian<quint32>(pos);
+	if (block_offsets[index] + 4 + 9 * quint64(count) > quint64(block_data.size()))
+		throw FileFormatException(ImportExport::tr("Could not parse the coordinates."));
+	pos += 4;
+	
+	auto flags = pos + 8 * quint64(count);
+	coords.reserve(coords.size() + count);
+	for (quint32 i = 0; i < count; ++i)
 	{
-		throw FileFormatException(ImportExport::tr("Expected %1 coordinates, found %2."));
+		coords.push_back(MapCoord::load(qFromLittleEndian<qint32>(pos), qFromLittleEndian<qint32>(pos + 4), flags[i]));
+		pos += 8;
 	}
 }
+
+
+
+// ### BinaryCoordBlocks::Buffer ###
+
+BinaryCoordBlocks::Buffer::Buffer(QByteArray* xml_data, BinaryCoordBlocks& blocks)
+ : QBuffer(xml_data)
+ , coord_blocks(blocks)
+{
+	// nothing else
+}
+
+BinaryCoordBlocks::Buffer::~Buffer()
+{
+	// nothing, not inlined
+}
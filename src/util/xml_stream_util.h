@@ -22,6 +22,7 @@
 
 #include <vector>
 
+#include <QBuffer>
 #include <QHash>
 #include <QRectF>
 #include <QString>
@@ -33,7 +34,7 @@
 
 // Originally defined in map_coord.h, but we want to avoid the depedency.
 class MapCoord;
-typedef std::vector<MapCoord> MapCoordVector;
+class MapCoordVector;
 
 
 /**
@@ -256,6 +257,25 @@ public:
 	 */
 	void read(MapCoordVector& coords);
 	
+	/**
+	 * Reads the coordinates vector like read(MapCoordVector&), but returns the
+	 * text of the simple text format for parsing at a later time.
+	 * 
+	 * Returns true if the text was returned. Returns false if the coordinates
+	 * were read directly. This happens for binary blocks and for rich XML, and
+	 * as long as the bounds offset is not determined (cf. MapCoord::load()).
+	 */
+	bool readText(MapCoordVector& coords, QString& text);
+	
+	/**
+	 * Parses coordinates text returned by readText().
+	 * 
+	 * Throws a FileFormatException if the text is invalid or if the number
+	 * of coordinates differs from count. This function does not access the
+	 * XML stream. It may be called from other threads.
+	 */
+	static void parseText(const QString& text, unsigned int count, MapCoordVector& coords);
+	
 	/**
 	 * Read tags.
 	 */
@@ -267,6 +287,113 @@ private:
 };
 
 
+/**
+ * BinaryCoordBlocks is a store of coordinate vectors in binary form.
+ * 
+ * The store is attached to the XML stream by means of a Buffer which serves
+ * as the device of the stream. While writing to such a device,
+ * XmlElementWriter::write(const MapCoordVector&) appends the coordinates to
+ * the store, and it writes only the index of the block as an attribute.
+ * XmlElementReader::read(MapCoordVector&) takes the coordinates of elements
+ * which have this attribute from the store of the stream's device. Other
+ * streams, including those of concurrent imports and exports, are not
+ * affected.
+ * 
+ * The data is a sequence of blocks, one for each coordinate vector. A block
+ * holds the number of coordinates as quint32, the x and y coordinates as
+ * qint32, and the flags as quint8, all in little-endian byte order. Blocks
+ * are padded to multiples of four bytes, so that the coordinates are aligned
+ * when the data is memory mapped. The offsets of the blocks form a table of
+ * contents which permits reading the blocks in any order.
+ */
+class BinaryCoordBlocks
+{
+public:
+	class Buffer;
+	
+	/**
+	 * Constructs an empty store, for writing.
+	 */
+	BinaryCoordBlocks();
+	
+	/**
+	 * Constructs a store for reading the given data.
+	 * 
+	 * The offsets are the table of contents. The data is not copied.
+	 */
+	BinaryCoordBlocks(const QByteArray& data, const std::vector<quint64>& offsets);
+	
+	BinaryCoordBlocks(const BinaryCoordBlocks&) = delete;
+	BinaryCoordBlocks& operator=(const BinaryCoordBlocks&) = delete;
+	
+	/**
+	 * Returns the store which is attached to the given device of an XML
+	 * stream, or nullptr.
+	 */
+	static BinaryCoordBlocks* forDevice(QIODevice* device);
+	
+	/**
+	 * Appends a block for the given coordinates.
+	 * 
+	 * @return The index of the new block.
+	 */
+	quint32 append(const MapCoordVector& coords);
+	
+	/**
+	 * Reads the coordinates from the block with the given index.
+	 * 
+	 * Throws a FileFormatException if there is no valid block of this index.
+	 * Bounds offsets are handled like in MapCoord::load().
+	 */
+	void read(quint32 index, MapCoordVector& coords) const;
+	
+	/**
+	 * Returns the blocks.
+	 */
+	const QByteArray& data() const;
+	
+	/**
+	 * Returns the offsets of the blocks in data().
+	 */
+	const std::vector<quint64>& offsets() const;
+	
+private:
+	QByteArray block_data;
+	std::vector<quint64> block_offsets;
+};
+
+
+/**
+ * A buffer for the XML document of a compact file, with the store of the
+ * binary coordinate blocks of this document.
+ * 
+ * \see BinaryCoordBlocks::forDevice()
+ */
+class BinaryCoordBlocks::Buffer : public QBuffer
+{
+public:
+	/**
+	 * Constructs a buffer which operates on the given XML data.
+	 * 
+	 * The store must exist as long as the buffer.
+	 */
+	Buffer(QByteArray* xml_data, BinaryCoordBlocks& blocks);
+	
+	/**
+	 * Destructor.
+	 */
+	~Buffer() override;
+	
+	/**
+	 * Returns the store of the coordinate blocks.
+	 */
+	BinaryCoordBlocks& blocks() const;
+	
+private:
+	BinaryCoordBlocks& coord_blocks;
+};
+
+
 /**
  * @namespace literal
  * @brief Namespace for \c QLatin1String constants
@@ -332,6 +459,7 @@ namespace XmlStreamLiteral
 	static const QLatin1String k("k");
 	
 	static const QLatin1String coord("coord");
+	static const QLatin1String block("block");
 }
 
 
@@ -667,4 +795,33 @@ void XmlElementReader::read(QHash<QString, QString> &tags)
 	}
 }
 
+
+
+inline
+BinaryCoordBlocks* BinaryCoordBlocks::forDevice(QIODevice* device)
+{
+	auto buffer = dynamic_cast<Buffer*>(device);
+	return buffer ? &buffer->blocks() : nullptr;
+}
+
+inline
+const QByteArray& BinaryCoordBlocks::data() const
+{
+	return block_data;
+}
+
+inline
+const std::vector<quint64>& BinaryCoordBlocks::offsets() const
+{
+	return block_offsets;
+}
+
+
+
+inline
+BinaryCoordBlocks& BinaryCoordBlocks::Buffer::blocks() const
+{
+	return coord_blocks;
+}
+
 #endif
@@ -0,0 +1,122 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "batch_exporter_t.h"
+
+#include <QImage>
+#include <QTemporaryDir>
+
+#include "../src/core/batch_exporter.h"
+#include "../src/core/map_color.h"
+#include "../src/global.h"
+#include "../src/map.h"
+#include "../src/object.h"
+#include "../src/symbol_line.h"
+
+
+namespace
+{
+	/** Writes a map with a single line starting at the given position. */
+	bool writeMap(const QString& path, const MapCoord& start)
+	{
+		Map map;
+		auto color = new MapColor(QString("black"), 0);
+		map.addColor(color, 0);
+		auto line = new LineSymbol();
+		line->setColor(color);
+		line->setLineWidth(1.0);
+		map.addSymbol(line, 0);
+		map.addObject(new PathObject(line, MapCoordVector{ start, MapCoord(start.x() + 40.0, start.y() + 20.0) }));
+		return map.exportTo(path);
+	}
+}
+
+
+
+void BatchExporterTest::initTestCase()
+{
+	QCoreApplication::setOrganizationName("OpenOrienteering.org");
+	QCoreApplication::setApplicationName("BatchExporterTest");
+	doStaticInitializations();
+}
+
+
+void BatchExporterTest::parallelExport()
+{
+#ifndef QT_PRINTSUPPORT_LIB
+	QSKIP("The batch export needs Qt PrintSupport.");
+#else
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	
+	// After loading, both maps have the line at the same position.
+	const QString near_path = dir.path() + QLatin1String("/near.omap");
+	const QString far_path  = dir.path() + QLatin1String("/far.omap");
+	QVERIFY(writeMap(near_path, MapCoord(0.0, 0.0)));
+	QVERIFY(writeMap(far_path, MapCoord(200000.0, 200000.0)));
+	
+	BatchExporter::Job prototype;
+	prototype.format = BatchExporter::Image;
+	prototype.print_area = QRectF(-10.0, -10.0, 60.0, 40.0);
+	prototype.scale = 15000;
+	prototype.resolution = 100;
+	
+	std::vector<BatchExporter::Job> jobs;
+	for (int i = 0; i < 16; ++i)
+	{
+		auto job = prototype;
+		job.input_path  = (i % 2) ? far_path : near_path;
+		job.output_path = dir.path() + QString("/map-%1.png").arg(i);
+		jobs.push_back(job);
+	}
+	
+	// The reference, exported one after the other.
+	auto reference_job = jobs[0];
+	reference_job.output_path = dir.path() + QLatin1String("/reference.png");
+	QVERIFY(BatchExporter::exportMap(reference_job).success);
+	QImage reference(reference_job.output_path);
+	QVERIFY(!reference.isNull());
+	
+	auto far_job = jobs[1];
+	far_job.output_path = dir.path() + QLatin1String("/far.png");
+	QVERIFY(BatchExporter::exportMap(far_job).success);
+	QCOMPARE(QImage(far_job.output_path), reference);
+	
+	const auto results = BatchExporter::run(jobs, 4);
+	QCOMPARE(results.size(), jobs.size());
+	for (std::size_t i = 0; i < jobs.size(); ++i)
+	{
+		QVERIFY2(results[i].success, qPrintable(results[i].error));
+		QCOMPARE(QImage(jobs[i].output_path), reference);
+	}
+#endif
+}
+
+
+/*
+ * We select a non-standard QPA because we don't need a real GUI window.
+ * 
+ * Normally, the "offscreen" plugin would be the correct one.
+ * However, it bails out with a QFontDatabase error (cf. QTBUG-33674)
+ */
+auto qpa_selected = qputenv("QT_QPA_PLATFORM", "minimal");
+
+
+QTEST_MAIN(BatchExporterTest)
@@ -0,0 +1,46 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_BATCH_EXPORTER_T_H
+#define _OPENORIENTEERING_BATCH_EXPORTER_T_H
+
+#include <QtTest/QtTest>
+
+
+/**
+ * @test Tests the headless batch export.
+ */
+class BatchExporterTest : public QObject
+{
+Q_OBJECT
+private slots:
+	void initTestCase();
+	
+	/**
+	 * Tests that exporting maps in parallel gives the same output as
+	 * exporting them one after the other.
+	 * 
+	 * One of the maps is far from the origin, so that loading it sets a
+	 * bounds offset which must not leak into the loading of the other map.
+	 */
+	void parallelExport();
+};
+
+#endif
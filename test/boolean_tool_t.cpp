@@ -0,0 +1,105 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "boolean_tool_t.h"
+
+#include <initializer_list>
+#include <memory>
+
+#include "../src/object.h"
+#include "../src/symbol_area.h"
+#include "../src/tool_boolean.h"
+
+#include "map_generator.h"
+
+
+namespace
+{
+	/** The radius of the rings, in mm. */
+	const double ring_radius = 100.0;
+}
+
+
+void BooleanToolTest::paths_data()
+{
+	QTest::addColumn<int>("num_vertices");
+	QTest::addColumn<bool>("curves");
+	for (int num_vertices : { 10, 100, 1000, 10000 })
+	{
+		QTest::newRow(qPrintable(QString("straight, num_vertices = %1").arg(num_vertices))) << num_vertices << false;
+		QTest::newRow(qPrintable(QString("curved, num_vertices = %1").arg(num_vertices))) << num_vertices << true;
+	}
+}
+
+void BooleanToolTest::pathObjectToPolygons_data()
+{
+	paths_data();
+}
+
+void BooleanToolTest::pathObjectToPolygons()
+{
+	QFETCH(int, num_vertices);
+	QFETCH(bool, curves);
+	MapGenerator generator { MapGenerator::Options() };
+	AreaSymbol symbol;
+	PathObject path(&symbol, generator.generateRing(num_vertices, ring_radius, curves));
+	path.update();
+	
+	ClipperLib::Paths polygons;
+	BooleanTool::PolyMap polymap;
+	QBENCHMARK
+	{
+		polygons.clear();
+		polymap.clear();
+		BooleanTool::pathObjectToPolygons(&path, polygons, &polymap);
+	}
+	QCOMPARE(int(polygons.size()), 1);
+	QVERIFY(polygons.front().size() >= std::size_t(num_vertices));
+}
+
+void BooleanToolTest::polygonToPathPart_data()
+{
+	paths_data();
+}
+
+void BooleanToolTest::polygonToPathPart()
+{
+	QFETCH(int, num_vertices);
+	QFETCH(bool, curves);
+	MapGenerator generator { MapGenerator::Options() };
+	AreaSymbol symbol;
+	PathObject path(&symbol, generator.generateRing(num_vertices, ring_radius, curves));
+	path.update();
+	
+	ClipperLib::Paths polygons;
+	BooleanTool::PolyMap polymap;
+	BooleanTool::pathObjectToPolygons(&path, polygons, &polymap);
+	QCOMPARE(int(polygons.size()), 1);
+	
+	std::unique_ptr<PathObject> result;
+	QBENCHMARK
+	{
+		result.reset(new PathObject(&symbol));
+		BooleanTool::polygonToPathPart(polygons.front(), polymap, result.get());
+	}
+	QCOMPARE(int(result->parts().size()), 1);
+}
+
+
+QTEST_MAIN(BooleanToolTest)
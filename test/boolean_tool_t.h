@@ -0,0 +1,50 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_BOOLEAN_TOOL_T_H
+#define _OPENORIENTEERING_BOOLEAN_TOOL_T_H
+
+#include <QtTest/QtTest>
+
+
+/**
+ * @test Benchmarks the conversion between paths and the polygons of
+ * ClipperLib in BooleanTool.
+ *
+ * The paths are closed rings (cf. MapGenerator::generateRing()) with an
+ * increasing number of vertices, with straight or with curved edges.
+ */
+class BooleanToolTest : public QObject
+{
+Q_OBJECT
+private slots:
+	/** Converts a path to a polygon, recording the points for the way back. */
+	void pathObjectToPolygons();
+	void pathObjectToPolygons_data();
+	
+	/** Converts a polygon to a path, rebuilding the curves. */
+	void polygonToPathPart();
+	void polygonToPathPart_data();
+
+private:
+	/** Adds the columns and rows of the sizes and kinds of the paths. */
+	void paths_data();
+};
+
+#endif
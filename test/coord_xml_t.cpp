@@ -24,6 +24,8 @@
 #include "../src/file_format_xml.h"
 #include "../src/util/xml_stream_util.h"
 
+#include "map_generator.h"
+
 namespace literal
 {
 	static const QLatin1String x("x");
@@ -863,6 +865,47 @@ void CoordXmlTest::readFastImplementation()
 }
 
 
+void CoordXmlTest::readRing_data()
+{
+	common_data();
+}
+
+void CoordXmlTest::readRing()
+{
+	QFETCH(int, num_coords);
+	MapGenerator generator { MapGenerator::Options() };
+	const MapCoordVector ring = generator.generateRing(num_coords, 100.0, true);
+	
+	XMLFileFormat::active_version = 6; // Activate fast text format.
+	
+	QBuffer data;
+	data.open(QBuffer::ReadWrite);
+	{
+		QXmlStreamWriter xml(&data);
+		xml.setAutoFormatting(false);
+		xml.writeStartDocument();
+		{
+			XmlElementWriter element(xml, QLatin1String("coords"));
+			element.write(ring);
+		}
+		xml.writeEndDocument();
+	}
+	data.close();
+	
+	MapCoordVector coords;
+	coords.reserve(ring.size());
+	QBENCHMARK
+	{
+		coords.clear();
+		QXmlStreamReader xml(data.data());
+		xml.readNextStartElement();
+		XmlElementReader element(xml);
+		element.read(coords);
+	}
+	
+	QVERIFY(coords == ring);
+}
+
 bool CoordXmlTest::compare_all(MapCoordVector& coords, MapCoord& expected) const
 {
 	return std::all_of(begin(coords), end(coords), [expected](const MapCoord& coord){ return coord == expected; });
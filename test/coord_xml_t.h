@@ -77,6 +77,13 @@ private slots:
 	void readFastImplementation();
 	void readFastImplementation_data();
 	
+	/**
+	 * Calls the actual fast implementation from MapCoord for the varying
+	 * coordinates and flags of a curved ring (cf. MapGenerator).
+	 */
+	void readRing();
+	void readRing_data();
+	
 private:
 	/** The common test data setup. */
 	void common_data();
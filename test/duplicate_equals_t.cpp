@@ -19,6 +19,7 @@
 
 #include "duplicate_equals_t.h"
 
+#include "../src/core/map_color.h"
 #include "../src/global.h"
 #include "../src/map.h"
 #include "../src/mapper_resource.h"
@@ -50,6 +51,7 @@ void DuplicateEqualsTest::symbols()
 		Symbol* original = map->getSymbol(symbol);
 		Symbol* duplicate = original->duplicate();
 		QVERIFY(original->equals(duplicate));
+		QCOMPARE(original->contentHash(), duplicate->contentHash());
 		delete duplicate;
 	}
 	
@@ -57,6 +59,34 @@ void DuplicateEqualsTest::symbols()
 }
 
 
+void DuplicateEqualsTest::colors_data()
+{
+	QTest::addColumn<QString>("map_filename");
+	QTest::newRow(map_filename.toLocal8Bit()) << map_filename;
+}
+
+void DuplicateEqualsTest::colors()
+{
+	QFETCH(QString, map_filename);
+	Map* map = new Map();
+	map->loadFrom(map_filename, NULL, NULL, false, false);
+	
+	for (int color = 0; color < map->getNumColors(); ++color)
+	{
+		const MapColor* original = map->getColor(color);
+		MapColor duplicate(*original);
+		QVERIFY(original->equals(duplicate, true));
+		QCOMPARE(original->contentHash(), duplicate.contentHash());
+		
+		duplicate.setPriority(original->getPriority() + 1);
+		QVERIFY(original->equals(duplicate, false));
+		QCOMPARE(original->contentHash(), duplicate.contentHash());
+	}
+	
+	delete map;
+}
+
+
 void DuplicateEqualsTest::objects_data()
 {
 	QTest::addColumn<QString>("map_filename");
@@ -24,7 +24,8 @@
 
 
 /**
- * @test Test that duplicates of symbols and objects are equal to their originals.
+ * @test Test that duplicates of symbols, colors and objects are equal to their
+ *       originals, and that they have the same content hash.
  */
 class DuplicateEqualsTest : public QObject
 {
@@ -35,6 +36,9 @@ private slots:
 	void symbols();
 	void symbols_data();
 	
+	void colors();
+	void colors_data();
+	
 	void objects();
 	void objects_data();
 	
@@ -0,0 +1,416 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "file_format_io_t.h"
+
+#include <functional>
+#include <initializer_list>
+
+#include <QBuffer>
+
+#include "../src/file_import_export.h"
+#include "../src/file_format_ocad8.h"
+#include "../src/file_format_registry.h"
+#include "../src/global.h"
+#include "../src/map.h"
+#include "../src/mapper_resource.h"
+#include "../src/settings.h"
+
+#include "map_generator.h"
+
+
+namespace
+{
+	const QString generated_prefix = QString("generated:");
+	
+	/** The sizes of the synthetic maps, in objects. */
+	const std::initializer_list<int> generated_sizes = { 1000, 10000, 100000 };
+	
+	/** Returns a short name for the source, for the rows of the data tables. */
+	QString sourceName(const QString& source)
+	{
+		if (source.startsWith(generated_prefix))
+			return QString("generated map with %1 objects").arg(source.mid(generated_prefix.length()));
+		return QFileInfo(source).fileName();
+	}
+	
+	/** Returns the OCD version of the given file data, or 0 if it is unknown. */
+	int ocdVersion(const QByteArray& data)
+	{
+		// The version follows the vendor mark and the file type.
+		if (data.size() < 6)
+			return 0;
+		return quint8(data[4]) + (quint8(data[5]) << 8);
+	}
+
+#ifdef Q_OS_LINUX
+	/** Returns the given value (in kB) from /proc/self/status, or -1. */
+	qint64 procStatus(const QByteArray& key)
+	{
+		QFile status("/proc/self/status");
+		if (!status.open(QIODevice::ReadOnly))
+			return -1;
+		
+		// Cannot use atEnd() on this special file.
+		for (QByteArray line = status.readLine(); !line.isEmpty(); line = status.readLine())
+		{
+			if (line.startsWith(key))
+				return line.mid(key.length()).trimmed().split(' ').front().toLongLong();
+		}
+		return -1;
+	}
+	
+	/** Resets the peak resident memory. Returns false if not supported. */
+	bool resetPeakMemory()
+	{
+		QFile clear_refs("/proc/self/clear_refs");
+		return clear_refs.open(QIODevice::WriteOnly) && clear_refs.write("5") == 1;
+	}
+#endif
+}
+
+
+
+void FileFormatIoTest::initTestCase()
+{
+	QCoreApplication::setOrganizationName("OpenOrienteering.org");
+	QCoreApplication::setApplicationName("FileFormatIoTest");
+	Settings::getInstance().setSetting(Settings::General_NewOcd8Implementation, true);
+	
+	doStaticInitializations();
+	if (!FileFormats.findFormat("OCAD78"))
+		FileFormats.registerFormat(new OCAD8FileFormat());
+	
+	for (const auto& test_file : { "COPY_OF_test_map.omap", "COPY_OF_spotcolor_overprint.xmap" })
+	{
+		const QString path = MapperResource::locate(MapperResource::TEST_DATA, QString::fromLatin1(test_file));
+		QVERIFY2(!path.isEmpty(), QString("Unable to locate %1").arg(test_file).toLocal8Bit());
+		map_sources.push_back(path);
+	}
+	
+	const QDir examples_dir(QFileInfo(__FILE__).dir().absoluteFilePath(QString("../examples")));
+	for (const auto& example : examples_dir.entryInfoList(QStringList() << "*.omap", QDir::Files, QDir::Name))
+		map_sources.push_back(example.absoluteFilePath());
+	
+	for (const auto num_objects : generated_sizes)
+		map_sources.push_back(generated_prefix + QString::number(num_objects));
+	
+	const QString data_dir = QString::fromLocal8Bit(qgetenv("MAPPER_BENCHMARK_DATA"));
+	if (!data_dir.isEmpty())
+	{
+		for (const auto& file : QDir(data_dir).entryInfoList(QStringList() << "*.ocd", QDir::Files, QDir::Name))
+			ocd_files.push_back(file.absoluteFilePath());
+	}
+}
+
+
+Map& FileFormatIoTest::sourceMap(const QString& source)
+{
+	auto& map = maps[source];
+	if (!map)
+	{
+		map.reset(new Map());
+		if (source.startsWith(generated_prefix))
+		{
+			MapGenerator::Options options;
+			options.num_objects = source.mid(generated_prefix.length()).toInt();
+			if (MapGenerator::loadSymbolSet(*map, MapGenerator::isomSymbolSetPath()))
+				MapGenerator(options).generateObjects(*map);
+		}
+		else
+			map->loadFrom(source, nullptr, nullptr, false, false);
+	}
+	return *map;
+}
+
+QByteArray FileFormatIoTest::exportedData(const QString& source, const QString& format_id, bool auto_formatting)
+{
+	return exportMap(sourceMap(source), FileFormats.findFormat(format_id), auto_formatting);
+}
+
+QByteArray FileFormatIoTest::sourceData(const QString& source, const QString& format_id)
+{
+	if (source.endsWith(".ocd", Qt::CaseInsensitive))
+	{
+		QFile file(source);
+		if (!file.open(QIODevice::ReadOnly))
+			return QByteArray();
+		return file.readAll();
+	}
+	return exportedData(source, format_id, false);
+}
+
+QByteArray FileFormatIoTest::exportMap(Map& map, const FileFormat* format, bool auto_formatting)
+{
+	QBuffer buffer;
+	buffer.open(QIODevice::WriteOnly);
+	try
+	{
+		std::unique_ptr<Exporter> exporter(format->createExporter(&buffer, &map, nullptr));
+		if (!exporter)
+			return QByteArray();
+		if (format->id() == "XML")
+			exporter->setOption("autoFormatting", auto_formatting);
+		exporter->doExport();
+	}
+	catch (std::exception& e)
+	{
+		qWarning("Export failed: %s", e.what());
+		return QByteArray();
+	}
+	buffer.close();
+	return buffer.data();
+}
+
+std::unique_ptr<Map> FileFormatIoTest::importMap(const QByteArray& data, const FileFormat* format, const QRectF& clip_rect)
+{
+	QBuffer buffer;
+	buffer.setData(data);
+	buffer.open(QIODevice::ReadOnly);
+	std::unique_ptr<Map> map(new Map());
+	try
+	{
+		std::unique_ptr<Importer> importer(format->createImporter(&buffer, map.get(), nullptr));
+		if (!importer)
+			return nullptr;
+		if (clip_rect.isValid())
+			importer->setOption("clipRect", clip_rect);
+		importer->doImport(false);
+		importer->finishImport();
+	}
+	catch (std::exception& e)
+	{
+		qWarning("Import failed: %s", e.what());
+		return nullptr;
+	}
+	return map;
+}
+
+
+void FileFormatIoTest::xml_data()
+{
+	QTest::addColumn<QString>("source");
+	QTest::addColumn<bool>("auto_formatting");
+	for (const auto& source : map_sources)
+	{
+		QTest::newRow(QString("%1 as .omap").arg(sourceName(source)).toLocal8Bit()) << source << false;
+		QTest::newRow(QString("%1 as .xmap").arg(sourceName(source)).toLocal8Bit()) << source << true;
+	}
+}
+
+void FileFormatIoTest::importXml_data()
+{
+	xml_data();
+}
+
+void FileFormatIoTest::importXml()
+{
+	QFETCH(QString, source);
+	QFETCH(bool, auto_formatting);
+	
+	const FileFormat* format = FileFormats.findFormat("XML");
+	QVERIFY(format);
+	const QByteArray data = exportedData(source, "XML", auto_formatting);
+	QVERIFY(!data.isEmpty());
+	
+	QBENCHMARK
+	{
+		QVERIFY(importMap(data, format));
+	}
+}
+
+void FileFormatIoTest::exportXml_data()
+{
+	xml_data();
+}
+
+void FileFormatIoTest::exportXml()
+{
+	QFETCH(QString, source);
+	QFETCH(bool, auto_formatting);
+	
+	const FileFormat* format = FileFormats.findFormat("XML");
+	QVERIFY(format);
+	Map& map = sourceMap(source);
+	QVERIFY(map.getNumObjects() > 0);
+	
+	QBENCHMARK
+	{
+		QVERIFY(!exportMap(map, format, auto_formatting).isEmpty());
+	}
+}
+
+
+void FileFormatIoTest::ocd_data()
+{
+	QTest::addColumn<QString>("source");
+	for (const auto& source : map_sources)
+		QTest::newRow(sourceName(source).toLocal8Bit()) << source;
+	for (const auto& source : ocd_files)
+		QTest::newRow(sourceName(source).toLocal8Bit()) << source;
+}
+
+void FileFormatIoTest::importOcd_data()
+{
+	ocd_data();
+}
+
+void FileFormatIoTest::importOcd()
+{
+	QFETCH(QString, source);
+	
+	const FileFormat* format = FileFormats.findFormat("OCD");
+	QVERIFY(format);
+	const QByteArray data = sourceData(source, "OCAD78");
+	QVERIFY(!data.isEmpty());
+	qDebug("OCD version %d", ocdVersion(data));
+	
+	QBENCHMARK
+	{
+		QVERIFY(importMap(data, format));
+	}
+}
+
+void FileFormatIoTest::importOcad8_data()
+{
+	ocd_data();
+}
+
+void FileFormatIoTest::importOcad8()
+{
+	QFETCH(QString, source);
+	
+	const FileFormat* format = FileFormats.findFormat("OCAD78");
+	QVERIFY(format);
+	const QByteArray data = sourceData(source, "OCAD78");
+	QVERIFY(!data.isEmpty());
+	if (ocdVersion(data) > 8)
+		QSKIP("libocad reads OCD files up to version 8 only");
+	
+	QBENCHMARK
+	{
+		QVERIFY(importMap(data, format));
+	}
+}
+
+void FileFormatIoTest::importOcad8Region_data()
+{
+	ocd_data();
+}
+
+void FileFormatIoTest::importOcad8Region()
+{
+	QFETCH(QString, source);
+	
+	const FileFormat* format = FileFormats.findFormat("OCAD78");
+	QVERIFY(format);
+	const QByteArray data = sourceData(source, "OCAD78");
+	QVERIFY(!data.isEmpty());
+	if (ocdVersion(data) > 8)
+		QSKIP("libocad reads OCD files up to version 8 only");
+	
+	auto full_map = importMap(data, format);
+	QVERIFY(full_map);
+	const QRectF extent = full_map->calculateExtent();
+	if (!extent.isValid())
+		QSKIP("The map has no extent");
+	const QRectF region(extent.topLeft(), extent.size() / 2);
+	
+	auto clipped_map = importMap(data, format, region);
+	QVERIFY(clipped_map);
+	QVERIFY(clipped_map->getNumObjects() <= full_map->getNumObjects());
+	
+	QBENCHMARK
+	{
+		QVERIFY(importMap(data, format, region));
+	}
+}
+
+void FileFormatIoTest::exportOcad8_data()
+{
+	QTest::addColumn<QString>("source");
+	for (const auto& source : map_sources)
+		QTest::newRow(sourceName(source).toLocal8Bit()) << source;
+}
+
+void FileFormatIoTest::exportOcad8()
+{
+	QFETCH(QString, source);
+	
+	const FileFormat* format = FileFormats.findFormat("OCAD78");
+	QVERIFY(format);
+	Map& map = sourceMap(source);
+	QVERIFY(map.getNumObjects() > 0);
+	
+	QBENCHMARK
+	{
+		QVERIFY(!exportMap(map, format, false).isEmpty());
+	}
+}
+
+
+void FileFormatIoTest::peakMemory_data()
+{
+	QTest::addColumn<QString>("operation");
+	QTest::addColumn<QString>("source");
+	for (const auto& operation : { "importXml", "exportXml", "importOcd", "importOcad8", "exportOcad8" })
+	{
+		for (const auto& source : map_sources)
+			QTest::newRow(QString("%1 %2").arg(operation, sourceName(source)).toLocal8Bit()) << QString(operation) << source;
+	}
+}
+
+void FileFormatIoTest::peakMemory()
+{
+#ifndef Q_OS_LINUX
+	QSKIP("Peak memory is measured on Linux only");
+#else
+	QFETCH(QString, operation);
+	QFETCH(QString, source);
+	
+	// Prepare the input outside of the measurement.
+	std::function<bool ()> run;
+	if (operation == "importXml" || operation == "importOcd" || operation == "importOcad8")
+	{
+		const QString format_id = (operation == "importXml") ? "XML" : (operation == "importOcd") ? "OCD" : "OCAD78";
+		const FileFormat* format = FileFormats.findFormat(format_id);
+		const QByteArray data = (operation == "importXml") ? exportedData(source, "XML") : sourceData(source, "OCAD78");
+		QVERIFY(format && !data.isEmpty());
+		run = [data, format]() { return bool(importMap(data, format)); };
+	}
+	else
+	{
+		const FileFormat* format = FileFormats.findFormat((operation == "exportXml") ? "XML" : "OCAD78");
+		Map* map = &sourceMap(source);
+		QVERIFY(format && map->getNumObjects() > 0);
+		run = [map, format]() { return !exportMap(*map, format, false).isEmpty(); };
+	}
+	
+	if (!resetPeakMemory())
+		QSKIP("Cannot reset the peak memory");
+	const qint64 baseline = procStatus("VmRSS:");
+	QVERIFY(run());
+	const qint64 peak = procStatus("VmHWM:");
+	QVERIFY(baseline >= 0 && peak >= 0);
+	QTest::setBenchmarkResult(qreal(qMax(qint64(0), peak - baseline)) * 1024, QTest::BytesAllocated);
+#endif
+}
+
+
+QTEST_MAIN(FileFormatIoTest)
@@ -0,0 +1,114 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_FILE_FORMAT_IO_T_H
+#define _OPENORIENTEERING_FILE_FORMAT_IO_T_H
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+class FileFormat;
+class Map;
+
+
+/**
+ * @test Benchmarks reading and writing maps in the supported file formats.
+ *
+ * The maps are the test maps, the example maps, and synthetic maps of
+ * increasing size, for scaling curves. The synthetic maps are generated from
+ * a fixed seed, so that the results are reproducible. OCD files of other
+ * versions (e.g. 9 to 11, which cannot be written) are taken from the
+ * directory given by the environment variable MAPPER_BENCHMARK_DATA.
+ *
+ * The files are read from and written to memory buffers, in order to measure
+ * the file formats rather than the disk. On Linux, peakMemory() measures the
+ * growth of the resident memory during each operation.
+ */
+class FileFormatIoTest : public QObject
+{
+Q_OBJECT
+private slots:
+	/** Initialization. */
+	void initTestCase();
+	
+	/** Reads .omap and .xmap data with XMLFileImporter. */
+	void importXml();
+	void importXml_data();
+	
+	/** Writes .omap and .xmap data with XMLFileExporter. */
+	void exportXml();
+	void exportXml_data();
+	
+	/** Reads OCD data with OcdFileImport. */
+	void importOcd();
+	void importOcd_data();
+	
+	/** Reads OCD data with OCAD8FileImport (libocad). */
+	void importOcad8();
+	void importOcad8_data();
+	
+	/** Reads a quarter of the area of OCD data with OCAD8FileImport. */
+	void importOcad8Region();
+	void importOcad8Region_data();
+	
+	/** Writes OCD data with OCAD8FileExport (libocad). */
+	void exportOcad8();
+	void exportOcad8_data();
+	
+	/** Measures the peak memory of each operation. */
+	void peakMemory();
+	void peakMemory_data();
+
+private:
+	/** Adds a row for each source map and for both XML flavours. */
+	void xml_data();
+	
+	/** Adds a row for each source map, and for each additional OCD file. */
+	void ocd_data();
+	
+	/** Returns the loaded or generated source map, see map_sources. */
+	Map& sourceMap(const QString& source);
+	
+	/** Returns the data of the source map, exported in the given format. */
+	QByteArray exportedData(const QString& source, const QString& format_id, bool auto_formatting = false);
+	
+	/** Returns the data of the given source, as a file of the given format. */
+	QByteArray sourceData(const QString& source, const QString& format_id);
+	
+	/** Exports the map in the given format. */
+	static QByteArray exportMap(Map& map, const FileFormat* format, bool auto_formatting);
+	
+	/** Imports the data in the given format into a new map. */
+	static std::unique_ptr<Map> importMap(const QByteArray& data, const FileFormat* format, const QRectF& clip_rect = QRectF());
+	
+	/**
+	 * The map sources: paths of map files, and "generated:<number of objects>".
+	 */
+	std::vector<QString> map_sources;
+	
+	/** Additional OCD files, which are only read. */
+	std::vector<QString> ocd_files;
+	
+	std::map<QString, std::unique_ptr<Map>> maps;
+};
+
+#endif
@@ -20,17 +20,30 @@
 
 #include "file_format_t.h"
 
+#include <cstring>
+
+#include <QSignalSpy>
+#include <QtEndian>
+#include <QXmlStreamWriter>
+
 #include "../src/core/georeferencing.h"
 #include "../src/core/map_color.h"
 #include "../src/core/map_grid.h"
 #include "../src/core/map_printer.h"
+#include "../src/core/map_view.h"
+#include "../src/core/zlib_device.h"
 #include "../src/file_import_export.h"
 #include "../src/file_format_ocad8.h"
 #include "../src/file_format_registry.h"
+#include "../src/file_format_xml.h"
 #include "../src/global.h"
+#include "../src/map_part.h"
 #include "../src/mapper_resource.h"
 #include "../src/object.h"
+#include "../src/object_undo.h"
 #include "../src/settings.h"
+#include "../src/symbol_area.h"
+#include "../src/symbol_line.h"
 #include "../src/template.h"
 #include "../src/undo_manager.h"
 
@@ -77,6 +90,71 @@ namespace QTest
 
 
 
+namespace
+{
+	/** Adds a line with the first symbol at the given y, and pushes the undo step. */
+	void addLine(Map& map, double y)
+	{
+		auto object = new PathObject(map.getSymbol(0), MapCoordVector{ MapCoord(0.0, y), MapCoord(10.0, y) });
+		auto undo_step = new DeleteObjectsUndoStep(&map);
+		undo_step->setPartIndex(map.getCurrentPartIndex());
+		undo_step->addObject(map.addObject(object));
+		map.push(undo_step);
+	}
+	
+	/** Creates a map with a line symbol and a few objects. */
+	void initCompressedTestMap(Map& map)
+	{
+		auto color = new MapColor(QString("black"), 0);
+		map.addColor(color, 0);
+		auto line = new LineSymbol();
+		line->setColor(color);
+		line->setLineWidth(0.5);
+		map.addSymbol(line, 0);
+		for (int i = 0; i < 100; ++i)
+		{
+			map.addObject(new PathObject(line, MapCoordVector{
+			    MapCoord(qreal(i), 0.0, MapCoord::CurveStart), MapCoord(qreal(i), 10.0), MapCoord(i + 10.0, 10.0),
+			    MapCoord(i + 10.0, 0.0, MapCoord::DashPoint), MapCoord(i + 20.0, 0.0) }));
+		}
+	}
+	
+	/** Returns the data in a compressed container. */
+	QByteArray compressedContainer(const QByteArray& payload)
+	{
+		QByteArray data(16, '\0');
+		auto pos = reinterpret_cast<uchar*>(data.data());
+		std::memcpy(pos, CompressedXMLFileFormat::magic_bytes, sizeof(CompressedXMLFileFormat::magic_bytes));
+		qToLittleEndian<quint32>(CompressedXMLFileFormat::container_version, pos + 8);
+		qToLittleEndian<quint32>(CompressedXMLFileFormat::Zlib, pos + 12);
+		
+		QBuffer buffer(&data);
+		buffer.open(QIODevice::Append);
+		ZlibOutputDevice device(&buffer);
+		device.open(QIODevice::WriteOnly);
+		device.write(payload);
+		device.finish();
+		return data;
+	}
+	
+	/** Returns true if the objects of the current parts are equal. */
+	bool equalObjects(const Map& map, const Map& other)
+	{
+		const MapPart* part = map.getCurrentPart();
+		const MapPart* other_part = other.getCurrentPart();
+		if (part->getNumObjects() != other_part->getNumObjects())
+			return false;
+		for (int i = 0; i < part->getNumObjects(); ++i)
+		{
+			if (!part->getObject(i)->equals(other_part->getObject(i), false))
+				return false;
+		}
+		return true;
+	}
+}
+
+
+
 void FileFormatTest::initTestCase()
 {
 	QCoreApplication::setOrganizationName("OpenOrienteering.org");
@@ -222,6 +300,515 @@ void FileFormatTest::saveAndLoad()
 	delete original;
 }
 
+void FileFormatTest::importRegion_data()
+{
+	QTest::addColumn<QString>("format_id");
+	QTest::addColumn<bool>("clip_areas");
+	
+	for (auto format : FileFormats.formats())
+	{
+		if (format->supportsExport() && format->supportsImport())
+		{
+			QTest::newRow(format->id().toLocal8Bit()) << format->id() << false;
+			QTest::newRow(QString(format->id() % " with clipping").toLocal8Bit()) << format->id() << true;
+		}
+	}
+}
+
+void FileFormatTest::importRegion()
+{
+	QFETCH(QString, format_id);
+	QFETCH(bool, clip_areas);
+	
+	const FileFormat* format = FileFormats.findFormat(format_id);
+	QVERIFY(format);
+	
+	Map original;
+	auto color = new MapColor(QString("black"), 0);
+	original.addColor(color, 0);
+	auto area = new AreaSymbol();
+	area->setColor(color);
+	original.addSymbol(area, 0);
+	auto line = new LineSymbol();
+	line->setColor(color);
+	line->setLineWidth(0.5);
+	original.addSymbol(line, 1);
+	
+	auto square = new PathObject(area, MapCoordVector{ MapCoord(0.0, 0.0), MapCoord(40.0, 0.0), MapCoord(40.0, 40.0), MapCoord(0.0, 40.0) });
+	square->closeAllParts();
+	original.addObject(square);
+	original.addObject(new PathObject(line, MapCoordVector{ MapCoord(100.0, 100.0), MapCoord(120.0, 100.0) }));
+	
+	QBuffer buffer;
+	buffer.open(QIODevice::ReadWrite);
+	QScopedPointer<Exporter> exporter(format->createExporter(&buffer, &original, NULL));
+	QVERIFY(exporter);
+	exporter->doExport();
+	buffer.seek(0);
+	
+	Map map;
+	QScopedPointer<Importer> importer(format->createImporter(&buffer, &map, NULL));
+	QVERIFY(importer);
+	importer->setOption("clipRect", QRectF(-10.0, -10.0, 30.0, 30.0));
+	importer->setOption("clipAreas", clip_areas);
+	importer->doImport(false);
+	importer->finishImport();
+	
+	// Only the area crosses the region.
+	QCOMPARE(map.getNumObjects(), 1);
+	const Object* object = map.getCurrentPart()->getObject(0);
+	QCOMPARE(object->getSymbol()->getType(), Symbol::Area);
+	
+	qreal max_x = 0;
+	for (const MapCoord& coord : object->getRawCoordinateVector())
+		max_x = qMax(max_x, coord.x());
+	if (clip_areas)
+		QVERIFY(max_x < 20.1);
+	else
+		QCOMPARE(max_x, 40.0);
+}
+
+void FileFormatTest::deferredLoadingError()
+{
+	const FileFormat* format = FileFormats.findFormat("XML");
+	QVERIFY(format);
+	
+	Map original;
+	auto color = new MapColor(QString("black"), 0);
+	original.addColor(color, 0);
+	auto line = new LineSymbol();
+	line->setColor(color);
+	line->setLineWidth(0.5);
+	original.addSymbol(line, 0);
+	original.addObject(new PathObject(line, MapCoordVector{ MapCoord(0.0, 0.0), MapCoord(10.0, 0.0) }));
+	original.addPart(new MapPart(QString("deferred"), &original), 1);
+	original.addObject(new PathObject(line, MapCoordVector{ MapCoord(50.0, 50.0), MapCoord(60.0, 50.0) }), 1);
+	QCOMPARE(original.getCurrentPartIndex(), std::size_t(0));
+	
+	QBuffer buffer;
+	buffer.open(QIODevice::ReadWrite);
+	QScopedPointer<Exporter> exporter(format->createExporter(&buffer, &original, NULL));
+	QVERIFY(exporter);
+	exporter->doExport();
+	
+	// Break the coordinates of the second part, keeping the XML well-formed.
+	QByteArray data = buffer.data();
+	QVERIFY(data.contains("50000 50000;"));
+	data.replace("50000 50000;", "garbage;");
+	QBuffer corrupt(&data);
+	corrupt.open(QIODevice::ReadOnly);
+	
+	auto& settings = Settings::getInstance();
+	const auto defer_loading = settings.getSetting(Settings::General_DeferMapPartLoading);
+	settings.setSettingInCache(Settings::General_DeferMapPartLoading, true);
+	
+	Map map;
+	QSignalSpy failures(&map, SIGNAL(mapPartLoadingFailed(QString,QString)));
+	QScopedPointer<Importer> importer(format->createImporter(&corrupt, &map, NULL));
+	QVERIFY(importer);
+	importer->doImport(false);
+	importer->finishImport();
+	
+	settings.setSettingInCache(Settings::General_DeferMapPartLoading, defer_loading);
+	
+	QCOMPARE(map.getNumParts(), 2);
+	QVERIFY(map.getPart(0)->isLoaded());
+	QCOMPARE(map.getPart(0)->getNumObjects(), 1);
+	
+	auto part = map.getPart(1);
+	QVERIFY(!part->isLoaded());
+	QCOMPARE(part->getNumObjects(), 0);
+	QVERIFY(!part->isLoaded());
+	QVERIFY(!part->loadingError().isEmpty());
+	QCOMPARE(failures.count(), 1);
+	QCOMPARE(failures.front().at(0).toString(), QString("deferred"));
+	
+	// A failed part is not retried.
+	QCOMPARE(part->getNumObjects(), 0);
+	QCOMPARE(failures.count(), 1);
+	
+	// Saving must not drop the objects of the failed part.
+	QBuffer out;
+	out.open(QIODevice::WriteOnly);
+	QXmlStreamWriter xml(&out);
+	QVERIFY_EXCEPTION_THROWN(part->save(xml), FileFormatException);
+}
+
+void FileFormatTest::compactFormatRoundTrip_data()
+{
+	QTest::addColumn<bool>("defer_loading");
+	
+	QTest::newRow("not deferred") << false;
+	QTest::newRow("deferred") << true;
+}
+
+void FileFormatTest::compactFormatRoundTrip()
+{
+	QFETCH(bool, defer_loading);
+	
+	const FileFormat* format = FileFormats.findFormat("XML-Compact");
+	QVERIFY(format);
+	
+	Map original;
+	auto color = new MapColor(QString("black"), 0);
+	original.addColor(color, 0);
+	auto line = new LineSymbol();
+	line->setColor(color);
+	line->setLineWidth(0.5);
+	original.addSymbol(line, 0);
+	original.addPart(new MapPart(QString("second"), &original), 1);
+	
+	auto path = new PathObject(line, MapCoordVector{
+	    MapCoord(0.0, 0.0, MapCoord::CurveStart), MapCoord(10.0, 0.0), MapCoord(20.0, 10.0),
+	    MapCoord(30.0, 10.0, MapCoord::DashPoint), MapCoord(40.0, 0.0, MapCoord::HolePoint),
+	    MapCoord(-1000.5, 2000.25), MapCoord(60.0, 50.0), MapCoord(60.0, 60.0) });
+	original.addObject(path, 0);
+	original.addObject(path->duplicate(), 1);
+	auto area = new PathObject(line, MapCoordVector{ MapCoord(0.0, 0.0), MapCoord(5.0, 0.0), MapCoord(5.0, 5.0) });
+	area->closeAllParts();
+	original.addObject(area, 1);
+	
+	QBuffer buffer;
+	buffer.open(QIODevice::ReadWrite);
+	QScopedPointer<Exporter> exporter(format->createExporter(&buffer, &original, NULL));
+	QVERIFY(exporter);
+	exporter->doExport();
+	buffer.seek(0);
+	
+	// The coordinates are stored in binary blocks, not as text.
+	QVERIFY(buffer.data().contains("block=\""));
+	QVERIFY(!buffer.data().contains("20000 10000;"));
+	
+	auto& settings = Settings::getInstance();
+	const auto defer_setting = settings.getSetting(Settings::General_DeferMapPartLoading);
+	settings.setSettingInCache(Settings::General_DeferMapPartLoading, defer_loading);
+	
+	Map map;
+	QScopedPointer<Importer> importer(format->createImporter(&buffer, &map, NULL));
+	QVERIFY(importer);
+	importer->doImport(false);
+	importer->finishImport();
+	
+	settings.setSettingInCache(Settings::General_DeferMapPartLoading, defer_setting);
+	
+	// The blocks are available during the import only.
+	QCOMPARE(map.getNumParts(), original.getNumParts());
+	for (int i = 0; i < map.getNumParts(); ++i)
+	{
+		auto part = map.getPart(i);
+		QVERIFY(part->isLoaded());
+		auto original_part = original.getPart(i);
+		QCOMPARE(part->getNumObjects(), original_part->getNumObjects());
+		for (int j = 0; j < part->getNumObjects(); ++j)
+		{
+			QVERIFY(part->getObject(j)->getRawCoordinateVector() == original_part->getObject(j)->getRawCoordinateVector());
+		}
+	}
+	
+	// Another stream is not affected by the blocks of the last import.
+	QBuffer plain;
+	plain.open(QIODevice::ReadWrite);
+	QScopedPointer<Exporter> plain_exporter(FileFormats.findFormat("XML")->createExporter(&plain, &map, NULL));
+	plain_exporter->doExport();
+	QVERIFY(!plain.data().contains("block=\""));
+	QVERIFY(plain.data().contains("20000 10000;"));
+}
+
+void FileFormatTest::packedUndoRoundTrip()
+{
+	const FileFormat* format = FileFormats.findFormat("XML");
+	QVERIFY(format);
+	
+	auto& settings = Settings::getInstance();
+	const auto retain_compatibility = settings.getSetting(Settings::General_RetainCompatiblity);
+	settings.setSettingInCache(Settings::General_RetainCompatiblity, false);
+	
+	Map original;
+	auto color = new MapColor(QString("black"), 0);
+	original.addColor(color, 0);
+	auto line = new LineSymbol();
+	line->setColor(color);
+	line->setLineWidth(0.5);
+	original.addSymbol(line, 0);
+	
+	addLine(original, 0.0);
+	addLine(original, 10.0);
+	addLine(original, 20.0);
+	{
+		Object* object = original.getCurrentPart()->getObject(1);
+		auto undo_step = new ReplaceObjectsUndoStep(&original);
+		undo_step->setPartIndex(original.getCurrentPartIndex());
+		undo_step->addObject(1, object->duplicate());
+		object->move(1000, 0);
+		original.push(undo_step);
+	}
+	QVERIFY(original.undoManager().undo(nullptr));
+	QCOMPARE(original.undoManager().undoStepCount(), std::size_t(3));
+	QCOMPARE(original.undoManager().redoStepCount(), std::size_t(1));
+	
+	QBuffer buffer;
+	buffer.open(QIODevice::ReadWrite);
+	QScopedPointer<Exporter> exporter(format->createExporter(&buffer, &original, NULL));
+	QVERIFY(exporter);
+	exporter->doExport();
+	
+	settings.setSettingInCache(Settings::General_RetainCompatiblity, retain_compatibility);
+	
+	QByteArray data = buffer.data();
+	QVERIFY(data.contains("<packed_step "));
+	QVERIFY(!data.contains("<step "));
+	const QByteArray packed_barrier = "<barrier version=\"7\" required=\"0.6.1\">";
+	QVERIFY(data.contains(packed_barrier));
+	QVERIFY(data.indexOf(packed_barrier) < data.indexOf("<undo>"));
+	
+	buffer.seek(0);
+	Map map;
+	QScopedPointer<Importer> importer(format->createImporter(&buffer, &map, NULL));
+	QVERIFY(importer);
+	importer->doImport(false);
+	importer->finishImport();
+	for (const auto& warning : importer->warnings())
+		QVERIFY2(!warning.contains(QLatin1String("0.6.1")), qPrintable(warning));
+	
+	QVERIFY(equalObjects(map, original));
+	QCOMPARE(map.undoManager().undoStepCount(), std::size_t(3));
+	QCOMPARE(map.undoManager().redoStepCount(), std::size_t(1));
+	
+	// The loaded steps undo and redo the same changes.
+	while (original.undoManager().canUndo())
+	{
+		QVERIFY(original.undoManager().undo(nullptr));
+		QVERIFY(map.undoManager().undo(nullptr));
+		QVERIFY(equalObjects(map, original));
+	}
+	QVERIFY(!map.undoManager().canUndo());
+	QCOMPARE(map.getCurrentPart()->getNumObjects(), 0);
+	
+	while (original.undoManager().canRedo())
+	{
+		QVERIFY(original.undoManager().redo(nullptr));
+		QVERIFY(map.undoManager().redo(nullptr));
+		QVERIFY(equalObjects(map, original));
+	}
+	QVERIFY(!map.undoManager().canRedo());
+	QVERIFY(map.getCurrentPart()->getObject(1)->getRawCoordinateVector().front() == MapCoord::fromNative(1000, 10000));
+	
+	// An implementation which does not know packed steps sees a barrier of
+	// a version higher than the one it supports.
+	data.replace(packed_barrier, QString("<barrier version=\"%1\" required=\"0.6.1\">").arg(XMLFileFormat::barrier_version + 1).toLatin1());
+	QBuffer old_buffer(&data);
+	old_buffer.open(QIODevice::ReadOnly);
+	Map old_map;
+	QScopedPointer<Importer> old_importer(format->createImporter(&old_buffer, &old_map, NULL));
+	QVERIFY(old_importer);
+	old_importer->doImport(false);
+	old_importer->finishImport();
+	
+	QCOMPARE(old_importer->warnings().size(), std::size_t(1));
+	QVERIFY(old_importer->warnings().front().contains(QLatin1String("0.6.1")));
+	QCOMPARE(old_map.getCurrentPart()->getNumObjects(), 3);
+	QVERIFY(old_map.getCurrentPart()->getObject(1)->getRawCoordinateVector().front() == MapCoord::fromNative(0, 10000));
+	QCOMPARE(old_map.undoManager().undoStepCount(), std::size_t(0));
+	QCOMPARE(old_map.undoManager().redoStepCount(), std::size_t(0));
+}
+
+void FileFormatTest::compressedFormatRoundTrip_data()
+{
+	QTest::addColumn<QString>("payload_format_id");
+	
+	QTest::newRow("plain") << QString();
+	QTest::newRow("compact") << QString("XML-Compact");
+}
+
+void FileFormatTest::compressedFormatRoundTrip()
+{
+	QFETCH(QString, payload_format_id);
+	
+	const FileFormat* format = FileFormats.findFormat("XML-Compressed");
+	QVERIFY(format);
+	
+	Map original;
+	initCompressedTestMap(original);
+	
+	QBuffer buffer;
+	buffer.open(QIODevice::ReadWrite);
+	if (payload_format_id.isEmpty())
+	{
+		QScopedPointer<Exporter> exporter(format->createExporter(&buffer, &original, NULL));
+		QVERIFY(exporter);
+		exporter->doExport();
+	}
+	else
+	{
+		// The exporter writes plain documents only.
+		const FileFormat* payload_format = FileFormats.findFormat(payload_format_id);
+		QVERIFY(payload_format);
+		QBuffer payload;
+		payload.open(QIODevice::WriteOnly);
+		QScopedPointer<Exporter> exporter(payload_format->createExporter(&payload, &original, NULL));
+		exporter->doExport();
+		buffer.write(compressedContainer(payload.data()));
+	}
+	QVERIFY(format->understands(reinterpret_cast<const unsigned char*>(buffer.data().constData()), std::size_t(buffer.size())));
+	buffer.seek(0);
+	
+	Map map;
+	QScopedPointer<Importer> importer(format->createImporter(&buffer, &map, NULL));
+	QVERIFY(importer);
+	importer->doImport(false);
+	importer->finishImport();
+	
+	QString error;
+	QVERIFY2(compareMaps(&original, &map, error), qPrintable(error));
+	QVERIFY(equalObjects(map, original));
+}
+
+void FileFormatTest::compressedFormatErrors_data()
+{
+	QTest::addColumn<bool>("truncate");
+	
+	QTest::newRow("truncated") << true;
+	QTest::newRow("corrupt") << false;
+}
+
+void FileFormatTest::compressedFormatErrors()
+{
+	QFETCH(bool, truncate);
+	
+	const FileFormat* format = FileFormats.findFormat("XML-Compressed");
+	QVERIFY(format);
+	
+	Map original;
+	initCompressedTestMap(original);
+	
+	QBuffer buffer;
+	buffer.open(QIODevice::WriteOnly);
+	QScopedPointer<Exporter> exporter(format->createExporter(&buffer, &original, NULL));
+	QVERIFY(exporter);
+	exporter->doExport();
+	
+	QByteArray data = buffer.data();
+	QVERIFY(data.size() > 1000);
+	if (truncate)
+	{
+		data.truncate(data.size() / 2);
+	}
+	else
+	{
+		for (int i = data.size() / 2; i < data.size() / 2 + 64; ++i)
+			data[i] = char(~data[i]);
+	}
+	
+	QBuffer damaged(&data);
+	damaged.open(QIODevice::ReadOnly);
+	Map map;
+	QScopedPointer<Importer> importer(format->createImporter(&damaged, &map, NULL));
+	QVERIFY(importer);
+	QVERIFY_EXCEPTION_THROWN(importer->doImport(false), FileFormatException);
+}
+
+void FileFormatTest::backgroundExport_data()
+{
+	QTest::addColumn<QString>("format_id");
+	QTest::addColumn<QString>("map_filename");
+	
+	for (const auto& format_id : { "XML", "XML-Compact", "XML-Compressed" })
+	{
+		for (const auto& filename : map_filenames)
+		{
+			auto id = QString { QFileInfo(filename).fileName() % " <> " % QLatin1String(format_id) };
+			QTest::newRow(id.toLocal8Bit()) << QString::fromLatin1(format_id) << filename;
+		}
+	}
+}
+
+void FileFormatTest::backgroundExport()
+{
+	QFETCH(QString, format_id);
+	QFETCH(QString, map_filename);
+	
+	const FileFormat* format = FileFormats.findFormat(format_id);
+	QVERIFY(format);
+	
+	Map map;
+	MapView view(&map);
+	QVERIFY(map.loadFrom(map_filename, nullptr, &view, false, false));
+	
+	// The undo history is a part of the map state which is not in the snapshot.
+	MapPart* part = map.getCurrentPart();
+	if (part->getNumObjects() > 0)
+	{
+		Object* object = part->getObject(0);
+		auto undo_step = new ReplaceObjectsUndoStep(&map);
+		undo_step->setPartIndex(map.getCurrentPartIndex());
+		undo_step->addObject(0, object->duplicate());
+		object->move(1000, 0);
+		map.push(undo_step);
+	}
+	
+	QByteArray expected;
+	QVERIFY(map.exportToData(map_filename, expected, &view, format));
+	
+	auto serializer = map.prepareExportToData(map_filename, &view, format);
+	QVERIFY(bool(serializer));
+	
+	// The map may change while the serializer runs.
+	map.setMapNotes(QLatin1String("Changed after the snapshot"));
+	
+	QByteArray data;
+	QString error_string;
+	QVERIFY2(serializer(data, error_string), qPrintable(error_string));
+	QCOMPARE(data, expected);
+}
+
+void FileFormatTest::zlibInputDevice()
+{
+	// More than the helper may keep ahead, so that it is restarted.
+	QByteArray original;
+	for (int i = 0; original.size() < 16 * 1024 * 1024; ++i)
+		original.append(QString("Line %1\n").arg(i).toLatin1());
+	
+	QByteArray compressed;
+	{
+		QBuffer buffer(&compressed);
+		buffer.open(QIODevice::WriteOnly);
+		ZlibOutputDevice device(&buffer);
+		QVERIFY(device.open(QIODevice::WriteOnly));
+		QCOMPARE(device.write(original), qint64(original.size()));
+		QVERIFY(device.finish());
+	}
+	QVERIFY(compressed.size() < original.size());
+	
+	// Reading all data
+	{
+		QBuffer buffer(&compressed);
+		buffer.open(QIODevice::ReadOnly);
+		ZlibInputDevice device(&buffer);
+		QVERIFY(device.open(QIODevice::ReadOnly));
+		QByteArray data;
+		while (!device.atEnd())
+		{
+			const QByteArray block = device.read(100000);
+			QVERIFY(!block.isEmpty());
+			data.append(block);
+		}
+		QVERIFY(!device.hasError());
+		QVERIFY(data == original);
+	}
+	
+	// Closing before the end of the stream
+	{
+		QBuffer buffer(&compressed);
+		buffer.open(QIODevice::ReadOnly);
+		ZlibInputDevice device(&buffer);
+		QVERIFY(device.open(QIODevice::ReadOnly));
+		QCOMPARE(device.read(1000), original.left(1000));
+		device.close();
+		QVERIFY(!device.isOpen());
+		QVERIFY(!device.hasError());
+	}
+}
+
 Map* FileFormatTest::saveAndLoadMap(Map* input, const FileFormat* format)
 {
 	try {
@@ -59,6 +59,61 @@ private slots:
 	void saveAndLoad();
 	void saveAndLoad_data();
 	
+	/**
+	 * Tests that importers skip the objects outside of a region,
+	 * and optionally cut the areas at its boundary.
+	 */
+	void importRegion();
+	void importRegion_data();
+	
+	/**
+	 * Tests that a deferred map part whose objects fail to load stays
+	 * unloaded and empty, reports the error once, and cannot be saved.
+	 */
+	void deferredLoadingError();
+	
+	/**
+	 * Tests that the compact format keeps the coordinates and their flags,
+	 * with and without deferred loading of map parts.
+	 */
+	void compactFormatRoundTrip();
+	void compactFormatRoundTrip_data();
+	
+	/**
+	 * Tests that packed undo steps can be saved and loaded, and that they
+	 * undo and redo the same changes as the original steps. Tests that
+	 * implementations which do not know packed steps skip them with a
+	 * warning.
+	 */
+	void packedUndoRoundTrip();
+	
+	/**
+	 * Tests that maps can be saved and loaded in the compressed format,
+	 * with a plain or a compact document as payload.
+	 */
+	void compressedFormatRoundTrip();
+	void compressedFormatRoundTrip_data();
+	
+	/**
+	 * Tests that truncated and corrupt compressed files are rejected
+	 * with an exception.
+	 */
+	void compressedFormatErrors();
+	void compressedFormatErrors_data();
+	
+	/**
+	 * Tests that exporting a map from a snapshot, as prepared by
+	 * Map::prepareExportToData(), gives the same data as a direct export.
+	 */
+	void backgroundExport();
+	void backgroundExport_data();
+	
+	/**
+	 * Tests that a ZlibInputDevice decompresses long streams, and that it
+	 * can be closed before the end of the stream.
+	 */
+	void zlibInputDevice();
+	
 private:
 	Map* saveAndLoadMap(Map* input, const FileFormat* format);
 	void comparePrinterConfig(const MapPrinterConfig& copy, const MapPrinterConfig& orig);
@@ -34,6 +34,7 @@ namespace
 	QString gk2_spec   = QLatin1String("+proj=tmerc +lat_0=0 +lon_0=6 +k=1.000000 +x_0=2500000 +y_0=0 +ellps=bessel +datum=potsdam +units=m +no_defs");
 	QString gk3_spec   = QLatin1String("+proj=tmerc +lat_0=0 +lon_0=9 +k=1.000000 +x_0=3500000 +y_0=0 +ellps=bessel +datum=potsdam +units=m +no_defs");
 	QString utm32_spec = QLatin1String("+proj=utm +zone=32 +datum=WGS84");
+	QString ortho_spec = QLatin1String("+proj=ortho +datum=WGS84 +lat_0=50 +lon_0=7");
 	
 	
 	/**
@@ -90,6 +91,34 @@ void GeoreferencingTest::testCRSTemplates()
 }
 
 
+void GeoreferencingTest::testAssignmentSignals()
+{
+	Georeferencing original;
+	original.setProjectedCRS("UTM", utm32_spec);
+	
+	Georeferencing copy(original);
+	QSignalSpy state_spy(&copy, SIGNAL(stateChanged()));
+	QSignalSpy transformation_spy(&copy, SIGNAL(transformationChanged()));
+	QSignalSpy declination_spy(&copy, SIGNAL(declinationChanged()));
+	QSignalSpy projection_spy(&copy, SIGNAL(projectionChanged()));
+	
+	copy = original;
+	QCOMPARE(state_spy.count(), 0);
+	QCOMPARE(transformation_spy.count(), 0);
+	QCOMPARE(declination_spy.count(), 0);
+	QCOMPARE(projection_spy.count(), 0);
+	
+	Georeferencing rotated(original);
+	rotated.setDeclination(original.getDeclination() + 2.0);
+	copy = rotated;
+	QCOMPARE(state_spy.count(), 0);
+	QCOMPARE(transformation_spy.count(), 1);
+	QCOMPARE(declination_spy.count(), 1);
+	QCOMPARE(projection_spy.count(), 0);
+	QCOMPARE(copy.getDeclination(), rotated.getDeclination());
+}
+
+
 void GeoreferencingTest::testProjection_data()
 {
 	QTest::addColumn<QString>("proj");
@@ -154,5 +183,121 @@ void GeoreferencingTest::testProjection()
 }
 
 
+void GeoreferencingTest::testBatchProjection()
+{
+	Georeferencing utm;
+	QVERIFY(utm.setProjectedCRS("UTM", utm32_spec));
+	utm.setScaleDenominator(10000);
+	utm.setProjectedRefPoint(QPointF(398000.0, 5579000.0));
+	
+	Georeferencing gk3;
+	QVERIFY(gk3.setProjectedCRS("GK3", gk3_spec));
+	gk3.setScaleDenominator(15000);
+	gk3.setProjectedRefPoint(QPointF(3398000.0, 5581000.0));
+	
+	std::vector<LatLon> lat_lon = {
+	    LatLon(degFromDMS(50, 21, 32.2), degFromDMS(7, 34, 4.0)),
+	    LatLon(degFromDMS(50, 12, 36.1), degFromDMS(6, 25, 39.6)),
+	    LatLon(degFromDMS(49, 12,  4.2), degFromDMS(8,  7, 52.0)),
+	};
+	
+	std::vector<QPointF> projected_coords;
+	QVERIFY(utm.toProjectedCoords(lat_lon, projected_coords));
+	QCOMPARE(projected_coords.size(), lat_lon.size());
+	for (std::size_t i = 0; i < lat_lon.size(); ++i)
+	{
+		bool ok;
+		QPointF expected = utm.toProjectedCoords(lat_lon[i], &ok);
+		QVERIFY(ok);
+		QVERIFY(fabs(projected_coords[i].x() - expected.x()) < 0.001);
+		QVERIFY(fabs(projected_coords[i].y() - expected.y()) < 0.001);
+	}
+	
+	std::vector<LatLon> lat_lon_2;
+	QVERIFY(utm.toGeographicCoords(projected_coords, lat_lon_2));
+	QCOMPARE(lat_lon_2.size(), lat_lon.size());
+	for (std::size_t i = 0; i < lat_lon.size(); ++i)
+	{
+		QVERIFY(fabs(lat_lon_2[i].latitude() - lat_lon[i].latitude()) < 0.000001);
+		QVERIFY(fabs(lat_lon_2[i].longitude() - lat_lon[i].longitude()) < 0.000001);
+	}
+	
+	std::vector<MapCoordF> map_coords;
+	QVERIFY(utm.toMapCoordF(lat_lon, map_coords));
+	QCOMPARE(map_coords.size(), lat_lon.size());
+	for (std::size_t i = 0; i < lat_lon.size(); ++i)
+	{
+		MapCoordF expected = utm.toMapCoordF(lat_lon[i]);
+		QVERIFY(fabs(map_coords[i].x() - expected.x()) < 0.0001);
+		QVERIFY(fabs(map_coords[i].y() - expected.y()) < 0.0001);
+	}
+	
+	std::vector<MapCoordF> gk3_coords;
+	QVERIFY(gk3.toMapCoordF(&utm, map_coords, gk3_coords));
+	QCOMPARE(gk3_coords.size(), map_coords.size());
+	for (std::size_t i = 0; i < map_coords.size(); ++i)
+	{
+		bool ok;
+		MapCoordF expected = gk3.toMapCoordF(&utm, map_coords[i], &ok);
+		QVERIFY(ok);
+		QVERIFY(fabs(gk3_coords[i].x() - expected.x()) < 0.0001);
+		QVERIFY(fabs(gk3_coords[i].y() - expected.y()) < 0.0001);
+	}
+	
+	// Without another georeferencing, the coordinates are not changed.
+	QVERIFY(gk3.toMapCoordF(nullptr, map_coords, gk3_coords));
+	QCOMPARE(gk3_coords.size(), map_coords.size());
+	for (std::size_t i = 0; i < map_coords.size(); ++i)
+		QCOMPARE(QPointF(gk3_coords[i]), QPointF(map_coords[i]));
+	
+	// Empty input is not an error.
+	lat_lon.clear();
+	QVERIFY(utm.toMapCoordF(lat_lon, map_coords));
+	QVERIFY(map_coords.empty());
+}
+
+
+void GeoreferencingTest::testBatchProjectionErrors()
+{
+	const std::vector<LatLon> lat_lon = {
+	    LatLon(50.0, 7.0),
+	    LatLon(-50.0, -173.0),  // on the far side of the ortho projection
+	};
+	
+	// A local georeferencing cannot transform geographic coordinates.
+	Georeferencing local;
+	QVERIFY(local.isLocal());
+	std::vector<MapCoordF> map_coords = { MapCoordF(1.0, 1.0) };
+	QVERIFY(!local.toMapCoordF(lat_lon, map_coords));
+	QVERIFY(map_coords.empty());
+	
+	Georeferencing ortho;
+	QVERIFY(ortho.setProjectedCRS("", ortho_spec));
+	std::vector<QPointF> projected_coords = { QPointF(1.0, 1.0) };
+	QVERIFY(!ortho.toProjectedCoords(lat_lon, projected_coords));
+	QVERIFY(projected_coords.empty());
+	
+	map_coords = { MapCoordF(1.0, 1.0) };
+	QVERIFY(!ortho.toMapCoordF(lat_lon, map_coords));
+	QVERIFY(map_coords.empty());
+	
+	// A point outside of the ortho projection's disk cannot be converted
+	// to another georeferencing.
+	Georeferencing utm;
+	QVERIFY(utm.setProjectedCRS("UTM", utm32_spec));
+	const std::vector<MapCoordF> ortho_coords = {
+	    ortho.toMapCoordF(QPointF(0.0, 0.0)),
+	    ortho.toMapCoordF(QPointF(1.0e8, 0.0)),
+	};
+	map_coords = { MapCoordF(1.0, 1.0) };
+	QVERIFY(!utm.toMapCoordF(&ortho, ortho_coords, map_coords));
+	QVERIFY(map_coords.empty());
+	
+	// The first point alone can be converted.
+	QVERIFY(utm.toMapCoordF(&ortho, { ortho_coords.front() }, map_coords));
+	QCOMPARE(map_coords.size(), std::size_t(1));
+}
+
+
 
 QTEST_GUILESS_MAIN(GeoreferencingTest)
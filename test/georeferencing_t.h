@@ -63,6 +63,23 @@ private slots:
 	
 	void testProjection_data();
 	
+	/**
+	 * Tests that the batch transformations give the same results as the
+	 * single coordinate transformations.
+	 */
+	void testBatchProjection();
+	
+	/**
+	 * Tests that failing batch transformations return false and leave the
+	 * output empty.
+	 */
+	void testBatchProjectionErrors();
+	
+	/**
+	 * Tests that assignment emits only the signals for actual changes.
+	 */
+	void testAssignmentSignals();
+	
 private:
 	Georeferencing georef;
 };
@@ -0,0 +1,250 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "line_symbol_t.h"
+
+#include <initializer_list>
+
+#include "../src/renderable.h"
+#include "../src/symbol_line.h"
+#include "../src/core/virtual_path.h"
+
+#include "map_generator.h"
+
+
+namespace
+{
+	/** The radius of the rings, in mm. */
+	const double ring_radius = 100.0;
+	
+	/** Makes the protected kernels of LineSymbol accessible. */
+	class BenchmarkLineSymbol : public LineSymbol
+	{
+	public:
+		BenchmarkLineSymbol()
+		{
+			setLineWidth(0.35);
+			setDashLength(4000);
+			setBreakLength(1000);
+		}
+		
+		using LineSymbol::shiftCoordinates;
+		using LineSymbol::processDashedLine;
+		using LineSymbol::createDashGroups;
+		
+		/** Like processDashedLine() for a closed path, optionally without the cache. */
+		void layoutDashes(
+		        const VirtualPath& path,
+		        bool cached,
+		        MapCoordVector& out_flags,
+		        MapCoordVectorF& out_coords,
+		        ObjectRenderables& output ) const
+		{
+			if (cached)
+			{
+				processDashedLine(path, true, out_flags, out_coords, output);
+				return;
+			}
+			
+			auto& path_coords = path.path_coords;
+			auto groups_start = SplitPathCoord::begin(path_coords);
+			auto line_start   = groups_start;
+			for (bool is_part_end = false; !is_part_end; )
+			{
+				auto groups_end = SplitPathCoord::at(path_coords, path_coords.findNextDashPoint(groups_start.path_coord_index));
+				bool is_part_start = (groups_start.index == path.first_index);
+				is_part_end = (groups_end.index == path.last_index);
+				line_start = createDashGroups(path, true,
+				                              line_start, groups_start, groups_end,
+				                              is_part_start, is_part_end,
+				                              out_flags, out_coords, output);
+				groups_start = groups_end;
+			}
+		}
+	};
+}
+
+
+void LineSymbolTest::paths_data()
+{
+	QTest::addColumn<int>("num_vertices");
+	QTest::addColumn<bool>("curves");
+	for (int num_vertices : { 10, 100, 1000, 10000 })
+	{
+		QTest::newRow(qPrintable(QString("straight, num_vertices = %1").arg(num_vertices))) << num_vertices << false;
+		QTest::newRow(qPrintable(QString("curved, num_vertices = %1").arg(num_vertices))) << num_vertices << true;
+	}
+}
+
+void LineSymbolTest::shiftCoordinates_data()
+{
+	paths_data();
+}
+
+void LineSymbolTest::shiftCoordinates()
+{
+	QFETCH(int, num_vertices);
+	QFETCH(bool, curves);
+	MapGenerator generator { MapGenerator::Options() };
+	const MapCoordVector coords = generator.generateRing(num_vertices, ring_radius, curves);
+	VirtualPath path(coords);
+	path.path_coords.update(0);
+	
+	BenchmarkLineSymbol symbol;
+	MapCoordVector out_flags;
+	MapCoordVectorF out_coords;
+	QBENCHMARK
+	{
+		out_flags.clear();
+		out_coords.clear();
+		symbol.shiftCoordinates(path, 0.5, out_flags, out_coords);
+	}
+	QVERIFY(out_coords.size() >= coords.size());
+}
+
+void LineSymbolTest::processDashedLine_data()
+{
+	paths_data();
+}
+
+void LineSymbolTest::processDashedLine()
+{
+	QFETCH(int, num_vertices);
+	QFETCH(bool, curves);
+	MapGenerator generator { MapGenerator::Options() };
+	const MapCoordVector coords = generator.generateRing(num_vertices, ring_radius, curves);
+	VirtualPath path(coords);
+	path.path_coords.update(0);
+	
+	BenchmarkLineSymbol symbol;
+	symbol.setDashed(true);
+	QRectF extent;
+	ObjectRenderables output(extent);
+	MapCoordVector out_flags;
+	MapCoordVectorF out_coords;
+	QBENCHMARK
+	{
+		out_flags.clear();
+		out_coords.clear();
+		symbol.processDashedLine(path, true, out_flags, out_coords, output);
+	}
+	QVERIFY(!out_coords.empty());
+}
+
+void LineSymbolTest::processDashedLineEdits_data()
+{
+	QTest::addColumn<int>("num_vertices");
+	QTest::addColumn<bool>("move_all");
+	QTest::addColumn<bool>("cached");
+	for (int num_vertices : { 100, 1000, 10000 })
+	{
+		for (bool move_all : { false, true })
+		{
+			for (bool cached : { false, true })
+			{
+				QTest::newRow(qPrintable(QString("%1, %2, num_vertices = %3")
+				                         .arg(QLatin1String(move_all ? "move all" : "move one"),
+				                              QLatin1String(cached ? "cached" : "uncached"))
+				                         .arg(num_vertices)))
+				        << num_vertices << move_all << cached;
+			}
+		}
+	}
+}
+
+void LineSymbolTest::processDashedLineEdits()
+{
+	QFETCH(int, num_vertices);
+	QFETCH(bool, move_all);
+	QFETCH(bool, cached);
+	MapGenerator generator { MapGenerator::Options() };
+	MapCoordVector flags = generator.generateRing(num_vertices, ring_radius, false);
+	// Dash points at every tenth vertex split the line into sections.
+	for (std::size_t i = 10; i + 1 < flags.size(); i += 10)
+		flags[i].setDashPoint(true);
+	const MapCoordVectorF original_coords(flags.begin(), flags.end());
+	MapCoordVectorF coords = original_coords;
+	
+	BenchmarkLineSymbol symbol;
+	symbol.setDashed(true);
+	QRectF extent;
+	ObjectRenderables output(extent);
+	MapCoordVector out_flags;
+	MapCoordVectorF out_coords;
+	int iteration = 0;
+	QBENCHMARK
+	{
+		// Each iteration moves vertices to positions which were not laid out before.
+		++iteration;
+		if (move_all)
+		{
+			for (auto& coord : coords)
+				coord += MapCoordF(0.001, 0.0);
+		}
+		else
+		{
+			auto index = 1 + std::size_t(iteration) * 7 % (coords.size() - 2);
+			coords[index] = original_coords[index] + MapCoordF(0.0, 0.001 * iteration);
+		}
+		VirtualPath path(flags, coords);
+		path.path_coords.update(0);
+		
+		out_flags.clear();
+		out_coords.clear();
+		symbol.layoutDashes(path, cached, out_flags, out_coords, output);
+	}
+	QVERIFY(!out_coords.empty());
+}
+
+void LineSymbolTest::createDashGroups_data()
+{
+	paths_data();
+}
+
+void LineSymbolTest::createDashGroups()
+{
+	QFETCH(int, num_vertices);
+	QFETCH(bool, curves);
+	MapGenerator generator { MapGenerator::Options() };
+	const MapCoordVector coords = generator.generateRing(num_vertices, ring_radius, curves);
+	VirtualPath path(coords);
+	path.path_coords.update(0);
+	
+	// The ring has no dash points, so it is a single group of dashes,
+	// like in processDashedLine().
+	const auto start = SplitPathCoord::begin(path.path_coords);
+	const auto end   = SplitPathCoord::at(path.path_coords, path.path_coords.size() - 1);
+	
+	BenchmarkLineSymbol symbol;
+	symbol.setDashed(true);
+	QRectF extent;
+	ObjectRenderables output(extent);
+	MapCoordVector out_flags;
+	MapCoordVectorF out_coords;
+	QBENCHMARK
+	{
+		out_flags.clear();
+		out_coords.clear();
+		symbol.createDashGroups(path, true, start, start, end, true, true, out_flags, out_coords, output);
+	}
+	QVERIFY(!out_coords.empty());
+}
+
+
+QTEST_MAIN(LineSymbolTest)
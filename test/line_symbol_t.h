@@ -0,0 +1,69 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_LINE_SYMBOL_T_H
+#define _OPENORIENTEERING_LINE_SYMBOL_T_H
+
+#include <QtTest/QtTest>
+
+
+/**
+ * @test Benchmarks the geometry kernels of LineSymbol: the shifted
+ * coordinates of border lines, and the layout of dashes.
+ *
+ * The paths are closed rings (cf. MapGenerator::generateRing()) with an
+ * increasing number of vertices, with straight or with curved edges.
+ */
+class LineSymbolTest : public QObject
+{
+Q_OBJECT
+private slots:
+	/** Calculates the coordinates of a border line. */
+	void shiftCoordinates();
+	void shiftCoordinates_data();
+	
+	/**
+	 * Calculates the dashes of a line as done for rendering.
+	 * 
+	 * After the first iteration, the dash groups are taken from the cache.
+	 */
+	void processDashedLine();
+	void processDashedLine_data();
+	
+	/**
+	 * Calculates the dashes of a line with dash points after edits,
+	 * with and without the cache.
+	 * 
+	 * Moving one vertex changes one section, so the other sections are taken
+	 * from the cache. Moving all vertices changes all sections, so this
+	 * measures the cost of looking up and storing the sections in vain.
+	 */
+	void processDashedLineEdits();
+	void processDashedLineEdits_data();
+	
+	/** Calculates the dashes of a line without the cache. */
+	void createDashGroups();
+	void createDashGroups_data();
+
+private:
+	/** Adds the columns and rows of the sizes and kinds of the paths. */
+	void paths_data();
+};
+
+#endif
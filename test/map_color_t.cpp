@@ -272,5 +272,49 @@ void MapColorTest::spotColorTest()
 	QVERIFY(spot_cyan_copy != *duplicate);
 }
 
+void MapColorTest::colorTransformTest()
+{
+	MapColor cyan(QString("Cyan"), 0);
+	cyan.setCmyk(MapColorCmyk(1.0f, 0.0f, 0.0f, 0.0f));
+	MapColor dark(QString("Dark"), 1);
+	dark.setCmyk(MapColorCmyk(1.0f, 1.0f, 1.0f, 1.0f));
+	MapColor white(QString("White"), 2);
+	white.setCmyk(MapColorCmyk(0.0f, 0.0f, 0.0f, 0.0f));
+	
+	ColorTransform transform;
+	transform.addColor(&cyan);
+	transform.addColor(&dark);
+	transform.addColor(&white);
+	
+	// Output values
+	QCOMPARE(transform.cmyk(&cyan), cyan.getCmyk());
+	const MapColorCmyk limited = transform.cmyk(&dark);
+	QCOMPARE(limited.k, 1.0f);
+	QVERIFY(limited.c + limited.m + limited.y + limited.k <= transform.profile().total_area_coverage + 0.001f);
+	
+	// Proof colors
+	QCOMPARE(transform.proofColor(&white).rgb(), transform.profile().paper);
+	QCOMPARE(transform.proofColor(&cyan).red(), 0);
+	QCOMPARE(transform.proofColor(&dark).rgb(), qRgb(0, 0, 0));
+	
+	// Pixels
+	const QRgb pixels[] = {
+	  static_cast<const QColor&>(cyan).rgb(),
+	  static_cast<const QColor&>(cyan).rgb(),
+	  qRgba(0, 0, 0, 0),
+	  qRgb(128, 128, 128),
+	};
+	const uchar expected[] = {
+	  255, 0, 0, 0,
+	  255, 0, 0, 0,
+	  0, 0, 0, 0,
+	  0, 0, 0, 127,
+	};
+	uchar cmyk[sizeof(expected)];
+	transform.convertToCmyk(pixels, 4, cmyk);
+	for (std::size_t i = 0; i < sizeof(expected); ++i)
+		QCOMPARE(cmyk[i], expected[i]);
+}
+
 
 QTEST_GUILESS_MAIN(MapColorTest)
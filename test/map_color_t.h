@@ -22,6 +22,7 @@
 
 #include <QtTest/QtTest>
 
+#include "../src/core/color_transform.h"
 #include "../src/core/map_color.h"
 
 
@@ -44,6 +45,9 @@ private slots:
 	
 	/** Tests spot colors */
 	void spotColorTest();
+	
+	/** Tests the CMYK conversions of ColorTransform. */
+	void colorTransformTest();
 };
 
 #endif
@@ -0,0 +1,337 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "map_draw_t.h"
+
+#include <initializer_list>
+
+#include <QImage>
+#include <QPainter>
+
+#include "../src/global.h"
+#include "../src/map.h"
+#include "../src/mapper_resource.h"
+#include "../src/renderable.h"
+#include "../src/core/map_color.h"
+
+#include "map_generator.h"
+
+
+namespace
+{
+	/** The prefix of the synthetic maps, followed by the number of objects. */
+	const QString generated_prefix = QString("generated:");
+	
+	/** The resolution of the simulated screen. */
+	const qreal pixels_per_mm = 96 / 25.4;
+	
+	/**
+	 * Sets up the painter for drawing the center of the map extent
+	 * at the given zoom, and returns the matching render config.
+	 */
+	RenderConfig setupView(QPainter& painter, const Map& map, const QImage& image, qreal zoom, RenderConfig::Options options)
+	{
+		const qreal scaling = zoom * pixels_per_mm;
+		const QRectF extent = map.calculateExtent();
+		const QSizeF view_size(image.width() / scaling, image.height() / scaling);
+		const QRectF view_rect(extent.center() - QPointF(view_size.width(), view_size.height()) / 2, view_size);
+		
+		painter.translate(image.width() / 2.0, image.height() / 2.0);
+		painter.scale(scaling, scaling);
+		painter.translate(-extent.center());
+		
+		RenderConfig config = { map, view_rect, scaling, options, 1.0 };
+		return config;
+	}
+}
+
+
+void MapDrawTest::initTestCase()
+{
+	Q_INIT_RESOURCE(resources);
+	doStaticInitializations();
+	
+	for (const auto& test_file : { "COPY_OF_test_map.omap", "COPY_OF_spotcolor_overprint.xmap" })
+	{
+		const QString path = MapperResource::locate(MapperResource::TEST_DATA, QString::fromLatin1(test_file));
+		QVERIFY2(!path.isEmpty(), QString("Unable to locate %1").arg(test_file).toLocal8Bit());
+		map_filenames.push_back(path);
+	}
+	
+	const QDir examples_dir(QFileInfo(__FILE__).dir().absoluteFilePath(QString("../examples")));
+	for (const auto& example : examples_dir.entryInfoList(QStringList() << "*.omap", QDir::Files, QDir::Name))
+		map_filenames.push_back(example.absoluteFilePath());
+	
+	// Synthetic maps with many objects, texts and vertices
+	for (const auto& num_objects : { 10000, 100000 })
+		map_filenames.push_back(generated_prefix + QString::number(num_objects));
+}
+
+
+void MapDrawTest::maps_data()
+{
+	QTest::addColumn<QString>("map_filename");
+	for (const auto& filename : map_filenames)
+		QTest::newRow(QFileInfo(filename).fileName().toLocal8Bit()) << filename;
+}
+
+Map& MapDrawTest::map(const QString& path)
+{
+	auto& map = maps[path];
+	if (!map)
+	{
+		map.reset(new Map());
+		if (path.startsWith(generated_prefix))
+		{
+			MapGenerator::Options options;
+			options.num_objects = path.mid(generated_prefix.length()).toInt();
+			options.texts_per_1000 = 50;
+			if (MapGenerator::loadSymbolSet(*map, MapGenerator::isomSymbolSetPath()))
+				MapGenerator(options).generateObjects(*map);
+			map->updateObjects();
+		}
+		else if (map->loadFrom(path, nullptr, nullptr, false, false))
+		{
+			map->updateObjects();
+		}
+	}
+	return *map;
+}
+
+
+void MapDrawTest::draw_data()
+{
+	QTest::addColumn<QString>("map_filename");
+	QTest::addColumn<qreal>("zoom");
+	QTest::addColumn<QSize>("viewport");
+	for (const auto& filename : map_filenames)
+	{
+		for (const qreal zoom : { 0.25, 1.0, 4.0 })
+		{
+			for (const auto& viewport : { QSize(640, 480), QSize(1920, 1080) })
+			{
+				const QString name = QString("%1 @ %2x, %3x%4")
+				                     .arg(QFileInfo(filename).fileName())
+				                     .arg(zoom)
+				                     .arg(viewport.width()).arg(viewport.height());
+				QTest::newRow(name.toLocal8Bit()) << filename << zoom << viewport;
+			}
+		}
+	}
+}
+
+void MapDrawTest::draw()
+{
+	QFETCH(QString, map_filename);
+	QFETCH(qreal, zoom);
+	QFETCH(QSize, viewport);
+	
+	Map& map = this->map(map_filename);
+	QVERIFY(map.getNumObjects() > 0);
+	
+	QImage image(viewport, QImage::Format_ARGB32_Premultiplied);
+	QPainter painter(&image);
+	painter.setRenderHint(QPainter::Antialiasing);
+	const auto config = setupView(painter, map, image, zoom, RenderConfig::Screen | RenderConfig::ReducedDetail);
+	QBENCHMARK
+	{
+		image.fill(Qt::white);
+		map.draw(&painter, config);
+	}
+}
+
+
+void MapDrawTest::drawConcurrently_data()
+{
+	maps_data();
+}
+
+void MapDrawTest::drawConcurrently()
+{
+	QFETCH(QString, map_filename);
+	
+	Map& map = this->map(map_filename);
+	QVERIFY(map.getNumObjects() > 0);
+	
+	// Only images of Format_ARGB32_Premultiplied are drawn concurrently.
+	QImage images[2] = {
+	    QImage(QSize(640, 480), QImage::Format_ARGB32_Premultiplied),
+	    QImage(QSize(640, 480), QImage::Format_RGB32)
+	};
+	for (QImage& image : images)
+	{
+		image.fill(Qt::white);
+		QPainter painter(&image);
+		painter.setRenderHint(QPainter::Antialiasing);
+		const auto config = setupView(painter, map, image, 0.25, RenderConfig::Screen);
+		map.draw(&painter, config);
+	}
+	
+	// The composition of layers may round differently.
+	const QImage concurrent = images[0].convertToFormat(QImage::Format_RGB32);
+	int num_different = 0;
+	for (int y = 0; y < concurrent.height(); ++y)
+	{
+		const QRgb* a = reinterpret_cast<const QRgb*>(concurrent.constScanLine(y));
+		const QRgb* b = reinterpret_cast<const QRgb*>(images[1].constScanLine(y));
+		for (int x = 0; x < concurrent.width(); ++x)
+		{
+			if (qAbs(qRed(a[x]) - qRed(b[x])) > 2
+			    || qAbs(qGreen(a[x]) - qGreen(b[x])) > 2
+			    || qAbs(qBlue(a[x]) - qBlue(b[x])) > 2)
+				++num_different;
+		}
+	}
+	QVERIFY(num_different <= concurrent.width() * concurrent.height() / 100);
+}
+
+
+void MapDrawTest::drawOcclusionCulling_data()
+{
+	maps_data();
+}
+
+void MapDrawTest::drawOcclusionCulling()
+{
+	QFETCH(QString, map_filename);
+	
+	Map& map = this->map(map_filename);
+	QVERIFY(map.getNumObjects() > 0);
+	
+	// Images of Format_RGB32 are not drawn concurrently.
+	const RenderConfig::Options options[2] = {
+	    RenderConfig::Screen,
+	    RenderConfig::Screen | RenderConfig::OcclusionCulling
+	};
+	QImage images[2];
+	for (int i = 0; i < 2; ++i)
+	{
+		images[i] = QImage(QSize(640, 480), QImage::Format_RGB32);
+		images[i].fill(Qt::white);
+		QPainter painter(&images[i]);
+		painter.setRenderHint(QPainter::Antialiasing);
+		const auto config = setupView(painter, map, images[i], 1.0, options[i]);
+		map.draw(&painter, config);
+	}
+	
+	int num_different = 0;
+	for (int y = 0; y < images[0].height(); ++y)
+	{
+		const QRgb* a = reinterpret_cast<const QRgb*>(images[0].constScanLine(y));
+		const QRgb* b = reinterpret_cast<const QRgb*>(images[1].constScanLine(y));
+		for (int x = 0; x < images[0].width(); ++x)
+		{
+			if (qAbs(qRed(a[x]) - qRed(b[x])) > 2
+			    || qAbs(qGreen(a[x]) - qGreen(b[x])) > 2
+			    || qAbs(qBlue(a[x]) - qBlue(b[x])) > 2)
+				++num_different;
+		}
+	}
+	QCOMPARE(num_different, 0);
+	
+	QImage image(QSize(1920, 1080), QImage::Format_ARGB32_Premultiplied);
+	QPainter painter(&image);
+	painter.setRenderHint(QPainter::Antialiasing);
+	const auto config = setupView(painter, map, image, 1.0, RenderConfig::Screen | RenderConfig::OcclusionCulling);
+	QBENCHMARK
+	{
+		image.fill(Qt::white);
+		map.draw(&painter, config);
+	}
+}
+
+
+void MapDrawTest::drawOverprintingSimulation_data()
+{
+	maps_data();
+}
+
+void MapDrawTest::drawOverprintingSimulation()
+{
+	QFETCH(QString, map_filename);
+	
+	Map& map = this->map(map_filename);
+	QVERIFY(map.getNumObjects() > 0);
+	
+	QImage image(QSize(1920, 1080), QImage::Format_ARGB32_Premultiplied);
+	QPainter painter(&image);
+	painter.setRenderHint(QPainter::Antialiasing);
+	const auto config = setupView(painter, map, image, 1.0, RenderConfig::Screen);
+	QBENCHMARK
+	{
+		image.fill(Qt::white);
+		map.drawOverprintingSimulation(&painter, config);
+	}
+}
+
+
+void MapDrawTest::drawColorSeparations_data()
+{
+	maps_data();
+}
+
+void MapDrawTest::drawColorSeparations()
+{
+	QFETCH(QString, map_filename);
+	
+	Map& map = this->map(map_filename);
+	QVERIFY(map.getNumObjects() > 0);
+	
+	std::vector<const MapColor*> spot_colors;
+	for (int i = map.getNumColors() - 1; i >= 0; --i)
+	{
+		const MapColor* color = map.getColor(i);
+		if (color->getSpotColorMethod() == MapColor::SpotColor)
+			spot_colors.push_back(color);
+	}
+	if (spot_colors.empty())
+		QSKIP("The map has no spot colors");
+	
+	QImage image(QSize(1920, 1080), QImage::Format_ARGB32_Premultiplied);
+	QPainter painter(&image);
+	painter.setRenderHint(QPainter::Antialiasing);
+	const auto config = setupView(painter, map, image, 1.0, RenderConfig::NoOptions);
+	QBENCHMARK
+	{
+		image.fill(Qt::white);
+		map.drawColorSeparations(&painter, config, spot_colors, [&image]() { image.fill(Qt::white); });
+	}
+}
+
+
+void MapDrawTest::updateAllObjects_data()
+{
+	maps_data();
+}
+
+void MapDrawTest::updateAllObjects()
+{
+	QFETCH(QString, map_filename);
+	
+	Map& map = this->map(map_filename);
+	QVERIFY(map.getNumObjects() > 0);
+	
+	QBENCHMARK
+	{
+		map.updateAllObjects();
+	}
+}
+
+
+QTEST_MAIN(MapDrawTest)
@@ -0,0 +1,87 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_MAP_DRAW_T_H
+#define _OPENORIENTEERING_MAP_DRAW_T_H
+
+#include <map>
+#include <memory>
+
+#include <QtTest/QtTest>
+
+class Map;
+
+
+/**
+ * @test Benchmarks the rendering of the example maps, of the test maps,
+ * and of synthetic large maps (see MapGenerator).
+ *
+ * The results can be written in a machine-readable format by the usual
+ * QtTest options, e.g. "map_draw_t -o results.xml,xml" or "map_draw_t -csv".
+ * The Mapper_Benchmark target writes the XML results of all benchmarks.
+ */
+class MapDrawTest : public QObject
+{
+Q_OBJECT
+private slots:
+	/** Initialization. */
+	void initTestCase();
+	
+	/** Draws the map at different zoom levels and viewport sizes. */
+	void draw();
+	void draw_data();
+	
+	/**
+	 * Verifies that drawing bands of colors concurrently gives the same
+	 * result as drawing the colors one after the other.
+	 */
+	void drawConcurrently();
+	void drawConcurrently_data();
+	
+	/**
+	 * Verifies that occlusion culling does not change the result, and
+	 * draws the map with occlusion culling.
+	 */
+	void drawOcclusionCulling();
+	void drawOcclusionCulling_data();
+	
+	/** Draws the spot color overprinting simulation. */
+	void drawOverprintingSimulation();
+	void drawOverprintingSimulation_data();
+	
+	/** Draws the separations of all spot colors. */
+	void drawColorSeparations();
+	void drawColorSeparations_data();
+	
+	/** Regenerates the renderables of all objects. */
+	void updateAllObjects();
+	void updateAllObjects_data();
+
+private:
+	/** Adds a row for each map. */
+	void maps_data();
+	
+	/** Returns the loaded map for the given path, loading or generating it when needed. */
+	Map& map(const QString& path);
+	
+	std::vector<QString> map_filenames;
+	std::map<QString, std::unique_ptr<Map>> maps;
+};
+
+#endif
@@ -0,0 +1,282 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "map_generator.h"
+
+#include <cmath>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <qmath.h>
+
+#include "../src/map.h"
+#include "../src/object.h"
+#include "../src/object_text.h"
+#include "../src/symbol.h"
+#include "../src/template.h"
+
+
+namespace
+{
+	const char* const words[] = { "Hill", "Marsh", "Lake", "Forest", "Start", "Finish", "Parking", "Camp" };
+}
+
+
+
+// ### MapGenerator::Options ###
+
+MapGenerator::Options::Options()
+ : num_objects(10000)
+ , vertices_per_object(10)
+ , texts_per_1000(10)
+ , num_templates(0)
+ , template_size(2000)
+ , extent(400.0, 400.0)
+ , seed(1)
+{
+	; // nothing
+}
+
+
+
+// ### MapGenerator ###
+
+MapGenerator::MapGenerator(const Options& options)
+ : options(options)
+ , state(options.seed)
+{
+	; // nothing
+}
+
+QString MapGenerator::isomSymbolSetPath(unsigned int scale)
+{
+	const QDir symbol_sets_dir(QFileInfo(__FILE__).dir().absoluteFilePath(QString("../symbol sets")));
+	const QString path = symbol_sets_dir.absoluteFilePath(QString("%1/ISOM_%1.omap").arg(scale));
+	return QFileInfo(path).exists() ? path : QString();
+}
+
+bool MapGenerator::loadSymbolSet(Map& map, const QString& path)
+{
+	return !path.isEmpty() && map.loadFrom(path, nullptr, nullptr, true, false);
+}
+
+void MapGenerator::generateObjects(Map& map)
+{
+	std::vector<const Symbol*> point_symbols, line_symbols, area_symbols, text_symbols;
+	for (int i = 0; i < map.getNumSymbols(); ++i)
+	{
+		const Symbol* symbol = map.getSymbol(i);
+		if (symbol->isHidden() || symbol->isHelperSymbol())
+			continue;
+		
+		switch (symbol->getType())
+		{
+		case Symbol::Point:
+			point_symbols.push_back(symbol);
+			break;
+		case Symbol::Text:
+			text_symbols.push_back(symbol);
+			break;
+		case Symbol::Line:
+		case Symbol::Area:
+		case Symbol::Combined:
+			if (symbol->getContainedTypes() & Symbol::Area)
+				area_symbols.push_back(symbol);
+			else
+				line_symbols.push_back(symbol);
+			break;
+		default:
+			; // nothing
+		}
+	}
+	
+	const int num_vertices = qMax(3, options.vertices_per_object);
+	for (int i = 0; i < options.num_objects; ++i)
+	{
+		// 40% line objects, 30% area objects, 30% point objects
+		const int kind = i % 10;
+		Object* object = nullptr;
+		if (kind < 4 && !line_symbols.empty())
+		{
+			PathObject* path = new PathObject(randomSymbol(line_symbols));
+			MapCoordF pos = randomPosition();
+			const double step = random(0.5, 2.0);
+			double direction = random(0.0, 2 * M_PI);
+			for (int j = 0; j < num_vertices; ++j)
+			{
+				path->addCoordinate(MapCoord(pos));
+				direction += random(-0.5, 0.5);
+				pos = clamped(pos + MapCoordF(step * std::cos(direction), step * std::sin(direction)));
+			}
+			object = path;
+		}
+		else if (kind < 7 && !area_symbols.empty())
+		{
+			PathObject* path = new PathObject(randomSymbol(area_symbols));
+			const MapCoordF center = randomPosition();
+			const double radius = random(1.0, 10.0);
+			for (int j = 0; j < num_vertices; ++j)
+			{
+				const double angle = j * 2 * M_PI / num_vertices;
+				const double r = radius * random(0.7, 1.0);
+				path->addCoordinate(MapCoord(clamped(center + MapCoordF(r * std::cos(angle), r * std::sin(angle)))));
+			}
+			path->closeAllParts();
+			object = path;
+		}
+		else if (kind >= 7 && !point_symbols.empty())
+		{
+			PointObject* point = new PointObject(randomSymbol(point_symbols));
+			point->setPosition(randomPosition());
+			object = point;
+		}
+		
+		if (object)
+			map.addObject(object);
+	}
+	
+	if (!text_symbols.empty())
+	{
+		const int num_texts = int(qint64(options.num_objects) * options.texts_per_1000 / 1000);
+		for (int i = 0; i < num_texts; ++i)
+		{
+			TextObject* text = new TextObject(randomSymbol(text_symbols));
+			text->setText(QString("%1 %2").arg(QString::fromLatin1(words[random(int(sizeof(words) / sizeof(words[0])))])).arg(i + 1));
+			text->setAnchorPosition(randomPosition());
+			map.addObject(text);
+		}
+	}
+}
+
+bool MapGenerator::generateTemplates(Map& map, const QDir& dir, const QString& basename)
+{
+	if (options.num_templates <= 0)
+		return true;
+	
+	const int columns = qCeil(std::sqrt(double(options.num_templates)));
+	const int rows = (options.num_templates + columns - 1) / columns;
+	const double cell_width = options.extent.width() / columns;
+	const double cell_height = options.extent.height() / rows;
+	const double scale = qMax(cell_width, cell_height) / options.template_size;
+	
+	for (int i = 0; i < options.num_templates; ++i)
+	{
+		// A smooth pattern with noise, similar to a scanned map or aerial image
+		QImage image(options.template_size, options.template_size, QImage::Format_RGB32);
+		const int phase = random(360);
+		for (int y = 0; y < image.height(); ++y)
+		{
+			QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+			for (int x = 0; x < image.width(); ++x)
+			{
+				const int value = 160 + int(40 * std::sin((x + phase) / 50.0) * std::cos((y - phase) / 70.0)) + random(32);
+				line[x] = qRgb(value, value + 16, value - 16);
+			}
+		}
+		
+		const QString path = dir.absoluteFilePath(QString("%1-template-%2.png").arg(basename).arg(i + 1));
+		if (!image.save(path))
+			return false;
+		
+		auto temp = Template::templateForFile(path, &map);
+		if (!temp)
+			return false;
+		
+		const MapCoordF center((i % columns + 0.5) * cell_width - options.extent.width() / 2,
+		                       (i / columns + 0.5) * cell_height - options.extent.height() / 2);
+		temp->setTemplatePosition(MapCoord(center));
+		temp->setTemplateScaleX(scale);
+		temp->setTemplateScaleY(scale);
+		temp->setTemplateRelativePath(QFileInfo(path).fileName());
+		temp->setTemplateState(Template::Unloaded);
+		map.addTemplate(temp.release(), map.getNumTemplates());
+	}
+	return true;
+}
+
+MapCoordVector MapGenerator::generateRing(int num_vertices, double radius, bool curves)
+{
+	num_vertices = qMax(3, num_vertices);
+	std::vector<MapCoordF> vertices;
+	vertices.reserve(std::size_t(num_vertices));
+	for (int j = 0; j < num_vertices; ++j)
+	{
+		const double angle = j * 2 * M_PI / num_vertices;
+		const double r = radius * random(0.7, 1.0);
+		vertices.push_back(MapCoordF(r * std::cos(angle), r * std::sin(angle)));
+	}
+	
+	MapCoordVector coords;
+	coords.reserve(std::size_t(curves ? 3 * num_vertices + 1 : num_vertices + 1));
+	for (std::size_t j = 0; j < vertices.size(); ++j)
+	{
+		const MapCoordF& current = vertices[j];
+		coords.push_back(MapCoord(current));
+		if (curves)
+		{
+			// The handles are pushed away from the center by a quarter of the edge.
+			const MapCoordF& next = vertices[(j + 1) % vertices.size()];
+			const MapCoordF edge = next - current;
+			const MapCoordF bulge = (current + next) * (0.25 * edge.length() / qMax(0.001, (current + next).length()));
+			coords.back().setCurveStart(true);
+			coords.push_back(MapCoord(current + edge / 3 + bulge));
+			coords.push_back(MapCoord(current + edge * 2 / 3 + bulge));
+		}
+	}
+	
+	MapCoord close_point(vertices.front());
+	close_point.setClosePoint(true);
+	close_point.setHolePoint(true);
+	coords.push_back(close_point);
+	return coords;
+}
+
+int MapGenerator::random(int range)
+{
+	// A linear congruential generator, independent of the platform's rand()
+	state = state * 1103515245u + 12345u;
+	return int((state >> 8) % quint32(range));
+}
+
+double MapGenerator::random(double min, double max)
+{
+	return min + (max - min) * random(1 << 20) / double(1 << 20);
+}
+
+MapCoordF MapGenerator::randomPosition()
+{
+	const double x = random(-options.extent.width() / 2, options.extent.width() / 2);
+	const double y = random(-options.extent.height() / 2, options.extent.height() / 2);
+	return MapCoordF(x, y);
+}
+
+MapCoordF MapGenerator::clamped(MapCoordF pos) const
+{
+	const double half_width = options.extent.width() / 2;
+	const double half_height = options.extent.height() / 2;
+	return MapCoordF(qBound(-half_width, pos.x(), half_width),
+	                 qBound(-half_height, pos.y(), half_height));
+}
+
+const Symbol* MapGenerator::randomSymbol(const std::vector<const Symbol*>& symbols)
+{
+	Q_ASSERT(!symbols.empty());
+	return symbols[std::size_t(random(int(symbols.size())))];
+}
@@ -0,0 +1,138 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_MAP_GENERATOR_H
+#define _OPENORIENTEERING_MAP_GENERATOR_H
+
+#include <vector>
+
+#include <QSizeF>
+#include <QString>
+
+#include "../src/core/map_coord.h"
+
+class QDir;
+
+class Map;
+class Symbol;
+
+
+/**
+ * Generates synthetic maps of arbitrary size, for scaling tests and benchmarks.
+ *
+ * Real large maps can rarely be shared. The synthetic maps use the symbols of
+ * a symbol set (normally one of the ISOM sets), and they are generated from a
+ * seed, so that the same options always produce the same map.
+ *
+ * The objects are a mix of line, area and point objects, and text objects at
+ * the given density. Templates are images which are generated on request.
+ */
+class MapGenerator
+{
+public:
+	/** The parameters of a synthetic map. */
+	struct Options
+	{
+		/** Constructs the default options. */
+		Options();
+		
+		/** The number of line, area and point objects. */
+		int num_objects;
+		
+		/** The number of vertices of each line and area object. */
+		int vertices_per_object;
+		
+		/** The number of text objects per 1000 other objects. */
+		int texts_per_1000;
+		
+		/** The number of image templates. */
+		int num_templates;
+		
+		/** The width and height of each template image, in pixels. */
+		int template_size;
+		
+		/** The size of the area covered by objects and templates, in mm. */
+		QSizeF extent;
+		
+		/** The seed of the random numbers. */
+		quint32 seed;
+	};
+	
+	/** Constructs a generator for the given options. */
+	explicit MapGenerator(const Options& options);
+	
+	/**
+	 * Returns the path of the ISOM symbol set for the given scale,
+	 * in the source tree, or an empty string if there is no such set.
+	 */
+	static QString isomSymbolSetPath(unsigned int scale = 10000);
+	
+	/**
+	 * Loads the colors and symbols of the given symbol set into the map.
+	 *
+	 * Returns false on error.
+	 */
+	static bool loadSymbolSet(Map& map, const QString& path);
+	
+	/**
+	 * Adds the objects to the map.
+	 *
+	 * Uses the map's visible non-helper symbols. Does nothing for the types
+	 * of objects for which there is no symbol.
+	 */
+	void generateObjects(Map& map);
+	
+	/**
+	 * Writes the template images to the given directory, and adds them
+	 * to the map as templates in a grid which covers the extent.
+	 *
+	 * The templates are added in unloaded state. Returns false on error.
+	 */
+	bool generateTemplates(Map& map, const QDir& dir, const QString& basename);
+	
+	/**
+	 * Returns the coordinates of a closed, star-shaped path with the given
+	 * number of vertices around the origin, for benchmarks of the geometry.
+	 *
+	 * The radius varies randomly between 70% and 100% of the given radius.
+	 * When curves is true, all edges are curves which bulge outwards.
+	 */
+	MapCoordVector generateRing(int num_vertices, double radius, bool curves);
+
+private:
+	/** Returns a random number in the range [0, range). */
+	int random(int range);
+	
+	/** Returns a random number in the range [min, max]. */
+	double random(double min, double max);
+	
+	/** Returns a random position within the extent. */
+	MapCoordF randomPosition();
+	
+	/** Returns the position, moved into the extent if necessary. */
+	MapCoordF clamped(MapCoordF pos) const;
+	
+	/** Returns a random element of a non-empty vector of symbols. */
+	const Symbol* randomSymbol(const std::vector<const Symbol*>& symbols);
+	
+	Options options;
+	quint32 state;
+};
+
+#endif
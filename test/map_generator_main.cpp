@@ -0,0 +1,104 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <initializer_list>
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+
+#include "../src/global.h"
+#include "../src/map.h"
+
+#include "map_generator.h"
+
+
+/**
+ * Writes a synthetic map for scaling tests, with the options given on
+ * the command line. Run "map_generator --help" for the options.
+ */
+int main(int argc, char** argv)
+{
+	QApplication app(argc, argv);
+	QCoreApplication::setOrganizationName("OpenOrienteering.org");
+	QCoreApplication::setApplicationName("MapGenerator");
+	
+	MapGenerator::Options options;
+	
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Generates a synthetic map for scaling tests.");
+	parser.addHelpOption();
+	QCommandLineOption objects_option("objects", "The number of line, area and point objects.", "number", QString::number(options.num_objects));
+	QCommandLineOption vertices_option("vertices", "The number of vertices per line and area object.", "number", QString::number(options.vertices_per_object));
+	QCommandLineOption texts_option("texts", "The number of text objects per 1000 other objects.", "number", QString::number(options.texts_per_1000));
+	QCommandLineOption templates_option("templates", "The number of image templates.", "number", QString::number(options.num_templates));
+	QCommandLineOption template_size_option("template-size", "The size of the template images, in pixels.", "pixels", QString::number(options.template_size));
+	QCommandLineOption extent_option("extent", "The width and height of the map area, in mm.", "mm", QString::number(options.extent.width()));
+	QCommandLineOption seed_option("seed", "The seed of the random numbers.", "number", QString::number(options.seed));
+	QCommandLineOption symbol_set_option("symbol-set", "The symbol set file. The default is the ISOM symbol set of the given scale.", "file");
+	QCommandLineOption scale_option("scale", "The scale of the default symbol set.", "denominator", QString("10000"));
+	for (const auto& option : { objects_option, vertices_option, texts_option, templates_option, template_size_option, extent_option, seed_option, symbol_set_option, scale_option })
+		parser.addOption(option);
+	parser.addPositionalArgument("output", "The map file to be written, e.g. large.omap.");
+	parser.process(app);
+	
+	const QStringList args = parser.positionalArguments();
+	if (args.size() != 1)
+		parser.showHelp(1);
+	
+	options.num_objects = parser.value(objects_option).toInt();
+	options.vertices_per_object = parser.value(vertices_option).toInt();
+	options.texts_per_1000 = parser.value(texts_option).toInt();
+	options.num_templates = parser.value(templates_option).toInt();
+	options.template_size = parser.value(template_size_option).toInt();
+	const double extent = parser.value(extent_option).toDouble();
+	options.extent = QSizeF(extent, extent);
+	options.seed = parser.value(seed_option).toUInt();
+	
+	const QString symbol_set = parser.isSet(symbol_set_option)
+	                           ? parser.value(symbol_set_option)
+	                           : MapGenerator::isomSymbolSetPath(parser.value(scale_option).toUInt());
+	
+	doStaticInitializations();
+	
+	Map map;
+	if (!MapGenerator::loadSymbolSet(map, symbol_set))
+	{
+		std::fprintf(stderr, "Cannot load the symbol set '%s'.\n", qPrintable(symbol_set));
+		return 1;
+	}
+	
+	const QFileInfo output(args.front());
+	MapGenerator generator(options);
+	generator.generateObjects(map);
+	if (!generator.generateTemplates(map, output.absoluteDir(), output.completeBaseName()))
+	{
+		std::fprintf(stderr, "Cannot write the template images.\n");
+		return 1;
+	}
+	
+	if (!map.exportTo(output.absoluteFilePath()))
+	{
+		std::fprintf(stderr, "Cannot write '%s'.\n", qPrintable(output.absoluteFilePath()));
+		return 1;
+	}
+	return 0;
+}
@@ -19,13 +19,113 @@
 
 #include "map_t.h"
 
+#include <algorithm>
+#include <memory>
+
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QTemporaryDir>
+
+#include "../src/autosave_journal.h"
 #include "../src/map.h"
+#include "../src/map_quality_check.h"
+#include "../src/map_part.h"
+#include "../src/map_tile_cache.h"
+#include "../src/memory_usage.h"
+#include "../src/object.h"
+#include "../src/object_undo.h"
+#include "../src/object_text.h"
+#include "../src/renderable.h"
+#include "../src/settings.h"
+#include "../src/symbol.h"
+#include "../src/symbol_area.h"
+#include "../src/symbol_cost_report.h"
+#include "../src/symbol_line.h"
+#include "../src/symbol_point.h"
+#include "../src/undo_manager.h"
 #include "../src/core/map_color.h"
+#include "../src/core/map_thumbnail_cache.h"
 #include "../src/core/map_view.h"
 
 namespace
 {
 	static QDir examples_dir;
+	
+	/**
+	 * Adds a black color and a line symbol with the given width to the map.
+	 * 
+	 * Returns the line symbol.
+	 */
+	LineSymbol* initTestMap(Map& map, double line_width = 1.0)
+	{
+		auto black = new MapColor(QString("black"), 0);
+		map.addColor(black, 0);
+		auto line = new LineSymbol();
+		line->setColor(black);
+		line->setLineWidth(line_width);
+		map.addSymbol(line, 0);
+		return line;
+	}
+	
+	/** Writes a dummy base file for an autosave journal. */
+	bool writeJournalBase(const QString& base_path)
+	{
+		QFile file(base_path);
+		return file.open(QIODevice::WriteOnly) && file.write("base") == 4;
+	}
+	
+	/** Adds a line with the first symbol at the given y, and pushes the undo step. */
+	void addLine(Map& map, double y)
+	{
+		auto object = new PathObject(map.getSymbol(0), MapCoordVector{ MapCoord(0.0, y), MapCoord(10.0, y) });
+		auto undo_step = new DeleteObjectsUndoStep(&map);
+		undo_step->setPartIndex(map.getCurrentPartIndex());
+		undo_step->addObject(map.addObject(object));
+		map.push(undo_step);
+	}
+	
+	/** Moves the object at the given index, and pushes the undo step. */
+	void moveObject(Map& map, int index, qint32 dx)
+	{
+		Object* object = map.getCurrentPart()->getObject(index);
+		auto undo_step = new ReplaceObjectsUndoStep(&map);
+		undo_step->setPartIndex(map.getCurrentPartIndex());
+		undo_step->addObject(index, object->duplicate());
+		object->move(dx, 0);
+		map.push(undo_step);
+	}
+	
+	/** Exports the journaled changes, and writes them to the journal file. */
+	bool writeJournal(AutosaveJournal& journal, const QString& base_path)
+	{
+		QByteArray data;
+		bool append;
+		if (!journal.exportChanges(base_path, data, append))
+			return false;
+		
+		QFile file(AutosaveJournal::journalPath(base_path));
+		return file.open(append ? QIODevice::Append : QIODevice::WriteOnly)
+		       && file.write(data) == data.size();
+	}
+	
+	/** Returns true if the current parts of the maps have equal objects. */
+	bool equalObjects(Map& map, Map& other)
+	{
+		MapPart* part = map.getCurrentPart();
+		MapPart* other_part = other.getCurrentPart();
+		if (part->getNumObjects() != other_part->getNumObjects())
+			return false;
+		for (int i = 0; i < part->getNumObjects(); ++i)
+		{
+			const Object* object = part->getObject(i);
+			const Object* other_object = other_part->getObject(i);
+			if (!object->equals(other_object, false)
+			    || map.findSymbolIndex(object->getSymbol()) != other.findSymbolIndex(other_object->getSymbol()))
+				return false;
+		}
+		return true;
+	}
 }
 
 void MapTest::initTestCase()
@@ -85,7 +185,7 @@ void MapTest::importTest_data()
 {
 	QTest::addColumn<QString>("first_file");
 	QTest::addColumn<QString>("imported_file");
-
+	
 	QTest::newRow("complete map, sprint sample")  << "complete map.omap" << "sprint sample.omap";
 	QTest::newRow("complete map, overprinting")   << "complete map.omap" << "overprinting.omap";
 	QTest::newRow("overprinting, forest sample")  << "overprinting.omap" << "forest sample.omap";
@@ -131,6 +231,1037 @@ void MapTest::importTest()
 	QCOMPARE(map.getNumObjects(), original_size + imported_map.getNumObjects());
 }
 
+void MapTest::memoryUsageTest()
+{
+	Map map;
+	QVERIFY(map.loadFrom(examples_dir.absoluteFilePath(QString("complete map.omap")), nullptr, nullptr, false, false));
+	
+	const MemoryUsage usage = MemoryUsage::measure(map);
+	QCOMPARE(usage.numObjects(), map.getNumObjects());
+	QVERIFY(usage.bytes(MemoryUsage::ObjectCoords) >= qint64(map.getNumObjects() * sizeof(MapCoord)));
+	QVERIFY(usage.bytes(MemoryUsage::PathCoords) > 0);
+	QVERIFY(usage.bytes(MemoryUsage::LineRenderables) > 0);
+	QVERIFY(usage.bytes(MemoryUsage::AreaRenderables) > 0);
+	QCOMPARE(usage.bytes(MemoryUsage::UndoSteps), qint64(0));
+	QCOMPARE(usage.bytes(MemoryUsage::WidgetCaches), qint64(0));
+	
+	qint64 sum = 0;
+	for (int i = 0; i < MemoryUsage::NumCategories; ++i)
+		sum += usage.bytes(MemoryUsage::Category(i));
+	QCOMPARE(usage.total(), sum);
+	
+	// Discarding the renderables must be reflected.
+	for (int i = 0; i < map.getNumParts(); ++i)
+	{
+		MapPart* part = map.getPart(i);
+		for (int j = 0; j < part->getNumObjects(); ++j)
+			part->getObject(j)->clearRenderables();
+	}
+	const MemoryUsage cleared = MemoryUsage::measure(map);
+	QCOMPARE(cleared.bytes(MemoryUsage::ObjectCoords), usage.bytes(MemoryUsage::ObjectCoords));
+	QVERIFY(cleared.bytes(MemoryUsage::AreaRenderables) < usage.bytes(MemoryUsage::AreaRenderables));
+}
+
+void MapTest::symbolCostReportTest()
+{
+	Map map;
+	MapView view(&map);
+	QVERIFY(map.loadFrom(examples_dir.absoluteFilePath(QString("complete map.omap")), nullptr, &view, false, false));
+	
+	const SymbolCostReport report = SymbolCostReport::measure(map, view);
+	QVERIFY(!report.entries().empty());
+	QCOMPARE(report.total().num_objects, map.getNumObjects());
+	
+	int num_objects = 0;
+	qint64 memory = 0;
+	for (const auto& entry : report.entries())
+	{
+		QVERIFY(entry.symbol);
+		QVERIFY(map.findSymbolIndex(entry.symbol) >= 0);
+		QVERIFY(entry.num_objects > 0);
+		num_objects += entry.num_objects;
+		memory += entry.memory;
+	}
+	QCOMPARE(num_objects, report.total().num_objects);
+	QCOMPARE(memory, report.total().memory);
+	QVERIFY(report.total().num_renderables > 0);
+	
+	// The most expensive symbols come first.
+	const auto& first = report.entries().front();
+	const auto& last = report.entries().back();
+	QVERIFY(first.update_time + first.render_time >= last.update_time + last.render_time);
+	
+	// One line per entry, plus header and total.
+	QCOMPARE(report.toText().count(QLatin1Char('\n')) + 1, int(report.entries().size()) + 2);
+}
+
+void MapTest::bulkSelectionTest()
+{
+	Map map;
+	MapView view(&map);
+	QVERIFY(map.loadFrom(examples_dir.absoluteFilePath(QString("complete map.omap")), nullptr, &view, false, false));
+	
+	MapPart* part = map.getCurrentPart();
+	QVERIFY(part->getNumObjects() > 2);
+	
+	std::vector<Object*> objects;
+	for (int i = 0; i < part->getNumObjects(); ++i)
+		objects.push_back(part->getObject(i));
+	
+	QCOMPARE(map.addObjectsToSelection(objects, false), objects.size());
+	QCOMPARE(map.getNumSelectedObjects(), int(objects.size()));
+	QVERIFY(map.getFirstSelectedObject());
+	
+	// Objects which are already selected are not added again.
+	QCOMPARE(map.addObjectsToSelection(objects, false), std::size_t(0));
+	
+	std::vector<Object*> removed(objects.begin(), objects.begin() + 2);
+	QCOMPARE(map.removeObjectsFromSelection(removed, false), std::size_t(2));
+	QCOMPARE(map.getNumSelectedObjects(), int(objects.size()) - 2);
+	QVERIFY(!map.isObjectSelected(objects[0]));
+	QVERIFY(!map.isObjectSelected(objects[1]));
+	QVERIFY(map.isObjectSelected(objects[2]));
+	QVERIFY(map.getFirstSelectedObject() != objects[0]);
+	QVERIFY(map.getFirstSelectedObject() != objects[1]);
+	
+	QCOMPARE(map.removeObjectsFromSelection(removed, false), std::size_t(0));
+	map.clearObjectSelection(false);
+	QCOMPARE(map.getNumSelectedObjects(), 0);
+}
+
+void MapTest::symbolsWithColorTest()
+{
+	Map map;
+	MapView view(&map);
+	QVERIFY(map.loadFrom(examples_dir.absoluteFilePath(QString("complete map.omap")), nullptr, &view, false, false));
+	QVERIFY(map.getNumColors() > 0);
+	
+	for (int c = 0; c < map.getNumColors(); ++c)
+	{
+		const MapColor* color = map.getColor(c);
+		std::vector<int> expected;
+		for (int i = 0; i < map.getNumSymbols(); ++i)
+		{
+			if (map.getSymbol(i)->containsColor(color))
+				expected.push_back(i);
+		}
+		QCOMPARE(map.findSymbolsWithColor(color), expected);
+	}
+	
+	// The index must follow changes of the symbols.
+	const MapColor* color = map.getColor(0);
+	const auto num_symbols = map.findSymbolsWithColor(color).size();
+	QVERIFY(num_symbols > 0);
+	map.deleteSymbol(map.findSymbolsWithColor(color).front());
+	QVERIFY(map.findSymbolsWithColor(color).size() < num_symbols);
+}
+
+void MapTest::tagIndexTest()
+{
+	Map map;
+	MapPart* part = map.getCurrentPart();
+	std::vector<Object*> objects;
+	for (int i = 0; i < 3; ++i)
+	{
+		Object* object = new PointObject(map.getUndefinedPoint());
+		part->addObject(object, i);
+		objects.push_back(object);
+	}
+	
+	objects[0]->setTag(QString("highway"), QString("track"));
+	objects[1]->setTag(QString("highway"), QString("path"));
+	objects[2]->setTag(QString("name"), QString("track"));
+	
+	// Equal strings share their data.
+	QVERIFY(objects[0]->tags().constBegin().value().constData() == objects[2]->tags().constBegin().value().constData());
+	QVERIFY(objects[0]->tags().constBegin().key().constData() == objects[1]->tags().constBegin().key().constData());
+	
+	QCOMPARE(map.findObjectsWithTag("highway"), std::vector<Object*>({ objects[0], objects[1] }));
+	QCOMPARE(map.findObjectsWithTag("highway", "path"), std::vector<Object*>({ objects[1] }));
+	QCOMPARE(map.findObjectsWithTag("name", "track"), std::vector<Object*>({ objects[2] }));
+	QVERIFY(map.findObjectsWithTag("surface").empty());
+	
+	// The index must follow changes of the tags and of the objects.
+	objects[1]->removeTag("highway");
+	QCOMPARE(map.findObjectsWithTag("highway"), std::vector<Object*>({ objects[0] }));
+	part->deleteObject(objects[0], false);
+	QVERIFY(map.findObjectsWithTag("highway").empty());
+}
+
+void MapTest::objectQueryTest()
+{
+	Map map;
+	MapView view(&map);
+	QVERIFY(map.loadFrom(examples_dir.absoluteFilePath(QString("complete map.omap")), nullptr, &view, false, false));
+	MapPart* part = map.getCurrentPart();
+	QVERIFY(part->getNumObjects() > 2);
+	
+	Object* first = part->getObject(0);
+	Object* last = part->getObject(part->getNumObjects() - 1);
+	first->setTag("bridge", "yes");
+	last->setTag("bridge", "no");
+	map.updateObjects();
+	
+	ObjectQuery query;
+	query.tag_key = "bridge";
+	QCOMPARE(map.findObjects(query), std::vector<Object*>({ first, last }));
+	
+	query.tag_value = "no";
+	QCOMPARE(map.findObjects(query), std::vector<Object*>({ last }));
+	
+	query.symbol = first->getSymbol();
+	QCOMPARE(map.findObjects(query).empty(), first->getSymbol() != last->getSymbol());
+	
+	// Symbol and area, without tags
+	query = ObjectQuery();
+	query.symbol = first->getSymbol();
+	query.area = first->getExtent();
+	query.part = part;
+	const std::vector<Object*> result = map.findObjects(query);
+	QVERIFY(std::find(result.begin(), result.end(), first) != result.end());
+	for (const Object* object : result)
+	{
+		QCOMPARE(object->getSymbol(), first->getSymbol());
+		QVERIFY(object->getExtent().intersects(query.area));
+	}
+	
+	// Area only, in map order
+	query.symbol = nullptr;
+	std::vector<Object*> expected;
+	for (int i = 0; i < part->getNumObjects(); ++i)
+	{
+		if (part->getObject(i)->getExtent().intersects(query.area))
+			expected.push_back(part->getObject(i));
+	}
+	QCOMPARE(map.findObjects(query), expected);
+}
+
+void MapTest::symbolIndexTest()
+{
+	Map map;
+	MapView view(&map);
+	QVERIFY(map.loadFrom(examples_dir.absoluteFilePath(QString("complete map.omap")), nullptr, &view, false, false));
+	MapPart* part = map.getCurrentPart();
+	QVERIFY(part->getNumObjects() > 0);
+	
+	auto count_with_symbol = [part](const Symbol* symbol) -> std::size_t {
+		std::size_t count = 0;
+		for (int i = 0; i < part->getNumObjects(); ++i)
+		{
+			if (part->getObject(i)->getSymbol() == symbol)
+				++count;
+		}
+		return count;
+	};
+	
+	const Symbol* symbol = part->getObject(0)->getSymbol();
+	std::vector<Object*> found;
+	part->findObjectsWithSymbol(symbol, found);
+	QCOMPARE(found.size(), count_with_symbol(symbol));
+	QVERIFY(map.existsObjectWithSymbol(symbol));
+	
+	// Added objects
+	Object* duplicate = part->getObject(0)->duplicate();
+	map.addObject(duplicate);
+	found.clear();
+	part->findObjectsWithSymbol(symbol, found);
+	QCOMPARE(found.size(), count_with_symbol(symbol));
+	QVERIFY(std::find(found.begin(), found.end(), duplicate) != found.end());
+	
+	// Changed symbols
+	Symbol* other_symbol = nullptr;
+	for (int i = 0; i < map.getNumSymbols() && !other_symbol; ++i)
+	{
+		if (map.getSymbol(i) != symbol && map.getSymbol(i)->isTypeCompatibleTo(duplicate))
+			other_symbol = map.getSymbol(i);
+	}
+	QVERIFY(other_symbol);
+	const std::size_t num_other = count_with_symbol(other_symbol);
+	QVERIFY(duplicate->setSymbol(other_symbol, false));
+	found.clear();
+	part->findObjectsWithSymbol(other_symbol, found);
+	QCOMPARE(found.size(), num_other + 1);
+	
+	map.changeSymbolForAllObjects(other_symbol, symbol);
+	QCOMPARE(count_with_symbol(other_symbol), std::size_t(0));
+	QVERIFY(!map.existsObjectWithSymbol(other_symbol));
+	
+	// Deleted objects
+	QVERIFY(map.deleteAllObjectsWithSymbol(symbol));
+	QCOMPARE(count_with_symbol(symbol), std::size_t(0));
+	QVERIFY(!map.existsObjectWithSymbol(symbol));
+	QVERIFY(!map.deleteAllObjectsWithSymbol(symbol));
+	
+	// Symbols in use
+	std::vector<bool> in_use;
+	map.determineSymbolsInUse(in_use);
+	QCOMPARE(in_use.size(), std::size_t(map.getNumSymbols()));
+	for (int i = 0; i < part->getNumObjects(); ++i)
+	{
+		const int index = map.findSymbolIndex(part->getObject(i)->getSymbol());
+		if (index >= 0)
+			QVERIFY(in_use[index]);
+	}
+}
+
+void MapTest::objectIndexTest()
+{
+	Map map;
+	MapView view(&map);
+	QVERIFY(map.loadFrom(examples_dir.absoluteFilePath(QString("complete map.omap")), nullptr, &view, false, false));
+	MapPart* part = map.getCurrentPart();
+	QVERIFY(part->getNumObjects() > 3);
+	
+	auto verify_indices = [part]() -> bool {
+		for (int i = 0; i < part->getNumObjects(); ++i)
+		{
+			if (part->findObjectIndex(part->getObject(i)) != i)
+				return false;
+		}
+		return true;
+	};
+	QVERIFY(verify_indices());
+	
+	// Inserted objects
+	Object* duplicate = part->getObject(0)->duplicate();
+	part->addObject(duplicate, 1);
+	QCOMPARE(part->findObjectIndex(duplicate), 1);
+	QVERIFY(verify_indices());
+	
+	// Bulk deletion of selected objects, and undo
+	std::vector<Object*> original_objects;
+	for (int i = 0; i < part->getNumObjects(); ++i)
+		original_objects.push_back(part->getObject(i));
+	
+	map.clearObjectSelection(false);
+	for (std::size_t i = 0; i < original_objects.size(); i += 3)
+		map.addObjectToSelection(original_objects[i], false);
+	const int num_selected = map.getNumSelectedObjects();
+	map.deleteSelectedObjects();
+	QCOMPARE(part->getNumObjects(), int(original_objects.size()) - num_selected);
+	QVERIFY(verify_indices());
+	
+	QVERIFY(map.undoManager().undo(nullptr));
+	QCOMPARE(part->getNumObjects(), int(original_objects.size()));
+	for (int i = 0; i < part->getNumObjects(); ++i)
+		QCOMPARE(part->getObject(i), original_objects[i]);
+	QVERIFY(verify_indices());
+	
+	// Deletion by pointer
+	QVERIFY(part->deleteObject(duplicate, false));
+	QCOMPARE(part->getNumObjects(), int(original_objects.size()) - 1);
+	QVERIFY(verify_indices());
+}
+
+void MapTest::colorRenderKeyTest()
+{
+	Map map;
+	auto color_a = new MapColor(QString("a"), 0);
+	map.addColor(color_a, 0);
+	auto color_b = new MapColor(QString("b"), 1);
+	map.addColor(color_b, 1);
+	const int key_a = color_a->getRenderKey();
+	const int key_b = color_b->getRenderKey();
+	QVERIFY(key_a != key_b);
+	QCOMPARE(map.renderKeyToPriority(key_a), 0);
+	QCOMPARE(map.renderKeyToPriority(key_b), 1);
+	
+	// Reordering, as done by the color dock widget
+	map.setColor(color_b, 0);
+	map.setColor(color_a, 1);
+	QCOMPARE(color_a->getRenderKey(), key_a);
+	QCOMPARE(color_b->getRenderKey(), key_b);
+	QCOMPARE(map.renderKeyToPriority(key_a), 1);
+	QCOMPARE(map.renderKeyToPriority(key_b), 0);
+	
+	// Inserting a duplicate
+	auto color_c = new MapColor(*color_a);
+	map.addColor(color_c, 0);
+	const int key_c = color_c->getRenderKey();
+	QVERIFY(key_c != key_a);
+	QVERIFY(key_c != key_b);
+	QCOMPARE(map.renderKeyToPriority(key_c), 0);
+	QCOMPARE(map.renderKeyToPriority(key_b), 1);
+	QCOMPARE(map.renderKeyToPriority(key_a), 2);
+	
+	// Deleting
+	map.deleteColor(0);
+	QCOMPARE(map.renderKeyToPriority(key_b), 0);
+	QCOMPARE(map.renderKeyToPriority(key_a), 1);
+	QVERIFY(map.renderKeyToPriority(key_c) >= map.getNumColors());
+	
+	QCOMPARE(map.renderKeyToPriority(MapColor::Reserved), int(MapColor::Reserved));
+}
+
+void MapTest::sharedPointRenderablesTest()
+{
+	Map map;
+	auto color = new MapColor(QString("black"), 0);
+	map.addColor(color, 0);
+	
+	auto line = new LineSymbol();
+	line->setColor(color);
+	line->setLineWidth(0.5);
+	auto element = new PathObject(line, MapCoordVector{ MapCoord(-1.0, 0.0), MapCoord(1.0, 0.0) });
+	
+	auto point = new PointSymbol();
+	point->setInnerRadius(0);
+	point->addElement(0, element, line);
+	map.addSymbol(point, 0);
+	
+	auto first = new PointObject(point);
+	first->setPosition(MapCoordF(10.0, 10.0));
+	map.addObject(first);
+	auto second = new PointObject(point);
+	second->setPosition(MapCoordF(20.0, 10.0));
+	map.addObject(second);
+	map.updateObjects();
+	
+	// The objects share the prototype, but they keep their own positions.
+	QCOMPARE(first->getExtent().center(), QPointF(10.0, 10.0));
+	QCOMPARE(second->getExtent(), first->getExtent().translated(10.0, 0.0));
+	
+	// Changing the symbol must not leave stale renderables.
+	const auto old_height = first->getExtent().height();
+	line->setLineWidth(1.0);
+	map.updateAllObjectsWithSymbol(point);
+	QVERIFY(first->getExtent().height() > old_height);
+	QCOMPARE(second->getExtent(), first->getExtent().translated(10.0, 0.0));
+}
+
+void MapTest::extentTest()
+{
+	Map map;
+	auto line = initTestMap(map);
+	
+	map.addObject(new PathObject(line, MapCoordVector{ MapCoord(0.0, 0.0), MapCoord(10.0, 0.0) }));
+	const QRectF extent = map.calculateExtent();
+	QVERIFY(extent.contains(QPointF(10.0, 0.0)));
+	QCOMPARE(map.calculateExtent(), extent);
+	
+	auto far_object = new PathObject(line, MapCoordVector{ MapCoord(100.0, 0.0), MapCoord(110.0, 0.0) });
+	map.addObject(far_object);
+	QVERIFY(map.calculateExtent().contains(QPointF(110.0, 0.0)));
+	
+	far_object->move(MapCoord(0.0, 50.0));
+	QVERIFY(map.calculateExtent().contains(QPointF(110.0, 50.0)));
+	QVERIFY(!map.calculateExtent().contains(QPointF(110.0, 0.0)));
+	
+	map.deleteObject(far_object, false);
+	QCOMPARE(map.calculateExtent(), extent);
+	
+	// Hiding a symbol changes the objects revision, and thus the extent.
+	const quint64 revision = map.getObjectsRevision();
+	map.setSymbolHidden(line, true);
+	QVERIFY(map.getObjectsRevision() != revision);
+	QVERIFY(!map.calculateExtent().isValid());
+}
+
+void MapTest::addObjectsTest()
+{
+	Map map;
+	auto line = initTestMap(map);
+	map.addObject(new PathObject(line, MapCoordVector{ MapCoord(0.0, 0.0), MapCoord(10.0, 0.0) }));
+	
+	std::vector<Object*> objects;
+	for (int i = 1; i <= 3; ++i)
+		objects.push_back(new PathObject(line, MapCoordVector{ MapCoord(0.0, 10.0 * i), MapCoord(10.0, 10.0 * i) }));
+	QCOMPARE(map.addObjects(objects), 1);
+	QCOMPARE(map.getNumObjects(), 4);
+	
+	// The objects are in order and up to date.
+	MapPart* part = map.getCurrentPart();
+	for (int i = 0; i < 3; ++i)
+	{
+		QCOMPARE(part->getObject(i + 1), objects[i]);
+		QVERIFY(!objects[i]->isOutputDirty());
+		QVERIFY(objects[i]->getExtent().contains(QPointF(5.0, 10.0 * (i + 1))));
+	}
+	QVERIFY(map.existsObjectWithSymbol(line));
+}
+
+void MapTest::mapTileStoreTest()
+{
+	Map map;
+	MapTileCache first;
+	MapTileCache second;
+	first.setStore(map.getMapTileStore());
+	second.setStore(map.getMapTileStore());
+	
+	const QRect viewport(0, 0, MapTileCache::tile_size, MapTileCache::tile_size);
+	const QTransform transform = QTransform::fromScale(2.0, 2.0);
+	first.setTransform(transform);
+	QRect tile = first.nextInvalidTile(viewport);
+	QCOMPARE(tile, viewport);
+	first.tileImage(tile).fill(Qt::white);
+	QVERIFY(!first.nextInvalidTile(viewport).isValid());
+	
+	// The same zoom, panned by full tiles, uses the tile drawn for the first cache.
+	const int shift = MapTileCache::tile_size;
+	second.setTransform(transform * QTransform::fromTranslate(shift, 0));
+	QVERIFY(!second.nextInvalidTile(viewport.translated(shift, 0)).isValid());
+	QVERIFY(second.nextInvalidTile(viewport).isValid());
+	
+	// Another render key needs other tiles.
+	second.setTransform(transform, 1);
+	QVERIFY(second.nextInvalidTile(viewport).isValid());
+	
+	// Invalidation affects all caches.
+	second.setTransform(transform);
+	first.invalidate(QRectF(0.0, 0.0, 1.0, 1.0), 1);
+	QVERIFY(second.nextInvalidTile(viewport).isValid());
+}
+
+void MapTest::thumbnailTest()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString path = dir.path() + QLatin1String("/thumbnail.omap");
+	
+	Map map;
+	auto line = initTestMap(map, 20.0);
+	map.addObject(new PathObject(line, MapCoordVector{ MapCoord(0.0, 0.0), MapCoord(100.0, 0.0) }));
+	QVERIFY(map.exportTo(path));
+	
+	const QImage image = MapThumbnailCache::renderThumbnail(path, 32);
+	QCOMPARE(image.size(), QSize(32, 32));
+	// The line crosses the center of the thumbnail.
+	QVERIFY(qGray(image.pixel(16, 16)) < 64);
+	QCOMPARE(qGray(image.pixel(16, 2)), 255);
+	
+	QVERIFY(MapThumbnailCache::renderThumbnail(dir.path() + QLatin1String("/missing.omap"), 32).isNull());
+}
+
+void MapTest::snapshotTest()
+{
+	Map map;
+	auto line = initTestMap(map);
+	auto object = new PathObject(line, MapCoordVector{ MapCoord(0.0, 0.0), MapCoord(10.0, 0.0) });
+	map.addObject(object);
+	map.addPart(new MapPart(QString("second"), &map), 1);
+	
+	auto snapshot = map.snapshot();
+	QVERIFY(bool(snapshot));
+	QCOMPARE(map.snapshot(), snapshot);
+	QCOMPARE(snapshot->getNumColors(), 1);
+	QCOMPARE(snapshot->getNumSymbols(), 1);
+	QCOMPARE(snapshot->getNumParts(), 2);
+	QCOMPARE(snapshot->getPart(1)->getName(), QString("second"));
+	QCOMPARE(snapshot->getPart(0)->getNumObjects(), 1);
+	
+	// The snapshot has its own colors, symbols and objects, and it is up to date.
+	const Object* copy = snapshot->getPart(0)->getObject(0);
+	QVERIFY(copy != object);
+	QVERIFY(snapshot->getSymbol(0) != line);
+	QCOMPARE(copy->getSymbol(), snapshot->getSymbol(0));
+	QVERIFY(!copy->isOutputDirty());
+	
+	// Editing the map does not change the snapshot.
+	object->move(MapCoord(0.0, 50.0));
+	map.setObjectsDirty();
+	QVERIFY(copy->getExtent().contains(QPointF(5.0, 0.0)));
+	auto next_snapshot = map.snapshot();
+	QVERIFY(next_snapshot != snapshot);
+	QVERIFY(next_snapshot->getPart(0)->getObject(0)->getExtent().contains(QPointF(5.0, 50.0)));
+	
+	// The snapshot is released with the last reference.
+	std::weak_ptr<const Map> released = snapshot;
+	snapshot.reset();
+	QVERIFY(released.expired());
+}
+
+void MapTest::updateObjectsForTest()
+{
+	Map map;
+	auto line = initTestMap(map);
+	
+	const int num_objects = 10000;
+	std::vector<Object*> objects;
+	for (int i = 0; i < num_objects; ++i)
+		objects.push_back(new PathObject(line, MapCoordVector{ MapCoord(0.0, 0.1 * i), MapCoord(10.0, 0.1 * i) }));
+	map.addObjects(objects);
+	map.updateObjects();
+	QVERIFY(!map.hasScheduledObjectUpdates());
+	
+	// Changing the symbol leaves the update to the drawing.
+	line->setLineWidth(2.0);
+	map.changeSymbolForAllObjects(line, line);
+	QVERIFY(map.hasScheduledObjectUpdates());
+	
+	// Without time, only the first batch is updated.
+	QVERIFY(!map.updateObjectsFor(0));
+	auto num_dirty = std::count_if(begin(objects), end(objects), [](const Object* object) {
+		return object->isOutputDirty();
+	});
+	QVERIFY(num_dirty > 0);
+	QVERIFY(num_dirty < num_objects);
+	
+	QVERIFY(map.updateObjectsFor(60000));
+	QVERIFY(!map.hasScheduledObjectUpdates());
+	QVERIFY(std::none_of(begin(objects), end(objects), [](const Object* object) {
+		return object->isOutputDirty();
+	}));
+}
+
+void MapTest::mapPartMoveTest()
+{
+	Map map;
+	MapView view(&map);
+	QVERIFY(map.loadFrom(examples_dir.absoluteFilePath(QString("complete map.omap")), nullptr, &view, false, false));
+	map.updateObjects();
+	MapPart* source = map.getPart(0);
+	QVERIFY(source->getNumObjects() > 3);
+	
+	map.addPart(new MapPart(QString("target"), &map), 1);
+	MapPart* target = map.getPart(1);
+	
+	std::vector<Object*> original_objects;
+	for (int i = 0; i < source->getNumObjects(); ++i)
+		original_objects.push_back(source->getObject(i));
+	const int num_objects = source->getNumObjects();
+	
+	// Moving some objects, in the given order
+	std::vector<int> positions = { 3, 0, 2 };
+	QCOMPARE(map.reassignObjectsToMapPart(positions.begin(), positions.end(), 0, 1), std::size_t(0));
+	QCOMPARE(source->getNumObjects(), num_objects - 3);
+	QCOMPARE(target->getNumObjects(), 3);
+	QCOMPARE(target->getObject(0), original_objects[3]);
+	QCOMPARE(target->getObject(1), original_objects[0]);
+	QCOMPARE(target->getObject(2), original_objects[2]);
+	QCOMPARE(source->getObject(0), original_objects[1]);
+	QCOMPARE(source->findObjectIndex(original_objects[4]), 1);
+	for (int i = 0; i < target->getNumObjects(); ++i)
+	{
+		Object* object = target->getObject(i);
+		QCOMPARE(object->getMap(), &map);
+		QVERIFY(!object->update()); // No regeneration of renderables
+		QVERIFY(target->contains(object));
+		QVERIFY(!source->contains(object));
+		QCOMPARE(target->findObjectIndex(object), i);
+	}
+	
+	std::vector<Object*> found;
+	target->findObjectsWithSymbol(original_objects[0]->getSymbol(), found);
+	QVERIFY(std::find(found.begin(), found.end(), original_objects[0]) != found.end());
+	
+	// Merging the remaining objects into the non-empty part
+	QCOMPARE(map.mergeParts(0, 1), std::size_t(3));
+	QCOMPARE(map.getNumParts(), 1);
+	target = map.getPart(0);
+	QCOMPARE(target->getNumObjects(), num_objects);
+	QCOMPARE(target->getObject(3), original_objects[1]);
+	for (int i = 0; i < target->getNumObjects(); ++i)
+	{
+		Object* object = target->getObject(i);
+		QVERIFY(!object->update());
+		QVERIFY(target->contains(object));
+		QCOMPARE(target->findObjectIndex(object), i);
+	}
+	
+	// Merging into an empty part
+	map.addPart(new MapPart(QString("empty"), &map), 1);
+	QCOMPARE(map.mergeParts(0, 1), std::size_t(0));
+	QCOMPARE(map.getNumParts(), 1);
+	QCOMPARE(map.getPart(0)->getNumObjects(), num_objects);
+	QVERIFY(map.getPart(0)->contains(original_objects[0]));
+}
+
+void MapTest::textLayoutTest()
+{
+	Map map;
+	MapView view(&map);
+	QVERIFY(map.loadFrom(examples_dir.absoluteFilePath(QString("complete map.omap")), nullptr, &view, false, false));
+	
+	const TextObject* prototype = nullptr;
+	MapPart* part = map.getCurrentPart();
+	for (int i = 0; i < part->getNumObjects() && !prototype; ++i)
+	{
+		const Object* object = part->getObject(i);
+		if (object->getType() == Object::Text)
+			prototype = object->asText();
+	}
+	QVERIFY(prototype);
+	
+	// Compares the (updated) layout of the object with a fresh layout.
+	auto compare_layout = [](const TextObject* object) -> bool {
+		std::unique_ptr<TextObject> fresh { static_cast<TextObject*>(object->duplicate()) };
+		fresh->setHorizontalAlignment(fresh->getHorizontalAlignment()); // Invalidates the layout
+		fresh->prepareLineInfos();
+		if (fresh->getNumLines() != object->getNumLines())
+			return false;
+		for (int i = 0; i < object->getNumLines(); ++i)
+		{
+			const TextObjectLineInfo* a = object->getLineInfo(i);
+			const TextObjectLineInfo* b = fresh->getLineInfo(i);
+			if (a->start_index != b->start_index || a->end_index != b->end_index
+			    || a->paragraph_end != b->paragraph_end || a->part_infos.size() != b->part_infos.size()
+			    || !qFuzzyCompare(1.0 + a->line_x, 1.0 + b->line_x)
+			    || !qFuzzyCompare(1.0 + a->line_y, 1.0 + b->line_y)
+			    || !qFuzzyCompare(1.0 + a->width, 1.0 + b->width))
+				return false;
+		}
+		return true;
+	};
+	
+	for (auto v_align : { TextObject::AlignTop, TextObject::AlignVCenter, TextObject::AlignBottom })
+	{
+		std::unique_ptr<TextObject> object { static_cast<TextObject*>(prototype->duplicate()) };
+		object->setVerticalAlignment(v_align);
+		object->setHorizontalAlignment(TextObject::AlignHCenter);
+		object->setText(QString("First paragraph with some words\nSecond\tparagraph\n\nLast paragraph with more words"));
+		object->prepareLineInfos();
+		QVERIFY(compare_layout(object.get()));
+		
+		QString text = object->getText();
+		const std::vector<std::pair<int, QString>> insertions = {
+		    { 6, QString("long ") },             // Into the first paragraph
+		    { text.indexOf('\t'), QString("\n") }, // Splitting a paragraph
+		    { 0, QString("X") },                 // At the beginning
+		    { -1, QString(" end") },             // At the end
+		};
+		for (const auto& insertion : insertions)
+		{
+			text.insert(insertion.first < 0 ? text.length() : insertion.first, insertion.second);
+			object->setText(text);
+			object->prepareLineInfos();
+			QVERIFY(compare_layout(object.get()));
+		}
+		
+		// Removing characters and joining paragraphs
+		while (text.length() > 10)
+		{
+			text.remove(text.length() / 3, 4);
+			object->setText(text);
+			object->prepareLineInfos();
+			QVERIFY(compare_layout(object.get()));
+		}
+	}
+}
+
+void MapTest::replaceRenderablesTest()
+{
+	Map map;
+	auto red = new MapColor(QString("red"), 0);
+	red->setRgb(MapColorRgb(1.0, 0.0, 0.0));
+	red->setCmykFromRgb();
+	map.addColor(red, 0);
+	auto blue = new MapColor(QString("blue"), 1);
+	blue->setRgb(MapColorRgb(0.0, 0.0, 1.0));
+	blue->setCmykFromRgb();
+	map.addColor(blue, 1);
+	auto line = new LineSymbol();
+	line->setColor(red);
+	line->setLineWidth(2.0);
+	map.addSymbol(line, 0);
+	map.addObject(new PathObject(line, MapCoordVector{ MapCoord(-10.0, 0.0), MapCoord(10.0, 0.0) }));
+	
+	auto draw = [&map]() -> QRgb {
+		QImage image(QSize(100, 100), QImage::Format_RGB32);
+		image.fill(Qt::white);
+		QPainter painter(&image);
+		painter.translate(50.0, 50.0);
+		painter.scale(5.0, 5.0);
+		RenderConfig config = { map, QRectF(-10.0, -10.0, 20.0, 20.0), 5.0, RenderConfig::NoOptions, 1.0 };
+		map.draw(&painter, config);
+		painter.end();
+		return image.pixel(50, 50);
+	};
+	QCOMPARE(draw(), qRgb(255, 0, 0));
+	
+	// The renderables of the previous color must not remain in the map.
+	line->setColor(blue);
+	map.updateAllObjectsWithSymbol(line);
+	QCOMPARE(draw(), qRgb(0, 0, 255));
+}
+
+void MapTest::compactRenderablesTest()
+{
+	Map map;
+	auto red = new MapColor(QString("red"), 0);
+	map.addColor(red, 0);
+	auto blue = new MapColor(QString("blue"), 1);
+	map.addColor(blue, 1);
+	auto line = new LineSymbol();
+	line->setColor(red);
+	line->setLineWidth(2.0);
+	map.addSymbol(line, 0);
+	for (int i = 0; i < 10; ++i)
+		map.addObject(new PathObject(line, MapCoordVector{ MapCoord(-10.0, i), MapCoord(10.0, i) }));
+	map.updateObjects();
+	
+	// The objects keep empty containers for the previous color.
+	line->setColor(blue);
+	map.updateAllObjectsWithSymbol(line);
+	const MemoryUsage before = MemoryUsage::measure(map);
+	QCOMPARE(before.reclaimedBytes(), qint64(0));
+	
+	const qint64 reclaimed = map.compactRenderables();
+	QVERIFY(reclaimed > 0);
+	const MemoryUsage after = MemoryUsage::measure(map);
+	QCOMPARE(after.reclaimedBytes(), reclaimed);
+	QVERIFY(after.bytes(MemoryUsage::LineRenderables) < before.bytes(MemoryUsage::LineRenderables));
+	
+	// Nothing is left to be released, and the objects are still drawn.
+	QCOMPARE(map.compactRenderables(), qint64(0));
+	QVERIFY(map.getPart(0)->getObject(0)->renderables().numRenderables() > 0);
+}
+
+void MapTest::qualityCheckTest()
+{
+	Map map;
+	auto line = initTestMap(map, 0.2);
+	line->setMinimumLength(2000);
+	auto area = new AreaSymbol();
+	area->setColor(map.getColor(0));
+	map.addSymbol(area, 1);
+	
+	auto makeArea = [area](double left, double top, double size) {
+		auto object = new PathObject(area, MapCoordVector{ MapCoord(left, top), MapCoord(left + size, top), MapCoord(left + size, top + size), MapCoord(left, top + size) });
+		object->closeAllParts();
+		return object;
+	};
+	
+	// Clean objects: a line, and two areas which share an edge
+	map.addObject(new PathObject(line, MapCoordVector{ MapCoord(0.0, 0.0), MapCoord(10.0, 0.0) }));
+	map.addObject(makeArea(0.0, 10.0, 10.0));
+	map.addObject(makeArea(10.0, 10.0, 10.0));
+	map.updateObjects();
+	QVERIFY(MapQualityCheck::run(map).issues().empty());
+	
+	map.addObject(new PathObject(line, MapCoordVector{ MapCoord(0.0, 0.0), MapCoord(10.0, 0.0) }));
+	map.addObject(makeArea(5.0, 15.0, 10.0));
+	map.addObject(new PathObject(line, MapCoordVector{ MapCoord(50.0, 0.0), MapCoord(50.0, 0.0) }));
+	map.addObject(new PathObject(line, MapCoordVector{ MapCoord(60.0, 0.0), MapCoord(61.0, 0.0) }));
+	map.addObject(new PathObject(line, MapCoordVector{ MapCoord(10.1, 0.0), MapCoord(20.0, 0.0) }));
+	map.updateObjects();
+	
+	const auto issues = MapQualityCheck::run(map).issues();
+	auto count = [&issues](MapQualityCheck::IssueType type) {
+		return std::count_if(begin(issues), end(issues), [type](const MapQualityCheck::Issue& issue) { return issue.type == type; });
+	};
+	QCOMPARE(int(count(MapQualityCheck::DuplicateObject)), 1);
+	QCOMPARE(int(count(MapQualityCheck::OverlappingAreas)), 2);
+	QCOMPARE(int(count(MapQualityCheck::DegeneratePath)), 1);
+	QCOMPARE(int(count(MapQualityCheck::BelowMinimumSize)), 1);
+	QCOMPARE(int(count(MapQualityCheck::AlmostTouchingEnds)), 2);
+	
+	const auto& duplicate = issues.front();
+	QCOMPARE(duplicate.type, MapQualityCheck::DuplicateObject);
+	QCOMPARE(duplicate.object_index, 3);
+	QCOMPARE(duplicate.other_object_index, 0);
+}
+
+void MapTest::changeFeedTest()
+{
+	Map map;
+	MapChangeFeed& feed = map.changeFeed();
+	QVERIFY(!feed.isRecording());
+	
+	// Changes without consumers are not recorded.
+	auto black = new MapColor(QString("black"), 0);
+	map.addColor(black, 0);
+	std::vector<MapChange> changes;
+	QVERIFY(!feed.changesSince(0, changes));
+	QVERIFY(changes.empty());
+	
+	feed.addConsumer();
+	QVERIFY(feed.isRecording());
+	const quint64 start = feed.version();
+	QVERIFY(feed.changesSince(start, changes));
+	QVERIFY(changes.empty());
+	
+	auto line = new LineSymbol();
+	line->setColor(black);
+	line->setLineWidth(0.2);
+	map.addSymbol(line, 0);
+	auto object = new PathObject(line, MapCoordVector{ MapCoord(0.0, 0.0), MapCoord(10.0, 0.0) });
+	map.addObject(object);
+	const QRectF extent = object->getExtent();
+	QVERIFY(extent.isValid());
+	map.deleteObject(object, false);
+	
+	QVERIFY(feed.changesSince(start, changes));
+	QCOMPARE(int(changes.size()), 4);
+	QCOMPARE(changes[0].type, MapChange::SymbolAdded);
+	QCOMPARE(changes[0].symbol, static_cast<const Symbol*>(line));
+	QCOMPARE(changes[1].type, MapChange::ObjectAdded);
+	QCOMPARE(changes[1].object, static_cast<const Object*>(object));
+	QCOMPARE(changes[1].part, static_cast<const MapPart*>(map.getPart(0)));
+	QCOMPARE(changes[2].type, MapChange::ObjectModified);
+	QVERIFY(changes[2].extent.contains(extent));
+	QCOMPARE(changes[3].type, MapChange::ObjectRemoved);
+	QCOMPARE(changes[3].extent, extent);
+	for (std::size_t i = 0; i < changes.size(); ++i)
+		QCOMPARE(changes[i].version, start + i + 1);
+	QCOMPARE(feed.version(), changes.back().version);
+	
+	// Incremental deltas
+	const quint64 version = feed.version();
+	black->setName(QString("Black"));
+	map.setColor(black, 0);
+	changes.clear();
+	QVERIFY(feed.changesSince(version, changes));
+	QCOMPARE(int(changes.size()), 1);
+	QCOMPARE(changes[0].type, MapChange::ColorModified);
+	QCOMPARE(changes[0].color, static_cast<const MapColor*>(black));
+	
+	// Discarded entries
+	MapChangeFeed small_feed(2);
+	small_feed.addConsumer();
+	for (int i = 0; i < 3; ++i)
+		small_feed.recordSymbol(MapChange::SymbolModified, line);
+	changes.clear();
+	QVERIFY(!small_feed.changesSince(0, changes));
+	QVERIFY(small_feed.changesSince(1, changes));
+	QCOMPARE(int(changes.size()), 2);
+	
+	// Changes which cannot be described by entries
+	feed.invalidate();
+	changes.clear();
+	QVERIFY(!feed.changesSince(version, changes));
+	QVERIFY(changes.empty());
+	
+	feed.removeConsumer();
+	QVERIFY(!feed.isRecording());
+}
+
+void MapTest::changeSymbolsTest()
+{
+	Map map;
+	auto line_a = initTestMap(map, 0.2);
+	auto line_b = new LineSymbol();
+	line_b->setColor(map.getColor(0));
+	line_b->setLineWidth(0.5);
+	map.addSymbol(line_b, 1);
+	auto point = new PointSymbol();
+	map.addSymbol(point, 2);
+	
+	std::vector<Object*> objects = {
+		new PathObject(line_a, MapCoordVector{ MapCoord(0.0, 0.0), MapCoord(10.0, 0.0) }),
+		new PathObject(line_b, MapCoordVector{ MapCoord(0.0, 5.0), MapCoord(10.0, 5.0) }),
+		new PointObject(point),
+		new PathObject(line_a, MapCoordVector{ MapCoord(0.0, 10.0), MapCoord(10.0, 10.0) }),
+	};
+	map.addObjects(objects);
+	map.updateObjects();
+	map.undoManager().clear();
+	
+	// Swapped line symbols. The point object is not compatible to a line symbol.
+	QHash<const Symbol*, const Symbol*> mapping;
+	mapping.insert(line_a, line_b);
+	mapping.insert(line_b, line_a);
+	mapping.insert(point, line_a);
+	QCOMPARE(map.changeSymbols(mapping), 3);
+	QCOMPARE(objects[0]->getSymbol(), static_cast<const Symbol*>(line_b));
+	QCOMPARE(objects[1]->getSymbol(), static_cast<const Symbol*>(line_a));
+	QCOMPARE(objects[2]->getSymbol(), static_cast<const Symbol*>(point));
+	QCOMPARE(objects[3]->getSymbol(), static_cast<const Symbol*>(line_b));
+	QVERIFY(!map.hasScheduledObjectUpdates());
+	std::vector<Object*> found;
+	map.getCurrentPart()->findObjectsWithSymbol(line_b, found);
+	QCOMPARE(int(found.size()), 2);
+	
+	// A single undo step restores all symbols.
+	QCOMPARE(int(map.undoManager().undoStepCount()), 1);
+	QVERIFY(map.undoManager().undo(nullptr));
+	QCOMPARE(objects[0]->getSymbol(), static_cast<const Symbol*>(line_a));
+	QCOMPARE(objects[1]->getSymbol(), static_cast<const Symbol*>(line_b));
+	QCOMPARE(objects[3]->getSymbol(), static_cast<const Symbol*>(line_a));
+	
+	// Nothing to change
+	mapping.clear();
+	mapping.insert(point, line_a);
+	QCOMPARE(map.changeSymbols(mapping), 0);
+	QVERIFY(!map.undoManager().canUndo());
+}
+
+void MapTest::journalUndoEditTest()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString base_path = dir.path() + QLatin1String("/base.omap");
+	QVERIFY(writeJournalBase(base_path));
+	
+	Map map;
+	initTestMap(map);
+	AutosaveJournal journal(&map);
+	journal.setBase();
+	
+	// A step which was undone before it was journaled is not journaled.
+	addLine(map, 0.0);
+	addLine(map, 10.0);
+	QVERIFY(map.undoManager().undo(nullptr));
+	moveObject(map, 0, 1000);
+	QVERIFY(writeJournal(journal, base_path));
+	
+	Map replayed;
+	initTestMap(replayed);
+	QString error_string;
+	QVERIFY(AutosaveJournal::replay(replayed, base_path, error_string));
+	QVERIFY(equalObjects(map, replayed));
+	QCOMPARE(replayed.getCurrentPart()->getNumObjects(), 1);
+	
+	// Undoing a journaled step and making another change at the same index
+	// requires a full autosave, even if the new undo step happens to be
+	// allocated at the address of the old one.
+	QVERIFY(map.undoManager().undo(nullptr));
+	moveObject(map, 0, 2000);
+	QByteArray data;
+	bool append;
+	QVERIFY(!journal.exportChanges(base_path, data, append));
+	QVERIFY(data.isEmpty());
+}
+
+void MapTest::journalSpillTest()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString base_path = dir.path() + QLatin1String("/base.omap");
+	QVERIFY(writeJournalBase(base_path));
+	
+	// All undo steps but the most recent one are moved to the spill file.
+	Settings& settings = Settings::getInstance();
+	const QVariant memory_limit = settings.getSettingCached(Settings::General_UndoMemoryLimitMB);
+	settings.setSettingInCache(Settings::General_UndoMemoryLimitMB, 0);
+	
+	Map map;
+	initTestMap(map);
+	AutosaveJournal journal(&map);
+	journal.setBase();
+	
+	addLine(map, 0.0);
+	addLine(map, 10.0);
+	addLine(map, 20.0);
+	moveObject(map, 1, 1000);
+	QVERIFY(writeJournal(journal, base_path));
+	
+	// Undo and redo load the spilled steps and replace the step objects.
+	// This is not a change for the journal.
+	UndoManager& undo_manager = map.undoManager();
+	const quint64 serial = undo_manager.undoStepSerial(2);
+	QVERIFY(undo_manager.undo(nullptr));
+	QVERIFY(undo_manager.undo(nullptr));
+	QVERIFY(undo_manager.redo(nullptr));
+	QVERIFY(undo_manager.redo(nullptr));
+	QCOMPARE(undo_manager.undoStepSerial(2), serial);
+	QByteArray data;
+	bool append;
+	QVERIFY(journal.exportChanges(base_path, data, append));
+	QVERIFY(data.isEmpty());
+	
+	moveObject(map, 2, -1000);
+	QVERIFY(writeJournal(journal, base_path));
+	
+	settings.setSettingInCache(Settings::General_UndoMemoryLimitMB, memory_limit);
+	
+	Map replayed;
+	initTestMap(replayed);
+	QString error_string;
+	QVERIFY(AutosaveJournal::replay(replayed, base_path, error_string));
+	QVERIFY(equalObjects(map, replayed));
+	QCOMPARE(replayed.getCurrentPart()->getNumObjects(), 3);
+}
+
 /*
  * We select a non-standard QPA because we don't need a real GUI window.
  * 
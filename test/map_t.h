@@ -42,6 +42,81 @@ private slots:
 	
 	void importTest_data();
 	void importTest();
+	
+	/** Tests the memory accounting of a loaded map. */
+	void memoryUsageTest();
+	
+	/** Tests the measuring of the rendering cost by symbol. */
+	void symbolCostReportTest();
+	
+	/** Tests adding and removing many objects to and from the selection at once. */
+	void bulkSelectionTest();
+	
+	/** Tests the index of the symbols which use a color. */
+	void symbolsWithColorTest();
+	
+	/** Tests the interning of tag strings and the index of the tags. */
+	void tagIndexTest();
+	
+	/** Tests queries which combine symbol, tag, part and area criteria. */
+	void objectQueryTest();
+	
+	/** Tests the symbol index used by the symbol-scoped operations. */
+	void symbolIndexTest();
+	
+	/** Tests the sharing of renderables between the objects of a point symbol. */
+	void sharedPointRenderablesTest();
+	
+	/** Tests that the cached map extent follows changes of the objects. */
+	void extentTest();
+	
+	/** Tests adding many objects at once. */
+	void addObjectsTest();
+	
+	/** Tests the sharing of map tiles between the caches of a map. */
+	void mapTileStoreTest();
+	
+	/** Tests rendering a thumbnail of a map file. */
+	void thumbnailTest();
+	
+	/** Tests the immutable snapshots of a map. */
+	void snapshotTest();
+	
+	/** Tests updating changed objects in batches, within a time limit. */
+	void updateObjectsForTest();
+	
+	/** Tests that the render keys of colors are stable when colors are reordered. */
+	void colorRenderKeyTest();
+	
+	/** Tests the lookup of object indices after insertions and bulk deletions. */
+	void objectIndexTest();
+	
+	/** Tests moving objects between map parts without updating them. */
+	void mapPartMoveTest();
+	
+	/** Tests that updating the layout of an edited text gives the full layout. */
+	void textLayoutTest();
+	
+	/** Tests that regenerated renderables replace the previous ones in all colors. */
+	void replaceRenderablesTest();
+	
+	/** Tests the release of unused containers of renderables. */
+	void compactRenderablesTest();
+	
+	/** Tests the detection of duplicates, overlaps, tiny objects and line end gaps. */
+	void qualityCheckTest();
+	
+	/** Tests the recording of changes of objects, symbols and colors. */
+	void changeFeedTest();
+	
+	/** Tests replacing the symbols of all objects by a mapping, and undo. */
+	void changeSymbolsTest();
+	
+	/** Tests replaying the autosave journal after undoing and editing. */
+	void journalUndoEditTest();
+	
+	/** Tests the autosave journal when undo steps are moved to the spill file. */
+	void journalSpillTest();
 };
 
 #endif
@@ -0,0 +1,142 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "path_coord_t.h"
+
+#include "../src/core/virtual_path.h"
+
+#include "map_generator.h"
+
+
+namespace
+{
+	/** The radius of the rings, in mm. */
+	const double ring_radius = 100.0;
+	
+	/** The number of rows and columns of the grids of queries. */
+	const int grid_size = 32;
+	
+	/** Returns the positions of a grid over the extent of the rings. */
+	std::vector<MapCoordF> queryGrid()
+	{
+		std::vector<MapCoordF> grid;
+		grid.reserve(grid_size * grid_size);
+		const double step = 2 * ring_radius / (grid_size - 1);
+		for (int i = 0; i < grid_size; ++i)
+		{
+			for (int j = 0; j < grid_size; ++j)
+				grid.push_back(MapCoordF(-ring_radius + i * step, -ring_radius + j * step));
+		}
+		return grid;
+	}
+}
+
+
+void PathCoordTest::sizes_data()
+{
+	QTest::addColumn<int>("num_vertices");
+	QTest::newRow("num_vertices = 10") << 10;
+	QTest::newRow("num_vertices = 100") << 100;
+	QTest::newRow("num_vertices = 1000") << 1000;
+	QTest::newRow("num_vertices = 10000") << 10000;
+	QTest::newRow("num_vertices = 100000") << 100000;
+}
+
+void PathCoordTest::curveToPathCoord_data()
+{
+	sizes_data();
+}
+
+void PathCoordTest::curveToPathCoord()
+{
+	QFETCH(int, num_vertices);
+	MapGenerator generator { MapGenerator::Options() };
+	const MapCoordVector coords = generator.generateRing(num_vertices, ring_radius, true);
+	
+	auto size = PathCoordVector::size_type { 0 };
+	QBENCHMARK
+	{
+		// A new vector, so that no curves are taken from the cache of the last update.
+		PathCoordVector path_coords(coords);
+		path_coords.update(0);
+		size = path_coords.size();
+	}
+	QVERIFY(size > coords.size());
+}
+
+void PathCoordTest::isPointInside_data()
+{
+	sizes_data();
+}
+
+void PathCoordTest::isPointInside()
+{
+	QFETCH(int, num_vertices);
+	MapGenerator generator { MapGenerator::Options() };
+	const MapCoordVector coords = generator.generateRing(num_vertices, ring_radius, false);
+	VirtualPath path(coords);
+	path.path_coords.update(0);
+	const std::vector<MapCoordF> grid = queryGrid();
+	
+	// The first query builds the segment boxes.
+	QVERIFY(path.isPointInside(MapCoordF(0.0, 0.0)));
+	
+	int inside = 0;
+	QBENCHMARK
+	{
+		inside = 0;
+		for (const auto& pos : grid)
+			inside += path.isPointInside(pos) ? 1 : 0;
+	}
+	QVERIFY(inside > 0);
+	QVERIFY(inside < int(grid.size()));
+}
+
+void PathCoordTest::intersectsBox_data()
+{
+	sizes_data();
+}
+
+void PathCoordTest::intersectsBox()
+{
+	QFETCH(int, num_vertices);
+	MapGenerator generator { MapGenerator::Options() };
+	const MapCoordVector coords = generator.generateRing(num_vertices, ring_radius, false);
+	VirtualPath path(coords);
+	path.path_coords.update(0);
+	const std::vector<MapCoordF> grid = queryGrid();
+	
+	// Boxes of the size of a grid cell, so that some of them touch the ring.
+	const double box_size = 2 * ring_radius / (grid_size - 1);
+	
+	// The first query builds the segment boxes.
+	QVERIFY(!path.intersectsBox(QRectF(-1.0, -1.0, 2.0, 2.0)));
+	
+	int intersecting = 0;
+	QBENCHMARK
+	{
+		intersecting = 0;
+		for (const auto& pos : grid)
+			intersecting += path.intersectsBox(QRectF(pos.x(), pos.y(), box_size, box_size)) ? 1 : 0;
+	}
+	QVERIFY(intersecting > 0);
+}
+
+
+QTEST_MAIN(PathCoordTest)
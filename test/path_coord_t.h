@@ -0,0 +1,54 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_PATH_COORD_T_H
+#define _OPENORIENTEERING_PATH_COORD_T_H
+
+#include <QtTest/QtTest>
+
+
+/**
+ * @test Benchmarks the path coords of VirtualPath: the approximation of
+ * curves, and the spatial queries.
+ *
+ * The paths are closed rings (cf. MapGenerator::generateRing()) with an
+ * increasing number of vertices.
+ */
+class PathCoordTest : public QObject
+{
+Q_OBJECT
+private slots:
+	/** Calculates the path coords of curved paths from scratch. */
+	void curveToPathCoord();
+	void curveToPathCoord_data();
+	
+	/** Tests a grid of points for being inside of the path. */
+	void isPointInside();
+	void isPointInside_data();
+	
+	/** Tests a grid of small boxes for intersection with the path. */
+	void intersectsBox();
+	void intersectsBox_data();
+
+private:
+	/** Adds the columns and rows of the sizes of the paths. */
+	void sizes_data();
+};
+
+#endif
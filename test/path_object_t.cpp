@@ -20,7 +20,11 @@
 
 #include "path_object_t.h"
 
+#include <memory>
+
 #include "../src/map.h"
+#include "../src/object_statistics.h"
+#include "../src/symbol_area.h"
 #include "../src/symbol_line.h"
 
 class DummyPathObject : public PathObject
@@ -61,6 +65,66 @@ void PathObjectTest::mapCoordTest()
 	QCOMPARE(vector.angle(), M_PI/2); // Remember, our y axis is mirrored.
 }
 
+void PathObjectTest::mapCoordVectorTest()
+{
+	MapCoordVector empty;
+	QVERIFY(empty.empty());
+	QCOMPARE(empty.capacity(), MapCoordVector::size_type(0));
+	QVERIFY(empty.begin() == empty.end());
+	
+	auto coords = MapCoordVector { { 0.0, 0.0 }, { 2.0, 0.0 }, { 2.0, 1.0 } };
+	auto copy = coords;
+	QCOMPARE(copy.size(), coords.size());
+	QVERIFY(coords.isShared());
+	QCOMPARE(static_cast<const MapCoordVector&>(copy).data(), static_cast<const MapCoordVector&>(coords).data());
+	
+	// Modifying a copy detaches it
+	copy.emplace_back(3.0, 3.0);
+	QVERIFY(!coords.isShared());
+	QVERIFY(!copy.isShared());
+	QCOMPARE(coords.size(), MapCoordVector::size_type(3));
+	QCOMPARE(copy.size(), MapCoordVector::size_type(4));
+	QVERIFY(copy != coords);
+	
+	// Erasing with an iterator taken before detaching
+	copy = coords;
+	const MapCoordVector& const_copy = copy;
+	auto next = copy.erase(const_copy.begin() + 1);
+	QCOMPARE(copy.size(), MapCoordVector::size_type(2));
+	QCOMPARE(*next, coords[2]);
+	QCOMPARE(coords.size(), MapCoordVector::size_type(3));
+	
+	// Moving leaves the source empty
+	auto moved = std::move(copy);
+	QVERIFY(copy.empty());
+	QCOMPARE(moved.size(), MapCoordVector::size_type(2));
+	
+	copy = coords;
+	copy.clear();
+	QVERIFY(copy.empty());
+	QCOMPARE(coords.size(), MapCoordVector::size_type(3));
+}
+
+void PathObjectTest::duplicateSharingTest()
+{
+	auto coords = MapCoordVector { { 0.0, 0.0 }, { 2.0, 0.0 }, { 2.0, 1.0 }, { 2.0, -1.0 } };
+	PathObject original(nullptr, coords);
+	QScopedPointer<PathObject> duplicate(original.duplicate()->asPath());
+	
+	const MapCoordVector& original_coords = original.getRawCoordinateVector();
+	const MapCoordVector& duplicate_coords = duplicate->getRawCoordinateVector();
+	QCOMPARE(duplicate_coords.data(), original_coords.data());
+	
+	duplicate->setCoordinate(1, MapCoord(5.0, 5.0));
+	QVERIFY(duplicate_coords.data() != original_coords.data());
+	QCOMPARE(original.getCoordinate(1), MapCoord(2.0, 0.0));
+	QCOMPARE(duplicate->getCoordinate(1), MapCoord(5.0, 5.0));
+	
+	// The path parts follow the detached coordinates.
+	QCOMPARE(duplicate->parts().front().coords[1], MapCoordF(5.0, 5.0));
+	QCOMPARE(original.parts().front().coords[1], MapCoordF(2.0, 0.0));
+}
+
 void PathObjectTest::virtualPathTest()
 {
 	// Test open path
@@ -128,6 +192,107 @@ void PathObjectTest::virtualPathTest()
 	QCOMPARE(scaling, sqrt(2.0));
 }
 
+void PathObjectTest::lazyPathCoordsTest()
+{
+	AreaSymbol area_symbol;
+	QVERIFY(!area_symbol.needsPathCoords());
+	
+	auto coords = MapCoordVector { { 0.0, 0.0 }, { 4.0, 0.0 }, { 4.0, 3.0 }, { 0.0, 3.0 } };
+	PathObject area(&area_symbol, coords);
+	area.parts().front().setClosed(true);
+	area.update();
+	
+	// The extent does not depend on the path coords.
+	QCOMPARE(area.getExtent().left(), 0.0);
+	QCOMPARE(area.getExtent().right(), 4.0);
+	QCOMPARE(area.getExtent().bottom(), 3.0);
+	
+	const auto& part = static_cast<const PathObject&>(area).parts().front();
+	QCOMPARE(part.last_index, MapCoordVector::size_type(4));
+	QCOMPARE(part.path_coords.size(), PathCoordVector::size_type(5));
+	QCOMPARE(part.length(), PathCoord::length_type(14));
+	QVERIFY(area.isPointInsideArea(MapCoordF(2.0, 1.0)));
+	
+	// The path coords follow later changes.
+	area.setCoordinate(2, MapCoord(4.0, 6.0));
+	area.update();
+	QCOMPARE(area.getExtent().bottom(), 6.0);
+	QVERIFY(area.isPointInsideArea(MapCoordF(3.5, 4.0)));
+}
+
+void PathObjectTest::pathAreaTest()
+{
+	LineSymbol line_symbol;
+	QVERIFY(line_symbol.hasLocalPathOutput());
+	
+	auto coords = MapCoordVector { { 0.0, 0.0 }, { 4.0, 0.0 }, { 4.0, 3.0 }, { 0.0, 3.0 } };
+	PathObject path(&line_symbol, coords);
+	path.parts().front().setClosed(true);
+	path.update();
+	const auto& parts = static_cast<const PathObject&>(path).parts();
+	QCOMPARE(parts.front().calculateArea(), 12.0);
+	
+	// Moving a single point updates the path coords locally.
+	path.setCoordinate(2, MapCoord(4.0, 6.0));
+	path.update();
+	QCOMPARE(parts.front().calculateArea(), 18.0);
+	
+	// Moving the start point changes the closing segment, too.
+	path.setCoordinate(0, MapCoord(0.0, 1.0));
+	path.update();
+	QCOMPARE(parts.front().calculateArea(), 16.0);
+	
+	// A hole is subtracted from the area, but it adds to the length.
+	AreaSymbol area_symbol;
+	PathObject area(&area_symbol, coords);
+	area.parts().front().setClosed(true);
+	area.addCoordinate(MapCoord(1.0, 1.0), true);
+	area.addCoordinate(MapCoord(2.0, 1.0));
+	area.addCoordinate(MapCoord(2.0, 2.0));
+	area.addCoordinate(MapCoord(1.0, 2.0));
+	area.parts().back().setClosed(true);
+	area.update();
+	QCOMPARE(ObjectStatistics::pathArea(static_cast<const PathObject&>(area).parts()), 11.0);
+	QCOMPARE(ObjectStatistics::pathLength(static_cast<const PathObject&>(area).parts()), 18.0);
+	
+	std::unique_ptr<Object> duplicate(area.duplicate());
+	duplicate->update();
+	
+	ObjectStatistics statistics;
+	statistics.add(&path);
+	statistics.add(&area);
+	statistics.add(duplicate.get());
+	QCOMPARE(statistics.count(), 3);
+	QCOMPARE(int(statistics.entries().size()), 2);
+	for (const auto& entry : statistics.entries())
+	{
+		if (entry.symbol == &area_symbol)
+		{
+			QCOMPARE(entry.count, 2);
+			QCOMPARE(entry.area, 22.0);
+		}
+		else
+		{
+			QCOMPARE(entry.count, 1);
+			QCOMPARE(entry.area, 0.0);
+		}
+	}
+
+	// Summing up the measures gives the same entries, after sorting.
+	auto sum = ObjectStatistics::sum({ ObjectStatistics::measure(duplicate.get()),
+	                                   ObjectStatistics::measure(&path),
+	                                   ObjectStatistics::measure(&area) });
+	sum.sort();
+	QCOMPARE(sum.count(), 3);
+	QCOMPARE(int(sum.entries().size()), 2);
+	for (std::size_t i = 0; i < sum.entries().size(); ++i)
+	{
+		QCOMPARE(sum.entries()[i].symbol, statistics.entries()[i].symbol);
+		QCOMPARE(sum.entries()[i].count, statistics.entries()[i].count);
+		QCOMPARE(sum.entries()[i].area, statistics.entries()[i].area);
+	}
+}
+
 void PathObjectTest::calcIntersectionsTest()
 {
 	QFETCH(void*, v_path1);
@@ -172,6 +337,41 @@ void PathObjectTest::calcIntersectionsTest()
 	}
 }
 
+void PathObjectTest::copyRangeTest()
+{
+	LineSymbol line_symbol;
+	PathObject path(&line_symbol, MapCoordVector { { 0.0, 0.0 }, { 4.0, 0.0 }, { 4.0, 3.0 }, { 0.0, 3.0 } });
+	path.parts().front().setClosed(true);
+	path.update();
+	const auto& part = static_cast<const PathObject&>(path).parts().front();
+	
+	MapCoordVector coords;
+	part.copyRange(2.0, 9.0, coords);
+	QCOMPARE(int(coords.size()), 4);
+	QVERIFY(coords[0].isPositionEqualTo(MapCoord(2.0, 0.0)));
+	QVERIFY(coords[1].isPositionEqualTo(MapCoord(4.0, 0.0)));
+	QVERIFY(coords[2].isPositionEqualTo(MapCoord(4.0, 3.0)));
+	QVERIFY(coords[3].isPositionEqualTo(MapCoord(2.0, 3.0)));
+	QVERIFY(coords[3].isHolePoint());
+	
+	// A range which ends before its start continues at the beginning.
+	coords.clear();
+	part.copyRange(12.0, 2.0, coords);
+	QCOMPARE(int(coords.size()), 3);
+	QVERIFY(coords[0].isPositionEqualTo(MapCoord(0.0, 2.0)));
+	QVERIFY(coords[1].isPositionEqualTo(MapCoord(0.0, 0.0)));
+	QVERIFY(!coords[1].isHolePoint());
+	QVERIFY(coords[2].isPositionEqualTo(MapCoord(2.0, 0.0)));
+	QVERIFY(coords[2].isHolePoint());
+	
+	// changePathBounds() gives the same result.
+	PathObject bounded(path);
+	bounded.changePathBounds(0, 12.0, 2.0);
+	QCOMPARE(int(bounded.getCoordinateCount()), 3);
+	for (int i = 0; i < 3; ++i)
+		QVERIFY(bounded.getCoordinate(i).isPositionEqualTo(coords[i]));
+}
+
 void PathObjectTest::calcIntersectionsTest_data()
 {
 	QTest::addColumn<void*>("v_path1");
@@ -45,9 +45,24 @@ private slots:
 	/** Tests MapCoordF. */
 	void mapCoordTest();
 	
+	/** Tests the implicit sharing of MapCoordVector. */
+	void mapCoordVectorTest();
+	
+	/** Tests that duplicated paths share their coordinates until modified. */
+	void duplicateSharingTest();
+	
 	/** Tests VirtualPath. */
 	void virtualPathTest();
 	
+	/** Tests that area paths calculate their path coords when requested. */
+	void lazyPathCoordsTest();
+	
+	/** Tests that the area of paths follows changes of the coordinates. */
+	void pathAreaTest();
+	
+	/** Tests copying a range of a path part, as used for following paths. */
+	void copyRangeTest();
+	
 	/** Tests finding intersections with calcAllIntersectionsWith(). */
 	void calcIntersectionsTest();
 	void calcIntersectionsTest_data();
@@ -83,6 +83,17 @@ void QPainterTest::multiplyComposition()
 	ImageTransparencyFixup fixup(&result);
 	fixup();
 	QCOMPARE(result.pixel(0,0), qRgba(0, 0, 0, 0)); // Now correct!
+	
+	// The fixup may be restricted to a region.
+	QImage wrong(4, 4, QImage::Format_ARGB32_Premultiplied);
+	wrong.fill(qRgba(0, 0, 0, 1));
+	ImageTransparencyFixup region_fixup(&wrong, QRect(1, 1, 2, 8));
+	region_fixup();
+	QCOMPARE(wrong.pixel(0, 1), qRgba(0, 0, 0, 1));
+	QCOMPARE(wrong.pixel(1, 0), qRgba(0, 0, 0, 1));
+	QCOMPARE(wrong.pixel(1, 1), qRgba(0, 0, 0, 0));
+	QCOMPARE(wrong.pixel(2, 3), qRgba(0, 0, 0, 0));
+	QCOMPARE(wrong.pixel(3, 3), qRgba(0, 0, 0, 1));
 }
 
 void QPainterTest::darkenComposition()
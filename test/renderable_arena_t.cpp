@@ -0,0 +1,109 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "renderable_arena_t.h"
+
+#include <cstring>
+#include <vector>
+
+#include <QThread>
+
+#include "../src/core/renderable_arena.h"
+
+
+namespace
+{
+	class ReleaseThread : public QThread
+	{
+	public:
+		explicit ReleaseThread(std::vector<void*>& allocations)
+		 : allocations(allocations)
+		{ }
+		
+		void run() override
+		{
+			for (void* p : allocations)
+				RenderableArena::deallocate(p);
+			allocations.clear();
+		}
+		
+	private:
+		std::vector<void*>& allocations;
+	};
+}
+
+
+void RenderableArenaTest::allocationTest()
+{
+	std::vector<void*> allocations;
+	for (int i = 0; i < 10000; ++i)
+	{
+		const std::size_t size = 1 + std::size_t(i % 300);
+		void* p = RenderableArena::allocate(size);
+		QVERIFY(p != nullptr);
+		QCOMPARE(reinterpret_cast<quintptr>(p) % sizeof(double), quintptr(0));
+		std::memset(p, i & 0xff, size);
+		allocations.push_back(p);
+	}
+	
+	for (int i = 0; i < 10000; ++i)
+	{
+		const unsigned char* p = static_cast<const unsigned char*>(allocations[std::size_t(i)]);
+		const std::size_t size = 1 + std::size_t(i % 300);
+		QCOMPARE(int(p[0]), i & 0xff);
+		QCOMPARE(int(p[size-1]), i & 0xff);
+	}
+	
+	// Large allocations
+	void* large = RenderableArena::allocate(1 << 20);
+	std::memset(large, 0, 1 << 20);
+	RenderableArena::deallocate(large);
+	
+	for (void* p : allocations)
+		RenderableArena::deallocate(p);
+	RenderableArena::deallocate(nullptr);
+}
+
+void RenderableArenaTest::reuseTest()
+{
+	void* first = RenderableArena::allocate(64);
+	RenderableArena::deallocate(first);
+	void* second = RenderableArena::allocate(64);
+	QCOMPARE(second, first);
+	RenderableArena::deallocate(second);
+}
+
+void RenderableArenaTest::otherThreadTest()
+{
+	std::vector<void*> allocations;
+	for (int round = 0; round < 3; ++round)
+	{
+		for (int i = 0; i < 10000; ++i)
+			allocations.push_back(RenderableArena::allocate(100));
+		
+		ReleaseThread thread(allocations);
+		thread.start();
+		QVERIFY(thread.wait());
+		QVERIFY(allocations.empty());
+	}
+}
+
+
+QTEST_GUILESS_MAIN(RenderableArenaTest)
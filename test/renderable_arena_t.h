@@ -0,0 +1,44 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_RENDERABLE_ARENA_T_H
+#define _OPENORIENTEERING_RENDERABLE_ARENA_T_H
+
+#include <QtTest/QtTest>
+
+
+/**
+ * @test Tests the allocations from the RenderableArena.
+ */
+class RenderableArenaTest : public QObject
+{
+Q_OBJECT
+private slots:
+	/** Tests that allocations are aligned and do not overlap. */
+	void allocationTest();
+	
+	/** Tests that a block is reused when all its allocations are released. */
+	void reuseTest();
+	
+	/** Tests releasing memory in another thread than the allocating one. */
+	void otherThreadTest();
+};
+
+#endif
@@ -0,0 +1,166 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "spatial_index_t.h"
+
+#include <algorithm>
+#include <set>
+
+#include "../src/core/spatial_index.h"
+
+
+namespace
+{
+	struct Item
+	{
+		QRectF extent;
+	};
+	
+	std::set<Item*> querySet(const SpatialIndex<Item>& index, const QRectF& rect, std::size_t* raw_size = nullptr)
+	{
+		std::vector<Item*> result;
+		index.query(rect, result);
+		if (raw_size)
+			*raw_size = result.size();
+		return std::set<Item*>(result.begin(), result.end());
+	}
+}
+
+
+void SpatialIndexTest::basicTest()
+{
+	Item a { QRectF(0.0, 0.0, 1.0, 1.0) };
+	Item b { QRectF(20.0, 20.0, 5.0, 5.0) };
+	
+	SpatialIndex<Item> index;
+	QVERIFY(index.empty());
+	index.insert(&a, a.extent);
+	index.insert(&b, b.extent);
+	QCOMPARE(index.size(), std::size_t(2));
+	QVERIFY(index.contains(&a));
+	
+	QCOMPARE(querySet(index, QRectF(-1.0, -1.0, 3.0, 3.0)), std::set<Item*>({ &a }));
+	QCOMPARE(querySet(index, QRectF(21.0, 21.0, 1.0, 1.0)), std::set<Item*>({ &b }));
+	QCOMPARE(querySet(index, QRectF(0.0, 0.0, 30.0, 30.0)), std::set<Item*>({ &a, &b }));
+	QVERIFY(querySet(index, QRectF(10.0, 10.0, 1.0, 1.0)).empty());
+	
+	// Touching borders count, unlike QRectF::intersects()
+	QCOMPARE(querySet(index, QRectF(1.0, 1.0, 0.0, 0.0)), std::set<Item*>({ &a }));
+	
+	a.extent = QRectF(100.0, 100.0, 2.0, 2.0);
+	QVERIFY(index.update(&a, a.extent));
+	QVERIFY(querySet(index, QRectF(-1.0, -1.0, 3.0, 3.0)).empty());
+	QCOMPARE(querySet(index, QRectF(101.0, 101.0, 0.5, 0.5)), std::set<Item*>({ &a }));
+	
+	QVERIFY(index.remove(&a));
+	QVERIFY(!index.remove(&a));
+	QVERIFY(!index.update(&a, a.extent));
+	QVERIFY(!index.contains(&a));
+	QVERIFY(querySet(index, QRectF(101.0, 101.0, 0.5, 0.5)).empty());
+	QCOMPARE(index.size(), std::size_t(1));
+	
+	index.clear();
+	QVERIFY(index.empty());
+	QVERIFY(querySet(index, QRectF(21.0, 21.0, 1.0, 1.0)).empty());
+}
+
+void SpatialIndexTest::invalidExtentTest()
+{
+	Item a { QRectF() };
+	Item b { QRectF(0.0, 0.0, 1.0, 1.0) };
+	
+	SpatialIndex<Item> index;
+	index.insert(&a, a.extent);
+	index.insert(&b, b.extent);
+	QCOMPARE(querySet(index, QRectF(50.0, 50.0, 1.0, 1.0)), std::set<Item*>({ &a }));
+	QCOMPARE(index.count(QRectF(50.0, 50.0, 1.0, 1.0)), std::size_t(0));
+	
+	a.extent = QRectF(60.0, 60.0, 1.0, 1.0);
+	index.update(&a, a.extent);
+	QVERIFY(querySet(index, QRectF(50.0, 50.0, 1.0, 1.0)).empty());
+	QCOMPARE(index.count(QRectF(0.0, 0.0, 100.0, 100.0)), std::size_t(2));
+}
+
+void SpatialIndexTest::largeItemsTest()
+{
+	Item small_item { QRectF(0.5, 0.5, 1.0, 1.0) };
+	Item large_item { QRectF(-1000.0, -1000.0, 2000.0, 2000.0) };
+	
+	SpatialIndex<Item> index(1.0);
+	index.insert(&small_item, small_item.extent);
+	index.insert(&large_item, large_item.extent);
+	
+	std::size_t raw_size;
+	QCOMPARE(querySet(index, QRectF(0.0, 0.0, 2.0, 2.0), &raw_size), std::set<Item*>({ &small_item, &large_item }));
+	QCOMPARE(raw_size, std::size_t(2));
+	QCOMPARE(querySet(index, QRectF(900.0, 900.0, 2.0, 2.0)), std::set<Item*>({ &large_item }));
+	QCOMPARE(querySet(index, QRectF(-5000.0, -5000.0, 10000.0, 10000.0), &raw_size), std::set<Item*>({ &small_item, &large_item }));
+	QCOMPARE(raw_size, std::size_t(2));
+	
+	// Items may move between the grid and the list of large items.
+	large_item.extent = QRectF(10.0, 10.0, 1.0, 1.0);
+	index.update(&large_item, large_item.extent);
+	QCOMPARE(querySet(index, QRectF(900.0, 900.0, 2.0, 2.0)).size(), std::size_t(0));
+	small_item.extent = QRectF(-1000.0, -1000.0, 2000.0, 2000.0);
+	index.update(&small_item, small_item.extent);
+	QCOMPARE(querySet(index, QRectF(10.5, 10.5, 0.1, 0.1)), std::set<Item*>({ &small_item, &large_item }));
+}
+
+void SpatialIndexTest::randomizedTest()
+{
+	qsrand(1);
+	auto random = [](qreal min, qreal max) { return min + (max - min) * qrand() / RAND_MAX; };
+	
+	std::vector<Item> items(2000);
+	SpatialIndex<Item> index;
+	for (Item& item : items)
+	{
+		item.extent = QRectF(random(-200.0, 200.0), random(-200.0, 200.0), random(0.01, 20.0), random(0.01, 20.0));
+		index.insert(&item, item.extent);
+	}
+	for (int i = 0; i < 500; ++i)
+	{
+		Item& item = items[qrand() % items.size()];
+		item.extent.translate(random(-20.0, 20.0), random(-20.0, 20.0));
+		index.update(&item, item.extent);
+	}
+	
+	for (int i = 0; i < 100; ++i)
+	{
+		const QRectF rect(random(-250.0, 250.0), random(-250.0, 250.0), random(0.0, 100.0), random(0.0, 100.0));
+		std::set<Item*> expected;
+		for (Item& item : items)
+		{
+			if ( item.extent.left() <= rect.right() && rect.left() <= item.extent.right() &&
+			     item.extent.top() <= rect.bottom() && rect.top() <= item.extent.bottom() )
+			{
+				expected.insert(&item);
+			}
+		}
+		
+		std::size_t raw_size;
+		QCOMPARE(querySet(index, rect, &raw_size), expected);
+		QCOMPARE(raw_size, expected.size());
+		QCOMPARE(index.count(rect), expected.size());
+	}
+}
+
+
+QTEST_GUILESS_MAIN(SpatialIndexTest)
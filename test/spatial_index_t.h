@@ -0,0 +1,46 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_SPATIAL_INDEX_T_H
+#define _OPENORIENTEERING_SPATIAL_INDEX_T_H
+
+#include <QtTest/QtTest>
+
+
+/**
+ * @test Tests the SpatialIndex class template.
+ */
+class SpatialIndexTest : public QObject
+{
+Q_OBJECT
+private slots:
+	/** Tests insertion, update and removal of items. */
+	void basicTest();
+	
+	/** Tests that items without valid extent are always returned. */
+	void invalidExtentTest();
+	
+	/** Tests that large items and large queries return the correct items. */
+	void largeItemsTest();
+	
+	/** Compares query results with a brute force search. */
+	void randomizedTest();
+};
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "task_pool_t.h"
+
+#include <initializer_list>
+#include <vector>
+
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QSemaphore>
+
+#include "../src/core/task_pool.h"
+
+
+namespace
+{
+	class NestedJob : public QRunnable
+	{
+	public:
+		NestedJob(QAtomicInt& sum, QSemaphore& done)
+		 : sum(sum)
+		 , done(done)
+		{ }
+		
+		void run() override
+		{
+			TaskPool::forEach(1000, 10, [this](int i) {
+				sum.fetchAndAddRelaxed(i);
+			});
+			done.release();
+		}
+		
+	private:
+		QAtomicInt& sum;
+		QSemaphore& done;
+	};
+}
+
+
+void TaskPoolTest::forEachTest()
+{
+	QVERIFY(TaskPool::maxThreads() >= 1);
+	
+	for (int count : { 0, 1, 63, 64, 65, 10000 })
+	{
+		std::vector<QAtomicInt> visits(std::size_t(count));
+		TaskPool::forEach(count, 64, [&visits](int i) {
+			visits[std::size_t(i)].ref();
+		});
+		for (const QAtomicInt& value : visits)
+			QCOMPARE(value.load(), 1);
+	}
+}
+
+void TaskPoolTest::cancelTest()
+{
+	TaskPool::CancellationToken token;
+	QVERIFY(!token.isCancelled());
+	
+	QAtomicInt visits(0);
+	TaskPool::forEach(100000, 1, [&token, &visits](int) {
+		visits.ref();
+		token.cancel();
+	}, &token);
+	QVERIFY(token.isCancelled());
+	QVERIFY(visits.load() >= 1);
+	QVERIFY(visits.load() <= TaskPool::maxThreads());
+}
+
+void TaskPoolTest::nestedTest()
+{
+	// More jobs than threads: the caller of forEach() must never wait for
+	// helpers which cannot start.
+	const int num_jobs = 2 * TaskPool::maxThreads() + 1;
+	QAtomicInt sum(0);
+	QSemaphore done;
+	for (int i = 0; i < num_jobs; ++i)
+		TaskPool::start(new NestedJob(sum, done), TaskPool::Background);
+	done.acquire(num_jobs);
+	QCOMPARE(sum.load(), num_jobs * 999 * 1000 / 2);
+}
+
+
+QTEST_GUILESS_MAIN(TaskPoolTest)
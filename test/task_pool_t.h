@@ -0,0 +1,44 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_TASK_POOL_T_H
+#define _OPENORIENTEERING_TASK_POOL_T_H
+
+#include <QtTest/QtTest>
+
+
+/**
+ * @test Tests the shared pool of worker threads.
+ */
+class TaskPoolTest : public QObject
+{
+Q_OBJECT
+private slots:
+	/** Tests that forEach() processes each index exactly once. */
+	void forEachTest();
+	
+	/** Tests that forEach() stops taking chunks when cancelled. */
+	void cancelTest();
+	
+	/** Tests forEach() from within jobs which occupy the pool. */
+	void nestedTest();
+};
+
+#endif
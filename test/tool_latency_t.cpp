@@ -0,0 +1,306 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tool_latency_t.h"
+
+#include <cmath>
+#include <initializer_list>
+
+#include "../src/global.h"
+#include "../src/input_recording.h"
+#include "../src/map.h"
+#include "../src/map_editor.h"
+#include "../src/map_part.h"
+#include "../src/map_widget.h"
+#include "../src/object.h"
+#include "../src/symbol.h"
+#include "../src/tool_cut.h"
+#include "../src/tool_draw_path.h"
+#include "../src/tool_edit_line.h"
+#include "../src/tool_edit_point.h"
+#include "../src/gui/main_window.h"
+
+#include "map_generator.h"
+
+
+namespace
+{
+	const QString synthetic_prefix = QString("synthetic:");
+	
+	/** The number of objects of the synthetic map. */
+	const int synthetic_objects = 10000;
+	
+	/** The number of paths drawn or edited by a built-in session. */
+	const int session_paths = 10;
+	
+	
+	/** Appends a mouse event to the recording. */
+	void addMouseEvent(InputRecording& recording, QEvent::Type type, QPoint pos, Qt::MouseButton button, Qt::MouseButtons buttons)
+	{
+		const qint64 time = qint64(recording.events.size()) * 10;
+		InputRecording::Event event = { time, type, pos, button, buttons, Qt::NoModifier, 0, QString(), 0 };
+		recording.events.push_back(event);
+	}
+	
+	/** Appends a mouse click to the recording. */
+	void addClick(InputRecording& recording, QPoint pos)
+	{
+		addMouseEvent(recording, QEvent::MouseButtonPress, pos, Qt::LeftButton, Qt::LeftButton);
+		addMouseEvent(recording, QEvent::MouseButtonRelease, pos, Qt::LeftButton, Qt::NoButton);
+	}
+	
+	/** Appends mouse moves from start to end to the recording. */
+	void addMoves(InputRecording& recording, QPoint start, QPoint end, int steps, Qt::MouseButtons buttons)
+	{
+		for (int i = 1; i <= steps; ++i)
+			addMouseEvent(recording, QEvent::MouseMove, start + (end - start) * i / steps, Qt::NoButton, buttons);
+	}
+	
+	/** Appends a key press and release to the recording. */
+	void addKey(InputRecording& recording, int key, Qt::KeyboardModifiers modifiers)
+	{
+		const qint64 time = qint64(recording.events.size()) * 10;
+		InputRecording::Event press = { time, QEvent::KeyPress, QPoint(), Qt::NoButton, Qt::NoButton, modifiers, key, QString(), 0 };
+		recording.events.push_back(press);
+		InputRecording::Event release = press;
+		release.type = QEvent::KeyRelease;
+		recording.events.push_back(release);
+	}
+	
+	/** Returns the path objects of the current part whose vertices are all in the viewport. */
+	std::vector<PathObject*> visiblePaths(Map& map, const MapWidget& widget, int max_count)
+	{
+		std::vector<PathObject*> paths;
+		const QRectF viewport = QRectF(widget.rect()).adjusted(10, 10, -10, -10);
+		MapPart* part = map.getCurrentPart();
+		for (int i = 0; i < part->getNumObjects() && int(paths.size()) < max_count; ++i)
+		{
+			Object* object = part->getObject(i);
+			if (object->getType() != Object::Path || object->getRawCoordinateVector().size() < 3)
+				continue;
+			
+			bool visible = true;
+			for (const auto& coord : object->getRawCoordinateVector())
+				visible = visible && viewport.contains(widget.mapToViewport(coord));
+			if (visible)
+				paths.push_back(object->asPath());
+		}
+		return paths;
+	}
+	
+	/** Returns the first line symbol of the map, or nullptr. */
+	const Symbol* firstLineSymbol(const Map& map)
+	{
+		for (int i = 0; i < map.getNumSymbols(); ++i)
+		{
+			const Symbol* symbol = map.getSymbol(i);
+			if (symbol->getType() == Symbol::Line && !symbol->isHidden())
+				return symbol;
+		}
+		return nullptr;
+	}
+	
+	/** Creates a built-in session for the tool. */
+	void createSession(InputRecording& recording, Map& map, const MapWidget& widget)
+	{
+		const QRect area = widget.rect().adjusted(20, 20, -20, -20);
+		if (recording.tool_name == QLatin1String("DrawPathTool"))
+		{
+			// Polylines with hovering between the clicks
+			const Symbol* symbol = firstLineSymbol(map);
+			recording.symbol_index = symbol ? map.findSymbolIndex(symbol) : -1;
+			QPoint pos = area.center();
+			for (int i = 0; i < session_paths; ++i)
+			{
+				for (int j = 0; j < 10; ++j)
+				{
+					const double angle = (i * 10 + j) * 0.7;
+					const QPoint next(area.left() + qRound(area.width() * (0.5 + 0.4 * std::cos(angle))),
+					                  area.top() + qRound(area.height() * (0.5 + 0.4 * std::sin(angle * 1.3))));
+					addMoves(recording, pos, next, 5, Qt::NoButton);
+					addClick(recording, next);
+					pos = next;
+				}
+				addKey(recording, Qt::Key_Return, Qt::ControlModifier);
+			}
+		}
+		else if (recording.tool_name == QLatin1String("EditPointTool"))
+		{
+			// Select a path by clicking at a vertex, and drag the vertex
+			for (const auto path : visiblePaths(map, widget, session_paths))
+			{
+				const QPoint start = widget.mapToViewport(path->getCoordinate(0)).toPoint();
+				const QPoint end = start + QPoint(30, 20);
+				addClick(recording, start);
+				addMouseEvent(recording, QEvent::MouseButtonPress, start, Qt::LeftButton, Qt::LeftButton);
+				addMoves(recording, start, end, 20, Qt::LeftButton);
+				addMouseEvent(recording, QEvent::MouseButtonRelease, end, Qt::LeftButton, Qt::NoButton);
+			}
+		}
+		else if (recording.tool_name == QLatin1String("CutTool"))
+		{
+			// Hover over the selected paths, and cut each at a vertex
+			map.clearObjectSelection(false);
+			QPoint pos = area.center();
+			for (const auto path : visiblePaths(map, widget, session_paths))
+			{
+				map.addObjectToSelection(path, false);
+				const QPoint next = widget.mapToViewport(path->getCoordinate(1)).toPoint();
+				addMoves(recording, pos, next, 10, Qt::NoButton);
+				addClick(recording, next);
+				pos = next;
+			}
+			map.emitSelectionChanged();
+		}
+	}
+	
+	/** Creates a tool by class name, or returns nullptr. */
+	MapEditorTool* createTool(const QString& name, MapEditorController* editor)
+	{
+		if (name == QLatin1String("DrawPathTool"))
+			return new DrawPathTool(editor, nullptr, false, true);
+		if (name == QLatin1String("EditPointTool"))
+			return new EditPointTool(editor, nullptr);
+		if (name == QLatin1String("EditLineTool"))
+			return new EditLineTool(editor, nullptr);
+		if (name == QLatin1String("CutTool"))
+			return new CutTool(editor, nullptr);
+		return nullptr;
+	}
+	
+	QString milliseconds(qint64 nsecs)
+	{
+		return QString::number(nsecs / 1000000.0, 'f', 3);
+	}
+}
+
+
+
+void ToolLatencyTest::initTestCase()
+{
+	QCoreApplication::setOrganizationName("OpenOrienteering.org");
+	QCoreApplication::setApplicationName("ToolLatencyTest");
+	Q_INIT_RESOURCE(resources);
+	doStaticInitializations();
+	
+	bool ok = false;
+	threshold = qgetenv("MAPPER_LATENCY_THRESHOLD").toLongLong(&ok) * 1000000;
+	if (!ok || threshold <= 0)
+		threshold = 100 * 1000000;
+	
+	const QString recordings_dir = QString::fromLocal8Bit(qgetenv("MAPPER_INPUT_RECORDINGS"));
+	if (!recordings_dir.isEmpty())
+	{
+		for (const auto& file : QDir(recordings_dir).entryInfoList(QStringList() << "*.input", QDir::Files, QDir::Name))
+			recording_files.push_back(file.absoluteFilePath());
+	}
+}
+
+
+void ToolLatencyTest::replay_data()
+{
+	QTest::addColumn<QString>("source");
+	for (const auto& tool : { "DrawPathTool", "EditPointTool", "CutTool" })
+		QTest::newRow(tool) << (synthetic_prefix + QString::fromLatin1(tool));
+	for (const auto& file : recording_files)
+		QTest::newRow(QFileInfo(file).fileName().toLocal8Bit()) << file;
+}
+
+void ToolLatencyTest::replay()
+{
+	QFETCH(QString, source);
+	
+	// The map is owned by the editor.
+	Map* map = new Map();
+	InputRecording recording;
+	if (source.startsWith(synthetic_prefix))
+	{
+		recording.tool_name = source.mid(synthetic_prefix.length());
+		MapGenerator::Options options;
+		options.num_objects = synthetic_objects;
+		QVERIFY(MapGenerator::loadSymbolSet(*map, MapGenerator::isomSymbolSetPath()));
+		MapGenerator(options).generateObjects(*map);
+	}
+	else
+	{
+		QFile file(source);
+		QVERIFY(file.open(QIODevice::ReadOnly | QIODevice::Text));
+		QVERIFY(recording.read(&file));
+		QVERIFY2(map->loadFrom(recording.map_path, nullptr, nullptr, false, false),
+		         QString("Cannot load %1").arg(recording.map_path).toLocal8Bit());
+		for (int i = 0; i < map->getNumParts(); ++i)
+			map->getPart(i)->ensureLoaded();
+	}
+	
+	MainWindow window(true);
+	MapEditorController* editor = new MapEditorController(MapEditorController::MapEditor, map);
+	window.setController(editor);
+	MapWidget* map_widget = editor->getMainWidget();
+	window.show();
+	QCoreApplication::processEvents();
+	
+	if (source.startsWith(synthetic_prefix))
+	{
+		recording.begin(*map_widget);
+		createSession(recording, *map, *map_widget);
+	}
+	else
+	{
+		// Make room for the map widget in the window.
+		window.resize(window.size() + recording.widget_size - map_widget->size());
+	}
+	QVERIFY(!recording.events.empty());
+	
+	MapEditorTool* tool = createTool(recording.tool_name, editor);
+	QVERIFY2(tool, QString("Unsupported tool: %1").arg(recording.tool_name).toLocal8Bit());
+	editor->setTool(tool);
+	if (recording.symbol_index >= 0 && recording.symbol_index < map->getNumSymbols())
+	{
+		const Symbol* symbol = map->getSymbol(recording.symbol_index);
+		QMetaObject::invokeMethod(tool, "setDrawingSymbol", Q_ARG(const Symbol*, symbol));
+	}
+	
+	const auto latencies = recording.replay(map_widget);
+	QCOMPARE(latencies.size(), recording.events.size());
+	
+	const auto times = InputRecording::totalTimes(latencies);
+	const qint64 p50 = InputRecording::percentile(times, 50);
+	const qint64 p95 = InputRecording::percentile(times, 95);
+	const qint64 max = InputRecording::percentile(times, 100);
+	qDebug("%d events: p50 %s ms, p95 %s ms, max %s ms", int(times.size()),
+	       qPrintable(milliseconds(p50)), qPrintable(milliseconds(p95)), qPrintable(milliseconds(max)));
+	QTest::setBenchmarkResult(p95 / 1000000.0, QTest::WalltimeMilliseconds);
+	
+	editor->setTool(nullptr);
+	
+	QVERIFY2(p95 <= threshold, QString("The 95th percentile of %1 ms exceeds the threshold of %2 ms")
+	                           .arg(milliseconds(p95), milliseconds(threshold)).toLocal8Bit());
+}
+
+
+/*
+ * We select a non-standard QPA because we don't need a real GUI window.
+ *
+ * Normally, the "offscreen" plugin would be the correct one.
+ * However, it bails out with a QFontDatabase error (cf. QTBUG-33674)
+ */
+auto qpa_selected = qputenv("QT_QPA_PLATFORM", "minimal");
+
+
+QTEST_MAIN(ToolLatencyTest)
@@ -0,0 +1,64 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OPENORIENTEERING_TOOL_LATENCY_T_H
+#define _OPENORIENTEERING_TOOL_LATENCY_T_H
+
+#include <vector>
+
+#include <QtTest/QtTest>
+
+
+/**
+ * @test Benchmarks the latency of the editing tools, by replaying input.
+ *
+ * Each session is a sequence of input events for a single tool, which is
+ * replayed by InputRecording against a visible map widget. The test measures
+ * the time for processing each event and for the resulting repaint, and it
+ * fails when the 95th percentile exceeds a threshold. The threshold is 100 ms,
+ * unless given in milliseconds by the environment variable
+ * MAPPER_LATENCY_THRESHOLD.
+ *
+ * The built-in sessions use DrawPathTool, EditPointTool and CutTool on a
+ * synthetic map, see MapGenerator. In addition, the recordings (*.input)
+ * found in the directory given by the environment variable
+ * MAPPER_INPUT_RECORDINGS are replayed against the maps where they were
+ * recorded. Recordings are made with "Record input" in the map editor's view
+ * menu.
+ */
+class ToolLatencyTest : public QObject
+{
+Q_OBJECT
+private slots:
+	/** Initialization. */
+	void initTestCase();
+	
+	/** Replays a session, and checks the 95th percentile of the latencies. */
+	void replay();
+	void replay_data();
+
+private:
+	/** The recordings from MAPPER_INPUT_RECORDINGS. */
+	std::vector<QString> recording_files;
+	
+	/** The maximum 95th percentile, in nanoseconds. */
+	qint64 threshold;
+};
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tracing_t.h"
+
+#include <QBuffer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "../src/core/tracing.h"
+
+
+void TracingTest::recordingTest()
+{
+	Tracing::stop();
+	Tracing::start();
+	Tracing::stop();
+	{
+		TraceScope scope("test", "not recorded");
+	}
+	Tracing::addCounter("test", "not recorded", 1);
+	QVERIFY(!Tracing::isRecording());
+	QCOMPARE(Tracing::numEvents(), std::size_t(0));
+	
+	Tracing::start();
+	QVERIFY(Tracing::isRecording());
+	{
+		TraceScope scope("test", "scope");
+	}
+	Tracing::addCounter("test", "counter", 42);
+	Tracing::stop();
+	QCOMPARE(Tracing::numEvents(), std::size_t(2));
+	QCOMPARE(Tracing::numDroppedEvents(), std::size_t(0));
+	
+	// A new recording discards the previous trace.
+	Tracing::start();
+	Tracing::stop();
+	QCOMPARE(Tracing::numEvents(), std::size_t(0));
+}
+
+void TracingTest::chromeTraceTest()
+{
+	Tracing::start();
+	{
+		TraceScope outer("test", "outer \"quoted\"");
+		TraceScope inner("test", "inner");
+		QTest::qSleep(2);
+	}
+	Tracing::addCounter("test", "counter", 42);
+	Tracing::stop();
+	
+	QBuffer buffer;
+	buffer.open(QIODevice::WriteOnly);
+	QVERIFY(Tracing::writeChromeTrace(&buffer));
+	buffer.close();
+	
+	QJsonParseError error;
+	const QJsonDocument document = QJsonDocument::fromJson(buffer.data(), &error);
+	QCOMPARE(error.error, QJsonParseError::NoError);
+	const QJsonArray events = document.object().value(QLatin1String("traceEvents")).toArray();
+	QCOMPARE(events.size(), 3);
+	
+	// Scopes are recorded when they end.
+	const QJsonObject inner = events[0].toObject();
+	const QJsonObject outer = events[1].toObject();
+	QCOMPARE(inner.value(QLatin1String("name")).toString(), QString::fromLatin1("inner"));
+	QCOMPARE(inner.value(QLatin1String("ph")).toString(), QString::fromLatin1("X"));
+	QCOMPARE(outer.value(QLatin1String("name")).toString(), QString::fromLatin1("outer \"quoted\""));
+	QVERIFY(outer.value(QLatin1String("ts")).toDouble() <= inner.value(QLatin1String("ts")).toDouble());
+	QVERIFY(outer.value(QLatin1String("dur")).toDouble() >= inner.value(QLatin1String("dur")).toDouble());
+	QVERIFY(inner.value(QLatin1String("dur")).toDouble() >= 1000);
+	
+	const QJsonObject counter = events[2].toObject();
+	QCOMPARE(counter.value(QLatin1String("ph")).toString(), QString::fromLatin1("C"));
+	QCOMPARE(counter.value(QLatin1String("args")).toObject().value(QLatin1String("value")).toInt(), 42);
+}
+
+
+QTEST_GUILESS_MAIN(TracingTest)
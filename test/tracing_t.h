@@ -0,0 +1,41 @@
+/*
+ *    Copyright 2026 The OpenOrienteering developers
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _OPENORIENTEERING_TRACING_T_H
+#define _OPENORIENTEERING_TRACING_T_H
+
+#include <QtTest/QtTest>
+
+
+/**
+ * @test Tests the recording and writing of traces.
+ */
+class TracingTest : public QObject
+{
+Q_OBJECT
+private slots:
+	/** Tests that nothing is recorded before start() and after stop(). */
+	void recordingTest();
+	
+	/** Tests the written Chrome trace JSON. */
+	void chromeTraceTest();
+};
+
+#endif
@@ -201,6 +201,92 @@ void UndoManagerTest::testUndoRedo()
 	QVERIFY(!undo_manager.canRedo());
 }
 
+// test
+void UndoManagerTest::testDropSteps()
+{
+	Map* const map = NULL;
+	UndoManager undo_manager(map);
+	const std::size_t max_steps = UndoManager::max_undo_steps;
+	
+	undo_manager.setLoaded();
+	for (std::size_t i = 0; i < 10; ++i)
+		undo_manager.push(new NoOpUndoStep(map, true));
+	undo_manager.setClean();
+	
+	// Push more steps than the limit.
+	for (std::size_t i = 0; i < max_steps; ++i)
+		undo_manager.push(new NoOpUndoStep(map, true));
+	QCOMPARE(undo_manager.undoStepCount(), max_steps);
+	QCOMPARE(undo_manager.droppedStepCount(), std::size_t(10));
+	
+	// The clean state is the oldest reachable state, the loaded state is gone.
+	for (std::size_t i = 0; i < max_steps; ++i)
+	{
+		QVERIFY(!undo_manager.isClean());
+		QVERIFY(undo_manager.undo());
+	}
+	QVERIFY(undo_manager.isClean());
+	QVERIFY(!undo_manager.isLoaded());
+	QVERIFY(!undo_manager.canUndo());
+	
+	// Pushing clears the redo steps.
+	undo_manager.push(new NoOpUndoStep(map, true));
+	QCOMPARE(undo_manager.undoStepCount(), std::size_t(1));
+	QCOMPARE(undo_manager.redoStepCount(), std::size_t(0));
+	QCOMPARE(undo_manager.droppedStepCount(), std::size_t(10));
+	
+	// An invalid step makes all older steps unreachable.
+	undo_manager.push(new NoOpUndoStep(map, true));
+	undo_manager.push(new NoOpUndoStep(map, false));
+	QCOMPARE(undo_manager.undoStepCount(), std::size_t(1));
+	QCOMPARE(undo_manager.droppedStepCount(), std::size_t(12));
+	QVERIFY(!undo_manager.isClean());
+	QVERIFY(!undo_manager.canUndo());
+	
+	undo_manager.clear();
+	QCOMPARE(undo_manager.droppedStepCount(), std::size_t(0));
+}
+
+// test
+void UndoManagerTest::testStepSerials()
+{
+	Map* const map = NULL;
+	UndoManager undo_manager(map);
+	
+	undo_manager.push(new NoOpUndoStep(map, true));
+	undo_manager.push(new NoOpUndoStep(map, true));
+	const quint64 first = undo_manager.undoStepSerial(0);
+	const quint64 second = undo_manager.undoStepSerial(1);
+	QVERIFY(first != 0);
+	QVERIFY(second > first);
+	
+	// Undo and redo replace the step objects, but not the serial numbers.
+	QVERIFY(undo_manager.undo());
+	QVERIFY(undo_manager.redo());
+	QCOMPARE(undo_manager.undoStepSerial(0), first);
+	QCOMPARE(undo_manager.undoStepSerial(1), second);
+	
+	// A new step at the same index gets a new serial number.
+	QVERIFY(undo_manager.undo());
+	undo_manager.push(new NoOpUndoStep(map, true));
+	QCOMPARE(undo_manager.undoStepSerial(0), first);
+	QVERIFY(undo_manager.undoStepSerial(1) > second);
+	
+	// Dropping steps keeps the serial numbers of the remaining steps.
+	const quint64 last = undo_manager.undoStepSerial(1);
+	for (std::size_t i = 0; i < UndoManager::max_undo_steps; ++i)
+		undo_manager.push(new NoOpUndoStep(map, true));
+	QCOMPARE(undo_manager.undoStepSerial(0), last + 1);
+	
+	// Without a map, no forward steps can be recorded.
+	undo_manager.setRecordingForwardSteps(true);
+	undo_manager.push(new NoOpUndoStep(map, true));
+	QByteArray data;
+	QVERIFY(!undo_manager.saveForwardSteps(undo_manager.undoStepCount() - 1, data));
+	QVERIFY(undo_manager.saveForwardSteps(undo_manager.undoStepCount(), data));
+	QVERIFY(data.isEmpty());
+}
+
 void UndoManagerTest::resetAllChanged()
 {
 	loaded_changed   = false;
@@ -38,6 +38,16 @@ private slots:
 	 */
 	void testUndoRedo();
 	
+	/**
+	 * Tests that old and unreachable undo steps are dropped.
+	 */
+	void testDropSteps();
+	
+	/**
+	 * Tests that serial numbers identify steps across undo and redo.
+	 */
+	void testStepSerials();
+	
 private:
 	bool clean_changed;
 	bool clean;